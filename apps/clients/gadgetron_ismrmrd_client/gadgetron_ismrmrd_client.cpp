@@ -38,8 +38,20 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <mutex>
+#include <vector>
 
 #include "NHLBICompression.h"
+#include "MetaContainerBinary.h"
+#include "ImageCompression.h"
+#include "GadgetSharedMemoryRingLayout.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if defined GADGETRON_COMPRESSION_ZFP
 #include "zfp/zfp.h"
@@ -189,6 +201,9 @@ size_t compress_zfp_precision(float* in, size_t samples, size_t coils, unsigned
 namespace po = boost::program_options;
 using boost::asio::ip::tcp;
 
+// TCP or, with local-socket, a Unix domain socket
+typedef boost::asio::generic::stream_protocol::socket client_socket;
+
 
 enum GadgetronMessageID {
     GADGET_MESSAGE_INT_ID_MIN                             =   0,
@@ -197,6 +212,11 @@ enum GadgetronMessageID {
     GADGET_MESSAGE_PARAMETER_SCRIPT                       =   3,
     GADGET_MESSAGE_CLOSE                                  =   4,
     GADGET_MESSAGE_TEXT                                   =   5,
+    GADGET_MESSAGE_SHM_ATTACH                             =   6,
+    GADGET_MESSAGE_ATTRIBUTE_ENCODING                     =   7,
+    GADGET_MESSAGE_IMAGE_COMPRESSION                      =   8,
+    GADGET_MESSAGE_STREAM_PRIORITY                        =   9,
+    GADGET_MESSAGE_FILE_INGEST                            =  10,
     GADGET_MESSAGE_INT_ID_MAX                             = 999,
     GADGET_MESSAGE_EXT_ID_MIN                             = 1000,
     GADGET_MESSAGE_ACQUISITION                            = 1001, /**< DEPRECATED */
@@ -222,6 +242,9 @@ enum GadgetronMessageID {
     GADGET_MESSAGE_ISMRMRD_IMAGEWITHATTRIB_REAL_SHORT     = 1021, /**< DEPRECATED */
     GADGET_MESSAGE_ISMRMRD_IMAGE                          = 1022,
     GADGET_MESSAGE_RECONDATA                              = 1023,
+    GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH              = 1024,
+    GADGET_MESSAGE_ISMRMRD_ACQUISITION_SHM                = 1025,
+    GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED               = 1026,
     GADGET_MESSAGE_EXT_ID_MAX                             = 4096
 };
 
@@ -242,6 +265,59 @@ struct GadgetMessageScript
     uint32_t script_length;
 };
 
+enum GadgetAttributeEncodingType {
+    GADGET_ATTRIBUTE_ENCODING_XML    = 0,
+    GADGET_ATTRIBUTE_ENCODING_BINARY = 1
+};
+
+struct GadgetMessageAttributeEncoding
+{
+    uint32_t encoding;
+};
+
+struct GadgetMessageImageCompression
+{
+    uint32_t mode;
+    float tolerance;
+};
+
+enum GadgetStreamPriority {
+    GADGET_STREAM_PRIORITY_REALTIME = 0,
+    GADGET_STREAM_PRIORITY_BATCH    = 1
+};
+
+struct GadgetMessageStreamPriority
+{
+    uint32_t priority;
+};
+
+// The server reads the header and the acquisitions of this file itself
+struct GadgetMessageFileIngest
+{
+    char filename[1024];
+    char group[256];
+    uint32_t chunk_acquisitions;
+};
+
+// Names the shared memory ring that carries the payload of the following acquisitions, local connections only
+struct GadgetMessageSharedMemoryAttach
+{
+    char name[256];
+};
+
+// The server may send the meta attributes of an image in the binary form if it was requested, they are stored as XML
+std::string meta_attributes_as_xml(const std::string& meta_attrib)
+{
+    if (!Gadgetron::is_meta_binary(meta_attrib.c_str(), meta_attrib.length())) return meta_attrib;
+
+    ISMRMRD::MetaContainer meta;
+    Gadgetron::deserialize_meta_binary(meta_attrib.c_str(), meta_attrib.length(), meta);
+
+    std::stringstream str;
+    ISMRMRD::serialize(meta, str);
+    return str.str();
+}
+
 class GadgetronClientException : public std::exception
 {
 
@@ -271,8 +347,91 @@ public:
     /**
     Function must be implemented to read a specific message.
     */
-    virtual void read(tcp::socket* s) = 0;
+    virtual void read(client_socket* s) = 0;
+
+};
+
+// Reads the pixel data of an image message, decompressing the chunks of a GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED
+void read_image_data(client_socket* stream, const ISMRMRD::ImageHeader& h, void* data, size_t bytes, bool compressed)
+{
+    if (!compressed)
+    {
+        boost::asio::read(*stream, boost::asio::buffer(data, bytes));
+        return;
+    }
 
+    Gadgetron::ImageCompressionHeader ch;
+    boost::asio::read(*stream, boost::asio::buffer(&ch, sizeof(Gadgetron::ImageCompressionHeader)));
+
+    std::vector<Gadgetron::ImageCompressionChunk> table(ch.chunks);
+    if (ch.chunks > 0)
+    {
+        boost::asio::read(*stream, boost::asio::buffer(table.data(), sizeof(Gadgetron::ImageCompressionChunk)*table.size()));
+    }
+
+    const size_t element_size = Gadgetron::image_element_size(h.data_type);
+    if (ch.uncompressed_bytes != bytes || element_size == 0)
+    {
+        throw GadgetronClientException("Compressed image does not match its header");
+    }
+
+    std::vector<char> buffer;
+    size_t offset = 0;
+    for (size_t c = 0; c < table.size(); c++)
+    {
+        if ((offset + table[c].elements)*element_size > bytes)
+        {
+            throw GadgetronClientException("Compressed image chunks exceed the image");
+        }
+
+        buffer.resize(table[c].bytes);
+        boost::asio::read(*stream, boost::asio::buffer(buffer.data(), buffer.size()));
+
+        try
+        {
+            Gadgetron::decompress_image_chunk(ch.mode, h.data_type, buffer.data(), buffer.size(), static_cast<char*>(data) + offset*element_size, table[c].elements);
+        }
+        catch (std::exception& e)
+        {
+            throw GadgetronClientException(std::string("Unable to decompress image: ") + e.what());
+        }
+        offset += table[c].elements;
+    }
+
+    if (offset*element_size != bytes)
+    {
+        throw GadgetronClientException("Compressed image chunks do not cover the image");
+    }
+}
+
+// Image readers read both the plain and the compressed image messages
+class GadgetronClientImageReader : public GadgetronClientMessageReader
+{
+public:
+    virtual void read(client_socket* s)
+    {
+        this->read_image(s, false);
+    }
+
+    virtual void read_image(client_socket* s, bool compressed) = 0;
+};
+
+// Reader of GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED, hands the images to the reader of the uncompressed ones
+class GadgetronClientCompressedImageMessageReader : public GadgetronClientMessageReader
+{
+public:
+    GadgetronClientCompressedImageMessageReader(boost::shared_ptr<GadgetronClientImageReader> reader)
+        : reader_(reader)
+    {
+    }
+
+    virtual void read(client_socket* s)
+    {
+        reader_->read_image(s, true);
+    }
+
+protected:
+    boost::shared_ptr<GadgetronClientImageReader> reader_;
 };
 
 class GadgetronClientTextReader : public GadgetronClientMessageReader
@@ -289,7 +448,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(client_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -334,7 +493,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(client_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -380,7 +539,7 @@ public:
 };
 
 
-class GadgetronClientImageMessageReader : public GadgetronClientMessageReader
+class GadgetronClientImageMessageReader : public GadgetronClientImageReader
 {
 
 public:
@@ -395,7 +554,7 @@ public:
     } 
 
     template <typename T> 
-    void read_data_attrib(tcp::socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
+    void read_data_attrib(client_socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im, bool compressed)
     {
         im.setHead(h);
 
@@ -409,11 +568,11 @@ public:
         {
             std::string meta_attrib(meta_attrib_length, 0);
             boost::asio::read(*stream, boost::asio::buffer(const_cast<char*>(meta_attrib.c_str()), meta_attrib_length));
-            im.setAttributeString(meta_attrib);
+            im.setAttributeString(meta_attributes_as_xml(meta_attrib));
         }
 
         //Read image data
-        boost::asio::read(*stream, boost::asio::buffer(im.getDataPtr(), im.getDataSize()));
+        read_image_data(stream, h, im.getDataPtr(), im.getDataSize(), compressed);
         {
             if (!dataset_) {
 
@@ -437,7 +596,7 @@ public:
         }
     }
 
-    virtual void read(tcp::socket* stream) 
+    virtual void read_image(client_socket* stream, bool compressed)
     {
         //Read the image headerfrom the socket
         ISMRMRD::ImageHeader h;
@@ -446,42 +605,42 @@ public:
         if (h.data_type == ISMRMRD::ISMRMRD_USHORT)
         {
             ISMRMRD::Image<unsigned short> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_SHORT)
         {
             ISMRMRD::Image<short> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_UINT)
         {
             ISMRMRD::Image<unsigned int> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_INT)
         {
             ISMRMRD::Image<int> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_FLOAT)
         {
             ISMRMRD::Image<float> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_DOUBLE)
         {
             ISMRMRD::Image<double> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_CXFLOAT)
         {
             ISMRMRD::Image< std::complex<float> > im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_CXDOUBLE)
         {
             ISMRMRD::Image< std::complex<double> > im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else
         {
@@ -808,7 +967,7 @@ public:
     }
 };
 
-class GadgetronClientAnalyzeImageMessageReader : public GadgetronClientMessageReader
+class GadgetronClientAnalyzeImageMessageReader : public GadgetronClientImageReader
 {
 
 public:
@@ -822,7 +981,7 @@ public:
     } 
 
     template <typename T>
-    void read_data_attrib(tcp::socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im)
+    void read_data_attrib(client_socket* stream, const ISMRMRD::ImageHeader& h, ISMRMRD::Image<T>& im, bool compressed)
     {
         im.setHead(h);
 
@@ -856,6 +1015,7 @@ public:
         {
             std::string meta_attrib(meta_attrib_length, 0);
             boost::asio::read(*stream, boost::asio::buffer(const_cast<char*>(meta_attrib.c_str()), meta_attrib_length));
+            meta_attrib = meta_attributes_as_xml(meta_attrib);
 
             // deserialize the meta attribute
             ISMRMRD::MetaContainer imgAttrib;
@@ -867,12 +1027,12 @@ public:
 
             std::ofstream outfile;
             outfile.open(meta_varname.c_str(), std::ios::out | std::ios::binary);
-            outfile.write(meta_attrib.c_str(), meta_attrib_length);
+            outfile.write(meta_attrib.c_str(), meta_attrib.length());
             outfile.close();
         }
 
         //Read data
-        boost::asio::read(*stream, boost::asio::buffer(im.getDataPtr(), im.getDataSize()));
+        read_image_data(stream, h, im.getDataPtr(), im.getDataSize(), compressed);
 
         // analyze header
         std::stringstream st1;
@@ -910,7 +1070,7 @@ public:
         outfileData.close();
     }
 
-    virtual void read(tcp::socket* stream) 
+    virtual void read_image(client_socket* stream, bool compressed)
     {
         //Read the image headerfrom the socket
         ISMRMRD::ImageHeader h;
@@ -919,42 +1079,42 @@ public:
         if (h.data_type == ISMRMRD::ISMRMRD_USHORT)
         {
             ISMRMRD::Image<unsigned short> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_SHORT)
         {
             ISMRMRD::Image<short> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_UINT)
         {
             ISMRMRD::Image<unsigned int> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_INT)
         {
             ISMRMRD::Image<int> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_FLOAT)
         {
             ISMRMRD::Image<float> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_DOUBLE)
         {
             ISMRMRD::Image<double> im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_CXFLOAT)
         {
             ISMRMRD::Image< std::complex<float> > im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else if (h.data_type == ISMRMRD::ISMRMRD_CXDOUBLE)
         {
             ISMRMRD::Image< std::complex<double> > im;
-            this->read_data_attrib(stream, h, im);
+            this->read_data_attrib(stream, h, im, compressed);
         }
         else
         {
@@ -987,7 +1147,7 @@ public:
 
     virtual ~GadgetronClientBlobMessageReader() {}
 
-    virtual void read(tcp::socket* socket) 
+    virtual void read(client_socket* socket) 
     {
 
         // MUST READ 32-bits
@@ -1064,6 +1224,72 @@ protected:
 
 };
 
+/**
+   The shared memory ring of a local connection (see GadgetSharedMemoryRing.h on the server).
+   The client creates the segment and removes it again, the server maps it on GADGET_MESSAGE_SHM_ATTACH.
+*/
+class GadgetronClientSharedMemory
+{
+public:
+    GadgetronClientSharedMemory(const std::string& name, size_t capacity)
+        : name_(name)
+        , base_(0)
+        , size_(0)
+    {
+#ifndef _WIN32
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if (fd == -1) {
+            throw GadgetronClientException("Unable to create shared memory " + name);
+        }
+
+        size_ = Gadgetron::GadgetSharedMemoryRingView::DATA_OFFSET + capacity;
+        if (ftruncate(fd, size_) == -1) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            throw GadgetronClientException("Unable to size shared memory " + name);
+        }
+
+        base_ = mmap(0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base_ == MAP_FAILED) {
+            base_ = 0;
+            shm_unlink(name.c_str());
+            throw GadgetronClientException("Unable to map shared memory " + name);
+        }
+
+        ring_.initialize(base_, capacity);
+#else
+        throw GadgetronClientException("Shared memory is not available on this platform");
+#endif
+    }
+
+    ~GadgetronClientSharedMemory()
+    {
+#ifndef _WIN32
+        if (base_) {
+            munmap(base_, size_);
+            shm_unlink(name_.c_str());
+        }
+#endif
+    }
+
+    const std::string& name() const
+    {
+        return name_;
+    }
+
+    Gadgetron::GadgetSharedMemoryRingView& ring()
+    {
+        return ring_;
+    }
+
+protected:
+    std::string name_;
+    void* base_;
+    size_t size_;
+    Gadgetron::GadgetSharedMemoryRingView ring_;
+};
+
 class GadgetronClientConnector
 {
 
@@ -1073,6 +1299,8 @@ public:
         , timeout_ms_(10000)
         , uncompressed_bytes_sent_(0)
         , compressed_bytes_sent_(0)
+        , start_time_(std::chrono::steady_clock::now())
+        , acquisitions_sent_time_(-1.0)
     {
 
     }
@@ -1098,6 +1326,41 @@ public:
     {
         timeout_ms_ = t;
     }
+
+    /// Seconds since the connection was opened
+    double elapsed_time()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    }
+
+    void mark_acquisitions_sent()
+    {
+        std::lock_guard<std::mutex> guard(timing_mutex_);
+        acquisitions_sent_time_ = elapsed_time();
+    }
+
+    /**
+       Writes the times in seconds since the connection was opened, one event per line:
+       "image <t>" for every image or DICOM received, "acquisitions_sent <t>" when the last
+       acquisition was written to the socket and "closed <t>" when the server closed the stream.
+    */
+    void write_timing(const std::string& filename)
+    {
+        std::ofstream f(filename.c_str());
+        if (!f) {
+            throw GadgetronClientException("Unable to open timing file");
+        }
+
+        std::lock_guard<std::mutex> guard(timing_mutex_);
+        f << std::fixed << std::setprecision(6);
+        for (size_t i = 0; i < image_times_.size(); i++) {
+            f << "image " << image_times_[i] << "\n";
+        }
+        if (acquisitions_sent_time_ >= 0) {
+            f << "acquisitions_sent " << acquisitions_sent_time_ << "\n";
+        }
+        f << "closed " << elapsed_time() << "\n";
+    }
     
     void read_task()
     {
@@ -1137,12 +1400,14 @@ public:
     {
 
 
+        start_time_ = std::chrono::steady_clock::now();
+
         tcp::resolver resolver(io_service);
         tcp::resolver::query query(tcp::v4(), hostname.c_str(), port.c_str());
         tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
         tcp::resolver::iterator end;
         
-        socket_ = new tcp::socket(io_service);
+        socket_ = new client_socket(io_service);
         if (!socket_) {
             throw GadgetronClientException("Unable to create socket.");
         }
@@ -1157,7 +1422,8 @@ public:
                 //   boost::asio::connect(*socket_, iterator);
                 while (error && endpoint_iterator != end) {
                     socket_->close();
-                    socket_->connect(*endpoint_iterator++, error);
+                    socket_->connect(client_socket::endpoint_type(endpoint_iterator->endpoint()), error);
+                    ++endpoint_iterator;
                 }
                 cv.notify_all();
             });
@@ -1180,6 +1446,53 @@ public:
 
     }
 
+    /// Connects to the Unix domain socket of a Gadgetron on this host (gadgetron -u)
+    void connect_local(std::string path)
+    {
+#if defined BOOST_ASIO_HAS_LOCAL_SOCKETS
+        start_time_ = std::chrono::steady_clock::now();
+
+        socket_ = new client_socket(io_service);
+
+        boost::system::error_code error;
+        socket_->connect(client_socket::endpoint_type(boost::asio::local::stream_protocol::endpoint(path)), error);
+        if (error)
+            throw GadgetronClientException("Error connecting to local socket " + path);
+
+        reader_thread_ = boost::thread(boost::bind(&GadgetronClientConnector::read_task, this));
+#else
+        throw GadgetronClientException("Local sockets are not available on this platform");
+#endif
+    }
+
+    /**
+       Creates a shared memory ring of the given size and announces it to the server, the payload of
+       the acquisitions sent with send_ismrmrd_acquisition_shared_memory goes through the ring.
+       Local connections only.
+    */
+    void attach_shared_memory(size_t capacity)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        std::stringstream name;
+#ifndef _WIN32
+        name << "/gadgetron_client_" << getpid();
+#endif
+        shared_memory_ = boost::shared_ptr<GadgetronClientSharedMemory>(new GadgetronClientSharedMemory(name.str(), capacity));
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_SHM_ATTACH;
+
+        GadgetMessageSharedMemoryAttach attach;
+        memset(attach.name, 0, sizeof(attach.name));
+        strncpy(attach.name, shared_memory_->name().c_str(), sizeof(attach.name)-1);
+
+        boost::asio::write(*socket_, boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        boost::asio::write(*socket_, boost::asio::buffer(&attach, sizeof(GadgetMessageSharedMemoryAttach)));
+    }
+
     void send_gadgetron_close() { 
         if (!socket_) {
             throw GadgetronClientException("Invalid socket.");
@@ -1207,6 +1520,78 @@ public:
 
     }
 
+    void send_gadgetron_attribute_encoding(uint32_t encoding)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_ATTRIBUTE_ENCODING;
+
+        GadgetMessageAttributeEncoding enc;
+        enc.encoding = encoding;
+
+        boost::asio::write(*socket_, boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        boost::asio::write(*socket_, boost::asio::buffer(&enc, sizeof(GadgetMessageAttributeEncoding)));
+    }
+
+    void send_gadgetron_image_compression(uint32_t mode, float tolerance)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_IMAGE_COMPRESSION;
+
+        GadgetMessageImageCompression compression;
+        compression.mode = mode;
+        compression.tolerance = tolerance;
+
+        boost::asio::write(*socket_, boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        boost::asio::write(*socket_, boost::asio::buffer(&compression, sizeof(GadgetMessageImageCompression)));
+    }
+
+    void send_gadgetron_stream_priority(uint32_t priority)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_STREAM_PRIORITY;
+
+        GadgetMessageStreamPriority p;
+        p.priority = priority;
+
+        boost::asio::write(*socket_, boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        boost::asio::write(*socket_, boost::asio::buffer(&p, sizeof(GadgetMessageStreamPriority)));
+    }
+
+    void send_gadgetron_file_ingest(const std::string& filename, const std::string& group, uint32_t chunk_acquisitions)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        GadgetMessageFileIngest ingest;
+        if (filename.size() >= sizeof(ingest.filename) || group.size() >= sizeof(ingest.group)) {
+            throw GadgetronClientException("File name or group too long for server side reading.");
+        }
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_FILE_INGEST;
+
+        memset(&ingest, 0, sizeof(GadgetMessageFileIngest));
+        memcpy(ingest.filename, filename.c_str(), filename.size());
+        memcpy(ingest.group, group.c_str(), group.size());
+        ingest.chunk_acquisitions = chunk_acquisitions;
+
+        boost::asio::write(*socket_, boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        boost::asio::write(*socket_, boost::asio::buffer(&ingest, sizeof(GadgetMessageFileIngest)));
+    }
+
     void send_gadgetron_configuration_script(std::string xml_string)
     {
         if (!socket_) {
@@ -1269,6 +1654,82 @@ public:
     }
 
 
+    /**
+       Writes the trajectory and the data of an acquisition into the shared memory ring, only the
+       header and the position of the payload in the ring go over the socket. Blocks while the ring
+       is full, the server releases the payload as soon as it has read the message.
+    */
+    void send_ismrmrd_acquisition_shared_memory(ISMRMRD::Acquisition& acq)
+    {
+        if (!socket_ || !shared_memory_) {
+            throw GadgetronClientException("No shared memory attached.");
+        }
+
+        size_t trajectory_bytes = sizeof(float)*acq.getHead().trajectory_dimensions*acq.getHead().number_of_samples;
+        size_t data_bytes = 2*sizeof(float)*acq.getHead().active_channels*acq.getHead().number_of_samples;
+
+        Gadgetron::GadgetSharedMemoryRecord record;
+        char* payload = shared_memory_->ring().reserve(trajectory_bytes + data_bytes, record);
+        if (!payload) {
+            throw GadgetronClientException("Acquisition does not fit into the shared memory");
+        }
+
+        if (trajectory_bytes) {
+            memcpy(payload, &acq.getTrajPtr()[0], trajectory_bytes);
+        }
+        if (data_bytes) {
+            memcpy(payload + trajectory_bytes, &acq.getDataPtr()[0], data_bytes);
+        }
+        shared_memory_->ring().commit(record);
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION_SHM;
+
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.push_back(boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        buffers.push_back(boost::asio::buffer(&acq.getHead(), sizeof(ISMRMRD::AcquisitionHeader)));
+        buffers.push_back(boost::asio::buffer(&record, sizeof(Gadgetron::GadgetSharedMemoryRecord)));
+        boost::asio::write(*socket_, buffers);
+    }
+
+    /**
+       Sends several uncompressed acquisitions as one batch message: the number of acquisitions,
+       all headers and then trajectory and data of every acquisition, gathered in one write.
+     */
+    void send_ismrmrd_acquisition_batch(std::vector<ISMRMRD::Acquisition>& acqs)
+    {
+        if (!socket_) {
+            throw GadgetronClientException("Invalid socket.");
+        }
+
+        if (acqs.empty()) return;
+
+        GadgetMessageIdentifier id;
+        id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH;
+        uint32_t count = static_cast<uint32_t>(acqs.size());
+
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.push_back(boost::asio::buffer(&id, sizeof(GadgetMessageIdentifier)));
+        buffers.push_back(boost::asio::buffer(&count, sizeof(uint32_t)));
+        for (size_t i = 0; i < acqs.size(); i++) {
+            buffers.push_back(boost::asio::buffer(&acqs[i].getHead(), sizeof(ISMRMRD::AcquisitionHeader)));
+        }
+
+        for (size_t i = 0; i < acqs.size(); i++) {
+            unsigned long trajectory_elements = acqs[i].getHead().trajectory_dimensions*acqs[i].getHead().number_of_samples;
+            unsigned long data_elements = acqs[i].getHead().active_channels*acqs[i].getHead().number_of_samples;
+
+            if (trajectory_elements) {
+                buffers.push_back(boost::asio::buffer(&acqs[i].getTrajPtr()[0], sizeof(float)*trajectory_elements));
+            }
+            if (data_elements) {
+                buffers.push_back(boost::asio::buffer(&acqs[i].getDataPtr()[0], 2*sizeof(float)*data_elements));
+            }
+        }
+
+        boost::asio::write(*socket_, buffers);
+    }
+
     void send_ismrmrd_compressed_acquisition_precision(ISMRMRD::Acquisition& acq, unsigned int compression_precision) 
     {
         if (!socket_) {
@@ -1499,12 +1960,18 @@ protected:
     }
 
     boost::asio::io_service io_service;
-    tcp::socket* socket_;
+    client_socket* socket_;
+    boost::shared_ptr<GadgetronClientSharedMemory> shared_memory_;
     boost::thread reader_thread_;
     maptype readers_;
     unsigned int timeout_ms_;
     double uncompressed_bytes_sent_;
     double compressed_bytes_sent_;
+
+    std::chrono::steady_clock::time_point start_time_;
+    std::mutex timing_mutex_;
+    std::vector<double> image_times_;
+    double acquisitions_sent_time_;
 };
 
 
@@ -1522,7 +1989,7 @@ public:
     
   }
 
-  virtual void read(tcp::socket* stream)
+  virtual void read(client_socket* stream)
   {
     size_t recv_count = 0;
     
@@ -1623,6 +2090,20 @@ NoiseStatistics get_noise_statistics(std::string dependency_name, std::string ho
     return stat;
 }
 
+// Spiral trajectories are regenerated by the SpiralToGenericGadget from a HargreavesVDS2000 description,
+// radial trajectories are computed by the gpu radial gadgets from their configuration
+bool trajectories_can_be_regenerated(const ISMRMRD::IsmrmrdHeader& h)
+{
+    if (h.encoding.size() != 1) return false;
+
+    ISMRMRD::Encoding e = h.encoding[0];
+    if (e.trajectory.compare("spiral") == 0) {
+        return e.trajectoryDescription.is_present() && (e.trajectoryDescription.get().identifier == "HargreavesVDS2000");
+    }
+
+    return (e.trajectory.compare("radial") == 0) || (e.trajectory.compare("goldenangle") == 0);
+}
+
 int main(int argc, char **argv)
 {
 
@@ -1638,10 +2119,21 @@ int main(int argc, char **argv)
     unsigned int loops;
     unsigned int timeout_ms;
     std::string out_fileformat;
+    std::string timing_file;
     bool open_input_file = true;
     unsigned int compression_precision = 0;
     float compression_tolerance = 0.0;
     bool use_zfp_compression = false;
+    unsigned int batch_size = 0;
+    bool binary_attributes = false;
+    std::string image_compression;
+    float image_tolerance = 0.0f;
+    bool omit_trajectories = false;
+    std::string priority;
+    bool server_file = false;
+    unsigned int ingest_chunk = 0;
+    std::string local_socket;
+    unsigned int shared_memory_mb = 0;
     
     po::options_description desc("Allowed options");
 
@@ -1661,6 +2153,17 @@ int main(int argc, char **argv)
         ("outformat,F", po::value<std::string>(&out_fileformat)->default_value("h5"), "Out format, h5 for hdf5 and hdr for analyze image")
         ("precision,P", po::value<unsigned int>(&compression_precision)->default_value(0), "Compression precision (bits)")
         ("tolerance,T", po::value<float>(&compression_tolerance)->default_value(0.0), "Compression tolerance (fraction of sigma, if no noise stats, assume sigma 1)")
+        ("timing,k", po::value<std::string>(&timing_file), "Write the arrival times of the images to this file")
+        ("batch,b", po::value<unsigned int>(&batch_size)->default_value(0), "Send acquisitions in batches of this size (uncompressed only, 0 = no batching)")
+        ("binary-attributes,B", po::value<bool>(&binary_attributes)->default_value(false), "Ask for the image meta attributes in the binary encoding instead of XML")
+        ("image-compression,I", po::value<std::string>(&image_compression)->default_value("none"), "Compression of the returned images: none, lossless (zstd) or zfp (float and complex images)")
+        ("image-tolerance", po::value<float>(&image_tolerance)->default_value(0.0f), "Absolute error bound of the zfp image compression")
+        ("priority", po::value<std::string>(&priority), "Priority of the stream on the server, realtime or batch (queued and throttled behind real-time streams). Default is that of the configuration")
+        ("server-file,S", po::value<bool>(&server_file)->default_value(false), "The server reads the input file itself (the path must be valid on the server and below its fileIngest root), only the images come over the connection")
+        ("ingest-chunk", po::value<unsigned int>(&ingest_chunk)->default_value(0), "Acquisitions the server reads per chunk with server-file (0 = server default)")
+        ("omit-trajectories,j", po::value<bool>(&omit_trajectories)->default_value(false), "Leave the trajectories out of spiral and radial acquisitions, the reconstruction regenerates them from the header (SpiralToGenericGadget, gpu radial gadgets)")
+        ("local-socket,U", po::value<std::string>(&local_socket), "Connect to the Unix domain socket of a Gadgetron on this host (gadgetron -u) instead of host and port, dependency queries still use host and port")
+        ("shared-memory,M", po::value<unsigned int>(&shared_memory_mb)->default_value(0), "Send the acquisition data through a shared memory ring of this size in MB (local-socket only, uncompressed, 0 = over the socket)")
 #if defined GADGETRON_COMPRESSION_ZFP
         ("ZFP,Z", po::value<bool>(&use_zfp_compression)->default_value(false), "Use ZFP library for compression");
 #endif //GADGETRON_COMPRESSION_ZFP
@@ -1684,6 +2187,21 @@ int main(int argc, char **argv)
     if (vm.count("query")) {
       open_input_file = false;
     }
+
+    if (server_file && (compression_precision > 0 || compression_tolerance > 0.0 || batch_size > 0 || omit_trajectories)) {
+       std::cout << "The server reads the file itself with server-file (S), it cannot be combined with compression (P or T), batching (b) or omitted trajectories (j)" << std::endl;
+       return -1;
+    }
+    
+    if (shared_memory_mb > 0 && local_socket.empty()) {
+       std::cout << "Shared memory (M) is only available on a local socket (U)" << std::endl;
+       return -1;
+    }
+
+    if (shared_memory_mb > 0 && (compression_precision > 0 || compression_tolerance > 0.0 || batch_size > 0 || server_file)) {
+       std::cout << "Shared memory (M) cannot be combined with compression (P or T), batching (b) or server-file (S)" << std::endl;
+       return -1;
+    }
     
     if (vm.count("config-local")) {
         std::ifstream t(config_file_local.c_str());
@@ -1701,6 +2219,30 @@ int main(int argc, char **argv)
        std::cout << "You cannot supply both compression precision (P) and compression tolerance (T) at the same time" << std::endl;
        return -1;
     }
+
+    if (batch_size > 0 && (compression_precision > 0 || compression_tolerance > 0.0)) {
+       std::cout << "Batched acquisitions (b) cannot be combined with compression (P or T)" << std::endl;
+       return -1;
+    }
+
+    uint32_t image_compression_mode = Gadgetron::IMAGE_COMPRESSION_NONE;
+    if (image_compression == "lossless") {
+       image_compression_mode = Gadgetron::IMAGE_COMPRESSION_LOSSLESS;
+    } else if (image_compression == "zfp") {
+       if (image_tolerance <= 0.0f) {
+          std::cout << "ZFP image compression (I) needs an image tolerance greater than zero" << std::endl;
+          return -1;
+       }
+       image_compression_mode = Gadgetron::IMAGE_COMPRESSION_ZFP;
+    } else if (image_compression != "none") {
+       std::cout << "Unknown image compression " << image_compression << ", use none, lossless or zfp" << std::endl;
+       return -1;
+    }
+
+    if (vm.count("priority") && priority != "realtime" && priority != "batch") {
+       std::cout << "Unknown priority " << priority << ", use realtime or batch" << std::endl;
+       return -1;
+    }
     
     //Let's check if the files exist:
     std::string hdf5_xml_varname = std::string(hdf5_in_group) + std::string("/xml");
@@ -1712,7 +2254,7 @@ int main(int argc, char **argv)
     //Let's open the input file
     boost::shared_ptr<ISMRMRD::Dataset> ismrmrd_dataset;
     std::string xml_config;
-    if (open_input_file) {
+    if (open_input_file && !server_file) {
       ismrmrd_dataset = boost::shared_ptr<ISMRMRD::Dataset>(new ISMRMRD::Dataset(in_filename.c_str(), hdf5_in_group.c_str(), false));
       // Read the header
       ismrmrd_dataset->readHeader(xml_config);
@@ -1720,9 +2262,16 @@ int main(int argc, char **argv)
 
     if (!vm.count("query")) {
       std::cout << "Gadgetron ISMRMRD client" << std::endl;
-      std::cout << "  -- host            :      " << host_name << std::endl;
-      std::cout << "  -- port            :      " << port << std::endl;
-      std::cout << "  -- hdf5 file  in   :      " << in_filename << std::endl;
+      if (local_socket.empty()) {
+        std::cout << "  -- host            :      " << host_name << std::endl;
+        std::cout << "  -- port            :      " << port << std::endl;
+      } else {
+        std::cout << "  -- local socket    :      " << local_socket << std::endl;
+        if (shared_memory_mb > 0) {
+          std::cout << "  -- shared memory   :      " << shared_memory_mb << " MB" << std::endl;
+        }
+      }
+      std::cout << "  -- hdf5 file  in   :      " << in_filename << (server_file ? " (read by the server)" : "") << std::endl;
       std::cout << "  -- hdf5 group in   :      " << hdf5_in_group << std::endl;
       std::cout << "  -- conf            :      " << config_file << std::endl;
       std::cout << "  -- loop            :      " << loops << std::endl;
@@ -1733,9 +2282,14 @@ int main(int argc, char **argv)
 
     //Let's figure out if this measurement has dependencies
     NoiseStatistics noise_stats; noise_stats.status = false;
-    if (!vm.count("query")) {
+    if (!vm.count("query") && !server_file) {
         ISMRMRD::IsmrmrdHeader h;
         ISMRMRD::deserialize(xml_config.c_str(),h);
+
+        if (omit_trajectories && !trajectories_can_be_regenerated(h)) {
+            std::cout << "WARNING: The trajectories of this measurement cannot be regenerated from its header, sending them" << std::endl;
+            omit_trajectories = false;
+        }
         
         std::string noise_id;
         if (h.measurementInformation.is_present() &&
@@ -1783,29 +2337,51 @@ int main(int argc, char **argv)
     GadgetronClientConnector con;
     con.set_timeout(timeout_ms);
     
+    boost::shared_ptr<GadgetronClientImageReader> image_reader;
     if ( out_fileformat == "hdr" )
     {
-        con.register_reader(GADGET_MESSAGE_ISMRMRD_IMAGE, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientAnalyzeImageMessageReader(hdf5_out_group)));
+        image_reader = boost::shared_ptr<GadgetronClientImageReader>(new GadgetronClientAnalyzeImageMessageReader(hdf5_out_group));
     }
     else
     {
-        con.register_reader(GADGET_MESSAGE_ISMRMRD_IMAGE, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientImageMessageReader(out_filename, hdf5_out_group)));
+        image_reader = boost::shared_ptr<GadgetronClientImageReader>(new GadgetronClientImageMessageReader(out_filename, hdf5_out_group));
     }
 
+    con.register_reader(GADGET_MESSAGE_ISMRMRD_IMAGE, image_reader);
+    con.register_reader(GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientCompressedImageMessageReader(image_reader)));
+
     con.register_reader(GADGET_MESSAGE_DICOM_WITHNAME, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientBlobMessageReader(std::string(hdf5_out_group), std::string("dcm"))));
 
     con.register_reader(GADGET_MESSAGE_DEPENDENCY_QUERY, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientDependencyQueryReader(std::string(out_filename))));			
     con.register_reader(GADGET_MESSAGE_TEXT, boost::shared_ptr<GadgetronClientMessageReader>(new GadgetronClientTextReader()));
 			
     try {
-        con.connect(host_name,port);
+        if (local_socket.empty()) {
+            con.connect(host_name,port);
+        } else {
+            con.connect_local(local_socket);
+        }
+        if (shared_memory_mb > 0) {
+            con.attach_shared_memory(size_t(shared_memory_mb)*1024*1024);
+        }
+        if (binary_attributes) {
+            con.send_gadgetron_attribute_encoding(GADGET_ATTRIBUTE_ENCODING_BINARY);
+        }
+        if (image_compression_mode != Gadgetron::IMAGE_COMPRESSION_NONE) {
+            con.send_gadgetron_image_compression(image_compression_mode, image_tolerance);
+        }
+        if (vm.count("priority")) {
+            con.send_gadgetron_stream_priority((priority == "batch") ? GADGET_STREAM_PRIORITY_BATCH : GADGET_STREAM_PRIORITY_REALTIME);
+        }
         if (vm.count("config-local")) {
             con.send_gadgetron_configuration_script(config_xml_local);
         } else {
             con.send_gadgetron_configuration_file(config_file);
         }
 
-	if (open_input_file) {
+	if (open_input_file && server_file) {
+	  con.send_gadgetron_file_ingest(in_filename, hdf5_in_group, ingest_chunk);
+	} else if (open_input_file) {
 	  con.send_gadgetron_parameters(xml_config);
 	  
 	  uint32_t acquisitions = 0;
@@ -1816,6 +2392,7 @@ int main(int argc, char **argv)
 	  }
 	  
 	  ISMRMRD::Acquisition acq_tmp;
+	  std::vector<ISMRMRD::Acquisition> batch;
 	  for (uint32_t i = 0; i < acquisitions; i++) {
             {
 	      {
@@ -1823,6 +2400,12 @@ int main(int argc, char **argv)
 		ismrmrd_dataset->readAcquisition(i, acq_tmp);
 	      }
 
+              if (omit_trajectories && acq_tmp.getHead().trajectory_dimensions > 0) {
+                  ISMRMRD::AcquisitionHeader head = acq_tmp.getHead();
+                  head.trajectory_dimensions = 0;
+                  acq_tmp.setHead(head);
+              }
+
               if (compression_precision > 0) {
                   if (use_zfp_compression) {
                       con.send_ismrmrd_zfp_compressed_acquisition_precision(acq_tmp,compression_precision);
@@ -1835,11 +2418,25 @@ int main(int argc, char **argv)
                   } else {
                       con.send_ismrmrd_compressed_acquisition_tolerance(acq_tmp,compression_tolerance, noise_stats);
                   }
+              } else if (batch_size > 0) {
+                  batch.push_back(acq_tmp);
+                  if (batch.size() >= batch_size) {
+                      con.send_ismrmrd_acquisition_batch(batch);
+                      batch.clear();
+                  }
+              } else if (shared_memory_mb > 0) {
+                  con.send_ismrmrd_acquisition_shared_memory(acq_tmp);
               } else {
                   con.send_ismrmrd_acquisition(acq_tmp);              
               }
             }
 	  }
+
+	  if (!batch.empty()) {
+	    con.send_ismrmrd_acquisition_batch(batch);
+	  }
+
+	  con.mark_acquisitions_sent();
 	}
 
         if (compression_precision > 0 || compression_tolerance > 0.0) {
@@ -1849,6 +2446,10 @@ int main(int argc, char **argv)
         con.send_gadgetron_close();
         con.wait();
 
+        if (!timing_file.empty()) {
+            con.write_timing(timing_file);
+        }
+
     } catch (std::exception& ex) {
         std::cerr << "Error caught: " << ex.what() << std::endl;
 	return -1;
@@ -0,0 +1,498 @@
+/** \file   gt_emulator.cpp
+    \brief  Scanner emulator, plays an ISMRMRD dataset to the Gadgetron at the timing of the sequence.
+
+            The acquisitions are sent at the times given by their acquisition_time_stamp (or, with -t p, by
+            the time since the trigger in physiology_time_stamp[0]), scaled by the speed factor. A speed of 0
+            sends as fast as possible. For every image received the latency is measured against the
+            acquisition clock: the arrival time minus the time the last acquisition with a time stamp not
+            later than the acquisition_time_stamp of the image was sent.
+
+            Several clients can be played concurrently, each on its own connection, to emulate a busy site.
+            The dataset is read into memory once before the clients start, so that reading the file does not
+            disturb the timing.
+*/
+
+#include "GadgetronConnector.h"
+#include "GadgetMRIHeaders.h"
+#include "GadgetContainerMessage.h"
+
+#include <ismrmrd/ismrmrd.h>
+#include <ismrmrd/dataset.h>
+
+#include <ace/Log_Msg.h>
+#include <ace/Get_Opt.h>
+#include <ace/OS_NS_string.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+using namespace Gadgetron;
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    /// Sends an ISMRMRD::Acquisition held in a container message: identifier, header, trajectory and data
+    class EmulatorAcquisitionWriter : public GadgetMessageWriter
+    {
+    public:
+        virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+        {
+            GadgetContainerMessage<ISMRMRD::Acquisition>* m = AsContainerMessage<ISMRMRD::Acquisition>(mb);
+            if (!m) {
+                GERROR("EmulatorAcquisitionWriter, invalid acquisition message\n");
+                return -1;
+            }
+
+            ISMRMRD::Acquisition& acq = *m->getObjectPtr();
+
+            GadgetMessageIdentifier id;
+            id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION;
+
+            if (sock->send_n(&id, sizeof(GadgetMessageIdentifier)) <= 0) {
+                GERROR("Unable to send acquisition message identifier\n");
+                return -1;
+            }
+
+            if (sock->send_n(&acq.getHead(), sizeof(ISMRMRD::AcquisitionHeader)) <= 0) {
+                GERROR("Unable to send acquisition header\n");
+                return -1;
+            }
+
+            if (acq.getNumberOfTrajElements() > 0) {
+                if (sock->send_n(acq.getTrajPtr(), sizeof(float)*acq.getNumberOfTrajElements()) <= 0) {
+                    GERROR("Unable to send acquisition trajectory\n");
+                    return -1;
+                }
+            }
+
+            if (acq.getNumberOfDataElements() > 0) {
+                if (sock->send_n(acq.getDataPtr(), sizeof(std::complex<float>)*acq.getNumberOfDataElements()) <= 0) {
+                    GERROR("Unable to send acquisition data\n");
+                    return -1;
+                }
+            }
+
+            return 0;
+        }
+    };
+
+    /// Reads an image message and keeps the header only, attributes and pixels are discarded
+    class EmulatorImageReader : public GadgetMessageReader
+    {
+    public:
+        virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream)
+        {
+            GadgetContainerMessage<ISMRMRD::ImageHeader>* m = new GadgetContainerMessage<ISMRMRD::ImageHeader>();
+            ISMRMRD::ImageHeader& h = *m->getObjectPtr();
+
+            if (stream->recv_n(&h, sizeof(ISMRMRD::ImageHeader)) <= 0) {
+                GERROR("EmulatorImageReader, failed to read image header\n");
+                m->release();
+                return 0;
+            }
+
+            typedef unsigned long long size_t_type;
+            size_t_type attrib_length = 0;
+            if (stream->recv_n(&attrib_length, sizeof(size_t_type)) <= 0) {
+                GERROR("EmulatorImageReader, failed to read attribute length\n");
+                m->release();
+                return 0;
+            }
+
+            size_t data_bytes = (size_t)h.matrix_size[0] * h.matrix_size[1] * h.matrix_size[2] * h.channels
+                * ismrmrd_sizeof_data_type(h.data_type);
+
+            if (!skip(stream, (size_t)attrib_length) || !skip(stream, data_bytes)) {
+                GERROR("EmulatorImageReader, failed to read image data\n");
+                m->release();
+                return 0;
+            }
+
+            return m;
+        }
+
+    protected:
+        bool skip(ACE_SOCK_Stream* stream, size_t n)
+        {
+            if (buffer_.size() < 65536) buffer_.resize(65536);
+            while (n > 0) {
+                size_t chunk = std::min(n, buffer_.size());
+                if (stream->recv_n(&buffer_[0], chunk) <= 0) return false;
+                n -= chunk;
+            }
+            return true;
+        }
+
+        std::vector<char> buffer_;
+    };
+
+    /// Arrival of an image, in seconds since the start of the client
+    struct ImageArrival
+    {
+        double time;
+        uint32_t acquisition_time_stamp;
+    };
+
+    class EmulatorConnector : public GadgetronConnector
+    {
+    public:
+        EmulatorConnector(Clock::time_point start) : start_(start) {}
+
+        virtual int process(size_t messageid, ACE_Message_Block* mb)
+        {
+            GadgetContainerMessage<ISMRMRD::ImageHeader>* m = AsContainerMessage<ISMRMRD::ImageHeader>(mb);
+            if (messageid == GADGET_MESSAGE_ISMRMRD_IMAGE && m) {
+                ImageArrival a;
+                a.time = std::chrono::duration<double>(Clock::now() - start_).count();
+                a.acquisition_time_stamp = m->getObjectPtr()->acquisition_time_stamp;
+
+                std::lock_guard<std::mutex> guard(mutex_);
+                arrivals_.push_back(a);
+            }
+
+            mb->release();
+            return 0;
+        }
+
+        std::vector<ImageArrival> arrivals()
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            return arrivals_;
+        }
+
+    protected:
+        Clock::time_point start_;
+        std::mutex mutex_;
+        std::vector<ImageArrival> arrivals_;
+    };
+
+    struct EmulatorSettings
+    {
+        std::string host;
+        std::string port;
+        std::string config;
+        std::string parameters;
+        double speed;
+        double tick_ms;
+        bool physiology_clock;
+    };
+
+    struct ClientResult
+    {
+        ClientResult() : ok(false), duration(0), time_to_first_image(0), late_acquisitions(0) {}
+
+        bool ok;
+        double duration;
+        std::vector<double> latencies;
+        double time_to_first_image;
+        size_t late_acquisitions;
+    };
+
+    /// Play time of every acquisition in seconds at speed 1, relative to the first one
+    std::vector<double> play_times(const std::vector<ISMRMRD::Acquisition>& acqs, double tick_ms, bool physiology_clock)
+    {
+        std::vector<double> t(acqs.size(), 0.0);
+        if (acqs.empty()) return t;
+
+        if (!physiology_clock) {
+            uint32_t first = acqs[0].getHead().acquisition_time_stamp;
+            for (size_t i = 0; i < acqs.size(); i++) {
+                uint32_t ts = acqs[i].getHead().acquisition_time_stamp;
+                t[i] = (ts >= first) ? (ts - first) * tick_ms / 1000.0 : 0.0;
+            }
+            return t;
+        }
+
+        //The time since the trigger restarts with every heart beat, the time of the beat before counts up to the new trigger
+        double elapsed = 0;
+        uint32_t previous = acqs[0].getHead().physiology_time_stamp[0];
+        for (size_t i = 1; i < acqs.size(); i++) {
+            uint32_t ts = acqs[i].getHead().physiology_time_stamp[0];
+            elapsed += ((ts >= previous) ? (ts - previous) : ts) * tick_ms / 1000.0;
+            previous = ts;
+            t[i] = elapsed;
+        }
+        return t;
+    }
+
+    void run_client(size_t client, const EmulatorSettings& settings, const std::vector<ISMRMRD::Acquisition>& acqs,
+                    const std::vector<double>& times, ClientResult& result)
+    {
+        Clock::time_point start = Clock::now();
+        EmulatorConnector con(start);
+
+        con.register_reader(GADGET_MESSAGE_ISMRMRD_IMAGE, new EmulatorImageReader());
+        con.register_writer(GADGET_MESSAGE_ISMRMRD_ACQUISITION, new EmulatorAcquisitionWriter());
+
+        if (con.open(settings.host, settings.port) != 0) {
+            GERROR("Client %d, unable to connect to the Gadgetron host\n", (int)client);
+            return;
+        }
+
+        if (con.send_gadgetron_configuration_file(settings.config) != 0) {
+            GERROR("Client %d, unable to send XML configuration to the Gadgetron host\n", (int)client);
+            return;
+        }
+
+        if (con.send_gadgetron_parameters(settings.parameters) != 0) {
+            GERROR("Client %d, unable to send the ISMRMRD header to the Gadgetron host\n", (int)client);
+            return;
+        }
+
+        //Sent time of every acquisition, the clock starts with the first acquisition
+        std::vector< std::pair<uint32_t, double> > sent(acqs.size());
+        Clock::time_point play_start = Clock::now();
+
+        for (size_t i = 0; i < acqs.size(); i++) {
+            if (settings.speed > 0) {
+                Clock::time_point due = play_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(times[i] / settings.speed));
+                Clock::time_point now = Clock::now();
+                if (due > now) {
+                    std::this_thread::sleep_until(due);
+                } else if (now - due > std::chrono::milliseconds(5)) {
+                    result.late_acquisitions++;
+                }
+            }
+
+            GadgetContainerMessage<GadgetMessageIdentifier>* m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
+            m1->getObjectPtr()->id = GADGET_MESSAGE_ISMRMRD_ACQUISITION;
+            m1->cont(new GadgetContainerMessage<ISMRMRD::Acquisition>(acqs[i]));
+
+            if (con.putq(m1) == -1) {
+                GERROR("Client %d, unable to put acquisition on queue\n", (int)client);
+                m1->release();
+                return;
+            }
+
+            sent[i] = std::make_pair(acqs[i].getHead().acquisition_time_stamp, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+
+        GadgetContainerMessage<GadgetMessageIdentifier>* close = new GadgetContainerMessage<GadgetMessageIdentifier>();
+        close->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+        if (con.putq(close) == -1) {
+            GERROR("Client %d, unable to put CLOSE package on queue\n", (int)client);
+            close->release();
+            return;
+        }
+
+        con.wait();
+        result.duration = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<ImageArrival> arrivals = con.arrivals();
+        if (arrivals.empty()) {
+            GWARN("Client %d, no images received\n", (int)client);
+            return;
+        }
+
+        result.time_to_first_image = arrivals[0].time - sent[0].second;
+
+        //Latency against the last acquisition sent with a time stamp up to the one of the image
+        std::stable_sort(sent.begin(), sent.end(),
+            [](const std::pair<uint32_t, double>& a, const std::pair<uint32_t, double>& b) { return a.first < b.first; });
+
+        for (size_t n = 0; n < arrivals.size(); n++) {
+            std::vector< std::pair<uint32_t, double> >::const_iterator it = std::upper_bound(sent.begin(), sent.end(),
+                std::make_pair(arrivals[n].acquisition_time_stamp, 1e300));
+            if (it == sent.begin()) continue;
+            --it;
+            result.latencies.push_back(arrivals[n].time - it->second);
+        }
+
+        result.ok = true;
+    }
+
+    double percentile(std::vector<double> v, double p)
+    {
+        if (v.empty()) return 0;
+        std::sort(v.begin(), v.end());
+        size_t k = (size_t)(p * v.size());
+        return v[std::min(k, v.size() - 1)];
+    }
+
+    void print_result(std::ostream& os, const std::string& label, const std::vector<double>& latencies, double time_to_first_image)
+    {
+        double mean = 0;
+        for (size_t n = 0; n < latencies.size(); n++) mean += latencies[n];
+        if (!latencies.empty()) mean /= latencies.size();
+
+        os << std::setw(10) << std::left << label
+           << std::right << std::fixed << std::setprecision(1)
+           << std::setw(10) << latencies.size()
+           << std::setw(12) << time_to_first_image * 1e3
+           << std::setw(10) << mean * 1e3
+           << std::setw(10) << percentile(latencies, 0.5) * 1e3
+           << std::setw(10) << percentile(latencies, 0.95) * 1e3
+           << std::setw(10) << percentile(latencies, 1.0) * 1e3 << "\n";
+    }
+}
+
+static void usage()
+{
+    using namespace std;
+    std::ostringstream outs;
+
+    outs << "Play an ISMRMRD dataset to the gadgetron server at the timing of the sequence" << endl;
+    outs << "gt_emulator   -f <ISMRMRD file>                (required)" << endl;
+    outs << "              -g <HDF5 group>                  (default /dataset)" << endl;
+    outs << "              -c <Configuration (remote)>      (default default.xml)" << endl;
+    outs << "              -p <PORT>                        (default 9002)" << endl;
+    outs << "              -h <HOST>                        (default localhost)" << endl;
+    outs << "              -s <Speed, multiple of real time, 0 for as fast as possible> (default 1)" << endl;
+    outs << "              -t <Clock, a for acquisition_time_stamp, p for physiology_time_stamp> (default a)" << endl;
+    outs << "              -k <Length of a time stamp tick in ms> (default 2.5)" << endl;
+    outs << "              -n <Number of concurrent clients> (default 1)" << endl;
+    outs << "              -d <Delay between the starts of the clients in ms> (default 0)" << endl;
+    outs << std::ends;
+
+    GDEBUG_STREAM(outs.str());
+}
+
+int ACE_TMAIN(int argc, ACE_TCHAR *argv[] )
+{
+    EmulatorSettings settings;
+    settings.host = "localhost";
+    settings.port = "9002";
+    settings.config = "default.xml";
+    settings.speed = 1.0;
+    settings.tick_ms = 2.5;
+    settings.physiology_clock = false;
+
+    std::string filename;
+    std::string group("/dataset");
+    size_t clients = 1;
+    double delay_ms = 0;
+
+    static const ACE_TCHAR options[] = ACE_TEXT(":f:g:c:p:h:s:t:k:n:d:");
+
+    ACE_Get_Opt cmd_opts(argc, argv, options);
+
+    int option;
+    while ((option = cmd_opts()) != EOF)
+    {
+        switch (option) {
+        case 'f':
+            filename = std::string(cmd_opts.opt_arg());
+            break;
+        case 'g':
+            group = std::string(cmd_opts.opt_arg());
+            break;
+        case 'c':
+            settings.config = std::string(cmd_opts.opt_arg());
+            break;
+        case 'p':
+            settings.port = std::string(cmd_opts.opt_arg());
+            break;
+        case 'h':
+            settings.host = std::string(cmd_opts.opt_arg());
+            break;
+        case 's':
+            settings.speed = std::atof(cmd_opts.opt_arg());
+            break;
+        case 't':
+            settings.physiology_clock = (cmd_opts.opt_arg()[0] == 'p');
+            break;
+        case 'k':
+            settings.tick_ms = std::atof(cmd_opts.opt_arg());
+            break;
+        case 'n':
+            clients = (size_t)std::max(1, std::atoi(cmd_opts.opt_arg()));
+            break;
+        case 'd':
+            delay_ms = std::atof(cmd_opts.opt_arg());
+            break;
+        case ':':
+            usage();
+            GERROR("-%c requires an argument.\n", cmd_opts.opt_opt());
+            return -1;
+            break;
+        default:
+            usage();
+            GERROR("Command line parse error\n");
+            return -1;
+            break;
+        }
+    }
+
+    if (filename.empty()) {
+        usage();
+        GERROR("An ISMRMRD file is required\n");
+        return -1;
+    }
+
+    std::vector<ISMRMRD::Acquisition> acqs;
+    try {
+        ISMRMRD::Dataset d(filename.c_str(), group.c_str(), false);
+        d.readHeader(settings.parameters);
+
+        uint32_t n = d.getNumberOfAcquisitions();
+        acqs.resize(n);
+        for (uint32_t i = 0; i < n; i++) d.readAcquisition(i, acqs[i]);
+    } catch (std::exception& e) {
+        GERROR("Unable to read %s: %s\n", filename.c_str(), e.what());
+        return -1;
+    }
+
+    if (acqs.empty()) {
+        GERROR("No acquisitions in %s\n", filename.c_str());
+        return -1;
+    }
+
+    std::vector<double> times = play_times(acqs, settings.tick_ms, settings.physiology_clock);
+
+    std::cout << "Playing " << acqs.size() << " acquisitions (" << std::fixed << std::setprecision(1) << times.back() << " s of scan time)"
+              << " at speed " << settings.speed << " on " << clients << " client(s)" << std::endl;
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; c++) {
+        threads.push_back(std::thread(run_client, c, std::cref(settings), std::cref(acqs), std::cref(times), std::ref(results[c])));
+        if (delay_ms > 0 && c + 1 < clients) {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay_ms));
+        }
+    }
+    for (size_t c = 0; c < threads.size(); c++) threads[c].join();
+
+    std::cout << std::setw(10) << std::left << "client"
+              << std::right
+              << std::setw(10) << "images"
+              << std::setw(12) << "first [ms]"
+              << std::setw(10) << "mean"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p95"
+              << std::setw(10) << "max" << "\n";
+
+    std::vector<double> all;
+    double first = 0;
+    size_t succeeded = 0;
+    for (size_t c = 0; c < clients; c++) {
+        if (!results[c].ok) {
+            std::cout << std::setw(10) << std::left << c << "failed\n";
+            continue;
+        }
+
+        print_result(std::cout, std::to_string(c), results[c].latencies, results[c].time_to_first_image);
+        if (results[c].late_acquisitions > 0) {
+            std::cout << "          " << results[c].late_acquisitions << " acquisitions were sent more than 5 ms late\n";
+        }
+
+        all.insert(all.end(), results[c].latencies.begin(), results[c].latencies.end());
+        first = std::max(first, results[c].time_to_first_image);
+        succeeded++;
+    }
+
+    if (clients > 1 && succeeded > 0) {
+        print_result(std::cout, "all", all, first);
+    }
+    std::cout << std::flush;
+
+    return (succeeded == clients) ? 0 : -1;
+}
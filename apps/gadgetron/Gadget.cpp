@@ -1,5 +1,14 @@
 #include "Gadget.h"
 #include "GadgetStreamController.h"
+#include "GadgetWorkerPool.h"
+
+#include <ace/OS_NS_sys_time.h>
+#include <ace/OS_NS_Thread.h>
+#include <ace/Thread.h>
+#include <ismrmrd/xml.h>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 
 namespace Gadgetron
 {
@@ -37,4 +46,124 @@ namespace Gadgetron
 
     return boost::shared_ptr<std::string>(new std::string(""));
   }
+
+  boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> Gadget::get_ismrmrd_header(ACE_Message_Block* mb)
+  {
+    size_t length = strnlen(mb->rd_ptr(), mb->length());
+
+    //Configuration messages are passed on unchanged, normally this is the header the controller has parsed
+    if (controller_) {
+      boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = controller_->get_ismrmrd_header(mb->rd_ptr(), length);
+      if (header) return header;
+    }
+
+    boost::shared_ptr<ISMRMRD::IsmrmrdHeader> header(new ISMRMRD::IsmrmrdHeader());
+    ISMRMRD::deserialize(std::string(mb->rd_ptr(), length).c_str(), *header);
+    return header;
+  }
+
+  void Gadget::apply_thread_priority()
+  {
+    //Real-time priority usually needs CAP_SYS_NICE or an rtprio limit, without it the thread keeps the normal scheduler
+    ACE_hthread_t handle;
+    ACE_Thread::self(handle);
+    if (ACE_OS::thr_setprio(handle, thread_priority_, ACE_SCHED_FIFO) == -1) {
+      GWARN("Gadget (%s) unable to set real-time thread priority %d\n", this->module()->name(), thread_priority_);
+      return;
+    }
+    GDEBUG("Gadget (%s) thread runs with real-time priority %d\n", this->module()->name(), thread_priority_);
+  }
+
+  int Gadget::open_pooled()
+  {
+    GDEBUG("Gadget (%s) runs on the shared worker pool, max concurrency %d\n", this->module()->name(), this->desired_threads());
+
+    //Worker pool tasks must never block in putq, otherwise all workers could end up waiting for a
+    //downstream gadget that has no worker left to run on. The ACE queue is therefore made unbounded.
+    this->msg_queue()->high_water_mark(std::numeric_limits<size_t>::max()/2);
+    this->msg_queue()->notification_strategy(&pool_notifier_);
+
+    //Messages may have been queued before the notifier was installed
+    if (!this->msg_queue()->is_empty()) {
+      this->schedule_pooled();
+    }
+    return 0;
+  }
+
+  int Gadget::wait_pooled()
+  {
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    pool_cv_.wait(lock, [this]() { return pool_finished_; });
+    return 0;
+  }
+
+  void Gadget::schedule_pooled()
+  {
+    if (pool_stopped_.load()) return;
+
+    int max_running = std::max(1u, this->desired_threads());
+    int running = pool_running_.load();
+    while (running < max_running) {
+      if (pool_running_.compare_exchange_weak(running, running + 1)) {
+        GadgetWorkerPool::instance()->submit([this]() { this->run_pooled(); });
+        return;
+      }
+    }
+  }
+
+  void Gadget::run_pooled()
+  {
+    //Number of messages processed before the task yields to other gadgets on the pool
+    const size_t batch_size = 64;
+
+    bool stop = false;
+    size_t processed = 0;
+    while (processed < batch_size) {
+      ACE_Message_Block* m = 0;
+      ACE_Time_Value nowait(ACE_OS::gettimeofday());
+      if (this->getq(m, &nowait) == -1) {
+        break; //Queue is empty
+      }
+
+      if (m->msg_type() == ACE_Message_Block::MB_HANGUP) {
+        m->release();
+        stop = true;
+        break;
+      }
+
+      if (this->process_message(m) == GADGET_FAIL) {
+        stop = true;
+        break;
+      }
+      processed++;
+    }
+
+    if (!stop && processed == batch_size) {
+      //Keep the running slot and continue in a new task
+      GadgetWorkerPool::instance()->submit([this]() { this->run_pooled(); });
+      return;
+    }
+
+    //The gadget may be deleted as soon as close() sees pool_finished_, so everything below
+    //happens with the mutex held and nothing is touched once it is released.
+    std::lock_guard<std::mutex> guard(pool_mutex_);
+    if (stop) {
+      pool_stopped_.store(true);
+    }
+
+    int remaining = pool_running_.fetch_sub(1) - 1;
+
+    if (pool_stopped_.load()) {
+      if (remaining == 0) {
+        pool_finished_ = true;
+        pool_cv_.notify_all();
+      }
+      return;
+    }
+
+    //A message may have arrived after the queue was found empty, but before the slot was released
+    if (!this->msg_queue()->is_empty()) {
+      this->schedule_pooled();
+    }
+  }
 }
@@ -10,12 +10,25 @@
 #include <ace/Svc_Handler.h>
 #include <ace/SOCK_Stream.h>
 
+#include <ace/Notification_Strategy.h>
+
 #include <map>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 #include <boost/shared_ptr.hpp>
 
 #include "gadgetbase_export.h"
 #include "GadgetContainerMessage.h"
+#include "GadgetStatistics.h"
+#include "GadgetronTrace.h"
+#include "GadgetronProfile.h"
+#include "GadgetronMemoryAccount.h"
+#include "GadgetronThreadBudget.h"
+#include "GadgetLockFreeMessageQueue.h"
+#include "GadgetPayloadMessageQueue.h"
 #include "GadgetronExport.h"
 #include "gadgetron_config.h"
 #include "log.h"
@@ -26,6 +39,11 @@
 #define GADGET_FAIL -1
 #define GADGET_OK    0
 
+namespace ISMRMRD
+{
+  struct IsmrmrdHeader;
+}
+
 namespace Gadgetron{
 
   class GadgetPropertyBase
@@ -110,6 +128,16 @@ namespace Gadgetron{
     , pass_on_undesired_data_(false)
     , controller_(0)
     , parameter_mutex_("GadgetParameterMutex")
+    , trace_(0)
+    , traced_messages_(0)
+    , profile_(0)
+    , max_omp_threads_(0)
+    , thread_priority_(0)
+    , use_worker_pool_(false)
+    , pool_notifier_(this)
+    , pool_running_(0)
+    , pool_stopped_(false)
+    , pool_finished_(false)
     {
 
       gadgetron_version_ = std::string(GADGETRON_VERSION_STRING) + std::string(" (") +
@@ -132,6 +160,9 @@ namespace Gadgetron{
 
     virtual int open(void* = 0)
     {
+      if (use_worker_pool_) {
+        return this->open_pooled();
+      }
       return this->activate( THR_NEW_LWP | THR_JOINABLE, this->desired_threads() );
     }
 
@@ -169,6 +200,96 @@ namespace Gadgetron{
       return controller_;
     }
 
+    /**
+    *  The ISMRMRD header in a configuration message. The stream controller parses the header once
+    *  when it arrives and all gadgets share the result; the message is only parsed here if it is
+    *  not the header of the stream (or there is no controller). Throws if the XML is not valid.
+    */
+    boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> get_ismrmrd_header(ACE_Message_Block* mb);
+
+    /**
+    *  Records every message processed by this gadget (and the GadgetronTimer steps within)
+    *  into the trace of the connection. 0 disables tracing. Must be set before open().
+    */
+    virtual void set_trace(GadgetronTrace* trace)
+    {
+      trace_ = trace;
+    }
+
+    GadgetronTrace* get_trace()
+    {
+      return trace_;
+    }
+
+    /**
+    *  Aggregates the time of process() and of the profiling zones and GadgetronTimer steps
+    *  within into the profile of the connection. 0 disables profiling. Must be set before open().
+    */
+    virtual void set_profile(GadgetronProfile* profile)
+    {
+      profile_ = profile;
+    }
+
+    GadgetronProfile* get_profile()
+    {
+      return profile_;
+    }
+
+    /**
+    *  Charges the arrays allocated in process() and process_config() to this account,
+    *  so the memory held by the gadget can be inspected. Must be set before open().
+    */
+    virtual void set_memory_account(std::shared_ptr<GadgetronMemoryAccount> account)
+    {
+      memory_account_ = account;
+    }
+
+    std::shared_ptr<GadgetronMemoryAccount> get_memory_account()
+    {
+      return memory_account_;
+    }
+
+    /**
+    *  Limits the OpenMP threads of process() and process_config() to the share of this
+    *  gadget in the thread budget of the stream. Without a budget the thread count is left alone. Must be set before open().
+    */
+    virtual void set_thread_budget(std::shared_ptr<GadgetronThreadBudget::Stream> budget)
+    {
+      thread_budget_ = budget;
+    }
+
+    std::shared_ptr<GadgetronThreadBudget::Stream> get_thread_budget()
+    {
+      return thread_budget_;
+    }
+
+    /**
+    *  Upper limit of the OpenMP threads of this gadget, below its share of the budget. 0 for no limit.
+    */
+    void max_omp_threads(int n)
+    {
+      max_omp_threads_ = n;
+    }
+
+    int max_omp_threads() const
+    {
+      return max_omp_threads_;
+    }
+
+    /**
+    *  Real-time (SCHED_FIFO) priority of the threads of this gadget, 0 for the normal scheduler.
+    *  Used for the latency critical gadgets of real-time pipelines. Has no effect in the pooled mode.
+    */
+    void thread_priority(int p)
+    {
+      thread_priority_ = p;
+    }
+
+    int thread_priority() const
+    {
+      return thread_priority_;
+    }
+
     virtual int close(unsigned long flags)
     {
       GDEBUG("Gadget (%s) Close Called with flags = %d\n", this->module()->name(), flags);
@@ -182,7 +303,7 @@ namespace Gadgetron{
           return GADGET_FAIL;
         }
         GDEBUG("Gadget (%s) waiting for thread to finish\n", this->module()->name());
-        rval = this->wait();
+        rval = use_worker_pool_ ? this->wait_pooled() : this->wait();
         GDEBUG("Gadget (%s) thread finished\n", this->module()->name());
         controller_ = 0;
       }
@@ -191,10 +312,21 @@ namespace Gadgetron{
 
     virtual int svc(void)
     {
+      if (thread_priority_ > 0) {
+        this->apply_thread_priority();
+      }
+
       for (ACE_Message_Block *m = 0; ;) {
 
         //GDEBUG("Waiting for message in Gadget (%s)\n", this->module()->name());
-        if (this->getq(m) == -1) {
+        GadgetStatistics::clock::time_point wait_start = GadgetStatistics::clock::now();
+        ACE_Time_Value deadline;
+        bool timed = this->queue_deadline(deadline);
+        if (this->getq(m, timed ? &deadline : 0) == -1) {
+          if (timed && errno == EWOULDBLOCK) {
+            if (this->process_timeout() == GADGET_FAIL) return GADGET_FAIL;
+            continue;
+          }
           GDEBUG("Gadget (%s) failed to get message from queue\n", this->module()->name());
           return GADGET_FAIL;
         }
@@ -211,51 +343,111 @@ namespace Gadgetron{
           break;
         }
 
+        statistics_.wait_time_us.add(GadgetStatistics::elapsed_us(wait_start, GadgetStatistics::clock::now()));
 
-        //Is this config info, if so call appropriate process function
-        if (m->flags() & GADGET_MESSAGE_CONFIG) {
-
-          int success;
-          try{ success = this->process_config(m); }
-          catch (std::runtime_error& err){
-            GEXCEPTION(err,"Gadget::process_config() failed\n");
-            success = -1;
-          }
+        if (this->process_message(m) == GADGET_FAIL) {
+          return GADGET_FAIL;
+        }
+      }
+      return 0;
+    }
 
-          if (success == -1) {
-            m->release();
-            this->flush();
-            GDEBUG("Gadget (%s) process config failed\n", this->module()->name());
-            return GADGET_FAIL;
+    /**
+    *  Absolute time (as ACE_OS::gettimeofday()) up to which the thread of this gadget waits for the next
+    *  message, process_timeout() is called when none arrived by then. A gadget holding messages back
+    *  returns the time at which it has to pass them on regardless. Returns false to wait without a limit,
+    *  the default. Has no effect in the pooled mode.
+    */
+    virtual bool queue_deadline(ACE_Time_Value& deadline)
+    {
+      return false;
+    }
 
-          }
+    virtual int process_timeout()
+    {
+      return GADGET_OK;
+    }
 
-          //Push this onto next gadgets queue, other gadgets may need this configuration information
-          if (this->next()) {
-            if (this->next()->putq(m) == -1) {
-              m->release();
-              GDEBUG("Gadget (%s) process config failed to put config on dowstream gadget\n", this->module()->name());
-              return GADGET_FAIL;
-            }
-          }
-          continue;
-        }
+    /**
+    *  Dispatches one message taken from the queue to process_config() or process().
+    *  Configuration messages are passed on to the next gadget. On failure the message
+    *  is released and the queue is flushed.
+    */
+    int process_message(ACE_Message_Block* m)
+    {
+      GadgetStatistics::clock::time_point process_start = GadgetStatistics::clock::now();
+      statistics_.queue_depth.add(this->msg_queue()->message_count());
+
+      bool is_config = (m->flags() & GADGET_MESSAGE_CONFIG) != 0;
+      GadgetronTraceScope trace_scope(trace_, trace_ ? this->module()->name() : "",
+                                      is_config ? "config" : "gadget",
+                                      trace_ ? (int64_t)traced_messages_.fetch_add(1) : -1);
+      GadgetronProfileScope profile_scope(is_config ? 0 : profile_);
+      GadgetronProfileZone profile_zone(this->module()->name());
+      GadgetronMemoryAccountScope memory_scope(memory_account_.get());
+      GadgetronThreadBudgetScope thread_scope(thread_budget_.get(), max_omp_threads_);
+      GadgetronNumaScope numa_scope(thread_budget_ ? thread_budget_->node() : -1, true);
+
+      //Is this config info, if so call appropriate process function
+      if (is_config) {
 
         int success;
-        try{ success = this->process(m); }
+        try{ success = this->process_config(m); }
         catch (std::runtime_error& err){
-          GEXCEPTION(err,"Gadget::process() failed\n");
+          GEXCEPTION(err,"Gadget::process_config() failed\n");
           success = -1;
         }
+        statistics_.process_time_us.add(GadgetStatistics::elapsed_us(process_start, GadgetStatistics::clock::now()));
 
         if (success == -1) {
           m->release();
           this->flush();
-          GERROR("Gadget (%s) process failed\n", this->module()->name());
+          GDEBUG("Gadget (%s) process config failed\n", this->module()->name());
           return GADGET_FAIL;
+
         }
+
+        //Push this onto next gadgets queue, other gadgets may need this configuration information
+        if (this->next()) {
+          if (this->next()->putq(m) == -1) {
+            m->release();
+            GDEBUG("Gadget (%s) process config failed to put config on dowstream gadget\n", this->module()->name());
+            return GADGET_FAIL;
+          }
+        }
+        return GADGET_OK;
       }
-      return 0;
+
+      int success;
+      try{ success = this->process(m); }
+      catch (std::runtime_error& err){
+        GEXCEPTION(err,"Gadget::process() failed\n");
+        success = -1;
+      }
+      statistics_.process_time_us.add(GadgetStatistics::elapsed_us(process_start, GadgetStatistics::clock::now()));
+
+      if (success == -1) {
+        m->release();
+        this->flush();
+        GERROR("Gadget (%s) process failed\n", this->module()->name());
+        return GADGET_FAIL;
+      }
+      return GADGET_OK;
+    }
+
+    /**
+    *  Selects the scheduler mode. In the pooled mode the gadget does not start its own threads,
+    *  messages are processed by tasks on the shared GadgetWorkerPool and desired_threads() is the
+    *  maximal number of messages processed concurrently. Must be set before open() is called.
+    */
+    void use_worker_pool(bool p)
+    {
+      use_worker_pool_ = p;
+    }
+
+    bool use_worker_pool() const
+    {
+      return use_worker_pool_;
     }
 
     virtual int set_parameter(const char* name, const char* val, bool trigger = true) {
@@ -348,6 +540,19 @@ namespace Gadgetron{
       return gadgetron_version_.c_str();
     }
 
+    /**
+    *  Queue depth, queue wait time and processing time histograms, updated by svc()
+    */
+    const GadgetStatistics& get_statistics() const
+    {
+      return statistics_;
+    }
+
+    void reset_statistics()
+    {
+      statistics_.reset();
+    }
+
   protected:
     std::vector<GadgetPropertyBase*> properties_;
 
@@ -367,6 +572,45 @@ namespace Gadgetron{
     bool pass_on_undesired_data_;
     GadgetStreamInterface* controller_;
     ACE_Thread_Mutex parameter_mutex_;
+    GadgetStatistics statistics_;
+    GadgetronTrace* trace_;
+    std::atomic<uint64_t> traced_messages_;
+    GadgetronProfile* profile_;
+    std::shared_ptr<GadgetronMemoryAccount> memory_account_;
+    std::shared_ptr<GadgetronThreadBudget::Stream> thread_budget_;
+    int max_omp_threads_;
+    int thread_priority_;
+
+    void apply_thread_priority();
+
+    // Pooled scheduler mode, see use_worker_pool()
+    int open_pooled();
+    int wait_pooled();
+    void schedule_pooled();
+    void run_pooled();
+
+    /**
+    *  Notification strategy installed on the message queue in the pooled mode,
+    *  every enqueued message schedules the gadget on the worker pool.
+    */
+    class PoolNotifier : public ACE_Notification_Strategy
+    {
+    public:
+      PoolNotifier(Gadget* g) : ACE_Notification_Strategy(0, ACE_Event_Handler::NULL_MASK), gadget_(g) {}
+      virtual int notify(void) { gadget_->schedule_pooled(); return 0; }
+      virtual int notify(ACE_Event_Handler*, ACE_Reactor_Mask) { return this->notify(); }
+    protected:
+      Gadget* gadget_;
+    };
+
+    bool use_worker_pool_;
+    PoolNotifier pool_notifier_;
+    std::atomic<int> pool_running_;
+    std::atomic<bool> pool_stopped_;
+    bool pool_finished_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+
   private:
     std::map<std::string, std::string> parameters_;
     std::string gadgetron_version_;
@@ -633,10 +877,55 @@ namespace Gadgetron{
 
         virtual ~BasicPropertyGadget() {}
 
+        virtual int open(void* args = 0)
+        {
+          bool payload_limit = queue_high_water_mark_mb.value() > 0;
+
+          if (queue_type.value() == "lockfree") {
+            GDEBUG("Gadget (%s) uses a lock-free input queue with capacity %d\n", this->module()->name(), queue_capacity.value());
+            if (payload_limit) {
+              GWARN("Gadget (%s), queue_high_water_mark_mb is ignored for lockfree queues, use queue_capacity\n", this->module()->name());
+            }
+            //The task takes ownership of the queue and deletes it on destruction
+            this->msg_queue(new GadgetLockFreeMessageQueue(queue_capacity.value()));
+            this->delete_msg_queue_ = true;
+          } else if (payload_limit && this->use_worker_pool()) {
+            //Worker pool tasks must not block in putq
+            GWARN("Gadget (%s), queue_high_water_mark_mb is ignored in the pooled scheduler mode\n", this->module()->name());
+          } else if (payload_limit) {
+            float low_water = queue_low_water_mark_mb.value();
+            if (low_water <= 0) low_water = 0.5f*queue_high_water_mark_mb.value();
+
+            size_t hwm = static_cast<size_t>(queue_high_water_mark_mb.value()*1024*1024);
+            size_t lwm = static_cast<size_t>(low_water*1024*1024);
+            GDEBUG("Gadget (%s) input queue is limited to %d bytes of payload (resume at %d bytes)\n", this->module()->name(), hwm, lwm);
+
+            this->msg_queue(new GadgetPayloadMessageQueue(hwm, lwm));
+            this->delete_msg_queue_ = true;
+          }
+          this->max_omp_threads(omp_threads.value());
+
+          if (thread_priority.value() > 0 && this->use_worker_pool()) {
+            GWARN("Gadget (%s), thread_priority is ignored in the pooled scheduler mode\n", this->module()->name());
+          } else {
+            this->thread_priority(thread_priority.value());
+          }
+          return Gadget::open(args);
+        }
+
       protected:
         GADGET_PROPERTY(using_cloudbus,bool,"Indicates whether the cloudbus is in use and available", false);
         GADGET_PROPERTY(pass_on_undesired_data,bool, "If true, data not matching the process function will be passed to next Gadget", false);
         GADGET_PROPERTY(threads,int, "Number of threads to run in this Gadget", 1);
+        GADGET_PROPERTY(omp_threads, int, "Maximal number of OpenMP threads per message, below the share of the gadget in the thread budget (0 = the share)", 0);
+        GADGET_PROPERTY_LIMITS(thread_priority, int, "Real-time (SCHED_FIFO) priority of the gadget threads for latency critical pipelines (0 = normal scheduling)", 0,
+          GadgetPropertyLimitsRange, 0, 99);
+        GADGET_PROPERTY_LIMITS(queue_type, std::string, "Input queue implementation, ace (mutex based ACE_Message_Queue) or lockfree (bounded ring buffer)", "ace",
+          GadgetPropertyLimitsEnumeration, "ace", "lockfree");
+        GADGET_PROPERTY_LIMITS(queue_capacity, int, "Maximal number of messages on a lockfree input queue (rounded up to a power of two)", 4096,
+          GadgetPropertyLimitsRange, 2, 1048576);
+        GADGET_PROPERTY(queue_high_water_mark_mb, float, "Upstream gadgets block when the payload on the input queue reaches this size in MB (0 = no payload limit)", 0);
+        GADGET_PROPERTY(queue_low_water_mark_mb, float, "Blocked upstream gadgets resume when the input queue payload drops to this size in MB (0 = half of the high water mark)", 0);
         #ifdef _WIN32
         GADGET_PROPERTY(workingDirectory, std::string, "Where to store temporary files", "c:\\temp\\gadgetron\\");
         #else
@@ -644,6 +933,20 @@ namespace Gadgetron{
         #endif // _WIN32
       };
 
+      /**
+         Objects which keep their data in a compact form until load_data() is called, such as the half
+         precision buffers of IsmrmrdReconData, are loaded when a gadget receives them. The process
+         functions of Gadget1/2/3 always see the full data, whatever the upstream gadget stored.
+      */
+      template <class T> auto load_message_data(T& obj, int) -> decltype(obj.load_data(), void())
+      {
+        obj.load_data();
+      }
+
+      template <class T> void load_message_data(T&, long)
+      {
+      }
+
       template <class P1> class Gadget1 : public BasicPropertyGadget
       {
 
@@ -662,6 +965,7 @@ namespace Gadgetron{
 
           }
 
+          load_message_data(*m->getObjectPtr(), 0);
           return this->process(m);
         }
 
@@ -702,6 +1006,8 @@ namespace Gadgetron{
             }
           }
 
+          load_message_data(*m1->getObjectPtr(), 0);
+          load_message_data(*m2->getObjectPtr(), 0);
           return this->process(m1,m2);
         }
 
@@ -749,6 +1055,9 @@ namespace Gadgetron{
             }
           }
 
+          load_message_data(*m1->getObjectPtr(), 0);
+          load_message_data(*m2->getObjectPtr(), 0);
+          load_message_data(*m3->getObjectPtr(), 0);
           return this->process(m1,m2,m3);
         }
 
@@ -0,0 +1,36 @@
+#include "GadgetAttributeEncoding.h"
+
+namespace Gadgetron
+{
+  std::mutex GadgetAttributeEncoding::registry_mutex_;
+  std::map<ACE_HANDLE, ACE_UINT32> GadgetAttributeEncoding::registry_;
+
+  bool GadgetAttributeEncoding::is_supported(ACE_UINT32 encoding)
+  {
+    return (encoding == GADGET_ATTRIBUTE_ENCODING_XML) || (encoding == GADGET_ATTRIBUTE_ENCODING_BINARY);
+  }
+
+  void GadgetAttributeEncoding::register_encoding(ACE_HANDLE socket, ACE_UINT32 encoding)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    if (encoding == GADGET_ATTRIBUTE_ENCODING_XML) {
+      registry_.erase(socket);
+    } else {
+      registry_[socket] = encoding;
+    }
+  }
+
+  void GadgetAttributeEncoding::unregister_encoding(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    registry_.erase(socket);
+  }
+
+  ACE_UINT32 GadgetAttributeEncoding::for_socket(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    std::map<ACE_HANDLE, ACE_UINT32>::iterator it = registry_.find(socket);
+    if (it == registry_.end()) return GADGET_ATTRIBUTE_ENCODING_XML;
+    return it->second;
+  }
+}
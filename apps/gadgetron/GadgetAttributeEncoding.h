@@ -0,0 +1,45 @@
+/** \file   GadgetAttributeEncoding.h
+    \brief  Encoding of the meta attributes of the images sent back on a connection.
+
+            The attributes are sent as XML unless the client asks for another encoding with a
+            GADGET_MESSAGE_ATTRIBUTE_ENCODING message. Encodings the server does not know are
+            ignored, so the client has to accept XML in any case.
+*/
+
+#ifndef GADGETATTRIBUTEENCODING_H
+#define GADGETATTRIBUTEENCODING_H
+#pragma once
+
+#include "gadgetbase_export.h"
+
+#include <ace/os_include/sys/os_types.h>
+#include <ace/Basic_Types.h>
+
+#include <map>
+#include <mutex>
+
+namespace Gadgetron{
+
+  enum GadgetAttributeEncodingType {
+    GADGET_ATTRIBUTE_ENCODING_XML    = 0,
+    GADGET_ATTRIBUTE_ENCODING_BINARY = 1  //See MetaContainerBinary.h
+  };
+
+  class EXPORTGADGETBASE GadgetAttributeEncoding
+  {
+  public:
+    /// Whether the server can send the encoding
+    static bool is_supported(ACE_UINT32 encoding);
+
+    /// Encoding of a connection, looked up by the socket handle of the connection
+    static void register_encoding(ACE_HANDLE socket, ACE_UINT32 encoding);
+    static void unregister_encoding(ACE_HANDLE socket);
+    static ACE_UINT32 for_socket(ACE_HANDLE socket);
+
+  protected:
+    static std::mutex registry_mutex_;
+    static std::map<ACE_HANDLE, ACE_UINT32> registry_;
+  };
+}
+
+#endif //GADGETATTRIBUTEENCODING_H
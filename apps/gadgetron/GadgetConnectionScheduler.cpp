@@ -0,0 +1,156 @@
+#include "GadgetConnectionScheduler.h"
+#include "GadgetStreamController.h"
+#include "GadgetronMemoryAccount.h"
+#include "GadgetronMetrics.h"
+#include "log.h"
+
+#include <chrono>
+#include <exception>
+
+namespace Gadgetron{
+
+  namespace {
+    //Memory and GPUs are freed without a notification, waiting batch streams check again this often
+    const int ADMISSION_POLL_MS = 1000;
+  }
+
+  GadgetConnectionScheduler::Admission::~Admission()
+  {
+    scheduler_->release(batch_);
+  }
+
+  GadgetConnectionScheduler* GadgetConnectionScheduler::instance()
+  {
+    static GadgetConnectionScheduler scheduler;
+    return &scheduler;
+  }
+
+  GadgetConnectionScheduler::GadgetConnectionScheduler()
+    : next_ticket_(0)
+    , running_batch_(0)
+    , running_realtime_(0)
+    , default_batch_(false)
+    , max_batch_streams_(0)
+    , min_gpu_memory_(0)
+    , queue_timeout_(0)
+  {
+  }
+
+  void GadgetConnectionScheduler::configure(const GadgetronXML::Scheduling& scheduling)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    default_batch_ = (scheduling.defaultPriority == "batch");
+    max_batch_streams_ = scheduling.maxBatchStreams;
+    min_gpu_memory_ = size_t(scheduling.minGpuMemoryMB) << 20;
+    queue_timeout_ = scheduling.queueTimeout;
+    released_.notify_all();
+  }
+
+  bool GadgetConnectionScheduler::default_batch()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return default_batch_;
+  }
+
+  void GadgetConnectionScheduler::set_gpu_memory_probe(std::function<size_t()> probe)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    gpu_memory_probe_ = probe;
+  }
+
+  bool GadgetConnectionScheduler::batch_fits()
+  {
+    if (max_batch_streams_ > 0 && running_batch_ >= max_batch_streams_) return false;
+
+    size_t limit = GadgetStreamController::memory_limit();
+    if (limit > 0 && GadgetronMemoryTracker::instance().bytes(GadgetronMemoryAccount::HOST) >= limit) return false;
+
+    if (min_gpu_memory_ > 0 && gpu_memory_probe_) {
+      size_t free = 0;
+      try { free = gpu_memory_probe_(); }
+      catch (std::exception& e) {
+        GERROR("GadgetConnectionScheduler, failed to query the free GPU memory: %s\n", e.what());
+        return true;
+      }
+      if (free < min_gpu_memory_) return false;
+    }
+
+    return true;
+  }
+
+  std::unique_ptr<GadgetConnectionScheduler::Admission> GadgetConnectionScheduler::admit(bool batch)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!batch) {
+      running_realtime_++;
+      return std::unique_ptr<Admission>(new Admission(this, false));
+    }
+
+    uint64_t ticket = next_ticket_++;
+    queue_.push_back(ticket);
+
+    if (queue_.front() != ticket || !this->batch_fits()) {
+      GINFO("Batch stream queued, %d waiting, %d batch streams running\n", (int)queue_.size(), (int)running_batch_);
+    }
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(queue_timeout_);
+
+    while (queue_.front() != ticket || !this->batch_fits()) {
+      if (queue_timeout_ > 0 && std::chrono::steady_clock::now() >= deadline) {
+        for (std::deque<uint64_t>::iterator it = queue_.begin(); it != queue_.end(); ++it) {
+          if (*it == ticket) {
+            queue_.erase(it);
+            break;
+          }
+        }
+        released_.notify_all();
+        GWARN("Batch stream not admitted within %d seconds\n", (int)queue_timeout_);
+        return std::unique_ptr<Admission>();
+      }
+      released_.wait_for(lock, std::chrono::milliseconds(ADMISSION_POLL_MS));
+    }
+
+    queue_.pop_front();
+    running_batch_++;
+
+    //The next stream in the queue may fit as well
+    released_.notify_all();
+    return std::unique_ptr<Admission>(new Admission(this, true));
+  }
+
+  void GadgetConnectionScheduler::release(bool batch)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (batch) {
+      running_batch_--;
+    } else {
+      running_realtime_--;
+    }
+    released_.notify_all();
+  }
+
+  size_t GadgetConnectionScheduler::queued()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return queue_.size();
+  }
+
+  size_t GadgetConnectionScheduler::running(bool batch)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return batch ? running_batch_ : running_realtime_;
+  }
+
+  void GadgetConnectionScheduler::write_metrics(std::ostream& os)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    GadgetronMetrics::write_header(os, "gadgetron_queued_streams", "Batch streams waiting for admission", "gauge");
+    GadgetronMetrics::write_sample(os, "gadgetron_queued_streams", "", queue_.size());
+
+    GadgetronMetrics::write_header(os, "gadgetron_admitted_streams", "Admitted streams by priority", "gauge");
+    GadgetronMetrics::write_sample(os, "gadgetron_admitted_streams", "priority=\"realtime\"", running_realtime_);
+    GadgetronMetrics::write_sample(os, "gadgetron_admitted_streams", "priority=\"batch\"", running_batch_);
+  }
+}
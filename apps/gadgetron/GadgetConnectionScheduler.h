@@ -0,0 +1,100 @@
+/** \file   GadgetConnectionScheduler.h
+    \brief  Admission of the streams of the connections by priority.
+
+            A live scan on the scanner cannot wait, a burst of offline reprocessing jobs can. Every stream
+            is either real-time or batch: the priority of its configuration, overridden by a
+            GADGET_MESSAGE_STREAM_PRIORITY message of the client, or the default priority of gadgetron.xml.
+
+            Real-time streams are admitted at once. Batch streams are queued in the order they arrive
+            until fewer than the maximum number of batch streams are running, the host array memory of the
+            streams is below the memory limit (GADGETRON_MEMORY_LIMIT_MB) and a GPU has the minimum free
+            memory. The stream controller asks for admission after the configuration is received and before
+            its gadgets are built, a batch stream that is not admitted within the queue timeout is closed.
+
+            Once running, batch streams are throttled to one thread each while real-time streams are
+            running, see GadgetronThreadBudget.
+*/
+
+#ifndef GADGETCONNECTIONSCHEDULER_H
+#define GADGETCONNECTIONSCHEDULER_H
+#pragma once
+
+#include "gadgetbase_export.h"
+#include "gadgetron_xml.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETBASE GadgetConnectionScheduler
+  {
+  public:
+
+    /// A running stream, counts towards the limits until it is destroyed
+    class Admission
+    {
+    public:
+      ~Admission();
+
+      bool batch() const { return batch_; }
+
+    protected:
+      friend class GadgetConnectionScheduler;
+      Admission(GadgetConnectionScheduler* scheduler, bool batch) : scheduler_(scheduler), batch_(batch) {}
+
+      GadgetConnectionScheduler* scheduler_;
+      bool batch_;
+    };
+
+    static GadgetConnectionScheduler* instance();
+
+    void configure(const GadgetronXML::Scheduling& scheduling);
+
+    /// Priority of streams which neither the configuration nor the client gives one
+    bool default_batch();
+
+    /// Largest free memory of the GPUs in bytes, set by the server when it is built with CUDA
+    void set_gpu_memory_probe(std::function<size_t()> probe);
+
+    /**
+       Admits a stream. Real-time streams return at once, batch streams wait in the queue.
+       Returns null if a batch stream was not admitted within the queue timeout.
+     */
+    std::unique_ptr<Admission> admit(bool batch);
+
+    size_t queued();
+    size_t running(bool batch);
+
+    /// Queue and running streams in the Prometheus text format, see GadgetStreamController::write_metrics
+    void write_metrics(std::ostream& os);
+
+  protected:
+    GadgetConnectionScheduler();
+
+    // whether the stream at the head of the queue can run, mutex_ must be held
+    bool batch_fits();
+
+    void release(bool batch);
+
+    std::mutex mutex_;
+    std::condition_variable released_;
+    std::deque<uint64_t> queue_;
+    uint64_t next_ticket_;
+    size_t running_batch_;
+    size_t running_realtime_;
+
+    bool default_batch_;
+    size_t max_batch_streams_;
+    size_t min_gpu_memory_;
+    unsigned int queue_timeout_;
+    std::function<size_t()> gpu_memory_probe_;
+  };
+}
+
+#endif //GADGETCONNECTIONSCHEDULER_H
@@ -4,6 +4,9 @@
 
 #include <ace/Message_Block.h>
 #include <string>
+#include <new>
+
+#include "GadgetMessageAllocator.h"
 
 namespace Gadgetron{
 /**
@@ -31,8 +34,29 @@ class GadgetContainerMessageBase : public ACE_Message_Block
   {
     set_flags(CONTAINER_MESSAGE_BLOCK);
   }
+
+  /**
+     Constructor taking an allocator which is used for the data buffer, the data block
+     and (by the caller) for the memory of the message block itself
+   */
+  GadgetContainerMessageBase(size_t size, ACE_Allocator* allocator)
+    : base(size, ACE_Message_Block::MB_DATA, 0, 0, allocator, 0,
+           ACE_DEFAULT_MESSAGE_BLOCK_PRIORITY, ACE_Time_Value::zero, ACE_Time_Value::max_time,
+           allocator, allocator)
+  {
+    set_flags(CONTAINER_MESSAGE_BLOCK);
+  }
   
 
+  /**
+     Number of bytes held by the contained object, including memory it owns on the heap
+     when the type reports it (e.g. hoNDArray::get_number_of_bytes). Used for queue accounting.
+   */
+  virtual size_t payload_bytes()
+  {
+    return this->length();
+  }
+
 #ifdef WIN32
   std::string getTypeID() { return type_magic_id_; }
   template <class T> static std::string magic_number_for_type() { return std::string(typeid(T).name()); } 
@@ -62,6 +86,25 @@ protected:
 #endif  
 };
 
+/**
+   Payload size of an object stored in a container message. Types with a get_number_of_bytes()
+   member (the arrays) add the size of their data, other types count with their own size.
+ */
+template <class T> auto container_payload_bytes(T& t, int) -> decltype(size_t(t.get_number_of_bytes()))
+{
+  return sizeof(T) + t.get_number_of_bytes();
+}
+
+template <class T> size_t container_payload_bytes(T&, long)
+{
+  return sizeof(T);
+}
+
+/**
+   Tag type selecting the allocator based constructor of GadgetContainerMessage
+ */
+struct GadgetContainerMessagePooled {};
+
 template <class T> class GadgetContainerMessage : public GadgetContainerMessageBase
 {
   typedef GadgetContainerMessageBase base;
@@ -88,6 +131,17 @@ public:
    }
 
 
+  /**
+   *  Constructor for messages placed in memory from an allocator, see make_pooled_container_message.
+   */
+  template<typename... X> GadgetContainerMessage(const GadgetContainerMessagePooled&, ACE_Allocator* allocator, X... xs)
+  :base(sizeof(T), allocator), content_(0)
+   {
+    content_ = new (this->wr_ptr()) T(xs...);
+    this->wr_ptr(sizeof(T));
+    type_magic_id_ = magic_number_for_type<T>();
+   }
+
   GadgetContainerMessage(ACE_Data_Block* d)
     : base(d)
   {
@@ -118,6 +172,11 @@ public:
     return content_;
   }
 
+  virtual size_t payload_bytes()
+  {
+    return content_ ? container_payload_bytes(*content_, 0) : 0;
+  }
+
   virtual GadgetContainerMessage<T>* duplicate() 
   {
     GadgetContainerMessage<T>* nb = new GadgetContainerMessage<T>(this->data_block()->duplicate());
@@ -133,6 +192,21 @@ protected:
   T* content_;
 }; 
 
+/**
+   Creates a GadgetContainerMessage whose message block, data block and content are served
+   from the GadgetMessageAllocator free lists. The message is used and released like any
+   other container message; ACE returns the memory to the allocator on release.
+ */
+template <class T, typename... X> GadgetContainerMessage<T>* make_pooled_container_message(X... xs)
+{
+  ACE_Allocator* allocator = GadgetMessageAllocator::instance();
+  void* mem = allocator->malloc(sizeof(GadgetContainerMessage<T>));
+  if (!mem) {
+    return 0;
+  }
+  return new (mem) GadgetContainerMessage<T>(GadgetContainerMessagePooled(), allocator, xs...);
+}
+
 /**
    This function replaces the slower dynamic_cast which we would otherwise rely on.
    The speed of dynamic_cast varies greatly from platform to platform.
@@ -0,0 +1,314 @@
+#include "GadgetFileIngest.h"
+#include "GadgetContainerMessage.h"
+#include "GadgetronMemoryAccount.h"
+#include "GadgetronNuma.h"
+#include "hoNDArray.h"
+#include "hoNDArrayMemoryPool.h"
+#include "log.h"
+
+#include <ismrmrd/ismrmrd.h>
+#include <ismrmrd/dataset.h>
+
+#include <algorithm>
+#include <complex>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/stat.h>
+  #include <limits.h>
+#endif
+
+namespace Gadgetron{
+
+  namespace {
+    //Guards all HDF5 calls of the ingests, see the file comment
+    std::mutex hdf5_mutex;
+
+    //Set once at startup, before the connections are accepted
+    std::string ingest_root;
+
+    //The absolute path with the symbolic links and '.'/'..' resolved, empty if it does not exist
+    std::string canonical_path(const std::string& path)
+    {
+#ifdef _WIN32
+      char resolved[MAX_PATH];
+      if (!_fullpath(resolved, path.c_str(), MAX_PATH)) return std::string();
+      if (GetFileAttributesA(resolved) == INVALID_FILE_ATTRIBUTES) return std::string();
+      return std::string(resolved);
+#else
+      char resolved[PATH_MAX];
+      if (!realpath(path.c_str(), resolved)) return std::string();
+      return std::string(resolved);
+#endif
+    }
+
+    bool is_directory(const std::string& path)
+    {
+#ifdef _WIN32
+      DWORD attributes = GetFileAttributesA(path.c_str());
+      return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+      struct stat st;
+      return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+    }
+
+    bool is_separator(char c)
+    {
+#ifdef _WIN32
+      return c == '/' || c == '\\';
+#else
+      return c == '/';
+#endif
+    }
+
+    //The array owns the memory from the hoNDArray memory pool and gives it back when released
+    template <typename T> bool create_pooled(hoNDArray<T>& a, std::vector<size_t>& dims)
+    {
+      size_t N = 1;
+      for (size_t d = 0; d < dims.size(); d++) N *= dims[d];
+
+      if (N == 0) {
+        a.create(&dims);
+        return true;
+      }
+
+      T* data = hoNDArrayMemoryPool::instance().allocate<T>(N);
+      if (!data) return false;
+
+      a.create(&dims, data, true);
+      return true;
+    }
+
+    //The messages of one acquisition as the acquisition reader makes them: header, data and the trajectory if there is one
+    ACE_Message_Block* make_acquisition_message(const ISMRMRD::Acquisition& acq)
+    {
+      GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1 =
+        make_pooled_container_message<ISMRMRD::AcquisitionHeader>();
+
+      GadgetContainerMessage<hoNDArray< std::complex<float> > >* m2 =
+        make_pooled_container_message< hoNDArray< std::complex<float> > >();
+
+      if (!m1 || !m2) {
+        if (m1) m1->release();
+        if (m2) m2->release();
+        return 0;
+      }
+
+      m1->cont(m2);
+      *m1->getObjectPtr() = acq.getHead();
+
+      std::vector<size_t> adims;
+      adims.push_back(acq.number_of_samples());
+      adims.push_back(acq.active_channels());
+
+      if (!create_pooled(*m2->getObjectPtr(), adims)) {
+        m1->release();
+        return 0;
+      }
+      memcpy(m2->getObjectPtr()->get_data_ptr(), acq.getDataPtr(), sizeof(std::complex<float>)*adims[0]*adims[1]);
+
+      if (acq.trajectory_dimensions()) {
+        GadgetContainerMessage<hoNDArray< float > >* m3 =
+          make_pooled_container_message< hoNDArray< float > >();
+
+        if (!m3) {
+          m1->release();
+          return 0;
+        }
+        m2->cont(m3);
+
+        std::vector<size_t> tdims;
+        tdims.push_back(acq.trajectory_dimensions());
+        tdims.push_back(acq.number_of_samples());
+
+        if (!create_pooled(*m3->getObjectPtr(), tdims)) {
+          m1->release();
+          return 0;
+        }
+        memcpy(m3->getObjectPtr()->get_data_ptr(), acq.getTrajPtr(), sizeof(float)*tdims[0]*tdims[1]);
+      }
+
+      return m1;
+    }
+
+    void release_chain(ACE_Message_Block* mb)
+    {
+      while (mb) {
+        ACE_Message_Block* next_mb = mb->next();
+        mb->next(0);
+        mb->release();
+        mb = next_mb;
+      }
+    }
+  }
+
+  bool GadgetFileIngest::set_root(const std::string& root)
+  {
+    std::string resolved = canonical_path(root);
+    if (resolved.empty() || !is_directory(resolved)) {
+      GERROR("GadgetFileIngest, the ingest root %s is not a directory, file ingest is disabled\n", root.c_str());
+      ingest_root.clear();
+      return false;
+    }
+
+    //Without the trailing separator a root /data would let /data2 through
+    while (resolved.size() > 1 && is_separator(resolved[resolved.size()-1])) resolved.erase(resolved.size()-1);
+    ingest_root = resolved;
+    return true;
+  }
+
+  bool GadgetFileIngest::enabled()
+  {
+    return !ingest_root.empty();
+  }
+
+  std::string GadgetFileIngest::resolve(const std::string& filename)
+  {
+    if (ingest_root.empty() || filename.empty()) return std::string();
+
+    std::string resolved = canonical_path(filename);
+    if (resolved.size() <= ingest_root.size()) return std::string();
+    if (resolved.compare(0, ingest_root.size(), ingest_root) != 0) return std::string();
+
+    //The root itself may end with a separator, e.g. /
+    if (!is_separator(ingest_root[ingest_root.size()-1]) && !is_separator(resolved[ingest_root.size()])) return std::string();
+    if (is_directory(resolved)) return std::string();
+
+    return resolved;
+  }
+
+  GadgetFileIngest::GadgetFileIngest(const std::string& filename, const std::string& group, size_t chunk_acquisitions)
+    : filename_(filename)
+    , group_(group)
+    , chunk_acquisitions_((chunk_acquisitions > 0) ? chunk_acquisitions : size_t(DEFAULT_CHUNK_ACQUISITIONS))
+    , acquisitions_(0)
+    , numa_node_(-1)
+    , done_(false)
+    , failed_(false)
+    , stop_(false)
+  {
+  }
+
+  GadgetFileIngest::~GadgetFileIngest()
+  {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_all();
+
+    if (thread_.joinable()) thread_.join();
+
+    for (size_t k = 0; k < chunks_.size(); k++) release_chain(chunks_[k]);
+    chunks_.clear();
+
+    std::lock_guard<std::mutex> guard(hdf5_mutex);
+    dataset_.reset();
+  }
+
+  bool GadgetFileIngest::start(std::shared_ptr<GadgetronMemoryAccount> account, int numa_node)
+  {
+    account_ = account;
+    numa_node_ = numa_node;
+
+    try {
+      std::lock_guard<std::mutex> guard(hdf5_mutex);
+      dataset_.reset(new ISMRMRD::Dataset(filename_.c_str(), group_.c_str(), false));
+      dataset_->readHeader(header_);
+      acquisitions_ = dataset_->getNumberOfAcquisitions();
+    } catch (std::exception& e) {
+      GERROR("GadgetFileIngest, unable to read %s%s: %s\n", filename_.c_str(), group_.c_str(), e.what());
+      dataset_.reset();
+      return false;
+    }
+
+    GINFO("Reading %d acquisitions from %s%s on the server\n", (int)acquisitions_, filename_.c_str(), group_.c_str());
+
+    thread_ = std::thread([this]() { this->prefetch(); });
+    return true;
+  }
+
+  ACE_Message_Block* GadgetFileIngest::read_chunk(size_t first, size_t count)
+  {
+    ACE_Message_Block* head = 0;
+    ACE_Message_Block* tail = 0;
+
+    ISMRMRD::Acquisition acq;
+    for (size_t i = first; i < first + count; i++) {
+      try {
+        std::lock_guard<std::mutex> guard(hdf5_mutex);
+        dataset_->readAcquisition((uint32_t)i, acq);
+      } catch (std::exception& e) {
+        GERROR("GadgetFileIngest, unable to read acquisition %d of %s: %s\n", (int)i, filename_.c_str(), e.what());
+        release_chain(head);
+        return 0;
+      }
+
+      ACE_Message_Block* mb = make_acquisition_message(acq);
+      if (!mb) {
+        GERROR("GadgetFileIngest, failed to allocate acquisition message\n");
+        release_chain(head);
+        return 0;
+      }
+
+      if (tail) tail->next(mb); else head = mb;
+      tail = mb;
+    }
+
+    return head;
+  }
+
+  void GadgetFileIngest::prefetch()
+  {
+    //The arrays belong to the stream, as if its reader had received them
+    GadgetronMemoryAccountScope memory_scope(account_.get());
+    GadgetronNumaScope numa_scope(numa_node_, false);
+
+    for (size_t first = 0; first < acquisitions_; first += chunk_acquisitions_) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return stop_ || chunks_.size() < size_t(PREFETCH_CHUNKS); });
+        if (stop_) return;
+      }
+
+      size_t count = std::min(chunk_acquisitions_, acquisitions_ - first);
+      ACE_Message_Block* chunk = this->read_chunk(first, count);
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!chunk) {
+        failed_ = true;
+        break;
+      }
+      chunks_.push_back(chunk);
+      cond_.notify_all();
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    done_ = true;
+    cond_.notify_all();
+  }
+
+  ACE_Message_Block* GadgetFileIngest::next_chunk()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return !chunks_.empty() || done_ || stop_ || !thread_.joinable(); });
+
+    if (chunks_.empty()) return 0;
+
+    ACE_Message_Block* chunk = chunks_.front();
+    chunks_.pop_front();
+    cond_.notify_all();
+    return chunk;
+  }
+
+  bool GadgetFileIngest::failed()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return failed_;
+  }
+}
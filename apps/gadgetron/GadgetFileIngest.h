@@ -0,0 +1,104 @@
+/** \file   GadgetFileIngest.h
+    \brief  Reads the acquisitions of an ISMRMRD file on the server for a stream, ahead of the gadgets.
+
+            For reprocessing of stored data the client only names a file the server can read
+            (GADGET_MESSAGE_FILE_INGEST), instead of sending every acquisition over the socket to be
+            read back by the acquisition reader. A prefetch thread reads the dataset in chunks of
+            acquisitions into pooled acquisition messages, the same messages the acquisition reader
+            produces, and keeps a bounded number of chunks ready while the stream controller puts the
+            previous ones on the stream. The images go back to the client as usual, or to a file if
+            the chain writes them there.
+
+            HDF5 is not thread safe in every build, the datasets of all ingests are read under one lock.
+
+            A client must not get the server to open arbitrary files, so file ingest is off unless
+            gadgetron.xml names a root directory (fileIngest/root). The requested file is resolved with
+            realpath, symbolic links and '..' included, and must lie below the root.
+*/
+
+#pragma once
+
+#include "gadgetbase_export.h"
+
+#include <ace/Message_Block.h>
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <string>
+#include <cstdint>
+
+namespace ISMRMRD { class Dataset; }
+
+namespace Gadgetron{
+
+  class GadgetronMemoryAccount;
+
+  class EXPORTGADGETBASE GadgetFileIngest
+  {
+  public:
+    enum { DEFAULT_CHUNK_ACQUISITIONS = 1024, PREFETCH_CHUNKS = 2 };
+
+    /// Enables file ingest for the files below the directory root, false if root is not a directory
+    static bool set_root(const std::string& root);
+
+    /// Whether a root is set, file ingest requests are refused otherwise
+    static bool enabled();
+
+    /// The resolved path of filename if it is below the root, empty otherwise
+    static std::string resolve(const std::string& filename);
+
+    GadgetFileIngest(const std::string& filename, const std::string& group, size_t chunk_acquisitions = DEFAULT_CHUNK_ACQUISITIONS);
+
+    /// Stops the prefetch thread and releases the chunks not taken
+    ~GadgetFileIngest();
+
+    /**
+       Opens the dataset and reads its header, then starts the prefetch thread. The arrays are
+       charged to account and placed on NUMA node numa_node (-1 for any). False if the file
+       cannot be read.
+     */
+    bool start(std::shared_ptr<GadgetronMemoryAccount> account, int numa_node);
+
+    /// The ISMRMRD header of the dataset, valid after start()
+    const std::string& header() const { return header_; }
+
+    size_t number_of_acquisitions() const { return acquisitions_; }
+
+    /**
+       The next chunk of acquisition messages, linked with next() in the order of the file.
+       Blocks until the chunk has been read, 0 at the end of the file or if reading failed.
+     */
+    ACE_Message_Block* next_chunk();
+
+    /// Whether reading the dataset failed, the chunks before the failure have been returned
+    bool failed();
+
+  protected:
+    void prefetch();
+
+    /// Reads the acquisitions [first, first+count) into a chain of messages, 0 on failure
+    ACE_Message_Block* read_chunk(size_t first, size_t count);
+
+    std::string filename_;
+    std::string group_;
+    size_t chunk_acquisitions_;
+
+    std::unique_ptr<ISMRMRD::Dataset> dataset_;
+    std::string header_;
+    size_t acquisitions_;
+
+    std::shared_ptr<GadgetronMemoryAccount> account_;
+    int numa_node_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<ACE_Message_Block*> chunks_;
+    bool done_;
+    bool failed_;
+    bool stop_;
+  };
+}
@@ -0,0 +1,36 @@
+#include "GadgetImageCompression.h"
+
+namespace Gadgetron
+{
+  std::mutex GadgetImageCompression::registry_mutex_;
+  std::map<ACE_HANDLE, GadgetMessageImageCompression> GadgetImageCompression::registry_;
+
+  void GadgetImageCompression::register_compression(ACE_HANDLE socket, const GadgetMessageImageCompression& compression)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    if (compression.mode == 0) {
+      registry_.erase(socket);
+    } else {
+      registry_[socket] = compression;
+    }
+  }
+
+  void GadgetImageCompression::unregister_compression(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    registry_.erase(socket);
+  }
+
+  GadgetMessageImageCompression GadgetImageCompression::for_socket(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    std::map<ACE_HANDLE, GadgetMessageImageCompression>::iterator it = registry_.find(socket);
+    if (it == registry_.end()) {
+      GadgetMessageImageCompression none;
+      none.mode = 0;
+      none.tolerance = 0.0f;
+      return none;
+    }
+    return it->second;
+  }
+}
@@ -0,0 +1,38 @@
+/** \file   GadgetImageCompression.h
+    \brief  Compression of the images sent back on a connection.
+
+            Images are sent uncompressed unless the client asks for compression with a
+            GADGET_MESSAGE_IMAGE_COMPRESSION message. The modes and the format of the compressed
+            images are defined by the image writer (see ImageCompression.h of the mri_core gadgets),
+            which falls back to uncompressed images for modes it was built without.
+*/
+
+#ifndef GADGETIMAGECOMPRESSION_H
+#define GADGETIMAGECOMPRESSION_H
+#pragma once
+
+#include "gadgetbase_export.h"
+#include "GadgetMessageInterface.h"
+
+#include <ace/os_include/sys/os_types.h>
+
+#include <map>
+#include <mutex>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETBASE GadgetImageCompression
+  {
+  public:
+    /// Compression of a connection, looked up by the socket handle of the connection. Mode 0 is no compression.
+    static void register_compression(ACE_HANDLE socket, const GadgetMessageImageCompression& compression);
+    static void unregister_compression(ACE_HANDLE socket);
+    static GadgetMessageImageCompression for_socket(ACE_HANDLE socket);
+
+  protected:
+    static std::mutex registry_mutex_;
+    static std::map<ACE_HANDLE, GadgetMessageImageCompression> registry_;
+  };
+}
+
+#endif //GADGETIMAGECOMPRESSION_H
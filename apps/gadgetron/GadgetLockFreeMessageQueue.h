@@ -0,0 +1,373 @@
+/** \file   GadgetLockFreeMessageQueue.h
+    \brief  Bounded lock-free multi-producer/multi-consumer message queue for gadgets.
+
+            The queue derives from ACE_Message_Queue and overrides the virtual enqueue/dequeue
+            interface, so it can be installed on any ACE_Task with ACE_Task::msg_queue(...).
+            putq/getq, flush and the hangup handling in Gadget::svc/Gadget::close therefore work
+            unchanged.
+
+            The ring buffer is the bounded MPMC queue by D. Vyukov: every cell carries a sequence
+            number which tells producers and consumers whether the cell is free or holds data.
+            Producers and consumers only contend on one atomic counter each.
+
+            A consumer that finds the queue empty spins for a short while and then sleeps on a
+            condition variable; producers only touch the mutex if a consumer is actually sleeping.
+            A producer that finds the queue full yields until space is available, which gives a
+            natural back-pressure towards the upstream gadget.
+
+            Ordering is strictly FIFO; enqueue_head/enqueue_prio are mapped to enqueue_tail.
+            An installed ACE_Notification_Strategy is notified for every enqueued message.
+*/
+
+#ifndef GADGETLOCKFREEMESSAGEQUEUE_H
+#define GADGETLOCKFREEMESSAGEQUEUE_H
+#pragma once
+
+#include <ace/Message_Queue.h>
+#include <ace/OS_NS_sys_time.h>
+#include <ace/OS_NS_errno.h>
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class GadgetLockFreeMessageQueue : public ACE_Message_Queue<ACE_MT_SYNCH>
+  {
+  public:
+    typedef ACE_Message_Queue<ACE_MT_SYNCH> inherited;
+
+    enum { DEFAULT_CAPACITY = 4096 };
+
+    /**
+       @param capacity Maximal number of messages on the queue, rounded up to a power of two
+     */
+    GadgetLockFreeMessageQueue(size_t capacity = DEFAULT_CAPACITY)
+      : inherited()
+      , cells_(round_up_to_power_of_two(capacity))
+      , mask_(round_up_to_power_of_two(capacity) - 1)
+      , enqueue_pos_(0)
+      , dequeue_pos_(0)
+      , bytes_(0)
+      , sleepers_(0)
+      , lf_state_(ACE_Message_Queue_Base::ACTIVATED)
+    {
+      for (size_t i = 0; i < cells_.size(); i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+        cells_[i].data = 0;
+      }
+    }
+
+    virtual ~GadgetLockFreeMessageQueue()
+    {
+      this->release_all();
+    }
+
+    size_t capacity() const
+    {
+      return cells_.size();
+    }
+
+    /**
+       Non-blocking enqueue, returns false if the queue is full
+     */
+    bool try_enqueue(ACE_Message_Block* mb)
+    {
+      Cell* cell;
+      size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+      for (;;) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+        if (dif == 0) {
+          if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+          return false;
+        } else {
+          pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+      }
+
+      cell->data = mb;
+      bytes_.fetch_add(mb->total_size(), std::memory_order_relaxed);
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+       Non-blocking dequeue, returns false if the queue is empty
+     */
+    bool try_dequeue(ACE_Message_Block*& mb)
+    {
+      Cell* cell;
+      size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+      for (;;) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+        if (dif == 0) {
+          if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+          return false;
+        } else {
+          pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+      }
+
+      mb = cell->data;
+      cell->data = 0;
+      bytes_.fetch_sub(mb->total_size(), std::memory_order_relaxed);
+      cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+      return true;
+    }
+
+    virtual int enqueue_tail(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      if (!new_item) {
+        errno = EINVAL;
+        return -1;
+      }
+
+      unsigned int spins = 0;
+      while (!this->try_enqueue(new_item)) {
+        if (this->deactivated()) {
+          errno = ESHUTDOWN;
+          return -1;
+        }
+        if (timeout && ACE_OS::gettimeofday() >= *timeout) {
+          errno = EWOULDBLOCK;
+          return -1;
+        }
+        backoff(spins++);
+      }
+
+      this->wake_consumer();
+      if (this->notification_strategy_) {
+        this->notification_strategy_->notify();
+      }
+      return (int)this->message_count();
+    }
+
+    virtual int enqueue_head(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->enqueue_tail(new_item, timeout);
+    }
+
+    virtual int enqueue_prio(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->enqueue_tail(new_item, timeout);
+    }
+
+    virtual int enqueue_deadline(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->enqueue_tail(new_item, timeout);
+    }
+
+    virtual int enqueue(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->enqueue_tail(new_item, timeout);
+    }
+
+    virtual int dequeue_head(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      const unsigned int spin_limit = 64;
+      unsigned int spins = 0;
+
+      while (!this->try_dequeue(first_item)) {
+        if (this->deactivated()) {
+          errno = ESHUTDOWN;
+          return -1;
+        }
+        if (timeout && ACE_OS::gettimeofday() >= *timeout) {
+          errno = EWOULDBLOCK;
+          return -1;
+        }
+
+        if (spins < spin_limit) {
+          backoff(spins++);
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->is_empty() && !this->deactivated()) {
+          //The timed wait is only a safety net, producers signal sleeping consumers
+          sleep_cv_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        sleepers_.fetch_sub(1);
+      }
+
+      return (int)this->message_count();
+    }
+
+    virtual int dequeue(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->dequeue_head(first_item, timeout);
+    }
+
+    virtual int dequeue_prio(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      return this->dequeue_head(first_item, timeout);
+    }
+
+    virtual int dequeue_tail(ACE_Message_Block*& dequeued, ACE_Time_Value* timeout = 0)
+    {
+      return this->dequeue_head(dequeued, timeout);
+    }
+
+    virtual int dequeue_deadline(ACE_Message_Block*& dequeued, ACE_Time_Value* timeout = 0)
+    {
+      return this->dequeue_head(dequeued, timeout);
+    }
+
+    virtual int peek_dequeue_head(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      //Peeking is inherently racy with concurrent consumers and is not supported
+      errno = ENOTSUP;
+      return -1;
+    }
+
+    virtual bool is_empty(void)
+    {
+      return this->message_count() == 0;
+    }
+
+    virtual bool is_full(void)
+    {
+      return this->message_count() >= cells_.size();
+    }
+
+    virtual size_t message_count(void)
+    {
+      size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+      size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+      return (enq > deq) ? (enq - deq) : 0;
+    }
+
+    virtual size_t message_bytes(void)
+    {
+      return bytes_.load(std::memory_order_relaxed);
+    }
+
+    virtual size_t message_length(void)
+    {
+      return this->message_bytes();
+    }
+
+    virtual int flush(void)
+    {
+      return this->release_all();
+    }
+
+    virtual int close(void)
+    {
+      this->deactivate();
+      return this->release_all();
+    }
+
+    virtual int deactivate(void)
+    {
+      int previous = lf_state_.exchange(ACE_Message_Queue_Base::DEACTIVATED);
+      this->wake_all_consumers();
+      return previous;
+    }
+
+    virtual int activate(void)
+    {
+      return lf_state_.exchange(ACE_Message_Queue_Base::ACTIVATED);
+    }
+
+    virtual int pulse(void)
+    {
+      int previous = lf_state_.exchange(ACE_Message_Queue_Base::PULSED);
+      this->wake_all_consumers();
+      return previous;
+    }
+
+    virtual int state(void)
+    {
+      return lf_state_.load();
+    }
+
+    virtual bool deactivated(void)
+    {
+      return lf_state_.load() == ACE_Message_Queue_Base::DEACTIVATED;
+    }
+
+  protected:
+
+    struct Cell
+    {
+      std::atomic<size_t> sequence;
+      ACE_Message_Block* data;
+    };
+
+    static size_t round_up_to_power_of_two(size_t n)
+    {
+      size_t p = 2;
+      while (p < n) p <<= 1;
+      return p;
+    }
+
+    static void backoff(unsigned int spins)
+    {
+      if (spins < 16) {
+        return;
+      } else if (spins < 256) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+
+    void wake_consumer()
+    {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+      }
+    }
+
+    void wake_all_consumers()
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      sleep_cv_.notify_all();
+    }
+
+    int release_all()
+    {
+      int released = 0;
+      ACE_Message_Block* mb = 0;
+      while (this->try_dequeue(mb)) {
+        mb->release();
+        released++;
+      }
+      return released;
+    }
+
+    std::vector<Cell> cells_;
+    size_t mask_;
+
+    //Keep the producer and consumer positions on separate cache lines
+    char pad0_[64];
+    std::atomic<size_t> enqueue_pos_;
+    char pad1_[64];
+    std::atomic<size_t> dequeue_pos_;
+    char pad2_[64];
+
+    std::atomic<size_t> bytes_;
+    std::atomic<int> sleepers_;
+    std::atomic<int> lf_state_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+  };
+}
+
+#endif //GADGETLOCKFREEMESSAGEQUEUE_H
@@ -0,0 +1,140 @@
+/** \file   GadgetMessageAllocator.h
+    \brief  Free-list ACE_Allocator used for pooled GadgetContainerMessage allocation.
+
+            ACE_Message_Block can take allocators for the message block itself, its ACE_Data_Block
+            and the data buffer. GadgetMessageAllocator serves all three from power-of-two size
+            classes and keeps released blocks on free lists, so that messages which are created and
+            released at a high rate (one per readout) are recycled instead of going through new/delete.
+
+            The allocator is a process wide singleton; messages may outlive the stream they were
+            created by. The number of cached blocks per size class is bounded, every size class
+            has its own lock.
+*/
+
+#ifndef GADGETMESSAGEALLOCATOR_H
+#define GADGETMESSAGEALLOCATOR_H
+#pragma once
+
+#include <ace/Malloc_Base.h>
+
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <new>
+
+namespace Gadgetron{
+
+  class GadgetMessageAllocator : public ACE_New_Allocator
+  {
+  public:
+
+    enum
+    {
+      MIN_BLOCK_SIZE_LOG2 = 6,     // 64 bytes
+      MAX_BLOCK_SIZE_LOG2 = 14,    // 16 KB
+      NUMBER_OF_CLASSES = MAX_BLOCK_SIZE_LOG2 - MIN_BLOCK_SIZE_LOG2 + 1,
+      MAX_CACHED_BLOCKS = 8192,
+      HEADER_SIZE = 16             // keeps the returned memory 16 byte aligned
+    };
+
+    static GadgetMessageAllocator* instance()
+    {
+      //Never destroyed, messages may still be released during static destruction
+      static GadgetMessageAllocator* allocator = new GadgetMessageAllocator();
+      return allocator;
+    }
+
+    virtual void* malloc(size_t nbytes)
+    {
+      size_t c = size_class(nbytes);
+
+      char* block = 0;
+      if (c < NUMBER_OF_CLASSES) {
+        std::lock_guard<std::mutex> guard(classes_[c].mutex);
+        std::vector<char*>& free_list = classes_[c].free_list;
+        if (!free_list.empty()) {
+          block = free_list.back();
+          free_list.pop_back();
+        }
+      }
+
+      if (!block) {
+        size_t bsize = (c < NUMBER_OF_CLASSES) ? block_size(c) : nbytes;
+        block = static_cast<char*>(::operator new(bsize + HEADER_SIZE, std::nothrow));
+        if (!block) return 0;
+        *reinterpret_cast<size_t*>(block) = c;
+      }
+
+      return block + HEADER_SIZE;
+    }
+
+    virtual void* calloc(size_t nbytes, char initial_value = '\0')
+    {
+      void* ptr = this->malloc(nbytes);
+      if (ptr) std::memset(ptr, initial_value, nbytes);
+      return ptr;
+    }
+
+    virtual void* calloc(size_t n_elem, size_t elem_size, char initial_value = '\0')
+    {
+      return this->calloc(n_elem*elem_size, initial_value);
+    }
+
+    virtual void free(void* ptr)
+    {
+      if (!ptr) return;
+
+      char* block = static_cast<char*>(ptr) - HEADER_SIZE;
+      size_t c = *reinterpret_cast<size_t*>(block);
+
+      if (c < NUMBER_OF_CLASSES) {
+        std::lock_guard<std::mutex> guard(classes_[c].mutex);
+        std::vector<char*>& free_list = classes_[c].free_list;
+        if (free_list.size() < MAX_CACHED_BLOCKS) {
+          free_list.push_back(block);
+          return;
+        }
+      }
+
+      ::operator delete(block);
+    }
+
+    /// Number of blocks currently cached on the free lists
+    size_t cached_blocks()
+    {
+      size_t n = 0;
+      for (size_t c = 0; c < NUMBER_OF_CLASSES; c++) {
+        std::lock_guard<std::mutex> guard(classes_[c].mutex);
+        n += classes_[c].free_list.size();
+      }
+      return n;
+    }
+
+    static size_t block_size(size_t c)
+    {
+      return size_t(1) << (c + MIN_BLOCK_SIZE_LOG2);
+    }
+
+    static size_t size_class(size_t nbytes)
+    {
+      size_t c = 0;
+      while (c < NUMBER_OF_CLASSES && block_size(c) < nbytes) c++;
+      return c;
+    }
+
+  protected:
+    GadgetMessageAllocator() {}
+    virtual ~GadgetMessageAllocator() {}
+
+    struct SizeClass
+    {
+      std::mutex mutex;
+      std::vector<char*> free_list;
+    };
+
+    SizeClass classes_[NUMBER_OF_CLASSES];
+  };
+}
+
+#endif //GADGETMESSAGEALLOCATOR_H
@@ -19,6 +19,11 @@ enum GadgetronMessageID {
   GADGET_MESSAGE_PARAMETER_SCRIPT =   3,
   GADGET_MESSAGE_CLOSE            =   4,
   GADGET_MESSAGE_TEXT             =   5,
+  GADGET_MESSAGE_SHM_ATTACH       =   6,
+  GADGET_MESSAGE_ATTRIBUTE_ENCODING =  7,
+  GADGET_MESSAGE_IMAGE_COMPRESSION  =  8,
+  GADGET_MESSAGE_STREAM_PRIORITY    =  9,
+  GADGET_MESSAGE_FILE_INGEST        = 10,
   GADGET_MESSAGE_INT_ID_MAX       = 999
 };
 
@@ -37,6 +42,60 @@ struct GadgetMessageScript
   ACE_UINT32 script_length;
 };
 
+/**
+   Announces the shared memory ring (see GadgetSharedMemoryRing.h) that carries the payload
+   of the following messages. Only accepted on local connections.
+ */
+struct GadgetMessageSharedMemoryAttach
+{
+  char name[256];
+};
+
+/**
+   Requests the encoding of the meta attributes of the images sent back
+   (see GadgetAttributeEncoding.h). Unknown encodings leave the attributes in XML.
+ */
+struct GadgetMessageAttributeEncoding
+{
+  ACE_UINT32 encoding;
+};
+
+/**
+   Requests the compression of the images sent back (see GadgetImageCompression.h),
+   tolerance is the absolute error bound of the lossy modes.
+ */
+struct GadgetMessageImageCompression
+{
+  ACE_UINT32 mode;
+  float tolerance;
+};
+
+enum GadgetStreamPriority {
+  GADGET_STREAM_PRIORITY_REALTIME = 0,
+  GADGET_STREAM_PRIORITY_BATCH    = 1
+};
+
+/**
+   Sets the priority of the stream (see GadgetConnectionScheduler.h), sent before the
+   configuration. Overrides the priority of the stream configuration.
+ */
+struct GadgetMessageStreamPriority
+{
+  ACE_UINT32 priority;
+};
+
+/**
+   Asks the server to read the header and the acquisitions of an ISMRMRD file itself (see
+   GadgetFileIngest.h), sent after the configuration in place of them. The file must be readable
+   by the server, chunk_acquisitions 0 takes the default chunk size.
+ */
+struct GadgetMessageFileIngest
+{
+  char filename[1024];
+  char group[256];
+  ACE_UINT32 chunk_acquisitions;
+};
+
 
 /**
    Interface for classes capable of reading a specific message
@@ -50,6 +109,8 @@ class GadgetMessageReader
 
   /**
      Function must be implemented to read a specific message.
+     A reader may return several messages linked with ACE_Message_Block::next(),
+     they are put on the stream one after the other.
    */
   virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream) = 0;
 
@@ -0,0 +1,253 @@
+/** \file   GadgetPayloadMessageQueue.h
+    \brief  Gadget input queue bounded by the payload memory of the queued messages.
+
+            ACE_Message_Queue limits the bytes of the message blocks themselves. For container
+            messages that is the size of the hoNDArray object, not of its data, so an ACE queue
+            in front of a slow gadget grows without bound. This queue counts the payload of every
+            message (GadgetContainerMessageBase::payload_bytes() over the cont() chain) and blocks
+            producers once the high water mark is reached, until the queue has drained to the low
+            water mark.
+
+            A full queue blocks the putq of the upstream gadget, whose own queue then fills up, and
+            so on until the stream controller blocks in stream_.put() and stops reading from the
+            socket. The memory held by a stream is thereby bounded by the sum of the limits.
+
+            Only data messages are subject to the limit, hangup and other control messages are
+            always accepted.
+*/
+
+#ifndef GADGETPAYLOADMESSAGEQUEUE_H
+#define GADGETPAYLOADMESSAGEQUEUE_H
+#pragma once
+
+#include "GadgetContainerMessage.h"
+
+#include <ace/Message_Queue.h>
+#include <ace/OS_NS_sys_time.h>
+#include <ace/OS_NS_errno.h>
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+namespace Gadgetron{
+
+  class GadgetPayloadMessageQueue : public ACE_Message_Queue<ACE_MT_SYNCH>
+  {
+  public:
+    typedef ACE_Message_Queue<ACE_MT_SYNCH> inherited;
+
+    /**
+       @param high_water_bytes Producers block when the queued payload reaches this size
+       @param low_water_bytes  Blocked producers resume when the queued payload has dropped to this size
+     */
+    GadgetPayloadMessageQueue(size_t high_water_bytes, size_t low_water_bytes)
+      : inherited()
+      , payload_high_water_mark_(high_water_bytes)
+      , payload_low_water_mark_(std::min(low_water_bytes, high_water_bytes))
+      , payload_bytes_(0)
+      , blocked_(false)
+    {
+      //The queue is bounded by payload, the ACE limit on message block bytes is lifted
+      this->high_water_mark(std::numeric_limits<size_t>::max()/2);
+      this->low_water_mark(std::numeric_limits<size_t>::max()/2);
+    }
+
+    virtual ~GadgetPayloadMessageQueue() {}
+
+    /// Payload bytes of a message and all messages in its cont() chain
+    static size_t message_payload_bytes(ACE_Message_Block* mb)
+    {
+      size_t bytes = 0;
+      for (ACE_Message_Block* m = mb; m; m = m->cont()) {
+        if (m->flags() & GadgetContainerMessageBase::CONTAINER_MESSAGE_BLOCK) {
+          bytes += reinterpret_cast<GadgetContainerMessageBase*>(m)->payload_bytes();
+        } else {
+          bytes += m->length();
+        }
+      }
+      return bytes;
+    }
+
+    size_t payload_bytes()
+    {
+      std::lock_guard<std::mutex> guard(credit_mutex_);
+      return payload_bytes_;
+    }
+
+    size_t payload_high_water_mark() const
+    {
+      return payload_high_water_mark_;
+    }
+
+    size_t payload_low_water_mark() const
+    {
+      return payload_low_water_mark_;
+    }
+
+    virtual int enqueue_tail(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      if (this->wait_for_credit(new_item, timeout) == -1) return -1;
+      size_t bytes = message_payload_bytes(new_item);
+      int r = inherited::enqueue_tail(new_item, timeout);
+      if (r != -1) this->add_payload(bytes);
+      return r;
+    }
+
+    virtual int enqueue_head(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      if (this->wait_for_credit(new_item, timeout) == -1) return -1;
+      size_t bytes = message_payload_bytes(new_item);
+      int r = inherited::enqueue_head(new_item, timeout);
+      if (r != -1) this->add_payload(bytes);
+      return r;
+    }
+
+    virtual int enqueue_prio(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      if (this->wait_for_credit(new_item, timeout) == -1) return -1;
+      size_t bytes = message_payload_bytes(new_item);
+      int r = inherited::enqueue_prio(new_item, timeout);
+      if (r != -1) this->add_payload(bytes);
+      return r;
+    }
+
+    virtual int enqueue_deadline(ACE_Message_Block* new_item, ACE_Time_Value* timeout = 0)
+    {
+      if (this->wait_for_credit(new_item, timeout) == -1) return -1;
+      size_t bytes = message_payload_bytes(new_item);
+      int r = inherited::enqueue_deadline(new_item, timeout);
+      if (r != -1) this->add_payload(bytes);
+      return r;
+    }
+
+    virtual int dequeue_head(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      int r = inherited::dequeue_head(first_item, timeout);
+      if (r != -1) this->remove_payload(message_payload_bytes(first_item));
+      return r;
+    }
+
+    virtual int dequeue_prio(ACE_Message_Block*& first_item, ACE_Time_Value* timeout = 0)
+    {
+      int r = inherited::dequeue_prio(first_item, timeout);
+      if (r != -1) this->remove_payload(message_payload_bytes(first_item));
+      return r;
+    }
+
+    virtual int dequeue_tail(ACE_Message_Block*& dequeued, ACE_Time_Value* timeout = 0)
+    {
+      int r = inherited::dequeue_tail(dequeued, timeout);
+      if (r != -1) this->remove_payload(message_payload_bytes(dequeued));
+      return r;
+    }
+
+    virtual int dequeue_deadline(ACE_Message_Block*& dequeued, ACE_Time_Value* timeout = 0)
+    {
+      int r = inherited::dequeue_deadline(dequeued, timeout);
+      if (r != -1) this->remove_payload(message_payload_bytes(dequeued));
+      return r;
+    }
+
+    virtual int flush(void)
+    {
+      int r = inherited::flush();
+      this->reset_payload();
+      return r;
+    }
+
+    virtual int close(void)
+    {
+      int r = inherited::close();
+      this->reset_payload();
+      return r;
+    }
+
+    virtual int deactivate(void)
+    {
+      int r = inherited::deactivate();
+      this->wake_producers();
+      return r;
+    }
+
+    virtual int pulse(void)
+    {
+      int r = inherited::pulse();
+      this->wake_producers();
+      return r;
+    }
+
+  protected:
+
+    int wait_for_credit(ACE_Message_Block* new_item, ACE_Time_Value* timeout)
+    {
+      if (!new_item || new_item->msg_type() != ACE_Message_Block::MB_DATA) return 0;
+
+      std::unique_lock<std::mutex> lock(credit_mutex_);
+      while (blocked_) {
+        if (this->deactivated()) {
+          errno = ESHUTDOWN;
+          return -1;
+        }
+
+        if (timeout) {
+          ACE_Time_Value now = ACE_OS::gettimeofday();
+          if (now >= *timeout) {
+            errno = EWOULDBLOCK;
+            return -1;
+          }
+          ACE_Time_Value remaining = *timeout - now;
+          credit_cv_.wait_for(lock, std::chrono::milliseconds(std::max<long>(1, (long)remaining.msec())));
+        } else {
+          //The timed wait only guards against a missed deactivation
+          credit_cv_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+      }
+      return 0;
+    }
+
+    void add_payload(size_t bytes)
+    {
+      std::lock_guard<std::mutex> guard(credit_mutex_);
+      payload_bytes_ += bytes;
+      if (payload_bytes_ >= payload_high_water_mark_) {
+        blocked_ = true;
+      }
+    }
+
+    void remove_payload(size_t bytes)
+    {
+      std::lock_guard<std::mutex> guard(credit_mutex_);
+      payload_bytes_ -= std::min(bytes, payload_bytes_);
+      if (blocked_ && payload_bytes_ <= payload_low_water_mark_) {
+        blocked_ = false;
+        credit_cv_.notify_all();
+      }
+    }
+
+    void reset_payload()
+    {
+      std::lock_guard<std::mutex> guard(credit_mutex_);
+      payload_bytes_ = 0;
+      blocked_ = false;
+      credit_cv_.notify_all();
+    }
+
+    void wake_producers()
+    {
+      std::lock_guard<std::mutex> guard(credit_mutex_);
+      credit_cv_.notify_all();
+    }
+
+    size_t payload_high_water_mark_;
+    size_t payload_low_water_mark_;
+    size_t payload_bytes_;
+    bool blocked_;
+    std::mutex credit_mutex_;
+    std::condition_variable credit_cv_;
+  };
+}
+
+#endif //GADGETPAYLOADMESSAGEQUEUE_H
@@ -2,9 +2,16 @@
 #include "GadgetServerAcceptor.h"
 #include "GadgetStreamController.h"
 #include "CloudBus.h"
+#include "GadgetronMetrics.h"
 
 using namespace Gadgetron;
 
+GadgetServerAcceptor::GadgetServerAcceptor ()
+  : is_listening_(false)
+  , event_loop_(0)
+{
+}
+
 GadgetServerAcceptor::~GadgetServerAcceptor ()
 {
   this->handle_close (ACE_INVALID_HANDLE, 0);
@@ -46,7 +53,16 @@ int GadgetServerAcceptor::open (const ACE_INET_Addr &listen_addr)
       return crow::response(500, "Port not available");
   });
 
-  
+  //Register a way to inspect queue depths and gadget timings of running reconstructions
+  Gadgetron::ReST::instance()->server().route_dynamic("/info/statistics")([]()
+  {
+      std::stringstream ss;
+      GadgetStreamController::print_active_stream_statistics(ss);
+      return ss.str();
+  });
+
+  GadgetronMetrics::instance().add_collector("streams", &GadgetStreamController::write_metrics);
+
   return this->reactor ()->register_handler(this, ACE_Event_Handler::ACCEPT_MASK);
 }
 
@@ -58,6 +74,8 @@ int GadgetServerAcceptor::handle_input (ACE_HANDLE)
 
 
   controller->set_global_gadget_parameters(global_gadget_parameters_);
+  controller->set_event_loop(event_loop_);
+  controller->set_trace_directory(trace_directory_);
 
   if (this->acceptor_.accept (controller->peer ()) == -1) {
     GERROR("Failed to accept controller connection\n"); 
@@ -65,6 +83,12 @@ int GadgetServerAcceptor::handle_input (ACE_HANDLE)
     return -1;
   }
   
+  //Admission control, the client sees the connection closed before the configuration is read
+  if (!GadgetStreamController::admit_connection()) {
+    delete controller;
+    return 0;
+  }
+
   controller->reactor (this->reactor ());
   if (controller->open () == -1)
     controller->handle_close (ACE_INVALID_HANDLE, 0);
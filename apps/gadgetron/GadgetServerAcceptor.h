@@ -8,11 +8,27 @@
 #include <mutex>
 
 namespace Gadgetron{
+
+class GadgetServerEventLoop;
+
 class GadgetServerAcceptor : public ACE_Event_Handler
 {
 public:
+  GadgetServerAcceptor ();
   virtual ~GadgetServerAcceptor ();
 
+  /// Accepted connections are received by the event loop instead of a thread per connection
+  void set_event_loop(GadgetServerEventLoop* loop)
+  {
+    event_loop_ = loop;
+  }
+
+  /// Every connection writes a Chrome trace of its stream to this directory, empty disables tracing
+  void set_trace_directory(const std::string& dir)
+  {
+    trace_directory_ = dir;
+  }
+
   int open (const ACE_INET_Addr &listen_addr);
 
   virtual ACE_HANDLE get_handle (void) const
@@ -36,6 +52,8 @@ protected:
   ACE_SOCK_Acceptor acceptor_;
   std::mutex acceptor_mtx_;
   bool is_listening_;
+  GadgetServerEventLoop* event_loop_;
+  std::string trace_directory_;
   
 };
 }
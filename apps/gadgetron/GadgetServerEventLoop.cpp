@@ -0,0 +1,232 @@
+#include "GadgetServerEventLoop.h"
+#include "GadgetStreamController.h"
+#include "log.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace Gadgetron
+{
+  GadgetServerEventLoop::GadgetServerEventLoop()
+    : epoll_fd_(-1)
+    , wakeup_fd_(-1)
+    , shutdown_(false)
+  {
+  }
+
+  GadgetServerEventLoop::~GadgetServerEventLoop()
+  {
+    this->close();
+  }
+
+#ifdef __linux__
+
+  int GadgetServerEventLoop::open(size_t io_threads)
+  {
+    if (epoll_fd_ != -1) {
+      GERROR("GadgetServerEventLoop is already open\n");
+      return -1;
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+      GERROR("GadgetServerEventLoop, epoll_create1 failed: %d\n", errno);
+      return -1;
+    }
+
+    //Level triggered and never read, it wakes up every I/O thread at shutdown
+    wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeup_fd_ == -1) {
+      GERROR("GadgetServerEventLoop, eventfd failed: %d\n", errno);
+      ::close(epoll_fd_);
+      epoll_fd_ = -1;
+      return -1;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = 0;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev) == -1) {
+      GERROR("GadgetServerEventLoop, failed to register wakeup descriptor: %d\n", errno);
+      ::close(wakeup_fd_);
+      ::close(epoll_fd_);
+      wakeup_fd_ = epoll_fd_ = -1;
+      return -1;
+    }
+
+    if (io_threads == 0) io_threads = 1;
+
+    shutdown_ = false;
+    for (size_t i = 0; i < io_threads; i++) {
+      threads_.push_back(std::thread([this]() { this->run(); }));
+    }
+
+    GINFO("Receiving client messages on %d I/O threads\n", threads_.size());
+    return 0;
+  }
+
+  int GadgetServerEventLoop::close()
+  {
+    if (epoll_fd_ == -1) return 0;
+
+    shutdown_ = true;
+    uint64_t one = 1;
+    if (::write(wakeup_fd_, &one, sizeof(one)) != sizeof(one)) {
+      GERROR("GadgetServerEventLoop, failed to wake up I/O threads\n");
+    }
+
+    for (size_t i = 0; i < threads_.size(); i++) {
+      if (threads_[i].joinable()) threads_[i].join();
+    }
+    threads_.clear();
+
+    ::close(wakeup_fd_);
+    ::close(epoll_fd_);
+    wakeup_fd_ = epoll_fd_ = -1;
+    return 0;
+  }
+
+  int GadgetServerEventLoop::add(GadgetStreamController* controller)
+  {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+    ev.data.ptr = controller;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, controller->peer().get_handle(), &ev) == -1) {
+      GERROR("GadgetServerEventLoop, failed to register connection: %d\n", errno);
+      return -1;
+    }
+    return 0;
+  }
+
+  int GadgetServerEventLoop::rearm(GadgetStreamController* controller)
+  {
+    //Modifying a one shot descriptor re-evaluates it, data that arrived in the meantime is reported again
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+    ev.data.ptr = controller;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, controller->peer().get_handle(), &ev) == -1) {
+      GERROR("GadgetServerEventLoop, failed to re-arm connection: %d\n", errno);
+      return -1;
+    }
+    return 0;
+  }
+
+  void GadgetServerEventLoop::remove(GadgetStreamController* controller)
+  {
+    struct epoll_event ev;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, controller->peer().get_handle(), &ev);
+
+    //Shutting down the stream waits for the gadgets, the I/O thread moves on
+    std::thread([controller]() { controller->handle_close(ACE_INVALID_HANDLE, 0); }).detach();
+  }
+
+  void GadgetServerEventLoop::run()
+  {
+    const int max_events = 64;
+    struct epoll_event events[max_events];
+
+    while (!shutdown_) {
+      int n = epoll_wait(epoll_fd_, events, max_events, -1);
+      if (n == -1) {
+        if (errno == EINTR) continue;
+        GERROR("GadgetServerEventLoop, epoll_wait failed: %d\n", errno);
+        break;
+      }
+
+      for (int e = 0; e < n; e++) {
+        GadgetStreamController* controller = static_cast<GadgetStreamController*>(events[e].data.ptr);
+        if (!controller) continue; //Wakeup
+        this->handle_connection(controller);
+      }
+    }
+  }
+
+  void GadgetServerEventLoop::handle_connection(GadgetStreamController* controller)
+  {
+    ACE_HANDLE fd = controller->peer().get_handle();
+
+    for (size_t k = 0; k < MAX_MESSAGES_PER_EVENT; k++) {
+      int r = controller->receive_message();
+
+      if (r == GadgetStreamController::RECEIVE_FAILED) {
+        this->remove(controller);
+        return;
+      }
+
+      if (r == GadgetStreamController::RECEIVE_CLOSE) {
+        //Nothing is received until the gadgets have finished, the client waits for the output anyway
+        std::thread([this, controller]() {
+            controller->close_stream();
+            if (this->rearm(controller) == -1) this->remove(controller);
+          }).detach();
+        return;
+      }
+
+      if (r == GadgetStreamController::RECEIVE_CONFIGURE) {
+        //Batch streams may wait for admission and the gadgets are built, nothing is received meanwhile
+        std::thread([this, controller]() {
+            if (controller->configure_received() != GADGET_OK || this->rearm(controller) == -1) this->remove(controller);
+          }).detach();
+        return;
+      }
+
+      if (r == GadgetStreamController::RECEIVE_INGEST) {
+        //The file is read and put on the stream by the server, the client only waits for the output meanwhile
+        std::thread([this, controller]() {
+            if (controller->ingest_received() != GADGET_OK || this->rearm(controller) == -1) this->remove(controller);
+          }).detach();
+        return;
+      }
+
+      //Continue while the next message (or the end of the connection) is already waiting
+      char c;
+      if (::recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == -1) break;
+    }
+
+    if (this->rearm(controller) == -1) {
+      this->remove(controller);
+    }
+  }
+
+#else
+
+  int GadgetServerEventLoop::open(size_t)
+  {
+    GERROR("GadgetServerEventLoop is only available on Linux\n");
+    return -1;
+  }
+
+  int GadgetServerEventLoop::close()
+  {
+    return 0;
+  }
+
+  int GadgetServerEventLoop::add(GadgetStreamController*)
+  {
+    return -1;
+  }
+
+  int GadgetServerEventLoop::rearm(GadgetStreamController*)
+  {
+    return -1;
+  }
+
+  void GadgetServerEventLoop::remove(GadgetStreamController*)
+  {
+  }
+
+  void GadgetServerEventLoop::run()
+  {
+  }
+
+  void GadgetServerEventLoop::handle_connection(GadgetStreamController*)
+  {
+  }
+
+#endif //__linux__
+}
@@ -0,0 +1,70 @@
+/** \file   GadgetServerEventLoop.h
+    \brief  Multiplexes the client connections of the server on a few I/O threads.
+
+            In the default mode every GadgetStreamController runs its own thread that blocks in recv
+            on its socket. With an event loop the controllers are registered with an edge triggered,
+            one shot epoll set instead. Whenever a socket becomes readable one of the I/O threads
+            receives the available messages (GadgetStreamController::receive_message) and puts them
+            on the gadget stream of the connection, then re-arms the socket. A connection is owned
+            by at most one I/O thread at a time, so the messages of a connection stay in order.
+
+            Closing a stream waits for its gadgets to finish and configuring a stream waits for its
+            admission (GadgetConnectionScheduler) and builds the gadgets. These and the teardown of a
+            connection happen on a separate thread so that the I/O threads are never held up by a slow
+            reconstruction.
+
+            Only available on Linux, open() fails on other platforms.
+*/
+
+#ifndef GADGETSERVEREVENTLOOP_H
+#define GADGETSERVEREVENTLOOP_H
+#pragma once
+
+#include "gadgetbase_export.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace Gadgetron{
+
+  class GadgetStreamController;
+
+  class EXPORTGADGETBASE GadgetServerEventLoop
+  {
+  public:
+
+    /// Maximal number of messages read from one connection before the other connections get their turn
+    enum { MAX_MESSAGES_PER_EVENT = 32 };
+
+    GadgetServerEventLoop();
+    virtual ~GadgetServerEventLoop();
+
+    /// Creates the epoll set and starts the I/O threads
+    int open(size_t io_threads);
+
+    /// Stops the I/O threads, connections still registered are left alone
+    int close();
+
+    /// Registers the socket of a controller, its messages are received from now on
+    int add(GadgetStreamController* controller);
+
+    size_t number_of_threads() const
+    {
+      return threads_.size();
+    }
+
+  protected:
+    void run();
+    void handle_connection(GadgetStreamController* controller);
+    int rearm(GadgetStreamController* controller);
+    void remove(GadgetStreamController* controller);
+
+    int epoll_fd_;
+    int wakeup_fd_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> shutdown_;
+  };
+}
+
+#endif //GADGETSERVEREVENTLOOP_H
@@ -0,0 +1,79 @@
+#include "GadgetServerLocalAcceptor.h"
+#include "GadgetStreamController.h"
+
+#include "ace/LSOCK_Stream.h"
+#include "ace/OS_NS_unistd.h"
+
+using namespace Gadgetron;
+
+GadgetServerLocalAcceptor::GadgetServerLocalAcceptor ()
+  : event_loop_(0)
+{
+}
+
+GadgetServerLocalAcceptor::~GadgetServerLocalAcceptor ()
+{
+  this->handle_close (ACE_INVALID_HANDLE, 0);
+}
+
+int GadgetServerLocalAcceptor::open (const std::string& path)
+{
+  path_ = path;
+  ACE_OS::unlink(path_.c_str());
+
+  ACE_UNIX_Addr listen_addr(path_.c_str());
+  if (this->acceptor_.open (listen_addr, 1) == -1) {
+    GERROR("error opening local acceptor on %s\n", path_.c_str());
+    return -1;
+  }
+
+  GINFO("Accepting local connections on %s\n", path_.c_str());
+  return this->reactor ()->register_handler(this, ACE_Event_Handler::ACCEPT_MASK);
+}
+
+int GadgetServerLocalAcceptor::handle_input (ACE_HANDLE)
+{
+  GadgetStreamController *controller;
+
+  ACE_NEW_RETURN (controller, GadgetStreamController, -1);
+
+  controller->set_global_gadget_parameters(global_gadget_parameters_);
+  controller->set_event_loop(event_loop_);
+  controller->set_trace_directory(trace_directory_);
+  controller->set_local_connection(true);
+
+  ACE_LSOCK_Stream local_stream;
+  if (this->acceptor_.accept (local_stream) == -1) {
+    GERROR("Failed to accept local controller connection\n");
+    delete controller;
+    return -1;
+  }
+
+  //The controller and the message readers work on ACE_SOCK_Stream, which only wraps the handle
+  controller->peer ().set_handle (local_stream.get_handle ());
+  local_stream.set_handle (ACE_INVALID_HANDLE);
+
+  //Admission control, the client sees the connection closed before the configuration is read
+  if (!GadgetStreamController::admit_connection()) {
+    delete controller;
+    return 0;
+  }
+
+  controller->reactor (this->reactor ());
+  if (controller->open () == -1)
+    controller->handle_close (ACE_INVALID_HANDLE, 0);
+  return 0;
+}
+
+int GadgetServerLocalAcceptor::handle_close (ACE_HANDLE, ACE_Reactor_Mask)
+{
+  if (this->acceptor_.get_handle () != ACE_INVALID_HANDLE) {
+    GDEBUG("Close Local Acceptor\n");
+    ACE_Reactor_Mask m =
+      ACE_Event_Handler::ACCEPT_MASK | ACE_Event_Handler::DONT_CALL;
+    this->reactor ()->remove_handler (this, m);
+    this->acceptor_.close ();
+    ACE_OS::unlink(path_.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef _GADGETSERVERLOCALACCEPTOR_H
+#define _GADGETSERVERLOCALACCEPTOR_H
+
+#include "ace/LSOCK_Acceptor.h"
+#include "ace/UNIX_Addr.h"
+#include "ace/Reactor.h"
+#include <string>
+#include <map>
+
+namespace Gadgetron{
+
+class GadgetServerEventLoop;
+
+/**
+   Accepts connections from clients on the same host over a Unix domain socket. The
+   connections are served by the usual GadgetStreamController and may in addition attach a
+   shared memory ring for their payload (GadgetSharedMemoryRing.h).
+ */
+class GadgetServerLocalAcceptor : public ACE_Event_Handler
+{
+public:
+  GadgetServerLocalAcceptor ();
+  virtual ~GadgetServerLocalAcceptor ();
+
+  /// Listens on the socket path, a stale socket file from an earlier run is removed
+  int open (const std::string& path);
+
+  virtual ACE_HANDLE get_handle (void) const
+    { return this->acceptor_.get_handle (); }
+
+  virtual int handle_input (ACE_HANDLE fd = ACE_INVALID_HANDLE);
+
+  virtual int handle_close (ACE_HANDLE handle,
+                            ACE_Reactor_Mask close_mask);
+
+  void set_event_loop(GadgetServerEventLoop* loop)
+  {
+    event_loop_ = loop;
+  }
+
+  void set_trace_directory(const std::string& dir)
+  {
+    trace_directory_ = dir;
+  }
+
+  std::map<std::string, std::string> global_gadget_parameters_;
+
+protected:
+  ACE_LSOCK_Acceptor acceptor_;
+  std::string path_;
+  GadgetServerEventLoop* event_loop_;
+  std::string trace_directory_;
+};
+}
+#endif //_GADGETSERVERLOCALACCEPTOR_H
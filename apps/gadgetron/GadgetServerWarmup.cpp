@@ -0,0 +1,144 @@
+#include "GadgetServerWarmup.h"
+#include "GadgetStreamTemplateCache.h"
+#include "GadgetWorkerPool.h"
+#include "gadgetron_config.h"
+#include "gadgetron_system_info.h"
+#include "log.h"
+
+#if USE_CUDA
+#include "cudaDeviceManager.h"
+#endif
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace Gadgetron{
+
+  GadgetServerWarmup::GadgetServerWarmup()
+    : pending_(0)
+    , failures_(0)
+  {
+  }
+
+  void GadgetServerWarmup::start(const GadgetronXML::Warmup& warmup, const std::string& gadgetron_home)
+  {
+    gadgetron_home_ = gadgetron_home;
+
+    for (size_t i = 0; i < warmup.library.size(); i++) {
+      std::string dll = warmup.library[i];
+      this->run("library " + dll, [dll]() { return GadgetStreamTemplateCache::instance()->load_library(dll); });
+    }
+
+    for (size_t i = 0; i < warmup.configuration.size(); i++) {
+      std::string config_file = warmup.configuration[i];
+      this->run("configuration " + config_file, [this, config_file]() { return this->warm_configuration(config_file); });
+    }
+
+    if (warmup.gpu) {
+      int gpus = get_number_of_gpus();
+      for (int d = 0; d < gpus; d++) {
+        std::stringstream str;
+        str << "gpu " << d;
+        this->run(str.str(), [d]() { return GadgetServerWarmup::warm_gpu(d); });
+      }
+    }
+  }
+
+  void GadgetServerWarmup::run(const std::string& what, std::function<bool()> task)
+  {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      pending_++;
+    }
+
+    GadgetWorkerPool::instance()->submit([this, what, task]()
+    {
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+      bool ok = false;
+      try { ok = task(); }
+      catch (std::exception& e) {
+        GERROR("Warm-up of %s failed: %s\n", what.c_str(), e.what());
+      }
+      catch (...) {
+        GERROR("Warm-up of %s failed\n", what.c_str());
+      }
+
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+      if (ok) {
+        GINFO("Warm-up of %s done in %f ms\n", what.c_str(), ms);
+      } else {
+        GWARN("Warm-up of %s did not succeed\n", what.c_str());
+      }
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!ok) failures_++;
+      pending_--;
+      done_.notify_all();
+    });
+  }
+
+  bool GadgetServerWarmup::wait(unsigned int timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (timeout == 0) {
+      done_.wait(lock, [this]() { return pending_ == 0; });
+      return true;
+    }
+    return done_.wait_for(lock, std::chrono::seconds(timeout), [this]() { return pending_ == 0; });
+  }
+
+  bool GadgetServerWarmup::ready()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return pending_ == 0;
+  }
+
+  size_t GadgetServerWarmup::failures()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return failures_;
+  }
+
+  bool GadgetServerWarmup::warm_configuration(const std::string& config_file)
+  {
+    std::string filename = gadgetron_home_ + "/" + std::string(GADGETRON_CONFIG_PATH) + "/" + config_file;
+
+    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      GERROR("Unable to open configuration file: %s\n", filename.c_str());
+      return false;
+    }
+
+    std::string xml((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    GadgetronXML::GadgetStreamConfiguration cfg;
+    GadgetronXML::deserialize(xml.c_str(), cfg);
+
+    //Same key as GadgetStreamController::configure_from_file, so the first connection takes this stream
+    std::string key = GadgetStreamTemplateCache::make_key(config_file, xml);
+    return GadgetStreamTemplateCache::instance()->prepare_now(key, cfg);
+  }
+
+  bool GadgetServerWarmup::warm_gpu(int device)
+  {
+#if USE_CUDA
+    if (cudaSetDevice(device) != cudaSuccess) return false;
+
+    //Creates the context of the device
+    if (cudaFree(0) != cudaSuccess) return false;
+
+    cudaDeviceManager* manager = cudaDeviceManager::Instance();
+    manager->lockHandle(device);
+    manager->unlockHandle(device);
+    manager->lockSparseHandle(device);
+    manager->unlockSparseHandle(device);
+    return true;
+#else
+    return false;
+#endif
+  }
+}
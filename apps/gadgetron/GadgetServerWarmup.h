@@ -0,0 +1,60 @@
+/** \file   GadgetServerWarmup.h
+    \brief  Startup work of the server, done before the first connection is accepted.
+
+            Without it the first connection after a restart loads the gadget libraries, constructs its
+            gadgets and creates the GPU contexts and cuBLAS/cuSPARSE handles, which takes seconds. The
+            warm-up of gadgetron.xml lists the libraries and stream configurations to prepare and whether
+            the GPUs are initialized. The libraries are loaded and pinned and idle streams are built in
+            the GadgetStreamTemplateCache, in parallel on the GadgetWorkerPool; every GPU gets its context
+            and a cuBLAS and a cuSPARSE handle from the cudaDeviceManager.
+
+            The server opens its port once the warm-up is done, so gt_alive only succeeds on a warm server.
+*/
+
+#ifndef GADGETSERVERWARMUP_H
+#define GADGETSERVERWARMUP_H
+#pragma once
+
+#include "gadgetron_xml.h"
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Gadgetron{
+
+  class GadgetServerWarmup
+  {
+  public:
+
+    GadgetServerWarmup();
+
+    /// Starts the warm-up tasks, config files are looked up in the configuration folder of gadgetron_home
+    void start(const GadgetronXML::Warmup& warmup, const std::string& gadgetron_home);
+
+    /// Waits until all tasks are done or timeout seconds have passed (0 waits for all), returns true if done
+    bool wait(unsigned int timeout);
+
+    bool ready();
+
+    /// Number of tasks which failed
+    size_t failures();
+
+  protected:
+
+    void run(const std::string& what, std::function<bool()> task);
+
+    bool warm_configuration(const std::string& config_file);
+    static bool warm_gpu(int device);
+
+    std::string gadgetron_home_;
+
+    std::mutex mutex_;
+    std::condition_variable done_;
+    size_t pending_;
+    size_t failures_;
+  };
+}
+
+#endif //GADGETSERVERWARMUP_H
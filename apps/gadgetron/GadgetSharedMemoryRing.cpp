@@ -0,0 +1,159 @@
+#include "GadgetSharedMemoryRing.h"
+#include "log.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace Gadgetron
+{
+  std::mutex GadgetSharedMemoryRing::registry_mutex_;
+  std::map<ACE_HANDLE, std::shared_ptr<GadgetSharedMemoryRing> > GadgetSharedMemoryRing::registry_;
+
+  GadgetSharedMemoryRing::GadgetSharedMemoryRing()
+    : owner_(false)
+    , base_(0)
+    , mapped_size_(0)
+  {
+  }
+
+#ifndef _WIN32
+
+  GadgetSharedMemoryRing::~GadgetSharedMemoryRing()
+  {
+    if (base_) munmap(base_, mapped_size_);
+    if (owner_) shm_unlink(name_.c_str());
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> GadgetSharedMemoryRing::attach(const std::string& name)
+  {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+      GERROR("GadgetSharedMemoryRing, unable to open shared memory %s: %d\n", name.c_str(), errno);
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < (size_t)DATA_OFFSET) {
+      GERROR("GadgetSharedMemoryRing, shared memory %s is too small\n", name.c_str());
+      ::close(fd);
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    void* base = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      GERROR("GadgetSharedMemoryRing, unable to map shared memory %s: %d\n", name.c_str(), errno);
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    std::shared_ptr<GadgetSharedMemoryRing> ring(new GadgetSharedMemoryRing());
+    ring->name_ = name;
+    ring->base_ = base;
+    ring->mapped_size_ = st.st_size;
+
+    if (!ring->view_.open(base, ring->mapped_size_)) {
+      GERROR("GadgetSharedMemoryRing, shared memory %s does not hold a valid ring\n", name.c_str());
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    return ring;
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> GadgetSharedMemoryRing::create(const std::string& name, size_t capacity)
+  {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+      GERROR("GadgetSharedMemoryRing, unable to create shared memory %s: %d\n", name.c_str(), errno);
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    size_t size = DATA_OFFSET + capacity;
+    if (ftruncate(fd, size) == -1) {
+      GERROR("GadgetSharedMemoryRing, unable to size shared memory %s: %d\n", name.c_str(), errno);
+      ::close(fd);
+      shm_unlink(name.c_str());
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    void* base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      GERROR("GadgetSharedMemoryRing, unable to map shared memory %s: %d\n", name.c_str(), errno);
+      shm_unlink(name.c_str());
+      return std::shared_ptr<GadgetSharedMemoryRing>();
+    }
+
+    std::shared_ptr<GadgetSharedMemoryRing> ring(new GadgetSharedMemoryRing());
+    ring->name_ = name;
+    ring->owner_ = true;
+    ring->base_ = base;
+    ring->mapped_size_ = size;
+    ring->view_.initialize(base, capacity);
+    return ring;
+  }
+
+#else
+
+  GadgetSharedMemoryRing::~GadgetSharedMemoryRing()
+  {
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> GadgetSharedMemoryRing::attach(const std::string&)
+  {
+    GERROR("GadgetSharedMemoryRing is not available on this platform\n");
+    return std::shared_ptr<GadgetSharedMemoryRing>();
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> GadgetSharedMemoryRing::create(const std::string&, size_t)
+  {
+    GERROR("GadgetSharedMemoryRing is not available on this platform\n");
+    return std::shared_ptr<GadgetSharedMemoryRing>();
+  }
+
+#endif //_WIN32
+
+  const char* GadgetSharedMemoryRing::record(const GadgetSharedMemoryRecord& r) const
+  {
+    return view_.record(r);
+  }
+
+  void GadgetSharedMemoryRing::release(const GadgetSharedMemoryRecord& r)
+  {
+    view_.release(r);
+  }
+
+  char* GadgetSharedMemoryRing::reserve(uint64_t bytes, GadgetSharedMemoryRecord& r)
+  {
+    return view_.reserve(bytes, r);
+  }
+
+  void GadgetSharedMemoryRing::commit(const GadgetSharedMemoryRecord& r)
+  {
+    view_.commit(r);
+  }
+
+  void GadgetSharedMemoryRing::register_ring(ACE_HANDLE socket, std::shared_ptr<GadgetSharedMemoryRing> ring)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    registry_[socket] = ring;
+  }
+
+  void GadgetSharedMemoryRing::unregister_ring(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    registry_.erase(socket);
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> GadgetSharedMemoryRing::for_socket(ACE_HANDLE socket)
+  {
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    std::map<ACE_HANDLE, std::shared_ptr<GadgetSharedMemoryRing> >::iterator it = registry_.find(socket);
+    if (it == registry_.end()) return std::shared_ptr<GadgetSharedMemoryRing>();
+    return it->second;
+  }
+}
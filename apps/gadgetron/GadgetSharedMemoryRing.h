@@ -0,0 +1,93 @@
+/** \file   GadgetSharedMemoryRing.h
+    \brief  Shared memory ring buffer for the payload of local (Unix domain socket) connections.
+
+            A client on the same host creates a POSIX shared memory segment, announces it with a
+            GADGET_MESSAGE_SHM_ATTACH message and from then on writes the bulk data of its messages
+            into the ring instead of the socket. The socket only carries the message identifier,
+            the header and a GadgetSharedMemoryRecord with the position of the payload in the ring.
+
+            Segment layout, shared by both processes:
+
+              [GadgetSharedMemoryRingHeader][padding up to data_offset][capacity bytes of data]
+
+            Positions are monotonic byte counters; a record at position p starts at data offset
+            p % capacity and never wraps. If a record does not fit before the end of the data area
+            the client continues at the start of the next lap, the skipped bytes are released with
+            the record. The client advances write_position after writing a record, the server
+            advances read_position once it has taken the payload out. Records are consumed in order,
+            there is a single producer and a single consumer. The header, the record and the ring
+            operations are in GadgetSharedMemoryRingLayout.h, which clients include as well.
+*/
+
+#ifndef GADGETSHAREDMEMORYRING_H
+#define GADGETSHAREDMEMORYRING_H
+#pragma once
+
+#include "gadgetbase_export.h"
+#include "GadgetSharedMemoryRingLayout.h"
+
+#include <ace/os_include/sys/os_types.h>
+#include <ace/Basic_Types.h>
+
+#include <string>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETBASE GadgetSharedMemoryRing
+  {
+  public:
+    enum { DATA_OFFSET = GadgetSharedMemoryRingView::DATA_OFFSET };
+
+    ~GadgetSharedMemoryRing();
+
+    /// Maps an existing segment created by a client, 0 on failure
+    static std::shared_ptr<GadgetSharedMemoryRing> attach(const std::string& name);
+
+    /// Creates and initializes a new segment (client side), it is removed when the ring is destroyed
+    static std::shared_ptr<GadgetSharedMemoryRing> create(const std::string& name, size_t capacity);
+
+    uint64_t capacity() const
+    {
+      return view_.capacity();
+    }
+
+    /**
+       Payload of a record, 0 if the record is not (entirely) written or lies outside of the
+       data area. Only valid until the record is released.
+     */
+    const char* record(const GadgetSharedMemoryRecord& r) const;
+
+    /// Releases a record and every record before it
+    void release(const GadgetSharedMemoryRecord& r);
+
+    /**
+       Client side: space for a record of the given size, blocks while the ring is full.
+       The returned record is published with commit().
+     */
+    char* reserve(uint64_t bytes, GadgetSharedMemoryRecord& r);
+    void commit(const GadgetSharedMemoryRecord& r);
+
+    /// Ring attached to a connection, looked up by the socket handle of the connection
+    static void register_ring(ACE_HANDLE socket, std::shared_ptr<GadgetSharedMemoryRing> ring);
+    static void unregister_ring(ACE_HANDLE socket);
+    static std::shared_ptr<GadgetSharedMemoryRing> for_socket(ACE_HANDLE socket);
+
+  protected:
+    GadgetSharedMemoryRing();
+
+    std::string name_;
+    bool owner_;
+    void* base_;
+    size_t mapped_size_;
+    GadgetSharedMemoryRingView view_;
+
+    static std::mutex registry_mutex_;
+    static std::map<ACE_HANDLE, std::shared_ptr<GadgetSharedMemoryRing> > registry_;
+  };
+}
+
+#endif //GADGETSHAREDMEMORYRING_H
@@ -0,0 +1,152 @@
+/** \file   GadgetSharedMemoryRingLayout.h
+    \brief  Layout of the shared memory ring and the operations on a mapped ring.
+
+            Header only and free of ACE, so that clients (gadgetron_ismrmrd_client, scanner bridges)
+            write the ring with the same code the server reads it with. GadgetSharedMemoryRing maps
+            the segment on the server, the segment layout is described in GadgetSharedMemoryRing.h.
+*/
+
+#ifndef GADGETSHAREDMEMORYRINGLAYOUT_H
+#define GADGETSHAREDMEMORYRINGLAYOUT_H
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace Gadgetron{
+
+  struct GadgetSharedMemoryRingHeader
+  {
+    enum { MAGIC = 0x47545247, VERSION = 1 };
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;    //Bytes in the data area
+    uint64_t data_offset; //Start of the data area from the start of the segment
+
+    alignas(64) std::atomic<uint64_t> write_position; //Advanced by the client
+    alignas(64) std::atomic<uint64_t> read_position;  //Advanced by the server
+  };
+
+  /**
+     Follows the header of a message whose payload is in the ring
+   */
+  struct GadgetSharedMemoryRecord
+  {
+    uint64_t position;
+    uint64_t bytes;
+  };
+
+  /**
+     A mapped ring, does not own the mapping
+   */
+  class GadgetSharedMemoryRingView
+  {
+  public:
+    enum { DATA_OFFSET = 4096 };
+
+    GadgetSharedMemoryRingView()
+      : header_(0)
+      , data_(0)
+    {
+    }
+
+    /// Writes an empty ring of capacity bytes into a mapping of at least DATA_OFFSET + capacity bytes
+    void initialize(void* base, uint64_t capacity)
+    {
+      header_ = new (base) GadgetSharedMemoryRingHeader();
+      header_->capacity = capacity;
+      header_->data_offset = DATA_OFFSET;
+      header_->write_position.store(0);
+      header_->read_position.store(0);
+      header_->version = GadgetSharedMemoryRingHeader::VERSION;
+      header_->magic = GadgetSharedMemoryRingHeader::MAGIC;
+      data_ = reinterpret_cast<char*>(base) + DATA_OFFSET;
+    }
+
+    /// Uses a ring initialized by the other process, false if the mapping does not hold a valid ring
+    bool open(void* base, size_t mapped_size)
+    {
+      if (mapped_size < (size_t)DATA_OFFSET) return false;
+
+      GadgetSharedMemoryRingHeader* h = reinterpret_cast<GadgetSharedMemoryRingHeader*>(base);
+      if (h->magic != GadgetSharedMemoryRingHeader::MAGIC || h->version != GadgetSharedMemoryRingHeader::VERSION
+          || h->data_offset < sizeof(GadgetSharedMemoryRingHeader) || h->capacity == 0
+          || h->data_offset > mapped_size || h->capacity > mapped_size - h->data_offset) {
+        return false;
+      }
+
+      header_ = h;
+      data_ = reinterpret_cast<char*>(base) + h->data_offset;
+      return true;
+    }
+
+    uint64_t capacity() const
+    {
+      return header_->capacity;
+    }
+
+    /**
+       Payload of a record, 0 if the record is not (entirely) written or lies outside of the
+       data area. Only valid until the record is released.
+     */
+    const char* record(const GadgetSharedMemoryRecord& r) const
+    {
+      uint64_t capacity = header_->capacity;
+      uint64_t offset = r.position % capacity;
+
+      if (r.bytes > capacity - offset) return 0;
+      if (r.position < header_->read_position.load(std::memory_order_relaxed)) return 0;
+      if (r.position + r.bytes > header_->write_position.load(std::memory_order_acquire)) return 0;
+
+      return data_ + offset;
+    }
+
+    /// Releases a record and every record before it
+    void release(const GadgetSharedMemoryRecord& r)
+    {
+      header_->read_position.store(r.position + r.bytes, std::memory_order_release);
+    }
+
+    /**
+       Client side: space for a record of the given size, blocks while the ring is full.
+       0 if the record is larger than the ring. The returned record is published with commit().
+     */
+    char* reserve(uint64_t bytes, GadgetSharedMemoryRecord& r)
+    {
+      uint64_t capacity = header_->capacity;
+      if (bytes > capacity) return 0;
+
+      uint64_t position = header_->write_position.load(std::memory_order_relaxed);
+      uint64_t offset = position % capacity;
+      if (bytes > capacity - offset) {
+        //Skip the rest of this lap, the record has to be contiguous
+        position += capacity - offset;
+        offset = 0;
+      }
+
+      while (position + bytes - header_->read_position.load(std::memory_order_acquire) > capacity) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+
+      r.position = position;
+      r.bytes = bytes;
+      return data_ + offset;
+    }
+
+    void commit(const GadgetSharedMemoryRecord& r)
+    {
+      header_->write_position.store(r.position + r.bytes, std::memory_order_release);
+    }
+
+  protected:
+    GadgetSharedMemoryRingHeader* header_;
+    char* data_;
+  };
+}
+
+#endif //GADGETSHAREDMEMORYRINGLAYOUT_H
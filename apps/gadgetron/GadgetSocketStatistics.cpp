@@ -0,0 +1,31 @@
+#include "GadgetSocketStatistics.h"
+
+// Only the kernel header has the byte counters of tcp_info, it must not be mixed with
+// netinet/tcp.h (included by ACE), so this file does not include ACE.
+#if defined(__linux__)
+#include <cstddef>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#endif
+
+namespace Gadgetron{
+
+  bool get_socket_byte_counts(int fd, uint64_t& received, uint64_t& sent)
+  {
+#if defined(__linux__)
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (fd < 0 || getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) return false;
+
+    //Kernels before 4.1 do not fill in the byte counters
+    if (len < offsetof(struct tcp_info, tcpi_bytes_received) + sizeof(info.tcpi_bytes_received)) return false;
+
+    received = info.tcpi_bytes_received;
+    sent = info.tcpi_bytes_acked;
+    return true;
+#else
+    return false;
+#endif
+  }
+}
@@ -0,0 +1,17 @@
+/** \file   GadgetSocketStatistics.h
+    \brief  Byte counts of a connected socket as kept by the kernel.
+
+            The readers and writers of a stream send and receive on the socket directly, so the
+            number of bytes transferred is taken from the kernel (TCP_INFO on Linux) rather than
+            being counted on every call.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Gadgetron{
+
+  /// Bytes received and sent (acknowledged by the peer) on a TCP socket, false where this is not available
+  bool get_socket_byte_counts(int fd, uint64_t& received, uint64_t& sent);
+}
@@ -0,0 +1,188 @@
+/** \file   GadgetStatistics.h
+    \brief  Lightweight per-gadget instrumentation of queue depth, queue wait time and process() time.
+
+            Every Gadget owns a GadgetStatistics object which is updated from Gadget::svc.
+            Values are accumulated in power-of-two histograms with atomic bins, so the statistics
+            can be read by other threads (e.g. the ReST interface) while the stream is running.
+*/
+
+#ifndef GADGETSTATISTICS_H
+#define GADGETSTATISTICS_H
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  /**
+     Histogram with logarithmic (power of two) bins.
+
+     Bin 0 counts the value 0, bin b (b>0) counts values in [2^(b-1), 2^b). The last bin
+     collects everything larger. All members are atomic; add() is lock-free.
+   */
+  class GadgetHistogram
+  {
+  public:
+    enum { NUMBER_OF_BINS = 40 };
+
+    GadgetHistogram()
+    {
+      this->reset();
+    }
+
+    void add(uint64_t v)
+    {
+      bins_[bin_index(v)].fetch_add(1, std::memory_order_relaxed);
+      count_.fetch_add(1, std::memory_order_relaxed);
+      total_.fetch_add(v, std::memory_order_relaxed);
+
+      uint64_t cur_max = max_.load(std::memory_order_relaxed);
+      while (v > cur_max && !max_.compare_exchange_weak(cur_max, v, std::memory_order_relaxed)) {}
+    }
+
+    void reset()
+    {
+      for (size_t b = 0; b < NUMBER_OF_BINS; b++) bins_[b].store(0, std::memory_order_relaxed);
+      count_.store(0, std::memory_order_relaxed);
+      total_.store(0, std::memory_order_relaxed);
+      max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t total() const { return total_.load(std::memory_order_relaxed); }
+    uint64_t max()   const { return max_.load(std::memory_order_relaxed); }
+
+    double mean() const
+    {
+      uint64_t n = this->count();
+      return (n > 0) ? (double)this->total() / (double)n : 0.0;
+    }
+
+    uint64_t bin(size_t b) const { return bins_[b].load(std::memory_order_relaxed); }
+
+    /// Lower bound of the values counted in bin b
+    static uint64_t bin_lower_bound(size_t b)
+    {
+      return (b == 0) ? 0 : (uint64_t(1) << (b - 1));
+    }
+
+    /// Upper bound estimate of percentile p (0 < p <= 1), resolved to bin precision
+    uint64_t percentile(double p) const
+    {
+      uint64_t n = this->count();
+      if (n == 0) return 0;
+
+      uint64_t target = (uint64_t)(p * n + 0.5);
+      if (target < 1) target = 1;
+
+      uint64_t accum = 0;
+      for (size_t b = 0; b < NUMBER_OF_BINS; b++) {
+        accum += this->bin(b);
+        if (accum >= target) {
+          uint64_t upper = (b == 0) ? 0 : ((uint64_t(1) << b) - 1);
+          uint64_t m = this->max();
+          return (upper < m) ? upper : m;
+        }
+      }
+      return this->max();
+    }
+
+    static size_t bin_index(uint64_t v)
+    {
+      size_t b = 0;
+      while (v > 0 && b < NUMBER_OF_BINS - 1) {
+        v >>= 1;
+        b++;
+      }
+      return b;
+    }
+
+  protected:
+    std::atomic<uint64_t> bins_[NUMBER_OF_BINS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> max_;
+  };
+
+  /**
+     Instrumentation collected for one gadget.
+
+     queue_depth     : number of messages found on the gadget queue when a message is dequeued
+     wait_time_us    : time (in micro-seconds) the gadget thread blocked in getq
+     process_time_us : time (in micro-seconds) spent in process() or process_config()
+
+     Gadgets which reconstruct frames of a real-time series report in addition
+
+     frame_latency_us : time (in micro-seconds) from the end of the frame acquisition to its output
+     frames_dropped   : frames skipped because a newer frame was waiting or the deadline had passed
+     deadline_misses  : frames which were put out later than the deadline of the gadget
+   */
+  class GadgetStatistics
+  {
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    GadgetHistogram queue_depth;
+    GadgetHistogram wait_time_us;
+    GadgetHistogram process_time_us;
+    GadgetHistogram frame_latency_us;
+
+    std::atomic<uint64_t> frames_dropped;
+    std::atomic<uint64_t> deadline_misses;
+
+    GadgetStatistics() : frames_dropped(0), deadline_misses(0) {}
+
+    static uint64_t elapsed_us(const clock::time_point& start, const clock::time_point& end)
+    {
+      return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+
+    void reset()
+    {
+      queue_depth.reset();
+      wait_time_us.reset();
+      process_time_us.reset();
+      frame_latency_us.reset();
+      frames_dropped.store(0, std::memory_order_relaxed);
+      deadline_misses.store(0, std::memory_order_relaxed);
+    }
+
+    /// Write a one line summary per quantity
+    void print(std::ostream& os, const char* gadget_name) const
+    {
+      print_histogram(os, gadget_name, "queue_depth", queue_depth);
+      print_histogram(os, gadget_name, "wait_time_us", wait_time_us);
+      print_histogram(os, gadget_name, "process_time_us", process_time_us);
+
+      //Frame statistics only for the gadgets which track frames
+      uint64_t dropped = frames_dropped.load(std::memory_order_relaxed);
+      uint64_t missed = deadline_misses.load(std::memory_order_relaxed);
+      if (frame_latency_us.count() > 0 || dropped > 0) {
+        print_histogram(os, gadget_name, "frame_latency_us", frame_latency_us);
+        os << std::setw(40) << std::left << gadget_name << " "
+           << std::setw(16) << std::left << "frames"
+           << " dropped=" << dropped
+           << " deadline_misses=" << missed << std::endl;
+      }
+    }
+
+    static void print_histogram(std::ostream& os, const char* gadget_name, const char* quantity, const GadgetHistogram& h)
+    {
+      os << std::setw(40) << std::left << gadget_name << " "
+         << std::setw(16) << std::left << quantity
+         << " count=" << h.count()
+         << " mean=" << std::fixed << std::setprecision(1) << h.mean()
+         << " p50=" << h.percentile(0.5)
+         << " p90=" << h.percentile(0.9)
+         << " p99=" << h.percentile(0.99)
+         << " max=" << h.max() << std::endl;
+    }
+  };
+}
+
+#endif //GADGETSTATISTICS_H
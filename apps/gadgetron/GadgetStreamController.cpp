@@ -9,30 +9,249 @@
 #include "GadgetronConnector.h"
 #include "Gadget.h"
 #include "EndGadget.h"
+#include "ReplicatedGadget.h"
+#include "GadgetStreamTemplateCache.h"
+#include "GadgetServerEventLoop.h"
+#include "GadgetSharedMemoryRing.h"
+#include "GadgetAttributeEncoding.h"
+#include "GadgetImageCompression.h"
+#include "GadgetSocketStatistics.h"
+#include "GadgetronMetrics.h"
+#include "GadgetronNodeProfile.h"
 #include "gadgetron_config.h"
 
 #include "gadgetron_xml.h"
+#include "ismrmrd/xml.h"
 #include "url_encode.h"
 #include "CloudBus.h"
 
 #include <complex>
 #include <fstream>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <map>
 
 using namespace Gadgetron;
 
+std::mutex GadgetStreamController::active_streams_mutex_;
+std::set<GadgetStreamController*> GadgetStreamController::active_streams_;
+
+namespace {
+  //Connections that have a stream controller, whether or not the stream is configured yet
+  std::atomic<int64_t> number_of_connections(0);
+
+  //Metrics of the streams that have finished, guarded by active_streams_mutex_
+  struct GadgetMetricTotals
+  {
+    GadgetMetricTotals() : queue_depth(0)
+    {
+      for (size_t k = 0; k < GadgetronMemoryAccount::NUMBER_OF_KINDS; k++) memory_bytes[k] = 0;
+      for (size_t b = 0; b < GadgetHistogram::NUMBER_OF_BINS; b++) wait_bins[b] = process_bins[b] = 0;
+      wait_count = wait_total = process_count = process_total = 0;
+      frames_dropped = deadline_misses = 0;
+    }
+
+    void add(const GadgetStatistics& s)
+    {
+      for (size_t b = 0; b < GadgetHistogram::NUMBER_OF_BINS; b++) {
+        wait_bins[b] += s.wait_time_us.bin(b);
+        process_bins[b] += s.process_time_us.bin(b);
+      }
+      wait_count += s.wait_time_us.count();
+      wait_total += s.wait_time_us.total();
+      process_count += s.process_time_us.count();
+      process_total += s.process_time_us.total();
+      frames_dropped += s.frames_dropped.load(std::memory_order_relaxed);
+      deadline_misses += s.deadline_misses.load(std::memory_order_relaxed);
+    }
+
+    size_t queue_depth;
+    size_t memory_bytes[GadgetronMemoryAccount::NUMBER_OF_KINDS];
+    uint64_t wait_bins[GadgetHistogram::NUMBER_OF_BINS];
+    uint64_t wait_count, wait_total;
+    uint64_t process_bins[GadgetHistogram::NUMBER_OF_BINS];
+    uint64_t process_count, process_total;
+    uint64_t frames_dropped, deadline_misses;
+  };
+
+  std::map<std::string, GadgetMetricTotals> finished_gadget_metrics;
+  uint64_t finished_bytes_received = 0;
+  uint64_t finished_bytes_sent = 0;
+
+  void write_gadget_histogram(std::ostream& os, const std::string& name, const std::string& gadget,
+                              const uint64_t* bins, uint64_t count, uint64_t total)
+  {
+    std::string labels = "gadget=\"" + GadgetronMetrics::escape_label(gadget) + "\"";
+    uint64_t accum = 0;
+    for (size_t b = 0; b < GadgetHistogram::NUMBER_OF_BINS - 1; b++) {
+      accum += bins[b];
+      GadgetronMetrics::write_bucket(os, name, labels, GadgetronMetricHistogram::bucket_upper_bound(b), accum);
+    }
+    GadgetronMetrics::write_histogram_totals(os, name, labels, count, total);
+  }
+}
+
 GadgetStreamController::GadgetStreamController()
   : GadgetStreamInterface()
   , notifier_ (0, this, ACE_Event_Handler::WRITE_MASK)
   , writer_task_(&this->peer())
+  , output_queue_(new GadgetPayloadMessageQueue((size_t)OUTPUT_QUEUE_HIGH_WATER_MARK_MB*1024*1024,
+                                                (size_t)OUTPUT_QUEUE_LOW_WATER_MARK_MB*1024*1024))
+  , event_loop_(0)
+  , priority_(-1)
+  , local_connection_(false)
+  , shm_attached_(false)
+  , received_config_is_file_(false)
 {
+  //The writer thread sends from a queue bounded by payload, so a slow client holds up the
+  //gadgets instead of letting the finished images pile up in memory
+  writer_task_.msg_queue(output_queue_.get());
+  number_of_connections++;
   CloudBus::instance()->report_recon_start();    
 }
 
 GadgetStreamController::~GadgetStreamController()
 { 
+  unregister_active_stream();
+  number_of_connections--;
   CloudBus::instance()->report_recon_end();
 }
 
+void GadgetStreamController::register_active_stream()
+{
+  std::lock_guard<std::mutex> guard(active_streams_mutex_);
+  active_streams_.insert(this);
+  if (thread_budget_) thread_budget_->start();
+}
+
+void GadgetStreamController::unregister_active_stream()
+{
+  std::lock_guard<std::mutex> guard(active_streams_mutex_);
+  if (active_streams_.erase(this)) {
+    this->add_to_finished_metrics();
+  }
+  if (thread_budget_) thread_budget_->stop();
+  admission_.reset();
+}
+
+void GadgetStreamController::add_to_finished_metrics()
+{
+  uint64_t received = 0, sent = 0;
+  if (get_socket_byte_counts((int)this->peer().get_handle(), received, sent)) {
+    finished_bytes_received += received;
+    finished_bytes_sent += sent;
+  }
+
+  ACE_Stream_Iterator<ACE_MT_SYNCH> it(stream_);
+  const GadgetModule* m = 0;
+  while (it.next(m)) {
+    Gadget* g = dynamic_cast<Gadget*>(const_cast<GadgetModule*>(m)->writer());
+    if (g) {
+      finished_gadget_metrics[m->name()].add(g->get_statistics());
+    }
+    it.advance();
+  }
+}
+
+void GadgetStreamController::write_metrics(std::ostream& os)
+{
+  std::lock_guard<std::mutex> guard(active_streams_mutex_);
+
+  uint64_t bytes_received = finished_bytes_received;
+  uint64_t bytes_sent = finished_bytes_sent;
+  std::map<std::string, GadgetMetricTotals> gadgets = finished_gadget_metrics;
+
+  for (std::set<GadgetStreamController*>::iterator s = active_streams_.begin(); s != active_streams_.end(); ++s) {
+    uint64_t received = 0, sent = 0;
+    if (get_socket_byte_counts((int)(*s)->peer().get_handle(), received, sent)) {
+      bytes_received += received;
+      bytes_sent += sent;
+    }
+
+    ACE_Stream_Iterator<ACE_MT_SYNCH> it((*s)->stream_);
+    const GadgetModule* m = 0;
+    while (it.next(m)) {
+      Gadget* g = dynamic_cast<Gadget*>(const_cast<GadgetModule*>(m)->writer());
+      if (g) {
+        GadgetMetricTotals& t = gadgets[m->name()];
+        t.add(g->get_statistics());
+        t.queue_depth += g->msg_queue()->message_count();
+
+        std::shared_ptr<GadgetronMemoryAccount> account = g->get_memory_account();
+        if (account) {
+          t.memory_bytes[GadgetronMemoryAccount::HOST] += account->bytes(GadgetronMemoryAccount::HOST);
+          t.memory_bytes[GadgetronMemoryAccount::DEVICE] += account->bytes(GadgetronMemoryAccount::DEVICE);
+        }
+      }
+      it.advance();
+    }
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_connections", "Open client connections", "gauge");
+  GadgetronMetrics::write_sample(os, "gadgetron_connections", "", number_of_connections.load());
+  GadgetronMetrics::write_header(os, "gadgetron_active_streams", "Configured streams that are running", "gauge");
+  GadgetronMetrics::write_sample(os, "gadgetron_active_streams", "", active_streams_.size());
+  GadgetConnectionScheduler::instance()->write_metrics(os);
+
+  GadgetronMetrics::write_header(os, "gadgetron_bytes_received_total", "Bytes received from clients over TCP", "counter");
+  GadgetronMetrics::write_sample(os, "gadgetron_bytes_received_total", "", bytes_received);
+  GadgetronMetrics::write_header(os, "gadgetron_bytes_sent_total", "Bytes sent to clients over TCP", "counter");
+  GadgetronMetrics::write_sample(os, "gadgetron_bytes_sent_total", "", bytes_sent);
+
+  std::map<std::string, GadgetMetricTotals>::const_iterator g;
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_queue_depth", "Messages waiting in the queue of the gadget, summed over the active streams", "gauge");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    GadgetronMetrics::write_sample(os, "gadgetron_gadget_queue_depth", "gadget=\"" + GadgetronMetrics::escape_label(g->first) + "\"", g->second.queue_depth);
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_memory_bytes", "Array memory allocated by the gadget and not yet released, summed over the active streams", "gauge");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    std::string gadget = "gadget=\"" + GadgetronMetrics::escape_label(g->first) + "\"";
+    GadgetronMetrics::write_sample(os, "gadgetron_gadget_memory_bytes", gadget + ",kind=\"host\"", g->second.memory_bytes[GadgetronMemoryAccount::HOST]);
+    GadgetronMetrics::write_sample(os, "gadgetron_gadget_memory_bytes", gadget + ",kind=\"device\"", g->second.memory_bytes[GadgetronMemoryAccount::DEVICE]);
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_tracked_memory_bytes", "Array memory charged to the streams, including that of the readers", "gauge");
+  GadgetronMetrics::write_sample(os, "gadgetron_tracked_memory_bytes", "kind=\"host\"", GadgetronMemoryTracker::instance().bytes(GadgetronMemoryAccount::HOST));
+  GadgetronMetrics::write_sample(os, "gadgetron_tracked_memory_bytes", "kind=\"device\"", GadgetronMemoryTracker::instance().bytes(GadgetronMemoryAccount::DEVICE));
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_wait_time_us", "Time messages waited in the queue of the gadget in micro-seconds", "histogram");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    write_gadget_histogram(os, "gadgetron_gadget_wait_time_us", g->first, g->second.wait_bins, g->second.wait_count, g->second.wait_total);
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_process_time_us", "Time spent in process() of the gadget in micro-seconds", "histogram");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    write_gadget_histogram(os, "gadgetron_gadget_process_time_us", g->first, g->second.process_bins, g->second.process_count, g->second.process_total);
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_frames_dropped_total", "Real-time frames skipped by the gadget to catch up with the acquisition", "counter");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    GadgetronMetrics::write_sample(os, "gadgetron_gadget_frames_dropped_total", "gadget=\"" + GadgetronMetrics::escape_label(g->first) + "\"", g->second.frames_dropped);
+  }
+
+  GadgetronMetrics::write_header(os, "gadgetron_gadget_deadline_misses_total", "Real-time frames put out by the gadget after their deadline", "counter");
+  for (g = gadgets.begin(); g != gadgets.end(); ++g) {
+    GadgetronMetrics::write_sample(os, "gadgetron_gadget_deadline_misses_total", "gadget=\"" + GadgetronMetrics::escape_label(g->first) + "\"", g->second.deadline_misses);
+  }
+}
+
+void GadgetStreamController::print_active_stream_statistics(std::ostream& os)
+{
+  std::lock_guard<std::mutex> guard(active_streams_mutex_);
+  os << "Active streams: " << active_streams_.size() << std::endl;
+  for (std::set<GadgetStreamController*>::iterator it = active_streams_.begin(); it != active_streams_.end(); ++it) {
+    os << "--Stream " << static_cast<void*>(*it) << std::endl;
+    (*it)->print_gadget_statistics(os);
+    if ((*it)->memory_account_) {
+      os << "Memory (MB):" << std::endl;
+      (*it)->memory_account_->print(os);
+    }
+  }
+}
+
 int GadgetStreamController::open (void)
 {
 
@@ -45,6 +264,8 @@ int GadgetStreamController::open (void)
   if (peer().get_remote_addr (peer_addr) == 0 &&
       peer_addr.addr_to_string (peer_name, MAXHOSTNAMELEN) == 0) {
     GINFO("Connection from %s\n", peer_name);
+  } else if (local_connection_) {
+    GINFO("Local connection\n");
   }
 
   //We have to have these basic types to be able to receive configuration file for stream
@@ -76,6 +297,10 @@ int GadgetStreamController::open (void)
 
   this->writer_task_.open();
 
+  if (event_loop_) {
+    return event_loop_->add(this);
+  }
+
   return this->activate( THR_NEW_LWP | THR_JOINABLE, 1);
 
 }
@@ -83,77 +308,408 @@ int GadgetStreamController::open (void)
 int GadgetStreamController::svc(void)
 {
   while (true) {
-    GadgetMessageIdentifier id;
-    ssize_t recv_cnt = 0;
-    if ((recv_cnt = peer().recv_n (&id, sizeof(GadgetMessageIdentifier))) <= 0) {
-      GERROR("GadgetStreamController, unable to read message identifier\n");
+    int r = this->receive_message();
+    if (r == RECEIVE_FAILED) {
       return -1;
     }
-
-    if (id.id == GADGET_MESSAGE_CLOSE) {
-      stream_.close(1); //Shutdown gadgets and wait for them
-      GDEBUG("Stream closed\n");
-      GDEBUG("Closing writer task\n");
-      this->writer_task_.close(1);
-      GDEBUG("Writer task closed\n");
-      continue;
+    if (r == RECEIVE_CLOSE) {
+      this->close_stream();
     }
+  }
+  return GADGET_OK;
+}
 
-    GadgetMessageReader* r = readers_.find(id.id);
+void GadgetStreamController::close_stream()
+{
+  if (stream_configured_) {
+    std::stringstream ss;
+    print_gadget_statistics(ss);
+    GDEBUG("Gadget statistics:\n%s", ss.str().c_str());
+  }
+  unregister_active_stream(); //The gadgets are about to be removed from the stream
+  stream_.close(1); //Shutdown gadgets and wait for them
+  GDEBUG("Stream closed\n");
+  GDEBUG("Closing writer task\n");
+  this->writer_task_.close(1);
+  GDEBUG("Writer task closed\n");
+  this->write_trace();
+  this->write_profile();
+}
 
-    if (!r) {
-      GERROR("Unrecognized Message ID received: %d\n", id.id);
-      return GADGET_FAIL;
-    }
+void GadgetStreamController::write_trace()
+{
+  if (!trace_) return;
 
-    ACE_Message_Block* mb = r->read(&peer());
+  static std::atomic<unsigned long> trace_count(0);
+  long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
-    if (!mb) {
-      GERROR("GadgetMessageReader returned null pointer\n");
-      return GADGET_FAIL;
-    }
+  std::stringstream filename;
+  filename << trace_directory_ << "/gadgetron_trace_" << ms << "_" << trace_count++ << ".json";
 
-    //We need to handle some special cases to make sure that we can get a stream set up.
-    if (id.id == GADGET_MESSAGE_CONFIG_FILE) {
-      GadgetContainerMessage<GadgetMessageConfigurationFile>* cfgm =
-	AsContainerMessage<GadgetMessageConfigurationFile>(mb);
+  if (trace_->write(filename.str())) {
+    GINFO("Stream trace with %d events written to %s\n", trace_->number_of_events(), filename.str().c_str());
+  } else {
+    GERROR("Failed to write stream trace to %s\n", filename.str().c_str());
+  }
+  trace_.reset();
+}
 
-      if (!cfgm) {
-	GERROR("Failed to cast message block to configuration file\n");
-	mb->release();
-	return GADGET_FAIL;
-      } else {
-	if (this->configure_from_file(std::string(cfgm->getObjectPtr()->configuration_file)) != GADGET_OK) {
-	  GERROR("GadgetStream configuration failed\n");
-	  mb->release();
-	  return GADGET_FAIL;
-	} else {
-	  mb->release();
-	  continue;
-	}
-      }
-    } else if (id.id == GADGET_MESSAGE_CONFIG_SCRIPT) {
-      std::string xml_config(mb->rd_ptr(), mb->length());
-      if (this->configure(xml_config) != GADGET_OK) {
-	GERROR("GadgetStream configuration failed\n");
-	mb->release();
-	return GADGET_FAIL;
-      } else {
-	mb->release();
-	continue;
-      }
-    }
+bool GadgetStreamController::profiling_enabled()
+{
+  static const bool enabled = []() {
+    const char* s = ACE_OS::getenv("GADGETRON_PROFILE");
+    return s != 0 && std::string(s) != "0";
+  }();
+  return enabled;
+}
+
+bool GadgetStreamController::memory_accounting_enabled()
+{
+  static const bool enabled = []() {
+    const char* s = ACE_OS::getenv("GADGETRON_MEMORY_ACCOUNTING");
+    return s == 0 || std::string(s) != "0";
+  }();
+  return enabled;
+}
+
+size_t GadgetStreamController::memory_limit()
+{
+  static const size_t limit = []() {
+    const char* s = ACE_OS::getenv("GADGETRON_MEMORY_LIMIT_MB");
+    return (s != 0 && std::atol(s) > 0) ? size_t(std::atol(s)) << 20 : size_t(0);
+  }();
+  return limit;
+}
+
+bool GadgetStreamController::admit_connection()
+{
+  size_t limit = memory_limit();
+  if (limit == 0) return true;
+
+  size_t in_use = GadgetronMemoryTracker::instance().bytes(GadgetronMemoryAccount::HOST);
+  if (in_use < limit) return true;
+
+  GWARN("Refusing connection, the active streams hold %d MB of array memory (limit %d MB)\n",
+        (int)(in_use >> 20), (int)(limit >> 20));
+  return false;
+}
+
+void GadgetStreamController::write_profile()
+{
+  if (!profile_) return;
+
+  if (profile_->number_of_zones() > 0) {
+    std::stringstream ss;
+    profile_->print(ss);
+    GINFO("Stream profile (ms):\n%s", ss.str().c_str());
+  }
+  profile_.reset();
+}
+
+int GadgetStreamController::attach_shared_memory()
+{
+  GadgetMessageSharedMemoryAttach attach;
+  if (peer().recv_n(&attach, sizeof(GadgetMessageSharedMemoryAttach)) <= 0) {
+    GERROR("GadgetStreamController, unable to read shared memory attach message\n");
+    return GADGET_FAIL;
+  }
+
+  if (!memchr(attach.name, '\0', sizeof(attach.name))) {
+    GERROR("GadgetStreamController, shared memory attach message with unterminated name\n");
+    return GADGET_FAIL;
+  }
+
+  if (!local_connection_) {
+    GERROR("GadgetStreamController, shared memory is only available on local connections\n");
+    return GADGET_FAIL;
+  }
+
+  std::shared_ptr<GadgetSharedMemoryRing> ring = GadgetSharedMemoryRing::attach(std::string(attach.name));
+  if (!ring) {
+    GERROR("GadgetStreamController, failed to attach shared memory %s\n", attach.name);
+    return GADGET_FAIL;
+  }
+
+  //The readers find the ring through the socket they are reading from
+  GadgetSharedMemoryRing::register_ring(peer().get_handle(), ring);
+  shm_attached_ = true;
+
+  GINFO("Attached shared memory ring %s, %d MB\n", attach.name, (int)(ring->capacity()/(1024*1024)));
+  return GADGET_OK;
+}
+
+int GadgetStreamController::set_attribute_encoding()
+{
+  GadgetMessageAttributeEncoding request;
+  if (peer().recv_n(&request, sizeof(GadgetMessageAttributeEncoding)) <= 0) {
+    GERROR("GadgetStreamController, unable to read attribute encoding message\n");
+    return GADGET_FAIL;
+  }
+
+  //The client detects the encoding of every image, an unknown request is not fatal
+  if (!GadgetAttributeEncoding::is_supported(request.encoding)) {
+    GWARN("GadgetStreamController, unsupported attribute encoding %d requested, sending XML\n", (int)request.encoding);
+    return GADGET_OK;
+  }
+
+  //The image writers find the encoding through the socket they are writing to
+  GadgetAttributeEncoding::register_encoding(peer().get_handle(), request.encoding);
+  GDEBUG("Image attributes are sent with encoding %d\n", (int)request.encoding);
+  return GADGET_OK;
+}
+
+int GadgetStreamController::set_image_compression()
+{
+  GadgetMessageImageCompression request;
+  if (peer().recv_n(&request, sizeof(GadgetMessageImageCompression)) <= 0) {
+    GERROR("GadgetStreamController, unable to read image compression message\n");
+    return GADGET_FAIL;
+  }
+
+  //The image writer sends uncompressed images for modes it cannot do, the client accepts both
+  GadgetImageCompression::register_compression(peer().get_handle(), request);
+  GDEBUG("Images are sent with compression mode %d, tolerance %f\n", (int)request.mode, request.tolerance);
+  return GADGET_OK;
+}
+
+int GadgetStreamController::set_stream_priority()
+{
+  GadgetMessageStreamPriority request;
+  if (peer().recv_n(&request, sizeof(GadgetMessageStreamPriority)) <= 0) {
+    GERROR("GadgetStreamController, unable to read stream priority message\n");
+    return GADGET_FAIL;
+  }
+
+  if (request.priority != GADGET_STREAM_PRIORITY_REALTIME && request.priority != GADGET_STREAM_PRIORITY_BATCH) {
+    GWARN("GadgetStreamController, unknown stream priority %d requested, the configuration decides\n", (int)request.priority);
+    return GADGET_OK;
+  }
+
+  priority_ = (int)request.priority;
+  GDEBUG("Stream priority %s requested\n", (priority_ == GADGET_STREAM_PRIORITY_BATCH) ? "batch" : "realtime");
+  return GADGET_OK;
+}
+
+int GadgetStreamController::receive_file_ingest()
+{
+  GadgetMessageFileIngest request;
+  if (peer().recv_n(&request, sizeof(GadgetMessageFileIngest)) <= 0) {
+    GERROR("GadgetStreamController, unable to read file ingest message\n");
+    return GADGET_FAIL;
+  }
+
+  if (!GadgetFileIngest::enabled()) {
+    GERROR("GadgetStreamController, file ingest is not enabled on this server (fileIngest in gadgetron.xml)\n");
+    return GADGET_FAIL;
+  }
+
+  if (!memchr(request.filename, '\0', sizeof(request.filename)) || !memchr(request.group, '\0', sizeof(request.group))) {
+    GERROR("GadgetStreamController, file ingest message with unterminated file or group name\n");
+    return GADGET_FAIL;
+  }
+
+  //The header of the file configures the gadgets, the stream has to be there
+  if (!stream_configured_) {
+    GERROR("GadgetStreamController, file ingest requested before the stream is configured\n");
+    return GADGET_FAIL;
+  }
+
+  std::string filename = GadgetFileIngest::resolve(std::string(request.filename));
+  if (filename.empty()) {
+    GERROR("GadgetStreamController, file ingest of %s refused, not a file below the ingest root\n", request.filename);
+    return GADGET_FAIL;
+  }
+
+  ingest_.reset(new GadgetFileIngest(filename, std::string(request.group), request.chunk_acquisitions));
+  return GADGET_OK;
+}
+
+int GadgetStreamController::ingest_received()
+{
+  std::unique_ptr<GadgetFileIngest> ingest;
+  ingest.swap(ingest_);
+  if (!ingest) return GADGET_FAIL;
+
+  if (!ingest->start(memory_account_, thread_budget_ ? thread_budget_->node() : -1)) {
+    return GADGET_FAIL;
+  }
+
+  //The header goes first as if the client had sent it
+  const std::string& xml = ingest->header();
+  ACE_Message_Block* header = new ACE_Message_Block(xml.size()+1);
+  memcpy(header->wr_ptr(), xml.c_str(), xml.size()+1);
+  header->wr_ptr(xml.size()+1);
+  header->set_flags(Gadget::GADGET_MESSAGE_CONFIG);
+
+  this->set_ismrmrd_header(header->rd_ptr(), header->length());
+  if (this->put_messages(header) != GADGET_OK) return GADGET_FAIL;
+
+  size_t chunks = 0;
+  while (ACE_Message_Block* chunk = ingest->next_chunk()) {
+    GadgetronTraceScope trace_scope(trace_.get(), "ingest", "controller", (int)chunks++);
+    if (this->put_messages(chunk) != GADGET_OK) return GADGET_FAIL;
+  }
+
+  if (ingest->failed()) {
+    GERROR("GadgetStreamController, reading the file for the stream failed\n");
+    return GADGET_FAIL;
+  }
+
+  GDEBUG("All %d acquisitions of the file are on the stream\n", (int)ingest->number_of_acquisitions());
+  return GADGET_OK;
+}
+
+int GadgetStreamController::put_messages(ACE_Message_Block* mb)
+{
+  while (mb) {
+    ACE_Message_Block* next_mb = mb->next();
+    mb->next(0);
 
-    ACE_Time_Value wait = ACE_OS::gettimeofday() + ACE_Time_Value(0,10000); //10ms from now
     if (stream_.put(mb) == -1) {
       GERROR("Failed to put stuff on stream, too long wait, %d\n",  ACE_OS::last_error () ==  EWOULDBLOCK);
       mb->release();
+      while (next_mb) {
+	mb = next_mb;
+	next_mb = mb->next();
+	mb->next(0);
+	mb->release();
+      }
       return GADGET_FAIL;
     }
+    mb = next_mb;
   }
+
   return GADGET_OK;
 }
 
+bool GadgetStreamController::is_batch(const GadgetronXML::GadgetStreamConfiguration& cfg) const
+{
+  if (priority_ >= 0) return priority_ == GADGET_STREAM_PRIORITY_BATCH;
+  if (cfg.priority) return *cfg.priority == "batch";
+  return GadgetConnectionScheduler::instance()->default_batch();
+}
+
+int GadgetStreamController::configure_received()
+{
+  std::string config;
+  config.swap(received_config_);
+
+  int res = received_config_is_file_ ? this->configure_from_file(config) : this->configure(config);
+  if (res != GADGET_OK) {
+    GERROR("GadgetStream configuration failed\n");
+  }
+  return res;
+}
+
+int GadgetStreamController::receive_message()
+{
+  GadgetMessageIdentifier id;
+  ssize_t recv_cnt = 0;
+  if ((recv_cnt = peer().recv_n (&id, sizeof(GadgetMessageIdentifier))) <= 0) {
+    GERROR("GadgetStreamController, unable to read message identifier\n");
+    return RECEIVE_FAILED;
+  }
+
+  if (id.id == GADGET_MESSAGE_CLOSE) {
+    return RECEIVE_CLOSE;
+  }
+
+  if (id.id == GADGET_MESSAGE_SHM_ATTACH) {
+    return (this->attach_shared_memory() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  if (id.id == GADGET_MESSAGE_ATTRIBUTE_ENCODING) {
+    return (this->set_attribute_encoding() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  if (id.id == GADGET_MESSAGE_IMAGE_COMPRESSION) {
+    return (this->set_image_compression() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  if (id.id == GADGET_MESSAGE_STREAM_PRIORITY) {
+    return (this->set_stream_priority() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  if (id.id == GADGET_MESSAGE_FILE_INGEST) {
+    if (this->receive_file_ingest() != GADGET_OK) return RECEIVE_FAILED;
+    if (event_loop_) return RECEIVE_INGEST;
+    return (this->ingest_received() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  GadgetMessageReader* r = readers_.find(id.id);
+
+  if (!r) {
+    GERROR("Unrecognized Message ID received: %d\n", id.id);
+    return RECEIVE_FAILED;
+  }
+
+  //Reading and enqueuing, time spent here beyond the socket transfer is backpressure from the stream
+  GadgetronTraceScope trace_scope(trace_.get(), "receive", "controller", id.id);
+  GadgetronMemoryAccountScope memory_scope(memory_account_.get());
+
+  //The arrays read from the socket are placed on the NUMA node of the gadgets, the reader thread stays where it is
+  GadgetronNumaScope numa_scope(thread_budget_ ? thread_budget_->node() : -1, false);
+
+  ACE_Message_Block* mb = r->read(&peer());
+
+  if (!mb) {
+    GERROR("GadgetMessageReader returned null pointer\n");
+    return RECEIVE_FAILED;
+  }
+
+  //The header is parsed once here instead of in every gadget, it is still passed on as XML
+  if (id.id == GADGET_MESSAGE_PARAMETER_SCRIPT) {
+    this->set_ismrmrd_header(mb->rd_ptr(), mb->length());
+  }
+
+  //We need to handle some special cases to make sure that we can get a stream set up.
+  if (id.id == GADGET_MESSAGE_CONFIG_FILE) {
+    GadgetContainerMessage<GadgetMessageConfigurationFile>* cfgm =
+      AsContainerMessage<GadgetMessageConfigurationFile>(mb);
+
+    if (!cfgm) {
+      GERROR("Failed to cast message block to configuration file\n");
+      mb->release();
+      return RECEIVE_FAILED;
+    }
+
+    received_config_ = std::string(cfgm->getObjectPtr()->configuration_file);
+    received_config_is_file_ = true;
+    mb->release();
+  } else if (id.id == GADGET_MESSAGE_CONFIG_SCRIPT) {
+    received_config_ = std::string(mb->rd_ptr(), mb->length());
+    received_config_is_file_ = false;
+    mb->release();
+  }
+
+  if (id.id == GADGET_MESSAGE_CONFIG_FILE || id.id == GADGET_MESSAGE_CONFIG_SCRIPT) {
+    if (event_loop_) return RECEIVE_CONFIGURE;
+    return (this->configure_received() == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+  }
+
+  //Readers may return several messages linked with next() (e.g. batched acquisitions)
+  return (this->put_messages(mb) == GADGET_OK) ? RECEIVE_OK : RECEIVE_FAILED;
+}
+
+void GadgetStreamController::set_ismrmrd_header(const char* xml, size_t length)
+{
+  std::string xml_string(xml, strnlen(xml, length));
+
+  boost::shared_ptr<ISMRMRD::IsmrmrdHeader> header(new ISMRMRD::IsmrmrdHeader());
+  try {
+    ISMRMRD::deserialize(xml_string.c_str(), *header);
+  } catch (std::runtime_error& err) {
+    //The gadgets parse the message themselves and report the error
+    GDEBUG("Parameter script is not a valid ISMRMRD header: %s\n", err.what());
+    header.reset();
+    xml_string.clear();
+  }
+
+  std::lock_guard<std::mutex> guard(ismrmrd_header_mutex_);
+  ismrmrd_xml_.swap(xml_string);
+  ismrmrd_header_ = header;
+}
+
 int GadgetStreamController::handle_input (ACE_HANDLE)
 {
   return 0;
@@ -176,8 +732,22 @@ int GadgetStreamController::handle_close (ACE_HANDLE, ACE_Reactor_Mask mask)
     return 0;
 
   GINFO("Shutting down stream and closing up shop...\n");
-  
+
+  unregister_active_stream();
   this->stream_.close();
+  this->write_trace();
+  this->write_profile();
+
+  //The writer thread may still be waiting for output, it has to be gone before its queue is deleted
+  output_queue_->deactivate();
+  writer_task_.wait();
+
+  if (shm_attached_) {
+    GadgetSharedMemoryRing::unregister_ring(peer().get_handle());
+    shm_attached_ = false;
+  }
+  GadgetAttributeEncoding::unregister_encoding(peer().get_handle());
+  GadgetImageCompression::unregister_compression(peer().get_handle());
 
   //Empty output queue in case there is something on it.
   int messages_dropped = this->msg_queue ()->flush();
@@ -229,7 +799,7 @@ int GadgetStreamController::configure_from_file(std::string config_xml_filename)
     file.close();
     std::string xml_file_contents(buffer,size);
     
-    return configure(xml_file_contents);
+    return configure(xml_file_contents, config_xml_filename);
     delete[] buffer;
     
   } else {
@@ -240,18 +810,67 @@ int GadgetStreamController::configure_from_file(std::string config_xml_filename)
   return GADGET_OK;
 }
 
-int GadgetStreamController::configure(std::string config_xml_string)
+int GadgetStreamController::configure(std::string config_xml_string, std::string config_name)
 {
 
   //Store a copy
   config_xml_ = config_xml_string;
+
+  if (!trace_directory_.empty() && !trace_) {
+    trace_.reset(new GadgetronTrace());
+  }
+  GadgetronTraceScope trace_scope(trace_.get(), "configure", "controller");
+
+  if (profiling_enabled() && !profile_) {
+    profile_.reset(new GadgetronProfile());
+  }
+
+  if (memory_accounting_enabled() && !memory_account_) {
+    memory_account_ = GadgetronMemoryAccount::create(config_name.empty() ? std::string("stream") : config_name);
+  }
+
+  //The cores are shared by the running streams, see GadgetronThreadBudget
+  if (!thread_budget_) {
+    thread_budget_.reset(new GadgetronThreadBudget::Stream());
+  }
+
+  //Batch streams wait here until they fit, see GadgetConnectionScheduler
+  if (!admission_) {
+    GadgetronXML::GadgetStreamConfiguration priority_cfg;
+    try {
+      deserialize(config_xml_string.c_str(), priority_cfg);
+    } catch (const std::runtime_error& e) {
+      GERROR("Failed to parse Gadget Stream Configuration: %s\n", e.what());
+      return GADGET_FAIL;
+    }
+
+    bool batch = this->is_batch(priority_cfg);
+    GINFO("Stream priority: %s\n", batch ? "batch" : "realtime");
+
+    admission_ = GadgetConnectionScheduler::instance()->admit(batch);
+    if (!admission_) {
+      GERROR("Stream was not admitted\n");
+      return GADGET_FAIL;
+    }
+    thread_budget_->set_batch(batch);
+  }
+
+  //Gadgets constructed ahead of time for this configuration, if available
+  std::string template_key = GadgetStreamTemplateCache::make_key(config_name, config_xml_string);
+  std::unique_ptr<GadgetStreamTemplateCache::StreamTemplate> stream_template =
+    GadgetStreamTemplateCache::instance()->take(template_key);
   
   GadgetronXML::GadgetStreamConfiguration cfg;
-  try {
-    deserialize(config_xml_string.c_str(), cfg);  
-  }  catch (const std::runtime_error& e) {
-    GERROR("Failed to parse Gadget Stream Configuration: %s\n", e.what());
-    return GADGET_FAIL;
+  if (stream_template) {
+    GINFO("Using pre-constructed gadgets for configuration %s\n", config_name.c_str());
+    cfg = stream_template->cfg;
+  } else {
+    try {
+      deserialize(config_xml_string.c_str(), cfg);  
+    }  catch (const std::runtime_error& e) {
+      GERROR("Failed to parse Gadget Stream Configuration: %s\n", e.what());
+      return GADGET_FAIL;
+    }
   }
 
   GINFO("Found %d readers\n", cfg.reader.size());
@@ -326,6 +945,11 @@ int GadgetStreamController::configure(std::string config_xml_string)
   //Let's configure the stream
   GDEBUG("Processing %d gadgets in reverse order\n",cfg.gadget.size());
 
+  bool use_worker_pool = (cfg.scheduler && *cfg.scheduler == "pool");
+  if (use_worker_pool) {
+    GINFO("Gadgets are scheduled on the shared worker pool\n");
+  }
+
   for (std::vector<GadgetronXML::Gadget>::reverse_iterator i = cfg.gadget.rbegin();
        i != cfg.gadget.rend();
        ++i) 
@@ -343,38 +967,103 @@ int GadgetStreamController::configure(std::string config_xml_string)
       GINFO("  Gadget dll: %s\n", dllname.c_str());
       GINFO("  Gadget class: %s\n", classname.c_str());
 
-      GadgetModule* m = create_gadget_module(dllname.c_str(),
-					     classname.c_str(),
-					     gadgetname.c_str());
-      
-      if (!m) {
-	GERROR("Failed to create GadgetModule from %s:%s\n",
-	       classname.c_str(),
-	       dllname.c_str());
-	return GADGET_FAIL;
+      size_t gadget_index = (cfg.gadget.rend() - i) - 1;
+      unsigned int replicas = i->replicate ? *i->replicate : 1;
+      if (replicas > 1) {
+	GINFO("  Gadget replicas: %d\n", replicas);
       }
-      
-      Gadget* g = dynamic_cast<Gadget*>(m->writer());//Get the gadget out of the module
-      
-      GINFO("  Gadget parameters: %d\n", i->property.size());
-      for (std::vector<GadgetronXML::GadgetronParameter>::iterator p = i->property.begin();
-	   p != i->property.end();
-	   ++p)
-	{
-	  std::string pname(p->name);
-	  std::string pval(p->value);
-	  GINFO("Setting parameter %s = %s\n", pname.c_str(),pval.c_str());
-	  g->set_parameter(pname.c_str(),pval.c_str(),false);
+
+      std::vector<GadgetModule*> replica_modules;
+      for (unsigned int r = 0; r < replicas; r++) {
+	std::string modulename = gadgetname;
+	if (replicas > 1) {
+	  std::stringstream str;
+	  str << gadgetname << "_replica" << r;
+	  modulename = str.str();
 	}
-      
-      // set the global gadget parameters for every gadget
-      std::map<std::string, std::string>::const_iterator iter;
-      for ( iter=global_gadget_parameters_.begin(); iter!=global_gadget_parameters_.end(); iter++ )
-        {
-	  std::string key = iter->first;
-	  std::string value = iter->second;
-	  g->set_parameter(key.c_str(), value.c_str(), false);
-        }
+
+	GadgetModule* rm = 0;
+	Gadget* tg = stream_template ? stream_template->take(gadget_index, r) : 0;
+	if (tg) {
+	  tg->set_controller(this);
+	  ACE_NEW_NORETURN (rm, GadgetModule (modulename.c_str(), tg));
+	  if (!rm) delete tg;
+	} else {
+	  rm = create_gadget_module(dllname.c_str(),
+				    classname.c_str(),
+				    modulename.c_str());
+	}
+
+	if (!rm) {
+	  GERROR("Failed to create GadgetModule from %s:%s\n",
+		 classname.c_str(),
+		 dllname.c_str());
+	  for (size_t k = 0; k < replica_modules.size(); k++) delete replica_modules[k];
+	  return GADGET_FAIL;
+	}
+
+	Gadget* rg = dynamic_cast<Gadget*>(rm->writer());//Get the gadget out of the module
+
+	// defaults tuned for this node, the configuration overrides them
+	std::map<std::string, std::string> node_defaults = GadgetronNodeProfile::instance().gadget_properties(classname);
+	for (std::map<std::string, std::string>::const_iterator p = node_defaults.begin(); p != node_defaults.end(); ++p)
+	  {
+	    GadgetPropertyBase* prop = rg->find_property(p->first.c_str());
+	    if (!prop) {
+	      GWARN("Node profile sets unknown parameter %s of %s\n", p->first.c_str(), classname.c_str());
+	      continue;
+	    }
+	    GINFO("Setting parameter %s = %s (node profile)\n", p->first.c_str(), p->second.c_str());
+	    std::string previous(prop->string_value());
+	    try {
+	      rg->set_parameter(p->first.c_str(), p->second.c_str(), false);
+	    } catch (std::runtime_error& e) {
+	      GWARN("Node profile value %s of parameter %s ignored: %s\n", p->second.c_str(), p->first.c_str(), e.what());
+	      prop->string_value(previous.c_str());
+	    }
+	  }
+
+	GINFO("  Gadget parameters: %d\n", i->property.size());
+	for (std::vector<GadgetronXML::GadgetronParameter>::iterator p = i->property.begin();
+	     p != i->property.end();
+	     ++p)
+	  {
+	    std::string pname(p->name);
+	    std::string pval(p->value);
+	    GINFO("Setting parameter %s = %s\n", pname.c_str(),pval.c_str());
+	    rg->set_parameter(pname.c_str(),pval.c_str(),false);
+	  }
+
+	// set the global gadget parameters for every gadget
+	std::map<std::string, std::string>::const_iterator iter;
+	for ( iter=global_gadget_parameters_.begin(); iter!=global_gadget_parameters_.end(); iter++ )
+	  {
+	    std::string key = iter->first;
+	    std::string value = iter->second;
+	    rg->set_parameter(key.c_str(), value.c_str(), false);
+	  }
+
+	replica_modules.push_back(rm);
+      }
+
+      GadgetModule* m = replica_modules[0];
+      if (replicas > 1) {
+	//The replicas run behind a single module, which restores the order of their output
+	ReplicatedGadget* rg = new ReplicatedGadget(replica_modules);
+	rg->set_controller(this);
+	ACE_NEW_RETURN (m,
+			GadgetModule (gadgetname.c_str(), rg),
+			GADGET_FAIL);
+      }
+
+      Gadget* g = dynamic_cast<Gadget*>(m->writer());
+
+      //Must be decided before the module is pushed, push() opens the gadget
+      g->use_worker_pool(use_worker_pool);
+      g->set_trace(trace_.get());
+      g->set_profile(profile_.get());
+      if (memory_account_) g->set_memory_account(GadgetronMemoryAccount::create(gadgetname, memory_account_));
+      g->set_thread_budget(thread_budget_);
 
       if (stream_.push(m) < 0) {
 	GERROR("Failed to push Gadget %s onto stream\n", gadgetname.c_str());
@@ -387,6 +1076,12 @@ int GadgetStreamController::configure(std::string config_xml_string)
   GINFO("Gadget Stream configured\n");
   stream_configured_ = true;
 
+  //The stream is now complete and its gadgets can be inspected via the statistics interface
+  register_active_stream();
+
+  //Get the gadgets for the next connection with this configuration ready
+  GadgetStreamTemplateCache::instance()->prepare(template_key, cfg);
+
   return GADGET_OK;
 }
 
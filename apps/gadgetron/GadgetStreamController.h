@@ -10,19 +10,35 @@
 
 #include <complex>
 #include <vector>
+#include <set>
+#include <mutex>
+#include <ostream>
+#include <memory>
+#include <string>
 
 #include "gadgetbase_export.h"
 #include "GadgetronConnector.h"
 #include "GadgetStreamInterface.h"
+#include "GadgetronTrace.h"
+#include "GadgetronProfile.h"
+#include "GadgetronMemoryAccount.h"
+#include "GadgetronThreadBudget.h"
+#include "GadgetConnectionScheduler.h"
+#include "GadgetFileIngest.h"
 
 
 namespace Gadgetron{
 
+class GadgetServerEventLoop;
+
 class EXPORTGADGETBASE GadgetStreamController 
   : public ACE_Svc_Handler<ACE_SOCK_STREAM, ACE_MT_SYNCH>
   , public GadgetStreamInterface
 {
 public:
+  /// Gadgets passing on output block while this much image payload waits for a slow client
+  enum { OUTPUT_QUEUE_HIGH_WATER_MARK_MB = 512, OUTPUT_QUEUE_LOW_WATER_MARK_MB = 256 };
+
   GadgetStreamController();
 
   virtual ~GadgetStreamController();
@@ -37,12 +53,138 @@ public:
 
   virtual int output_ready(ACE_Message_Block* mb);
 
+  enum ReceiveResult { RECEIVE_FAILED = -1, RECEIVE_OK = 0, RECEIVE_CLOSE = 1, RECEIVE_CONFIGURE = 2, RECEIVE_INGEST = 3 };
+
+  /**
+     Reads one message from the socket and puts it on the stream. Blocks until the complete
+     message has been received. RECEIVE_CLOSE is returned for a close message, the caller
+     then shuts down the stream with close_stream().
+
+     With an event loop the configuration is not applied by the I/O thread, since a batch stream
+     may wait for admission: RECEIVE_CONFIGURE is returned and the caller runs configure_received().
+     Likewise a file to be read by the server is not read by the I/O thread, RECEIVE_INGEST is
+     returned and the caller runs ingest_received().
+   */
+  int receive_message();
+
+  /// Admits and configures the stream with the configuration received last, GADGET_OK on success
+  int configure_received();
+
+  /**
+     Puts the header and the acquisitions of the file named by the last GADGET_MESSAGE_FILE_INGEST
+     on the stream, read by a prefetch thread (see GadgetFileIngest.h). Returns once the last
+     acquisition is on the stream, GADGET_OK on success.
+   */
+  int ingest_received();
+
+  /// Shuts down the gadgets and the writer task after a close message, waits for them to finish
+  void close_stream();
+
+  /**
+     Connections with an event loop do not get a receiving thread of their own, open()
+     registers them with the loop instead. Must be set before open().
+   */
+  void set_event_loop(GadgetServerEventLoop* loop)
+  {
+    event_loop_ = loop;
+  }
+
+  /**
+     Records a timeline of the stream (every gadget, message and timed step) and writes it as
+     Chrome trace JSON to a file in this directory when the stream is closed. Empty disables tracing.
+   */
+  void set_trace_directory(const std::string& dir)
+  {
+    trace_directory_ = dir;
+  }
+
+  /**
+     Streams are profiled if the environment variable GADGETRON_PROFILE is set (and not 0): the
+     time of every gadget and of the profiling zones within is aggregated per zone and the table
+     is logged when the stream is closed.
+   */
+  static bool profiling_enabled();
+
+  /**
+     The arrays allocated by the readers and gadgets of a stream are charged to a memory account
+     of the stream, with one account per gadget below it. Disabled if the environment variable
+     GADGETRON_MEMORY_ACCOUNTING is 0.
+   */
+  static bool memory_accounting_enabled();
+
+  /**
+     New connections are refused while the tracked host array memory of all streams exceeds
+     this limit, set with GADGETRON_MEMORY_LIMIT_MB. 0 (the default) disables the check.
+   */
+  static size_t memory_limit();
+
+  /// False if a new connection would exceed the memory limit
+  static bool admit_connection();
+
+  /// Connections over a Unix domain socket may attach a shared memory ring for their payload
+  void set_local_connection(bool local)
+  {
+    local_connection_ = local;
+  }
+
+  /**
+     Writes the gadget statistics of all currently active stream controllers.
+     Used by the ReST interface to inspect running reconstructions.
+   */
+  static void print_active_stream_statistics(std::ostream& os);
+
+  /**
+     Writes the connection, traffic and gadget metrics of the server in the Prometheus text format.
+     Registered as a collector of the GadgetronMetrics, which are served at /metrics.
+   */
+  static void write_metrics(std::ostream& os);
+
 private:
   WriterTask writer_task_;
+  std::unique_ptr<GadgetPayloadMessageQueue> output_queue_;
   ACE_Reactor_Notification_Strategy notifier_;
   GadgetMessageReaderContainer readers_;
-  virtual int configure(std::string config_xml_string);
+  GadgetServerEventLoop* event_loop_;
+  std::string trace_directory_;
+  std::unique_ptr<GadgetronTrace> trace_;
+  std::unique_ptr<GadgetronProfile> profile_;
+  std::shared_ptr<GadgetronMemoryAccount> memory_account_;
+  std::shared_ptr<GadgetronThreadBudget::Stream> thread_budget_;
+  std::unique_ptr<GadgetConnectionScheduler::Admission> admission_;
+  int priority_; //From the client, -1 if it did not send one
+  bool local_connection_;
+  bool shm_attached_;
+  std::string received_config_;
+  bool received_config_is_file_;
+  std::unique_ptr<GadgetFileIngest> ingest_;
+  virtual int configure(std::string config_xml_string, std::string config_name = std::string(""));
   virtual int configure_from_file(std::string config_xml_filename);
+
+  void write_trace();
+  void write_profile();
+  int attach_shared_memory();
+  int set_attribute_encoding();
+  int set_image_compression();
+  int set_stream_priority();
+  int receive_file_ingest();
+
+  /// Puts messages linked with next() on the stream one at a time, on failure the rest are released
+  int put_messages(ACE_Message_Block* mb);
+
+  /// Whether the stream is a batch stream, the client overrides the configuration, which overrides the default
+  bool is_batch(const GadgetronXML::GadgetStreamConfiguration& cfg) const;
+
+  /// Parses the ISMRMRD header of the stream for the gadgets, see get_ismrmrd_header()
+  void set_ismrmrd_header(const char* xml, size_t length);
+
+  void register_active_stream();
+  void unregister_active_stream();
+
+  /// Adds the byte counts and gadget statistics of the stream to those of the finished streams, active_streams_mutex_ must be held
+  void add_to_finished_metrics();
+
+  static std::mutex active_streams_mutex_;
+  static std::set<GadgetStreamController*> active_streams_;
 };
 
 }
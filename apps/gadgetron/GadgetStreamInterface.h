@@ -5,6 +5,10 @@
 #include "ace/DLL.h"
 #include "ace/DLL_Manager.h"
 
+#include <ostream>
+#include <mutex>
+#include <cstring>
+
 #include "gadgetron_paths.h"
 #include "Gadget.h"
 
@@ -50,6 +54,37 @@ namespace Gadgetron {
     {
       return config_xml_;
     }
+
+    /**
+       The ISMRMRD header of the stream if it was parsed from the given XML, null otherwise.
+       The header is parsed once when the parameter script arrives and shared by all gadgets,
+       see Gadget::get_ismrmrd_header().
+     */
+    boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> get_ismrmrd_header(const char* xml, size_t length)
+    {
+      std::lock_guard<std::mutex> guard(ismrmrd_header_mutex_);
+      if (ismrmrd_header_ && ismrmrd_xml_.size() == length && std::memcmp(ismrmrd_xml_.data(), xml, length) == 0) {
+        return ismrmrd_header_;
+      }
+      return boost::shared_ptr<const ISMRMRD::IsmrmrdHeader>();
+    }
+
+    /**
+       Writes the instrumentation (queue depth, queue wait time and process time) of every gadget in the stream.
+       Safe to call while the stream is running.
+     */
+    virtual void print_gadget_statistics(std::ostream& os)
+    {
+      ACE_Stream_Iterator<ACE_MT_SYNCH> it(stream_);
+      const GadgetModule* m = 0;
+      while (it.next(m)) {
+	Gadget* g = dynamic_cast<Gadget*>(const_cast<GadgetModule*>(m)->writer());
+	if (g) {
+	  g->get_statistics().print(os, m->name());
+	}
+	it.advance();
+      }
+    }
     
     template <class T>  T* load_dll_component(const char* DLL, const char* component_name)
     {
@@ -109,6 +144,9 @@ namespace Gadgetron {
     std::map<std::string, std::string> global_gadget_parameters_;
     std::string gadgetron_home_;
     std::string config_xml_; //Copy of the original XML configuration
+    std::string ismrmrd_xml_;
+    boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> ismrmrd_header_;
+    std::mutex ismrmrd_header_mutex_;
 
     virtual GadgetModule * create_gadget_module(const char* DLL, const char* gadget, const char* gadget_module_name)
     {
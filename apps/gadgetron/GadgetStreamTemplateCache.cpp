@@ -0,0 +1,217 @@
+#include "GadgetStreamTemplateCache.h"
+#include "GadgetWorkerPool.h"
+#include "Gadget.h"
+#include "log.h"
+
+#include <ace/OS_NS_stdio.h>
+
+#include <functional>
+#include <sstream>
+#include <algorithm>
+#include <exception>
+
+namespace Gadgetron
+{
+  GadgetStreamTemplateCache::StreamTemplate::~StreamTemplate()
+  {
+    for (size_t i = 0; i < gadgets.size(); i++) {
+      for (size_t r = 0; r < gadgets[i].size(); r++) {
+        delete gadgets[i][r];
+      }
+    }
+  }
+
+  Gadget* GadgetStreamTemplateCache::StreamTemplate::take(size_t gadget, size_t replica)
+  {
+    if (gadget >= gadgets.size() || replica >= gadgets[gadget].size()) return 0;
+    Gadget* g = gadgets[gadget][replica];
+    gadgets[gadget][replica] = 0;
+    return g;
+  }
+
+  GadgetStreamTemplateCache* GadgetStreamTemplateCache::instance()
+  {
+    //Never destroyed, the pinned libraries stay loaded until the process ends
+    static GadgetStreamTemplateCache* cache = new GadgetStreamTemplateCache();
+    return cache;
+  }
+
+  GadgetStreamTemplateCache::GadgetStreamTemplateCache()
+    : enabled_(true)
+  {
+  }
+
+  std::string GadgetStreamTemplateCache::make_key(const std::string& name, const std::string& xml)
+  {
+    std::stringstream str;
+    str << name << "#" << std::hex << std::hash<std::string>()(xml) << "#" << xml.size();
+    return str.str();
+  }
+
+  void GadgetStreamTemplateCache::enable(bool e)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    enabled_ = e;
+    if (!enabled_) {
+      templates_.clear();
+      lru_.clear();
+    }
+  }
+
+  bool GadgetStreamTemplateCache::enabled()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return enabled_;
+  }
+
+  std::unique_ptr<GadgetStreamTemplateCache::StreamTemplate> GadgetStreamTemplateCache::take(const std::string& key)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::map<std::string, std::unique_ptr<StreamTemplate> >::iterator it = templates_.find(key);
+    if (it == templates_.end()) {
+      return std::unique_ptr<StreamTemplate>();
+    }
+
+    std::unique_ptr<StreamTemplate> t(std::move(it->second));
+    templates_.erase(it);
+    return t;
+  }
+
+  void GadgetStreamTemplateCache::prepare(const std::string& key, const GadgetronXML::GadgetStreamConfiguration& cfg)
+  {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!enabled_ || templates_.count(key) || building_[key]) return;
+      building_[key] = true;
+    }
+
+    GadgetWorkerPool::instance()->submit([this, key, cfg]() { this->build(key, cfg); });
+  }
+
+  bool GadgetStreamTemplateCache::prepare_now(const std::string& key, const GadgetronXML::GadgetStreamConfiguration& cfg)
+  {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!enabled_) return false;
+      if (templates_.count(key)) return true;
+      if (building_[key]) return true; //Built in the background already
+      building_[key] = true;
+    }
+
+    this->build(key, cfg);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    return templates_.count(key) > 0;
+  }
+
+  bool GadgetStreamTemplateCache::load_library(const std::string& dll)
+  {
+    std::lock_guard<std::mutex> guard(factory_mutex_);
+    return this->open_library(dll) != 0;
+  }
+
+  void GadgetStreamTemplateCache::build(const std::string& key, GadgetronXML::GadgetStreamConfiguration cfg)
+  {
+    std::unique_ptr<StreamTemplate> t(new StreamTemplate());
+    t->gadgets.resize(cfg.gadget.size());
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < cfg.gadget.size(); i++) {
+      GadgetCreator cc = this->find_factory(cfg.gadget[i].dll, cfg.gadget[i].classname);
+      if (!cc) {
+        ok = false;
+        break;
+      }
+
+      unsigned int replicas = cfg.gadget[i].replicate ? *cfg.gadget[i].replicate : 1;
+      for (unsigned int r = 0; r < replicas; r++) {
+        Gadget* g = 0;
+        try { g = cc(); }
+        catch (std::exception& e) {
+          GERROR("GadgetStreamTemplateCache, constructing %s failed: %s\n", cfg.gadget[i].classname.c_str(), e.what());
+        }
+        if (!g) {
+          ok = false;
+          break;
+        }
+        t->gadgets[i].push_back(g);
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    building_.erase(key);
+
+    if (!ok || !enabled_) {
+      return; //The template deletes whatever has been constructed
+    }
+
+    t->cfg = cfg;
+    templates_[key] = std::move(t);
+
+    lru_.remove(key);
+    lru_.push_back(key);
+    while (lru_.size() > MAX_CONFIGURATIONS) {
+      templates_.erase(lru_.front());
+      lru_.pop_front();
+    }
+
+    GDEBUG("GadgetStreamTemplateCache, idle stream ready for %s\n", key.substr(0, key.find('#')).c_str());
+  }
+
+  GadgetStreamTemplateCache::GadgetCreator GadgetStreamTemplateCache::find_factory(const std::string& dll, const std::string& classname)
+  {
+    std::lock_guard<std::mutex> guard(factory_mutex_);
+
+    std::string fkey = dll + ":" + classname;
+    std::map<std::string, GadgetCreator>::iterator it = factories_.find(fkey);
+    if (it != factories_.end()) {
+      return it->second;
+    }
+
+    ACE_DLL_Handle* handle = this->open_library(dll);
+    if (!handle) {
+      return 0;
+    }
+
+    ACE_TCHAR factoryname[1024];
+    ACE_OS::sprintf(factoryname, "make_%s", classname.c_str());
+
+    void *void_ptr = handle->symbol(factoryname);
+    ptrdiff_t tmp = reinterpret_cast<ptrdiff_t> (void_ptr);
+    GadgetCreator cc = reinterpret_cast<GadgetCreator> (tmp);
+
+    if (!cc) {
+      GERROR("GadgetStreamTemplateCache, failed to load factory (%s) from DLL (%s)\n", factoryname, dll.c_str());
+      return 0;
+    }
+
+    factories_[fkey] = cc;
+    return cc;
+  }
+
+  ACE_DLL_Handle* GadgetStreamTemplateCache::open_library(const std::string& dll)
+  {
+    std::map<std::string, ACE_DLL_Handle*>::iterator it = pinned_dlls_.find(dll);
+    if (it != pinned_dlls_.end()) {
+      return it->second;
+    }
+
+    ACE_TCHAR dllname[1024];
+#if defined(WIN32) && defined(_DEBUG)
+    ACE_OS::sprintf(dllname, "%s%sd",ACE_DLL_PREFIX, dll.c_str());
+#else
+    ACE_OS::sprintf(dllname, "%s%s",ACE_DLL_PREFIX, dll.c_str());
+#endif
+
+    //The handle is never closed, which keeps the library loaded between connections
+    ACE_SHLIB_HANDLE dll_handle = 0;
+    ACE_DLL_Handle* handle = ACE_DLL_Manager::instance()->open_dll(dllname, ACE_DEFAULT_SHLIB_MODE, dll_handle);
+    if (!handle) {
+      GERROR("GadgetStreamTemplateCache, failed to load DLL %s\n", dllname);
+      return 0;
+    }
+
+    pinned_dlls_[dll] = handle;
+    return handle;
+  }
+}
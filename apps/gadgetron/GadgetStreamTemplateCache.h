@@ -0,0 +1,95 @@
+/** \file   GadgetStreamTemplateCache.h
+    \brief  Process wide cache of pre-constructed, idle gadget streams.
+
+            When a stream has been configured, the cache builds a spare set of gadgets for the same
+            configuration in the background (on the GadgetWorkerPool): the gadget libraries are loaded
+            and pinned and every gadget is constructed. The next connection with the same configuration
+            takes this template instead of constructing its gadgets, only parameters, the controller
+            and process_config remain to be done per connection.
+
+            Templates are keyed by the configuration name and a hash of the XML, so a changed
+            configuration file never picks up a stale template.
+*/
+
+#ifndef GADGETSTREAMTEMPLATECACHE_H
+#define GADGETSTREAMTEMPLATECACHE_H
+#pragma once
+
+#include "gadgetbase_export.h"
+#include "gadgetron_xml.h"
+
+#include <ace/DLL_Manager.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+
+namespace Gadgetron{
+
+  class Gadget;
+
+  class EXPORTGADGETBASE GadgetStreamTemplateCache
+  {
+  public:
+
+    enum { MAX_CONFIGURATIONS = 16 };
+
+    /**
+       Gadgets of one stream, gadgets[i] holds one instance per replica of cfg.gadget[i]
+     */
+    struct StreamTemplate
+    {
+      ~StreamTemplate();
+
+      GadgetronXML::GadgetStreamConfiguration cfg;
+      std::vector< std::vector<Gadget*> > gadgets;
+
+      /// Removes a gadget from the template, the caller takes ownership. Returns 0 if not available.
+      Gadget* take(size_t gadget, size_t replica);
+    };
+
+    static GadgetStreamTemplateCache* instance();
+
+    static std::string make_key(const std::string& name, const std::string& xml);
+
+    /// Idle template for the key, 0 if there is none. The caller takes ownership.
+    std::unique_ptr<StreamTemplate> take(const std::string& key);
+
+    /// Builds an idle template for the configuration in the background, unless one is already available
+    void prepare(const std::string& key, const GadgetronXML::GadgetStreamConfiguration& cfg);
+
+    /// Builds an idle template for the configuration on the calling thread, returns false if it could not be built
+    bool prepare_now(const std::string& key, const GadgetronXML::GadgetStreamConfiguration& cfg);
+
+    /// Loads and pins a gadget library, returns false if it could not be loaded
+    bool load_library(const std::string& dll);
+
+    /// Enables or disables the cache, idle templates are dropped when it is disabled
+    void enable(bool e);
+    bool enabled();
+
+  protected:
+    typedef Gadget* (*GadgetCreator)(void);
+
+    GadgetStreamTemplateCache();
+
+    void build(const std::string& key, GadgetronXML::GadgetStreamConfiguration cfg);
+    GadgetCreator find_factory(const std::string& dll, const std::string& classname);
+    ACE_DLL_Handle* open_library(const std::string& dll); //called with factory_mutex_ held
+
+    std::mutex mutex_;
+    bool enabled_;
+    std::map<std::string, std::unique_ptr<StreamTemplate> > templates_;
+    std::map<std::string, bool> building_;
+    std::list<std::string> lru_;
+
+    std::mutex factory_mutex_;
+    std::map<std::string, GadgetCreator> factories_;
+    std::map<std::string, ACE_DLL_Handle*> pinned_dlls_;
+  };
+}
+
+#endif //GADGETSTREAMTEMPLATECACHE_H
@@ -0,0 +1,117 @@
+#include "GadgetWorkerPool.h"
+#include "log.h"
+
+#include <chrono>
+#include <algorithm>
+#include <exception>
+
+namespace Gadgetron
+{
+  namespace
+  {
+    //Index of the worker queue owned by the current thread, -1 for non-worker threads
+    thread_local long current_worker_index = -1;
+  }
+
+  GadgetWorkerPool* GadgetWorkerPool::instance()
+  {
+    //Never destroyed, gadgets may still submit work during static destruction
+    static GadgetWorkerPool* pool = new GadgetWorkerPool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+    return pool;
+  }
+
+  GadgetWorkerPool::GadgetWorkerPool(size_t workers)
+    : pending_(0)
+    , next_queue_(0)
+    , shutdown_(false)
+  {
+    GDEBUG("Starting gadget worker pool with %d threads\n", workers);
+
+    for (size_t i = 0; i < workers; i++) {
+      queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+      threads_.push_back(std::thread([this, i]() { this->worker(i); }));
+    }
+  }
+
+  GadgetWorkerPool::~GadgetWorkerPool()
+  {
+    shutdown_.store(true);
+    {
+      std::lock_guard<std::mutex> guard(sleep_mutex_);
+      sleep_cv_.notify_all();
+    }
+    for (size_t i = 0; i < threads_.size(); i++) {
+      if (threads_[i].joinable()) threads_[i].join();
+    }
+  }
+
+  void GadgetWorkerPool::submit(Task task)
+  {
+    if (current_worker_index >= 0) {
+      WorkerQueue& q = *queues_[current_worker_index];
+      std::lock_guard<std::mutex> guard(q.mutex);
+      q.tasks.push_front(std::move(task));
+    } else {
+      WorkerQueue& q = *queues_[next_queue_.fetch_add(1) % queues_.size()];
+      std::lock_guard<std::mutex> guard(q.mutex);
+      q.tasks.push_back(std::move(task));
+    }
+
+    pending_.fetch_add(1);
+
+    std::lock_guard<std::mutex> guard(sleep_mutex_);
+    sleep_cv_.notify_one();
+  }
+
+  bool GadgetWorkerPool::try_pop(size_t index, Task& task)
+  {
+    WorkerQueue& q = *queues_[index];
+    std::lock_guard<std::mutex> guard(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    return true;
+  }
+
+  bool GadgetWorkerPool::try_steal(size_t index, Task& task)
+  {
+    for (size_t k = 1; k < queues_.size(); k++) {
+      WorkerQueue& q = *queues_[(index + k) % queues_.size()];
+      std::lock_guard<std::mutex> guard(q.mutex);
+      if (!q.tasks.empty()) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void GadgetWorkerPool::worker(size_t index)
+  {
+    current_worker_index = (long)index;
+
+    while (!shutdown_.load()) {
+      Task task;
+      if (try_pop(index, task) || try_steal(index, task)) {
+        pending_.fetch_sub(1);
+        try {
+          task();
+        } catch (std::exception& e) {
+          GERROR("GadgetWorkerPool, task failed: %s\n", e.what());
+        } catch (...) {
+          GERROR("GadgetWorkerPool, task failed with unknown exception\n");
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      if (pending_.load() == 0 && !shutdown_.load()) {
+        sleep_cv_.wait_for(lock, std::chrono::milliseconds(100));
+      }
+    }
+  }
+}
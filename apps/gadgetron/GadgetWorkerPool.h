@@ -0,0 +1,68 @@
+/** \file   GadgetWorkerPool.h
+    \brief  Process wide work-stealing thread pool used by gadgets running in the pooled scheduler mode.
+
+            Each worker owns a task deque. Tasks submitted from a worker thread go to the front of its
+            own deque (good cache locality for the next gadget in the chain), tasks submitted from other
+            threads are distributed round robin. Idle workers steal from the back of the other deques
+            and sleep on a condition variable when there is no work at all.
+*/
+
+#ifndef GADGETWORKERPOOL_H
+#define GADGETWORKERPOOL_H
+#pragma once
+
+#include "gadgetbase_export.h"
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETBASE GadgetWorkerPool
+  {
+  public:
+    typedef std::function<void()> Task;
+
+    /// The pool is created on first use with one worker per hardware thread
+    static GadgetWorkerPool* instance();
+
+    void submit(Task task);
+
+    size_t number_of_workers() const
+    {
+      return queues_.size();
+    }
+
+  protected:
+
+    struct WorkerQueue
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    GadgetWorkerPool(size_t workers);
+    ~GadgetWorkerPool();
+
+    void worker(size_t index);
+    bool try_pop(size_t index, Task& task);
+    bool try_steal(size_t index, Task& task);
+
+    std::vector< std::unique_ptr<WorkerQueue> > queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_queue_;
+    std::atomic<bool> shutdown_;
+  };
+}
+
+#endif //GADGETWORKERPOOL_H
@@ -0,0 +1,281 @@
+#include "ReplicatedGadget.h"
+
+namespace Gadgetron
+{
+  ReplicatedGadget::Replica::Replica(ReplicatedGadget* owner, size_t i, GadgetModule* m)
+    : module(m)
+    , gadget(dynamic_cast<Gadget*>(m->writer()))
+    , collector(owner, i)
+    , current_sequence(0)
+    , failed(false)
+  {
+  }
+
+  ReplicatedGadget::ReplicatedGadget(const std::vector<GadgetModule*>& replicas)
+    : Gadget()
+    , next_sequence_(0)
+    , stopping_(false)
+    , replicas_closed_(false)
+    , next_emit_(0)
+    , forward_output_(true)
+  {
+    //Sequence numbers are assigned by the dispatching thread, there must only be one
+    this->desired_threads(1);
+
+    for (size_t i = 0; i < replicas.size(); i++) {
+      replicas_.push_back(std::unique_ptr<Replica>(new Replica(this, i, replicas[i])));
+      replicas_.back()->gadget->next(&replicas_.back()->collector);
+    }
+
+    //Expose the properties of the first replica, so that parameter lookups from other gadgets work
+    if (!replicas_.empty()) {
+      Gadget* g = replicas_[0]->gadget;
+      for (int p = 0; p < g->get_number_of_properties(); p++) {
+        this->register_property(g->get_property_by_index(p));
+      }
+    }
+  }
+
+  ReplicatedGadget::~ReplicatedGadget()
+  {
+    //Downstream gadgets may already be gone, output produced from here on is dropped
+    this->shutdown_replicas(false);
+  }
+
+  int ReplicatedGadget::open(void* args)
+  {
+    GDEBUG("Gadget (%s) starting %d replicas\n", this->module()->name(), replicas_.size());
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->thread = std::thread([this, i]() { this->run_replica(i); });
+    }
+    return Gadget::open(args);
+  }
+
+  int ReplicatedGadget::close(unsigned long flags)
+  {
+    int rval = Gadget::close(flags);
+    if (flags == 1) {
+      //The dispatching thread has finished, all messages are with the replicas now
+      this->shutdown_replicas(true);
+    }
+    return rval;
+  }
+
+  int ReplicatedGadget::set_parameter(const char* name, const char* val, bool trigger)
+  {
+    int rval = GADGET_OK;
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      if (replicas_[i]->gadget->set_parameter(name, val, trigger) != GADGET_OK) {
+        rval = GADGET_FAIL;
+      }
+    }
+
+    parameter_mutex_.acquire();
+    parameters_[std::string(name)] = std::string(val);
+    parameter_mutex_.release();
+
+    return rval;
+  }
+
+  void ReplicatedGadget::set_trace(GadgetronTrace* trace)
+  {
+    Gadget::set_trace(trace);
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->gadget->set_trace(trace);
+    }
+  }
+
+  void ReplicatedGadget::set_profile(GadgetronProfile* profile)
+  {
+    Gadget::set_profile(profile);
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->gadget->set_profile(profile);
+    }
+  }
+
+  void ReplicatedGadget::set_memory_account(std::shared_ptr<GadgetronMemoryAccount> account)
+  {
+    Gadget::set_memory_account(account);
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->gadget->set_memory_account(account);
+    }
+  }
+
+  void ReplicatedGadget::set_thread_budget(std::shared_ptr<GadgetronThreadBudget::Stream> budget)
+  {
+    Gadget::set_thread_budget(budget);
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->gadget->set_thread_budget(budget);
+    }
+  }
+
+  int ReplicatedGadget::process_config(ACE_Message_Block* m)
+  {
+    //Every replica needs the configuration, it is passed on downstream by Gadget::process_message
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      if (!this->enqueue_item(*replicas_[i], CONFIG_SEQUENCE, m->duplicate())) {
+        GERROR("Gadget (%s) failed to pass configuration to replica %d\n", this->module()->name(), i);
+        return GADGET_FAIL;
+      }
+    }
+    return GADGET_OK;
+  }
+
+  int ReplicatedGadget::process(ACE_Message_Block* m)
+  {
+    size_t sequence = next_sequence_++;
+    Replica& r = *replicas_[sequence % replicas_.size()];
+
+    if (!this->enqueue_item(r, sequence, m)) {
+      GERROR("Gadget (%s) replica %d has failed\n", this->module()->name(), sequence % replicas_.size());
+      return GADGET_FAIL;
+    }
+    return GADGET_OK;
+  }
+
+  bool ReplicatedGadget::enqueue_item(Replica& r, size_t sequence, ACE_Message_Block* mb)
+  {
+    std::unique_lock<std::mutex> lock(r.mutex);
+    r.cv.wait(lock, [&r]() { return r.queue.size() < MAX_QUEUED_PER_REPLICA || r.failed.load(); });
+
+    if (r.failed.load()) {
+      mb->release();
+      return false;
+    }
+
+    Item item;
+    item.sequence = sequence;
+    item.mb = mb;
+    r.queue.push_back(item);
+    r.cv.notify_all();
+    return true;
+  }
+
+  void ReplicatedGadget::run_replica(size_t i)
+  {
+    Replica& r = *replicas_[i];
+
+    for (;;) {
+      Item item;
+      {
+        std::unique_lock<std::mutex> lock(r.mutex);
+        r.cv.wait(lock, [this, &r]() { return !r.queue.empty() || stopping_; });
+        if (r.queue.empty()) break;
+        item = r.queue.front();
+        r.queue.pop_front();
+        r.cv.notify_all();
+      }
+
+      r.current_sequence = item.sequence;
+
+      if (r.failed.load()) {
+        item.mb->release();
+      } else if (r.gadget->process_message(item.mb) == GADGET_FAIL) {
+        std::lock_guard<std::mutex> guard(r.mutex);
+        r.failed.store(true);
+        r.cv.notify_all();
+      }
+
+      //Messages of a failed replica are completed as well, otherwise the merge would stall
+      if (item.sequence != CONFIG_SEQUENCE) {
+        this->complete(item.sequence);
+      }
+    }
+  }
+
+  int ReplicatedGadget::collect(size_t replica, ACE_Message_Block* mb)
+  {
+    //Configuration is passed on by the ReplicatedGadget itself, hangups are not forwarded
+    if ((mb->msg_type() == ACE_Message_Block::MB_HANGUP) || (mb->flags() & GADGET_MESSAGE_CONFIG)) {
+      mb->release();
+      return 0;
+    }
+
+    size_t sequence = replicas_[replica]->current_sequence;
+
+    std::lock_guard<std::mutex> guard(merge_mutex_);
+    if (sequence == next_emit_ || sequence == CONFIG_SEQUENCE || sequence == CLOSE_SEQUENCE) {
+      return this->forward(mb);
+    }
+
+    pending_[sequence].outputs.push_back(mb);
+    return 0;
+  }
+
+  void ReplicatedGadget::complete(size_t sequence)
+  {
+    std::lock_guard<std::mutex> guard(merge_mutex_);
+    pending_[sequence].done = true;
+
+    for (;;) {
+      std::map<size_t, Pending>::iterator it = pending_.find(next_emit_);
+      if (it == pending_.end()) break;
+
+      for (size_t k = 0; k < it->second.outputs.size(); k++) {
+        this->forward(it->second.outputs[k]);
+      }
+      it->second.outputs.clear();
+
+      //Output of the next message in line can go straight through from now on
+      if (!it->second.done) break;
+
+      pending_.erase(it);
+      next_emit_++;
+    }
+  }
+
+  int ReplicatedGadget::forward(ACE_Message_Block* mb)
+  {
+    if (!forward_output_ || !this->next()) {
+      mb->release();
+      return 0;
+    }
+
+    if (this->next()->putq(mb) == -1) {
+      mb->release();
+      GERROR("Gadget (%s) failed to pass on replica output\n", this->module()->name());
+      return -1;
+    }
+    return 0;
+  }
+
+  void ReplicatedGadget::shutdown_replicas(bool forward_output)
+  {
+    if (replicas_closed_) return;
+    replicas_closed_ = true;
+
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      std::lock_guard<std::mutex> guard(replicas_[i]->mutex);
+      stopping_ = true;
+      replicas_[i]->cv.notify_all();
+    }
+
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      if (replicas_[i]->thread.joinable()) replicas_[i]->thread.join();
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(merge_mutex_);
+      forward_output_ = forward_output;
+      for (std::map<size_t, Pending>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+        for (size_t k = 0; k < it->second.outputs.size(); k++) {
+          it->second.outputs[k]->release();
+        }
+      }
+      pending_.clear();
+    }
+
+    //Closing the modules closes the gadgets, whatever they pass on at close goes downstream in replica order
+    parameter_mutex_.acquire();
+    properties_.clear();
+    parameter_mutex_.release();
+
+    for (size_t i = 0; i < replicas_.size(); i++) {
+      replicas_[i]->current_sequence = CLOSE_SEQUENCE;
+      replicas_[i]->module->close(GadgetModule::M_DELETE);
+      delete replicas_[i]->module;
+      replicas_[i]->module = 0;
+      replicas_[i]->gadget = 0;
+    }
+  }
+}
@@ -0,0 +1,160 @@
+/** \file   ReplicatedGadget.h
+    \brief  Runs N instances of a gadget on different data items and restores the input order afterwards.
+
+            A gadget declared with <replicate>N</replicate> in the stream configuration is wrapped in a
+            ReplicatedGadget. The wrapper owns N independently created instances (replicas) of the gadget,
+            each with its own thread. Data messages are numbered and dealt out round robin, configuration
+            messages are given to every replica. Everything a replica passes on while it processes message
+            k is collected and forwarded downstream only after all output of messages 0..k-1 has been
+            forwarded, so the downstream gadgets see the same order as without replication.
+
+            This is meant for stages that work on independent items (slices, sets, IsmrmrdReconData
+            buckets). State that a gadget keeps from one item to the next is not shared between replicas.
+*/
+
+#ifndef REPLICATEDGADGET_H
+#define REPLICATEDGADGET_H
+#pragma once
+
+#include "Gadget.h"
+#include "GadgetStreamInterface.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETBASE ReplicatedGadget : public Gadget
+  {
+  public:
+
+    /// Maximal number of messages waiting in front of every replica
+    enum { MAX_QUEUED_PER_REPLICA = 2 };
+
+    /**
+       @param replicas Modules holding the gadget instances, the ReplicatedGadget takes ownership
+     */
+    ReplicatedGadget(const std::vector<GadgetModule*>& replicas);
+    virtual ~ReplicatedGadget();
+
+    virtual int open(void* = 0);
+    virtual int close(unsigned long flags);
+
+    /// Parameters are set on every replica
+    virtual int set_parameter(const char* name, const char* val, bool trigger = true);
+
+    /// The replicas record into the same trace, each under its own module name
+    virtual void set_trace(GadgetronTrace* trace);
+    virtual void set_profile(GadgetronProfile* profile);
+    virtual void set_memory_account(std::shared_ptr<GadgetronMemoryAccount> account);
+    virtual void set_thread_budget(std::shared_ptr<GadgetronThreadBudget::Stream> budget);
+
+    size_t number_of_replicas() const
+    {
+      return replicas_.size();
+    }
+
+    Gadget* get_replica(size_t i)
+    {
+      return (i < replicas_.size()) ? replicas_[i]->gadget : 0;
+    }
+
+    /// Called by the replica collectors for every message a replica passes on
+    int collect(size_t replica, ACE_Message_Block* mb);
+
+  protected:
+    virtual int process(ACE_Message_Block* m);
+    virtual int process_config(ACE_Message_Block* m);
+
+    //Sequence numbers of messages which are not subject to reordering
+    static const size_t CONFIG_SEQUENCE = size_t(-2);
+    static const size_t CLOSE_SEQUENCE = size_t(-1);
+
+    /**
+       Message queue of a collector, hands every enqueued message to ReplicatedGadget::collect
+     */
+    class CollectorQueue : public ACE_Message_Queue<ACE_MT_SYNCH>
+    {
+    public:
+      CollectorQueue(ReplicatedGadget* owner, size_t replica) : owner_(owner), replica_(replica) {}
+      virtual int enqueue_tail(ACE_Message_Block* mb, ACE_Time_Value* = 0) { return owner_->collect(replica_, mb); }
+      virtual int enqueue_head(ACE_Message_Block* mb, ACE_Time_Value* = 0) { return owner_->collect(replica_, mb); }
+      virtual int enqueue_prio(ACE_Message_Block* mb, ACE_Time_Value* = 0) { return owner_->collect(replica_, mb); }
+      virtual int enqueue_deadline(ACE_Message_Block* mb, ACE_Time_Value* = 0) { return owner_->collect(replica_, mb); }
+      virtual int enqueue(ACE_Message_Block* mb, ACE_Time_Value* = 0) { return owner_->collect(replica_, mb); }
+    protected:
+      ReplicatedGadget* owner_;
+      size_t replica_;
+    };
+
+    /**
+       Task installed as next() of every replica
+     */
+    class Collector : public ACE_Task<ACE_MT_SYNCH>
+    {
+    public:
+      Collector(ReplicatedGadget* owner, size_t replica)
+        : ACE_Task<ACE_MT_SYNCH>(0, new CollectorQueue(owner, replica))
+      {
+        this->delete_msg_queue_ = true;
+      }
+
+      virtual int put(ACE_Message_Block* mb, ACE_Time_Value* tv = 0)
+      {
+        return this->putq(mb, tv);
+      }
+    };
+
+    struct Item
+    {
+      size_t sequence;
+      ACE_Message_Block* mb;
+    };
+
+    struct Replica
+    {
+      Replica(ReplicatedGadget* owner, size_t i, GadgetModule* m);
+
+      GadgetModule* module;
+      Gadget* gadget;
+      Collector collector;
+      std::deque<Item> queue;
+      std::mutex mutex;
+      std::condition_variable cv;
+      std::thread thread;
+      size_t current_sequence;
+      std::atomic<bool> failed;
+    };
+
+    struct Pending
+    {
+      Pending() : done(false) {}
+      std::vector<ACE_Message_Block*> outputs;
+      bool done;
+    };
+
+    void run_replica(size_t i);
+    bool enqueue_item(Replica& r, size_t sequence, ACE_Message_Block* mb);
+    void complete(size_t sequence);
+    int forward(ACE_Message_Block* mb);
+    void shutdown_replicas(bool forward_output);
+
+    std::vector< std::unique_ptr<Replica> > replicas_;
+    size_t next_sequence_;
+    bool stopping_;
+    bool replicas_closed_;
+
+    std::mutex merge_mutex_;
+    std::map<size_t, Pending> pending_;
+    size_t next_emit_;
+    bool forward_output_;
+  };
+}
+
+#endif //REPLICATEDGADGET_H
@@ -60,7 +60,17 @@ namespace Gadgetron
     return 0L;
   }
 
-  
+  /// number of cuda capable devices, 0 if gadgetron is compiled without cuda
+  inline int get_number_of_gpus()
+  {
+#if defined USE_CUDA
+    int deviceCount = 0;
+    if (cudaGetDeviceCount(&deviceCount) != cudaSuccess) return 0;
+    return deviceCount;
+#else
+    return 0;
+#endif
+  }
 
   inline void print_system_information(std::ostream& os)
   {
@@ -56,6 +56,46 @@ namespace GadgetronXML
       }
       h.rest = re;
     }
+
+    pugi::xml_node w = root.child("warmup");
+    if (w) {
+      Warmup wu;
+      for (pugi::xml_node l = w.child("library"); l; l = l.next_sibling("library")) {
+        wu.library.push_back(l.child_value());
+      }
+      for (pugi::xml_node c = w.child("configuration"); c; c = c.next_sibling("configuration")) {
+        wu.configuration.push_back(c.child_value());
+      }
+      std::string gpu = w.child_value("gpu");
+      wu.gpu = (gpu == "true" || gpu == "1");
+      wu.timeout = static_cast<unsigned int>(std::atoi(w.child_value("timeout")));
+      h.warmup = wu;
+    }
+
+    pugi::xml_node sc = root.child("scheduling");
+    if (sc) {
+      Scheduling sch;
+      if (sc.child("defaultPriority")) {
+        sch.defaultPriority = sc.child_value("defaultPriority");
+        if (sch.defaultPriority != "realtime" && sch.defaultPriority != "batch") {
+          throw std::runtime_error("Invalid default priority in scheduling configuration, must be 'realtime' or 'batch'");
+        }
+      }
+      sch.maxBatchStreams = static_cast<unsigned int>(std::atoi(sc.child_value("maxBatchStreams")));
+      sch.minGpuMemoryMB = static_cast<unsigned int>(std::atoi(sc.child_value("minGpuMemoryMB")));
+      sch.queueTimeout = static_cast<unsigned int>(std::atoi(sc.child_value("queueTimeout")));
+      h.scheduling = sch;
+    }
+
+    pugi::xml_node fi = root.child("fileIngest");
+    if (fi) {
+      FileIngest ingest;
+      ingest.root = fi.child_value("root");
+      if (ingest.root.empty()) {
+        throw std::runtime_error("Invalid file ingest configuration, the root directory is missing");
+      }
+      h.fileIngest = ingest;
+    }
   }
 
   void deserialize(const char* xml_config, GadgetStreamConfiguration& cfg)
@@ -68,6 +108,24 @@ namespace GadgetronXML
       throw std::runtime_error("gadgetronStreamConfiguration element not found in configuration file");
     }
 
+    pugi::xml_node scheduler = root.child("scheduler");
+    if (scheduler) {
+      std::string s = scheduler.child_value();
+      if (s != "threads" && s != "pool") {
+	throw std::runtime_error("Invalid scheduler in stream configuration, must be 'threads' or 'pool'");
+      }
+      cfg.scheduler = s;
+    }
+
+    pugi::xml_node priority = root.child("priority");
+    if (priority) {
+      std::string s = priority.child_value();
+      if (s != "realtime" && s != "batch") {
+	throw std::runtime_error("Invalid priority in stream configuration, must be 'realtime' or 'batch'");
+      }
+      cfg.priority = s;
+    }
+
     pugi::xml_node reader = root.child("reader");
     while (reader) {
       Reader r;
@@ -95,6 +153,15 @@ namespace GadgetronXML
       g.dll = gadget.child_value("dll");
       g.classname = gadget.child_value("classname");
 
+      pugi::xml_node replicate = gadget.child("replicate");
+      if (replicate) {
+	int n = std::atoi(replicate.child_value());
+	if (n < 1) {
+	  throw std::runtime_error("Invalid replicate value in gadget configuration, must be at least 1");
+	}
+	g.replicate = static_cast<unsigned short>(n);
+      }
+
       pugi::xml_node property = gadget.child("property");
       while (property) {
         GadgetronParameter p;
@@ -144,6 +211,13 @@ namespace GadgetronXML
     a = root.append_attribute("xsi:schemaLocation");
     a.set_value("http://gadgetron.sf.net/gadgetron gadgetron.xsd");
 
+    if (cfg.scheduler) {
+      append_node(root, "scheduler", *cfg.scheduler);
+    }
+
+    if (cfg.priority) {
+      append_node(root, "priority", *cfg.priority);
+    }
 
     for (std::vector<Reader>::const_iterator it = cfg.reader.begin();
     it != cfg.reader.end(); it++)
@@ -189,6 +263,10 @@ namespace GadgetronXML
       n2 = n1.append_child("classname");
       n2.append_child(pugi::node_pcdata).set_value(it->classname.c_str());
 
+      if (it->replicate) {
+	append_node(n1, "replicate", to_string_val(*it->replicate));
+      }
+
       for (std::vector<GadgetronParameter>::const_iterator it2 = it->property.begin();
       it2 != it->property.end(); it2++)
       {
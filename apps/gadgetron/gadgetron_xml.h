@@ -87,12 +87,54 @@ namespace GadgetronXML
     unsigned int port;
   };
   
+  /**
+     Work done at startup, before the server accepts connections. The gadget libraries are loaded,
+     idle streams are built for the stream configurations and the GPUs get their contexts and handles.
+   */
+  struct Warmup
+  {
+    Warmup() : gpu(false), timeout(0) {}
+
+    std::vector<std::string> library;
+    std::vector<std::string> configuration;
+    bool gpu;
+    unsigned int timeout; //seconds, 0 to wait until the warm-up is done
+  };
+  
+  /**
+     Admission of the connections, see GadgetConnectionScheduler. Batch streams are queued until
+     fewer than maxBatchStreams batch streams are running (0 for no limit), the host array memory
+     is below GADGETRON_MEMORY_LIMIT_MB and a GPU has minGpuMemoryMB free. Real-time streams are
+     always admitted. A batch stream waits at most queueTimeout seconds (0 for no limit).
+   */
+  struct Scheduling
+  {
+    Scheduling() : defaultPriority("realtime"), maxBatchStreams(0), minGpuMemoryMB(0), queueTimeout(0) {}
+
+    std::string defaultPriority;
+    unsigned int maxBatchStreams;
+    unsigned int minGpuMemoryMB;
+    unsigned int queueTimeout;
+  };
+
+  /**
+     Reading of ISMRMRD files by the server for a stream (GADGET_MESSAGE_FILE_INGEST). Only the
+     files below root can be read, without this section file ingest is refused.
+   */
+  struct FileIngest
+  {
+    std::string root;
+  };
+
   struct GadgetronConfiguration
   {
     std::string port;
     std::vector<GadgetronParameter> globalGadgetParameter;
     Optional<CloudBus> cloudBus;
     Optional<ReST> rest;
+    Optional<Warmup> warmup;
+    Optional<Scheduling> scheduling;
+    Optional<FileIngest> fileIngest;
   };
 
   void EXPORTGADGETBASE deserialize(const char* xml_config, GadgetronConfiguration& h);
@@ -111,11 +153,14 @@ namespace GadgetronXML
     std::string name;
     std::string dll;
     std::string classname;
+    Optional<unsigned short> replicate;
     std::vector<GadgetronParameter> property;
   };
 
   struct GadgetStreamConfiguration
   {
+    Optional<std::string> scheduler;
+    Optional<std::string> priority; //"realtime" or "batch"
     std::vector<Reader> reader;
     std::vector<Writer> writer;
     std::vector<Gadget> gadget;
@@ -2,6 +2,11 @@
 #include "gadgetron_rest.h"
 
 #include "GadgetServerAcceptor.h"
+#include "GadgetServerEventLoop.h"
+#include "GadgetServerLocalAcceptor.h"
+#include "GadgetServerWarmup.h"
+#include "GadgetConnectionScheduler.h"
+#include "GadgetFileIngest.h"
 #include "FileInfo.h"
 #include "url_encode.h"
 #include "gadgetron_xml.h"
@@ -10,6 +15,13 @@
 #include "CloudBus.h"
 
 #include "gadgetron_system_info.h"
+#include "hoNDFFT.h"
+#include "GadgetronNodeProfile.h"
+#include "GadgetronThreadBudget.h"
+
+#if USE_CUDA
+#include "cudaDeviceManager.h"
+#endif
 
 #include <ace/Log_Msg.h>
 #include <ace/Service_Config.h>
@@ -92,6 +104,9 @@ void print_usage()
   GINFO("            -r <RELAY HOST>                (default localhost)  \n");
   GINFO("            -l <RELAY PORT>                (default 0, disabled)\n");
   GINFO("            -R <REST PORT>                 (default 0, disabled)\n");
+  GINFO("            -i <I/O THREADS>               (default 0, one thread per connection)\n");
+  GINFO("            -T <TRACE DIRECTORY>           (default none, tracing disabled)\n");
+  GINFO("            -u <UNIX SOCKET PATH>          (default none, no local connections)\n");
 }
 
 int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
@@ -110,10 +125,40 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
   }
 
 
+  // settings tuned for this node with gadgetron_autotune
+  GadgetronNodeProfile& node_profile = GadgetronNodeProfile::instance();
+  if (GadgetronNodeProfile::enabled() && node_profile.load(GadgetronNodeProfile::filename(gadgetron_home))) {
+    GINFO("Loaded node profile %s\n", GadgetronNodeProfile::filename(gadgetron_home).c_str());
+    if (!std::getenv("GADGETRON_NUM_THREADS") && node_profile.get_int("threads", 0) > 0) {
+      GadgetronThreadBudget::instance().set_total(node_profile.get_int("threads", 0));
+      GINFO("Thread budget of the node profile: %d\n", GadgetronThreadBudget::instance().total());
+    }
+  }
+
+  // fft plans tuned offline with gadgetron_fftw_wisdom, the node profile may prefer estimated plans
+  std::string fftw_rigor = node_profile.get("fftw.rigor", "measure");
+  unsigned wisdom_rigor = FFTW_MEASURE;
+  if (fftw_rigor == "patient") wisdom_rigor = FFTW_PATIENT;
+  else if (fftw_rigor == "exhaustive") wisdom_rigor = FFTW_EXHAUSTIVE;
+
+  if (fftw_rigor != "estimate") {
+    if (hoNDFFT<float>::instance()->load_wisdom(hoNDFFT<float>::wisdom_filename(gadgetron_home))) {
+      hoNDFFT<float>::instance()->use_wisdom(wisdom_rigor);
+      GINFO("Loaded fftw wisdom %s\n", hoNDFFT<float>::wisdom_filename(gadgetron_home).c_str());
+    }
+    if (hoNDFFT<double>::instance()->load_wisdom(hoNDFFT<double>::wisdom_filename(gadgetron_home))) {
+      hoNDFFT<double>::instance()->use_wisdom(wisdom_rigor);
+      GINFO("Loaded fftw wisdom %s\n", hoNDFFT<double>::wisdom_filename(gadgetron_home).c_str());
+    }
+  }
+
   ACE_TCHAR port_no[1024];
   ACE_TCHAR relay_host[1024];
   uint16_t  relay_port = 0;
   uint16_t  rest_port = 0;
+  size_t    io_threads = 0;
+  std::string trace_directory = "";
+  std::string local_socket_path = "";
   std::string lb_endpoint = "";
   
   ACE_OS_String::strncpy(relay_host, "localhost", 1024);
@@ -162,7 +207,7 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     return -1;
   }
 
-  static const ACE_TCHAR options[] = ACE_TEXT(":p:r:l:R:e:");
+  static const ACE_TCHAR options[] = ACE_TEXT(":p:r:l:R:e:i:T:u:");
   ACE_Get_Opt cmd_opts(argc, argv, options);
 
   int option;
@@ -183,6 +228,15 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     case 'e':
       lb_endpoint = std::string(cmd_opts.opt_arg());
       break;  
+    case 'i':
+      io_threads = std::atoi(cmd_opts.opt_arg());
+      break;
+    case 'T':
+      trace_directory = std::string(cmd_opts.opt_arg());
+      break;
+    case 'u':
+      local_socket_path = std::string(cmd_opts.opt_arg());
+      break;
     case ':':
       print_usage();
       GERROR("-%c requires an argument.\n", cmd_opts.opt_opt());
@@ -196,6 +250,38 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     }
   }
 
+  if (c.scheduling) {
+    GINFO("Batch streams: at most %d running (0 for no limit), %d MB of free GPU memory\n",
+          (int)c.scheduling->maxBatchStreams, (int)c.scheduling->minGpuMemoryMB);
+    GadgetConnectionScheduler::instance()->configure(*c.scheduling);
+  }
+
+  if (c.fileIngest) {
+    if (GadgetFileIngest::set_root(c.fileIngest->root)) {
+      GINFO("Files below %s can be read by the server for a stream\n", c.fileIngest->root.c_str());
+    }
+  }
+
+#if USE_CUDA
+  GadgetConnectionScheduler::instance()->set_gpu_memory_probe([]()
+  {
+    size_t largest = 0;
+    int gpus = Gadgetron::get_number_of_gpus();
+    for (int d = 0; d < gpus; d++) {
+      size_t free = cudaDeviceManager::Instance()->getFreeMemory(d);
+      if (free > largest) largest = free;
+    }
+    return largest;
+  });
+#endif
+
+  //Libraries, idle streams and GPUs are prepared while the rest of the server starts up
+  GadgetServerWarmup warmup;
+  if (c.warmup) {
+    GINFO("Starting warm-up\n");
+    warmup.start(*c.warmup, gadgetron_home);
+  }
+
   if (rest_port > 0) {
     GINFO("Starting ReST interface on port %d\n", rest_port);
     Gadgetron::ReST::port_ = rest_port;
@@ -206,6 +292,10 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
       std::string content = ss.str();
       return content;
     });
+    Gadgetron::ReST::instance()->server().route_dynamic("/info/ready")([&warmup]()
+    {
+      return std::string(warmup.ready() ? "true" : "false");
+    });
   }
 
   if (relay_port > 0) {
@@ -215,6 +305,9 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
     Gadgetron::CloudBus::set_gadgetron_port(std::atoi(port_no));
     Gadgetron::CloudBus::set_rest_port(rest_port);
     Gadgetron::CloudBus* cb = Gadgetron::CloudBus::instance();//This actually starts the bus.
+    //Nodes with gpus are preferred by the load aware node selection of the DistributeGadget
+    cb->set_compute_capability(1 + Gadgetron::get_number_of_gpus());
+    cb->send_node_info();
     if (lb_endpoint.size()) {
         size_t colon_pos = lb_endpoint.find(":");
         if (colon_pos == std::string::npos) {
@@ -257,14 +350,54 @@ int ACE_TMAIN(int argc, ACE_TCHAR *argv[])
       return -1;
     }
 
+  //The port is opened once warm, so gt_alive does not report a server that is still warming up
+  if (c.warmup) {
+    if (warmup.wait(c.warmup->timeout)) {
+      GINFO("Warm-up done, %d tasks failed\n", (int)warmup.failures());
+    } else {
+      GWARN("Warm-up not done after %d seconds, accepting connections\n", (int)c.warmup->timeout);
+    }
+  }
+
   GINFO("Configuring services, Running on port %s\n", port_no);
 
   ACE_INET_Addr port_to_listen (port_no);
   GadgetServerAcceptor acceptor;
   acceptor.global_gadget_parameters_ = gadget_parameters;
   acceptor.reactor (ACE_Reactor::instance ());
+
+  if (trace_directory.size()) {
+    if (!Gadgetron::create_folder_with_all_permissions(trace_directory)) {
+      GERROR("Failed to create trace directory %s\n", trace_directory.c_str());
+      return -1;
+    }
+    GINFO("Writing stream traces to %s\n", trace_directory.c_str());
+    acceptor.set_trace_directory(trace_directory);
+  }
+
+  GadgetServerEventLoop event_loop;
+  if (io_threads > 0) {
+    if (event_loop.open(io_threads) == -1) {
+      GERROR("Failed to start the event loop, using one thread per connection\n");
+    } else {
+      acceptor.set_event_loop(&event_loop);
+    }
+  }
+
   if (acceptor.open (port_to_listen) == -1)
     return 1;
+
+  GadgetServerLocalAcceptor local_acceptor;
+  if (local_socket_path.size()) {
+    local_acceptor.global_gadget_parameters_ = gadget_parameters;
+    local_acceptor.set_trace_directory(trace_directory);
+    if (event_loop.number_of_threads() > 0) {
+      local_acceptor.set_event_loop(&event_loop);
+    }
+    local_acceptor.reactor (ACE_Reactor::instance ());
+    if (local_acceptor.open (local_socket_path) == -1)
+      return 1;
+  }
   
   ACE_Reactor::instance()->run_reactor_event_loop ();
 
@@ -0,0 +1,294 @@
+/**
+	\brief command line tool that benchmarks the performance settings on this machine and writes them to the node profile
+
+	The gadgetron reads the profile at startup (see GadgetronNodeProfile), so every node of a fleet runs with the
+	settings measured on it. Run the tool after the installation on every node, on an otherwise idle machine.
+	The tuned settings are merged with the existing profile, entries set by hand (e.g. gadget properties) are kept.
+
+	Benchmarked are
+	  threads               total threads of the streams, the fewest within 5% of the fastest batched fft2c
+	  fftw.rigor            measure if the plans of gadgetron_fftw_wisdom are more than 5% faster than estimated plans
+	  wavelet.threads       threads of the loop over the arrays of a 2D redundant Harr wavelet
+	  registration.threads  threads of the deformation field registration over a series of images
+
+	On a node without a GPU the GPU path of GrappaGadget is switched off. The CPU and GPU reconstructions of the other
+	gadgets and the atomic variant of cuNFFT_plan (a template parameter) are not timed; pin them in the profile with
+	gadget.<class>.<property> entries where needed.
+
+	\param s: size of the benchmark images, RO x E1 x N, default 256x256x32
+	\param r: repetitions of every timing, the fastest counts
+	\param o: output file, default <gadgetron home>/share/gadgetron/config/node_profile.txt
+*/
+
+#include "hoNDArray.h"
+#include "hoNDFFT.h"
+#include "hoNDHarrWavelet.h"
+#include "hoNDImageContainer2D.h"
+#include "hoImageRegContainer2DRegistration.h"
+#include "GadgetronNodeProfile.h"
+#include "GadgetronThreadBudget.h"
+#include "parameterparser.h"
+#include "gadgetron_paths.h"
+#include "gadgetron_system_info.h"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gadgetron;
+
+namespace
+{
+	// fastest of reps runs in seconds, after one run to warm up caches and plans
+	template <typename F> double time_best(F f, int reps)
+	{
+		f();
+
+		double best = 0;
+		for (int r = 0; r < reps; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			f();
+			double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (r == 0 || t < best) best = t;
+		}
+		return best;
+	}
+
+	// 1, 2, 4, ... and the number of cores
+	std::vector<int> thread_counts()
+	{
+		int cores = GadgetronThreadBudget::number_of_cores();
+
+		std::vector<int> counts;
+		for (int n = 1; n < cores; n *= 2) counts.push_back(n);
+		counts.push_back(cores);
+		return counts;
+	}
+
+	// the fewest threads within 5% of the fastest, more threads than that only take cores from other streams
+	int pick(const std::vector<int>& counts, const std::vector<double>& times)
+	{
+		double best = times[0];
+		for (size_t i = 1; i < times.size(); i++) if (times[i] < best) best = times[i];
+
+		for (size_t i = 0; i < times.size(); i++)
+		{
+			if (times[i] <= 1.05 * best) return counts[i];
+		}
+		return counts.back();
+	}
+
+	void report(const char* what, const std::vector<int>& counts, const std::vector<double>& times, int picked)
+	{
+		cout << what << ":";
+		for (size_t i = 0; i < counts.size(); i++) cout << " " << counts[i] << " threads " << times[i] * 1e3 << " ms,";
+		cout << " picked " << picked << endl;
+	}
+
+	void fill(hoNDArray< std::complex<float> >& a)
+	{
+		for (size_t i = 0; i < a.get_number_of_elements(); i++) a[i] = std::complex<float>(std::sin(0.01f*i), std::cos(0.03f*i));
+	}
+
+	int tune_threads(size_t RO, size_t E1, size_t N, int reps)
+	{
+		hoNDArray< std::complex<float> > a(RO, E1, N);
+		fill(a);
+
+		std::vector<int> counts = thread_counts();
+		std::vector<double> times;
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			GadgetronThreadBudget::instance().set_total(counts[i]);
+			times.push_back(time_best([&]() { hoNDFFT<float>::instance()->fft2c(a); hoNDFFT<float>::instance()->ifft2c(a); }, reps));
+		}
+		GadgetronThreadBudget::instance().set_total(0);
+
+		int n = pick(counts, times);
+		report("fft2c", counts, times, n);
+		return n;
+	}
+
+	// FFTW directly, the plans of hoNDFFT are cached independently of the rigor
+	std::string tune_fftw_rigor(size_t RO, size_t E1, size_t N, int reps)
+	{
+		hoNDArray< std::complex<float> > a(RO, E1, N);
+		fill(a);
+		fftwf_complex* p = reinterpret_cast<fftwf_complex*>(a.begin());
+
+		double t[2];
+		unsigned rigor[2] = { FFTW_ESTIMATE, FFTW_MEASURE };
+		for (int r = 0; r < 2; r++)
+		{
+			// measuring overwrites the array
+			fftwf_plan plan = fftwf_plan_dft_2d((int)E1, (int)RO, p, p, FFTW_FORWARD, rigor[r]);
+			fill(a);
+			t[r] = time_best([&]() { for (size_t n = 0; n < N; n++) fftwf_execute_dft(plan, p + n*RO*E1, p + n*RO*E1); }, reps);
+			fftwf_destroy_plan(plan);
+		}
+
+		std::string res = (t[0] > 1.05 * t[1]) ? "measure" : "estimate";
+		cout << "fftw plans: estimate " << t[0] * 1e3 << " ms, measure " << t[1] * 1e3 << " ms, picked " << res << endl;
+		return res;
+	}
+
+	int tune_wavelet(size_t RO, size_t E1, size_t N, int reps)
+	{
+		hoNDArray< std::complex<float> > a(RO, E1, N), w;
+		fill(a);
+
+		hoNDHarrWavelet< std::complex<float> > wav;
+		GadgetronNodeProfile& profile = GadgetronNodeProfile::instance();
+
+		std::vector<int> counts = thread_counts();
+		std::vector<double> times;
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			profile.set("wavelet.threads", counts[i]);
+			times.push_back(time_best([&]() { wav.transform(a, w, 2, 3, true); wav.transform(w, a, 2, 3, false); }, reps));
+		}
+
+		int n = pick(counts, times);
+		report("wavelet", counts, times, n);
+		return n;
+	}
+
+	int tune_registration(size_t RO, size_t E1, size_t N, int reps)
+	{
+		typedef hoImageRegContainer2DRegistration< hoNDImage<float, 2>, hoNDImage<float, 2>, float > RegistrationType;
+
+		// a blob moving across the series
+		hoNDArray<float> im(RO, E1, N);
+		for (size_t n = 0; n < N; n++)
+		{
+			float cx = RO*(0.4f + 0.2f*n/N), cy = E1*(0.5f - 0.1f*n/N), r = 0.15f*RO;
+			for (size_t e1 = 0; e1 < E1; e1++)
+			{
+				for (size_t ro = 0; ro < RO; ro++)
+				{
+					float d2 = (ro - cx)*(ro - cx) + (e1 - cy)*(e1 - cy);
+					im(ro, e1, n) = 100.0f*std::exp(-d2 / (2*r*r)) + 10.0f;
+				}
+			}
+		}
+
+		std::vector<size_t> dim;
+		im.get_dimensions(dim);
+		std::vector<unsigned int> reference(1, 0);
+
+		std::vector<int> counts = thread_counts();
+		std::vector<double> times;
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			times.push_back(time_best([&]() {
+				hoNDImageContainer2D< hoNDImage<float, 2> > container;
+				container.create(im.begin(), dim);
+
+				RegistrationType reg;
+				reg.setDefaultParameters(3, false);
+				reg.container_reg_mode_ = GT_IMAGE_REG_CONTAINER_FIXED_REFERENCE;
+				reg.dynamic_scheduling_ = true;
+				reg.max_num_of_threads_ = counts[i];
+				reg.max_iter_num_pyramid_level_ = std::vector<unsigned int>(3, 16);
+				reg.registerOverContainer2DFixedReference(container, reference, false, false);
+			}, reps));
+		}
+
+		int n = pick(counts, times);
+		report("registration", counts, times, n);
+		return n;
+	}
+
+	// "256x256x32" -> {256, 256, 32}
+	bool parse_size(const std::string& spec, std::vector<size_t>& dims)
+	{
+		std::stringstream ds(spec);
+		std::string d;
+		while (std::getline(ds, d, 'x'))
+		{
+			size_t v = 0;
+			std::stringstream vs(d);
+			if (!(vs >> v) || v == 0) return false;
+			dims.push_back(v);
+		}
+		return dims.size() == 3;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ParameterParser parms;
+	parms.add_parameter('s', COMMAND_LINE_STRING, 1, "Image size RO x E1 x N (e.g. 256x256x32)", true, "256x256x32");
+	parms.add_parameter('r', COMMAND_LINE_INT, 1, "Repetitions of every timing", true, "5");
+	parms.add_parameter('o', COMMAND_LINE_STRING, 1, "Output file (default <gadgetron home>/share/gadgetron/config/node_profile.txt)", false);
+
+	parms.parse_parameter_list(argc, argv);
+	if(parms.all_required_parameters_set()){
+		cout << "Running gadgetron_autotune with the following parameters:" << endl;
+		parms.print_parameter_list();
+	}else{
+		cout << "Some required parameters are missing: " << endl;
+		parms.print_parameter_list();
+		parms.print_usage();
+		return 1;
+	}
+
+	std::vector<size_t> dims;
+	if (!parse_size(parms.get_parameter('s')->get_string_value(), dims))
+	{
+		cout << "Invalid image size: " << parms.get_parameter('s')->get_string_value() << endl;
+		return 1;
+	}
+
+	int reps = parms.get_parameter('r')->get_int_value();
+	if (reps < 1) reps = 1;
+
+	std::string filename;
+	if (parms.get_parameter('o')->get_is_set()) filename = parms.get_parameter('o')->get_string_value();
+	else filename = GadgetronNodeProfile::filename(get_gadgetron_home());
+
+	boost::system::error_code ec;
+	boost::filesystem::path dir = boost::filesystem::path(filename).parent_path();
+	if (!dir.empty()) boost::filesystem::create_directories(dir, ec);
+
+	GadgetronNodeProfile& profile = GadgetronNodeProfile::instance();
+	if (profile.load(filename)) cout << "Adding to the profile in " << filename << endl;
+
+	size_t RO = dims[0], E1 = dims[1], N = dims[2];
+
+	int threads = tune_threads(RO, E1, N, reps);
+	std::string rigor = tune_fftw_rigor(RO, E1, N, reps);
+	int wavelet_threads = tune_wavelet(RO, E1, N, reps);
+	int registration_threads = tune_registration(RO / 2, E1 / 2, 8, reps);
+
+	profile.set("threads", threads);
+	profile.set("fftw.rigor", rigor);
+	profile.set("wavelet.threads", wavelet_threads);
+	profile.set("registration.threads", registration_threads);
+
+	int gpus = get_number_of_gpus();
+	cout << "GPUs: " << gpus << endl;
+	if (gpus == 0) profile.set("gadget.GrappaGadget.use_gpu", "false");
+
+	std::time_t now = std::time(nullptr);
+	std::stringstream comment;
+	comment << "node profile written by gadgetron_autotune, " << std::ctime(&now)
+	        << "benchmark images " << RO << "x" << E1 << "x" << N << ", " << GadgetronThreadBudget::number_of_cores() << " cores, " << gpus << " GPUs";
+	if (rigor == "measure") comment << "\nfftw.rigor = measure takes effect with the wisdom of gadgetron_fftw_wisdom";
+
+	if (!profile.save(filename, comment.str()))
+	{
+		cout << "Could not write the profile to " << filename << endl;
+		return 1;
+	}
+
+	cout << "Wrote the profile to " << filename << endl;
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+	\brief command line tool that tunes the FFTW plans of hoNDFFT offline and stores them as wisdom
+
+	The gadgetron loads the wisdom at startup (hoNDFFT::use_wisdom), so the reconstructions get measured
+	plans for the tuned array sizes without planning on their data. The tool runs the same transforms the
+	reconstructions do, because FFTW wisdom only applies to the same sizes, batch counts and thread split.
+	Run it on the machine the gadgetron runs on; new wisdom is merged with the existing file.
+
+	\param s: array sizes, e.g. 256x256x32,192x192x16
+	\param r: number of leading dimensions transformed, 1, 2 or 3
+	\param l: rigor, measure, patient or exhaustive
+	\param p: precision, float, double or both
+	\param o: output directory, default <gadgetron home>/share/gadgetron/fftw
+*/
+
+#include "hoNDFFT.h"
+#include "parameterparser.h"
+#include "gadgetron_paths.h"
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gadgetron;
+
+namespace
+{
+	// "256x256x32,192x192x16" -> {{256, 256, 32}, {192, 192, 16}}
+	bool parse_sizes(const std::string& spec, std::vector< std::vector<size_t> >& sizes)
+	{
+		std::stringstream list(spec);
+		std::string item;
+		while (std::getline(list, item, ','))
+		{
+			std::vector<size_t> dims;
+			std::stringstream ds(item);
+			std::string d;
+			while (std::getline(ds, d, 'x'))
+			{
+				size_t v = 0;
+				std::stringstream vs(d);
+				if (!(vs >> v) || v == 0) return false;
+				dims.push_back(v);
+			}
+			if (dims.empty()) return false;
+			sizes.push_back(dims);
+		}
+		return !sizes.empty();
+	}
+
+	template <typename T> bool tune(const std::vector< std::vector<size_t> >& sizes, size_t rank, unsigned rigor, const std::string& dir)
+	{
+		typedef std::complex<T> ComplexType;
+		hoNDFFT<T>* fft = hoNDFFT<T>::instance();
+
+		std::string filename = dir + "/" + boost::filesystem::path(hoNDFFT<T>::wisdom_filename("")).filename().string();
+		if (fft->load_wisdom(filename)) cout << "Adding to wisdom in " << filename << endl;
+
+		fft->learn_wisdom(rigor);
+
+		for (size_t i = 0; i < sizes.size(); i++)
+		{
+			if (sizes[i].size() < rank)
+			{
+				cout << "Skipping a size with fewer than " << rank << " dimensions" << endl;
+				continue;
+			}
+
+			cout << "Tuning " << (sizeof(T) == sizeof(float) ? "float" : "double") << " [";
+			for (size_t d = 0; d < sizes[i].size(); d++) cout << (d ? " " : "") << sizes[i][d];
+			cout << "]" << endl;
+
+			// the values do not matter, the plans are measured on (and overwrite) the arrays
+			std::vector<size_t> dims(sizes[i]);
+			hoNDArray<ComplexType> a(dims), r(dims);
+			a.fill(ComplexType(1, 0));
+
+			if (rank == 1) { fft->fft1c(a); fft->ifft1c(a); fft->fft1c(a, r); fft->ifft1c(a, r); fft->fft1(a); fft->ifft1(a); }
+			else if (rank == 2) { fft->fft2c(a); fft->ifft2c(a); fft->fft2c(a, r); fft->ifft2c(a, r); fft->fft2(a); fft->ifft2(a); }
+			else { fft->fft3c(a); fft->ifft3c(a); fft->fft3c(a, r); fft->ifft3c(a, r); fft->fft3(a); fft->ifft3(a); }
+		}
+
+		fft->use_wisdom(rigor);
+		if (!fft->save_wisdom(filename)) return false;
+
+		cout << "Wrote the wisdom to " << filename << endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ParameterParser parms;
+	parms.add_parameter('s', COMMAND_LINE_STRING, 1, "Array sizes (e.g. 256x256x32,192x192x16)", true);
+	parms.add_parameter('r', COMMAND_LINE_INT, 1, "Number of transformed dimensions (1, 2 or 3)", true, "2");
+	parms.add_parameter('l', COMMAND_LINE_STRING, 1, "Rigor (measure, patient or exhaustive)", true, "measure");
+	parms.add_parameter('p', COMMAND_LINE_STRING, 1, "Precision (float, double or both)", true, "float");
+	parms.add_parameter('o', COMMAND_LINE_STRING, 1, "Output directory (default <gadgetron home>/share/gadgetron/fftw)", false);
+
+	parms.parse_parameter_list(argc, argv);
+	if(parms.all_required_parameters_set()){
+		cout << "Running gadgetron_fftw_wisdom with the following parameters:" << endl;
+		parms.print_parameter_list();
+	}else{
+		cout << "Some required parameters are missing: " << endl;
+		parms.print_parameter_list();
+		parms.print_usage();
+		return 1;
+	}
+
+	std::vector< std::vector<size_t> > sizes;
+	if (!parse_sizes(parms.get_parameter('s')->get_string_value(), sizes))
+	{
+		cout << "Invalid array sizes: " << parms.get_parameter('s')->get_string_value() << endl;
+		return 1;
+	}
+
+	int rank = parms.get_parameter('r')->get_int_value();
+	if (rank < 1 || rank > 3)
+	{
+		cout << "The number of transformed dimensions must be 1, 2 or 3" << endl;
+		return 1;
+	}
+
+	std::string level = parms.get_parameter('l')->get_string_value();
+	unsigned rigor = FFTW_MEASURE;
+	if (level == "patient") rigor = FFTW_PATIENT;
+	else if (level == "exhaustive") rigor = FFTW_EXHAUSTIVE;
+	else if (level != "measure")
+	{
+		cout << "Unknown rigor: " << level << endl;
+		return 1;
+	}
+
+	std::string dir;
+	if (parms.get_parameter('o')->get_is_set()) dir = parms.get_parameter('o')->get_string_value();
+	else dir = boost::filesystem::path(hoNDFFT<float>::wisdom_filename(get_gadgetron_home())).parent_path().string();
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(dir, ec);
+	if (!boost::filesystem::is_directory(dir))
+	{
+		cout << "Could not create the output directory " << dir << endl;
+		return 1;
+	}
+
+	std::string precision = parms.get_parameter('p')->get_string_value();
+	bool good = true;
+	if (precision == "float" || precision == "both") good = tune<float>(sizes, (size_t)rank, rigor, dir) && good;
+	if (precision == "double" || precision == "both") good = tune<double>(sizes, (size_t)rank, rigor, dir) && good;
+
+	return good ? 0 : 1;
+}
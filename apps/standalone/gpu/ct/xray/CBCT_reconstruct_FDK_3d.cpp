@@ -2,6 +2,7 @@
 #include "CBCT_acquisition.h"
 #include "CBCT_binning.h"
 #include "hoCuConebeamProjectionOperator.h"
+#include "hoCuStreamingConebeamProjectionOperator.h"
 #include "hoNDArray_fileio.h"
 #include "hoCuNDArray_math.h"
 #include "vector_td_utilities.h"
@@ -29,6 +30,8 @@ int main(int argc, char** argv)
   parms.add_parameter( 'F', COMMAND_LINE_INT, 1, "Use filtered backprojection (fbp)", true, "1" );
   parms.add_parameter( 'P', COMMAND_LINE_INT, 1, "Projections per batch", false );
   parms.add_parameter( 'D', COMMAND_LINE_INT, 1, "Number of downsamples of projection plate", true, "0" );
+  parms.add_parameter( 'S', COMMAND_LINE_INT, 1, "Streams per device, streamed reconstruction if non-zero", true, "0" );
+  parms.add_parameter( 'G', COMMAND_LINE_INT, 1, "Number of devices for streamed reconstruction (0 for all)", true, "0" );
 
   parms.parse_parameter_list(argc, argv);
   if( parms.all_required_parameters_set() ) {
@@ -113,7 +116,26 @@ int main(int argc, char** argv)
   // - and configure based on input parameters
   //
   
-  boost::shared_ptr< hoCuConebeamProjectionOperator > E( new hoCuConebeamProjectionOperator() );
+  boost::shared_ptr< hoCuConebeamProjectionOperator > E;
+
+  unsigned int num_streams = parms.get_parameter('S')->get_int_value();
+  if( num_streams > 0 ){
+
+    // Streamed through the devices, for volumes and acquisitions larger than the device memory
+    //
+
+    boost::shared_ptr< hoCuStreamingConebeamProjectionOperator > S( new hoCuStreamingConebeamProjectionOperator() );
+    S->set_num_streams(num_streams);
+
+    std::vector<int> devices;
+    for( int i=0; i<parms.get_parameter('G')->get_int_value(); i++ )
+      devices.push_back(i);
+    S->set_devices(devices);
+
+    E = S;
+  }
+  else
+    E = boost::shared_ptr< hoCuConebeamProjectionOperator >( new hoCuConebeamProjectionOperator() );
 
   E->setup( acquisition, binning, is_dims_in_mm );
   E->set_use_filtered_backprojection(use_fbp);
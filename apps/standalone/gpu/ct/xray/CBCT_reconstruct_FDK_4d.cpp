@@ -30,6 +30,7 @@ int main(int argc, char** argv)
 	parms.add_parameter( 'H', COMMAND_LINE_FLOAT, 1, "Half-scan mode maximum angle", true, "0" );
 	parms.add_parameter( 'P', COMMAND_LINE_INT, 1, "Projections per batch", true, "50" );
   parms.add_parameter( 'D', COMMAND_LINE_INT, 1, "Number of downsamples of projection plate", true, "0" );
+	parms.add_parameter( 'B', COMMAND_LINE_INT, 1, "Backproject all bins in one pass (fp16 projections)", true, "0" );
 
 	parms.parse_parameter_list(argc, argv);
 	if( parms.all_required_parameters_set() ) {
@@ -84,6 +85,7 @@ int main(int argc, char** argv)
 	bool use_fbp_os = parms.get_parameter('O')->get_int_value();
 	float half_scan_max_angle = parms.get_parameter('H')->get_float_value();
 	unsigned int projections_per_batch = parms.get_parameter('P')->get_int_value();
+	bool use_binned_backprojection = parms.get_parameter('B')->get_int_value();
 	boost::shared_ptr<CBCT_binning> ps_bd4d(  new CBCT_binning());
 
 	std::cout << "binning data file: " << binning_filename << std::endl;
@@ -139,6 +141,7 @@ int main(int argc, char** argv)
 	E4D( new hoCuConebeamProjectionOperator() );
 	E4D->setup(acquisition,ps_bd4d,is_dims_in_mm);
 	E4D->set_use_filtered_backprojection(true);
+	E4D->set_use_binned_backprojection(use_binned_backprojection);
 	E4D->set_domain_dimensions(&is_dims);
 
 	hoCuNDArray<float> fdk(*expand(&fdk_3d,numBins));
@@ -0,0 +1,31 @@
+#
+# Find the ZSTD includes and library
+#
+
+# This module defines
+# ZSTD_INCLUDE_DIR, where to find zstd.h
+# ZSTD_LIBRARIES, the libraries to link against
+# ZSTD_FOUND, if false, you cannot build anything that requires ZSTD
+
+######################################################################## 
+find_path(ZSTD_INCLUDE_DIR zstd.h /usr/include /usr/local/include $ENV{ZSTD_ROOT} $ENV{ZSTD_ROOT}/include DOC "directory containing zstd.h for ZSTD library")  
+find_library(ZSTD_LIBRARY NAMES zstd libzstd zstd_static PATHS /usr/lib /usr/local/lib $ENV{ZSTD_ROOT}/lib $ENV{ZSTD_ROOT} DOC "ZSTD library file") 
+ 
+if (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY) 
+	set(ZSTD_FOUND TRUE) 
+else () 
+	set(ZSTD_FOUND FALSE) 
+endif () 
+ 
+if (ZSTD_FOUND) 
+	if (NOT ZSTD_FIND_QUIETLY) 
+		message(STATUS "Found ZSTD library: ${ZSTD_LIBRARY}") 
+		message(STATUS "Found ZSTD include: ${ZSTD_INCLUDE_DIR}") 
+	endif () 
+else () 
+	if (ZSTD_FIND_REQUIRED) 
+		message(FATAL_ERROR "Could not find ZSTD") 
+	endif () 
+endif () 
+
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY}) 
@@ -1,5 +1,6 @@
 
 #include "CmrCartesianKSpaceBinningCineGadget.h"
+#include <future>
 
 namespace Gadgetron {
 
@@ -27,53 +28,58 @@ namespace Gadgetron {
         //    GDEBUG("Error parsing ISMRMRD Header");
         //}
 
-        binning_reconer_.debug_folder_                                   = this->debug_folder_full_path_;
-        binning_reconer_.perform_timing_                                 = this->perform_timing.value();
-        binning_reconer_.verbose_                                        = this->verbose.value();
-
-        binning_reconer_.use_multiple_channel_recon_                     = this->use_multiple_channel_recon.value();
-        binning_reconer_.use_paralell_imaging_binning_recon_             = true;
-        binning_reconer_.use_nonlinear_binning_recon_                    = this->use_nonlinear_binning_recon.value();
-
-        binning_reconer_.estimate_respiratory_navigator_                 = true;
-        binning_reconer_.respiratory_navigator_moco_reg_strength_        = this->respiratory_navigator_moco_reg_strength.value();
-        binning_reconer_.respiratory_navigator_moco_iters_               = this->respiratory_navigator_moco_iters.value();
-
-        binning_reconer_.time_tick_                                      = this->time_tick.value();
-        binning_reconer_.trigger_time_index_                             = 0;
-        binning_reconer_.arrhythmia_rejector_factor_                     = this->arrhythmia_rejector_factor.value();
-
-        binning_reconer_.grappa_kSize_RO_                                = this->grappa_kSize_RO.value();
-        binning_reconer_.grappa_kSize_E1_                                = this->grappa_kSize_E1.value();
-        binning_reconer_.grappa_reg_lamda_                               = this->grappa_reg_lamda.value();
-        binning_reconer_.downstream_coil_compression_num_modesKept_      = this->downstream_coil_compression_num_modesKept.value();
-        binning_reconer_.downstream_coil_compression_thres_              = this->downstream_coil_compression_thres.value();
-
-        binning_reconer_.kspace_binning_interpolate_heart_beat_images_   = this->kspace_binning_interpolate_heart_beat_images.value();
-        binning_reconer_.kspace_binning_navigator_acceptance_window_     = this->kspace_binning_navigator_acceptance_window.value();
-
-        binning_reconer_.kspace_binning_moco_reg_strength_               = this->kspace_binning_moco_reg_strength.value();
-        binning_reconer_.kspace_binning_moco_iters_                      = this->kspace_binning_moco_iters.value();
-
-        binning_reconer_.kspace_binning_max_temporal_window_             = this->kspace_binning_max_temporal_window.value();
-        binning_reconer_.kspace_binning_minimal_cardiac_phase_width_     = this->kspace_binning_minimal_cardiac_phase_width.value();
-        binning_reconer_.kspace_binning_kSize_RO_                        = this->kspace_binning_kSize_RO.value();
-        binning_reconer_.kspace_binning_kSize_E1_                        = this->kspace_binning_kSize_E1.value();
-        binning_reconer_.kspace_binning_reg_lamda_                       = this->kspace_binning_reg_lamda.value();
-        binning_reconer_.kspace_binning_linear_iter_max_                 = this->kspace_binning_linear_iter_max.value();
-        binning_reconer_.kspace_binning_linear_iter_thres_               = this->kspace_binning_linear_iter_thres.value();
-        binning_reconer_.kspace_binning_nonlinear_iter_max_              = this->kspace_binning_nonlinear_iter_max.value();
-        binning_reconer_.kspace_binning_nonlinear_iter_thres_            = this->kspace_binning_nonlinear_iter_thres.value();
-        binning_reconer_.kspace_binning_nonlinear_data_fidelity_lamda_   = this->kspace_binning_nonlinear_data_fidelity_lamda.value();
-        binning_reconer_.kspace_binning_nonlinear_image_reg_lamda_       = this->kspace_binning_nonlinear_image_reg_lamda.value();
-        binning_reconer_.kspace_binning_nonlinear_reg_N_weighting_ratio_ = this->kspace_binning_nonlinear_reg_N_weighting_ratio.value();
-        binning_reconer_.kspace_binning_nonlinear_reg_use_coil_sen_map_  = this->kspace_binning_nonlinear_reg_use_coil_sen_map.value();
-        binning_reconer_.kspace_binning_nonlinear_reg_with_approx_coeff_ = this->kspace_binning_nonlinear_reg_with_approx_coeff.value();
-        binning_reconer_.kspace_binning_nonlinear_reg_wav_name_          = this->kspace_binning_nonlinear_reg_wav_name.value();
+        this->configure_binning_reconer(binning_reconer_);
 
         return GADGET_OK;
     }
 
+    void CmrCartesianKSpaceBinningCineGadget::configure_binning_reconer(Gadgetron::CmrKSpaceBinning<float>& reconer)
+    {
+        reconer.debug_folder_                                   = this->debug_folder_full_path_;
+        reconer.perform_timing_                                 = this->perform_timing.value();
+        reconer.verbose_                                        = this->verbose.value();
+
+        reconer.use_multiple_channel_recon_                     = this->use_multiple_channel_recon.value();
+        reconer.use_paralell_imaging_binning_recon_             = true;
+        reconer.use_nonlinear_binning_recon_                    = this->use_nonlinear_binning_recon.value();
+
+        reconer.estimate_respiratory_navigator_                 = true;
+        reconer.respiratory_navigator_moco_reg_strength_        = this->respiratory_navigator_moco_reg_strength.value();
+        reconer.respiratory_navigator_moco_iters_               = this->respiratory_navigator_moco_iters.value();
+
+        reconer.time_tick_                                      = this->time_tick.value();
+        reconer.trigger_time_index_                             = 0;
+        reconer.arrhythmia_rejector_factor_                     = this->arrhythmia_rejector_factor.value();
+
+        reconer.grappa_kSize_RO_                                = this->grappa_kSize_RO.value();
+        reconer.grappa_kSize_E1_                                = this->grappa_kSize_E1.value();
+        reconer.grappa_reg_lamda_                               = this->grappa_reg_lamda.value();
+        reconer.downstream_coil_compression_num_modesKept_      = this->downstream_coil_compression_num_modesKept.value();
+        reconer.downstream_coil_compression_thres_              = this->downstream_coil_compression_thres.value();
+
+        reconer.kspace_binning_interpolate_heart_beat_images_   = this->kspace_binning_interpolate_heart_beat_images.value();
+        reconer.kspace_binning_navigator_acceptance_window_     = this->kspace_binning_navigator_acceptance_window.value();
+
+        reconer.kspace_binning_moco_reg_strength_               = this->kspace_binning_moco_reg_strength.value();
+        reconer.kspace_binning_moco_iters_                      = this->kspace_binning_moco_iters.value();
+
+        reconer.kspace_binning_max_temporal_window_             = this->kspace_binning_max_temporal_window.value();
+        reconer.kspace_binning_minimal_cardiac_phase_width_     = this->kspace_binning_minimal_cardiac_phase_width.value();
+        reconer.kspace_binning_kSize_RO_                        = this->kspace_binning_kSize_RO.value();
+        reconer.kspace_binning_kSize_E1_                        = this->kspace_binning_kSize_E1.value();
+        reconer.kspace_binning_reg_lamda_                       = this->kspace_binning_reg_lamda.value();
+        reconer.kspace_binning_linear_iter_max_                 = this->kspace_binning_linear_iter_max.value();
+        reconer.kspace_binning_linear_iter_thres_               = this->kspace_binning_linear_iter_thres.value();
+        reconer.kspace_binning_nonlinear_iter_max_              = this->kspace_binning_nonlinear_iter_max.value();
+        reconer.kspace_binning_nonlinear_iter_thres_            = this->kspace_binning_nonlinear_iter_thres.value();
+        reconer.kspace_binning_nonlinear_data_fidelity_lamda_   = this->kspace_binning_nonlinear_data_fidelity_lamda.value();
+        reconer.kspace_binning_nonlinear_image_reg_lamda_       = this->kspace_binning_nonlinear_image_reg_lamda.value();
+        reconer.kspace_binning_nonlinear_reg_N_weighting_ratio_ = this->kspace_binning_nonlinear_reg_N_weighting_ratio.value();
+        reconer.kspace_binning_nonlinear_reg_use_coil_sen_map_  = this->kspace_binning_nonlinear_reg_use_coil_sen_map.value();
+        reconer.kspace_binning_nonlinear_reg_with_approx_coeff_ = this->kspace_binning_nonlinear_reg_with_approx_coeff.value();
+        reconer.kspace_binning_nonlinear_reg_wav_name_          = this->kspace_binning_nonlinear_reg_wav_name.value();
+    }
+
     int CmrCartesianKSpaceBinningCineGadget::process(Gadgetron::GadgetContainerMessage< IsmrmrdReconData >* m1)
     {
         if (perform_timing.value()) { gt_timer_local_.start("CmrCartesianKSpaceBinningCineGadget::process"); }
@@ -236,69 +242,79 @@ namespace Gadgetron {
             acq_time_binning_.create(binned_N, S, SLC);
             cpt_time_binning_.create(binned_N, S, SLC);
 
-            size_t n, s, slc;
+            // the binning of a slice only depends on its own data, so the binning of the next slice
+            // overlaps with the recon on the binned kspace of the current slice
+            bool pipelined = this->kspace_binning_pipeline_slices.value() && (SLC > 1);
+
+            std::vector< boost::shared_ptr< Gadgetron::CmrKSpaceBinning<float> > > reconers(SLC);
+            std::future<void> binned_recon;
+            long long binned_recon_slc = -1;
+
+            size_t slc;
             for (slc=0; slc<SLC; slc++)
             {
-                std::stringstream os;
-                os << "_encoding_" << encoding << "_SLC_" << slc;
-
                 GDEBUG_CONDITION_STREAM(verbose.value(), "Processing binning on SLC : " << slc << " , encoding space : " << encoding);
 
+                reconers[slc] = boost::shared_ptr< Gadgetron::CmrKSpaceBinning<float> >(new Gadgetron::CmrKSpaceBinning<float>());
+                Gadgetron::CmrKSpaceBinning<float>& reconer = *reconers[slc];
+                this->configure_binning_reconer(reconer);
+
                 // set up the binning object
-                binning_reconer_.binning_obj_.data_.create(RO, E1, CHA, N, S, recon_bit.data_.data_.begin()+slc*RO*E1*CHA*N*S);
-                binning_reconer_.binning_obj_.sampling_ = recon_bit.data_.sampling_;
-                binning_reconer_.binning_obj_.headers_.create(E1, N, S, recon_bit.data_.headers_.begin()+slc*E1*N*S);
+                reconer.binning_obj_.data_.create(RO, E1, CHA, N, S, recon_bit.data_.data_.begin()+slc*RO*E1*CHA*N*S);
+                reconer.binning_obj_.sampling_ = recon_bit.data_.sampling_;
+                reconer.binning_obj_.headers_.create(E1, N, S, recon_bit.data_.headers_.begin()+slc*E1*N*S);
 
-                binning_reconer_.binning_obj_.output_N_ = binned_N;
-                binning_reconer_.binning_obj_.accel_factor_E1_ = acceFactorE1_[encoding];
-                binning_reconer_.binning_obj_.random_sampling_ = (calib_mode_[encoding]!=ISMRMRD_embedded 
+                reconer.binning_obj_.output_N_ = binned_N;
+                reconer.binning_obj_.accel_factor_E1_ = acceFactorE1_[encoding];
+                reconer.binning_obj_.random_sampling_ = (calib_mode_[encoding]!=ISMRMRD_embedded 
                                                                 && calib_mode_[encoding]!=ISMRMRD_interleaved 
                                                                 && calib_mode_[encoding]!=ISMRMRD_separate 
                                                                 && calib_mode_[encoding]!=ISMRMRD_noacceleration);
 
-                // if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(binning_reconer_.binning_obj_.data_, debug_folder_full_path_ + "binning_obj_data" + os.str()); }
-
                 // compute the binning
                 if (perform_timing.value()) { timer.start("compute binning ... "); }
+                bool binning_done = true;
                 try
                 {
-                    binning_reconer_.process_binning_recon();
+                    reconer.process_binning();
                 }
                 catch(...)
                 {
-                    GERROR_STREAM("Exceptions happened in binning_reconer_.process_binning_recon() for slice " << slc);
-                    continue;
+                    GERROR_STREAM("Exceptions happened in reconer.process_binning() for slice " << slc);
+                    binning_done = false;
                 }
                 if (perform_timing.value()) { timer.stop(); }
 
-                if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(binning_reconer_.binning_obj_.complex_image_raw_, debug_folder_full_path_ + "binning_obj_complex_image_raw" + os.str()); }
-                if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(binning_reconer_.binning_obj_.complex_image_binning_, debug_folder_full_path_ + "binning_obj_complex_image_binning" + os.str()); }
+                // finish the binned recon of the previous slice
+                if (binned_recon_slc >= 0)
+                {
+                    this->finish_binned_recon(binned_recon, reconers, (size_t)binned_recon_slc, encoding);
+                    binned_recon_slc = -1;
+                }
 
-                // get the binnig results
-                memcpy(this->res_raw_.data_.begin()+slc*RO*E1*N*S*SLC, 
-                        binning_reconer_.binning_obj_.complex_image_raw_.begin(), 
-                        binning_reconer_.binning_obj_.complex_image_raw_.get_number_of_bytes());
+                if (!binning_done)
+                {
+                    reconers[slc].reset();
+                    continue;
+                }
 
-                memcpy(this->res_binning_.data_.begin()+slc*RO*E1*binned_N*S*SLC, 
-                        binning_reconer_.binning_obj_.complex_image_binning_.begin(), 
-                        binning_reconer_.binning_obj_.complex_image_binning_.get_number_of_bytes());
+                // without pipelining, the binned recon runs in this thread when its results are collected
+                boost::shared_ptr< Gadgetron::CmrKSpaceBinning<float> > r = reconers[slc];
+                binned_recon = std::async(pipelined ? std::launch::async : std::launch::deferred, [r]() { r->process_binned_recon(); });
+                binned_recon_slc = (long long)slc;
 
-                for (s=0; s<S; s++)
+                if (!pipelined)
                 {
-                    for (n=0; n<N; n++)
-                    {
-                        acq_time_raw_(n, s, slc) = binning_reconer_.binning_obj_.phs_time_stamp_(n, s);
-                        cpt_time_raw_(n, s, slc) = binning_reconer_.binning_obj_.phs_cpt_time_stamp_(n, s);
-                    }
-
-                    for (n=0; n<binned_N; n++)
-                    {
-                        acq_time_binning_(n, s, slc) = binning_reconer_.binning_obj_.phs_time_stamp_(n, s);
-                        cpt_time_binning_(n, s, slc) = binning_reconer_.binning_obj_.mean_RR_ * binning_reconer_.binning_obj_.desired_cpt_[n];
-                    }
+                    this->finish_binned_recon(binned_recon, reconers, slc, encoding);
+                    binned_recon_slc = -1;
                 }
             }
 
+            if (binned_recon_slc >= 0)
+            {
+                this->finish_binned_recon(binned_recon, reconers, (size_t)binned_recon_slc, encoding);
+            }
+
             std::stringstream os;
             os << "_encoding_" << encoding;
 
@@ -317,6 +333,62 @@ namespace Gadgetron {
         }
     }
 
+    void CmrCartesianKSpaceBinningCineGadget::finish_binned_recon(std::future<void>& binned_recon, std::vector< boost::shared_ptr< Gadgetron::CmrKSpaceBinning<float> > >& reconers, size_t slc, size_t encoding)
+    {
+        try
+        {
+            binned_recon.get();
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Exceptions happened in reconer.process_binned_recon() for slice " << slc);
+            reconers[slc].reset();
+            return;
+        }
+
+        Gadgetron::CmrKSpaceBinning<float>& reconer = *reconers[slc];
+
+        size_t RO = res_raw_.data_.get_size(0);
+        size_t E1 = res_raw_.data_.get_size(1);
+        size_t N = res_raw_.data_.get_size(4);
+        size_t S = res_raw_.data_.get_size(5);
+        size_t binned_N = res_binning_.data_.get_size(4);
+
+        std::stringstream os;
+        os << "_encoding_" << encoding << "_SLC_" << slc;
+
+        if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(reconer.binning_obj_.complex_image_raw_, debug_folder_full_path_ + "binning_obj_complex_image_raw" + os.str()); }
+        if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(reconer.binning_obj_.complex_image_binning_, debug_folder_full_path_ + "binning_obj_complex_image_binning" + os.str()); }
+
+        // get the binnig results
+        memcpy(this->res_raw_.data_.begin()+slc*RO*E1*N*S, 
+                reconer.binning_obj_.complex_image_raw_.begin(), 
+                reconer.binning_obj_.complex_image_raw_.get_number_of_bytes());
+
+        memcpy(this->res_binning_.data_.begin()+slc*RO*E1*binned_N*S, 
+                reconer.binning_obj_.complex_image_binning_.begin(), 
+                reconer.binning_obj_.complex_image_binning_.get_number_of_bytes());
+
+        size_t n, s;
+        for (s=0; s<S; s++)
+        {
+            for (n=0; n<N; n++)
+            {
+                acq_time_raw_(n, s, slc) = reconer.binning_obj_.phs_time_stamp_(n, s);
+                cpt_time_raw_(n, s, slc) = reconer.binning_obj_.phs_cpt_time_stamp_(n, s);
+            }
+
+            for (n=0; n<binned_N; n++)
+            {
+                acq_time_binning_(n, s, slc) = reconer.binning_obj_.phs_time_stamp_(n, s);
+                cpt_time_binning_(n, s, slc) = reconer.binning_obj_.mean_RR_ * reconer.binning_obj_.desired_cpt_[n];
+            }
+        }
+
+        // release the slice
+        reconers[slc].reset();
+    }
+
     void CmrCartesianKSpaceBinningCineGadget::create_binning_image_headers_from_raw()
     {
         try
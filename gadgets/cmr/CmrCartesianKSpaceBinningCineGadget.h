@@ -23,6 +23,7 @@
 #include "gadgetron_cmr_export.h"
 #include "GenericReconGadget.h"
 #include "cmr_kspace_binning.h"
+#include <future>
 
 namespace Gadgetron {
 
@@ -38,6 +39,7 @@ namespace Gadgetron {
 
         /// parameters for workflow
         GADGET_PROPERTY(use_multiple_channel_recon, bool, "Whether to perform multi-channel recon in the raw data step", true);
+        GADGET_PROPERTY(kspace_binning_pipeline_slices, bool, "Whether to overlap the binning of the next slice with the binned kspace recon of the current slice", true);
         GADGET_PROPERTY(use_nonlinear_binning_recon, bool, "Whether to non-linear recon in the binning step", true);
         GADGET_PROPERTY(number_of_output_phases, int, "Number of output phases after binning", 30);
 
@@ -139,6 +141,12 @@ namespace Gadgetron {
         // --------------------------------------------------
         virtual void perform_binning(IsmrmrdReconBit& recon_bit, size_t encoding);
 
+        // set the parameters of a binning reconer from the gadget properties
+        void configure_binning_reconer(Gadgetron::CmrKSpaceBinning<float>& reconer);
+
+        // wait for the binned kspace recon of a slice and copy its results
+        void finish_binned_recon(std::future<void>& binned_recon, std::vector< boost::shared_ptr< Gadgetron::CmrKSpaceBinning<float> > >& reconers, size_t slc, size_t encoding);
+
         // create binning image header
         void create_binning_image_headers_from_raw();
 
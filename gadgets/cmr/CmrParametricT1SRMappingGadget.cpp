@@ -115,6 +115,8 @@ namespace Gadgetron {
             t1_sr.max_iter_ = max_iter.value();
             t1_sr.thres_fun_ = thres_func.value();
             t1_sr.max_map_value_ = max_T1.value();
+            t1_sr.batch_fitting_ = batch_fitting.value();
+            t1_sr.dictionary_initialization_ = dictionary_initialization.value();
 
             t1_sr.verbose_ = verbose.value();
             t1_sr.debug_folder_ = debug_folder_full_path_;
@@ -27,6 +27,8 @@ namespace Gadgetron {
         GADGET_PROPERTY(max_iter, size_t, "Maximal number of iterations", 150);
         GADGET_PROPERTY(thres_func, double, "Threshold for minimal change of cost function", 1e-4);
         GADGET_PROPERTY(max_T1, double, "Maximal T1 allowed in mapping (ms)", 4000);
+        GADGET_PROPERTY(batch_fitting, bool, "Whether to fit the pixels in batches with the vectorised solver", true);
+        GADGET_PROPERTY(dictionary_initialization, bool, "Whether to initialize the fitting with the best matching atom of a T1 dictionary", true);
 
         GADGET_PROPERTY(anchor_image_index, size_t, "Index for anchor image; by default, the first image is the anchor (without SR pulse)", 0);
         GADGET_PROPERTY(anchor_TS, double, "Saturation time for anchor", 10000);
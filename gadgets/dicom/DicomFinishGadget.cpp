@@ -2,6 +2,7 @@
 #include "boost/date_time/gregorian/gregorian.hpp"
 
 #include "DicomFinishGadget.h"
+#include "GadgetWorkerPool.h"
 #include "ismrmrd/xml.h"
 
 namespace Gadgetron {
@@ -14,6 +15,7 @@ namespace Gadgetron {
         xml = h;
 
         Gadgetron::fill_dicom_image_from_ismrmrd_header(h, dcmFile);
+        seriesTemplates.clear();
 
         ISMRMRD::MeasurementInformation meas_info = *h.measurementInformation;
 
@@ -31,6 +33,139 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    int DicomFinishGadget::close(unsigned long flags)
+    {
+        int rval = BaseClass::close(flags);
+
+        if (flags == 1)
+        {
+            // the gadget thread has finished, no more images are submitted
+            std::unique_lock<std::mutex> lock(encoding_mutex_);
+            encoding_done_.wait(lock, [this]() { return next_sent_ == next_encoding_; });
+
+            if (encoding_failed_)
+            {
+                GERROR("DicomFinishGadget, not all images could be converted to DICOM\n");
+                rval = GADGET_FAIL;
+            }
+        }
+
+        return rval;
+    }
+
+    const DcmFileFormat& DicomFinishGadget::get_series_template(unsigned int series_number, std::string& seriesIUID)
+    {
+        // Try to find an already-generated Series Instance UID in our map
+        std::map<unsigned int, std::string>::iterator it = seriesIUIDs.find(series_number);
+
+        if (it == seriesIUIDs.end()) {
+            // Didn't find a Series Instance UID for this series number
+            char prefix[32];
+            char newuid[96];
+            if (seriesIUIDRoot.length() > 20) {
+                memcpy(prefix, seriesIUIDRoot.c_str(), 20);
+                prefix[20] = '\0';
+                dcmGenerateUniqueIdentifier(newuid, prefix);
+            }
+            else {
+                dcmGenerateUniqueIdentifier(newuid);
+            }
+            seriesIUIDs[series_number] = std::string(newuid);
+        }
+
+        seriesIUID = seriesIUIDs[series_number];
+
+        std::map<unsigned int, DcmFileFormat>::iterator t = seriesTemplates.find(series_number);
+        if (t == seriesTemplates.end())
+        {
+            // the tags from the ismrmrd header plus the Series Instance UID
+            DcmFileFormat& series_template = seriesTemplates[series_number];
+            series_template = dcmFile;
+
+            DcmTagKey key(0x0020, 0x000E);
+            Gadgetron::write_dcm_string(series_template.getDataset(), key, seriesIUID.c_str());
+
+            return series_template;
+        }
+
+        return t->second;
+    }
+
+    int DicomFinishGadget::encode_and_send(ACE_Message_Block* m1, ACE_Message_Block* mb, std::function<void()> encode)
+    {
+        if (!parallel_encoding.value())
+        {
+            // on failure m1 is released by the caller of process
+            try
+            {
+                encode();
+            }
+            catch (...)
+            {
+                mb->release();
+                throw;
+            }
+
+            m1->release();
+
+            if (this->send_message(mb) < 0)
+            {
+                GDEBUG("Failed to return message to controller\n");
+                return GADGET_FAIL;
+            }
+
+            return GADGET_OK;
+        }
+
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(encoding_mutex_);
+            encoding_controller_ = this->controller_;
+            index = next_encoding_++;
+        }
+
+        GadgetWorkerPool::instance()->submit([this, m1, mb, encode, index]()
+        {
+            bool ok = true;
+            try
+            {
+                encode();
+            }
+            catch (...)
+            {
+                GERROR("DicomFinishGadget, failed to convert image to DICOM\n");
+                ok = false;
+            }
+
+            m1->release();
+            if (!ok) mb->release();
+
+            std::lock_guard<std::mutex> lock(encoding_mutex_);
+            if (!ok) encoding_failed_ = true;
+            encoded_[index] = ok ? mb : 0;
+            this->send_encoded();
+            encoding_done_.notify_all();
+        });
+
+        return GADGET_OK;
+    }
+
+    void DicomFinishGadget::send_encoded()
+    {
+        for (std::map<size_t, ACE_Message_Block*>::iterator it = encoded_.find(next_sent_); it != encoded_.end(); it = encoded_.find(next_sent_))
+        {
+            ACE_Message_Block* mb = it->second;
+            encoded_.erase(it);
+            next_sent_++;
+
+            if (mb && encoding_controller_->output_ready(mb) < 0)
+            {
+                GDEBUG("Failed to return message to controller\n");
+                encoding_failed_ = true;
+            }
+        }
+    }
+
     int DicomFinishGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1)
     {
         if (!this->controller_) {
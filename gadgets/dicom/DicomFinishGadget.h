@@ -32,6 +32,9 @@ The dicom image is sent out with message id -> dicom image -> dicom image name -
 #include <string>
 #include <map>
 #include <complex>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 namespace Gadgetron
 {
@@ -48,12 +51,22 @@ namespace Gadgetron
             , dcmFile()
             , initialSeriesNumber(0)
             , seriesIUIDRoot()
+            , encoding_controller_(0)
+            , next_encoding_(0)
+            , next_sent_(0)
+            , encoding_failed_(false)
         { }
 
     protected:
 
+        GADGET_PROPERTY(parallel_encoding, bool, "If true, images are converted to DICOM on the worker pool and sent out in order", true);
+
         virtual int process_config(ACE_Message_Block * mb);
         virtual int process(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1);
+
+        /// waits until all images have been converted and sent
+        virtual int close(unsigned long flags);
+
         virtual int send_message(ACE_Message_Block *mb)
         {
             return this->controller_->output_ready(mb);
@@ -63,6 +76,12 @@ namespace Gadgetron
         int write_data_attrib(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1, GadgetContainerMessage< hoNDArray< T > >* m2)
         {
 
+            {
+                // an image that failed on the worker pool fails the chain
+                std::lock_guard<std::mutex> lock(encoding_mutex_);
+                if (encoding_failed_) return GADGET_FAIL;
+            }
+
             GadgetContainerMessage< ISMRMRD::MetaContainer >* m3 = AsContainerMessage< ISMRMRD::MetaContainer >(m2->cont());
 
             std::string filename;
@@ -130,44 +149,16 @@ namespace Gadgetron
 
             unsigned short series_number = m1->getObjectPtr()->image_series_index + 1;
 
-            // Try to find an already-generated Series Instance UID in our map
-            std::map<unsigned int, std::string>::iterator it = seriesIUIDs.find(series_number);
-
-            if (it == seriesIUIDs.end()) {
-                // Didn't find a Series Instance UID for this series number
-                char prefix[32];
-                char newuid[96];
-                if (seriesIUIDRoot.length() > 20) {
-                    memcpy(prefix, seriesIUIDRoot.c_str(), 20);
-                    prefix[20] = '\0';
-                    dcmGenerateUniqueIdentifier(newuid, prefix);
-                }
-                else {
-                    dcmGenerateUniqueIdentifier(newuid);
-                }
-                seriesIUIDs[series_number] = std::string(newuid);
-            }
-
-            // --------------------------------------------------
-
-            if(m3)
-            {
-                Gadgetron::write_ismrmd_image_into_dicom(*m1->getObjectPtr(), *m2->getObjectPtr(), xml, *m3->getObjectPtr(), seriesIUIDs[series_number], dcmFile);
-            }
-            else
-            {
-                ISMRMRD::MetaContainer attrib;
-                Gadgetron::write_ismrmd_image_into_dicom(*m1->getObjectPtr(), *m2->getObjectPtr(), xml, attrib, seriesIUIDs[series_number], dcmFile);
-            }
+            // the tags shared by all images of the series are filled once
+            std::string seriesIUID;
+            const DcmFileFormat& series_template = this->get_series_template(series_number, seriesIUID);
 
             // --------------------------------------------------
-            /* release the old data array */
+            /* the meta attributes go out with the dicom image */
             m2->cont(NULL); // still need m3
-            m1->release();
 
             GadgetContainerMessage<DcmFileFormat>* mdcm = new GadgetContainerMessage<DcmFileFormat>();
-
-            *mdcm->getObjectPtr() = dcmFile;
+            *mdcm->getObjectPtr() = series_template;
 
             GadgetContainerMessage<GadgetMessageIdentifier>* mb =
                 new GadgetContainerMessage<GadgetMessageIdentifier>();
@@ -182,23 +173,54 @@ namespace Gadgetron
                 mfilename->cont(m3);
             }
 
-            int ret = this->send_message(mb);
-
-            if ((ret < 0))
+            // the image is written straight into the outgoing dicom object
+            ISMRMRD::IsmrmrdHeader* h = &xml;
+            std::function<void()> encode = [m1, m2, m3, mdcm, h, seriesIUID]()
             {
-                GDEBUG("Failed to return message to controller\n");
-                return GADGET_FAIL;
-            }
+                std::string uid(seriesIUID);
+                if (m3)
+                {
+                    Gadgetron::write_ismrmd_image_into_dicom(*m1->getObjectPtr(), *m2->getObjectPtr(), *h, *m3->getObjectPtr(), uid, *mdcm->getObjectPtr());
+                }
+                else
+                {
+                    ISMRMRD::MetaContainer attrib;
+                    Gadgetron::write_ismrmd_image_into_dicom(*m1->getObjectPtr(), *m2->getObjectPtr(), *h, attrib, uid, *mdcm->getObjectPtr());
+                }
+            };
 
-            return GADGET_OK;
+            return this->encode_and_send(m1, mb, encode);
         }
 
+        /// returns the template of a series, creating its Series Instance UID if the series is new
+        const DcmFileFormat& get_series_template(unsigned int series_number, std::string& seriesIUID);
+
+        /**
+           Runs encode and sends mb, on the worker pool if parallel_encoding is set. The image message m1 is
+           released once it is encoded. If encode throws, mb is released and the failure is reported right
+           away, or with the next image or close() when encoding on the worker pool.
+        */
+        int encode_and_send(ACE_Message_Block* m1, ACE_Message_Block* mb, std::function<void()> encode);
+
+        /// sends the encoded images that are next in line, encoding_mutex_ must be held
+        void send_encoded();
+
     private:
         ISMRMRD::IsmrmrdHeader xml;
         DcmFileFormat dcmFile;
         std::string seriesIUIDRoot;
         long initialSeriesNumber;
         std::map <unsigned int, std::string> seriesIUIDs;
+        std::map <unsigned int, DcmFileFormat> seriesTemplates;
+
+        // images encoded on the worker pool, sent out in the order they came in
+        GadgetStreamController* encoding_controller_;
+        std::mutex encoding_mutex_;
+        std::condition_variable encoding_done_;
+        std::map<size_t, ACE_Message_Block*> encoded_;
+        size_t next_encoding_;
+        size_t next_sent_;
+        bool encoding_failed_;
     };
 
 } /* namespace Gadgetron */
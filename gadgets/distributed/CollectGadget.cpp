@@ -3,6 +3,10 @@
 #include "GadgetMRIHeaders.h"
 #include "GadgetIsmrmrdReadWrite.h"
 #include "GadgetStreamInterface.h"
+#include "hoNDArray.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace Gadgetron{
 
@@ -18,11 +22,275 @@ namespace Gadgetron{
   }
 
   CollectGadget::CollectGadget()
+    : parallel_jobs_(false)
+    , head_sequence_(0)
+    , held_results_(0)
+    , readout_chunks_(0)
+    , readout_size_(0)
+    , chunk_size_(0)
   {
   }
 
   CollectGadget::~CollectGadget()
   {
+    for (auto it = held_.begin(); it != held_.end(); it++) {
+      for (auto m = it->second.begin(); m != it->second.end(); m++) (*m)->release();
+    }
+    for (auto it = chunked_images_.begin(); it != chunked_images_.end(); it++) {
+      if (it->second.image) it->second.image->release();
+    }
+  }
+
+  void CollectGadget::set_readout_chunks(size_t chunks, size_t readout_size, size_t chunk_size)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    this->release_chunked_images();
+    readout_chunks_ = chunks;
+    readout_size_ = readout_size;
+    chunk_size_ = chunk_size;
+    sequence_chunk_.clear();
+  }
+
+  void CollectGadget::set_readout_chunk(size_t sequence, size_t group, size_t chunk)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    sequence_chunk_[sequence] = std::make_pair(group, chunk);
+  }
+
+  template <typename T> bool CollectGadget::copy_chunk(ACE_Message_Block* m, ChunkedImage& img, size_t chunk)
+  {
+    auto d = AsContainerMessage< hoNDArray<T> >(m->cont());
+    if (!d) return false;
+
+    hoNDArray<T>& in = *d->getObjectPtr();
+    if (in.get_size(0) != chunk_size_) {
+      GERROR("CollectGadget, image of readout chunk %d has %d pixels along x, expected %d\n", (int)chunk, (int)in.get_size(0), (int)chunk_size_);
+      return true;
+    }
+
+    //The first chunk that arrives brings the header and the meta attributes
+    if (!img.image) {
+      auto h = new GadgetContainerMessage<ISMRMRD::ImageHeader>();
+      *h->getObjectPtr() = *AsContainerMessage<ISMRMRD::ImageHeader>(m)->getObjectPtr();
+      h->getObjectPtr()->matrix_size[0] = readout_size_;
+      h->getObjectPtr()->field_of_view[0] *= (float)readout_size_ / (float)chunk_size_;
+
+      std::vector<size_t> dims;
+      in.get_dimensions(dims);
+      dims[0] = readout_size_;
+      auto out = new GadgetContainerMessage< hoNDArray<T> >();
+      out->getObjectPtr()->create(dims);
+      memset(out->getObjectPtr()->get_data_ptr(), 0, out->getObjectPtr()->get_number_of_bytes());
+
+      h->cont(out);
+      out->cont(d->cont());
+      d->cont(0);
+      img.image = h;
+    }
+
+    hoNDArray<T>& out = *AsContainerMessage< hoNDArray<T> >(img.image->cont())->getObjectPtr();
+    size_t lines = in.get_number_of_elements() / chunk_size_;
+    if (out.get_number_of_elements() != lines*readout_size_) {
+      GERROR("CollectGadget, image of readout chunk %d does not match the other chunks\n", (int)chunk);
+      return true;
+    }
+
+    //The last chunk reaches beyond the field of view
+    size_t start = chunk*chunk_size_;
+    size_t len = (start < readout_size_) ? std::min(chunk_size_, readout_size_ - start) : 0;
+    for (size_t l = 0; l < lines; l++) {
+      memcpy(out.get_data_ptr() + l*readout_size_ + start, in.get_data_ptr() + l*chunk_size_, len*sizeof(T));
+    }
+
+    return true;
+  }
+
+  ACE_Message_Block* CollectGadget::assemble_chunk(ACE_Message_Block* m, size_t sequence)
+  {
+    auto h = AsContainerMessage<ISMRMRD::ImageHeader>(m);
+    auto sc = sequence_chunk_.find(sequence);
+    if (!h || sc == sequence_chunk_.end()) return m;
+
+    size_t group = sc->second.first;
+    size_t chunk = sc->second.second;
+
+    //The chunks of an image have the same indices, they only differ in their job
+    const ISMRMRD::ImageHeader& ih = *h->getObjectPtr();
+    std::vector<size_t> key = { group, ih.image_series_index, ih.image_index, ih.image_type, ih.average, ih.slice,
+                                ih.contrast, ih.phase, ih.repetition, ih.set };
+
+    ChunkedImage& img = chunked_images_[key];
+    bool copied = copy_chunk< std::complex<float> >(m, img, chunk)
+      || copy_chunk<float>(m, img, chunk)
+      || copy_chunk< std::complex<double> >(m, img, chunk)
+      || copy_chunk<double>(m, img, chunk)
+      || copy_chunk<unsigned short>(m, img, chunk)
+      || copy_chunk<short>(m, img, chunk);
+
+    if (!copied) {
+      GERROR("CollectGadget, unsupported image data type of readout chunk %d, passed on as it is\n", (int)chunk);
+      if (!img.image) chunked_images_.erase(key);
+      return m;
+    }
+
+    m->release();
+    img.chunks.insert(chunk);
+    if (img.chunks.size() < readout_chunks_) return 0;
+
+    ACE_Message_Block* complete = img.image;
+    chunked_images_.erase(key);
+    return complete;
+  }
+
+  int CollectGadget::release_chunked_images()
+  {
+    int ret = GADGET_OK;
+    for (auto it = chunked_images_.begin(); it != chunked_images_.end(); it++) {
+      if (!it->second.image) continue;
+      GWARN("CollectGadget, passing on an image with %d of %d readout chunks\n", (int)it->second.chunks.size(), (int)readout_chunks_);
+      if (this->putq(it->second.image) == -1) {
+        GERROR("CollectGadget::release_chunked_images, failed to put image on queue\n");
+        it->second.image->release();
+        ret = GADGET_FAIL;
+      }
+    }
+    chunked_images_.clear();
+    return ret;
+  }
+
+  int CollectGadget::release_sequence(size_t sequence)
+  {
+    auto it = held_.find(sequence);
+    if (it == held_.end()) return GADGET_OK;
+
+    std::list<ACE_Message_Block*> results;
+    results.swap(it->second);
+    held_.erase(it);
+    held_results_ -= results.size();
+
+    int ret = GADGET_OK;
+    for (auto m = results.begin(); m != results.end(); m++) {
+      if (ret == GADGET_OK && this->putq(*m) != -1) continue;
+      GERROR("CollectGadget::release_sequence, failed to put result on queue\n");
+      (*m)->release();
+      ret = GADGET_FAIL;
+    }
+    return ret;
+  }
+
+  int CollectGadget::advance_head()
+  {
+    int ret = GADGET_OK;
+    for (;;) {
+      //The head job streams, what it sent while it waited goes out first
+      bool started = held_.count(head_sequence_) > 0;
+      if (this->release_sequence(head_sequence_) != GADGET_OK) ret = GADGET_FAIL;
+
+      if (done_.erase(head_sequence_) || (parallel_jobs_ && started)) {
+        head_sequence_++;
+        continue;
+      }
+      return ret;
+    }
+  }
+
+  void CollectGadget::set_parallel_jobs(bool parallel)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    parallel_jobs_ = parallel;
+  }
+
+  int CollectGadget::collect(ACE_Message_Block* m, size_t sequence)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (readout_chunks_ > 0) {
+        //Images combined from the chunks of several jobs are passed on as soon as they are complete
+        m = this->assemble_chunk(m, sequence);
+        if (!m) return GADGET_OK;
+        if (this->putq(m) == -1) {
+          m->release();
+          return GADGET_FAIL;
+        }
+        return GADGET_OK;
+      }
+    }
+
+    if (!reorder_results.value()) {
+      if (this->putq(m) == -1) {
+        m->release();
+        return GADGET_FAIL;
+      }
+      return GADGET_OK;
+    }
+
+    std::lock_guard<std::mutex> lk(mtx_);
+
+    //The oldest unfinished job streams, everything else waits for it
+    if (sequence <= head_sequence_) {
+      if (this->putq(m) == -1) {
+        m->release();
+        return GADGET_FAIL;
+      }
+
+      //Parallel jobs are not done before the end, the next one may go as soon as the head has sent something
+      if (parallel_jobs_ && sequence == head_sequence_) {
+        head_sequence_++;
+        return this->advance_head();
+      }
+      return GADGET_OK;
+    }
+
+    held_[sequence].push_back(m);
+    held_results_++;
+
+    int ret = GADGET_OK;
+    while (held_results_ > reorder_buffer_size.value() && !held_.empty()) {
+      size_t early = held_.begin()->first;
+      GWARN("CollectGadget, reorder buffer full, passing on results of job %d out of order\n", (int)early);
+      if (this->release_sequence(early) != GADGET_OK) ret = GADGET_FAIL;
+
+      //A parallel job that has sent something counts as passed, the head must not wait for it
+      if (parallel_jobs_) done_.insert(early);
+    }
+    return ret;
+  }
+
+  void CollectGadget::sequence_done(size_t sequence)
+  {
+    if (!reorder_results.value()) return;
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (sequence < head_sequence_) return;
+
+    done_.insert(sequence);
+    this->advance_head();
+  }
+
+  void CollectGadget::sequence_restarted(size_t sequence)
+  {
+    if (!reorder_results.value()) return;
+
+    //Results passed on already can not be taken back
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = held_.find(sequence);
+    if (it == held_.end()) return;
+
+    for (auto m = it->second.begin(); m != it->second.end(); m++) (*m)->release();
+    held_results_ -= it->second.size();
+    held_.erase(it);
+  }
+
+  int CollectGadget::close(unsigned long flags)
+  {
+    if (flags) {
+      //Whatever is still held goes out in sequence order
+      std::lock_guard<std::mutex> lk(mtx_);
+      while (!held_.empty()) this->release_sequence(held_.begin()->first);
+      done_.clear();
+      this->release_chunked_images();
+    }
+    return BasicPropertyGadget::close(flags);
   }
 
   int CollectGadget::process(ACE_Message_Block* m)
@@ -5,6 +5,11 @@
 #include "gadgetron_distributed_gadgets_export.h"
 
 #include <complex>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <mutex>
 
 namespace Gadgetron{
 
@@ -16,11 +21,84 @@ namespace Gadgetron{
     CollectGadget();
     virtual ~CollectGadget();
 
+    /**
+    Result of the job with this sequence number, called by the DistributeGadget for the results coming back from the nodes.
+
+    With reorder_results, the results of a job are held until all earlier jobs are finished (see sequence_done),
+    the results of the oldest unfinished job are passed on as they arrive. If more than reorder_buffer_size results
+    are held, the ones of the lowest sequence number are passed on, so the memory stays bounded.
+    */
+    virtual int collect(ACE_Message_Block* m, size_t sequence);
+
+    /// All results of the job with this sequence number have been collected
+    virtual void sequence_done(size_t sequence);
+
+    /// The job with this sequence number runs again on another node, the results still held are dropped
+    virtual void sequence_restarted(size_t sequence);
+
+    /**
+    The jobs run in parallel and are only done when the stream closes. A job then counts as passed once its first
+    result is passed on: as soon as a result of the next expected job arrives, it goes out together with the held
+    results of the jobs after it, up to the first job that has not sent anything yet.
+    */
+    void set_parallel_jobs(bool parallel);
+
+    /**
+    Images of jobs that reconstruct one chunk along the readout each (see IsmrmrdAcquisitionDistributeGadget::readout_chunks)
+    are put back together: the images of the chunks of a job group with the same image header indices are combined into
+    one image of readout_size pixels along x, which is passed on once all chunks have arrived. chunks = 0 switches it off.
+    */
+    void set_readout_chunks(size_t chunks, size_t readout_size, size_t chunk_size);
+
+    /// the job with this sequence number reconstructs chunk of the job group
+    void set_readout_chunk(size_t sequence, size_t group, size_t chunk);
+
+    virtual int close(unsigned long flags);
+
   protected:
     GADGET_PROPERTY(pass_through_mode, bool,
       "If true, data will simply pass through to next gadget, otherwise return to controller", false);
+    GADGET_PROPERTY(reorder_results, bool,
+      "Pass on the results of the distributed jobs in the order the jobs were started", false);
+    GADGET_PROPERTY(reorder_buffer_size, size_t,
+      "Maximal number of results held for reordering", 1024);
+
     virtual int process(ACE_Message_Block* m);
     virtual int message_id(ACE_Message_Block* m);
+
+    /// puts the held results of the sequence on the queue, mtx_ must be held
+    int release_sequence(size_t sequence);
+
+    /// moves head_sequence_ past the jobs that are done (or started, for parallel jobs), mtx_ must be held
+    int advance_head();
+
+    std::mutex mtx_;
+    bool parallel_jobs_;
+    size_t head_sequence_;
+    size_t held_results_;
+    std::map<size_t, std::list<ACE_Message_Block*> > held_;
+    std::set<size_t> done_;
+
+    /// image of the readout chunks, being put together
+    struct ChunkedImage
+    {
+      ChunkedImage() : image(0) {}
+      ACE_Message_Block* image;
+      std::set<size_t> chunks;
+    };
+
+    /// combines the image m of a readout chunk with the other chunks, returns the complete image or 0
+    ACE_Message_Block* assemble_chunk(ACE_Message_Block* m, size_t sequence);
+    template <typename T> bool copy_chunk(ACE_Message_Block* m, ChunkedImage& img, size_t chunk);
+
+    /// passes on the images of all chunks, or of the ones that arrived, mtx_ must be held
+    int release_chunked_images();
+
+    size_t readout_chunks_;
+    size_t readout_size_;
+    size_t chunk_size_;
+    std::map<size_t, std::pair<size_t, size_t> > sequence_chunk_;
+    std::map<std::vector<size_t>, ChunkedImage> chunked_images_;
   };
 }
 #endif //COLLECTGADGET_H
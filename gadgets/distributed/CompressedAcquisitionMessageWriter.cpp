@@ -0,0 +1,205 @@
+#include "CompressedAcquisitionMessageWriter.h"
+#include "GadgetContainerMessage.h"
+#include "GadgetMRIHeaders.h"
+#include "NHLBICompression.h"
+#include "hoNDArray.h"
+#include "log.h"
+
+#include <ismrmrd/ismrmrd.h>
+
+#include <chrono>
+#include <complex>
+#include <stdexcept>
+
+#if defined GADGETRON_COMPRESSION_ZFP
+#include <zfp/zfp.h>
+#endif //GADGETRON_COMPRESSION_ZFP
+
+namespace Gadgetron{
+
+  CompressedAcquisitionMessageWriter::Method CompressedAcquisitionMessageWriter::method_from_name(const std::string& name)
+  {
+    if (name == "nhlbi") return COMPRESSION_NHLBI;
+
+    if (name == "zfp") {
+#if defined GADGETRON_COMPRESSION_ZFP
+      return COMPRESSION_ZFP;
+#else
+      GWARN("CompressedAcquisitionMessageWriter, gadgetron is compiled without ZFP, NHLBI compression is used\n");
+      return COMPRESSION_NHLBI;
+#endif //GADGETRON_COMPRESSION_ZFP
+    }
+
+    if (name != "none") {
+      GWARN("CompressedAcquisitionMessageWriter, unknown compression %s, data is sent uncompressed\n", name.c_str());
+    }
+    return COMPRESSION_NONE;
+  }
+
+  CompressedAcquisitionMessageWriter::CompressedAcquisitionMessageWriter(Method method, float tolerance, unsigned int precision, bool adaptive)
+    : method_(method)
+    , tolerance_(tolerance)
+    , precision_(precision)
+    , adaptive_(adaptive)
+    , link_rate_(0)
+    , compress_rate_(0)
+    , compression_ratio_(0)
+    , compressing_(true)
+    , messages_(0)
+  {
+  }
+
+  CompressedAcquisitionMessageWriter::~CompressedAcquisitionMessageWriter()
+  {
+  }
+
+  void CompressedAcquisitionMessageWriter::update(double& estimate, double v)
+  {
+    estimate = (estimate > 0) ? (0.9*estimate + 0.1*v) : v;
+  }
+
+  bool CompressedAcquisitionMessageWriter::use_compression()
+  {
+    if (link_rate_ > 0 && compress_rate_ > 0 && compression_ratio_ > 0) {
+      //Seconds per raw byte, compressed: compress it and send 1/ratio of it
+      compressing_ = (1.0/compress_rate_ + 1.0/(link_rate_*compression_ratio_)) < 1.0/link_rate_;
+    }
+
+    messages_++;
+    if (messages_ % PROBE_INTERVAL == 0) return !compressing_;
+    return compressing_;
+  }
+
+  size_t CompressedAcquisitionMessageWriter::compress(const float* data, size_t samples, size_t channels)
+  {
+    if (method_ == COMPRESSION_NHLBI) {
+      return CompressedBuffer<float>::compress(data, samples*channels, tolerance_, static_cast<uint8_t>(precision_), buffer_);
+    }
+
+#if defined GADGETRON_COMPRESSION_ZFP
+    zfp_type type = zfp_type_float;
+    zfp_stream* zfp = zfp_stream_open(NULL);
+    zfp_field* field = zfp_field_alloc();
+
+    zfp_field_set_pointer(field, const_cast<float*>(data));
+    zfp_field_set_type(field, type);
+    zfp_field_set_size_2d(field, samples, channels);
+
+    if (tolerance_ > 0) {
+      zfp_stream_set_accuracy(zfp, tolerance_, type);
+    } else {
+      zfp_stream_set_precision(zfp, precision_, type);
+    }
+
+    buffer_.resize(zfp_stream_maximum_size(zfp, field));
+
+    bitstream* stream = stream_open(&buffer_[0], buffer_.size());
+    if (!stream) {
+      zfp_field_free(field);
+      zfp_stream_close(zfp);
+      throw std::runtime_error("Cannot open compressed stream");
+    }
+    zfp_stream_set_bit_stream(zfp, stream);
+
+    size_t zfpsize = 0;
+    if (zfp_write_header(zfp, field, ZFP_HEADER_FULL)) {
+      zfpsize = zfp_compress(zfp, field);
+    }
+
+    zfp_field_free(field);
+    zfp_stream_close(zfp);
+    stream_close(stream);
+
+    if (zfpsize == 0) {
+      throw std::runtime_error("ZFP compression failed");
+    }
+    return zfpsize;
+#else
+    throw std::runtime_error("Gadgetron is compiled without ZFP");
+#endif //GADGETRON_COMPRESSION_ZFP
+  }
+
+  int CompressedAcquisitionMessageWriter::write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+  {
+    auto h = AsContainerMessage<ISMRMRD::AcquisitionHeader>(mb);
+    if (!h) {
+      GERROR("CompressedAcquisitionMessageWriter, invalid acquisition message objects\n");
+      return -1;
+    }
+
+    //A copy, the compression flag is only set on the wire
+    ISMRMRD::AcquisitionHeader acqHead = *h->getObjectPtr();
+
+    size_t trajectory_elements = acqHead.trajectory_dimensions*acqHead.number_of_samples;
+    size_t data_elements = acqHead.active_channels*acqHead.number_of_samples;
+
+    auto d = AsContainerMessage< hoNDArray<std::complex<float> > >(h->cont());
+    auto t = AsContainerMessage< hoNDArray<float> >(d ? d->cont() : 0);
+
+    if ((data_elements && !d) || (trajectory_elements && !t)) {
+      GERROR("CompressedAcquisitionMessageWriter, missing acquisition data or trajectory\n");
+      return -1;
+    }
+
+    size_t raw_bytes = 2*sizeof(float)*data_elements;
+
+    bool compressed = (method_ != COMPRESSION_NONE) && data_elements && (!adaptive_ || this->use_compression());
+    uint32_t comp_size = 0;
+
+    if (compressed) {
+      auto t0 = std::chrono::steady_clock::now();
+      try {
+        comp_size = static_cast<uint32_t>(this->compress(reinterpret_cast<const float*>(d->getObjectPtr()->get_data_ptr()),
+                                                         acqHead.number_of_samples*2, acqHead.active_channels));
+      }
+      catch (std::runtime_error& err) {
+        GWARN("CompressedAcquisitionMessageWriter, compression failed, sending uncompressed data : %s\n", err.what());
+        compressed = false;
+      }
+
+      if (compressed) {
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s > 0) this->update(compress_rate_, raw_bytes/s);
+        if (comp_size > 0) this->update(compression_ratio_, raw_bytes/(double)comp_size);
+
+        acqHead.setFlag((method_ == COMPRESSION_ZFP) ? ISMRMRD::ISMRMRD_ACQ_COMPRESSION1 : ISMRMRD::ISMRMRD_ACQ_COMPRESSION2);
+      }
+    }
+
+    GadgetMessageIdentifier id;
+    id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION;
+
+    iovec iov[5];
+    int iovcnt = 0;
+    size_t wire_bytes = 0;
+
+    auto add = [&](void* ptr, size_t len) {
+      if (!len) return;
+      iov[iovcnt].iov_base = reinterpret_cast<char*>(ptr);
+      iov[iovcnt].iov_len = len;
+      iovcnt++;
+      wire_bytes += len;
+    };
+
+    add(&id, sizeof(GadgetMessageIdentifier));
+    add(&acqHead, sizeof(ISMRMRD::AcquisitionHeader));
+    if (trajectory_elements) add(t->getObjectPtr()->get_data_ptr(), sizeof(float)*trajectory_elements);
+    if (compressed) {
+      add(&comp_size, sizeof(uint32_t));
+      add(&buffer_[0], comp_size);
+    } else if (data_elements) {
+      add(d->getObjectPtr()->get_data_ptr(), raw_bytes);
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    if (sock->sendv_n(iov, iovcnt) <= 0) {
+      GERROR("CompressedAcquisitionMessageWriter, unable to send acquisition\n");
+      return -1;
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    if (s > 0) this->update(link_rate_, wire_bytes/s);
+
+    return 0;
+  }
+}
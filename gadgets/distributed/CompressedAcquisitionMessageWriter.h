@@ -0,0 +1,77 @@
+/** \file   CompressedAcquisitionMessageWriter.h
+    \brief  Acquisition writer for the links between distributed nodes, with bounded error compression of the samples.
+
+            The readouts are sent in the format of the compressed acquisitions of the ismrmrd client, so the
+            GadgetIsmrmrdAcquisitionMessageReader of the compute node decompresses them: ZFP (ISMRMRD_ACQ_COMPRESSION1)
+            if gadgetron is compiled with ZFP, otherwise NHLBI (ISMRMRD_ACQ_COMPRESSION2). Trajectories are not compressed.
+
+            In adaptive mode the writer decides per link from measured rates: it keeps running averages of the link
+            throughput, the compression throughput and the compression ratio and compresses only if compressing and
+            sending the smaller payload is faster than sending the raw samples. Every PROBE_INTERVAL messages the
+            other mode is used once, so the estimates follow changes of the link load.
+*/
+
+#ifndef COMPRESSEDACQUISITIONMESSAGEWRITER_H
+#define COMPRESSEDACQUISITIONMESSAGEWRITER_H
+#pragma once
+
+#include "gadgetron_distributed_gadgets_export.h"
+#include "GadgetMessageInterface.h"
+
+#include <ace/SOCK_Stream.h>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+namespace Gadgetron{
+
+  class EXPORTDISTRIBUTEDGADGETS CompressedAcquisitionMessageWriter : public GadgetMessageWriter
+  {
+  public:
+
+    enum { PROBE_INTERVAL = 64 };
+
+    enum Method
+    {
+      COMPRESSION_NONE = 0,
+      COMPRESSION_NHLBI,
+      COMPRESSION_ZFP
+    };
+
+    /// method from its name, "none", "nhlbi" or "zfp"; zfp falls back to nhlbi if gadgetron is compiled without ZFP
+    static Method method_from_name(const std::string& name);
+
+    /// tolerance > 0 bounds the absolute error, otherwise precision bits are kept
+    CompressedAcquisitionMessageWriter(Method method, float tolerance, unsigned int precision, bool adaptive);
+    virtual ~CompressedAcquisitionMessageWriter();
+
+    virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb);
+
+  protected:
+
+    /// compresses the samples [RO*2 CHA] into buffer_, returns the compressed size
+    size_t compress(const float* data, size_t samples, size_t channels);
+
+    /// decides for the next message, called in adaptive mode
+    bool use_compression();
+
+    void update(double& estimate, double v);
+
+    Method method_;
+    float tolerance_;
+    unsigned int precision_;
+    bool adaptive_;
+
+    /// running averages, 0 until measured: link throughput in wire bytes/s, compression throughput in input bytes/s, raw/compressed size
+    double link_rate_;
+    double compress_rate_;
+    double compression_ratio_;
+
+    bool compressing_;
+    size_t messages_;
+
+    std::vector<uint8_t> buffer_;
+  };
+}
+
+#endif //COMPRESSEDACQUISITIONMESSAGEWRITER_H
@@ -1,27 +1,123 @@
 #include "DistributeGadget.h"
+#include "CollectGadget.h"
 #include "GadgetStreamInterface.h"
 #include "gadgetron_xml.h"
 #include "CloudBus.h"
+#include "DistributionConnectionPool.h"
 #include <stdint.h>
+#include <chrono>
+#include <algorithm>
+#include <set>
 
 namespace Gadgetron{
 
+  namespace {
+    /// connection latencies measured by all distribute gadgets of this process, in ms
+    struct NodeLatency
+    {
+      std::mutex mtx;
+      std::map<std::string, double> latency_ms;
+
+      static NodeLatency* instance()
+      {
+        static NodeLatency* l = new NodeLatency();
+        return l;
+      }
+    };
+
+    void update_latency(const std::string& key, double ms)
+    {
+      NodeLatency* l = NodeLatency::instance();
+      std::lock_guard<std::mutex> lk(l->mtx);
+      auto t = l->latency_ms.find(key);
+      if (t == l->latency_ms.end()) {
+        l->latency_ms[key] = ms;
+      } else {
+        t->second = 0.5*(t->second + ms);
+      }
+    }
+  }
+
   DistributionConnector::DistributionConnector(DistributeGadget* g)
   : distribute_gadget_(g)
+  , finished_(false)
+  , sequence_((size_t)NO_SEQUENCE)
   {
 
   }
 
   int DistributionConnector::process(size_t messageid, ACE_Message_Block* mb) {
-    return distribute_gadget_->collector_putq(mb);
+    DistributeGadget* g = 0;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      g = distribute_gadget_;
+    }
+
+    //An idle connection in the pool does not expect any data
+    if (!g) {
+      GERROR("DistributionConnector, data received on an idle connection\n");
+      mb->release();
+      return -1;
+    }
+
+    return g->collector_putq(mb, this->sequence());
+  }
+
+  int DistributionConnector::svc(void)
+  {
+    int ret = GadgetronConnector::svc();
+
+    DistributeGadget* g = 0;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      finished_ = true;
+      g = distribute_gadget_;
+    }
+
+    //A failed read means the node is gone, a CLOSE from the node means the job is done
+    if (g) g->connector_finished(this, ret < 0);
+    return ret;
+  }
+
+  void DistributionConnector::set_distribute_gadget(DistributeGadget* g)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    distribute_gadget_ = g;
+  }
+
+  bool DistributionConnector::alive()
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return !finished_;
+  }
+
+  void DistributionConnector::set_sequence(size_t s)
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    sequence_ = s;
+  }
+
+  size_t DistributionConnector::sequence()
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return sequence_;
   }
 
 
   DistributeGadget::DistributeGadget()
   : BasicPropertyGadget()
+  , collect_gadget_(0)
+  , sequence_collector_(0)
+  , next_sequence_(0)
   , mtx_("distribution_mtx")
   , prev_connector_(0)
+  , stop_watchdog_(false)
+  {
+  }
+
+  DistributeGadget::~DistributeGadget()
   {
+    this->stop_watchdog();
   }
 
 
@@ -46,6 +142,406 @@ namespace Gadgetron{
     return GADGET_OK;
   }
 
+  int DistributeGadget::collector_putq(ACE_Message_Block* m, size_t sequence)
+  {
+    if (!sequence_collector_ || sequence == (size_t)DistributionConnector::NO_SEQUENCE) {
+      return this->collector_putq(m);
+    }
+
+    if (sequence_collector_->collect(m, sequence) != GADGET_OK) {
+      GERROR("DistributeGadget::collector_putq, passing data on to collector\n");
+      return GADGET_FAIL;
+    }
+    return GADGET_OK;
+  }
+
+  void DistributeGadget::connector_finished(GadgetronConnector* con, bool failed)
+  {
+    bool resubmitted = false;
+    if (failure_detection.value()) {
+      std::lock_guard<std::mutex> lk(jobs_mtx_);
+      auto j = jobs_.find(con);
+      if (j != jobs_.end()) {
+        if (failed) {
+          GWARN("DistributeGadget, node %s failed, resubmitting its job\n", j->second.node_key.c_str());
+          {
+            std::lock_guard<std::mutex> load_lk(load_mtx_);
+            failed_nodes_.insert(j->second.node_key);
+          }
+          resubmitted = this->resubmit(con);
+          if (!resubmitted) GERROR("DistributeGadget, unable to resubmit the job of node %s\n", j->second.node_key.c_str());
+        }
+
+        //The node is done with the job, the packages are not needed any more
+        if (!resubmitted) {
+          for (auto p = j->second.packages.begin(); p != j->second.packages.end(); p++) (*p)->release();
+          jobs_.erase(j);
+        }
+      }
+    }
+
+    //All results of the job have been read, unless it runs again on another node
+    DistributionConnector* dc = dynamic_cast<DistributionConnector*>(con);
+    if (!resubmitted && dc && sequence_collector_ && dc->sequence() != (size_t)DistributionConnector::NO_SEQUENCE) {
+      sequence_collector_->sequence_done(dc->sequence());
+    }
+
+    std::lock_guard<std::mutex> lk(load_mtx_);
+    auto c = connector_node_.find(con);
+    if (c == connector_node_.end()) return;
+
+    auto p = pending_jobs_.find(c->second);
+    if (p != pending_jobs_.end() && p->second > 0) p->second--;
+    connector_node_.erase(c);
+  }
+
+  double DistributeGadget::node_score(const GadgetronNodeInfo& n)
+  {
+    std::string key = DistributionConnectionPool::make_node_key(n.address, n.port);
+
+    //Idle pooled connections are counted as active reconstructions by the node
+    double load = n.active_reconstructions;
+    double idle = DistributionConnectionPool::instance()->idle_connections(key);
+    load = (load > idle) ? (load - idle) : 0;
+    {
+      std::lock_guard<std::mutex> lk(load_mtx_);
+      auto p = pending_jobs_.find(key);
+      if (p != pending_jobs_.end()) load += p->second;
+    }
+
+    double capability = (n.compute_capability > 0) ? n.compute_capability : 1;
+    double score = (load + 1) / capability;
+
+    //Nodes not connected yet have no latency, they are tried once
+    NodeLatency* l = NodeLatency::instance();
+    std::lock_guard<std::mutex> lk(l->mtx);
+    auto t = l->latency_ms.find(key);
+    if (t != l->latency_ms.end()) score += latency_weight.value() * t->second;
+
+    return score;
+  }
+
+  void DistributeGadget::select_node(const std::vector<GadgetronNodeInfo>& nl, GadgetronNodeInfo& me)
+  {
+    bool found = use_this_node_for_compute.value();
+    double best_score = found ? this->node_score(me) : 0;
+
+    for (auto it = nl.begin(); it != nl.end(); it++) {
+      double score = this->node_score(*it);
+      GDEBUG_STREAM("Node " << it->address << ":" << it->port << " - active reconstructions " << it->active_reconstructions << " - compute capability " << it->compute_capability << " - score " << score);
+
+      if (!found || score < best_score) {
+        me = *it;
+        best_score = score;
+        found = true;
+      }
+    }
+
+    GDEBUG_STREAM("Load aware node selection : " << me.address << ":" << me.port << " - score " << best_score);
+  }
+
+  void DistributeGadget::choose_node(int node_index, GadgetronNodeInfo& me)
+  {
+    std::vector<GadgetronNodeInfo> nl;
+    if (best_nodes.value() > 0) {
+      CloudBus::instance()->get_best_nodes(best_nodes.value(), nl);
+    } else {
+      CloudBus::instance()->get_node_info(nl);
+    }
+
+    //Nodes that failed during this series are not used again
+    if (failure_detection.value()) {
+      std::lock_guard<std::mutex> lk(load_mtx_);
+      auto fail = [this](const GadgetronNodeInfo& n) {
+        return failed_nodes_.count(DistributionConnectionPool::make_node_key(n.address, n.port)) > 0;
+      };
+      nl.erase(std::remove_if(nl.begin(), nl.end(), fail), nl.end());
+    }
+
+    GDEBUG("Number of network nodes found: %d\n", nl.size());
+
+    me.address = "127.0.0.1";//We may have to update this
+    me.port = CloudBus::instance()->port();
+    me.uuid = CloudBus::instance()->uuid();
+    me.active_reconstructions = CloudBus::instance()->active_reconstructions();
+    me.compute_capability = CloudBus::instance()->compute_capability();
+
+    //This would give the current node the lowest possible priority
+    if (!use_this_node_for_compute.value()) {
+      me.active_reconstructions = UINT32_MAX;
+    }
+
+    if (load_aware_node_selection.value()) {
+      this->select_node(nl, me);
+    } else {
+      for (auto it = nl.begin(); it != nl.end(); it++) {
+        if (it->active_reconstructions < me.active_reconstructions) {
+          me = *it;
+        }
+
+        //Is this a free node
+        if (me.active_reconstructions == 0) break;
+      }
+    }
+
+    // first job, send to current node if required
+    if (use_this_node_for_compute.value() && node_index==0 && !load_aware_node_selection.value())
+    {
+      size_t num_of_ip = local_address_.size();
+
+        for (auto it = nl.begin(); it != nl.end(); it++)
+        {
+            for (size_t ii=0; ii<num_of_ip; ii++)
+            {
+                if (it->address == local_address_[ii])
+                {
+                    me = *it;
+                }
+            }
+        }
+
+        GDEBUG_STREAM("Send first job to current node : " << me.address);
+    }
+  }
+
+  DistributionConnector* DistributeGadget::open_connection(const GadgetronNodeInfo& me)
+  {
+    //The readers and writers are loaded through the controller, which is not thread safe
+    std::lock_guard<std::mutex> connect_lk(connect_mtx_);
+
+    DistributionConnector* con = 0;
+    std::string key = DistributionConnectionPool::make_node_key(me.address, me.port);
+
+    DistributionConnectionPool* pool = DistributionConnectionPool::instance();
+    bool pooled = (connection_pool_size.value() > 0);
+    if (pooled) {
+      con = pool->take(DistributionConnectionPool::make_key(me.address, me.port, node_xml_config_, this->link_writer_key()), this);
+    }
+
+    if (!con) {
+      auto t0 = std::chrono::steady_clock::now();
+
+      if (pooled) {
+        con = pool->connect(me.address, me.port, node_xml_config_, this, this->link_writer_factory());
+        if (!con) {
+          GERROR("Failed to open a configured connection to node %s : %d\n", me.address.c_str(), me.port);
+          return 0;
+        }
+      } else {
+        con = new DistributionConnector(this);
+
+        GadgetronXML::GadgetStreamConfiguration cfg;
+        try {
+          deserialize(node_xml_config_.c_str(), cfg);
+        }  catch (const std::runtime_error& e) {
+          GERROR("Failed to parse Node Gadget Stream Configuration: %s\n", e.what());
+          return 0;
+        }
+
+        //Configuration of readers
+        for (auto i = cfg.reader.begin(); i != cfg.reader.end(); ++i) {
+          GadgetMessageReader* r =
+          controller_->load_dll_component<GadgetMessageReader>(i->dll.c_str(),
+          i->classname.c_str());
+          if (!r) {
+            GERROR("Failed to load GadgetMessageReader from DLL\n");
+            return 0;
+          }
+          con->register_reader(i->slot, r);
+        }
+
+        DistributionConnectionPool::WriterFactory link_writers = this->link_writer_factory();
+        for (auto i = cfg.writer.begin(); i != cfg.writer.end(); ++i) {
+          GadgetMessageWriter* w = link_writers ? link_writers(i->slot) : 0;
+          if (!w) {
+            w = controller_->load_dll_component<GadgetMessageWriter>(i->dll.c_str(),
+            i->classname.c_str());
+          }
+          if (!w) {
+            GERROR("Failed to load GadgetMessageWriter from DLL\n");
+            return 0;
+          }
+          con->register_writer(i->slot, w);
+        }
+
+        char buffer[10];
+        sprintf(buffer,"%d",me.port);
+        if (con->open(me.address,std::string(buffer)) != 0) {
+          GERROR("Failed to open connection to node %s : %d\n", me.address.c_str(), me.port);
+          return 0;
+        }
+
+        if (con->send_gadgetron_configuration_script(node_xml_config_) != 0) {
+          GERROR("Failed to send XML configuration to compute node\n");
+          return 0;
+        }
+      }
+
+      //The connect takes one round trip, it is kept as a running average per node
+      if (load_aware_node_selection.value()) {
+        update_latency(key, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+      }
+    }
+
+    if (load_aware_node_selection.value()) {
+      std::lock_guard<std::mutex> lk(load_mtx_);
+      pending_jobs_[key]++;
+      connector_node_[con] = key;
+    }
+
+    if (con->send_gadgetron_parameters(node_parameters_) != 0) {
+      GERROR("Failed to send XML parameters to compute node\n");
+      return 0;
+    }
+
+    //The next series with this configuration finds a connection that is ready
+    if (pooled) {
+      pool->prepare(me.address, me.port, node_xml_config_, connection_pool_size.value(), this->link_writer_factory(), this->link_writer_key());
+    }
+
+    return con;
+  }
+
+  bool DistributeGadget::resubmit(GadgetronConnector* con)
+  {
+    auto j = jobs_.find(con);
+    if (j == jobs_.end()) return false;
+
+    //Not the first job, it does not have to stay on this node
+    GadgetronNodeInfo me;
+    this->choose_node(1, me);
+
+    std::string key = DistributionConnectionPool::make_node_key(me.address, me.port);
+    {
+      std::lock_guard<std::mutex> lk(load_mtx_);
+      if (failed_nodes_.count(key)) return false;
+    }
+
+    DistributionConnector* c = this->open_connection(me);
+    if (!c) return false;
+
+    size_t sequence = static_cast<DistributionConnector*>(con)->sequence();
+    c->set_sequence(sequence);
+
+    //The results of the failed node that are still held are computed again
+    if (sequence_collector_ && sequence != (size_t)DistributionConnector::NO_SEQUENCE) {
+      sequence_collector_->sequence_restarted(sequence);
+    }
+
+    Job& job = jobs_[c];
+    job.node_key = key;
+    job.uuid = me.uuid;
+    job.closed = j->second.closed;
+    job.packages.swap(j->second.packages);
+    jobs_.erase(j);
+
+    redirect_[con] = c;
+    resubmitted_.push_back(c);
+
+    GDEBUG("DistributeGadget, resubmitting %d packages to node %s\n", (int)job.packages.size(), key.c_str());
+    for (auto p = job.packages.begin(); p != job.packages.end(); p++) {
+      ACE_Message_Block* d = (*p)->duplicate();
+      if (c->putq(d) == -1) {
+        d->release();
+        GERROR("DistributeGadget, unable to put resubmitted package on queue\n");
+        return true;
+      }
+    }
+
+    if (job.closed) {
+      auto mc = new GadgetContainerMessage<GadgetMessageIdentifier>();
+      mc->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+      if (c->putq(mc) == -1) {
+        mc->release();
+        GERROR("DistributeGadget, unable to put CLOSE package on queue of resubmitted job\n");
+      }
+    }
+
+    return true;
+  }
+
+  int DistributeGadget::send_to_job(GadgetronConnector* con, ACE_Message_Block* m, bool close_job)
+  {
+    if (!failure_detection.value()) {
+      if (con->putq(m) == -1) {
+        m->release();
+        return -1;
+      }
+      return 0;
+    }
+
+    bool retained = false;
+    {
+      std::lock_guard<std::mutex> lk(jobs_mtx_);
+
+      //The job may have moved on from a failed node
+      for (auto r = redirect_.find(con); r != redirect_.end(); r = redirect_.find(con)) con = r->second;
+
+      auto j = jobs_.find(con);
+      if (j != jobs_.end()) {
+        if (close_job) {
+          j->second.closed = true;
+        } else {
+          j->second.packages.push_back(m->duplicate());
+        }
+        retained = true;
+      }
+    }
+
+    //The queue may block on a node that hangs, the watchdog must be able to shut it down meanwhile
+    if (con->putq(m) == -1) {
+      m->release();
+
+      //A failed connection does not take packages any more, the retained ones are resubmitted
+      return retained ? 0 : -1;
+    }
+    return 0;
+  }
+
+  void DistributeGadget::watch_nodes()
+  {
+    std::unique_lock<std::mutex> lk(watchdog_mtx_);
+    while (!stop_watchdog_) {
+      watchdog_condition_.wait_for(lk, std::chrono::milliseconds(node_check_interval_ms.value()));
+      if (stop_watchdog_) break;
+      lk.unlock();
+
+      std::vector<GadgetronNodeInfo> nl;
+      CloudBus::instance()->get_node_info(nl);
+
+      //An empty list says nothing about the nodes, e.g. the relay is not reachable
+      if (!nl.empty()) {
+        std::set<std::string> uuids;
+        for (auto n = nl.begin(); n != nl.end(); n++) uuids.insert(n->uuid);
+        std::string self(CloudBus::instance()->uuid());
+
+        //Shutting down the socket makes the connector fail, which resubmits the job
+        std::lock_guard<std::mutex> jobs_lk(jobs_mtx_);
+        for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+          Job& job = j->second;
+          if (job.shut_down || job.uuid.empty() || job.uuid == self || uuids.count(job.uuid)) continue;
+
+          GWARN("DistributeGadget, node %s has disappeared from the CloudBus, shutting down its connection\n", job.node_key.c_str());
+          j->first->peer().close_reader();
+          j->first->peer().close_writer();
+          job.shut_down = true;
+        }
+      }
+
+      lk.lock();
+    }
+  }
+
+  void DistributeGadget::stop_watchdog()
+  {
+    {
+      std::lock_guard<std::mutex> lk(watchdog_mtx_);
+      stop_watchdog_ = true;
+    }
+    watchdog_condition_.notify_all();
+    if (watchdog_.joinable()) watchdog_.join();
+  }
+
   int DistributeGadget::process(ACE_Message_Block* m)
   {
     int node_index = this->node_index(m);
@@ -82,101 +578,23 @@ namespace Gadgetron{
     if (n != node_map_.end()) { //We have a suitable connection already.
       con = n->second;
     } else {
-      std::vector<GadgetronNodeInfo> nl;
-      CloudBus::instance()->get_node_info(nl);
-
-      GDEBUG("Number of network nodes found: %d\n", nl.size());
-
       GadgetronNodeInfo me;
-      me.address = "127.0.0.1";//We may have to update this
-      me.port = CloudBus::instance()->port();
-      me.uuid = CloudBus::instance()->uuid();
-      me.active_reconstructions = CloudBus::instance()->active_reconstructions();
+      this->choose_node(node_index, me);
 
-      //This would give the current node the lowest possible priority
-      if (!use_this_node_for_compute.value()) {
-        me.active_reconstructions = UINT32_MAX;
-      }
+      con = this->open_connection(me);
+      if (!con) return GADGET_FAIL;
 
-      for (auto it = nl.begin(); it != nl.end(); it++) {
-        if (it->active_reconstructions < me.active_reconstructions) {
-          me = *it;
-        }
-
-        //Is this a free node
-        if (me.active_reconstructions == 0) break;
-      }
-
-      // first job, send to current node if required
-      if (use_this_node_for_compute.value() && node_index==0)
-      {
-        size_t num_of_ip = local_address_.size();
+      //Jobs are numbered in the order they are started, the collector can pass on the results in this order
+      static_cast<DistributionConnector*>(con)->set_sequence(next_sequence_);
+      this->job_started(node_index, next_sequence_++);
 
-          for (auto it = nl.begin(); it != nl.end(); it++)
-          {
-              for (size_t ii=0; ii<num_of_ip; ii++)
-              {
-                  if (it->address == local_address_[ii])
-                  {
-                      me = *it;
-                  }
-              }
-          }
-
-          GDEBUG_STREAM("Send first job to current node : " << me.address);
-      }
-
-      con = new DistributionConnector(this);
-
-      GadgetronXML::GadgetStreamConfiguration cfg;
-      try {
-        deserialize(node_xml_config_.c_str(), cfg);
-      }  catch (const std::runtime_error& e) {
-        GERROR("Failed to parse Node Gadget Stream Configuration: %s\n", e.what());
-        return GADGET_FAIL;
+      if (failure_detection.value()) {
+        std::lock_guard<std::mutex> lk(jobs_mtx_);
+        Job& j = jobs_[con];
+        j.node_key = DistributionConnectionPool::make_node_key(me.address, me.port);
+        j.uuid = me.uuid;
       }
 
-      //Configuration of readers
-      for (auto i = cfg.reader.begin(); i != cfg.reader.end(); ++i) {
-        GadgetMessageReader* r =
-        controller_->load_dll_component<GadgetMessageReader>(i->dll.c_str(),
-        i->classname.c_str());
-        if (!r) {
-          GERROR("Failed to load GadgetMessageReader from DLL\n");
-          return GADGET_FAIL;
-        }
-        con->register_reader(i->slot, r);
-      }
-
-      for (auto i = cfg.writer.begin(); i != cfg.writer.end(); ++i) {
-        GadgetMessageWriter* w =
-        controller_->load_dll_component<GadgetMessageWriter>(i->dll.c_str(),
-        i->classname.c_str());
-        if (!w) {
-          GERROR("Failed to load GadgetMessageWriter from DLL\n");
-          return GADGET_FAIL;
-        }
-        con->register_writer(i->slot, w);
-      }
-
-
-      char buffer[10];
-      sprintf(buffer,"%d",me.port);
-      if (con->open(me.address,std::string(buffer)) != 0) {
-        GERROR("Failed to open connection to node %s : %d\n", me.address.c_str(), me.port);
-        return GADGET_FAIL;
-      }
-
-      if (con->send_gadgetron_configuration_script(node_xml_config_) != 0) {
-        GERROR("Failed to send XML configuration to compute node\n");
-        return GADGET_FAIL;
-      }
-
-      if (con->send_gadgetron_parameters(node_parameters_) != 0) {
-        GERROR("Failed to send XML parameters to compute node\n");
-        return GADGET_FAIL;
-      }
-      
       mtx_.acquire();
       node_map_[node_index] = con;
       mtx_.release();
@@ -220,7 +638,7 @@ namespace Gadgetron{
 	  auto mc = new GadgetContainerMessage<GadgetMessageIdentifier>();
 	  mc->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
 	  
-	  if (prev_connector_->putq(mc) == -1) {
+	  if (this->send_to_job(prev_connector_, mc, true) == -1) {
 	    GERROR("Unable to put CLOSE package on queue of previous connection\n");
 	    return -1;
 	  }
@@ -237,9 +655,8 @@ namespace Gadgetron{
 
       m1->cont(m);
 
-      if (con->putq(m1) == -1) {
+      if (this->send_to_job(con, m1) == -1) {
         GERROR("Unable to put package on connector queue\n");
-        m1->release();
         return GADGET_FAIL;
       }
 
@@ -247,7 +664,7 @@ namespace Gadgetron{
         auto m2 = new GadgetContainerMessage<GadgetMessageIdentifier>();
         m2->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
 
-        if (con->putq(m2) == -1) {
+        if (this->send_to_job(con, m2, true) == -1) {
           GERROR("Unable to put CLOSE package on queue\n");
           return -1;
         }
@@ -263,6 +680,7 @@ namespace Gadgetron{
   {
 
     started_nodes_ = 0;
+    next_sequence_ = 0;
     node_parameters_ = std::string(m->rd_ptr());
 
     //Grab the original XML conifguration
@@ -293,6 +711,17 @@ namespace Gadgetron{
     }
 
     collect_gadget_ = tmp;
+    sequence_collector_ = dynamic_cast<CollectGadget*>(collect_gadget_);
+
+    //Connections used in parallel are only closed at the end, the jobs are not done before that
+    if (sequence_collector_) {
+      sequence_collector_->set_parallel_jobs(!nodes_used_sequentially.value() && !single_package_mode.value());
+    }
+
+    if (failure_detection.value() && !watchdog_.joinable()) {
+      stop_watchdog_ = false;
+      watchdog_ = std::thread(&DistributeGadget::watch_nodes, this);
+    }
 
     if (!collect_gadget_) {
       GERROR("Failed to locate collector Gadget with name %s\n", collector.value().c_str());
@@ -331,12 +760,14 @@ namespace Gadgetron{
       mtx_.acquire();
 
       for (auto n = node_map_.begin(); n != node_map_.end(); n++) {
-        if (n->second) {
+        //Connectors that got their CLOSE already do not take any more packages
+        if (n->second && std::find(closed_connectors_.begin(), closed_connectors_.end(), n->second) == closed_connectors_.end()) {
           auto m1 = new GadgetContainerMessage<GadgetMessageIdentifier>();
           m1->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
 
-          if (n->second->putq(m1) == -1) {
+          if (this->send_to_job(n->second, m1, true) == -1) {
             GERROR("Unable to put CLOSE package on queue\n");
+            mtx_.release();
             return -1;
           }
 	}
@@ -352,6 +783,37 @@ namespace Gadgetron{
         it = node_map_.begin();
       }
 
+      //Connections that took over the jobs of failed nodes, they may fail and be replaced in turn
+      while (true) {
+        GadgetronConnector* c = 0;
+        {
+          std::lock_guard<std::mutex> lk(jobs_mtx_);
+          if (resubmitted_.empty()) break;
+          c = resubmitted_.back();
+          resubmitted_.pop_back();
+        }
+        c->wait();
+        delete c;
+      }
+
+      this->stop_watchdog();
+
+      {
+        std::lock_guard<std::mutex> lk(jobs_mtx_);
+        for (auto j = jobs_.begin(); j != jobs_.end(); j++) {
+          for (auto p = j->second.packages.begin(); p != j->second.packages.end(); p++) (*p)->release();
+        }
+        jobs_.clear();
+        redirect_.clear();
+      }
+
+      {
+        std::lock_guard<std::mutex> lk(load_mtx_);
+        pending_jobs_.clear();
+        connector_node_.clear();
+        failed_nodes_.clear();
+      }
+
       mtx_.release();
       GDEBUG("All connectors closed. Waiting for Gadget to close\n");
     }
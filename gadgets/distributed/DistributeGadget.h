@@ -4,12 +4,22 @@
 #include "Gadget.h"
 #include "gadgetron_distributed_gadgets_export.h"
 #include "GadgetronConnector.h"
+#include "DistributionConnectionPool.h"
 
 #include <complex>
+#include <list>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <string>
 
 namespace Gadgetron{
 
   class DistributeGadget;
+  class CollectGadget;
+  struct GadgetronNodeInfo;
 
   class DistributionConnector : public GadgetronConnector
   {
@@ -17,9 +27,24 @@ namespace Gadgetron{
   public:
     DistributionConnector(DistributeGadget* g);
     virtual int process(size_t messageid, ACE_Message_Block* mb);
+    virtual int svc(void);
+
+    /// hands the connector to another gadget, 0 while it is idle in the DistributionConnectionPool
+    void set_distribute_gadget(DistributeGadget* g);
+
+    /// false once the node has closed the connection or it failed
+    bool alive();
+
+    /// sequence number of the job sent on this connection, NO_SEQUENCE while it is not used
+    enum { NO_SEQUENCE = -1 };
+    void set_sequence(size_t s);
+    size_t sequence();
 
   protected:
+    std::mutex mtx_;
     DistributeGadget* distribute_gadget_;
+    bool finished_;
+    size_t sequence_;
   };
 
   class EXPORTDISTRIBUTEDGADGETS DistributeGadget : public BasicPropertyGadget
@@ -27,8 +52,18 @@ namespace Gadgetron{
   public:
     GADGET_DECLARE(DistributeGadget);
     DistributeGadget();
+    virtual ~DistributeGadget();
     virtual int collector_putq(ACE_Message_Block* m);
 
+    /// result of the job with this sequence number, reordered by the collector if it is a CollectGadget
+    virtual int collector_putq(ACE_Message_Block* m, size_t sequence);
+
+    /**
+    Called by a connector when its node has closed the connection, i.e. the node is done with this package,
+    or when the connection failed. With failure_detection, the job of a failed connection is resubmitted to another node.
+    */
+    virtual void connector_finished(GadgetronConnector* con, bool failed = false);
+
   protected:
     GADGET_PROPERTY(collector, std::string,
       "Name of collection Gadget", "Collect");
@@ -38,6 +73,18 @@ namespace Gadgetron{
       "Indicates that data is distributed to one node at a time. When new node becomes active, previous receives close message.", true);
     GADGET_PROPERTY(use_this_node_for_compute, bool,
       "This node can also be used for computation", true);
+    GADGET_PROPERTY(load_aware_node_selection, bool,
+      "Select nodes by their load, compute capability and connection latency instead of the least active reconstructions", false);
+    GADGET_PROPERTY(latency_weight, float,
+      "Score added per ms of measured connection latency in the load aware node selection; one active reconstruction counts as 1", 0.01);
+    GADGET_PROPERTY(connection_pool_size, size_t,
+      "Number of idle, pre-configured connections kept per node for the next series with the same configuration, 0 disables the pool", 0);
+    GADGET_PROPERTY(failure_detection, bool,
+      "Keep the packages of each job until its node has finished and resubmit them to another node if the node fails", false);
+    GADGET_PROPERTY(node_check_interval_ms, size_t,
+      "Interval in ms in which the CloudBus node list is checked for nodes that stopped sending heartbeats", 200);
+    GADGET_PROPERTY(best_nodes, size_t,
+      "Number of best ranked nodes the relay sends for the node selection instead of the full node list, 0 uses the full list", 0);
 
     virtual int process(ACE_Message_Block* m);
     virtual int process_config(ACE_Message_Block* m);
@@ -59,10 +106,62 @@ namespace Gadgetron{
       return 0; //This is an invalid ID.
     }
 
+    /**
+    Writers that replace the ones of the node configuration on the links to the nodes, e.g. to compress the data.
+    The factory is also used by the DistributionConnectionPool after the gadget is gone, it must not refer to the gadget.
+    */
+    virtual DistributionConnectionPool::WriterFactory link_writer_factory()
+    {
+      return DistributionConnectionPool::WriterFactory();
+    }
+
+    /// identifies the settings of the link writers, connections are only reused with the same writers
+    virtual std::string link_writer_key()
+    {
+      return std::string();
+    }
+
     const char* get_node_xml_config();
 
+    /**
+    Score of a node for the load aware node selection, the node with the lowest score is used.
+
+    The reconstructions running on the node and the ones sent to it by this gadget and not yet finished
+    are divided by its compute capability; the measured connection latency is added with latency_weight.
+    */
+    virtual double node_score(const GadgetronNodeInfo& n);
+
+    /// pick the node with the lowest node_score from nl; me holds the local node and is replaced by the selection
+    virtual void select_node(const std::vector<GadgetronNodeInfo>& nl, GadgetronNodeInfo& me);
+
+    /// fills me with the node for the job node_index, nodes that failed during this series are not used
+    virtual void choose_node(int node_index, GadgetronNodeInfo& me);
+
+    /// called when the job for node_index is started on a node, with the sequence number of the job
+    virtual void job_started(int node_index, size_t sequence) {}
+
+    /// opens and configures a connection to the node, 0 on failure
+    virtual DistributionConnector* open_connection(const GadgetronNodeInfo& me);
+
+    /**
+    Puts a package, or a CLOSE if close_job, on the queue of the job of connector con, the package is released on failure.
+    With failure_detection the package is retained for a resubmission, and it goes to the node that took over the job.
+    */
+    int send_to_job(GadgetronConnector* con, ACE_Message_Block* m, bool close_job = false);
+
+    /// runs the job of a failed connector on another node, jobs_mtx_ must be held
+    bool resubmit(GadgetronConnector* con);
+
+    /// shuts down the connections to the nodes that disappeared from the CloudBus node list
+    void watch_nodes();
+    void stop_watchdog();
+
     Gadget* collect_gadget_;
 
+    /// collect_gadget_ if it is a CollectGadget, it gets the sequence numbers of the jobs
+    CollectGadget* sequence_collector_;
+    size_t next_sequence_;
+
     size_t started_nodes_;
     ACE_Thread_Mutex mtx_;
 
@@ -74,6 +173,35 @@ namespace Gadgetron{
     GadgetronConnector* prev_connector_; //Keeps track of previously used connector
     std::vector<std::string> local_address_;
 
+    /// bookkeeping of the load aware node selection, keyed by node address:port
+    std::mutex load_mtx_;
+    std::map<std::string, size_t> pending_jobs_;
+    std::map<GadgetronConnector*, std::string> connector_node_;
+    std::set<std::string> failed_nodes_;
+
+    /// packages of a job, kept with failure_detection until the node has finished the job
+    struct Job
+    {
+      Job() : closed(false), shut_down(false) {}
+      std::string node_key;
+      std::string uuid;
+      std::list<ACE_Message_Block*> packages;
+      bool closed;
+      bool shut_down;
+    };
+
+    std::mutex jobs_mtx_;
+    std::map<GadgetronConnector*, Job> jobs_;
+    std::map<GadgetronConnector*, GadgetronConnector*> redirect_; //failed connector to the one that took over its job
+    std::vector<GadgetronConnector*> resubmitted_;
+
+    std::mutex connect_mtx_;
+
+    std::thread watchdog_;
+    std::mutex watchdog_mtx_;
+    std::condition_variable watchdog_condition_;
+    bool stop_watchdog_;
+
   };
 }
 #endif //DISTRIBUTEGADGET_H
@@ -0,0 +1,265 @@
+#include "DistributionConnectionPool.h"
+#include "DistributeGadget.h"
+#include "GadgetWorkerPool.h"
+#include "gadgetron_xml.h"
+#include "log.h"
+
+#include <ace/OS_NS_stdio.h>
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+namespace Gadgetron
+{
+  DistributionConnectionPool* DistributionConnectionPool::instance()
+  {
+    //Never destroyed, the pinned libraries stay loaded while idle connections use their readers and writers
+    static DistributionConnectionPool* pool = new DistributionConnectionPool();
+    return pool;
+  }
+
+  DistributionConnectionPool::DistributionConnectionPool()
+  {
+  }
+
+  std::string DistributionConnectionPool::make_node_key(const std::string& address, uint32_t port)
+  {
+    std::stringstream str;
+    str << address << ":" << port;
+    return str.str();
+  }
+
+  std::string DistributionConnectionPool::make_key(const std::string& address, uint32_t port, const std::string& xml, const std::string& writer_key)
+  {
+    std::stringstream str;
+    str << make_node_key(address, port) << "#" << std::hex << std::hash<std::string>()(xml) << "#" << xml.size() << "#" << writer_key;
+    return str.str();
+  }
+
+  void DistributionConnectionPool::evict(const std::string& key, std::vector<DistributionConnector*>& evicted)
+  {
+    std::map<std::string, std::list<IdleConnection> >::iterator it = idle_.find(key);
+    if (it == idle_.end()) return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::list<IdleConnection>::iterator c = it->second.begin();
+    while (c != it->second.end()) {
+      if (!c->con->alive() || (now - c->since) > std::chrono::seconds(IDLE_TIMEOUT_SECONDS)) {
+        evicted.push_back(c->con);
+        c = it->second.erase(c);
+      } else {
+        c++;
+      }
+    }
+
+    if (it->second.empty()) idle_.erase(it);
+  }
+
+  DistributionConnector* DistributionConnectionPool::take(const std::string& key, DistributeGadget* g)
+  {
+    DistributionConnector* con = 0;
+    while (!con) {
+      std::vector<DistributionConnector*> evicted;
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        this->evict(key, evicted);
+
+        std::map<std::string, std::list<IdleConnection> >::iterator it = idle_.find(key);
+        if (it != idle_.end()) {
+          con = it->second.front().con;
+          it->second.pop_front();
+          if (it->second.empty()) idle_.erase(it);
+        }
+      }
+
+      for (size_t i = 0; i < evicted.size(); i++) {
+        GDEBUG("DistributionConnectionPool, evicting idle connection for %s\n", key.substr(0, key.find('#')).c_str());
+        release(evicted[i]);
+      }
+
+      if (!con) return 0;
+
+      //The node may close the connection until it is handed over, the gadget is told about it afterwards
+      con->set_distribute_gadget(g);
+      if (!con->alive()) {
+        release(con);
+        con = 0;
+      }
+    }
+
+    GDEBUG("DistributionConnectionPool, reusing idle connection for %s\n", key.substr(0, key.find('#')).c_str());
+    return con;
+  }
+
+  DistributionConnector* DistributionConnectionPool::connect(const std::string& address, uint32_t port, const std::string& xml, DistributeGadget* g,
+                                                             const WriterFactory& writers)
+  {
+    GadgetronXML::GadgetStreamConfiguration cfg;
+    try {
+      GadgetronXML::deserialize(xml.c_str(), cfg);
+    } catch (const std::runtime_error& e) {
+      GERROR("DistributionConnectionPool, failed to parse node gadget stream configuration: %s\n", e.what());
+      return 0;
+    }
+
+    typedef GadgetMessageReader* (*ReaderCreator)(void);
+    typedef GadgetMessageWriter* (*WriterCreator)(void);
+
+    DistributionConnector* con = new DistributionConnector(g);
+
+    for (auto i = cfg.reader.begin(); i != cfg.reader.end(); ++i) {
+      ptrdiff_t tmp = reinterpret_cast<ptrdiff_t>(this->find_factory(i->dll, i->classname));
+      ReaderCreator rc = reinterpret_cast<ReaderCreator>(tmp);
+      GadgetMessageReader* r = rc ? rc() : 0;
+      if (!r) {
+        GERROR("DistributionConnectionPool, failed to load GadgetMessageReader %s\n", i->classname.c_str());
+        delete con;
+        return 0;
+      }
+      con->register_reader(i->slot, r);
+    }
+
+    for (auto i = cfg.writer.begin(); i != cfg.writer.end(); ++i) {
+      GadgetMessageWriter* w = writers ? writers(i->slot) : 0;
+      if (!w) {
+        ptrdiff_t tmp = reinterpret_cast<ptrdiff_t>(this->find_factory(i->dll, i->classname));
+        WriterCreator wc = reinterpret_cast<WriterCreator>(tmp);
+        w = wc ? wc() : 0;
+      }
+      if (!w) {
+        GERROR("DistributionConnectionPool, failed to load GadgetMessageWriter %s\n", i->classname.c_str());
+        delete con;
+        return 0;
+      }
+      con->register_writer(i->slot, w);
+    }
+
+    char buffer[10];
+    sprintf(buffer,"%d",port);
+    if (con->open(address,std::string(buffer)) != 0) {
+      GERROR("DistributionConnectionPool, failed to open connection to node %s : %d\n", address.c_str(), port);
+      delete con;
+      return 0;
+    }
+
+    //Idle connections can stay open for a long time, keep alive detects nodes that went away
+    int keep_alive = 1;
+    con->peer().set_option(SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(keep_alive));
+
+    if (con->send_gadgetron_configuration_script(xml) != 0) {
+      GERROR("DistributionConnectionPool, failed to send XML configuration to compute node\n");
+      release(con);
+      return 0;
+    }
+
+    return con;
+  }
+
+  void DistributionConnectionPool::prepare(const std::string& address, uint32_t port, const std::string& xml, size_t idle_connections,
+                                           const WriterFactory& writers, const std::string& writer_key)
+  {
+    std::string key = make_key(address, port, xml, writer_key);
+
+    size_t missing = 0;
+    std::vector<DistributionConnector*> evicted;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      this->evict(key, evicted);
+
+      size_t available = opening_[key];
+      std::map<std::string, std::list<IdleConnection> >::iterator it = idle_.find(key);
+      if (it != idle_.end()) available += it->second.size();
+
+      if (available < idle_connections) missing = idle_connections - available;
+      opening_[key] += missing;
+    }
+
+    for (size_t i = 0; i < evicted.size(); i++) release(evicted[i]);
+
+    for (size_t i = 0; i < missing; i++) {
+      GadgetWorkerPool::instance()->submit([this, key, address, port, xml, writers]() { this->open_idle(key, address, port, xml, writers); });
+    }
+  }
+
+  void DistributionConnectionPool::open_idle(const std::string& key, const std::string& address, uint32_t port, const std::string& xml, WriterFactory writers)
+  {
+    DistributionConnector* con = this->connect(address, port, xml, 0, writers);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (opening_[key] > 0) opening_[key]--;
+
+    if (con) {
+      IdleConnection c;
+      c.con = con;
+      c.since = std::chrono::steady_clock::now();
+      idle_[key].push_back(c);
+      GDEBUG("DistributionConnectionPool, idle connection ready for %s\n", key.substr(0, key.find('#')).c_str());
+    }
+  }
+
+  size_t DistributionConnectionPool::idle_connections(const std::string& node_key)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    std::string prefix = node_key + "#";
+    size_t n = 0;
+    for (std::map<std::string, std::list<IdleConnection> >::iterator it = idle_.begin(); it != idle_.end(); it++) {
+      if (it->first.compare(0, prefix.size(), prefix) == 0) n += it->second.size();
+    }
+    return n;
+  }
+
+  void DistributionConnectionPool::release(DistributionConnector* con)
+  {
+    if (!con) return;
+
+    auto m = new GadgetContainerMessage<GadgetMessageIdentifier>();
+    m->getObjectPtr()->id = GADGET_MESSAGE_CLOSE;
+    if (con->putq(m) == -1) {
+      m->release();
+    }
+
+    con->wait();
+    delete con;
+  }
+
+  void* DistributionConnectionPool::find_factory(const std::string& dll, const std::string& classname)
+  {
+    std::lock_guard<std::mutex> guard(factory_mutex_);
+
+    std::string fkey = dll + ":" + classname;
+    std::map<std::string, void*>::iterator it = factories_.find(fkey);
+    if (it != factories_.end()) {
+      return it->second;
+    }
+
+    ACE_TCHAR dllname[1024];
+#if defined(WIN32) && defined(_DEBUG)
+    ACE_OS::sprintf(dllname, "%s%sd",ACE_DLL_PREFIX, dll.c_str());
+#else
+    ACE_OS::sprintf(dllname, "%s%s",ACE_DLL_PREFIX, dll.c_str());
+#endif
+
+    ACE_TCHAR factoryname[1024];
+    ACE_OS::sprintf(factoryname, "make_%s", classname.c_str());
+
+    //The handle is never closed, the readers and writers of idle connections live in these libraries
+    ACE_SHLIB_HANDLE dll_handle = 0;
+    ACE_DLL_Handle* handle = ACE_DLL_Manager::instance()->open_dll(dllname, ACE_DEFAULT_SHLIB_MODE, dll_handle);
+    if (!handle) {
+      GERROR("DistributionConnectionPool, failed to load DLL %s\n", dllname);
+      return 0;
+    }
+    pinned_dlls_.push_back(handle);
+
+    void* factory = handle->symbol(factoryname);
+    if (!factory) {
+      GERROR("DistributionConnectionPool, failed to load factory (%s) from DLL (%s)\n", factoryname, dllname);
+      return 0;
+    }
+
+    factories_[fkey] = factory;
+    return factory;
+  }
+}
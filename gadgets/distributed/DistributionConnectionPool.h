@@ -0,0 +1,98 @@
+/** \file   DistributionConnectionPool.h
+    \brief  Process wide pool of idle, pre-configured connections to compute nodes.
+
+            A connection in the pool is open and the node has received its stream configuration, so the node has
+            built the stream and waits for the parameters. The DistributeGadget takes such a connection for the
+            next series with the same node configuration, sends only the parameters and the data, and the pool
+            opens a replacement in the background (on the GadgetWorkerPool).
+
+            Connections are keyed by the node address, port, a hash of the node XML configuration and the key of
+            the writers that replace configured ones on the link (e.g. the CompressedAcquisitionMessageWriter).
+            Connections the node has closed, the ones that failed and the ones idle for longer than
+            IDLE_TIMEOUT_SECONDS are evicted when they are found. The sockets use TCP keep alive, so a node
+            that disappears without closing its connections is detected as well.
+*/
+
+#ifndef DISTRIBUTIONCONNECTIONPOOL_H
+#define DISTRIBUTIONCONNECTIONPOOL_H
+#pragma once
+
+#include "gadgetron_distributed_gadgets_export.h"
+
+#include <ace/DLL_Manager.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+
+namespace Gadgetron{
+
+  class DistributeGadget;
+  class DistributionConnector;
+  class GadgetMessageWriter;
+
+  class EXPORTDISTRIBUTEDGADGETS DistributionConnectionPool
+  {
+  public:
+
+    enum { IDLE_TIMEOUT_SECONDS = 600 };
+
+    /// writer used on the link instead of the configured one for a slot, 0 keeps the configured writer
+    typedef std::function<GadgetMessageWriter*(size_t slot)> WriterFactory;
+
+    static DistributionConnectionPool* instance();
+
+    /// node address:port, the prefix of the keys of all connections to this node
+    static std::string make_node_key(const std::string& address, uint32_t port);
+    static std::string make_key(const std::string& address, uint32_t port, const std::string& xml, const std::string& writer_key);
+
+    /// Idle connection for the key, handed to g, 0 if there is none alive. The caller takes ownership.
+    DistributionConnector* take(const std::string& key, DistributeGadget* g);
+
+    /// Opens a connection to the node and sends the configuration, 0 if it failed. The caller takes ownership.
+    DistributionConnector* connect(const std::string& address, uint32_t port, const std::string& xml, DistributeGadget* g,
+                                   const WriterFactory& writers = WriterFactory());
+
+    /// Opens connections in the background until idle_connections are available for this node and configuration
+    void prepare(const std::string& address, uint32_t port, const std::string& xml, size_t idle_connections,
+                 const WriterFactory& writers = WriterFactory(), const std::string& writer_key = std::string());
+
+    /// Number of idle connections to the node (see make_node_key), for all configurations
+    size_t idle_connections(const std::string& node_key);
+
+    /// Sends a close to the node and deletes the connector
+    static void release(DistributionConnector* con);
+
+  protected:
+
+    struct IdleConnection
+    {
+      DistributionConnector* con;
+      std::chrono::steady_clock::time_point since;
+    };
+
+    DistributionConnectionPool();
+
+    void open_idle(const std::string& key, const std::string& address, uint32_t port, const std::string& xml, WriterFactory writers);
+
+    /// Removes the dead and timed out connections of the key, mutex_ must be held
+    void evict(const std::string& key, std::vector<DistributionConnector*>& evicted);
+
+    void* find_factory(const std::string& dll, const std::string& classname);
+
+    std::mutex mutex_;
+    std::map<std::string, std::list<IdleConnection> > idle_;
+    std::map<std::string, size_t> opening_;
+
+    std::mutex factory_mutex_;
+    std::map<std::string, void*> factories_;
+    std::vector<ACE_DLL_Handle*> pinned_dlls_;
+  };
+}
+
+#endif //DISTRIBUTIONCONNECTIONPOOL_H
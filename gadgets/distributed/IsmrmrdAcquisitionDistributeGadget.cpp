@@ -1,9 +1,202 @@
 #include "IsmrmrdAcquisitionDistributeGadget.h"
 #include "GadgetMRIHeaders.h"
+#include "CompressedAcquisitionMessageWriter.h"
+#include "CollectGadget.h"
+#include "hoNDArray.h"
+#include "hoNDFFT.h"
+
+#include <ismrmrd/xml.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
 
 namespace Gadgetron{
 
+  IsmrmrdAcquisitionDistributeGadget::IsmrmrdAcquisitionDistributeGadget()
+    : encoded_readout_(0)
+    , readout_crop_start_(0)
+    , readout_crop_(0)
+    , chunk_size_(0)
+    , chunk_node_index_(-1)
+  {
+  }
+
+  int IsmrmrdAcquisitionDistributeGadget::process_config(ACE_Message_Block* m)
+  {
+    chunk_node_index_ = -1;
+
+    size_t chunks = readout_chunks.value();
+    if (chunks == 0) {
+      int ret = DistributeGadget::process_config(m);
+      if (ret == GADGET_OK && sequence_collector_) sequence_collector_->set_readout_chunks(0, 0, 0);
+      return ret;
+    }
+
+    ISMRMRD::IsmrmrdHeader h;
+    try {
+      ISMRMRD::deserialize(m->rd_ptr(), h);
+    } catch (...) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, failed to parse the ISMRMRD header\n");
+      return GADGET_FAIL;
+    }
+
+    if (h.encoding.size() != 1) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, the readout partition needs exactly one encoding space, found %d\n", (int)h.encoding.size());
+      return GADGET_FAIL;
+    }
+
+    ISMRMRD::EncodingSpace& e_space = h.encoding[0].encodedSpace;
+    ISMRMRD::EncodingSpace& r_space = h.encoding[0].reconSpace;
+
+    //The crop to the recon field of view is the one of the fft based RO oversampling removal
+    encoded_readout_ = e_space.matrixSize.x;
+    double ratio = e_space.fieldOfView_mm.x / r_space.fieldOfView_mm.x;
+    if (!(ratio >= 1.0)) ratio = 1.0;
+    readout_crop_ = (size_t)(encoded_readout_ / ratio);
+    if (readout_crop_ == 0 || readout_crop_ < chunks) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, %d readout samples can not be split into %d chunks\n", (int)readout_crop_, (int)chunks);
+      return GADGET_FAIL;
+    }
+    readout_crop_start_ = (encoded_readout_ - readout_crop_) / 2;
+    chunk_size_ = (readout_crop_ + chunks - 1) / chunks;
+
+    //The nodes reconstruct one chunk, without oversampling
+    float chunk_fov = r_space.fieldOfView_mm.x * chunk_size_ / readout_crop_;
+    e_space.matrixSize.x = chunk_size_;
+    r_space.matrixSize.x = chunk_size_;
+    e_space.fieldOfView_mm.x = chunk_fov;
+    r_space.fieldOfView_mm.x = chunk_fov;
+
+    GDEBUG("IsmrmrdAcquisitionDistributeGadget, readouts of %d samples are cropped to %d and split into %d chunks of %d\n",
+           (int)encoded_readout_, (int)readout_crop_, (int)chunks, (int)chunk_size_);
+
+    //All chunks of a readout are sent at once, the nodes of a job are not used one after the other
+    if (nodes_used_sequentially.value()) {
+      GDEBUG("IsmrmrdAcquisitionDistributeGadget, nodes_used_sequentially is switched off for the readout partition\n");
+      nodes_used_sequentially.value(false);
+    }
+
+    std::stringstream str;
+    ISMRMRD::serialize(h, str);
+    std::string xml = str.str();
+
+    ACE_Message_Block* mb = new ACE_Message_Block(xml.size() + 1);
+    memcpy(mb->wr_ptr(), xml.c_str(), xml.size() + 1);
+    mb->wr_ptr(xml.size() + 1);
+
+    int ret = DistributeGadget::process_config(mb);
+    mb->release();
+    if (ret != GADGET_OK) return ret;
+
+    if (!sequence_collector_) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, the readout partition needs a CollectGadget as collector\n");
+      return GADGET_FAIL;
+    }
+    sequence_collector_->set_readout_chunks(chunks, readout_crop_, chunk_size_);
+
+    return GADGET_OK;
+  }
+
+  int IsmrmrdAcquisitionDistributeGadget::process(ACE_Message_Block* m)
+  {
+    if (readout_chunks.value() == 0) return DistributeGadget::process(m);
+
+    auto m1 = AsContainerMessage<ISMRMRD::AcquisitionHeader>(m);
+    if (!m1) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, the readout partition only takes readouts\n");
+      m->release();
+      return GADGET_FAIL;
+    }
+
+    return this->process_readout_chunks(m1);
+  }
+
+  int IsmrmrdAcquisitionDistributeGadget::process_readout_chunks(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1)
+  {
+    auto m2 = AsContainerMessage< hoNDArray< std::complex<float> > >(m1->cont());
+    if (!m2) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, readout without data\n");
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    ISMRMRD::AcquisitionHeader& h = *m1->getObjectPtr();
+    if (h.number_of_samples != encoded_readout_) {
+      GERROR("IsmrmrdAcquisitionDistributeGadget, readout of %d samples, the readout partition expects %d\n", (int)h.number_of_samples, (int)encoded_readout_);
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    int p = this->parallel_index(m1);
+    if (p < 0) {
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    hoNDArray< std::complex<float> >& data = *m2->getObjectPtr();
+    size_t CHA = data.get_number_of_elements() / encoded_readout_;
+
+    hoNDFFT<float>::instance()->ifft1c(data);
+
+    size_t chunks = readout_chunks.value();
+    for (size_t c = 0; c < chunks; c++) {
+      auto cm1 = new GadgetContainerMessage<ISMRMRD::AcquisitionHeader>();
+      ISMRMRD::AcquisitionHeader& ch = *cm1->getObjectPtr();
+      ch = h;
+      ch.number_of_samples = chunk_size_;
+      ch.center_sample = chunk_size_ / 2;
+      ch.discard_pre = 0;
+      ch.discard_post = 0;
+      ch.trajectory_dimensions = 0;
+
+      //The last chunk is padded with zeros beyond the field of view
+      auto cm2 = new GadgetContainerMessage< hoNDArray< std::complex<float> > >();
+      hoNDArray< std::complex<float> >& chunk = *cm2->getObjectPtr();
+      chunk.create(chunk_size_, CHA);
+      memset(chunk.get_data_ptr(), 0, chunk.get_number_of_bytes());
+
+      size_t start = c*chunk_size_;
+      size_t len = (start < readout_crop_) ? std::min(chunk_size_, readout_crop_ - start) : 0;
+      for (size_t cha = 0; cha < CHA; cha++) {
+        memcpy(chunk.get_data_ptr() + cha*chunk_size_,
+               data.get_data_ptr() + cha*encoded_readout_ + readout_crop_start_ + start,
+               len*sizeof(std::complex<float>));
+      }
+
+      hoNDFFT<float>::instance()->fft1c(chunk);
+      cm1->cont(cm2);
+
+      chunk_node_index_ = (int)(p*chunks + c);
+      int ret = DistributeGadget::process(cm1);
+      chunk_node_index_ = -1;
+
+      if (ret != GADGET_OK) {
+        GERROR("IsmrmrdAcquisitionDistributeGadget, failed to distribute readout chunk %d\n", (int)c);
+        m1->release();
+        return GADGET_FAIL;
+      }
+    }
+
+    m1->release();
+    return GADGET_OK;
+  }
+
+  void IsmrmrdAcquisitionDistributeGadget::job_started(int node_index, size_t sequence)
+  {
+    size_t chunks = readout_chunks.value();
+    if (chunks > 0 && sequence_collector_) {
+      sequence_collector_->set_readout_chunk(sequence, node_index / chunks, node_index % chunks);
+    }
+  }
+
   int IsmrmrdAcquisitionDistributeGadget::node_index(ACE_Message_Block* m)
+  {
+    if (chunk_node_index_ >= 0) return chunk_node_index_;
+    return this->parallel_index(m);
+  }
+
+  int IsmrmrdAcquisitionDistributeGadget::parallel_index(ACE_Message_Block* m)
   {
     auto h = AsContainerMessage<ISMRMRD::AcquisitionHeader>(m);
 
@@ -62,6 +255,34 @@ namespace Gadgetron{
     return GADGET_MESSAGE_ISMRMRD_ACQUISITION;
   }
 
+  DistributionConnectionPool::WriterFactory IsmrmrdAcquisitionDistributeGadget::link_writer_factory()
+  {
+    CompressedAcquisitionMessageWriter::Method method = CompressedAcquisitionMessageWriter::method_from_name(link_compression.value());
+    if (method == CompressedAcquisitionMessageWriter::COMPRESSION_NONE) {
+      return DistributionConnectionPool::WriterFactory();
+    }
+
+    float tolerance = link_compression_tolerance.value();
+    unsigned int precision = link_compression_precision.value();
+    bool adaptive = link_compression_adaptive.value();
+
+    //Every link gets its own writer, the adaptive decision is made per link
+    return [method, tolerance, precision, adaptive](size_t slot) -> GadgetMessageWriter* {
+      if (slot != GADGET_MESSAGE_ISMRMRD_ACQUISITION) return 0;
+      return new CompressedAcquisitionMessageWriter(method, tolerance, precision, adaptive);
+    };
+  }
+
+  std::string IsmrmrdAcquisitionDistributeGadget::link_writer_key()
+  {
+    if (link_compression.value() == "none") return std::string();
+
+    std::stringstream str;
+    str << link_compression.value() << ":" << link_compression_tolerance.value() << ":"
+        << link_compression_precision.value() << ":" << link_compression_adaptive.value();
+    return str.str();
+  }
+
   GADGET_FACTORY_DECLARE(IsmrmrdAcquisitionDistributeGadget)
 
 }
@@ -14,7 +14,7 @@ namespace Gadgetron{
   {
   public:
     GADGET_DECLARE(IsmrmrdAcquisitionDistributeGadget);
-    IsmrmrdAcquisitionDistributeGadget() {}
+    IsmrmrdAcquisitionDistributeGadget();
     virtual ~IsmrmrdAcquisitionDistributeGadget() {}
 
   protected:
@@ -39,10 +39,55 @@ namespace Gadgetron{
       "user_6",
       "user_7");
 
+    GADGET_PROPERTY_LIMITS(link_compression, std::string,
+      "Compression of the readouts sent to the nodes, zfp falls back to nhlbi without ZFP support", "none",
+      GadgetPropertyLimitsEnumeration,
+      "none",
+      "nhlbi",
+      "zfp");
+    GADGET_PROPERTY(link_compression_tolerance, float,
+      "Absolute error bound of the link compression, if <= 0 link_compression_precision is used", 0);
+    GADGET_PROPERTY(link_compression_precision, unsigned int,
+      "Bits of precision kept by the link compression if no tolerance is given", 24);
+    GADGET_PROPERTY(link_compression_adaptive, bool,
+      "Compress only while the measured link throughput makes it faster than sending the raw readouts", true);
+
+    GADGET_PROPERTY(readout_chunks, size_t,
+      "Number of chunks along the readout that every job is split into, each chunk is reconstructed on its own node; 0 disables the readout partition", 0);
+
+
+      /**
+      With readout_chunks, the readouts are transformed to image space along RO, cropped to the recon field of view and
+      split into readout_chunks chunks, which are transformed back and sent to the nodes as readouts of their own.
+      Chunk c of the job of parallel index p goes to node index p*readout_chunks + c. The nodes get a header with the
+      encoded and recon space of one chunk and reconstruct it like any other acquisition, e.g. with GRAPPA or SPIRIT
+      calibrated on the chunk; the CollectGadget puts the images of the chunks back together.
+      The readouts must still be oversampled as in the encoded space, the crop replaces the RO oversampling removal.
+      */
+      virtual int process(ACE_Message_Block* m);
+      virtual int process_config(ACE_Message_Block* m);
 
       virtual int node_index(ACE_Message_Block* m);
       virtual int message_id(ACE_Message_Block* m);
 
+      virtual void job_started(int node_index, size_t sequence);
+
+      /// parallel index of a readout, from parallel_dimension
+      int parallel_index(ACE_Message_Block* m);
+
+      /// sends the chunks of one readout to their nodes
+      int process_readout_chunks(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1);
+
+      virtual DistributionConnectionPool::WriterFactory link_writer_factory();
+      virtual std::string link_writer_key();
+
+      /// readout partition of the current series, chunk_node_index_ is the node index of the chunk being sent
+      size_t encoded_readout_;
+      size_t readout_crop_start_;
+      size_t readout_crop_;
+      size_t chunk_size_;
+      int chunk_node_index_;
+
     };
   }
 #endif //ISMRMRDACQUISITIONDISTRIBUTEGADGET_H
@@ -0,0 +1,81 @@
+#include "IsmrmrdReconDataDistributeGadget.h"
+#include "IsmrmrdReconDataMessageReadWrite.h"
+#include "GadgetMRIHeaders.h"
+
+#include <sstream>
+
+namespace Gadgetron{
+
+  int IsmrmrdReconDataDistributeGadget::node_index(ACE_Message_Block* m)
+  {
+    auto recon_data = AsContainerMessage<IsmrmrdReconData>(m);
+
+    if (!recon_data) return GADGET_FAIL;
+
+    IsmrmrdReconData& rd = *recon_data->getObjectPtr();
+    if (rd.rbit_.empty() || rd.rbit_[0].data_.headers_.get_number_of_elements() == 0) {
+      GERROR("IsmrmrdReconDataDistributeGadget, recon data without acquisition headers\n");
+      return -1;
+    }
+
+    const ISMRMRD::AcquisitionHeader& h = rd.rbit_[0].data_.headers_[0];
+
+    std::string parallel_dimension_local = parallel_dimension.value();
+
+    if (parallel_dimension_local.size() == 0) {
+      return -1;
+    } else if (parallel_dimension_local.compare("average") == 0) {
+      return h.idx.average;
+    } else if (parallel_dimension_local.compare("slice") == 0) {
+      return h.idx.slice;
+    } else if (parallel_dimension_local.compare("contrast") == 0) {
+      return h.idx.contrast;
+    } else if (parallel_dimension_local.compare("phase") == 0) {
+      return h.idx.phase;
+    } else if (parallel_dimension_local.compare("repetition") == 0) {
+      return h.idx.repetition;
+    } else if (parallel_dimension_local.compare("set") == 0) {
+      return h.idx.set;
+    } else {
+      GERROR("ERROR: Unkown parallel dimension\n");
+      return -1;
+    }
+    return -1; //We should never reach this
+  }
+
+  int IsmrmrdReconDataDistributeGadget::message_id(ACE_Message_Block* m)
+  {
+    auto recon_data = AsContainerMessage<IsmrmrdReconData>(m);
+    if (!recon_data) return 0;
+
+    return GADGET_MESSAGE_RECONDATA;
+  }
+
+  DistributionConnectionPool::WriterFactory IsmrmrdReconDataDistributeGadget::link_writer_factory()
+  {
+    std::string compression = link_compression.value();
+    if (compression == "none") {
+      return DistributionConnectionPool::WriterFactory();
+    }
+
+    float tolerance = link_compression_tolerance.value();
+    uint32_t mode = (compression == "zfp" && tolerance > 0) ? IMAGE_COMPRESSION_ZFP : IMAGE_COMPRESSION_LOSSLESS;
+
+    return [mode, tolerance](size_t slot) -> GadgetMessageWriter* {
+      if (slot != GADGET_MESSAGE_RECONDATA) return 0;
+      return new IsmrmrdReconDataMessageWriter(mode, tolerance);
+    };
+  }
+
+  std::string IsmrmrdReconDataDistributeGadget::link_writer_key()
+  {
+    if (link_compression.value() == "none") return std::string();
+
+    std::stringstream str;
+    str << "recondata:" << link_compression.value() << ":" << link_compression_tolerance.value();
+    return str.str();
+  }
+
+  GADGET_FACTORY_DECLARE(IsmrmrdReconDataDistributeGadget)
+
+}
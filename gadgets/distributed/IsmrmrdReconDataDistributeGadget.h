@@ -0,0 +1,50 @@
+#ifndef ISMRMRDRECONDATADISTRIBUTEGADGET_H
+#define ISMRMRDRECONDATADISTRIBUTEGADGET_H
+
+#include "Gadget.h"
+#include "gadgetron_distributed_gadgets_export.h"
+#include "DistributeGadget.h"
+#include "mri_core_data.h"
+
+namespace Gadgetron{
+
+  /**
+  Distributes the IsmrmrdReconData of the BucketToBufferGadget, one GADGET_MESSAGE_RECONDATA message per job.
+  The node configuration needs the IsmrmrdReconDataMessageReader and Writer in slot 1023, the results are
+  collected as usual with the CollectGadget.
+  */
+  class EXPORTDISTRIBUTEDGADGETS IsmrmrdReconDataDistributeGadget : public DistributeGadget
+  {
+  public:
+    GADGET_DECLARE(IsmrmrdReconDataDistributeGadget);
+    IsmrmrdReconDataDistributeGadget() {}
+    virtual ~IsmrmrdReconDataDistributeGadget() {}
+
+  protected:
+    GADGET_PROPERTY_LIMITS(parallel_dimension, std::string,
+      "Dimension that data will be parallelized over, taken from the first acquisition header of the buffer", "slice",
+      GadgetPropertyLimitsEnumeration,
+      "average",
+      "slice",
+      "contrast",
+      "phase",
+      "repetition",
+      "set");
+
+    GADGET_PROPERTY_LIMITS(link_compression, std::string,
+      "Compression of the buffered samples sent to the nodes, zfp falls back to lossless for half precision buffers", "none",
+      GadgetPropertyLimitsEnumeration,
+      "none",
+      "lossless",
+      "zfp");
+    GADGET_PROPERTY(link_compression_tolerance, float,
+      "Absolute error bound of the zfp link compression, lossless compression is used if <= 0", 0);
+
+    virtual int node_index(ACE_Message_Block* m);
+    virtual int message_id(ACE_Message_Block* m);
+
+    virtual DistributionConnectionPool::WriterFactory link_writer_factory();
+    virtual std::string link_writer_key();
+  };
+}
+#endif //ISMRMRDRECONDATADISTRIBUTEGADGET_H
@@ -0,0 +1,399 @@
+#include "IsmrmrdReconDataMessageReadWrite.h"
+#include "GadgetContainerMessage.h"
+#include "GadgetMRIHeaders.h"
+#include "GadgetWorkerPool.h"
+#include "log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+namespace Gadgetron{
+
+  namespace {
+
+    //Kept well below IOV_MAX, longer lists are sent in several writes
+    const size_t MAX_IOVECS_PER_WRITE = 64;
+
+    /// runs task(0) ... task(n-1), the calling thread takes the first one and the workers the others
+    bool run_chunks(size_t n, const std::function<bool(size_t)>& task)
+    {
+      std::mutex mutex;
+      std::condition_variable done;
+      size_t remaining = n;
+      bool failed = false;
+
+      auto run = [&](size_t c)
+      {
+        bool ok = false;
+        try
+        {
+          ok = task(c);
+        }
+        catch (std::exception& e)
+        {
+          GERROR("IsmrmrdReconData link, chunk failed: %s\n", e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok) failed = true;
+        remaining--;
+        done.notify_all();
+      };
+
+      for (size_t c = 1; c < n; c++)
+      {
+        GadgetWorkerPool::instance()->submit([&run, c]() { run(c); });
+      }
+      if (n > 0) run(0);
+
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&remaining]() { return remaining == 0; });
+      return !failed;
+    }
+
+    template <typename T> bool set_dimensions(const hoNDArray<T>& a, IsmrmrdArrayMessageDimensions& d)
+    {
+      std::memset(&d, 0, sizeof(d));
+      if (a.get_number_of_elements() == 0) return true;
+      if (a.get_number_of_dimensions() > IsmrmrdArrayMessageDimensions::MAX_DIMENSIONS) return false;
+
+      d.ndims = a.get_number_of_dimensions();
+      for (size_t n = 0; n < d.ndims; n++) d.dims[n] = a.get_size(n);
+      return true;
+    }
+
+    size_t number_of_elements(const IsmrmrdArrayMessageDimensions& d)
+    {
+      if (d.ndims == 0) return 0;
+      size_t elements = 1;
+      for (size_t n = 0; n < d.ndims; n++) elements *= d.dims[n];
+      return elements;
+    }
+
+    /// creates the array for the dimensions, false if they are not valid
+    template <typename T> bool create_array(const IsmrmrdArrayMessageDimensions& d, hoNDArray<T>& a)
+    {
+      if (d.ndims > IsmrmrdArrayMessageDimensions::MAX_DIMENSIONS) return false;
+      if (d.ndims == 0) return true;
+
+      std::vector<size_t> dims(d.dims, d.dims + d.ndims);
+      a.create(dims);
+      return true;
+    }
+  }
+
+  IsmrmrdReconDataMessageWriter::IsmrmrdReconDataMessageWriter(uint32_t mode, float tolerance)
+    : mode_(mode)
+    , tolerance_(tolerance)
+  {
+  }
+
+  uint32_t IsmrmrdReconDataMessageWriter::compression_mode(uint16_t data_type) const
+  {
+    if (mode_ == IMAGE_COMPRESSION_ZFP && tolerance_ > 0 && image_compression_available(IMAGE_COMPRESSION_ZFP, data_type)) {
+      return IMAGE_COMPRESSION_ZFP;
+    }
+
+    if (mode_ != IMAGE_COMPRESSION_NONE && image_compression_available(IMAGE_COMPRESSION_LOSSLESS, data_type)) {
+      return IMAGE_COMPRESSION_LOSSLESS;
+    }
+
+    return IMAGE_COMPRESSION_NONE;
+  }
+
+  bool IsmrmrdReconDataMessageWriter::compress(uint32_t mode, uint16_t data_type, const void* data, size_t elements, size_t line, CompressedSamples& out)
+  {
+    const size_t element_size = image_element_size(data_type);
+    if (line == 0 || (elements % line) != 0) line = elements;
+
+    const size_t lines = elements / line;
+    size_t lines_per_chunk = std::max<size_t>(1, COMPRESSION_CHUNK_BYTES / (line*element_size));
+    lines_per_chunk = std::max<size_t>(lines_per_chunk, (lines + MAX_COMPRESSION_CHUNKS - 1) / MAX_COMPRESSION_CHUNKS);
+    const size_t chunks = (lines + lines_per_chunk - 1) / lines_per_chunk;
+
+    out.table.resize(chunks);
+    out.chunks.resize(chunks);
+
+    const float tolerance = tolerance_;
+    bool ok = run_chunks(chunks, [&](size_t c)
+    {
+      const size_t first = c*lines_per_chunk*line;
+      out.table[c].elements = std::min(lines_per_chunk*line, elements - first);
+      compress_image_chunk(mode, tolerance, data_type, static_cast<const char*>(data) + first*element_size,
+                           out.table[c].elements, line, out.chunks[c]);
+      out.table[c].bytes = out.chunks[c].size();
+      return true;
+    });
+
+    if (!ok) return false;
+
+    size_t compressed_bytes = 0;
+    for (size_t c = 0; c < chunks; c++) compressed_bytes += out.chunks[c].size();
+
+    //Incompressible samples are cheaper to send as they are
+    if (compressed_bytes + chunks*sizeof(ImageCompressionChunk) >= elements*element_size) return false;
+
+    out.header.mode = mode;
+    out.header.chunks = (uint32_t)chunks;
+    out.header.uncompressed_bytes = elements*element_size;
+    return true;
+  }
+
+  int IsmrmrdReconDataMessageWriter::write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+  {
+    auto m = AsContainerMessage<IsmrmrdReconData>(mb);
+    if (!m) {
+      GERROR("IsmrmrdReconDataMessageWriter, invalid recon data message objects\n");
+      return -1;
+    }
+
+    IsmrmrdReconData& recon_data = *m->getObjectPtr();
+    const size_t bits = recon_data.rbit_.size();
+
+    GadgetMessageIdentifier id;
+    id.id = GADGET_MESSAGE_RECONDATA;
+
+    IsmrmrdReconDataMessageHeader header;
+    header.bits = (uint32_t)bits;
+    header.reserved = 0;
+
+    //Everything the iovecs point to has to stay where it is until the message is sent
+    std::vector<IsmrmrdDataBufferedMessageHeader> buffer_headers(2*bits);
+    std::list<CompressedSamples> compressed;
+    std::vector<iovec> iov;
+
+    auto add = [&iov](const void* ptr, size_t len) {
+      if (!len) return;
+      iovec v;
+      v.iov_base = reinterpret_cast<char*>(const_cast<void*>(ptr));
+      v.iov_len = len;
+      iov.push_back(v);
+    };
+
+    add(&id, sizeof(GadgetMessageIdentifier));
+    add(&header, sizeof(IsmrmrdReconDataMessageHeader));
+
+    for (size_t b = 0; b < bits; b++) {
+      IsmrmrdReconBit& bit = recon_data.rbit_[b];
+
+      for (size_t k = 0; k < 2; k++) {
+        IsmrmrdDataBufferedMessageHeader& h = buffer_headers[2*b + k];
+        std::memset(&h, 0, sizeof(IsmrmrdDataBufferedMessageHeader));
+
+        const IsmrmrdDataBuffered* buffer = (k == 0) ? &bit.data_ : (bit.ref_ ? &(*bit.ref_) : 0);
+        if (!buffer) {
+          add(&h, sizeof(IsmrmrdDataBufferedMessageHeader));
+          continue;
+        }
+
+        h.flags = IsmrmrdDataBufferedMessageHeader::BUFFER_PRESENT;
+        h.sampling = buffer->sampling_;
+
+        //Half precision samples are compressed as pairs of 16 bit integers
+        const void* samples = 0;
+        size_t elements = 0;
+        size_t line = 0;
+        uint16_t data_type = ISMRMRD::ISMRMRD_CXFLOAT;
+        bool dims_ok = true;
+
+        if (buffer->data_half_) {
+          h.flags |= IsmrmrdDataBufferedMessageHeader::HALF_PRECISION;
+          dims_ok = set_dimensions(*buffer->data_half_, h.data);
+          samples = buffer->data_half_->begin();
+          elements = 2*buffer->data_half_->get_number_of_elements();
+          line = (buffer->data_half_->get_number_of_dimensions() > 0) ? 2*buffer->data_half_->get_size(0) : 0;
+          data_type = ISMRMRD::ISMRMRD_USHORT;
+        } else {
+          dims_ok = set_dimensions(buffer->data_, h.data);
+          samples = buffer->data_.begin();
+          elements = buffer->data_.get_number_of_elements();
+          line = (buffer->data_.get_number_of_dimensions() > 0) ? buffer->data_.get_size(0) : 0;
+        }
+
+        if (buffer->trajectory_) {
+          h.flags |= IsmrmrdDataBufferedMessageHeader::TRAJECTORY_PRESENT;
+          dims_ok = dims_ok && set_dimensions(*buffer->trajectory_, h.trajectory);
+        }
+
+        dims_ok = dims_ok && set_dimensions(buffer->headers_, h.headers);
+        if (!dims_ok) {
+          GERROR("IsmrmrdReconDataMessageWriter, arrays with more than %d dimensions cannot be sent\n", (int)IsmrmrdArrayMessageDimensions::MAX_DIMENSIONS);
+          return -1;
+        }
+
+        add(&h, sizeof(IsmrmrdDataBufferedMessageHeader));
+
+        uint32_t mode = elements ? this->compression_mode(data_type) : (uint32_t)IMAGE_COMPRESSION_NONE;
+        if (mode != IMAGE_COMPRESSION_NONE) {
+          compressed.push_back(CompressedSamples());
+          if (!this->compress(mode, data_type, samples, elements, line, compressed.back())) {
+            compressed.pop_back();
+            mode = IMAGE_COMPRESSION_NONE;
+          }
+        }
+        h.compression = mode;
+
+        if (mode != IMAGE_COMPRESSION_NONE) {
+          CompressedSamples& c = compressed.back();
+          add(&c.header, sizeof(ImageCompressionHeader));
+          add(c.table.data(), c.table.size()*sizeof(ImageCompressionChunk));
+          for (size_t n = 0; n < c.chunks.size(); n++) add(c.chunks[n].data(), c.chunks[n].size());
+        } else {
+          add(samples, elements*image_element_size(data_type));
+        }
+
+        add(buffer->headers_.begin(), buffer->headers_.get_number_of_bytes());
+        if (buffer->trajectory_) add(buffer->trajectory_->begin(), buffer->trajectory_->get_number_of_bytes());
+      }
+    }
+
+    for (size_t first = 0; first < iov.size(); first += MAX_IOVECS_PER_WRITE) {
+      int n = (int)std::min(MAX_IOVECS_PER_WRITE, iov.size() - first);
+      if (sock->sendv_n(&iov[first], n) <= 0) {
+        GERROR("IsmrmrdReconDataMessageWriter, unable to send recon data\n");
+        return -1;
+      }
+    }
+
+    return 0;
+  }
+
+  bool IsmrmrdReconDataMessageReader::read_samples(ACE_SOCK_Stream* stream, uint32_t mode, uint16_t data_type, void* data, size_t elements)
+  {
+    const size_t bytes = elements*image_element_size(data_type);
+
+    if (mode == IMAGE_COMPRESSION_NONE) {
+      return bytes == 0 || stream->recv_n(data, bytes) > 0;
+    }
+
+    if (!image_compression_available(mode, data_type)) {
+      GERROR("IsmrmrdReconDataMessageReader, compression mode %d is not available\n", (int)mode);
+      return false;
+    }
+
+    ImageCompressionHeader header;
+    if (stream->recv_n(&header, sizeof(ImageCompressionHeader)) <= 0) return false;
+    if (header.uncompressed_bytes != bytes || header.chunks == 0 || header.chunks > IsmrmrdReconDataMessageWriter::MAX_COMPRESSION_CHUNKS) {
+      GERROR("IsmrmrdReconDataMessageReader, invalid compression header\n");
+      return false;
+    }
+
+    std::vector<ImageCompressionChunk> table(header.chunks);
+    if (stream->recv_n(table.data(), table.size()*sizeof(ImageCompressionChunk)) <= 0) return false;
+
+    size_t elements_total = 0;
+    size_t compressed_bytes = 0;
+    std::vector<size_t> offsets(table.size());
+    for (size_t c = 0; c < table.size(); c++) {
+      offsets[c] = compressed_bytes;
+      elements_total += table[c].elements;
+      compressed_bytes += table[c].bytes;
+    }
+
+    if (elements_total != elements) {
+      GERROR("IsmrmrdReconDataMessageReader, the compressed chunks do not match the buffer\n");
+      return false;
+    }
+
+    std::vector<char> in(compressed_bytes);
+    if (compressed_bytes && stream->recv_n(in.data(), compressed_bytes) <= 0) return false;
+
+    const size_t element_size = image_element_size(data_type);
+    return run_chunks(table.size(), [&](size_t c)
+    {
+      size_t first = 0;
+      for (size_t k = 0; k < c; k++) first += table[k].elements;
+      decompress_image_chunk(mode, data_type, in.data() + offsets[c], table[c].bytes,
+                             static_cast<char*>(data) + first*element_size, table[c].elements);
+      return true;
+    });
+  }
+
+  bool IsmrmrdReconDataMessageReader::read_buffer(ACE_SOCK_Stream* stream, const IsmrmrdDataBufferedMessageHeader& h, IsmrmrdDataBuffered& buffer)
+  {
+    buffer.sampling_ = h.sampling;
+
+    if (!create_array(h.headers, buffer.headers_)) return false;
+
+    if (h.flags & IsmrmrdDataBufferedMessageHeader::HALF_PRECISION) {
+      buffer.data_half_ = hoNDArray<complex_half>();
+      if (!create_array(h.data, *buffer.data_half_)) return false;
+      if (!this->read_samples(stream, h.compression, ISMRMRD::ISMRMRD_USHORT, buffer.data_half_->begin(), 2*number_of_elements(h.data))) return false;
+    } else {
+      if (!create_array(h.data, buffer.data_)) return false;
+      if (!this->read_samples(stream, h.compression, ISMRMRD::ISMRMRD_CXFLOAT, buffer.data_.begin(), number_of_elements(h.data))) return false;
+    }
+
+    if (buffer.headers_.get_number_of_bytes() && stream->recv_n(buffer.headers_.begin(), buffer.headers_.get_number_of_bytes()) <= 0) return false;
+
+    if (h.flags & IsmrmrdDataBufferedMessageHeader::TRAJECTORY_PRESENT) {
+      buffer.trajectory_ = hoNDArray<float>();
+      if (!create_array(h.trajectory, *buffer.trajectory_)) return false;
+      if (buffer.trajectory_->get_number_of_bytes() && stream->recv_n(buffer.trajectory_->begin(), buffer.trajectory_->get_number_of_bytes()) <= 0) return false;
+    }
+
+    return true;
+  }
+
+  ACE_Message_Block* IsmrmrdReconDataMessageReader::read(ACE_SOCK_Stream* stream)
+  {
+    IsmrmrdReconDataMessageHeader header;
+    if (stream->recv_n(&header, sizeof(IsmrmrdReconDataMessageHeader)) <= 0) {
+      GERROR("IsmrmrdReconDataMessageReader, failed to read the message header\n");
+      return 0;
+    }
+
+    if (header.bits > MAX_BITS) {
+      GERROR("IsmrmrdReconDataMessageReader, invalid number of recon bits %d\n", (int)header.bits);
+      return 0;
+    }
+
+    auto m = new GadgetContainerMessage<IsmrmrdReconData>();
+    IsmrmrdReconData& recon_data = *m->getObjectPtr();
+    recon_data.rbit_.resize(header.bits);
+
+    for (size_t b = 0; b < header.bits; b++) {
+      for (size_t k = 0; k < 2; k++) {
+        IsmrmrdDataBufferedMessageHeader h;
+        if (stream->recv_n(&h, sizeof(IsmrmrdDataBufferedMessageHeader)) <= 0) {
+          GERROR("IsmrmrdReconDataMessageReader, failed to read the buffer header\n");
+          m->release();
+          return 0;
+        }
+
+        if (!(h.flags & IsmrmrdDataBufferedMessageHeader::BUFFER_PRESENT)) continue;
+
+        IsmrmrdDataBuffered* buffer = &recon_data.rbit_[b].data_;
+        if (k == 1) {
+          recon_data.rbit_[b].ref_ = IsmrmrdDataBuffered();
+          buffer = &(*recon_data.rbit_[b].ref_);
+        }
+
+        bool ok = false;
+        try
+        {
+          ok = this->read_buffer(stream, h, *buffer);
+        }
+        catch (std::exception& e)
+        {
+          GERROR("IsmrmrdReconDataMessageReader, unable to create the buffer: %s\n", e.what());
+        }
+
+        if (!ok) {
+          GERROR("IsmrmrdReconDataMessageReader, failed to read the buffer\n");
+          m->release();
+          return 0;
+        }
+      }
+    }
+
+    return m;
+  }
+
+  GADGETRON_WRITER_FACTORY_DECLARE(IsmrmrdReconDataMessageWriter)
+  GADGETRON_READER_FACTORY_DECLARE(IsmrmrdReconDataMessageReader)
+}
@@ -0,0 +1,113 @@
+/** \file   IsmrmrdReconDataMessageReadWrite.h
+    \brief  Reader and writer of whole IsmrmrdReconData units for the links between distributed nodes.
+
+            With the IsmrmrdReconDataDistributeGadget the accumulation, trigger and buffering are done once,
+            before the distribution, and every job is one GADGET_MESSAGE_RECONDATA message instead of
+            thousands of acquisitions. The compute node starts the recon as soon as the message is read.
+
+            The message is sent with a single scatter-gather write from the arrays of the buffers:
+
+              IsmrmrdReconDataMessageHeader
+              per recon bit, for data_ and then ref_:
+                IsmrmrdDataBufferedMessageHeader
+                if the buffer is present:
+                  the samples, raw or ImageCompressionHeader, ImageCompressionChunk[chunks] and the chunks
+                  the acquisition headers
+                  the trajectory, if present
+
+            The samples are compressed like the images returned to the client (see ImageCompression.h): in
+            chunks of whole E0 lines, compressed in parallel on the GadgetWorkerPool. Half precision buffers are
+            sent in half precision, ZFP falls back to lossless compression for them.
+*/
+
+#ifndef ISMRMRDRECONDATAMESSAGEREADWRITE_H
+#define ISMRMRDRECONDATAMESSAGEREADWRITE_H
+#pragma once
+
+#include "gadgetron_distributed_gadgets_export.h"
+#include "GadgetMessageInterface.h"
+#include "mri_core_data.h"
+#include "ImageCompression.h"
+
+#include <ace/SOCK_Stream.h>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace Gadgetron{
+
+  /// Dimensions of an array on the wire, ndims 0 for an empty array
+  struct IsmrmrdArrayMessageDimensions
+  {
+    enum { MAX_DIMENSIONS = 8 };
+    uint64_t ndims;
+    uint64_t dims[MAX_DIMENSIONS];
+  };
+
+  struct IsmrmrdReconDataMessageHeader
+  {
+    uint32_t bits;
+    uint32_t reserved;
+  };
+
+  struct IsmrmrdDataBufferedMessageHeader
+  {
+    enum { BUFFER_PRESENT = 1, HALF_PRECISION = 2, TRAJECTORY_PRESENT = 4 };
+
+    uint32_t flags;
+    uint32_t compression; //ImageCompressionMode of the samples
+    IsmrmrdArrayMessageDimensions data;
+    IsmrmrdArrayMessageDimensions headers;
+    IsmrmrdArrayMessageDimensions trajectory;
+    SamplingDescription sampling;
+  };
+
+  class EXPORTDISTRIBUTEDGADGETS IsmrmrdReconDataMessageWriter : public GadgetMessageWriter
+  {
+  public:
+    GADGETRON_WRITER_DECLARE(IsmrmrdReconDataMessageWriter)
+
+    /// Samples are compressed in chunks of about this size, at most MAX_COMPRESSION_CHUNKS per buffer
+    enum { COMPRESSION_CHUNK_BYTES = 1024*1024, MAX_COMPRESSION_CHUNKS = 256 };
+
+    /// mode is an ImageCompressionMode, tolerance the absolute error bound of ZFP
+    IsmrmrdReconDataMessageWriter(uint32_t mode = IMAGE_COMPRESSION_NONE, float tolerance = 0);
+
+    virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb);
+
+  protected:
+
+    struct CompressedSamples
+    {
+      ImageCompressionHeader header;
+      std::vector<ImageCompressionChunk> table;
+      std::vector< std::vector<char> > chunks;
+    };
+
+    /// mode used for samples of the data type, the configured one if this build has it
+    uint32_t compression_mode(uint16_t data_type) const;
+
+    /// compresses elements samples in chunks of whole lines, false if it fails or does not pay off
+    bool compress(uint32_t mode, uint16_t data_type, const void* data, size_t elements, size_t line, CompressedSamples& out);
+
+    uint32_t mode_;
+    float tolerance_;
+  };
+
+  class EXPORTDISTRIBUTEDGADGETS IsmrmrdReconDataMessageReader : public GadgetMessageReader
+  {
+  public:
+    GADGETRON_READER_DECLARE(IsmrmrdReconDataMessageReader);
+
+    /// Upper bound of the recon bits of a message, larger counts are taken for a corrupt stream
+    enum { MAX_BITS = 65536 };
+
+    virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream);
+
+  protected:
+    bool read_buffer(ACE_SOCK_Stream* stream, const IsmrmrdDataBufferedMessageHeader& h, IsmrmrdDataBuffered& buffer);
+    bool read_samples(ACE_SOCK_Stream* stream, uint32_t mode, uint16_t data_type, void* data, size_t elements);
+  };
+}
+
+#endif //ISMRMRDRECONDATAMESSAGEREADWRITE_H
@@ -0,0 +1,245 @@
+#include "EPIBatchReconGadget.h"
+#include "EPIReconXGadget.h"
+#include "ismrmrd/xml.h"
+#include "hoNDFFT.h"
+
+#ifdef USE_OMP
+#include "omp.h"
+#endif // USE_OMP
+
+namespace Gadgetron{
+
+  EPIBatchReconGadget::EPIBatchReconGadget()
+    : oversamplng_ratio2_(1.0f)
+    , train_length_(1)
+    , num_pos_(0)
+    , num_neg_(0)
+  {
+    omp_threads.value(1);
+  }
+
+  EPIBatchReconGadget::~EPIBatchReconGadget()
+  {
+    for (size_t n = 0; n < train_.size(); n++) train_[n].m1->release();
+  }
+
+int EPIBatchReconGadget::process_config(ACE_Message_Block* mb)
+{
+  if (EPICorrGadget::process_config(mb) != 0) {
+    return GADGET_FAIL;
+  }
+
+  ISMRMRD::IsmrmrdHeader h;
+  ISMRMRD::deserialize(mb->rd_ptr(),h);
+
+  if (EPIReconXGadget::configure_reconx(h, reconx, reconx_other, oversamplng_ratio2_) != 0) {
+    return GADGET_FAIL;
+  }
+
+  if (etl_ > 0) {
+    train_length_ = etl_;
+  } else {
+    GWARN("EPIBatchReconGadget, the echo train length (etl) is missing, the echoes are processed one by one\n");
+    train_length_ = 1;
+  }
+
+  return 0;
+}
+
+int EPIBatchReconGadget::process(
+          GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
+      GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2)
+{
+  ISMRMRD::AcquisitionHeader &hdr = *m1->getObjectPtr();
+  hoNDArray< std::complex<float> >& data = *m2->getObjectPtr();
+
+  // Non-EPI data (e.g. FLASH Calibration) is reconstructed line by line,
+  // after the echoes received before it
+  if (hdr.encoding_space_ref > 0) {
+    if (process_echo_train() != GADGET_OK) {
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    ISMRMRD::AcquisitionHeader hdr_out;
+    hoNDArray< std::complex<float> > data_out(reconx_other.reconNx_, data.get_size(1));
+    EPIReconXGadget::apply_reconx_other(reconx_other, oversamplng_ratio2_, hdr, data, hdr_out, data_out);
+    hoNDFFT<float>::instance()->fft1c(data_out);
+
+    hdr = hdr_out;
+    data = data_out;
+    return pass_on(m1);
+  }
+
+  // The navigators of the next shot end the current echo train
+  if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA)) {
+    if (process_echo_train() != GADGET_OK) {
+      m1->release();
+      return GADGET_FAIL;
+    }
+
+    ISMRMRD::AcquisitionHeader hdr_out;
+    hoNDArray< std::complex<float> > data_out(reconx.reconNx_, data.get_size(1));
+    reconx.apply(hdr, data, hdr_out, data_out);
+    process_navigator(hdr_out, as_arma_matrix(&data_out));
+
+    m1->release();
+    return GADGET_OK;
+  }
+
+  // An imaging echo, stored with the others of its polarity
+  size_t RO = data.get_size(0);
+  size_t CHA = data.get_size(1);
+
+  if (!train_.empty() && (data_pos_.get_size(0) != RO || data_pos_.get_size(1) != CHA)) {
+    if (process_echo_train() != GADGET_OK) {
+      m1->release();
+      return GADGET_FAIL;
+    }
+  }
+
+  if (data_pos_.get_size(0) != RO || data_pos_.get_size(1) != CHA || data_pos_.get_size(2) != train_length_) {
+    data_pos_.create(RO, CHA, train_length_);
+    data_neg_.create(RO, CHA, train_length_);
+  }
+
+  epiEchoNumber_ += 1;
+  if (epiEchoNumber_ == 0) {
+    // Phase evolution is corrected with respect to echo 0, see the EPICorrGadget
+    RefNav_to_Echo0_time_ES_ = 0;
+  }
+
+  Echo e;
+  e.m1 = m1;
+  e.m2 = m2;
+  e.reverse = hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
+  e.index = e.reverse ? num_neg_++ : num_pos_++;
+  e.echo_number = epiEchoNumber_;
+
+  hoNDArray< std::complex<float> >& buf = e.reverse ? data_neg_ : data_pos_;
+  memcpy(buf.begin() + e.index * RO * CHA, data.begin(), data.get_number_of_bytes());
+  train_.push_back(e);
+
+  if (train_.size() == train_length_) {
+    return process_echo_train();
+  }
+
+  return GADGET_OK;
+}
+
+int EPIBatchReconGadget::process_echo_train()
+{
+  if (train_.empty()) return GADGET_OK;
+
+  size_t RO = data_pos_.get_size(0);
+  size_t CHA = data_pos_.get_size(1);
+  size_t Nx = reconx.reconNx_;
+  size_t N = train_.size();
+
+  // Resampling, one matrix-matrix product per readout polarity, the positive
+  // echoes go to the first part of data_x_ and the negative ones after them
+  if (data_x_.get_size(0) != Nx || data_x_.get_size(1) != CHA || data_x_.get_size(2) != N) {
+    data_x_.create(Nx, CHA, N);
+  }
+
+  for (size_t n = 0; n < N; n++) {
+    Echo& e = train_[n];
+    if (e.index != 0) continue;
+
+    size_t num = e.reverse ? num_neg_ : num_pos_;
+    size_t first = e.reverse ? num_pos_ : 0;
+    hoNDArray< std::complex<float> > in(RO, CHA * num, (e.reverse ? data_neg_ : data_pos_).begin());
+    hoNDArray< std::complex<float> > out(Nx, CHA * num, data_x_.begin() + first * Nx * CHA);
+
+    if (reconx.applyBatch(*e.m1->getObjectPtr(), in, out) != 0) {
+      GERROR("EPIBatchReconGadget::process_echo_train, resampling of the echo train failed\n");
+      for (size_t k = 0; k < N; k++) train_[k].m1->release();
+      train_.clear();
+      num_pos_ = num_neg_ = 0;
+      return GADGET_FAIL;
+    }
+  }
+
+  // Phase correction: corrB0_^(echo + RefNav_to_Echo0_time_ES_) times the odd-even term,
+  // for all echoes at once
+  if (corrComputed_ && corrB0_.n_elem == Nx) {
+    arma::fvec phi(Nx);
+    for (size_t x = 0; x < Nx; x++) phi(x) = std::arg(corrB0_(x));
+
+    arma::fvec echoes(N);
+    for (size_t n = 0; n < N; n++) echoes(n) = train_[n].echo_number + RefNav_to_Echo0_time_ES_;
+
+    arma::cx_fmat corr = arma::exp(arma::cx_fmat(arma::zeros<arma::fmat>(Nx, N), phi * echoes.t()));
+
+    for (size_t n = 0; n < N; n++) {
+      Echo& e = train_[n];
+      corr.col(n) %= e.reverse ? corrneg_ : corrpos_;
+
+      size_t line = e.reverse ? num_pos_ + e.index : e.index;
+      arma::cx_fmat x(data_x_.begin() + line * Nx * CHA, Nx, CHA, false, true);
+      for (size_t c = 0; c < CHA; c++) {
+        x.col(c) %= corr.col(n);
+      }
+    }
+  } else {
+    GWARN("EPIBatchReconGadget, no navigator correction for this echo train\n");
+  }
+
+  // Back to k-space, one FFT over all echoes and channels
+  hoNDArray< std::complex<float> > x_all(Nx, CHA * N, data_x_.begin());
+  hoNDFFT<float>::instance()->fft1c(x_all);
+
+  // Pass the echoes on in the order they came
+  int ret = GADGET_OK;
+  for (size_t n = 0; n < N; n++) {
+    Echo& e = train_[n];
+    ISMRMRD::AcquisitionHeader& hdr = *e.m1->getObjectPtr();
+    hoNDArray< std::complex<float> >& data = *e.m2->getObjectPtr();
+
+    size_t line = e.reverse ? num_pos_ + e.index : e.index;
+    data.create(Nx, CHA);
+    memcpy(data.begin(), data_x_.begin() + line * Nx * CHA, data.get_number_of_bytes());
+
+    hdr.number_of_samples = Nx;
+    hdr.center_sample = Nx / 2;
+    // Now that we have corrected we set the readout direction to positive
+    hdr.clearFlag(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
+
+    if (ret == GADGET_OK) {
+      ret = pass_on(e.m1);
+    } else {
+      e.m1->release();
+    }
+  }
+
+  train_.clear();
+  num_pos_ = 0;
+  num_neg_ = 0;
+
+  return ret;
+}
+
+int EPIBatchReconGadget::pass_on(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1)
+{
+  // It is enough to put the first one, since they are linked
+  if (this->next()->putq(m1) == -1) {
+    m1->release();
+    GERROR("EPIBatchReconGadget, passing data on to next gadget\n");
+    return GADGET_FAIL;
+  }
+  return GADGET_OK;
+}
+
+int EPIBatchReconGadget::close(unsigned long flags)
+{
+  int ret = Gadget::close(flags);
+
+  if ( flags != 0 ) {
+    GDEBUG("EPIBatchReconGadget::close\n");
+    process_echo_train();
+  }
+  return ret;
+}
+
+GADGET_FACTORY_DECLARE(EPIBatchReconGadget)
+}
@@ -0,0 +1,67 @@
+#ifndef EPIBATCHRECONGADGET_H
+#define EPIBATCHRECONGADGET_H
+
+#include "EPICorrGadget.h"
+#include "EPIReconXObjectFlat.h"
+#include "EPIReconXObjectTrapezoid.h"
+
+#include <vector>
+
+namespace Gadgetron{
+
+  /**
+     Readout reconstruction of EPI in batches of one echo train, in place of the chain
+     EPIReconXGadget, EPICorrGadget and FFTXGadget.
+
+     The navigators are resampled and evaluated as they arrive, as by the EPICorrGadget (and
+     with its properties). The echoes of a shot are collected and then resampled with one
+     matrix-matrix product per readout polarity, phase corrected in one pass and transformed
+     back to k-space with one batched FFT. An echo train is processed when it has etl echoes,
+     when the navigators of the next shot or data of another encoding space arrive, and at
+     the end of the stream.
+   */
+  class EXPORTGADGETS_EPI EPIBatchReconGadget : public EPICorrGadget
+    {
+    public:
+      EPIBatchReconGadget();
+      virtual ~EPIBatchReconGadget();
+
+      virtual int close(unsigned long flags);
+
+    protected:
+      virtual int process_config(ACE_Message_Block* mb);
+      virtual int process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
+              GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2);
+
+      int process_echo_train();
+      int pass_on(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1);
+
+      // A set of reconstruction objects, as in the EPIReconXGadget
+      EPI::EPIReconXObjectTrapezoid<std::complex<float> > reconx;
+      EPI::EPIReconXObjectFlat<std::complex<float> > reconx_other;
+      float oversamplng_ratio2_;
+
+      struct Echo
+      {
+        GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1;
+        GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2;
+        bool reverse;     // negative readout
+        size_t index;     // position among the echoes of the same polarity
+        int echo_number;  // echo number in the train, for the B0 correction
+      };
+
+      // echoes of the current train in order of arrival
+      std::vector<Echo> train_;
+      size_t train_length_;
+
+      // raw echoes of the current train by polarity [numSamples CHA train_length_]
+      hoNDArray< std::complex<float> > data_pos_;
+      hoNDArray< std::complex<float> > data_neg_;
+      size_t num_pos_;
+      size_t num_neg_;
+
+      // resampled echoes, all positive ones first [reconNx CHA num_pos_+num_neg_]
+      hoNDArray< std::complex<float> > data_x_;
+    };
+}
+#endif //EPIBATCHRECONGADGET_H
@@ -106,61 +106,127 @@ int EPICorrGadget::process(
 
   // Check to see if the data is a navigator line or an imaging line
   if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA)) {
+    // Store it and, after the last navigator of the shot, compute the corrections
+    process_navigator(hdr, adata);
+  }
+  else {
+    // Increment the echo number
+    epiEchoNumber_ += 1;
 
-    // Increment the navigator counter
-    navNumber_ += 1;
+    if (epiEchoNumber_ == 0)
+    {
+        // For now, we will correct the phase evolution of each EPI line, with respect
+        //   to the first line in the EPI readout train (echo 0), due to B0 inhomogeneities.
+        //   That is, the reconstructed images will have the phase that the object had at
+        //   the beginning of the EPI readout train (excluding the phase due to encoding),
+        //   multiplied by the coil phase.
+        // Later, we could add the time between the excitation and echo 0, or between one
+        //   of the navigators and echo 0, to correct for phase differences from shot to shot.
+        //   This will be important for multi-shot EPI acquisitions.
+        RefNav_to_Echo0_time_ES_ = 0;
+    }
 
-    // If the number of navigators per shot is exceeded, then
-    // we are at the beginning of the next shot
-    if (navNumber_ == numNavigators_) {
-      corrComputed_ = false;
-      navNumber_ = 0;
-      epiEchoNumber_ = -1;
+    // Apply the correction
+    // We use the armadillo notation that loops over all the columns
+    if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE)) {
+      // Negative readout
+      for (int p=0; p<adata.n_cols; p++) {
+        adata.col(p) %= (arma::pow(corrB0_,epiEchoNumber_+RefNav_to_Echo0_time_ES_) % corrneg_);
+      }
+      // Now that we have corrected we set the readout direction to positive
+      hdr.clearFlag(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
+    } 
+    else {
+      // Positive readout
+      for (int p=0; p<adata.n_cols; p++) {
+        adata.col(p) %= (arma::pow(corrB0_,epiEchoNumber_+RefNav_to_Echo0_time_ES_) % corrpos_);
+      }
     }
-    
-    int Nx_ = adata.n_rows;
-
-    // If we are at the beginning of a shot, then initialize
-    if (navNumber_==0) {
-      // Set the size of the corrections and storage arrays
-      corrB0_.set_size(  Nx_ );
-      corrpos_.set_size( Nx_ );
-      corrneg_.set_size( Nx_ );
-      navdata_.set_size( Nx_, hdr.active_channels, numNavigators_);
-      navdata_.zeros();
-      // Store the first navigator's polarity
-      startNegative_ = hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
+  }
+
+  // Pass on the imaging data
+  // TODO: this should be controlled by a flag
+  if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA)) {
+    m1->release();
+  } 
+  else {
+    // It is enough to put the first one, since they are linked
+    if (this->next()->putq(m1) == -1) {
+      m1->release();
+      GERROR("EPICorrGadget::process, passing data on to next gadget");
+      return -1;
     }
+  }
 
-    // Store the navigator data
-    navdata_.slice(navNumber_) = adata;
-
-    // If this is the last of the navigators for this shot, then
-    // compute the correction operator
-    if (navNumber_ == (numNavigators_-1)) {
-      arma::cx_fvec ctemp =  arma::zeros<arma::cx_fvec>(Nx_);    // temp column complex
-      arma::fvec tvec = arma::zeros<arma::fvec>(Nx_);            // temp column real
-      arma::fvec x = arma::linspace<arma::fvec>(-0.5, 0.5, Nx_); // Evenly spaced x-space locations
-      arma::fmat X;
-      if ( OEPhaseCorrectionMode.value().compare("polynomial")==0 )
-      {
-          X  = arma::zeros<arma::fmat>( Nx_ ,OE_PHASE_CORR_POLY_ORDER+1);
-          X.col(0) = arma::ones<arma::fvec>( Nx_ );
-          X.col(1) = x;                       // x
-          X.col(2) = arma::square(x);         // x^2
-          X.col(3) = x % X.col(2);            // x^3
-          X.col(4) = arma::square(X.col(2));  // x^4
-      }
-      int p; // counter
-      
-      // mean of the reference navigator (across RO and channels):
-      std::complex<float> navMean = arma::mean( arma::vectorise( navdata_.slice(referenceNavigatorNumber.value()) ) );
-      //GDEBUG_STREAM("navMean = " << navMean);
+  return 0;
+}
+
+
+//////////////////////////////////////////////////////////
+//
+// process_navigator
+//
+//    function to store a navigator line and, after the last navigator of a shot,
+//    to compute the B0 and odd-even corrections for the echoes of that shot
+//    - hdr:   header of the navigator line
+//    - adata: navigator data [RO CHA]
+
+void EPICorrGadget::process_navigator( ISMRMRD::AcquisitionHeader& hdr, const arma::cx_fmat& adata )
+{
+  // Increment the navigator counter
+  navNumber_ += 1;
+
+  // If the number of navigators per shot is exceeded, then
+  // we are at the beginning of the next shot
+  if (navNumber_ == numNavigators_) {
+    corrComputed_ = false;
+    navNumber_ = 0;
+    epiEchoNumber_ = -1;
+  }
+  
+  int Nx_ = adata.n_rows;
+
+  // If we are at the beginning of a shot, then initialize
+  if (navNumber_==0) {
+    // Set the size of the corrections and storage arrays
+    corrB0_.set_size(  Nx_ );
+    corrpos_.set_size( Nx_ );
+    corrneg_.set_size( Nx_ );
+    navdata_.set_size( Nx_, hdr.active_channels, numNavigators_);
+    navdata_.zeros();
+    // Store the first navigator's polarity
+    startNegative_ = hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
+  }
+
+  // Store the navigator data
+  navdata_.slice(navNumber_) = adata;
+
+  // If this is the last of the navigators for this shot, then
+  // compute the correction operator
+  if (navNumber_ == (numNavigators_-1)) {
+    arma::cx_fvec ctemp =  arma::zeros<arma::cx_fvec>(Nx_);    // temp column complex
+    arma::fvec tvec = arma::zeros<arma::fvec>(Nx_);            // temp column real
+    arma::fvec x = arma::linspace<arma::fvec>(-0.5, 0.5, Nx_); // Evenly spaced x-space locations
+    arma::fmat X;
+    if ( OEPhaseCorrectionMode.value().compare("polynomial")==0 )
+    {
+        X  = arma::zeros<arma::fmat>( Nx_ ,OE_PHASE_CORR_POLY_ORDER+1);
+        X.col(0) = arma::ones<arma::fvec>( Nx_ );
+        X.col(1) = x;                       // x
+        X.col(2) = arma::square(x);         // x^2
+        X.col(3) = x % X.col(2);            // x^3
+        X.col(4) = arma::square(X.col(2));  // x^4
+    }
+    int p; // counter
+    
+    // mean of the reference navigator (across RO and channels):
+    std::complex<float> navMean = arma::mean( arma::vectorise( navdata_.slice(referenceNavigatorNumber.value()) ) );
+    //GDEBUG_STREAM("navMean = " << navMean);
 	
-      // for clarity, we'll use the following when filtering navigator parameters:
-      size_t set, slc, exc;
-      if (navigatorParameterFilterLength.value() > 1)
-      {
+    // for clarity, we'll use the following when filtering navigator parameters:
+    size_t set, slc, exc;
+    if (navigatorParameterFilterLength.value() > 1)
+    {
 	  set = hdr.idx.set;
 	  slc = hdr.idx.slice;
 	  // Careful: kspace_encode_step_2 for a navigator is always 0, and at this point we
@@ -178,33 +244,33 @@ int EPICorrGadget::process(
 	      this->increase_no_repetitions( 100 );     // add 100 volumes more, to be safe
 	  }
 	  Nav_mag_(exc, set, slc) = std::abs(navMean);
-      }
+    }
+
+ 
+    /////////////////////////////////////
+    //////      B0 correction      //////
+    /////////////////////////////////////
 
-   
-      /////////////////////////////////////
-      //////      B0 correction      //////
-      /////////////////////////////////////
-
-      if ( B0CorrectionMode.value().compare("none")!=0 )    // If B0 correction is requested
-      {
-          // Accumulate over navigator pairs and sum over coils
-          // this is the average phase difference between consecutive odd or even navigators
-          for (p=0; p<numNavigators_-2; p++)
-          {
-              ctemp += arma::sum(arma::conj(navdata_.slice(p)) % navdata_.slice(p+2),1);
-          }
-
-          // Perform the fit:
-          float slope = 0.;
-          float intercept = 0.;
-          if ( (B0CorrectionMode.value().compare("mean")==0)  ||
-               (B0CorrectionMode.value().compare("linear")==0) )
-          {
-              // If a linear term is requested, compute it first (in the complex domain):
-              if (B0CorrectionMode.value().compare("linear")==0)
-              {          // Robust fit to a straight line:
-                  slope = (Nx_-1) * std::arg(arma::cdot(ctemp.rows(0,Nx_-2), ctemp.rows(1,Nx_-1)));
-                  //GDEBUG_STREAM("Slope = " << slope << std::endl);
+    if ( B0CorrectionMode.value().compare("none")!=0 )    // If B0 correction is requested
+    {
+        // Accumulate over navigator pairs and sum over coils
+        // this is the average phase difference between consecutive odd or even navigators
+        for (p=0; p<numNavigators_-2; p++)
+        {
+            ctemp += arma::sum(arma::conj(navdata_.slice(p)) % navdata_.slice(p+2),1);
+        }
+
+        // Perform the fit:
+        float slope = 0.;
+        float intercept = 0.;
+        if ( (B0CorrectionMode.value().compare("mean")==0)  ||
+             (B0CorrectionMode.value().compare("linear")==0) )
+        {
+            // If a linear term is requested, compute it first (in the complex domain):
+            if (B0CorrectionMode.value().compare("linear")==0)
+            {          // Robust fit to a straight line:
+                slope = (Nx_-1) * std::arg(arma::cdot(ctemp.rows(0,Nx_-2), ctemp.rows(1,Nx_-1)));
+                //GDEBUG_STREAM("Slope = " << slope << std::endl);
 		  // If we need to filter the estimate:
 		  if (navigatorParameterFilterLength.value() > 1)
 		  {
@@ -216,13 +282,13 @@ int EPICorrGadget::process(
 		      slope = filter_nav_correction_parameter( B0_slope_, Nav_mag_, exc, set, slc, navigatorParameterFilterLength.value() );
 		  }
 
-                  // Correct for the slope, to be able to compute the average phase:
-                  ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -slope*x));
-              }   // end of the B0CorrectionMode == "linear"
+                // Correct for the slope, to be able to compute the average phase:
+                ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -slope*x));
+            }   // end of the B0CorrectionMode == "linear"
 
-              // Now, compute the mean phase:
-              intercept = std::arg(arma::sum(ctemp));
-              //GDEBUG_STREAM("Intercept = " << intercept << std::endl);
+            // Now, compute the mean phase:
+            intercept = std::arg(arma::sum(ctemp));
+            //GDEBUG_STREAM("Intercept = " << intercept << std::endl);
 	      if (navigatorParameterFilterLength.value() > 1)
 	      {
 		  //   - Store the value found in the corresponding array:
@@ -232,49 +298,49 @@ int EPICorrGadget::process(
 		  intercept = filter_nav_correction_parameter( B0_intercept_, Nav_mag_, exc, set, slc, navigatorParameterFilterLength.value(), true );
 	      }
 
-              // Then, our estimate of the phase:
-              tvec = slope*x + intercept;
+            // Then, our estimate of the phase:
+            tvec = slope*x + intercept;
 
-          }       // end of B0CorrectionMode == "mean" or "linear"
+        }       // end of B0CorrectionMode == "mean" or "linear"
 
-          // The B0 Correction:
-          // 0.5* because what we have calculated was the phase difference between every other navigator
-          corrB0_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(ctemp.n_rows), -0.5*tvec));
+        // The B0 Correction:
+        // 0.5* because what we have calculated was the phase difference between every other navigator
+        corrB0_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(ctemp.n_rows), -0.5*tvec));
 
-      }        // end of B0CorrectionMode != "none"
-      else
-      {      // No B0 correction:
-          corrB0_.ones();
-      }
+    }        // end of B0CorrectionMode != "none"
+    else
+    {      // No B0 correction:
+        corrB0_.ones();
+    }
 
 
-      ////////////////////////////////////////////////////
-      //////      Odd-Even correction -- Phase      //////
-      ////////////////////////////////////////////////////
-
-      if (OEPhaseCorrectionMode.value().compare("none")!=0)    // If Odd-Even phase correction is requested
-      {
-          // Accumulate over navigator triplets and sum over coils
-          // this is the average phase difference between odd and even navigators
-          // Note: we have to correct for the B0 evolution between navigators before
-          ctemp.zeros();      // set all elements to zero
-          for (p=0; p<numNavigators_-2; p=p+2)
-          {
-              ctemp += arma::sum( arma::conj( navdata_.slice(p)/repmat(corrB0_,1,navdata_.n_cols) + navdata_.slice(p+2)%repmat(corrB0_,1,navdata_.n_cols) ) % navdata_.slice(p+1),1);
-          }
-
-          float slope = 0.;
-          float intercept = 0.;
-          if ( (OEPhaseCorrectionMode.value().compare("mean")==0      ) ||
-               (OEPhaseCorrectionMode.value().compare("linear")==0    ) ||
-               (OEPhaseCorrectionMode.value().compare("polynomial")==0) )
-          {
-              // If a linear term is requested, compute it first (in the complex domain):
+    ////////////////////////////////////////////////////
+    //////      Odd-Even correction -- Phase      //////
+    ////////////////////////////////////////////////////
+
+    if (OEPhaseCorrectionMode.value().compare("none")!=0)    // If Odd-Even phase correction is requested
+    {
+        // Accumulate over navigator triplets and sum over coils
+        // this is the average phase difference between odd and even navigators
+        // Note: we have to correct for the B0 evolution between navigators before
+        ctemp.zeros();      // set all elements to zero
+        for (p=0; p<numNavigators_-2; p=p+2)
+        {
+            ctemp += arma::sum( arma::conj( navdata_.slice(p)/repmat(corrB0_,1,navdata_.n_cols) + navdata_.slice(p+2)%repmat(corrB0_,1,navdata_.n_cols) ) % navdata_.slice(p+1),1);
+        }
+
+        float slope = 0.;
+        float intercept = 0.;
+        if ( (OEPhaseCorrectionMode.value().compare("mean")==0      ) ||
+             (OEPhaseCorrectionMode.value().compare("linear")==0    ) ||
+             (OEPhaseCorrectionMode.value().compare("polynomial")==0) )
+        {
+            // If a linear term is requested, compute it first (in the complex domain):
 	      // (This is important in case there are -pi/+pi phase wraps, since a polynomial
 	      //  fit to the phase will not work)
-              if ( (OEPhaseCorrectionMode.value().compare("linear")==0    ) ||
-                   (OEPhaseCorrectionMode.value().compare("polynomial")==0) )
-              {          // Robust fit to a straight line:
+            if ( (OEPhaseCorrectionMode.value().compare("linear")==0    ) ||
+                 (OEPhaseCorrectionMode.value().compare("polynomial")==0) )
+            {          // Robust fit to a straight line:
 		  slope = (Nx_-1) * std::arg(arma::cdot(ctemp.rows(0,Nx_-2), ctemp.rows(1,Nx_-1)));
 		  // If we need to filter the estimate:
 		  if (navigatorParameterFilterLength.value() > 1)
@@ -287,13 +353,13 @@ int EPICorrGadget::process(
 		      slope = filter_nav_correction_parameter( OE_phi_slope_, Nav_mag_, exc, set, slc, navigatorParameterFilterLength.value() );
 		  }
 
-                  // Now correct for the slope, to be able to compute the average phase:
-                  ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -slope*x));
+                // Now correct for the slope, to be able to compute the average phase:
+                ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -slope*x));
 		  // at this point we should have got rid of any -pi/+pi phase wraps.
-              }   // end of the OEPhaseCorrectionMode == "linear" or "polynomial"
+            }   // end of the OEPhaseCorrectionMode == "linear" or "polynomial"
 
-              // Now, compute the mean phase:
-              intercept = std::arg(arma::sum(ctemp));
+            // Now, compute the mean phase:
+            intercept = std::arg(arma::sum(ctemp));
 	      //GDEBUG_STREAM("Intercept = " << intercept << std::endl);
 	      if (navigatorParameterFilterLength.value() > 1)
 	      {
@@ -304,35 +370,35 @@ int EPICorrGadget::process(
 		  intercept = filter_nav_correction_parameter( OE_phi_intercept_, Nav_mag_, exc, set, slc, navigatorParameterFilterLength.value(), true );
 	      }
 
-              // Then, our estimate of the phase:
-              tvec = slope*x + intercept;
-
-              // If a polynomial fit is requested:
-              if (OEPhaseCorrectionMode.value().compare("polynomial")==0)
-              {
-                  // Fit the residuals (i.e., after removing the linear trend) to a polynomial.
-                  // You cannot fit the phase directly to the polynomial because it doesn't work
-                  //   in cases that the phase wraps across the image.
-                  // Since we have already removed the slope (in the if OEPhaseCorrectionMode
-                  //   == "linear" or "polynomial" step), just remove the constant phase:
-                  ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -intercept*arma::ones<arma::fvec>( Nx_ )));
-
-                  // Use the magnitude of the average odd navigator as weights:
-                  arma::fvec ctemp_odd  = arma::zeros<arma::fvec>(Nx_);    // temp column complex for odd  magnitudes
-                  for (int p=0; p<numNavigators_-2; p=p+2)
-                  {
-                      ctemp_odd  += ( arma::sqrt(arma::sum(arma::square(arma::abs(navdata_.slice(p))),1)) + arma::sqrt(arma::sum(arma::square(arma::abs(navdata_.slice(p+2))),1)) )/2;
-                  }
-
-                  arma::fmat WX     = arma::diagmat(ctemp_odd) * X;   // Weighted polynomial matrix
-                  arma::fvec Wctemp( Nx_ );                           // Weighted phase residual
-                  for (int p=0; p<Nx_; p++)
-                  {
-                      Wctemp(p) = ctemp_odd(p) * std::arg(ctemp(p));
-                  }
-
-                  // Solve for the polynomial coefficients:
-                  arma::fvec phase_poly_coef = arma::solve( WX , Wctemp );
+            // Then, our estimate of the phase:
+            tvec = slope*x + intercept;
+
+            // If a polynomial fit is requested:
+            if (OEPhaseCorrectionMode.value().compare("polynomial")==0)
+            {
+                // Fit the residuals (i.e., after removing the linear trend) to a polynomial.
+                // You cannot fit the phase directly to the polynomial because it doesn't work
+                //   in cases that the phase wraps across the image.
+                // Since we have already removed the slope (in the if OEPhaseCorrectionMode
+                //   == "linear" or "polynomial" step), just remove the constant phase:
+                ctemp = ctemp % arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>( Nx_ ), -intercept*arma::ones<arma::fvec>( Nx_ )));
+
+                // Use the magnitude of the average odd navigator as weights:
+                arma::fvec ctemp_odd  = arma::zeros<arma::fvec>(Nx_);    // temp column complex for odd  magnitudes
+                for (int p=0; p<numNavigators_-2; p=p+2)
+                {
+                    ctemp_odd  += ( arma::sqrt(arma::sum(arma::square(arma::abs(navdata_.slice(p))),1)) + arma::sqrt(arma::sum(arma::square(arma::abs(navdata_.slice(p+2))),1)) )/2;
+                }
+
+                arma::fmat WX     = arma::diagmat(ctemp_odd) * X;   // Weighted polynomial matrix
+                arma::fvec Wctemp( Nx_ );                           // Weighted phase residual
+                for (int p=0; p<Nx_; p++)
+                {
+                    Wctemp(p) = ctemp_odd(p) * std::arg(ctemp(p));
+                }
+
+                // Solve for the polynomial coefficients:
+                arma::fvec phase_poly_coef = arma::solve( WX , Wctemp );
 		  if (navigatorParameterFilterLength.value() > 1)
 		  {
 		      for (size_t i = 0; i < OE_phi_poly_coef_.size(); ++i)
@@ -346,88 +412,35 @@ int EPICorrGadget::process(
 		      //GDEBUG_STREAM("OE_phi_poly_coef size: " << OE_phi_poly_coef_.size()); 
 		  }
 
-                  // Then, update our estimate of the phase correction:
-                  tvec += X * phase_poly_coef;     // ( Note the "+=" )
+                // Then, update our estimate of the phase correction:
+                tvec += X * phase_poly_coef;     // ( Note the "+=" )
 
-              }   // end of OEPhaseCorrectionMode == "polynomial"
+            }   // end of OEPhaseCorrectionMode == "polynomial"
 
-          }       // end of OEPhaseCorrectionMode == "mean", "linear" or "polynomial"
+        }       // end of OEPhaseCorrectionMode == "mean", "linear" or "polynomial"
 
-          if (!startNegative_) {
-            // if the first navigator is a positive readout, we need to flip the sign of our correction
-            tvec = -1.0*tvec;
-          }
-      }    // end of OEPhaseCorrectionMode != "none"
-      else
-      {      // No OEPhase correction:
-          tvec.zeros();
-      }
-
-      // Odd and even phase corrections
-      corrpos_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(Nx_), -0.5*tvec));
-      corrneg_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(Nx_), +0.5*tvec));
-      corrComputed_ = true;
-
-      // Increase the excitation number for this slice and set (to be used for the next shot)
-      if (navigatorParameterFilterLength.value() > 1) {
-	  excitNo_[slc][set]++;
-      }
+        if (!startNegative_) {
+          // if the first navigator is a positive readout, we need to flip the sign of our correction
+          tvec = -1.0*tvec;
+        }
+    }    // end of OEPhaseCorrectionMode != "none"
+    else
+    {      // No OEPhase correction:
+        tvec.zeros();
     }
 
-  }
-  else {
-    // Increment the echo number
-    epiEchoNumber_ += 1;
-
-    if (epiEchoNumber_ == 0)
-    {
-        // For now, we will correct the phase evolution of each EPI line, with respect
-        //   to the first line in the EPI readout train (echo 0), due to B0 inhomogeneities.
-        //   That is, the reconstructed images will have the phase that the object had at
-        //   the beginning of the EPI readout train (excluding the phase due to encoding),
-        //   multiplied by the coil phase.
-        // Later, we could add the time between the excitation and echo 0, or between one
-        //   of the navigators and echo 0, to correct for phase differences from shot to shot.
-        //   This will be important for multi-shot EPI acquisitions.
-        RefNav_to_Echo0_time_ES_ = 0;
-    }
+    // Odd and even phase corrections
+    corrpos_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(Nx_), -0.5*tvec));
+    corrneg_ = arma::exp(arma::cx_fvec(arma::zeros<arma::fvec>(Nx_), +0.5*tvec));
+    corrComputed_ = true;
 
-    // Apply the correction
-    // We use the armadillo notation that loops over all the columns
-    if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE)) {
-      // Negative readout
-      for (int p=0; p<adata.n_cols; p++) {
-        adata.col(p) %= (arma::pow(corrB0_,epiEchoNumber_+RefNav_to_Echo0_time_ES_) % corrneg_);
-      }
-      // Now that we have corrected we set the readout direction to positive
-      hdr.clearFlag(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE);
-    } 
-    else {
-      // Positive readout
-      for (int p=0; p<adata.n_cols; p++) {
-        adata.col(p) %= (arma::pow(corrB0_,epiEchoNumber_+RefNav_to_Echo0_time_ES_) % corrpos_);
-      }
-    }
-  }
-
-  // Pass on the imaging data
-  // TODO: this should be controlled by a flag
-  if (hdr.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA)) {
-    m1->release();
-  } 
-  else {
-    // It is enough to put the first one, since they are linked
-    if (this->next()->putq(m1) == -1) {
-      m1->release();
-      GERROR("EPICorrGadget::process, passing data on to next gadget");
-      return -1;
+    // Increase the excitation number for this slice and set (to be used for the next shot)
+    if (navigatorParameterFilterLength.value() > 1) {
+	  excitNo_[slc][set]++;
     }
   }
-
-  return 0;
 }
 
-
 //////////////////////////////////////////////////////////
 //
 // init_arrays_for_nav_parameter_filtering
@@ -46,6 +46,7 @@ namespace Gadgetron{
       // in verbose mode, more info is printed out
       bool verboseMode_;
 
+      void process_navigator( ISMRMRD::AcquisitionHeader& hdr, const arma::cx_fmat& adata );
       void init_arrays_for_nav_parameter_filtering( ISMRMRD::EncodingLimits e_limits );
       float filter_nav_correction_parameter( hoNDArray<float>& nav_corr_param_array,
 					     hoNDArray<float>& weights_array,
@@ -7,7 +7,10 @@
 
 namespace Gadgetron{
 
-  EPIReconXGadget::EPIReconXGadget() {}
+  EPIReconXGadget::EPIReconXGadget()
+  {
+    omp_threads.value(1);
+  }
   EPIReconXGadget::~EPIReconXGadget() {}
 
 int EPIReconXGadget::process_config(ACE_Message_Block* mb)
@@ -18,6 +21,18 @@ int EPIReconXGadget::process_config(ACE_Message_Block* mb)
   
   verboseMode_ = verboseMode.value();
 
+  if (configure_reconx(h, reconx, reconx_other, oversamplng_ratio2_) != 0) {
+    return GADGET_FAIL;
+  }
+
+  return 0;
+}
+
+int EPIReconXGadget::configure_reconx(const ISMRMRD::IsmrmrdHeader& h,
+                                      EPI::EPIReconXObjectTrapezoid<std::complex<float> >& reconx,
+                                      EPI::EPIReconXObjectFlat<std::complex<float> >& reconx_other,
+                                      float& oversamplng_ratio2)
+{
   if (h.encoding.size() == 0) {
     GDEBUG("Number of encoding spaces: %d\n", h.encoding.size());
     GDEBUG("This Gadget needs an encoding description\n");
@@ -51,7 +66,7 @@ int EPIReconXGadget::process_config(ACE_Message_Block* mb)
   reconx.reconFOV_  = r_space.fieldOfView_mm.x;
   
   // TODO: we need a flag that says it's a balanced readout.
-  for (std::vector<ISMRMRD::UserParameterLong>::iterator i (traj_desc.userParameterLong.begin()); i != traj_desc.userParameterLong.end(); ++i) {
+  for (std::vector<ISMRMRD::UserParameterLong>::const_iterator i (traj_desc.userParameterLong.begin()); i != traj_desc.userParameterLong.end(); ++i) {
     if (i->name == "rampUpTime") {
       reconx.rampUpTime_ = i->value;
     } else if (i->name == "rampDownTime") {
@@ -65,7 +80,7 @@ int EPIReconXGadget::process_config(ACE_Message_Block* mb)
     }
   }
 
-  for (std::vector<ISMRMRD::UserParameterDouble>::iterator i (traj_desc.userParameterDouble.begin()); i != traj_desc.userParameterDouble.end(); ++i) {
+  for (std::vector<ISMRMRD::UserParameterDouble>::const_iterator i (traj_desc.userParameterDouble.begin()); i != traj_desc.userParameterDouble.end(); ++i) {
     if (i->name == "dwellTime") {
       reconx.dwellTime_ = i->value;
     }
@@ -89,18 +104,39 @@ int EPIReconXGadget::process_config(ACE_Message_Block* mb)
     reconx_other.reconNx_   = r_space2.matrixSize.x;
     reconx_other.reconFOV_  = r_space2.fieldOfView_mm.x;
     reconx_other.numSamples_ = e_space2.matrixSize.x;
-    oversamplng_ratio2_ = (float)e_space2.matrixSize.x / r_space2.matrixSize.x;
+    oversamplng_ratio2 = (float)e_space2.matrixSize.x / r_space2.matrixSize.x;
     reconx_other.dwellTime_ = 1.0;
     reconx_other.computeTrajectory();
   }
 
-#ifdef USE_OMP
-  omp_set_num_threads(1);
-#endif // USE_OMP
-
   return 0;
 }
 
+int EPIReconXGadget::apply_reconx_other(EPI::EPIReconXObjectFlat<std::complex<float> >& reconx_other,
+                                        float oversamplng_ratio2,
+                                        ISMRMRD::AcquisitionHeader& hdr_in, hoNDArray< std::complex<float> >& data_in,
+                                        ISMRMRD::AcquisitionHeader& hdr_out, hoNDArray< std::complex<float> >& data_out)
+{
+  if(reconx_other.encodeNx_>data_in.get_size(0)/ oversamplng_ratio2)
+  {
+      reconx_other.encodeNx_ = (int)(data_in.get_size(0) / oversamplng_ratio2);
+      reconx_other.computeTrajectory();
+  }
+
+  if (reconx_other.reconNx_>data_in.get_size(0) / oversamplng_ratio2)
+  {
+      reconx_other.reconNx_ = (int)(data_in.get_size(0) / oversamplng_ratio2);
+  }
+
+  if(reconx_other.numSamples_>data_in.get_size(0))
+  {
+      reconx_other.numSamples_ = data_in.get_size(0);
+      reconx_other.computeTrajectory();
+  }
+
+  return reconx_other.apply(hdr_in, data_in, hdr_out, data_out);
+}
+
 int EPIReconXGadget::process(
           GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
       GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2)
@@ -118,24 +154,7 @@ int EPIReconXGadget::process(
   }
   else
   {
-    if(reconx_other.encodeNx_>m2->getObjectPtr()->get_size(0)/ oversamplng_ratio2_)
-    {
-        reconx_other.encodeNx_ = (int)(m2->getObjectPtr()->get_size(0) / oversamplng_ratio2_);
-        reconx_other.computeTrajectory();
-    }
-
-    if (reconx_other.reconNx_>m2->getObjectPtr()->get_size(0) / oversamplng_ratio2_)
-    {
-        reconx_other.reconNx_ = (int)(m2->getObjectPtr()->get_size(0) / oversamplng_ratio2_);
-    }
-
-    if(reconx_other.numSamples_>m2->getObjectPtr()->get_size(0))
-    {
-        reconx_other.numSamples_ = m2->getObjectPtr()->get_size(0);
-        reconx_other.computeTrajectory();
-    }
-
-    reconx_other.apply(*m1->getObjectPtr(), *m2->getObjectPtr(), hdr_out, data_out);
+    apply_reconx_other(reconx_other, oversamplng_ratio2_, *m1->getObjectPtr(), *m2->getObjectPtr(), hdr_out, data_out);
   }
 
   // Replace the contents of m1 with the new header and the contentes of m2 with the new data
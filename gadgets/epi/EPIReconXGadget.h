@@ -7,6 +7,7 @@
 #include "hoArmadillo.h"
 
 #include <ismrmrd/ismrmrd.h>
+#include "ismrmrd/xml.h"
 #include <complex>
 
 #include "EPIReconXObjectFlat.h"
@@ -20,6 +21,19 @@ namespace Gadgetron{
     public:
       EPIReconXGadget();
       virtual ~EPIReconXGadget();
+
+      // Sets up the trapezoid operator of the EPI encoding space and the flat operator of a
+      // second encoding space (e.g. FLASH calibration) from the ISMRMRD header
+      static int configure_reconx(const ISMRMRD::IsmrmrdHeader& h,
+                                  EPI::EPIReconXObjectTrapezoid<std::complex<float> >& reconx,
+                                  EPI::EPIReconXObjectFlat<std::complex<float> >& reconx_other,
+                                  float& oversamplng_ratio2);
+
+      // Applies the flat operator to a readout of the second encoding space
+      static int apply_reconx_other(EPI::EPIReconXObjectFlat<std::complex<float> >& reconx_other,
+                                    float oversamplng_ratio2,
+                                    ISMRMRD::AcquisitionHeader& hdr_in, hoNDArray< std::complex<float> >& data_in,
+                                    ISMRMRD::AcquisitionHeader& hdr_out, hoNDArray< std::complex<float> >& data_out);
       
     protected:
       GADGET_PROPERTY(verboseMode, bool, "Verbose output", false);
@@ -95,6 +95,9 @@ namespace Gadgetron{
         a.species_.push_back(w);
         a.species_.push_back(f);
 
+        a.multiResolutionLevels_ = std::max(0, multi_resolution_levels.value());
+        a.multiResolutionSearchWindow_ = std::max(0, multi_resolution_search_window.value());
+
         try {            
             //This should return the images
             hoNDArray< std::complex<float> > wfimages = Gadgetron::fatwater_separation(imagearr.data_, p, a);
@@ -15,6 +15,9 @@ namespace Gadgetron{
     public:
       GADGET_DECLARE(FatWaterGadget)
       FatWaterGadget();
+
+      GADGET_PROPERTY(multi_resolution_levels, int, "Number of coarser resolutions for the coarse to fine field map search, 0 to search at full resolution only", 0);
+      GADGET_PROPERTY(multi_resolution_search_window, int, "Field map candidates searched on either side of the estimate of the coarser resolution", 5);
 	
     protected:
       virtual int process(GadgetContainerMessage<IsmrmrdImageArray>* m1);
@@ -7,15 +7,7 @@
 
 #include <boost/make_shared.hpp>
 
-#if defined (WIN32)
-#if defined (__BUILD_GADGETRON_GPUGADGET__)
-#define EXPORTGPUGADGET __declspec(dllexport)
-#else
-#define EXPORTGPUGADGET __declspec(dllimport)
-#endif
-#else
-#define EXPORTGPUGADGET
-#endif
+#include "gadgetron_gpugadget_export.h"
 
 
 namespace Gadgetron{
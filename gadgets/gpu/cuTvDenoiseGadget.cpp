@@ -0,0 +1,140 @@
+#include "cuTvDenoiseGadget.h"
+#include "check_CUDA.h"
+
+#include <algorithm>
+
+namespace Gadgetron{
+
+  cuTvDenoiseGadget::cuTvDenoiseGadget() : held_planes_(0)
+  {
+  }
+
+  cuTvDenoiseGadget::~cuTvDenoiseGadget()
+  {
+    for (size_t n = 0; n < held_.size(); n++) held_[n]->release();
+  }
+
+  int cuTvDenoiseGadget::process_config(ACE_Message_Block* mb)
+  {
+    denoiser_.set_regularization((regularization.value() == "tgv") ? cuBatchedTvDenoiser<float_complext>::TGV : cuBatchedTvDenoiser<float_complext>::TV);
+    denoiser_.set_check_interval((unsigned int) std::max(1, check_interval.value()));
+    return GADGET_OK;
+  }
+
+  int cuTvDenoiseGadget::process( GadgetContainerMessage< ISMRMRD::ImageHeader>* m1,
+                                  GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2)
+  {
+    hoNDArray< std::complex<float> >* data = m2->getObjectPtr();
+    if (data->get_number_of_dimensions() < 2 || data->get_number_of_elements() == 0) {
+      GERROR("cuTvDenoiseGadget: image without two dimensions received\n");
+      return GADGET_FAIL;
+    }
+
+    // A batch holds images of one size only
+    if (!held_.empty()) {
+      hoNDArray< std::complex<float> >* first = AsContainerMessage< hoNDArray< std::complex<float> > >(held_[0]->cont())->getObjectPtr();
+      if (first->get_size(0) != data->get_size(0) || first->get_size(1) != data->get_size(1)) {
+        if (flush() != GADGET_OK) return GADGET_FAIL;
+      }
+    }
+
+    held_.push_back(m1);
+    held_planes_ += data->get_number_of_elements() / (data->get_size(0)*data->get_size(1));
+
+    // on failure m1 is released by the caller of process
+    if ((int)held_.size() >= batch_size.value()) return flush(m1);
+    return GADGET_OK;
+  }
+
+  int cuTvDenoiseGadget::flush(ACE_Message_Block* current)
+  {
+    if (held_.empty()) return GADGET_OK;
+
+    hoNDArray< std::complex<float> >* first = AsContainerMessage< hoNDArray< std::complex<float> > >(held_[0]->cont())->getObjectPtr();
+    const size_t nx = first->get_size(0), ny = first->get_size(1), N = nx*ny;
+
+    std::vector<size_t> dims;
+    dims.push_back(nx); dims.push_back(ny); dims.push_back(held_planes_);
+
+    cuBatchedTvDenoiser<float_complext>::Parameters p(lambda.value(), (unsigned int) std::max(0, max_iterations.value()), tolerance.value(), alpha0.value());
+    std::vector< cuBatchedTvDenoiser<float_complext>::Parameters > params(held_planes_, p);
+
+    int result = GADGET_OK;
+    size_t passed = 0;
+    try {
+      // Stack the planes of the held images
+      cuNDArray<float_complext> batch(dims);
+
+      size_t plane = 0;
+      for (size_t n = 0; n < held_.size(); n++) {
+        hoNDArray< std::complex<float> >* data = AsContainerMessage< hoNDArray< std::complex<float> > >(held_[n]->cont())->getObjectPtr();
+        size_t planes = data->get_number_of_elements() / N;
+
+        CUDA_CALL(cudaMemcpy(batch.get_data_ptr() + plane*N, data->get_data_ptr(), planes*N*sizeof(float_complext), cudaMemcpyHostToDevice));
+
+        if (scale_by_intensity.value()) {
+          for (size_t k = 0; k < planes; k++, plane++) {
+            const std::complex<float>* d = data->get_data_ptr() + k*N;
+            double mean = 0;
+            for (size_t i = 0; i < N; i++) mean += std::abs(d[i]);
+            mean /= N;
+
+            // a blank image is left as it is
+            float scale = (mean > 0) ? (float) mean : 1.0f;
+            params[plane].lambda *= scale;
+            params[plane].alpha0 *= scale;
+          }
+        }
+        else {
+          plane += planes;
+        }
+      }
+
+      denoiser_.denoise(&batch, params);
+
+      const std::vector<unsigned int>& iterations = denoiser_.get_iterations();
+      GDEBUG("cuTvDenoiseGadget: %d images, %d iterations at most\n", (int)held_planes_, (int)*std::max_element(iterations.begin(), iterations.end()));
+
+      // Pass the images on in order as they are copied back
+      plane = 0;
+      for (; passed < held_.size(); ) {
+        hoNDArray< std::complex<float> >* data = AsContainerMessage< hoNDArray< std::complex<float> > >(held_[passed]->cont())->getObjectPtr();
+        size_t planes = data->get_number_of_elements() / N;
+
+        CUDA_CALL(cudaMemcpy(data->get_data_ptr(), batch.get_data_ptr() + plane*N, planes*N*sizeof(float_complext), cudaMemcpyDeviceToHost));
+        plane += planes;
+
+        if (this->next()->putq(held_[passed]) < 0) {
+          GERROR("cuTvDenoiseGadget: failed to pass on an image\n");
+          result = GADGET_FAIL;
+          break;
+        }
+        passed++;
+      }
+    }
+    catch (std::exception& e) {
+      GERROR("cuTvDenoiseGadget: denoising failed: %s\n", e.what());
+      result = GADGET_FAIL;
+    }
+
+    for (size_t n = passed; n < held_.size(); n++) {
+      if (held_[n] != current) held_[n]->release();
+    }
+
+    held_.clear();
+    held_planes_ = 0;
+    return result;
+  }
+
+  int cuTvDenoiseGadget::close(unsigned long flags)
+  {
+    // the gadget thread has finished once the base class returns
+    int ret = Gadget::close(flags);
+    if (flags != 0) {
+      if (flush() != GADGET_OK) GERROR("cuTvDenoiseGadget::close: failed to denoise the remaining images\n");
+    }
+    return ret;
+  }
+
+  GADGET_FACTORY_DECLARE(cuTvDenoiseGadget)
+}
@@ -0,0 +1,61 @@
+/** \file cuTvDenoiseGadget.h
+    \brief TV or TGV denoising of series of 2D images on the GPU, many images per solver run.
+
+    The images are held back until batch_size of them have arrived, an image of another size arrives or
+    the stream closes. The x-y planes of the held images are then stacked into one device array and denoised
+    together by cuBatchedTvDenoiser, each with its own weights, and the images are passed on in the order
+    they arrived.
+
+    With scale_by_intensity the weights are relative to the mean magnitude of each plane, so one setting
+    fits images of different intensity.
+*/
+
+#pragma once
+
+#include "Gadget.h"
+#include "hoNDArray.h"
+#include "cuBatchedTvDenoiser.h"
+#include "gadgetron_gpugadget_export.h"
+
+#include <ismrmrd/ismrmrd.h>
+#include <complex>
+#include <vector>
+
+namespace Gadgetron{
+
+  class EXPORTGPUGADGET cuTvDenoiseGadget :
+  public Gadget2<ISMRMRD::ImageHeader, hoNDArray< std::complex<float> > >
+    {
+    public:
+      GADGET_DECLARE(cuTvDenoiseGadget)
+
+      cuTvDenoiseGadget();
+      virtual ~cuTvDenoiseGadget();
+
+      virtual int close(unsigned long flags);
+
+    protected:
+      GADGET_PROPERTY_LIMITS(regularization, std::string, "Total variation (tv) or total generalized variation (tgv)", "tv",
+                             GadgetPropertyLimitsEnumeration, "tv", "tgv");
+      GADGET_PROPERTY(lambda, float, "Weight of the total variation, the first order term of TGV", 0.05);
+      GADGET_PROPERTY(alpha0, float, "Weight of the second order term of TGV", 0.1);
+      GADGET_PROPERTY(scale_by_intensity, bool, "Weights relative to the mean magnitude of each image", true);
+      GADGET_PROPERTY(max_iterations, int, "Max number of primal-dual iterations", 100);
+      GADGET_PROPERTY(tolerance, float, "Relative change of an image at which it is converged (0 runs all iterations)", 1e-4);
+      GADGET_PROPERTY(check_interval, int, "Iterations between convergence checks", 10);
+      GADGET_PROPERTY(batch_size, int, "Number of images denoised together", 256);
+
+      virtual int process_config(ACE_Message_Block* mb);
+
+      virtual int process( GadgetContainerMessage< ISMRMRD::ImageHeader>* m1,
+                           GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2);
+
+      // Denoises the held images and passes them on, on failure the images not passed on are released except current
+      int flush(ACE_Message_Block* current = 0);
+
+      cuBatchedTvDenoiser<float_complext> denoiser_;
+
+      std::vector< GadgetContainerMessage<ISMRMRD::ImageHeader>* > held_;
+      size_t held_planes_;
+    };
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#if defined (WIN32)
+#if defined (__BUILD_GADGETRON_GPUGADGET__)
+#define EXPORTGPUGADGET __declspec(dllexport)
+#else
+#define EXPORTGPUGADGET __declspec(dllimport)
+#endif
+#else
+#define EXPORTGPUGADGET
+#endif
@@ -3,6 +3,7 @@
 #include "ismrmrd/xml.h"
 
 #include <ace/OS_NS_stdlib.h>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/split.hpp>
 
@@ -104,6 +105,7 @@ namespace Gadgetron{
 
     buffers_ = std::vector<GrappaCalibrationBuffer* >(dimensions_[4],0);
     time_stamps_ = std::vector<ACE_UINT32>(dimensions_[4],0);
+    frame_lines_ = std::vector< std::vector<size_t> >(dimensions_[4]);
 
     //Let's figure out the number of target coils
     target_coils_ = target_coils.value();
@@ -119,6 +121,7 @@ namespace Gadgetron{
     GDEBUG_STREAM("use_gpu_ is " << use_gpu_);
 
     weights_calculator_.set_use_gpu(use_gpu_);
+    weights_calculator_.set_incremental_calib(incremental_calibration.value());
 
     if (device_channels.value()) {
       GDEBUG("We got the number of device channels from other gadget: %d\n", device_channels.value());
@@ -270,6 +273,12 @@ namespace Gadgetron{
       memcpy(b+offset,d+c*samples,sizeof(std::complex<float>)*samples);
     }
 
+    //The lines of the frame, the unmixing only transforms these
+    std::vector<size_t>& frame_lines = frame_lines_[slice];
+    if (frame_lines.empty() || frame_lines.back() != line) {
+      frame_lines.push_back(line);
+    }
+
 
     bool is_last_scan_in_slice = m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_LAST_IN_SLICE);
 
@@ -283,6 +292,7 @@ namespace Gadgetron{
 
       GadgetContainerMessage<GrappaUnmixingJob>* cm0 =
         new GadgetContainerMessage<GrappaUnmixingJob>();
+      cm0->getObjectPtr()->frame_start_ = GadgetStatistics::clock::now();
 
       GadgetContainerMessage<ISMRMRD::ImageHeader>* cm1 =
         new GadgetContainerMessage<ISMRMRD::ImageHeader>();
@@ -340,6 +350,10 @@ namespace Gadgetron{
 
 
       cm0->getObjectPtr()->weights_ = weights_[slice];
+
+      std::sort(frame_lines.begin(), frame_lines.end());
+      frame_lines.erase(std::unique(frame_lines.begin(), frame_lines.end()), frame_lines.end());
+      cm0->getObjectPtr()->lines_.swap(frame_lines);
       cm0->cont(cm1);
       cm1->cont(image_data_[slice]);
 
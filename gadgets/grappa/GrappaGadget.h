@@ -47,6 +47,7 @@ public Gadget2< ISMRMRD::AcquisitionHeader, hoNDArray< std::complex<float> > >
 
   GADGET_PROPERTY(target_coils,int, "Number of target coils for GRAPPA recon", 0);
   GADGET_PROPERTY(use_gpu,bool,"If true, recon will try to use GPU resources (when available)", true);
+  GADGET_PROPERTY(incremental_calibration,bool,"If true, the cpu calibration only updates the equations of changed calibration lines", false);
   GADGET_PROPERTY(device_channels,int,"Number of device channels", 0);
   GADGET_PROPERTY(uncombined_channels,std::string,"Uncombined channels (as a comma separated list of channel indices", "");
   GADGET_PROPERTY(uncombined_channels_by_name,std::string,"Uncombined channels (as a comma separated list of channel names", "");
@@ -63,6 +64,7 @@ public Gadget2< ISMRMRD::AcquisitionHeader, hoNDArray< std::complex<float> > >
   std::vector< boost::shared_ptr<GrappaWeights<float> > > weights_;
   GrappaWeightsCalculator<float> weights_calculator_;
   std::vector<ACE_UINT32> time_stamps_;
+  std::vector< std::vector<size_t> > frame_lines_;
   int image_counter_;
   int image_series_;
   int target_coils_;
@@ -0,0 +1,329 @@
+#include "GrappaIncrementalCalibration.h"
+#include "hoNDArray_elemwise.h"
+#include "hoNDArray_linalg.h"
+#include "mri_core_grappa.h"
+
+#include <cstring>
+
+namespace Gadgetron{
+
+template <class T> GrappaIncrementalCalibration<T>::GrappaIncrementalCalibration()
+  : rebuild_interval_(32)
+  , updates_since_rebuild_(0)
+  , num_updated_anchors_(0)
+  , rebuilt_(false)
+  , RO_(0), E1_(0), srcCHA_(0), dstCHA_(0)
+  , accelFactor_(0), kRO_(0), kNE1_(0)
+  , startRO_(0), endRO_(0), startE1_(0), endE1_(0)
+  , fitItself_(false)
+  , thres_(0)
+{
+}
+
+template <class T> void GrappaIncrementalCalibration<T>::reset()
+{
+  AHA_.clear();
+  AHB_.clear();
+  src_.clear();
+  dst_.clear();
+  convKer_.clear();
+  updates_since_rebuild_ = 0;
+}
+
+template <class T> bool GrappaIncrementalCalibration<T>::
+calib(const hoNDArray< std::complex<T> >& acsSrc, const hoNDArray< std::complex<T> >& acsDst,
+      size_t accelFactor, double thres, size_t kRO, size_t kNE1,
+      size_t startRO, size_t endRO, size_t startE1, size_t endE1,
+      hoNDArray< std::complex<T> >& convKer)
+{
+  try
+  {
+    GADGET_CHECK_THROW(acsSrc.get_size(0)==acsDst.get_size(0));
+    GADGET_CHECK_THROW(acsSrc.get_size(1)==acsDst.get_size(1));
+    GADGET_CHECK_THROW(acsSrc.get_size(2)>=acsDst.get_size(2));
+
+    size_t RO = acsSrc.get_size(0);
+    size_t E1 = acsSrc.get_size(1);
+    size_t srcCHA = acsSrc.get_size(2);
+    size_t dstCHA = acsDst.get_size(2);
+
+    // same as grappa2d_calib_convolution_kernel
+    bool fitItself = (&acsSrc != &acsDst);
+
+    std::vector<int> kE1, oE1;
+    size_t convKRO, convKE1;
+    grappa2d_kerPattern(kE1, oE1, convKRO, convKE1, accelFactor, kRO, kNE1, fitItself);
+
+    long long kROhalf = kRO/2;
+    kRO = 2*kROhalf + 1;
+
+    long long sE1 = std::abs(kE1[0]) + (long long)startE1;
+    long long eE1 = (long long)endE1 - kE1[kNE1-1];
+    GADGET_CHECK_THROW(eE1 >= sE1);
+    GADGET_CHECK_THROW(endRO >= startRO + 2*kROhalf);
+
+    bool rebuild = (AHA_.get_number_of_elements()==0)
+      || (RO!=RO_) || (E1!=E1_) || (srcCHA!=srcCHA_) || (dstCHA!=dstCHA_)
+      || (accelFactor!=accelFactor_) || (kRO!=kRO_) || (kNE1!=kNE1_)
+      || (startRO!=startRO_) || (endRO!=endRO_) || (fitItself!=fitItself_) || (thres!=thres_)
+      || (updates_since_rebuild_ >= rebuild_interval_);
+
+    std::vector<long long> removed, added;
+
+    if (!rebuild)
+    {
+      // lines changed since the last call
+      std::vector<char> changed(E1, 0);
+      size_t num_changed = 0;
+
+      for (size_t e1=0; e1<E1; e1++)
+      {
+	for (size_t cha=0; cha<srcCHA && !changed[e1]; cha++)
+	{
+	  size_t offset = cha*RO*E1 + e1*RO;
+	  if (memcmp(acsSrc.begin()+offset, src_.begin()+offset, sizeof(std::complex<T>)*RO) != 0) changed[e1] = 1;
+	}
+
+	for (size_t cha=0; cha<dstCHA && !changed[e1]; cha++)
+	{
+	  size_t offset = cha*RO*E1 + e1*RO;
+	  if (memcmp(acsDst.begin()+offset, dst_.begin()+offset, sizeof(std::complex<T>)*RO) != 0) changed[e1] = 1;
+	}
+
+	if (changed[e1]) num_changed++;
+      }
+
+      if ((num_changed==0) && (startE1==startE1_) && (endE1==endE1_))
+      {
+	num_updated_anchors_ = 0;
+	rebuilt_ = false;
+	convKer = convKer_;
+	return false;
+      }
+
+      long long sE1_old = std::abs(kE1[0]) + (long long)startE1_;
+      long long eE1_old = (long long)endE1_ - kE1[kNE1-1];
+
+      long long a;
+      for (a=sE1_old; a<=eE1_old; a++)
+      {
+	bool touched = (a < sE1) || (a > eE1);
+	for (size_t k=0; k<kE1.size() && !touched; k++) touched = (changed[a+kE1[k]] != 0);
+	for (size_t o=0; o<oE1.size() && !touched; o++) touched = (changed[a+oE1[o]] != 0);
+	if (touched) removed.push_back(a);
+      }
+
+      for (a=sE1; a<=eE1; a++)
+      {
+	bool touched = (a < sE1_old) || (a > eE1_old);
+	for (size_t k=0; k<kE1.size() && !touched; k++) touched = (changed[a+kE1[k]] != 0);
+	for (size_t o=0; o<oE1.size() && !touched; o++) touched = (changed[a+oE1[o]] != 0);
+	if (touched) added.push_back(a);
+      }
+
+      // updating costs as much as a rebuild
+      if (removed.size() + added.size() >= (size_t)(eE1 - sE1 + 1)) rebuild = true;
+    }
+
+    size_t colA = kRO*kNE1*srcCHA;
+    size_t colB = dstCHA*oE1.size();
+
+    if (rebuild)
+    {
+      RO_ = RO; E1_ = E1; srcCHA_ = srcCHA; dstCHA_ = dstCHA;
+      accelFactor_ = accelFactor; kRO_ = kRO; kNE1_ = kNE1;
+      startRO_ = startRO; endRO_ = endRO;
+      fitItself_ = fitItself;
+      thres_ = thres;
+      kE1_ = kE1;
+      oE1_ = oE1;
+
+      AHA_.create(colA, colA);
+      Gadgetron::clear(AHA_);
+      AHB_.create(colA, colB);
+      Gadgetron::clear(AHB_);
+
+      added.clear();
+      for (long long a=sE1; a<=eE1; a++) added.push_back(a);
+
+      this->accumulate(acsSrc.begin(), acsDst.begin(), added, (T)1);
+
+      updates_since_rebuild_ = 0;
+      num_updated_anchors_ = added.size();
+      rebuilt_ = true;
+    }
+    else
+    {
+      if (!removed.empty() || !added.empty())
+      {
+	this->accumulate(src_.begin(), dst_.begin(), removed, (T)(-1));
+	this->accumulate(acsSrc.begin(), acsDst.begin(), added, (T)1);
+	updates_since_rebuild_++;
+      }
+
+      num_updated_anchors_ = removed.size() + added.size();
+      rebuilt_ = false;
+    }
+
+    startE1_ = startE1;
+    endE1_ = endE1;
+
+    src_ = acsSrc;
+    dst_ = acsDst;
+
+    // lines outside the kernel support changed, the kernel stays the same
+    if (!rebuild && (num_updated_anchors_==0) && (convKer_.get_number_of_elements()>0))
+    {
+      convKer = convKer_;
+      return true;
+    }
+
+    // Tikhonov regularization of SolveLinearSystem_Tikhonov
+    hoNDArray< std::complex<T> > M(AHA_);
+    hoNDArray< std::complex<T> > x(AHB_);
+
+    size_t c;
+    double trA = 0;
+    for (c=0; c<colA; c++) trA += std::abs(M(c, c));
+
+    double value = trA*thres/colA;
+    for (c=0; c<colA; c++) M(c, c) = std::complex<T>( (T)(std::abs(M(c, c)) + value) );
+
+    if (trA/colA < 4.0)
+    {
+      T scalingFactor = (T)(colA*4.0/trA);
+      Gadgetron::scal(scalingFactor, M);
+      Gadgetron::scal(scalingFactor, x);
+    }
+
+    hoNDArray< std::complex<T> > M_ori(M);
+    hoNDArray< std::complex<T> > x_ori(x);
+
+    try
+    {
+      posv(M, x);
+    }
+    catch(...)
+    {
+      GERROR_STREAM("GrappaIncrementalCalibration : posv failed, hesv is called ... ");
+      M = M_ori;
+      x = x_ori;
+      hesv(M, x);
+    }
+
+    hoNDArray< std::complex<T> > ker(kRO, kNE1, srcCHA, dstCHA, oE1.size());
+    memcpy(ker.begin(), x.begin(), ker.get_number_of_bytes());
+
+    grappa2d_convert_to_convolution_kernel(ker, kRO, kE1, oE1, convKer_);
+    convKer = convKer_;
+  }
+  catch(...)
+  {
+    this->reset();
+    GADGET_THROW("Errors in GrappaIncrementalCalibration<T>::calib(...) ... ");
+  }
+
+  return true;
+}
+
+template <class T> void GrappaIncrementalCalibration<T>::
+fill_rows(const std::complex<T>* pSrc, const std::complex<T>* pDst, const std::vector<long long>& anchors,
+	  hoNDArray< std::complex<T> >& A, hoNDArray< std::complex<T> >& B)
+{
+  size_t RO = RO_;
+  size_t E1 = E1_;
+  size_t srcCHA = srcCHA_;
+  size_t dstCHA = dstCHA_;
+  const int* kE1 = &kE1_[0];
+  const int* oE1 = &oE1_[0];
+
+  long long kROhalf = kRO_/2;
+  long long sRO = startRO_ + kROhalf;
+  long long eRO = endRO_ - kROhalf;
+  size_t lenRO = eRO - sRO + 1;
+
+  size_t kNE1 = kE1_.size();
+  size_t oNE1 = oE1_.size();
+
+  size_t rowA = anchors.size()*lenRO;
+  size_t colA = kRO_*kNE1*srcCHA;
+  size_t colB = dstCHA*oNE1;
+
+  A.create(rowA, colA);
+  B.create(rowA, colB);
+
+  std::complex<T>* pA = A.begin();
+  std::complex<T>* pB = B.begin();
+
+  long long n;
+#pragma omp parallel for default(none) private(n) shared(anchors, pA, pB, pSrc, pDst, RO, E1, srcCHA, dstCHA, kE1, oE1, kROhalf, sRO, eRO, lenRO, kNE1, oNE1, rowA)
+  for (n=0; n<(long long)anchors.size(); n++)
+  {
+    long long e1 = anchors[n];
+
+    for (long long ro=sRO; ro<=eRO; ro++)
+    {
+      size_t rInd = n*lenRO + ro - sRO;
+
+      size_t col = 0;
+      for (size_t src=0; src<srcCHA; src++)
+      {
+	for (size_t ke1=0; ke1<kNE1; ke1++)
+	{
+	  size_t offset = src*RO*E1 + (e1+kE1[ke1])*RO;
+	  for (long long kro=-kROhalf; kro<=kROhalf; kro++)
+	  {
+	    pA[rInd + col*rowA] = pSrc[ro+kro+offset];
+	    col++;
+	  }
+	}
+      }
+
+      col = 0;
+      for (size_t oe1=0; oe1<oNE1; oe1++)
+      {
+	for (size_t dst=0; dst<dstCHA; dst++)
+	{
+	  pB[rInd + col*rowA] = pDst[ro + (e1+oE1[oe1])*RO + dst*RO*E1];
+	  col++;
+	}
+      }
+    }
+  }
+}
+
+template <class T> void GrappaIncrementalCalibration<T>::
+accumulate(const std::complex<T>* src, const std::complex<T>* dst, const std::vector<long long>& anchors, T sign)
+{
+  if (anchors.empty()) return;
+
+  hoNDArray< std::complex<T> > A, B;
+  this->fill_rows(src, dst, anchors, A, B);
+
+  hoNDArray< std::complex<T> > AHA, AHB;
+  herk(AHA, A, 'L', true);
+  gemm(AHB, A, true, B, false);
+
+  size_t colA = AHA_.get_size(0);
+  size_t colB = AHB_.get_size(1);
+
+  // only the lower triangle of AHA is set by herk
+  for (size_t j=0; j<colA; j++)
+  {
+    for (size_t i=j; i<colA; i++)
+    {
+      AHA_(i, j) += sign*AHA(i, j);
+    }
+  }
+
+  for (size_t j=0; j<colB; j++)
+  {
+    for (size_t i=0; i<colA; i++)
+    {
+      AHB_(i, j) += sign*AHB(i, j);
+    }
+  }
+}
+
+template class EXPORTGADGETSGRAPPA GrappaIncrementalCalibration<float>;
+}
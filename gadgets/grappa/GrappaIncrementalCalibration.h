@@ -0,0 +1,79 @@
+#pragma once
+
+#include "gadgetron_grappa_export.h"
+#include "hoNDArray.h"
+
+#include <complex>
+#include <vector>
+
+namespace Gadgetron{
+
+/**
+   2D GRAPPA calibration that keeps the normal equations A^H A and A^H B of the previous call.
+
+   Every kernel anchor line e1 of the calibration region contributes one block of rows to A and B, built from the
+   source lines e1+kE1 and the target lines e1+oE1. When the calibration data changes, only the blocks of the anchors
+   touching a changed line, or leaving/entering the calibration region, are subtracted (with the old data) and added
+   (with the new data). The regularization and solve are those of SolveLinearSystem_Tikhonov, the kernel is the same
+   as the one of grappa2d_calib_convolution_kernel up to the float rounding.
+
+   If nothing changed since the last call, the kernel of the last call is kept and calib returns false.
+   The normal equations are rebuilt from scratch when the setup changes, when updating would touch as many anchors as
+   a rebuild, and every rebuild_interval updates to bound the accumulated rounding of the subtractions.
+*/
+template <class T> class EXPORTGADGETSGRAPPA GrappaIncrementalCalibration
+{
+ public:
+  GrappaIncrementalCalibration();
+  virtual ~GrappaIncrementalCalibration() {}
+
+  /// acsSrc [RO E1 srcCHA], acsDst [RO E1 dstCHA], [startRO endRO] x [startE1 endE1] is used for the calibration
+  /// convKer [convKRO convKE1 srcCHA dstCHA], returns false if the calibration data did not change since the last call
+  bool calib(const hoNDArray< std::complex<T> >& acsSrc, const hoNDArray< std::complex<T> >& acsDst,
+	     size_t accelFactor, double thres, size_t kRO, size_t kNE1,
+	     size_t startRO, size_t endRO, size_t startE1, size_t endE1,
+	     hoNDArray< std::complex<T> >& convKer);
+
+  /// forget the normal equations, the next call rebuilds them
+  void reset();
+
+  size_t get_rebuild_interval() { return rebuild_interval_; }
+  void set_rebuild_interval(size_t n) { rebuild_interval_ = n; }
+
+  /// number of anchors updated by the last call, all anchors of the region for a rebuild
+  size_t get_number_of_updated_anchors() { return num_updated_anchors_; }
+  bool get_last_call_rebuilt() { return rebuilt_; }
+
+ protected:
+
+  /// fill the rows of A and B for the anchors, with the data in src and dst
+  void fill_rows(const std::complex<T>* src, const std::complex<T>* dst, const std::vector<long long>& anchors,
+		 hoNDArray< std::complex<T> >& A, hoNDArray< std::complex<T> >& B);
+
+  /// AHA_ += sign * A^H A, AHB_ += sign * A^H B, for the anchors
+  void accumulate(const std::complex<T>* src, const std::complex<T>* dst, const std::vector<long long>& anchors, T sign);
+
+  size_t rebuild_interval_;
+  size_t updates_since_rebuild_;
+  size_t num_updated_anchors_;
+  bool rebuilt_;
+
+  // setup of the normal equations
+  size_t RO_, E1_, srcCHA_, dstCHA_;
+  size_t accelFactor_, kRO_, kNE1_;
+  size_t startRO_, endRO_, startE1_, endE1_;
+  bool fitItself_;
+  double thres_;
+  std::vector<int> kE1_, oE1_;
+
+  // calibration data the normal equations are built from
+  hoNDArray< std::complex<T> > src_;
+  hoNDArray< std::complex<T> > dst_;
+
+  // lower triangle of A^H A [colA colA] and A^H B [colA colB]
+  hoNDArray< std::complex<T> > AHA_;
+  hoNDArray< std::complex<T> > AHB_;
+
+  hoNDArray< std::complex<T> > convKer_;
+};
+}
@@ -1,6 +1,10 @@
 #include "GadgetIsmrmrdReadWrite.h"
 #include "GrappaUnmixingGadget.h"
 #include "hoNDFFT.h"
+#include "hoNDArray_elemwise.h"
+
+#include <ace/OS_NS_sys_time.h>
+#include <cmath>
 
 namespace Gadgetron{
 
@@ -13,9 +17,127 @@ namespace Gadgetron{
     // TODO Auto-generated destructor stub
   }
 
+  bool GrappaUnmixingGadget::newer_frame_waiting(uint16_t slice)
+  {
+    //Only the thread of the gadget takes messages off the queue, so the head stays valid
+    if (this->desired_threads() > 1) return false;
+
+    ACE_Message_Block* mb = 0;
+    ACE_Time_Value nowait(ACE_OS::gettimeofday());
+    if (this->msg_queue()->peek_dequeue_head(mb, &nowait) == -1) {
+      return false; //Empty, or a queue without look ahead
+    }
+
+    GadgetContainerMessage<GrappaUnmixingJob>* job = AsContainerMessage<GrappaUnmixingJob>(mb);
+    if (!job) return false;
+
+    GadgetContainerMessage<ISMRMRD::ImageHeader>* header = AsContainerMessage<ISMRMRD::ImageHeader>(job->cont());
+    return header && header->getObjectPtr()->slice == slice;
+  }
+
+  void GrappaUnmixingGadget::ifft_frame(hoNDArray< std::complex<float> >& data, const std::vector<size_t>& lines, hoNDArray< std::complex<float> >& images)
+  {
+    size_t RO = data.get_size(0);
+    size_t E1 = data.get_size(1);
+    size_t E2 = data.get_size(2);
+    size_t CHA = data.get_number_of_elements()/(RO*E1*E2);
+
+    //The lines k + R*m, m = 0 .. E1/R-1, of a 2D k-space
+    size_t M = lines.size();
+    size_t R = (M > 1) ? lines[1] - lines[0] : 0;
+    bool interleave = (E2 == 1) && (R > 1) && (M*R == E1);
+    for (size_t m = 2; interleave && m < M; m++) {
+      interleave = (lines[m] == lines[0] + m*R);
+    }
+
+    if (!interleave) {
+      hoNDFFT<float>::instance()->ifft3c(data);
+      images.create(data.get_dimensions(), data.get_data_ptr());
+      return;
+    }
+
+    //Centered ifft of the sampled lines along RO and along the M lines
+    size_t k = lines[0];
+    std::vector<size_t> dims = { RO, M, CHA };
+    std::vector<size_t> strides = { 1, R*RO, RO*E1 };
+    hoNDArrayView< std::complex<float> > sampled(data.get_data_ptr() + k*RO, dims, strides);
+    hoNDFFT<float>::instance()->ifft_many(sampled, { 0, 1 });
+
+    //With e = k + R*m the E1 transform of the lines is, for y - E1/2 = t,
+    //exp(2*pi*i*d*t/E1)/sqrt(R) times the M point transform at (t + M/2) mod M, d = k - E1/2 + R*(M/2)
+    images.create(RO, E1, 1, CHA);
+
+    long long n = (long long)E1;
+    long long n_lines = (long long)M;
+    long long d = (long long)k - n/2 + (long long)(R*(M/2));
+    float scale = 1.0f/std::sqrt((float)R);
+
+    const std::complex<float>* src = data.get_data_ptr() + k*RO;
+    std::complex<float>* dst = images.get_data_ptr();
+
+    long long y;
+#pragma omp parallel for private(y)
+    for (y = 0; y < n; y++) {
+      long long t = y - n/2;
+      size_t j = (size_t)((((t + n_lines/2) % n_lines) + n_lines) % n_lines);
+      long long p = ((d*t) % n + n) % n;
+      std::complex<float> phase = std::polar(scale, (float)(2*M_PI*(double)p/(double)n));
+
+      for (size_t c = 0; c < CHA; c++) {
+        const std::complex<float>* s = src + j*R*RO + c*RO*E1;
+        std::complex<float>* o = dst + y*RO + c*RO*E1;
+        for (size_t x = 0; x < RO; x++) {
+          o[x] = phase*s[x];
+        }
+      }
+    }
+  }
+
+  void GrappaUnmixingGadget::update_window(uint16_t slice, const std::vector<size_t>& lines,
+                                           hoNDArray< std::complex<float> >& unmixed, hoNDArray< std::complex<float> >& out)
+  {
+    std::lock_guard<std::mutex> guard(window_mutex_);
+    std::list<LineGroup>& groups = window_[slice];
+
+    for (std::list<LineGroup>::iterator it = groups.begin(); it != groups.end(); ) {
+      bool replaced = !it->unmixed_.dimensions_equal(&unmixed);
+
+      //Both line lists are sorted
+      std::vector<size_t>::const_iterator a = it->lines_.begin(), b = lines.begin();
+      while (!replaced && a != it->lines_.end() && b != lines.end()) {
+        if (*a < *b) a++;
+        else if (*b < *a) b++;
+        else replaced = true;
+      }
+
+      if (replaced) it = groups.erase(it);
+      else it++;
+    }
+
+    groups.push_back(LineGroup());
+    groups.back().lines_ = lines;
+    groups.back().unmixed_ = std::move(unmixed);
+
+    //The sum is formed anew from the groups, so rounding errors do not pile up over the frames
+    std::list<LineGroup>::const_iterator it = groups.begin();
+    out = it->unmixed_;
+    for (it++; it != groups.end(); it++) {
+      out += it->unmixed_;
+    }
+  }
+
   int GrappaUnmixingGadget::process(GadgetContainerMessage<GrappaUnmixingJob>* m1,
                                     GadgetContainerMessage<ISMRMRD::ImageHeader>* m2, GadgetContainerMessage<hoNDArray<std::complex<float> > >* m3)
   {
+    if (drop_late_frames.value() && this->newer_frame_waiting(m2->getObjectPtr()->slice)) {
+      GDEBUG("Dropping frame of slice %d, a newer frame is waiting\n", m2->getObjectPtr()->slice);
+      statistics_.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+      m1->release();
+      return GADGET_OK;
+    }
+
+    GadgetStatistics::clock::time_point frame_start = m1->getObjectPtr()->frame_start_;
+
     GadgetContainerMessage< hoNDArray<std::complex<float> > >* cm2 =
 			new GadgetContainerMessage< hoNDArray<std::complex<float> > >();
 
@@ -37,25 +159,34 @@ namespace Gadgetron{
     m1->cont(0);
     m2->cont(cm2);
 
-    hoNDFFT<float>::instance()->ifft3c(*m3->getObjectPtr());
-    /*
-    hoNDFFT<float>::instance()->ifft(m3->getObjectPtr(),0);
-    hoNDFFT<float>::instance()->ifft(m3->getObjectPtr(),1);
-    hoNDFFT<float>::instance()->ifft(m3->getObjectPtr(),2);
-    */
+    const std::vector<size_t>& lines = m1->getObjectPtr()->lines_;
+
+    hoNDArray< std::complex<float> > images;
+    this->ifft_frame(*m3->getObjectPtr(), lines, images);
 
     if (!m1->getObjectPtr()->weights_) {
       GDEBUG("Weights are a NULL\n");
       return GADGET_FAIL;
     }
 
+    bool window = sliding_window.value() && !lines.empty();
+
+    hoNDArray< std::complex<float> > unmixed;
+    if (window) {
+      unmixed.create(combined_dims);
+    }
+
     float scale_factor = 1.0;
-    int appl_result = m1->getObjectPtr()->weights_->apply(m3->getObjectPtr(), cm2->getObjectPtr(), scale_factor);
+    int appl_result = m1->getObjectPtr()->weights_->apply(&images, window ? &unmixed : cm2->getObjectPtr(), scale_factor);
     if (appl_result < 0) {
       GDEBUG("Failed to apply GRAPPA weights: error code %d\n", appl_result);
       return GADGET_FAIL;
     }
 
+    if (window) {
+      this->update_window(m2->getObjectPtr()->slice, lines, unmixed, *cm2->getObjectPtr());
+    }
+
     m1->release();
     m3->release();
 
@@ -63,6 +194,17 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
+    if (frame_start != GadgetStatistics::clock::time_point()) {
+      uint64_t latency = GadgetStatistics::elapsed_us(frame_start, GadgetStatistics::clock::now());
+      statistics_.frame_latency_us.add(latency);
+
+      float deadline = frame_deadline_ms.value();
+      if (deadline > 0 && latency > (uint64_t)(deadline*1000)) {
+        statistics_.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+        GDEBUG("Frame missed its deadline by %f ms\n", latency/1000.0f - deadline);
+      }
+    }
+
     return GADGET_OK;
   }
 
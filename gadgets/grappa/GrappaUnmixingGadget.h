@@ -8,14 +8,46 @@
 #include "GrappaWeights.h"
 
 #include <complex>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace Gadgetron{
 
   struct EXPORTGADGETSGRAPPA GrappaUnmixingJob
   {
     boost::shared_ptr< GrappaWeights<float> > weights_;
+
+    /// Time the last readout of the frame arrived, the start of the frame latency
+    GadgetStatistics::clock::time_point frame_start_;
+
+    /// Encoding lines (with the line offset) sampled in the frame, sorted, empty if not known
+    std::vector<size_t> lines_;
   };
 
+  /**
+     Applies the GRAPPA unmixing weights to a frame.
+
+     For real-time (interventional) pipelines the gadget can run in a low latency mode:
+     with drop_late_frames a frame is skipped when a newer frame of the same slice is already
+     waiting at the head of the input queue, so only the newest frame is reconstructed when the
+     pipeline falls behind the acquisition. The latency of every frame, the frames dropped and the
+     frames put out after frame_deadline_ms are kept in the gadget statistics.
+     Looking ahead on the queue needs the ace queue (not lockfree) and a single thread.
+
+     The frames hold only the lines acquired for them. When these lines are a regular interleave
+     of a 2D k-space (every R-th line, as in TGRAPPA), the inverse FFT only transforms the sampled
+     lines: along E1 the image of the interleave is the E1/R point transform, repeated R times with
+     a linear phase.
+
+     With sliding_window the gadget puts out the unmixed image of the newest acquisition of every
+     line instead of the frame alone. As the unmixing is linear this is the sum of the unmixed
+     images of the line groups of the last frames, so only the image of the new lines is computed
+     and replaces the images of the groups it shares lines with. Groups unmixed with older weights
+     are replaced as the window slides on.
+   */
+
   class EXPORTGADGETSGRAPPA GrappaUnmixingGadget: public Gadget3<GrappaUnmixingJob, ISMRMRD::ImageHeader, hoNDArray<std::complex<float> > > {
   public:
     GADGET_DECLARE(GrappaUnmixingGadget);
@@ -24,8 +56,31 @@ namespace Gadgetron{
     virtual ~GrappaUnmixingGadget();
 
   protected:
+    GADGET_PROPERTY(drop_late_frames, bool, "Skip a frame if a newer frame of the same slice is waiting on the input queue", false);
+    GADGET_PROPERTY(frame_deadline_ms, float, "Maximal time from the end of the frame acquisition to the output of the image in ms (0 = no deadline)", 0);
+    GADGET_PROPERTY(sliding_window, bool, "Put out the unmixed image of the newest acquisition of every line, only the new lines are reconstructed", false);
+
+    /// Unmixed image of the lines of one frame
+    struct LineGroup
+    {
+      std::vector<size_t> lines_;
+      hoNDArray< std::complex<float> > unmixed_;
+    };
+
+    /// True if a newer frame of the slice is at the head of the input queue
+    bool newer_frame_waiting(uint16_t slice);
+
+    /// Coil images of the k-space data [RO E1 E2 CHA] sampled on lines, into images or in-place into data (images then wraps data)
+    void ifft_frame(hoNDArray< std::complex<float> >& data, const std::vector<size_t>& lines, hoNDArray< std::complex<float> >& images);
+
+    /// Replaces the groups of the slice sharing lines with the frame by its unmixed image and puts the sum of all groups into out
+    void update_window(uint16_t slice, const std::vector<size_t>& lines, hoNDArray< std::complex<float> >& unmixed, hoNDArray< std::complex<float> >& out);
+
     virtual int process(GadgetContainerMessage<GrappaUnmixingJob>* m1,
                         GadgetContainerMessage<ISMRMRD::ImageHeader>* m2, GadgetContainerMessage<hoNDArray<std::complex<float> > >* m3);
+
+    std::map< uint16_t, std::list<LineGroup> > window_;
+    std::mutex window_mutex_;
   };
 }
 
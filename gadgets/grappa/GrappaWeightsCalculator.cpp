@@ -192,6 +192,20 @@ template <class T> int GrappaWeightsCalculator<T>::svc(void)  {
                 hoNDArray< std::complex<float> > acs(RO, E1, target_coils_, reinterpret_cast< std::complex<float>* >(host_data->begin()));
                 hoNDArray< std::complex<float> > target_acs(RO, E1, target_coils_, acs.begin());
 
+                // the kernel is updated first, the weights are kept if the calibration data did not change
+                if (incremental_calib_ && (mb1->getObjectPtr()->acceleration_factor > 1))
+                {
+                    if (!incremental_calibs_[mb1->getObjectPtr()->destination.get()].calib(acs, target_acs,
+                        (size_t)(mb1->getObjectPtr()->acceleration_factor), thres, kRO, kNE1,
+                        mb1->getObjectPtr()->sampled_region[0].first, mb1->getObjectPtr()->sampled_region[0].second,
+                        mb1->getObjectPtr()->sampled_region[1].first, mb1->getObjectPtr()->sampled_region[1].second, conv_ker_))
+                    {
+                        GDEBUG("Calibration data unchanged, GRAPPA weights are kept\n");
+                        mb->release();
+                        continue;
+                    }
+                }
+
                 // estimate coil map
                 if (!complex_im_.dimensions_equal(&target_acs))
                 {
@@ -216,9 +230,12 @@ template <class T> int GrappaWeightsCalculator<T>::svc(void)  {
                     size_t startE1 = mb1->getObjectPtr()->sampled_region[1].first;
                     size_t endE1 = mb1->getObjectPtr()->sampled_region[1].second;
 
-                    Gadgetron::grappa2d_calib_convolution_kernel(acs, target_acs,
-                        (size_t)(mb1->getObjectPtr()->acceleration_factor),
-                        thres, kRO, kNE1, startRO, endRO, startE1, endE1, conv_ker_);
+                    if (!incremental_calib_)
+                    {
+                        Gadgetron::grappa2d_calib_convolution_kernel(acs, target_acs,
+                            (size_t)(mb1->getObjectPtr()->acceleration_factor),
+                            thres, kRO, kNE1, startRO, endRO, startE1, endE1, conv_ker_);
+                    }
 
                     Gadgetron::grappa2d_image_domain_kernel(conv_ker_, RO, E1, kIm_);
 
@@ -321,6 +338,24 @@ template <class T> int GrappaWeightsCalculator<T>::svc(void)  {
                         }
                     }
 
+                    if (incremental_calib_)
+                    {
+                        if (!incremental_calibs_[mb1->getObjectPtr()->destination.get()].calib(acs, target_acs_,
+                            (size_t)(mb1->getObjectPtr()->acceleration_factor), thres, kRO, kNE1,
+                            0, RO - 1, 0, E1 - 1, conv_ker_))
+                        {
+                            GDEBUG("Calibration data unchanged, GRAPPA weights are kept\n");
+                            mb->release();
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        Gadgetron::grappa2d_calib_convolution_kernel(acs, target_acs_,
+                            (size_t)(mb1->getObjectPtr()->acceleration_factor),
+                            thres, kRO, kNE1, conv_ker_);
+                    }
+
                     if (!complex_im_.dimensions_equal(&target_acs_))
                     {
                         complex_im_.create(RO, E1, target_acs_.get_size(2));
@@ -330,10 +365,6 @@ template <class T> int GrappaWeightsCalculator<T>::svc(void)  {
 
                     Gadgetron::coil_map_2d_Inati(complex_im_, coil_map_, ks, power);
 
-                    Gadgetron::grappa2d_calib_convolution_kernel(acs, target_acs_,
-                        (size_t)(mb1->getObjectPtr()->acceleration_factor),
-                        thres, kRO, kNE1, conv_ker_);
-
                     Gadgetron::grappa2d_image_domain_kernel(conv_ker_, RO, E1, kIm_);
 
                     // kIm_ stored the unwrapping coefficients as [RO E1 CHA target_coils_with_uncombined]
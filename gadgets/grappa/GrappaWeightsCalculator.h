@@ -2,9 +2,11 @@
 
 #include "gadgetron_grappa_export.h"
 #include "GrappaWeights.h"
+#include "GrappaIncrementalCalibration.h"
 
 #include <ace/Task.h>
 #include <list>
+#include <map>
 
 namespace Gadgetron{
 
@@ -16,6 +18,7 @@ template <class T> class EXPORTGADGETSGRAPPA GrappaWeightsCalculator : public AC
   GrappaWeightsCalculator() 
     : inherited()
     , target_coils_(0)
+    , incremental_calib_(false)
   {
     #ifdef USE_CUDA
       use_gpu_ = true;
@@ -68,10 +71,24 @@ template <class T> class EXPORTGADGETSGRAPPA GrappaWeightsCalculator : public AC
       use_gpu_ = v;
   }
 
+  /// if true, the cpu calibration keeps the normal equations of every destination and only updates
+  /// the rows of changed calibration lines, see GrappaIncrementalCalibration
+  bool get_incremental_calib() {
+    return incremental_calib_;
+  }
+
+  void set_incremental_calib(bool v) {
+      incremental_calib_ = v;
+  }
+
  private:
   std::list<unsigned int> uncombined_channels_;
   int target_coils_;
   bool use_gpu_;
+  bool incremental_calib_;
+
+  // normal equations for every destination
+  std::map< GrappaWeights<T>*, GrappaIncrementalCalibration<T> > incremental_calibs_;
 
   hoNDArray< std::complex<T> > target_acs_;
 
@@ -30,8 +30,6 @@ CSIGadget::~CSIGadget() {
 int CSIGadget::process_config(ACE_Message_Block *mb){
 	//GDEBUG("gpuCgSenseGadget::process_config\n");
 
-        device_number_ = deviceno.value();
-
 	int number_of_devices = 0;
 	if (cudaGetDeviceCount(&number_of_devices)!= cudaSuccess) {
 		GDEBUG( "Error: unable to query number of CUDA devices.\n" );
@@ -43,10 +41,8 @@ int CSIGadget::process_config(ACE_Message_Block *mb){
 		return GADGET_FAIL;
 	}
 
-	if (device_number_ >= number_of_devices) {
-		GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-		device_number_ = (device_number_%number_of_devices);
-	}
+	device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+	GDEBUG("Using CUDA device %d\n", device_number_);
 
 	if (cudaSetDevice(device_number_)!= cudaSuccess) {
 		GDEBUG( "Error: unable to set CUDA device.\n" );
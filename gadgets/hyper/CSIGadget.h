@@ -15,6 +15,7 @@
 #include "cuNonCartesianSenseOperator.h"
 #include "cuSbcCgSolver.h"
 #include "gpuCSICoilEstimationGadget.h"
+#include "cudaDeviceManager.h"
 namespace Gadgetron {
 
 class CSIGadget: public Gadgetron::Gadget1<cuSenseData>{
@@ -26,7 +27,7 @@ public:
     virtual int process_config( ACE_Message_Block* mb );
 
 protected:
-    GADGET_PROPERTY(deviceno,int,"GPU device number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(number_of_cg_iterations,int,"Number of CG iterations", 10);
     GADGET_PROPERTY(number_of_sb_iterations,int,"Number of SB iterations",20);
     GADGET_PROPERTY(cg_limit,float,"CG limit",1e-5f);
@@ -43,6 +44,7 @@ protected:
 
 
     int device_number_;
+    cudaDeviceSelection device_selection_;
     unsigned int number_of_cg_iterations_;
     unsigned int number_of_sb_iterations_;
     float cg_limit_;
@@ -26,6 +26,14 @@ int DeviceChannelSplitterGadget<T>
     return GADGET_FAIL;
   }
   
+  //The channel images reference the incoming buffer instead of copying it
+  m2->getObjectPtr()->share();
+
+  std::vector<size_t> image_dims(4);
+  image_dims[0] = dim_x;
+  image_dims[1] = dim_y;
+  image_dims[2] = dim_z;
+  image_dims[3] = 1;
 
   for (int i = 0; i < array_channels; i++) {
     
@@ -47,8 +55,7 @@ int DeviceChannelSplitterGadget<T>
     */
 
     GadgetContainerMessage< hoNDArray< T > >* im2 = new GadgetContainerMessage< hoNDArray< T > >();
-    im2->getObjectPtr()->create(dim_x,dim_y,dim_z,1);
-    memcpy(im2->getObjectPtr()->get_data_ptr(), m2->getObjectPtr()->get_data_ptr() + i*image_elements, sizeof(T)*image_elements);
+    m2->getObjectPtr()->get_shared_sub_array(i*image_elements, image_dims, *im2->getObjectPtr());
     
     im1->cont(im2);
     
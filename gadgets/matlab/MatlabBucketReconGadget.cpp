@@ -13,15 +13,16 @@ std::mutex mutex_MBRG_;
 namespace Gadgetron{
 
 MatlabBucketReconGadget::MatlabBucketReconGadget()
+    : engine_(0)
 {
 }
 
 MatlabBucketReconGadget::~MatlabBucketReconGadget()
 {
     std::lock_guard<std::mutex> lock(mutex_MBRG_);   
-    // Close the Matlab engine
-    GDEBUG("Closing down Matlab\n");
-    engClose(engine_);
+    // Return the Matlab engine to the pool
+    GDEBUG("Returning Matlab engine to the pool\n");
+    MatlabEnginePool::instance().release(engine_);
 }
 
 int MatlabBucketReconGadget::process_config(ACE_Message_Block* mb)
@@ -98,26 +99,10 @@ int MatlabBucketReconGadget::process_config(ACE_Message_Block* mb)
     GDEBUG("MATLAB Class Name : %s\n", classname_.c_str());
 
 
-    // Open the Matlab Engine on the current host
-    GDEBUG("Starting MATLAB engine with command: %s\n", startcmd_.c_str());
-    if (!(engine_ = engOpen(startcmd_.c_str()))) {
-        // TODO: error checking!
-        GDEBUG("Can't start MATLAB engine\n");
-    } else {
-        // Prepare a buffer for collecting Matlab's output
-        char matlab_buffer_[2049] = "\0";
-        engOutputBuffer(engine_, matlab_buffer_, 2048);
-
-        // Add the necessary paths to the matlab environment
-        // Java matlab command server
-        std::string gadgetron_matlab_path = get_gadgetron_home() + "/share/gadgetron/matlab";
-        std::string add_path_cmd = std::string("addpath('") + gadgetron_matlab_path + std::string("');");
-        // Gadgetron matlab scripts
-        engEvalString(engine_, add_path_cmd.c_str());
-        // ISMRMRD matlab library
-        engEvalString(engine_, "addpath(fullfile(getenv('ISMRMRD_HOME'), '/share/ismrmrd/matlab'));");
-
-        GDEBUG("%s", matlab_buffer_);
+    // Lease a Matlab Engine on the current host, the Gadgetron and ISMRMRD paths are set up by the pool
+    if (!(engine_ = MatlabEnginePool::instance().acquire(startcmd_))) {
+        GERROR("Can't start MATLAB engine\n");
+        return GADGET_FAIL;
     }
 
     //char matlab_buffer_[2049] = "\0";
@@ -440,9 +425,8 @@ int MatlabBucketReconGadget::process(GadgetContainerMessage<IsmrmrdAcquisitionBu
 		ISMRMRD::ImageHeader *hdr_new = m3->getObjectPtr();
 		memcpy(hdr_new, mxGetData(res_hdr), sizeof(ISMRMRD::ImageHeader));
 
-		auto image= MatlabToHoNDArray<std::complex<float>>(res_data);
-		auto m4 = new GadgetContainerMessage< hoNDArray< std::complex<float> > >(image);
-		auto dims = *image.get_dimensions();
+		auto m4 = new GadgetContainerMessage< hoNDArray< std::complex<float> > >();
+		MatlabToHoNDArray(res_data, *m4->getObjectPtr());
 
 		m3->cont(m4);
         
@@ -474,18 +458,17 @@ int MatlabBucketReconGadget::process(GadgetContainerMessage<IsmrmrdAcquisitionBu
 
 	for (mwIndex idx = 0; idx <qlen; idx++){
 
-		IsmrmrdReconData output_data;
-		IsmrmrdReconBit bit;
+		// fill the message in place, the buffers are not copied again
+		auto m3 = new GadgetContainerMessage<IsmrmrdReconData>();
+		m3->getObjectPtr()->rbit_.resize(1);
+		IsmrmrdReconBit& bit = m3->getObjectPtr()->rbit_[0];
 		bit.data_ = MatlabStructToBuffer(mxGetField(bufferQ,idx,"data"));
 
-        
 		auto ref = mxGetField(bufferQ,idx,"reference");
 		if (ref){
 			GDEBUG("Adding reference");
 			bit.ref_ = MatlabStructToBuffer(ref);
 		}
-		output_data.rbit_.push_back(bit);
-		auto m3 = new GadgetContainerMessage<IsmrmrdReconData>(output_data);
 		if (this->next()->putq(m3) < 0){
 			GDEBUG("Failed to put Buffer message on queue\n");
 			return GADGET_FAIL;
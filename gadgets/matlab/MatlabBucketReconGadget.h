@@ -16,6 +16,7 @@
 
 #include <mutex>
 #include "engine.h"     // Matlab Engine header
+#include "MatlabEnginePool.h"
 #include "gadgetron_paths.h"
 
 
@@ -195,9 +195,8 @@ int MatlabBufferGadget::process(GadgetContainerMessage<IsmrmrdReconData>* m1)
 		ISMRMRD::ImageHeader *hdr_new = m3->getObjectPtr();
 		memcpy(hdr_new, mxGetData(res_hdr), sizeof(ISMRMRD::ImageHeader));
 
-		auto image= MatlabToHoNDArray<std::complex<float>>(res_data);
-		auto m4 = new GadgetContainerMessage< hoNDArray< std::complex<float> > >(image);
-		auto dims = *image.get_dimensions();
+		auto m4 = new GadgetContainerMessage< hoNDArray< std::complex<float> > >();
+		MatlabToHoNDArray(res_data, *m4->getObjectPtr());
 
 		m3->cont(m4);
 		if (this->next()->putq(m3) < 0) {
@@ -223,8 +222,10 @@ int MatlabBufferGadget::process(GadgetContainerMessage<IsmrmrdReconData>* m1)
 
 	for (mwIndex idx = 0; idx <qlen; idx++){
 
-		IsmrmrdReconData output_data;
-		IsmrmrdReconBit bit;
+		// fill the message in place, the buffers are not copied again
+		auto m3 = new GadgetContainerMessage<IsmrmrdReconData>();
+		m3->getObjectPtr()->rbit_.resize(1);
+		IsmrmrdReconBit& bit = m3->getObjectPtr()->rbit_[0];
 		bit.data_ = MatlabStructToBuffer(mxGetField(bufferQ,idx,"data"));
 
 		auto ref = mxGetField(bufferQ,idx,"reference");
@@ -232,8 +233,6 @@ int MatlabBufferGadget::process(GadgetContainerMessage<IsmrmrdReconData>* m1)
 			GDEBUG("Adding reference");
 			bit.ref_ = MatlabStructToBuffer(ref);
 		}
-		output_data.rbit_.push_back(bit);
-		auto m3 = new GadgetContainerMessage<IsmrmrdReconData>(output_data);
 		if (this->next()->putq(m3) < 0){
 			GDEBUG("Failed to put Buffer message on queue\n");
 			return GADGET_FAIL;
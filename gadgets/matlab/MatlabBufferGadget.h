@@ -7,6 +7,7 @@
 #include "hoNDArray.h"
 #include "ismrmrd/ismrmrd.h"
 #include "engine.h"     // Matlab Engine header
+#include "MatlabEnginePool.h"
 
 //#include "ace/Synch.h"  // For the MatlabCommandServer
 #include "ace/SOCK_Connector.h"
@@ -32,15 +33,15 @@ class MatlabBufferGadget:
     public Gadget1<IsmrmrdReconData >
 {
 public:
-    MatlabBufferGadget(): Gadget1<IsmrmrdReconData >()
+    MatlabBufferGadget(): Gadget1<IsmrmrdReconData >(), engine_(0)
     {
     }
 
     ~MatlabBufferGadget()
     {
         std::lock_guard<std::mutex> lock(mutex_);   
-        GDEBUG("Closing down Matlab\n");
-        engClose(engine_);
+        GDEBUG("Returning Matlab engine to the pool\n");
+        MatlabEnginePool::instance().release(engine_);
     }
 
     virtual int process(GadgetContainerMessage<IsmrmrdReconData> *);
@@ -69,32 +70,12 @@ protected:
         GDEBUG("MATLAB Class Name : %s\n", classname_.c_str());
 
 
-		// Open the Matlab Engine on the current host
-		GDEBUG("Starting MATLAB engine with command: %s\n", startcmd_.c_str());
-		if (!(engine_ = engOpen(startcmd_.c_str()))) {
-			// TODO: error checking!
-			GDEBUG("Can't start MATLAB engine\n");
-		} else {
-            // Prepare a buffer for collecting Matlab's output
-            char matlab_buffer_[2049] = "\0";
-            engOutputBuffer(engine_, matlab_buffer_, 2048);
-
-	    // Add the necessary paths to the matlab environment
-	    // Java matlab command server
-	    std::string gadgetron_matlab_path = get_gadgetron_home() + "/share/gadgetron/matlab";
-	    std::string add_path_cmd = std::string("addpath('") + gadgetron_matlab_path + std::string("');");
-            // Gadgetron matlab scripts
-	    engEvalString(engine_, add_path_cmd.c_str());
-            // ISMRMRD matlab library
-            engEvalString(engine_, "addpath(fullfile(getenv('ISMRMRD_HOME'), '/share/ismrmrd/matlab'));");
-  
-	    GDEBUG("%s", matlab_buffer_);
+        // Lease a Matlab Engine on the current host, the Gadgetron and ISMRMRD paths are set up by the pool
+        if (!(engine_ = MatlabEnginePool::instance().acquire(startcmd_))) {
+            GERROR("Can't start MATLAB engine\n");
+            return GADGET_FAIL;
         }
 
-
-
-
-
         //char matlab_buffer_[2049] = "\0";
         char matlab_buffer_[20481] = "\0";
         engOutputBuffer(engine_, matlab_buffer_, 20480);
@@ -0,0 +1,211 @@
+#include "MatlabEnginePool.h"
+#include "gadgetron_paths.h"
+#include "log.h"
+
+#include <cstdlib>
+#include <future>
+#include <list>
+#include <chrono>
+
+namespace Gadgetron {
+
+    namespace {
+        // engOpen is not safe to call concurrently
+        std::mutex open_mutex;
+
+        // background start ups, waited for when the pool goes
+        std::list< std::future<void> > start_ups;
+
+        const char* RESET_COMMAND = "clear all; clear classes; close all force; fclose('all'); restoredefaultpath;";
+    }
+
+    MatlabEnginePool& MatlabEnginePool::instance()
+    {
+        static MatlabEnginePool pool;
+        return pool;
+    }
+
+    MatlabEnginePool::MatlabEnginePool()
+        : size_(1)
+    {
+        const char* s = std::getenv("GADGETRON_MATLAB_ENGINE_POOL");
+        if (s && std::atoi(s) >= 0) size_ = std::atoi(s);
+    }
+
+    MatlabEnginePool::~MatlabEnginePool()
+    {
+        std::list< std::future<void> > pending;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            size_ = 0;
+            pending.swap(start_ups);
+        }
+        for (auto& f : pending) f.wait();
+
+        for (size_t n = 0; n < idle_.size(); n++) engClose(idle_[n].second);
+        idle_.clear();
+    }
+
+    void MatlabEnginePool::set_size(size_t n)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        size_ = n;
+
+        // keep the most recently returned engines of every start command
+        std::map<std::string, size_t> kept;
+        std::deque< std::pair<std::string, Engine*> > idle;
+        for (size_t k = 0; k < idle_.size(); k++) {
+            if (kept[idle_[k].first]++ < size_) {
+                idle.push_back(idle_[k]);
+            } else {
+                engClose(idle_[k].second);
+            }
+        }
+        idle_.swap(idle);
+    }
+
+    size_t MatlabEnginePool::size()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return size_;
+    }
+
+    size_t MatlabEnginePool::number_of_idle(const std::string& startcmd) const
+    {
+        size_t n = 0;
+        for (size_t k = 0; k < idle_.size(); k++) if (idle_[k].first == startcmd) n++;
+        return n;
+    }
+
+    Engine* MatlabEnginePool::open(const std::string& startcmd)
+    {
+        std::lock_guard<std::mutex> guard(open_mutex);
+
+        GDEBUG("Starting MATLAB engine with command: %s\n", startcmd.c_str());
+        Engine* engine = engOpen(startcmd.c_str());
+        if (!engine) {
+            GERROR("Can't start MATLAB engine with command: %s\n", startcmd.c_str());
+            return 0;
+        }
+
+        engSetVisible(engine, false);
+        if (!reset(engine)) {
+            GERROR("MATLAB engine started with command %s does not respond\n", startcmd.c_str());
+            engClose(engine);
+            return 0;
+        }
+
+        return engine;
+    }
+
+    bool MatlabEnginePool::reset(Engine* engine)
+    {
+        // Prepare a buffer for collecting Matlab's output
+        char matlab_buffer_[2049] = "\0";
+        engOutputBuffer(engine, matlab_buffer_, 2048);
+
+        // Java matlab command server and Gadgetron matlab scripts
+        std::string gadgetron_matlab_path = get_gadgetron_home() + "/share/gadgetron/matlab";
+        std::string cmd = std::string(RESET_COMMAND) + "addpath('" + gadgetron_matlab_path + "');";
+        // ISMRMRD matlab library
+        cmd += "addpath(fullfile(getenv('ISMRMRD_HOME'), '/share/ismrmrd/matlab'));";
+
+        int res = engEvalString(engine, cmd.c_str());
+        GDEBUG("%s", matlab_buffer_);
+
+        engOutputBuffer(engine, NULL, 0);
+        return res == 0;
+    }
+
+    void MatlabEnginePool::top_up(const std::string& startcmd)
+    {
+        // forget the start ups that have finished
+        for (auto it = start_ups.begin(); it != start_ups.end(); ) {
+            if (it->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                it = start_ups.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        size_t available = this->number_of_idle(startcmd) + starting_[startcmd];
+        if (available >= size_) return;
+
+        size_t n = size_ - available;
+        starting_[startcmd] += n;
+
+        start_ups.push_back(std::async(std::launch::async, [this, startcmd, n]() {
+            for (size_t k = 0; k < n; k++) {
+                Engine* engine = open(startcmd);
+
+                std::lock_guard<std::mutex> guard(mutex_);
+                starting_[startcmd]--;
+                if (!engine) continue;
+
+                if (this->number_of_idle(startcmd) < size_) {
+                    idle_.push_back(std::make_pair(startcmd, engine));
+                } else {
+                    engClose(engine);
+                }
+            }
+        }));
+    }
+
+    Engine* MatlabEnginePool::acquire(const std::string& startcmd)
+    {
+        Engine* engine = 0;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+                if (it->first == startcmd) {
+                    engine = it->second;
+                    idle_.erase(it);
+                    break;
+                }
+            }
+            this->top_up(startcmd);
+        }
+
+        if (engine) {
+            GDEBUG("Using pooled MATLAB engine started with command: %s\n", startcmd.c_str());
+        } else {
+            engine = open(startcmd);
+            if (!engine) return 0;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        leased_[engine] = startcmd;
+        return engine;
+    }
+
+    void MatlabEnginePool::release(Engine* engine)
+    {
+        if (!engine) return;
+
+        std::string startcmd;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            auto it = leased_.find(engine);
+            if (it == leased_.end()) {
+                GERROR("MatlabEnginePool, releasing an engine that was not leased from the pool\n");
+                return;
+            }
+            startcmd = it->second;
+            leased_.erase(it);
+        }
+
+        // the workspace of one connection must not leak into the next
+        if (!reset(engine)) {
+            GWARN("MATLAB engine does not respond, closing it\n");
+            engClose(engine);
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (this->number_of_idle(startcmd) < size_) {
+            idle_.push_front(std::make_pair(startcmd, engine));
+        } else {
+            engClose(engine);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/** \file   MatlabEnginePool.h
+    \brief  Server wide pool of MATLAB engines shared by the Matlab gadgets.
+
+            Starting a MATLAB engine takes several seconds, too long to do it for every connection. The
+            Matlab gadgets lease an engine when they are configured and return it when they are destroyed.
+            A returned engine is cleaned up (workspace, classes, figures, files and path) and kept for the
+            next gadget with the same start command.
+
+            The pool keeps size() idle engines per start command. Engines are started ahead of time on a
+            background thread once the first gadget has asked for a start command, so that the next
+            connection finds one waiting.
+*/
+
+#pragma once
+
+#include "gadgetron_matlab_export.h"
+#include "engine.h"     // Matlab Engine header
+
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace Gadgetron {
+
+    class EXPORTGADGETSMATLAB MatlabEnginePool
+    {
+    public:
+        static MatlabEnginePool& instance();
+
+        /// Leases an engine started with startcmd, with the Gadgetron and ISMRMRD matlab paths added, 0 on failure
+        Engine* acquire(const std::string& startcmd);
+
+        /// Returns a leased engine, it is closed if it cannot be cleaned up or the pool is full
+        void release(Engine* engine);
+
+        /// Number of idle engines per start command, initialised from GADGETRON_MATLAB_ENGINE_POOL (1 by default)
+        void set_size(size_t n);
+        size_t size();
+
+    protected:
+        MatlabEnginePool();
+        ~MatlabEnginePool();
+
+        /// Opens a new engine and adds the paths, 0 on failure
+        static Engine* open(const std::string& startcmd);
+
+        /// Resets an engine to the state open() left it in, false if the engine does not respond
+        static bool reset(Engine* engine);
+
+        /// Starts engines on a background thread until size() are idle for startcmd, mutex_ must be held
+        void top_up(const std::string& startcmd);
+
+        size_t number_of_idle(const std::string& startcmd) const;
+
+        std::mutex mutex_;
+        size_t size_;
+        std::deque< std::pair<std::string, Engine*> > idle_;
+        std::map<Engine*, std::string> leased_;
+        std::map<std::string, size_t> starting_;
+    };
+}
@@ -7,6 +7,7 @@
 #include "ismrmrd/ismrmrd.h"
 #include "log.h"
 #include "engine.h"     // Matlab Engine header
+#include "MatlabEnginePool.h"
 
 #include "ace/Synch.h"  // For the MatlabCommandServer
 #include "ace/SOCK_Connector.h"
@@ -34,34 +35,16 @@ template <class T> class MatlabGadget :
 public:
 	MatlabGadget(): Gadget2<T, hoNDArray< std::complex<float> > >()
 	{
-		// Open the Matlab Engine on the current host
-		GDEBUG("Starting MATLAB engine\n");
-		if (!(engine_ = engOpen("matlab -nosplash -nodesktop"))) {
-			// TODO: error checking!
-			GDEBUG("Can't start MATLAB engine\n");
-		} else {
-
-			// Prepare a buffer for collecting Matlab's output
-			char matlab_buffer_[2049] = "\0";
-			engOutputBuffer(engine_, matlab_buffer_, 2048);
-
-			// Add the necessary paths to the matlab environment
-			// Java matlab command server
-			std::string gadgetron_matlab_path = get_gadgetron_home() + "/share/gadgetron/matlab";
-			std::string add_path_cmd = std::string("addpath('") + gadgetron_matlab_path + std::string("');");
-			// Gadgetron matlab scripts
-			engEvalString(engine_, add_path_cmd.c_str());
-			// ISMRMRD matlab library
-			engEvalString(engine_, "addpath(fullfile(getenv('ISMRMRD_HOME'), '/share/ismrmrd/matlab'));");
-
-			GDEBUG("%s", matlab_buffer_);
+		// Lease a Matlab Engine on the current host, the Gadgetron and ISMRMRD paths are set up by the pool
+		if (!(engine_ = MatlabEnginePool::instance().acquire("matlab -nosplash -nodesktop"))) {
+			GERROR("Can't start MATLAB engine\n");
 		}
 	}
 
 	~MatlabGadget()
 	{
-		GDEBUG("Closing down Matlab\n");
-		engClose(engine_);
+		GDEBUG("Returning Matlab engine to the pool\n");
+		MatlabEnginePool::instance().release(engine_);
 	}
 
 protected:
@@ -81,6 +64,11 @@ protected:
 			return GADGET_FAIL;
 		}
 
+		if (!engine_) {
+			GERROR("No MATLAB engine\n");
+			return GADGET_FAIL;
+		}
+
 		GDEBUG("MATLAB Class Name : %s\n", classname_.c_str());
 
 		//char matlab_buffer_[2049] = "\0";
@@ -26,6 +26,8 @@ namespace Gadgetron{
     solver->set_alpha(this->alpha_);
     solver->set_beta(this->beta_);
     solver->set_limit(this->limit_);
+    solver->set_sor_relaxation(sor_relaxation.value());
+    solver->set_convergence_check_interval(convergence_check_interval.value());
 
     return GADGET_OK;
   }
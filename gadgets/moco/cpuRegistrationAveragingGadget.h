@@ -17,6 +17,9 @@ namespace Gadgetron{
     virtual ~cpuRegistrationAveragingGadget2D() {}
 
   protected:
+    GADGET_PROPERTY(sor_relaxation, float, "Over-relaxation factor of the Gauss-Seidel iterations, in (0,2)", 1.0);
+    GADGET_PROPERTY(convergence_check_interval, int, "Test for convergence every n'th iteration", 4);
+
     virtual int setup_solver();
     virtual int set_continuation( GadgetContainerMessage<ISMRMRD::ImageHeader> *m1, hoNDArray<float> *continuation );
   };
@@ -4,6 +4,25 @@
 
 namespace Gadgetron{
 
+  int gpuRegistrationAveragingGadget2D::process_config(ACE_Message_Block *mb)
+  {
+    int number_of_devices = 0;
+    if (cudaGetDeviceCount(&number_of_devices)!= cudaSuccess || number_of_devices == 0) {
+      GDEBUG( "Error: No available CUDA devices.\n" );
+      return GADGET_FAIL;
+    }
+
+    int device_number = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number);
+
+    if (cudaSetDevice(device_number)!= cudaSuccess) {
+      GDEBUG( "Error: unable to set CUDA device.\n" );
+      return GADGET_FAIL;
+    }
+
+    return RegistrationAveragingGadget< cuNDArray<float>, 2 >::process_config(mb);
+  }
+
   int gpuRegistrationAveragingGadget2D::setup_solver()
   {
     // Allocate solver
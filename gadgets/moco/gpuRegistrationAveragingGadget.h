@@ -5,6 +5,7 @@
 #include "cuNDArray_utils.h"
 #include "cuCKOpticalFlowSolver.h"
 #include "RegistrationAveragingGadget.h"
+#include "cudaDeviceManager.h"
 
 namespace Gadgetron{  
 
@@ -18,8 +19,13 @@ namespace Gadgetron{
     virtual ~gpuRegistrationAveragingGadget2D() {}
 
   protected:
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
+
+    virtual int process_config(ACE_Message_Block *mb);
     virtual int setup_solver();
     virtual int set_continuation( GadgetContainerMessage<ISMRMRD::ImageHeader> *m1, cuNDArray<float> *continuation );
+
+    cudaDeviceSelection device_selection_;
   };
 }
 
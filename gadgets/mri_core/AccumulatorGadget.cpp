@@ -21,8 +21,8 @@ AccumulatorGadget::~AccumulatorGadget()
  */
 int AccumulatorGadget::process_config(ACE_Message_Block* mb)
 {
-  ISMRMRD::IsmrmrdHeader h;
-  ISMRMRD::deserialize(mb->rd_ptr(),h);
+  boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+  const ISMRMRD::IsmrmrdHeader& h = *header;
 
   if (h.encoding.size() != 1) {
     GDEBUG("Number of encoding spaces: %d\n", h.encoding.size());
@@ -3,6 +3,8 @@
 #include "mri_core_data.h"
 #include "log.h"
 
+#include <algorithm>
+
 namespace Gadgetron{
 
   AcquisitionAccumulateTriggerGadget::~AcquisitionAccumulateTriggerGadget()
@@ -119,6 +121,48 @@ namespace Gadgetron{
 
     trigger_events_ = 0;
 
+    compact_buckets_ = compact_buckets.value();
+    compact_data_readouts_ = 0;
+    compact_ref_readouts_ = 0;
+    GDEBUG("COMPACT BUCKETS IS: %d\n", compact_buckets_);
+
+    stream_readouts_ = stream_readouts.value();
+    streamed_since_trigger_ = false;
+    if (stream_readouts_ && (sort_ != NONE)) {
+      GWARN_STREAM("AcquisitionAccumulateTriggerGadget, streaming readouts is not available with a sorting dimension, the readouts are accumulated");
+      stream_readouts_ = false;
+    }
+
+    limits_stats_.clear();
+    if (stream_readouts_) {
+      hdr_ = *this->get_ismrmrd_header(mb);
+
+      limits_stats_.resize(hdr_.encoding.size());
+      for (size_t e = 0; e < hdr_.encoding.size(); e++) {
+        const ISMRMRD::EncodingLimits& limits = hdr_.encoding[e].encodingLimits;
+        IsmrmrdAcquisitionBucketStats& stats = limits_stats_[e];
+
+        if (limits.kspace_encoding_step_1.is_present()) { stats.kspace_encode_step_1.insert(limits.kspace_encoding_step_1->minimum); stats.kspace_encode_step_1.insert(limits.kspace_encoding_step_1->maximum); }
+        if (limits.kspace_encoding_step_2.is_present()) { stats.kspace_encode_step_2.insert(limits.kspace_encoding_step_2->minimum); stats.kspace_encode_step_2.insert(limits.kspace_encoding_step_2->maximum); }
+        if (limits.slice.is_present()) { stats.slice.insert(limits.slice->minimum); stats.slice.insert(limits.slice->maximum); }
+        if (limits.phase.is_present()) { stats.phase.insert(limits.phase->minimum); stats.phase.insert(limits.phase->maximum); }
+        if (limits.contrast.is_present()) { stats.contrast.insert(limits.contrast->minimum); stats.contrast.insert(limits.contrast->maximum); }
+        if (limits.repetition.is_present()) { stats.repetition.insert(limits.repetition->minimum); stats.repetition.insert(limits.repetition->maximum); }
+        if (limits.set.is_present()) { stats.set.insert(limits.set->minimum); stats.set.insert(limits.set->maximum); }
+        if (limits.segment.is_present()) { stats.segment.insert(limits.segment->minimum); stats.segment.insert(limits.segment->maximum); }
+        if (limits.average.is_present()) { stats.average.insert(limits.average->minimum); stats.average.insert(limits.average->maximum); }
+      }
+    }
+
+    GDEBUG("STREAM READOUTS IS: %d\n", stream_readouts_);
+
+    progressive_ref_trigger_ = progressive_ref_trigger.value();
+    if (progressive_ref_trigger_ && stream_readouts_) {
+      GWARN_STREAM("AcquisitionAccumulateTriggerGadget, the progressive reference trigger is not used when streaming readouts");
+      progressive_ref_trigger_ = false;
+    }
+    GDEBUG("PROGRESSIVE REF TRIGGER IS: %d\n", progressive_ref_trigger_);
+
     return GADGET_OK;
   }
 
@@ -329,23 +373,69 @@ namespace Gadgetron{
     //Now we can update the previous data item that we store for 
     //purposes of determining if trigger condition has occurred. 
     prev_ = d;
-    
+
+    uint16_t espace = m1->getObjectPtr()->encoding_space_ref;
+
+    bool is_data = !(
+	  ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION).isSet(m1->getObjectPtr()->flags) ||
+	  ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA).isSet(m1->getObjectPtr()->flags)
+	);
+
+    bool is_ref = ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION).isSet(m1->getObjectPtr()->flags) ||
+	 ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION_AND_IMAGING).isSet(m1->getObjectPtr()->flags);
+
+    // the reference lines are complete when the imaging data starts
+    if (progressive_ref_trigger_ && is_data && !is_ref) {
+      if (trigger_ref() != GADGET_OK) {
+        m1->release();
+        return GADGET_FAIL;
+      }
+    }
+
+    if (stream_readouts_ && (espace < hdr_.encoding.size())) {
+      // the buffer of separate or external reference lines is sized by the lines received, these wait for the trigger
+      bool ref_waits = false;
+      if (is_ref && hdr_.encoding[espace].parallelImaging && hdr_.encoding[espace].parallelImaging->calibrationMode) {
+        std::string calib_mode = *hdr_.encoding[espace].parallelImaging->calibrationMode;
+        ref_waits = (calib_mode == "separate") || (calib_mode == "external");
+      }
+
+      if (!ref_waits) {
+        int ret = this->stream(d, is_data, is_ref);
+        if ((ret == GADGET_OK) && (trigger_ == N_ACQUISITIONS)) {
+          if (++n_acq_since_trigger_ >= n_acquisitions_before_trigger_) {
+            ret = trigger();
+            n_acq_since_trigger_ = 0;
+            n_acquisitions_before_trigger_ = n_acquisitions_before_ongoing_trigger_;
+          }
+        }
+
+        m1->release();
+        return ret;
+      }
+    }
+
     //Find the bucket the data should go in
     map_type_::iterator it = buckets_.find(sorting_index);
     if (it == buckets_.end()) {
       //Bucket does not exist, create it
       buckets_[sorting_index] = new GadgetContainerMessage<IsmrmrdAcquisitionBucket>;
+
+      if (compact_buckets_) {
+        size_t samples = m2->getObjectPtr()->get_number_of_elements();
+        size_t traj = (size_t)m1->getObjectPtr()->trajectory_dimensions*m1->getObjectPtr()->number_of_samples;
+        buckets_[sorting_index]->getObjectPtr()->data_slab_.reserve(compact_data_readouts_, samples, traj);
+        buckets_[sorting_index]->getObjectPtr()->ref_slab_.reserve(compact_ref_readouts_, samples, traj);
+      }
     }
     IsmrmrdAcquisitionBucket* bucket = buckets_[sorting_index]->getObjectPtr();
 
-    uint16_t espace = m1->getObjectPtr()->encoding_space_ref;
+    hoNDArray<float>* traj = d.traj_ ? d.traj_->getObjectPtr() : 0;
 
-    if (!(
-	  ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION).isSet(m1->getObjectPtr()->flags) ||
-	  ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PHASECORR_DATA).isSet(m1->getObjectPtr()->flags)
-	))
+    if (is_data)
       {
-	bucket->data_.push_back(d);
+	if (compact_buckets_) bucket->data_slab_.add(*m1->getObjectPtr(), *m2->getObjectPtr(), traj);
+	else bucket->data_.push_back(d);
         if (bucket->datastats_.size() < (espace+1)) {
             bucket->datastats_.resize(espace+1);
         }
@@ -360,10 +450,10 @@ namespace Gadgetron{
         bucket->datastats_[espace].repetition.insert(m1->getObjectPtr()->idx.repetition);
       }
 
-    if ( ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION).isSet(m1->getObjectPtr()->flags) ||
-	 ISMRMRD::FlagBit(ISMRMRD::ISMRMRD_ACQ_IS_PARALLEL_CALIBRATION_AND_IMAGING).isSet(m1->getObjectPtr()->flags) )
+    if (is_ref)
       {
-	bucket->ref_.push_back(d);
+	if (compact_buckets_) bucket->ref_slab_.add(*m1->getObjectPtr(), *m2->getObjectPtr(), traj);
+	else bucket->ref_.push_back(d);
         if (bucket->refstats_.size() < (espace+1)) {
             bucket->refstats_.resize(espace+1);
         }
@@ -401,7 +491,23 @@ namespace Gadgetron{
     //We will keep track of the triggers we encounter
     trigger_events_++;
 
+    // the end of a streamed trigger is marked by a bucket, even if nothing else is left to send
+    if (streamed_since_trigger_ && buckets_.empty()) {
+      buckets_[0] = new GadgetContainerMessage<IsmrmrdAcquisitionBucket>;
+    }
+    streamed_since_trigger_ = false;
+
     GDEBUG("Trigger (%d) occurred, sending out %d buckets\n", trigger_events_, buckets_.size());
+
+    if (compact_buckets_ && !buckets_.empty()) {
+      compact_data_readouts_ = 0;
+      compact_ref_readouts_ = 0;
+      for (map_type_::iterator it = buckets_.begin(); it != buckets_.end(); it++) {
+        if (!it->second) continue;
+        compact_data_readouts_ = std::max(compact_data_readouts_, it->second->getObjectPtr()->data_slab_.size());
+        compact_ref_readouts_ = std::max(compact_ref_readouts_, it->second->getObjectPtr()->ref_slab_.size());
+      }
+    }
     //Pass all buckets down the chain
     for (map_type_::iterator it = buckets_.begin(); it != buckets_.end(); it++) {
       if (it->second) {
@@ -418,6 +524,92 @@ namespace Gadgetron{
     return GADGET_OK;
   }
 
+  int AcquisitionAccumulateTriggerGadget::trigger_ref()
+  {
+    map_type_::iterator it = buckets_.begin();
+    while (it != buckets_.end()) {
+      IsmrmrdAcquisitionBucket* bucket = it->second ? it->second->getObjectPtr() : 0;
+
+      if (bucket && bucket->data_.empty() && bucket->data_slab_.empty() && (!bucket->ref_.empty() || !bucket->ref_slab_.empty())) {
+        GDEBUG("Reference lines are complete, sending out the reference bucket %d\n", it->first);
+        if (this->next()->putq(it->second) == -1) {
+          it->second->release();
+          buckets_.erase(it);
+          GDEBUG("Failed to pass bucket down the chain\n");
+          return GADGET_FAIL;
+        }
+
+        buckets_.erase(it++);
+      } else {
+        it++;
+      }
+    }
+
+    return GADGET_OK;
+  }
+
+  int AcquisitionAccumulateTriggerGadget::stream(IsmrmrdAcquisitionData& d, bool is_data, bool is_ref)
+  {
+    GadgetContainerMessage<IsmrmrdAcquisitionBucket>* cm = new GadgetContainerMessage<IsmrmrdAcquisitionBucket>;
+    IsmrmrdAcquisitionBucket* bucket = cm->getObjectPtr();
+    bucket->end_of_trigger_ = false;
+
+    const ISMRMRD::AcquisitionHeader& acqhdr = *d.head_->getObjectPtr();
+    uint16_t espace = acqhdr.encoding_space_ref;
+
+    if (is_data) {
+      bucket->data_.push_back(d);
+      bucket->datastats_.resize(espace+1);
+      this->fillStreamedStats(bucket->datastats_[espace], espace, acqhdr);
+    }
+
+    if (is_ref) {
+      bucket->ref_.push_back(d);
+      bucket->refstats_.resize(espace+1);
+      this->fillStreamedStats(bucket->refstats_[espace], espace, acqhdr);
+    }
+
+    streamed_since_trigger_ = true;
+
+    if (this->next()->putq(cm) == -1) {
+      cm->release();
+      GDEBUG("Failed to pass bucket down the chain\n");
+      return GADGET_FAIL;
+    }
+
+    return GADGET_OK;
+  }
+
+  void AcquisitionAccumulateTriggerGadget::fillStreamedStats(IsmrmrdAcquisitionBucketStats& stats, uint16_t espace, const ISMRMRD::AcquisitionHeader& acqhdr)
+  {
+    stats = limits_stats_[espace];
+
+    // a trigger covers one value of the trigger dimension
+    switch (trigger_) {
+    case KSPACE_ENCODE_STEP_1: stats.kspace_encode_step_1.clear(); break;
+    case KSPACE_ENCODE_STEP_2: stats.kspace_encode_step_2.clear(); break;
+    case AVERAGE: stats.average.clear(); break;
+    case SLICE: stats.slice.clear(); break;
+    case CONTRAST: stats.contrast.clear(); break;
+    case PHASE: stats.phase.clear(); break;
+    case REPETITION: stats.repetition.clear(); break;
+    case SET: stats.set.clear(); break;
+    case SEGMENT: stats.segment.clear(); break;
+    default: break;
+    }
+
+    // the readout itself, also covers the limits which are not given in the header
+    stats.kspace_encode_step_1.insert(acqhdr.idx.kspace_encode_step_1);
+    stats.kspace_encode_step_2.insert(acqhdr.idx.kspace_encode_step_2);
+    stats.slice.insert(acqhdr.idx.slice);
+    stats.phase.insert(acqhdr.idx.phase);
+    stats.contrast.insert(acqhdr.idx.contrast);
+    stats.set.insert(acqhdr.idx.set);
+    stats.segment.insert(acqhdr.idx.segment);
+    stats.average.insert(acqhdr.idx.average);
+    stats.repetition.insert(acqhdr.idx.repetition);
+  }
+
   int AcquisitionAccumulateTriggerGadget::close(unsigned long flags)
   {
     
@@ -6,6 +6,7 @@
 #include "gadgetron_mricore_export.h"
 
 #include <ismrmrd/ismrmrd.h>
+#include <ismrmrd/xml.h>
 #include <complex>
 #include <map>
 #include "mri_core_acquisition_bucket.h"
@@ -73,6 +74,21 @@ namespace Gadgetron{
       
       GADGET_PROPERTY(n_acquisitions_before_trigger, unsigned long, "Number of acquisition before first trigger", 40);
       GADGET_PROPERTY(n_acquisitions_before_ongoing_trigger, unsigned long, "Number of acquisition before ongoing triggers", 40);
+
+      /// if true, every readout is passed on at once in its own bucket, the last bucket of a trigger has end_of_trigger_ set.
+      /// The stats of the streamed buckets are the encoding limits, with the trigger dimension fixed to the current value,
+      /// so the BucketToBufferGadget can allocate the buffer on the first readout and fill it while the data arrives.
+      /// Separate and external reference readouts are still accumulated and sent with the last bucket of the trigger.
+      /// Not used together with a sorting dimension.
+      /// if true, the readouts of a bucket are copied into its data_slab_ and ref_slab_ instead of keeping one set of messages per readout,
+      /// for the BucketToBufferGadget
+      GADGET_PROPERTY(compact_buckets, bool, "Whether to keep the readouts of a bucket in contiguous storage", false);
+
+      /// if true, the reference lines acquired before the imaging data (separate calibration) are sent in their own buckets
+      /// when the first imaging line arrives, so the recon can calibrate while the imaging data is acquired
+      GADGET_PROPERTY(progressive_ref_trigger, bool, "Whether to send the reference lines as soon as the imaging data starts", false);
+
+      GADGET_PROPERTY(stream_readouts, bool, "Whether to pass on every readout at once, for the BucketToBufferGadget to fill its buffers while the data arrives", false);
       
       IsmrmrdCONDITION trigger_;
       IsmrmrdCONDITION sort_;
@@ -83,6 +99,21 @@ namespace Gadgetron{
       unsigned long n_acq_since_trigger_;
       unsigned long n_acquisitions_before_trigger_;
       unsigned long n_acquisitions_before_ongoing_trigger_;
+
+      bool compact_buckets_;
+      // number of readouts of the previous trigger, to reserve the storage of compact buckets
+      size_t compact_data_readouts_;
+      size_t compact_ref_readouts_;
+
+      bool progressive_ref_trigger_;
+
+      bool stream_readouts_;
+      // readouts were streamed since the last trigger
+      bool streamed_since_trigger_;
+      ISMRMRD::IsmrmrdHeader hdr_;
+      // encoding limits of every encoding space, as bucket stats
+      std::vector<IsmrmrdAcquisitionBucketStats> limits_stats_;
+
       virtual int process_config(ACE_Message_Block* mb);
 
       virtual int process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
@@ -90,6 +121,15 @@ namespace Gadgetron{
 
       virtual int trigger();
 
+      /// sends the buckets holding only reference lines, see progressive_ref_trigger
+      virtual int trigger_ref();
+
+      /// passes on one readout in its own bucket, see stream_readouts
+      virtual int stream(IsmrmrdAcquisitionData& d, bool is_data, bool is_ref);
+
+      /// expected stats of the trigger for a streamed readout
+      void fillStreamedStats(IsmrmrdAcquisitionBucketStats& stats, uint16_t espace, const ISMRMRD::AcquisitionHeader& acqhdr);
+
     };
 
   
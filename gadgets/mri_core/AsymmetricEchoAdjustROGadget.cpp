@@ -11,8 +11,8 @@ AsymmetricEchoAdjustROGadget::AsymmetricEchoAdjustROGadget() : maxRO_(0)
 
 int AsymmetricEchoAdjustROGadget::process_config(ACE_Message_Block* mb)
 {
-  ISMRMRD::IsmrmrdHeader h;
-  deserialize(mb->rd_ptr(),h);
+  boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+  const ISMRMRD::IsmrmrdHeader& h = *header;
 
   maxRO_.resize(h.encoding.size() );
 
@@ -3,6 +3,7 @@
 #include "mri_core_data.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDArray_reductions.h"
+#include "mri_core_ro_oversampling.h"
 namespace Gadgetron{
 
     BucketToBufferGadget::BucketToBufferGadget()
@@ -12,6 +13,10 @@ namespace Gadgetron{
   BucketToBufferGadget::~BucketToBufferGadget()
   {
     //The buckets array should be empty but just in case, let's make sure all the stuff is released.
+    for (std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* >::iterator it = recon_data_buffers_.begin(); it != recon_data_buffers_.end(); it++) {
+      if (it->second) it->second->release();
+    }
+    recon_data_buffers_.clear();
   }
 
   int BucketToBufferGadget
@@ -69,8 +74,11 @@ namespace Gadgetron{
     ignore_segment_  = ignore_segment.value();
     GDEBUG("IGNORE SEGMENT IS: %b\n", ignore_segment_);
 
-    // keep a copy of the deserialized ismrmrd xml header for runtime
-    ISMRMRD::deserialize(mb->rd_ptr(), hdr_);
+    half_precision_  = half_precision.value();
+    GDEBUG("HALF PRECISION IS: %b\n", half_precision_);
+
+    // keep a copy of the ismrmrd xml header of the stream for runtime
+    hdr_ = *this->get_ismrmrd_header(mb);
 
     return GADGET_OK;
   }
@@ -81,8 +89,7 @@ namespace Gadgetron{
 
       
       
-    size_t key;
-    std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* > recon_data_buffers;
+    std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* > & recon_data_buffers = recon_data_buffers_;
 
     //GDEBUG("BucketToBufferGadget::process\n");
 
@@ -109,49 +116,16 @@ namespace Gadgetron{
     for (std::vector<IsmrmrdAcquisitionData>::iterator it = m1->getObjectPtr()->ref_.begin();
         it != m1->getObjectPtr()->ref_.end(); ++it)
     {
-        //Get a reference to the header for this acquisition
-        ISMRMRD::AcquisitionHeader & acqhdr = *it->head_->getObjectPtr();
-
-        //Generate the key to the corresponding ReconData buffer
-        key = getKey(acqhdr.idx);
-
-        //The storage is based on the encoding space
-        uint16_t espace = acqhdr.encoding_space_ref;
-
-        //GDEBUG_STREAM("espace: " << acqhdr.encoding_space_ref << std::endl);
-        //GDEBUG_STREAM("slice: " << acqhdr.idx.slice << std::endl);
-        //GDEBUG_STREAM("rep: " << acqhdr.idx.repetition << std::endl);
-        //GDEBUG_STREAM("k1: " << acqhdr.idx.kspace_encode_step_1 << std::endl);
-        //GDEBUG_STREAM("k2: " << acqhdr.idx.kspace_encode_step_2 << std::endl);
-        //GDEBUG_STREAM("seg: " << acqhdr.idx.segment << std::endl);
-        //GDEBUG_STREAM("key: " << key << std::endl);
-
-        //Get some references to simplify the notation
-        //the reconstruction bit corresponding to this ReconDataBuffer and encoding space
-        IsmrmrdReconBit & rbit = getRBit(recon_data_buffers, key, espace);
-        //and the corresponding data buffer for the reference data
-        if (!rbit.ref_)
-            rbit.ref_ = IsmrmrdDataBuffered();
-        IsmrmrdDataBuffered & dataBuffer = *rbit.ref_;
-        //this encoding space's xml header info
-        ISMRMRD::Encoding & encoding = hdr_.encoding[espace];
-        //this bucket's reference stats
-        IsmrmrdAcquisitionBucketStats & stats = m1->getObjectPtr()->refstats_[espace];
-
-        //Fill the sampling description for this data buffer, only need to fill the sampling_ once per recon bit
-        if (&dataBuffer != pCurrDataBuffer)
-        {
-            fillSamplingDescription(dataBuffer.sampling_, encoding, stats, acqhdr, true);
-            pCurrDataBuffer = &dataBuffer;
-        }
-
-        //Make sure that the data storage for this data buffer has been allocated
-        //TODO should this check the limits, or should that be done in the stuff function?
-        allocateDataArrays(dataBuffer, acqhdr, encoding, stats, true);
+        const float* acqtraj = it->traj_ ? it->traj_->getObjectPtr()->get_data_ptr() : NULL;
+        addReadout(recon_data_buffers, *it->head_->getObjectPtr(), it->data_->getObjectPtr()->get_data_ptr(), acqtraj, m1->getObjectPtr()->refstats_, true, pCurrDataBuffer);
+    }
 
-        // Stuff the data, header and trajectory into this data buffer
-        stuff(it, dataBuffer, encoding, stats, true);
-      }
+    //and the reference readouts kept in contiguous storage
+    IsmrmrdAcquisitionSlab & ref_slab = m1->getObjectPtr()->ref_slab_;
+    for (size_t n = 0; n < ref_slab.size(); n++)
+    {
+        addReadout(recon_data_buffers, ref_slab.header(n), ref_slab.data(n), ref_slab.traj(n), m1->getObjectPtr()->refstats_, true, pCurrDataBuffer);
+    }
 
     //Iterate over the imaging data of the bucket
     // this is exactly the same code as for the reference data except for
@@ -160,56 +134,21 @@ namespace Gadgetron{
     for (std::vector<IsmrmrdAcquisitionData>::iterator it = m1->getObjectPtr()->data_.begin();
         it != m1->getObjectPtr()->data_.end(); ++it)
     {
-        //Get a reference to the header for this acquisition
-        ISMRMRD::AcquisitionHeader & acqhdr = *it->head_->getObjectPtr();
-
-        //Generate the key to the corresponding ReconData buffer
-        key = getKey(acqhdr.idx);
-
-        //The storage is based on the encoding space
-        uint16_t espace = acqhdr.encoding_space_ref;
-
-        //GDEBUG_STREAM("espace: " << acqhdr.encoding_space_ref << std::endl);
-        //GDEBUG_STREAM("slice: " << acqhdr.idx.slice << std::endl);
-        //GDEBUG_STREAM("rep: " << acqhdr.idx.repetition << std::endl);
-        //GDEBUG_STREAM("k1: " << acqhdr.idx.kspace_encode_step_1 << std::endl);
-        //GDEBUG_STREAM("k2: " << acqhdr.idx.kspace_encode_step_2 << std::endl);
-        //GDEBUG_STREAM("seg: " << acqhdr.idx.segment << std::endl);
-        //GDEBUG_STREAM("key: " << key << std::endl);
-
-        //Get some references to simplify the notation
-        //the reconstruction bit corresponding to this ReconDataBuffer and encoding space
-        IsmrmrdReconBit & rbit = getRBit(recon_data_buffers, key, espace);
-        //and the corresponding data buffer for the imaging data
-        IsmrmrdDataBuffered & dataBuffer = rbit.data_;
-        //this encoding space's xml header info
-        ISMRMRD::Encoding & encoding = hdr_.encoding[espace];
-        //this bucket's imaging data stats
-        IsmrmrdAcquisitionBucketStats & stats = m1->getObjectPtr()->datastats_[espace];
-
-
-        
-        
-        //Fill the sampling description for this data buffer, only need to fill sampling_ once per recon bit
-        if (&dataBuffer != pCurrDataBuffer)
-        {
-            fillSamplingDescription(dataBuffer.sampling_, encoding, stats, acqhdr, false);
-            pCurrDataBuffer = &dataBuffer;
-        }
-        
-        //Make sure that the data storage for this data buffer has been allocated
-        //TODO should this check the limits, or should that be done in the stuff function?
-        allocateDataArrays(dataBuffer, acqhdr, encoding, stats, false);
-
-        
-        
-        
-        // Stuff the data, header and trajectory into this data buffer
-        stuff(it, dataBuffer, encoding, stats, false);
-        
-        
+        const float* acqtraj = it->traj_ ? it->traj_->getObjectPtr()->get_data_ptr() : NULL;
+        addReadout(recon_data_buffers, *it->head_->getObjectPtr(), it->data_->getObjectPtr()->get_data_ptr(), acqtraj, m1->getObjectPtr()->datastats_, false, pCurrDataBuffer);
       }
 
+    IsmrmrdAcquisitionSlab & data_slab = m1->getObjectPtr()->data_slab_;
+    for (size_t n = 0; n < data_slab.size(); n++)
+    {
+        addReadout(recon_data_buffers, data_slab.header(n), data_slab.data(n), data_slab.traj(n), m1->getObjectPtr()->datastats_, false, pCurrDataBuffer);
+    }
+
+    //A streamed trigger continues, the readouts are in their buffers and can be released
+    if (!m1->getObjectPtr()->end_of_trigger_) {
+      m1->release();
+      return GADGET_OK;
+    }
 
     //Send all the ReconData messages
     GDEBUG("End of bucket reached, sending out %d ReconData buffers\n", recon_data_buffers.size());
@@ -225,12 +164,29 @@ namespace Gadgetron{
                 total_data += it->second->getObjectPtr()->rbit_[r].data_.data_.get_number_of_elements();
             }
 
+            if (remove_ro_oversampling.value())
+            {
+                for (size_t r=0; r<num_rbit; r++)
+                {
+                    IsmrmrdReconBit& rbit = it->second->getObjectPtr()->rbit_[r];
+                    uint16_t espace = rbit.data_.headers_.get_number_of_elements() > 0 ? rbit.data_.headers_(0).encoding_space_ref : 0;
+                    if (espace >= hdr_.encoding.size()) continue;
+
+                    this->removeROOversampling(rbit.data_, hdr_.encoding[espace]);
+                    if (rbit.ref_) this->removeROOversampling(*rbit.ref_, hdr_.encoding[espace]);
+                }
+            }
+
             if(true/*total_data>0*/)
             {
                 if (this->next()->putq(it->second) == -1) {
                     it->second->release();
+                    it->second = 0;
                     throw std::runtime_error("Failed to pass bucket down the chain\n");
                 }
+
+                // owned by the next gadget now
+                it->second = 0;
             }
         }
       }
@@ -393,9 +349,45 @@ namespace Gadgetron{
 
   }
 
+  void BucketToBufferGadget::addReadout(std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* > & recon_data_buffers, ISMRMRD::AcquisitionHeader & acqhdr,
+      const std::complex<float>* acqdata, const float* acqtraj, std::vector<IsmrmrdAcquisitionBucketStats> & bucket_stats, bool forref, IsmrmrdDataBuffered* & pCurrDataBuffer)
+  {
+        //Generate the key to the corresponding ReconData buffer
+        size_t key = getKey(acqhdr.idx);
+
+        //The storage is based on the encoding space
+        uint16_t espace = acqhdr.encoding_space_ref;
+
+        //Get some references to simplify the notation
+        //the reconstruction bit corresponding to this ReconDataBuffer and encoding space
+        IsmrmrdReconBit & rbit = getRBit(recon_data_buffers, key, espace);
+        //and the corresponding data buffer for the reference or imaging data
+        if (forref && !rbit.ref_)
+            rbit.ref_ = IsmrmrdDataBuffered();
+        IsmrmrdDataBuffered & dataBuffer = forref ? *rbit.ref_ : rbit.data_;
+        //this encoding space's xml header info
+        ISMRMRD::Encoding & encoding = hdr_.encoding[espace];
+        //this bucket's stats
+        IsmrmrdAcquisitionBucketStats & stats = bucket_stats[espace];
+
+        //Fill the sampling description for this data buffer, only need to fill the sampling_ once per recon bit
+        if (&dataBuffer != pCurrDataBuffer)
+        {
+            fillSamplingDescription(dataBuffer.sampling_, encoding, stats, acqhdr, forref);
+            pCurrDataBuffer = &dataBuffer;
+        }
+
+        //Make sure that the data storage for this data buffer has been allocated
+        //TODO should this check the limits, or should that be done in the stuff function?
+        allocateDataArrays(dataBuffer, acqhdr, encoding, stats, forref);
+
+        // Stuff the data, header and trajectory into this data buffer
+        stuff(acqhdr, acqdata, acqtraj, dataBuffer, encoding, stats, forref);
+  }
+
   void BucketToBufferGadget::allocateDataArrays(IsmrmrdDataBuffered & dataBuffer, ISMRMRD::AcquisitionHeader & acqhdr, ISMRMRD::Encoding encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref)
   {
-    if (dataBuffer.data_.get_number_of_elements() == 0)
+    if (dataBuffer.data_.get_number_of_elements() == 0 && !dataBuffer.data_half_)
       {
         //Allocate the reference data array
         //7D,  fixed order [E0, E1, E2, CHA, N, S, LOC]
@@ -571,8 +563,17 @@ namespace Gadgetron{
         GDEBUG_CONDITION_STREAM(verbose.value(), "Data dimensions [RO E1 E2 CHA N S SLC] : [" << NE0 << " " << NE1 << " " << NE2 << " " << NCHA << " " << NN << " " << NS << " " << NLOC <<"]");
 
         //Allocate the array for the data
-        dataBuffer.data_.create(NE0, NE1, NE2, NCHA, NN, NS, NLOC);
-        clear(&dataBuffer.data_); // bottleneck
+        if (half_precision_)
+          {
+            dataBuffer.data_half_ = hoNDArray<complex_half>();
+            dataBuffer.data_half_->create(NE0, NE1, NE2, NCHA, NN, NS, NLOC);
+            memset(dataBuffer.data_half_->get_data_ptr(), 0, dataBuffer.data_half_->get_number_of_bytes());
+          }
+        else
+          {
+            dataBuffer.data_.create(NE0, NE1, NE2, NCHA, NN, NS, NLOC);
+            clear(&dataBuffer.data_); // bottleneck
+          }
 
         //Allocate the array for the headers
         dataBuffer.headers_.create(NE1, NE2, NN, NS, NLOC);
@@ -595,6 +596,60 @@ namespace Gadgetron{
 
   }
 
+  void BucketToBufferGadget::removeROOversampling(IsmrmrdDataBuffered & dataBuffer, const ISMRMRD::Encoding & encoding)
+  {
+    if (encoding.trajectory.compare("cartesian") != 0) return;
+
+    float encodeFOV = encoding.encodedSpace.fieldOfView_mm.x;
+    float reconFOV = encoding.reconSpace.fieldOfView_mm.x;
+    if ( (encoding.encodedSpace.matrixSize.x == encoding.reconSpace.matrixSize.x) && (encodeFOV == reconFOV) ) return;
+
+    if (dataBuffer.headers_.get_number_of_elements() == 0) return;
+
+    // already removed upstream
+    size_t RO = dataBuffer.data_half_ ? dataBuffer.data_half_->get_size(0) : dataBuffer.data_.get_size(0);
+    if (RO == 0 || RO <= encoding.reconSpace.matrixSize.x) return;
+
+    float ratioFOV = encodeFOV / reconFOV;
+
+    bool half = (bool)dataBuffer.data_half_;
+    dataBuffer.load_data();
+
+    hoNDArray< std::complex<float> > res;
+    Gadgetron::remove_ro_oversampling_fft(dataBuffer.data_, ratioFOV, res);
+
+    if (half)
+      {
+        dataBuffer.data_half_ = hoNDArray<complex_half>();
+        Gadgetron::complex_to_half(res, *dataBuffer.data_half_);
+        dataBuffer.data_.clear();
+      }
+    else
+      {
+        dataBuffer.data_ = res;
+      }
+
+    size_t dRO = res.get_size(0);
+
+    for (size_t n = 0; n < dataBuffer.headers_.get_number_of_elements(); n++)
+      {
+        ISMRMRD::AcquisitionHeader& acqhdr = dataBuffer.headers_(n);
+        if (acqhdr.number_of_samples == 0) continue;
+
+        acqhdr.number_of_samples = (uint16_t)dRO;
+        acqhdr.center_sample = (uint16_t)(acqhdr.center_sample / ratioFOV);
+        acqhdr.discard_pre = (uint16_t)(acqhdr.discard_pre / ratioFOV);
+        acqhdr.discard_post = (uint16_t)(acqhdr.discard_post / ratioFOV);
+      }
+
+    SamplingLimit& lim = dataBuffer.sampling_.sampling_limits_[0];
+    lim.min_ = (uint16_t)(lim.min_ / ratioFOV);
+    lim.max_ = (uint16_t)(std::min((size_t)(lim.max_ / ratioFOV), dRO - 1));
+    lim.center_ = (uint16_t)(dRO / 2);
+
+    GDEBUG_CONDITION_STREAM(verbose.value(), "Readout oversampling removed, RO " << RO << " -> " << dRO);
+  }
+
   void BucketToBufferGadget::fillSamplingDescription(SamplingDescription & sampling, ISMRMRD::Encoding & encoding, IsmrmrdAcquisitionBucketStats & stats, ISMRMRD::AcquisitionHeader& acqhdr, bool forref)
   {
     // For cartesian trajectories, assume that any oversampling has been removed.
@@ -693,19 +748,24 @@ namespace Gadgetron{
 
   void BucketToBufferGadget::stuff(std::vector<IsmrmrdAcquisitionData>::iterator it, IsmrmrdDataBuffered & dataBuffer, ISMRMRD::Encoding encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref)
   {
+    const float* acqtraj = it->traj_ ? it->traj_->getObjectPtr()->get_data_ptr() : NULL;
+    stuff(*it->head_->getObjectPtr(), it->data_->getObjectPtr()->get_data_ptr(), acqtraj, dataBuffer, encoding, stats, forref);
+  }
+
+  void BucketToBufferGadget::stuff(const ISMRMRD::AcquisitionHeader & acqhdr, const std::complex<float>* acqdata, const float* acqtraj, IsmrmrdDataBuffered & dataBuffer, ISMRMRD::Encoding & encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref)
+  {
+    // acqdata is [number_of_samples, active_channels], acqtraj is [trajectory_dimensions, number_of_samples]
 
-    // The acquisition header and data
-    ISMRMRD::AcquisitionHeader & acqhdr = *it->head_->getObjectPtr();
-    hoNDArray< std::complex<float> > & acqdata = *it->data_->getObjectPtr();
-    // we make one for the trajectory down below if we need it
+    // the data is either in data_ or, in half precision, in data_half_
+    std::vector<size_t> dims = dataBuffer.data_half_ ? *dataBuffer.data_half_->get_dimensions() : *dataBuffer.data_.get_dimensions();
 
-    uint16_t NE0  = (uint16_t)dataBuffer.data_.get_size(0);
-    uint16_t NE1  = (uint16_t)dataBuffer.data_.get_size(1);
-    uint16_t NE2  = (uint16_t)dataBuffer.data_.get_size(2);
-    uint16_t NCHA = (uint16_t)dataBuffer.data_.get_size(3);
-    uint16_t NN   = (uint16_t)dataBuffer.data_.get_size(4);
-    uint16_t NS   = (uint16_t)dataBuffer.data_.get_size(5);
-    uint16_t NLOC = (uint16_t)dataBuffer.data_.get_size(6);
+    uint16_t NE0  = (uint16_t)dims[0];
+    uint16_t NE1  = (uint16_t)dims[1];
+    uint16_t NE2  = (uint16_t)dims[2];
+    uint16_t NCHA = (uint16_t)dims[3];
+    uint16_t NN   = (uint16_t)dims[4];
+    uint16_t NS   = (uint16_t)dims[5];
+    uint16_t NLOC = (uint16_t)dims[6];
 
     size_t slice_loc;
     if (split_slices_ || NLOC==1)
@@ -721,7 +781,7 @@ namespace Gadgetron{
     uint16_t npts_to_copy = acqhdr.number_of_samples - acqhdr.discard_pre - acqhdr.discard_post;
     long long offset;
     if (encoding.trajectory.compare("cartesian") == 0 || encoding.trajectory.compare("epi") == 0) {
-        if ((acqhdr.number_of_samples == dataBuffer.data_.get_size(0)) && (acqhdr.center_sample == acqhdr.number_of_samples/2)) // acq has been corrected for center , e.g. by asymmetric handling
+        if ((acqhdr.number_of_samples == NE0) && (acqhdr.center_sample == acqhdr.number_of_samples/2)) // acq has been corrected for center , e.g. by asymmetric handling
         {
             offset = acqhdr.discard_pre;
         }
@@ -734,7 +794,7 @@ namespace Gadgetron{
         //TODO any other sort of trajectory?
         offset = 0;
     }
-    long long roffset = (long long) dataBuffer.data_.get_size(0) - npts_to_copy - offset;
+    long long roffset = (long long) NE0 - npts_to_copy - offset;
 
     //GDEBUG_STREAM("Num_samp: "<< acqhdr.number_of_samples << ", pre: " << acqhdr.discard_pre << ", post" << acqhdr.discard_post << std::endl);
     //std::cout << "Sampling limits: "
@@ -822,27 +882,35 @@ namespace Gadgetron{
         }
     }
 
-    std::complex<float>* pData = &dataBuffer.data_(offset, e1, e2, 0, NUsed, SUsed, slice_loc);
+    if (dataBuffer.data_half_)
+    {
+        complex_half* pHalf = &(*dataBuffer.data_half_)(offset, e1, e2, 0, NUsed, SUsed, slice_loc);
 
-    
-    for (uint16_t cha = 0; cha < NCHA; cha++)
+        for (uint16_t cha = 0; cha < NCHA; cha++)
+        {
+            hoNDArrayHalf::to_half(npts_to_copy, acqdata + acqhdr.discard_pre + (size_t)cha*acqhdr.number_of_samples, pHalf + (size_t)cha*NE0*NE1*NE2);
+        }
+    }
+    else
     {
-        dataptr = pData + cha*NE0*NE1*NE2;
-        memcpy(dataptr, &acqdata(acqhdr.discard_pre, cha), sizeof(std::complex<float>)*npts_to_copy);
+        std::complex<float>* pData = &dataBuffer.data_(offset, e1, e2, 0, NUsed, SUsed, slice_loc);
+
+        for (uint16_t cha = 0; cha < NCHA; cha++)
+        {
+            dataptr = pData + cha*NE0*NE1*NE2;
+            memcpy(dataptr, acqdata + acqhdr.discard_pre + (size_t)cha*acqhdr.number_of_samples, sizeof(std::complex<float>)*npts_to_copy);
+        }
     }
 
     dataBuffer.headers_(e1, e2, NUsed, SUsed, slice_loc) = acqhdr;
 
-    if (acqhdr.trajectory_dimensions > 0)
+    if ((acqhdr.trajectory_dimensions > 0) && acqtraj)
     {
-
-        hoNDArray< float > & acqtraj = *it->traj_->getObjectPtr();  // TODO do we need to check this?
-
         float * trajptr;
 
         trajptr = &(*dataBuffer.trajectory_)(0, offset, e1, e2, NUsed, SUsed, slice_loc);
 
-        memcpy(trajptr, &acqtraj(0, acqhdr.discard_pre), sizeof(float)*npts_to_copy*acqhdr.trajectory_dimensions);
+        memcpy(trajptr, acqtraj + (size_t)acqhdr.discard_pre*acqhdr.trajectory_dimensions, sizeof(float)*npts_to_copy*acqhdr.trajectory_dimensions);
 
     }
   }
@@ -20,6 +20,8 @@ namespace Gadgetron{
     // This gadget fills the IsmrmrdReconData structures with kspace readouts and sets up the sampling limits
     // For the cartesian sampling, the filled kspace ensures its center (N/2) is aligned with the specified center in the encoding limits
     // For the non-cartesian sampling, this "center alignment" constraint is not applied and kspace lines are filled as their E1 and E2 indexes
+    // For the buckets streamed by the AcquisitionAccumulateTriggerGadget, the buffers are allocated on the first readout and filled
+    // as the readouts arrive, they are sent out with the last bucket of the trigger
 
   class EXPORTGADGETSMRICORE BucketToBufferGadget : 
   public Gadget1<IsmrmrdAcquisitionBucket>
@@ -58,12 +60,18 @@ namespace Gadgetron{
       GADGET_PROPERTY(split_slices, bool, "Split slices", false);
       GADGET_PROPERTY(ignore_segment, bool, "Ignore segment", false);
       GADGET_PROPERTY(verbose, bool, "Whether to print more information", false);
+      GADGET_PROPERTY(half_precision, bool, "Keep the buffered data in half precision, it is converted to float when a gadget receives it", false);
+      GADGET_PROPERTY(remove_ro_oversampling, bool, "Remove the readout oversampling of cartesian buffers at once, for readouts passed on oversampled", false);
 
       IsmrmrdCONDITION N_;
       IsmrmrdCONDITION S_;
       bool split_slices_;
       bool ignore_segment_;
+      bool half_precision_;
       ISMRMRD::IsmrmrdHeader hdr_;
+
+      // buffers being filled, kept across the buckets of a streamed trigger
+      std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* > recon_data_buffers_;
       
       virtual int process_config(ACE_Message_Block* mb);
       virtual int process(GadgetContainerMessage<IsmrmrdAcquisitionBucket>* m1);
@@ -76,6 +84,15 @@ namespace Gadgetron{
       virtual void allocateDataArrays(IsmrmrdDataBuffered &  dataBuffer, ISMRMRD::AcquisitionHeader & acqhdr, ISMRMRD::Encoding encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref);
       virtual void fillSamplingDescription(SamplingDescription & sampling, ISMRMRD::Encoding & encoding, IsmrmrdAcquisitionBucketStats & stats, ISMRMRD::AcquisitionHeader & acqhdr, bool forref);
       virtual void stuff(std::vector<IsmrmrdAcquisitionData>::iterator it, IsmrmrdDataBuffered & dataBuffer, ISMRMRD::Encoding encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref);
+      /// acqdata is [number_of_samples, active_channels], acqtraj is [trajectory_dimensions, number_of_samples] or NULL
+      virtual void stuff(const ISMRMRD::AcquisitionHeader & acqhdr, const std::complex<float>* acqdata, const float* acqtraj, IsmrmrdDataBuffered & dataBuffer, ISMRMRD::Encoding & encoding, IsmrmrdAcquisitionBucketStats & stats, bool forref);
+
+      /// removes the readout oversampling of a cartesian buffer with one batched fft along RO, and updates its headers and sampling limits
+      virtual void removeROOversampling(IsmrmrdDataBuffered & dataBuffer, const ISMRMRD::Encoding & encoding);
+
+      /// finds the buffer of a readout of the bucket, allocates it if needed and stuffs the readout
+      void addReadout(std::map<size_t, GadgetContainerMessage<IsmrmrdReconData>* > & recon_data_buffers, ISMRMRD::AcquisitionHeader & acqhdr,
+          const std::complex<float>* acqdata, const float* acqtraj, std::vector<IsmrmrdAcquisitionBucketStats> & bucket_stats, bool forref, IsmrmrdDataBuffered* & pCurrDataBuffer);
     };
 }
 #endif //BUCKETTOBUFFER_H
@@ -20,8 +20,8 @@ namespace Gadgetron{
 
     int CoilReductionGadget::process_config(ACE_Message_Block *mb)
     {
-      ISMRMRD::IsmrmrdHeader h;
-      ISMRMRD::deserialize(mb->rd_ptr(),h);
+      boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+      const ISMRMRD::IsmrmrdHeader& h = *header;
       
       coils_in_ = h.acquisitionSystemInformation->receiverChannels ? *h.acquisitionSystemInformation->receiverChannels : 128;
 
@@ -71,6 +71,42 @@ namespace Gadgetron{
 
     int CoilReductionGadget::process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader> *m1, GadgetContainerMessage<hoNDArray<std::complex<float> > > *m2)
     {
+        if (in_place.value())
+        {
+            hoNDArray< std::complex<float> >& data = *m2->getObjectPtr();
+            size_t samples = m1->getObjectPtr()->number_of_samples;
+            size_t CHA = m1->getObjectPtr()->active_channels;
+
+            if (CHA > coil_mask_.size()) {
+                GDEBUG("Fatal error, too many coils for coil mask\n");
+                return GADGET_FAIL;
+            }
+
+            // kept coils only move towards the front, so the blocks never overlap
+            std::complex<float>* d = data.get_data_ptr();
+            size_t coils_kept = 0;
+            for (size_t c = 0; c < CHA; c++) {
+                if (coil_mask_[c]) {
+                    if (coils_kept < c) memcpy(d + coils_kept*samples, d + c*samples, sizeof(std::complex<float>)*samples);
+                    coils_kept++;
+                }
+            }
+
+            std::vector<size_t> dims_out(2);
+            dims_out[0] = samples;
+            dims_out[1] = coils_kept;
+            data.shrink(dims_out);
+
+            m1->getObjectPtr()->active_channels = (uint16_t)coils_kept;
+
+            if( this->next()->putq(m1) < 0 ){
+                GDEBUG("Failed to put message on queue\n");
+                return GADGET_FAIL;
+            }
+
+            return GADGET_OK;
+        }
+
         std::vector<size_t> dims_out(2);
         dims_out[0] = m1->getObjectPtr()->number_of_samples;
         dims_out[1] = coils_out_;
@@ -89,7 +125,7 @@ namespace Gadgetron{
         size_t samples =  m1->getObjectPtr()->number_of_samples;
         size_t coils_copied = 0;
         for (int c = 0; c < m1->getObjectPtr()->active_channels; c++) {
-            if (c > coil_mask_.size()) {
+            if (c >= coil_mask_.size()) {
                 GDEBUG("Fatal error, too many coils for coil mask\n");
                 m3->release();
                 return GADGET_FAIL;
@@ -27,6 +27,7 @@ class EXPORTGADGETSMRICORE CoilReductionGadget :
       GADGET_PROPERTY(coil_mask, std::string, "String mask of zeros and ones, e.g. 000111000 indicating which coils to keep", "");
       GADGET_PROPERTY_LIMITS(coils_out, int, "Number of coils to keep, coils with higher indices will be discarded", 128,
 			     GadgetPropertyLimitsRange, 1, 1024);
+      GADGET_PROPERTY(in_place, bool, "Move the kept coils to the front of the incoming readout instead of copying them to a new array", false);
       std::vector<unsigned short> coil_mask_;
       unsigned int coils_in_;
       unsigned int coils_out_;      
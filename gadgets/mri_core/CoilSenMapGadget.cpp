@@ -58,8 +58,8 @@ namespace Gadgetron {
 
         GDEBUG( "Folder to store coil map dependencies is %s\n", coil_sen_dependency_folder_.c_str() );
 
-        // deserialize the ismrmrd header
-        ISMRMRD::deserialize(mb->rd_ptr(), current_ismrmrd_header_);
+        // the ismrmrd header of the stream
+        current_ismrmrd_header_ = *this->get_ismrmrd_header(mb);
 
         if (current_ismrmrd_header_.measurementInformation)
         {
@@ -1,5 +1,6 @@
 #include "GadgetIsmrmrdReadWrite.h"
 #include "DependencyQueryGadget.h"
+#include "mri_core_dependencies.h"
 
 #include <boost/version.hpp>
 #include <boost/filesystem.hpp>
@@ -113,16 +114,19 @@ namespace Gadgetron
 
                                 if ( std::abs( (double)lastWriteTime - (double)curr_time_UTC_ ) > time_limit_in_storage_*3600.0 )
                                 {
-                                    remove(*it);
+                                    // also drops the file from memory
+                                    DependencyStore::instance()->remove(filename);
                                 }
                             }
+                        }
 
-                            // update the file list
-                            v.clear();
-                            copy(directory_iterator(p), directory_iterator(), back_inserter(v));
-                            sort(v.begin(), v.end());
+                        // the listing is answered from memory and includes the files still being written
+                        std::vector<std::string> names;
+                        DependencyStore::instance()->list(noise_dependency_folder_, names);
 
-                            GDEBUG_STREAM( "A total of " << v.size() << " dependency measurements are found after cleaning ... ");
+                        if ( clean_storage_while_query_ )
+                        {
+                            GDEBUG_STREAM( "A total of " << names.size() << " dependency measurements are found after cleaning ... ");
                         }
 
                         // declear the attributes
@@ -131,13 +135,9 @@ namespace Gadgetron
                         size_t count = 0;
                         size_t ind;
 
-                        for (vec::const_iterator it (v.begin()); it != v.end(); ++it)
+                        for (std::vector<std::string>::const_iterator it (names.begin()); it != names.end(); ++it)
                         {
-#                       if BOOST_VERSION < 104600
-                            filename = it->filename();
-#                       else
-                            filename = it->filename().string();
-#                       endif
+                            filename = *it;
                             ind = filename.find(noise_dependency_prefix_);
 
                             if ( ind != std::string::npos )
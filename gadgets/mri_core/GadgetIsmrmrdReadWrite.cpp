@@ -3,4 +3,7 @@
 namespace Gadgetron{
     GADGETRON_READER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionMessageReader)
     GADGETRON_WRITER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionMessageWriter)
+    GADGETRON_READER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionBatchMessageReader)
+    GADGETRON_WRITER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionBatchMessageWriter)
+    GADGETRON_READER_FACTORY_DECLARE(GadgetIsmrmrdAcquisitionSharedMemoryMessageReader)
 }
@@ -2,6 +2,7 @@
 #define GADGETISMRMRDREADWRITE_H
 
 #include "GadgetMRIHeaders.h"
+#include "GadgetSharedMemoryRing.h"
 #include "GadgetContainerMessage.h"
 #include "GadgetMessageInterface.h"
 #include "hoNDArray.h"
@@ -11,6 +12,10 @@
 #include <ace/SOCK_Stream.h>
 #include <ace/Task.h>
 #include <complex>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cstring>
 
 #include "NHLBICompression.h"
 
@@ -75,6 +80,10 @@ namespace Gadgetron{
 
     /**
     Default implementation of GadgetMessageReader for IsmrmrdAcquisition messages
+
+    The container messages are taken from the pooled message allocator and the trajectory and sample
+    buffers from the hoNDArray memory pool, so steady state ingest reuses the blocks released by
+    downstream gadgets instead of allocating new ones for every readout.
     */
     class EXPORTGADGETSMRICORE GadgetIsmrmrdAcquisitionMessageReader : public GadgetMessageReader
     {
@@ -86,10 +95,17 @@ namespace Gadgetron{
         {
 
             GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1 =
-                new GadgetContainerMessage<ISMRMRD::AcquisitionHeader>();
+                make_pooled_container_message<ISMRMRD::AcquisitionHeader>();
 
             GadgetContainerMessage<hoNDArray< std::complex<float> > >* m2 =
-                new GadgetContainerMessage< hoNDArray< std::complex<float> > >();
+                make_pooled_container_message< hoNDArray< std::complex<float> > >();
+
+            if (!m1 || !m2) {
+                GERROR("GadgetIsmrmrdAcquisitionMessageReader, failed to allocate acquisition message\n");
+                if (m1) m1->release();
+                if (m2) m2->release();
+                return 0;
+            }
 
             m1->cont(m2);
 
@@ -97,12 +113,24 @@ namespace Gadgetron{
 
             if ((recv_count = stream->recv_n(m1->getObjectPtr(), sizeof(ISMRMRD::AcquisitionHeader))) <= 0) {
 	      GERROR("GadgetIsmrmrdAcquisitionMessageReader, failed to read ISMRMRDACQ Header\n");
+	      m1->release();
 	      return 0;
             }
 
+            //The header determines the size of everything that follows. Trajectory and data (or the size
+            //of the compressed data) are then received with a single scatter read into the final arrays.
+            iovec iov[2];
+            int iovcnt = 0;
+
             if (m1->getObjectPtr()->trajectory_dimensions) {
                 GadgetContainerMessage<hoNDArray< float > >* m3 =
-                    new GadgetContainerMessage< hoNDArray< float > >();
+                    make_pooled_container_message< hoNDArray< float > >();
+
+                if (!m3) {
+                    GERROR("GadgetIsmrmrdAcquisitionMessageReader, failed to allocate trajectory message\n");
+                    m1->release();
+                    return 0;
+                }
 
                 m2->cont(m3);
 
@@ -110,7 +138,7 @@ namespace Gadgetron{
                 tdims.push_back(m1->getObjectPtr()->trajectory_dimensions);
                 tdims.push_back(m1->getObjectPtr()->number_of_samples);
 
-                try { m3->getObjectPtr()->create(&tdims);}
+                try { create_pooled(*m3->getObjectPtr(), tdims); }
                 catch (std::runtime_error &err){
                     GEXCEPTION(err,"(%P|%t) Allocate trajectory data\n");
                     m1->release();
@@ -118,23 +146,16 @@ namespace Gadgetron{
                     return 0;
                 }
 
-                if ((recv_count =
-		     stream->recv_n
-		     (m3->getObjectPtr()->get_data_ptr(),
-		     sizeof(float)*tdims[0]*tdims[1])) <= 0) {
-		  
-		        GERROR("Unable to read trajectory data\n");
-		        m1->release();
-                        return 0;
-                }
-
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(m3->getObjectPtr()->get_data_ptr());
+                iov[iovcnt].iov_len = sizeof(float)*tdims[0]*tdims[1];
+                iovcnt++;
             }
 
             std::vector<size_t> adims;
             adims.push_back(m1->getObjectPtr()->number_of_samples);
             adims.push_back(m1->getObjectPtr()->active_channels);
 
-            try{ m2->getObjectPtr()->create(&adims); }
+            try{ create_pooled(*m2->getObjectPtr(), adims); }
             catch (std::runtime_error &err ){
                 GEXCEPTION(err,"(%P|%t) Allocate sample data\n")
                     m1->release();
@@ -142,25 +163,48 @@ namespace Gadgetron{
                 return 0;
             }
 
+            bool compressed =
+                m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1) ||
+                m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2);
+
+            uint32_t comp_size = 0;
+            if (compressed) {
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(&comp_size);
+                iov[iovcnt].iov_len = sizeof(uint32_t);
+            } else {
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(m2->getObjectPtr()->get_data_ptr());
+                iov[iovcnt].iov_len = sizeof(std::complex<float>)*adims[0]*adims[1];
+            }
+            iovcnt++;
 
-            if (m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1)) { //Is this ZFP compressed data
+            if ((recv_count = stream->recvv_n(iov, iovcnt)) <= 0) {
+                GERROR("Unable to read Acq data\n");
+                m1->release();
+                return 0;
+            }
 
-#if defined GADGETRON_COMPRESSION_ZFP
-                
-                uint32_t comp_size = 0;
-                if ((recv_count = stream->recv_n(&comp_size, sizeof(uint32_t))) <= 0) {
-	            GERROR("Unable to read size of compressed data\n");
-                    m1->release();
-                    return 0;
-                }
+            if (!compressed) {
+                return m1;
+            }
 
-                char* comp_buffer = new char[comp_size];
-                if ((recv_count = stream->recv_n(comp_buffer, comp_size)) <= 0) {
-	            GERROR("Unable to read compressed data\n");
-                    m1->release();
-                    return 0;
-                }
+            //Compressed payload, received into a pooled scratch buffer and decompressed into the array.
+            //The padding allows the decoders to read whole words at the end of the buffer.
+            PooledBuffer comp_buffer(comp_size + sizeof(uint64_t));
+            if (!comp_buffer.ptr) {
+                GERROR("Unable to allocate buffer for compressed data\n");
+                m1->release();
+                return 0;
+            }
+
+            if ((recv_count = stream->recv_n(comp_buffer.ptr, comp_size)) <= 0) {
+                GERROR("Unable to read compressed data\n");
+                m1->release();
+                return 0;
+            }
 
+            if (m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1)) { //Is this ZFP compressed data
+
+#if defined GADGETRON_COMPRESSION_ZFP
 
                 zfp_type type = zfp_type_float;
                 zfp_field* field = NULL;
@@ -171,13 +215,12 @@ namespace Gadgetron{
                 zfp = zfp_stream_open(NULL);
                 field = zfp_field_alloc();
                 
-                cstream = stream_open(comp_buffer, comp_size);
+                cstream = stream_open(comp_buffer.ptr, comp_size);
                 if (!cstream) {
                     GERROR("Unable to open compressed stream\n");
                     zfp_field_free(field);
                     zfp_stream_close(zfp);
                     stream_close(cstream);            
-                    delete [] comp_buffer;
                     m1->release();
                     return 0;
                 }
@@ -189,7 +232,6 @@ namespace Gadgetron{
                     zfp_field_free(field);
                     zfp_stream_close(zfp);
                     stream_close(cstream);            
-                    delete [] comp_buffer;
                     m1->release();
                     return 0;
                 }
@@ -204,7 +246,6 @@ namespace Gadgetron{
                     zfp_field_free(field);
                     zfp_stream_close(zfp);
                     stream_close(cstream);            
-                    delete [] comp_buffer;
                     m1->release();
                     return 0;                
                 }
@@ -215,7 +256,6 @@ namespace Gadgetron{
                     zfp_field_free(field);
                     zfp_stream_close(zfp);
                     stream_close(cstream);            
-                    delete [] comp_buffer;
                     m1->release();
                     return 0;                
                 }
@@ -223,7 +263,6 @@ namespace Gadgetron{
                 zfp_field_free(field);
                 zfp_stream_close(zfp);
                 stream_close(cstream);            
-                delete [] comp_buffer;
 
                 //At this point the data is no longer compressed and we should clear the flag
                 m1->getObjectPtr()->clearFlag(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1);
@@ -237,55 +276,418 @@ namespace Gadgetron{
 
 #endif //GADGETRON_COMPRESSION_ZFP
 
-            } else if (m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2)) {
-                //NHLBI Compression
-                uint32_t comp_size = 0;
-                if ((recv_count = stream->recv_n(&comp_size, sizeof(uint32_t))) <= 0) {
-	            GERROR("Unable to read size of compressed data\n");
+            } else {
+                //NHLBI Compression, decoded sample by sample straight into the uncompressed array
+                size_t elements = m2->getObjectPtr()->get_number_of_elements()*2; //*2 for complex
+                try {
+                    CompressedBuffer<float>::decompress(reinterpret_cast<uint8_t*>(comp_buffer.ptr), comp_size,
+                                                        reinterpret_cast<float*>(m2->getObjectPtr()->get_data_ptr()), elements);
+                }
+                catch (std::runtime_error &err) {
+                    GEXCEPTION(err, "Unable to decompress NHLBI compressed data\n");
                     m1->release();
                     return 0;
                 }
 
-                std::vector<uint8_t> comp_buffer(comp_size,0);
-                if ((recv_count = stream->recv_n(&comp_buffer[0], comp_size)) <= 0) {
-	            GERROR("Unable to read compressed data\n");
-                    m1->release();
+                //At this point the data is no longer compressed and we should clear the flag
+                m1->getObjectPtr()->clearFlag(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2);
+            }
+                
+            return m1;
+        }
+
+    protected:
+
+        /**
+        Creates the array with memory from the hoNDArray memory pool, the array owns the memory
+        and returns it to the pool when released.
+        */
+        template <typename T> static void create_pooled(hoNDArray<T>& a, std::vector<size_t>& dims)
+        {
+            size_t N = 1;
+            for (size_t d = 0; d < dims.size(); d++) N *= dims[d];
+
+            if (N == 0) {
+                a.create(&dims);
+                return;
+            }
+
+            T* data = hoNDArrayMemoryPool::instance().allocate<T>(N);
+            if (!data) {
+                throw std::runtime_error("GadgetIsmrmrdAcquisitionMessageReader, hoNDArrayMemoryPool allocation failed");
+            }
+
+            a.create(&dims, data, true);
+        }
+
+        /**
+        Scratch buffer from the hoNDArray memory pool, released when it goes out of scope
+        */
+        struct PooledBuffer
+        {
+            PooledBuffer(size_t n) : ptr(reinterpret_cast<char*>(hoNDArrayMemoryPool::instance().allocate_bytes(n))) {}
+            ~PooledBuffer()
+            {
+                if (ptr && !hoNDArrayMemoryPool::instance().deallocate(ptr)) free(ptr);
+            }
+            char* ptr;
+        private:
+            PooledBuffer(const PooledBuffer&);
+            PooledBuffer& operator=(const PooledBuffer&);
+        };
+
+    };    
+
+    /**
+    Batched acquisitions, GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH
+
+    Wire format after the message identifier:
+        uint32_t                          number of acquisitions N
+        ISMRMRD::AcquisitionHeader[N]     all headers
+        N x (trajectory, data)            payload of every acquisition in header order
+
+    Compressed acquisitions are not supported in a batch, they are sent as individual messages.
+    */
+    struct GadgetIsmrmrdAcquisitionBatch
+    {
+        enum
+        {
+            MAX_ACQUISITIONS = 65536,
+            MAX_IOVECS_PER_CALL = 512   //Stays below IOV_MAX on all supported platforms
+        };
+
+        /// Scatter/gather transfer of an arbitrary number of buffers, split into calls of at most MAX_IOVECS_PER_CALL
+        template <class F> static bool transfer(std::vector<iovec>& iov, F f)
+        {
+            for (size_t start = 0; start < iov.size(); start += MAX_IOVECS_PER_CALL) {
+                int n = static_cast<int>(std::min<size_t>(MAX_IOVECS_PER_CALL, iov.size() - start));
+                if (f(&iov[start], n) <= 0) return false;
+            }
+            return true;
+        }
+
+        static void add_buffer(std::vector<iovec>& iov, void* ptr, size_t len)
+        {
+            if (!len) return;
+            iovec v;
+            v.iov_base = reinterpret_cast<char*>(ptr);
+            v.iov_len = len;
+            iov.push_back(v);
+        }
+
+        /// Releases a list of messages linked with next()
+        static void release_list(ACE_Message_Block* mb)
+        {
+            while (mb) {
+                ACE_Message_Block* n = mb->next();
+                mb->next(0);
+                mb->release();
+                mb = n;
+            }
+        }
+    };
+
+    /**
+    Writes acquisitions as one GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH message.
+    The acquisitions are taken from a list of messages linked with next(), a single
+    acquisition message is sent as a batch of one.
+    */
+    class EXPORTGADGETSMRICORE GadgetIsmrmrdAcquisitionBatchMessageWriter : public GadgetMessageWriter
+    {
+
+    public:
+        virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
+        {
+            std::vector<ISMRMRD::AcquisitionHeader*> headers;
+            std::vector<iovec> payload;
+
+            for (ACE_Message_Block* it = mb; it; it = it->next()) {
+                auto h = AsContainerMessage<ISMRMRD::AcquisitionHeader>(it);
+                if (!h) {
+                    GERROR("GadgetIsmrmrdAcquisitionBatchMessageWriter, invalid acquisition message objects\n");
+                    return -1;
+                }
+
+                ISMRMRD::AcquisitionHeader* acqHead = h->getObjectPtr();
+                if (acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1) || acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2)) {
+                    GERROR("GadgetIsmrmrdAcquisitionBatchMessageWriter, compressed acquisitions cannot be batched\n");
+                    return -1;
+                }
+                headers.push_back(acqHead);
+
+                size_t trajectory_elements = acqHead->trajectory_dimensions*acqHead->number_of_samples;
+                size_t data_elements = acqHead->active_channels*acqHead->number_of_samples;
+
+                auto d = AsContainerMessage< hoNDArray<std::complex<float> > >(h->cont());
+                if (trajectory_elements) {
+                    auto t = AsContainerMessage< hoNDArray<float> >(d ? d->cont() : 0);
+                    if (!t) {
+                        GERROR("GadgetIsmrmrdAcquisitionBatchMessageWriter, missing trajectory\n");
+                        return -1;
+                    }
+                    GadgetIsmrmrdAcquisitionBatch::add_buffer(payload, t->getObjectPtr()->get_data_ptr(), sizeof(float)*trajectory_elements);
+                }
+                if (data_elements) {
+                    if (!d) {
+                        GERROR("GadgetIsmrmrdAcquisitionBatchMessageWriter, missing data\n");
+                        return -1;
+                    }
+                    GadgetIsmrmrdAcquisitionBatch::add_buffer(payload, d->getObjectPtr()->get_data_ptr(), 2*sizeof(float)*data_elements);
+                }
+            }
+
+            GadgetMessageIdentifier id;
+            id.id = GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH;
+            uint32_t count = static_cast<uint32_t>(headers.size());
+
+            std::vector<iovec> frame;
+            GadgetIsmrmrdAcquisitionBatch::add_buffer(frame, &id, sizeof(GadgetMessageIdentifier));
+            GadgetIsmrmrdAcquisitionBatch::add_buffer(frame, &count, sizeof(uint32_t));
+            for (size_t i = 0; i < headers.size(); i++) {
+                GadgetIsmrmrdAcquisitionBatch::add_buffer(frame, headers[i], sizeof(ISMRMRD::AcquisitionHeader));
+            }
+            frame.insert(frame.end(), payload.begin(), payload.end());
+
+            if (!GadgetIsmrmrdAcquisitionBatch::transfer(frame, [sock](iovec* iov, int n) { return sock->sendv_n(iov, n); })) {
+                GERROR("Unable to send acquisition batch\n");
+                return -1;
+            }
+
+            return 0;
+        }
+    };
+
+    /**
+    Reads a GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH message and expands it into the usual
+    acquisition messages (header, data and optional trajectory). The headers are received with
+    one read, the payload of all acquisitions with scatter reads straight into the pooled arrays.
+    The acquisitions are returned as a list linked with next(), the stream controller puts them
+    on the stream one by one.
+    */
+    class EXPORTGADGETSMRICORE GadgetIsmrmrdAcquisitionBatchMessageReader : public GadgetIsmrmrdAcquisitionMessageReader
+    {
+
+    public:
+        GADGETRON_READER_DECLARE(GadgetIsmrmrdAcquisitionBatchMessageReader);
+
+        virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream)
+        {
+            uint32_t count = 0;
+            if (stream->recv_n(&count, sizeof(uint32_t)) <= 0) {
+                GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to read number of acquisitions\n");
+                return 0;
+            }
+
+            if (count == 0 || count > GadgetIsmrmrdAcquisitionBatch::MAX_ACQUISITIONS) {
+                GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, invalid number of acquisitions in batch: %d\n", count);
+                return 0;
+            }
+
+            //Create all header messages, the headers are received with a single scatter read
+            ACE_Message_Block* first = 0;
+            ACE_Message_Block* last = 0;
+            std::vector< GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* > heads(count, 0);
+            std::vector<iovec> iov;
+            iov.reserve(count);
+
+            for (uint32_t i = 0; i < count; i++) {
+                heads[i] = make_pooled_container_message<ISMRMRD::AcquisitionHeader>();
+                if (!heads[i]) {
+                    GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to allocate acquisition message\n");
+                    GadgetIsmrmrdAcquisitionBatch::release_list(first);
                     return 0;
                 }
+                if (last) last->next(heads[i]); else first = heads[i];
+                last = heads[i];
 
-                CompressedBuffer<float> comp;
-                comp.deserialize(comp_buffer);
+                GadgetIsmrmrdAcquisitionBatch::add_buffer(iov, heads[i]->getObjectPtr(), sizeof(ISMRMRD::AcquisitionHeader));
+            }
 
-                if (comp.size() != m2->getObjectPtr()->get_number_of_elements()*2) { //*2 for complex
-	            GERROR("Mismatch between uncompressed data samples (%d) and expected number of samples (%d)\n", comp.size(), m2->getObjectPtr()->get_number_of_elements()*2);
-                    m1->release();
+            if (!GadgetIsmrmrdAcquisitionBatch::transfer(iov, [stream](iovec* v, int n) { return stream->recvv_n(v, n); })) {
+                GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to read acquisition headers\n");
+                GadgetIsmrmrdAcquisitionBatch::release_list(first);
+                return 0;
+            }
+
+            //Allocate the arrays and receive the payload of all acquisitions
+            iov.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                ISMRMRD::AcquisitionHeader* acqHead = heads[i]->getObjectPtr();
+
+                if (acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1) || acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2)) {
+                    GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, compressed acquisitions cannot be batched\n");
+                    GadgetIsmrmrdAcquisitionBatch::release_list(first);
                     return 0;
                 }
 
-                float* d_ptr = (float*)m2->getObjectPtr()->get_data_ptr();
-                for (size_t i = 0; i < comp.size(); i++) {
-                    d_ptr[i] = comp[i]; //This uncompresses sample by sample into the uncompressed array
+                GadgetContainerMessage<hoNDArray< std::complex<float> > >* m2 =
+                    make_pooled_container_message< hoNDArray< std::complex<float> > >();
+                if (!m2) {
+                    GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to allocate data message\n");
+                    GadgetIsmrmrdAcquisitionBatch::release_list(first);
+                    return 0;
+                }
+                heads[i]->cont(m2);
+
+                GadgetContainerMessage<hoNDArray< float > >* m3 = 0;
+                if (acqHead->trajectory_dimensions) {
+                    m3 = make_pooled_container_message< hoNDArray< float > >();
+                    if (!m3) {
+                        GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to allocate trajectory message\n");
+                        GadgetIsmrmrdAcquisitionBatch::release_list(first);
+                        return 0;
+                    }
+                    m2->cont(m3);
                 }
 
-                //At this point the data is no longer compressed and we should clear the flag
-                m1->getObjectPtr()->clearFlag(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2);
+                std::vector<size_t> adims;
+                adims.push_back(acqHead->number_of_samples);
+                adims.push_back(acqHead->active_channels);
+
+                try {
+                    create_pooled(*m2->getObjectPtr(), adims);
+                    if (m3) {
+                        std::vector<size_t> tdims;
+                        tdims.push_back(acqHead->trajectory_dimensions);
+                        tdims.push_back(acqHead->number_of_samples);
+                        create_pooled(*m3->getObjectPtr(), tdims);
+                    }
+                }
+                catch (std::runtime_error &err){
+                    GEXCEPTION(err,"GadgetIsmrmrdAcquisitionBatchMessageReader, failed to allocate acquisition arrays\n");
+                    GadgetIsmrmrdAcquisitionBatch::release_list(first);
+                    return 0;
+                }
+
+                if (m3) {
+                    GadgetIsmrmrdAcquisitionBatch::add_buffer(iov, m3->getObjectPtr()->get_data_ptr(),
+                        sizeof(float)*m3->getObjectPtr()->get_number_of_elements());
+                }
+                GadgetIsmrmrdAcquisitionBatch::add_buffer(iov, m2->getObjectPtr()->get_data_ptr(),
+                    sizeof(std::complex<float>)*m2->getObjectPtr()->get_number_of_elements());
+            }
+
+            if (!GadgetIsmrmrdAcquisitionBatch::transfer(iov, [stream](iovec* v, int n) { return stream->recvv_n(v, n); })) {
+                GERROR("GadgetIsmrmrdAcquisitionBatchMessageReader, failed to read acquisition data\n");
+                GadgetIsmrmrdAcquisitionBatch::release_list(first);
+                return 0;
+            }
+
+            return first;
+        }
+    };
+
+    /**
+    Reads a GADGET_MESSAGE_ISMRMRD_ACQUISITION_SHM message of a local connection.
+
+    Wire format after the message identifier:
+        ISMRMRD::AcquisitionHeader        header
+        GadgetSharedMemoryRecord           position and size of the payload in the shared memory ring
+
+    The payload in the ring has the same layout as on the socket (trajectory, then data). It is
+    copied into pooled arrays and the ring space is released right away, so the lifetime of the
+    arrays in the stream is independent of the ring. Compressed acquisitions are not supported.
+    */
+    class EXPORTGADGETSMRICORE GadgetIsmrmrdAcquisitionSharedMemoryMessageReader : public GadgetIsmrmrdAcquisitionMessageReader
+    {
+
+    public:
+        GADGETRON_READER_DECLARE(GadgetIsmrmrdAcquisitionSharedMemoryMessageReader);
+
+        virtual ACE_Message_Block* read(ACE_SOCK_Stream* stream)
+        {
+            std::shared_ptr<GadgetSharedMemoryRing> ring = GadgetSharedMemoryRing::for_socket(stream->get_handle());
+            if (!ring) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, no shared memory attached to this connection\n");
+                return 0;
+            }
+
+            GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1 =
+                make_pooled_container_message<ISMRMRD::AcquisitionHeader>();
+            GadgetContainerMessage<hoNDArray< std::complex<float> > >* m2 =
+                make_pooled_container_message< hoNDArray< std::complex<float> > >();
 
-            } else { 
-                //Uncompressed data
-                if ((recv_count =
-                     stream->recv_n
-                     (m2->getObjectPtr()->get_data_ptr(),
-                      sizeof(std::complex<float>)*adims[0]*adims[1])) <= 0) {
-                    
-	            GERROR("Unable to read Acq data\n");
+            if (!m1 || !m2) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, failed to allocate acquisition message\n");
+                if (m1) m1->release();
+                if (m2) m2->release();
+                return 0;
+            }
+            m1->cont(m2);
+
+            GadgetSharedMemoryRecord record;
+            iovec iov[2];
+            iov[0].iov_base = reinterpret_cast<char*>(m1->getObjectPtr());
+            iov[0].iov_len = sizeof(ISMRMRD::AcquisitionHeader);
+            iov[1].iov_base = reinterpret_cast<char*>(&record);
+            iov[1].iov_len = sizeof(GadgetSharedMemoryRecord);
+
+            if (stream->recvv_n(iov, 2) <= 0) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, failed to read header\n");
+                m1->release();
+                return 0;
+            }
+
+            ISMRMRD::AcquisitionHeader* acqHead = m1->getObjectPtr();
+            if (acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION1) || acqHead->isFlagSet(ISMRMRD::ISMRMRD_ACQ_COMPRESSION2)) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, compressed acquisitions are not supported\n");
+                m1->release();
+                return 0;
+            }
+
+            GadgetContainerMessage<hoNDArray< float > >* m3 = 0;
+            if (acqHead->trajectory_dimensions) {
+                m3 = make_pooled_container_message< hoNDArray< float > >();
+                if (!m3) {
+                    GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, failed to allocate trajectory message\n");
                     m1->release();
                     return 0;
                 }
+                m2->cont(m3);
             }
-                
+
+            std::vector<size_t> adims;
+            adims.push_back(acqHead->number_of_samples);
+            adims.push_back(acqHead->active_channels);
+
+            size_t traj_bytes = 0;
+            try {
+                create_pooled(*m2->getObjectPtr(), adims);
+                if (m3) {
+                    std::vector<size_t> tdims;
+                    tdims.push_back(acqHead->trajectory_dimensions);
+                    tdims.push_back(acqHead->number_of_samples);
+                    create_pooled(*m3->getObjectPtr(), tdims);
+                    traj_bytes = sizeof(float)*m3->getObjectPtr()->get_number_of_elements();
+                }
+            }
+            catch (std::runtime_error &err){
+                GEXCEPTION(err,"GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, failed to allocate acquisition arrays\n");
+                m1->release();
+                return 0;
+            }
+
+            size_t data_bytes = sizeof(std::complex<float>)*m2->getObjectPtr()->get_number_of_elements();
+            if (record.bytes != traj_bytes + data_bytes) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, record size %d does not match the header (%d)\n",
+                       (int)record.bytes, (int)(traj_bytes + data_bytes));
+                m1->release();
+                return 0;
+            }
+
+            const char* payload = ring->record(record);
+            if (!payload) {
+                GERROR("GadgetIsmrmrdAcquisitionSharedMemoryMessageReader, invalid record in shared memory\n");
+                m1->release();
+                return 0;
+            }
+
+            if (traj_bytes) memcpy(m3->getObjectPtr()->get_data_ptr(), payload, traj_bytes);
+            memcpy(m2->getObjectPtr()->get_data_ptr(), payload + traj_bytes, data_bytes);
+            ring->release(record);
+
             return m1;
         }
-
-    };    
+    };
 }
 #endif //GADGETISMRMRDREADWRITE_H
@@ -60,6 +60,9 @@ enum GadgetMessageID {
   GADGET_MESSAGE_ISMRMRD_IMAGEWITHATTRIB_REAL_SHORT     = 1021, /**< DEPRECATED */
   GADGET_MESSAGE_ISMRMRD_IMAGE                          = 1022,
   GADGET_MESSAGE_RECONDATA                              = 1023,
+  GADGET_MESSAGE_ISMRMRD_ACQUISITION_BATCH              = 1024,
+  GADGET_MESSAGE_ISMRMRD_ACQUISITION_SHM                = 1025,
+  GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED               = 1026,
   GADGET_MESSAGE_EXT_ID_MAX                             = 4096
 };
 
@@ -1,11 +1,327 @@
 
 #include "GenericReconBase.h"
 #include <boost/filesystem.hpp>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
 
 namespace Gadgetron {
 
+    GenericReconCalibrationCache* GenericReconCalibrationCache::instance()
+    {
+        static GenericReconCalibrationCache* cache = new GenericReconCalibrationCache();
+        return cache;
+    }
+
+    std::string GenericReconCalibrationCache::make_protocol_key(const ISMRMRD::IsmrmrdHeader& header)
+    {
+        std::string ref_id;
+        if (header.measurementInformation)
+        {
+            for (size_t d = 0; d < header.measurementInformation->measurementDependency.size(); d++)
+            {
+                const ISMRMRD::MeasurementDependency& dep = header.measurementInformation->measurementDependency[d];
+                if (dep.dependencyType == "SenMap" || dep.dependencyType == "senmap") ref_id = dep.measurementID;
+            }
+        }
+
+        if (ref_id.empty()) return std::string();
+
+        std::ostringstream ostr;
+        ostr << ref_id << "\n";
+        if (header.acquisitionSystemInformation)
+        {
+            for (size_t l = 0; l < header.acquisitionSystemInformation->coilLabel.size(); l++)
+            {
+                ostr << header.acquisitionSystemInformation->coilLabel[l].coilNumber << ":" << header.acquisitionSystemInformation->coilLabel[l].coilName << ";";
+            }
+        }
+
+        return ostr.str();
+    }
+
+    std::string GenericReconCalibrationCache::make_geometry_key(const hoNDArray<ISMRMRD::AcquisitionHeader>& headers)
+    {
+        size_t SLC = headers.get_size(4);
+        size_t num = (SLC > 0) ? headers.get_number_of_elements() / SLC : 0;
+
+        std::ostringstream ostr;
+        ostr << std::fixed << std::setprecision(2);
+
+        for (size_t slc = 0; slc < SLC; slc++)
+        {
+            // the first acquired line of the slice, lines which were not acquired have no orientation
+            const ISMRMRD::AcquisitionHeader* acq = NULL;
+            for (size_t i = 0; i < num; i++)
+            {
+                const ISMRMRD::AcquisitionHeader& h = headers(i + slc*num);
+                if (h.read_dir[0] != 0 || h.read_dir[1] != 0 || h.read_dir[2] != 0)
+                {
+                    acq = &h;
+                    break;
+                }
+            }
+
+            ostr << "[";
+            if (acq)
+            {
+                for (size_t d = 0; d < 3; d++) ostr << acq->position[d] << " ";
+                for (size_t d = 0; d < 3; d++) ostr << acq->patient_table_position[d] << " ";
+
+                // the directions are unit vectors, rounded finer than the positions
+                ostr << std::setprecision(4);
+                for (size_t d = 0; d < 3; d++) ostr << acq->read_dir[d] << " " << acq->phase_dir[d] << " " << acq->slice_dir[d] << " ";
+                ostr << std::setprecision(2);
+            }
+            ostr << "]";
+        }
+
+        return ostr.str();
+    }
+
+    template <typename V>
+    void GenericReconCalibrationCache::remove_expired(std::list< Entry<V> >& entries)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        typename std::list< Entry<V> >::iterator it = entries.begin();
+        while (it != entries.end())
+        {
+            if (it->expiry <= now) it = entries.erase(it);
+            else it++;
+        }
+    }
+
+    template <typename V>
+    bool GenericReconCalibrationCache::find(std::list< Entry<V> >& entries, const std::string& key, V& v)
+    {
+        remove_expired(entries);
+
+        for (typename std::list< Entry<V> >::iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->key != key) continue;
+            v = it->value;
+            return true;
+        }
+
+        return false;
+    }
+
+    template <typename V>
+    void GenericReconCalibrationCache::insert(std::list< Entry<V> >& entries, const std::string& key, const V& v, double lifetime_seconds)
+    {
+        remove_expired(entries);
+
+        if (lifetime_seconds <= 0 || key.empty()) return;
+
+        for (typename std::list< Entry<V> >::iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->key == key)
+            {
+                entries.erase(it);
+                break;
+            }
+        }
+
+        entries.push_front(Entry<V>());
+        entries.front().key = key;
+        entries.front().expiry = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(lifetime_seconds));
+        entries.front().value = v;
+    }
+
+    bool GenericReconCalibrationCache::find_coil_map(const std::string& key, hoNDArray< std::complex<float> >& coil_map)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return find(coil_maps_, key, coil_map);
+    }
+
+    void GenericReconCalibrationCache::insert_coil_map(const std::string& key, const hoNDArray< std::complex<float> >& coil_map, double lifetime_seconds)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        insert(coil_maps_, key, coil_map, lifetime_seconds);
+    }
+
+    bool GenericReconCalibrationCache::find_eigen_channels(const std::string& key, KLTArrayType& KLT)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return find(eigen_channels_, key, KLT);
+    }
+
+    void GenericReconCalibrationCache::insert_eigen_channels(const std::string& key, const KLTArrayType& KLT, double lifetime_seconds)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        insert(eigen_channels_, key, KLT, lifetime_seconds);
+    }
+
+    size_t GenericReconCalibrationCache::size()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        remove_expired(coil_maps_);
+        remove_expired(eigen_channels_);
+        return coil_maps_.size() + eigen_channels_.size();
+    }
+
+    void GenericReconCalibrationCache::clear()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        coil_maps_.clear();
+        eigen_channels_.clear();
+    }
+
+    // ----------------------------------------------------------------------------------------
+
+    GenericReconResultCache* GenericReconResultCache::instance()
+    {
+        static GenericReconResultCache* cache = new GenericReconResultCache();
+        return cache;
+    }
+
+    unsigned long long GenericReconResultCache::hash_bytes(const void* p, size_t n, unsigned long long h)
+    {
+        const unsigned char* c = reinterpret_cast<const unsigned char*>(p);
+
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            unsigned long long w;
+            memcpy(&w, c + i, 8);
+            h = (h ^ w) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        for (; i < n; i++) h = (h ^ c[i]) * 0x100000001b3ULL;
+
+        return h;
+    }
+
+    unsigned long long GenericReconResultCache::hash_buffer(const IsmrmrdDataBuffered& buffer, unsigned long long h)
+    {
+        std::vector<size_t> dims;
+        buffer.data_.get_dimensions(dims);
+        if (!dims.empty()) h = hash_bytes(&dims[0], dims.size()*sizeof(size_t), h);
+        h = hash_bytes(buffer.data_.begin(), buffer.data_.get_number_of_bytes(), h);
+        h = hash_bytes(buffer.headers_.begin(), buffer.headers_.get_number_of_bytes(), h);
+
+        if (buffer.trajectory_)
+        {
+            buffer.trajectory_->get_dimensions(dims);
+            if (!dims.empty()) h = hash_bytes(&dims[0], dims.size()*sizeof(size_t), h);
+            h = hash_bytes(buffer.trajectory_->begin(), buffer.trajectory_->get_number_of_bytes(), h);
+        }
+
+        const SamplingDescription& sd = buffer.sampling_;
+        h = hash_bytes(sd.encoded_FOV_, sizeof(sd.encoded_FOV_), h);
+        h = hash_bytes(sd.recon_FOV_, sizeof(sd.recon_FOV_), h);
+        h = hash_bytes(sd.encoded_matrix_, sizeof(sd.encoded_matrix_), h);
+        h = hash_bytes(sd.recon_matrix_, sizeof(sd.recon_matrix_), h);
+        for (size_t d = 0; d < 3; d++)
+        {
+            uint16_t lim[3] = { sd.sampling_limits_[d].min_, sd.sampling_limits_[d].center_, sd.sampling_limits_[d].max_ };
+            h = hash_bytes(lim, sizeof(lim), h);
+        }
+
+        return h;
+    }
+
+    std::string GenericReconResultCache::make_key(const std::string& gadget, const std::vector<GadgetPropertyBase*>& properties, const std::string& context, const IsmrmrdReconBit& recon_bit, size_t encoding)
+    {
+        std::ostringstream ostr;
+        ostr << gadget << "\n" << context << "\n" << encoding << "\n";
+        for (size_t p = 0; p < properties.size(); p++)
+        {
+            ostr << properties[p]->name() << "=" << properties[p]->string_value() << "\n";
+        }
+        std::string desc = ostr.str();
+
+        // two hashes of different seeds, a collision of both is not a concern
+        unsigned long long h[2] = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+        for (size_t k = 0; k < 2; k++)
+        {
+            h[k] = hash_bytes(desc.c_str(), desc.size(), h[k]);
+            h[k] = hash_buffer(recon_bit.data_, h[k]);
+            if (recon_bit.ref_) h[k] = hash_buffer(*recon_bit.ref_, h[k] ^ 0x5bd1e995ULL);
+        }
+
+        std::ostringstream key;
+        key << std::hex << std::setfill('0') << std::setw(16) << h[0] << std::setw(16) << h[1];
+        return key.str();
+    }
+
+    bool GenericReconResultCache::find(const std::string& key, OutputList& outputs)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); it++)
+        {
+            if (it->key != key) continue;
+            outputs = it->outputs;
+
+            // most recently used first
+            entries_.splice(entries_.begin(), entries_, it);
+            return true;
+        }
+
+        return false;
+    }
+
+    void GenericReconResultCache::insert(const std::string& key, const OutputList& outputs, size_t max_bytes)
+    {
+        size_t nbytes = 0;
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            nbytes += outputs[i].res.data_.get_number_of_bytes() + outputs[i].res.headers_.get_number_of_bytes();
+            for (size_t m = 0; m < outputs[i].res.meta_.size(); m++) nbytes += sizeof(ISMRMRD::MetaContainer);
+        }
+
+        if (nbytes > max_bytes) return;
+
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); it++)
+        {
+            if (it->key == key)
+            {
+                bytes_ -= it->bytes;
+                entries_.erase(it);
+                break;
+            }
+        }
+
+        while (!entries_.empty() && bytes_ + nbytes > max_bytes)
+        {
+            bytes_ -= entries_.back().bytes;
+            entries_.pop_back();
+        }
+
+        entries_.push_front(Entry());
+        entries_.front().key = key;
+        entries_.front().bytes = nbytes;
+        entries_.front().outputs = outputs;
+        bytes_ += nbytes;
+    }
+
+    size_t GenericReconResultCache::size()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return entries_.size();
+    }
+
+    size_t GenericReconResultCache::bytes()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return bytes_;
+    }
+
+    void GenericReconResultCache::clear()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        entries_.clear();
+        bytes_ = 0;
+    }
+
+    // ----------------------------------------------------------------------------------------
+
     template <typename T> 
-    GenericReconBase<T>::GenericReconBase() : num_encoding_spaces_(1), process_called_times_(0)
+    GenericReconBase<T>::GenericReconBase() : num_encoding_spaces_(1), process_called_times_(0), timing_start_ms_(0)
     {
         gt_timer_.set_timing_in_destruction(false);
         gt_timer_local_.set_timing_in_destruction(false);
@@ -19,6 +335,13 @@ namespace Gadgetron {
     template <typename T> 
     int GenericReconBase<T>::process_config(ACE_Message_Block* mb)
     {
+        // the timed steps are aggregated in the profile of a profiled stream instead of being logged,
+        // or in timing_profile_ if they are only attached to the images
+        if ((this->get_profile() || timing_in_meta.value()) && !perform_timing.value())
+        {
+            perform_timing.value(true);
+        }
+
         if (!debug_folder.value().empty())
         {
             Gadgetron::get_debug_folder_path(debug_folder.value(), debug_folder_full_path_);
@@ -35,6 +358,9 @@ namespace Gadgetron {
                 GERROR("Error creating the debug folder.\n");
                 return false;
             }
+
+            gt_exporter_.configure(debug_asynchronous.value(), debug_memory_budget_MB.value() * 1024 * 1024,
+                debug_every_nth.value(), debug_format.value(), debug_compression.value());
         }
         else
         {
@@ -50,6 +376,74 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    template <typename T>
+    int GenericReconBase<T>::process(ACE_Message_Block* mb)
+    {
+        if (!timing_in_meta.value()) return BaseClass::process(mb);
+
+        timing_record_.zones.clear();
+        timing_start_ms_ = GadgetronProfile::now_ns() / 1e6;
+
+        GadgetronProfileScope profile_scope(GadgetronProfile::current() ? NULL : &timing_profile_);
+        GadgetronProfileRecordScope record_scope(&timing_record_);
+
+        return BaseClass::process(mb);
+    }
+
+    template <typename T>
+    void GenericReconBase<T>::attach_timing(IsmrmrdImageArray& res, const hoNDArray<ISMRMRD::AcquisitionHeader>* headers)
+    {
+        if (!timing_in_meta.value()) return;
+
+        // acquisitions not measured have a zero header
+        double buffered_ms = -1;
+        if (headers != NULL)
+        {
+            uint32_t first = 0, last = 0;
+            bool found = false;
+            for (size_t n = 0; n < headers->get_number_of_elements(); n++)
+            {
+                uint32_t t = (*headers)(n).acquisition_time_stamp;
+                if (t == 0) continue;
+                if (!found || t < first) first = t;
+                if (!found || t > last) last = t;
+                found = true;
+            }
+
+            if (found) buffered_ms = (last - first) * time_tick.value();
+        }
+
+        std::vector<std::string> zones(timing_record_.zones.size());
+        for (size_t z = 0; z < timing_record_.zones.size(); z++)
+        {
+            std::ostringstream ostr;
+            ostr << timing_record_.zones[z].first << "=" << timing_record_.zones[z].second / 1e6;
+            zones[z] = ostr.str();
+        }
+
+        double end_ms = GadgetronProfile::now_ns() / 1e6;
+
+        for (size_t i = 0; i < res.meta_.size(); i++)
+        {
+            ISMRMRD::MetaContainer& meta = res.meta_[i];
+
+            if (buffered_ms >= 0) meta.set(GADGETRON_TIMING_BUFFERED, buffered_ms);
+
+            // set replaces the zones of an earlier call if the meta attributes are reused
+            for (size_t z = 0; z < zones.size(); z++)
+            {
+                if (z == 0)
+                    meta.set(GADGETRON_TIMING_ZONES, zones[z].c_str());
+                else
+                    meta.append(GADGETRON_TIMING_ZONES, zones[z].c_str());
+            }
+
+            meta.set(GADGETRON_TIMING_RECON, end_ms - timing_start_ms_);
+            meta.set(GADGETRON_TIMING_RECON_START, timing_start_ms_);
+            meta.set(GADGETRON_TIMING_RECON_END, end_ms);
+        }
+    }
+
     template class EXPORTGADGETSMRICORE GenericReconBase<IsmrmrdReconData>;
     template class EXPORTGADGETSMRICORE GenericReconBase<IsmrmrdImageArray>;
     template class EXPORTGADGETSMRICORE GenericReconBase<ISMRMRD::ImageHeader>;
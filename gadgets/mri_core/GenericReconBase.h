@@ -8,6 +8,11 @@
 #pragma once
 
 #include <complex>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "gadgetron_mricore_export.h"
 #include "Gadget.h"
 #include "GadgetronTimer.h"
@@ -20,10 +25,128 @@
 #include "mri_core_data.h"
 #include "mri_core_utility.h"
 
-#include "ImageIOAnalyze.h"
+#include "GenericReconDebugExporter.h"
+#include "hoNDKLT.h"
 
 namespace Gadgetron {
 
+    /**
+        Process wide cache of coil maps and eigen channel coefficients, shared by the series of a study.
+
+        Consecutive series with the same slice geometry, coils and reference measurement, e.g. the contrasts of a
+        multi-contrast study with a separate reference scan, compute the same coil maps and coil compression.
+        Entries are keyed by the SenMap dependency of the protocol, the coil labels, the encoding space, the array
+        size, the position and orientation of every slice and the settings of the computation. Every entry expires
+        after the lifetime given when it is stored.
+    */
+    class EXPORTGADGETSMRICORE GenericReconCalibrationCache
+    {
+    public:
+
+        typedef hoNDKLT< std::complex<float> > KLTType;
+        /// [SLC][S][N]
+        typedef std::vector< std::vector< std::vector<KLTType> > > KLTArrayType;
+
+        static GenericReconCalibrationCache* instance();
+
+        /// key of the reference measurement and the coils, empty if the protocol has no SenMap dependency
+        static std::string make_protocol_key(const ISMRMRD::IsmrmrdHeader& header);
+
+        /// key of the position and orientation of every SLC, from the acquisition headers [E1 E2 N S SLC] of a buffer
+        static std::string make_geometry_key(const hoNDArray<ISMRMRD::AcquisitionHeader>& headers);
+
+        /// copies the coil map stored for the key into coil_map, returns false if there is none
+        bool find_coil_map(const std::string& key, hoNDArray< std::complex<float> >& coil_map);
+        void insert_coil_map(const std::string& key, const hoNDArray< std::complex<float> >& coil_map, double lifetime_seconds);
+
+        /// copies the eigen channel coefficients stored for the key into KLT, returns false if there are none
+        bool find_eigen_channels(const std::string& key, KLTArrayType& KLT);
+        void insert_eigen_channels(const std::string& key, const KLTArrayType& KLT, double lifetime_seconds);
+
+        /// number of entries which have not expired
+        size_t size();
+        void clear();
+
+    protected:
+
+        GenericReconCalibrationCache() {}
+
+        template <typename V>
+        struct Entry
+        {
+            std::string key;
+            std::chrono::steady_clock::time_point expiry;
+            V value;
+        };
+
+        template <typename V> static bool find(std::list< Entry<V> >& entries, const std::string& key, V& v);
+        template <typename V> static void insert(std::list< Entry<V> >& entries, const std::string& key, const V& v, double lifetime_seconds);
+        template <typename V> static void remove_expired(std::list< Entry<V> >& entries);
+
+        std::mutex mutex_;
+        std::list< Entry< hoNDArray< std::complex<float> > > > coil_maps_;
+        std::list< Entry<KLTArrayType> > eigen_channels_;
+    };
+
+    /**
+        Process wide cache of the image arrays a recon gadget sent out for its input, replayed when the same raw data
+        is reconstructed again, e.g. resubmitted with only the settings of downstream gadgets changed.
+
+        Entries are content addressed: the key is a 128 bit hash of the gadget, its properties, a context given by the
+        gadget (protocol, calibration state) and the data, headers, trajectory and sampling of the input buffers, see
+        make_key. The least recently used entries are dropped to stay within the memory budget given when storing.
+    */
+    class EXPORTGADGETSMRICORE GenericReconResultCache
+    {
+    public:
+
+        /// an image array as given to send_out_image_array, before the image numbers and meta of sending are set
+        struct Output
+        {
+            IsmrmrdImageArray res;
+            int series_num;
+            std::string data_role;
+        };
+
+        typedef std::vector<Output> OutputList;
+
+        static GenericReconResultCache* instance();
+
+        /// 64 bit hash of n bytes, continued from h
+        static unsigned long long hash_bytes(const void* p, size_t n, unsigned long long h);
+
+        /// hash of the data, headers, trajectory and sampling of a buffer, continued from h
+        static unsigned long long hash_buffer(const IsmrmrdDataBuffered& buffer, unsigned long long h);
+
+        /// key of the input of encoding space encoding of a gadget, from the gadget name, its properties, the context and the data and ref of recon_bit
+        static std::string make_key(const std::string& gadget, const std::vector<GadgetPropertyBase*>& properties, const std::string& context, const IsmrmrdReconBit& recon_bit, size_t encoding);
+
+        /// copies the image arrays stored for the key into outputs, returns false if there are none
+        bool find(const std::string& key, OutputList& outputs);
+
+        /// stores outputs for the key, dropping the least recently used entries beyond max_bytes
+        void insert(const std::string& key, const OutputList& outputs, size_t max_bytes);
+
+        size_t size();
+        size_t bytes();
+        void clear();
+
+    protected:
+
+        GenericReconResultCache() : bytes_(0) {}
+
+        struct Entry
+        {
+            std::string key;
+            size_t bytes;
+            OutputList outputs;
+        };
+
+        std::mutex mutex_;
+        std::list<Entry> entries_;
+        size_t bytes_;
+    };
+
     template <typename T> 
     class EXPORTGADGETSMRICORE GenericReconBase : public Gadget1<T>
     {
@@ -39,11 +162,19 @@ namespace Gadgetron {
         /// debug and timing
         GADGET_PROPERTY(verbose, bool, "Whether to print more information", false);
         GADGET_PROPERTY(debug_folder, std::string, "If set, the debug output will be written out", "");
+        GADGET_PROPERTY(debug_asynchronous, bool, "Whether to write the debug output on a thread of its own", true);
+        GADGET_PROPERTY(debug_memory_budget_MB, size_t, "Memory budget in MB of the debug output waiting to be written, further output is dropped, 0 for no limit", 1024);
+        GADGET_PROPERTY(debug_every_nth, size_t, "Only write every Nth debug output of the same name", 1);
+        GADGET_PROPERTY(debug_format, std::string, "Format of the debug output, 'analyze' or 'chunked'", "analyze");
+        GADGET_PROPERTY(debug_compression, bool, "Whether to compress the debug output of the chunked format", false);
         GADGET_PROPERTY(perform_timing, bool, "Whether to perform timing on some computational steps", false);
 
         /// ms for every time tick
         GADGET_PROPERTY(time_tick, float, "Time tick in ms", 2.5);
 
+        /// the timed steps of the call that produced an image are attached to its meta attributes, see attach_timing
+        GADGET_PROPERTY(timing_in_meta, bool, "Whether to attach the timing of the recon to the meta attributes of the images", false);
+
     protected:
 
         // number of encoding spaces in the protocol
@@ -63,14 +194,28 @@ namespace Gadgetron {
         // debug folder
         std::string debug_folder_full_path_;
 
-        // exporter
-        Gadgetron::ImageIOAnalyze gt_exporter_;
+        // exporter, writes the debug output asynchronously
+        Gadgetron::GenericReconDebugExporter gt_exporter_;
+
+        // timed steps of the current call of process, if timing_in_meta is set
+        Gadgetron::GadgetronProfile::Record timing_record_;
+        // profile of the timed steps if the stream is not profiled
+        Gadgetron::GadgetronProfile timing_profile_;
+        // steady clock in ms when the current call of process started
+        double timing_start_ms_;
+
+        /// attaches to the meta attributes of res the time between the first and last acquisition in headers (if given),
+        /// the timed steps of the current call of process and the time since it started
+        void attach_timing(IsmrmrdImageArray& res, const hoNDArray<ISMRMRD::AcquisitionHeader>* headers = NULL);
 
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
         virtual int process_config(ACE_Message_Block* mb);
         virtual int process(GadgetContainerMessage<T>* m1);
+
+        // records the timed steps of the call if timing_in_meta is set
+        virtual int process(ACE_Message_Block* mb);
     };
 
     class EXPORTGADGETSMRICORE GenericReconDataBase :public GenericReconBase < IsmrmrdReconData >
@@ -1,6 +1,7 @@
 
 #include "GenericReconCartesianFFTGadget.h"
 #include "hoNDArray_reductions.h"
+#include "hoNDArrayScratch.h"
 
 /*
     The input is IsmrmrdReconData and output is single 2D or 3D ISMRMRD images
@@ -25,15 +26,17 @@ namespace Gadgetron {
 
         // -------------------------------------------------
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         size_t NE = h.encoding.size();
         num_encoding_spaces_ = NE;
@@ -46,6 +49,9 @@ namespace Gadgetron {
 
     int GenericReconCartesianFFTGadget::process(Gadgetron::GadgetContainerMessage< IsmrmrdReconData >* m1)
     {
+        // scratch temporaries of this recon item are given back when it is done
+        hoNDArrayScratchScope scratch_scope;
+
         if (perform_timing.value()) { gt_timer_local_.start("GenericReconCartesianFFTGadget::process"); }
 
         process_called_times_++;
@@ -1,7 +1,20 @@
 
 #include "GenericReconCartesianGrappaGadget.h"
 #include "mri_core_grappa.h"
+#include "mri_core_pseudo_replica.h"
 #include "hoNDArray_reductions.h"
+#include "hoNDArrayScratch.h"
+
+#include <stdexcept>
+
+#ifdef USE_OMP
+    #include "omp.h"
+#endif // USE_OMP
+
+#ifdef USE_CUDA
+    #include "cuGrappa.h"
+    #include "cudaDeviceManager.h"
+#endif // USE_CUDA
 
 /*
     The input is IsmrmrdReconData and output is single 2D or 3D ISMRMRD images
@@ -15,7 +28,89 @@
 
 namespace Gadgetron {
 
-    GenericReconCartesianGrappaGadget::GenericReconCartesianGrappaGadget() : BaseClass()
+    namespace
+    {
+        /**
+            Splits the OpenMP threads between the loop over num independent units (N/S/SLC) and the
+            parallel regions inside every unit. Small 2D units do not scale over many threads, so the
+            unit loop takes up to num threads and, if nested threading is allowed, every unit gets the
+            threads left over. The nested setting of the caller is restored on destruction.
+        */
+        class GrappaUnitThreads
+        {
+        public:
+
+            GrappaUnitThreads(long long num, int max_outer_threads, bool nested_threading) : outer_(1), inner_(1), nested_(0)
+            {
+#ifdef USE_OMP
+                int num_threads = omp_get_max_threads();
+
+                outer_ = num_threads;
+                if (max_outer_threads > 0 && max_outer_threads < outer_) outer_ = max_outer_threads;
+                if (num < outer_) outer_ = (num > 1) ? (int)num : 1;
+
+                inner_ = (outer_ > 1 && !nested_threading) ? 1 : num_threads / outer_;
+                if (inner_ < 1) inner_ = 1;
+
+                nested_ = omp_get_nested();
+                if (outer_ > 1) omp_set_nested(inner_ > 1);
+#endif // USE_OMP
+            }
+
+            ~GrappaUnitThreads()
+            {
+#ifdef USE_OMP
+                omp_set_nested(nested_);
+#endif // USE_OMP
+            }
+
+            /// number of threads of the unit loop
+            int outer() const { return outer_; }
+
+            /// number of threads of the parallel regions inside every unit, to be set by every thread of the unit loop
+            void set_inner() const
+            {
+#ifdef USE_OMP
+                omp_set_num_threads(inner_);
+#endif // USE_OMP
+            }
+
+        protected:
+            int outer_;
+            int inner_;
+            int nested_;
+        };
+
+#ifdef USE_CUDA
+        /**
+            Sets the gpu device of the calling thread and restores the previous one on destruction,
+            the cpu threads of the scheduler may be running other gpu work of the stream.
+        */
+        class GrappaDeviceScope
+        {
+        public:
+
+            explicit GrappaDeviceScope(int device) : previous_(-1)
+            {
+                if (cudaGetDevice(&previous_) != cudaSuccess || cudaSetDevice(device) != cudaSuccess)
+                {
+                    previous_ = -1;
+                    throw std::runtime_error("cannot set the gpu device");
+                }
+            }
+
+            ~GrappaDeviceScope()
+            {
+                if (previous_ >= 0) cudaSetDevice(previous_);
+            }
+
+        protected:
+            int previous_;
+        };
+#endif // USE_CUDA
+    }
+
+    GenericReconCartesianGrappaGadget::GenericReconCartesianGrappaGadget() : BaseClass(), use_gpu_(false)
     {
     }
 
@@ -29,27 +124,70 @@ namespace Gadgetron {
 
         // -------------------------------------------------
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         size_t NE = h.encoding.size();
         num_encoding_spaces_ = NE;
         GDEBUG_CONDITION_STREAM(verbose.value(), "Number of encoding spaces: " << NE);
 
         recon_obj_.resize(NE);
+        early_ref_.clear();
+        early_ref_.resize(NE);
+        deferred_ref_.clear();
+        deferred_ref_.resize(NE);
+        result_cache_ref_key_.clear();
+        result_cache_ref_key_.resize(NE);
+
+        use_gpu_ = false;
+        gpu_devices_.clear();
+        calib_scheduler_.reset_measurements();
+        unwrapping_scheduler_.reset_measurements();
+        if (grappa_use_gpu.value())
+        {
+#ifdef USE_CUDA
+            int num_devices = cudaDeviceManager::Instance()->getTotalNumberOfDevice();
+            if (grappa_gpu_device.value() == -1)
+            {
+                for (int d = 0; d < num_devices; d++) gpu_devices_.push_back(d);
+            }
+            else if (grappa_gpu_device.value() >= 0 && grappa_gpu_device.value() < num_devices)
+            {
+                gpu_devices_.push_back(grappa_gpu_device.value());
+            }
+
+            use_gpu_ = !gpu_devices_.empty();
+            if (use_gpu_)
+            {
+                GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianGrappaGadget, 2D calibration and unwrapping on " << gpu_devices_.size() << " gpu(s)"
+                    << (grappa_gpu_cpu_coscheduling.value() ? " and the cpu" : ""));
+            }
+            else
+            {
+                GWARN_STREAM("GenericReconCartesianGrappaGadget, gpu " << grappa_gpu_device.value() << " not found among " << num_devices << " devices, the cpu is used");
+            }
+#else
+            GWARN_STREAM("GenericReconCartesianGrappaGadget, grappa_use_gpu is set but the gadget is built without cuda, the cpu is used");
+#endif // USE_CUDA
+        }
 
         return GADGET_OK;
     }
 
     int GenericReconCartesianGrappaGadget::process(Gadgetron::GadgetContainerMessage< IsmrmrdReconData >* m1)
     {
+        // scratch temporaries of this recon item are given back when it is done
+        hoNDArrayScratchScope scratch_scope;
+
         if (perform_timing.value()) { gt_timer_local_.start("GenericReconCartesianGrappaGadget::process"); }
 
         process_called_times_++;
@@ -87,8 +225,85 @@ namespace Gadgetron {
 
             // ---------------------------------------------------------------
 
+            // send the images of an identical earlier input again instead of reconstructing it
+            size_t result_cache_max_bytes = result_cache_max_size_MB.value()*1024*1024;
+            GenericReconResultCache::OutputList result_outputs;
+            GenericReconResultCache::OutputList* result_record = NULL;
+            std::string result_key;
+
+            if (result_cache_max_bytes > 0)
+            {
+                bool has_data = (recon_bit_->rbit_[e].data_.data_.get_number_of_elements() > 0);
+
+                // data without ref is reconstructed with the calibration of the last ref
+                if (has_data) result_key = this->make_result_cache_key(recon_bit_->rbit_[e], e, recon_bit_->rbit_[e].ref_ ? std::string() : result_cache_ref_key_[e]);
+
+                if (recon_bit_->rbit_[e].ref_)
+                {
+                    std::ostringstream ostr;
+                    ostr << std::hex << GenericReconResultCache::hash_buffer(*recon_bit_->rbit_[e].ref_, 0xcbf29ce484222325ULL);
+                    result_cache_ref_key_[e] = ostr.str();
+                    deferred_ref_[e] = boost::none;
+                }
+
+                if (has_data && GenericReconResultCache::instance()->find(result_key, result_outputs))
+                {
+                    GDEBUG_CONDITION_STREAM(verbose.value(), "Input seen before, " << result_outputs.size() << " cached image arrays are sent for encoding space " << e);
+
+                    // the ref is calibrated once data is not found in the cache
+                    if (recon_bit_->rbit_[e].ref_)
+                    {
+                        deferred_ref_[e] = *recon_bit_->rbit_[e].ref_;
+                        early_ref_[e] = boost::none;
+                    }
+
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::replay_image_arrays"); }
+                    this->replay_image_arrays(recon_bit_->rbit_[e], result_outputs, e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    continue;
+                }
+
+                if (has_data)
+                {
+                    if (!recon_bit_->rbit_[e].ref_ && deferred_ref_[e])
+                    {
+                        recon_bit_->rbit_[e].ref_ = *deferred_ref_[e];
+                        deferred_ref_[e] = boost::none;
+                    }
+
+                    result_record = &result_outputs;
+                }
+            }
+
+            // ---------------------------------------------------------------
+
+            // the data of a ref calibrated on its own, calibrate again if it does not have the expected size
+            if (!recon_bit_->rbit_[e].ref_ && early_ref_[e] && (recon_bit_->rbit_[e].data_.data_.get_number_of_elements() > 0))
+            {
+                const hoNDArray< std::complex<float> >& data = recon_bit_->rbit_[e].data_.data_;
+                const std::vector<size_t>& calib_dims = recon_obj_[e].recon_dims_;
+
+                if (calib_dims.size() < 3 || calib_dims[0] != data.get_size(0) || calib_dims[1] != data.get_size(1) || calib_dims[2] != data.get_size(2))
+                {
+                    GWARN_STREAM("Imaging data does not have the size the reference was calibrated for, calibrating again for encoding space " << e);
+                    recon_bit_->rbit_[e].ref_ = *early_ref_[e];
+                }
+
+                early_ref_[e] = boost::none;
+            }
+
             if (recon_bit_->rbit_[e].ref_)
             {
+                // the ref can arrive before its imaging data
+                std::vector<size_t> recon_dims = *recon_bit_->rbit_[e].data_.data_.get_dimensions();
+                if (recon_bit_->rbit_[e].data_.data_.get_number_of_elements() == 0)
+                {
+                    recon_dims = this->expected_recon_dims(*recon_bit_->rbit_[e].ref_, e);
+                    early_ref_[e] = *recon_bit_->rbit_[e].ref_;
+                    GDEBUG_CONDITION_STREAM(verbose.value(), "Reference arrived before the imaging data, calibrating for [" << recon_dims[0] << " " << recon_dims[1] << " " << recon_dims[2] << "]");
+                }
+
                 if (!debug_folder_full_path_.empty())
                 {
                     gt_exporter_.export_array_complex(recon_bit_->rbit_[e].ref_->data_, debug_folder_full_path_ + "ref" + os.str());
@@ -104,44 +319,91 @@ namespace Gadgetron {
 
                 // ---------------------------------------------------------------
 
-                // after this step, the recon_obj_[e].ref_calib_ and recon_obj_[e].ref_coil_map_ are set
-
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::make_ref_coil_map"); }
-                this->make_ref_coil_map(*recon_bit_->rbit_[e].ref_,*recon_bit_->rbit_[e].data_.data_.get_dimensions(), recon_obj_[e].ref_calib_, recon_obj_[e].ref_coil_map_, e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                // reuse the calibration if the same reference was seen before
+                size_t cache_max_bytes = calib_cache_max_size_MB.value()*1024*1024;
+                unsigned long long cache_key = 0;
+                bool cached = false;
 
-                // ----------------------------------------------------------
-                // export prepared ref for calibration and coil map
-                if (!debug_folder_full_path_.empty())
+                if (cache_max_bytes > 0)
                 {
-                    this->gt_exporter_.export_array_complex(recon_obj_[e].ref_calib_, debug_folder_full_path_ + "ref_calib" + os.str());
+                    cache_key = calib_cache_.compute_key(*recon_bit_->rbit_[e].ref_, recon_dims);
+                    cached = calib_cache_.find(e, cache_key, recon_bit_->rbit_[e].ref_->data_, recon_obj_[e]);
+                    GDEBUG_CONDITION_STREAM(verbose.value() && cached, "Reference unchanged, calibration is reused for encoding space " << e);
                 }
 
-                if (!debug_folder_full_path_.empty())
+                recon_obj_[e].recon_dims_ = recon_dims;
+
+                if (!cached)
                 {
-                    this->gt_exporter_.export_array_complex(recon_obj_[e].ref_coil_map_, debug_folder_full_path_ + "ref_coil_map" + os.str());
-                }
+                    // the cache is keyed by the ref as it arrived
+                    hoNDArray< std::complex<float> > ref_uncompressed;
+                    const hoNDArray< std::complex<float> >* ref_cache_data = &recon_bit_->rbit_[e].ref_->data_;
 
-                // ---------------------------------------------------------------
-                // after this step, the recon_obj_[e].ref_calib_dst_ and recon_obj_[e].ref_coil_map_ are modified
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::prepare_down_stream_coil_compression_ref_data"); }
-                this->prepare_down_stream_coil_compression_ref_data(recon_obj_[e].ref_calib_, recon_obj_[e].ref_coil_map_, recon_obj_[e].ref_calib_dst_, e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                    // after this step, recon_obj_[e].upstream_KLT_ is set and the ref is converted to the kept eigen channels
+                    if (upstream_coil_compression.value())
+                    {
+                        if (cache_max_bytes > 0)
+                        {
+                            ref_uncompressed = recon_bit_->rbit_[e].ref_->data_;
+                            ref_cache_data = &ref_uncompressed;
+                        }
 
-                // ---------------------------------------------------------------
+                        if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::prepare_up_stream_coil_compression"); }
+                        this->prepare_up_stream_coil_compression(*recon_bit_->rbit_[e].ref_, recon_obj_[e], e);
+                        if (perform_timing.value()) { gt_timer_.stop(); }
+                    }
+                    else
+                    {
+                        recon_obj_[e].upstream_KLT_.clear();
+                    }
 
-                // after this step, coil map is computed and stored in recon_obj_[e].coil_map_
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_coil_map_estimation"); }
-                this->perform_coil_map_estimation(recon_obj_[e].ref_coil_map_, recon_obj_[e].coil_map_, e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                    // ---------------------------------------------------------------
 
-                // ---------------------------------------------------------------
+                    // after this step, the recon_obj_[e].ref_calib_ and recon_obj_[e].ref_coil_map_ are set
 
-                // after this step, recon_obj_[e].kernel_, recon_obj_[e].kernelIm_, recon_obj_[e].unmixing_coeff_ are filled
-                // gfactor is computed too
-                if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_calib"); }
-                this->perform_calib(recon_bit_->rbit_[e], recon_obj_[e], e);
-                if (perform_timing.value()) { gt_timer_.stop(); }
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::make_ref_coil_map"); }
+                    this->make_ref_coil_map(*recon_bit_->rbit_[e].ref_, recon_dims, recon_obj_[e].ref_calib_, recon_obj_[e].ref_coil_map_, e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    // ----------------------------------------------------------
+                    // export prepared ref for calibration and coil map
+                    if (!debug_folder_full_path_.empty())
+                    {
+                        this->gt_exporter_.export_array_complex(recon_obj_[e].ref_calib_, debug_folder_full_path_ + "ref_calib" + os.str());
+                    }
+
+                    if (!debug_folder_full_path_.empty())
+                    {
+                        this->gt_exporter_.export_array_complex(recon_obj_[e].ref_coil_map_, debug_folder_full_path_ + "ref_coil_map" + os.str());
+                    }
+
+                    // ---------------------------------------------------------------
+                    // after this step, the recon_obj_[e].ref_calib_dst_ and recon_obj_[e].ref_coil_map_ are modified
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::prepare_down_stream_coil_compression_ref_data"); }
+                    this->prepare_down_stream_coil_compression_ref_data(recon_obj_[e].ref_calib_, recon_obj_[e].ref_coil_map_, recon_obj_[e].ref_calib_dst_, e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    // ---------------------------------------------------------------
+
+                    // after this step, coil map is computed and stored in recon_obj_[e].coil_map_
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_coil_map_estimation"); }
+                    this->perform_coil_map_estimation(recon_obj_[e].ref_coil_map_, recon_obj_[e].coil_map_, e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    // ---------------------------------------------------------------
+
+                    // after this step, recon_obj_[e].kernel_, recon_obj_[e].kernelIm_, recon_obj_[e].unmixing_coeff_ are filled
+                    // gfactor is computed too
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::perform_calib"); }
+                    this->perform_calib(recon_bit_->rbit_[e], recon_obj_[e], e);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    if (cache_max_bytes > 0)
+                    {
+                        calib_cache_.insert(e, cache_key, *ref_cache_data, recon_obj_[e], cache_max_bytes);
+                        GDEBUG_CONDITION_STREAM(verbose.value(), "Calibration cache : " << calib_cache_.size() << " entries, " << calib_cache_.bytes()/(1024*1024) << " MB");
+                    }
+                }
 
                 // ---------------------------------------------------------------
 
@@ -150,6 +412,14 @@ namespace Gadgetron {
 
             if (recon_bit_->rbit_[e].data_.data_.get_number_of_elements() > 0)
             {
+                // data is converted to the same eigen channels as the ref
+                if (!recon_obj_[e].upstream_KLT_.empty())
+                {
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::apply_up_stream_coil_compression"); }
+                    Gadgetron::apply_eigen_channel_coefficients(recon_obj_[e].upstream_KLT_, recon_bit_->rbit_[e].data_.data_);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+                }
+
                 if (!debug_folder_full_path_.empty())
                 {
                     gt_exporter_.export_array_complex(recon_bit_->rbit_[e].data_.data_, debug_folder_full_path_ + "data_before_unwrapping" + os.str());
@@ -183,7 +453,7 @@ namespace Gadgetron {
                 }
 
                 if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::send_out_image_array"); }
-                this->send_out_image_array(recon_bit_->rbit_[e], recon_obj_[e].recon_res_, e, image_series.value() + ((int)e + 1), GADGETRON_IMAGE_REGULAR);
+                this->send_out_image_array(recon_bit_->rbit_[e], recon_obj_[e].recon_res_, e, image_series.value() + ((int)e + 1), GADGETRON_IMAGE_REGULAR, result_record);
                 if (perform_timing.value()) { gt_timer_.stop(); }
 
                 // ---------------------------------------------------------------
@@ -195,8 +465,34 @@ namespace Gadgetron {
                     res.meta_ = recon_obj_[e].recon_res_.meta_;
 
                     if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::send_out_image_array, gfactor"); }
-                    this->send_out_image_array(recon_bit_->rbit_[e], res, e, image_series.value() + 10 * ((int)e + 2), GADGETRON_IMAGE_GFACTOR);
+                    this->send_out_image_array(recon_bit_->rbit_[e], res, e, image_series.value() + 10 * ((int)e + 2), GADGETRON_IMAGE_GFACTOR, result_record);
+                    if (perform_timing.value()) { gt_timer_.stop(); }
+                }
+
+                // ---------------------------------------------------------------
+                hoNDArray<float> pseudo_replica_std_map;
+                if (pseudo_replica_repetitions.value() > 0)
+                {
+                    if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::compute_pseudo_replica_std_map"); }
+                    this->compute_pseudo_replica_std_map(recon_bit_->rbit_[e], recon_obj_[e], e, pseudo_replica_std_map);
                     if (perform_timing.value()) { gt_timer_.stop(); }
+
+                    if (pseudo_replica_std_map.get_number_of_elements() > 0)
+                    {
+                        if (!debug_folder_full_path_.empty())
+                        {
+                            this->gt_exporter_.export_array(pseudo_replica_std_map, debug_folder_full_path_ + "pseudo_replica_std_map" + os.str());
+                        }
+
+                        IsmrmrdImageArray res;
+                        Gadgetron::real_to_complex(pseudo_replica_std_map, res.data_);
+                        res.headers_ = recon_obj_[e].recon_res_.headers_;
+                        res.meta_ = recon_obj_[e].recon_res_.meta_;
+
+                        if (perform_timing.value()) { gt_timer_.start("GenericReconCartesianGrappaGadget::send_out_image_array, std map"); }
+                        this->send_out_image_array(recon_bit_->rbit_[e], res, e, image_series.value() + 100 * ((int)e + 4), GADGETRON_IMAGE_STD_MAP, result_record);
+                        if (perform_timing.value()) { gt_timer_.stop(); }
+                    }
                 }
 
                 // ---------------------------------------------------------------
@@ -204,7 +500,18 @@ namespace Gadgetron {
                 {
                     hoNDArray< std::complex<float> > snr_map;
 
-                    if (calib_mode_[e] == Gadgetron::ISMRMRD_noacceleration)
+                    if (pseudo_replica_std_map.get_number_of_elements() > 0)
+                    {
+                        snr_map = recon_obj_[e].recon_res_.data_;
+
+                        std::complex<float>* pSNR = snr_map.begin();
+                        const float* pStd = pseudo_replica_std_map.begin();
+                        for (size_t ii = 0; ii < snr_map.get_number_of_elements(); ii++)
+                        {
+                            pSNR[ii] = (pStd[ii] > 0) ? pSNR[ii] / pStd[ii] : std::complex<float>(0);
+                        }
+                    }
+                    else if (calib_mode_[e] == Gadgetron::ISMRMRD_noacceleration)
                     {
                         snr_map = recon_obj_[e].recon_res_.data_;
                     }
@@ -232,13 +539,19 @@ namespace Gadgetron {
                         res.headers_ = recon_obj_[e].recon_res_.headers_;
                         res.meta_ = recon_obj_[e].recon_res_.meta_;
 
-                        this->send_out_image_array(recon_bit_->rbit_[e], res, e, image_series.value() + 100 * ((int)e + 3), GADGETRON_IMAGE_SNR_MAP);
+                        this->send_out_image_array(recon_bit_->rbit_[e], res, e, image_series.value() + 100 * ((int)e + 3), GADGETRON_IMAGE_SNR_MAP, result_record);
 
                         if (perform_timing.value()) { gt_timer_.stop(); }
                     }
                 }
             }
 
+            if (result_record)
+            {
+                GenericReconResultCache::instance()->insert(result_key, result_outputs, result_cache_max_bytes);
+                GDEBUG_CONDITION_STREAM(verbose.value(), "Result cache : " << GenericReconResultCache::instance()->size() << " entries, " << GenericReconResultCache::instance()->bytes() / (1024 * 1024) << " MB");
+            }
+
             recon_obj_[e].recon_res_.data_.clear();
             recon_obj_[e].gfactor_.clear();
             recon_obj_[e].recon_res_.headers_.clear();
@@ -252,6 +565,38 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    std::vector<size_t> GenericReconCartesianGrappaGadget::expected_recon_dims(const IsmrmrdDataBuffered& ref, size_t e)
+    {
+        // the ref prep keeps the readout center of the uncropped ref, the imaging data has the encoded matrix along E1 and E2
+        std::vector<size_t> dims(3);
+        dims[0] = 2 * (size_t)ref.sampling_.sampling_limits_[0].center_;
+        if (dims[0] == 0) dims[0] = ref.data_.get_size(0);
+        dims[1] = (size_t)meas_max_idx_[e].kspace_encode_step_1 + 1;
+        dims[2] = (size_t)meas_max_idx_[e].kspace_encode_step_2 + 1;
+        return dims;
+    }
+
+    void GenericReconCartesianGrappaGadget::prepare_up_stream_coil_compression(IsmrmrdDataBuffered& ref, ReconObjType& recon_obj, size_t e)
+    {
+        try
+        {
+            size_t CHA = ref.data_.get_size(3);
+
+            // one KLT for every SLC, computed from the ref averaged over N and S
+            // all N and S of the data are then converted to the channels the unmixing coefficients are computed for
+            Gadgetron::compute_eigen_channel_coefficients(ref.data_, true, true, (calib_mode_[e] == Gadgetron::ISMRMRD_interleaved), 1, 1,
+                upstream_coil_compression_thres.value(), upstream_coil_compression_num_modesKept.value(), recon_obj.upstream_KLT_);
+
+            GDEBUG_CONDITION_STREAM(verbose.value(), "Upstream coil compression keeps " << recon_obj.upstream_KLT_[0][0][0].output_length() << " out of " << CHA << " channels for encoding space " << e);
+
+            Gadgetron::apply_eigen_channel_coefficients(recon_obj.upstream_KLT_, ref.data_);
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconCartesianGrappaGadget::prepare_up_stream_coil_compression(...) ... ");
+        }
+    }
+
     void GenericReconCartesianGrappaGadget::prepare_down_stream_coil_compression_ref_data(const hoNDArray< std::complex<float> >& ref_src, hoNDArray< std::complex<float> >& ref_coil_map, hoNDArray< std::complex<float> >& ref_dst, size_t e)
     {
         try
@@ -366,6 +711,14 @@ namespace Gadgetron {
             size_t E1 = recon_bit.data_.data_.get_size(1);
             size_t E2 = recon_bit.data_.data_.get_size(2);
 
+            // ref without its imaging data
+            if (recon_bit.data_.data_.get_number_of_elements() == 0 && recon_obj.recon_dims_.size() >= 3)
+            {
+                RO = recon_obj.recon_dims_[0];
+                E1 = recon_obj.recon_dims_[1];
+                E2 = recon_obj.recon_dims_[2];
+            }
+
             hoNDArray< std::complex<float> >& src = recon_obj.ref_calib_;
             hoNDArray< std::complex<float> >& dst = recon_obj.ref_calib_dst_;
 
@@ -410,6 +763,17 @@ namespace Gadgetron {
                     std::vector<int> kE1, oE1;
                     bool fitItself = true;
                     Gadgetron::grappa2d_kerPattern(kE1, oE1, convKRO, convKE1, (size_t)acceFactorE1_[e], kRO, kNE1, fitItself);
+
+                    // the centred transforms of the gpu path need even image sizes
+                    if (use_gpu_ && RO % 2 == 0 && E1 % 2 == 0)
+                    {
+                        recon_obj.kernel_.create(convKRO, convKE1, 1, srcCHA, dstCHA, ref_N, ref_S, ref_SLC);
+                        recon_obj.kernelIm_.clear();
+
+                        this->perform_calib_scheduled(recon_obj, kE1, oE1, e);
+                        return;
+                    }
+
                     recon_obj.kernelIm_.create(RO, E1, 1, srcCHA, dstCHA, ref_N, ref_S, ref_SLC);
                 }
 
@@ -422,10 +786,15 @@ namespace Gadgetron {
 
                 long long ii;
 
-                // only allow this for loop openmp if num>1 and 2D recon
-#pragma omp parallel for default(none) private(ii) shared(src, dst, recon_obj, e, num, ref_N, ref_S, ref_RO, ref_E1, ref_E2, RO, E1, E2, dstCHA, srcCHA, convKRO, convKE1, convKE2, kRO, kNE1, kNE2) if(num>1 && E2==1)
+                // only allow the unit loop in parallel for 2D recon, a 3D unit uses all threads
+                GrappaUnitThreads unit_threads((E2 == 1) ? num : 1, grappa_unit_max_threads.value(), grappa_unit_nested_threading.value());
+                int num_unit_threads = unit_threads.outer();
+
+#pragma omp parallel for default(none) private(ii) shared(src, dst, recon_obj, e, num, ref_N, ref_S, ref_RO, ref_E1, ref_E2, RO, E1, E2, dstCHA, srcCHA, convKRO, convKE1, convKE2, kRO, kNE1, kNE2, unit_threads) num_threads(num_unit_threads) schedule(dynamic) if(num_unit_threads>1)
                 for (ii = 0; ii < num; ii++)
                 {
+                    unit_threads.set_inner();
+
                     size_t slc = ii / (ref_N*ref_S);
                     size_t s = (ii - slc*ref_N*ref_S) / (ref_N);
                     size_t n = ii - slc*ref_N*ref_S - s*ref_N;
@@ -469,41 +838,8 @@ namespace Gadgetron {
                     }
                     else
                     {
-                        hoNDArray< std::complex<float> > acsSrc(ref_RO, ref_E1, srcCHA, const_cast< std::complex<float>*>(ref_src.begin()));
-                        hoNDArray< std::complex<float> > acsDst(ref_RO, ref_E1, dstCHA, const_cast< std::complex<float>*>(ref_dst.begin()));
-
-                        hoNDArray< std::complex<float> > convKer(convKRO, convKE1, srcCHA, dstCHA, &(recon_obj.kernel_(0, 0, 0, 0, 0, n, s, slc)));
                         hoNDArray< std::complex<float> > kIm(RO, E1, srcCHA, dstCHA, &(recon_obj.kernelIm_(0, 0, 0, 0, 0, n, s, slc)));
-
-                        Gadgetron::grappa2d_calib_convolution_kernel(acsSrc, acsDst, (size_t)acceFactorE1_[e], grappa_reg_lamda.value(), kRO, kNE1, convKer);
-                        Gadgetron::grappa2d_image_domain_kernel(convKer, RO, E1, kIm);
-
-                        /*if (!debug_folder_full_path_.empty())
-                        {
-                            gt_exporter_.export_array_complex(convKer, debug_folder_full_path_ + "convKer_" + suffix);
-                        }
-
-                        if (!debug_folder_full_path_.empty())
-                        {
-                            gt_exporter_.export_array_complex(kIm, debug_folder_full_path_ + "kIm_" + suffix);
-                        }*/
-
-                        hoNDArray< std::complex<float> > coilMap(RO, E1, dstCHA, &(recon_obj.coil_map_(0, 0, 0, 0, n, s, slc)));
-                        hoNDArray< std::complex<float> > unmixC(RO, E1, srcCHA, &(recon_obj.unmixing_coeff_(0, 0, 0, 0, n, s, slc)));
-                        hoNDArray<float> gFactor;
-
-                        Gadgetron::grappa2d_unmixing_coeff(kIm, coilMap, (size_t)acceFactorE1_[e], unmixC, gFactor);
-                        memcpy(&(recon_obj.gfactor_(0, 0, 0, 0, n, s, slc)), gFactor.begin(), gFactor.get_number_of_bytes());
-
-                        /*if (!debug_folder_full_path_.empty())
-                        {
-                            gt_exporter_.export_array_complex(unmixC, debug_folder_full_path_ + "unmixC_" + suffix);
-                        }
-
-                        if (!debug_folder_full_path_.empty())
-                        {
-                            gt_exporter_.export_array(gFactor, debug_folder_full_path_ + "gFactor_" + suffix);
-                        }*/
+                        this->perform_calib_unit_2d(recon_obj, ii, e, kIm);
                     }
 
                     // -----------------------------------
@@ -556,6 +892,35 @@ namespace Gadgetron {
                 gt_exporter_.export_array_complex(recon_bit.data_.data_, debug_folder_full_path_ + "data_src_" + suffix);
             }
 
+            // SNR unit scaling
+            float effective_acce_factor(1), snr_scaling_ratio(1);
+            this->compute_snr_scaling_factor(recon_bit, effective_acce_factor, snr_scaling_ratio);
+
+            float scaling_factor(1);
+            if (effective_acce_factor > 1)
+            {
+                // since the grappa in gadgetron is doing signal preserving scaling, to perserve noise level, we need this compensation factor
+                double grappaKernelCompensationFactor = 1.0 / (acceFactorE1_[e] * acceFactorE2_[e]);
+                scaling_factor = (float)(grappaKernelCompensationFactor*snr_scaling_ratio);
+
+                if (this->verbose.value()) GDEBUG_STREAM("GenericReconCartesianGrappaGadget, grappaKernelCompensationFactor*snr_scaling_ratio : " << grappaKernelCompensationFactor*snr_scaling_ratio);
+            }
+
+            if (use_gpu_ && E2 == 1 && RO % 2 == 0 && E1 % 2 == 0)
+            {
+                this->perform_unwrapping_scheduled(recon_bit, recon_obj, scaling_factor);
+
+                if (!debug_folder_full_path_.empty())
+                {
+                    std::stringstream os;
+                    os << "encoding_" << e;
+                    std::string suffix = os.str();
+                    gt_exporter_.export_array_complex(recon_obj.recon_res_.data_, debug_folder_full_path_ + "unwrappedIm_" + suffix);
+                }
+
+                return;
+            }
+
             // compute aliased images
             data_recon_buf_.create(RO, E1, E2, dstCHA, N, S, SLC);
 
@@ -568,16 +933,9 @@ namespace Gadgetron {
                 Gadgetron::hoNDFFT<float>::instance()->ifft2c(recon_bit.data_.data_, complex_im_recon_buf_, data_recon_buf_);
             }
 
-            // SNR unit scaling
-            float effective_acce_factor(1), snr_scaling_ratio(1);
-            this->compute_snr_scaling_factor(recon_bit, effective_acce_factor, snr_scaling_ratio);
             if (effective_acce_factor > 1)
             {
-                // since the grappa in gadgetron is doing signal preserving scaling, to perserve noise level, we need this compensation factor
-                double grappaKernelCompensationFactor = 1.0 / (acceFactorE1_[e] * acceFactorE2_[e]);
-                Gadgetron::scal((float)(grappaKernelCompensationFactor*snr_scaling_ratio), complex_im_recon_buf_);
-
-                if (this->verbose.value()) GDEBUG_STREAM("GenericReconCartesianGrappaGadget, grappaKernelCompensationFactor*snr_scaling_ratio : " << grappaKernelCompensationFactor*snr_scaling_ratio);
+                Gadgetron::scal(scaling_factor, complex_im_recon_buf_);
             }
 
             if (!debug_folder_full_path_.empty())
@@ -594,9 +952,14 @@ namespace Gadgetron {
 
             long long ii;
 
-#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, E2, srcCHA, convkRO, convkE1, convkE2, ref_N, ref_S, recon_obj, dstCHA, unmixingCoeff_CHA, e) if(num>1)
+            GrappaUnitThreads unit_threads(num, grappa_unit_max_threads.value(), grappa_unit_nested_threading.value());
+            int num_unit_threads = unit_threads.outer();
+
+#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, E2, srcCHA, convkRO, convkE1, convkE2, ref_N, ref_S, recon_obj, dstCHA, unmixingCoeff_CHA, e, unit_threads) num_threads(num_unit_threads) if(num_unit_threads>1)
             {
-#pragma omp for 
+                unit_threads.set_inner();
+
+#pragma omp for schedule(dynamic)
                 for (ii = 0; ii < num; ii++)
                 {
                     size_t slc = ii / (N*S);
@@ -637,6 +1000,273 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconCartesianGrappaGadget::perform_calib_unit_2d(ReconObjType& recon_obj, size_t ii, size_t e, hoNDArray< std::complex<float> >& kIm)
+    {
+        hoNDArray< std::complex<float> >& src = recon_obj.ref_calib_;
+        hoNDArray< std::complex<float> >& dst = recon_obj.ref_calib_dst_;
+
+        size_t ref_RO = src.get_size(0);
+        size_t ref_E1 = src.get_size(1);
+        size_t srcCHA = src.get_size(3);
+        size_t dstCHA = dst.get_size(3);
+
+        size_t RO = recon_obj.unmixing_coeff_.get_size(0);
+        size_t E1 = recon_obj.unmixing_coeff_.get_size(1);
+
+        size_t convKRO = recon_obj.kernel_.get_size(0);
+        size_t convKE1 = recon_obj.kernel_.get_size(1);
+
+        hoNDArray< std::complex<float> > acsSrc(ref_RO, ref_E1, srcCHA, src.begin() + ii*ref_RO*ref_E1*srcCHA);
+        hoNDArray< std::complex<float> > acsDst(ref_RO, ref_E1, dstCHA, dst.begin() + ii*ref_RO*ref_E1*dstCHA);
+
+        hoNDArray< std::complex<float> > convKer(convKRO, convKE1, srcCHA, dstCHA, recon_obj.kernel_.begin() + ii*convKRO*convKE1*srcCHA*dstCHA);
+
+        Gadgetron::grappa2d_calib_convolution_kernel(acsSrc, acsDst, (size_t)acceFactorE1_[e], grappa_reg_lamda.value(), grappa_kSize_RO.value(), grappa_kSize_E1.value(), convKer);
+        Gadgetron::grappa2d_image_domain_kernel(convKer, RO, E1, kIm);
+
+        hoNDArray< std::complex<float> > coilMap(RO, E1, dstCHA, recon_obj.coil_map_.begin() + ii*RO*E1*dstCHA);
+        hoNDArray< std::complex<float> > unmixC(RO, E1, srcCHA, recon_obj.unmixing_coeff_.begin() + ii*RO*E1*srcCHA);
+        hoNDArray<float> gFactor(RO, E1, recon_obj.gfactor_.begin() + ii*RO*E1);
+
+        Gadgetron::grappa2d_unmixing_coeff(kIm, coilMap, (size_t)acceFactorE1_[e], unmixC, gFactor);
+    }
+
+    void GenericReconCartesianGrappaGadget::perform_unwrapping_unit_2d(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor, size_t ii)
+    {
+        typedef std::complex<float> T;
+
+        hoNDArray<T>& data = recon_bit.data_.data_;
+
+        size_t RO = data.get_size(0);
+        size_t E1 = data.get_size(1);
+        size_t dstCHA = data.get_size(3);
+        size_t N = data.get_size(4);
+        size_t S = data.get_size(5);
+
+        size_t srcCHA = recon_obj.ref_calib_.get_size(3);
+        size_t ref_N = recon_obj.unmixing_coeff_.get_size(4);
+        size_t ref_S = recon_obj.unmixing_coeff_.get_size(5);
+        size_t unmixingCoeff_CHA = recon_obj.unmixing_coeff_.get_size(3);
+
+        size_t slc = ii / S;
+        size_t s = ii - slc*S;
+
+        // aliased images of all N of this unit
+        hoNDArray<T> kspace(RO, E1, dstCHA, N, &(data(0, 0, 0, 0, 0, s, slc)));
+        hoNDArray<T> aliased, buf;
+        Gadgetron::hoNDFFT<float>::instance()->ifft2c(kspace, aliased, buf);
+
+        if (scaling_factor != 1) Gadgetron::scal(scaling_factor, aliased);
+
+        size_t usedS = s;
+        if (s >= ref_S) usedS = ref_S - 1;
+
+        for (size_t n = 0; n < N; n++)
+        {
+            size_t usedN = n;
+            if (n >= ref_N) usedN = ref_N - 1;
+
+            T* pUnmix = &(recon_obj.unmixing_coeff_(0, 0, 0, 0, usedN, usedS, slc));
+            T* pRes = &(recon_obj.recon_res_.data_(0, 0, 0, 0, n, s, slc));
+
+            hoNDArray<T> res(RO, E1, 1, 1, pRes);
+            hoNDArray<T> unmixing(RO, E1, 1, unmixingCoeff_CHA, pUnmix);
+            hoNDArray<T> aliasedIm(RO, E1, 1, ((unmixingCoeff_CHA <= srcCHA) ? unmixingCoeff_CHA : srcCHA), 1, aliased.begin() + n*RO*E1*dstCHA);
+            Gadgetron::apply_unmix_coeff_aliased_image_3D(aliasedIm, unmixing, res);
+        }
+    }
+
+    void GenericReconCartesianGrappaGadget::perform_calib_scheduled(ReconObjType& recon_obj, const std::vector<int>& kE1, const std::vector<int>& oE1, size_t e)
+    {
+        size_t num = recon_obj.ref_calib_.get_size(4)*recon_obj.ref_calib_.get_size(5)*recon_obj.ref_calib_.get_size(6);
+
+        size_t RO = recon_obj.unmixing_coeff_.get_size(0);
+        size_t E1 = recon_obj.unmixing_coeff_.get_size(1);
+        size_t srcCHA = recon_obj.ref_calib_.get_size(3);
+        size_t dstCHA = recon_obj.ref_calib_dst_.get_size(3);
+
+        GrappaUnitThreads unit_threads(num, grappa_unit_max_threads.value(), grappa_unit_nested_threading.value());
+
+        // the image domain kernel is only kept per thread
+        GadgetronUnitScheduler::Work cpu = [&](size_t first, size_t count) {
+            unit_threads.set_inner();
+            hoNDArray< std::complex<float> > kIm(RO, E1, srcCHA, dstCHA);
+            this->perform_calib_unit_2d(recon_obj, first, e, kIm);
+        };
+
+        std::vector<GadgetronUnitScheduler::Work> gpus;
+        for (size_t g = 0; g < gpu_devices_.size(); g++)
+        {
+            int device = gpu_devices_[g];
+            gpus.push_back([&, device](size_t first, size_t count) {
+                if (!this->perform_calib_gpu(recon_obj, kE1, oE1, first, count, device, e))
+                {
+                    GADGET_THROW("GenericReconCartesianGrappaGadget::perform_calib_scheduled, gpu calibration failed");
+                }
+            });
+        }
+
+        calib_scheduler_.run(num, cpu, grappa_gpu_cpu_coscheduling.value() ? unit_threads.outer() : 0, gpus);
+
+        GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianGrappaGadget, calibration units done by the cpu : " << calib_scheduler_.cpu_units() << " out of " << num);
+        this->remove_failed_gpus(calib_scheduler_);
+    }
+
+    void GenericReconCartesianGrappaGadget::perform_unwrapping_scheduled(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor)
+    {
+        size_t num = recon_bit.data_.data_.get_size(5)*recon_bit.data_.data_.get_size(6);
+
+        GrappaUnitThreads unit_threads(num, grappa_unit_max_threads.value(), grappa_unit_nested_threading.value());
+
+        GadgetronUnitScheduler::Work cpu = [&](size_t first, size_t count) {
+            unit_threads.set_inner();
+            this->perform_unwrapping_unit_2d(recon_bit, recon_obj, scaling_factor, first);
+        };
+
+        std::vector<GadgetronUnitScheduler::Work> gpus;
+        for (size_t g = 0; g < gpu_devices_.size(); g++)
+        {
+            int device = gpu_devices_[g];
+            gpus.push_back([&, device](size_t first, size_t count) {
+                if (!this->perform_unwrapping_gpu(recon_bit, recon_obj, scaling_factor, first, count, device))
+                {
+                    GADGET_THROW("GenericReconCartesianGrappaGadget::perform_unwrapping_scheduled, gpu unwrapping failed");
+                }
+            });
+        }
+
+        unwrapping_scheduler_.run(num, cpu, grappa_gpu_cpu_coscheduling.value() ? unit_threads.outer() : 0, gpus);
+
+        GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianGrappaGadget, unwrapping units done by the cpu : " << unwrapping_scheduler_.cpu_units() << " out of " << num);
+        this->remove_failed_gpus(unwrapping_scheduler_);
+    }
+
+    void GenericReconCartesianGrappaGadget::remove_failed_gpus(const GadgetronUnitScheduler& scheduler)
+    {
+        std::vector<int> devices;
+        for (size_t g = 0; g < gpu_devices_.size(); g++)
+        {
+            if (scheduler.gpu_failed(g))
+            {
+                GERROR_STREAM("GenericReconCartesianGrappaGadget, gpu " << gpu_devices_[g] << " failed and is not used any more");
+            }
+            else
+            {
+                devices.push_back(gpu_devices_[g]);
+            }
+        }
+
+        gpu_devices_ = devices;
+        if (gpu_devices_.empty()) use_gpu_ = false;
+    }
+
+    bool GenericReconCartesianGrappaGadget::perform_calib_gpu(ReconObjType& recon_obj, const std::vector<int>& kE1, const std::vector<int>& oE1, size_t first, size_t count, int device, size_t e)
+    {
+#ifdef USE_CUDA
+        try
+        {
+            hoNDArray< std::complex<float> >& src = recon_obj.ref_calib_;
+            hoNDArray< std::complex<float> >& dst = recon_obj.ref_calib_dst_;
+
+            size_t ref_RO = src.get_size(0);
+            size_t ref_E1 = src.get_size(1);
+            size_t srcCHA = src.get_size(3);
+            size_t dstCHA = dst.get_size(3);
+
+            size_t RO = recon_obj.unmixing_coeff_.get_size(0);
+            size_t E1 = recon_obj.unmixing_coeff_.get_size(1);
+
+            size_t convKRO = recon_obj.kernel_.get_size(0);
+            size_t convKE1 = recon_obj.kernel_.get_size(1);
+
+            size_t kRO = grappa_kSize_RO.value();
+
+            // the E2 dimension is 1, the units N/S/SLC are the last dimension of the gpu functions
+            hoNDArray<float_complext> acsSrc(ref_RO, ref_E1, srcCHA, count, reinterpret_cast<float_complext*>(src.begin() + first*ref_RO*ref_E1*srcCHA));
+            hoNDArray<float_complext> acsDst(ref_RO, ref_E1, dstCHA, count, reinterpret_cast<float_complext*>(dst.begin() + first*ref_RO*ref_E1*dstCHA));
+            hoNDArray<float_complext> coilMap(RO, E1, dstCHA, count, reinterpret_cast<float_complext*>(recon_obj.coil_map_.begin() + first*RO*E1*dstCHA));
+            hoNDArray<float_complext> convKer(convKRO, convKE1, srcCHA, dstCHA, count, reinterpret_cast<float_complext*>(recon_obj.kernel_.begin() + first*convKRO*convKE1*srcCHA*dstCHA));
+            hoNDArray<float_complext> unmixC(RO, E1, srcCHA, count, reinterpret_cast<float_complext*>(recon_obj.unmixing_coeff_.begin() + first*RO*E1*srcCHA));
+            hoNDArray<float> gFactor(RO, E1, count, recon_obj.gfactor_.begin() + first*RO*E1);
+
+            GrappaDeviceScope device_scope(device);
+
+            Gadgetron::cuGrappa2d_calib_unmixing_coeff(acsSrc, acsDst, coilMap, (size_t)acceFactorE1_[e], grappa_reg_lamda.value(), kRO, kE1, oE1, convKer, unmixC, gFactor);
+
+            return true;
+        }
+        catch (std::exception& ex)
+        {
+            GERROR_STREAM("GenericReconCartesianGrappaGadget::perform_calib_gpu failed on gpu " << device << " : " << ex.what());
+        }
+        catch (...)
+        {
+            GERROR_STREAM("GenericReconCartesianGrappaGadget::perform_calib_gpu failed on gpu " << device);
+        }
+#endif // USE_CUDA
+
+        return false;
+    }
+
+    bool GenericReconCartesianGrappaGadget::perform_unwrapping_gpu(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor, size_t first, size_t count, int device)
+    {
+#ifdef USE_CUDA
+        try
+        {
+            // the calibration of this encoding space may have been done on the cpu, the unwrapping does not need the kernels
+            hoNDArray< std::complex<float> >& data = recon_bit.data_.data_;
+            hoNDArray< std::complex<float> >& unmixing = recon_obj.unmixing_coeff_;
+
+            size_t RO = data.get_size(0);
+            size_t E1 = data.get_size(1);
+            size_t CHA = data.get_size(3);
+            size_t N = data.get_size(4);
+            size_t S = data.get_size(5);
+
+            size_t uCHA = unmixing.get_size(3);
+            size_t ref_N = unmixing.get_size(4);
+            size_t ref_S = unmixing.get_size(5);
+
+            GrappaDeviceScope device_scope(device);
+
+            // the S/SLC units of the range, in pieces of one slice which use the same or the last unmixing coefficients
+            size_t ii = first;
+            while (ii < first + count)
+            {
+                size_t slc = ii / S;
+                size_t s = ii - slc*S;
+
+                size_t end = std::min(first + count, (slc + 1)*S);
+                if (s < ref_S) end = std::min(end, slc*S + ref_S);
+                size_t num = end - ii;
+
+                size_t usedS = (s < ref_S) ? s : ref_S - 1;
+                size_t usedNum = (s < ref_S) ? num : 1;
+
+                hoNDArray<float_complext> kspace(RO, E1, CHA, N, num, 1, reinterpret_cast<float_complext*>(&(data(0, 0, 0, 0, 0, s, slc))));
+                hoNDArray<float_complext> unmixC(RO, E1, uCHA, ref_N, usedNum, 1, reinterpret_cast<float_complext*>(&(unmixing(0, 0, 0, 0, 0, usedS, slc))));
+                hoNDArray<float_complext> res(RO, E1, N, num, 1, reinterpret_cast<float_complext*>(&(recon_obj.recon_res_.data_(0, 0, 0, 0, 0, s, slc))));
+
+                Gadgetron::cuGrappa2d_image_domain_unwrapping(kspace, unmixC, scaling_factor, res);
+
+                ii = end;
+            }
+
+            return true;
+        }
+        catch (std::exception& ex)
+        {
+            GERROR_STREAM("GenericReconCartesianGrappaGadget::perform_unwrapping_gpu failed on gpu " << device << " : " << ex.what());
+        }
+        catch (...)
+        {
+            GERROR_STREAM("GenericReconCartesianGrappaGadget::perform_unwrapping_gpu failed on gpu " << device);
+        }
+#endif // USE_CUDA
+
+        return false;
+    }
+
     void GenericReconCartesianGrappaGadget::compute_snr_map(ReconObjType& recon_obj, hoNDArray< std::complex<float> >& snr_map)
     {
         try
@@ -693,5 +1323,118 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconCartesianGrappaGadget::compute_pseudo_replica_std_map(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t e, hoNDArray<float>& std_map)
+    {
+        try
+        {
+            typedef std::complex<float> T;
+
+            std_map.clear();
+
+            if (recon_obj.unmixing_coeff_.get_number_of_elements() == 0)
+            {
+                GWARN_STREAM("GenericReconCartesianGrappaGadget, no unmixing coefficients, pseudo replica std map is not computed for encoding space " << e);
+                return;
+            }
+
+            const hoNDArray<T>& data = recon_bit.data_.data_;
+
+            size_t RO = data.get_size(0);
+            size_t E1 = data.get_size(1);
+            size_t E2 = data.get_size(2);
+            size_t dstCHA = data.get_size(3);
+            size_t N = data.get_size(4);
+            size_t S = data.get_size(5);
+            size_t SLC = data.get_size(6);
+
+            size_t srcCHA = recon_obj.ref_calib_.get_size(3);
+            size_t ref_N = recon_obj.ref_calib_.get_size(4);
+            size_t ref_S = recon_obj.ref_calib_.get_size(5);
+
+            size_t unmixingCoeff_CHA = recon_obj.unmixing_coeff_.get_size(3);
+
+            GADGET_CHECK_THROW(recon_obj.recon_res_.data_.get_number_of_elements() == RO*E1*E2*N*S*SLC);
+
+            // same SNR unit scaling as the unwrapping
+            float effective_acce_factor(1), snr_scaling_ratio(1);
+            this->compute_snr_scaling_factor(recon_bit, effective_acce_factor, snr_scaling_ratio);
+
+            float scaling_factor(1);
+            if (effective_acce_factor > 1)
+            {
+                scaling_factor = (float)(snr_scaling_ratio / (acceFactorE1_[e] * acceFactorE2_[e]));
+            }
+
+            // the unwrapping is linear, so every replica is the recon plus the unwrapped noise of the sampled kspace
+            hoNDArray<T> noise, aliasedIm, buf(RO, E1, E2, dstCHA, N, S, SLC), replica(RO, E1, E2, 1, N, S, SLC);
+            PseudoReplicaAccumulator<T> acc;
+
+            long long num = N*S*SLC;
+            int R = pseudo_replica_repetitions.value();
+
+            GrappaUnitThreads unit_threads(num, grappa_unit_max_threads.value(), grappa_unit_nested_threading.value());
+            int num_unit_threads = unit_threads.outer();
+
+            for (int r = 0; r < R; r++)
+            {
+                // unit noise, as the data is prewhitened, every replica and recon call gets its own seed
+                unsigned long long seed = ((unsigned long long)process_called_times_ << 32) + ((unsigned long long)e << 24) + (unsigned long long)r;
+                Gadgetron::generate_sampled_kspace_noise(data, 1.0f, seed, noise);
+
+                if (E2 > 1)
+                {
+                    Gadgetron::hoNDFFT<float>::instance()->ifft3c(noise, aliasedIm, buf);
+                }
+                else
+                {
+                    Gadgetron::hoNDFFT<float>::instance()->ifft2c(noise, aliasedIm, buf);
+                }
+
+                if (scaling_factor != 1)
+                {
+                    Gadgetron::scal(scaling_factor, aliasedIm);
+                }
+
+                long long ii;
+
+#pragma omp parallel default(none) private(ii) shared(num, N, S, RO, E1, E2, srcCHA, ref_N, ref_S, recon_obj, unmixingCoeff_CHA, aliasedIm, replica, unit_threads) num_threads(num_unit_threads) if(num_unit_threads>1)
+                {
+                    unit_threads.set_inner();
+
+#pragma omp for schedule(dynamic)
+                    for (ii = 0; ii < num; ii++)
+                    {
+                        size_t slc = ii / (N*S);
+                        size_t s = (ii - slc*N*S) / N;
+                        size_t n = ii - slc*N*S - s*N;
+
+                        size_t usedN = n;
+                        if (n >= ref_N) usedN = ref_N - 1;
+
+                        size_t usedS = s;
+                        if (s >= ref_S) usedS = ref_S - 1;
+
+                        hoNDArray<T> unmixing(RO, E1, E2, unmixingCoeff_CHA, &(recon_obj.unmixing_coeff_(0, 0, 0, 0, usedN, usedS, slc)));
+                        hoNDArray<T> aliased(RO, E1, E2, ((unmixingCoeff_CHA <= srcCHA) ? unmixingCoeff_CHA : srcCHA), 1, &(aliasedIm(0, 0, 0, 0, n, s, slc)));
+                        hoNDArray<T> res(RO, E1, E2, 1, &(replica(0, 0, 0, 0, n, s, slc)));
+
+                        Gadgetron::apply_unmix_coeff_aliased_image_3D(aliased, unmixing, res);
+                    }
+                }
+
+                Gadgetron::add(replica, recon_obj.recon_res_.data_, replica);
+                acc.add(replica);
+            }
+
+            acc.get_std(std_map);
+
+            GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianGrappaGadget, pseudo replica std map from " << acc.number_of_replicas() << " replicas for encoding space " << e);
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconCartesianGrappaGadget::compute_pseudo_replica_std_map(...) ... ");
+        }
+    }
+
     GADGET_FACTORY_DECLARE(GenericReconCartesianGrappaGadget)
 }
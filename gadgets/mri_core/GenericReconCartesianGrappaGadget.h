@@ -6,6 +6,11 @@
 #pragma once
 
 #include "GenericReconGadget.h"
+#include "GadgetronUnitScheduler.h"
+#include "hoNDKLT.h"
+
+#include <list>
+#include <cstring>
 
 namespace Gadgetron {
 
@@ -49,6 +54,158 @@ namespace Gadgetron {
 
         /// coil sensitivity map, [RO E1 E2 dstCHA - uncombinedCHA Nor1 Sor1 SLC]
         hoNDArray<T> coil_map_;
+
+        /// upstream coil compression of ref and data, [SLC][1][1], empty if not used
+        std::vector< std::vector< std::vector< hoNDKLT<T> > > > upstream_KLT_;
+
+        /// dimensions of the data the calibration is computed for
+        std::vector<size_t> recon_dims_;
+    };
+
+    /// calibration results of reference data seen before, e.g. a separate reference sent again with every repetition
+    /// entries are found by a hash of the reference and confirmed by comparing the reference data
+    /// the least recently used entries are dropped to stay within the memory budget
+    /// the image domain kernel is not kept, it is only needed to compute the unmixing coefficients
+    template <typename T>
+    class GenericReconCartesianGrappaCalibCache
+    {
+    public:
+
+        typedef GenericReconCartesianGrappaObj<T> ObjType;
+
+        GenericReconCartesianGrappaCalibCache() : bytes_(0) {}
+
+        /// key of a reference, from its data, its sampling description and the recon dimensions
+        static unsigned long long compute_key(const IsmrmrdDataBuffered& ref, const std::vector<size_t>& recon_dims)
+        {
+            unsigned long long h = 0xcbf29ce484222325ULL;
+
+            std::vector<size_t> dims;
+            ref.data_.get_dimensions(dims);
+            h = hash_bytes(&dims[0], dims.size()*sizeof(size_t), h);
+            if (!recon_dims.empty()) h = hash_bytes(&recon_dims[0], recon_dims.size()*sizeof(size_t), h);
+
+            const SamplingDescription& sd = ref.sampling_;
+            h = hash_bytes(sd.encoded_FOV_, sizeof(sd.encoded_FOV_), h);
+            h = hash_bytes(sd.recon_FOV_, sizeof(sd.recon_FOV_), h);
+            h = hash_bytes(sd.encoded_matrix_, sizeof(sd.encoded_matrix_), h);
+            h = hash_bytes(sd.recon_matrix_, sizeof(sd.recon_matrix_), h);
+            for (size_t d = 0; d < 3; d++)
+            {
+                uint16_t lim[3] = { sd.sampling_limits_[d].min_, sd.sampling_limits_[d].center_, sd.sampling_limits_[d].max_ };
+                h = hash_bytes(lim, sizeof(lim), h);
+            }
+
+            return hash_bytes(ref.data_.begin(), ref.data_.get_number_of_bytes(), h);
+        }
+
+        /// if the reference was seen before for this encoding space, copies its calibration into obj
+        bool find(size_t encoding, unsigned long long key, const hoNDArray<T>& ref_data, ObjType& obj)
+        {
+            for (typename std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); it++)
+            {
+                if (it->encoding != encoding || it->key != key) continue;
+                if (!it->ref_data.dimensions_equal(&ref_data)) continue;
+                if (memcmp(it->ref_data.begin(), ref_data.begin(), ref_data.get_number_of_bytes()) != 0) continue;
+
+                obj.ref_calib_ = it->ref_calib;
+                obj.ref_calib_dst_ = it->ref_calib_dst;
+                obj.ref_coil_map_ = it->ref_coil_map;
+                obj.coil_map_ = it->coil_map;
+                obj.kernel_ = it->kernel;
+                obj.kernelIm_.clear();
+                obj.unmixing_coeff_ = it->unmixing_coeff;
+                obj.gfactor_ = it->gfactor;
+                obj.upstream_KLT_ = it->upstream_KLT;
+
+                // most recently used first
+                entries_.splice(entries_.begin(), entries_, it);
+                return true;
+            }
+
+            return false;
+        }
+
+        /// stores the calibration in obj, dropping the least recently used entries beyond max_bytes
+        void insert(size_t encoding, unsigned long long key, const hoNDArray<T>& ref_data, const ObjType& obj, size_t max_bytes)
+        {
+            size_t nbytes = ref_data.get_number_of_bytes() + obj.ref_calib_.get_number_of_bytes() + obj.ref_calib_dst_.get_number_of_bytes()
+                + obj.ref_coil_map_.get_number_of_bytes() + obj.coil_map_.get_number_of_bytes() + obj.kernel_.get_number_of_bytes()
+                + obj.unmixing_coeff_.get_number_of_bytes() + obj.gfactor_.get_number_of_bytes();
+
+            if (nbytes > max_bytes) return;
+
+            while (!entries_.empty() && bytes_ + nbytes > max_bytes)
+            {
+                bytes_ -= entries_.back().bytes;
+                entries_.pop_back();
+            }
+
+            entries_.push_front(Entry());
+            Entry& e = entries_.front();
+            e.encoding = encoding;
+            e.key = key;
+            e.bytes = nbytes;
+            e.ref_data = ref_data;
+            e.ref_calib = obj.ref_calib_;
+            e.ref_calib_dst = obj.ref_calib_dst_;
+            e.ref_coil_map = obj.ref_coil_map_;
+            e.coil_map = obj.coil_map_;
+            e.kernel = obj.kernel_;
+            e.unmixing_coeff = obj.unmixing_coeff_;
+            e.gfactor = obj.gfactor_;
+            e.upstream_KLT = obj.upstream_KLT_;
+
+            bytes_ += nbytes;
+        }
+
+        void clear()
+        {
+            entries_.clear();
+            bytes_ = 0;
+        }
+
+        size_t size() const { return entries_.size(); }
+        size_t bytes() const { return bytes_; }
+
+    protected:
+
+        struct Entry
+        {
+            size_t encoding;
+            unsigned long long key;
+            size_t bytes;
+
+            hoNDArray<T> ref_data;
+            hoNDArray<T> ref_calib;
+            hoNDArray<T> ref_calib_dst;
+            hoNDArray<T> ref_coil_map;
+            hoNDArray<T> coil_map;
+            hoNDArray<T> kernel;
+            hoNDArray<T> unmixing_coeff;
+            hoNDArray<typename realType<T>::Type> gfactor;
+            std::vector< std::vector< std::vector< hoNDKLT<T> > > > upstream_KLT;
+        };
+
+        static unsigned long long hash_bytes(const void* p, size_t n, unsigned long long h)
+        {
+            const unsigned char* c = reinterpret_cast<const unsigned char*>(p);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                unsigned long long w;
+                memcpy(&w, c + i, 8);
+                h = (h ^ w) * 0x100000001b3ULL;
+                h ^= h >> 29;
+            }
+            for (; i < n; i++) h = (h ^ c[i]) * 0x100000001b3ULL;
+
+            return h;
+        }
+
+        std::list<Entry> entries_;
+        size_t bytes_;
     };
 }
 
@@ -74,6 +231,12 @@ namespace Gadgetron {
         GADGET_PROPERTY(send_out_gfactor, bool, "Whether to send out gfactor map", false);
         GADGET_PROPERTY(send_out_snr_map, bool, "Whether to send out SNR map", false);
 
+        /// ------------------------------------------------------------------------------------
+        /// pseudo replica snr measurement
+        /// if pseudo_replica_repetitions > 0, this number of noise replicas of the data are unwrapped with the unmixing coefficients of the recon
+        /// the std map of the replica magnitudes is sent out and, if send_out_snr_map==true, the SNR map is the image divided by this std map instead of the gfactor
+        GADGET_PROPERTY(pseudo_replica_repetitions, int, "Number of pseudo replicas used to compute the noise std map, 0 to disable", 0);
+
         /// ------------------------------------------------------------------------------------
         /// Grappa parameters
         GADGET_PROPERTY(grappa_kSize_RO, int, "Grappa kernel size RO", 5);
@@ -82,6 +245,46 @@ namespace Gadgetron {
         GADGET_PROPERTY(grappa_reg_lamda, double, "Grappa regularization threshold", 0.0005);
         GADGET_PROPERTY(grappa_calib_over_determine_ratio, double, "Grappa calibration overdermination ratio", 45);
 
+        /// ------------------------------------------------------------------------------------
+        /// threading of calibration and unwrapping
+        /// the N/S/SLC units are processed in parallel by up to grappa_unit_max_threads threads (0 for all available)
+        /// if grappa_unit_nested_threading==true, threads left over by the unit loop are used inside every unit
+        GADGET_PROPERTY(grappa_unit_max_threads, int, "Maximal number of threads for the loop over N/S/SLC in calibration and unwrapping, 0 for all", 0);
+        GADGET_PROPERTY(grappa_unit_nested_threading, bool, "Whether to give threads left over by the N/S/SLC loop to the processing inside every unit", true);
+
+        /// ------------------------------------------------------------------------------------
+        /// gpu backend
+        /// if grappa_use_gpu==true and the gadget is built with cuda, the 2D calibration, unmixing coefficients and unwrapping run on grappa_gpu_device
+        /// or, if grappa_gpu_device is -1, on all gpus of the node
+        /// if grappa_gpu_cpu_coscheduling==true, the cpu threads take part as well, the N/S/SLC (calibration) or S/SLC (unwrapping) units are split between the cpu threads and the gpus
+        /// by their measured throughput while the calibration or unwrapping runs (see GadgetronUnitScheduler)
+        /// 3D recon falls back to the cpu, the units of a failed gpu are done by the cpu and the gpu is not used any more
+        GADGET_PROPERTY(grappa_use_gpu, bool, "Whether to perform the 2D calibration and unwrapping on the gpu", false);
+        GADGET_PROPERTY(grappa_gpu_device, int, "Gpu device used if grappa_use_gpu is true, -1 for all gpus", 0);
+        GADGET_PROPERTY(grappa_gpu_cpu_coscheduling, bool, "Whether the cpu threads take units of the 2D calibration and unwrapping as well when the gpu is used", false);
+
+        /// ------------------------------------------------------------------------------------
+        /// calibration cache
+        /// if calib_cache_max_size_MB > 0, the calibration of every reference is kept and reused when the same reference arrives again
+        GADGET_PROPERTY(calib_cache_max_size_MB, size_t, "Memory budget in MB of the calibration cache for repeated reference data, 0 to disable", 0);
+
+        /// ------------------------------------------------------------------------------------
+        /// result cache
+        /// if result_cache_max_size_MB > 0, the image arrays sent out for every input are kept in the process wide GenericReconResultCache
+        /// and sent again when the same input arrives with the same properties and protocol, e.g. a dataset resubmitted with other downstream settings
+        /// the ref of an input found in the cache is only calibrated once later data is not found
+        GADGET_PROPERTY(result_cache_max_size_MB, size_t, "Memory budget in MB of the process wide cache of the images sent for identical input, 0 to disable", 0);
+
+        /// ------------------------------------------------------------------------------------
+        /// up stream coil compression
+        /// if upstream_coil_compression==true, ref and data are converted to eigen channels of the ref before the coil map estimation and calibration
+        /// one KLT is computed for every SLC from the ref averaged over N and S, so that calibration and unwrapping run on the kept channels only
+        /// if upstream_coil_compression_num_modesKept > 0, this number of channels will be kept
+        /// if upstream_coil_compression_num_modesKept==0 and upstream_coil_compression_thres>0, the number of kept channels will be determined by this threshold
+        GADGET_PROPERTY(upstream_coil_compression, bool, "Whether to perform upstream coil compression", false);
+        GADGET_PROPERTY(upstream_coil_compression_thres, double, "Threadhold for upstream coil compression", -1);
+        GADGET_PROPERTY(upstream_coil_compression_num_modesKept, size_t, "Number of modes to keep for upstream coil compression", 0);
+
         /// ------------------------------------------------------------------------------------
         /// down stream coil compression
         /// if downstream_coil_compression==true, down stream coil compression is used
@@ -99,6 +302,27 @@ namespace Gadgetron {
         // record the recon kernel, coil maps etc. for every encoding space
         std::vector< ReconObjType > recon_obj_;
 
+        // calibrations of earlier references, see calib_cache_max_size_MB
+        GenericReconCartesianGrappaCalibCache< std::complex<float> > calib_cache_;
+
+        // whether the gpu backend is used, see grappa_use_gpu
+        bool use_gpu_;
+        // gpus used, a gpu is removed once it failed
+        std::vector<int> gpu_devices_;
+
+        // split of the units between cpu and gpus, with the throughput measured so far, see grappa_gpu_cpu_coscheduling
+        GadgetronUnitScheduler calib_scheduler_;
+        GadgetronUnitScheduler unwrapping_scheduler_;
+
+        // a ref which arrived before its imaging data (e.g. AcquisitionAccumulateTriggerGadget::progressive_ref_trigger) is calibrated
+        // for the expected data size and kept until the data arrives, to calibrate again if the data size does not match
+        std::vector< boost::optional<IsmrmrdDataBuffered> > early_ref_;
+
+        // ref of an input found in the result cache, calibrated when the next data without ref is not found, see result_cache_max_size_MB
+        std::vector< boost::optional<IsmrmrdDataBuffered> > deferred_ref_;
+        // hash of the last ref, the result of data without ref depends on it
+        std::vector<std::string> result_cache_ref_key_;
+
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
@@ -110,16 +334,44 @@ namespace Gadgetron {
         // recon step functions
         // --------------------------------------------------
 
+        // if upstream coil compression is used, compute the KLT of the ref and convert ref to the kept eigen channels
+        virtual void prepare_up_stream_coil_compression(IsmrmrdDataBuffered& ref, ReconObjType& recon_obj, size_t encoding);
+
         // if downstream coil compression is used, determine number of channels used and prepare the ref_calib_dst_
         virtual void prepare_down_stream_coil_compression_ref_data(const hoNDArray< std::complex<float> >& ref_src, hoNDArray< std::complex<float> >& ref_coil_map, hoNDArray< std::complex<float> >& ref_dst, size_t encoding);
 
         // calibration, if only one dst channel is prescribed, the GrappaOne is used
         virtual void perform_calib(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
 
+        // dimensions of the imaging data expected for a ref which arrives on its own, from the encoded matrix
+        virtual std::vector<size_t> expected_recon_dims(const IsmrmrdDataBuffered& ref, size_t encoding);
+
         // unwrapping or coil combination
         virtual void perform_unwrapping(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
 
+        // 2D calibration of the N/S/SLC unit ii of recon_obj.ref_calib_, kIm is the buffer of the image domain kernel [RO E1 srcCHA dstCHA]
+        virtual void perform_calib_unit_2d(ReconObjType& recon_obj, size_t ii, size_t encoding, hoNDArray< std::complex<float> >& kIm);
+
+        // 2D unwrapping of the S/SLC unit ii of recon_bit, all N at once, from the kspace data
+        virtual void perform_unwrapping_unit_2d(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor, size_t ii);
+
+        // 2D calibration and unwrapping split between the gpus and, with grappa_gpu_cpu_coscheduling, the cpu threads
+        virtual void perform_calib_scheduled(ReconObjType& recon_obj, const std::vector<int>& kE1, const std::vector<int>& oE1, size_t encoding);
+        virtual void perform_unwrapping_scheduled(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor);
+
+        // 2D calibration of the N/S/SLC units [first, first+count) and unwrapping of the S/SLC units [first, first+count) on a gpu
+        // return false if that fails
+        virtual bool perform_calib_gpu(ReconObjType& recon_obj, const std::vector<int>& kE1, const std::vector<int>& oE1, size_t first, size_t count, int device, size_t encoding);
+        virtual bool perform_unwrapping_gpu(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, float scaling_factor, size_t first, size_t count, int device);
+
+        // drops the gpus which failed in the last run of scheduler
+        void remove_failed_gpus(const GadgetronUnitScheduler& scheduler);
+
         // compute snr map
         virtual void compute_snr_map(ReconObjType& recon_obj, hoNDArray< std::complex<float> >& snr_map);
+
+        // pseudo replica std map, [RO E1 E2 1 N S SLC], from pseudo_replica_repetitions noise replicas of the data unwrapped with recon_obj.unmixing_coeff_
+        // the noise of every replica only goes through the linear unwrapping and is added to recon_obj.recon_res_
+        virtual void compute_pseudo_replica_std_map(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding, hoNDArray<float>& std_map);
     };
 }
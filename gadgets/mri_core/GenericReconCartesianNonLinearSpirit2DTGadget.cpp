@@ -9,9 +9,16 @@
 #include "hoGdSolver.h"
 #include <boost/make_shared.hpp>
 
+#ifdef USE_CUDA
+    #include "cuSPIRIT2DTOperator.h"
+    #include "cuWavelet2DTOperator.h"
+    #include "cuGdSolver.h"
+    #include "cudaDeviceManager.h"
+#endif // USE_CUDA
+
 namespace Gadgetron {
 
-    GenericReconCartesianNonLinearSpirit2DTGadget::GenericReconCartesianNonLinearSpirit2DTGadget() : BaseClass()
+    GenericReconCartesianNonLinearSpirit2DTGadget::GenericReconCartesianNonLinearSpirit2DTGadget() : BaseClass(), use_gpu_(false)
     {
     }
 
@@ -25,15 +32,17 @@ namespace Gadgetron {
 
         // -------------------------------------------------
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         // -------------------------------------------------
         // check the parameters
@@ -91,6 +100,25 @@ namespace Gadgetron {
             GDEBUG_STREAM("spirit_reg_N_weighting_ratio: " << this->spirit_reg_N_weighting_ratio.value());
         }
 
+        use_gpu_ = false;
+        if (spirit_use_gpu.value())
+        {
+#ifdef USE_CUDA
+            int num_devices = cudaDeviceManager::Instance()->getTotalNumberOfDevice();
+            if (spirit_gpu_device.value() >= 0 && spirit_gpu_device.value() < num_devices)
+            {
+                use_gpu_ = true;
+                GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianNonLinearSpirit2DTGadget, non-linear iterations on gpu " << spirit_gpu_device.value());
+            }
+            else
+            {
+                GWARN_STREAM("GenericReconCartesianNonLinearSpirit2DTGadget, gpu " << spirit_gpu_device.value() << " not found among " << num_devices << " devices, the cpu is used");
+            }
+#else
+            GWARN_STREAM("GenericReconCartesianNonLinearSpirit2DTGadget, spirit_use_gpu is set but the gadget is built without cuda, the cpu is used");
+#endif // USE_CUDA
+        }
+
         return GADGET_OK;
     }
 
@@ -503,7 +531,12 @@ namespace Gadgetron {
                 hoNDArray< std::complex<float> > kspaceInitial(RO, E1, CHA, N, kspaceLinear.begin());
                 hoNDArray< std::complex<float> > res2DT(RO, E1, CHA, N, res.begin());
 
-                if (this->spirit_data_fidelity_lamda.value() > 0)
+                if (use_gpu_ && this->perform_nonlinear_spirit_unwrapping_gpu(*ker, *acq, kspaceInitial, (this->spirit_reg_use_coil_sen_map.value() && hasCoilMap) ? coilMap.get() : NULL,
+                    smallest_eigen_value, gfactorMedian, res2DT))
+                {
+                    if (!debug_folder_full_path_.empty()) gt_exporter_.export_array_complex(res2DT, debug_folder_full_path_ + "spirit_nl_2DT_gpu_res");
+                }
+                else if (this->spirit_data_fidelity_lamda.value() > 0)
                 {
                     GDEBUG_STREAM("Start the NL SPIRIT data fidelity iteration - regularization strength : " << this->spirit_image_reg_lamda.value()
                                     << " - number of iteration : "                      << this->spirit_nl_iter_max.value()
@@ -608,6 +641,7 @@ namespace Gadgetron {
                     acq->get_dimensions(dims);
 
                     hoSPIRIT2DTOperator< std::complex<float> > spirit(&dims);
+                    spirit.use_blocked_kernel_ = true;
                     spirit.set_forward_kernel(*ker, false);
                     spirit.set_acquired_points(*acq);
                     spirit.no_null_space_ = true;
@@ -664,5 +698,165 @@ namespace Gadgetron {
         }
     }
 
+#ifdef USE_CUDA
+    class gpuSolverCallBack : public cuGdSolverCallBack< float_complext, cuWavelet2DTOperator<float> >
+    {
+        public:
+        typedef cuGdSolverCallBack< float_complext, cuWavelet2DTOperator<float> > BaseClass;
+
+        gpuSolverCallBack() : BaseClass() {}
+        virtual ~gpuSolverCallBack() {}
+
+        void execute(const cuNDArray<float_complext>& b, cuNDArray<float_complext>& x)
+        {
+            typedef cuSPIRIT2DTOperator<float> SpiritOperType;
+            SpiritOperType* pOper = dynamic_cast<SpiritOperType*> (this->solver_->oper_system_);
+            if (pOper != NULL) pOper->restore_acquired_kspace(x);
+        }
+    };
+#endif // USE_CUDA
+
+    bool GenericReconCartesianNonLinearSpirit2DTGadget::perform_nonlinear_spirit_unwrapping_gpu(hoNDArray< std::complex<float> >& ker, hoNDArray< std::complex<float> >& acq,
+        hoNDArray< std::complex<float> >& kspaceInitial, hoNDArray< std::complex<float> >* coilMap, float smallest_eigen_value, float gfactorMedian, hoNDArray< std::complex<float> >& res)
+    {
+#ifdef USE_CUDA
+        size_t RO = acq.get_size(0);
+        size_t E1 = acq.get_size(1);
+        size_t CHA = acq.get_size(2);
+        size_t N = acq.get_size(3);
+
+        // only the harr wavelet is on the gpu, see hoWaveletOperator::select_wavelet
+        std::string wav_name = this->spirit_reg_name.value();
+        bool redundant_wav = (wav_name == "db2" || wav_name == "db3" || wav_name == "db4" || wav_name == "db5");
+
+        if (redundant_wav || N < 2 || RO % 2 != 0 || E1 % 2 != 0)
+        {
+            GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconCartesianNonLinearSpirit2DTGadget, the setting is not supported on the gpu, the cpu is used for this 2DT : "
+                << wav_name << " - [" << RO << " " << E1 << " " << N << "]");
+            return false;
+        }
+
+        try
+        {
+            if (cudaSetDevice(spirit_gpu_device.value()) != cudaSuccess)
+            {
+                GADGET_THROW("GenericReconCartesianNonLinearSpirit2DTGadget::perform_nonlinear_spirit_unwrapping_gpu, cannot set the gpu device");
+            }
+
+            Gadgetron::GadgetronTimer timer(false);
+
+            hoNDArray<float_complext> h_ker(ker.get_dimensions(), reinterpret_cast<float_complext*>(ker.begin()));
+            hoNDArray<float_complext> h_acq(acq.get_dimensions(), reinterpret_cast<float_complext*>(acq.begin()));
+            hoNDArray<float_complext> h_res(res.get_dimensions(), reinterpret_cast<float_complext*>(res.begin()));
+
+            cuNDArray<float_complext> d_ker(h_ker);
+            cuNDArray<float_complext> d_acq(h_acq);
+            cuNDArray<float_complext> d_res;
+
+            typedef cuGdSolver< float_complext, cuWavelet2DTOperator<float> > SolverType;
+            SolverType solver;
+            solver.iterations_ = this->spirit_nl_iter_max.value();
+            solver.set_output_mode(this->spirit_print_iter.value() ? SolverType::OUTPUT_VERBOSE : SolverType::OUTPUT_SILENT);
+            solver.grad_thres_ = this->spirit_nl_iter_thres.value();
+
+            if(spirit_reg_estimate_noise_floor.value() && std::abs(smallest_eigen_value)>0)
+            {
+                solver.scale_factor_ = smallest_eigen_value;
+                solver.proximal_strength_ratio_ = this->spirit_image_reg_lamda.value() * gfactorMedian;
+            }
+            else
+            {
+                solver.proximal_strength_ratio_ = this->spirit_image_reg_lamda.value();
+            }
+
+            hoNDArray<float_complext> h_x0(kspaceInitial.get_dimensions(), reinterpret_cast<float_complext*>(kspaceInitial.begin()));
+            boost::shared_ptr< cuNDArray<float_complext> > x0(new cuNDArray<float_complext>(h_x0));
+            solver.set_x0(x0);
+
+            // image reg term
+            cuWavelet2DTOperator<float> wav3DOperator;
+            wav3DOperator.set_acquired_points(d_acq);
+            wav3DOperator.scale_factor_first_dimension_ = this->spirit_reg_RO_weighting_ratio.value();
+            wav3DOperator.scale_factor_second_dimension_ = this->spirit_reg_E1_weighting_ratio.value();
+            wav3DOperator.scale_factor_third_dimension_ = this->spirit_reg_N_weighting_ratio.value();
+            wav3DOperator.with_approx_coeff_ = !this->spirit_reg_keep_approx_coeff.value();
+            wav3DOperator.proximity_across_cha_ = this->spirit_reg_proximity_across_cha.value();
+            wav3DOperator.no_null_space_ = true;
+            wav3DOperator.input_in_kspace_ = true;
+
+            if (coilMap != NULL)
+            {
+                hoNDArray<float_complext> h_coilMap(coilMap->get_dimensions(), reinterpret_cast<float_complext*>(coilMap->begin()));
+                wav3DOperator.coil_map_ = cuNDArray<float_complext>(h_coilMap);
+            }
+
+            solver.oper_reg_ = &wav3DOperator;
+
+            if (this->spirit_data_fidelity_lamda.value() > 0)
+            {
+                GDEBUG_STREAM("Start the NL SPIRIT data fidelity iteration on the gpu - regularization strength : " << solver.proximal_strength_ratio_
+                                << " - number of iteration : " << this->spirit_nl_iter_max.value());
+
+                // parallel imaging term
+                cuSPIRIT2DTDataFidelityOperator<float> spirit;
+                spirit.set_forward_kernel(d_ker);
+                spirit.set_acquired_points(d_acq);
+
+                solver.oper_system_ = &spirit;
+
+                if (this->perform_timing.value()) timer.start("NonLinear SPIRIT solver for 2DT with data fidelity on the gpu ... ");
+                solver.solve(d_acq, d_res);
+                if (this->perform_timing.value()) timer.stop();
+            }
+            else
+            {
+                GDEBUG_STREAM("Start the NL SPIRIT iteration on the gpu - regularization strength : " << solver.proximal_strength_ratio_
+                                << " - number of iteration : " << this->spirit_nl_iter_max.value());
+
+                // parallel imaging term
+                cuSPIRIT2DTOperator<float> spirit;
+                spirit.set_forward_kernel(d_ker);
+                spirit.set_acquired_points(d_acq);
+                spirit.no_null_space_ = true;
+
+                solver.oper_system_ = &spirit;
+
+                // set call back
+                gpuSolverCallBack cb;
+                cb.solver_ = &solver;
+                solver.call_back_ = &cb;
+
+                cuNDArray<float_complext> b(*x0);
+                clear(&b);
+
+                if (this->perform_timing.value()) timer.start("NonLinear SPIRIT solver for 2DT on the gpu ... ");
+                solver.solve(b, d_res);
+                if (this->perform_timing.value()) timer.stop();
+
+                spirit.restore_acquired_kspace(d_res);
+            }
+
+            // x0 is returned if the proximal strength is 0
+            if (d_res.get_number_of_elements() != h_res.get_number_of_elements()) d_res = *x0;
+
+            d_res.to_host(&h_res);
+
+            return true;
+        }
+        catch (std::exception& ex)
+        {
+            GERROR_STREAM("GenericReconCartesianNonLinearSpirit2DTGadget::perform_nonlinear_spirit_unwrapping_gpu failed, the cpu is used from now on : " << ex.what());
+        }
+        catch (...)
+        {
+            GERROR_STREAM("GenericReconCartesianNonLinearSpirit2DTGadget::perform_nonlinear_spirit_unwrapping_gpu failed, the cpu is used from now on");
+        }
+
+        use_gpu_ = false;
+#endif // USE_CUDA
+
+        return false;
+    }
+
     GADGET_FACTORY_DECLARE(GenericReconCartesianNonLinearSpirit2DTGadget)
 }
@@ -48,6 +48,10 @@ namespace Gadgetron {
         GADGET_PROPERTY(spirit_reg_RO_weighting_ratio        , double,  "Spirit regularization weigthing ratio for RO", 1.0);
         GADGET_PROPERTY(spirit_reg_E1_weighting_ratio        , double,  "Spirit regularization weigthing ratio for E1", 1.0);
         GADGET_PROPERTY(spirit_reg_N_weighting_ratio         , double,  "Spirit regularization weigthing ratio for N", 0);
+        /// if spirit_use_gpu==true and the gadget is built with cuda, the non-linear iterations run on spirit_gpu_device
+        /// only the db1 regularizer is supported on the gpu, other settings and gpu failures fall back to the cpu
+        GADGET_PROPERTY(spirit_use_gpu                       , bool,    "Spirit whether to perform the non-linear iterations on the gpu", false);
+        GADGET_PROPERTY(spirit_gpu_device                    , int,     "Spirit gpu device used if spirit_use_gpu is true", 0);
 
     protected:
 
@@ -55,6 +59,9 @@ namespace Gadgetron {
         // variable for recon
         // --------------------------------------------------
 
+        // whether the gpu is used for the non-linear iterations, see spirit_use_gpu
+        bool use_gpu_;
+
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
@@ -71,5 +78,10 @@ namespace Gadgetron {
         // perform non-linear spirit unwrapping
         // kspace, kerIm, full_kspace: [RO E1 CHA N S SLC]
         void perform_nonlinear_spirit_unwrapping(hoNDArray< std::complex<float> >& kspace, hoNDArray< std::complex<float> >& kerIm, hoNDArray< std::complex<float> >& ref2DT, hoNDArray< std::complex<float> >& coilMap2DT, hoNDArray< std::complex<float> >& full_kspace, size_t e);
+
+        // non-linear iterations on the gpu, returns false if the setting is not supported on the gpu or the gpu failed
+        // ker: [RO E1 CHA CHA ref_N], acq, kspaceInitial, res: [RO E1 CHA N], coilMap: [RO E1 CHA] or [RO E1 CHA ref_N] or NULL
+        bool perform_nonlinear_spirit_unwrapping_gpu(hoNDArray< std::complex<float> >& ker, hoNDArray< std::complex<float> >& acq, hoNDArray< std::complex<float> >& kspaceInitial,
+            hoNDArray< std::complex<float> >* coilMap, float smallest_eigen_value, float gfactorMedian, hoNDArray< std::complex<float> >& res);
     };
 }
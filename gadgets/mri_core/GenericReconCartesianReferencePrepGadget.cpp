@@ -19,15 +19,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -122,6 +124,12 @@ namespace Gadgetron {
             // -----------------------------------------
             if (prepare_ref_always.value() || !ref_prepared_[e])
             {
+                // the data of a separate or external calibration comes without ref after the ref was sent on its own
+                if (!rbit.ref_ && ref_prepared_[e] && (calib_mode_[e] == Gadgetron::ISMRMRD_separate || calib_mode_[e] == Gadgetron::ISMRMRD_external))
+                {
+                    continue;
+                }
+
                 // if no ref data is set, make copy the ref point from the  data
                 if (!rbit.ref_)
                 {
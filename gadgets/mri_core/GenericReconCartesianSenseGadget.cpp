@@ -0,0 +1,104 @@
+
+#include "GenericReconCartesianSenseGadget.h"
+#include "mri_core_sense.h"
+
+/*
+    The input is IsmrmrdReconData and output is single 2D or 3D ISMRMRD images
+
+    The unmixing coefficients are computed by SENSE from the coil maps estimated from the ref, no grappa kernel is calibrated
+
+    If required, the gfactor and snr map can be sent out
+*/
+
+namespace Gadgetron {
+
+    GenericReconCartesianSenseGadget::GenericReconCartesianSenseGadget() : BaseClass()
+    {
+    }
+
+    GenericReconCartesianSenseGadget::~GenericReconCartesianSenseGadget()
+    {
+    }
+
+    void GenericReconCartesianSenseGadget::perform_calib(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t e)
+    {
+        try
+        {
+            size_t RO = recon_bit.data_.data_.get_size(0);
+            size_t E1 = recon_bit.data_.data_.get_size(1);
+            size_t E2 = recon_bit.data_.data_.get_size(2);
+
+            // ref without its imaging data
+            if (recon_bit.data_.data_.get_number_of_elements() == 0 && recon_obj.recon_dims_.size() >= 3)
+            {
+                RO = recon_obj.recon_dims_[0];
+                E1 = recon_obj.recon_dims_[1];
+                E2 = recon_obj.recon_dims_[2];
+            }
+
+            size_t acceE1 = (acceFactorE1_[e] > 1) ? (size_t)acceFactorE1_[e] : 1;
+            size_t acceE2 = (acceFactorE2_[e] > 1) ? (size_t)acceFactorE2_[e] : 1;
+
+            if (acceE1 == 1 && acceE2 == 1)
+            {
+                BaseClass::perform_calib(recon_bit, recon_obj, e);
+                return;
+            }
+
+            if ((E1 % acceE1 != 0) || (E2 % acceE2 != 0))
+            {
+                GWARN_STREAM("GenericReconCartesianSenseGadget, matrix [" << E1 << " " << E2 << "] is not a multiple of the acceleration factors [" << acceE1 << " " << acceE2 << "], grappa is used for encoding space " << e);
+                BaseClass::perform_calib(recon_bit, recon_obj, e);
+                return;
+            }
+
+            hoNDArray< std::complex<float> >& coil_map = recon_obj.coil_map_;
+
+            size_t CHA = coil_map.get_size(3);
+            size_t ref_N = coil_map.get_size(4);
+            size_t ref_S = coil_map.get_size(5);
+            size_t ref_SLC = coil_map.get_size(6);
+
+            GADGET_CHECK_THROW(coil_map.get_size(0) == RO);
+            GADGET_CHECK_THROW(coil_map.get_size(1) == E1);
+            GADGET_CHECK_THROW(coil_map.get_size(2) == E2);
+
+            recon_obj.unmixing_coeff_.create(RO, E1, E2, CHA, ref_N, ref_S, ref_SLC);
+            recon_obj.gfactor_.create(RO, E1, E2, 1, ref_N, ref_S, ref_SLC);
+
+            // no grappa kernel for the unwrapping
+            recon_obj.kernel_.clear();
+            recon_obj.kernelIm_.clear();
+
+            // the unfolding of every unit is batched over the pixels and threaded inside
+            for (size_t slc = 0; slc < ref_SLC; slc++)
+            {
+                for (size_t s = 0; s < ref_S; s++)
+                {
+                    for (size_t n = 0; n < ref_N; n++)
+                    {
+                        hoNDArray< std::complex<float> > coilMap(RO, E1, E2, CHA, &(coil_map(0, 0, 0, 0, n, s, slc)));
+                        hoNDArray< std::complex<float> > unmixC(RO, E1, E2, CHA, &(recon_obj.unmixing_coeff_(0, 0, 0, 0, n, s, slc)));
+                        hoNDArray<float> gFactor(RO, E1, E2, &(recon_obj.gfactor_(0, 0, 0, 0, n, s, slc)));
+
+                        Gadgetron::sense_unmixing_coeff(coilMap, acceE1, acceE2, sense_reg_lamda.value(), unmixC, gFactor);
+                    }
+                }
+            }
+
+            if (!debug_folder_full_path_.empty())
+            {
+                std::stringstream os;
+                os << "encoding_" << e;
+                gt_exporter_.export_array_complex(recon_obj.unmixing_coeff_, debug_folder_full_path_ + "unmixing_coeff_sense_" + os.str());
+                gt_exporter_.export_array(recon_obj.gfactor_, debug_folder_full_path_ + "gfactor_sense_" + os.str());
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors happened in GenericReconCartesianSenseGadget::perform_calib(...) ... ");
+        }
+    }
+
+    GADGET_FACTORY_DECLARE(GenericReconCartesianSenseGadget)
+}
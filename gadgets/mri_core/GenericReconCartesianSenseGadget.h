@@ -0,0 +1,39 @@
+/** \file   GenericReconCartesianSenseGadget.h
+    \brief  This is the class gadget for 2DT and 3DT cartesian SENSE reconstruction with uniform undersampling, working on the IsmrmrdReconData.
+
+            The SENSE unmixing coefficients are computed from the coil maps by a regularised unfolding of every group of aliased pixels.
+            They replace the grappa unmixing coefficients, so unwrapping, gfactor, snr map, pseudo replica and calibration cache
+            are the ones of GenericReconCartesianGrappaGadget.
+
+    \author Hui Xue
+*/
+
+#pragma once
+
+#include "GenericReconCartesianGrappaGadget.h"
+
+namespace Gadgetron {
+
+    class EXPORTGADGETSMRICORE GenericReconCartesianSenseGadget : public GenericReconCartesianGrappaGadget
+    {
+    public:
+        GADGET_DECLARE(GenericReconCartesianSenseGadget);
+
+        typedef GenericReconCartesianGrappaGadget BaseClass;
+        typedef BaseClass::ReconObjType ReconObjType;
+
+        GenericReconCartesianSenseGadget();
+        ~GenericReconCartesianSenseGadget();
+
+        /// ------------------------------------------------------------------------------------
+        /// SENSE parameters
+        /// the regularization is relative to the mean coil sensitivity energy of every group of aliased pixels
+        /// if the matrix size is not a multiple of the acceleration factor, the grappa calibration is used instead
+        GADGET_PROPERTY(sense_reg_lamda, double, "SENSE regularization threshold", 0.001);
+
+    protected:
+
+        // SENSE unmixing coefficients and gfactor from recon_obj.coil_map_
+        virtual void perform_calib(IsmrmrdReconBit& recon_bit, ReconObjType& recon_obj, size_t encoding);
+    };
+}
@@ -2,6 +2,8 @@
 #include "GenericReconCartesianSpiritGadget.h"
 #include "mri_core_spirit.h"
 #include "hoNDArray_reductions.h"
+#include "hoNDArrayScratch.h"
+#include "GadgetronThreadBudget.h"
 #include "hoSPIRIT2DOperator.h"
 #include "hoLsqrSolver.h"
 #include "mri_core_grappa.h"
@@ -22,15 +24,17 @@ namespace Gadgetron {
 
         // -------------------------------------------------
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         size_t NE = h.encoding.size();
         num_encoding_spaces_ = NE;
@@ -92,6 +96,9 @@ namespace Gadgetron {
 
     int GenericReconCartesianSpiritGadget::process(Gadgetron::GadgetContainerMessage< IsmrmrdReconData >* m1)
     {
+        // scratch temporaries of this recon item are given back when it is done
+        hoNDArrayScratchScope scratch_scope;
+
         if (perform_timing.value()) { gt_timer_local_.start("GenericReconCartesianSpiritGadget::process"); }
 
         process_called_times_++;
@@ -662,7 +669,7 @@ namespace Gadgetron {
 
 #ifdef USE_OMP
             int numThreads = (int)num;
-            if (numThreads > omp_get_num_procs()) numThreads = omp_get_num_procs();
+            if (numThreads > GadgetronThreadBudget::num_threads()) numThreads = GadgetronThreadBudget::num_threads();
             GDEBUG_CONDITION_STREAM(this->verbose.value(), "numThreads : " << numThreads);
 #endif // USE_OMP
 
@@ -677,6 +684,7 @@ namespace Gadgetron {
                 hoSPIRIT2DOperator< std::complex<float> >& spirit = *oper;
                 spirit.use_non_centered_fft_ = true;
                 spirit.no_null_space_ = false;
+                spirit.use_blocked_kernel_ = true;
 
                 if (ref_N == 1 && ref_S == 1)
                 {
@@ -0,0 +1,292 @@
+
+#include "GenericReconDebugExporter.h"
+#include "ImageCompression.h"
+#include "log.h"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace Gadgetron {
+
+    namespace
+    {
+        const char DEBUG_CHUNKED_MAGIC[4] = { 'G', 'T', 'D', '1' };
+        const size_t DEBUG_CHUNK_ELEMENTS = 4 * 1024 * 1024;
+
+        template <typename T> uint32_t ismrmrd_data_type() { return 0; }
+        template <> uint32_t ismrmrd_data_type<unsigned short>() { return ISMRMRD::ISMRMRD_USHORT; }
+        template <> uint32_t ismrmrd_data_type<short>() { return ISMRMRD::ISMRMRD_SHORT; }
+        template <> uint32_t ismrmrd_data_type<unsigned int>() { return ISMRMRD::ISMRMRD_UINT; }
+        template <> uint32_t ismrmrd_data_type<int>() { return ISMRMRD::ISMRMRD_INT; }
+        template <> uint32_t ismrmrd_data_type<float>() { return ISMRMRD::ISMRMRD_FLOAT; }
+        template <> uint32_t ismrmrd_data_type<double>() { return ISMRMRD::ISMRMRD_DOUBLE; }
+        template <> uint32_t ismrmrd_data_type< std::complex<float> >() { return ISMRMRD::ISMRMRD_CXFLOAT; }
+        template <> uint32_t ismrmrd_data_type< std::complex<double> >() { return ISMRMRD::ISMRMRD_CXDOUBLE; }
+
+        void put(std::ofstream& out, uint32_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+        void put(std::ofstream& out, uint64_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    }
+
+    GenericReconDebugExporter::GenericReconDebugExporter() : BaseClass()
+        , asynchronous_(true), memory_budget_(0), every_nth_(1), format_(FORMAT_ANALYZE), compress_(false)
+        , queued_bytes_(0), dropped_(0), writing_(false), stop_(false)
+    {
+    }
+
+    GenericReconDebugExporter::~GenericReconDebugExporter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queued_.notify_all();
+
+        // the writer thread empties the queue before it returns
+        if (writer_.joinable()) writer_.join();
+
+        if (dropped_ > 0)
+        {
+            GWARN_STREAM("GenericReconDebugExporter dropped " << dropped_ << " debug exports over the memory budget of " << memory_budget_ << " bytes");
+        }
+    }
+
+    void GenericReconDebugExporter::configure(bool asynchronous, size_t memory_budget, size_t every_nth, const std::string& format, bool compress)
+    {
+        this->flush();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        asynchronous_ = asynchronous;
+        memory_budget_ = memory_budget;
+        every_nth_ = (every_nth > 0) ? every_nth : 1;
+
+        if (format == "chunked")
+        {
+            format_ = FORMAT_CHUNKED;
+        }
+        else
+        {
+            if (format != "analyze") GWARN_STREAM("Unknown debug format " << format << ", the Analyze format is used");
+            format_ = FORMAT_ANALYZE;
+        }
+
+        compress_ = compress;
+#if !defined GADGETRON_COMPRESSION_ZSTD
+        if (compress_ && format_ == FORMAT_CHUNKED) GWARN_STREAM("Gadgetron is compiled without zstd, the debug output is not compressed");
+#endif //GADGETRON_COMPRESSION_ZSTD
+    }
+
+    void GenericReconDebugExporter::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        written_.wait(lock, [this]() { return jobs_.empty() && !writing_; });
+    }
+
+    size_t GenericReconDebugExporter::dropped()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+    bool GenericReconDebugExporter::sample(const std::string& filename)
+    {
+        // called with mutex_ held
+        size_t& n = exports_[filename];
+        return ((n++) % every_nth_) == 0;
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::submit(const hoNDArray<T>& a, const std::string& filename, bool complex_parts)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            if (!this->sample(filename)) return;
+
+            if (asynchronous_)
+            {
+                const size_t bytes = a.get_number_of_bytes();
+                if (memory_budget_ > 0 && queued_bytes_ + bytes > memory_budget_)
+                {
+                    if ((dropped_++) == 0) GWARN_STREAM("Debug output over the memory budget is dropped, first dropped : " << filename);
+                    return;
+                }
+
+                // the copy is the only work left on the calling thread
+                std::shared_ptr< hoNDArray<T> > copy(new hoNDArray<T>(a));
+
+                Job job;
+                job.bytes = bytes;
+                job.write = [this, copy, filename, complex_parts]() { this->write(*copy, filename, complex_parts); };
+
+                jobs_.push_back(job);
+                queued_bytes_ += bytes;
+
+                if (!writer_.joinable()) writer_ = std::thread(&GenericReconDebugExporter::run, this);
+
+                lock.unlock();
+                queued_.notify_one();
+                return;
+            }
+        }
+
+        this->write(a, filename, complex_parts);
+    }
+
+    void GenericReconDebugExporter::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            queued_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty()) break;
+
+            Job job = jobs_.front();
+            jobs_.pop_front();
+            writing_ = true;
+            lock.unlock();
+
+            try
+            {
+                job.write();
+            }
+            catch (...)
+            {
+                GERROR_STREAM("Exceptions happened when writing the debug output ... ");
+            }
+
+            // release the copy of the array before its bytes are given back to the budget
+            job.write = std::function<void()>();
+
+            lock.lock();
+            queued_bytes_ -= job.bytes;
+            writing_ = false;
+            written_.notify_all();
+        }
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::write(const hoNDArray<T>& a, const std::string& filename, bool complex_parts)
+    {
+        if (complex_parts)
+        {
+            this->write_complex_parts(a, filename);
+        }
+        else
+        {
+            this->write_file(a, filename);
+        }
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::write_complex_parts(const hoNDArray< std::complex<T> >& a, const std::string& filename)
+    {
+        hoNDArray<T> part(a.get_dimensions());
+        const size_t num = a.get_number_of_elements();
+
+        size_t n;
+        for (n = 0; n < num; n++) part(n) = a(n).real();
+        this->write_file(part, filename + "_REAL");
+
+        for (n = 0; n < num; n++) part(n) = a(n).imag();
+        this->write_file(part, filename + "_IMAG");
+
+        for (n = 0; n < num; n++) part(n) = std::abs(a(n));
+        this->write_file(part, filename + "_MAG");
+
+        for (n = 0; n < num; n++) part(n) = std::arg(a(n));
+        this->write_file(part, filename + "_PHASE");
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::write_complex_parts(const hoNDArray<T>& a, const std::string& filename)
+    {
+        this->write_file(a, filename);
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::write_file(const hoNDArray<T>& a, const std::string& filename)
+    {
+        if (format_ == FORMAT_CHUNKED)
+        {
+            this->write_chunked(a, filename);
+        }
+        else
+        {
+            this->export_array_impl(a, filename);
+        }
+    }
+
+    template <typename T>
+    void GenericReconDebugExporter::write_chunked(const hoNDArray<T>& a, const std::string& filename)
+    {
+        boost::filesystem::path boost_folder_path(filename);
+        boost_folder_path.remove_filename();
+        if (!boost::filesystem::is_directory(boost_folder_path))
+        {
+            GWARN_STREAM("Failed to write " << filename << " because parent folder does not exist");
+            return;
+        }
+
+        const uint32_t data_type = ismrmrd_data_type<T>();
+        const bool compress = compress_ && image_compression_available(IMAGE_COMPRESSION_LOSSLESS, (uint16_t)data_type);
+
+        std::ofstream out((filename + ".gtd").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            GWARN_STREAM("Failed to open " << filename << ".gtd");
+            return;
+        }
+
+        const size_t num = a.get_number_of_elements();
+        const size_t chunks = (num + DEBUG_CHUNK_ELEMENTS - 1) / DEBUG_CHUNK_ELEMENTS;
+
+        out.write(DEBUG_CHUNKED_MAGIC, sizeof(DEBUG_CHUNKED_MAGIC));
+        put(out, data_type);
+        put(out, (uint32_t)sizeof(T));
+        put(out, (uint32_t)(compress ? 1 : 0));
+        put(out, (uint32_t)a.get_number_of_dimensions());
+        for (size_t d = 0; d < a.get_number_of_dimensions(); d++) put(out, (uint64_t)a.get_size(d));
+        put(out, (uint64_t)chunks);
+
+        std::vector<char> compressed;
+        for (size_t c = 0; c < chunks; c++)
+        {
+            const size_t start = c * DEBUG_CHUNK_ELEMENTS;
+            const size_t elements = std::min(DEBUG_CHUNK_ELEMENTS, num - start);
+            const char* data = reinterpret_cast<const char*>(a.begin() + start);
+            size_t bytes = elements * sizeof(T);
+
+            if (compress)
+            {
+                compress_image_chunk(IMAGE_COMPRESSION_LOSSLESS, 0, (uint16_t)data_type, data, elements, 0, compressed);
+                data = compressed.data();
+                bytes = compressed.size();
+            }
+
+            put(out, (uint64_t)elements);
+            put(out, (uint64_t)bytes);
+            out.write(data, bytes);
+        }
+
+        if (!out.good()) GWARN_STREAM("Failed to write " << filename << ".gtd");
+    }
+
+#define GADGETRON_DEBUG_EXPORTER_INSTANTIATE(T) \
+    template void GenericReconDebugExporter::submit<T>(const hoNDArray<T>& a, const std::string& filename, bool complex_parts);
+
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(short)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(unsigned short)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(int)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(unsigned int)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(size_t)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(float)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(double)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(std::complex<float>)
+    GADGETRON_DEBUG_EXPORTER_INSTANTIATE(std::complex<double>)
+
+#undef GADGETRON_DEBUG_EXPORTER_INSTANTIATE
+}
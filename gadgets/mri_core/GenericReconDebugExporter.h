@@ -0,0 +1,130 @@
+/** \file   GenericReconDebugExporter.h
+    \brief  Exporter of the debug output of the generic recon gadgets, writing on a thread of its own.
+
+            Writing the intermediate arrays of a reconstruction to the debug folder on the recon thread slows it
+            down several fold. This exporter has the interface of ImageIOAnalyze, so the debug output of the gadgets
+            is unchanged, but export_array and export_array_complex only copy the array and queue it. A writer
+            thread of the exporter splits complex arrays into their parts and writes the files in the order they
+            were queued.
+
+            The arrays queued and not yet written take at most the memory budget, arrays beyond it are dropped and
+            counted instead of delaying the recon. With every_nth N only the 1st, N+1th, 2N+1th ... export of each
+            file name is kept, as the gadgets export the same names for every call of process.
+
+            The files are written in the Analyze format of ImageIOAnalyze, or in the chunked format below, which
+            avoids the header conversion and can compress the data (zstd, after separating the bytes of the samples):
+
+              <filename>.gtd
+                char[4]  magic "GTD1"
+                uint32   ISMRMRD data type of the elements, 0 for other types
+                uint32   size of an element in bytes
+                uint32   compression, 0 none, 1 zstd
+                uint32   number of dimensions D
+                uint64   dimensions [D]
+                uint64   number of chunks
+                per chunk: uint64 number of elements, uint64 number of stored bytes, the stored bytes
+
+            Integers are in host byte order. Every chunk holds at most 4M elements.
+*/
+
+#pragma once
+
+#include "gadgetron_mricore_export.h"
+#include "ImageIOAnalyze.h"
+
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Gadgetron {
+
+    class EXPORTGADGETSMRICORE GenericReconDebugExporter : public ImageIOAnalyze
+    {
+    public:
+
+        typedef ImageIOAnalyze BaseClass;
+
+        enum Format
+        {
+            FORMAT_ANALYZE = 0,
+            FORMAT_CHUNKED = 1
+        };
+
+        GenericReconDebugExporter();
+        /// writes the arrays still queued before returning
+        virtual ~GenericReconDebugExporter();
+
+        /// asynchronous: queue the exports for the writer thread, otherwise write them on the calling thread
+        /// memory_budget: bytes of the arrays waiting to be written, 0 for no limit
+        /// every_nth: keep every Nth export of a file name, 0 and 1 keep all
+        /// format: "analyze" or "chunked", compress: zstd compression of the chunked format if available
+        void configure(bool asynchronous, size_t memory_budget, size_t every_nth, const std::string& format, bool compress);
+
+        virtual void export_array(const hoNDArray<short>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<unsigned short>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<int>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<unsigned int>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<size_t>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<float>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray<double>& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray< std::complex<float> >& a, const std::string& filename) { this->submit(a, filename, false); }
+        virtual void export_array(const hoNDArray< std::complex<double> >& a, const std::string& filename) { this->submit(a, filename, false); }
+
+        /// real, imaginary, magnitude and phase of a, computed by the writer thread
+        template <typename T>
+        void export_array_complex(const hoNDArray<T>& a, const std::string& filename) { this->submit(a, filename, true); }
+
+        /// waits until the queued arrays are written
+        void flush();
+
+        /// number of exports dropped because the memory budget was exhausted
+        size_t dropped();
+
+    protected:
+
+        template <typename T> void submit(const hoNDArray<T>& a, const std::string& filename, bool complex_parts);
+
+        // writes on the calling thread, never through the virtual export_array
+        template <typename T> void write(const hoNDArray<T>& a, const std::string& filename, bool complex_parts);
+        template <typename T> void write_complex_parts(const hoNDArray< std::complex<T> >& a, const std::string& filename);
+        template <typename T> void write_complex_parts(const hoNDArray<T>& a, const std::string& filename);
+        template <typename T> void write_file(const hoNDArray<T>& a, const std::string& filename);
+        template <typename T> void write_chunked(const hoNDArray<T>& a, const std::string& filename);
+
+        // whether the export of filename is kept by the sampling
+        bool sample(const std::string& filename);
+
+        void run();
+
+        struct Job
+        {
+            std::function<void()> write;
+            size_t bytes;
+        };
+
+        bool asynchronous_;
+        size_t memory_budget_;
+        size_t every_nth_;
+        Format format_;
+        bool compress_;
+
+        std::map<std::string, size_t> exports_;
+
+        std::mutex mutex_;
+        std::condition_variable queued_;
+        std::condition_variable written_;
+        std::deque<Job> jobs_;
+        size_t queued_bytes_;
+        size_t dropped_;
+        bool writing_;
+        bool stop_;
+        std::thread writer_;
+    };
+}
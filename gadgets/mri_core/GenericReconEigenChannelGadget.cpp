@@ -1,6 +1,7 @@
 
 #include "GenericReconEigenChannelGadget.h"
 #include <iomanip>
+#include <sstream>
 
 #include "hoNDArray_reductions.h"
 #include "mri_core_def.h"
@@ -19,15 +20,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -45,6 +48,8 @@ namespace Gadgetron {
 
         KLT_.resize(NE);
 
+        calib_cache_protocol_key_ = GenericReconCalibrationCache::make_protocol_key(h);
+
         for (size_t e = 0; e < h.encoding.size(); e++)
         {
             ISMRMRD::EncodingSpace e_space = h.encoding[e].encodedSpace;
@@ -161,6 +166,26 @@ namespace Gadgetron {
                 bool average_N = average_all_ref_N.value();
                 bool average_S = average_all_ref_S.value();
 
+            // coefficients of an earlier series with the same reference, coils and geometry
+            std::string cache_key;
+            if (recompute_coeff && eigen_channel_cache_lifetime.value() > 0 && !calib_cache_protocol_key_.empty())
+            {
+                const IsmrmrdDataBuffered& src = rbit.ref_ ? *rbit.ref_ : rbit.data_;
+
+                std::ostringstream ostr;
+                ostr << calib_cache_protocol_key_ << "\neigen_channels encoding " << e << " [" << src.data_.get_size(0) << " " << CHA << " " << N << " " << S << " " << SLC << "] "
+                    << average_N << average_S << (calib_mode_[e] == Gadgetron::ISMRMRD_interleaved) << " "
+                    << upstream_coil_compression_thres.value() << " " << upstream_coil_compression_num_modesKept.value() << "\n"
+                    << GenericReconCalibrationCache::make_geometry_key(src.headers_);
+                cache_key = ostr.str();
+
+                if (GenericReconCalibrationCache::instance()->find_eigen_channels(cache_key, KLT_[e]))
+                {
+                    GDEBUG_CONDITION_STREAM(verbose.value(), "GenericReconEigenChannelGadget - KLT coefficients of an earlier series are used for encoding space " << e);
+                    recompute_coeff = false;
+                }
+            }
+
             if(recompute_coeff)
             {
                 if(rbit.ref_)
@@ -176,6 +201,11 @@ namespace Gadgetron {
                         (calib_mode_[e] == Gadgetron::ISMRMRD_interleaved), N, S, upstream_coil_compression_thres.value(), upstream_coil_compression_num_modesKept.value(), KLT_[e]);
                 }
 
+                if (!cache_key.empty())
+                {
+                    GenericReconCalibrationCache::instance()->insert_eigen_channels(cache_key, KLT_[e], eigen_channel_cache_lifetime.value());
+                }
+
                 if (verbose.value())
                 {
                     hoNDArray< std::complex<float> > E;
@@ -51,6 +51,10 @@ namespace Gadgetron {
         GADGET_PROPERTY(upstream_coil_compression_thres, double, "Threadhold for upstream coil compression", -1);
         GADGET_PROPERTY(upstream_coil_compression_num_modesKept, int, "Number of modes to keep for upstream coil compression", 0);
 
+        /// if eigen_channel_cache_lifetime > 0, the KLT coefficients are shared with later series with the same reference measurement, coils and slice geometry
+        /// see GenericReconCalibrationCache
+        GADGET_PROPERTY(eigen_channel_cache_lifetime, double, "Seconds the KLT coefficients are kept for later series with the same reference and geometry, 0 to disable", 0);
+
     protected:
 
         // --------------------------------------------------
@@ -68,6 +72,9 @@ namespace Gadgetron {
         // store the KLT coefficients for N, S, SLC at every encoding space
         std::vector< std::vector< std::vector< std::vector< KLTType > > > > KLT_;
 
+        // key of the protocol in the GenericReconCalibrationCache, empty if it cannot be cached
+        std::string calib_cache_protocol_key_;
+
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
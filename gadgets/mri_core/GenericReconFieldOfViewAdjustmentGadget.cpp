@@ -25,15 +25,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -134,24 +136,6 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
-    void GenericReconFieldOfViewAdjustmentGadget::perform_fft(size_t E2, const hoNDArray< std::complex<float> >& input, hoNDArray< std::complex<float> >& output)
-    {
-        if (E2>1)
-        {
-            if (&input == &output)
-                Gadgetron::hoNDFFT<float>::instance()->fft3c(output);
-            else
-                Gadgetron::hoNDFFT<float>::instance()->fft3c(input, output);
-        }
-        else
-        {
-            if (&input == &output)
-                Gadgetron::hoNDFFT<float>::instance()->fft2c(output);
-            else
-                Gadgetron::hoNDFFT<float>::instance()->fft2c(input, output);
-        }
-    }
-
     void GenericReconFieldOfViewAdjustmentGadget::perform_ifft(size_t E2, const hoNDArray< std::complex<float> >& input, hoNDArray< std::complex<float> >& output)
     {
         if (E2>1)
@@ -170,6 +154,18 @@ namespace Gadgetron {
         }
     }
 
+    void GenericReconFieldOfViewAdjustmentGadget::perform_fft_crop(size_t E2, const hoNDArray< std::complex<float> >& input, size_t sizeRO, size_t sizeE1, size_t sizeE2, hoNDArray< std::complex<float> >& output)
+    {
+        // only the kspace lines which are kept are transformed
+        std::vector<size_t> size(2);
+        size[0] = sizeRO;
+        size[1] = sizeE1;
+        if (E2>1) size.push_back(sizeE2);
+
+        Gadgetron::hoNDFFT<float>::instance()->fft_crop(input, size, kspace_buf_);
+        this->perform_ifft(E2, kspace_buf_, output);
+    }
+
     int GenericReconFieldOfViewAdjustmentGadget::adjust_FOV(IsmrmrdImageArray& recon_res)
     {
         try
@@ -208,9 +204,7 @@ namespace Gadgetron {
                 }
                 else if (RO >= reconSizeRO && E1 >= reconSizeE1 && E2 >= reconSizeE2)
                 {
-                    this->perform_fft(E2, recon_res.data_, kspace_buf_);
-                    Gadgetron::crop(reconSizeRO, reconSizeE1, reconSizeE2, &kspace_buf_, &res_);
-                    this->perform_ifft(E2, res_, recon_res.data_);
+                    this->perform_fft_crop(E2, recon_res.data_, reconSizeRO, reconSizeE1, reconSizeE2, recon_res.data_);
                 }
                 else
                 {
@@ -246,9 +240,7 @@ namespace Gadgetron {
                 }
                 else if (encodingE1 <= E1 - 1)
                 {
-                    this->perform_fft(E2, *pSrc, kspace_buf_);
-                    Gadgetron::crop(RO, encodingE1, E2, &kspace_buf_, pDst);
-                    this->perform_ifft(E2, *pDst, *pDst);
+                    this->perform_fft_crop(E2, *pSrc, RO, encodingE1, E2, *pDst);
 
                     pTmp = pSrc; pSrc = pDst; pDst = pTmp;
                 }
@@ -261,9 +253,7 @@ namespace Gadgetron {
                 }
                 else if (encodingE2 <= E2 - 1)
                 {
-                    this->perform_fft(E2, *pSrc, kspace_buf_);
-                    Gadgetron::crop(RO, pSrc->get_size(1), encodingE2, &kspace_buf_, pDst);
-                    this->perform_ifft(E2, *pDst, *pDst);
+                    this->perform_fft_crop(E2, *pSrc, RO, pSrc->get_size(1), encodingE2, *pDst);
 
                     pTmp = pSrc; pSrc = pDst; pDst = pTmp;
                 }
@@ -276,9 +266,7 @@ namespace Gadgetron {
                 }
                 else if (RO > reconSizeRO)
                 {
-                    this->perform_fft(E2, *pSrc, kspace_buf_);
-                    Gadgetron::crop(reconSizeRO, pSrc->get_size(1), pSrc->get_size(2), &kspace_buf_, pDst);
-                    this->perform_ifft(E2, *pDst, *pDst);
+                    this->perform_fft_crop(E2, *pSrc, reconSizeRO, pSrc->get_size(1), pSrc->get_size(2), *pDst);
 
                     pTmp = pSrc; pSrc = pDst; pDst = pTmp;
                 }
@@ -67,8 +67,10 @@ namespace Gadgetron {
         // adjust FOV
         int adjust_FOV(IsmrmrdImageArray& data);
 
-        // perform fft or ifft
-        void perform_fft(size_t E2, const hoNDArray< std::complex<float> >& input, hoNDArray< std::complex<float> >& output);
+        // perform ifft
         void perform_ifft(size_t E2, const hoNDArray< std::complex<float> >& input, hoNDArray< std::complex<float> >& output);
+
+        // crop the kspace of the input to [sizeRO sizeE1 sizeE2] and go back to image domain, output can be the input
+        void perform_fft_crop(size_t E2, const hoNDArray< std::complex<float> >& input, size_t sizeRO, size_t sizeE1, size_t sizeE2, hoNDArray< std::complex<float> >& output);
     };
 }
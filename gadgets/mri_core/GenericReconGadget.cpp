@@ -3,6 +3,10 @@
 #include "mri_core_kspace_filter.h"
 #include "hoNDArray_reductions.h"
 
+#include <cstring>
+#include <sstream>
+#include <typeinfo>
+
 namespace Gadgetron {
 
     GenericReconGadget::GenericReconGadget() : BaseClass()
@@ -17,14 +21,23 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
+        }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
+
+        {
+            size_t length = strnlen(mb->rd_ptr(), mb->length());
+            std::ostringstream ostr;
+            ostr << std::hex << GenericReconResultCache::hash_bytes(mb->rd_ptr(), length, 0xcbf29ce484222325ULL);
+            result_cache_protocol_key_ = ostr.str();
         }
 
         if (!h.acquisitionSystemInformation)
@@ -47,6 +60,15 @@ namespace Gadgetron {
         space_matrix_offset_E1_.resize(NE, 0);
         space_matrix_offset_E2_.resize(NE, 0);
 
+        calib_cache_protocol_key_ = GenericReconCalibrationCache::make_protocol_key(h);
+        coil_map_cache_geometry_.clear();
+        coil_map_cache_geometry_.resize(NE);
+
+        if (coil_map_cache_lifetime.value() > 0 && calib_cache_protocol_key_.empty())
+        {
+            GDEBUG_CONDITION_STREAM(verbose.value(), "No SenMap dependency in the protocol, coil maps are not shared with other series");
+        }
+
         size_t e;
         for (e = 0; e < h.encoding.size(); e++)
         {
@@ -271,6 +293,19 @@ namespace Gadgetron {
                 res.meta_[offset].append(GADGETRON_SEQUENCEDESCRIPTION, GADGETRON_IMAGE_SNR_MAP);
                 res.meta_[offset].set(GADGETRON_DATA_ROLE, GADGETRON_IMAGE_SNR_MAP);
             }
+            else if (data_role == GADGETRON_IMAGE_STD_MAP)
+            {
+                res.headers_(n, s, slc).image_type = ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE;
+
+                res.meta_[offset].append(GADGETRON_IMAGECOMMENT, "SNR");
+                res.meta_[offset].append(GADGETRON_IMAGECOMMENT, GADGETRON_IMAGE_STD_MAP);
+                res.meta_[offset].append(GADGETRON_SEQUENCEDESCRIPTION, "_STD_MAP");
+                res.meta_[offset].set(GADGETRON_DATA_ROLE, GADGETRON_IMAGE_STD_MAP);
+                res.meta_[offset].set(GADGETRON_USE_DEDICATED_SCALING_FACTOR, (long)1);
+
+                // the std map is not processed during e.g. partial fourier handling or kspace filter gadgets
+                res.meta_[offset].set(GADGETRON_SKIP_PROCESSING_AFTER_RECON, (long)1);
+            }
             else if (data_role == GADGETRON_IMAGE_RETRO)
             {
                 res.headers_(n, s, slc).image_type = ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE;
@@ -324,6 +359,8 @@ namespace Gadgetron {
                 }
             }
 
+            this->attach_timing(res, &recon_bit.data_.headers_);
+
             // send out the images
             Gadgetron::GadgetContainerMessage<IsmrmrdImageArray>* cm1 = new Gadgetron::GadgetContainerMessage<IsmrmrdImageArray>();
             *(cm1->getObjectPtr()) = res;
@@ -343,6 +380,35 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    int GenericReconGadget::send_out_image_array(IsmrmrdReconBit& recon_bit, IsmrmrdImageArray& res, size_t encoding, int series_num, const std::string& data_role, GenericReconResultCache::OutputList* outputs)
+    {
+        if (outputs)
+        {
+            outputs->push_back(GenericReconResultCache::Output());
+            outputs->back().res = res;
+            outputs->back().series_num = series_num;
+            outputs->back().data_role = data_role;
+        }
+
+        return this->send_out_image_array(recon_bit, res, encoding, series_num, data_role);
+    }
+
+    int GenericReconGadget::replay_image_arrays(IsmrmrdReconBit& recon_bit, const GenericReconResultCache::OutputList& outputs, size_t encoding)
+    {
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            IsmrmrdImageArray res = outputs[i].res;
+            GADGET_CHECK_RETURN(this->send_out_image_array(recon_bit, res, encoding, outputs[i].series_num, outputs[i].data_role) == GADGET_OK, GADGET_FAIL);
+        }
+
+        return GADGET_OK;
+    }
+
+    std::string GenericReconGadget::make_result_cache_key(const IsmrmrdReconBit& recon_bit, size_t encoding, const std::string& context)
+    {
+        return GenericReconResultCache::make_key(typeid(*this).name(), this->properties_, result_cache_protocol_key_ + "\n" + context, recon_bit, encoding);
+    }
+
     // ----------------------------------------------------------------------------------------
 
     void GenericReconGadget::make_ref_coil_map(IsmrmrdDataBuffered& ref_, std::vector<size_t>  recon_dims, hoNDArray< std::complex<float> >& ref_calib, hoNDArray< std::complex<float> >& ref_coil_map, size_t encoding)
@@ -352,6 +418,11 @@ namespace Gadgetron {
         {
             hoNDArray< std::complex<float> >& ref_data = ref_.data_;
 
+            if (encoding < coil_map_cache_geometry_.size())
+            {
+                coil_map_cache_geometry_[encoding] = GenericReconCalibrationCache::make_geometry_key(ref_.headers_);
+            }
+
             // sampling limits
             size_t sRO = ref_.sampling_.sampling_limits_[0].min_;
             size_t eRO = ref_.sampling_.sampling_limits_[0].max_;
@@ -445,44 +516,24 @@ namespace Gadgetron {
                 gt_exporter_.export_array_complex(ref_coil_map, debug_folder_full_path_ + "ref_coil_map_before_filtering_" + os.str());
             }
 
-            // filter the ref_coil_map
-            if (filter_RO_ref_coi_map_.get_size(0) != RO)
-            {
-                Gadgetron::generate_symmetric_filter_ref(ref_coil_map.get_size(0), ref_.sampling_.sampling_limits_[0].min_, ref_.sampling_.sampling_limits_[0].max_, filter_RO_ref_coi_map_);
-
-                if (!debug_folder_full_path_.empty())
-                {
-                    std::stringstream os;
-                    os << "encoding_" << encoding;
+            // filter the ref_coil_map, the filters are generated once for every size and sampled RO range
+            Gadgetron::hoKSpaceFilterCache< std::complex<float> >* filter_cache = Gadgetron::hoKSpaceFilterCache< std::complex<float> >::instance();
 
-                    gt_exporter_.export_array_complex(filter_RO_ref_coi_map_, debug_folder_full_path_ + "filter_RO_ref_coi_map_" + os.str());
-                }
-            }
-
-            if (filter_E1_ref_coi_map_.get_size(0) != E1)
+            filter_cache->symmetric_filter_ref(ref_coil_map.get_size(0), ref_.sampling_.sampling_limits_[0].min_, ref_.sampling_.sampling_limits_[0].max_, filter_RO_ref_coi_map_);
+            filter_cache->symmetric_filter_ref(ref_coil_map.get_size(1), 0, E1-1, filter_E1_ref_coi_map_);
+            if (E2 > 1)
             {
-                Gadgetron::generate_symmetric_filter_ref(ref_coil_map.get_size(1), 0, E1-1, filter_E1_ref_coi_map_);
-
-                if (!debug_folder_full_path_.empty())
-                {
-                    std::stringstream os;
-                    os << "encoding_" << encoding;
-
-                    gt_exporter_.export_array_complex(filter_E1_ref_coi_map_, debug_folder_full_path_ + "filter_E1_ref_coi_map_" + os.str());
-                }
+                filter_cache->symmetric_filter_ref(ref_coil_map.get_size(2), 0, E2-1, filter_E2_ref_coi_map_);
             }
 
-            if ( (E2 > 1) && (filter_E2_ref_coi_map_.get_size(0) != E2) )
+            if (!debug_folder_full_path_.empty())
             {
-                Gadgetron::generate_symmetric_filter_ref(ref_coil_map.get_size(2), 0, E2-1, filter_E2_ref_coi_map_);
-
-                if (!debug_folder_full_path_.empty())
-                {
-                    std::stringstream os;
-                    os << "encoding_" << encoding;
+                std::stringstream os;
+                os << "encoding_" << encoding;
 
-                    gt_exporter_.export_array_complex(filter_E2_ref_coi_map_, debug_folder_full_path_ + "filter_E2_ref_coi_map_" + os.str());
-                }
+                gt_exporter_.export_array_complex(filter_RO_ref_coi_map_, debug_folder_full_path_ + "filter_RO_ref_coi_map_" + os.str());
+                gt_exporter_.export_array_complex(filter_E1_ref_coi_map_, debug_folder_full_path_ + "filter_E1_ref_coi_map_" + os.str());
+                if (E2 > 1) gt_exporter_.export_array_complex(filter_E2_ref_coi_map_, debug_folder_full_path_ + "filter_E2_ref_coi_map_" + os.str());
             }
 
             hoNDArray< std::complex<float> > ref_recon_buf;
@@ -529,9 +580,6 @@ namespace Gadgetron {
     {
         try
         {
-            coil_map = ref_coil_map;
-            Gadgetron::clear(coil_map);
-
             size_t E2 = ref_coil_map.get_size(2);
             if (E2 > 1)
             {
@@ -542,6 +590,28 @@ namespace Gadgetron {
                 Gadgetron::hoNDFFT<float>::instance()->ifft2c(ref_coil_map, complex_im_recon_buf_);
             }
 
+            // coil map of an earlier series with the same reference, coils and geometry
+            std::string cache_key;
+            if (coil_map_cache_lifetime.value() > 0 && !calib_cache_protocol_key_.empty() && e < coil_map_cache_geometry_.size() && !coil_map_cache_geometry_[e].empty())
+            {
+                std::ostringstream ostr;
+                ostr << calib_cache_protocol_key_ << "\ncoil_map " << coil_map_algorithm.value() << " encoding " << e << " [";
+                for (size_t d = 0; d < ref_coil_map.get_number_of_dimensions(); d++) ostr << ref_coil_map.get_size(d) << " ";
+                ostr << "]\n" << coil_map_cache_geometry_[e];
+                cache_key = ostr.str();
+
+                if (GenericReconCalibrationCache::instance()->find_coil_map(cache_key, coil_map) && coil_map.dimensions_equal(&ref_coil_map))
+                {
+                    float match = Gadgetron::coil_map_match(complex_im_recon_buf_, coil_map);
+                    GDEBUG_CONDITION_STREAM(verbose.value(), "Cached coil map explains " << match << " of the ref image energy for encoding space " << e);
+
+                    if (match >= coil_map_cache_min_match.value()) return;
+                }
+            }
+
+            coil_map = ref_coil_map;
+            Gadgetron::clear(coil_map);
+
             if (!debug_folder_full_path_.empty())
             {
                 std::stringstream os;
@@ -575,6 +645,11 @@ namespace Gadgetron {
 
                 gt_exporter_.export_array_complex(coil_map, debug_folder_full_path_ + "coil_map_" + os.str());
             }
+
+            if (!cache_key.empty())
+            {
+                GenericReconCalibrationCache::instance()->insert_coil_map(cache_key, coil_map, coil_map_cache_lifetime.value());
+            }
         }
         catch (...)
         {
@@ -37,6 +37,12 @@ namespace Gadgetron {
         GADGET_PROPERTY_LIMITS(coil_map_algorithm, std::string, "Method for coil map estimation", "Inati",
             GadgetPropertyLimitsEnumeration, "Inati", "Inati_Iter");
 
+        /// coil maps shared with later series, see GenericReconCalibrationCache
+        /// if coil_map_cache_lifetime > 0, a series with the same reference measurement, coils and slice geometry uses the coil map of an earlier series
+        /// a cached coil map is only used if it explains at least coil_map_cache_min_match of the energy of the current ref images
+        GADGET_PROPERTY(coil_map_cache_lifetime, double, "Seconds a coil map is kept for later series with the same reference and geometry, 0 to disable", 0);
+        GADGET_PROPERTY(coil_map_cache_min_match, double, "Minimal fraction of the ref image energy explained by a cached coil map for it to be used", 0.9);
+
     protected:
 
         // --------------------------------------------------
@@ -72,6 +78,15 @@ namespace Gadgetron {
         std::vector<int> space_matrix_offset_E1_;
         std::vector<int> space_matrix_offset_E2_;
 
+        // key of the protocol in the GenericReconCalibrationCache, empty if it cannot be cached
+        std::string calib_cache_protocol_key_;
+
+        // slice geometry of the last ref for every encoding space, set by make_ref_coil_map
+        std::vector<std::string> coil_map_cache_geometry_;
+
+        // hash of the protocol, part of the context of the GenericReconResultCache keys
+        std::string result_cache_protocol_key_;
+
         // --------------------------------------------------
         // gadget functions
         // --------------------------------------------------
@@ -98,6 +113,15 @@ namespace Gadgetron {
         // send out the recon results
         virtual int send_out_image_array(IsmrmrdReconBit& recon_bit, IsmrmrdImageArray& res, size_t encoding, int series_num, const std::string& data_role);
 
+        // send out the recon results, and append a copy of res as it was given to outputs if it is not NULL, see GenericReconResultCache
+        int send_out_image_array(IsmrmrdReconBit& recon_bit, IsmrmrdImageArray& res, size_t encoding, int series_num, const std::string& data_role, GenericReconResultCache::OutputList* outputs);
+
+        // send out the image arrays of an earlier identical input again
+        int replay_image_arrays(IsmrmrdReconBit& recon_bit, const GenericReconResultCache::OutputList& outputs, size_t encoding);
+
+        // key of the GenericReconResultCache for encoding space encoding of recon_bit, context is any state the result depends on besides the input
+        std::string make_result_cache_key(const IsmrmrdReconBit& recon_bit, size_t encoding, const std::string& context);
+
         // compute snr scaling factor from effective acceleration rate and sampling region
         void compute_snr_scaling_factor(IsmrmrdReconBit& recon_bit, float& effective_acce_factor, float& snr_scaling_ratio);
 
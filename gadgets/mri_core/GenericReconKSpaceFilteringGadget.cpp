@@ -24,15 +24,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -171,143 +173,32 @@ namespace Gadgetron {
         }
 
         // ----------------------------------------------------------
-        // filter create if needed
+        // filters for the sampled kspace, generated once for every size and sampling
         // ----------------------------------------------------------
-        size_t ii;
+        Gadgetron::hoKSpaceFilterCache< std::complex<float> >* filter_cache = Gadgetron::hoKSpaceFilterCache< std::complex<float> >::instance();
 
-        if (filter_RO_[encoding].get_number_of_elements() != RO)
-        {
-            if (sampling_limits[0].min_ == 0 || sampling_limits[0].max_ == RO - 1)
-            {
-                if (filterRO.value() != "None")
-                {
-                    filter_RO_[encoding].create(RO);
-                    Gadgetron::generate_symmetric_filter(RO, filter_RO_[encoding], Gadgetron::get_kspace_filter_type(filterRO.value()), filterRO_sigma.value(), (size_t)std::ceil(filterRO_width.value()*RO));
-                }
-            }
-            else
-            {
-                if (filterRO.value() != "None")
-                {
-                    size_t len;
-                    this->find_kspace_sampled_range(sampling_limits[0].min_, sampling_limits[0].max_, RO, len);
-
-                    hoNDArray< std::complex<float> > f;
-                    Gadgetron::generate_symmetric_filter(len, f, Gadgetron::get_kspace_filter_type(filterRO.value()), filterRO_sigma.value(), (size_t)std::ceil(filterRO_width.value()*len));
-                    Gadgetron::pad(RO, &f, &filter_RO_[encoding]);
-                }
-            }
+        filter_cache->symmetric_filter(RO, sampling_limits[0].min_, sampling_limits[0].max_, Gadgetron::get_kspace_filter_type(filterRO.value()), filterRO_sigma.value(), filterRO_width.value(), filter_RO_[encoding]);
+        filter_cache->symmetric_filter(E1, sampling_limits[1].min_, sampling_limits[1].max_, Gadgetron::get_kspace_filter_type(filterE1.value()), filterE1_sigma.value(), filterE1_width.value(), filter_E1_[encoding]);
 
-            if (filter_RO_[encoding].get_number_of_elements() == RO)
-            {
-                if (sampling_limits[0].min_ != 0 || sampling_limits[0].max_ != RO - 1)
-                {
-                    // compensate the sacling from min_ to max_
-                    std::complex<float> sos = 0.0f;
-                    for (ii = sampling_limits[0].min_; ii <= sampling_limits[0].max_; ii++)
-                    {
-                        sos += filter_RO_[encoding](ii)* std::conj(filter_RO_[encoding](ii));
-                    }
-
-                    Gadgetron::scal((float)(1.0 / std::sqrt(std::abs(sos) / (sampling_limits[0].max_ - sampling_limits[0].min_ + 1))), filter_RO_[encoding]);
-                }
-            }
-
-            if (!debug_folder_full_path_.empty())
-            {
-                if(filter_RO_[encoding].get_number_of_elements()>0)
-                    gt_exporter_.export_array_complex(filter_RO_[encoding], debug_folder_full_path_ + "filterRO_" + str);
-            }
+        if (E2 > 1)
+        {
+            filter_cache->symmetric_filter(E2, sampling_limits[2].min_, sampling_limits[2].max_, Gadgetron::get_kspace_filter_type(filterE2.value()), filterE2_sigma.value(), filterE2_width.value(), filter_E2_[encoding]);
         }
-
-        if (filter_E1_[encoding].get_number_of_elements() != E1)
+        else
         {
-            if (sampling_limits[1].min_ == 0 || sampling_limits[1].max_ == E1 - 1)
-            {
-                if (filterE1.value() != "None")
-                {
-                    filter_E1_[encoding].create(E1);
-                    Gadgetron::generate_symmetric_filter(E1, filter_E1_[encoding], Gadgetron::get_kspace_filter_type(filterE1.value()), filterE1_sigma.value(), (size_t)std::ceil(filterE1_width.value()*E1));
-                }
-            }
-            else
-            {
-                if (filterE1.value() != "None")
-                {
-                    size_t len;
-                    this->find_kspace_sampled_range(sampling_limits[1].min_, sampling_limits[1].max_, E1, len);
-
-                    hoNDArray< std::complex<float> > f;
-                    Gadgetron::generate_symmetric_filter(len, f, Gadgetron::get_kspace_filter_type(filterE1.value()), filterE1_sigma.value(), (size_t)std::ceil(filterE1_width.value()*len));
-                    Gadgetron::pad(E1, &f, &filter_E1_[encoding]);
-                }
-            }
-
-            if (filter_E1_[encoding].get_number_of_elements() == E1)
-            {
-                if (sampling_limits[1].min_ != 0 || sampling_limits[1].max_ != E1 - 1)
-                {
-                    // compensate the sacling from min_ to max_
-                    std::complex<float> sos = 0.0f;
-                    for (ii = sampling_limits[1].min_; ii <= sampling_limits[1].max_; ii++)
-                    {
-                        sos += filter_E1_[encoding](ii)* std::conj(filter_E1_[encoding](ii));
-                    }
-
-                    Gadgetron::scal((float)(1.0 / std::sqrt(std::abs(sos) / (sampling_limits[1].max_ - sampling_limits[1].min_ + 1))), filter_E1_[encoding]);
-                }
-            }
-
-            if (!debug_folder_full_path_.empty())
-            {
-                if (filter_E1_[encoding].get_number_of_elements()>0)
-                    gt_exporter_.export_array_complex(filter_E1_[encoding], debug_folder_full_path_ + "filterE1_" + str);
-            }
+            filter_E2_[encoding].clear();
         }
 
-        if (E2>1 && filter_E2_[encoding].get_number_of_elements() != E2)
+        if (!debug_folder_full_path_.empty())
         {
-            if (sampling_limits[2].min_ == 0 || sampling_limits[2].max_ == E1 - 1)
-            {
-                if (filterE2.value() != "None")
-                {
-                    filter_E2_[encoding].create(E2);
-                    Gadgetron::generate_symmetric_filter(E2, filter_E2_[encoding], Gadgetron::get_kspace_filter_type(filterE2.value()), filterE2_sigma.value(), (size_t)std::ceil(filterE2_width.value()*E2));
-                }
-            }
-            else
-            {
-                if (filterE2.value() != "None")
-                {
-                    size_t len;
-                    this->find_kspace_sampled_range(sampling_limits[2].min_, sampling_limits[2].max_, E2, len);
-
-                    hoNDArray< std::complex<float> > f;
-                    Gadgetron::generate_symmetric_filter(len, f, Gadgetron::get_kspace_filter_type(filterE2.value()), filterE2_sigma.value(), (size_t)std::ceil(filterE2_width.value()*len));
-                    Gadgetron::pad(E2, &f, &filter_E2_[encoding]);
-                }
-            }
+            if (filter_RO_[encoding].get_number_of_elements()>0)
+                gt_exporter_.export_array_complex(filter_RO_[encoding], debug_folder_full_path_ + "filterRO_" + str);
 
-            if (filter_E2_[encoding].get_number_of_elements() == E2)
-            {
-                if (sampling_limits[2].min_ != 0 || sampling_limits[2].max_ != E1 - 1)
-                {
-                    // compensate the sacling from min_ to max_
-                    std::complex<float> sos = 0.0f;
-                    for (ii = sampling_limits[2].min_; ii <= sampling_limits[2].max_; ii++)
-                    {
-                        sos += filter_E2_[encoding](ii)* std::conj(filter_E2_[encoding](ii));
-                    }
-
-                    Gadgetron::scal((float)(1.0 / std::sqrt(std::abs(sos) / (sampling_limits[2].max_ - sampling_limits[2].min_ + 1))), filter_E2_[encoding]);
-                }
-            }
+            if (filter_E1_[encoding].get_number_of_elements()>0)
+                gt_exporter_.export_array_complex(filter_E1_[encoding], debug_folder_full_path_ + "filterE1_" + str);
 
-            if (!debug_folder_full_path_.empty())
-            {
-                if (filter_E2_[encoding].get_number_of_elements()>0)
-                    gt_exporter_.export_array_complex(filter_E2_[encoding], debug_folder_full_path_ + "filterE2_" + str);
-            }
+            if (filter_E2_[encoding].get_number_of_elements()>0)
+                gt_exporter_.export_array_complex(filter_E2_[encoding], debug_folder_full_path_ + "filterE2_" + str);
         }
 
         // ----------------------------------------------------------
@@ -336,72 +227,12 @@ namespace Gadgetron {
             if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(kspace_buf_, debug_folder_full_path_ + "kspace_before_filtering_" + str); }
 
             // ----------------------------------------------------------
-            // filtering
+            // filtering, the separable filter is applied in one pass
             // ----------------------------------------------------------
 
-            bool inKSpace = true;
-
-            if ( (filter_RO_[encoding].get_number_of_elements() == RO)
-                && (filter_E1_[encoding].get_number_of_elements() == E1)
-                && (E2>1) && (filter_E2_[encoding].get_number_of_elements() == E2) )
-            {
-                if (perform_timing.value()) { gt_timer_.start("GenericReconKSpaceFilteringGadget, apply_kspace_filter_ROE1E2 ... "); }
-                Gadgetron::apply_kspace_filter_ROE1E2(kspace_buf_, filter_RO_[encoding], filter_E1_[encoding], filter_E2_[encoding], filter_res_);
-                if (perform_timing.value()) { gt_timer_.stop(); }
-
-                if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(filter_res_, debug_folder_full_path_ + "kspace_after_filtered_" + str); }
-                inKSpace = true;
-            }
-            else if ( (filter_RO_[encoding].get_number_of_elements() == RO) && (filter_E1_[encoding].get_number_of_elements() == E1) )
-            {
-                if (perform_timing.value()) { gt_timer_.start("GenericReconKSpaceFilteringGadget, apply_kspace_filter_ROE1 ... "); }
-                Gadgetron::apply_kspace_filter_ROE1(kspace_buf_, filter_RO_[encoding], filter_E1_[encoding], filter_res_);
-                if (perform_timing.value()) { gt_timer_.stop(); }
-
-                if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(filter_res_, debug_folder_full_path_ + "kspace_after_filtered_" + str); }
-
-                inKSpace = true;
-            }
-            else
-            {
-                filter_res_ = kspace_buf_;
-
-                hoNDArray< std::complex<float> >* pSrc = &kspace_buf_;
-                hoNDArray< std::complex<float> >* pDst = &filter_res_;
-
-                bool filterPerformed = false;
-
-                if (filter_RO_[encoding].get_number_of_elements() == RO)
-                {
-                    Gadgetron::apply_kspace_filter_RO(*pSrc, filter_RO_[encoding], *pDst);
-                    std::swap(pSrc, pDst);
-                    filterPerformed = true;
-                }
-
-                if (filter_E1_[encoding].get_number_of_elements() == E1)
-                {
-                    Gadgetron::apply_kspace_filter_E1(*pSrc, filter_E1_[encoding], *pDst);
-                    std::swap(pSrc, pDst);
-                    filterPerformed = true;
-                }
-
-                if (filter_E2_[encoding].get_number_of_elements() == E2)
-                {
-                    Gadgetron::apply_kspace_filter_E2(*pSrc, filter_E2_[encoding], *pDst);
-                    std::swap(pSrc, pDst);
-                    filterPerformed = true;
-                }
-
-                if (filterPerformed)
-                {
-                    if (pDst != &filter_res_)
-                    {
-                        filter_res_ = *pDst;
-                    }
-                }
-
-                inKSpace = true;
-            }
+            if (perform_timing.value()) { gt_timer_.start("GenericReconKSpaceFilteringGadget, apply_kspace_filter ... "); }
+            Gadgetron::apply_kspace_filter(kspace_buf_, filter_RO_[encoding], filter_E1_[encoding], filter_E2_[encoding], filter_res_);
+            if (perform_timing.value()) { gt_timer_.stop(); }
 
             if (!debug_folder_full_path_.empty()) { gt_exporter_.export_array_complex(filter_res_, debug_folder_full_path_ + "kspace_after_filtering_" + str); }
 
@@ -436,19 +267,6 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
-    void GenericReconKSpaceFilteringGadget::find_kspace_sampled_range(size_t min, size_t max, size_t len, size_t& r)
-    {
-        GADGET_CHECK_THROW(min < max);
-        GADGET_CHECK_THROW(min < len);
-        GADGET_CHECK_THROW(max < len);
-
-        size_t hmin = len / 2 - min;
-        size_t hmax = max - len / 2;
-        r = (hmax>hmin) ? 2*hmax+1 : 2*hmin+1;
-
-        if (r > len) r = len;
-    }
-
     int GenericReconKSpaceFilteringGadget::close(unsigned long flags)
     {
         GDEBUG_CONDITION_STREAM(true, "GenericReconKSpaceFilteringGadget - close(flags) : " << flags);
@@ -73,7 +73,7 @@ namespace Gadgetron {
         // variable for recon
         // --------------------------------------------------
 
-        // kspace filter for every encoding space
+        // kspace filter for every encoding space, from the hoKSpaceFilterCache
         std::vector< hoNDArray< std::complex<float> > > filter_RO_;
         std::vector< hoNDArray< std::complex<float> > > filter_E1_;
         std::vector< hoNDArray< std::complex<float> > > filter_E2_;
@@ -94,8 +94,5 @@ namespace Gadgetron {
 
         // close call
         int close(unsigned long flags);
-
-        // find kspace sampled range
-        void find_kspace_sampled_range(size_t min, size_t max, size_t len, size_t& r);
     };
 }
@@ -23,15 +23,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(), h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -108,7 +110,8 @@ namespace Gadgetron {
             return GADGET_OK;
         }
 
-        // make a copy for results
+        // make a copy for results, it shares the buffers until it is written to
+        m1->getObjectPtr()->share();
         Gadgetron::GadgetContainerMessage<IsmrmrdImageArray>* cm1 = new Gadgetron::GadgetContainerMessage<IsmrmrdImageArray>();
         *(cm1->getObjectPtr()) = *(m1->getObjectPtr());
 
@@ -134,7 +137,7 @@ namespace Gadgetron {
         hoNDArray<real_value_type> stdMap(RO, E1, E2, CHA, 1, S, SLC);
         Gadgetron::clear(stdMap);
 
-        hoNDArray<T>& snrMap = cm1->getObjectPtr()->data_;
+        const hoNDArray<T>& snrMap = cm1->getObjectPtr()->data_;
 
         size_t n, s, slc;
 
@@ -144,7 +147,7 @@ namespace Gadgetron {
             {
                 for (n = startN; n < N; n++)
                 {
-                    T* pSNRMap = &(snrMap(0, 0, 0, 0, n, s, slc));
+                    const T* pSNRMap = &(snrMap(0, 0, 0, 0, n, s, slc));
                     memcpy(repBuf.begin() + (n - startN)*RO*E1*E2*CHA, pSNRMap, sizeof(T)*RO*E1*E2*CHA);
                 }
 
@@ -74,6 +74,31 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    void GenericReconPartialFourierHandlingFilterGadget::pf_res_nonzero_region(std::vector<size_t>& offset, std::vector<size_t>& len)
+    {
+        BaseClass::pf_res_nonzero_region(offset, len);
+
+        // partial_fourier_filter applies the filters of the kspace size only
+        const hoNDArray<T>* filters[3] = { &filter_pf_RO_, &filter_pf_E1_, &filter_pf_E2_ };
+
+        for (size_t d = 0; d < len.size(); d++)
+        {
+            const hoNDArray<T>& filter = *filters[d];
+            size_t n = len[d];
+            if (filter.get_number_of_elements() != n) continue;
+
+            size_t first = 0;
+            while (first < n && filter(first) == T(0)) first++;
+            if (first == n) continue;
+
+            size_t last = n;
+            while (filter(last - 1) == T(0)) last--;
+
+            offset[d] = first;
+            len[d] = last - first;
+        }
+    }
+
     // ----------------------------------------------------------------------------------------
 
     GADGET_FACTORY_DECLARE(GenericReconPartialFourierHandlingFilterGadget)
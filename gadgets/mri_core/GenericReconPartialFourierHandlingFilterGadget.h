@@ -45,5 +45,8 @@ namespace Gadgetron {
         hoNDArray<T> filter_pf_E2_;
 
         virtual int perform_partial_fourier_handling();
+
+        // the filters are zero outside the sampled region, and so is pf_res_
+        virtual void pf_res_nonzero_region(std::vector<size_t>& offset, std::vector<size_t>& len);
     };
 }
@@ -28,15 +28,17 @@ namespace Gadgetron {
     {
         GADGET_CHECK_RETURN(BaseClass::process_config(mb) == GADGET_OK, GADGET_FAIL);
 
-        ISMRMRD::IsmrmrdHeader h;
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
         try
         {
-            deserialize(mb->rd_ptr(),h);
+            header = this->get_ismrmrd_header(mb);
         }
         catch (...)
         {
             GDEBUG("Error parsing ISMRMRD Header");
+            header.reset(new ISMRMRD::IsmrmrdHeader());
         }
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (!h.acquisitionSystemInformation)
         {
@@ -250,7 +252,21 @@ namespace Gadgetron {
         // ----------------------------------------------------------
         // go back to image domain
         // ----------------------------------------------------------
-        if (E2 > 1)
+        std::vector<size_t> offset, len;
+        this->pf_res_nonzero_region(offset, len);
+
+        std::vector<size_t> size(len.size());
+        for (size_t d = 0; d < size.size(); d++) size[d] = pf_res_.get_size(d);
+
+        if (len != size)
+        {
+            hoNDArrayView<T> region(pf_res_);
+            for (size_t d = 0; d < len.size(); d++) region = region.range(d, offset[d], len[d]);
+            region.copy_to(pf_res_region_);
+
+            Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft_pad(pf_res_region_, size, offset, recon_res_->data_);
+        }
+        else if (E2 > 1)
         {
             Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft3c(pf_res_, recon_res_->data_);
         }
@@ -280,6 +296,15 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    void GenericReconPartialFourierHandlingGadget::pf_res_nonzero_region(std::vector<size_t>& offset, std::vector<size_t>& len)
+    {
+        size_t D = (pf_res_.get_size(2) > 1) ? 3 : 2;
+
+        offset.assign(D, 0);
+        len.resize(D);
+        for (size_t d = 0; d < D; d++) len[d] = pf_res_.get_size(d);
+    }
+
     int GenericReconPartialFourierHandlingGadget::close(unsigned long flags)
     {
         GDEBUG_CONDITION_STREAM(true, "GenericReconPartialFourierHandlingGadget - close(flags) : " << flags);
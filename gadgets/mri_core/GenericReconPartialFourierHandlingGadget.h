@@ -71,6 +71,9 @@ namespace Gadgetron {
         // results of pf handling
         hoNDArray<T> pf_res_;
 
+        // the region of pf_res_ which is not zero
+        hoNDArray<T> pf_res_region_;
+
         // --------------------------------------------------
         // functional functions
         // --------------------------------------------------
@@ -87,5 +90,9 @@ namespace Gadgetron {
         // --------------------------------------------------
         virtual int perform_partial_fourier_handling() = 0;
 
+        // pf_res_ is zero outside [offset, offset+len) along RO, E1 and, for E2>1, E2
+        // the lines outside are then not transformed back to the image domain; the default is the whole kspace
+        virtual void pf_res_nonzero_region(std::vector<size_t>& offset, std::vector<size_t>& len);
+
     };
 }
@@ -30,6 +30,9 @@ int ImageArraySplitGadget::process( GadgetContainerMessage<IsmrmrdImageArray>* m
     img_dims[2] = Z;
     img_dims[3] = CHA;
 
+    // the images reference the array instead of copying it
+    imagearr.data_.share();
+
     //Loop over N, S and LOC
     for (uint16_t loc=0; loc < LOC; loc++) {
         for (uint16_t s=0; s < S; s++) {                
@@ -45,14 +48,13 @@ int ImageArraySplitGadget::process( GadgetContainerMessage<IsmrmrdImageArray>* m
                 GadgetContainerMessage< hoNDArray< std::complex<float> > >* cm2 = 
                         new GadgetContainerMessage<hoNDArray< std::complex<float> > >();
 
-                try{cm2->getObjectPtr()->create(&img_dims);}
+                try{imagearr.data_.get_shared_sub_array(imagearr.data_.calculate_offset(0,0,0,0,n,s,loc), img_dims, *cm2->getObjectPtr());}
                 catch (std::runtime_error &err){
                     GEXCEPTION(err,"Unable to allocate new image\n");
                     cm1->release();
                     cm2->release();
                     return GADGET_FAIL;
                 }
-                memcpy(cm2->getObjectPtr()->get_data_ptr(), &imagearr.data_(0,0,0,0,n,s,loc), X*Y*Z*CHA*sizeof(std::complex<float>));
                 //Chain them
                 cm1->cont(cm2);
 
@@ -0,0 +1,174 @@
+/*
+*       ImageArrayToFixPointGadget.cpp
+*       Author: Hui Xue
+*/
+
+#include "GadgetIsmrmrdReadWrite.h"
+#include "ImageArrayToFixPointGadget.h"
+#include "mri_core_image_conversion.h"
+#include "mri_core_def.h"
+
+namespace Gadgetron
+{
+    template <typename T>
+    ImageArrayToFixPointGadget<T>::ImageArrayToFixPointGadget()
+        : max_intensity_value_(std::numeric_limits<T>::max()),
+          min_intensity_value_(std::numeric_limits<T>::min()),
+          intensity_offset_value_(0)
+    {
+    }
+
+    template <typename T>
+    ImageArrayToFixPointGadget<T>::~ImageArrayToFixPointGadget()
+    {
+    }
+
+    template <typename T>
+    int ImageArrayToFixPointGadget<T>::process_config(ACE_Message_Block* mb)
+    {
+        // gadget parameters
+        max_intensity_value_ = max_intensity.value();
+        min_intensity_value_ = min_intensity.value();
+        intensity_offset_value_ = intensity_offset.value();
+
+        return GADGET_OK;
+    }
+
+    template <typename T>
+    int ImageArrayToFixPointGadget<T>::process(GadgetContainerMessage<IsmrmrdImageArray>* m1)
+    {
+        IsmrmrdImageArray& imagearr = *m1->getObjectPtr();
+
+        uint16_t data_type;
+        if (typeid(T) == typeid(unsigned short))
+        {
+            data_type = ISMRMRD::ISMRMRD_USHORT;
+        }
+        else if (typeid(T) == typeid(short))
+        {
+            data_type = ISMRMRD::ISMRMRD_SHORT;
+        }
+        else
+        {
+            GDEBUG("Unknown data type, bailing out\n");
+            m1->release();
+            return GADGET_FAIL;
+        }
+
+        // 7D, fixed order [X, Y, Z, CHA, N, S, LOC]
+        size_t X = imagearr.data_.get_size(0);
+        size_t Y = imagearr.data_.get_size(1);
+        size_t Z = imagearr.data_.get_size(2);
+        size_t CHA = imagearr.data_.get_size(3);
+        size_t N = imagearr.data_.get_size(4);
+        size_t S = imagearr.data_.get_size(5);
+        size_t LOC = imagearr.data_.get_size(6);
+
+        std::vector<size_t> img_dims(4);
+        img_dims[0] = X;
+        img_dims[1] = Y;
+        img_dims[2] = Z;
+        img_dims[3] = CHA;
+
+        // images in the order of ImageArraySplitGadget, n is the fastest
+        long long num = (long long)(N*S*LOC);
+        std::vector< GadgetContainerMessage<ISMRMRD::ImageHeader>* > images(num, (GadgetContainerMessage<ISMRMRD::ImageHeader>*)NULL);
+
+        float auto_scale = auto_scale_max_value.value();
+        int failed = 0;
+
+        long long ii;
+
+#pragma omp parallel for default(none) private(ii) shared(num, N, S, X, Y, Z, CHA, img_dims, imagearr, images, auto_scale, failed, data_type) schedule(dynamic) if(num>1)
+        for (ii = 0; ii < num; ii++)
+        {
+            size_t loc = ii / (N*S);
+            size_t s = (ii - loc*N*S) / N;
+            size_t n = ii - loc*N*S - s*N;
+
+            GadgetContainerMessage<ISMRMRD::ImageHeader>* cm1 = new GadgetContainerMessage<ISMRMRD::ImageHeader>();
+            memcpy(cm1->getObjectPtr(), &imagearr.headers_(n, s, loc), sizeof(ISMRMRD::ImageHeader));
+
+            GadgetContainerMessage< hoNDArray<T> >* cm2 = new GadgetContainerMessage< hoNDArray<T> >();
+            cm1->cont(cm2);
+            images[ii] = cm1;
+
+            try
+            {
+                hoNDArray< std::complex<float> > im(img_dims, &imagearr.data_(0, 0, 0, 0, n, s, loc));
+                Gadgetron::complex_to_fix_point(im, cm1->getObjectPtr()->image_type, auto_scale,
+                    min_intensity_value_, max_intensity_value_, intensity_offset_value_, *cm2->getObjectPtr());
+            }
+            catch (...)
+            {
+                GERROR("ImageArrayToFixPointGadget, unable to convert image of type %d\n", cm1->getObjectPtr()->image_type);
+#pragma omp atomic
+                failed++;
+                continue;
+            }
+
+            cm1->getObjectPtr()->data_type = data_type;
+
+            if (imagearr.meta_.size() > 0)
+            {
+                GadgetContainerMessage< ISMRMRD::MetaContainer >* cm3 = new GadgetContainerMessage< ISMRMRD::MetaContainer >();
+                *cm3->getObjectPtr() = imagearr.meta_[ii];
+                cm2->cont(cm3);
+
+                uint16_t image_type = cm1->getObjectPtr()->image_type;
+                if ((image_type == ISMRMRD::ISMRMRD_IMTYPE_REAL || image_type == ISMRMRD::ISMRMRD_IMTYPE_IMAG)
+                    && cm3->getObjectPtr()->length(GADGETRON_IMAGE_WINDOWCENTER) > 0)
+                {
+                    long windowCenter = cm3->getObjectPtr()->as_long(GADGETRON_IMAGE_WINDOWCENTER, 0);
+                    cm3->getObjectPtr()->set(GADGETRON_IMAGE_WINDOWCENTER, windowCenter + (long)intensity_offset_value_);
+                }
+            }
+        }
+
+        m1->release();
+
+        if (failed > 0)
+        {
+            for (ii = 0; ii < num; ii++) images[ii]->release();
+            return GADGET_FAIL;
+        }
+
+        for (ii = 0; ii < num; ii++)
+        {
+            if (this->next()->putq(images[ii]) < 0)
+            {
+                GDEBUG("Unable to put fix point image on next gadgets queue");
+                for (; ii < num; ii++) images[ii]->release();
+                return GADGET_FAIL;
+            }
+        }
+
+        return GADGET_OK;
+    }
+
+    ImageArrayToUShortGadget::ImageArrayToUShortGadget()
+    {
+        max_intensity.value(4095);
+        min_intensity.value(0);
+        intensity_offset.value(2048);
+
+        max_intensity_value_ = 4095;
+        min_intensity_value_ = 0;
+        intensity_offset_value_ = 2048;
+    }
+
+    ImageArrayToUShortGadget::~ImageArrayToUShortGadget()
+    {
+    }
+
+    ImageArrayToShortGadget::ImageArrayToShortGadget()
+    {
+    }
+
+    ImageArrayToShortGadget::~ImageArrayToShortGadget()
+    {
+    }
+
+    GADGET_FACTORY_DECLARE(ImageArrayToUShortGadget)
+    GADGET_FACTORY_DECLARE(ImageArrayToShortGadget)
+}
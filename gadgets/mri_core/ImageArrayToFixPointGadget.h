@@ -0,0 +1,74 @@
+/** \file   ImageArrayToFixPointGadget.h
+    \brief  This Gadget splits an image array and converts every image to fix point values in one pass.
+    \author Hui Xue
+*/
+
+#ifndef ImageArrayToFixPointGadget_H_
+#define ImageArrayToFixPointGadget_H_
+
+#include "Gadget.h"
+#include "hoNDArray.h"
+#include "ismrmrd/meta.h"
+#include "gadgetron_mricore_export.h"
+#include "mri_core_data.h"
+
+#include <ismrmrd/ismrmrd.h>
+
+namespace Gadgetron
+{
+
+    /**
+    * This Gadget does the work of ImageArraySplitGadget, ComplexToFloatGadget, AutoScaleGadget and
+    * FloatToFixPointGadget in one go. Every [X Y Z CHA] image of the array is converted straight from
+    * the complex values to fix point, without the float image and the message hops in between.
+    * The images of an array are converted in parallel and sent out in the order of ImageArraySplitGadget.
+    *
+    * The output is the same as from the separate gadgets with the same properties.
+    * If auto_scale_max_value > 0, magnitude images are scaled as by AutoScaleGadget with max_value.
+    *
+    */
+
+    template <typename T>
+    class EXPORTGADGETSMRICORE ImageArrayToFixPointGadget:public Gadget1<IsmrmrdImageArray>
+    {
+    public:
+
+        GADGET_DECLARE(ImageArrayToFixPointGadget);
+
+        ImageArrayToFixPointGadget();
+        virtual ~ImageArrayToFixPointGadget();
+
+    protected:
+        GADGET_PROPERTY(max_intensity, T, "Maximum intensity value", std::numeric_limits<T>::max() );
+        GADGET_PROPERTY(min_intensity, T, "Minimal intensity value", std::numeric_limits<T>::min());
+        GADGET_PROPERTY(intensity_offset, T, "Intensity offset", 0);
+        GADGET_PROPERTY(auto_scale_max_value, float, "If > 0, magnitude images are scaled as by AutoScaleGadget with this maximum value", 0);
+
+        T max_intensity_value_;
+        T min_intensity_value_;
+        T intensity_offset_value_;
+
+        virtual int process_config(ACE_Message_Block* mb);
+        virtual int process(GadgetContainerMessage<IsmrmrdImageArray>* m1);
+    };
+
+    class EXPORTGADGETSMRICORE ImageArrayToShortGadget :public ImageArrayToFixPointGadget < short >
+    {
+    public:
+        GADGET_DECLARE(ImageArrayToShortGadget);
+
+        ImageArrayToShortGadget();
+        virtual ~ImageArrayToShortGadget();
+    };
+
+    class EXPORTGADGETSMRICORE ImageArrayToUShortGadget :public ImageArrayToFixPointGadget < unsigned short >
+    {
+    public:
+        GADGET_DECLARE(ImageArrayToUShortGadget);
+
+        ImageArrayToUShortGadget();
+        virtual ~ImageArrayToUShortGadget();
+    };
+}
+
+#endif /* ImageArrayToFixPointGadget_H_ */
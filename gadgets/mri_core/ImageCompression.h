@@ -0,0 +1,255 @@
+/** \file   ImageCompression.h
+\brief  Compression of the pixel data of the images sent back to the client.
+
+        Clients request a mode for their connection with a GADGET_MESSAGE_IMAGE_COMPRESSION message. Images the
+        mode applies to are then sent as GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED, which has the identifier, the
+        image header and the meta attributes of GADGET_MESSAGE_ISMRMRD_IMAGE followed by
+
+          ImageCompressionHeader
+          ImageCompressionChunk[chunks]
+          the compressed bytes of the chunks, one after the other
+
+        The chunks are consecutive runs of whole RO x E1 planes, compressed independently so the server can
+        compress them in parallel. Lossless compression (zstd, after separating the bytes of the samples) applies
+        to all data types, bounded error compression (ZFP, fixed accuracy) to float, double and complex images.
+        Other images, and modes Gadgetron is compiled without, are sent uncompressed as GADGET_MESSAGE_ISMRMRD_IMAGE.
+*/
+
+#ifndef ImageCompression_H
+#define ImageCompression_H
+
+#include <ismrmrd/ismrmrd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined GADGETRON_COMPRESSION_ZFP
+#include <zfp/zfp.h>
+#endif //GADGETRON_COMPRESSION_ZFP
+
+#if defined GADGETRON_COMPRESSION_ZSTD
+#include <zstd.h>
+#endif //GADGETRON_COMPRESSION_ZSTD
+
+namespace Gadgetron{
+
+    enum ImageCompressionMode
+    {
+        IMAGE_COMPRESSION_NONE = 0,
+        IMAGE_COMPRESSION_LOSSLESS = 1,
+        IMAGE_COMPRESSION_ZFP = 2
+    };
+
+    struct ImageCompressionHeader
+    {
+        uint32_t mode;
+        uint32_t chunks;
+        uint64_t uncompressed_bytes;
+    };
+
+    struct ImageCompressionChunk
+    {
+        uint64_t elements;  //Image elements (complex values count once) in the chunk
+        uint64_t bytes;     //Compressed size
+    };
+
+    /// Size of an element of the ISMRMRD data type, 0 if unknown
+    inline size_t image_element_size(uint16_t data_type)
+    {
+        switch (data_type)
+        {
+        case ISMRMRD::ISMRMRD_USHORT: return sizeof(uint16_t);
+        case ISMRMRD::ISMRMRD_SHORT: return sizeof(int16_t);
+        case ISMRMRD::ISMRMRD_UINT: return sizeof(uint32_t);
+        case ISMRMRD::ISMRMRD_INT: return sizeof(int32_t);
+        case ISMRMRD::ISMRMRD_FLOAT: return sizeof(float);
+        case ISMRMRD::ISMRMRD_DOUBLE: return sizeof(double);
+        case ISMRMRD::ISMRMRD_CXFLOAT: return 2 * sizeof(float);
+        case ISMRMRD::ISMRMRD_CXDOUBLE: return 2 * sizeof(double);
+        default: return 0;
+        }
+    }
+
+    inline bool image_is_complex(uint16_t data_type)
+    {
+        return (data_type == ISMRMRD::ISMRMRD_CXFLOAT) || (data_type == ISMRMRD::ISMRMRD_CXDOUBLE);
+    }
+
+    /// Whether images of the data type can be compressed in the mode by this build
+    inline bool image_compression_available(uint32_t mode, uint16_t data_type)
+    {
+        if (image_element_size(data_type) == 0) return false;
+
+        if (mode == IMAGE_COMPRESSION_LOSSLESS)
+        {
+#if defined GADGETRON_COMPRESSION_ZSTD
+            return true;
+#else
+            return false;
+#endif //GADGETRON_COMPRESSION_ZSTD
+        }
+
+        if (mode == IMAGE_COMPRESSION_ZFP)
+        {
+#if defined GADGETRON_COMPRESSION_ZFP
+            return (data_type == ISMRMRD::ISMRMRD_FLOAT) || (data_type == ISMRMRD::ISMRMRD_DOUBLE)
+                || (data_type == ISMRMRD::ISMRMRD_CXFLOAT) || (data_type == ISMRMRD::ISMRMRD_CXDOUBLE);
+#else
+            return false;
+#endif //GADGETRON_COMPRESSION_ZFP
+        }
+
+        return false;
+    }
+
+    namespace image_compression_detail
+    {
+        // Size of the scalars of the data type, the bytes of a scalar are separated before the lossless compression
+        inline size_t scalar_size(uint16_t data_type)
+        {
+            return image_is_complex(data_type) ? image_element_size(data_type) / 2 : image_element_size(data_type);
+        }
+
+        inline void shuffle(const char* in, size_t scalars, size_t size, char* out)
+        {
+            for (size_t b = 0; b < size; b++)
+                for (size_t i = 0; i < scalars; i++)
+                    out[b*scalars + i] = in[i*size + b];
+        }
+
+        inline void unshuffle(const char* in, size_t scalars, size_t size, char* out)
+        {
+            for (size_t b = 0; b < size; b++)
+                for (size_t i = 0; i < scalars; i++)
+                    out[i*size + b] = in[b*scalars + i];
+        }
+
+#if defined GADGETRON_COMPRESSION_ZFP
+        inline zfp_type zfp_scalar_type(uint16_t data_type)
+        {
+            return ((data_type == ISMRMRD::ISMRMRD_DOUBLE) || (data_type == ISMRMRD::ISMRMRD_CXDOUBLE)) ? zfp_type_double : zfp_type_float;
+        }
+#endif //GADGETRON_COMPRESSION_ZFP
+    }
+
+    /**
+        Compresses elements elements of the data type into out, replacing its content.
+        line is the length of the image lines (RO), the ZFP field is 2D if the chunk consists of whole lines.
+        tolerance is the absolute error bound of ZFP. Throws if the compression fails.
+    */
+    inline void compress_image_chunk(uint32_t mode, float tolerance, uint16_t data_type, const void* data, size_t elements, size_t line, std::vector<char>& out)
+    {
+        using namespace image_compression_detail;
+
+        if (!image_compression_available(mode, data_type)) throw std::runtime_error("Image compression mode not available for the data type");
+
+        if (mode == IMAGE_COMPRESSION_LOSSLESS)
+        {
+#if defined GADGETRON_COMPRESSION_ZSTD
+            const size_t bytes = elements * image_element_size(data_type);
+            std::vector<char> shuffled(bytes);
+            shuffle(static_cast<const char*>(data), bytes / scalar_size(data_type), scalar_size(data_type), shuffled.data());
+
+            out.resize(ZSTD_compressBound(bytes));
+            size_t compressed = ZSTD_compress(out.data(), out.size(), shuffled.data(), bytes, 1);
+            if (ZSTD_isError(compressed)) throw std::runtime_error(ZSTD_getErrorName(compressed));
+            out.resize(compressed);
+#endif //GADGETRON_COMPRESSION_ZSTD
+            return;
+        }
+
+#if defined GADGETRON_COMPRESSION_ZFP
+        const size_t scalars = elements * (image_is_complex(data_type) ? 2 : 1);
+        zfp_type type = zfp_scalar_type(data_type);
+        zfp_stream* zfp = zfp_stream_open(NULL);
+        zfp_field* field = zfp_field_alloc();
+
+        const size_t nx = line * (image_is_complex(data_type) ? 2 : 1);
+        zfp_field_set_pointer(field, const_cast<void*>(data));
+        zfp_field_set_type(field, type);
+        if (line > 0 && (elements % line) == 0) {
+            zfp_field_set_size_2d(field, nx, elements / line);
+        } else {
+            zfp_field_set_size_1d(field, scalars);
+        }
+
+        zfp_stream_set_accuracy(zfp, tolerance, type);
+
+        out.resize(zfp_stream_maximum_size(zfp, field));
+
+        bitstream* stream = stream_open(out.data(), out.size());
+        if (!stream) {
+            zfp_field_free(field);
+            zfp_stream_close(zfp);
+            throw std::runtime_error("Cannot open compressed stream");
+        }
+        zfp_stream_set_bit_stream(zfp, stream);
+
+        size_t zfpsize = 0;
+        if (zfp_write_header(zfp, field, ZFP_HEADER_FULL)) {
+            zfpsize = zfp_compress(zfp, field);
+        }
+
+        zfp_field_free(field);
+        zfp_stream_close(zfp);
+        stream_close(stream);
+
+        if (zfpsize == 0) throw std::runtime_error("ZFP compression failed");
+        out.resize(zfpsize);
+#endif //GADGETRON_COMPRESSION_ZFP
+    }
+
+    /// Decompresses a chunk of elements elements of the data type into data. Throws if the chunk does not decompress to that size.
+    inline void decompress_image_chunk(uint32_t mode, uint16_t data_type, const char* in, size_t bytes, void* data, size_t elements)
+    {
+        using namespace image_compression_detail;
+
+        if (!image_compression_available(mode, data_type)) throw std::runtime_error("Image compression mode not available for the data type");
+
+        if (mode == IMAGE_COMPRESSION_LOSSLESS)
+        {
+#if defined GADGETRON_COMPRESSION_ZSTD
+            const size_t expected = elements * image_element_size(data_type);
+            std::vector<char> shuffled(expected);
+            size_t decompressed = ZSTD_decompress(shuffled.data(), expected, in, bytes);
+            if (ZSTD_isError(decompressed)) throw std::runtime_error(ZSTD_getErrorName(decompressed));
+            if (decompressed != expected) throw std::runtime_error("Lossless image chunk has the wrong size");
+            unshuffle(shuffled.data(), expected / scalar_size(data_type), scalar_size(data_type), static_cast<char*>(data));
+#endif //GADGETRON_COMPRESSION_ZSTD
+            return;
+        }
+
+#if defined GADGETRON_COMPRESSION_ZFP
+        const size_t scalars = elements * (image_is_complex(data_type) ? 2 : 1);
+        zfp_stream* zfp = zfp_stream_open(NULL);
+        zfp_field* field = zfp_field_alloc();
+
+        bitstream* stream = stream_open(const_cast<char*>(in), bytes);
+        if (!stream) {
+            zfp_field_free(field);
+            zfp_stream_close(zfp);
+            throw std::runtime_error("Cannot open compressed stream");
+        }
+        zfp_stream_set_bit_stream(zfp, stream);
+        zfp_stream_rewind(zfp);
+
+        bool ok = zfp_read_header(zfp, field, ZFP_HEADER_FULL)
+            && (field->type == zfp_scalar_type(data_type))
+            && (zfp_field_size(field, NULL) == scalars);
+
+        if (ok) {
+            zfp_field_set_pointer(field, data);
+            ok = (zfp_decompress(zfp, field) != 0);
+        }
+
+        zfp_field_free(field);
+        zfp_stream_close(zfp);
+        stream_close(stream);
+
+        if (!ok) throw std::runtime_error("ZFP decompression failed");
+#endif //GADGETRON_COMPRESSION_ZFP
+    }
+}
+#endif
@@ -1,11 +1,107 @@
 #include "ImageSortGadget.h"
+#include <ismrmrd/xml.h>
+#include <ismrmrd/meta.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
 
 namespace Gadgetron{
 
+  namespace {
+
+    template <typename T> bool write_image_data(std::ofstream& f, ACE_Message_Block* mb)
+    {
+      GadgetContainerMessage< hoNDArray<T> >* d = AsContainerMessage< hoNDArray<T> >(mb);
+      if (!d) return false;
+
+      std::vector<size_t> dims = *d->getObjectPtr()->get_dimensions();
+      unsigned long long ndim = dims.size();
+      f.write(reinterpret_cast<const char*>(&ndim), sizeof(ndim));
+      f.write(reinterpret_cast<const char*>(&dims[0]), ndim*sizeof(size_t));
+      f.write(reinterpret_cast<const char*>(d->getObjectPtr()->get_data_ptr()), d->getObjectPtr()->get_number_of_bytes());
+      return true;
+    }
+
+    template <typename T> ACE_Message_Block* read_image_data(std::ifstream& f)
+    {
+      unsigned long long ndim = 0;
+      f.read(reinterpret_cast<char*>(&ndim), sizeof(ndim));
+      if (!f || ndim == 0) return 0;
+
+      std::vector<size_t> dims(ndim);
+      f.read(reinterpret_cast<char*>(&dims[0]), ndim*sizeof(size_t));
+
+      GadgetContainerMessage< hoNDArray<T> >* d = new GadgetContainerMessage< hoNDArray<T> >();
+      d->getObjectPtr()->create(dims);
+      f.read(reinterpret_cast<char*>(d->getObjectPtr()->get_data_ptr()), d->getObjectPtr()->get_number_of_bytes());
+      if (!f) {
+	d->release();
+	return 0;
+      }
+
+      return d;
+    }
+  }
+
+  ImageSortGadget::ImageSortGadget() : num_index_(0), next_index_(0), num_waiting_(0), num_spilled_(0)
+  {
+  }
+
+  ImageSortGadget::~ImageSortGadget()
+  {
+    for (size_t i = 0; i < waiting_images_.size(); i++) {
+      for (auto it = waiting_images_[i].begin(); it != waiting_images_[i].end(); it++) {
+	if (it->mb_) it->mb_->release();
+	if (!it->spill_file_.empty()) boost::filesystem::remove(it->spill_file_);
+      }
+    }
+  }
+
+  int ImageSortGadget::process_config(ACE_Message_Block* mb)
+  {
+    num_index_ = 0;
+    next_index_ = 0;
+
+    if (!streaming.value()) return GADGET_OK;
+
+    boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
+    try {
+      header = this->get_ismrmrd_header(mb);
+    } catch (...) {
+      GERROR("ImageSortGadget, error parsing ISMRMRD Header\n");
+      return GADGET_FAIL;
+    }
+    const ISMRMRD::IsmrmrdHeader& h = *header;
+
+    if (h.encoding.size() > 0) {
+      const ISMRMRD::EncodingLimits& limits = h.encoding[0].encodingLimits;
+      std::string dim = sorting_dimension.value();
+
+      ISMRMRD::Optional<ISMRMRD::Limit> limit;
+      if (dim.compare("average") == 0) limit = limits.average;
+      else if (dim.compare("slice") == 0) limit = limits.slice;
+      else if (dim.compare("contrast") == 0) limit = limits.contrast;
+      else if (dim.compare("phase") == 0) limit = limits.phase;
+      else if (dim.compare("repetition") == 0) limit = limits.repetition;
+      else if (dim.compare("set") == 0) limit = limits.set;
+
+      if (limit.is_present()) num_index_ = (int)limit->maximum + 1;
+    }
+
+    if (num_index_ > 0) {
+      waiting_images_.resize(num_index_);
+      GDEBUG("ImageSortGadget, streaming over %d %s indices, window %d\n", num_index_, sorting_dimension.value().c_str(), streaming_window.value());
+    } else {
+      GWARN("ImageSortGadget, no encoding limit for %s, images are sorted at close\n", sorting_dimension.value().c_str());
+    }
+
+    return GADGET_OK;
+  }
+
   int ImageSortGadget::index(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1)
   {
     std::string sorting_dimension_local = sorting_dimension.value();
-    
+
     if (sorting_dimension_local.size() == 0) {
       return -1;
     } else if (sorting_dimension_local.compare("average") == 0) {
@@ -29,11 +125,25 @@ namespace Gadgetron{
 
   int ImageSortGadget::close(unsigned long flags)
   {
+    if (num_waiting_) {
+      GDEBUG("++++++ close call with %d waiting images, %d spilled\n", num_waiting_, num_spilled_);
+
+      // images of missing indices are skipped
+      while (num_waiting_) {
+	if (waiting_images_[next_index_].empty()) {
+	  next_index_ = (next_index_ + 1) % num_index_;
+	  continue;
+	}
+
+	if (send_ready_images() != GADGET_OK) return GADGET_FAIL;
+      }
+    }
+
     GDEBUG("++++++ close call with %d images\n", images_.size());
     if (images_.size()) {
-      
+
       std::sort(images_.begin(),images_.end(), image_entry_compare);
-      
+
       for (auto it = images_.begin(); it != images_.end(); it++) {
 	if (this->next()->putq(it->mb_) == -1) {
 	  it->mb_->release();
@@ -41,31 +151,198 @@ namespace Gadgetron{
 	  return GADGET_FAIL;
 	}
       }
-      
+
       images_.clear();
     }
     return GADGET_OK;
   }
-  
+
   int ImageSortGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1)
   {
-    
-    if (index(m1) < 0) {
+    int idx = index(m1);
+
+    if (idx < 0 || (num_index_ > 0 && idx >= num_index_)) {
+      if (idx >= 0) GWARN("ImageSortGadget, index %d beyond the encoding limits, image is passed on\n", idx);
+
       if (this->next()->putq(m1) == -1) {
 	m1->release();
 	GERROR("Error passing data on to next gadget\n");
 	return GADGET_FAIL;
       }
+      return GADGET_OK;
     }
 
     ImageEntry i;
-    i.index_ = index(m1);
+    i.index_ = idx;
     i.mb_ = m1;
 
-    images_.push_back(i);
+    if (num_index_ == 0) {
+      images_.push_back(i);
+      return GADGET_OK;
+    }
+
+    // an image of an index which is still waiting belongs to a later round
+    if (idx == next_index_ && waiting_images_[idx].empty()) {
+      if (send_image(i) != GADGET_OK) return GADGET_FAIL;
+      return send_ready_images();
+    }
+
+    size_t ahead = (size_t)((idx - next_index_ + num_index_) % num_index_) + waiting_images_[idx].size()*num_index_;
+    if (streaming_window.value() > 0 && ahead >= (size_t)streaming_window.value()) {
+      if (spill_image(i)) num_spilled_++;
+    }
+
+    waiting_images_[idx].push_back(i);
+    num_waiting_++;
+
+    return GADGET_OK;
+  }
+
+  int ImageSortGadget::send_ready_images()
+  {
+    while (!waiting_images_[next_index_].empty()) {
+      ImageEntry i = waiting_images_[next_index_].front();
+      waiting_images_[next_index_].pop_front();
+      num_waiting_--;
+
+      if (!i.spill_file_.empty()) {
+	num_spilled_--;
+	if (!restore_image(i)) {
+	  GERROR("ImageSortGadget, failed to read back spilled image %s\n", i.spill_file_.c_str());
+	  return GADGET_FAIL;
+	}
+      }
+
+      if (send_image(i) != GADGET_OK) return GADGET_FAIL;
+    }
+
+    return GADGET_OK;
+  }
+
+  int ImageSortGadget::send_image(ImageEntry& entry)
+  {
+    next_index_ = (next_index_ + 1) % num_index_;
+
+    if (this->next()->putq(entry.mb_) == -1) {
+      entry.mb_->release();
+      GERROR("Error passing data on to next gadget\n");
+      return GADGET_FAIL;
+    }
 
     return GADGET_OK;
   }
 
+  bool ImageSortGadget::spill_image(ImageEntry& entry)
+  {
+    GadgetContainerMessage<ISMRMRD::ImageHeader>* m1 = entry.mb_;
+    ACE_Message_Block* data = m1->cont();
+    if (!data) return false;
+
+    GadgetContainerMessage<ISMRMRD::MetaContainer>* meta = 0;
+    if (data->cont()) {
+      meta = AsContainerMessage<ISMRMRD::MetaContainer>(data->cont());
+      // other attachments are not known here, the image stays in memory
+      if (!meta || meta->cont()) return false;
+    }
+
+    try {
+      boost::filesystem::path folder(workingDirectory.value());
+      boost::filesystem::create_directories(folder);
+      std::string filename = (folder / boost::filesystem::unique_path("ImageSortGadget_%%%%-%%%%-%%%%-%%%%.img")).string();
+
+      std::ofstream f(filename.c_str(), std::ios::binary);
+      if (!f) return false;
+
+      f.write(reinterpret_cast<const char*>(m1->getObjectPtr()), sizeof(ISMRMRD::ImageHeader));
+
+      bool written = false;
+      switch (m1->getObjectPtr()->data_type) {
+      case ISMRMRD::ISMRMRD_USHORT: written = write_image_data<uint16_t>(f, data); break;
+      case ISMRMRD::ISMRMRD_SHORT: written = write_image_data<int16_t>(f, data); break;
+      case ISMRMRD::ISMRMRD_UINT: written = write_image_data<uint32_t>(f, data); break;
+      case ISMRMRD::ISMRMRD_INT: written = write_image_data<int32_t>(f, data); break;
+      case ISMRMRD::ISMRMRD_FLOAT: written = write_image_data<float>(f, data); break;
+      case ISMRMRD::ISMRMRD_DOUBLE: written = write_image_data<double>(f, data); break;
+      case ISMRMRD::ISMRMRD_CXFLOAT: written = write_image_data< std::complex<float> >(f, data); break;
+      case ISMRMRD::ISMRMRD_CXDOUBLE: written = write_image_data< std::complex<double> >(f, data); break;
+      default: break;
+      }
+
+      std::string attrib;
+      if (meta) {
+	std::stringstream str;
+	ISMRMRD::serialize(*meta->getObjectPtr(), str);
+	attrib = str.str();
+      }
+
+      unsigned long long attrib_length = attrib.size();
+      f.write(reinterpret_cast<const char*>(&attrib_length), sizeof(attrib_length));
+      f.write(attrib.c_str(), attrib_length);
+      f.close();
+
+      if (!written || !f) {
+	boost::filesystem::remove(filename);
+	return false;
+      }
+
+      entry.spill_file_ = filename;
+    } catch (...) {
+      GWARN("ImageSortGadget, failed to spill an image to %s, it is kept in memory\n", workingDirectory.value().c_str());
+      return false;
+    }
+
+    m1->release();
+    entry.mb_ = 0;
+
+    return true;
+  }
+
+  bool ImageSortGadget::restore_image(ImageEntry& entry)
+  {
+    std::ifstream f(entry.spill_file_.c_str(), std::ios::binary);
+    if (!f) return false;
+
+    GadgetContainerMessage<ISMRMRD::ImageHeader>* m1 = new GadgetContainerMessage<ISMRMRD::ImageHeader>();
+    f.read(reinterpret_cast<char*>(m1->getObjectPtr()), sizeof(ISMRMRD::ImageHeader));
+
+    ACE_Message_Block* data = 0;
+    switch (m1->getObjectPtr()->data_type) {
+    case ISMRMRD::ISMRMRD_USHORT: data = read_image_data<uint16_t>(f); break;
+    case ISMRMRD::ISMRMRD_SHORT: data = read_image_data<int16_t>(f); break;
+    case ISMRMRD::ISMRMRD_UINT: data = read_image_data<uint32_t>(f); break;
+    case ISMRMRD::ISMRMRD_INT: data = read_image_data<int32_t>(f); break;
+    case ISMRMRD::ISMRMRD_FLOAT: data = read_image_data<float>(f); break;
+    case ISMRMRD::ISMRMRD_DOUBLE: data = read_image_data<double>(f); break;
+    case ISMRMRD::ISMRMRD_CXFLOAT: data = read_image_data< std::complex<float> >(f); break;
+    case ISMRMRD::ISMRMRD_CXDOUBLE: data = read_image_data< std::complex<double> >(f); break;
+    default: break;
+    }
+
+    if (!data) {
+      m1->release();
+      return false;
+    }
+    m1->cont(data);
+
+    unsigned long long attrib_length = 0;
+    f.read(reinterpret_cast<char*>(&attrib_length), sizeof(attrib_length));
+    if (f && attrib_length > 0) {
+      std::string attrib(attrib_length, 0);
+      f.read(&attrib[0], attrib_length);
+
+      GadgetContainerMessage<ISMRMRD::MetaContainer>* meta = new GadgetContainerMessage<ISMRMRD::MetaContainer>();
+      ISMRMRD::deserialize(attrib.c_str(), *meta->getObjectPtr());
+      data->cont(meta);
+    }
+
+    f.close();
+    boost::filesystem::remove(entry.spill_file_);
+
+    entry.mb_ = m1;
+    entry.spill_file_.clear();
+
+    return true;
+  }
+
   GADGET_FACTORY_DECLARE(ImageSortGadget);
 }
@@ -9,6 +9,7 @@
 
 #include <ismrmrd/ismrmrd.h>
 #include <complex>
+#include <deque>
 
 namespace Gadgetron{
 
@@ -16,21 +17,38 @@ namespace Gadgetron{
   {
     int index_;
     GadgetContainerMessage<ISMRMRD::ImageHeader>* mb_;
+
+    // if not empty, the image was spilled to this file and mb_ is 0
+    std::string spill_file_;
   };
 
-  bool image_entry_compare(const ImageEntry& i, const ImageEntry& j)
+  inline bool image_entry_compare(const ImageEntry& i, const ImageEntry& j)
   {
     return (i.index_<j.index_);
   }
 
+  /**
+     Sorts images by the sorting dimension.
+
+     By default all images are kept until close() and then sent out sorted by their index.
+
+     In the streaming mode, the index runs over the range of the encoding limits of the sorting
+     dimension and every image is sent out as soon as all images with a lower index have arrived.
+     Once the last index is sent out, the next round starts at index 0 again, so that every round
+     holds one image of every index. Images more than streaming_window positions ahead of the next
+     image to send are spilled to workingDirectory and read back when it is their turn.
+  */
   class EXPORTGADGETSMRICORE ImageSortGadget : public Gadget1 < ISMRMRD::ImageHeader >
   {
   public:
     GADGET_DECLARE(ImageSortGadget);
 
+    ImageSortGadget();
+    virtual ~ImageSortGadget();
+
   protected:
     GADGET_PROPERTY_LIMITS(sorting_dimension, std::string, "Dimension that data will be sorted by", "slice",
-			   GadgetPropertyLimitsEnumeration, 
+			   GadgetPropertyLimitsEnumeration,
 			   "average",
 			   "slice",
 			   "contrast",
@@ -38,12 +56,38 @@ namespace Gadgetron{
 			   "repetition",
 			   "set");
 
+    GADGET_PROPERTY(streaming, bool, "Whether to send out every image as soon as all images with a lower index have arrived, the index range is given by the encoding limits", false);
+    GADGET_PROPERTY(streaming_window, int, "In the streaming mode, images more than this number of positions ahead of the next image to send are spilled to workingDirectory, 0 to keep all images in memory", 0);
+
+    virtual int process_config(ACE_Message_Block* mb);
     virtual int close(unsigned long flags);
     virtual int process(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1);
     int index(GadgetContainerMessage<ISMRMRD::ImageHeader>* m1);
-    
+
+    // streaming mode, send out the waiting images in order as far as possible
+    int send_ready_images();
+
+    // streaming mode, send out an image and move on to the next index
+    int send_image(ImageEntry& entry);
+
+    // write the image to a file in workingDirectory, return false if it cannot be spilled
+    bool spill_image(ImageEntry& entry);
+
+    // read back a spilled image
+    bool restore_image(ImageEntry& entry);
+
     std::vector<ImageEntry> images_;
-    
+
+    // number of index values of the sorting dimension, from the encoding limits, 0 if not known
+    int num_index_;
+
+    // streaming mode, index of the next image to send
+    int next_index_;
+
+    // streaming mode, waiting images for every index, in the order of arrival
+    std::vector< std::deque<ImageEntry> > waiting_images_;
+    size_t num_waiting_;
+    size_t num_spilled_;
   };
 }
 
@@ -1,6 +1,7 @@
 #include "GadgetIsmrmrdReadWrite.h"
 #include "IsmrmrdDumpGadget.h"
 #include <iomanip>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include "network_utils.h"
 
@@ -30,17 +31,140 @@ namespace Gadgetron
     }
 
     IsmrmrdDumpGadget::IsmrmrdDumpGadget() : BaseClass(), first_call_(true), save_ismrmrd_data_(true)
+        , write_queue_capacity_(1024), write_chunk_(64), writer_stop_(false), writer_failed_(false)
     {
     }
 
     IsmrmrdDumpGadget::~IsmrmrdDumpGadget()
     {
+        this->stop_writer();
+    }
+
+    int IsmrmrdDumpGadget::close(unsigned long flags)
+    {
+        // the gadget thread has finished once the base class returns, nothing is queued after that
+        int rval = BaseClass::close(flags);
+
+        if (flags == 1 && this->stop_writer() != GADGET_OK)
+        {
+            GERROR("IsmrmrdDumpGadget, failed to write all acquisitions to the dataset\n");
+            rval = GADGET_FAIL;
+        }
+
+        return rval;
+    }
+
+    void IsmrmrdDumpGadget::start_writer()
+    {
+        write_queue_capacity_ = (size_t)std::max(1, write_queue_size.value());
+        write_chunk_ = (size_t)std::max(1, write_chunk_size.value());
+        writer_stop_ = false;
+        writer_failed_ = false;
+        writer_ = std::thread(&IsmrmrdDumpGadget::writer_loop, this);
+    }
+
+    int IsmrmrdDumpGadget::stop_writer()
+    {
+        if (writer_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex_);
+                writer_stop_ = true;
+            }
+            writer_wake_.notify_one();
+            writer_.join();
+        }
+
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        return writer_failed_ ? GADGET_FAIL : GADGET_OK;
+    }
+
+    void IsmrmrdDumpGadget::writer_loop()
+    {
+        std::vector< std::unique_ptr<ISMRMRD::Acquisition> > chunk;
+        chunk.reserve(write_chunk_);
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(writer_mutex_);
+                writer_wake_.wait(lock, [this]() { return !write_queue_.empty() || writer_stop_; });
+
+                if (write_queue_.empty()) return;
+
+                while (!write_queue_.empty() && chunk.size() < write_chunk_)
+                {
+                    chunk.push_back(std::move(write_queue_.front()));
+                    write_queue_.pop_front();
+                }
+            }
+            writer_space_.notify_all();
+
+            // the disk is only touched outside of the lock
+            bool failed = false;
+            try
+            {
+                for (size_t n = 0; n < chunk.size(); n++)
+                {
+                    ismrmrd_dataset_->appendAcquisition(*chunk[n]);
+                }
+            }
+            catch (...)
+            {
+                GERROR("Error appending ISMRMRD Dataset\n");
+                failed = true;
+            }
+            chunk.clear();
+
+            if (failed)
+            {
+                // drop whatever is left, the gadget reports the failure with the next acquisition
+                std::lock_guard<std::mutex> lock(writer_mutex_);
+                writer_failed_ = true;
+                write_queue_.clear();
+                writer_space_.notify_all();
+                return;
+            }
+        }
+    }
+
+    int IsmrmrdDumpGadget::write_acquisition(std::unique_ptr<ISMRMRD::Acquisition> acq)
+    {
+        if (!writer_.joinable())
+        {
+            try
+            {
+                ismrmrd_dataset_->appendAcquisition(*acq);
+            }
+            catch (...)
+            {
+                GDEBUG("Error appending ISMRMRD Dataset\n");
+                return GADGET_FAIL;
+            }
+            return GADGET_OK;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex_);
+            writer_space_.wait(lock, [this]() { return write_queue_.size() < write_queue_capacity_ || writer_failed_; });
+
+            if (writer_failed_)
+            {
+                GERROR("IsmrmrdDumpGadget, background writer failed\n");
+                return GADGET_FAIL;
+            }
+
+            write_queue_.push_back(std::move(acq));
+        }
+        writer_wake_.notify_one();
+
+        return GADGET_OK;
     }
 
     int IsmrmrdDumpGadget::process_config(ACE_Message_Block* mb)
     {
 
-        ISMRMRD::deserialize(mb->rd_ptr(), ismrmrd_header_);
+        ismrmrd_header_ = *this->get_ismrmrd_header(mb);
         ismrmrd_xml_ = std::string(mb->rd_ptr());
 
         // if ip_no_data_saving is set, check current ip of gadgetron server
@@ -255,6 +379,11 @@ namespace Gadgetron
                 }
 
                 GDEBUG_STREAM("IsmrmrdDumpGadget, save ismrmrd xml header ... ");
+
+                if (this->async_writing.value() && !this->save_xml_header_only.value())
+                {
+                    this->start_writer();
+                }
             }
             else
             {
@@ -266,7 +395,8 @@ namespace Gadgetron
 
         if (this->save_ismrmrd_data_ && !this->save_xml_header_only.value())
         {
-            ISMRMRD::Acquisition ismrmrd_acq;
+            std::unique_ptr<ISMRMRD::Acquisition> acq(new ISMRMRD::Acquisition());
+            ISMRMRD::Acquisition& ismrmrd_acq = *acq;
             ismrmrd_acq.setHead(*m1->getObjectPtr());
             memcpy((void *)ismrmrd_acq.getDataPtr(), m2->getObjectPtr()->get_data_ptr(), sizeof(float)*m2->getObjectPtr()->get_number_of_elements() * 2);
 
@@ -299,16 +429,9 @@ namespace Gadgetron
                 }
             }
 
+            if (this->write_acquisition(std::move(acq)) != GADGET_OK)
             {
-                try
-                {
-                    ismrmrd_dataset_->appendAcquisition(ismrmrd_acq);
-                }
-                catch (...)
-                {
-                    GDEBUG("Error appending ISMRMRD Dataset\n");
-                    return GADGET_FAIL;
-                }
+                return GADGET_FAIL;
             }
         }
 
@@ -10,6 +10,11 @@
 #include <ismrmrd/xml.h>
 
 #include <complex>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Gadgetron {
 
@@ -46,9 +51,17 @@ namespace Gadgetron {
         // if true, only save the xml header
         GADGET_PROPERTY(save_xml_header_only, bool, "If true, only save the xml header", false);
 
+        // acquisitions are appended to the dataset on a background thread, the chain does not wait for the disk
+        GADGET_PROPERTY(async_writing, bool, "If true, write the dataset on a background thread", true);
+        GADGET_PROPERTY(write_queue_size, int, "Number of acquisitions waiting to be written before the gadget blocks", 1024);
+        GADGET_PROPERTY(write_chunk_size, int, "Number of acquisitions the background thread appends in one go", 64);
+
         virtual int process_config(ACE_Message_Block* mb);
         virtual int process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1, GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2);
 
+        /// waits for the background writer to empty its queue
+        virtual int close(unsigned long flags);
+
     private:
 
         bool first_call_;
@@ -58,6 +71,23 @@ namespace Gadgetron {
         boost::shared_ptr<ISMRMRD::Dataset>  ismrmrd_dataset_;
 
         int create_ismrmrd_dataset(ISMRMRD::AcquisitionHeader* acq = NULL);
+
+        /// appends directly or hands the acquisition to the background writer
+        int write_acquisition(std::unique_ptr<ISMRMRD::Acquisition> acq);
+
+        void start_writer();
+        int stop_writer();
+        void writer_loop();
+
+        std::thread writer_;
+        std::mutex writer_mutex_;
+        std::condition_variable writer_wake_;
+        std::condition_variable writer_space_;
+        std::deque< std::unique_ptr<ISMRMRD::Acquisition> > write_queue_;
+        size_t write_queue_capacity_;
+        size_t write_chunk_;
+        bool writer_stop_;
+        bool writer_failed_;
     };
 }
 #endif //ISMRMRDDUMPGADGET_H
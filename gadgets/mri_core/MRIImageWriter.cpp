@@ -2,11 +2,36 @@
 #include "MRIImageWriter.h"
 #include "GadgetContainerMessage.h"
 #include "hoNDArray.h"
+#include "GadgetImageCompression.h"
+#include "GadgetWorkerPool.h"
+#include "GadgetronProfile.h"
 
+#include <algorithm>
 #include <complex>
+#include <condition_variable>
+#include <mutex>
 
 namespace Gadgetron{
 
+    void MRIImageWriter::finish_timing(const ISMRMRD::MetaContainer& meta, ISMRMRD::MetaContainer& timed)
+    {
+        double now_ms = GadgetronProfile::now_ns() / 1e6;
+
+        for (auto it = meta.begin(); it != meta.end(); it++)
+        {
+            if (it->first == GADGETRON_TIMING_RECON_START || it->first == GADGETRON_TIMING_RECON_END) continue;
+
+            for (size_t v = 0; v < it->second.size(); v++) timed.append(it->first.c_str(), it->second[v].as_str());
+        }
+
+        timed.set(GADGETRON_TIMING_POSTPROCESSING, now_ms - meta.as_double(GADGETRON_TIMING_RECON_END));
+
+        if (meta.length(GADGETRON_TIMING_RECON_START) > 0)
+        {
+            timed.set(GADGETRON_TIMING_LATENCY, now_ms - meta.as_double(GADGETRON_TIMING_RECON_START));
+        }
+    }
+
     int MRIImageWriter::write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb)
     {
         GadgetContainerMessage<ISMRMRD::ImageHeader>* imagemb =
@@ -144,6 +169,88 @@ namespace Gadgetron{
         return 0;
     }
 
+    bool MRIImageWriter::compress(ACE_SOCK_Stream* sock, const ISMRMRD::ImageHeader& header, const void* data, size_t elements)
+    {
+        GadgetMessageImageCompression compression = GadgetImageCompression::for_socket(sock->get_handle());
+
+        if (compression.mode == IMAGE_COMPRESSION_NONE || !image_compression_available(compression.mode, header.data_type)) return false;
+        if (compression.mode == IMAGE_COMPRESSION_ZFP && !(compression.tolerance > 0)) return false;
+
+        const size_t element_size = image_element_size(header.data_type);
+
+        //Chunks of whole RO x E1 planes
+        size_t line = header.matrix_size[0];
+        size_t plane = line*header.matrix_size[1];
+        if (plane == 0 || (elements % plane) != 0)
+        {
+            plane = elements;
+            line = 0;
+        }
+
+        const size_t planes = elements / plane;
+        size_t planes_per_chunk = std::max<size_t>(1, COMPRESSION_CHUNK_BYTES / (plane*element_size));
+        planes_per_chunk = std::max<size_t>(planes_per_chunk, (planes + MAX_COMPRESSION_CHUNKS - 1) / MAX_COMPRESSION_CHUNKS);
+        const size_t chunks = (planes + planes_per_chunk - 1) / planes_per_chunk;
+
+        compression_table_.resize(chunks);
+        compressed_chunks_.resize(chunks);
+
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining = chunks;
+        bool failed = false;
+
+        auto compress_chunk = [&](size_t c)
+        {
+            const size_t first = c*planes_per_chunk*plane;
+            compression_table_[c].elements = std::min(planes_per_chunk*plane, elements - first);
+
+            bool ok = true;
+            try
+            {
+                compress_image_chunk(compression.mode, compression.tolerance, header.data_type,
+                    static_cast<const char*>(data) + first*element_size, compression_table_[c].elements, line, compressed_chunks_[c]);
+                compression_table_[c].bytes = compressed_chunks_[c].size();
+            }
+            catch (std::exception& e)
+            {
+                GERROR("MRIImageWriter, image compression failed: %s\n", e.what());
+                ok = false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) failed = true;
+            remaining--;
+            done.notify_all();
+        };
+
+        //The first chunk is compressed by the writer thread while the workers take the others
+        for (size_t c = 1; c < chunks; c++)
+        {
+            GadgetWorkerPool::instance()->submit([&compress_chunk, c]() { compress_chunk(c); });
+        }
+        compress_chunk(0);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&remaining]() { return remaining == 0; });
+        }
+
+        if (failed) return false;
+
+        size_t compressed_bytes = 0;
+        for (size_t c = 0; c < chunks; c++) compressed_bytes += compressed_chunks_[c].size();
+
+        //Incompressible images are cheaper to send as they are
+        if (compressed_bytes + chunks*sizeof(ImageCompressionChunk) >= elements*element_size) return false;
+
+        compression_header_.mode = compression.mode;
+        compression_header_.chunks = (uint32_t)chunks;
+        compression_header_.uncompressed_bytes = elements*element_size;
+
+        return true;
+    }
+
     GADGETRON_WRITER_FACTORY_DECLARE(MRIImageWriter)
 
 }
@@ -8,19 +8,43 @@
 
 #include "GadgetMessageInterface.h"
 #include "GadgetMRIHeaders.h"
+#include "GadgetAttributeEncoding.h"
+#include "MetaContainerBinary.h"
+#include "ImageCompression.h"
+#include "mri_core_def.h"
 #include "ismrmrd/meta.h"
 #include "gadgetron_mricore_export.h"
 
 #include <ismrmrd/ismrmrd.h>
 #include <complex>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace Gadgetron{
 
     class MRIImageWriter : public GadgetMessageWriter
     {
     public:
+        /// Images are compressed in chunks of about this size, at most MAX_COMPRESSION_CHUNKS per image
+        enum { COMPRESSION_CHUNK_BYTES = 256*1024, MAX_COMPRESSION_CHUNKS = 256 };
+
         virtual int write(ACE_SOCK_Stream* sock, ACE_Message_Block* mb);
 
+        /**
+            Compresses the data of an image in the mode the client asked for, the chunks are compressed in
+            parallel on the GadgetWorkerPool. The result is kept in compression_header_, compression_table_ and
+            compressed_chunks_. Returns false if the image is to be sent uncompressed.
+        */
+        bool compress(ACE_SOCK_Stream* sock, const ISMRMRD::ImageHeader& header, const void* data, size_t elements);
+
+        /**
+            Copies the meta attributes of an image timed by the recon gadgets into timed, the steady clock stamps
+            of the recon are replaced by the time since the recon sent the image (post-processing) and the
+            time since the recon started (latency).
+        */
+        static void finish_timing(const ISMRMRD::MetaContainer& meta, ISMRMRD::MetaContainer& timed);
+
         template <typename T>
         int write_data_attrib(ACE_SOCK_Stream* sock, GadgetContainerMessage<ISMRMRD::ImageHeader>* header, GadgetContainerMessage< hoNDArray<T> >* data)
         {
@@ -45,35 +69,38 @@ namespace Gadgetron{
                 return -1;
             }
 
-            ssize_t send_cnt = 0;
-            GadgetMessageIdentifier id;
-            id.id = GADGET_MESSAGE_ISMRMRD_IMAGE;
-
-            if ((send_cnt = sock->send_n(&id, sizeof(GadgetMessageIdentifier))) <= 0)
-            {
-                GERROR("Unable to send image message identifier\n");
-                return -1;
-            }
-
             GadgetContainerMessage<ISMRMRD::MetaContainer>* attribmb = AsContainerMessage<ISMRMRD::MetaContainer>(data->cont());
 
-            char* buf = NULL;
+            //Attributes are sent as zero terminated XML, or binary if the client asked for it
+            std::string attribContent;
             size_t_type len(0);
 
             if (attribmb)
             {
                 try
                 {
-                    std::stringstream str;
-                    ISMRMRD::serialize(*attribmb->getObjectPtr(), str);
-                    std::string attribContent = str.str();
-                    len = attribContent.length() + 1;
-
-                    buf = new char[len];
-                    GADGET_CHECK_THROW(buf != NULL);
-
-                    memset(buf, '\0', sizeof(char)*len);
-                    memcpy(buf, attribContent.c_str(), len - 1);
+                    const ISMRMRD::MetaContainer* meta = attribmb->getObjectPtr();
+
+                    ISMRMRD::MetaContainer timed;
+                    if (meta->length(GADGETRON_TIMING_RECON_END) > 0)
+                    {
+                        finish_timing(*meta, timed);
+                        meta = &timed;
+                    }
+
+                    if (GadgetAttributeEncoding::for_socket(sock->get_handle()) == GADGET_ATTRIBUTE_ENCODING_BINARY)
+                    {
+                        //The binary form carries its own lengths and is not terminated
+                        serialize_meta_binary(*meta, attribContent);
+                        len = attribContent.length();
+                    }
+                    else
+                    {
+                        std::stringstream str;
+                        ISMRMRD::serialize(*meta, str);
+                        attribContent = str.str();
+                        len = attribContent.length() + 1;
+                    }
                 }
                 catch (...)
                 {
@@ -84,39 +111,72 @@ namespace Gadgetron{
 
             header->getObjectPtr()->attribute_string_len = (uint32_t)len;
 
-            if ((send_cnt = sock->send_n(header->getObjectPtr(), sizeof(ISMRMRD::ImageHeader))) <= 0)
-            {
-                GERROR("Unable to send image header\n");
-                return -1;
-            }
+            size_t data_bytes = sizeof(T)*data->getObjectPtr()->get_number_of_elements();
+            bool compressed = (data_bytes > 0) && this->compress(sock, *header->getObjectPtr(), data->getObjectPtr()->get_data_ptr(), data->getObjectPtr()->get_number_of_elements());
 
-            if ((send_cnt = sock->send_n(&len, sizeof(size_t_type))) <= 0)
+            GadgetMessageIdentifier id;
+            id.id = compressed ? GADGET_MESSAGE_ISMRMRD_IMAGE_COMPRESSED : GADGET_MESSAGE_ISMRMRD_IMAGE;
+
+            //Identifier, header, attribute length, attributes and data go out with a single gather write
+            std::vector<iovec> iov(compressed ? 6 + compressed_chunks_.size() : 5);
+            int iovcnt = 0;
+
+            iov[iovcnt].iov_base = reinterpret_cast<char*>(&id);
+            iov[iovcnt].iov_len = sizeof(GadgetMessageIdentifier);
+            iovcnt++;
+
+            iov[iovcnt].iov_base = reinterpret_cast<char*>(header->getObjectPtr());
+            iov[iovcnt].iov_len = sizeof(ISMRMRD::ImageHeader);
+            iovcnt++;
+
+            iov[iovcnt].iov_base = reinterpret_cast<char*>(&len);
+            iov[iovcnt].iov_len = sizeof(size_t_type);
+            iovcnt++;
+
+            if (len > 0)
             {
-                GERROR("Unable to send image meta attributes length\n");
-                if (buf != NULL) delete[] buf;
-                return -1;
+                iov[iovcnt].iov_base = const_cast<char*>(attribContent.c_str());
+                iov[iovcnt].iov_len = len;
+                iovcnt++;
             }
 
-            if (len>0)
+            if (compressed)
             {
-                if ((send_cnt = sock->send_n(buf, len)) <= 0)
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(&compression_header_);
+                iov[iovcnt].iov_len = sizeof(ImageCompressionHeader);
+                iovcnt++;
+
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(compression_table_.data());
+                iov[iovcnt].iov_len = sizeof(ImageCompressionChunk)*compression_table_.size();
+                iovcnt++;
+
+                for (size_t c = 0; c < compressed_chunks_.size(); c++)
                 {
-                    GERROR("Unable to send image meta attributes\n");
-                    if (buf != NULL) delete[] buf;
-                    return -1;
+                    iov[iovcnt].iov_base = compressed_chunks_[c].data();
+                    iov[iovcnt].iov_len = compressed_chunks_[c].size();
+                    iovcnt++;
                 }
             }
+            else if (data_bytes > 0)
+            {
+                iov[iovcnt].iov_base = reinterpret_cast<char*>(data->getObjectPtr()->get_data_ptr());
+                iov[iovcnt].iov_len = data_bytes;
+                iovcnt++;
+            }
 
-            if (buf != NULL) delete[] buf;
-
-            if ((send_cnt = sock->send_n(data->getObjectPtr()->get_data_ptr(), sizeof(T)*data->getObjectPtr()->get_number_of_elements())) <= 0)
+            if (sock->sendv_n(iov.data(), iovcnt) <= 0)
             {
-                GERROR("Unable to send image data\n");
+                GERROR("Unable to send image\n");
                 return -1;
             }
 
             return 0;
         }
+
+    protected:
+        ImageCompressionHeader compression_header_;
+        std::vector<ImageCompressionChunk> compression_table_;
+        std::vector< std::vector<char> > compressed_chunks_;
     };
 
 }
@@ -1,6 +1,7 @@
 #include "MaxwellCorrectionGadget.h"
 #include "GadgetronTimer.h"
 #include "Spline.h"
+#include "hoNDArray_simd.h"
 #include "ismrmrd/xml.h"
 
 #include <numeric>
@@ -26,8 +27,8 @@ namespace Gadgetron{
     int MaxwellCorrectionGadget::process_config(ACE_Message_Block* mb)
     {
 
-        ISMRMRD::IsmrmrdHeader h;
-        ISMRMRD::deserialize(mb->rd_ptr(),h);
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         if (h.userParameters)
         {
@@ -79,51 +80,51 @@ namespace Gadgetron{
             GDEBUG("img_pos_x = %f, img_pos_y = %f, img_pos_z = %f\n", m1->getObjectPtr()->position[0], m1->getObjectPtr()->position[1], m1->getObjectPtr()->position[2]);
             */
 
-            std::vector<float> dR(3,0);
-            std::vector<float> dP(3,0);
-            std::vector<float> dS(3,0);
-            std::vector<float> p(3,0);
+            const ISMRMRD::ImageHeader& h = *m1->getObjectPtr();
 
-            for (int z = 0; z < Nz; z++) {
-                for (int y = 0; y < Ny; y++) {
-                    for (int x = 0; x < Nx; x++) {
+            // the phase in turns is the quadratic form p'Ap of the position p
+            const double A[3][3] = { { maxwell_coefficients_[1], 0, maxwell_coefficients_[2] / 2 },
+                                     { 0, maxwell_coefficients_[1], maxwell_coefficients_[3] / 2 },
+                                     { maxwell_coefficients_[2] / 2, maxwell_coefficients_[3] / 2, maxwell_coefficients_[0] } };
 
-                        dR[0] = (x-Nx/2+0.5) * dx * m1->getObjectPtr()->read_dir[0];
-                        dR[1] = (x-Nx/2+0.5) * dx * m1->getObjectPtr()->read_dir[1];
-                        dR[2] = (x-Nx/2+0.5) * dx * m1->getObjectPtr()->read_dir[2];
+            // along a row p = q + x*r, so the phase is q'Aq + 2x q'Ar + x^2 r'Ar
+            double r[3], Ar[3];
+            for (int i = 0; i < 3; i++) r[i] = dx * h.read_dir[i] / 1000.0;
+            for (int i = 0; i < 3; i++) Ar[i] = A[i][0] * r[0] + A[i][1] * r[1] + A[i][2] * r[2];
+            const double c2 = r[0] * Ar[0] + r[1] * Ar[1] + r[2] * Ar[2];
 
-                        dP[0] = (y-Ny/2+0.5) * dy * m1->getObjectPtr()->phase_dir[0];
-                        dP[1] = (y-Ny/2+0.5) * dy * m1->getObjectPtr()->phase_dir[1];
-                        dP[2] = (y-Ny/2+0.5) * dy * m1->getObjectPtr()->phase_dir[2];
+            // all rows of all slices, and of every further image in the array, are corrected
+            size_t rows = (size_t)Ny*Nz;
+            size_t num = (Nx > 0 && rows > 0) ? m2->getObjectPtr()->get_number_of_elements() / ((size_t)Nx*rows) : 0;
+            std::complex<float>* data_ptr = m2->getObjectPtr()->get_data_ptr();
 
-                        if (Nz > 1) {
-                            dS[0] = (z-Nz/2+0.5) * dz * m1->getObjectPtr()->slice_dir[0];
-                            dS[1] = (z-Nz/2+0.5) * dz * m1->getObjectPtr()->slice_dir[1];
-                            dS[2] = (z-Nz/2+0.5) * dz * m1->getObjectPtr()->slice_dir[2];
-                        }
+            long long n;
 
-                        p[0] = m1->getObjectPtr()->position[0] + dP[0] + dR[0] + dS[0];
-                        p[1] = m1->getObjectPtr()->position[1] + dP[1] + dR[1] + dS[1];
-                        p[2] = m1->getObjectPtr()->position[2] + dP[2] + dR[2] + dS[2];
-
-                        //Convert to centimeters
-                        p[0] = p[0]/1000.0;
-                        p[1] = p[1]/1000.0;
-                        p[2] = p[2]/1000.0;
-
-                        float delta_phi = maxwell_coefficients_[0]*p[2]*p[2] +
-                            maxwell_coefficients_[1]*(p[0]*p[0] + p[1]*p[1]) + 
-                            maxwell_coefficients_[2]*p[0]*p[2] + 
-                            maxwell_coefficients_[3]*p[1]*p[2];
+#pragma omp parallel for private(n) if(num*rows*Nx > 64*1024)
+            for (n = 0; n < (long long)(num*rows); n++)
+            {
+                int y = (int)(n % Ny);
+                int z = (int)((n / Ny) % Nz);
 
-                        long index = z*Ny*Nx+y*Nx+x;
-                        std::complex<float>* data_ptr = m2->getObjectPtr()->get_data_ptr();
+                double q[3];
+                for (int i = 0; i < 3; i++)
+                {
+                    q[i] = h.position[i] + (-Nx/2 + 0.5) * dx * h.read_dir[i] + (y - Ny/2 + 0.5) * dy * h.phase_dir[i];
+                    if (Nz > 1) q[i] += (z - Nz/2 + 0.5) * dz * h.slice_dir[i];
 
-                        std::complex<float> correction = std::polar(1.0f,static_cast<float>(2*M_PI*delta_phi));
+                    //Convert to centimeters
+                    q[i] = q[i] / 1000.0;
+                }
 
-                        data_ptr[index] *= correction;
-                    }
+                double c0 = 0, c1 = 0;
+                for (int i = 0; i < 3; i++)
+                {
+                    c0 += q[i] * (A[i][0] * q[0] + A[i][1] * q[1] + A[i][2] * q[2]);
+                    c1 += 2 * q[i] * Ar[i];
                 }
+
+                std::complex<float>* pRow = data_ptr + n*Nx;
+                hoNDArraySimd::multiplyPhase(Nx, c0, c1, c2, pRow, pRow);
             }
 
         }
@@ -0,0 +1,115 @@
+/** \file   MetaContainerBinary.h
+\brief  Compact binary encoding of the ISMRMRD::MetaContainer attributes of image messages.
+
+        The XML form of ISMRMRD::serialize is built and parsed for every image, which dominates the
+        transfer of series with many small images. Clients that request it with a
+        GADGET_MESSAGE_ATTRIBUTE_ENCODING message receive the attributes in this form instead:
+
+          char[4]  magic "\0GMB", never the start of the XML form
+          uint32   number of names
+          per name:
+            uint32 length, bytes of the name
+            uint32 number of values
+            per value: uint32 length, bytes of the value string
+
+        Integers are in host byte order, as the rest of the message. The values are the strings of
+        MetaValue::as_str(), as in the XML form, so both forms decode to the same container.
+*/
+
+#ifndef MetaContainerBinary_H
+#define MetaContainerBinary_H
+
+#include "ismrmrd/meta.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Gadgetron{
+
+    static const char META_BINARY_MAGIC[4] = { '\0', 'G', 'M', 'B' };
+
+    /// Whether the len bytes at data are in the binary form, otherwise they are XML
+    inline bool is_meta_binary(const char* data, size_t len)
+    {
+        return (len >= sizeof(META_BINARY_MAGIC)) && (std::memcmp(data, META_BINARY_MAGIC, sizeof(META_BINARY_MAGIC)) == 0);
+    }
+
+    namespace meta_binary_detail
+    {
+        inline void put(std::string& out, uint32_t v)
+        {
+            out.append(reinterpret_cast<const char*>(&v), sizeof(uint32_t));
+        }
+
+        inline void put(std::string& out, const char* s, size_t len)
+        {
+            put(out, (uint32_t)len);
+            out.append(s, len);
+        }
+
+        inline uint32_t get(const char*& p, const char* end)
+        {
+            if ((size_t)(end - p) < sizeof(uint32_t)) throw std::runtime_error("Truncated binary meta attributes");
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(uint32_t));
+            p += sizeof(uint32_t);
+            return v;
+        }
+
+        inline std::string get_string(const char*& p, const char* end)
+        {
+            uint32_t len = get(p, end);
+            if ((size_t)(end - p) < len) throw std::runtime_error("Truncated binary meta attributes");
+            std::string s(p, len);
+            p += len;
+            return s;
+        }
+    }
+
+    /// Encodes meta into out, replacing its content
+    inline void serialize_meta_binary(const ISMRMRD::MetaContainer& meta, std::string& out)
+    {
+        out.assign(META_BINARY_MAGIC, sizeof(META_BINARY_MAGIC));
+
+        uint32_t names = 0;
+        for (auto it = meta.begin(); it != meta.end(); it++) names++;
+        meta_binary_detail::put(out, names);
+
+        for (auto it = meta.begin(); it != meta.end(); it++)
+        {
+            meta_binary_detail::put(out, it->first.c_str(), it->first.length());
+            meta_binary_detail::put(out, (uint32_t)it->second.size());
+
+            for (size_t v = 0; v < it->second.size(); v++)
+            {
+                const char* s = it->second[v].as_str();
+                meta_binary_detail::put(out, s, std::strlen(s));
+            }
+        }
+    }
+
+    /// Decodes the len bytes at data into meta, appending to its attributes. Throws if the data are malformed.
+    inline void deserialize_meta_binary(const char* data, size_t len, ISMRMRD::MetaContainer& meta)
+    {
+        if (!is_meta_binary(data, len)) throw std::runtime_error("Not binary meta attributes");
+
+        const char* p = data + sizeof(META_BINARY_MAGIC);
+        const char* end = data + len;
+
+        uint32_t names = meta_binary_detail::get(p, end);
+        for (uint32_t n = 0; n < names; n++)
+        {
+            std::string name = meta_binary_detail::get_string(p, end);
+            uint32_t values = meta_binary_detail::get(p, end);
+
+            for (uint32_t v = 0; v < values; v++)
+            {
+                std::string value = meta_binary_detail::get_string(p, end);
+                meta.append(name.c_str(), value.c_str());
+            }
+        }
+    }
+}
+#endif
@@ -1,7 +1,10 @@
 #ifndef NHLBICOMPRESSION_H
 #define NHLBICOMPRESSION_H
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <exception>
 #include <fstream>
 #include <iostream>
@@ -118,6 +121,116 @@ public:
         memcpy(&comp_[0], &buffer[sizeof(CompressionHeader)], bytes_needed);
     }
 
+    /**
+       Decompresses a serialized buffer straight into out, without building a CompressedBuffer.
+       The decoder reads 8 bytes at a time, buffer must be readable for 8 bytes beyond buffer_size.
+       @return number of decompressed elements, which must be equal to out_elements
+     */
+    static size_t decompress(const uint8_t* buffer, size_t buffer_size, T* out, size_t out_elements)
+    {
+        if (buffer_size <= sizeof(CompressionHeader)) {
+            throw std::runtime_error("Invalid buffer size");
+        }
+
+        CompressionHeader h;
+        memcpy(&h, buffer, sizeof(CompressionHeader));
+
+        size_t bytes_needed = static_cast<size_t>(std::ceil((h.bits_*h.elements_)/8.0f));
+        if (bytes_needed != (buffer_size-sizeof(CompressionHeader))) {
+            throw std::runtime_error("Incorrect number of bytes in buffer");
+        }
+
+        if (h.bits_ == 0 || h.bits_ > 56) {
+            throw std::runtime_error("Unsupported number of bits in compressed buffer");
+        }
+
+        if (h.elements_ != out_elements) {
+            throw std::runtime_error("Number of compressed elements does not match output size");
+        }
+
+        const uint8_t* comp = buffer + sizeof(CompressionHeader);
+        const size_t bits = h.bits_;
+        const uint64_t bitmask = (uint64_t(1)<<bits)-1;
+        const uint64_t signbit = uint64_t(1)<<(bits-1);
+
+        for (size_t idx = 0; idx < out_elements; idx++) {
+            size_t sb = (idx*bits)/8;
+            size_t upshift = idx*bits-sb*8;
+
+            uint64_t word;
+            memcpy(&word, comp + sb, sizeof(uint64_t));
+            uint64_t compact_val = (word>>upshift) & bitmask;
+
+            int64_t int_val = (compact_val & signbit) ?
+                -static_cast<int64_t>((compact_val ^ bitmask)+1) : static_cast<int64_t>(compact_val);
+
+            out[idx] = int_val / h.scale_;
+        }
+
+        return out_elements;
+    }
+
+    /**
+       Compresses in straight into the serialized format read by decompress, without building a CompressedBuffer.
+       As the constructor, the error is bounded by tolerance if tolerance > 0, otherwise precision_bits are used.
+       out is resized to hold 8 bytes beyond the serialized data, so the words can be written without bounds checks.
+       @return size of the serialized buffer in bytes
+     */
+    static size_t compress(const T* in, size_t elements, T tolerance, uint8_t precision_bits, std::vector<uint8_t>& out)
+    {
+        T max_val = 0;
+        for (size_t idx = 0; idx < elements; idx++) {
+            max_val = std::max(max_val, static_cast<T>(std::abs(in[idx])));
+        }
+
+        size_t bits = 0;
+        T scale = 1;
+        if (tolerance > 0) {
+            scale = 0.5/tolerance;
+            uint64_t max_int = static_cast<uint64_t>(std::ceil(std::abs(scale*max_val+1)));
+            while (max_int) {
+                bits++;
+                max_int = max_int>>1;
+            }
+            bits++; //Signed
+        } else {
+            bits = precision_bits;
+            uint64_t max_int = (uint64_t(1)<<(bits-1))-1;
+            if (max_val > 0) scale = (max_int-1)/max_val;
+        }
+
+        if (bits < 2 || bits > 56) {
+            throw std::runtime_error("Unsupported number of bits for compression");
+        }
+
+        size_t bytes_needed = static_cast<size_t>(std::ceil((bits*elements)/8.0f));
+        out.assign(sizeof(CompressionHeader) + bytes_needed + sizeof(uint64_t), 0);
+
+        CompressionHeader h;
+        h.elements_ = elements;
+        h.scale_ = scale;
+        h.bits_ = static_cast<uint8_t>(bits);
+        memcpy(&out[0], &h, sizeof(CompressionHeader));
+
+        uint8_t* comp = &out[sizeof(CompressionHeader)];
+        const uint64_t bitmask = (uint64_t(1)<<bits)-1;
+
+        for (size_t idx = 0; idx < elements; idx++) {
+            size_t sb = (idx*bits)/8;
+            size_t upshift = idx*bits-sb*8;
+
+            int64_t int_val = static_cast<int64_t>(std::round(in[idx]*scale));
+            uint64_t compact_val = static_cast<uint64_t>(int_val) & bitmask;
+
+            uint64_t word;
+            memcpy(&word, comp + sb, sizeof(uint64_t));
+            word |= compact_val << upshift;
+            memcpy(comp + sb, &word, sizeof(uint64_t));
+        }
+
+        return sizeof(CompressionHeader) + bytes_needed;
+    }
+
 private:
     size_t bits_;
     size_t elements_;
@@ -4,6 +4,7 @@
 #include "hoMatrix.h"
 #include "hoNDArray_linalg.h"
 #include "hoNDArray_reductions.h"
+#include "mri_core_dependencies.h"
 
 #ifdef USE_OMP
 #include "omp.h"
@@ -34,11 +35,15 @@ namespace Gadgetron{
     noise_dwell_time_us_preset_ = 0.0;
     perform_noise_adjust_ = true;
     pass_nonconformant_data_ = false;
+
+    // the prewhitening of single readouts does not pay off the OpenMP threads
+    omp_threads.value(1);
   }
 
   NoiseAdjustGadget::~NoiseAdjustGadget()
   {
-
+    for (size_t n = 0; n < prewhitening_batch_.size(); n++) prewhitening_batch_[n]->release();
+    prewhitening_batch_.clear();
   }
 
   int NoiseAdjustGadget::process_config(ACE_Message_Block* mb)
@@ -65,7 +70,7 @@ namespace Gadgetron{
     GDEBUG("NoiseAdjustGadget::pass_nonconformant_data_ is %d\n", pass_nonconformant_data_);
 
     noise_dwell_time_us_preset_ = noise_dwell_time_us_preset.value();
-    ISMRMRD::deserialize(mb->rd_ptr(),current_ismrmrd_header_);
+    current_ismrmrd_header_ = *this->get_ismrmrd_header(mb);
     
     if ( current_ismrmrd_header_.acquisitionSystemInformation ) {
       receiver_noise_bandwidth_ = (float)(current_ismrmrd_header_.acquisitionSystemInformation->relativeReceiverNoiseBandwidth ?
@@ -107,8 +112,12 @@ namespace Gadgetron{
 	      full_name_stored_noise_dependency_ = this->generateNoiseDependencyFilename(generateMeasurementIdOfNoiseDependency(measurement_id_of_noise_dependency_));
 	      GDEBUG("Stored noise dependency is %s\n", full_name_stored_noise_dependency_.c_str());
 		  
-	      // try to load the precomputed noise prewhitener
-	      if ( !this->loadNoiseCovariance() ) {
+	      noise_dependency_key_ = this->generateNoiseDependencyKey();
+
+	      // load the precomputed noise prewhitener
+	      bool loaded = this->loadNoiseCovariance();
+
+	      if ( !loaded ) {
 		GDEBUG("Stored noise dependency is NOT found : %s\n", full_name_stored_noise_dependency_.c_str());
 		noiseCovarianceLoaded_ = false;
 		noise_dwell_time_us_ = -1;
@@ -172,10 +181,6 @@ namespace Gadgetron{
       }
     }
 
-#ifdef USE_OMP
-    omp_set_num_threads(1);
-#endif // USE_OMP
-
     return GADGET_OK;
   }
 
@@ -213,12 +218,38 @@ namespace Gadgetron{
     return full_name_stored_noise_dependency;
   }
 
+  std::string NoiseAdjustGadget::generateNoiseDependencyKey()
+  {
+    std::ostringstream ostr;
+    ostr << "NoiseAdjustGadget\n";
+    if ( current_ismrmrd_header_.acquisitionSystemInformation ) {
+      for (size_t l = 0; l < current_ismrmrd_header_.acquisitionSystemInformation->coilLabel.size(); l++) {
+	ostr << current_ismrmrd_header_.acquisitionSystemInformation->coilLabel[l].coilNumber << ":" << current_ismrmrd_header_.acquisitionSystemInformation->coilLabel[l].coilName << ";";
+      }
+    }
+    ostr << "\n" << scale_only_channels_by_name.value();
+    return ostr.str();
+  }
+
   bool NoiseAdjustGadget::loadNoiseCovariance()
   {
-    std::ifstream infile;
-    infile.open (full_name_stored_noise_dependency_.c_str(), std::ios::in|std::ios::binary);
+    DependencyStore* store = DependencyStore::instance();
+
+    // served from memory if the file was read or written before
+    if (store->read(full_name_stored_noise_dependency_, noise_dependency_content_)) {
+
+      // parsed by an earlier series
+      std::shared_ptr<NoiseDependency> d = std::static_pointer_cast<NoiseDependency>(store->derived(full_name_stored_noise_dependency_, noise_dependency_key_));
+      if ( d ) {
+	GDEBUG("Stored noise dependency is found in memory : %s\n", full_name_stored_noise_dependency_.c_str());
+	noise_ismrmrd_header_ = d->noise_header;
+	noise_dwell_time_us_ = d->noise_dwell_time_us;
+	noise_covariance_matrixf_ = d->covariance;
+	return true;
+      }
+
+      std::istringstream infile(*noise_dependency_content_, std::ios::in|std::ios::binary);
 
-    if (infile.good()) {
       //Read the XML header of the noise scan
       uint32_t xml_length;
       infile.read( reinterpret_cast<char*>(&xml_length), 4);
@@ -243,7 +274,12 @@ namespace Gadgetron{
 	}
 
       delete [] buf;
-      infile.close();
+
+      d = std::make_shared<NoiseDependency>();
+      d->noise_header = noise_ismrmrd_header_;
+      d->noise_dwell_time_us = noise_dwell_time_us_;
+      d->covariance = noise_covariance_matrixf_;
+      store->set_derived(full_name_stored_noise_dependency_, noise_dependency_content_, noise_dependency_key_, d);
     } else {
       GDEBUG("Noise prewhitener file is not found. Proceeding without stored noise\n");
       return false;
@@ -279,34 +315,22 @@ namespace Gadgetron{
     std::string xml_str = xml_ss.str();
     uint32_t xml_length = static_cast<uint32_t>(xml_str.size());
 
-    std::ofstream outfile;
     std::string filename  = this->generateNoiseDependencyFilename(measurement_id_);
-    outfile.open (filename.c_str(), std::ios::out|std::ios::binary);
 
-    if (outfile.good())
-      {
-	GDEBUG("write out the noise dependency file : %s\n", filename.c_str());
-	outfile.write( reinterpret_cast<char*>(&xml_length), 4);
-	outfile.write( xml_str.c_str(), xml_length );
-	outfile.write( reinterpret_cast<char*>(&noise_dwell_time_us_), sizeof(float));
-	outfile.write( reinterpret_cast<char*>(&len), sizeof(size_t));
-	outfile.write(buf, len);
-	outfile.close();
-
-	// set the permission for the noise file to be rewritable
-#ifndef _WIN32
-	int res = chmod(filename.c_str(), S_IRUSR|S_IWUSR|S_IXUSR|S_IRGRP|S_IWGRP|S_IXGRP|S_IROTH|S_IWOTH|S_IXOTH);
-	if ( res != 0 ) {
-	  GDEBUG("Changing noise prewhitener file permission failed ...\n");
-	}
-#endif // _WIN32
-      } else {
-      delete [] buf;
-      GERROR_STREAM("Noise prewhitener file is not good for writing");
-      return false;
-    }
+    std::ostringstream outfile(std::ios::out|std::ios::binary);
+    outfile.write( reinterpret_cast<char*>(&xml_length), 4);
+    outfile.write( xml_str.c_str(), xml_length );
+    outfile.write( reinterpret_cast<char*>(&noise_dwell_time_us_), sizeof(float));
+    outfile.write( reinterpret_cast<char*>(&len), sizeof(size_t));
+    outfile.write(buf, len);
 
     delete [] buf;
+
+    // the file is written in the background, with the permission for the noise file to be rewritable;
+    // this drops the noise dependency parsed from an earlier scan of the same id
+    GDEBUG("write out the noise dependency file : %s\n", filename.c_str());
+    DependencyStore::instance()->write(filename, outfile.str(), true);
+
     return true;
   }
 
@@ -318,6 +342,19 @@ namespace Gadgetron{
     if (!noise_decorrelation_calculated_) {
       
       if (number_of_noise_samples_ > 0 ) {
+
+	// the prewhitener of a loaded noise dependency may have been computed by an earlier series
+	std::shared_ptr<NoiseDependency> d;
+	if ( noiseCovarianceLoaded_ ) {
+	  d = std::static_pointer_cast<NoiseDependency>(DependencyStore::instance()->derived(full_name_stored_noise_dependency_, noise_dependency_key_));
+	  if ( d && d->prewhitener.dimensions_equal(&noise_covariance_matrixf_) ) {
+	    GDEBUG("Using the noise decorrelation kept in memory\n");
+	    noise_prewhitener_matrixf_ = d->prewhitener;
+	    noise_decorrelation_calculated_ = true;
+	    return;
+	  }
+	}
+
 	GDEBUG("Calculating noise decorrelation\n");
 	
 	noise_prewhitener_matrixf_ = noise_covariance_matrixf_;
@@ -353,6 +390,12 @@ namespace Gadgetron{
 
     noise_decorrelation_calculated_ = true;
 
+    if ( d ) {
+      std::shared_ptr<NoiseDependency> with_prewhitener = std::make_shared<NoiseDependency>(*d);
+      with_prewhitener->prewhitener = noise_prewhitener_matrixf_;
+      DependencyStore::instance()->set_derived(full_name_stored_noise_dependency_, noise_dependency_content_, noise_dependency_key_, with_prewhitener);
+    }
+
       } else {
 	noise_decorrelation_calculated_ = false;
       }
@@ -449,6 +492,20 @@ namespace Gadgetron{
       if (noise_decorrelation_calculated_) {
           //Apply prewhitener
           if ( noise_prewhitener_matrixf_.get_size(0) == m2->getObjectPtr()->get_size(1) ) {
+               if ( prewhitening_batch_size.value() > 1 ) {
+                    prewhitening_batch_.push_back(m1);
+
+                    bool last = m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_LAST_IN_SLICE)
+                         || m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_LAST_IN_REPETITION)
+                         || m1->getObjectPtr()->isFlagSet(ISMRMRD::ISMRMRD_ACQ_LAST_IN_MEASUREMENT);
+
+                    if ( last || (prewhitening_batch_.size() >= prewhitening_batch_size.value()) ) {
+                         return this->flushPrewhiteningBatch();
+                    }
+
+                    return GADGET_OK;
+               }
+
                hoNDArray<std::complex<float> > tmp(*m2->getObjectPtr());
                gemm(*m2->getObjectPtr(), tmp, noise_prewhitener_matrixf_);
           } else {
@@ -461,6 +518,12 @@ namespace Gadgetron{
       }
     }
 
+    // keep the order of the readouts
+    if ( !prewhitening_batch_.empty() && (this->flushPrewhiteningBatch() != GADGET_OK) ) {
+      m1->release();
+      return GADGET_FAIL;
+    }
+
     if (this->next()->putq(m1) == -1) {
       GDEBUG("Error passing on data to next gadget\n");
       return GADGET_FAIL;
@@ -470,10 +533,65 @@ namespace Gadgetron{
 
   }
 
+  int NoiseAdjustGadget::flushPrewhiteningBatch()
+  {
+    if ( prewhitening_batch_.empty() ) return GADGET_OK;
+
+    size_t CHA = noise_prewhitener_matrixf_.get_size(0);
+
+    size_t total_RO = 0;
+    for (size_t n = 0; n < prewhitening_batch_.size(); n++) {
+      GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2 = AsContainerMessage< hoNDArray< std::complex<float> > >(prewhitening_batch_[n]->cont());
+      total_RO += m2->getObjectPtr()->get_size(0);
+    }
+
+    if ( (prewhitening_buf_.get_size(0) != total_RO) || (prewhitening_buf_.get_size(1) != CHA) ) {
+      prewhitening_buf_.create(total_RO, CHA);
+    }
+
+    // the readouts [RO CHA] are stacked along RO
+    size_t offset = 0;
+    for (size_t n = 0; n < prewhitening_batch_.size(); n++) {
+      hoNDArray< std::complex<float> >& d = *AsContainerMessage< hoNDArray< std::complex<float> > >(prewhitening_batch_[n]->cont())->getObjectPtr();
+      size_t RO = d.get_size(0);
+      for (size_t cha = 0; cha < CHA; cha++) {
+	memcpy(prewhitening_buf_.begin() + cha*total_RO + offset, d.begin() + cha*RO, sizeof(std::complex<float>)*RO);
+      }
+      offset += RO;
+    }
+
+    gemm(prewhitening_res_, prewhitening_buf_, noise_prewhitener_matrixf_);
+
+    offset = 0;
+    int result = GADGET_OK;
+    for (size_t n = 0; n < prewhitening_batch_.size(); n++) {
+      hoNDArray< std::complex<float> >& d = *AsContainerMessage< hoNDArray< std::complex<float> > >(prewhitening_batch_[n]->cont())->getObjectPtr();
+      size_t RO = d.get_size(0);
+      for (size_t cha = 0; cha < CHA; cha++) {
+	memcpy(d.begin() + cha*RO, prewhitening_res_.begin() + cha*total_RO + offset, sizeof(std::complex<float>)*RO);
+      }
+      offset += RO;
+
+      if ( result != GADGET_OK ) {
+	prewhitening_batch_[n]->release();
+      } else if (this->next()->putq(prewhitening_batch_[n]) == -1) {
+	GDEBUG("Error passing on data to next gadget\n");
+	prewhitening_batch_[n]->release();
+	result = GADGET_FAIL;
+      }
+    }
+
+    prewhitening_batch_.clear();
+    return result;
+  }
+
   int NoiseAdjustGadget::close(unsigned long flags)
   {
     if ( BaseClass::close(flags) != GADGET_OK ) return GADGET_FAIL;
 
+    // the remaining readouts, the next gadget is still open
+    if ( !prewhitening_batch_.empty() && (this->flushPrewhiteningBatch() != GADGET_OK) ) return GADGET_FAIL;
+
     if ( !noiseCovarianceLoaded_  && !saved_ ){
       saveNoiseCovariance();
       saved_ = true;
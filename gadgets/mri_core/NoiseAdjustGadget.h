@@ -8,6 +8,8 @@
 #include <ismrmrd/ismrmrd.h>
 #include <ismrmrd/xml.h>
 #include <complex>
+#include <string>
+#include <memory>
 
 namespace Gadgetron {
 
@@ -30,6 +32,7 @@ namespace Gadgetron {
       GADGET_PROPERTY(pass_nonconformant_data, bool, "Whether to pass data that does not conform", false);
       GADGET_PROPERTY(noise_dwell_time_us_preset, float, "Preset dwell time for noise measurement", 0.0);
       GADGET_PROPERTY(scale_only_channels_by_name, std::string, "List of named channels that should only be scaled", "");
+      GADGET_PROPERTY(prewhitening_batch_size, size_t, "Number of readouts gathered to apply the prewhitener as one matrix product, 1 to prewhiten every readout on arrival", 1);
 
       bool noise_decorrelation_calculated_;
       hoNDArray< std::complex<float> > noise_covariance_matrixf_;
@@ -55,6 +58,32 @@ namespace Gadgetron {
       std::string measurement_id_of_noise_dependency_;
       std::string full_name_stored_noise_dependency_;
 
+      // readouts waiting to be prewhitened, see prewhitening_batch_size
+      std::vector< GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* > prewhitening_batch_;
+      hoNDArray< std::complex<float> > prewhitening_buf_;
+      hoNDArray< std::complex<float> > prewhitening_res_;
+
+      /**
+         A parsed noise dependency and its prewhitener, kept with the file in the DependencyStore so that
+         later series skip the parsing and the Cholesky factorization. Shared between connections, so it is
+         replaced rather than changed.
+      */
+      struct NoiseDependency
+      {
+        ISMRMRD::IsmrmrdHeader noise_header;
+        float noise_dwell_time_us;
+        /// scaled noise covariance [CHA CHA], as stored in the file
+        hoNDArray< std::complex<float> > covariance;
+        /// prewhitener before the bandwidth scaling, empty until it has been computed
+        hoNDArray< std::complex<float> > prewhitener;
+      };
+
+      // contents of the loaded noise dependency file
+      std::shared_ptr<const std::string> noise_dependency_content_;
+
+      // the prewhitener depends on the coil labels and the scale only channels as well as on the file
+      std::string noise_dependency_key_;
+
       virtual int process_config(ACE_Message_Block* mb);
       virtual int process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
 			  GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2);
@@ -62,10 +91,15 @@ namespace Gadgetron {
       std::string generateNoiseDependencyFilename(const std::string& measurement_id);
       std::string generateMeasurementIdOfNoiseDependency(const std::string& noise_id);
 
+      std::string generateNoiseDependencyKey();
+
       bool loadNoiseCovariance();
       bool saveNoiseCovariance();
       void computeNoisePrewhitener();
 
+      /// prewhitens the readouts of prewhitening_batch_ as one [sum of RO, CHA] block and passes them on in order
+      int flushPrewhiteningBatch();
+
       //We will store/load a copy of the noise scans XML header to enable us to check which coil layout, etc.
       ISMRMRD::IsmrmrdHeader current_ismrmrd_header_;
       ISMRMRD::IsmrmrdHeader noise_ismrmrd_header_;
@@ -102,8 +102,8 @@ NoiseAdjustGadget_unoptimized::NoiseAdjustGadget_unoptimized()
 
 int NoiseAdjustGadget_unoptimized::process_config(ACE_Message_Block* mb)
 {
-  ISMRMRD::IsmrmrdHeader h;
-  ISMRMRD::deserialize(mb->rd_ptr(),h);
+  boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+  const ISMRMRD::IsmrmrdHeader& h = *header;
   
   if ( h.acquisitionSystemInformation ) {
     receiver_noise_bandwidth_ = (float)(h.acquisitionSystemInformation->relativeReceiverNoiseBandwidth ?
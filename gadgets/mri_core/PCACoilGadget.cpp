@@ -23,6 +23,7 @@ namespace Gadgetron {
         : max_buffered_profiles_(100)
         , samples_to_use_(16)
     {
+        omp_threads.value(1);
     }
 
     PCACoilGadget::~PCACoilGadget()
@@ -40,8 +41,8 @@ namespace Gadgetron {
 
     int PCACoilGadget::process_config(ACE_Message_Block *mb)
     {
-        ISMRMRD::IsmrmrdHeader h;
-        ISMRMRD::deserialize(mb->rd_ptr(), h);
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         std::string uncomb_str = uncombined_channels_by_name.value();
         std::vector<std::string> uncomb;
@@ -64,10 +65,6 @@ namespace Gadgetron {
         present_uncombined_channels.value((int)uncombined_channels_.size());
         GDEBUG("Number of uncombined channels (present_uncombined_channels) set to %d\n", uncombined_channels_.size());
 
-#ifdef USE_OMP
-        omp_set_num_threads(1);
-#endif // USE_OMP
-
         return GADGET_OK;
     }
 
@@ -207,6 +204,10 @@ namespace Gadgetron {
                     VT->prepare(A, (size_t)1, untransformed, (size_t)0, false);
 
                 }
+                else if (randomized_svd_modes.value() > 0)
+                {
+                    VT->prepare_randomized(A, (size_t)1, (size_t)randomized_svd_modes.value(), false);
+                }
                 else
                 {
                     VT->prepare(A, (size_t)1, (size_t)0, false);
@@ -242,6 +243,9 @@ namespace Gadgetron {
             if (pca_coefficients_[location] != 0)
             {
                 pca_coefficients_[location]->transform(*(m2->getObjectPtr()), *(m3->getObjectPtr()), 1);
+
+                //Fewer channels if only the leading modes are kept
+                m1->getObjectPtr()->active_channels = (uint16_t)m3->getObjectPtr()->get_size(1);
             }
 
             m1->cont(m3);
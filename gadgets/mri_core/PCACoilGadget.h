@@ -30,6 +30,7 @@ namespace Gadgetron {
   private:
     GADGET_PROPERTY(uncombined_channels_by_name, std::string, "List of comma separated channels by name", "");
     GADGET_PROPERTY(present_uncombined_channels, int, "Number of uncombined channels found", 0);
+    GADGET_PROPERTY(randomized_svd_modes, int, "If larger than 0, only this number of leading PCA channels are computed, with a randomized SVD, and passed on", 0);
 
     std::vector<unsigned int> uncombined_channels_;
     
@@ -31,8 +31,8 @@ namespace Gadgetron{
         mode_ = mode.value();
         first_beat_on_trigger_ = first_beat_on_trigger.value();
 
-        ISMRMRD::IsmrmrdHeader h;
-        ISMRMRD::deserialize(mb->rd_ptr(),h);
+        boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+        const ISMRMRD::IsmrmrdHeader& h = *header;
 
         interp_method_ = interp_method.value();
         if ( interp_method_.empty() ) interp_method_ = "Spline";
@@ -317,20 +317,33 @@ namespace Gadgetron{
 
                     size_t SplineDegree = 5;
 
+                    typedef hoNDBSpline< std::complex<float>, 1 > BSplineType;
+
+                    // the output phases are the same for every pixel, so the weights are computed once
+                    size_t num = relative_cycle_time.size();
+                    std::vector<float> x(outelem);
+                    for (size_t i = 0; i < outelem; i++)
+                    {
+                        x[i] = (num-1)*(recon_cycle_time[i]-relative_cycle_time[0])/(relative_cycle_time[num-1] - relative_cycle_time[0]);
+                    }
+
+                    std::vector<BSplineType::bspline_float_type> weight;
+                    std::vector<long long> index;
+                    BSplineType::computeBSplineGridWeights(inelem, SplineDegree, 0, x, weight, index);
+
+                    // coefficients of all pixels [imageelem inelem]
+                    hoNDArray< std::complex<float> > coeff_all(imageelem, inelem);
+
                     long long p;
-#pragma omp parallel default(none) shared(SplineDegree, imageelem, inelem, outelem, aptrs, relative_cycle_time, recon_cycle_time, out_data) private(p)
+#pragma omp parallel default(none) shared(SplineDegree, imageelem, inelem, aptrs, coeff_all) private(p)
                     {
                         hoNDArray< std::complex<float> > data_in(inelem);
-                        hoNDArray< std::complex<float> > data_out(outelem);
-
                         hoNDArray< std::complex<float> > coeff(inelem);
 
-                        hoNDBSpline< std::complex<float>, 1 > interp;
+                        BSplineType interp;
 
                         size_t i;
 
-                        size_t num = relative_cycle_time.size();
-
 #pragma omp for
                         for (p = 0; p < (long long)imageelem; p++)
                         {
@@ -340,17 +353,19 @@ namespace Gadgetron{
                             // compute the coefficient
                             interp.computeBSplineCoefficients(data_in, SplineDegree, coeff);
 
-                            //Interpolate the data
-                            for (i = 0; i < outelem; i++)
-                            {
-                                float x = (num-1)*(recon_cycle_time[i]-relative_cycle_time[0])/(relative_cycle_time[num-1] - relative_cycle_time[0]);
-                                data_out(i) = interp.evaluateBSpline(coeff.begin(), inelem, SplineDegree, 0, x);
-                            }
-
-                            //Copy it to the images
-                            for (i = 0; i < outelem; i++) out_data[i]->getObjectPtr()->get_data_ptr()[p] = data_out[i];
+                            for (i = 0; i < inelem; i++) coeff_all.begin()[p + i*imageelem] = coeff(i);
                         }
                     }
+
+                    //Interpolate all pixels at once, image i of the output is data_out(:, i)
+                    hoNDArray< std::complex<float> > data_out(imageelem, outelem);
+                    BSplineType::applyBSplineGridWeights(coeff_all.begin(), imageelem, inelem, 1, SplineDegree, &weight[0], &index[0], outelem, data_out.begin());
+
+                    //Copy it to the images
+                    for (size_t i = 0; i < outelem; i++)
+                    {
+                        memcpy(out_data[i]->getObjectPtr()->get_data_ptr(), data_out.begin() + i*imageelem, sizeof(std::complex<float>)*imageelem);
+                    }
                 }
 
                 //Send out the images
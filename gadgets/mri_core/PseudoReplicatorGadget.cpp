@@ -29,6 +29,8 @@ int PseudoReplicatorGadget::process(GadgetContainerMessage<IsmrmrdReconData>* m)
 	std::mt19937 engine;
 	std::normal_distribution<float> distribution;
 
+	// the replicas share the buffers, only the data they add noise to is copied
+	m->getObjectPtr()->share();
 	auto m_copy = *m->getObjectPtr();
 	//First just send the normal data to obtain standard image
 	if (this->next()->putq(m) == GADGET_FAIL)
@@ -1,5 +1,5 @@
 #include "RemoveROOversamplingGadget.h"
-#include "hoNDFFT.h"
+#include "mri_core_ro_oversampling.h"
 #include "ismrmrd/xml.h"
 
 #ifdef USE_OMP
@@ -10,6 +10,8 @@ namespace Gadgetron{
 
     RemoveROOversamplingGadget::RemoveROOversamplingGadget()
     {
+        // limit the number of threads used to be 1
+        omp_threads.value(1);
     }
 
     RemoveROOversamplingGadget::~RemoveROOversamplingGadget()
@@ -19,8 +21,8 @@ namespace Gadgetron{
     int RemoveROOversamplingGadget::process_config(ACE_Message_Block* mb)
     {
 
-	ISMRMRD::IsmrmrdHeader h;
-	ISMRMRD::deserialize(mb->rd_ptr(),h);
+	boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header = this->get_ismrmrd_header(mb);
+	const ISMRMRD::IsmrmrdHeader& h = *header;
 
 	if (h.encoding.size() == 0) {
 	  GDEBUG("Number of encoding spaces: %d\n", h.encoding.size());
@@ -37,12 +39,6 @@ namespace Gadgetron{
         reconNx_   = r_space.matrixSize.x;
         reconFOV_  = r_space.fieldOfView_mm.x;
 
-        // limit the number of threads used to be 1
-#ifdef USE_OMP
-        omp_set_num_threads(1);
-        GDEBUG_STREAM("RemoveROOversamplingGadget:omp_set_num_threads(1) ... ");
-#endif // USE_OMP
-
     // If the encoding and recon matrix size and FOV are the same
     // then the data is not oversampled and we can safely pass
     // the data onto the next gadget
@@ -54,6 +50,29 @@ namespace Gadgetron{
       dowork_ = true;
     }
 
+        halfband_taps_.clear();
+        halfband_center_tap_ = 0;
+
+        if (dowork_)
+        {
+            if (ro_oversampling_removal.value() == "deferred")
+            {
+                GDEBUG("Readout oversampling is passed on for deferred removal\n");
+                dowork_ = false;
+            }
+            else if (ro_oversampling_removal.value() == "halfband")
+            {
+                if (std::abs(encodeFOV_ / reconFOV_ - 2.0f) < 1e-3f && halfband_filter_taps.value() > 0)
+                {
+                    Gadgetron::generate_halfband_filter((size_t)halfband_filter_taps.value(), halfband_taps_, halfband_center_tap_);
+                }
+                else
+                {
+                    GWARN_STREAM("RemoveROOversamplingGadget, half-band removal needs 2x oversampling, fft is used for the FOV ratio " << encodeFOV_ / reconFOV_);
+                }
+            }
+        }
+
         return GADGET_OK;
     }
 
@@ -73,56 +92,35 @@ namespace Gadgetron{
             return GADGET_FAIL;
         }
 
-        std::vector<size_t> data_out_dims = *m2->getObjectPtr()->get_dimensions();
-        if ( !ifft_buf_.dimensions_equal(&data_out_dims) )
-        {
-            ifft_buf_.create(data_out_dims);
-            ifft_res_.create(data_out_dims);
-        }
-
         float ratioFOV = encodeFOV_/reconFOV_;
 
-        data_out_dims[0] = (size_t)(data_out_dims[0]/ratioFOV);
-        if ( !fft_buf_.dimensions_equal(&data_out_dims) )
+        size_t RO = m2->getObjectPtr()->get_size(0);
+        bool halfband = !halfband_taps_.empty() && (std::abs(ratioFOV - 2.0f) < 1e-3f) && (RO % 2 == 0);
+
+        try
         {
-            fft_buf_.create(data_out_dims);
-            fft_res_.create(data_out_dims);
+            if (halfband)
+            {
+                Gadgetron::remove_ro_oversampling_halfband(*m2->getObjectPtr(), halfband_taps_, halfband_center_tap_, *m3->getObjectPtr());
+            }
+            else
+            {
+                Gadgetron::remove_ro_oversampling_fft(*m2->getObjectPtr(), ratioFOV, *m3->getObjectPtr());
+            }
         }
-
-        try{ m3->getObjectPtr()->create(&data_out_dims);}
         catch (std::runtime_error &err)
         {
-            GEXCEPTION(err,"Unable to create new data array for downsampled data\n");
+            GEXCEPTION(err,"Unable to remove the readout oversampling\n");
+            m3->release();
             return GADGET_FAIL;
         }
 
-        size_t sRO = m2->getObjectPtr()->get_size(0);
-        size_t start = (size_t)( (m2->getObjectPtr()->get_size(0)-data_out_dims[0])/ratioFOV );
-
         size_t dRO = m3->getObjectPtr()->get_size(0);
-        size_t numOfBytes = data_out_dims[0]*sizeof(std::complex<float>);
-
-        int c;
-
-        int CHA = (int)(data_out_dims[1]);
-
-        std::complex<float>* data_in, *data_out;
-
-        hoNDFFT<float>::instance()->ifft(m2->getObjectPtr(), 0);
-        data_in  = m2->getObjectPtr()->get_data_ptr();
-        data_out = m3->getObjectPtr()->get_data_ptr();
-
-        for ( c=0; c<CHA; c++)
-        {
-            memcpy( data_out+c*dRO, data_in+c*sRO+start, numOfBytes );
-        }
-
-        hoNDFFT<float>::instance()->fft(m3->getObjectPtr(), 0);
 
         m2->release(); //We are done with this data
 
         m1->cont(m3);
-        m1->getObjectPtr()->number_of_samples = data_out_dims[0];
+        m1->getObjectPtr()->number_of_samples = (uint16_t)dRO;
         m1->getObjectPtr()->center_sample = (uint16_t)(m1->getObjectPtr()->center_sample/ratioFOV);
         m1->getObjectPtr()->discard_pre = (uint16_t)(m1->getObjectPtr()->discard_pre / ratioFOV);
         m1->getObjectPtr()->discard_post = (uint16_t)(m1->getObjectPtr()->discard_post / ratioFOV);
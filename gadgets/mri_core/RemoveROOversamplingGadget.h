@@ -18,6 +18,13 @@ namespace Gadgetron{
         RemoveROOversamplingGadget();
         virtual ~RemoveROOversamplingGadget();
 
+        /// fft: inverse fft, crop and fft of every readout
+        /// halfband: polyphase half-band filtering and decimation of every readout, for 2x oversampling; other ratios use fft
+        /// deferred: readouts are passed on oversampled, for the removal to be batched downstream (BucketToBufferGadget remove_ro_oversampling)
+        GADGET_PROPERTY_LIMITS(ro_oversampling_removal, std::string, "Method to remove the readout oversampling", "fft",
+            GadgetPropertyLimitsEnumeration, "fft", "halfband", "deferred");
+        GADGET_PROPERTY(halfband_filter_taps, int, "Number of nonzero odd taps of each half of the half-band filter", 32);
+
     protected:
 
         virtual int process_config(ACE_Message_Block* mb);
@@ -25,11 +32,9 @@ namespace Gadgetron{
         virtual int process(GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* m1,
             GadgetContainerMessage< hoNDArray< std::complex<float> > >* m2);
 
-        hoNDArray< std::complex<float> > fft_res_;
-        hoNDArray< std::complex<float> > ifft_res_;
-
-        hoNDArray< std::complex<float> > fft_buf_;
-        hoNDArray< std::complex<float> > ifft_buf_;
+        // odd taps and center tap of the half-band filter
+        std::vector<float> halfband_taps_;
+        float halfband_center_tap_;
 
         int   encodeNx_;
         float encodeFOV_;
@@ -140,14 +140,15 @@ int WhiteNoiseInjectorGadget::process_config(ACE_Message_Block* mb)
     randn_->seed( (unsigned long)seed );
 
     // ---------------------------------------------------------------------------------------------------------
-    ISMRMRD::IsmrmrdHeader h;
+    boost::shared_ptr<const ISMRMRD::IsmrmrdHeader> header;
     try {
-      deserialize(mb->rd_ptr(),h);
+      header = this->get_ismrmrd_header(mb);
     } catch (...) {
       GDEBUG("Error parsing ISMRMRD Header");
       throw;
       return GADGET_FAIL;
     }
+    const ISMRMRD::IsmrmrdHeader& h = *header;
 
     if( h.encoding.size() != 1)
     {
@@ -90,24 +90,31 @@ namespace Gadgetron{
 		hoNDArray<float> *dcw,
 		size_t nCoils
 	){
+		// all channels are gridded at once, [imageDimsOs[0] imageDimsOs[1] nCoils]
+		hoNDArray<float_complext> channelRecon = *reconstructChannels(data, traj, dcw, nCoils);
+
+		// root sum of squares over the channels
+		size_t num = imageDimsOs[0]*imageDimsOs[1];
 		hoNDArray<float_complext> arg;
-		arg.create(imageDimsOs[0], imageDimsOs[0]);
-		for(unsigned int i = 0; i < nCoils; ++i){
-			hoNDArray<float_complext> channelData(data->get_number_of_elements()/nCoils);
-			std::copy(data->begin()+i*(data->get_number_of_elements()/nCoils), data->begin()+(i+1)*(data->get_number_of_elements()/nCoils), channelData.begin());
-			
-			hoNDArray<float_complext> channelRecon = *reconstructChannel(&channelData, traj, dcw);
-			multiplyConj(channelRecon, channelRecon, channelRecon);
-			add(arg, channelRecon, arg);	
+		arg.create(imageDimsOs[0], imageDimsOs[1]);
+		float_complext* pRecon = channelRecon.get_data_ptr();
+		float_complext* pArg = arg.get_data_ptr();
+
+		#pragma omp parallel for
+		for(long long i = 0; i < (long long)num; i++){
+			float sum = 0;
+			for(size_t c = 0; c < nCoils; c++)
+				sum += norm(pRecon[c*num+i]);
+			pArg[i] = float_complext(std::sqrt(sum), 0);
 		}
-		sqrt_inplace(&arg);
 		return boost::make_shared<hoNDArray<float_complext>>(arg);
 	}	
 
-	boost::shared_ptr<hoNDArray<float_complext>> CPUGriddingReconGadget::reconstructChannel(
+	boost::shared_ptr<hoNDArray<float_complext>> CPUGriddingReconGadget::reconstructChannels(
 		hoNDArray<float_complext> *data,
 		hoNDArray<floatd2> *traj,
-		hoNDArray<float> *dcw
+		hoNDArray<float> *dcw,
+		size_t nCoils
 	){	
 		if(!iterateProperty.value()){
 			hoNFFT_plan<float, 2> plan(
@@ -115,7 +122,7 @@ namespace Gadgetron{
 				oversamplingFactor,
 				kernelWidth
 			);	
-			hoNDArray<float_complext> result; result.create(imageDimsOs[0], imageDimsOs[1]);
+			hoNDArray<float_complext> result; result.create(imageDimsOs[0], imageDimsOs[1], nCoils);
 			plan.preprocess(*traj);
 			plan.compute(*data, result, *dcw, hoNFFT_plan<float, 2>::NFFT_BACKWARDS_NC2C); 
 
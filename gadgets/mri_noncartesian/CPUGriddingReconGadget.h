@@ -76,17 +76,21 @@ namespace Gadgetron{
 		);
 
 		/**
-			Reconstruct single channel
+			Reconstruct all channels in one pass over the trajectory,
+			the kernel weights of a sample are computed once for all
+			channels and the grids are transformed with a batched FFT
 
-			/param data: single channel data
+			/param data: multi-channel k-space data, channels last
 			/param traj: trajectory
 			/param dcw: density compensation
+			/param nCoils: number of channels
 		*/
 
-		boost::shared_ptr<hoNDArray<float_complext>> reconstructChannel(
+		boost::shared_ptr<hoNDArray<float_complext>> reconstructChannels(
 			hoNDArray<float_complext> *data,
 			hoNDArray<floatd2> *traj,
-			hoNDArray<float> *dcw
+			hoNDArray<float> *dcw,
+			size_t nCoils
 		);
 
 		/**
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "hoNDArray.h"
+#include "cuNDArrayPayload.h"
 #include "vector_td.h"
 
 #include <ismrmrd/ismrmrd.h>
@@ -23,5 +24,47 @@ namespace Gadgetron{
     boost::shared_ptr< hoNDArray<float>          >  dcw_host_;
     boost::shared_ptr< hoNDArray<float_complext> >  csm_host_;
     boost::shared_ptr< hoNDArray<float_complext> >  reg_host_;
+
+    // Device resident csm and regularization image of a GPU prep gadget, set instead of csm_host_ and reg_host_.
+    // GPU gadgets use them without a round trip through the host, host gadgets download them on demand.
+    boost::shared_ptr< cuNDArrayPayload<float_complext> >  csm_device_;
+    boost::shared_ptr< cuNDArrayPayload<float_complext> >  reg_device_;
+
+    bool has_csm() const { return csm_host_.get() || csm_device_.get(); }
+    bool has_reg() const { return reg_host_.get() || reg_device_.get(); }
+
+    /// Host csm, downloaded from the device at the first call if the job only has the device csm
+    boost::shared_ptr< hoNDArray<float_complext> > csm_host()
+    {
+      if( !csm_host_.get() && csm_device_.get() ) csm_host_ = csm_device_->host_array();
+      return csm_host_;
+    }
+
+    /// Host regularization image, downloaded from the device at the first call if the job only has the device image
+    boost::shared_ptr< hoNDArray<float_complext> > reg_host()
+    {
+      if( !reg_host_.get() && reg_device_.get() ) reg_host_ = reg_device_->host_array();
+      return reg_host_;
+    }
+
+    /// csm on the current device for work on stream, shared with the producer (read-only) if the job has the device csm
+    boost::shared_ptr< cuNDArray<float_complext> > csm_device( cudaStream_t stream = 0 )
+    {
+      if( csm_device_.get() ) return csm_device_->device_array(stream);
+      return boost::shared_ptr< cuNDArray<float_complext> >( new cuNDArray<float_complext>(csm_host_.get()) );
+    }
+
+    /// Regularization image on the current device for work on stream, shared with the producer (read-only) if the job has the device image
+    boost::shared_ptr< cuNDArray<float_complext> > reg_device( cudaStream_t stream = 0 )
+    {
+      if( reg_device_.get() ) return reg_device_->device_array(stream);
+      return boost::shared_ptr< cuNDArray<float_complext> >( new cuNDArray<float_complext>(reg_host_.get()) );
+    }
+
+    /// Size of dimension dim of the regularization image, without a download
+    size_t reg_size( size_t dim ) const
+    {
+      return (reg_device_.get()) ? reg_device_->get_size(dim) : reg_host_->get_size(dim);
+    }
   };
 }
@@ -125,8 +125,8 @@ int gpuBufferSensePrepGadget::process(
 
 		auto tmp_combined = abs(reg_images.get());
 		auto tmpcsm = abs(csm.get());
-		job.csm_host_ = csm->to_host();
-		job.reg_host_ = combined->to_host();
+		job.csm_device_ = boost::make_shared< cuNDArrayPayload<float_complext> >(csm);
+		job.reg_device_ = boost::make_shared< cuNDArrayPayload<float_complext> >(combined);
 	}
 
 
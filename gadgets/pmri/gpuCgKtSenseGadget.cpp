@@ -29,7 +29,6 @@ namespace Gadgetron{
   {
     //GDEBUG("gpuCgKtSenseGadget::process_config\n");
 
-    device_number_ = deviceno.value();
 
     int number_of_devices = 0;
     if (cudaGetDeviceCount(&number_of_devices)!= cudaSuccess) {
@@ -42,10 +41,8 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    if (device_number_ >= number_of_devices) {
-      GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-      device_number_ = (device_number_%number_of_devices);
-    }
+    device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number_);
 
     if (cudaSetDevice(device_number_)!= cudaSuccess) {
       GDEBUG( "Error: unable to set CUDA device.\n" );
@@ -140,7 +137,7 @@ namespace Gadgetron{
     GenericReconJob* j = m2->getObjectPtr();
 
     // Some basic validation of the incoming Sense job
-    if (!j->csm_host_.get() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
+    if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
       GDEBUG("Received an incomplete Sense job\n");
       return GADGET_FAIL;
     }
@@ -159,7 +156,7 @@ namespace Gadgetron{
     boost::shared_ptr< cuNDArray<floatd2> > traj(new cuNDArray<floatd2> (j->tra_host_.get()));
     boost::shared_ptr< cuNDArray<float> > dcw(new cuNDArray<float> (j->dcw_host_.get()));
     sqrt_inplace(dcw.get()); //Take square root to use for weighting
-    boost::shared_ptr< cuNDArray<float_complext> > csm(new cuNDArray<float_complext> (j->csm_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > csm = j->csm_device();
     boost::shared_ptr< cuNDArray<float_complext> > device_samples(new cuNDArray<float_complext> (j->dat_host_.get()));
 
     cudaDeviceProp deviceProp;
@@ -170,7 +167,7 @@ namespace Gadgetron{
     
     unsigned int warp_size = deviceProp.warpSize;
     
-    matrix_size_ = uint64d2( j->reg_host_->get_size(0), j->reg_host_->get_size(1) );    
+    matrix_size_ = uint64d2( j->reg_size(0), j->reg_size(1) );    
 
     matrix_size_os_ =
       uint64d2(((static_cast<unsigned int>(std::ceil(matrix_size_[0]*oversampling_factor_))+warp_size-1)/warp_size)*warp_size,
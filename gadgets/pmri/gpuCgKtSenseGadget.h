@@ -14,6 +14,7 @@
 
 #include <ismrmrd/ismrmrd.h>
 #include <complex>
+#include "cudaDeviceManager.h"
 
 namespace Gadgetron{
 
@@ -27,7 +28,7 @@ namespace Gadgetron{
     virtual ~gpuCgKtSenseGadget();
 
   protected:
-    GADGET_PROPERTY(deviceno, int, "GPU device number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(setno, int, "Set to process", 0);
     GADGET_PROPERTY(sliceno, int, "Slice to process", 0);
     GADGET_PROPERTY(number_of_iterations, int, "Number of iterations", 5);
@@ -46,6 +47,7 @@ namespace Gadgetron{
 
     int channels_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
     int set_number_;
     int slice_number_;
 
@@ -10,6 +10,7 @@
 #include "vector_td_utilities.h"
 #include "hoNDArray_fileio.h"
 #include "ismrmrd/xml.h"
+#include <algorithm>
 
 namespace Gadgetron{
 
@@ -63,9 +64,17 @@ namespace Gadgetron{
 
      // Allocate encoding operator for non-Cartesian Sense
       E_ = boost::shared_ptr< cuNonCartesianSenseOperator<float,2> >( new cuNonCartesianSenseOperator<float,2>() );
+      E_->set_use_toeplitz( use_toeplitz.value() );
 
       // Allocate preconditioner
-      D_ = boost::shared_ptr< cuCgPreconditioner<float_complext> >( new cuCgPreconditioner<float_complext>() );
+      use_circulant_preconditioner_ = ( preconditioner.value() == "circulant" );
+      if( use_circulant_preconditioner_ ){
+        C_ = boost::shared_ptr< cuCirculantPreconditioner<float,2> >( new cuCirculantPreconditioner<float,2>() );
+        D_ = C_;
+      }
+      else
+        D_ = boost::shared_ptr< cuCgPreconditioner<float_complext> >( new cuCgPreconditioner<float_complext>() );
+      precon_cache_.set_capacity( std::max(1, preconditioner_cache_size.value()) );
 
       // Allocate regularization image operator
       R_ = boost::shared_ptr< cuImageOperator<float_complext> >( new cuImageOperator<float_complext>() );
@@ -77,6 +86,11 @@ namespace Gadgetron{
       cg_.set_preconditioner( D_ );           // preconditioning matrix
       cg_.set_max_iterations( number_of_iterations_ );
       cg_.set_tc_tolerance( cg_limit_ );
+      cg_.set_use_graphs( use_cuda_graphs.value() );
+      cg_.set_tc_check_interval( cg_check_interval.value() );
+      cg_.set_mixed_precision( mixed_precision.value() );
+      cg_.set_warm_start( warm_start.value() );
+      cg_.set_stagnation_termination( std::max(0, stagnation_iterations.value()), stagnation_ratio.value() );
       cg_.set_output_mode( (output_convergence_) ? cuCgSolver<float_complext>::OUTPUT_VERBOSE : cuCgSolver<float_complext>::OUTPUT_SILENT);
       is_configured_ = true;
     }
@@ -108,7 +122,7 @@ namespace Gadgetron{
     GenericReconJob* j = m2->getObjectPtr();
 
     // Some basic validation of the incoming Sense job
-    if (!j->csm_host_.get() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get() || !j->reg_host_.get()) {
+    if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get() || !j->has_reg()) {
       GDEBUG("Received an incomplete Sense job\n");
       return GADGET_FAIL;
     }
@@ -124,11 +138,12 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    boost::shared_ptr< cuNDArray<floatd2> > traj(new cuNDArray<floatd2> (j->tra_host_.get()));
-    boost::shared_ptr< cuNDArray<float> > dcw(new cuNDArray<float> (j->dcw_host_.get()));
+    gpuReconJobPrefetcher::DeviceJob device_job = prefetcher_.upload(j);
+    boost::shared_ptr< cuNDArray<floatd2> > traj = device_job.tra;
+    boost::shared_ptr< cuNDArray<float> > dcw = device_job.dcw;
     sqrt_inplace(dcw.get()); //Take square root to use for weighting
-    boost::shared_ptr< cuNDArray<float_complext> > csm(new cuNDArray<float_complext> (j->csm_host_.get()));
-    boost::shared_ptr< cuNDArray<float_complext> > device_samples(new cuNDArray<float_complext> (j->dat_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > csm = device_job.csm;
+    boost::shared_ptr< cuNDArray<float_complext> > device_samples = device_job.dat;
     
     cudaDeviceProp deviceProp;
     if( cudaGetDeviceProperties( &deviceProp, device_number_ ) != cudaSuccess) {
@@ -138,7 +153,7 @@ namespace Gadgetron{
     
     unsigned int warp_size = deviceProp.warpSize;
     
-    matrix_size_ = uint64d2( j->reg_host_->get_size(0), j->reg_host_->get_size(1) );    
+    matrix_size_ = uint64d2( j->reg_size(0), j->reg_size(1) );    
 
     matrix_size_os_ =
       uint64d2(((static_cast<unsigned int>(std::ceil(matrix_size_[0]*oversampling_factor_))+warp_size-1)/warp_size)*warp_size,
@@ -161,19 +176,56 @@ namespace Gadgetron{
     E_->setup( matrix_size_, matrix_size_os_, static_cast<float>(kernel_width_) );
     E_->preprocess(traj.get());
 
-    boost::shared_ptr< cuNDArray<float_complext> > reg_image(new cuNDArray<float_complext> (j->reg_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > reg_image = device_job.reg;
     R_->compute(reg_image.get());
 
-    // Define preconditioning weights
-    boost::shared_ptr< cuNDArray<float> > _precon_weights = sum(abs_square(csm.get()).get(), 2);
-    boost::shared_ptr<cuNDArray<float> > R_diag = R_->get();
-    *R_diag *= float(kappa_);
-    *_precon_weights += *R_diag;
-    R_diag.reset();
-    reciprocal_sqrt_inplace(_precon_weights.get());	
-    boost::shared_ptr< cuNDArray<float_complext> > precon_weights = real_to_complex<float_complext>( _precon_weights.get() );
-    _precon_weights.reset();
-    D_->set_weights( precon_weights );
+    // Define preconditioning weights, reused while the inputs they depend on are unchanged
+    typedef cgPreconditionerCache< cuNDArray<float_complext> > precon_cache_type;
+    precon_cache_type::key_type precon_key = precon_cache_type::hash( &kappa_, sizeof(kappa_) );
+    // Device resident inputs are identified by their payload, they are not downloaded for the hash
+    if( j->reg_device_.get() ){
+      unsigned long long serial = j->reg_device_->get_serial();
+      precon_key = precon_cache_type::hash( &serial, sizeof(serial), precon_key );
+    }
+    else
+      precon_key = precon_cache_type::hash( j->reg_host_->get_data_ptr(), j->reg_host_->get_number_of_bytes(), precon_key );
+    if( use_circulant_preconditioner_ ){
+      precon_key = precon_cache_type::hash( j->tra_host_->get_data_ptr(), j->tra_host_->get_number_of_bytes(), precon_key );
+      precon_key = precon_cache_type::hash( j->dcw_host_->get_data_ptr(), j->dcw_host_->get_number_of_bytes(), precon_key );
+    }
+    else if( j->csm_device_.get() ){
+      unsigned long long serial = j->csm_device_->get_serial();
+      precon_key = precon_cache_type::hash( &serial, sizeof(serial), precon_key );
+    }
+    else
+      precon_key = precon_cache_type::hash( j->csm_host_->get_data_ptr(), j->csm_host_->get_number_of_bytes(), precon_key );
+
+    boost::shared_ptr< cuNDArray<float_complext> > precon_weights = precon_cache_.find( precon_key );
+
+    if( precon_weights.get() ){
+      D_->set_weights( precon_weights );
+    }
+    else if( use_circulant_preconditioner_ ){
+      if( !use_toeplitz.value() )
+        E_->get_plan()->preprocess_toeplitz( traj.get(), dcw.get() );
+      boost::shared_ptr<cuNDArray<float> > R_diag = R_->get();
+      float regularization = float(kappa_)*asum(R_diag.get())/float(R_diag->get_number_of_elements());
+      R_diag.reset();
+      C_->set_toeplitz_kernel( E_->get_plan()->get_toeplitz_kernel().get(), regularization );
+      precon_cache_.insert( precon_key, C_->get_weights() );
+    }
+    else{
+      boost::shared_ptr< cuNDArray<float> > _precon_weights = sum(abs_square(csm.get()).get(), 2);
+      boost::shared_ptr<cuNDArray<float> > R_diag = R_->get();
+      *R_diag *= float(kappa_);
+      *_precon_weights += *R_diag;
+      R_diag.reset();
+      reciprocal_sqrt_inplace(_precon_weights.get());	
+      precon_weights = real_to_complex<float_complext>( _precon_weights.get() );
+      _precon_weights.reset();
+      D_->set_weights( precon_weights );
+      precon_cache_.insert( precon_key, precon_weights );
+    }
     
     //Apply dcw weights
     *device_samples *= *dcw;
@@ -195,6 +247,10 @@ namespace Gadgetron{
       counter++; 
       }*/
 
+    // The next job is uploaded while this one is solved
+    if( prefetch_jobs_ )
+      prefetcher_.prefetch( this->msg_queue(), set_number_, slice_number_ );
+
     // Invoke solver
     // 
     boost::shared_ptr< cuNDArray<float_complext> > cgresult;
@@ -9,6 +9,8 @@
 #include "cuCgSolver.h"
 #include "cuNonCartesianSenseOperator.h"
 #include "cuCgPreconditioner.h"
+#include "cuCirculantPreconditioner.h"
+#include "cgPreconditionerCache.h"
 #include "cuNFFT.h"
 #include "cuImageOperator.h"
 
@@ -32,6 +34,16 @@ namespace Gadgetron{
     GADGET_PROPERTY(kappa, float, "Regularization factor kappa", 0.3);
     GADGET_PROPERTY(number_of_iterations, int, "Max number of iterations in CG solver", 5);
     GADGET_PROPERTY(cg_limit, float, "Residual limit for CG convergence", 1e-6);
+    GADGET_PROPERTY(use_toeplitz, bool, "Apply the normal operator with a precomputed Toeplitz kernel", false);
+    GADGET_PROPERTY(use_cuda_graphs, bool, "Replay the CG vector updates from CUDA graphs with the scalars kept on the GPU", false);
+    GADGET_PROPERTY(cg_check_interval, int, "Iterations between convergence checks when using CUDA graphs", 1);
+    GADGET_PROPERTY(mixed_precision, bool, "Accumulate the CG inner products in double precision and recompute a stalled residual", false);
+    GADGET_PROPERTY(warm_start, bool, "Start each solve from the solution of the previous frames", false);
+    GADGET_PROPERTY(stagnation_iterations, int, "Stop when the residual stagnates over this many iterations (0 disables)", 0);
+    GADGET_PROPERTY(stagnation_ratio, float, "Relative residual decrease regarded as stagnation", 0.95);
+    GADGET_PROPERTY_LIMITS(preconditioner, std::string, "Diagonal (coil sensitivity) or circulant (Toeplitz) preconditioner", "diagonal",
+                           GadgetPropertyLimitsEnumeration, "diagonal", "circulant");
+    GADGET_PROPERTY(preconditioner_cache_size, int, "Number of preconditioners kept for unchanged coil maps and trajectories", 4);
 
     virtual int process( GadgetContainerMessage< ISMRMRD::ImageHeader > *m1, GadgetContainerMessage< GenericReconJob > *m2 );
     virtual int process_config( ACE_Message_Block* mb );
@@ -52,6 +64,11 @@ namespace Gadgetron{
 
     // Define preconditioner
     boost::shared_ptr< cuCgPreconditioner<float_complext> > D_;
+    boost::shared_ptr< cuCirculantPreconditioner<float,2> > C_;
+    bool use_circulant_preconditioner_;
+
+    // Preconditioner weights by the inputs they were computed from
+    cgPreconditionerCache< cuNDArray<float_complext> > precon_cache_;
 
     // Define regularization image operator
     boost::shared_ptr< cuImageOperator<float_complext> > R_;
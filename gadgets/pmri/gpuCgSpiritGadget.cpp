@@ -107,7 +107,7 @@ namespace Gadgetron{
     GenericReconJob* j = m2->getObjectPtr();
 
     // Some basic validation of the incoming Spirit job
-    if (!j->csm_host_.get() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get() || !j->reg_host_.get()) {
+    if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get() || !j->has_reg()) {
       GDEBUG("Received an incomplete Spirit job\n");
       return GADGET_FAIL;
     }
@@ -126,7 +126,7 @@ namespace Gadgetron{
     boost::shared_ptr< cuNDArray<floatd2> > traj(new cuNDArray<floatd2> (j->tra_host_.get()));
     boost::shared_ptr< cuNDArray<float> > dcw(new cuNDArray<float> (j->dcw_host_.get()));
     sqrt_inplace(dcw.get()); //Take square root to use for weighting
-    boost::shared_ptr< cuNDArray<float_complext> > csm(new cuNDArray<float_complext> (j->csm_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > csm = j->csm_device();
     boost::shared_ptr< cuNDArray<float_complext> > device_samples(new cuNDArray<float_complext> (j->dat_host_.get()));
     
     cudaDeviceProp deviceProp;
@@ -137,7 +137,7 @@ namespace Gadgetron{
     
     unsigned int warp_size = deviceProp.warpSize;
     
-    matrix_size_ = uint64d2( j->reg_host_->get_size(0), j->reg_host_->get_size(1) );    
+    matrix_size_ = uint64d2( j->reg_size(0), j->reg_size(1) );    
 
     matrix_size_os_ =
       uint64d2(((static_cast<unsigned int>(std::ceil(matrix_size_[0]*oversampling_factor_))+warp_size-1)/warp_size)*warp_size,
@@ -167,7 +167,7 @@ namespace Gadgetron{
     S_->set_codomain_dimensions(&image_dims);
 
     /*
-    boost::shared_ptr< cuNDArray<float_complext> > reg_image(new cuNDArray<float_complext> (j->reg_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > reg_image = j->reg_device();
     R_->compute(reg_image.get());
 
     // Define preconditioning weights
@@ -34,7 +34,6 @@ namespace Gadgetron{
     // Get configuration values from config file
     //
 
-    device_number_ = deviceno.value();
     rotations_per_reconstruction_ = rotations_per_reconstruction.value();
     buffer_length_in_rotations_ = buffer_length_in_rotations.value();
     buffer_using_solver_ = buffer_using_solver.value();
@@ -75,10 +74,8 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    if (device_number_ >= number_of_devices) {
-      GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-      device_number_ = (device_number_%number_of_devices);
-    }
+    device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number_);
 
     if (cudaSetDevice(device_number_)!= cudaSuccess) {
       GDEBUG( "Error: unable to set CUDA device.\n" );
@@ -13,6 +13,7 @@
 #include <complex>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include "cudaDeviceManager.h"
 
 namespace Gadgetron{
 
@@ -27,7 +28,7 @@ namespace Gadgetron{
     virtual ~gpuGenericSensePrepGadget();
 
   protected:
-    GADGET_PROPERTY(deviceno, int, "GPU device number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(buffer_length_in_rotations, int, "Number of rotations in a buffer", 1);
     GADGET_PROPERTY(buffer_using_solver, bool, "Use solver for buffer", false);
     GADGET_PROPERTY(buffer_convolution_kernel_width, float, "Convolution kernel width for buffer", 5.5);
@@ -81,6 +82,7 @@ namespace Gadgetron{
     int slices_;
     int sets_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
     long samples_per_readout_;
 
     boost::shared_array<long> image_counter_;
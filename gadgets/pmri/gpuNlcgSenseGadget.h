@@ -8,6 +8,7 @@
 #include "gadgetron_gpupmri_export.h"
 #include "Gadget.h"
 #include "GenericReconJob.h"
+#include "gpuReconJobPrefetcher.h"
 #include "GadgetMRIHeaders.h"
 #include "cuNlcgSolver.h"
 #include "cuNonCartesianSenseOperator.h"
@@ -20,6 +21,7 @@
 #include "cuTvPicsOperator.h"
 
 #include <complex>
+#include "cudaDeviceManager.h"
 
 namespace Gadgetron{
 
@@ -32,7 +34,7 @@ namespace Gadgetron{
     virtual ~gpuNlcgSenseGadget();
 
   protected:
-    GADGET_PROPERTY(deviceno, int, "GPU device number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(setno, int, "Which set to process", 0);
     GADGET_PROPERTY(sliceno, int, "Which slice to process", 0);
     GADGET_PROPERTY(cg_limit, float, "Convervence limit for CG", 1e-6);
@@ -44,12 +46,14 @@ namespace Gadgetron{
     GADGET_PROPERTY(number_of_cg_iterations, int, "Number of CG iterations", 0);
     GADGET_PROPERTY(rotations_to_discard, int, "Rotations to discard", 0);
     GADGET_PROPERTY(output_convergence, bool, "Output convergence information", false);
+    GADGET_PROPERTY(prefetch_jobs, bool, "Upload the next job in the queue while the current job is solved", true);
     
     virtual int process( GadgetContainerMessage< ISMRMRD::ImageHeader >* m1, GadgetContainerMessage< GenericReconJob > * m2 );
     virtual int process_config( ACE_Message_Block* mb );
 
     int channels_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
     int set_number_;
     int slice_number_;
 
@@ -71,6 +75,10 @@ namespace Gadgetron{
     bool exclusive_access_;
     bool is_configured_;
     bool prepared_;
+    bool prefetch_jobs_;
+
+    // Uploads the jobs, the next one ahead of time with prefetch_jobs
+    gpuReconJobPrefetcher prefetcher_;
 
     // Define non-linear conjugate gradient solver
     cuNlcgSolver<float_complext> solver_;
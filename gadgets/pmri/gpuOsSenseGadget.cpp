@@ -129,7 +129,7 @@ int gpuOsSenseGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader> *m1,
 	GenericReconJob* j = m2->getObjectPtr();
 
 	// Let's first check that this job has the required data...
-	if (!j->csm_host_.get() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
+	if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
 		GDEBUG("Received an incomplete Sense job\n");
 		return GADGET_FAIL;
 	}
@@ -148,14 +148,14 @@ int gpuOsSenseGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader> *m1,
 	boost::shared_ptr< cuNDArray<floatd2> > traj(new cuNDArray<floatd2> (j->tra_host_.get()));
 	boost::shared_ptr< cuNDArray<float> > dcw(new cuNDArray<float> (j->dcw_host_.get()));
 	sqrt_inplace(dcw.get());
-	boost::shared_ptr< cuNDArray<float_complext> > csm(new cuNDArray<float_complext> (j->csm_host_.get()));
+	boost::shared_ptr< cuNDArray<float_complext> > csm = j->csm_device();
 	boost::shared_ptr< cuNDArray<float_complext> > device_samples(new cuNDArray<float_complext> (j->dat_host_.get()));
 
 
 	// Take the reconstruction matrix size from the regulariaztion image.
 	// It could be oversampled from the sequence specified size...
 
-	matrix_size_ = uint64d2( j->reg_host_->get_size(0), j->reg_host_->get_size(1) );
+	matrix_size_ = uint64d2( j->reg_size(0), j->reg_size(1) );
 
 	cudaDeviceProp deviceProp;
 	if( cudaGetDeviceProperties( &deviceProp, device_number_ ) != cudaSuccess) {
@@ -198,8 +198,8 @@ int gpuOsSenseGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader> *m1,
 	//
 
 	{
-		cuNDArray<float_complext> tmp(*j->reg_host_);
-		*reg_image_ = *expand( &tmp, frames );
+		boost::shared_ptr< cuNDArray<float_complext> > tmp = j->reg_device();
+		*reg_image_ = *expand( tmp.get(), frames );
 	}
 	PICS_->set_prior(reg_image_);
 
@@ -235,10 +235,10 @@ int gpuOsSenseGadget::process(GadgetContainerMessage<ISMRMRD::ImageHeader> *m1,
 	//
 
 	if( alpha_ > 0.0 ){
-		cuNDArray<float_complext> gpureg(j->reg_host_.get());
+		boost::shared_ptr< cuNDArray<float_complext> > gpureg = j->reg_device();
 		boost::shared_ptr< cuNDArray<float_complext> > gpurec = sum(result.get(),2);
 		*gpurec /= float(result->get_size(2));
-		float scale = abs(dot(gpurec.get(), gpurec.get())/dot(gpurec.get(),&gpureg));
+		float scale = abs(dot(gpurec.get(), gpurec.get())/dot(gpurec.get(),gpureg.get()));
 		GDEBUG("Scaling factor between regularization and reconstruction is %f.\n", scale);
 	}
 
@@ -0,0 +1,140 @@
+#include "gpuReconJobPrefetcher.h"
+#include "cudaMemoryCache.h"
+#include "GadgetContainerMessage.h"
+#include "log.h"
+
+#include <ismrmrd/ismrmrd.h>
+#include <cstring>
+
+namespace Gadgetron{
+
+  gpuReconJobPrefetcher::gpuReconJobPrefetcher()
+    : stream_(0)
+    , uploaded_(0)
+    , device_(-1)
+    , job_(0)
+  {
+  }
+
+  gpuReconJobPrefetcher::~gpuReconJobPrefetcher()
+  {
+    clear();
+    if (uploaded_) cudaEventDestroy(uploaded_);
+    if (stream_) cudaStreamDestroy(stream_);
+  }
+
+  void gpuReconJobPrefetcher::clear()
+  {
+    // The staging buffers and the device memory are in use until the copies are done
+    if (job_ && uploaded_) cudaEventSynchronize(uploaded_);
+    job_ = 0;
+    job_dat_.reset();
+    device_job_ = DeviceJob();
+  }
+
+  template <class T> boost::shared_ptr< cuNDArray<T> >
+  gpuReconJobPrefetcher::upload_async(const hoNDArray<T>& in, hoCuNDArray<T>& staging)
+  {
+    if (staging.get_number_of_elements() != in.get_number_of_elements()) {
+      staging.create(in.get_dimensions());
+    }
+    memcpy(staging.get_data_ptr(), in.get_data_ptr(), in.get_number_of_bytes());
+
+    T* data = static_cast<T*>(cudaMemoryCache::instance()->allocate(in.get_number_of_bytes(), stream_));
+    if (!data) {
+      throw cuda_error("gpuReconJobPrefetcher: unable to allocate device memory");
+    }
+
+    boost::shared_ptr< cuNDArray<T> > out(new cuNDArray<T>(in.get_dimensions(), data, true));
+    out->from_host_async(staging, stream_);
+    return out;
+  }
+
+  void gpuReconJobPrefetcher::prefetch(ACE_Message_Queue<ACE_MT_SYNCH>* queue, unsigned int set, unsigned int slice)
+  {
+    // Double buffering, one job is solved while the next one is uploaded
+    if (job_ || !queue) return;
+
+    ACE_Message_Block* mb = 0;
+    ACE_Time_Value nowait(ACE_OS::gettimeofday());
+    if (queue->peek_dequeue_head(mb, &nowait) == -1 || !mb) return;
+
+    GadgetContainerMessage<ISMRMRD::ImageHeader>* m1 = AsContainerMessage<ISMRMRD::ImageHeader>(mb);
+    if (!m1 || m1->getObjectPtr()->set != set || m1->getObjectPtr()->slice != slice) return;
+
+    GadgetContainerMessage<GenericReconJob>* m2 = AsContainerMessage<GenericReconJob>(m1->cont());
+    if (!m2) return;
+
+    GenericReconJob* j = m2->getObjectPtr();
+    if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) return;
+
+    try {
+      int device;
+      CUDA_CALL(cudaGetDevice(&device));
+      if (stream_ && device != device_) {
+        cudaEventDestroy(uploaded_);
+        cudaStreamDestroy(stream_);
+        uploaded_ = 0;
+        stream_ = 0;
+      }
+
+      if (!stream_) {
+        // Non-blocking, the copies do not wait for the solver on the default stream
+        CUDA_CALL(cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking));
+        CUDA_CALL(cudaEventCreateWithFlags(&uploaded_, cudaEventDisableTiming));
+        device_ = device;
+      }
+
+      // The copies of the previous prefetch may still read from the staging buffers
+      CUDA_CALL(cudaEventSynchronize(uploaded_));
+
+      device_job_.tra = upload_async(*j->tra_host_, tra_staging_);
+      device_job_.dcw = upload_async(*j->dcw_host_, dcw_staging_);
+      device_job_.dat = upload_async(*j->dat_host_, dat_staging_);
+
+      // Device resident arrays are not uploaded, the upload stream waits for their producers instead
+      device_job_.csm = (j->csm_device_.get()) ? j->csm_device(stream_) : upload_async(*j->csm_host_, csm_staging_);
+      if (j->has_reg()) device_job_.reg = (j->reg_device_.get()) ? j->reg_device(stream_) : upload_async(*j->reg_host_, reg_staging_);
+
+      CUDA_CALL(cudaEventRecord(uploaded_, stream_));
+      job_ = j;
+      job_dat_ = j->dat_host_;
+    } catch (const std::exception& e) {
+      GDEBUG("gpuReconJobPrefetcher: prefetch failed, the job is uploaded when it is processed: %s\n", e.what());
+      if (stream_) cudaStreamSynchronize(stream_);
+      device_job_ = DeviceJob();
+      job_ = 0;
+      job_dat_.reset();
+    }
+  }
+
+  gpuReconJobPrefetcher::DeviceJob gpuReconJobPrefetcher::upload(GenericReconJob* j)
+  {
+    DeviceJob d;
+
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+
+    if (job_ && j == job_ && j->dat_host_ == job_dat_ && device == device_) {
+      // Work on the default stream starts once the copies are complete
+      CUDA_CALL(cudaStreamWaitEvent(0, uploaded_, 0));
+      d = device_job_;
+
+      // The staging buffers are overwritten by the next prefetch, which waits for the event itself
+      job_ = 0;
+      job_dat_.reset();
+      device_job_ = DeviceJob();
+      return d;
+    }
+
+    // Not prefetched, e.g. the first job or a job that arrived while the previous one was solved
+    clear();
+
+    d.tra = boost::shared_ptr< cuNDArray<floatd2> >(new cuNDArray<floatd2>(j->tra_host_.get()));
+    d.dcw = boost::shared_ptr< cuNDArray<float> >(new cuNDArray<float>(j->dcw_host_.get()));
+    d.csm = j->csm_device();
+    d.dat = boost::shared_ptr< cuNDArray<float_complext> >(new cuNDArray<float_complext>(j->dat_host_.get()));
+    if (j->has_reg()) d.reg = j->reg_device();
+    return d;
+  }
+}
@@ -0,0 +1,73 @@
+/** \file   gpuReconJobPrefetcher.h
+    \brief  Uploads the next GenericReconJob while the current one is solved.
+
+            Before a gadget starts its solver, prefetch() looks at the head of the gadget's message
+            queue. If the next job is waiting there already, its arrays are staged in pinned memory and
+            copied to the device on a non-blocking stream, so the copies overlap with the solver running
+            on the default stream. upload() returns the device arrays of a job, from the prefetch if there
+            was one, with synchronous copies otherwise. The default stream waits for the prefetched copies.
+
+            The device memory of a prefetch is allocated for the upload stream, see cudaMemoryCache.h,
+            so it is never handed out to the default stream while kernels of a finished job may still use it.
+
+            The device resident csm and regularization image of a job (see cuNDArrayPayload.h) are not
+            copied, the job shares them with the gadget that produced them.
+*/
+
+#pragma once
+
+#include "gadgetron_gpupmri_export.h"
+#include "GenericReconJob.h"
+#include "cuNDArray.h"
+#include "hoCuNDArray.h"
+
+#include <ace/Message_Queue.h>
+#include <ace/Synch.h>
+#include <boost/shared_ptr.hpp>
+
+namespace Gadgetron{
+
+  class EXPORTGADGETS_GPUPMRI gpuReconJobPrefetcher
+  {
+  public:
+
+    gpuReconJobPrefetcher();
+    ~gpuReconJobPrefetcher();
+
+    struct DeviceJob
+    {
+      boost::shared_ptr< cuNDArray<floatd2> > tra;
+      boost::shared_ptr< cuNDArray<float> > dcw;
+      boost::shared_ptr< cuNDArray<float_complext> > csm;
+      boost::shared_ptr< cuNDArray<float_complext> > dat;
+      boost::shared_ptr< cuNDArray<float_complext> > reg; // empty if the job has no regularization image
+    };
+
+    /// Device copies of the arrays of job j on the current device
+    DeviceJob upload(GenericReconJob* j);
+
+    /// Start the upload of the next job in the queue if it is a job for this set and slice
+    void prefetch(ACE_Message_Queue<ACE_MT_SYNCH>* queue, unsigned int set, unsigned int slice);
+
+  protected:
+
+    template <class T> boost::shared_ptr< cuNDArray<T> > upload_async(const hoNDArray<T>& in, hoCuNDArray<T>& staging);
+
+    void clear();
+
+    cudaStream_t stream_;
+    cudaEvent_t uploaded_;
+    int device_;
+
+    // The prefetched job, the data array is held so that its address identifies the job
+    GenericReconJob* job_;
+    boost::shared_ptr< hoNDArray<float_complext> > job_dat_;
+    DeviceJob device_job_;
+
+    hoCuNDArray<floatd2> tra_staging_;
+    hoCuNDArray<float> dcw_staging_;
+    hoCuNDArray<float_complext> csm_staging_;
+    hoCuNDArray<float_complext> dat_staging_;
+    hoCuNDArray<float_complext> reg_staging_;
+  };
+}
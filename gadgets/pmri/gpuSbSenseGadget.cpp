@@ -155,7 +155,7 @@ namespace Gadgetron{
     GenericReconJob* j = m2->getObjectPtr();
 
     // Let's first check that this job has the required data...
-    if (!j->csm_host_.get() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
+    if (!j->has_csm() || !j->dat_host_.get() || !j->tra_host_.get() || !j->dcw_host_.get()) {
       GDEBUG("Received an incomplete Sense job\n");
       return GADGET_FAIL;
     }
@@ -171,18 +171,19 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    boost::shared_ptr< cuNDArray<floatd2> > traj(new cuNDArray<floatd2> (j->tra_host_.get()));
-    boost::shared_ptr< cuNDArray<float> > dcw(new cuNDArray<float> (j->dcw_host_.get()));
+    gpuReconJobPrefetcher::DeviceJob device_job = prefetcher_.upload(j);
+    boost::shared_ptr< cuNDArray<floatd2> > traj = device_job.tra;
+    boost::shared_ptr< cuNDArray<float> > dcw = device_job.dcw;
     sqrt_inplace(dcw.get());
-    boost::shared_ptr< cuNDArray<float_complext> > csm(new cuNDArray<float_complext> (j->csm_host_.get()));
-    boost::shared_ptr< cuNDArray<float_complext> > device_samples(new cuNDArray<float_complext> (j->dat_host_.get()));
+    boost::shared_ptr< cuNDArray<float_complext> > csm = device_job.csm;
+    boost::shared_ptr< cuNDArray<float_complext> > device_samples = device_job.dat;
     
     if( !prepared_){
 
       // Take the reconstruction matrix size from the regulariaztion image. 
       // It could be oversampled from the sequence specified size...
       
-      matrix_size_ = uint64d2( j->reg_host_->get_size(0), j->reg_host_->get_size(1) );
+      matrix_size_ = uint64d2( j->reg_size(0), j->reg_size(1) );
       
       cudaDeviceProp deviceProp;
       if( cudaGetDeviceProperties( &deviceProp, device_number_ ) != cudaSuccess) {
@@ -284,8 +285,7 @@ namespace Gadgetron{
     //
 
     {
-      cuNDArray<float_complext> tmp(*j->reg_host_);
-      *reg_image_ = *expand( &tmp, frames );
+      *reg_image_ = *expand( device_job.reg.get(), frames );
     }
 
     // Define preconditioning weights
@@ -301,6 +301,10 @@ namespace Gadgetron{
     //Apply weights
     *device_samples *= *dcw;
 
+    // The next job is uploaded while this one is solved
+    if( prefetch_jobs_ )
+      prefetcher_.prefetch( this->msg_queue(), set_number_, slice_number_ );
+
     // Invoke solver
     //
 
@@ -327,10 +331,10 @@ namespace Gadgetron{
     // 
 
     if( alpha_ > 0.0 ){
-      cuNDArray<float_complext> gpureg(j->reg_host_.get());
+      boost::shared_ptr< cuNDArray<float_complext> > gpureg = device_job.reg;
       boost::shared_ptr< cuNDArray<float_complext> > gpurec = sum(sbresult.get(),2);
       *gpurec /= float(sbresult->get_size(2));
-      float scale = abs(dot(gpurec.get(), gpurec.get())/dot(gpurec.get(),&gpureg));
+      float scale = abs(dot(gpurec.get(), gpurec.get())/dot(gpurec.get(),gpureg.get()));
       GDEBUG("Scaling factor between regularization and reconstruction is %f.\n", scale);
     }
     
@@ -25,8 +25,6 @@ gpuSenseGadget::~gpuSenseGadget() {
 }
 
 int gpuSenseGadget::process_config(ACE_Message_Block* mb) {
-  device_number_ = deviceno.value();
-
   int number_of_devices = 0;
   if (cudaGetDeviceCount(&number_of_devices)!= cudaSuccess) {
     GDEBUG( "Error: unable to query number of CUDA devices.\n" );
@@ -38,10 +36,8 @@ int gpuSenseGadget::process_config(ACE_Message_Block* mb) {
     return GADGET_FAIL;
   }
 
-  if (device_number_ >= number_of_devices) {
-    GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-    device_number_ = (device_number_%number_of_devices);
-  }
+  device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+  GDEBUG("Using CUDA device %d\n", device_number_);
   
   if (cudaSetDevice(device_number_)!= cudaSuccess) {
     GDEBUG( "Error: unable to set CUDA device.\n" );
@@ -62,6 +58,7 @@ int gpuSenseGadget::process_config(ACE_Message_Block* mb) {
     return GADGET_FAIL;
   }
   save_individual_frames_ = save_individual_frames.value();
+  prefetch_jobs_ = prefetch_jobs.value();
 
 }
 
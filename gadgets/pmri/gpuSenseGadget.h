@@ -14,6 +14,8 @@
 #include "vector_td.h"
 #include "GenericReconJob.h"
 #include "cuNDArray.h"
+#include "gpuReconJobPrefetcher.h"
+#include "cudaDeviceManager.h"
 namespace Gadgetron {
 
 class gpuSenseGadget: public Gadget2<ISMRMRD::ImageHeader, GenericReconJob>{
@@ -23,7 +25,7 @@ public:
   virtual int process_config(ACE_Message_Block* mb);
   
 protected:
-  GADGET_PROPERTY(deviceno,int,"GPU device number", 0);
+  GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
   GADGET_PROPERTY(setno,int,"Set number to process", 0);
   GADGET_PROPERTY(sliceno,int,"Slice number to process",0);
   GADGET_PROPERTY(oversampling_factor, float, "Oversampling factor for NFFT", 1.5);
@@ -32,10 +34,12 @@ protected:
   GADGET_PROPERTY(output_convergence, bool, "Ouput convergence information", false);
   GADGET_PROPERTY(rotations_to_discard, int, "Number of rotations to dump", 0);
   GADGET_PROPERTY(output_timing, bool, "Output timing information", false);
+  GADGET_PROPERTY(prefetch_jobs, bool, "Upload the next job in the queue while the current job is solved", true);
 
   virtual int put_frames_on_que(int frames,int rotations, GenericReconJob* j, cuNDArray<float_complext>* cgresult, int channels = 1);
   int channels_;
   int device_number_;
+  cudaDeviceSelection device_selection_;
   int set_number_;
   int slice_number_;
   
@@ -49,6 +53,10 @@ protected:
   bool output_convergence_;
   bool output_timing_;
   bool save_individual_frames_;
+  bool prefetch_jobs_;
+
+  // Uploads the jobs, the next one ahead of time with prefetch_jobs
+  gpuReconJobPrefetcher prefetcher_;
   
   int frame_counter_;
 };
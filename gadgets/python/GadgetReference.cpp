@@ -7,6 +7,7 @@
 
 /* #include <boost/preprocessor/stringize.hpp> */
 #include <boost/python.hpp>
+#include <memory>
 
 namespace Gadgetron {
 
@@ -112,6 +113,88 @@ namespace Gadgetron {
         return GADGET_OK;
     }
 
+    template<class TH, class TD>
+    int GadgetReference::return_batch(boost::python::object headers, boost::python::object arr, boost::python::object metas)
+    {
+        size_t N = boost::python::len(headers);
+        bool is_list = boost::python::extract<boost::python::list>(arr).check();
+
+        // the stacked array is sliced into the messages, the extractor keeps it valid until then
+        std::unique_ptr< boost::python::extract< const hoNDArray< TD >& > > stacked_ex;
+        const hoNDArray< TD >* stacked = 0;
+        std::vector<size_t> dims;
+        if (!is_list) {
+            stacked_ex.reset(new boost::python::extract< const hoNDArray< TD >& >(arr));
+            stacked = &(*stacked_ex)();
+            stacked->get_dimensions(dims);
+            if (dims.empty() || dims.back() != N) {
+                GERROR("Batch returned from python with %d headers, but %d arrays\n", (int)N, dims.empty() ? 0 : (int)dims.back());
+                return GADGET_FAIL;
+            }
+            dims.pop_back();
+        }
+
+        for (size_t n = 0; n < N; n++) {
+            GadgetContainerMessage< TH >* m1 = new GadgetContainerMessage< TH >;
+            *m1->getObjectPtr() = boost::python::extract< TH >(headers[n])();
+
+            GadgetContainerMessage< hoNDArray< TD > >* m2;
+            if (is_list) {
+                m2 = new GadgetContainerMessage< hoNDArray< TD > >(
+                    boost::python::extract<hoNDArray < TD > >(arr[n])());
+            }
+            else {
+                m2 = new GadgetContainerMessage< hoNDArray< TD > >(dims);
+                size_t M = m2->getObjectPtr()->get_number_of_elements();
+                memcpy(m2->getObjectPtr()->begin(), stacked->begin() + n*M, M*sizeof(TD));
+            }
+            m1->cont(m2);
+
+            if (!metas.is_none() && !boost::python::object(metas[n]).is_none()) {
+                GadgetContainerMessage< ISMRMRD::MetaContainer >* m3 =
+                    new GadgetContainerMessage< ISMRMRD::MetaContainer >;
+
+                std::string meta = boost::python::extract<std::string>(metas[n]);
+                ISMRMRD::deserialize(meta.c_str(), *m3->getObjectPtr());
+                m2->cont(m3);
+            }
+
+            if (!gadget_) {
+                GDEBUG("Data received from python, but no Gadget registered for output\n");
+                m1->release();
+                continue;
+            }
+
+            ACE_Time_Value nowait(ACE_OS::gettimeofday());
+            if (gadget_->next()->putq(m1, &nowait) == -1) {
+                m1->release();
+                return GADGET_FAIL;
+            }
+        }
+
+        return GADGET_OK;
+    }
+
+    int GadgetReference::return_acquisitions(boost::python::object headers, boost::python::object arr)
+    {
+        return return_batch<ISMRMRD::AcquisitionHeader, std::complex<float> >(headers, arr, boost::python::object());
+    }
+
+    int GadgetReference::return_images_cplx(boost::python::object headers, boost::python::object arr, boost::python::object metas)
+    {
+        return return_batch<ISMRMRD::ImageHeader, std::complex<float> >(headers, arr, metas);
+    }
+
+    int GadgetReference::return_images_float(boost::python::object headers, boost::python::object arr, boost::python::object metas)
+    {
+        return return_batch<ISMRMRD::ImageHeader, float>(headers, arr, metas);
+    }
+
+    int GadgetReference::return_images_ushort(boost::python::object headers, boost::python::object arr, boost::python::object metas)
+    {
+        return return_batch<ISMRMRD::ImageHeader, unsigned short>(headers, arr, metas);
+    }
+
     int GadgetReference::return_acquisition(ISMRMRD::AcquisitionHeader acq, boost::python::object arr)
     {
         return return_data<ISMRMRD::AcquisitionHeader, std::complex<float> >(acq, arr, 0);
@@ -33,6 +33,14 @@ namespace Gadgetron{
     int return_image_ushort(ISMRMRD::ImageHeader img, boost::python::object arr);
     int return_image_ushort_attr(ISMRMRD::ImageHeader img, boost::python::object arr, const char* meta);
 
+    // A batch of messages in one call: a list of headers, the arrays stacked along the last
+    // dimension or as a list, and a list of serialized meta containers or None (or just None)
+    template<class TH, class TD> int return_batch(boost::python::object headers, boost::python::object arr, boost::python::object metas);
+    int return_acquisitions(boost::python::object headers, boost::python::object arr);
+    int return_images_cplx(boost::python::object headers, boost::python::object arr, boost::python::object metas);
+    int return_images_float(boost::python::object headers, boost::python::object arr, boost::python::object metas);
+    int return_images_ushort(boost::python::object headers, boost::python::object arr, boost::python::object metas);
+
   protected:
     Gadget* gadget_;
   };
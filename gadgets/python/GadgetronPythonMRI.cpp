@@ -20,6 +20,10 @@ BOOST_PYTHON_MODULE(GadgetronPythonMRI)
       .def("return_image_float_attr", &Gadgetron::GadgetReference::return_image_float_attr)
       .def("return_image_ushort", &Gadgetron::GadgetReference::return_image_ushort)
       .def("return_image_ushort_attr", &Gadgetron::GadgetReference::return_image_ushort_attr)
+      .def("return_acquisitions", &Gadgetron::GadgetReference::return_acquisitions)
+      .def("return_images_cplx", &Gadgetron::GadgetReference::return_images_cplx)
+      .def("return_images_float", &Gadgetron::GadgetReference::return_images_float)
+      .def("return_images_ushort", &Gadgetron::GadgetReference::return_images_ushort)
       ;
 
     class_<Gadgetron::GadgetInstrumentationStreamControllerWrapper>("GadgetInstrumentationStreamController")
@@ -1,9 +1,28 @@
 #include "PythonGadget.h"
+#include "gadgetron_paths.h"    // for get_gadgetron_home()
+#include "gadgetron_config.h"   // for GADGETRON_PYTHON_PATH
+
+#include <algorithm>
 
 namespace Gadgetron {
 
     int PythonGadget::process(ACE_Message_Block* mb)
     {
+        if (batch_size.value() > 1) {
+            if (AsContainerMessage<ISMRMRD::AcquisitionHeader>(mb)) {
+                return this->add_to_batch(mb, PYTHON_WORKER_ACQUISITION, ISMRMRD::ISMRMRD_CXFLOAT);
+            }
+            GadgetContainerMessage<ISMRMRD::ImageHeader>* hmi = AsContainerMessage<ISMRMRD::ImageHeader>(mb);
+            if (hmi) {
+                return this->add_to_batch(mb, PYTHON_WORKER_IMAGE, hmi->getObjectPtr()->data_type);
+            }
+
+            // everything else keeps its place behind the held messages
+            if (this->flush_batch() != GADGET_OK) {
+                return GADGET_FAIL;
+            }
+        }
+
         GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* hma = AsContainerMessage<ISMRMRD::AcquisitionHeader>(mb);
         if (hma)
         {
@@ -28,6 +47,7 @@ namespace Gadgetron {
             auto recon_data = AsContainerMessage<IsmrmrdReconData>(mb);
             if (recon_data) {
                 GDEBUG("Calling into python gadget with IsmrmrdReconData");
+                recon_data->getObjectPtr()->load_data();
                 return this->process(recon_data);
             }
         }
@@ -93,5 +113,281 @@ namespace Gadgetron {
             break;
         }
     }
+
+    int PythonGadget::add_to_batch(ACE_Message_Block* mb, uint64_t id, uint16_t data_type)
+    {
+        // a batch holds messages of one type
+        if (!batch_.empty() && (id != batch_id_ || data_type != batch_data_type_)) {
+            if (this->flush_batch() != GADGET_OK) {
+                return GADGET_FAIL;
+            }
+        }
+
+        if (batch_.empty()) {
+            batch_id_ = id;
+            batch_data_type_ = data_type;
+            batch_start_ = std::chrono::steady_clock::now();
+        }
+        batch_.push_back(mb);
+
+        bool timed_out = batch_timeout_ms.value() > 0
+            && std::chrono::steady_clock::now() - batch_start_ >= std::chrono::milliseconds(batch_timeout_ms.value());
+        if ((int)batch_.size() >= batch_size.value() || timed_out) {
+            return this->flush_batch(mb);
+        }
+        return GADGET_OK;
+    }
+
+    int PythonGadget::flush_batch(ACE_Message_Block* current)
+    {
+        if (batch_.empty()) return GADGET_OK;
+
+        int res = GADGET_FAIL;
+        if (batch_id_ == PYTHON_WORKER_ACQUISITION) {
+            res = this->process_batch< ISMRMRD::AcquisitionHeader, std::complex<float> >();
+        }
+        else {
+            switch (batch_data_type_) {
+            case (ISMRMRD::ISMRMRD_USHORT):
+                res = this->process_batch< ISMRMRD::ImageHeader, uint16_t >();
+                break;
+            case (ISMRMRD::ISMRMRD_SHORT):
+                res = this->process_batch< ISMRMRD::ImageHeader, int16_t >();
+                break;
+            case (ISMRMRD::ISMRMRD_UINT):
+                res = this->process_batch< ISMRMRD::ImageHeader, uint32_t >();
+                break;
+            case (ISMRMRD::ISMRMRD_INT):
+                res = this->process_batch< ISMRMRD::ImageHeader, int32_t >();
+                break;
+            case (ISMRMRD::ISMRMRD_FLOAT):
+                res = this->process_batch< ISMRMRD::ImageHeader, float >();
+                break;
+            case (ISMRMRD::ISMRMRD_DOUBLE):
+                res = this->process_batch< ISMRMRD::ImageHeader, double >();
+                break;
+            case (ISMRMRD::ISMRMRD_CXFLOAT):
+                res = this->process_batch< ISMRMRD::ImageHeader, std::complex<float> >();
+                break;
+            case (ISMRMRD::ISMRMRD_CXDOUBLE):
+                res = this->process_batch< ISMRMRD::ImageHeader, std::complex<double> >();
+                break;
+            default:
+                GERROR("Unknown image data_type %d received\n", batch_data_type_);
+                break;
+            }
+        }
+
+        for (size_t n = 0; n < batch_.size(); n++) {
+            if (res == GADGET_OK || batch_[n] != current) batch_[n]->release();
+        }
+        batch_.clear();
+        return res;
+    }
+
+    bool PythonGadget::queue_deadline(ACE_Time_Value& deadline)
+    {
+        if (batch_.empty() || batch_timeout_ms.value() <= 0) return false;
+
+        std::chrono::steady_clock::duration left = batch_start_ + std::chrono::milliseconds(batch_timeout_ms.value()) - std::chrono::steady_clock::now();
+        long long us = std::max<long long>(0, std::chrono::duration_cast<std::chrono::microseconds>(left).count());
+        deadline = ACE_OS::gettimeofday() + ACE_Time_Value((time_t)(us / 1000000), (suseconds_t)(us % 1000000));
+        return true;
+    }
+
+    int PythonGadget::process_timeout()
+    {
+        return this->flush_batch();
+    }
+
+    int PythonGadget::close(unsigned long flags)
+    {
+        // the gadget thread has finished once the base class returns
+        int rval = BasicPropertyGadget::close(flags);
+
+        if (flags != 0 && this->flush_batch() != GADGET_OK) {
+            GERROR("Error passing the held messages on to Gadget %s\n", this->module()->name());
+            rval = GADGET_FAIL;
+        }
+
+        if (flags == 1 && worker_) {
+            PythonWorkerWriter w;
+            if (this->call_worker(PYTHON_WORKER_CLOSE, w, 0) != GADGET_OK) {
+                GERROR("Error closing the python worker of Gadget %s\n", this->module()->name());
+                rval = GADGET_FAIL;
+            }
+            worker_->stop();
+            worker_.reset();
+        }
+
+        return rval;
+    }
+
+    int PythonGadget::process_config_worker(ACE_Message_Block* mb)
+    {
+        class_name = python_class.value();
+        if (python_module.value().size() == 0 || class_name.size() == 0) {
+            GDEBUG("Null module or class name received in Gadget %s\n", this->module()->name());
+            return GADGET_FAIL;
+        }
+
+        std::string script = get_gadgetron_home() + std::string("/") + std::string(GADGETRON_PYTHON_PATH) + std::string("/gadgetron_python_worker.py");
+        worker_ = PythonWorkerPool::instance().acquire(worker_executable.value(), script);
+        if (!worker_) {
+            GERROR("Unable to start a python worker for Gadget %s\n", this->module()->name());
+            return GADGET_FAIL;
+        }
+
+        GDEBUG("Python Worker          : %d\n", (int)worker_->pid());
+        GDEBUG("Python Module          : %s\n", python_module.value().c_str());
+        GDEBUG("Python Class           : %s\n", class_name.c_str());
+
+        PythonWorkerWriter w;
+        w.put_string(python_path.value());
+        w.put_string(python_module.value());
+        w.put_string(class_name);
+        w.put_uint(parameters_python_.size());
+        for (std::map<std::string, std::string>::iterator it = parameters_python_.begin(); it != parameters_python_.end(); it++) {
+            w.put_string(it->first);
+            w.put_string(it->second);
+        }
+        w.put_string(std::string(mb->rd_ptr()));
+
+        if (this->call_worker(PYTHON_WORKER_CONFIG, w, 0) != GADGET_OK) {
+            GERROR("Error configuring the python worker of Gadget %s\n", this->module()->name());
+            worker_->stop();
+            worker_.reset();
+            return GADGET_FAIL;
+        }
+
+        return GADGET_OK;
+    }
+
+    int PythonGadget::call_worker(uint64_t id, const PythonWorkerWriter& w, ACE_Message_Block* mb)
+    {
+        if (!worker_->send(id, w.buffer())) {
+            return GADGET_FAIL;
+        }
+
+        // a failure to pass on returned data does not stop the call, the worker still has to finish it
+        bool forwarded = true;
+        uint64_t reply;
+        std::string payload;
+        while (worker_->receive(reply, payload)) {
+            try {
+                PythonWorkerReader r(payload);
+
+                if (reply == PYTHON_WORKER_DONE) {
+                    int res = (int)r.get_uint();
+                    if (res != GADGET_OK) {
+                        GDEBUG("Gadget (%s) Returned from python call with error\n", this->module()->name());
+                        return GADGET_FAIL;
+                    }
+                    if (!forwarded) return GADGET_FAIL;
+
+                    //Else we are done with this now.
+                    if (mb) mb->release();
+                    return GADGET_OK;
+                }
+
+                if (reply == PYTHON_WORKER_ERROR) {
+                    GERROR("Python worker of Gadget %s failed:\n%s\n", this->module()->name(), r.get_string().c_str());
+                    return GADGET_FAIL;
+                }
+
+                if (this->forward_worker_message(reply, r) != GADGET_OK) forwarded = false;
+            }
+            catch (std::exception& e) {
+                // the stream is out of step with the worker, it can not be used any more
+                GERROR("Invalid message from the python worker of Gadget %s: %s\n", this->module()->name(), e.what());
+                worker_->stop(0);
+                return GADGET_FAIL;
+            }
+        }
+
+        return GADGET_FAIL;
+    }
+
+    template <typename T>
+    GadgetContainerMessage< hoNDArray<T> >* PythonGadget::worker_array_message(PythonWorkerReader& r)
+    {
+        GadgetContainerMessage< hoNDArray<T> >* m = new GadgetContainerMessage< hoNDArray<T> >();
+        try {
+            r.get_array(*m->getObjectPtr());
+        }
+        catch (...) {
+            m->release();
+            throw;
+        }
+        return m;
+    }
+
+    int PythonGadget::forward_worker_message(uint64_t id, PythonWorkerReader& r)
+    {
+        ACE_Message_Block* m = 0;
+
+        try {
+            if (id == PYTHON_WORKER_ACQUISITION || id == PYTHON_WORKER_IMAGE) {
+                GadgetContainerMessage<ISMRMRD::AcquisitionHeader>* ma = 0;
+                GadgetContainerMessage<ISMRMRD::ImageHeader>* mi = 0;
+                if (id == PYTHON_WORKER_ACQUISITION) {
+                    m = ma = new GadgetContainerMessage<ISMRMRD::AcquisitionHeader>();
+                    r.get_struct(*ma->getObjectPtr());
+                }
+                else {
+                    m = mi = new GadgetContainerMessage<ISMRMRD::ImageHeader>();
+                    r.get_struct(*mi->getObjectPtr());
+                }
+
+                ACE_Message_Block* data = 0;
+                switch (r.peek_data_type()) {
+                case ISMRMRD::ISMRMRD_USHORT:   data = this->worker_array_message<uint16_t>(r); break;
+                case ISMRMRD::ISMRMRD_SHORT:    data = this->worker_array_message<int16_t>(r); break;
+                case ISMRMRD::ISMRMRD_UINT:     data = this->worker_array_message<uint32_t>(r); break;
+                case ISMRMRD::ISMRMRD_INT:      data = this->worker_array_message<int32_t>(r); break;
+                case ISMRMRD::ISMRMRD_FLOAT:    data = this->worker_array_message<float>(r); break;
+                case ISMRMRD::ISMRMRD_DOUBLE:   data = this->worker_array_message<double>(r); break;
+                case ISMRMRD::ISMRMRD_CXFLOAT:  data = this->worker_array_message< std::complex<float> >(r); break;
+                case ISMRMRD::ISMRMRD_CXDOUBLE: data = this->worker_array_message< std::complex<double> >(r); break;
+                default:
+                    throw std::runtime_error("unknown array data type");
+                }
+                m->cont(data);
+
+                GadgetContainerMessage<ISMRMRD::MetaContainer>* mm = new GadgetContainerMessage<ISMRMRD::MetaContainer>();
+                if (r.get_meta(*mm->getObjectPtr())) {
+                    data->cont(mm);
+                }
+                else {
+                    mm->release();
+                }
+            }
+            else if (id == PYTHON_WORKER_IMAGE_ARRAY) {
+                GadgetContainerMessage<IsmrmrdImageArray>* ma = new GadgetContainerMessage<IsmrmrdImageArray>();
+                m = ma;
+                r.get_image_array(*ma->getObjectPtr());
+            }
+            else if (id == PYTHON_WORKER_RECON_DATA) {
+                GadgetContainerMessage<IsmrmrdReconData>* mr = new GadgetContainerMessage<IsmrmrdReconData>();
+                m = mr;
+                r.get_recon_data(*mr->getObjectPtr());
+            }
+            else {
+                throw std::runtime_error("unknown message");
+            }
+        }
+        catch (...) {
+            if (m) m->release();
+            throw;
+        }
+
+        if (this->next()->putq(m) == -1) {
+            GERROR("Gadget (%s) unable to pass on data returned by python\n", this->module()->name());
+            m->release();
+            return GADGET_FAIL;
+        }
+        return GADGET_OK;
+    }
+
     GADGET_FACTORY_DECLARE(PythonGadget)
 }
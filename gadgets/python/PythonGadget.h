@@ -7,10 +7,14 @@
 #include "GadgetReference.h"
 #include "gadgetronpython_export.h"
 #include "python_toolbox.h"
+#include "PythonWorker.h"
 
 #include <ismrmrd/ismrmrd.h>
 #include <ismrmrd/meta.h>
 #include <boost/python.hpp>
+#include <type_traits>
+#include <chrono>
+#include <vector>
 
 namespace Gadgetron {
 
@@ -37,9 +41,15 @@ namespace Gadgetron {
             return GADGET_OK;
         }
 
+        virtual int close(unsigned long flags);
+
     protected:
         int process_config(ACE_Message_Block* mb)
         {
+            if (use_worker_process.value()) {
+                return this->process_config_worker(mb);
+            }
+
             // start python interpreter
             if (initialize_python() != GADGET_OK) {
                 GDEBUG("Failed to initialize Python in Gadget %s\n", this->module()->name());
@@ -160,6 +170,18 @@ namespace Gadgetron {
                 return GADGET_FAIL;
             }
 
+            if (worker_) {
+                try {
+                    PythonWorkerWriter w;
+                    w.put_recon_data(*recon_data->getObjectPtr());
+                    return this->call_worker(PYTHON_WORKER_RECON_DATA, w, recon_data);
+                }
+                catch (std::exception& e) {
+                    GERROR("Passing IsmrmrdReconData on to python worker failed: %s\n", e.what());
+                    return GADGET_FAIL;
+                }
+            }
+
             // We want to avoid a deadlock for the Python GIL if this python call
             // results in an output that the GadgetReference will not be able to
             // get rid of.
@@ -177,7 +199,8 @@ namespace Gadgetron {
             GILLock lock;
             try {
                 boost::python::object process_fn = class_.attr("process");
-                auto pyrecon_data = boost::python::object(*recon_data->getObjectPtr());
+                // the message is released after the call, so the data arrays are handed to Python without copying
+                auto pyrecon_data = IsmrmrdReconData_to_python_object::convert(std::move(*recon_data->getObjectPtr()));
                 int res = boost::python::extract<int>(process_fn(pyrecon_data));
                 if (res != GADGET_OK) {
                     GDEBUG("Gadget (%s) Returned from python call with error\n",
@@ -203,6 +226,21 @@ namespace Gadgetron {
                 return GADGET_FAIL;
             }
 
+            if (worker_)
+            {
+                try
+                {
+                    PythonWorkerWriter w;
+                    w.put_image_array(*recon_data->getObjectPtr());
+                    return this->call_worker(PYTHON_WORKER_IMAGE_ARRAY, w, recon_data);
+                }
+                catch (std::exception& e)
+                {
+                    GERROR("Passing IsmrmrdImageArray on to python worker failed: %s\n", e.what());
+                    return GADGET_FAIL;
+                }
+            }
+
             while (this->next()->msg_queue()->is_full())
             {
                 ACE_Time_Value tv(0, 10000);
@@ -213,7 +251,7 @@ namespace Gadgetron {
             try
             {
                 boost::python::object process_fn = class_.attr("process");
-                auto pyrecon_data = boost::python::object(*recon_data->getObjectPtr());
+                auto pyrecon_data = IsmrmrdImageArray_to_python_object::convert(std::move(*recon_data->getObjectPtr()));
                 int res = boost::python::extract<int>(process_fn(pyrecon_data));
                 if (res != GADGET_OK)
                 {
@@ -242,6 +280,22 @@ namespace Gadgetron {
                 return GADGET_FAIL;
             }
 
+            if (worker_) {
+                try {
+                    PythonWorkerWriter w;
+                    w.put_bytes(hmb->getObjectPtr(), sizeof(H));
+                    w.put_array(*dmb->getObjectPtr());
+                    w.put_meta(mmb ? mmb->getObjectPtr() : 0);
+
+                    uint64_t id = std::is_same<H, ISMRMRD::AcquisitionHeader>::value ? PYTHON_WORKER_ACQUISITION : PYTHON_WORKER_IMAGE;
+                    return this->call_worker(id, w, hmb);
+                }
+                catch (std::exception& e) {
+                    GERROR("Passing data on to python worker failed: %s\n", e.what());
+                    return GADGET_FAIL;
+                }
+            }
+
             // We want to avoid a deadlock for the Python GIL if this python call
             // results in an output that the GadgetReference will not be able to
             // get rid of.
@@ -266,14 +320,15 @@ namespace Gadgetron {
             GILLock lock;
             try {
                 boost::python::object process_fn = class_.attr("process");
+                boost::python::object pydata = hoNDArray_to_numpy_array_shared<D>::convert(std::move(*data));
                 int res;
                 if (meta) {
                     std::stringstream str;
                     ISMRMRD::serialize(*meta, str);
-                    res = boost::python::extract<int>(process_fn(head, data, str.str()));
+                    res = boost::python::extract<int>(process_fn(head, pydata, str.str()));
                 }
                 else {
-                    res = boost::python::extract<int>(process_fn(head, data));
+                    res = boost::python::extract<int>(process_fn(head, pydata));
                 }
                 if (res != GADGET_OK) {
                     GDEBUG("Gadget (%s) Returned from python call with error\n",
@@ -291,12 +346,124 @@ namespace Gadgetron {
             return GADGET_OK;
         }
 
+        /// Passes the held messages to process_batch of the Python class in one call.
+        /// The arrays are stacked along a new last dimension if they are alike, a list of arrays otherwise.
+        template <typename H, typename D> int process_batch()
+        {
+            std::vector< GadgetContainerMessage<H>* > hmbs;
+            std::vector< hoNDArray< D >* > arrays;
+            std::vector< ISMRMRD::MetaContainer* > metas;
+            bool alike = true;
+            for (size_t n = 0; n < batch_.size(); n++) {
+                GadgetContainerMessage<H>* hmb = AsContainerMessage<H>(batch_[n]);
+                GadgetContainerMessage< hoNDArray< D > >* dmb = hmb ? AsContainerMessage< hoNDArray< D > >(hmb->cont()) : 0;
+                if (!dmb) {
+                    GERROR("Received null pointer to data block");
+                    return GADGET_FAIL;
+                }
+                GadgetContainerMessage< ISMRMRD::MetaContainer>* mmb = AsContainerMessage< ISMRMRD::MetaContainer >(dmb->cont());
+
+                hmbs.push_back(hmb);
+                arrays.push_back(dmb->getObjectPtr());
+                metas.push_back(mmb ? mmb->getObjectPtr() : 0);
+                if (arrays[n]->get_number_of_elements() == 0 || !arrays[n]->dimensions_equal(arrays[0])) alike = false;
+            }
+
+            if (worker_) {
+                try {
+                    PythonWorkerWriter w;
+                    w.put_uint(std::is_same<H, ISMRMRD::AcquisitionHeader>::value ? PYTHON_WORKER_ACQUISITION : PYTHON_WORKER_IMAGE);
+                    w.put_uint(batch_.size());
+                    for (size_t n = 0; n < batch_.size(); n++) {
+                        w.put_bytes(hmbs[n]->getObjectPtr(), sizeof(H));
+                        w.put_array(*arrays[n]);
+                        w.put_meta(metas[n]);
+                    }
+                    return this->call_worker(PYTHON_WORKER_BATCH, w, 0);
+                }
+                catch (std::exception& e) {
+                    GERROR("Passing a batch on to python worker failed: %s\n", e.what());
+                    return GADGET_FAIL;
+                }
+            }
+
+            while (this->next()->msg_queue()->is_full()) {
+                ACE_Time_Value tv(0, 10000);
+                ACE_OS::sleep(tv);
+            }
+
+            GILLock lock;
+            try {
+                boost::python::list headers;
+                boost::python::list pymetas;
+                for (size_t n = 0; n < batch_.size(); n++) {
+                    headers.append(*hmbs[n]->getObjectPtr());
+                    if (metas[n]) {
+                        std::stringstream str;
+                        ISMRMRD::serialize(*metas[n], str);
+                        pymetas.append(str.str());
+                    }
+                    else {
+                        pymetas.append(boost::python::object());
+                    }
+                }
+
+                // the messages are released after the call, so their arrays are handed to Python without copying
+                boost::python::object pydata;
+                if (alike) {
+                    std::vector<size_t> dims;
+                    arrays[0]->get_dimensions(dims);
+                    dims.push_back(batch_.size());
+
+                    hoNDArray< D > stacked(dims);
+                    size_t N = arrays[0]->get_number_of_elements();
+                    for (size_t n = 0; n < batch_.size(); n++) {
+                        memcpy(stacked.begin() + n*N, arrays[n]->begin(), N*sizeof(D));
+                    }
+                    pydata = hoNDArray_to_numpy_array_shared<D>::convert(std::move(stacked));
+                }
+                else {
+                    boost::python::list l;
+                    for (size_t n = 0; n < batch_.size(); n++) {
+                        l.append(hoNDArray_to_numpy_array_shared<D>::convert(std::move(*arrays[n])));
+                    }
+                    pydata = l;
+                }
+
+                boost::python::object process_batch_fn = class_.attr("process_batch");
+                int res = boost::python::extract<int>(process_batch_fn(headers, pydata, pymetas));
+                if (res != GADGET_OK) {
+                    GDEBUG("Gadget (%s) Returned from python call with error\n",
+                        this->module()->name());
+                    return GADGET_FAIL;
+                }
+            }
+            catch (boost::python::error_already_set const &) {
+                GDEBUG("Passing a batch on to python module failed\n");
+                PyErr_Print();
+                return GADGET_FAIL;
+            }
+            return GADGET_OK;
+        }
+
         virtual int process(ACE_Message_Block* mb);
 
+        /// A held batch is passed on batch_timeout_ms after its first message arrived
+        virtual bool queue_deadline(ACE_Time_Value& deadline);
+        virtual int process_timeout();
+
     protected:
         GADGET_PROPERTY(python_module, std::string, "Python module containing the Python Gadget class to be loaded", "");
         GADGET_PROPERTY(python_class, std::string, "Python class to load from python module", "");
         GADGET_PROPERTY(python_path, std::string, "Path(s) to add to the to the Python search path", "");
+        GADGET_PROPERTY(use_worker_process, bool, "Run the Python class in a worker process with its own interpreter instead of the embedded one", false);
+#if defined PYVER && PYVER == 3
+        GADGET_PROPERTY(worker_executable, std::string, "Python interpreter of the worker process", "python3");
+#else
+        GADGET_PROPERTY(worker_executable, std::string, "Python interpreter of the worker process", "python");
+#endif
+        GADGET_PROPERTY(batch_size, int, "Number of acquisitions or images passed to process_batch of the Python class in one call, 1 calls process for every message", 1);
+        GADGET_PROPERTY(batch_timeout_ms, int, "Time in ms a batch waits for more messages before it is passed on incomplete, 0 waits until it is full", 0);
 
     private:
         boost::python::object module_;
@@ -304,6 +471,25 @@ namespace Gadgetron {
         boost::shared_ptr<GadgetReference> gadget_ref_;
         std::string class_name;
         int process_image(GadgetContainerMessage<ISMRMRD::ImageHeader>* hmi);
+
+        /// Worker mode, the Python class lives in worker_ and the embedded interpreter is not used
+        std::shared_ptr<PythonWorker> worker_;
+        int process_config_worker(ACE_Message_Block* mb);
+
+        /// Sends a call to the worker and forwards the data returned until it is done, mb is released on success
+        int call_worker(uint64_t id, const PythonWorkerWriter& w, ACE_Message_Block* mb);
+        int forward_worker_message(uint64_t id, PythonWorkerReader& r);
+        template <typename T> GadgetContainerMessage< hoNDArray<T> >* worker_array_message(PythonWorkerReader& r);
+        /// Acquisitions or images of one data type held for the next process_batch call
+        std::vector<ACE_Message_Block*> batch_;
+        uint64_t batch_id_;
+        uint16_t batch_data_type_;
+        std::chrono::steady_clock::time_point batch_start_;
+        int add_to_batch(ACE_Message_Block* mb, uint64_t id, uint16_t data_type);
+
+        /// Calls process_batch and releases the held messages, on failure except current, which is released by the caller
+        int flush_batch(ACE_Message_Block* current = 0);
+
         /*
           We are going to keep a copy of the parameters in this gadget that are not properties.
           They should be passed on to the Python class.
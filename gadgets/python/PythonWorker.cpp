@@ -0,0 +1,479 @@
+#include "PythonWorker.h"
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <errno.h>
+
+extern char** environ;
+#endif
+
+namespace Gadgetron {
+
+#ifndef _WIN32
+
+    bool python_worker_write_segment(const std::string& name, const void* data, size_t bytes)
+    {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if (fd == -1) {
+            GERROR("PythonWorker, unable to create shared memory %s: %d\n", name.c_str(), errno);
+            return false;
+        }
+
+        if (ftruncate(fd, bytes) == -1) {
+            GERROR("PythonWorker, unable to size shared memory %s: %d\n", name.c_str(), errno);
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        void* base = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            GERROR("PythonWorker, unable to map shared memory %s: %d\n", name.c_str(), errno);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        memcpy(base, data, bytes);
+        munmap(base, bytes);
+        return true;
+    }
+
+    bool python_worker_read_segment(const std::string& name, void* data, size_t bytes)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd == -1) {
+            GERROR("PythonWorker, unable to open shared memory %s: %d\n", name.c_str(), errno);
+            return false;
+        }
+        shm_unlink(name.c_str());
+
+        struct stat st;
+        if (fstat(fd, &st) == -1 || (size_t)st.st_size < bytes) {
+            GERROR("PythonWorker, shared memory %s is too small\n", name.c_str());
+            ::close(fd);
+            return false;
+        }
+
+        void* base = mmap(0, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            GERROR("PythonWorker, unable to map shared memory %s: %d\n", name.c_str(), errno);
+            return false;
+        }
+
+        memcpy(data, base, bytes);
+        munmap(base, bytes);
+        return true;
+    }
+
+#else
+
+    bool python_worker_write_segment(const std::string& name, const void* data, size_t bytes)
+    {
+        GERROR("PythonWorker, shared memory is not supported on this platform\n");
+        return false;
+    }
+
+    bool python_worker_read_segment(const std::string& name, void* data, size_t bytes)
+    {
+        GERROR("PythonWorker, shared memory is not supported on this platform\n");
+        return false;
+    }
+
+#endif
+
+    // ------------------------------------------------------------------------
+
+    PythonWorkerWriter::~PythonWorkerWriter()
+    {
+#ifndef _WIN32
+        for (size_t n = 0; n < segments_.size(); n++) shm_unlink(segments_[n].c_str());
+#endif
+    }
+
+    std::string PythonWorkerWriter::segment_name()
+    {
+        static std::atomic<unsigned long long> counter(0);
+
+        std::stringstream str;
+#ifndef _WIN32
+        str << "/gadgetron_py_" << getpid() << "_" << counter++;
+#else
+        str << "/gadgetron_py_" << counter++;
+#endif
+        return str.str();
+    }
+
+    void PythonWorkerWriter::put_meta(const ISMRMRD::MetaContainer* meta)
+    {
+        if (!meta) {
+            this->put_string(std::string());
+            return;
+        }
+
+        std::stringstream str;
+        ISMRMRD::serialize(const_cast<ISMRMRD::MetaContainer&>(*meta), str);
+        this->put_string(str.str());
+    }
+
+    void PythonWorkerWriter::put_image_array(const IsmrmrdImageArray& a)
+    {
+        this->put_array(a.data_);
+        this->put_headers(a.headers_);
+
+        this->put_uint(a.meta_.size());
+        for (size_t n = 0; n < a.meta_.size(); n++) this->put_meta(&a.meta_[n]);
+    }
+
+    void PythonWorkerWriter::put_data_buffered(const IsmrmrdDataBuffered& b)
+    {
+        this->put_array(b.data_);
+
+        this->put_uint(b.trajectory_ ? 1 : 0);
+        if (b.trajectory_) this->put_array(*b.trajectory_);
+
+        this->put_headers(b.headers_);
+
+        const SamplingDescription& s = b.sampling_;
+        for (int i = 0; i < 3; i++) this->put_double(s.encoded_FOV_[i]);
+        for (int i = 0; i < 3; i++) this->put_double(s.recon_FOV_[i]);
+        for (int i = 0; i < 3; i++) this->put_uint(s.encoded_matrix_[i]);
+        for (int i = 0; i < 3; i++) this->put_uint(s.recon_matrix_[i]);
+        for (int i = 0; i < 3; i++) {
+            this->put_uint(s.sampling_limits_[i].min_);
+            this->put_uint(s.sampling_limits_[i].center_);
+            this->put_uint(s.sampling_limits_[i].max_);
+        }
+    }
+
+    void PythonWorkerWriter::put_recon_data(const IsmrmrdReconData& d)
+    {
+        this->put_uint(d.rbit_.size());
+        for (size_t n = 0; n < d.rbit_.size(); n++) {
+            this->put_data_buffered(d.rbit_[n].data_);
+            this->put_uint(d.rbit_[n].ref_ ? 1 : 0);
+            if (d.rbit_[n].ref_) this->put_data_buffered(*d.rbit_[n].ref_);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+
+    bool PythonWorkerReader::get_meta(ISMRMRD::MetaContainer& meta)
+    {
+        std::string s = this->get_string();
+        if (s.empty()) return false;
+
+        ISMRMRD::deserialize(s.c_str(), meta);
+        return true;
+    }
+
+    void PythonWorkerReader::get_dimensions(std::vector<size_t>& dims)
+    {
+        size_t ndim = this->get_uint();
+        if (ndim > 64) throw std::runtime_error("PythonWorkerReader, too many array dimensions");
+
+        dims.resize(ndim);
+        for (size_t d = 0; d < ndim; d++) dims[d] = this->get_uint();
+    }
+
+    void PythonWorkerReader::get_image_array(IsmrmrdImageArray& a)
+    {
+        this->get_array(a.data_);
+        this->get_headers(a.headers_);
+
+        size_t num = this->get_uint();
+        a.meta_.clear();
+        a.meta_.resize(num);
+        for (size_t n = 0; n < num; n++) this->get_meta(a.meta_[n]);
+    }
+
+    void PythonWorkerReader::get_data_buffered(IsmrmrdDataBuffered& b)
+    {
+        this->get_array(b.data_);
+
+        if (this->get_uint()) {
+            hoNDArray<float> trajectory;
+            this->get_array(trajectory);
+            b.trajectory_ = std::move(trajectory);
+        }
+
+        this->get_headers(b.headers_);
+
+        SamplingDescription& s = b.sampling_;
+        for (int i = 0; i < 3; i++) s.encoded_FOV_[i] = (float)this->get_double();
+        for (int i = 0; i < 3; i++) s.recon_FOV_[i] = (float)this->get_double();
+        for (int i = 0; i < 3; i++) s.encoded_matrix_[i] = (uint16_t)this->get_uint();
+        for (int i = 0; i < 3; i++) s.recon_matrix_[i] = (uint16_t)this->get_uint();
+        for (int i = 0; i < 3; i++) {
+            s.sampling_limits_[i].min_ = (uint16_t)this->get_uint();
+            s.sampling_limits_[i].center_ = (uint16_t)this->get_uint();
+            s.sampling_limits_[i].max_ = (uint16_t)this->get_uint();
+        }
+    }
+
+    void PythonWorkerReader::get_recon_data(IsmrmrdReconData& d)
+    {
+        size_t num = this->get_uint();
+        d.rbit_.clear();
+        d.rbit_.resize(num);
+        for (size_t n = 0; n < num; n++) {
+            this->get_data_buffered(d.rbit_[n].data_);
+            if (this->get_uint()) {
+                IsmrmrdDataBuffered ref;
+                this->get_data_buffered(ref);
+                d.rbit_[n].ref_ = std::move(ref);
+            }
+        }
+    }
+
+    // ------------------------------------------------------------------------
+
+    PythonWorker::PythonWorker()
+        : pid_(-1)
+        , fd_(-1)
+    {
+    }
+
+    PythonWorker::~PythonWorker()
+    {
+        this->stop(0);
+    }
+
+#ifndef _WIN32
+
+    std::shared_ptr<PythonWorker> PythonWorker::spawn(const std::string& executable, const std::string& script)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+            GERROR("PythonWorker, unable to create socket pair: %d\n", errno);
+            return std::shared_ptr<PythonWorker>();
+        }
+
+        // dup2 clears close-on-exec, only the worker end is inherited
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], 3);
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(executable.c_str()));
+        argv.push_back(const_cast<char*>(script.c_str()));
+        argv.push_back(0);
+
+        pid_t pid = -1;
+        int res = posix_spawnp(&pid, executable.c_str(), &actions, 0, &argv[0], environ);
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(fds[1]);
+
+        if (res != 0) {
+            GERROR("PythonWorker, unable to start %s %s: %d\n", executable.c_str(), script.c_str(), res);
+            ::close(fds[0]);
+            return std::shared_ptr<PythonWorker>();
+        }
+
+        std::shared_ptr<PythonWorker> worker(new PythonWorker());
+        worker->executable_ = executable;
+        worker->script_ = script;
+        worker->pid_ = pid;
+        worker->fd_ = fds[0];
+        return worker;
+    }
+
+    bool PythonWorker::alive()
+    {
+        if (pid_ <= 0) return false;
+
+        int status;
+        pid_t res = waitpid(pid_, &status, WNOHANG);
+        if (res == 0) return true;
+
+        pid_ = -1;
+        return false;
+    }
+
+    bool PythonWorker::send(uint64_t id, const std::string& payload)
+    {
+        if (fd_ == -1) return false;
+
+        uint64_t header[2] = { id, payload.size() };
+        std::string message(reinterpret_cast<const char*>(header), sizeof(header));
+        message += payload;
+
+        size_t sent = 0;
+        while (sent < message.size()) {
+            // no SIGPIPE if the worker has died
+            ssize_t n = ::send(fd_, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                GERROR("PythonWorker, unable to send to worker %d: %d\n", (int)pid_, errno);
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+
+    bool PythonWorker::receive(uint64_t& id, std::string& payload)
+    {
+        if (fd_ == -1) return false;
+
+        uint64_t header[2];
+        char* p = reinterpret_cast<char*>(header);
+        size_t received = 0;
+        while (received < sizeof(header)) {
+            ssize_t n = ::recv(fd_, p + received, sizeof(header) - received, 0);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) {
+                GERROR("PythonWorker, worker %d has gone\n", (int)pid_);
+                return false;
+            }
+            received += n;
+        }
+
+        id = header[0];
+        payload.resize(header[1]);
+
+        received = 0;
+        while (received < payload.size()) {
+            ssize_t n = ::recv(fd_, &payload[received], payload.size() - received, 0);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) {
+                GERROR("PythonWorker, worker %d has gone\n", (int)pid_);
+                return false;
+            }
+            received += n;
+        }
+        return true;
+    }
+
+    void PythonWorker::stop(unsigned int timeout_ms)
+    {
+        // the worker exits when its end of the socket is closed
+        if (fd_ != -1) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+        if (pid_ <= 0) return;
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        int status;
+        while (waitpid(pid_, &status, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                if (timeout_ms > 0) GWARN("PythonWorker, killing worker %d\n", (int)pid_);
+                kill(pid_, SIGKILL);
+                waitpid(pid_, &status, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        pid_ = -1;
+    }
+
+#else
+
+    std::shared_ptr<PythonWorker> PythonWorker::spawn(const std::string& executable, const std::string& script)
+    {
+        GERROR("PythonWorker, worker processes are not supported on this platform\n");
+        return std::shared_ptr<PythonWorker>();
+    }
+
+    bool PythonWorker::alive()
+    {
+        return false;
+    }
+
+    bool PythonWorker::send(uint64_t id, const std::string& payload)
+    {
+        return false;
+    }
+
+    bool PythonWorker::receive(uint64_t& id, std::string& payload)
+    {
+        return false;
+    }
+
+    void PythonWorker::stop(unsigned int timeout_ms)
+    {
+    }
+
+#endif
+
+    // ------------------------------------------------------------------------
+
+    PythonWorkerPool& PythonWorkerPool::instance()
+    {
+        static PythonWorkerPool pool;
+        return pool;
+    }
+
+    PythonWorkerPool::PythonWorkerPool()
+        : size_(2)
+    {
+        const char* s = std::getenv("GADGETRON_PYTHON_WORKER_POOL");
+        if (s && std::atoi(s) >= 0) size_ = std::atoi(s);
+    }
+
+    PythonWorkerPool::~PythonWorkerPool()
+    {
+        for (size_t n = 0; n < idle_.size(); n++) idle_[n]->stop(0);
+    }
+
+    void PythonWorkerPool::set_size(size_t n)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        size_ = n;
+        while (idle_.size() > size_) idle_.pop_front();
+    }
+
+    size_t PythonWorkerPool::size()
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return size_;
+    }
+
+    std::shared_ptr<PythonWorker> PythonWorkerPool::acquire(const std::string& executable, const std::string& script)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        // workers started for another interpreter or script are of no use any more
+        std::deque< std::shared_ptr<PythonWorker> > idle;
+        for (size_t n = 0; n < idle_.size(); n++) {
+            if (idle_[n]->executable() == executable && idle_[n]->script() == script && idle_[n]->alive()) {
+                idle.push_back(idle_[n]);
+            }
+        }
+        idle_.swap(idle);
+
+        std::shared_ptr<PythonWorker> worker;
+        if (!idle_.empty()) {
+            worker = idle_.front();
+            idle_.pop_front();
+        } else {
+            worker = PythonWorker::spawn(executable, script);
+        }
+
+        // starting a process is quick, the interpreters of the new workers start up in the background
+        while (worker && idle_.size() < size_) {
+            std::shared_ptr<PythonWorker> w = PythonWorker::spawn(executable, script);
+            if (!w) break;
+            idle_.push_back(w);
+        }
+
+        return worker;
+    }
+}
@@ -0,0 +1,336 @@
+/** \file   PythonWorker.h
+    \brief  Worker processes running Python gadgets outside of the embedded interpreter.
+
+            A PythonGadget in worker mode hosts its Python class in a separate Python process
+            (gadgetron_python_worker.py) instead of the interpreter embedded in the Gadgetron. Every
+            worker has its own GIL, so Python gadgets of different chains and connections run in parallel.
+
+            The gadget and its worker talk over a Unix domain socket pair, the worker end is file
+            descriptor 3 of the worker. A message is
+
+              [uint64 id][uint64 payload bytes][payload]
+
+            and a payload is a sequence of fields: integers are uint64, floating point numbers double,
+            strings and raw structures (ISMRMRD headers) a uint64 length followed by the bytes. Array data
+            is not sent over the socket: the sender writes it into a POSIX shared memory segment and the
+            payload only carries
+
+              [uint64 ISMRMRD data type][uint64 ndim][uint64 dims, ndim times][string segment name]
+
+            The worker maps the segments of a call without copying, the gadget removes them once the call
+            has finished. Data returned by the Python class comes back the same way and is copied into new
+            hoNDArrays, the gadget removes these segments after reading them.
+
+            Every call is answered by a DONE message with the return value of the Python method, or an
+            ERROR message with the Python traceback. Data the Python class passes on in the mean time
+            arrives as ACQUISITION, IMAGE, IMAGE_ARRAY or RECON_DATA messages before that and is put on
+            the queue of the next gadget.
+
+            A PythonGadget with batch_size > 1 sends the acquisitions or images it has gathered as one BATCH
+            call, the message id of its items followed by their count and the fields of every item as in
+            an ACQUISITION or IMAGE call.
+
+            Starting an interpreter and importing NumPy takes a while, so the PythonWorkerPool keeps a few
+            workers started ahead of time. A worker serves a single gadget and exits when the gadget closes,
+            the module state of one connection never leaks into the next.
+*/
+
+#pragma once
+
+#include "gadgetronpython_export.h"
+#include "hoNDArray.h"
+#include "mri_core_data.h"
+
+#include <ismrmrd/ismrmrd.h>
+#include <ismrmrd/meta.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <complex>
+#include <stdexcept>
+#include <sys/types.h>
+
+namespace Gadgetron {
+
+    /// Message identifiers, shared with gadgetron_python_worker.py
+    enum PythonWorkerMessageId
+    {
+        PYTHON_WORKER_CONFIG = 1,
+        PYTHON_WORKER_ACQUISITION = 2,
+        PYTHON_WORKER_IMAGE = 3,
+        PYTHON_WORKER_IMAGE_ARRAY = 4,
+        PYTHON_WORKER_RECON_DATA = 5,
+        PYTHON_WORKER_CLOSE = 6,
+        PYTHON_WORKER_BATCH = 7,
+        PYTHON_WORKER_DONE = 100,
+        PYTHON_WORKER_ERROR = 101
+    };
+
+    /// ISMRMRD data type of the array elements sent to a worker
+    template <typename T> uint64_t python_worker_data_type();
+    template <> inline uint64_t python_worker_data_type<uint16_t>() { return ISMRMRD::ISMRMRD_USHORT; }
+    template <> inline uint64_t python_worker_data_type<int16_t>() { return ISMRMRD::ISMRMRD_SHORT; }
+    template <> inline uint64_t python_worker_data_type<uint32_t>() { return ISMRMRD::ISMRMRD_UINT; }
+    template <> inline uint64_t python_worker_data_type<int32_t>() { return ISMRMRD::ISMRMRD_INT; }
+    template <> inline uint64_t python_worker_data_type<float>() { return ISMRMRD::ISMRMRD_FLOAT; }
+    template <> inline uint64_t python_worker_data_type<double>() { return ISMRMRD::ISMRMRD_DOUBLE; }
+    template <> inline uint64_t python_worker_data_type< std::complex<float> >() { return ISMRMRD::ISMRMRD_CXFLOAT; }
+    template <> inline uint64_t python_worker_data_type< std::complex<double> >() { return ISMRMRD::ISMRMRD_CXDOUBLE; }
+
+    /// Writes array data to a new shared memory segment, returns false on failure
+    EXPORTGADGETSPYTHON bool python_worker_write_segment(const std::string& name, const void* data, size_t bytes);
+
+    /// Copies a shared memory segment to data and removes the segment, returns false on failure
+    EXPORTGADGETSPYTHON bool python_worker_read_segment(const std::string& name, void* data, size_t bytes);
+
+    // ------------------------------------------------------------------------
+
+    /// Builds the payload of a message
+    class EXPORTGADGETSPYTHON PythonWorkerWriter
+    {
+    public:
+        PythonWorkerWriter() {}
+        ~PythonWorkerWriter();
+
+        void put_uint(uint64_t v) { buffer_.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+        void put_double(double v) { buffer_.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+        void put_bytes(const void* data, size_t bytes)
+        {
+            this->put_uint(bytes);
+            buffer_.append(reinterpret_cast<const char*>(data), bytes);
+        }
+
+        void put_string(const std::string& s) { this->put_bytes(s.data(), s.size()); }
+
+        /// An empty string if meta is 0
+        void put_meta(const ISMRMRD::MetaContainer* meta);
+
+        /// The array data goes to a shared memory segment, which lives until the writer is destroyed
+        template <typename T> void put_array(const hoNDArray<T>& a)
+        {
+            this->put_uint(python_worker_data_type<T>());
+            this->put_dimensions(a);
+
+            size_t bytes = a.get_number_of_elements() * sizeof(T);
+            std::string name;
+            if (bytes > 0) {
+                name = this->segment_name();
+                if (!python_worker_write_segment(name, a.begin(), bytes)) {
+                    throw std::runtime_error("PythonWorkerWriter, unable to write shared memory segment " + name);
+                }
+                segments_.push_back(name);
+            }
+            this->put_string(name);
+        }
+
+        /// Arrays of ISMRMRD headers are sent as raw structures over the socket
+        template <typename H> void put_headers(const hoNDArray<H>& a)
+        {
+            this->put_dimensions(a);
+            this->put_bytes(a.begin(), a.get_number_of_elements() * sizeof(H));
+        }
+
+        void put_image_array(const IsmrmrdImageArray& a);
+        void put_recon_data(const IsmrmrdReconData& d);
+
+        const std::string& buffer() const { return buffer_; }
+
+    protected:
+        template <typename T> void put_dimensions(const hoNDArray<T>& a)
+        {
+            size_t ndim = a.get_number_of_elements() > 0 ? a.get_number_of_dimensions() : 0;
+            this->put_uint(ndim);
+            for (size_t d = 0; d < ndim; d++) this->put_uint(a.get_size(d));
+        }
+
+        void put_data_buffered(const IsmrmrdDataBuffered& b);
+
+        std::string segment_name();
+
+        std::string buffer_;
+        std::vector<std::string> segments_;
+    };
+
+    // ------------------------------------------------------------------------
+
+    /// Reads the payload of a message, throws std::runtime_error if the payload is malformed
+    class EXPORTGADGETSPYTHON PythonWorkerReader
+    {
+    public:
+        PythonWorkerReader(const std::string& buffer) : buffer_(buffer), pos_(0) {}
+
+        uint64_t get_uint()
+        {
+            uint64_t v;
+            this->get_raw(&v, sizeof(v));
+            return v;
+        }
+
+        double get_double()
+        {
+            double v;
+            this->get_raw(&v, sizeof(v));
+            return v;
+        }
+
+        std::string get_string()
+        {
+            size_t bytes = this->get_uint();
+            this->check(bytes);
+            std::string s = buffer_.substr(pos_, bytes);
+            pos_ += bytes;
+            return s;
+        }
+
+        /// A raw structure, its size must match
+        template <typename H> void get_struct(H& h)
+        {
+            if (this->get_uint() != sizeof(H)) throw std::runtime_error("PythonWorkerReader, structure size mismatch");
+            this->get_raw(&h, sizeof(H));
+        }
+
+        /// Returns false if no meta data was sent
+        bool get_meta(ISMRMRD::MetaContainer& meta);
+
+        /// ISMRMRD data type of the next array
+        uint64_t peek_data_type()
+        {
+            uint64_t v;
+            this->check(sizeof(v));
+            memcpy(&v, buffer_.data() + pos_, sizeof(v));
+            return v;
+        }
+
+        /// The shared memory segment of the array is removed
+        template <typename T> void get_array(hoNDArray<T>& a)
+        {
+            if (this->get_uint() != python_worker_data_type<T>()) {
+                throw std::runtime_error("PythonWorkerReader, unexpected array data type");
+            }
+
+            std::vector<size_t> dims;
+            this->get_dimensions(dims);
+            std::string name = this->get_string();
+
+            if (dims.empty()) {
+                a.clear();
+                return;
+            }
+
+            a.create(dims);
+            if (!python_worker_read_segment(name, a.begin(), a.get_number_of_elements() * sizeof(T))) {
+                throw std::runtime_error("PythonWorkerReader, unable to read shared memory segment " + name);
+            }
+        }
+
+        template <typename H> void get_headers(hoNDArray<H>& a)
+        {
+            std::vector<size_t> dims;
+            this->get_dimensions(dims);
+
+            size_t bytes = this->get_uint();
+            if (dims.empty()) {
+                if (bytes != 0) throw std::runtime_error("PythonWorkerReader, header array size mismatch");
+                a.clear();
+                return;
+            }
+
+            a.create(dims);
+            if (bytes != a.get_number_of_elements() * sizeof(H)) {
+                throw std::runtime_error("PythonWorkerReader, header array size mismatch");
+            }
+            this->get_raw(a.begin(), bytes);
+        }
+
+        void get_image_array(IsmrmrdImageArray& a);
+        void get_recon_data(IsmrmrdReconData& d);
+
+    protected:
+        void check(size_t bytes) const
+        {
+            if (bytes > buffer_.size() - pos_) throw std::runtime_error("PythonWorkerReader, truncated message");
+        }
+
+        void get_raw(void* data, size_t bytes)
+        {
+            this->check(bytes);
+            memcpy(data, buffer_.data() + pos_, bytes);
+            pos_ += bytes;
+        }
+
+        void get_dimensions(std::vector<size_t>& dims);
+        void get_data_buffered(IsmrmrdDataBuffered& b);
+
+        const std::string& buffer_;
+        size_t pos_;
+    };
+
+    // ------------------------------------------------------------------------
+
+    /// A Python process hosting one Python gadget
+    class EXPORTGADGETSPYTHON PythonWorker
+    {
+    public:
+        ~PythonWorker();
+
+        /// Starts `executable script` with the worker end of the socket as file descriptor 3, 0 on failure
+        static std::shared_ptr<PythonWorker> spawn(const std::string& executable, const std::string& script);
+
+        const std::string& executable() const { return executable_; }
+        const std::string& script() const { return script_; }
+        pid_t pid() const { return pid_; }
+
+        /// False if the process has exited
+        bool alive();
+
+        bool send(uint64_t id, const std::string& payload);
+
+        /// Blocks until a message arrives, false if the worker has gone
+        bool receive(uint64_t& id, std::string& payload);
+
+        /// Closes the socket and waits for the process to exit, it is killed after timeout_ms
+        void stop(unsigned int timeout_ms = 10000);
+
+    protected:
+        PythonWorker();
+
+        std::string executable_;
+        std::string script_;
+        pid_t pid_;
+        int fd_;
+    };
+
+    // ------------------------------------------------------------------------
+
+    /// Workers started ahead of time
+    class EXPORTGADGETSPYTHON PythonWorkerPool
+    {
+    public:
+        static PythonWorkerPool& instance();
+
+        /**
+           Hands out an idle worker of the executable and script, or starts one if there is none, and
+           starts new workers until size() are idle again. Workers are not given back, a gadget stops its
+           worker when it closes.
+        */
+        std::shared_ptr<PythonWorker> acquire(const std::string& executable, const std::string& script);
+
+        /// Number of idle workers, initialised from GADGETRON_PYTHON_WORKER_POOL (2 by default)
+        void set_size(size_t n);
+        size_t size();
+
+    protected:
+        PythonWorkerPool();
+        ~PythonWorkerPool();
+
+        std::mutex mutex_;
+        size_t size_;
+        std::deque< std::shared_ptr<PythonWorker> > idle_;
+    };
+}
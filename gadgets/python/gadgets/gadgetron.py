@@ -34,6 +34,19 @@ class Gadget(object):
         # do work here
         self.put_next(header,*args)
 
+    def process_batch(self, headers, data, metas):
+        # Called instead of process by a PythonGadget with batch_size > 1. data holds the arrays
+        # stacked along the last axis if they are alike, a list of arrays otherwise, and metas the
+        # serialized meta data or None of every header. Override it to work on the whole batch.
+        for i, header in enumerate(headers):
+            args = (header, data[..., i] if isinstance(data, np.ndarray) else data[i])
+            if metas[i] is not None:
+                args += (metas[i],)
+            res = self.process(*args)
+            if res:
+                return res
+        return 0
+
     def wait(self):
         pass
     
@@ -47,7 +60,7 @@ class Gadget(object):
                     self.next_gadget.process(*new_args)
                 else:
                     self.next_gadget.process(*args)
-            elif isinstance(self.next_gadget, GadgetronPythonMRI.GadgetReference):
+            elif hasattr(self.next_gadget, "return_acquisition"): # GadgetReference, or its stand-in in a worker process
                 if len(args) > 3:
                     raise Exception("Only two or 3 return arguments are currently supported when returning to Gadgetron framework")
                 if isinstance(args[0], ismrmrd.AcquisitionHeader):
@@ -80,6 +93,34 @@ class Gadget(object):
         else:
             self.results.append(list(args))
 
+    def put_next_batch(self, headers, data, metas=None):
+        # Passes a batch on like put_next, data stacked along the last axis or a list of arrays.
+        # The Gadgetron framework takes the whole batch in one call.
+        if len(headers) == 0:
+            return
+        if metas is None:
+            metas = [None] * len(headers)
+        if hasattr(self.next_gadget, "return_acquisitions"):
+            metas = [m.serialize() if isinstance(m, ismrmrd.Meta) else m for m in metas]
+            stacked = isinstance(data, np.ndarray)
+            dtype = data.dtype if stacked else data[0].dtype
+            if isinstance(headers[0], ismrmrd.AcquisitionHeader) or dtype not in (np.uint16, np.float32):
+                data = data.astype('complex64') if stacked else [d.astype('complex64') for d in data]
+            if isinstance(headers[0], ismrmrd.AcquisitionHeader):
+                self.next_gadget.return_acquisitions(list(headers), data)
+            elif dtype == np.uint16:
+                self.next_gadget.return_images_ushort(list(headers), data, metas)
+            elif dtype == np.float32:
+                self.next_gadget.return_images_float(list(headers), data, metas)
+            else:
+                self.next_gadget.return_images_cplx(list(headers), data, metas)
+        else:
+            for i, header in enumerate(headers):
+                args = (header, data[..., i] if isinstance(data, np.ndarray) else data[i])
+                if metas[i] is not None:
+                    args += (metas[i],)
+                self.put_next(*args)
+
     def get_results(self):
         results = self.results
         self.results = []
@@ -0,0 +1,411 @@
+"""Worker process hosting the Python class of a PythonGadget in worker mode.
+
+Started by the PythonGadget (see PythonWorker.h for the protocol) with its end of
+a Unix domain socket pair as file descriptor 3. Array data is exchanged through
+POSIX shared memory segments, which are mapped here without copying.
+"""
+
+import os
+import sys
+import mmap
+import ctypes
+import socket
+import struct
+import itertools
+import traceback
+
+import numpy as np
+import ismrmrd
+import gadgetron
+
+CONFIG = 1
+ACQUISITION = 2
+IMAGE = 3
+IMAGE_ARRAY = 4
+RECON_DATA = 5
+CLOSE = 6
+BATCH = 7
+DONE = 100
+ERROR = 101
+
+# ISMRMRD data types
+DTYPES = {1: np.uint16, 2: np.int16, 3: np.uint32, 4: np.int32,
+          5: np.float32, 6: np.float64, 7: np.complex64, 8: np.complex128}
+TYPECODES = dict((np.dtype(v), k) for k, v in DTYPES.items())
+
+SHM_DIR = '/dev/shm'
+segment_counter = itertools.count()
+
+
+def to_str(b):
+    if isinstance(b, str):
+        return b
+    return b.decode('utf-8')
+
+
+def map_segment(name, dims, dtype):
+    nbytes = int(np.prod(dims)) * np.dtype(dtype).itemsize
+    fd = os.open(SHM_DIR + name, os.O_RDWR)
+    try:
+        mm = mmap.mmap(fd, nbytes)
+    finally:
+        os.close(fd)
+    return np.ndarray(shape=dims, dtype=dtype, buffer=mm, order='F')
+
+
+def new_segment(a):
+    name = '/gadgetron_py_%d_%d' % (os.getpid(), next(segment_counter))
+    fd = os.open(SHM_DIR + name, os.O_CREAT | os.O_EXCL | os.O_RDWR, 0o600)
+    try:
+        os.ftruncate(fd, a.nbytes)
+        mm = mmap.mmap(fd, a.nbytes)
+    finally:
+        os.close(fd)
+    dst = np.ndarray(shape=a.shape, dtype=a.dtype, buffer=mm, order='F')
+    dst[...] = a
+    del dst
+    mm.close()
+    return name
+
+
+class Reader(object):
+    def __init__(self, buf):
+        self.buf = buf
+        self.pos = 0
+
+    def uint(self):
+        v, = struct.unpack_from('=Q', self.buf, self.pos)
+        self.pos += 8
+        return v
+
+    def double(self):
+        v, = struct.unpack_from('=d', self.buf, self.pos)
+        self.pos += 8
+        return v
+
+    def bytes(self):
+        n = self.uint()
+        b = self.buf[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+    def string(self):
+        return to_str(self.bytes())
+
+    def dims(self):
+        return tuple(self.uint() for _ in range(self.uint()))
+
+    def array(self):
+        dtype = DTYPES[self.uint()]
+        dims = self.dims()
+        name = self.string()
+        if len(dims) == 0:
+            return np.zeros((0,), dtype=dtype)
+        return map_segment(name, dims, dtype)
+
+    def header(self, cls):
+        return cls.from_buffer_copy(self.bytes())
+
+    def headers(self, cls):
+        dims = self.dims()
+        raw = self.bytes()
+        size = ctypes.sizeof(cls)
+        num = len(raw) // size
+        flat = np.empty((num,), dtype=object)
+        for n in range(num):
+            flat[n] = cls.from_buffer_copy(raw[n * size:(n + 1) * size])
+        if len(dims) == 0:
+            return flat
+        return flat.reshape(dims, order='F')
+
+    def image_array(self):
+        data = self.array()
+        headers = self.headers(ismrmrd.ImageHeader)
+        meta = [self.string() for _ in range(self.uint())]
+        return gadgetron.IsmrmrdImageArray(data, headers, meta)
+
+    def data_buffered(self):
+        data = self.array()
+        trajectory = self.array() if self.uint() else None
+        headers = self.headers(ismrmrd.AcquisitionHeader)
+        sampling = gadgetron.SamplingDescription()
+        sampling.encoded_FOV = tuple(self.double() for _ in range(3))
+        sampling.recon_FOV = tuple(self.double() for _ in range(3))
+        sampling.encoded_matrix = tuple(self.uint() for _ in range(3))
+        sampling.recon_matrix = tuple(self.uint() for _ in range(3))
+        limits = []
+        for _ in range(3):
+            sl = gadgetron.SamplingLimit()
+            sl.min = self.uint()
+            sl.center = self.uint()
+            sl.max = self.uint()
+            limits.append(sl)
+        sampling.sampling_limits = tuple(limits)
+        return gadgetron.IsmrmrdDataBuffered(data, headers, sampling, trajectory)
+
+    def recon_data(self):
+        bits = []
+        for _ in range(self.uint()):
+            data = self.data_buffered()
+            ref = self.data_buffered() if self.uint() else None
+            bits.append(gadgetron.IsmrmrdReconBit(data, ref))
+        return bits
+
+
+class Writer(object):
+    def __init__(self):
+        self.parts = []
+
+    def payload(self):
+        return b''.join(self.parts)
+
+    def uint(self, v):
+        self.parts.append(struct.pack('=Q', int(v)))
+
+    def double(self, v):
+        self.parts.append(struct.pack('=d', float(v)))
+
+    def bytes(self, b):
+        self.uint(len(b))
+        self.parts.append(b)
+
+    def string(self, s):
+        if s is None:
+            s = ''
+        if not isinstance(s, type(b'')):
+            s = s.encode('utf-8')
+        self.bytes(s)
+
+    def dims(self, shape):
+        self.uint(len(shape))
+        for d in shape:
+            self.uint(d)
+
+    def array(self, a, dtype=None):
+        a = np.asarray(a)
+        if dtype is not None and a.dtype != np.dtype(dtype):
+            a = a.astype(dtype)
+        if a.dtype not in TYPECODES:
+            raise TypeError('unsupported array data type %s' % a.dtype)
+        self.uint(TYPECODES[a.dtype])
+        if a.size == 0:
+            self.dims(())
+            self.string('')
+        else:
+            self.dims(a.shape)
+            self.string(new_segment(a))
+
+    def header(self, h):
+        self.bytes(ctypes.string_at(ctypes.addressof(h), ctypes.sizeof(h)))
+
+    def headers(self, arr):
+        arr = np.asarray(arr, dtype=object)
+        flat = arr.ravel(order='F')
+        self.dims(arr.shape if flat.size > 0 else ())
+        self.bytes(b''.join(ctypes.string_at(ctypes.addressof(h), ctypes.sizeof(h)) for h in flat))
+
+    def image_array(self, a):
+        self.array(a.data, np.complex64)
+        self.headers(a.headers)
+        meta = a.meta if a.meta is not None else []
+        self.uint(len(meta))
+        for m in meta:
+            self.string(m)
+
+    def data_buffered(self, b):
+        self.array(b.data, np.complex64)
+        trajectory = getattr(b, 'trajectory', None)
+        self.uint(trajectory is not None)
+        if trajectory is not None:
+            self.array(trajectory, np.float32)
+        self.headers(b.headers)
+        s = b.sampling
+        for v in s.encoded_FOV:
+            self.double(v)
+        for v in s.recon_FOV:
+            self.double(v)
+        for v in s.encoded_matrix:
+            self.uint(v)
+        for v in s.recon_matrix:
+            self.uint(v)
+        for sl in s.sampling_limits:
+            self.uint(sl.min)
+            self.uint(sl.center)
+            self.uint(sl.max)
+
+    def recon_data(self, bits):
+        self.uint(len(bits))
+        for bit in bits:
+            self.data_buffered(bit.data)
+            ref = getattr(bit, 'ref', None)
+            self.uint(ref is not None)
+            if ref is not None:
+                self.data_buffered(ref)
+
+
+class Connection(object):
+    def __init__(self, fd):
+        self.sock = socket.fromfd(fd, socket.AF_UNIX, socket.SOCK_STREAM)
+        os.close(fd)
+
+    def recv_exact(self, n):
+        parts = []
+        while n > 0:
+            b = self.sock.recv(min(n, 1 << 20))
+            if not b:
+                raise EOFError()
+            parts.append(b)
+            n -= len(b)
+        return b''.join(parts)
+
+    def receive(self):
+        msg_id, n = struct.unpack('=QQ', self.recv_exact(16))
+        return msg_id, self.recv_exact(n)
+
+    def send(self, msg_id, payload=b''):
+        self.sock.sendall(struct.pack('=QQ', msg_id, len(payload)) + payload)
+
+
+class WorkerGadgetReference(object):
+    """Stands in for the GadgetReference of the embedded interpreter"""
+
+    def __init__(self, connection):
+        self.connection = connection
+
+    def return_data(self, msg_id, header, arr, dtype, meta=None):
+        w = Writer()
+        w.header(header)
+        w.array(arr, dtype)
+        w.string(meta)
+        self.connection.send(msg_id, w.payload())
+        return 0
+
+    def return_acquisition(self, acq, arr):
+        return self.return_data(ACQUISITION, acq, arr, np.complex64)
+
+    def return_image_cplx(self, img, arr):
+        return self.return_data(IMAGE, img, arr, np.complex64)
+
+    def return_image_cplx_attr(self, img, arr, meta):
+        return self.return_data(IMAGE, img, arr, np.complex64, meta)
+
+    def return_image_float(self, img, arr):
+        return self.return_data(IMAGE, img, arr, np.float32)
+
+    def return_image_float_attr(self, img, arr, meta):
+        return self.return_data(IMAGE, img, arr, np.float32, meta)
+
+    def return_image_ushort(self, img, arr):
+        return self.return_data(IMAGE, img, arr, np.uint16)
+
+    def return_image_ushort_attr(self, img, arr, meta):
+        return self.return_data(IMAGE, img, arr, np.uint16, meta)
+
+    def return_batch(self, msg_id, headers, arr, dtype, metas=None):
+        for i, header in enumerate(headers):
+            a = arr[..., i] if isinstance(arr, np.ndarray) else arr[i]
+            self.return_data(msg_id, header, a, dtype, None if metas is None else metas[i])
+        return 0
+
+    def return_acquisitions(self, headers, arr):
+        return self.return_batch(ACQUISITION, headers, arr, np.complex64)
+
+    def return_images_cplx(self, headers, arr, metas):
+        return self.return_batch(IMAGE, headers, arr, np.complex64, metas)
+
+    def return_images_float(self, headers, arr, metas):
+        return self.return_batch(IMAGE, headers, arr, np.float32, metas)
+
+    def return_images_ushort(self, headers, arr, metas):
+        return self.return_batch(IMAGE, headers, arr, np.uint16, metas)
+
+    def return_ismrmrd_image_array(self, rec):
+        w = Writer()
+        w.image_array(rec)
+        self.connection.send(IMAGE_ARRAY, w.payload())
+        return 0
+
+    def return_recondata(self, rec):
+        w = Writer()
+        w.recon_data(rec)
+        self.connection.send(RECON_DATA, w.payload())
+        return 0
+
+
+def configure(connection, r):
+    for p in r.string().split(';'):
+        if len(p) > 0 and p not in sys.path:
+            sys.path.insert(0, p)
+    module_name = r.string()
+    class_name = r.string()
+    parameters = [(r.string(), r.string()) for _ in range(r.uint())]
+    xml = r.string()
+
+    module = __import__(module_name)
+    gadget = getattr(module, class_name)(WorkerGadgetReference(connection))
+    for name, value in parameters:
+        gadget.set_parameter(name, value)
+    gadget.process_config(xml)
+    return gadget
+
+
+def process(gadget, msg_id, r):
+    if msg_id == ACQUISITION or msg_id == IMAGE:
+        cls = ismrmrd.AcquisitionHeader if msg_id == ACQUISITION else ismrmrd.ImageHeader
+        header = r.header(cls)
+        data = r.array()
+        meta = r.string()
+        if len(meta) > 0:
+            return gadget.process(header, data, meta)
+        return gadget.process(header, data)
+    if msg_id == BATCH:
+        cls = ismrmrd.AcquisitionHeader if r.uint() == ACQUISITION else ismrmrd.ImageHeader
+        headers, arrays, metas = [], [], []
+        for _ in range(r.uint()):
+            headers.append(r.header(cls))
+            arrays.append(r.array())
+            meta = r.string()
+            metas.append(meta if len(meta) > 0 else None)
+        # stacked along the last axis as by the embedded interpreter
+        if all(a.size > 0 and a.shape == arrays[0].shape for a in arrays):
+            data = np.stack(arrays, axis=-1)
+        else:
+            data = arrays
+        return gadget.process_batch(headers, data, metas)
+    if msg_id == IMAGE_ARRAY:
+        return gadget.process(r.image_array())
+    if msg_id == RECON_DATA:
+        return gadget.process(r.recon_data())
+    raise ValueError('unknown message %d' % msg_id)
+
+
+def main():
+    connection = Connection(3)
+    gadget = None
+
+    while True:
+        try:
+            msg_id, payload = connection.receive()
+        except EOFError:
+            break
+
+        if msg_id == CLOSE:
+            connection.send(DONE, struct.pack('=Q', 0))
+            break
+
+        try:
+            r = Reader(payload)
+            if msg_id == CONFIG:
+                gadget = configure(connection, r)
+                res = 0
+            else:
+                res = process(gadget, msg_id, r)
+            connection.send(DONE, struct.pack('=Q', (0 if res is None else int(res)) & 0xFFFFFFFFFFFFFFFF))
+        except Exception:
+            w = Writer()
+            w.string(traceback.format_exc())
+            connection.send(ERROR, w.payload())
+
+
+if __name__ == '__main__':
+    main()
@@ -14,9 +14,83 @@
 #include <algorithm>
 #include <vector>
 #include <cmath>
+#include <sstream>
 
 namespace Gadgetron{
 
+  RadialTrajectoryCache* RadialTrajectoryCache::instance()
+  {
+    static RadialTrajectoryCache cache;
+    return &cache;
+  }
+
+  RadialTrajectoryCache::Entry* RadialTrajectoryCache::find_entry(const std::string& key)
+  {
+    for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->key == key) {
+        entries_.splice(entries_.begin(), entries_, it);
+        return &entries_.front();
+      }
+    }
+    return 0;
+  }
+
+  void RadialTrajectoryCache::insert_entry(const Entry& e)
+  {
+    for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->key == e.key) {
+        entries_.erase(it);
+        break;
+      }
+    }
+    entries_.push_front(e);
+    while (entries_.size() > MAX_ENTRIES) entries_.pop_back();
+  }
+
+  bool RadialTrajectoryCache::find(const std::string& key, boost::shared_ptr< hoNDArray<floatd2> >& trajectory)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry* e = find_entry(key);
+    if (!e || !e->trajectory) return false;
+    trajectory = e->trajectory;
+    return true;
+  }
+
+  bool RadialTrajectoryCache::find(const std::string& key, boost::shared_ptr< hoNDArray<float> >& dcw)
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry* e = find_entry(key);
+    if (!e || !e->dcw) return false;
+    dcw = e->dcw;
+    return true;
+  }
+
+  void RadialTrajectoryCache::insert(const std::string& key, boost::shared_ptr< hoNDArray<floatd2> > trajectory)
+  {
+    Entry e;
+    e.key = key;
+    e.trajectory = trajectory;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    insert_entry(e);
+  }
+
+  void RadialTrajectoryCache::insert(const std::string& key, boost::shared_ptr< hoNDArray<float> > dcw)
+  {
+    Entry e;
+    e.key = key;
+    e.dcw = dcw;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    insert_entry(e);
+  }
+
+  size_t RadialTrajectoryCache::size()
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return entries_.size();
+  }
+
   gpuRadialPrepGadget::gpuRadialPrepGadget()
     : slices_(-1)
     , sets_(-1)
@@ -36,7 +110,6 @@ namespace Gadgetron{
     //
 
     mode_ = mode.value();
-    device_number_ = deviceno.value();
     rotations_per_reconstruction_ = rotations_per_reconstruction.value();
     buffer_length_in_rotations_ = buffer_length_in_rotations.value();
     buffer_using_solver_ = buffer_using_solver.value();
@@ -77,10 +150,8 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    if (device_number_ >= number_of_devices) {
-      GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-      device_number_ = (device_number_%number_of_devices);
-    }
+    device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number_);
 
     if (cudaSetDevice(device_number_)!= cudaSuccess) {
       GDEBUG( "Error: unable to set CUDA device.\n" );
@@ -255,13 +326,16 @@ namespace Gadgetron{
     // Allocate remaining shared_arrays
     //
     
-    csm_host_ = boost::shared_array< hoNDArray<float_complext> >(new hoNDArray<float_complext>[slices_*sets_]);
-    reg_host_ = boost::shared_array< hoNDArray<float_complext> >(new hoNDArray<float_complext>[slices_*sets_]);
+    csm_device_ = boost::shared_array< cuNDArrayPayload<float_complext> >(new cuNDArrayPayload<float_complext>[slices_*sets_]);
+    reg_device_ = boost::shared_array< cuNDArrayPayload<float_complext> >(new cuNDArrayPayload<float_complext>[slices_*sets_]);
 
     host_traj_recon_ = boost::shared_array< hoNDArray<floatd2> >(new hoNDArray<floatd2>[slices_*sets_]);
     host_weights_recon_ = boost::shared_array< hoNDArray<float> >(new hoNDArray<float>[slices_*sets_]);
 
-    if( !csm_host_.get() || !reg_host_.get() || !host_traj_recon_.get() || !host_weights_recon_ ){
+    frame_traj_ = boost::shared_array< std::map< long, boost::shared_ptr< cuNDArray<floatd2> > > >
+      (new std::map< long, boost::shared_ptr< cuNDArray<floatd2> > >[slices_*sets_]);
+
+    if( !csm_device_.get() || !reg_device_.get() || !host_traj_recon_.get() || !host_weights_recon_ ){
       GDEBUG("Failed to allocate host memory (3)\n");
       return GADGET_FAIL;
     }
@@ -409,7 +483,7 @@ namespace Gadgetron{
       long profile_offset = profiles_counter_global_[set*slices_+slice] - ((new_frame_detected) ? 1 : 0);
       boost::shared_ptr< cuNDArray<floatd2> > traj = calculate_trajectory_for_frame(profile_offset, set, slice);
 
-      buffer_update_needed_[set*slices_+slice] |= acc_buffer->add_frame_data( &samples, traj.get() );
+      buffer_update_needed_[set*slices_+slice] |= acc_buffer->add_frame_data( &samples, traj );
     }
     
     // Are we ready to reconstruct (downstream)?
@@ -477,24 +551,35 @@ namespace Gadgetron{
       // - and at the first pass
       
       if( buffer_update_needed_[set*slices_+slice] || 
-          csm_host_[set*slices_+slice].get_number_of_elements() == 0 || 
-          reg_host_[set*slices_+slice].get_number_of_elements() == 0 ){
+          csm_device_[set*slices_+slice].empty() || 
+          reg_device_[set*slices_+slice].empty() ){
 
         // Compute and set CSM (in derived Sense/Spirit/... class)
         //
 
-        csm_host_[set*slices_+slice] = *compute_csm( set*slices_+slice );
+        boost::shared_ptr< cuNDArray<float_complext> > csm = compute_csm( set*slices_+slice );
 	                
         // Compute regularization image
         //
         
-        reg_host_[set*slices_+slice] = *compute_reg( set, slice, new_frame_detected );
+        boost::shared_ptr< cuNDArray<float_complext> > reg = compute_reg( set, slice, new_frame_detected );
+
+        if( !csm.get() || !reg.get() ){
+          GDEBUG("Failed to compute csm or regularization image\n");
+          return GADGET_FAIL;
+        }
+
+        // Both stay on the device; the payloads record the stream the images were computed on
+        //
+
+        csm_device_[set*slices_+slice] = cuNDArrayPayload<float_complext>( csm );
+        reg_device_[set*slices_+slice] = cuNDArrayPayload<float_complext>( reg );
 		
         /*
           static int counter = 0;
           char filename[256];
           sprintf((char*)filename, "_reg_%d.real", counter);
-          write_nd_array<float>( abs(&reg_host_[set*slices_+slice]).get(), filename );
+          write_nd_array<float>( abs(reg_device_[set*slices_+slice].host_array().get()).get(), filename );
           counter++; */
 
         buffer_update_needed_[set*slices_+slice] = false;
@@ -528,8 +613,8 @@ namespace Gadgetron{
       m4->getObjectPtr()->dat_host_ = samples_host;
       m4->getObjectPtr()->tra_host_ = boost::shared_ptr< hoNDArray<floatd2> >(new hoNDArray<floatd2>(host_traj_recon_[set*slices_+slice]));
       m4->getObjectPtr()->dcw_host_ = boost::shared_ptr< hoNDArray<float> >(new hoNDArray<float>(host_weights_recon_[set*slices_+slice]));
-      m4->getObjectPtr()->csm_host_ = boost::shared_ptr< hoNDArray<float_complext> >( new hoNDArray<float_complext>(csm_host_[set*slices_+slice]));
-      m4->getObjectPtr()->reg_host_ = boost::shared_ptr< hoNDArray<float_complext> >( new hoNDArray<float_complext>(reg_host_[set*slices_+slice]));
+      m4->getObjectPtr()->csm_device_ = boost::shared_ptr< cuNDArrayPayload<float_complext> >( new cuNDArrayPayload<float_complext>(csm_device_[set*slices_+slice]));
+      m4->getObjectPtr()->reg_device_ = boost::shared_ptr< cuNDArrayPayload<float_complext> >( new cuNDArrayPayload<float_complext>(reg_device_[set*slices_+slice]));
 
       // Pull the image headers out of the queue
       //
@@ -628,12 +713,30 @@ namespace Gadgetron{
           long local_frame = (profile_offset/profiles_per_frame_[set*slices_+slice])%frames_per_rotation_[set*slices_+slice];
           float angular_offset = M_PI/float(profiles_per_frame_[set*slices_+slice])*float(local_frame)/float(frames_per_rotation_[set*slices_+slice]);	  
 
-          host_traj_recon_[set*slices_+slice] = *compute_radial_trajectory_fixed_angle_2d<float>
-            ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], 1, angular_offset )->to_host();	
+          std::stringstream key;
+          key << "fixed_angle_traj " << samples_per_profile_ << " " << profiles_per_frame_[set*slices_+slice] << " 1 "
+              << local_frame << "/" << frames_per_rotation_[set*slices_+slice];
+
+          boost::shared_ptr< hoNDArray<floatd2> > traj;
+          if( !RadialTrajectoryCache::instance()->find(key.str(), traj) ){
+            traj = compute_radial_trajectory_fixed_angle_2d<float>
+              ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], 1, angular_offset )->to_host();
+            RadialTrajectoryCache::instance()->insert(key.str(), traj);
+          }
+          host_traj_recon_[set*slices_+slice] = *traj;
         }
         else{
-          host_traj_recon_[set*slices_+slice] = *compute_radial_trajectory_fixed_angle_2d<float>
-            ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], frames_per_rotation_[set*slices_+slice] )->to_host();
+          std::stringstream key;
+          key << "fixed_angle_traj " << samples_per_profile_ << " " << profiles_per_frame_[set*slices_+slice] << " "
+              << frames_per_rotation_[set*slices_+slice];
+
+          boost::shared_ptr< hoNDArray<floatd2> > traj;
+          if( !RadialTrajectoryCache::instance()->find(key.str(), traj) ){
+            traj = compute_radial_trajectory_fixed_angle_2d<float>
+              ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], frames_per_rotation_[set*slices_+slice] )->to_host();
+            RadialTrajectoryCache::instance()->insert(key.str(), traj);
+          }
+          host_traj_recon_[set*slices_+slice] = *traj;
         }
       }
       break;
@@ -670,29 +773,13 @@ namespace Gadgetron{
   gpuRadialPrepGadget::calculate_density_compensation_for_reconstruction( unsigned int set, unsigned int slice)
   {
     //GDEBUG("Calculating dcw for reconstruction\n");
-    
-    switch(mode_){
-      
-    case 0:
-    case 1:
-      host_weights_recon_[set*slices_+slice] = *compute_radial_dcw_fixed_angle_2d<float>
-        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, 
-          1.0f/(float(samples_per_profile_)/float(image_dimensions_recon_[0])) )->to_host();
-      break;
-      
-    case 2:
-    case 3:
-      host_weights_recon_[set*slices_+slice] = *compute_radial_dcw_golden_ratio_2d<float>
-        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, 
-          1.0f/(float(samples_per_profile_)/float(image_dimensions_recon_[0])),0,
-          (mode_==2) ? GR_ORIGINAL : GR_SMALLEST )->to_host();
-      break;
-      
-    default:
-      GDEBUG("Illegal dcw mode\n");
+
+    // The weights of a reconstruction are those of a frame
+    boost::shared_ptr< hoNDArray<float> > dcw = cached_density_compensation_for_frame(set, slice);
+    if( !dcw.get() )
       return GADGET_FAIL;
-      break;
-    }
+
+    host_weights_recon_[set*slices_+slice] = *dcw;
     return GADGET_OK;
   }
   
@@ -709,10 +796,17 @@ namespace Gadgetron{
     case 1:
       {
         long local_frame = (profile_offset/profiles_per_frame_[set*slices_+slice])%frames_per_rotation_[set*slices_+slice];
-        float angular_offset = M_PI/float(profiles_per_frame_[set*slices_+slice])*float(local_frame)/float(frames_per_rotation_[set*slices_+slice]);	  
 
-        result = compute_radial_trajectory_fixed_angle_2d<float>
-          ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], 1, angular_offset );  
+        // The frames of a rotation repeat, keep their trajectories on the device
+        boost::shared_ptr< cuNDArray<floatd2> >& cached = frame_traj_[set*slices_+slice][local_frame];
+
+        if( !cached.get() ){
+          float angular_offset = M_PI/float(profiles_per_frame_[set*slices_+slice])*float(local_frame)/float(frames_per_rotation_[set*slices_+slice]);	  
+
+          cached = compute_radial_trajectory_fixed_angle_2d<float>
+            ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], 1, angular_offset );  
+        }
+        result = cached;
       }
       break;
 	
@@ -739,29 +833,50 @@ namespace Gadgetron{
   {    
     //GDEBUG("Calculating dcw for buffer frame\n");
 
+    boost::shared_ptr< hoNDArray<float> > dcw = cached_density_compensation_for_frame(set, slice);
+    if( !dcw.get() )
+      return boost::shared_ptr< cuNDArray<float> >();
+
+    return boost::shared_ptr< cuNDArray<float> >( new cuNDArray<float>(*dcw) );
+  }
+
+  boost::shared_ptr< hoNDArray<float> >
+  gpuRadialPrepGadget::cached_density_compensation_for_frame(unsigned int set, unsigned int slice)
+  {
+    float scale = 1.0f/(float(samples_per_profile_)/float(image_dimensions_recon_[0]));
+
+    std::stringstream key;
+    key << "dcw " << mode_ << " " << samples_per_profile_ << " " << profiles_per_frame_[set*slices_+slice] << " "
+        << oversampling_factor_ << " " << scale;
+
+    boost::shared_ptr< hoNDArray<float> > dcw;
+    if( RadialTrajectoryCache::instance()->find(key.str(), dcw) )
+      return dcw;
+
     switch(mode_){
       
     case 0:
     case 1:
-      return compute_radial_dcw_fixed_angle_2d<float>
-        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, 1.0f/(float(samples_per_profile_)/float(image_dimensions_recon_[0])) );
+      dcw = compute_radial_dcw_fixed_angle_2d<float>
+        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, scale )->to_host();
       break;
       
     case 2:
     case 3:
-      return compute_radial_dcw_golden_ratio_2d<float>
-        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, 
-          1.0f/(float(samples_per_profile_)/float(image_dimensions_recon_[0])),0,
-          (mode_==2) ? GR_ORIGINAL : GR_SMALLEST );
+      dcw = compute_radial_dcw_golden_ratio_2d<float>
+        ( samples_per_profile_, profiles_per_frame_[set*slices_+slice], oversampling_factor_, scale, 0,
+          (mode_==2) ? GR_ORIGINAL : GR_SMALLEST )->to_host();
       break;
       
     default:
       GDEBUG("Illegal dcw mode\n");
-      return boost::shared_ptr< cuNDArray<float> >();
+      return dcw;
       break;
-    }   
-  }
+    }
 
+    RadialTrajectoryCache::instance()->insert(key.str(), dcw);
+    return dcw;
+  }
 
   boost::shared_ptr< cuNDArray<floatd2> > 
   gpuRadialPrepGadget::calculate_trajectory_for_rhs(long profile_offset, unsigned int set, unsigned int slice)
@@ -910,6 +1025,8 @@ namespace Gadgetron{
     GDEBUG("\nReconfiguring:\n#profiles/frame:%d\n#frames/rotation: %d\n#rotations/reconstruction:%d\n", 
                   profiles_per_frame_[set*slices_+slice], frames_per_rotation_[set*slices_+slice], rotations_per_reconstruction_);
 
+    frame_traj_[set*slices_+slice].clear();
+
     calculate_trajectory_for_reconstruction(0, set, slice);
     calculate_density_compensation_for_reconstruction(set, slice);
     
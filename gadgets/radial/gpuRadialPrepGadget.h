@@ -10,11 +10,17 @@
 #include "cuBuffer.h"
 #include "cuSenseBufferCg.h"
 #include "cuSpiritBuffer.h"
+#include "cuNDArrayPayload.h"
 
 #include <ismrmrd/ismrmrd.h>
 #include <complex>
+#include <string>
+#include <list>
+#include <map>
+#include <mutex>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include "cudaDeviceManager.h"
 
 /*
   ------------------------------------------
@@ -69,6 +75,49 @@
 
 namespace Gadgetron{
 
+  /**
+     Process wide cache of host radial trajectories and density compensation weights.
+
+     The trajectories of the fixed angle modes repeat with every rotation and the weights depend on the
+     sequence parameters only, so the connections of a protocol compute them once. Entries are keyed by
+     a description of the trajectory (mode and parameters) and the least recently used ones are dropped
+     beyond MAX_ENTRIES. Cached arrays are shared and must not be modified.
+  */
+  class EXPORTGADGETS_RADIAL RadialTrajectoryCache
+  {
+  public:
+
+    enum { MAX_ENTRIES = 64 };
+
+    static RadialTrajectoryCache* instance();
+
+    bool find(const std::string& key, boost::shared_ptr< hoNDArray<floatd2> >& trajectory);
+    bool find(const std::string& key, boost::shared_ptr< hoNDArray<float> >& dcw);
+
+    void insert(const std::string& key, boost::shared_ptr< hoNDArray<floatd2> > trajectory);
+    void insert(const std::string& key, boost::shared_ptr< hoNDArray<float> > dcw);
+
+    size_t size();
+
+  protected:
+
+    RadialTrajectoryCache() {}
+
+    struct Entry
+    {
+      std::string key;
+      boost::shared_ptr< hoNDArray<floatd2> > trajectory;
+      boost::shared_ptr< hoNDArray<float> > dcw;
+    };
+
+    Entry* find_entry(const std::string& key);
+    void insert_entry(const Entry& e);
+
+    std::mutex mutex_;
+    /// most recently used first
+    std::list<Entry> entries_;
+  };
+
   class EXPORTGADGETS_RADIAL gpuRadialPrepGadget :
     public Gadget2< ISMRMRD::AcquisitionHeader, hoNDArray< std::complex<float> > >
   {
@@ -80,7 +129,7 @@ namespace Gadgetron{
 
   protected:
     GADGET_PROPERTY_LIMITS(mode,int,"Radial mode", 0, GadgetPropertyLimitsEnumeration, 0,1,2,3);
-    GADGET_PROPERTY(deviceno,int,"GPU Device Number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(buffer_length_in_rotations, int, "Number of rotations in a buffer", 1);
     GADGET_PROPERTY(buffer_using_solver, bool, "Use solver for buffer", false);
     GADGET_PROPERTY(buffer_convolution_kernel_width, float, "Convolution kernel width for buffer", 5.5);
@@ -102,9 +151,9 @@ namespace Gadgetron{
 
     virtual void reconfigure(unsigned int set, unsigned int slice, bool use_dcw = true);
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_csm( unsigned int buffer_idx ) = 0;
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_csm( unsigned int buffer_idx ) = 0;
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_reg
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_reg
       ( unsigned int set, unsigned int slice, bool new_frame ) = 0;
     
     virtual void allocate_accumulation_buffer( unsigned int num_buffers ) = 0;
@@ -134,6 +183,10 @@ namespace Gadgetron{
     boost::shared_ptr< cuNDArray<float> >
       calculate_density_compensation_for_frame(unsigned int set, unsigned int slice);
 
+    // Density compensation weights of a frame on the host, from the RadialTrajectoryCache
+    boost::shared_ptr< hoNDArray<float> >
+      cached_density_compensation_for_frame(unsigned int set, unsigned int slice);
+
     // Compute trajectory/dcw for the fully sampled accumulation buffer (iterative buffer mode only)
     //
 
@@ -146,6 +199,7 @@ namespace Gadgetron{
     int slices_;
     int sets_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
     int mode_; // See note above
     long samples_per_profile_;
 
@@ -185,11 +239,16 @@ namespace Gadgetron{
 
     boost::shared_array<bool> buffer_update_needed_;
 
+    // Device trajectories of the frames of a rotation (fixed angle modes), by frame number.
+    // Passing the same array for consecutive frames lets the buffer reuse its nfft preprocessing.
+    boost::shared_array< std::map< long, boost::shared_ptr< cuNDArray<floatd2> > > > frame_traj_;
+
     boost::shared_array< hoNDArray<floatd2> > host_traj_recon_;
     boost::shared_array< hoNDArray<float> > host_weights_recon_;
     
-    boost::shared_array< hoNDArray<float_complext> > csm_host_;
-    boost::shared_array< hoNDArray<float_complext> > reg_host_;
+    // csm and regularization images stay on the device, the recon gadgets download them only if needed
+    boost::shared_array< cuNDArrayPayload<float_complext> > csm_device_;
+    boost::shared_array< cuNDArrayPayload<float_complext> > reg_device_;
     
     // We would like to make a single array of the buffer base class
     // but encounter yet unexplainable heap corruptions if we do.
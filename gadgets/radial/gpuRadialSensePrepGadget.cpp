@@ -2,9 +2,11 @@
 #include "b1_map.h"
 #include "cuSenseBufferCg.h"
 
+#include <algorithm>
+
 namespace Gadgetron{
 
-  boost::shared_ptr< hoNDArray<float_complext> > 
+  boost::shared_ptr< cuNDArray<float_complext> > 
   gpuRadialSensePrepGadget::compute_csm( unsigned int idx )
   {    
     // Estimate and update csm related data structures
@@ -13,27 +15,21 @@ namespace Gadgetron{
     cuSenseBuffer<float,2> *acc_buffer = 
       (this->buffer_using_solver_) ? &this->acc_buffer_sense_cg_[idx] : &this->acc_buffer_sense_[idx];
   
-    boost::shared_ptr< cuNDArray<float_complext> > csm_data = 
-      acc_buffer->get_accumulated_coil_images();
-    
-    if( !csm_data.get() ){
-      GDEBUG("Error during accumulation buffer computation\n");
-      return boost::shared_ptr< hoNDArray<float_complext> >();
+    // The buffer warm starts the estimation from its previous csm and skips estimations while the csm changes little
+    boost::shared_ptr< cuNDArray<float_complext> > csm;
+
+    try{
+      csm = acc_buffer->update_csm();
+    }
+    catch( std::runtime_error& err ){
+      GDEBUG("Error during coil estimation: %s\n", err.what());
+      return boost::shared_ptr< cuNDArray<float_complext> >();
     }
     
-    boost::shared_ptr< cuNDArray<float_complext> > csm = 
-      estimate_b1_map<float,2>( csm_data.get() );
-  
-    if( !csm.get() ){
-      GDEBUG("Error during coil estimation\n");
-      return boost::shared_ptr< hoNDArray<float_complext> >();
-    }            
-    
-    acc_buffer->set_csm(csm);
-    return csm->to_host(); 
+    return csm;
   }
   
-  boost::shared_ptr< hoNDArray<float_complext> > 
+  boost::shared_ptr< cuNDArray<float_complext> > 
   gpuRadialSensePrepGadget::compute_reg( unsigned int set, unsigned int slice, bool new_frame )
   {    
     // Estimate and update regularization image related data structures
@@ -52,10 +48,10 @@ namespace Gadgetron{
     
     if( !reg_image.get() ){
       GDEBUG("Error computing regularization image\n");
-      return boost::shared_ptr< hoNDArray<float_complext> >();
+      return boost::shared_ptr< cuNDArray<float_complext> >();
     }            
     
-    return reg_image->to_host();
+    return reg_image;
   }
 
   void 
@@ -70,6 +66,13 @@ namespace Gadgetron{
     else{
       this->acc_buffer_sense_ = boost::shared_array< cuSenseBuffer<float,2> >(new cuSenseBuffer<float,2>[size]);
     }
+
+    for( unsigned int i=0; i<size; i++ ){
+      cuSenseBuffer<float,2> *acc_buffer = 
+        (this->buffer_using_solver_) ? &this->acc_buffer_sense_cg_[i] : &this->acc_buffer_sense_[i];
+      acc_buffer->set_csm_update
+        ( std::max(csm_warm_start_iterations.value(), 0), csm_change_threshold.value(), std::max(csm_max_update_interval.value(), 1) );
+    }
   }
 
   void gpuRadialSensePrepGadget::reconfigure(unsigned int set, unsigned int slice, bool use_dcw)
@@ -13,12 +13,15 @@ namespace Gadgetron{
     virtual ~gpuRadialSensePrepGadget() {}
     
   protected:
+    GADGET_PROPERTY(csm_warm_start_iterations, int, "Power iterations of the csm estimation started from the previous csm, 0 to estimate every csm from scratch", 0);
+    GADGET_PROPERTY(csm_change_threshold, float, "Relative csm change below which the csm update interval is doubled", 0.02f);
+    GADGET_PROPERTY(csm_max_update_interval, int, "Largest number of buffer updates per csm estimation", 1);
     
     virtual void reconfigure(unsigned int set, unsigned int slice, bool use_dcw = true);
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_csm( unsigned int buffer_idx );
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_csm( unsigned int buffer_idx );
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_reg( unsigned int set, 
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_reg( unsigned int set, 
                                                                         unsigned int slice, 
                                                                         bool new_frame );
     
@@ -12,10 +12,15 @@ namespace Gadgetron{
   int 
   gpuRadialSpiritPrepGadget::process_config(ACE_Message_Block* mb)
   {
+    if( spirit_kernel_size.value() < 3 || (spirit_kernel_size.value()%2) == 0 ){
+      GDEBUG("Spirit kernel size must be odd and at least 3, got %d\n", spirit_kernel_size.value());
+      return GADGET_FAIL;
+    }
+
     return gpuRadialPrepGadget::process_config(mb);
   }
   
-  boost::shared_ptr< hoNDArray<float_complext> > 
+  boost::shared_ptr< cuNDArray<float_complext> > 
   gpuRadialSpiritPrepGadget::compute_csm( unsigned int idx )
   {    
     // Estimate and update csm related data structures
@@ -31,7 +36,7 @@ namespace Gadgetron{
     cuNDFFT<float>::instance()->fft( csm_data.get(), &dims_to_xform );
     
     boost::shared_ptr< cuNDArray<float_complext> > csm =       
-      estimate_spirit_kernels( csm_data.get(), 7 ); // TODO: let the kernel size be user defined
+      estimate_spirit_kernels( csm_data.get(), spirit_kernel_size.value(), spirit_fft_calibration.value() );
 
 
 
@@ -55,10 +60,10 @@ namespace Gadgetron{
     // <-- END debug output
 */
 
-    return csm->to_host(); 
+    return csm;
   }
   
-  boost::shared_ptr< hoNDArray<float_complext> > 
+  boost::shared_ptr< cuNDArray<float_complext> > 
   gpuRadialSpiritPrepGadget::compute_reg( unsigned int set, unsigned int slice, bool new_frame )
   {    
     // Estimate and update regularization image related data structures
@@ -69,10 +74,10 @@ namespace Gadgetron{
     
     if( !reg_image.get() ){
       GDEBUG("Error computing regularization image\n");
-      return boost::shared_ptr< hoNDArray<float_complext> >();
+      return boost::shared_ptr< cuNDArray<float_complext> >();
     }            
     
-    return reg_image->to_host();
+    return reg_image;
   }
 
   void 
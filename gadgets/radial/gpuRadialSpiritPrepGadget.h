@@ -13,14 +13,16 @@ namespace Gadgetron{
     virtual ~gpuRadialSpiritPrepGadget() {}
     
   protected:
+    GADGET_PROPERTY(spirit_kernel_size, int, "Size of the Spirit calibration kernels, odd", 7);
+    GADGET_PROPERTY(spirit_fft_calibration, bool, "Form the Spirit calibration equations from FFT based coil correlations", true);
     
     virtual int process_config(ACE_Message_Block *mb);
 
     virtual void reconfigure(unsigned int set, unsigned int slice, bool use_dcw = true );
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_csm( unsigned int buffer_idx );
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_csm( unsigned int buffer_idx );
 
-    virtual boost::shared_ptr< hoNDArray<float_complext> > compute_reg( unsigned int set, 
+    virtual boost::shared_ptr< cuNDArray<float_complext> > compute_reg( unsigned int set, 
                                                                         unsigned int slice, 
                                                                         bool new_frame );
     
@@ -35,7 +35,6 @@ namespace Gadgetron{
     //
 
     mode_ = mode.value();
-    device_number_ = deviceno.value();
     profiles_per_frame_ = profiles_per_frame.value();
     frames_per_cardiac_cycle_ = frames_per_cardiac_cycle.value();
     profiles_per_buffer_frame_ = profiles_per_buffer_frame.value();
@@ -67,10 +66,8 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    if (device_number_ >= number_of_devices) {
-      GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-      device_number_ = (device_number_%number_of_devices);
-    }
+    device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number_);
 
     if (cudaSetDevice(device_number_)!= cudaSuccess) {
       GDEBUG( "Error: unable to set CUDA device.\n" );
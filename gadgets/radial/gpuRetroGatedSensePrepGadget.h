@@ -13,6 +13,7 @@
 #include <complex>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include "cudaDeviceManager.h"
 
 /*
   Prep gadget for retrospectively gated Sense based on golden ratio sampling.
@@ -32,7 +33,7 @@ namespace Gadgetron{
 
   protected:
     GADGET_PROPERTY_LIMITS(mode,int,"Radial mode", 2, GadgetPropertyLimitsEnumeration, 2, 3);
-    GADGET_PROPERTY(deviceno,int,"GPU Device Number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(profiles_per_frame, int, "Profiles per frame", 16);
     GADGET_PROPERTY(frames_per_cardiac_cycle, int, "Frames in a cardiac cycle", 30);
     GADGET_PROPERTY(profiles_per_buffer_frame, int, "Profiles in each buffer frame", 32);
@@ -89,6 +90,7 @@ namespace Gadgetron{
     int slices_;
     int sets_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
     int mode_;
 
     unsigned short phys_time_index_;
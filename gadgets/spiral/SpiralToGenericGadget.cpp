@@ -136,24 +136,12 @@ namespace Gadgetron{
 
     if (!prepared_) {
 
-      int     nfov   = 1;         /*  number of fov coefficients.             */
-      int     ngmax  = 1e5;       /*  maximum number of gradient samples      */
-      double  *xgrad;             /*  x-component of gradient.                */
-      double  *ygrad;             /*  y-component of gradient.                */
-      double  *x_trajectory;
-      double  *y_trajectory;
-      double  *weighting;
-      int     ngrad;
-      double sample_time = (1.0*Tsamp_ns_) * 1e-9;
-
-      // Calculate gradients 
-      calc_vds(smax_,gmax_,sample_time,sample_time,Nints_,&fov_,nfov,krmax_,ngmax,&xgrad,&ygrad,&ngrad);
-
-      samples_per_interleave_ = std::min(ngrad,static_cast<int>(m1->getObjectPtr()->number_of_samples));
-      GDEBUG("Using %d samples per interleave\n", samples_per_interleave_);
+      // The trajectory is shared by the connections of a protocol
+      boost::shared_ptr<const SpiralTrajectory> spiral = calc_vds_trajectory
+	(smax_,gmax_,Tsamp_ns_,Nints_,fov_,krmax_,static_cast<int>(m1->getObjectPtr()->number_of_samples));
 
-      // Calculate the trajectory and weights
-      calc_traj(xgrad, ygrad, samples_per_interleave_, Nints_, sample_time, krmax_, &x_trajectory, &y_trajectory, &weighting);
+      samples_per_interleave_ = spiral->samples_per_interleave;
+      GDEBUG("Using %d samples per interleave\n", samples_per_interleave_);
 
       std::vector<size_t> trajectory_dimensions;
       trajectory_dimensions.push_back(3);
@@ -165,17 +153,14 @@ namespace Gadgetron{
 	float* co_ptr = reinterpret_cast<float*>(host_traj_->get_data_ptr());
 	
 	for (int i = 0; i < (samples_per_interleave_*Nints_); i++) {
-		co_ptr[i*3+0] = -x_trajectory[i]/2;
-		co_ptr[i*3+1] = -y_trajectory[i]/2;
-		co_ptr[i*3+2] = weighting[i];
+		co_ptr[i*3+0] = spiral->kx[i];
+		co_ptr[i*3+1] = spiral->ky[i];
+		co_ptr[i*3+2] = spiral->weights[i];
 	}
       }
 
-      delete [] xgrad;
-      delete [] ygrad;
-      delete [] x_trajectory;
-      delete [] y_trajectory;
-      delete [] weighting;
+      // The readouts reference their interleave in this array instead of carrying a copy
+      host_traj_->share();
 
       prepared_ = true;
     }
@@ -200,15 +185,17 @@ namespace Gadgetron{
     std::vector<size_t> trajectory_dimensions;
     trajectory_dimensions.push_back(3);
     trajectory_dimensions.push_back(samples_per_interleave_);
-    
-    hoNDArray<float> *traj_source = new hoNDArray<float>
-      (&trajectory_dimensions, host_traj_->get_data_ptr()+3*samples_per_interleave_*interleave);
-    
+
+    if (interleave >= static_cast<unsigned int>(Nints_)) {
+      GDEBUG("Interleave %d out of range, %d interleaves\n", interleave, Nints_);
+      return GADGET_FAIL;
+    }
+
     // Make a new array as continuation of m1, and pass along
     //
 
     GadgetContainerMessage< hoNDArray<float> > *cont = new GadgetContainerMessage< hoNDArray<float> >();
-    *(cont->getObjectPtr()) = *traj_source;
+    host_traj_->get_shared_sub_array(3*samples_per_interleave_*interleave, trajectory_dimensions, *cont->getObjectPtr());
     m2->cont(cont);
 
     //We need to make sure that the trajectory dimensions are attached. 
@@ -13,6 +13,11 @@
 
 namespace Gadgetron{
 
+  /**
+     Attaches the trajectory and density compensation weights of its interleave to every spiral readout,
+     computed once from the HargreavesVDS2000 trajectory description of the header. The readouts reference
+     the shared trajectory table without a copy, so clients may leave the trajectories out of the acquisitions.
+  */
   class EXPORTGADGETS_SPIRAL SpiralToGenericGadget :
     public Gadget2< ISMRMRD::AcquisitionHeader, hoNDArray< std::complex<float> > >
   {
@@ -43,12 +43,8 @@ namespace Gadgetron{
       return GADGET_FAIL;
     }
 
-    device_number_ = deviceno.value();
-
-    if (device_number_ >= number_of_devices) {
-      GDEBUG("Adjusting device number from %d to %d\n", device_number_,  (device_number_%number_of_devices));
-      device_number_ = (device_number_%number_of_devices);
-    }
+    device_number_ = device_selection_.select(deviceno.value(), this->get_controller());
+    GDEBUG("Using CUDA device %d\n", device_number_);
 
     if (cudaSetDevice(device_number_)!= cudaSuccess) {
       GDEBUG( "Error: unable to set CUDA device.\n" );
@@ -231,26 +227,13 @@ namespace Gadgetron{
 
     if (!prepared_) {
 
-      int     nfov   = 1;         /*  number of fov coefficients.             */
-      int     ngmax  = 1e5;       /*  maximum number of gradient samples      */
-      double  *xgrad;             /*  x-component of gradient.                */
-      double  *ygrad;             /*  y-component of gradient.                */
-      double  *x_trajectory;
-      double  *y_trajectory;
-      double  *weighting;
-      int     ngrad;
-      //int     count;
-      double sample_time = (1.0*Tsamp_ns_) * 1e-9;
-
-      /*	call c-function here to calculate gradients */
-      calc_vds(smax_,gmax_,sample_time,sample_time,Nints_,&fov_,nfov,krmax_,ngmax,&xgrad,&ygrad,&ngrad);
-      samples_per_interleave_ = std::min(ngrad,static_cast<int>(m1->getObjectPtr()->number_of_samples));
+      // The trajectory is shared by the connections of a protocol
+      boost::shared_ptr<const SpiralTrajectory> spiral = calc_vds_trajectory
+	(smax_,gmax_,Tsamp_ns_,Nints_,fov_,krmax_,static_cast<int>(m1->getObjectPtr()->number_of_samples));
+      samples_per_interleave_ = spiral->samples_per_interleave;
 
       GDEBUG("Using %d samples per interleave\n", samples_per_interleave_);
 
-      /* Calcualte the trajectory and weights*/
-      calc_traj(xgrad, ygrad, samples_per_interleave_, Nints_, sample_time, krmax_, &x_trajectory, &y_trajectory, &weighting);
-
       host_traj_ = boost::shared_ptr< hoNDArray<floatd2> >(new hoNDArray<floatd2>);
       host_weights_ = boost::shared_ptr< hoNDArray<float> >(new hoNDArray<float>);
 
@@ -265,18 +248,12 @@ namespace Gadgetron{
 	float* we_ptr =  reinterpret_cast<float*>(host_weights_->get_data_ptr());
 	
 	for (int i = 0; i < (samples_per_interleave_*Nints_); i++) {
-	  co_ptr[i*2]   = -x_trajectory[i]/2;
-	  co_ptr[i*2+1] = -y_trajectory[i]/2;
-	  we_ptr[i] = weighting[i];
+	  co_ptr[i*2]   = spiral->kx[i];
+	  co_ptr[i*2+1] = spiral->ky[i];
+	  we_ptr[i] = spiral->weights[i];
 	}
       }
 
-      delete [] xgrad;
-      delete [] ygrad;
-      delete [] x_trajectory;
-      delete [] y_trajectory;
-      delete [] weighting;
-
       // Setup the NFFT plan
       //
 
@@ -507,6 +484,7 @@ namespace Gadgetron{
 	
 	if( propagate_csm_from_set_ < 0 || propagate_csm_from_set_ == set ){	  	  
 	  csm_ = estimate_b1_map<float,2>( &image ); // Estimates csm
+	  csm_device_ = cuNDArrayPayload<float_complext>( csm_ );
 	}
 	else{
 	  //GDEBUG("Set %d is reusing the csm from set %d\n", set, propagate_csm_from_set_);
@@ -521,8 +499,8 @@ namespace Gadgetron{
 	//
 	
 	image_dims.pop_back();
-	cuNDArray<float_complext> reg_image(&image_dims);
-	E_->mult_csm_conj_sum( &image, &reg_image );
+	boost::shared_ptr< cuNDArray<float_complext> > reg_image( new cuNDArray<float_complext>(&image_dims) );
+	E_->mult_csm_conj_sum( &image, reg_image.get() );
 	
 	if( buffer_using_solver_ ){
 	  
@@ -537,14 +515,13 @@ namespace Gadgetron{
 	  D_->set_weights( precon_weights );
 	  
 	  // Solve from the plain coil combination
-	  reg_image = *cg_.solve_from_rhs(&reg_image);
+	  reg_image = cg_.solve_from_rhs(reg_image.get());
 	}
 
 	// Get ready to fill in the Sense job
 	//
 
-	boost::shared_ptr< hoNDArray<float_complext> > csm_host = csm_->to_host();
-	boost::shared_ptr< hoNDArray<float_complext> > reg_host = reg_image.to_host();
+	cuNDArrayPayload<float_complext> reg_device( reg_image );
 
 	unsigned int profiles_buffered = buffer_[set*slices_+slice].message_count();
 
@@ -612,8 +589,8 @@ namespace Gadgetron{
 	GadgetContainerMessage< GenericReconJob >* m4 = new GadgetContainerMessage< GenericReconJob >();
 
 	m4->getObjectPtr()->dat_host_ = data_host;
-	m4->getObjectPtr()->csm_host_ = csm_host;
-	m4->getObjectPtr()->reg_host_ = reg_host;
+	m4->getObjectPtr()->csm_device_ = boost::shared_ptr< cuNDArrayPayload<float_complext> >( new cuNDArrayPayload<float_complext>(csm_device_) );
+	m4->getObjectPtr()->reg_device_ = boost::shared_ptr< cuNDArrayPayload<float_complext> >( new cuNDArrayPayload<float_complext>(reg_device) );
 	m4->getObjectPtr()->tra_host_ = traj_host;
 	m4->getObjectPtr()->dcw_host_ = dcw_host;
 
@@ -9,6 +9,7 @@
 #include "cuNonCartesianSenseOperator.h"
 #include "cuCgPreconditioner.h"
 #include "cuNFFT.h"
+#include "cuNDArrayPayload.h"
 #include "hoNDArray.h"
 #include "vector_td.h"
 #include "cuNFFT.h"
@@ -17,6 +18,7 @@
 #include <complex>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include "cudaDeviceManager.h"
 
 namespace Gadgetron{
 
@@ -31,7 +33,7 @@ namespace Gadgetron{
     virtual ~gpuSpiralSensePrepGadget();
 
   protected:
-    GADGET_PROPERTY(deviceno, int, "GPU device number", 0);
+    GADGET_PROPERTY(deviceno, int, "GPU device number, -1 for the least loaded device", -1);
     GADGET_PROPERTY(propagate_csm_from_set, int, "Which set to use for CSM", -1);
     GADGET_PROPERTY(buffer_using_solver, bool, "Use solver for buffer", false);
     GADGET_PROPERTY(use_multiframe_grouping, bool, "Use multiframe grouping", false);
@@ -57,6 +59,7 @@ namespace Gadgetron{
     int sets_;
     boost::shared_array<long> image_counter_;
     int device_number_;
+    cudaDeviceSelection device_selection_;
 
     long    Tsamp_ns_;
     long    Nints_;
@@ -90,6 +93,7 @@ namespace Gadgetron{
     cuNFFT_plan<float,2> nfft_plan_;
     cuCgSolver<float_complext> cg_;
     boost::shared_ptr< cuNDArray<float_complext> > csm_;
+    cuNDArrayPayload<float_complext> csm_device_; // csm_ for the recon jobs, renewed with every estimation
     boost::shared_ptr< cuNonCartesianSenseOperator<float,2> > E_;
     boost::shared_ptr< cuCgPreconditioner<float_complext> > D_;
 
@@ -2,6 +2,9 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <algorithm>
+#include <list>
+#include <mutex>
 
 #define GAMMA 	4258.0		/* Hz/G */
 #define PI	3.141592	/* pi */
@@ -492,4 +495,83 @@ namespace Gadgetron{
 	  }    
       }    
   }
+  namespace {
+
+    // sequence parameters a cached trajectory was computed for
+    struct SpiralTrajectoryKey
+    {
+      double slewmax, gradmax, fov, krmax;
+      long Tsamp_ns;
+      int Ninterleaves, max_samples;
+
+      bool operator==(const SpiralTrajectoryKey& k) const
+      {
+	return slewmax == k.slewmax && gradmax == k.gradmax && fov == k.fov && krmax == k.krmax &&
+	  Tsamp_ns == k.Tsamp_ns && Ninterleaves == k.Ninterleaves && max_samples == k.max_samples;
+      }
+    };
+
+    typedef std::pair< SpiralTrajectoryKey, boost::shared_ptr<const SpiralTrajectory> > SpiralTrajectoryEntry;
+
+    const size_t SPIRAL_TRAJECTORY_CACHE_ENTRIES = 16;
+
+    std::mutex spiral_trajectory_mutex;
+    std::list<SpiralTrajectoryEntry> spiral_trajectory_cache; // most recently used first
+  }
+
+  boost::shared_ptr<const SpiralTrajectory>
+  calc_vds_trajectory(double slewmax, double gradmax, long Tsamp_ns, int Ninterleaves,
+		      double fov, double krmax, int max_samples)
+  {
+    SpiralTrajectoryKey key = { slewmax, gradmax, fov, krmax, Tsamp_ns, Ninterleaves, max_samples };
+
+    {
+      std::lock_guard<std::mutex> guard(spiral_trajectory_mutex);
+      for (std::list<SpiralTrajectoryEntry>::iterator it = spiral_trajectory_cache.begin(); it != spiral_trajectory_cache.end(); ++it) {
+	if (it->first == key) {
+	  spiral_trajectory_cache.splice(spiral_trajectory_cache.begin(), spiral_trajectory_cache, it);
+	  return spiral_trajectory_cache.front().second;
+	}
+      }
+    }
+
+    int     nfov   = 1;         /*  number of fov coefficients.             */
+    int     ngmax  = 1e5;       /*  maximum number of gradient samples      */
+    double  *xgrad;             /*  x-component of gradient.                */
+    double  *ygrad;             /*  y-component of gradient.                */
+    double  *x_trajectory;
+    double  *y_trajectory;
+    double  *weighting;
+    int     ngrad;
+    double sample_time = (1.0*Tsamp_ns) * 1e-9;
+
+    calc_vds(slewmax,gradmax,sample_time,sample_time,Ninterleaves,&fov,nfov,krmax,ngmax,&xgrad,&ygrad,&ngrad);
+
+    boost::shared_ptr<SpiralTrajectory> t(new SpiralTrajectory);
+    t->samples_per_interleave = std::min(ngrad, max_samples);
+    t->interleaves = Ninterleaves;
+
+    calc_traj(xgrad, ygrad, t->samples_per_interleave, Ninterleaves, sample_time, krmax, &x_trajectory, &y_trajectory, &weighting);
+
+    size_t n = (size_t)t->samples_per_interleave*Ninterleaves;
+    t->kx.resize(n);
+    t->ky.resize(n);
+    t->weights.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      t->kx[i] = -x_trajectory[i]/2;
+      t->ky[i] = -y_trajectory[i]/2;
+      t->weights[i] = weighting[i];
+    }
+
+    delete [] xgrad;
+    delete [] ygrad;
+    delete [] x_trajectory;
+    delete [] y_trajectory;
+    delete [] weighting;
+
+    std::lock_guard<std::mutex> guard(spiral_trajectory_mutex);
+    spiral_trajectory_cache.push_front(SpiralTrajectoryEntry(key, t));
+    if (spiral_trajectory_cache.size() > SPIRAL_TRAJECTORY_CACHE_ENTRIES) spiral_trajectory_cache.pop_back();
+    return t;
+  }
 }
@@ -2,6 +2,9 @@
 
 #include "gadgetron_spiral_export.h"
 
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
 namespace Gadgetron{
 
   void EXPORTGADGETS_SPIRAL 
@@ -12,4 +15,26 @@ namespace Gadgetron{
   void EXPORTGADGETS_SPIRAL 
   calc_traj(double* xgrad, double* ygrad, int ngrad, int Nints, double Tgsamp, double krmax,
 	    double** x_trajectory, double** y_trajectory, double** weights);  
+
+  /**
+     Trajectory and density compensation weights of a variable density spiral with a single fov
+     coefficient, as computed by calc_vds and calc_traj. The coordinates are scaled to [-0.5,0.5].
+  */
+  struct SpiralTrajectory
+  {
+    int samples_per_interleave;
+    int interleaves;
+    std::vector<float> kx;       // [samples_per_interleave*interleaves]
+    std::vector<float> ky;
+    std::vector<float> weights;
+  };
+
+  /**
+     calc_vds and calc_traj for the given sequence parameters, with at most max_samples samples per
+     interleave. The results are kept in a process wide cache, so the connections of a protocol
+     compute the trajectory once. The returned trajectory is shared and must not be modified.
+  */
+  boost::shared_ptr<const SpiralTrajectory> EXPORTGADGETS_SPIRAL
+  calc_vds_trajectory(double slewmax, double gradmax, long Tsamp_ns, int Ninterleaves,
+		      double fov, double krmax, int max_samples);
 }
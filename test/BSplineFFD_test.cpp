@@ -0,0 +1,110 @@
+/** \file       BSplineFFD_test.cpp
+    \brief      Test case for the batched evaluation of BSpline FFD
+*/
+
+#include "hoNDArray_elemwise.h"
+#include "hoNDArray_math.h"
+#include "hoNDArray_utils.h"
+#include "ho2DArray.h"
+#include "ho3DArray.h"
+#include "ho4DArray.h"
+#include "BSplineFFD2D.h"
+#include "BSplineFFD3D.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace Gadgetron;
+
+typedef FFDBase<float, float, 3, 2> FFDBase3D;
+typedef FFDBase<float, float, 2, 1> FFDBase2D;
+
+class BSplineFFD_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<float> uni(-1, 1);
+
+        a3D.create(40, 33, 21);
+        ffd3D = BSplineFFD3D<float, float, 2>(a3D, (size_t)9, (size_t)8, (size_t)7);
+
+        for (size_t z = 0; z < ffd3D.get_size(2); z++)
+            for (size_t y = 0; y < ffd3D.get_size(1); y++)
+                for (size_t x = 0; x < ffd3D.get_size(0); x++)
+                    for (size_t d = 0; d < 2; d++)
+                        ffd3D.set(x, y, z, d, uni(gen));
+
+        std::vector<size_t> dim(2);
+        dim[0] = 50;
+        dim[1] = 45;
+        im2D.create(dim);
+        im2D.set_pixel_size(0, 1.3f);
+        im2D.set_origin(1, 2.0f);
+        ffd2D = BSplineFFD2D<float, float, 1>(im2D, (size_t)12, (size_t)10);
+
+        for (size_t y = 0; y < ffd2D.get_size(1); y++)
+            for (size_t x = 0; x < ffd2D.get_size(0); x++)
+                ffd2D.set(x, y, 0, uni(gen));
+    }
+
+    hoNDArray<float> a3D;
+    BSplineFFD3D<float, float, 2> ffd3D;
+
+    hoNDImage<float, 2> im2D;
+    BSplineFFD2D<float, float, 1> ffd2D;
+};
+
+TEST_F(BSplineFFD_test, evaluateFFDOnArray)
+{
+    hoNDArray<float> r[2], r_ref[2];
+    for (size_t d = 0; d < 2; d++)
+    {
+        r[d].create(40, 33, 21);
+        r_ref[d].create(40, 33, 21);
+    }
+
+    EXPECT_TRUE(ffd3D.evaluateFFDOnArray(r));
+    EXPECT_TRUE(ffd3D.FFDBase3D::evaluateFFDOnArray(r_ref));
+
+    for (size_t d = 0; d < 2; d++)
+        for (size_t n = 0; n < r[d].get_number_of_elements(); n++)
+            EXPECT_NEAR(r[d](n), r_ref[d](n), 1e-5);
+}
+
+TEST_F(BSplineFFD_test, evaluateFFDOnImage)
+{
+    hoNDImage<float, 2> r(im2D), r_ref(im2D);
+
+    EXPECT_TRUE(ffd2D.evaluateFFDOnImage(r));
+    EXPECT_TRUE(ffd2D.FFDBase2D::evaluateFFDOnImage(&r_ref));
+
+    for (size_t n = 0; n < r.get_number_of_elements(); n++)
+        EXPECT_NEAR(r(n), r_ref(n), 1e-5);
+}
+
+TEST_F(BSplineFFD_test, evaluateFFDArray)
+{
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> uni(0, 1);
+
+    size_t N = 1000;
+    hoNDArray<float> pts(3, N), r;
+
+    for (size_t n = 0; n < N; n++)
+    {
+        float pg[3];
+        ffd3D.world_to_grid(uni(gen) * 39, uni(gen) * 32, uni(gen) * 20, pg[0], pg[1], pg[2]);
+        for (size_t d = 0; d < 3; d++) pts(d, n) = pg[d];
+    }
+
+    EXPECT_TRUE(ffd3D.evaluateFFDArray(pts, r));
+
+    for (size_t n = 0; n < N; n++)
+    {
+        float v[2];
+        ffd3D.evaluateFFD(&pts(0, n), v);
+        EXPECT_NEAR(r(0, n), v[0], 1e-5);
+        EXPECT_NEAR(r(1, n), v[1], 1e-5);
+    }
+}
@@ -0,0 +1,149 @@
+#include "GadgetSharedMemoryRingLayout.h"
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Gadgetron;
+
+namespace
+{
+    //One POSIX segment mapped twice, as the client and the server see it
+    class GadgetSharedMemoryRing_test : public ::testing::Test
+    {
+    protected:
+        enum { CAPACITY = 64*1024 };
+
+        virtual void SetUp()
+        {
+            std::stringstream name;
+            name << "/gadgetron_ring_test_" << getpid();
+            name_ = name.str();
+            size_ = GadgetSharedMemoryRingView::DATA_OFFSET + CAPACITY;
+
+            int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+            ASSERT_NE(fd, -1);
+            ASSERT_EQ(ftruncate(fd, size_), 0);
+
+            client_base_ = mmap(0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            server_base_ = mmap(0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            ASSERT_NE(client_base_, MAP_FAILED);
+            ASSERT_NE(server_base_, MAP_FAILED);
+        }
+
+        virtual void TearDown()
+        {
+            if (client_base_ != MAP_FAILED) munmap(client_base_, size_);
+            if (server_base_ != MAP_FAILED) munmap(server_base_, size_);
+            shm_unlink(name_.c_str());
+        }
+
+        std::string name_;
+        size_t size_;
+        void* client_base_;
+        void* server_base_;
+    };
+
+    //The payload of record i, the sizes vary so that records end anywhere in the ring
+    std::vector<char> payload(size_t i)
+    {
+        std::vector<char> p(1 + (i*7919) % 5000);
+        for (size_t k = 0; k < p.size(); k++) p[k] = char(i + k*13);
+        return p;
+    }
+}
+
+TEST_F(GadgetSharedMemoryRing_test, openRejectsUninitialized)
+{
+    memset(server_base_, 0, GadgetSharedMemoryRingView::DATA_OFFSET);
+    GadgetSharedMemoryRingView server;
+    EXPECT_FALSE(server.open(server_base_, size_));
+}
+
+TEST_F(GadgetSharedMemoryRing_test, openRejectsTooSmallMapping)
+{
+    GadgetSharedMemoryRingView client;
+    client.initialize(client_base_, CAPACITY);
+
+    GadgetSharedMemoryRingView server;
+    EXPECT_FALSE(server.open(server_base_, size_ - 1));
+    EXPECT_TRUE(server.open(server_base_, size_));
+    EXPECT_EQ(server.capacity(), uint64_t(CAPACITY));
+}
+
+TEST_F(GadgetSharedMemoryRing_test, recordNotVisibleBeforeCommit)
+{
+    GadgetSharedMemoryRingView client;
+    client.initialize(client_base_, CAPACITY);
+
+    GadgetSharedMemoryRingView server;
+    ASSERT_TRUE(server.open(server_base_, size_));
+
+    GadgetSharedMemoryRecord r;
+    char* p = client.reserve(100, r);
+    ASSERT_TRUE(p != 0);
+    EXPECT_TRUE(server.record(r) == 0);
+
+    client.commit(r);
+    EXPECT_TRUE(server.record(r) != 0);
+
+    server.release(r);
+    EXPECT_TRUE(server.record(r) == 0);
+
+    EXPECT_TRUE(client.reserve(CAPACITY + 1, r) == 0);
+}
+
+TEST_F(GadgetSharedMemoryRing_test, roundTrip)
+{
+    const size_t records = 2000;
+
+    GadgetSharedMemoryRingView client;
+    client.initialize(client_base_, CAPACITY);
+
+    GadgetSharedMemoryRingView server;
+    ASSERT_TRUE(server.open(server_base_, size_));
+
+    //The records go through the ring several times, the writer blocks while it is full.
+    //A pipe stands in for the socket that carries the records.
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    std::thread writer([&]() {
+        for (size_t i = 0; i < records; i++) {
+            std::vector<char> p = payload(i);
+            GadgetSharedMemoryRecord r;
+            char* dst = client.reserve(p.size(), r);
+            memcpy(dst, &p[0], p.size());
+            client.commit(r);
+            if (write(fds[1], &r, sizeof(r)) != sizeof(r)) break;
+        }
+    });
+
+    size_t mismatches = 0;
+    GadgetSharedMemoryRecord r;
+    r.position = 0;
+    for (size_t i = 0; i < records; i++) {
+        if (read(fds[0], &r, sizeof(r)) != sizeof(r)) break;
+
+        const char* src = server.record(r);
+        std::vector<char> p = payload(i);
+        if (!src || r.bytes != p.size() || memcmp(src, &p[0], p.size()) != 0) mismatches++;
+        server.release(r);
+    }
+
+    writer.join();
+    close(fds[0]);
+    close(fds[1]);
+
+    EXPECT_EQ(mismatches, size_t(0));
+    EXPECT_GT(r.position, uint64_t(CAPACITY));
+}
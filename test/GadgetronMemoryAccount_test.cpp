@@ -0,0 +1,71 @@
+#include "GadgetronMemoryAccount.h"
+#include "hoNDArrayAllocator.h"
+#include "hoNDArrayMemoryPool.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace Gadgetron;
+
+TEST(GadgetronMemoryAccount, chargedToStreamAndGadget)
+{
+    std::shared_ptr<GadgetronMemoryAccount> stream = GadgetronMemoryAccount::create("stream");
+    std::shared_ptr<GadgetronMemoryAccount> gadget = GadgetronMemoryAccount::create("gadget", stream);
+    ASSERT_EQ(1u, stream->children().size());
+
+    void* untracked = hoNDArrayAllocator::instance().allocate(1000);
+    void* ptr = 0;
+    {
+        GadgetronMemoryAccountScope scope(gadget.get());
+        ptr = hoNDArrayAllocator::instance().allocate(3000);
+    }
+    EXPECT_EQ(0, GadgetronMemoryAccount::current());
+    EXPECT_EQ(3000u, gadget->bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(3000u, stream->bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(0u, stream->bytes(GadgetronMemoryAccount::DEVICE));
+
+    //Released on another thread, outside of any account
+    std::thread t([ptr]() { hoNDArrayAllocator::instance().deallocate(ptr); });
+    t.join();
+    hoNDArrayAllocator::instance().deallocate(untracked);
+
+    EXPECT_EQ(0u, gadget->bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(0u, stream->bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(3000u, gadget->peak_bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(3000u, stream->peak_bytes(GadgetronMemoryAccount::HOST));
+}
+
+TEST(GadgetronMemoryAccount, pooledBlocks)
+{
+    std::shared_ptr<GadgetronMemoryAccount> gadget = GadgetronMemoryAccount::create("gadget");
+
+    void* ptr = 0;
+    {
+        GadgetronMemoryAccountScope scope(gadget.get());
+        ptr = hoNDArrayMemoryPool::instance().allocate_bytes(5000);
+    }
+
+    //The block is charged, not the slab it was carved from
+    EXPECT_EQ(hoNDArrayMemoryPool::block_size(hoNDArrayMemoryPool::size_class(5000)), gadget->bytes(GadgetronMemoryAccount::HOST));
+
+    EXPECT_TRUE(hoNDArrayMemoryPool::instance().deallocate(ptr));
+    EXPECT_EQ(0u, gadget->bytes(GadgetronMemoryAccount::HOST));
+}
+
+TEST(GadgetronMemoryAccount, outlivesGadget)
+{
+    std::shared_ptr<GadgetronMemoryAccount> stream = GadgetronMemoryAccount::create("stream");
+    void* ptr = 0;
+    {
+        std::shared_ptr<GadgetronMemoryAccount> gadget = GadgetronMemoryAccount::create("gadget", stream);
+        GadgetronMemoryAccountScope scope(gadget.get());
+        ptr = hoNDArrayAllocator::instance().allocate(100);
+    }
+    EXPECT_EQ(100u, stream->bytes(GadgetronMemoryAccount::HOST));
+
+    //The buffer keeps the account of the gadget alive until it is released
+    EXPECT_EQ(1u, stream->children().size());
+    hoNDArrayAllocator::instance().deallocate(ptr);
+    EXPECT_EQ(0u, stream->bytes(GadgetronMemoryAccount::HOST));
+    EXPECT_EQ(0u, stream->children().size());
+}
@@ -0,0 +1,58 @@
+#include "GadgetronMetrics.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace Gadgetron;
+
+TEST(GadgetronMetrics, counter)
+{
+    GadgetronMetricCounter& c = GadgetronMetrics::instance().counter("test_counter_total", "A test counter");
+    c.add();
+    c.add(4);
+    EXPECT_EQ(5u, c.value());
+
+    //The same name gives the same counter
+    EXPECT_EQ(&c, &GadgetronMetrics::instance().counter("test_counter_total", "Another help"));
+
+    std::string text = GadgetronMetrics::instance().write();
+    EXPECT_NE(std::string::npos, text.find("# HELP test_counter_total A test counter\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_counter_total counter\n"));
+    EXPECT_NE(std::string::npos, text.find("test_counter_total 5\n"));
+}
+
+TEST(GadgetronMetrics, histogramBuckets)
+{
+    GadgetronMetricHistogram& h = GadgetronMetrics::instance().histogram("test_histogram", "A test histogram");
+    h.add(0);
+    h.add(1);
+    h.add(3);
+    h.add(4);
+    EXPECT_EQ(4u, h.count());
+    EXPECT_EQ(8u, h.sum());
+    EXPECT_EQ(1u, h.bucket(0));
+    EXPECT_EQ(1u, h.bucket(1));
+    EXPECT_EQ(1u, h.bucket(2));
+    EXPECT_EQ(1u, h.bucket(3));
+
+    std::string text = GadgetronMetrics::instance().write();
+    EXPECT_NE(std::string::npos, text.find("test_histogram_bucket{le=\"0\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("test_histogram_bucket{le=\"3\"} 3\n"));
+    EXPECT_NE(std::string::npos, text.find("test_histogram_bucket{le=\"7\"} 4\n"));
+    EXPECT_EQ(std::string::npos, text.find("test_histogram_bucket{le=\"15\"}"));
+    EXPECT_NE(std::string::npos, text.find("test_histogram_bucket{le=\"+Inf\"} 4\n"));
+    EXPECT_NE(std::string::npos, text.find("test_histogram_sum 8\n"));
+    EXPECT_NE(std::string::npos, text.find("test_histogram_count 4\n"));
+}
+
+TEST(GadgetronMetrics, collector)
+{
+    GadgetronMetrics::instance().add_collector("test", [](std::ostream& os) {
+        GadgetronMetrics::write_header(os, "test_gauge", "A test gauge", "gauge");
+        GadgetronMetrics::write_sample(os, "test_gauge", "gadget=\"" + GadgetronMetrics::escape_label("a\"b") + "\"", 42);
+    });
+    EXPECT_NE(std::string::npos, GadgetronMetrics::instance().write().find("test_gauge{gadget=\"a\\\"b\"} 42\n"));
+
+    GadgetronMetrics::instance().remove_collector("test");
+    EXPECT_EQ(std::string::npos, GadgetronMetrics::instance().write().find("test_gauge"));
+}
@@ -0,0 +1,57 @@
+#include "GadgetronNodeProfile.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+
+using namespace Gadgetron;
+
+TEST(GadgetronNodeProfile, parse)
+{
+    std::stringstream s("# tuned on node 7\n\nthreads = 12\n  fftw.rigor=patient \ngadget.GrappaGadget.use_gpu = false\n");
+    std::map<std::string, std::string> settings;
+    ASSERT_TRUE(GadgetronNodeProfile::parse(s, settings));
+    ASSERT_EQ(3u, settings.size());
+    EXPECT_EQ("12", settings["threads"]);
+    EXPECT_EQ("patient", settings["fftw.rigor"]);
+    EXPECT_EQ("false", settings["gadget.GrappaGadget.use_gpu"]);
+
+    std::stringstream bad("threads = 12\nno setting here\n");
+    EXPECT_FALSE(GadgetronNodeProfile::parse(bad, settings));
+}
+
+TEST(GadgetronNodeProfile, saveAndLoad)
+{
+    GadgetronNodeProfile& profile = GadgetronNodeProfile::instance();
+    profile.clear();
+
+    profile.set("threads", 6);
+    profile.set("wavelet.threads", 2);
+    profile.set("gadget.GrappaGadget.use_gpu", "false");
+    profile.set("gadget.GrappaGadget.target_coils", "8");
+    profile.set("gadget.GrappaGadgetX.use_gpu", "true");
+
+    std::string filename = "GadgetronNodeProfile_test.txt";
+    ASSERT_TRUE(profile.save(filename, "first line\nsecond line"));
+
+    profile.clear();
+    EXPECT_FALSE(profile.has("threads"));
+    EXPECT_EQ(4, profile.get_int("threads", 4));
+
+    ASSERT_TRUE(profile.load(filename));
+    EXPECT_EQ(6, profile.get_int("threads", 0));
+    EXPECT_EQ(2, profile.get_int("wavelet.threads", 0));
+    EXPECT_EQ("none", profile.get("fftw.rigor", "none"));
+
+    std::map<std::string, std::string> props = profile.gadget_properties("GrappaGadget");
+    ASSERT_EQ(2u, props.size());
+    EXPECT_EQ("false", props["use_gpu"]);
+    EXPECT_EQ("8", props["target_coils"]);
+
+    //A file which cannot be read leaves the settings alone
+    EXPECT_FALSE(profile.load(filename + ".missing"));
+    EXPECT_EQ(6, profile.get_int("threads", 0));
+
+    std::remove(filename.c_str());
+    profile.clear();
+}
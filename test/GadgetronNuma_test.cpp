@@ -0,0 +1,67 @@
+#include "GadgetronNuma.h"
+#include "hoNDArrayAllocator.h"
+
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace Gadgetron;
+
+TEST(GadgetronNuma, parseCpulist)
+{
+    std::vector<int> cpus = GadgetronNuma::parse_cpulist("0-3,8,10-11\n");
+    ASSERT_EQ(7u, cpus.size());
+    EXPECT_EQ(0, cpus[0]);
+    EXPECT_EQ(3, cpus[3]);
+    EXPECT_EQ(8, cpus[4]);
+    EXPECT_EQ(11, cpus[6]);
+
+    EXPECT_TRUE(GadgetronNuma::parse_cpulist("").empty());
+}
+
+TEST(GadgetronNuma, placement)
+{
+    GadgetronNuma& numa = GadgetronNuma::instance();
+
+    if (!numa.enabled()) {
+        EXPECT_EQ(-1, numa.place(1));
+        return;
+    }
+
+    //Streams go to the node with the fewest streams
+    int a = numa.place(1);
+    int b = numa.place(1);
+    ASSERT_GE(a, 0);
+    ASSERT_GE(b, 0);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(1, numa.streams(a));
+    numa.release(a);
+    numa.release(b);
+    EXPECT_EQ(0, numa.streams(a));
+
+    //A share larger than any node is not placed
+    EXPECT_EQ(-1, numa.place(1 << 20));
+}
+
+TEST(GadgetronNuma, scopeAndAllocation)
+{
+    EXPECT_EQ(-1, GadgetronNuma::current_node());
+    {
+        GadgetronNumaScope scope(0, false);
+        EXPECT_EQ(0, GadgetronNuma::current_node());
+
+        //Large buffers are bound to the node, the data is unaffected
+        size_t n = 4 * GadgetronNuma::instance().bind_threshold();
+        char* ptr = static_cast<char*>(hoNDArrayAllocator::instance().allocate(n));
+        ASSERT_TRUE(ptr != 0);
+        std::memset(ptr, 7, n);
+        EXPECT_EQ(7, ptr[n - 1]);
+        hoNDArrayAllocator::instance().deallocate(ptr);
+    }
+    EXPECT_EQ(-1, GadgetronNuma::current_node());
+
+    //Pinning to the node the thread is on and back is harmless
+    {
+        GadgetronNumaScope scope(0, true);
+    }
+    GadgetronNuma::instance().bind_thread(-1);
+}
@@ -0,0 +1,104 @@
+#include "GadgetronTimer.h"
+#include "GadgetronProfile.h"
+
+#include <gtest/gtest.h>
+#include <cstdint>
+
+using namespace Gadgetron;
+
+TEST(GadgetronProfile, nestedZones)
+{
+    GadgetronProfile profile;
+    {
+        GadgetronProfileScope scope(&profile);
+        for (int i = 0; i < 10; i++) {
+            GADGETRON_PROFILE_ZONE("gadget");
+            { GADGETRON_PROFILE_ZONE("fft"); }
+            { GADGETRON_PROFILE_ZONE("fft"); }
+
+            GadgetronTimer timer(false);
+            timer.start("unmix");
+            timer.stop();
+        }
+    }
+    EXPECT_EQ(0, GadgetronProfile::current());
+    EXPECT_TRUE(GadgetronProfile::current_path().empty());
+
+    GadgetronProfile::ZoneMap zones = profile.zones();
+    ASSERT_EQ(3u, zones.size());
+    EXPECT_EQ(10u, zones["gadget"].count);
+    EXPECT_EQ(20u, zones["gadget/fft"].count);
+    EXPECT_EQ(10u, zones["gadget/unmix"].count);
+    EXPECT_GE(zones["gadget"].total_ns, zones["gadget/fft"].total_ns);
+}
+
+TEST(GadgetronProfile, noProfileNoZones)
+{
+    GadgetronProfile profile;
+    {
+        GADGETRON_PROFILE_ZONE("outside");
+    }
+    EXPECT_EQ(0u, profile.number_of_zones());
+}
+
+TEST(GadgetronProfile, childrenFollowParent)
+{
+    GadgetronProfile profile;
+    profile.add("a-b", 1);
+    profile.add("a/z", 1);
+    profile.add("a", 1);
+
+    GadgetronProfile::ZoneMap zones = profile.zones();
+    GadgetronProfile::ZoneMap::const_iterator it = zones.begin();
+    EXPECT_EQ("a", (it++)->first);
+    EXPECT_EQ("a/z", (it++)->first);
+    EXPECT_EQ("a-b", (it++)->first);
+}
+
+TEST(GadgetronProfile, percentiles)
+{
+    GadgetronProfile profile;
+    for (uint64_t v = 1; v <= 1000; v++) profile.add("zone", v * 1000);
+
+    GadgetronProfile::Zone z = profile.zones()["zone"];
+    EXPECT_EQ(1000u, z.count);
+    EXPECT_EQ(1000u, z.min_ns);
+    EXPECT_EQ(1000000u, z.max_ns);
+    EXPECT_NEAR(500500.0, z.mean_ns(), 1e-6);
+
+    //bins are 1/8 of an octave wide
+    EXPECT_GE(z.percentile_ns(0.5), 500000u);
+    EXPECT_LE(z.percentile_ns(0.5), 500000u * 9 / 8);
+    EXPECT_GE(z.percentile_ns(0.99), 990000u);
+    EXPECT_LE(z.percentile_ns(0.99), z.max_ns);
+}
+
+TEST(GadgetronProfile, recordListsZonesInOrder)
+{
+    GadgetronProfile profile;
+    GadgetronProfile::Record record;
+    {
+        GadgetronProfileScope scope(&profile);
+        GadgetronProfileRecordScope record_scope(&record);
+        {
+            GADGETRON_PROFILE_ZONE("outer");
+            {
+                GADGETRON_PROFILE_ZONE("inner");
+            }
+        }
+    }
+
+    ASSERT_EQ(2u, record.zones.size());
+    EXPECT_EQ("outer/inner", record.zones[0].first);
+    EXPECT_EQ("outer", record.zones[1].first);
+    EXPECT_GE(record.zones[1].second, record.zones[0].second);
+    EXPECT_EQ((GadgetronProfile::Record*)0, GadgetronProfile::current_record());
+
+    //zones outside of the record scope are not listed
+    {
+        GadgetronProfileScope scope(&profile);
+        GADGETRON_PROFILE_ZONE("after");
+    }
+    EXPECT_EQ(2u, record.zones.size());
+    EXPECT_EQ(3u, profile.number_of_zones());
+}
@@ -0,0 +1,121 @@
+#include "GadgetronThreadBudget.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif // USE_OMP
+
+using namespace Gadgetron;
+
+TEST(GadgetronThreadBudget, sharedByStreamsAndBusyGadgets)
+{
+    GadgetronThreadBudget& budget = GadgetronThreadBudget::instance();
+    budget.set_total(16);
+    int streams = budget.streams();
+
+    std::shared_ptr<GadgetronThreadBudget::Stream> a(new GadgetronThreadBudget::Stream());
+    std::shared_ptr<GadgetronThreadBudget::Stream> b(new GadgetronThreadBudget::Stream());
+
+    //Streams count once they are started
+    EXPECT_EQ(streams, budget.streams());
+    a->start();
+    a->start();
+    EXPECT_EQ(streams + 1, budget.streams());
+    b->start();
+    EXPECT_EQ(streams + 2, budget.streams());
+
+    if (streams == 0) {
+        EXPECT_EQ(8, budget.stream_share());
+
+        EXPECT_EQ(0, GadgetronThreadBudget::current());
+        EXPECT_EQ(16, GadgetronThreadBudget::num_threads());
+        {
+            GadgetronThreadBudgetScope s1(a.get());
+            EXPECT_EQ(8, GadgetronThreadBudget::num_threads());
+#ifdef USE_OMP
+            EXPECT_EQ(8, omp_get_max_threads());
+#endif // USE_OMP
+
+            //A second busy gadget of the stream gets half of its share
+            GadgetronThreadBudgetScope s2(a.get());
+            EXPECT_EQ(4, GadgetronThreadBudget::num_threads());
+
+            //The limit of a gadget applies below its share
+            GadgetronThreadBudgetScope s3(b.get(), 2);
+            EXPECT_EQ(2, GadgetronThreadBudget::num_threads());
+        }
+        EXPECT_EQ(0, a->busy());
+        EXPECT_EQ(16, GadgetronThreadBudget::num_threads());
+    }
+
+    a->stop();
+    b.reset();
+    EXPECT_EQ(streams, budget.streams());
+
+    //Never below one thread
+    budget.set_total(1);
+    a->start();
+    {
+        GadgetronThreadBudgetScope s1(a.get());
+        GadgetronThreadBudgetScope s2(a.get());
+        EXPECT_EQ(1, GadgetronThreadBudget::num_threads());
+    }
+    a->stop();
+
+    budget.set_total(0);
+    EXPECT_EQ(GadgetronThreadBudget::number_of_cores(), budget.total());
+}
+
+TEST(GadgetronThreadBudget, scopeWithoutStream)
+{
+#ifdef USE_OMP
+    int threads = omp_get_max_threads();
+#endif // USE_OMP
+    {
+        GadgetronThreadBudgetScope scope(0, 1);
+        EXPECT_EQ(0, GadgetronThreadBudget::current());
+#ifdef USE_OMP
+        EXPECT_EQ(threads, omp_get_max_threads());
+#endif // USE_OMP
+    }
+}
+
+TEST(GadgetronThreadBudget, batchStreamsGiveWayToRealtimeStreams)
+{
+    GadgetronThreadBudget& budget = GadgetronThreadBudget::instance();
+    budget.set_total(16);
+
+    if (budget.streams() == 0) {
+        GadgetronThreadBudget::Stream batch1, batch2, realtime;
+        batch1.set_batch(true);
+        batch2.set_batch(true);
+
+        //Without real-time streams the batch streams share equally
+        batch1.start();
+        batch2.start();
+        EXPECT_EQ(2, budget.batch_streams());
+        EXPECT_EQ(0, budget.realtime_streams());
+        EXPECT_EQ(8, batch1.share());
+
+        //A real-time stream takes all but one thread per batch stream
+        realtime.start();
+        EXPECT_EQ(1, budget.realtime_streams());
+        EXPECT_EQ(1, batch1.share());
+        EXPECT_EQ(14, realtime.share());
+
+        //The flag cannot change while the stream runs
+        batch2.set_batch(false);
+        EXPECT_TRUE(batch2.batch());
+
+        realtime.stop();
+        EXPECT_EQ(8, batch2.share());
+
+        batch1.stop();
+        batch2.stop();
+        EXPECT_EQ(0, budget.batch_streams());
+    }
+
+    budget.set_total(0);
+}
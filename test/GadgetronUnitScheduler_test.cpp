@@ -0,0 +1,153 @@
+#include "GadgetronUnitScheduler.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Gadgetron;
+
+namespace
+{
+    void sleep_us(int us)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+
+    //Counts how often every unit was processed
+    struct UnitCounter
+    {
+        UnitCounter(size_t num) : counts(num)
+        {
+            for (size_t i = 0; i < num; i++) counts[i] = 0;
+        }
+
+        void add(size_t first, size_t count)
+        {
+            for (size_t i = first; i < first + count; i++) counts[i]++;
+        }
+
+        bool all_once() const
+        {
+            for (size_t i = 0; i < counts.size(); i++) {
+                if (counts[i] != 1) return false;
+            }
+            return true;
+        }
+
+        std::vector< std::atomic<int> > counts;
+    };
+}
+
+TEST(GadgetronUnitScheduler, everyUnitOnce)
+{
+    const size_t num = 200;
+    UnitCounter c(num);
+
+    GadgetronUnitScheduler::Work cpu = [&](size_t first, size_t count) { EXPECT_EQ(1u, count); c.add(first, count); sleep_us(200); };
+    GadgetronUnitScheduler::Work gpu = [&](size_t first, size_t count) { c.add(first, count); sleep_us(100); };
+
+    GadgetronUnitScheduler scheduler;
+    scheduler.run(num, cpu, 4, std::vector<GadgetronUnitScheduler::Work>(2, gpu));
+
+    EXPECT_TRUE(c.all_once());
+    EXPECT_EQ(num, scheduler.cpu_units() + scheduler.gpu_units(0) + scheduler.gpu_units(1));
+
+    //Without gpus the cpu does all
+    UnitCounter d(num);
+    scheduler.run(num, [&](size_t first, size_t count) { d.add(first, count); }, 0, std::vector<GadgetronUnitScheduler::Work>());
+    EXPECT_TRUE(d.all_once());
+    EXPECT_EQ(num, scheduler.cpu_units());
+
+    scheduler.run(0, cpu, 4, std::vector<GadgetronUnitScheduler::Work>(1, gpu));
+    EXPECT_EQ(0u, scheduler.cpu_units() + scheduler.gpu_units(0));
+}
+
+TEST(GadgetronUnitScheduler, fasterBackendTakesMore)
+{
+    const size_t num = 400;
+    UnitCounter c(num);
+
+    //A call of the gpu costs as much as two cpu units, every unit 1/20 of that
+    GadgetronUnitScheduler::Work cpu = [&](size_t first, size_t count) { c.add(first, count); sleep_us(2000); };
+    GadgetronUnitScheduler::Work gpu = [&](size_t first, size_t count) { c.add(first, count); sleep_us(2000 + 200 * (int)count); };
+
+    GadgetronUnitScheduler scheduler;
+    scheduler.run(num, cpu, 2, std::vector<GadgetronUnitScheduler::Work>(1, gpu));
+
+    EXPECT_TRUE(c.all_once());
+    EXPECT_GT(scheduler.gpu_units(0), 2 * scheduler.cpu_units());
+
+    //The gpu starts with larger ranges once it is measured
+    double measured = scheduler.gpu_seconds_per_unit(0);
+    EXPECT_LT(measured, scheduler.cpu_seconds_per_unit());
+
+    UnitCounter d(num);
+    scheduler.run(num, [&](size_t first, size_t count) { d.add(first, count); sleep_us(2000); }, 2,
+        std::vector<GadgetronUnitScheduler::Work>(1, [&](size_t first, size_t count) { d.add(first, count); sleep_us(2000 + 200 * (int)count); }));
+    EXPECT_TRUE(d.all_once());
+    EXPECT_GT(scheduler.gpu_units(0), 2 * scheduler.cpu_units());
+
+    scheduler.reset_measurements();
+    EXPECT_EQ(0, scheduler.cpu_seconds_per_unit());
+    EXPECT_EQ(0, scheduler.gpu_seconds_per_unit(0));
+}
+
+TEST(GadgetronUnitScheduler, failedGpuLeftToCpu)
+{
+    const size_t num = 100;
+
+    GadgetronUnitScheduler::Work failing = [](size_t, size_t) { throw std::runtime_error("no device"); };
+
+    //Cpu and gpus together
+    {
+        UnitCounter c(num);
+        std::vector<GadgetronUnitScheduler::Work> gpus;
+        gpus.push_back([&](size_t first, size_t count) { c.add(first, count); sleep_us(100); });
+        gpus.push_back(failing);
+
+        GadgetronUnitScheduler scheduler;
+        scheduler.run(num, [&](size_t first, size_t count) { c.add(first, count); sleep_us(300); }, 2, gpus);
+
+        EXPECT_TRUE(c.all_once());
+        EXPECT_FALSE(scheduler.gpu_failed(0));
+        EXPECT_TRUE(scheduler.gpu_failed(1));
+        EXPECT_EQ(0u, scheduler.gpu_units(1));
+        EXPECT_EQ(num, scheduler.cpu_units() + scheduler.gpu_units(0));
+    }
+
+    //Gpu only, the cpu takes over what the gpu did not do
+    {
+        UnitCounter c(num);
+        std::atomic<int> calls(0);
+        GadgetronUnitScheduler::Work gpu = [&](size_t first, size_t count) {
+            if (calls.fetch_add(1) == 2) throw std::runtime_error("device lost");
+            c.add(first, count);
+        };
+
+        GadgetronUnitScheduler scheduler;
+        scheduler.run(num, [&](size_t first, size_t count) { c.add(first, count); }, 0, std::vector<GadgetronUnitScheduler::Work>(1, gpu));
+
+        EXPECT_TRUE(c.all_once());
+        EXPECT_TRUE(scheduler.gpu_failed(0));
+        EXPECT_GT(scheduler.gpu_units(0), 0u);
+        EXPECT_GT(scheduler.cpu_units(), 0u);
+        EXPECT_EQ(num, scheduler.cpu_units() + scheduler.gpu_units(0));
+    }
+}
+
+TEST(GadgetronUnitScheduler, cpuErrorThrown)
+{
+    GadgetronUnitScheduler::Work cpu = [](size_t first, size_t) { if (first == 5) throw std::runtime_error("unit failed"); };
+
+    GadgetronUnitScheduler scheduler;
+    EXPECT_THROW(scheduler.run(50, cpu, 2, std::vector<GadgetronUnitScheduler::Work>()), std::runtime_error);
+
+    //Also when the cpu takes over from a failed gpu
+    GadgetronUnitScheduler::Work failing = [](size_t, size_t) { throw std::runtime_error("no device"); };
+    GadgetronUnitScheduler::Work cpu_failing = [](size_t, size_t) { throw std::logic_error("unit failed"); };
+    EXPECT_THROW(scheduler.run(50, cpu_failing, 0, std::vector<GadgetronUnitScheduler::Work>(1, failing)), std::logic_error);
+    EXPECT_TRUE(scheduler.gpu_failed(0));
+}
@@ -0,0 +1,48 @@
+#include "hoNDArray.h"
+#include "NDArrayDimensions.h"
+
+#include <gtest/gtest.h>
+
+using namespace Gadgetron;
+
+TEST(NDArrayDimensions_test, inlineAndHeap)
+{
+    NDArrayDimensions d;
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(1u, d.product());
+
+    for (size_t i = 0; i < NDArrayDimensions::INLINE_CAPACITY + 3; i++) d.push_back(i + 1);
+    EXPECT_EQ(NDArrayDimensions::INLINE_CAPACITY + 3, d.size());
+    for (size_t i = 0; i < d.size(); i++) EXPECT_EQ(i + 1, d[i]);
+
+    NDArrayDimensions c(d);
+    EXPECT_TRUE(c == d);
+
+    std::vector<size_t> v = d;
+    EXPECT_TRUE(v == d);
+
+    c.resize(2);
+    EXPECT_EQ(2u, c.product());
+    EXPECT_TRUE(c != d);
+}
+
+TEST(NDArrayDimensions_test, arrays)
+{
+    hoNDArray<float> a(4, 3, 2);
+    EXPECT_EQ(3u, a.dimensions().size());
+    EXPECT_EQ(2u, a.dimensions()[2]);
+    EXPECT_EQ(12u, a.offset_factors()[2]);
+
+    hoNDArray<float> b(a);
+    EXPECT_TRUE(b.dimensions_equal(&a));
+
+    std::vector<size_t> dims(2);
+    dims[0] = 6; dims[1] = 4;
+    b.reshape(dims);
+    EXPECT_TRUE(b.dimensions() == dims);
+    EXPECT_EQ(6u, b.offset_factors()[1]);
+
+    std::vector<size_t>* p = 0;
+    b.get_dimensions(p);
+    EXPECT_TRUE(*p == dims);
+}
@@ -0,0 +1,30 @@
+/** \file   bench_util.h
+    \brief  Test data for the microbenchmarks.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+
+#include <complex>
+#include <random>
+
+namespace Gadgetron{ namespace bench{
+
+  /// Fills an array with reproducible uniform random values in [-1, 1)
+  template <typename T> void fill_random(hoNDArray<T>& a, unsigned int seed = 42)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<T> uni(-1, 1);
+    T* d = a.get_data_ptr();
+    for (size_t n = 0; n < a.get_number_of_elements(); n++) d[n] = uni(rng);
+  }
+
+  template <typename T> void fill_random(hoNDArray< std::complex<T> >& a, unsigned int seed = 42)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<T> uni(-1, 1);
+    std::complex<T>* d = a.get_data_ptr();
+    for (size_t n = 0; n < a.get_number_of_elements(); n++) d[n] = std::complex<T>(uni(rng), uni(rng));
+  }
+}}
@@ -0,0 +1,60 @@
+#include "gpu_bench_util.h"
+#include "cuCgSolver.h"
+#include "cuNFFTOperator.h"
+#include "radial_utilities.h"
+#include "vector_td_utilities.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef complext<float> cx;
+
+  // matrix, coils, iterations, mode (0 standard, 1 CUDA graphs, 2 mixed precision)
+  // Radial NFFT reconstruction with sqrt(dcw) weighting as in the standalone cg application
+  void BM_cuCgSolver_nfft(benchmark::State& state)
+  {
+    size_t matrix = state.range(0);
+    size_t coils = state.range(1);
+    size_t matrix_os = ((matrix * 3 / 2 + 31) / 32) * 32;
+    size_t samples_per_profile = 2 * matrix;
+    size_t profiles = matrix;
+
+    boost::shared_ptr< cuNDArray<floatd2> > traj = compute_radial_trajectory_golden_ratio_2d<float>(samples_per_profile, profiles, 1);
+    boost::shared_ptr< cuNDArray<float> > dcw = compute_radial_dcw_golden_ratio_2d<float>
+      (samples_per_profile, profiles, float(matrix_os) / matrix, float(matrix) / samples_per_profile);
+    sqrt_inplace(dcw.get());
+
+    boost::shared_ptr< cuNFFTOperator<float, 2> > E(new cuNFFTOperator<float, 2>());
+    E->setup(uint64d2(matrix, matrix), uint64d2(matrix_os, matrix_os), 5.5f);
+    E->set_dcw(dcw);
+
+    std::vector<size_t> image_dims = { matrix, matrix, coils };
+    E->set_domain_dimensions(&image_dims);
+    E->preprocess(traj.get());
+
+    cuNDArray<cx> data = bench::random_device_array<cx>({ samples_per_profile * profiles, coils });
+    std::vector<size_t> data_dims = *data.get_dimensions();
+    E->set_codomain_dimensions(&data_dims);
+
+    cuCgSolver<cx> cg;
+    cg.set_encoding_operator(E);
+    cg.set_max_iterations((unsigned int)state.range(2));
+    cg.set_tc_tolerance(0); // a fixed number of iterations
+    cg.set_output_mode(cuCgSolver<cx>::OUTPUT_SILENT);
+    cg.set_use_graphs(state.range(3) == 1);
+    cg.set_mixed_precision(state.range(3) == 2);
+
+    double seconds = bench::time_on_device(state, [&]() { benchmark::DoNotOptimize(cg.solve(&data)); });
+    if (state.iterations() > 0) {
+      state.counters["ms_per_cg_iteration"] = seconds * 1e3 / (double(state.iterations()) * state.range(2));
+    }
+  }
+  BENCHMARK(BM_cuCgSolver_nfft)
+    ->ArgNames({ "matrix", "coils", "iterations", "mode" })
+    ->ArgsProduct({ { 128, 192, 256 }, { 1, 8 }, { 10 }, { 0, 1, 2 } })
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,63 @@
+#include "gpu_bench_util.h"
+#include "cuNDArray_blas.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef complext<float> cx;
+
+  // number of elements, the cuBLAS wrappers on vectors of the sizes the solvers work on
+  void BM_cuNDArray_dot(benchmark::State& state)
+  {
+    cuNDArray<cx> x = bench::random_device_array<cx>({ (size_t)state.range(0) }, 1);
+    cuNDArray<cx> y = bench::random_device_array<cx>({ (size_t)state.range(0) }, 2);
+    bench::time_on_device(state, [&]() { benchmark::DoNotOptimize(dot(&x, &y)); });
+    state.SetBytesProcessed(int64_t(state.iterations()) * 2 * state.range(0) * sizeof(cx));
+  }
+
+  void BM_cuNDArray_axpy(benchmark::State& state)
+  {
+    cuNDArray<cx> x = bench::random_device_array<cx>({ (size_t)state.range(0) }, 1);
+    cuNDArray<cx> y = bench::random_device_array<cx>({ (size_t)state.range(0) }, 2);
+    bench::time_on_device(state, [&]() { axpy(cx(0.5f, 0.0f), &x, &y); });
+    state.SetBytesProcessed(int64_t(state.iterations()) * 3 * state.range(0) * sizeof(cx));
+  }
+
+  void BM_cuNDArray_nrm2(benchmark::State& state)
+  {
+    cuNDArray<cx> x = bench::random_device_array<cx>({ (size_t)state.range(0) });
+    bench::time_on_device(state, [&]() { benchmark::DoNotOptimize(nrm2(&x)); });
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0) * sizeof(cx));
+  }
+
+  void BM_cuNDArray_asum(benchmark::State& state)
+  {
+    cuNDArray<cx> x = bench::random_device_array<cx>({ (size_t)state.range(0) });
+    bench::time_on_device(state, [&]() { benchmark::DoNotOptimize(asum(&x)); });
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0) * sizeof(cx));
+  }
+
+  void BM_cuNDArray_amax(benchmark::State& state)
+  {
+    cuNDArray<cx> x = bench::random_device_array<cx>({ (size_t)state.range(0) });
+    bench::time_on_device(state, [&]() { benchmark::DoNotOptimize(amax(&x)); });
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0) * sizeof(cx));
+  }
+
+  void blas_sweep(benchmark::internal::Benchmark* b)
+  {
+    b->ArgNames({ "N" });
+    b->RangeMultiplier(4)->Range(1 << 14, 1 << 26);
+    b->UseManualTime();
+    b->Unit(benchmark::kMicrosecond);
+  }
+
+  BENCHMARK(BM_cuNDArray_dot)->Apply(blas_sweep);
+  BENCHMARK(BM_cuNDArray_axpy)->Apply(blas_sweep);
+  BENCHMARK(BM_cuNDArray_nrm2)->Apply(blas_sweep);
+  BENCHMARK(BM_cuNDArray_asum)->Apply(blas_sweep);
+  BENCHMARK(BM_cuNDArray_amax)->Apply(blas_sweep);
+}
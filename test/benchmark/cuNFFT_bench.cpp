@@ -0,0 +1,139 @@
+#include "gpu_bench_util.h"
+#include "cuNFFT.h"
+#include "cuNDFFT.h"
+#include "radial_utilities.h"
+#include "vector_td_utilities.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef complext<float> cx;
+
+  // Oversampled matrix for an oversampling factor in percent, rounded up to a multiple of the warp size
+  size_t oversampled(size_t matrix, int64_t percent)
+  {
+    size_t os = (matrix * percent + 99) / 100;
+    return ((os + 31) / 32) * 32;
+  }
+
+  // matrix, coils, oversampling [%], kernel width [1/10], golden angle radial with 2x readout oversampling
+  template <bool ATOMICS> struct RadialGpuPlan
+  {
+    RadialGpuPlan(benchmark::State& state)
+      : matrix(state.range(0))
+      , coils(state.range(1))
+      , matrix_os(oversampled(matrix, state.range(2)))
+      , samples_per_profile(2 * matrix)
+      , profiles(matrix)
+    {
+      plan.setup(uint64d2(matrix, matrix), uint64d2(matrix_os, matrix_os), state.range(3) / 10.0f);
+      traj = compute_radial_trajectory_golden_ratio_2d<float>(samples_per_profile, profiles, 1);
+      plan.preprocess(traj.get(), cuNFFT_plan<float, 2, ATOMICS>::NFFT_PREP_ALL);
+
+      image = bench::random_device_array<cx>({ matrix, matrix, coils }, 1);
+      grid = bench::random_device_array<cx>({ matrix_os, matrix_os, coils }, 2);
+      data = bench::random_device_array<cx>({ samples_per_profile * profiles, coils }, 3);
+
+      state.counters["matrix_os"] = (double)matrix_os;
+    }
+
+    size_t matrix, coils, matrix_os, samples_per_profile, profiles;
+    cuNFFT_plan<float, 2, ATOMICS> plan;
+    boost::shared_ptr< cuNDArray<floatd2> > traj;
+    cuNDArray<cx> image, grid, data;
+  };
+
+  template <bool ATOMICS> void BM_cuNFFT_forward(benchmark::State& state)
+  {
+    RadialGpuPlan<ATOMICS> p(state);
+    bench::time_on_device(state, [&]() {
+      p.plan.compute(&p.image, &p.data, 0, cuNFFT_plan<float, 2, ATOMICS>::NFFT_FORWARDS_C2NC);
+    });
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+
+  template <bool ATOMICS> void BM_cuNFFT_adjoint(benchmark::State& state)
+  {
+    RadialGpuPlan<ATOMICS> p(state);
+    bench::time_on_device(state, [&]() {
+      p.plan.compute(&p.data, &p.image, 0, cuNFFT_plan<float, 2, ATOMICS>::NFFT_BACKWARDS_NC2C);
+    });
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+
+  // The convolution kernels alone, this is where the atomic and the sorting variant differ
+  template <bool ATOMICS> void BM_cuNFFT_convolve_C2NC(benchmark::State& state)
+  {
+    RadialGpuPlan<ATOMICS> p(state);
+    bench::time_on_device(state, [&]() {
+      p.plan.convolve(&p.grid, &p.data, 0, cuNFFT_plan<float, 2, ATOMICS>::NFFT_CONV_C2NC);
+    });
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+
+  template <bool ATOMICS> void BM_cuNFFT_convolve_NC2C(benchmark::State& state)
+  {
+    RadialGpuPlan<ATOMICS> p(state);
+    bench::time_on_device(state, [&]() {
+      p.plan.convolve(&p.data, &p.grid, 0, cuNFFT_plan<float, 2, ATOMICS>::NFFT_CONV_NC2C);
+    });
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+
+  // The preprocessing is paid once per trajectory, for real-time trajectories once per frame
+  template <bool ATOMICS> void BM_cuNFFT_preprocess(benchmark::State& state)
+  {
+    RadialGpuPlan<ATOMICS> p(state);
+    bench::time_on_device(state, [&]() {
+      p.plan.preprocess(p.traj.get(), cuNFFT_plan<float, 2, ATOMICS>::NFFT_PREP_ALL);
+    });
+  }
+
+  void nfft_sweep(benchmark::internal::Benchmark* b)
+  {
+    b->ArgNames({ "matrix", "coils", "os", "W" });
+    b->ArgsProduct({ { 128, 256, 384 }, { 1, 8, 32 }, { 125, 150, 200 }, { 30, 55, 70 } });
+    b->UseManualTime();
+    b->Unit(benchmark::kMillisecond);
+  }
+
+  BENCHMARK_TEMPLATE(BM_cuNFFT_forward, false)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_forward, true)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_adjoint, false)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_adjoint, true)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_convolve_C2NC, false)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_convolve_C2NC, true)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_convolve_NC2C, false)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_convolve_NC2C, true)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_preprocess, false)->Apply(nfft_sweep);
+  BENCHMARK_TEMPLATE(BM_cuNFFT_preprocess, true)->Apply(nfft_sweep);
+
+  // RO E1 CHA, in place over the first two dimensions
+  void BM_cuNDFFT_fft2(benchmark::State& state)
+  {
+    cuNDArray<cx> a = bench::random_device_array<cx>({ (size_t)state.range(0), (size_t)state.range(1), (size_t)state.range(2) });
+    bench::time_on_device(state, [&]() { cuNDFFT<float>::instance()->fft2(&a); });
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(2));
+  }
+  BENCHMARK(BM_cuNDFFT_fft2)
+    ->ArgNames({ "RO", "E1", "CHA" })
+    ->ArgsProduct({ { 128, 256, 512 }, { 128, 256, 512 }, { 1, 8, 32 } })
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+  // RO E1 E2, in place
+  void BM_cuNDFFT_fft3(benchmark::State& state)
+  {
+    cuNDArray<cx> a = bench::random_device_array<cx>({ (size_t)state.range(0), (size_t)state.range(1), (size_t)state.range(2) });
+    bench::time_on_device(state, [&]() { cuNDFFT<float>::instance()->fft3(&a); });
+  }
+  BENCHMARK(BM_cuNDFFT_fft3)
+    ->Args({ 128, 128, 128 })
+    ->Args({ 256, 256, 128 })
+    ->Args({ 256, 256, 256 })
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,24 @@
+#include <benchmark/benchmark.h>
+#include <cuda_runtime_api.h>
+
+#include <sstream>
+
+// The results are only comparable on the same GPU model, so the device goes into the context of the report
+int main(int argc, char** argv)
+{
+  int device = 0;
+  cudaDeviceProp prop;
+  if (cudaGetDevice(&device) == cudaSuccess && cudaGetDeviceProperties(&prop, device) == cudaSuccess) {
+    std::stringstream cc;
+    cc << prop.major << "." << prop.minor;
+    benchmark::AddCustomContext("gpu_name", prop.name);
+    benchmark::AddCustomContext("gpu_compute_capability", cc.str());
+    benchmark::AddCustomContext("gpu_memory_mb", std::to_string(prop.totalGlobalMem >> 20));
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
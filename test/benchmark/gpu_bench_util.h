@@ -0,0 +1,82 @@
+/** \file   gpu_bench_util.h
+    \brief  Device timing and test data for the GPU microbenchmarks.
+
+            The GPU benchmarks use manual timing: every iteration is timed with a pair of CUDA events
+            on the default stream and reported with SetIterationTime, so the numbers are the time the
+            device spent on the kernels, not the time the host spent launching them.
+*/
+
+#pragma once
+
+#include "bench_util.h"
+#include "cuNDArray.h"
+#include "complext.h"
+
+#include <benchmark/benchmark.h>
+#include <cuda_runtime_api.h>
+#include <vector>
+
+namespace Gadgetron{ namespace bench{
+
+  class CudaEventTimer
+  {
+  public:
+    CudaEventTimer()
+    {
+      cudaEventCreate(&start_);
+      cudaEventCreate(&stop_);
+    }
+
+    ~CudaEventTimer()
+    {
+      cudaEventDestroy(start_);
+      cudaEventDestroy(stop_);
+    }
+
+    void start() { cudaEventRecord(start_, 0); }
+
+    /// Seconds between start() and now on the device, waits for the device
+    double stop()
+    {
+      float ms = 0;
+      cudaEventRecord(stop_, 0);
+      cudaEventSynchronize(stop_);
+      cudaEventElapsedTime(&ms, start_, stop_);
+      return ms * 1e-3;
+    }
+
+  protected:
+    cudaEvent_t start_;
+    cudaEvent_t stop_;
+  };
+
+  /// Runs f once per iteration of the benchmark and reports the device time of each run, returns the total in seconds
+  template <typename F> double time_on_device(benchmark::State& state, F f)
+  {
+    f(); // first call pays for plans and caches
+    cudaDeviceSynchronize();
+
+    CudaEventTimer timer;
+    double total = 0;
+    for (auto _ : state) {
+      timer.start();
+      f();
+      double t = timer.stop();
+      state.SetIterationTime(t);
+      total += t;
+    }
+    return total;
+  }
+
+  /// Device array with reproducible uniform random values in [-1, 1)
+  template <typename T> cuNDArray<T> random_device_array(std::vector<size_t> dims, unsigned int seed = 42)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    cuNDArray<T> d(dims);
+    hoNDArray<REAL> h(d.get_number_of_elements() * sizeof(T) / sizeof(REAL));
+    fill_random(h, seed);
+    cudaMemcpy(d.get_data_ptr(), h.get_data_ptr(), h.get_number_of_elements() * sizeof(REAL), cudaMemcpyHostToDevice);
+    return d;
+  }
+}}
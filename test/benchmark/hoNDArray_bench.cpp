@@ -0,0 +1,109 @@
+#include "bench_util.h"
+#include "hoNDArray_elemwise.h"
+#include "hoNDArray_reductions.h"
+#include "hoNDArray_utils.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef std::complex<float> cx;
+
+  // One 2D image series with 32 channels
+  const size_t RO = 256, E1 = 256, CHA = 32;
+
+  void set_bytes(benchmark::State& state, size_t bytes_per_iteration)
+  {
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes_per_iteration));
+  }
+
+  void BM_hoNDArray_add(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA), y(RO, E1, CHA), r(RO, E1, CHA);
+    bench::fill_random(x, 1);
+    bench::fill_random(y, 2);
+    for (auto _ : state) {
+      Gadgetron::add(x, y, r);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    set_bytes(state, 3 * x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_add)->Unit(benchmark::kMicrosecond);
+
+  void BM_hoNDArray_multiply(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA), y(RO, E1, CHA), r(RO, E1, CHA);
+    bench::fill_random(x, 1);
+    bench::fill_random(y, 2);
+    for (auto _ : state) {
+      Gadgetron::multiply(x, y, r);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    set_bytes(state, 3 * x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_multiply)->Unit(benchmark::kMicrosecond);
+
+  void BM_hoNDArray_abs(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA);
+    hoNDArray<float> r(RO, E1, CHA);
+    bench::fill_random(x);
+    for (auto _ : state) {
+      Gadgetron::abs(x, r);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    set_bytes(state, x.get_number_of_bytes() + r.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_abs)->Unit(benchmark::kMicrosecond);
+
+  void BM_hoNDArray_norm2(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA);
+    bench::fill_random(x);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(Gadgetron::norm2(x));
+    }
+    set_bytes(state, x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_norm2)->Unit(benchmark::kMicrosecond);
+
+  void BM_hoNDArray_dotc(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA), y(RO, E1, CHA);
+    bench::fill_random(x, 1);
+    bench::fill_random(y, 2);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(Gadgetron::dotc(x, y));
+    }
+    set_bytes(state, 2 * x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_dotc)->Unit(benchmark::kMicrosecond);
+
+  void BM_hoNDArray_sum_over_channels(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA), r;
+    bench::fill_random(x);
+    for (auto _ : state) {
+      Gadgetron::sum_over_dimension(x, r, 2);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    set_bytes(state, x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_sum_over_channels)->Unit(benchmark::kMicrosecond);
+
+  // RO E1 CHA -> CHA RO E1, as done before channel combination
+  void BM_hoNDArray_permute(benchmark::State& state)
+  {
+    hoNDArray<cx> x(RO, E1, CHA), r(CHA, RO, E1);
+    bench::fill_random(x);
+    std::vector<size_t> order = { 2, 0, 1 };
+    for (auto _ : state) {
+      Gadgetron::permute(&x, &r, &order);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    set_bytes(state, 2 * x.get_number_of_bytes());
+  }
+  BENCHMARK(BM_hoNDArray_permute)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,66 @@
+#include "bench_util.h"
+#include "hoNDFFT.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef std::complex<float> cx;
+
+  // RO E1 CHA, in place: cine and real time 2D, readout oversampled
+  void BM_hoNDFFT_fft2c(benchmark::State& state)
+  {
+    hoNDArray<cx> a(state.range(0), state.range(1), state.range(2));
+    bench::fill_random(a);
+    hoNDFFT<float>::instance()->fft2c(a); // plan creation is not timed
+
+    for (auto _ : state) {
+      hoNDFFT<float>::instance()->fft2c(a);
+      benchmark::DoNotOptimize(a.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(2));
+  }
+  BENCHMARK(BM_hoNDFFT_fft2c)
+    ->Args({ 256, 192, 32 })
+    ->Args({ 384, 256, 32 })
+    ->Args({ 512, 512, 16 })
+    ->Unit(benchmark::kMillisecond);
+
+  // RO E1 E2 CHA, in place: 3D volumes
+  void BM_hoNDFFT_fft3c(benchmark::State& state)
+  {
+    hoNDArray<cx> a(state.range(0), state.range(1), state.range(2), state.range(3));
+    bench::fill_random(a);
+    hoNDFFT<float>::instance()->fft3c(a);
+
+    for (auto _ : state) {
+      hoNDFFT<float>::instance()->fft3c(a);
+      benchmark::DoNotOptimize(a.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(3));
+  }
+  BENCHMARK(BM_hoNDFFT_fft3c)
+    ->Args({ 192, 192, 128, 1 })
+    ->Args({ 256, 256, 64, 8 })
+    ->Args({ 256, 224, 176, 1 })
+    ->Unit(benchmark::kMillisecond);
+
+  // Out of place with a caller provided buffer, as the recon gadgets call it
+  void BM_hoNDFFT_ifft2c_buffered(benchmark::State& state)
+  {
+    hoNDArray<cx> a(state.range(0), state.range(1), state.range(2)), r, buf;
+    bench::fill_random(a);
+    hoNDFFT<float>::instance()->ifft2c(a, r, buf);
+
+    for (auto _ : state) {
+      hoNDFFT<float>::instance()->ifft2c(a, r, buf);
+      benchmark::DoNotOptimize(r.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(2));
+  }
+  BENCHMARK(BM_hoNDFFT_ifft2c_buffered)
+    ->Args({ 384, 256, 32 })
+    ->Unit(benchmark::kMillisecond);
+}
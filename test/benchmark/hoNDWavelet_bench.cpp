@@ -0,0 +1,44 @@
+#include "bench_util.h"
+#include "hoNDHarrWavelet.h"
+#include "hoNDRedundantWavelet.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef std::complex<float> cx;
+
+  // Forward and inverse transform of RO E1 N, as in the compressed sensing recons: wavelet dimension, level
+  void BM_hoNDHarrWavelet(benchmark::State& state)
+  {
+    size_t dim = state.range(0), level = state.range(1);
+    hoNDArray<cx> a(256, 192, 32), r, rr;
+    bench::fill_random(a);
+    Gadgetron::hoNDHarrWavelet<cx> wav;
+
+    for (auto _ : state) {
+      wav.transform(a, r, dim, level, true);
+      wav.transform(r, rr, dim, level, false);
+      benchmark::DoNotOptimize(rr.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_hoNDHarrWavelet)->Args({ 2, 1 })->Args({ 3, 1 })->Args({ 2, 3 })->Unit(benchmark::kMillisecond);
+
+  void BM_hoNDRedundantWavelet_db2(benchmark::State& state)
+  {
+    size_t dim = state.range(0), level = state.range(1);
+    hoNDArray<cx> a(256, 192, 32), r, rr;
+    bench::fill_random(a);
+    Gadgetron::hoNDRedundantWavelet<cx> wav;
+    wav.compute_wavelet_filter("db2");
+
+    for (auto _ : state) {
+      wav.transform(a, r, dim, level, true);
+      wav.transform(r, rr, dim, level, false);
+      benchmark::DoNotOptimize(rr.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_hoNDRedundantWavelet_db2)->Args({ 2, 1 })->Args({ 3, 1 })->Unit(benchmark::kMillisecond);
+}
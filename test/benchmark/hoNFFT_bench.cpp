@@ -0,0 +1,78 @@
+#include "bench_util.h"
+#include "hoNFFT.h"
+#include "vector_td_utilities.h"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef std::complex<float> cx;
+
+  // Golden angle radial trajectory in [-0.5, 0.5)
+  void radial_trajectory(size_t samples, size_t spokes, hoNDArray< vector_td<float, 2> >& traj)
+  {
+    traj.create(samples * spokes);
+    const float golden = 111.246117975f * 3.14159265358979f / 180.0f;
+    for (size_t s = 0; s < spokes; s++) {
+      float c = std::cos(s * golden), sn = std::sin(s * golden);
+      for (size_t n = 0; n < samples; n++) {
+        float k = (float(n) / samples) - 0.5f;
+        traj(s * samples + n)[0] = k * c;
+        traj(s * samples + n)[1] = k * sn;
+      }
+    }
+  }
+
+  struct RadialPlan
+  {
+    RadialPlan(size_t matrix, size_t spokes, hoNFFT_plan<float, 2>::NFFT_prep_mode mode)
+      : plan(vector_td<size_t, 2>(matrix, matrix), 2.0f, 3.0f)
+    {
+      hoNDArray< vector_td<float, 2> > traj;
+      radial_trajectory(2 * matrix, spokes, traj);
+      plan.preprocess(traj, mode);
+
+      data.create(2 * matrix * spokes);
+      image.create(2 * matrix, 2 * matrix);
+      bench::fill_random(data, 1);
+      bench::fill_random(image, 2);
+    }
+
+    hoNFFT_plan<float, 2> plan;
+    hoNDArray<cx> data;
+    hoNDArray<cx> image;
+    hoNDArray<float> weights;
+  };
+
+  // matrix, spokes, preprocessing mode
+  void BM_hoNFFT_forward(benchmark::State& state)
+  {
+    RadialPlan p(state.range(0), state.range(1), (hoNFFT_plan<float, 2>::NFFT_prep_mode)state.range(2));
+    for (auto _ : state) {
+      p.plan.compute(p.image, p.data, p.weights, hoNFFT_plan<float, 2>::NFFT_FORWARDS_C2NC);
+      benchmark::DoNotOptimize(p.data.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+  BENCHMARK(BM_hoNFFT_forward)
+    ->Args({ 256, 128, hoNFFT_plan<float, 2>::NFFT_PREP_CONVOLVE })
+    ->Args({ 256, 128, hoNFFT_plan<float, 2>::NFFT_PREP_SPARSE_MATRIX })
+    ->Unit(benchmark::kMillisecond);
+
+  void BM_hoNFFT_adjoint(benchmark::State& state)
+  {
+    RadialPlan p(state.range(0), state.range(1), (hoNFFT_plan<float, 2>::NFFT_prep_mode)state.range(2));
+    for (auto _ : state) {
+      p.plan.compute(p.data, p.image, p.weights, hoNFFT_plan<float, 2>::NFFT_BACKWARDS_NC2C);
+      benchmark::DoNotOptimize(p.image.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * p.data.get_number_of_elements());
+  }
+  BENCHMARK(BM_hoNFFT_adjoint)
+    ->Args({ 256, 128, hoNFFT_plan<float, 2>::NFFT_PREP_CONVOLVE })
+    ->Args({ 256, 128, hoNFFT_plan<float, 2>::NFFT_PREP_SPARSE_MATRIX })
+    ->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,100 @@
+#include "bench_util.h"
+#include "mri_core_grappa.h"
+#include "mri_core_coil_map_estimation.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace Gadgetron;
+
+namespace {
+
+  typedef std::complex<float> cx;
+
+  // 2D GRAPPA R=2..4, 24 reference lines, 32 channels, 5x4 kernel
+  const size_t RO = 256, E1 = 192, CHA = 32, ACS = 24, KRO = 5, KNE1 = 4;
+  const double THRES = 5e-4;
+
+  void BM_grappa2d_calibration(benchmark::State& state)
+  {
+    size_t accel = state.range(0);
+    hoNDArray<cx> acs(RO, ACS, CHA), convKer;
+    bench::fill_random(acs);
+
+    for (auto _ : state) {
+      Gadgetron::grappa2d_calib_convolution_kernel(acs, acs, accel, THRES, KRO, KNE1, convKer);
+      benchmark::DoNotOptimize(convKer.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_grappa2d_calibration)->Arg(2)->Arg(3)->Arg(4)->Unit(benchmark::kMillisecond);
+
+  void BM_grappa2d_image_domain_kernel(benchmark::State& state)
+  {
+    size_t accel = state.range(0);
+    hoNDArray<cx> acs(RO, ACS, CHA), convKer, kIm;
+    bench::fill_random(acs);
+    Gadgetron::grappa2d_calib_convolution_kernel(acs, acs, accel, THRES, KRO, KNE1, convKer);
+
+    for (auto _ : state) {
+      Gadgetron::grappa2d_image_domain_kernel(convKer, RO, E1, kIm);
+      benchmark::DoNotOptimize(kIm.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_grappa2d_image_domain_kernel)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond);
+
+  // Image domain unwrapping of 16 frames with a fixed kernel
+  void BM_grappa2d_unwrapping(benchmark::State& state)
+  {
+    size_t accel = state.range(0);
+    const size_t N = 16;
+    hoNDArray<cx> acs(RO, ACS, CHA), convKer, kIm, complexIm;
+    bench::fill_random(acs);
+    Gadgetron::grappa2d_calib_convolution_kernel(acs, acs, accel, THRES, KRO, KNE1, convKer);
+    Gadgetron::grappa2d_image_domain_kernel(convKer, RO, E1, kIm);
+
+    hoNDArray<cx> kspace(RO, E1, CHA, N);
+    bench::fill_random(kspace, 2);
+
+    for (auto _ : state) {
+      Gadgetron::grappa2d_image_domain_unwrapping(kspace, kIm, complexIm);
+      benchmark::DoNotOptimize(complexIm.get_data_ptr());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+  }
+  BENCHMARK(BM_grappa2d_unwrapping)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond);
+
+  void BM_coil_map_2d_Inati(benchmark::State& state)
+  {
+    hoNDArray<cx> data(RO, E1, state.range(0)), coilMap;
+    bench::fill_random(data);
+
+    for (auto _ : state) {
+      Gadgetron::coil_map_2d_Inati(data, coilMap, 7, 3);
+      benchmark::DoNotOptimize(coilMap.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_coil_map_2d_Inati)->Arg(16)->Arg(32)->Unit(benchmark::kMillisecond);
+
+  void BM_coil_map_3d_Inati(benchmark::State& state)
+  {
+    hoNDArray<cx> data(128, 128, 64, state.range(0)), coilMap;
+    bench::fill_random(data);
+
+    for (auto _ : state) {
+      Gadgetron::coil_map_3d_Inati(data, coilMap, 7, 5, 3);
+      benchmark::DoNotOptimize(coilMap.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_coil_map_3d_Inati)->Arg(16)->Unit(benchmark::kMillisecond);
+
+  void BM_coil_map_2d_Inati_Iter(benchmark::State& state)
+  {
+    hoNDArray<cx> data(RO, E1, state.range(0)), coilMap;
+    bench::fill_random(data);
+
+    for (auto _ : state) {
+      Gadgetron::coil_map_2d_Inati_Iter(data, coilMap, 7, 5, 1e-3f);
+      benchmark::DoNotOptimize(coilMap.get_data_ptr());
+    }
+  }
+  BENCHMARK(BM_coil_map_2d_Inati_Iter)->Arg(32)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,42 @@
+#include "bench_util.h"
+#include "cmr_motion_correction.h"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+using namespace Gadgetron;
+
+namespace {
+
+  // Frames of a smooth blob that moves by a few pixels, registered to the first frame
+  void moving_blob(size_t RO, size_t E1, size_t N, hoNDArray<float>& frames)
+  {
+    frames.create(RO, E1, N);
+    for (size_t n = 0; n < N; n++) {
+      float cx = RO / 2.0f + 3.0f * std::sin(n * 0.7f), cy = E1 / 2.0f + 2.0f * std::cos(n * 0.7f);
+      for (size_t e1 = 0; e1 < E1; e1++) {
+        for (size_t ro = 0; ro < RO; ro++) {
+          float d2 = (ro - cx) * (ro - cx) + (e1 - cy) * (e1 - cy);
+          frames(ro, e1, n) = 100.0f * std::exp(-d2 / (2.0f * 20.0f * 20.0f)) + 10.0f;
+        }
+      }
+    }
+  }
+
+  // Non rigid, deformation field registration as used by the cardiac motion correction: frames
+  void BM_registration_moco_2DT(benchmark::State& state)
+  {
+    hoNDArray<float> frames;
+    moving_blob(192, 144, state.range(0), frames);
+
+    std::vector<unsigned int> iters = { 32, 64, 100 };
+
+    for (auto _ : state) {
+      Gadgetron::hoImageRegContainer2DRegistration< hoNDImage<float, 2>, hoNDImage<float, 2>, float > reg;
+      Gadgetron::perform_moco_fixed_key_frame_2DT(frames, 0, 12.0f, iters, false, false, reg);
+      benchmark::DoNotOptimize(&reg);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+  }
+  BENCHMARK(BM_registration_moco_2DT)->Arg(8)->Arg(30)->Unit(benchmark::kMillisecond);
+}
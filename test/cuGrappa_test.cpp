@@ -0,0 +1,149 @@
+#include "cuGrappa.h"
+#include "mri_core_grappa.h"
+#include "hoNDArray_elemwise.h"
+#include "hoNDArray_reductions.h"
+#include "hoNDFFT.h"
+#include "complext.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+namespace
+{
+    // fully sampled kspace [RO E1 CHA] of a smooth object seen by smooth coils
+    void make_kspace(size_t RO, size_t E1, size_t CHA, hoNDArray<T>& kspace, hoNDArray<T>& coilMap)
+    {
+        hoNDArray<T> im(RO, E1, CHA);
+        coilMap.create(RO, E1, CHA);
+
+        for (size_t e1 = 0; e1 < E1; e1++)
+        {
+            for (size_t ro = 0; ro < RO; ro++)
+            {
+                float x = (float)ro / RO - 0.5f;
+                float y = (float)e1 / E1 - 0.5f;
+                T rho = std::polar(1.0f + std::cos(9.0f*x)*std::sin(7.0f*y), 2.0f*x*y);
+
+                float sos = 0;
+                for (size_t c = 0; c < CHA; c++)
+                {
+                    float a = 6.2831853f * c / CHA;
+                    float dx = x - 0.4f*std::cos(a);
+                    float dy = y - 0.4f*std::sin(a);
+                    coilMap(ro, e1, c) = std::polar(std::exp(-2.0f*(dx*dx + dy*dy)), a + 1.5f*dy);
+                    sos += std::norm(coilMap(ro, e1, c));
+                }
+
+                for (size_t c = 0; c < CHA; c++)
+                {
+                    coilMap(ro, e1, c) /= std::sqrt(sos);
+                    im(ro, e1, c) = rho * coilMap(ro, e1, c);
+                }
+            }
+        }
+
+        hoNDFFT<float>::instance()->fft2c(im, kspace);
+    }
+
+    float relative_difference(hoNDArray<T>& a, hoNDArray<T>& b)
+    {
+        hoNDArray<T> d(a);
+        Gadgetron::subtract(a, b, d);
+        return Gadgetron::nrm2(&d) / Gadgetron::nrm2(&a);
+    }
+
+    // the gpu calibration and unwrapping against the cpu functions on the same calibration data
+    // (RO/2 + E1/2) odd for 64 x 62, which needs the sign correction of the centred transforms
+    void compare_cpu_gpu(size_t RO, size_t E1)
+    {
+        const size_t CHA = 6;
+        const size_t R = 2;
+        const size_t kRO = 5;
+        const size_t kNE1 = 4;
+        const double thres = 5e-4;
+        const size_t ref_E1 = 24;
+
+        hoNDArray<T> kspace, coilMap;
+        make_kspace(RO, E1, CHA, kspace, coilMap);
+
+        hoNDArray<T> acs(RO, ref_E1, CHA);
+        for (size_t c = 0; c < CHA; c++)
+            for (size_t e1 = 0; e1 < ref_E1; e1++)
+                for (size_t ro = 0; ro < RO; ro++)
+                    acs(ro, e1, c) = kspace(ro, e1 + (E1 - ref_E1) / 2, c);
+
+        hoNDArray<T> undersampled(kspace);
+        for (size_t c = 0; c < CHA; c++)
+            for (size_t e1 = 0; e1 < E1; e1++)
+                if (e1 % R != 0)
+                    for (size_t ro = 0; ro < RO; ro++) undersampled(ro, e1, c) = T(0);
+
+        std::vector<int> kE1, oE1;
+        size_t convKRO, convKE1;
+        Gadgetron::grappa2d_kerPattern(kE1, oE1, convKRO, convKE1, R, kRO, kNE1, true);
+
+        // cpu
+        hoNDArray<T> convKer, kIm, unmixCpu;
+        hoNDArray<float> gFactorCpu;
+        Gadgetron::grappa2d_calib_convolution_kernel(acs, acs, R, thres, kRO, kNE1, convKer);
+        kIm.create(RO, E1, CHA, CHA);
+        Gadgetron::grappa2d_image_domain_kernel(convKer, RO, E1, kIm);
+        unmixCpu.create(RO, E1, CHA);
+        gFactorCpu.create(RO, E1);
+        Gadgetron::grappa2d_unmixing_coeff(kIm, coilMap, R, unmixCpu, gFactorCpu);
+
+        hoNDArray<T> aliased, resCpu(RO, E1, 1);
+        hoNDFFT<float>::instance()->ifft2c(undersampled, aliased);
+        Gadgetron::apply_unmix_coeff_aliased_image(aliased, unmixCpu, resCpu);
+
+        // gpu, one unit
+        hoNDArray<T> convKerGpu(convKRO, convKE1, CHA, CHA, 1), unmixGpu(RO, E1, CHA, 1);
+        hoNDArray<float> gFactorGpu(RO, E1, 1);
+        hoNDArray<float_complext> acsC(RO, ref_E1, CHA, 1, reinterpret_cast<float_complext*>(acs.begin()));
+        hoNDArray<float_complext> coilMapC(RO, E1, CHA, 1, reinterpret_cast<float_complext*>(coilMap.begin()));
+        hoNDArray<float_complext> convKerC(convKRO, convKE1, CHA, CHA, 1, reinterpret_cast<float_complext*>(convKerGpu.begin()));
+        hoNDArray<float_complext> unmixC(RO, E1, CHA, 1, reinterpret_cast<float_complext*>(unmixGpu.begin()));
+        Gadgetron::cuGrappa2d_calib_unmixing_coeff(acsC, acsC, coilMapC, R, thres, kRO, kE1, oE1, convKerC, unmixC, gFactorGpu);
+
+        hoNDArray<T> resGpu(RO, E1, 1, 1, 1);
+        hoNDArray<float_complext> kspaceC(RO, E1, CHA, 1, 1, 1, reinterpret_cast<float_complext*>(undersampled.begin()));
+        hoNDArray<float_complext> resC(RO, E1, 1, 1, 1, reinterpret_cast<float_complext*>(resGpu.begin()));
+        Gadgetron::cuGrappa2d_image_domain_unwrapping(kspaceC, unmixC, 1.0f, resC);
+
+        hoNDArray<T> unmixGpu3D(RO, E1, CHA, unmixGpu.begin());
+        EXPECT_LT(relative_difference(unmixCpu, unmixGpu3D), 1e-3);
+
+        hoNDArray<float> gDiff(gFactorCpu);
+        hoNDArray<float> gFactorGpu2D(RO, E1, gFactorGpu.begin());
+        Gadgetron::subtract(gFactorCpu, gFactorGpu2D, gDiff);
+        EXPECT_LT(Gadgetron::nrm2(&gDiff) / Gadgetron::nrm2(&gFactorCpu), 1e-3);
+
+        hoNDArray<T> resGpu3D(RO, E1, 1, resGpu.begin());
+        EXPECT_LT(relative_difference(resCpu, resGpu3D), 1e-3);
+    }
+}
+
+TEST(cuGrappa_test, unmixingEvenHalfSizes)
+{
+    compare_cpu_gpu(64, 64);
+}
+
+TEST(cuGrappa_test, unmixingOddHalfSize)
+{
+    compare_cpu_gpu(64, 62);
+}
+
+TEST(cuGrappa_test, oddSizeThrows)
+{
+    std::vector<size_t> kDims{ 5, 7, 2, 2 };
+    std::vector<size_t> imDims{ 63, 64, 2, 2 };
+    cuNDArray<float_complext> convKer(kDims);
+    cuNDArray<float_complext> kIm(imDims);
+    EXPECT_ANY_THROW(Gadgetron::cuGrappa2d_image_domain_kernel(convKer, 63, 64, kIm));
+}
@@ -1,8 +1,10 @@
 #include "cuNDArray_blas.h"
 #include "cuNDArray_elemwise.h"
+#include "cudaDeviceManager.h"
 
 #include <gtest/gtest.h>
 #include <vector>
+#include <thread>
 
 using namespace Gadgetron;
 using testing::Types;
@@ -32,6 +34,25 @@ TYPED_TEST(cuNDArray_blas_Real,dotTest){
   EXPECT_FLOAT_EQ(this->Array.get_number_of_elements()*2,real(dot(&this->Array,&this->Array2)));
 }
 
+TYPED_TEST(cuNDArray_blas_Real,concurrentDotTest){
+  fill(&this->Array,TypeParam(1));
+  fill(&this->Array2,TypeParam(2));
+  int device = cudaDeviceManager::Instance()->getCurrentDevice();
+  std::vector<TypeParam> results(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++)
+    threads.push_back(std::thread([&,i](){
+      cudaSetDevice(device);
+      for (int k = 0; k < 16; k++)
+        results[i] = real(dot(&this->Array,&this->Array2));
+    }));
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  for (size_t i = 0; i < results.size(); i++)
+    EXPECT_FLOAT_EQ(this->Array.get_number_of_elements()*2,results[i]);
+  EXPECT_LE(cudaDeviceManager::Instance()->getNumberOfHandles(device),results.size()+1);
+}
+
 TYPED_TEST(cuNDArray_blas_Real,axpyTest){
   fill(&this->Array,TypeParam(71));
   fill(&this->Array2,TypeParam(97));
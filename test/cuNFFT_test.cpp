@@ -0,0 +1,119 @@
+#include "cuNFFT.h"
+#include "cuNDArray.h"
+#include "hoNDArray.h"
+#include "complext.h"
+#include "vector_td_utilities.h"
+
+#include <gtest/gtest.h>
+#include <boost/random.hpp>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace Gadgetron;
+
+namespace
+{
+    typedef std::complex<double> C;
+
+    const size_t N = 32;
+    const size_t NOS = 64;
+    const float W = 5.5f;
+    const size_t M = 400;
+
+    // least squares fit of NUDFT*a to the NFFT result, the plans scale and centre the transforms their own way;
+    // the relative residual is left
+    double fitted_residual(const std::vector<C>& nudft, const hoNDArray<float_complext>& nfft)
+    {
+        C num(0), den(0);
+        for (size_t i = 0; i < nudft.size(); i++)
+        {
+            C v(real(nfft[i]), imag(nfft[i]));
+            num += std::conj(nudft[i]) * v;
+            den += std::norm(nudft[i]);
+        }
+        C a = num / den;
+
+        double res = 0, ref = 0;
+        for (size_t i = 0; i < nudft.size(); i++)
+        {
+            C v(real(nfft[i]), imag(nfft[i]));
+            res += std::norm(v - a*nudft[i]);
+            ref += std::norm(v);
+        }
+        return std::sqrt(res / ref);
+    }
+
+    class cuNFFT_test : public ::testing::Test
+    {
+    protected:
+        virtual void SetUp()
+        {
+            boost::random::mt19937 rng;
+            boost::random::uniform_real_distribution<float> uni(-0.45f, 0.45f);
+            boost::random::uniform_real_distribution<float> val(-1.0f, 1.0f);
+
+            traj_ = hoNDArray<floatd2>(M);
+            for (size_t j = 0; j < M; j++) traj_[j] = floatd2(uni(rng), uni(rng));
+
+            image_ = hoNDArray<float_complext>(N, N);
+            for (size_t i = 0; i < N*N; i++) image_[i] = float_complext(val(rng), val(rng));
+
+            samples_ = hoNDArray<float_complext>(M);
+            for (size_t j = 0; j < M; j++) samples_[j] = float_complext(val(rng), val(rng));
+        }
+
+        // exp(-2 pi i k (x - N/2)), the phase of sample j at pixel (x, y)
+        C phase(size_t j, size_t x, size_t y) const
+        {
+            double p = -2.0*M_PI*(traj_[j][0]*(double(x) - N/2) + traj_[j][1]*(double(y) - N/2));
+            return C(std::cos(p), std::sin(p));
+        }
+
+        hoNDArray<floatd2> traj_;
+        hoNDArray<float_complext> image_;
+        hoNDArray<float_complext> samples_;
+    };
+}
+
+TEST_F(cuNFFT_test, forwardsMatchesNUDFT)
+{
+    std::vector<C> nudft(M, C(0));
+    for (size_t j = 0; j < M; j++)
+        for (size_t y = 0; y < N; y++)
+            for (size_t x = 0; x < N; x++)
+                nudft[j] += phase(j, x, y) * C(real(image_[x + y*N]), imag(image_[x + y*N]));
+
+    cuNFFT_plan<float, 2> plan(uint64d2(N, N), uint64d2(NOS, NOS), W);
+    cuNDArray<floatd2> traj(traj_);
+    plan.preprocess(&traj, cuNFFT_plan<float, 2>::NFFT_PREP_C2NC);
+
+    cuNDArray<float_complext> image(image_);
+    std::vector<size_t> dims(1, M);
+    cuNDArray<float_complext> samples(dims);
+    plan.compute(&image, &samples, 0, cuNFFT_plan<float, 2>::NFFT_FORWARDS_C2NC);
+
+    hoNDArray<float_complext> result = *samples.to_host();
+    EXPECT_LT(fitted_residual(nudft, result), 1e-3);
+}
+
+TEST_F(cuNFFT_test, adjointMatchesNUDFT)
+{
+    std::vector<C> nudft(N*N, C(0));
+    for (size_t y = 0; y < N; y++)
+        for (size_t x = 0; x < N; x++)
+            for (size_t j = 0; j < M; j++)
+                nudft[x + y*N] += std::conj(phase(j, x, y)) * C(real(samples_[j]), imag(samples_[j]));
+
+    cuNFFT_plan<float, 2> plan(uint64d2(N, N), uint64d2(NOS, NOS), W);
+    cuNDArray<floatd2> traj(traj_);
+    plan.preprocess(&traj, cuNFFT_plan<float, 2>::NFFT_PREP_NC2C);
+
+    cuNDArray<float_complext> samples(samples_);
+    std::vector<size_t> dims(2, N);
+    cuNDArray<float_complext> image(dims);
+    plan.compute(&samples, &image, 0, cuNFFT_plan<float, 2>::NFFT_BACKWARDS_NC2C);
+
+    hoNDArray<float_complext> result = *image.to_host();
+    EXPECT_LT(fitted_residual(nudft, result), 1e-3);
+}
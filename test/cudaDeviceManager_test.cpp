@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include "cudaDeviceManager.h"
+
+using namespace Gadgetron;
+
+TEST(cudaDeviceManager, scheduleDevice)
+{
+    cudaDeviceManager* dm = cudaDeviceManager::Instance();
+    int devices = dm->getTotalNumberOfDevice();
+
+    int stream_a, stream_b;
+    int a = dm->scheduleDevice(&stream_a);
+    ASSERT_GE(a, 0);
+    ASSERT_LT(a, devices);
+    EXPECT_EQ(1u, dm->getNumberOfScheduledKeys(a));
+
+    //A key stays on its device
+    EXPECT_EQ(a, dm->scheduleDevice(&stream_a));
+    EXPECT_EQ(1u, dm->getNumberOfScheduledKeys(a));
+
+    //A new key goes to another device if there is one
+    int b = dm->scheduleDevice(&stream_b);
+    if (devices > 1) EXPECT_NE(a, b);
+
+    dm->releaseDevice(&stream_b);
+    dm->releaseDevice(&stream_a);
+    EXPECT_EQ(1u, dm->getNumberOfScheduledKeys(a));
+    dm->releaseDevice(&stream_a);
+    EXPECT_EQ(0u, dm->getNumberOfScheduledKeys(a));
+    EXPECT_EQ(0u, dm->getNumberOfScheduledKeys(b));
+}
+
+TEST(cudaDeviceManager, selectDevice)
+{
+    cudaDeviceManager* dm = cudaDeviceManager::Instance();
+    int devices = dm->getTotalNumberOfDevice();
+
+    int stream;
+    {
+        cudaDeviceSelection fixed;
+        EXPECT_EQ(devices % devices, fixed.select(devices, &stream));
+        EXPECT_FALSE(fixed.scheduled());
+
+        cudaDeviceSelection any;
+        int d = any.select(-1, &stream);
+        EXPECT_TRUE(any.scheduled());
+        EXPECT_EQ(1u, dm->getNumberOfScheduledKeys(d));
+    }
+
+    //Released with the selection
+    for (int d = 0; d < devices; d++) EXPECT_EQ(0u, dm->getNumberOfScheduledKeys(d));
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "cuNDArray.h"
+#include "cudaMemoryCache.h"
+#include "cudaDeviceManager.h"
+#include "cuNDArray_elemwise.h"
+
+#include <complex>
+
+using namespace Gadgetron;
+
+TEST(cudaMemoryCache, binSize)
+{
+    EXPECT_EQ(512u, cudaMemoryCache::bin_size(1));
+    EXPECT_EQ(512u, cudaMemoryCache::bin_size(512));
+    EXPECT_EQ(1024u, cudaMemoryCache::bin_size(513));
+    EXPECT_EQ(size_t(1) << 20, cudaMemoryCache::bin_size(size_t(1) << 20));
+    EXPECT_EQ((size_t(1) << 20) + (size_t(128) << 10), cudaMemoryCache::bin_size((size_t(1) << 20) + 1));
+}
+
+TEST(cudaMemoryCache, reuse)
+{
+    int device = cudaDeviceManager::Instance()->getCurrentDevice();
+    cudaDeviceManager::Instance()->setMemoryCaching(true);
+    cudaDeviceManager::Instance()->releaseCachedMemory(device);
+
+    std::vector<size_t> dims(3);
+    dims[0] = 37; dims[1] = 49; dims[2] = 23;
+
+    float_complext* ptr = 0;
+    {
+        cuNDArray<float_complext> a(dims);
+        ptr = a.get_data_ptr();
+    }
+
+    cudaMemoryCache::Statistics s0 = cudaDeviceManager::Instance()->getMemoryCacheStatistics(device);
+    EXPECT_GE(s0.bytes_cached, 37*49*23*sizeof(float_complext));
+
+    {
+        cuNDArray<float_complext> b(dims);
+        EXPECT_EQ(ptr, b.get_data_ptr());
+
+        cudaMemoryCache::Statistics s1 = cudaDeviceManager::Instance()->getMemoryCacheStatistics(device);
+        EXPECT_EQ(s0.cache_hits + 1, s1.cache_hits);
+        EXPECT_EQ(s0.device_allocations, s1.device_allocations);
+    }
+
+    cudaDeviceManager::Instance()->releaseCachedMemory(device);
+    EXPECT_EQ(0u, cudaDeviceManager::Instance()->getMemoryCacheStatistics(device).bytes_cached);
+}
+
+TEST(cudaMemoryCache, disabled)
+{
+    int device = cudaDeviceManager::Instance()->getCurrentDevice();
+    cudaDeviceManager::Instance()->setMemoryCaching(false);
+
+    std::vector<size_t> dims(2);
+    dims[0] = 128; dims[1] = 128;
+    {
+        cuNDArray<float> a(dims);
+        fill(&a, 1.0f);
+    }
+    EXPECT_EQ(0u, cudaDeviceManager::Instance()->getMemoryCacheStatistics(device).bytes_cached);
+
+    cudaDeviceManager::Instance()->setMemoryCaching(true);
+}
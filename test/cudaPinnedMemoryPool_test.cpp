@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "hoCuNDArray.h"
+#include "cudaPinnedMemoryPool.h"
+#include "cudaDeviceManager.h"
+
+#include <complex>
+
+using namespace Gadgetron;
+
+TEST(cudaPinnedMemoryPool, binSize)
+{
+    EXPECT_EQ(4096u, cudaPinnedMemoryPool::bin_size(1));
+    EXPECT_EQ(4096u, cudaPinnedMemoryPool::bin_size(4096));
+    EXPECT_EQ(8192u, cudaPinnedMemoryPool::bin_size(4097));
+    EXPECT_EQ(size_t(1) << 20, cudaPinnedMemoryPool::bin_size(size_t(1) << 20));
+    EXPECT_EQ(size_t(2) << 20, cudaPinnedMemoryPool::bin_size((size_t(1) << 20) + 1));
+}
+
+TEST(cudaPinnedMemoryPool, reuse)
+{
+    cudaDeviceManager::Instance()->setPinnedMemoryPooling(true);
+    cudaDeviceManager::Instance()->releasePinnedMemory();
+
+    std::vector<size_t> dims(3);
+    dims[0] = 37; dims[1] = 49; dims[2] = 23;
+
+    std::complex<float>* ptr = 0;
+    {
+        hoCuNDArray< std::complex<float> > a(dims);
+        ptr = a.get_data_ptr();
+    }
+
+    cudaPinnedMemoryPool::Statistics s0 = cudaDeviceManager::Instance()->getPinnedMemoryPoolStatistics();
+    EXPECT_GE(s0.bytes_cached, 37*49*23*sizeof(std::complex<float>));
+
+    {
+        hoCuNDArray< std::complex<float> > b(dims);
+        EXPECT_EQ(ptr, b.get_data_ptr());
+
+        cudaPinnedMemoryPool::Statistics s1 = cudaDeviceManager::Instance()->getPinnedMemoryPoolStatistics();
+        EXPECT_EQ(s0.cache_hits + 1, s1.cache_hits);
+        EXPECT_EQ(s0.host_allocations, s1.host_allocations);
+    }
+
+    cudaDeviceManager::Instance()->releasePinnedMemory();
+    EXPECT_EQ(0u, cudaDeviceManager::Instance()->getPinnedMemoryPoolStatistics().bytes_cached);
+}
+
+TEST(cudaPinnedMemoryPool, cap)
+{
+    cudaDeviceManager::Instance()->setPinnedMemoryPooling(true);
+    cudaDeviceManager::Instance()->releasePinnedMemory();
+
+    size_t max_bytes = cudaPinnedMemoryPool::instance()->max_cached_bytes();
+    cudaDeviceManager::Instance()->setMaxPinnedMemory(0);
+
+    std::vector<size_t> dims(2);
+    dims[0] = 128; dims[1] = 128;
+    {
+        hoCuNDArray<float> a(dims);
+    }
+    EXPECT_EQ(0u, cudaDeviceManager::Instance()->getPinnedMemoryPoolStatistics().bytes_cached);
+
+    cudaDeviceManager::Instance()->setMaxPinnedMemory(max_bytes);
+}
@@ -231,3 +231,71 @@ TYPED_TEST(curveFitting_test, T1SRMapping)
     // test hole filling
     EXPECT_NEAR(t1_sr.map_(12, 23, 0, 0), 1122.36963, 1.0);
 }
+
+TYPED_TEST(curveFitting_test, T1SRMappingBatch)
+{
+    Gadgetron::CmrT1SRMapping<float> t1_sr;
+
+    t1_sr.fill_holes_in_maps_ = false;
+    t1_sr.compute_SD_maps_ = false;
+    t1_sr.batch_fitting_ = true;
+    t1_sr.batch_size_ = 48;
+
+    t1_sr.ti_.resize(11, 545);
+    t1_sr.ti_[10] = 10000;
+
+    t1_sr.max_iter_ = 150;
+    t1_sr.max_map_value_ = 4000;
+
+    size_t RO = 64;
+    size_t E1 = 50;
+    size_t N = t1_sr.ti_.size();
+
+    float y[11] = { 178, 185, 182, 189, 178, 180, 187, 179, 177, 177, 471 };
+
+    t1_sr.data_.create(RO, E1, N, 1, 1);
+
+    size_t n;
+    for (n = 0; n < N; n++)
+    {
+        Gadgetron::hoNDArray<float> data2D;
+        data2D.create(RO, E1, &(t1_sr.data_(0, 0, n, 0, 0)));
+        Gadgetron::fill(data2D, y[n]);
+    }
+
+    t1_sr.mask_for_mapping_.create(RO, E1, 1);
+    Gadgetron::fill(t1_sr.mask_for_mapping_, (float)1);
+    t1_sr.mask_for_mapping_(12, 23, 0) = 0;
+
+    t1_sr.perform_parametric_mapping();
+
+    // the least square solution of the model, the simplex solver stops close to it
+    EXPECT_NEAR(t1_sr.para_(0, 0, 0, 0, 0), 471.0636, 0.01);
+    EXPECT_NEAR(t1_sr.map_(0, 0, 0, 0), 1122.3631, 0.05);
+    EXPECT_NEAR(t1_sr.map_(RO-1, E1-1, 0, 0), 1122.3631, 0.05);
+
+    // masked pixels are not fitted
+    EXPECT_EQ(t1_sr.map_(12, 23, 0, 0), 0);
+}
+
+TYPED_TEST(curveFitting_test, T1SRDictionary)
+{
+    std::vector<float> ti(5);
+    ti[0] = 100; ti[1] = 300; ti[2] = 600; ti[3] = 1000; ti[4] = 10000;
+
+    boost::shared_ptr< Gadgetron::CmrT1SRDictionary<float> > dict = Gadgetron::CmrT1SRDictionary<float>::get(ti, 10, 4000, 512);
+
+    // the dictionary is cached for the same saturation times
+    EXPECT_EQ(dict.get(), Gadgetron::CmrT1SRDictionary<float>::get(ti, 10, 4000, 512).get());
+
+    float A = 350, T1 = 1200;
+    std::vector<float> y(ti.size());
+    for (size_t n = 0; n < ti.size(); n++) y[n] = A * (1 - std::exp(-ti[n] / T1));
+
+    float A_match, T1_match;
+    dict->match(&y[0], A_match, T1_match);
+
+    // the log-spaced atoms are about 1.2% apart
+    EXPECT_NEAR(T1_match, T1, 0.012*T1);
+    EXPECT_NEAR(A_match, A, 0.01*A);
+}
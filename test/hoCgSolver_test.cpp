@@ -0,0 +1,168 @@
+#include "hoCgSolver.h"
+#include "hoCgPreconditioner.h"
+#include "linearOperator.h"
+
+#include <gtest/gtest.h>
+#include <boost/make_shared.hpp>
+#include <cmath>
+#include <vector>
+
+using namespace Gadgetron;
+
+namespace
+{
+    const size_t N = 256;
+
+    //Symmetric tridiagonal matrix with a varying diagonal and -1 next to it, the solver works on its square
+    float diagonal(size_t i)
+    {
+        return 2.1f + 0.4f*float(i % 7);
+    }
+
+    class tridiagonalOperator : public linearOperator< hoNDArray<float> >
+    {
+    public:
+        tridiagonalOperator(std::vector<size_t>* dims) : linearOperator< hoNDArray<float> >(dims) {}
+
+        virtual void mult_M(hoNDArray<float>* in, hoNDArray<float>* out, bool accumulate = false)
+        {
+            const float* x = in->get_data_ptr();
+            float* y = out->get_data_ptr();
+            size_t n = in->get_number_of_elements();
+            for (size_t i = 0; i < n; i++) {
+                float v = diagonal(i)*x[i];
+                if (i > 0) v -= x[i-1];
+                if (i + 1 < n) v -= x[i+1];
+                y[i] = accumulate ? y[i] + v : v;
+            }
+        }
+
+        virtual void mult_MH(hoNDArray<float>* in, hoNDArray<float>* out, bool accumulate = false)
+        {
+            mult_M(in, out, accumulate);
+        }
+    };
+
+    //Counts the iterations of the last solve
+    class countingCgSolver : public hoCgSolver<float>
+    {
+    public:
+        countingCgSolver() : iterations(0) {}
+
+        virtual boost::shared_ptr< hoNDArray<float> > solve(hoNDArray<float>* d)
+        {
+            iterations = 0;
+            return hoCgSolver<float>::solve(d);
+        }
+
+        virtual void solver_dump(hoNDArray<float>*) { iterations++; }
+
+        unsigned int iterations;
+    };
+
+    class hoCgSolver_test : public ::testing::Test
+    {
+    protected:
+        virtual void SetUp()
+        {
+            dims_ = std::vector<size_t>(1, N);
+            op_ = boost::make_shared<tridiagonalOperator>(&dims_);
+
+            //Two frames of a series, the second one differs by a percent
+            hoNDArray<float> x1(N), x2(N);
+            for (size_t i = 0; i < N; i++) {
+                x1[i] = std::sin(0.05f*float(i)) + 0.5f*std::cos(0.3f*float(i));
+                x2[i] = x1[i] + 0.01f*std::sin(0.7f*float(i));
+            }
+            truth_ = x2;
+
+            frame1_.create(N);
+            frame2_.create(N);
+            op_->mult_M(&x1, &frame1_);
+            op_->mult_M(&x2, &frame2_);
+        }
+
+        void setup(countingCgSolver& cg)
+        {
+            cg.set_encoding_operator(op_);
+            cg.set_max_iterations(500);
+            cg.set_tc_tolerance(1e-8f);
+        }
+
+        float max_error(hoNDArray<float>& x)
+        {
+            float e = 0;
+            for (size_t i = 0; i < N; i++) e = std::max(e, std::abs(x[i] - truth_[i]));
+            return e;
+        }
+
+        std::vector<size_t> dims_;
+        boost::shared_ptr<tridiagonalOperator> op_;
+        hoNDArray<float> frame1_, frame2_, truth_;
+    };
+}
+
+TEST_F(hoCgSolver_test, warmStartConvergesFaster)
+{
+    countingCgSolver cold;
+    setup(cold);
+    boost::shared_ptr< hoNDArray<float> > x_cold = cold.solve(&frame2_);
+
+    countingCgSolver warm;
+    setup(warm);
+    warm.set_warm_start(true);
+    warm.solve(&frame1_);
+    boost::shared_ptr< hoNDArray<float> > x_warm = warm.solve(&frame2_);
+
+    EXPECT_LT(max_error(*x_cold), 1e-3f);
+    EXPECT_LT(max_error(*x_warm), 1e-3f);
+    EXPECT_LT(warm.iterations, cold.iterations);
+}
+
+TEST_F(hoCgSolver_test, warmStartPreconditioned)
+{
+    //Jacobi preconditioner of the squared matrix, the solver applies the weights twice
+    boost::shared_ptr< hoNDArray<float> > weights = boost::make_shared< hoNDArray<float> >(N);
+    for (size_t i = 0; i < N; i++) {
+        float d = diagonal(i);
+        (*weights)[i] = 1.0f/std::sqrt(d*d + ((i > 0 && i + 1 < N) ? 2.0f : 1.0f));
+    }
+    boost::shared_ptr< hoCgPreconditioner<float> > precond = boost::make_shared< hoCgPreconditioner<float> >();
+    precond->set_weights(weights);
+
+    countingCgSolver cold;
+    setup(cold);
+    cold.set_preconditioner(precond);
+    boost::shared_ptr< hoNDArray<float> > x_cold = cold.solve(&frame2_);
+
+    countingCgSolver warm;
+    setup(warm);
+    warm.set_preconditioner(precond);
+    warm.set_warm_start(true);
+    warm.solve(&frame1_);
+    boost::shared_ptr< hoNDArray<float> > x_warm = warm.solve(&frame2_);
+
+    EXPECT_LT(max_error(*x_cold), 1e-3f);
+    EXPECT_LT(max_error(*x_warm), 1e-3f);
+    EXPECT_LT(warm.iterations, cold.iterations);
+}
+
+TEST_F(hoCgSolver_test, warmStartDropsOtherDimensions)
+{
+    countingCgSolver warm;
+    setup(warm);
+    warm.set_warm_start(true);
+    warm.solve(&frame1_);
+    ASSERT_TRUE(warm.get_x0().get() != 0);
+
+    //A solve of another size starts cold
+    std::vector<size_t> dims(1, N/2);
+    boost::shared_ptr<tridiagonalOperator> op = boost::make_shared<tridiagonalOperator>(&dims);
+    warm.set_encoding_operator(op);
+    hoNDArray<float> d(N/2);
+    d.fill(1.0f);
+    boost::shared_ptr< hoNDArray<float> > x = warm.solve(&d);
+
+    ASSERT_TRUE(x.get() != 0);
+    EXPECT_EQ(N/2, x->get_number_of_elements());
+}
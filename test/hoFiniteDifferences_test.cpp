@@ -0,0 +1,115 @@
+#include "hoNDArray.h"
+#include "hoTvOperator.h"
+#include "hoPartialDerivativeOperator.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+namespace
+{
+    // periodic index of (x + dx, y + dy, z + dz) in an array of size [X Y Z]
+    size_t ind(long long x, long long y, long long z, long long X, long long Y, long long Z)
+    {
+        x = (x + X) % X;
+        y = (y + Y) % Y;
+        z = (z + Z) % Z;
+        return x + y*X + z*X*Y;
+    }
+
+    float grad_mag(const hoNDArray<T>& a, long long x, long long y, long long z)
+    {
+        long long X = a.get_size(0), Y = a.get_size(1), Z = a.get_size(2);
+        T c = a(ind(x, y, z, X, Y, Z));
+        return std::sqrt(std::norm(a(ind(x + 1, y, z, X, Y, Z)) - c) + std::norm(a(ind(x, y + 1, z, X, Y, Z)) - c) + std::norm(a(ind(x, y, z + 1, X, Y, Z)) - c));
+    }
+}
+
+class hoFiniteDifferences_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        a.create(13, 6, 5);
+        for (size_t n = 0; n < a.get_number_of_elements(); n++) a(n) = T(std::sin(0.37f*n), std::cos(0.11f*n*n));
+
+        // a constant patch, with gradients below the limit
+        for (size_t x = 2; x < 6; x++) for (size_t y = 1; y < 4; y++) a(x, y, 2) = T(0.5f, 0.5f);
+    }
+
+    hoNDArray<T> a;
+};
+
+TEST_F(hoFiniteDifferences_test, tvMatchesPointwiseReference)
+{
+    long long X = a.get_size(0), Y = a.get_size(1), Z = a.get_size(2);
+    const float limit = 1e-6f, weight = 0.7f;
+
+    hoTvOperator<T, 3> tv;
+    tv.set_weight(weight);
+    tv.set_limit(limit);
+
+    double ref_mag = 0;
+    hoNDArray<T> ref(a.get_dimensions());
+    for (long long z = 0; z < Z; z++) for (long long y = 0; y < Y; y++) for (long long x = 0; x < X; x++)
+    {
+        T c = a(ind(x, y, z, X, Y, Z));
+        T r(0);
+
+        float g = grad_mag(a, x, y, z);
+        ref_mag += g;
+        if (g > limit) r += (3.0f*c - a(ind(x + 1, y, z, X, Y, Z)) - a(ind(x, y + 1, z, X, Y, Z)) - a(ind(x, y, z + 1, X, Y, Z))) / g;
+
+        g = grad_mag(a, x - 1, y, z);
+        if (g > limit) r += (c - a(ind(x - 1, y, z, X, Y, Z))) / g;
+        g = grad_mag(a, x, y - 1, z);
+        if (g > limit) r += (c - a(ind(x, y - 1, z, X, Y, Z))) / g;
+        g = grad_mag(a, x, y, z - 1);
+        if (g > limit) r += (c - a(ind(x, y, z - 1, X, Y, Z))) / g;
+
+        ref(ind(x, y, z, X, Y, Z)) = weight*r;
+    }
+
+    EXPECT_NEAR(weight*ref_mag, tv.magnitude(&a), 1e-3*ref_mag);
+
+    hoNDArray<T> res(a.get_dimensions());
+    res.fill(T(1.0f, 0.0f));
+    tv.gradient(&a, &res, true);
+
+    for (size_t n = 0; n < a.get_number_of_elements(); n++)
+    {
+        EXPECT_NEAR(ref(n).real() + 1.0f, res(n).real(), 1e-3f);
+        EXPECT_NEAR(ref(n).imag(), res(n).imag(), 1e-3f);
+    }
+}
+
+TEST_F(hoFiniteDifferences_test, partialDerivatives)
+{
+    long long X = a.get_size(0), Y = a.get_size(1), Z = a.get_size(2);
+
+    for (size_t d = 0; d < 3; d++)
+    {
+        hoPartialDerivativeOperator<T, 3> op(d);
+        long long e[3] = { 0, 0, 0 };
+        e[d] = 1;
+
+        hoNDArray<T> fwd(a.get_dimensions()), adj(a.get_dimensions()), second(a.get_dimensions());
+        op.mult_M(&a, &fwd);
+        op.mult_MH(&a, &adj);
+        op.mult_MH_M(&a, &second);
+
+        for (long long z = 0; z < Z; z++) for (long long y = 0; y < Y; y++) for (long long x = 0; x < X; x++)
+        {
+            size_t c = ind(x, y, z, X, Y, Z);
+            T vf = a(ind(x + e[0], y + e[1], z + e[2], X, Y, Z)) - a(c);
+            T vb = a(ind(x - e[0], y - e[1], z - e[2], X, Y, Z)) - a(c);
+            EXPECT_EQ(vf, fwd(c));
+            EXPECT_EQ(vb, adj(c));
+            EXPECT_NEAR((-vf - vb).real(), second(c).real(), 1e-5f);
+            EXPECT_NEAR((-vf - vb).imag(), second(c).imag(), 1e-5f);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "hoNDArray.h"
+#include "hoNDArrayAllocator.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <cstdint>
+
+using namespace Gadgetron;
+
+TEST(hoNDArrayAllocator, defaultAlignment)
+{
+    hoNDArray< std::complex<float> > a;
+    a.create(37, 49, 23);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a.get_data_ptr()) % hoNDArrayAllocator::DEFAULT_ALIGNMENT);
+
+    hoNDArray<float> b;
+    b.create(3);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.get_data_ptr()) % hoNDArrayAllocator::DEFAULT_ALIGNMENT);
+}
+
+TEST(hoNDArrayAllocator, scopedPolicy)
+{
+    hoNDArrayAllocator::Policy p(256, hoNDArrayAllocator::HUGE_PAGES_TRANSPARENT, size_t(4) << 20);
+
+    hoNDArray<double> small, large;
+    {
+        hoNDArrayAllocationScope scope(p);
+        EXPECT_EQ(256u, hoNDArrayAllocator::instance().policy().alignment);
+
+        small.create(1000);
+        large.create(size_t(1) << 20); //8 MB, above the threshold
+    }
+
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(small.get_data_ptr()) % 256);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(large.get_data_ptr()) % hoNDArrayAllocator::HUGE_PAGE_SIZE);
+    EXPECT_EQ(size_t(hoNDArrayAllocator::DEFAULT_ALIGNMENT), hoNDArrayAllocator::instance().policy().alignment);
+
+    large.get_data_ptr()[(size_t(1) << 20) - 1] = 1.0;
+    EXPECT_EQ(1.0, large.get_data_ptr()[(size_t(1) << 20) - 1]);
+}
+
+TEST(hoNDArrayAllocator, explicitHugePagesFallBack)
+{
+    //Without reserved huge pages the allocation falls back to transparent huge pages
+    hoNDArrayAllocator::Policy p(64, hoNDArrayAllocator::HUGE_PAGES_EXPLICIT, 0);
+    void* ptr = hoNDArrayAllocator::instance().allocate(size_t(3) << 20, p);
+    ASSERT_TRUE(ptr != 0);
+    memset(ptr, 0, size_t(3) << 20);
+    hoNDArrayAllocator::instance().deallocate(ptr);
+}
@@ -0,0 +1,77 @@
+#include "hoNDArray_fileio.h"
+#include "hoNDArrayMapped.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <cstdio>
+#include <string>
+
+using namespace Gadgetron;
+
+class hoNDArrayMapped_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        filename = ::testing::TempDir() + "hoNDArrayMapped_test.bin";
+    }
+
+    virtual void TearDown()
+    {
+        std::remove(filename.c_str());
+    }
+
+    std::string filename;
+};
+
+TEST_F(hoNDArrayMapped_test, mapWrittenArray)
+{
+    hoNDArray< std::complex<float> > a(17, 9, 5);
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = std::complex<float>(float(i), -1.0f);
+    ASSERT_EQ(0, write_nd_array(&a, filename.c_str()));
+
+    boost::shared_ptr< hoNDArrayMapped< std::complex<float> > > m = map_nd_array< std::complex<float> >(filename.c_str());
+    ASSERT_TRUE(m.get() != 0);
+    EXPECT_TRUE(m->is_mapped());
+    EXPECT_TRUE(m->dimensions_equal(&a));
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) EXPECT_EQ(a(i), (*m)(i));
+
+    // copy-on-write, the file keeps the original values
+    m->advise(hoNDArrayMapped< std::complex<float> >::ADVISE_SEQUENTIAL);
+    (*m)(3) = std::complex<float>(100.0f, 0.0f);
+    m->close();
+    EXPECT_EQ(0u, m->get_number_of_elements());
+
+    boost::shared_ptr< hoNDArray< std::complex<float> > > r = read_nd_array< std::complex<float> >(filename.c_str());
+    EXPECT_EQ(a(3), (*r)(3));
+}
+
+TEST_F(hoNDArrayMapped_test, createFile)
+{
+    std::vector<size_t> dims(3);
+    dims[0] = 64; dims[1] = 33; dims[2] = 7;
+
+    {
+        hoNDArrayMapped<float> m;
+        m.create_file(filename, dims);
+        ASSERT_EQ(64u*33u*7u, m.get_number_of_elements());
+        for (size_t i = 0; i < m.get_number_of_elements(); i++) m(i) = float(i);
+        m.flush();
+    }
+
+    boost::shared_ptr< hoNDArray<float> > r = read_nd_array<float>(filename.c_str());
+    ASSERT_TRUE(r.get() != 0);
+    EXPECT_EQ(dims, *r->get_dimensions());
+    for (size_t i = 0; i < r->get_number_of_elements(); i++) EXPECT_EQ(float(i), (*r)(i));
+}
+
+TEST_F(hoNDArrayMapped_test, misalignedHeaderThrows)
+{
+    // 4D: 5 header ints, the data is not 8 byte aligned
+    hoNDArray<double> a(2, 3, 4, 5);
+    ASSERT_EQ(0, write_nd_array(&a, filename.c_str()));
+
+    hoNDArrayMapped<double> m;
+    EXPECT_THROW(m.open_file(filename), std::runtime_error);
+    EXPECT_FALSE(m.is_mapped());
+}
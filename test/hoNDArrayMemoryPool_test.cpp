@@ -0,0 +1,136 @@
+#include "hoNDArray.h"
+#include "hoNDArrayMemoryPool.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Gadgetron;
+
+namespace
+{
+    //Restores the limits of the process wide pool
+    struct PoolLimits
+    {
+        PoolLimits() : high_water(hoNDArrayMemoryPool::instance().free_high_water_bytes()) {}
+        ~PoolLimits() { hoNDArrayMemoryPool::instance().set_free_high_water_bytes(high_water); }
+        size_t high_water;
+    };
+}
+
+TEST(hoNDArrayMemoryPool, blocksComeBack)
+{
+    hoNDArrayMemoryPool& pool = hoNDArrayMemoryPool::instance();
+
+    void* a = pool.allocate_bytes(3000);
+    ASSERT_TRUE(a != 0);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a) % hoNDArrayAllocator::DEFAULT_ALIGNMENT);
+    EXPECT_TRUE(pool.deallocate(a));
+
+    //The same size class hands out the block again
+    void* b = pool.allocate_bytes(4000);
+    EXPECT_EQ(a, b);
+    EXPECT_TRUE(pool.deallocate(b));
+
+    //Not from the pool
+    void* c = malloc(3000);
+    EXPECT_FALSE(pool.deallocate(c));
+    free(c);
+}
+
+TEST(hoNDArrayMemoryPool, emptySlabReleasedAboveHighWater)
+{
+    PoolLimits limits;
+    hoNDArrayMemoryPool& pool = hoNDArrayMemoryPool::instance();
+
+    //The largest class has one block per slab
+    const size_t bytes = size_t(1) << hoNDArrayMemoryPool::MAX_BLOCK_SIZE_LOG2;
+
+    pool.set_free_high_water_bytes(size_t(1) << 40);
+
+    //Take the free blocks other tests left in the size class, the next allocations need new slabs
+    std::vector<void*> taken;
+    for (size_t slabs = pool.slab_bytes(); pool.slab_bytes() == slabs; ) {
+        taken.push_back(pool.allocate_bytes(bytes));
+    }
+
+    size_t before = pool.slab_bytes();
+    void* a = pool.allocate_bytes(bytes);
+    void* b = pool.allocate_bytes(bytes);
+    EXPECT_EQ(before + 2*bytes, pool.slab_bytes());
+
+    //Below the high water mark the slab is kept
+    EXPECT_TRUE(pool.deallocate(a));
+    EXPECT_EQ(before + 2*bytes, pool.slab_bytes());
+
+    //Above it the emptied slab goes back to the system
+    pool.set_free_high_water_bytes(0);
+    EXPECT_TRUE(pool.deallocate(b));
+    EXPECT_EQ(before + bytes, pool.slab_bytes());
+
+    //The kept slab still serves the size class
+    void* c = pool.allocate_bytes(bytes);
+    EXPECT_EQ(a, c);
+    EXPECT_TRUE(pool.deallocate(c));
+    EXPECT_EQ(before, pool.slab_bytes());
+
+    pool.set_free_high_water_bytes(size_t(1) << 40);
+    for (size_t k = 0; k < taken.size(); k++) EXPECT_TRUE(pool.deallocate(taken[k]));
+}
+
+TEST(hoNDArrayMemoryPool, concurrentSizeClasses)
+{
+    hoNDArrayMemoryPool& pool = hoNDArrayMemoryPool::instance();
+
+    const size_t threads = 4;
+    const size_t rounds = 2000;
+    std::vector<size_t> errors(threads, 0);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&pool, &errors, t]() {
+            //Two threads per size class, each checks that nobody else wrote its blocks
+            size_t bytes = (t % 2) ? 5000 : 20000;
+            std::vector<char*> blocks;
+            for (size_t r = 0; r < rounds; r++) {
+                char* p = reinterpret_cast<char*>(pool.allocate_bytes(bytes));
+                memset(p, int(t), bytes);
+                blocks.push_back(p);
+
+                if (blocks.size() == 8) {
+                    for (size_t k = 0; k < blocks.size(); k++) {
+                        if (blocks[k][0] != char(t) || blocks[k][bytes-1] != char(t)) errors[t]++;
+                        if (!pool.deallocate(blocks[k])) errors[t]++;
+                    }
+                    blocks.clear();
+                }
+            }
+            for (size_t k = 0; k < blocks.size(); k++) pool.deallocate(blocks[k]);
+        }));
+    }
+
+    for (size_t t = 0; t < threads; t++) workers[t].join();
+    for (size_t t = 0; t < threads; t++) EXPECT_EQ(0u, errors[t]);
+}
+
+TEST(hoNDArrayMemoryPool, pooledArray)
+{
+    std::vector<size_t> dims(2);
+    dims[0] = 256;
+    dims[1] = 8;
+
+    std::complex<float>* data = hoNDArrayMemoryPool::instance().allocate< std::complex<float> >(dims[0]*dims[1]);
+    size_t free_before = hoNDArrayMemoryPool::instance().free_bytes();
+    {
+        hoNDArray< std::complex<float> > a;
+        a.create(&dims, data, true);
+        a.fill(std::complex<float>(1.0f, 2.0f));
+    }
+
+    //The array gave its data back to the pool, not to the system
+    EXPECT_EQ(free_before + hoNDArrayMemoryPool::block_size(hoNDArrayMemoryPool::size_class(dims[0]*dims[1]*sizeof(std::complex<float>))),
+              hoNDArrayMemoryPool::instance().free_bytes());
+}
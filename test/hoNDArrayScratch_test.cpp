@@ -0,0 +1,72 @@
+#include "hoNDArray.h"
+#include "hoNDArrayScratch.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <cstdint>
+
+using namespace Gadgetron;
+
+TEST(hoNDArrayScratch, rewindAtEndOfScope)
+{
+    hoNDArrayScratch& scratch = hoNDArrayScratch::instance();
+    size_t used = scratch.used_bytes();
+
+    std::complex<float>* first = 0;
+    {
+        hoNDArrayScratchScope scope;
+
+        hoNDArray< std::complex<float> > a;
+        scratch.create(a, 64, 32);
+        first = a.begin();
+        EXPECT_EQ(64u*32u, a.get_number_of_elements());
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % hoNDArrayScratch::ALIGNMENT);
+        EXPECT_GE(scratch.used_bytes(), used + a.get_number_of_bytes());
+
+        {
+            hoNDArrayScratchScope inner;
+            hoNDArray<float> b;
+            scratch.create(b, 17);
+            EXPECT_NE(reinterpret_cast<void*>(first), reinterpret_cast<void*>(b.begin()));
+        }
+
+        hoNDArray<float> c;
+        scratch.create(c, 17);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(c.begin()) % hoNDArrayScratch::ALIGNMENT);
+    }
+
+    EXPECT_EQ(used, scratch.used_bytes());
+
+    // the memory is handed out again in the same order
+    hoNDArrayScratchScope scope;
+    hoNDArray< std::complex<float> > a;
+    scratch.create(a, 64, 32);
+    EXPECT_EQ(first, a.begin());
+}
+
+TEST(hoNDArrayScratch, largeRequestsGetTheirOwnChunk)
+{
+    hoNDArrayScratch& scratch = hoNDArrayScratch::instance();
+    size_t used = scratch.used_bytes();
+
+    {
+        hoNDArrayScratchScope scope;
+
+        hoNDArray<double> a, b;
+        std::vector<size_t> dims(2);
+        dims[0] = 1024;
+        dims[1] = 3*1024;
+        scratch.create(a, dims);
+        scratch.create(b, dims);
+
+        EXPECT_EQ(a.get_number_of_elements(), b.get_number_of_elements());
+        EXPECT_GE(scratch.reserved_bytes(), a.get_number_of_bytes() + b.get_number_of_bytes());
+
+        a.fill(1.0);
+        b.fill(2.0);
+        EXPECT_EQ(1.0, a(dims[0]*dims[1]-1));
+        EXPECT_EQ(2.0, b(0));
+    }
+
+    EXPECT_EQ(used, scratch.used_bytes());
+}
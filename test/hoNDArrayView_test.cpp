@@ -0,0 +1,72 @@
+#include "hoNDArray.h"
+#include "hoNDArrayView.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+
+using namespace Gadgetron;
+
+class hoNDArrayView_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        // [RO E1 CHA N]
+        a.create(8, 6, 4, 3);
+        for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = float(i);
+    }
+
+    hoNDArray<float> a;
+};
+
+TEST_F(hoNDArrayView_test, sliceAndRange)
+{
+    hoNDArrayView<float> v(a);
+    EXPECT_TRUE(v.is_contiguous());
+    EXPECT_EQ(a.get_number_of_elements(), v.get_number_of_elements());
+
+    // one coil of all N
+    hoNDArrayView<float> cha = v.slice(2, 1);
+    EXPECT_EQ(3u, cha.get_number_of_dimensions());
+    EXPECT_EQ(8u*6u*3u, cha.get_number_of_elements());
+    EXPECT_EQ(2u, cha.contiguous_dimensions());
+    EXPECT_FALSE(cha.is_contiguous());
+    EXPECT_EQ(a(3, 2, 1, 2), cha(std::vector<size_t>{3, 2, 2}));
+
+    // E1 range, each RO x E1 block is still packed
+    hoNDArrayView<float> e1 = v.range(1, 2, 3);
+    EXPECT_EQ(2u, e1.contiguous_dimensions());
+    EXPECT_EQ(a(5, 4, 3, 1), e1(std::vector<size_t>{5, 2, 3, 1}));
+
+    // the last N is a contiguous block
+    hoNDArray<float> last;
+    EXPECT_TRUE(v.slice(3, 2).as_array(last));
+    EXPECT_EQ(a.begin() + 2*8*6*4, last.begin());
+    EXPECT_EQ(8u*6u*4u, last.get_number_of_elements());
+}
+
+TEST_F(hoNDArrayView_test, copyAndBlocks)
+{
+    hoNDArrayView<float> cha = hoNDArrayView<float>(a).slice(2, 3);
+
+    hoNDArray<float> packed;
+    cha.copy_to(packed);
+    EXPECT_EQ(8u*6u*3u, packed.get_number_of_elements());
+    for (size_t i = 0; i < packed.get_number_of_elements(); i++) {
+        EXPECT_EQ(cha.at(i), packed(i));
+    }
+
+    size_t blocks = 0;
+    cha.for_each_block([&blocks](hoNDArray<float>& b) {
+        EXPECT_EQ(8u*6u, b.get_number_of_elements());
+        for (size_t i = 0; i < b.get_number_of_elements(); i++) b(i) = -1.0f;
+        blocks++;
+    });
+    EXPECT_EQ(3u, blocks);
+
+    EXPECT_EQ(-1.0f, a(7, 5, 3, 2));
+    EXPECT_EQ(float(a.get_number_of_elements()-8*6-1), a(7, 5, 2, 2));
+
+    cha.copy_from(packed);
+    EXPECT_EQ(packed(8*6*3-1), a(7, 5, 3, 2));
+}
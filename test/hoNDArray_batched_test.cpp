@@ -0,0 +1,107 @@
+#include "hoNDArray_batched.h"
+#include "hoNDArray_simd.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+class hoNDArray_batched_test : public ::testing::Test
+{
+protected:
+    virtual void TearDown()
+    {
+        hoNDArraySimd::set_level(hoNDArraySimd::detected());
+    }
+
+    static std::complex<float> value(size_t i)
+    {
+        return std::complex<float>(float(i % 7) - 3.0f, 0.25f*float(i % 13) - 1.0f);
+    }
+
+    static void expect_near(std::complex<float> a, std::complex<float> b)
+    {
+        EXPECT_NEAR(a.real(), b.real(), 1e-3f*(1.0f + std::abs(a)));
+        EXPECT_NEAR(a.imag(), b.imag(), 1e-3f*(1.0f + std::abs(a)));
+    }
+
+    // op(A) * x for batch element b, A stored as [b + N*(i + rows*k)]
+    static std::complex<float> reference(size_t N, size_t M, size_t K, const std::vector< std::complex<float> >& A, bool transA,
+                                         const std::vector< std::complex<float> >& x, bool conjX, size_t b, size_t i)
+    {
+        std::complex<float> r(0);
+        for (size_t k = 0; k < K; k++) {
+            std::complex<float> a = transA ? A[b + N*(k + K*i)] : A[b + N*(i + M*k)];
+            std::complex<float> v = conjX ? std::conj(x[b + N*k]) : x[b + N*k];
+            r += a*v;
+        }
+        return r;
+    }
+};
+
+TEST_F(hoNDArray_batched_test, gemvMatchesReference)
+{
+    // odd batch for the scalar tails, specialised and generic numbers of summed entries
+    const size_t N = 1037;
+    const size_t Ks[] = { 3, 8, 20 };
+    const size_t M = 3;
+
+    hoNDArraySimd::Level levels[] = { hoNDArraySimd::SIMD_SCALAR, hoNDArraySimd::detected() };
+
+    for (size_t l = 0; l < 2; l++) {
+        hoNDArraySimd::set_level(levels[l]);
+
+        for (size_t t = 0; t < 3; t++) {
+            const size_t K = Ks[t];
+            std::vector< std::complex<float> > A(N*M*K), x(N*K), r(N*M);
+            for (size_t i = 0; i < A.size(); i++) A[i] = value(i);
+            for (size_t i = 0; i < x.size(); i++) x[i] = value(3*i + 1);
+
+            for (int mode = 0; mode < 4; mode++) {
+                const bool transA = (mode & 1) != 0;
+                const bool conjX = (mode & 2) != 0;
+
+                hoNDArrayBatched::gemv(N, M, K, &A[0], transA, &x[0], conjX, &r[0]);
+
+                for (size_t b = 0; b < N; b += 97) {
+                    for (size_t i = 0; i < M; i++) expect_near(reference(N, M, K, A, transA, x, conjX, b, i), r[b + N*i]);
+                }
+                expect_near(reference(N, M, K, A, transA, x, conjX, N - 1, M - 1), r[N - 1 + N*(M - 1)]);
+            }
+        }
+    }
+}
+
+TEST_F(hoNDArray_batched_test, choleskySolve)
+{
+    const size_t N = 133;
+    const size_t M = 4;
+    const size_t P = 2;
+
+    // A = S^H S + I is positive definite
+    std::vector< std::complex<double> > S(N*M*M), A(N*M*M), B(N*M*P), X(N*M*P);
+    for (size_t i = 0; i < S.size(); i++) S[i] = std::complex<double>(value(i).real(), value(5*i + 2).imag());
+    for (size_t i = 0; i < X.size(); i++) X[i] = std::complex<double>(value(2*i).real(), value(i + 3).imag());
+
+    for (size_t b = 0; b < N; b++) {
+        for (size_t i = 0; i < M; i++) {
+            for (size_t j = 0; j < M; j++) {
+                std::complex<double> a = (i == j) ? 1.0 : 0.0;
+                for (size_t k = 0; k < M; k++) a += std::conj(S[b + N*(k + M*i)])*S[b + N*(k + M*j)];
+                A[b + N*(i + M*j)] = a;
+            }
+        }
+    }
+
+    hoNDArrayBatched::gemm(N, M, M, P, &A[0], false, &X[0], false, &B[0]);
+
+    hoNDArrayBatched::potrf(N, M, &A[0]);
+    hoNDArrayBatched::potrs(N, M, P, &A[0], &B[0]);
+
+    for (size_t i = 0; i < X.size(); i++) {
+        EXPECT_NEAR(X[i].real(), B[i].real(), 1e-9);
+        EXPECT_NEAR(X[i].imag(), B[i].imag(), 1e-9);
+    }
+}
@@ -0,0 +1,63 @@
+#include "hoNDArray.h"
+#include "hoNDArray_expression.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+
+using namespace Gadgetron;
+
+class hoNDArray_expression_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        b.create(64, 33, 2);
+        c.create(64, 33, 2);
+        d.create(64, 33, 2);
+        for (size_t i = 0; i < b.get_number_of_elements(); i++) {
+            b(i) = std::complex<float>(float(i % 7), -float(i % 5));
+            c(i) = std::complex<float>(0.5f*float(i % 3), float(i % 11));
+            d(i) = std::complex<float>(1.0f, 2.0f);
+        }
+    }
+
+    hoNDArray< std::complex<float> > b, c, d;
+};
+
+TEST_F(hoNDArray_expression_test, fusedChain)
+{
+    hoNDArray< std::complex<float> > a;
+    evaluate(expr(b) * conj(expr(c)) + expr(d), a);
+
+    EXPECT_TRUE(a.dimensions_equal(&b));
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) {
+        std::complex<float> v = b(i) * std::conj(c(i)) + d(i);
+        EXPECT_FLOAT_EQ(v.real(), a(i).real());
+        EXPECT_FLOAT_EQ(v.imag(), a(i).imag());
+    }
+}
+
+TEST_F(hoNDArray_expression_test, scalarsAndInPlace)
+{
+    // the result may be an operand
+    evaluate(std::complex<float>(2.0f) * expr(b) - expr(d) / std::complex<float>(2.0f, 0.0f), b);
+    EXPECT_FLOAT_EQ(2.0f*float(10 % 7) - 0.5f, b(10).real());
+    EXPECT_FLOAT_EQ(-2.0f*float(10 % 5) - 1.0f, b(10).imag());
+
+    hoNDArray<float> m;
+    evaluate(norm(expr(c)) * 0.5f, m);
+    EXPECT_TRUE(m.dimensions_equal(&c));
+    EXPECT_FLOAT_EQ(0.5f*std::norm(c(17)), m(17));
+
+    evaluate(abs(expr(d)) + real(expr(d)), m);
+    EXPECT_FLOAT_EQ(std::abs(d(0)) + 1.0f, m(0));
+
+    std::complex<float> s = evaluate_sum(expr(d) * expr(d));
+    EXPECT_FLOAT_EQ(float(d.get_number_of_elements())*(-3.0f), s.real());
+}
+
+TEST_F(hoNDArray_expression_test, sizeMismatch)
+{
+    hoNDArray< std::complex<float> > e(10), a;
+    EXPECT_THROW(evaluate(expr(b) + expr(e), a), std::runtime_error);
+}
@@ -0,0 +1,105 @@
+#include "hoNDArray_half.h"
+#include "hoNDArray_simd.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+using namespace Gadgetron;
+
+class hoNDArray_half_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        // odd length, so the scalar tails of the kernels are used as well, over the whole half range
+        N = 4099;
+        x.resize(N);
+        for (size_t i = 0; i < N; i++) {
+            float m = std::ldexp(1.0f + float(i % 97)/97.0f, int(i % 44) - 28);
+            x[i] = (i % 2) ? -m : m;
+        }
+    }
+
+    virtual void TearDown()
+    {
+        hoNDArraySimd::set_level(hoNDArraySimd::detected());
+    }
+
+    static unsigned short bits(float f)
+    {
+        return half_float::from_float(f);
+    }
+
+    size_t N;
+    std::vector<float> x;
+};
+
+TEST_F(hoNDArray_half_test, scalarRounding)
+{
+    EXPECT_EQ(bits(0.0f), 0x0000);
+    EXPECT_EQ(bits(-0.0f), 0x8000);
+    EXPECT_EQ(bits(1.0f), 0x3C00);
+    EXPECT_EQ(bits(-2.0f), 0xC000);
+    EXPECT_EQ(bits(65504.0f), 0x7BFF);
+    EXPECT_EQ(bits(65520.0f), 0x7C00);
+    EXPECT_EQ(bits(1e10f), 0x7C00);
+    EXPECT_EQ(bits(std::ldexp(1.0f, -14)), 0x0400);
+    EXPECT_EQ(bits(std::ldexp(1.0f, -24)), 0x0001);
+    EXPECT_EQ(bits(std::ldexp(1.0f, -25)), 0x0000);
+    EXPECT_EQ(bits(std::ldexp(1.5f, -25)), 0x0001);
+
+    // ties go to the even significand
+    EXPECT_EQ(bits(1.0f + std::ldexp(1.0f, -11)), 0x3C00);
+    EXPECT_EQ(bits(1.0f + 3.0f*std::ldexp(1.0f, -11)), 0x3C02);
+
+    EXPECT_EQ(half_float::to_float(0x3C00), 1.0f);
+    EXPECT_EQ(half_float::to_float(0x7BFF), 65504.0f);
+    EXPECT_EQ(half_float::to_float(0x0001), std::ldexp(1.0f, -24));
+    EXPECT_TRUE(std::isinf(half_float::to_float(0xFC00)));
+    EXPECT_TRUE(std::isnan(half_float::to_float(bits(std::nanf("")))));
+}
+
+TEST_F(hoNDArray_half_test, allLevelsMatchScalar)
+{
+    hoNDArraySimd::Level levels[] = { hoNDArraySimd::SIMD_SCALAR, hoNDArraySimd::SIMD_NEON, hoNDArraySimd::SIMD_AVX2, hoNDArraySimd::SIMD_AVX512 };
+
+    for (size_t l = 0; l < sizeof(levels)/sizeof(levels[0]); l++) {
+        if (levels[l] > hoNDArraySimd::detected()) continue;
+        hoNDArraySimd::set_level(levels[l]);
+
+        std::vector<half_float> h(N);
+        std::vector<float> back(N);
+        hoNDArrayHalf::to_half(N, &x[0], &h[0]);
+        hoNDArrayHalf::to_float(N, &h[0], &back[0]);
+
+        for (size_t i = 0; i < N; i++) {
+            EXPECT_EQ(h[i].bits, bits(x[i])) << hoNDArraySimd::name(hoNDArraySimd::level()) << " at " << i;
+            EXPECT_EQ(back[i], half_float::to_float(bits(x[i]))) << hoNDArraySimd::name(hoNDArraySimd::level()) << " at " << i;
+        }
+    }
+}
+
+TEST_F(hoNDArray_half_test, complexRoundTrip)
+{
+    hoNDArray< std::complex<float> > a(17, 9, 5), b;
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) {
+        a(i) = std::complex<float>(float(i % 31) - 15.0f, 0.01f*float(i % 7));
+    }
+
+    hoNDArray<complex_half> h;
+    complex_to_half(a, h);
+    EXPECT_TRUE(h.dimensions_equal(&a));
+    EXPECT_EQ(sizeof(complex_half), sizeof(std::complex<float>)/2);
+
+    half_to_complex(h, b);
+    EXPECT_TRUE(b.dimensions_equal(&a));
+
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) {
+        EXPECT_NEAR(b(i).real(), a(i).real(), std::ldexp(std::abs(a(i).real()), -11));
+        EXPECT_NEAR(b(i).imag(), a(i).imag(), std::ldexp(std::abs(a(i).imag()), -11));
+        EXPECT_EQ(std::complex<float>(h(i)), b(i));
+    }
+}
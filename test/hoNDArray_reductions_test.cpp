@@ -4,6 +4,12 @@
 #include <gtest/gtest.h>
 #include <complex>
 #include <vector>
+#include <cmath>
+#include <algorithm>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif // USE_OMP
 
 using namespace Gadgetron;
 using testing::Types;
@@ -66,3 +72,55 @@ TYPED_TEST(hoNDArray_reductions_TestReal, sortTest)
     EXPECT_EQ(ind[3] , 1);
     EXPECT_EQ(ind[4] , 4);
 }
+
+TYPED_TEST(hoNDArray_reductions_TestReal, sumAndNormsTest)
+{
+    size_t N = this->Array.get_number_of_elements();
+    TypeParam* pA = this->Array.begin();
+    TypeParam* pB = this->Array2.begin();
+
+    double s = 0, s2 = 0, d = 0;
+    for (size_t i = 0; i < N; i++) {
+        pA[i] = TypeParam(0.001*double(i % 1013) - 0.5);
+        pB[i] = TypeParam(1) + TypeParam(i % 3);
+        s += double(pA[i]);
+        s2 += double(pA[i])*double(pA[i]);
+        d += double(pA[i])*double(pB[i]);
+    }
+    pA[12345] = TypeParam(7);
+    s += 7.0 - (0.001*double(12345 % 1013) - 0.5);
+
+    EXPECT_NEAR(s, double(Gadgetron::sum(&this->Array)), 1e-6*N);
+    EXPECT_NEAR(s/N, double(Gadgetron::mean(&this->Array)), 1e-6);
+    EXPECT_EQ(TypeParam(7), Gadgetron::max(&this->Array));
+    EXPECT_EQ(12345u, Gadgetron::amax(this->Array));
+
+    pA[12345] = TypeParam(0.001*double(12345 % 1013) - 0.5);
+    EXPECT_NEAR(std::sqrt(s2), double(Gadgetron::nrm2(&this->Array)), 1e-4*std::sqrt(s2));
+    EXPECT_NEAR(d, double(Gadgetron::dot(&this->Array, &this->Array2)), 1e-4*std::abs(d) + 1e-3);
+}
+
+#ifdef USE_OMP
+TYPED_TEST(hoNDArray_reductions_TestReal, threadCountIndependentTest)
+{
+    size_t N = this->Array.get_number_of_elements();
+    TypeParam* pA = this->Array.begin();
+    for (size_t i = 0; i < N; i++) pA[i] = TypeParam(1.0/(1.0 + double(i % 977)));
+
+    int num_threads = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    TypeParam s1 = Gadgetron::sum(&this->Array);
+    TypeParam n1 = Gadgetron::norm2(this->Array);
+
+    omp_set_num_threads(std::max(2, num_threads));
+    TypeParam s2 = Gadgetron::sum(&this->Array);
+    TypeParam n2 = Gadgetron::norm2(this->Array);
+
+    omp_set_num_threads(num_threads);
+
+    // bitwise equal, not only close
+    EXPECT_EQ(s1, s2);
+    EXPECT_EQ(n1, n2);
+}
+#endif // USE_OMP
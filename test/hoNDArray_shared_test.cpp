@@ -0,0 +1,113 @@
+#include "hoNDArray.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+
+using namespace Gadgetron;
+
+class hoNDArray_shared_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        a.create(8, 6, 4);
+        for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = std::complex<float>(float(i), -float(i));
+    }
+
+    const std::complex<float>* data(const hoNDArray< std::complex<float> >& x) { return x.get_data_ptr(); }
+
+    hoNDArray< std::complex<float> > a;
+};
+
+TEST_F(hoNDArray_shared_test, copiesAreDeepByDefault)
+{
+    hoNDArray< std::complex<float> > b(a);
+    EXPECT_NE(data(a), data(b));
+    EXPECT_FALSE(a.is_shared());
+}
+
+TEST_F(hoNDArray_shared_test, copyOnWrite)
+{
+    a.share();
+    EXPECT_FALSE(a.is_shared());
+
+    hoNDArray< std::complex<float> > b(a);
+    hoNDArray< std::complex<float> > c;
+    c = a;
+    EXPECT_TRUE(a.is_shared());
+    EXPECT_EQ(data(a), data(b));
+    EXPECT_EQ(data(a), data(c));
+
+    // reading through a const array keeps the buffer shared
+    const hoNDArray< std::complex<float> >& cb = b;
+    EXPECT_EQ(std::complex<float>(5, -5), cb(5, 0, 0));
+    EXPECT_EQ(data(a), data(b));
+
+    b(5, 0, 0) = std::complex<float>(1, 1);
+    EXPECT_NE(data(a), data(b));
+    EXPECT_EQ(std::complex<float>(5, -5), a(5));
+    EXPECT_EQ(std::complex<float>(5, -5), c(5));
+    EXPECT_EQ(std::complex<float>(1, 1), b(5));
+    EXPECT_EQ(a(100), b(100));
+
+    // the last reference writes in place
+    c.clear();
+    EXPECT_FALSE(a.is_shared());
+    const std::complex<float>* pa = data(a);
+    a.fill(std::complex<float>(2, 0));
+    EXPECT_EQ(pa, data(a));
+}
+
+TEST_F(hoNDArray_shared_test, sharedSubArray)
+{
+    a.share();
+
+    std::vector<size_t> dims(2);
+    dims[0] = 8;
+    dims[1] = 6;
+
+    hoNDArray< std::complex<float> > s;
+    a.get_shared_sub_array(a.calculate_offset(0, 0, 2), dims, s);
+    EXPECT_EQ(data(a) + 2*8*6, data(s));
+    EXPECT_EQ(8u*6u, s.get_number_of_elements());
+    EXPECT_EQ(a(3, 4, 2), s(3, 4));
+
+    // the sub array keeps the buffer alive
+    a.clear();
+    EXPECT_EQ(std::complex<float>(2*8*6, -2*8*6), s(0));
+
+    // an array that is not shared is copied
+    hoNDArray< std::complex<float> > b(8, 6, 4);
+    hoNDArray< std::complex<float> > t;
+    b.get_shared_sub_array(0, dims, t);
+    EXPECT_NE(data(b), data(t));
+}
+
+TEST_F(hoNDArray_shared_test, borrowedMemoryIsNotShared)
+{
+    hoNDArray< std::complex<float> > b(8, 6, 4, a.begin());
+    b.share();
+
+    hoNDArray< std::complex<float> > c(b);
+    EXPECT_NE(data(b), data(c));
+    EXPECT_FALSE(b.is_shared());
+}
+
+TEST_F(hoNDArray_shared_test, shrinkKeepsBuffer)
+{
+    const std::complex<float>* pa = data(a);
+
+    std::vector<size_t> dims(2);
+    dims[0] = 8;
+    dims[1] = 3;
+    a.shrink(dims);
+
+    EXPECT_EQ(pa, data(a));
+    EXPECT_EQ(8u*3u, a.get_number_of_elements());
+    EXPECT_EQ(2u, a.get_number_of_dimensions());
+    EXPECT_EQ(std::complex<float>(8*2+5, -(8*2+5)), a(5, 2));
+
+    // more elements than the array holds
+    dims[1] = 7;
+    EXPECT_ANY_THROW(a.shrink(dims));
+}
@@ -0,0 +1,98 @@
+#include "hoNDArray_simd.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+class hoNDArray_simd_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        // odd length, so the scalar tails of the kernels are used as well
+        N = 1037;
+        x.resize(N);
+        y.resize(N);
+        for (size_t i = 0; i < N; i++) {
+            x[i] = std::complex<float>(float(i % 7) - 3.0f, 0.25f*float(i % 13));
+            y[i] = std::complex<float>(0.5f*float(i % 3), -float(i % 11));
+        }
+    }
+
+    virtual void TearDown()
+    {
+        hoNDArraySimd::set_level(hoNDArraySimd::detected());
+    }
+
+    static void expect_near(std::complex<float> a, std::complex<float> b)
+    {
+        EXPECT_NEAR(a.real(), b.real(), 1e-4f*(1.0f + std::abs(a)));
+        EXPECT_NEAR(a.imag(), b.imag(), 1e-4f*(1.0f + std::abs(a)));
+    }
+
+    size_t N;
+    std::vector< std::complex<float> > x, y;
+};
+
+TEST_F(hoNDArray_simd_test, allLevelsMatchReference)
+{
+    const hoNDArraySimd::Level levels[] = { hoNDArraySimd::SIMD_SCALAR, hoNDArraySimd::SIMD_NEON, hoNDArraySimd::SIMD_AVX2, hoNDArraySimd::SIMD_AVX512 };
+    const std::complex<float> a(1.5f, -0.75f);
+
+    for (size_t l = 0; l < sizeof(levels)/sizeof(levels[0]); l++) {
+        hoNDArraySimd::set_level(levels[l]);
+        SCOPED_TRACE(hoNDArraySimd::name(hoNDArraySimd::level()));
+
+        std::vector< std::complex<float> > r(N);
+        std::vector<float> m(N);
+
+        hoNDArraySimd::multiply(N, &x[0], &y[0], &r[0]);
+        for (size_t i = 0; i < N; i++) expect_near(x[i]*y[i], r[i]);
+
+        hoNDArraySimd::multiplyConj(N, &x[0], &y[0], &r[0]);
+        for (size_t i = 0; i < N; i++) expect_near(x[i]*std::conj(y[i]), r[i]);
+
+        hoNDArraySimd::conjugate(N, &x[0], &r[0]);
+        for (size_t i = 0; i < N; i++) expect_near(std::conj(x[i]), r[i]);
+
+        hoNDArraySimd::axpy(a, N, &x[0], &y[0], &r[0]);
+        for (size_t i = 0; i < N; i++) expect_near(a*x[i] + y[i], r[i]);
+
+        hoNDArraySimd::abs(N, &x[0], &m[0]);
+        for (size_t i = 0; i < N; i++) EXPECT_NEAR(std::abs(x[i]), m[i], 1e-5f*(1.0f + m[i]));
+
+        // x as the even and y as the odd samples, y has P samples before and after the M outputs
+        const size_t P = 5, M = N - 2*P;
+        const float h[P] = { 0.6f, -0.2f, 0.1f, -0.05f, 0.02f };
+        hoNDArraySimd::halfband(M, P, 0.5f, h, &x[0], &y[P], &r[0]);
+        for (size_t i = 0; i < M; i++) {
+            std::complex<float> v = 0.5f*x[i];
+            for (size_t j = 0; j < P; j++) v += h[j]*(y[P + i - j - 1] + y[P + i + j]);
+            expect_near(v, r[i]);
+        }
+
+        // a phase of tens of turns at the end of the line
+        const double c0 = 3.37, c1 = 0.0123, c2 = 2.1e-5;
+        hoNDArraySimd::multiplyPhase(N, c0, c1, c2, &x[0], &r[0]);
+        for (size_t i = 0; i < N; i++) {
+            const double t = 2*M_PI*(c0 + i*(c1 + i*c2));
+            expect_near(x[i]*std::complex<float>((float)std::cos(t), (float)std::sin(t)), r[i]);
+        }
+
+        // x and y have zeros, which have the phase 0
+        hoNDArraySimd::phaseDifference(N, &x[0], &y[0], &r[0]);
+        for (size_t i = 0; i < N; i++) expect_near(std::polar(0.5f*(std::abs(x[i]) + std::abs(y[i])), std::arg(y[i]) - std::arg(x[i])), r[i]);
+    }
+}
+
+TEST_F(hoNDArray_simd_test, levelIsCappedAtDetected)
+{
+    hoNDArraySimd::set_level(hoNDArraySimd::SIMD_AVX512);
+    EXPECT_LE(hoNDArraySimd::level(), hoNDArraySimd::detected());
+
+    hoNDArraySimd::set_level(hoNDArraySimd::SIMD_SCALAR);
+    EXPECT_EQ(hoNDArraySimd::SIMD_SCALAR, hoNDArraySimd::level());
+}
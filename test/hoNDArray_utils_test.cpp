@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 #include <complex>
 #include <vector>
+#include <algorithm>
 
 using namespace Gadgetron;
 using testing::Types;
@@ -106,6 +107,30 @@ TYPED_TEST(hoNDArray_utils_TestReal,permuteTest){
   EXPECT_FLOAT_EQ(2, permute(&this->Array,&order)->at(851));
 }
 
+TYPED_TEST(hoNDArray_utils_TestReal,permuteAllOrdersTest){
+
+  // every element differs, so each output position checks where it was read from
+  for (size_t i = 0; i < this->Array.get_number_of_elements(); i++) {
+    this->Array.get_data_ptr()[i] = TypeParam(i);
+  }
+
+  size_t n = this->Array.get_number_of_dimensions();
+  std::vector<size_t> order(n), ind_in(n), ind_out(n);
+  for (size_t i = 0; i < n; i++) order[i] = i;
+
+  do {
+    boost::shared_ptr< hoNDArray<TypeParam> > out = permute(&this->Array,&order);
+
+    size_t errors = 0;
+    for (size_t i = 0; i < this->Array.get_number_of_elements(); i++) {
+      this->Array.calculate_index(i, ind_in);
+      for (size_t k = 0; k < n; k++) ind_out[k] = ind_in[order[k]];
+      if (out->get_data_ptr()[out->calculate_offset(ind_out)] != this->Array.get_data_ptr()[i]) errors++;
+    }
+    EXPECT_EQ(0u, errors);
+  } while (std::next_permutation(order.begin(), order.end()));
+}
+
 TYPED_TEST(hoNDArray_utils_TestReal,shiftDimTest){
 
   fill(&this->Array,TypeParam(1));
@@ -0,0 +1,113 @@
+/** \file       hoNDBSpline_test.cpp
+    \brief      Test case for the regular grid evaluation of hoNDBSpline
+*/
+
+#include "hoNDBSpline.h"
+#include "hoNDBoundaryHandler.h"
+#include "hoNDInterpolator.h"
+#include <gtest/gtest.h>
+#include <complex>
+#include <cmath>
+
+using namespace Gadgetron;
+
+class hoNDBSpline_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        sx = 31; sy = 24; sz = 7;
+
+        a1D.create(sx);
+        for (size_t i = 0; i < sx; i++) a1D(i) = std::complex<float>(std::sin(0.4f*float(i)), std::cos(0.1f*float(i)));
+
+        a3D.create(sx, sy, sz);
+        for (size_t i = 0; i < a3D.get_number_of_elements(); i++) a3D(i) = std::cos(0.2f*float(i)) - 0.005f*float(i);
+
+        // finer and coarser grids, including locations on and outside the border
+        px.resize(50); py.resize(11); pz.resize(13);
+        for (size_t n = 0; n < px.size(); n++) px[n] = -0.5f + float(sx)*float(n)/float(px.size()-1);
+        for (size_t n = 0; n < py.size(); n++) py[n] = float(sy-1)*float(n)/float(py.size()-1);
+        for (size_t n = 0; n < pz.size(); n++) pz[n] = 0.3f + 0.47f*float(n);
+    }
+
+    size_t sx, sy, sz;
+    hoNDArray< std::complex<float> > a1D;
+    hoNDArray<float> a3D;
+    std::vector<float> px, py, pz;
+};
+
+TEST_F(hoNDBSpline_test, grid1D)
+{
+    hoNDBSpline<std::complex<float>, 1> bspline;
+
+    for (unsigned int degree = 2; degree <= 5; degree++)
+    {
+        hoNDArray< std::complex<float> > coeff, res;
+        EXPECT_TRUE(bspline.computeBSplineCoefficients(a1D, degree, coeff));
+
+        std::vector< std::vector<float> > pos(1, px);
+        std::vector<unsigned int> derivative(1, 0);
+        EXPECT_TRUE(bspline.evaluateBSplineOnGrid(coeff, degree, derivative, pos, res));
+        ASSERT_EQ(res.get_number_of_elements(), px.size());
+
+        for (size_t n = 0; n < px.size(); n++)
+        {
+            std::complex<float> v = bspline.evaluateBSpline(coeff.begin(), sx, degree, 0, px[n]);
+            EXPECT_EQ(res(n), v);
+        }
+
+        // the interpolation reproduces the samples
+        for (size_t n = 0; n < sx; n++)
+        {
+            std::complex<float> v = bspline.evaluateBSpline(coeff.begin(), sx, degree, 0, float(n));
+            EXPECT_NEAR(std::abs(v - a1D(n)), 0, 1e-4);
+        }
+    }
+}
+
+TEST_F(hoNDBSpline_test, grid3D)
+{
+    hoNDBSpline<float, 3> bspline;
+
+    hoNDArray<float> coeff, res;
+    EXPECT_TRUE(bspline.computeBSplineCoefficients(a3D, 5, coeff));
+
+    std::vector< std::vector<float> > pos(3);
+    pos[0] = px; pos[1] = py; pos[2] = pz;
+
+    std::vector<unsigned int> derivative(3, 0);
+    derivative[1] = 1;
+
+    EXPECT_TRUE(bspline.evaluateBSplineOnGrid(coeff, 5, derivative, pos, res));
+    ASSERT_EQ(res.get_size(0), px.size());
+    ASSERT_EQ(res.get_size(1), py.size());
+    ASSERT_EQ(res.get_size(2), pz.size());
+
+    for (size_t z = 0; z < pz.size(); z++)
+        for (size_t y = 0; y < py.size(); y++)
+            for (size_t x = 0; x < px.size(); x++)
+            {
+                float v = bspline.evaluateBSpline(coeff.begin(), sx, sy, sz, 5, 0, 1, 0, px[x], py[y], pz[z]);
+                EXPECT_NEAR(res(x, y, z), v, 1e-4);
+            }
+}
+
+TEST_F(hoNDBSpline_test, interpolatorOnGrid)
+{
+    hoNDBoundaryHandlerBorderValue< hoNDArray<float> > bh(a3D);
+    hoNDInterpolatorBSpline< hoNDArray<float>, 3 > interp(a3D, bh, 3);
+
+    std::vector< std::vector<float> > pos(3);
+    pos[0] = px; pos[1] = py; pos[2] = pz;
+
+    hoNDArray<float> res;
+    interp.evaluateOnGrid(pos, res);
+
+    for (size_t z = 0; z < pz.size(); z++)
+        for (size_t y = 0; y < py.size(); y++)
+            for (size_t x = 0; x < px.size(); x++)
+            {
+                EXPECT_NEAR(res(x, y, z), interp(px[x], py[y], pz[z]), 1e-4);
+            }
+}
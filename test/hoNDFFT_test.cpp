@@ -1,5 +1,6 @@
 #include "hoNDFFT.h"
 #include "hoNDArray_math.h"
+#include "hoNDArray_utils.h"
 #include "complext.h"
 #include <gtest/gtest.h>
 #include <boost/random.hpp>
@@ -44,3 +45,258 @@ TYPED_TEST(hoNDFFT_test,ifftNrm2Test){
 	EXPECT_NEAR(nrm2(&this->Array2),nrm2(&this->Array),nrm2(&this->Array)*1e-2);
 
 }
+
+namespace
+{
+	// centered DFT along dimension d of a [n0 n1 n2 n3] array, straight from the definition
+	template <typename REAL> void centered_dft(hoNDArray< std::complex<REAL> >& a, size_t d, int sign)
+	{
+		hoNDArray< std::complex<REAL> > r(a);
+		std::vector<size_t> dims = *a.get_dimensions();
+		size_t stride = 1;
+		for (size_t i = 0; i < d; i++) stride *= dims[i];
+		const long long n = (long long)dims[d];
+		const long long h = n/2;
+
+		for (size_t o = 0; o < a.get_number_of_elements(); o++)
+		{
+			if ((o/stride) % n != 0) continue;
+			for (long long k = 0; k < n; k++)
+			{
+				std::complex<double> s(0);
+				for (long long m = 0; m < n; m++)
+				{
+					s += std::complex<double>(a(o + m*stride))*std::polar(1.0, sign*2.0*M_PI*double((k - h)*(m - h))/double(n));
+				}
+				r(o + k*stride) = std::complex<REAL>(s/std::sqrt(double(n)));
+			}
+		}
+		a = r;
+	}
+}
+
+TYPED_TEST(hoNDFFT_test,fftManyMatchesCenteredDFT){
+	typedef std::complex<TypeParam> C;
+
+	// odd and even sizes, transform of non-adjacent dimensions
+	hoNDArray<C> a(6, 5, 3, 4);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		a(i) = C(TypeParam(std::cos(0.3*i)), TypeParam(std::sin(0.7*i) + 0.1*(i % 5)));
+
+	hoNDArray<C> ref(a);
+	centered_dft(ref, 0, -1);
+	centered_dft(ref, 2, -1);
+
+	std::vector<size_t> dims;
+	dims.push_back(0);
+	dims.push_back(2);
+
+	hoNDArray<C> b(a);
+	hoNDFFT<TypeParam>::instance()->fft_many(b, dims, 2);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(b(i) - ref(i)), 0, 1e-4);
+
+	hoNDFFT<TypeParam>::instance()->ifft_many(b, dims);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(b(i) - a(i)), 0, 1e-4);
+}
+
+TYPED_TEST(hoNDFFT_test,fftManyStridedViewTest){
+	typedef std::complex<TypeParam> C;
+
+	hoNDArray<C> a(8, 6, 7);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		a(i) = C(TypeParam(i % 11), TypeParam(i % 3) - 1);
+
+	// columns 2..5 of every image, a view that is not contiguous
+	hoNDArrayView<C> v = hoNDArrayView<C>(a).range(1, 2, 4);
+
+	hoNDArray<C> ref(8, 4, 7);
+	for (size_t z = 0; z < 7; z++)
+		for (size_t y = 0; y < 4; y++)
+			for (size_t x = 0; x < 8; x++)
+				ref(x, y, z) = a(x, y + 2, z);
+	centered_dft(ref, 0, 1);
+	centered_dft(ref, 1, 1);
+
+	hoNDArray<C> untouched(a);
+
+	std::vector<size_t> dims;
+	dims.push_back(1);
+	dims.push_back(0);
+	hoNDFFT<TypeParam>::instance()->ifft_many(v, dims, 3);
+
+	for (size_t z = 0; z < 7; z++)
+		for (size_t y = 0; y < 6; y++)
+			for (size_t x = 0; x < 8; x++)
+			{
+				if (y >= 2 && y < 6)
+					EXPECT_NEAR(std::abs(a(x, y, z) - ref(x, y - 2, z)), 0, 1e-4);
+				else
+					EXPECT_EQ(a(x, y, z), untouched(x, y, z));
+			}
+}
+
+TYPED_TEST(hoNDFFT_test,prunedPadAndCropMatchCenteredDFT){
+	typedef std::complex<TypeParam> C;
+
+	hoNDArray<C> a(6, 5, 3, 2);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		a(i) = C(TypeParam(std::cos(0.4*i)), TypeParam(std::sin(0.9*i) - 0.2*(i % 3)));
+
+	std::vector<size_t> size(3);
+	size[0] = 9;
+	size[1] = 8;
+	size[2] = 4;
+
+	// pad, then transform the whole array
+	hoNDArray<C> ref;
+	pad<C, 3>(uint64d3(size[0], size[1], size[2]), &a, &ref);
+	centered_dft(ref, 0, 1);
+	centered_dft(ref, 1, 1);
+	centered_dft(ref, 2, 1);
+
+	hoNDArray<C> padded;
+	hoNDFFT<TypeParam>::instance()->ifft_pad(a, size, padded);
+	ASSERT_TRUE(padded.dimensions_equal(&ref));
+	for (size_t i = 0; i < ref.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(padded(i) - ref(i)), 0, 1e-4);
+
+	// transform the whole array, then crop
+	hoNDArray<C> full(padded);
+	centered_dft(full, 0, -1);
+	centered_dft(full, 1, -1);
+	centered_dft(full, 2, -1);
+	crop<C, 3>(uint64d3(6, 5, 3), &full, &ref);
+
+	std::vector<size_t> size_a(3);
+	size_a[0] = 6;
+	size_a[1] = 5;
+	size_a[2] = 3;
+
+	hoNDArray<C> cropped;
+	hoNDFFT<TypeParam>::instance()->fft_crop(padded, size_a, cropped);
+	ASSERT_TRUE(cropped.dimensions_equal(&ref));
+	for (size_t i = 0; i < ref.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(cropped(i) - ref(i)), 0, 1e-4);
+
+	// a at a corner instead of the centre
+	std::vector<size_t> offset(3);
+	offset[0] = 3;
+	offset[1] = 0;
+	offset[2] = 1;
+
+	ref.create(9, 8, 4, 2);
+	ref.fill(C(0));
+	for (size_t n = 0; n < 2; n++)
+		for (size_t z = 0; z < 3; z++)
+			for (size_t y = 0; y < 5; y++)
+				for (size_t x = 0; x < 6; x++)
+					ref(x + 3, y, z + 1, n) = a(x, y, z, n);
+	centered_dft(ref, 0, 1);
+	centered_dft(ref, 1, 1);
+	centered_dft(ref, 2, 1);
+
+	hoNDFFT<TypeParam>::instance()->ifft_pad(a, size, offset, padded);
+	for (size_t i = 0; i < ref.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(padded(i) - ref(i)), 0, 1e-4);
+
+	// and back, the same window of the transform
+	hoNDFFT<TypeParam>::instance()->fft_crop(padded, size_a, offset, cropped);
+	for (size_t i = 0; i < a.get_number_of_elements(); i++)
+		EXPECT_NEAR(std::abs(cropped(i) - a(i)), 0, 1e-4);
+}
+
+TYPED_TEST(hoNDFFT_test,centeredFFTEvenAndOddSizes){
+	typedef std::complex<TypeParam> C;
+
+	// 8 and 4 take the checkerboard path, with 6 the sign of (-1)^(n/2) matters, 5 falls back to the shifts
+	size_t sizes[][3] = { {8, 4, 6}, {6, 10, 4}, {5, 4, 6}, {8, 5, 3} };
+
+	for (size_t t = 0; t < sizeof(sizes)/sizeof(sizes[0]); t++)
+	{
+		hoNDArray<C> a(sizes[t][0], sizes[t][1], sizes[t][2], 2);
+		for (size_t i = 0; i < a.get_number_of_elements(); i++)
+			a(i) = C(TypeParam(std::sin(0.9*i)), TypeParam(std::cos(0.4*i)));
+
+		for (size_t D = 1; D <= 3; D++)
+		{
+			hoNDArray<C> ref(a);
+			for (size_t d = 0; d < D; d++) centered_dft(ref, d, -1);
+
+			hoNDArray<C> b(a), r;
+			if (D == 1) { hoNDFFT<TypeParam>::instance()->fft1c(b); hoNDFFT<TypeParam>::instance()->fft1c(a, r); }
+			else if (D == 2) { hoNDFFT<TypeParam>::instance()->fft2c(b); hoNDFFT<TypeParam>::instance()->fft2c(a, r); }
+			else { hoNDFFT<TypeParam>::instance()->fft3c(b); hoNDFFT<TypeParam>::instance()->fft3c(a, r); }
+
+			for (size_t i = 0; i < a.get_number_of_elements(); i++)
+			{
+				EXPECT_NEAR(std::abs(b(i) - ref(i)), 0, 1e-4) << "D " << D << " case " << t;
+				EXPECT_NEAR(std::abs(r(i) - ref(i)), 0, 1e-4) << "D " << D << " case " << t;
+			}
+
+			if (D == 1) hoNDFFT<TypeParam>::instance()->ifft1c(b);
+			else if (D == 2) hoNDFFT<TypeParam>::instance()->ifft2c(b);
+			else hoNDFFT<TypeParam>::instance()->ifft3c(b);
+
+			for (size_t i = 0; i < a.get_number_of_elements(); i++)
+				EXPECT_NEAR(std::abs(b(i) - a(i)), 0, 1e-4) << "D " << D << " case " << t;
+		}
+	}
+}
+
+TYPED_TEST(hoNDFFT_test,realToComplexMatchesComplexFFT){
+	typedef std::complex<TypeParam> C;
+
+	size_t sizes[][3] = { {8, 6, 4}, {7, 5, 3}, {6, 9, 4} };
+
+	for (size_t t = 0; t < sizeof(sizes)/sizeof(sizes[0]); t++)
+	{
+		const size_t n0 = sizes[t][0];
+		hoNDArray<TypeParam> x(n0, sizes[t][1], sizes[t][2], 2);
+		hoNDArray<C> xc(x.get_dimensions());
+		for (size_t i = 0; i < x.get_number_of_elements(); i++)
+		{
+			x(i) = TypeParam(std::sin(0.9*i) + 0.1*(i % 7));
+			xc(i) = C(x(i), 0);
+		}
+
+		for (size_t D = 1; D <= 3; D++)
+		{
+			for (int centered = 0; centered < 2; centered++)
+			{
+				hoNDArray<C> full(xc), half;
+				if (centered)
+				{
+					if (D == 1) hoNDFFT<TypeParam>::instance()->fft1c(full);
+					else if (D == 2) hoNDFFT<TypeParam>::instance()->fft2c(full);
+					else hoNDFFT<TypeParam>::instance()->fft3c(full);
+				}
+				else
+				{
+					if (D == 1) hoNDFFT<TypeParam>::instance()->fft1(full);
+					else if (D == 2) hoNDFFT<TypeParam>::instance()->fft2(full);
+					else hoNDFFT<TypeParam>::instance()->fft3(full);
+				}
+
+				hoNDFFT<TypeParam>::instance()->fft_r2c(x, half, D, centered != 0);
+				ASSERT_EQ(half.get_size(0), n0/2 + 1);
+
+				// frequency k of dimension 0 sits at (k + n0/2) % n0 of the centered spectrum
+				for (size_t i = 0; i < half.get_number_of_elements(); i++)
+				{
+					const size_t k = i % (n0/2 + 1);
+					const size_t rest = i / (n0/2 + 1);
+					const size_t j = (centered ? (k + n0/2) % n0 : k) + rest*n0;
+					EXPECT_NEAR(std::abs(half(i) - full(j)), 0, 1e-4) << "D " << D << " case " << t << " centered " << centered;
+				}
+
+				hoNDArray<TypeParam> back;
+				hoNDFFT<TypeParam>::instance()->ifft_c2r(half, back, D, n0, centered != 0);
+				ASSERT_TRUE(back.dimensions_equal(&x));
+				for (size_t i = 0; i < x.get_number_of_elements(); i++)
+					EXPECT_NEAR(back(i), x(i), 1e-4) << "D " << D << " case " << t << " centered " << centered;
+			}
+		}
+	}
+}
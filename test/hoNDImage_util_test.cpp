@@ -0,0 +1,116 @@
+#include "hoNDArray.h"
+#include "hoNDImage_util.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace Gadgetron;
+
+TEST(hoNDImage_util, filterGaussianMultipleMatchesFilterGaussian)
+{
+    std::vector< std::vector<size_t> > sizes(3);
+    sizes[0].push_back(67); sizes[0].push_back(45);
+    sizes[1].push_back(37); sizes[1].push_back(29); sizes[1].push_back(11);
+    sizes[2].push_back(9); sizes[2].push_back(20); sizes[2].push_back(1); sizes[2].push_back(5);
+
+    double sigma[4] = { 2.5, 1.5, 3.0, 0.8 };
+
+    for (size_t s = 0; s < sizes.size(); s++)
+    {
+        std::vector< hoNDArray<double> > a(3), b(3);
+        std::vector< hoNDArray<double>* > pa(3);
+
+        for (size_t k = 0; k < a.size(); k++)
+        {
+            a[k].create(sizes[s]);
+            for (size_t i = 0; i < a[k].get_number_of_elements(); i++) a[k](i) = std::sin(0.37*i*(k + 1)) + 0.01*(i % 13);
+            b[k] = a[k];
+            pa[k] = &a[k];
+        }
+
+        EXPECT_TRUE(filterGaussianMultiple(pa, sigma));
+
+        size_t max_size = 0;
+        for (size_t d = 0; d < sizes[s].size(); d++) max_size = std::max(max_size, sizes[s][d]);
+        std::vector<double> mem(2*max_size);
+
+        for (size_t k = 0; k < a.size(); k++)
+        {
+            // with scratch memory filterGaussian filters line by line
+            hoNDArray<double> c(b[k]);
+            EXPECT_TRUE(filterGaussian(b[k], sigma, &mem[0]));
+            EXPECT_TRUE(filterGaussian(c, sigma));
+            for (size_t i = 0; i < a[k].get_number_of_elements(); i++)
+            {
+                EXPECT_NEAR(b[k](i), a[k](i), 1e-12);
+                EXPECT_NEAR(b[k](i), c(i), 1e-12);
+            }
+        }
+    }
+}
+
+TEST(hoNDImage_util, filterGaussianRecursiveLargeSigma)
+{
+    // the impulse response is close to the sampled gaussian for any sigma
+    const double sigmas[3] = { 4.0, 12.0, 40.0 };
+
+    for (size_t s = 0; s < 3; s++)
+    {
+        const double sg = sigmas[s];
+        const size_t N = (size_t)(16*sg) + 1, c = N/2;
+
+        hoNDArray<float> a(N, 3);
+        a.fill(0.0f);
+        for (size_t y = 0; y < 3; y++) a(c, y) = 1.0f;
+
+        float sigma[2] = { (float)sg, 0.0f };
+        EXPECT_TRUE(filterGaussianRecursive(a, sigma));
+
+        const double peak = 1.0/(std::sqrt(2*M_PI)*sg);
+        double sum = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            double x = (double)i - (double)c;
+            EXPECT_NEAR(a(i, 1), peak*std::exp(-x*x/(2*sg*sg)), 0.035*peak);
+            EXPECT_FLOAT_EQ(a(i, 0), a(i, 2));
+            sum += a(i, 1);
+        }
+        EXPECT_NEAR(1.0, sum, 1e-3);
+    }
+}
+
+TEST(hoNDImage_util, filterGaussianRecursiveBorderValue)
+{
+    // the same as filtering the image padded with its border values, along the first and the second dimension
+    const size_t sx = 23, sy = 31, pad = 400;
+    double sigma[2] = { 6.0, 9.0 };
+
+    hoNDArray<double> a(sx, sy), b(sx + 2*pad, sy + 2*pad);
+    for (size_t i = 0; i < a.get_number_of_elements(); i++) a(i) = std::sin(0.37*i) + 0.01*(i % 13);
+
+    for (size_t y = 0; y < b.get_size(1); y++)
+    {
+        for (size_t x = 0; x < b.get_size(0); x++)
+        {
+            size_t xa = (x < pad) ? 0 : std::min(x - pad, sx - 1);
+            size_t ya = (y < pad) ? 0 : std::min(y - pad, sy - 1);
+            b(x, y) = a(xa, ya);
+        }
+    }
+
+    EXPECT_TRUE(filterGaussianRecursive(a, sigma));
+    EXPECT_TRUE(filterGaussianRecursive(b, sigma));
+
+    for (size_t y = 0; y < sy; y++)
+    {
+        for (size_t x = 0; x < sx; x++) EXPECT_NEAR(b(x + pad, y + pad), a(x, y), 1e-9);
+    }
+
+    // a constant image stays constant, up to the rounding in float of the recursions with poles close to one
+    hoNDArray<float> c(17, 5, 4);
+    c.fill(3.0f);
+    float sigma3[3] = { 8.0f, 2.0f, 30.0f };
+    EXPECT_TRUE(filterGaussianRecursive(c, sigma3));
+    for (size_t i = 0; i < c.get_number_of_elements(); i++) EXPECT_NEAR(3.0f, c(i), 1e-3f);
+}
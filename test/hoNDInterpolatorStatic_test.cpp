@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <type_traits>
+
+#include "hoNDImage.h"
+#include "hoNDBoundaryHandler.h"
+#include "hoNDInterpolator.h"
+#include "hoNDInterpolatorStatic.h"
+#include "hoNDImage_util.h"
+
+using namespace Gadgetron;
+
+namespace
+{
+    template <unsigned int D>
+    void fillImage(hoNDImage<float, D>& im, const size_t* dim)
+    {
+        std::vector<size_t> d(dim, dim+D);
+        im.create(d);
+        for (size_t i = 0; i < im.get_number_of_elements(); i++) im(i) = std::sin(0.3f*float(i)) + 0.01f*float(i);
+    }
+
+    /// points inside and around the image, within one size of the border so that mirroring stays in range
+    template <unsigned int D>
+    std::vector< std::vector<float> > samplePoints(const size_t* dim, size_t N)
+    {
+        std::vector< std::vector<float> > pos(N, std::vector<float>(D));
+        for (size_t n = 0; n < N; n++) {
+            for (unsigned int d = 0; d < D; d++) {
+                size_t k = (n*(37 + 16*d) + 7*d) % 101;
+                pos[n][d] = -float(dim[d] - 1) + float(3*(dim[d] - 1))*float(k)/100.0f;
+            }
+        }
+        return pos;
+    }
+
+    template <unsigned int D, unsigned int Order, GT_BOUNDARY_CONDITION BC>
+    void compareWithVirtual(const size_t* dim)
+    {
+        SCOPED_TRACE(getBoundaryHandlerName(BC));
+        typedef hoNDImage<float, D> ImageType;
+
+        ImageType im;
+        fillImage<D>(im, dim);
+
+        boost::shared_ptr< hoNDBoundaryHandler<ImageType> > bh(createBoundaryHandler<ImageType>(BC));
+        bh->setArray(im);
+
+        typedef typename std::conditional<Order == 0, hoNDInterpolatorNearestNeighbor<ImageType>, hoNDInterpolatorLinear<ImageType> >::type InterpolatorType;
+        boost::shared_ptr< hoNDInterpolator<ImageType> > interp(new InterpolatorType(im, *bh));
+
+        hoNDInterpolatorStatic<ImageType, D, Order, BC> interpStatic(im);
+
+        std::vector< std::vector<float> > pos = samplePoints<D>(dim, 1021);
+        for (size_t n = 0; n < pos.size(); n++) {
+            const float* p = &pos[n][0];
+
+            if (D == 2) EXPECT_NEAR((*interp)(p[0], p[1]), interpStatic(p[0], p[1]), 1e-5f);
+            if (D == 3) EXPECT_NEAR((*interp)(p[0], p[1], p[2]), interpStatic(p[0], p[1], p[2]), 1e-5f);
+            EXPECT_NEAR((*interp)(pos[n]), interpStatic(pos[n]), 1e-5f);
+        }
+    }
+
+    template <unsigned int D, unsigned int Order>
+    void compareAllBoundaries(const size_t* dim)
+    {
+        compareWithVirtual<D, Order, GT_BOUNDARY_CONDITION_FIXEDVALUE>(dim);
+        compareWithVirtual<D, Order, GT_BOUNDARY_CONDITION_BORDERVALUE>(dim);
+        compareWithVirtual<D, Order, GT_BOUNDARY_CONDITION_PERIODIC>(dim);
+        compareWithVirtual<D, Order, GT_BOUNDARY_CONDITION_MIRROR>(dim);
+    }
+}
+
+TEST(hoNDInterpolatorStatic, nearestNeighborMatchesVirtualInterpolator)
+{
+    const size_t dim[4] = { 23, 17, 9, 4 };
+    compareAllBoundaries<2, 0>(dim);
+    compareAllBoundaries<3, 0>(dim);
+    compareAllBoundaries<4, 0>(dim);
+}
+
+TEST(hoNDInterpolatorStatic, linearMatchesVirtualInterpolator)
+{
+    const size_t dim[4] = { 23, 17, 9, 4 };
+    compareAllBoundaries<2, 1>(dim);
+    compareAllBoundaries<3, 1>(dim);
+    compareAllBoundaries<4, 1>(dim);
+}
+
+TEST(hoNDInterpolatorStatic, resampleImageByTypeMatchesVirtualInterpolator)
+{
+    const size_t dim[3] = { 31, 22, 7 };
+    hoNDImage<float, 3> im;
+    fillImage<3>(im, dim);
+
+    std::vector<size_t> dim_out(3);
+    dim_out[0] = 45; dim_out[1] = 13; dim_out[2] = 10;
+
+    const GT_IMAGE_INTERPOLATOR types[] = { GT_IMAGE_INTERPOLATOR_NEARESTNEIGHBOR, GT_IMAGE_INTERPOLATOR_LINEAR };
+    for (size_t t = 0; t < 2; t++) {
+        hoNDBoundaryHandlerMirror< hoNDImage<float, 3> > bh(im);
+        boost::shared_ptr< hoNDInterpolator< hoNDImage<float, 3> > > interp(createInterpolator<hoNDImage<float, 3>, 3>(types[t]));
+        interp->setArray(im);
+        interp->setBoundaryHandler(bh);
+
+        hoNDImage<float, 3> ref, res;
+        EXPECT_TRUE(resampleImage(im, *interp, dim_out, ref));
+        EXPECT_TRUE(resampleImage(im, types[t], GT_BOUNDARY_CONDITION_MIRROR, dim_out, res));
+
+        ASSERT_TRUE(res.dimensions_equal(&ref));
+        for (size_t i = 0; i < ref.get_number_of_elements(); i++) EXPECT_NEAR(ref(i), res(i), 1e-5f);
+    }
+}
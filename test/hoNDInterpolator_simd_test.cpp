@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "hoNDInterpolator_simd.h"
+#include "hoNDArray_simd.h"
+#include "hoNDImage.h"
+#include "hoNDBoundaryHandler.h"
+#include "hoNDInterpolator.h"
+
+using namespace Gadgetron;
+
+class hoNDInterpolator_simd_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        sx = 23; sy = 17; sz = 9;
+
+        std::vector<size_t> dim2D(2);
+        dim2D[0] = sx; dim2D[1] = sy;
+        im2D.create(dim2D);
+        for (size_t i = 0; i < im2D.get_number_of_elements(); i++) im2D(i) = std::sin(0.3f*float(i)) + 0.01f*float(i);
+
+        std::vector<size_t> dim3D(3);
+        dim3D[0] = sx; dim3D[1] = sy; dim3D[2] = sz;
+        im3D.create(dim3D);
+        for (size_t i = 0; i < im3D.get_number_of_elements(); i++) im3D(i) = std::cos(0.2f*float(i)) - 0.005f*float(i);
+
+        // odd number of points, a part of them outside the interior, including the far border
+        N = 1021;
+        x.resize(N); y.resize(N); z.resize(N);
+        for (size_t n = 0; n < N; n++) {
+            x[n] = -2.0f + float(sx + 3)*float((n*37) % 101)/100.0f;
+            y[n] = -2.0f + float(sy + 3)*float((n*53) % 103)/102.0f;
+            z[n] = -1.0f + float(sz + 1)*float((n*71) % 107)/106.0f;
+        }
+        x[1] = float(sx - 1);
+        x[2] = std::numeric_limits<float>::quiet_NaN();
+        y[3] = 1e20f;
+    }
+
+    virtual void TearDown()
+    {
+        hoNDArraySimd::set_level(hoNDArraySimd::detected());
+    }
+
+    size_t sx, sy, sz, N;
+    hoNDImage<float, 2> im2D;
+    hoNDImage<float, 3> im3D;
+    std::vector<float> x, y, z;
+};
+
+TEST_F(hoNDInterpolator_simd_test, interiorPointsMatchLinearInterpolator)
+{
+    hoNDBoundaryHandlerBorderValue< hoNDImage<float, 2> > bh2D(im2D);
+    hoNDInterpolatorLinear< hoNDImage<float, 2> > interp2D(im2D, bh2D);
+
+    hoNDBoundaryHandlerBorderValue< hoNDImage<float, 3> > bh3D(im3D);
+    hoNDInterpolatorLinear< hoNDImage<float, 3> > interp3D(im3D, bh3D);
+
+    const hoNDArraySimd::Level levels[] = { hoNDArraySimd::SIMD_SCALAR, hoNDArraySimd::SIMD_AVX2, hoNDArraySimd::SIMD_AVX512 };
+
+    for (size_t l = 0; l < sizeof(levels)/sizeof(levels[0]); l++) {
+        hoNDArraySimd::set_level(levels[l]);
+        SCOPED_TRACE(hoNDArraySimd::name(hoNDArraySimd::level()));
+
+        std::vector<float> r(N);
+        size_t interior = 0;
+
+        hoNDInterpolatorSimd::linear2D(im2D.begin(), sx, sy, N, &x[0], &y[0], &r[0]);
+        for (size_t n = 0; n < N; n++) {
+            if (!hoNDInterpolatorSimd::interior2D(sx, sy, x[n], y[n])) continue;
+            interior++;
+            EXPECT_NEAR(interp2D(x[n], y[n]), r[n], 1e-5f);
+        }
+
+        hoNDInterpolatorSimd::linear3D(im3D.begin(), sx, sy, sz, N, &x[0], &y[0], &z[0], &r[0]);
+        for (size_t n = 0; n < N; n++) {
+            if (!hoNDInterpolatorSimd::interior3D(sx, sy, sz, x[n], y[n], z[n])) continue;
+            interior++;
+            EXPECT_NEAR(interp3D(x[n], y[n], z[n]), r[n], 1e-5f);
+        }
+
+        EXPECT_GT(interior, N/2);
+    }
+}
+
+TEST_F(hoNDInterpolator_simd_test, interiorExcludesTheBorder)
+{
+    EXPECT_TRUE(hoNDInterpolatorSimd::interior2D(sx, sy, 0.0f, 0.0f));
+    EXPECT_TRUE(hoNDInterpolatorSimd::interior2D(sx, sy, float(sx) - 1.5f, float(sy) - 1.5f));
+    EXPECT_FALSE(hoNDInterpolatorSimd::interior2D(sx, sy, float(sx - 1), 0.0f));
+    EXPECT_FALSE(hoNDInterpolatorSimd::interior2D(sx, sy, -0.01f, 0.0f));
+    EXPECT_FALSE(hoNDInterpolatorSimd::interior2D(sx, sy, std::numeric_limits<float>::quiet_NaN(), 0.0f));
+    EXPECT_FALSE(hoNDInterpolatorSimd::interior3D(sx, sy, sz, 0.0f, 0.0f, float(sz - 1)));
+}
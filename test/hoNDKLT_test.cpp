@@ -0,0 +1,99 @@
+#include "hoNDKLT.h"
+#include "hoNDArray_math.h"
+#include <gtest/gtest.h>
+#include <boost/random.hpp>
+
+using namespace Gadgetron;
+using testing::Types;
+
+template<typename REAL> class hoNDKLT_test : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        boost::random::mt19937 rng;
+        boost::random::normal_distribution<REAL> gauss(0, 1);
+
+        M = 2000;
+        N = 32;
+        R = 4;
+
+        // a few strong modes with decaying amplitudes and a little noise, [M N]
+        Array.create(M, N);
+        Array.fill(std::complex<REAL>(0));
+
+        for (size_t r = 0; r < R; r++)
+        {
+            REAL amp = REAL(10) / (r + 1);
+
+            std::vector< std::complex<REAL> > u(M), v(N);
+            for (size_t m = 0; m < M; m++) u[m] = std::complex<REAL>(gauss(rng), gauss(rng));
+            for (size_t n = 0; n < N; n++) v[n] = std::complex<REAL>(gauss(rng), gauss(rng));
+
+            for (size_t n = 0; n < N; n++)
+                for (size_t m = 0; m < M; m++)
+                    Array(m, n) += amp * u[m] * v[n];
+        }
+
+        for (size_t i = 0; i < Array.get_number_of_elements(); i++)
+            Array(i) += REAL(0.01) * std::complex<REAL>(gauss(rng), gauss(rng));
+    }
+
+    size_t M, N, R;
+    hoNDArray< std::complex<REAL> > Array;
+};
+
+typedef Types<float, double> realImplementations;
+TYPED_TEST_CASE(hoNDKLT_test, realImplementations);
+
+TYPED_TEST(hoNDKLT_test, randomized)
+{
+    hoNDKLT< std::complex<TypeParam> > full, rnd;
+    full.prepare(this->Array, (size_t)1, (size_t)0, true);
+    rnd.prepare_randomized(this->Array, (size_t)1, this->R, true);
+
+    hoNDArray< std::complex<TypeParam> > Ef, Er;
+    full.eigen_value(Ef);
+    rnd.eigen_value(Er);
+
+    EXPECT_EQ(Er.get_number_of_elements(), this->R);
+    EXPECT_EQ(rnd.output_length(), this->R);
+
+    for (size_t r = 0; r < this->R; r++)
+    {
+        EXPECT_NEAR(std::abs(Er(r)) / std::abs(Ef(r)), 1, 0.001);
+    }
+
+    hoNDArray< std::complex<TypeParam> > out;
+    rnd.transform(this->Array, out, 1);
+    EXPECT_EQ(out.get_size(0), this->M);
+    EXPECT_EQ(out.get_size(1), this->R);
+}
+
+TYPED_TEST(hoNDKLT_test, update)
+{
+    hoNDKLT< std::complex<TypeParam> > full, inc;
+    full.prepare(this->Array, (size_t)1, (size_t)0, false);
+
+    size_t half = this->M / 2;
+    hoNDArray< std::complex<TypeParam> > first(half, this->N), second(this->M - half, this->N);
+    for (size_t n = 0; n < this->N; n++)
+    {
+        for (size_t m = 0; m < half; m++) first(m, n) = this->Array(m, n);
+        for (size_t m = half; m < this->M; m++) second(m - half, n) = this->Array(m, n);
+    }
+
+    inc.update(first, 1);
+    inc.update(second, 1);
+
+    hoNDArray< std::complex<TypeParam> > Ef, Ei;
+    full.eigen_value(Ef);
+    inc.eigen_value(Ei);
+
+    ASSERT_EQ(Ei.get_number_of_elements(), this->N);
+
+    for (size_t r = 0; r < this->R; r++)
+    {
+        EXPECT_NEAR(std::abs(Ei(r)) / std::abs(Ef(r)), 1, 0.001);
+    }
+}
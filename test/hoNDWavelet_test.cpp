@@ -3,6 +3,7 @@
 #include "hoNDArray_math.h"
 #include <gtest/gtest.h>
 #include <boost/random.hpp>
+#include <thread>
 
 using namespace Gadgetron;
 using testing::Types;
@@ -152,3 +153,76 @@ TYPED_TEST(hoNDWavelet_test, hoNDRedundantWaveletTest3D)
     EXPECT_NEAR(v, 0, 0.001);
 }
 
+
+TYPED_TEST(hoNDWavelet_test, hoNDRedundantWaveletBatchMatchesSingle)
+{
+    Gadgetron::hoNDRedundantWavelet< std::complex<TypeParam> > wav;
+    wav.compute_wavelet_filter("db3");
+
+    size_t RO = 128, E1 = 128, num = 128;
+    size_t level = 2;
+    size_t W = 1 + 3 * level;
+
+    hoNDArray< std::complex<TypeParam> > r(RO, E1, W, num);
+    wav.transform(this->Array.begin(), r.begin(), RO, E1, 1, num, 2, level, true);
+
+    hoNDArray< std::complex<TypeParam> > in(RO, E1, this->Array.begin() + 17 * RO*E1);
+    hoNDArray< std::complex<TypeParam> > r17, diff;
+    wav.transform(in, r17, 2, level, true);
+
+    hoNDArray< std::complex<TypeParam> > rb17(RO, E1, W, r.begin() + 17 * RO*E1*W);
+    Gadgetron::subtract(r17, rb17, diff);
+
+    TypeParam v(0);
+    Gadgetron::norm2(diff, v);
+    EXPECT_NEAR(v, 0, 1e-6);
+
+    hoNDArray< std::complex<TypeParam> > rr(RO, E1, num);
+    wav.transform(r.begin(), rr.begin(), RO, E1, 1, num, 2, level, false);
+
+    Gadgetron::subtract(this->Array, rr, diff);
+    Gadgetron::norm2(diff, v);
+    EXPECT_NEAR(v, 0, 0.001);
+}
+
+TYPED_TEST(hoNDWavelet_test, hoNDRedundantWaveletConcurrentTransforms)
+{
+    Gadgetron::hoNDRedundantWavelet< std::complex<TypeParam> > wav;
+    wav.compute_wavelet_filter("db2");
+
+    size_t RO = 128, E1 = 128, E2 = 16;
+    size_t level = 1;
+    size_t N = RO*E1*E2;
+    size_t W = 1 + 7 * level;
+
+    // four threads share the wavelet object, each transforming its own part of the array
+    hoNDArray< std::complex<TypeParam> > r(RO, E1, E2, W, 8);
+    hoNDArray< std::complex<TypeParam> > rr(RO, E1, E2, 8);
+
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < 4; k++)
+    {
+        threads.push_back(std::thread([&, k]() {
+            wav.transform(this->Array.begin() + 2 * k*N, r.begin() + 2 * k*N*W, RO, E1, E2, 2, 3, level, true);
+            wav.transform(r.begin() + 2 * k*N*W, rr.begin() + 2 * k*N, RO, E1, E2, 2, 3, level, false);
+        }));
+    }
+
+    for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+
+    hoNDArray< std::complex<TypeParam> > ref(RO, E1, E2, W), diff;
+    hoNDArray< std::complex<TypeParam> > in(RO, E1, E2, this->Array.begin() + 5 * N);
+    wav.transform(in, ref, 3, level, true);
+
+    hoNDArray< std::complex<TypeParam> > r5(RO, E1, E2, W, r.begin() + 5 * N*W);
+    Gadgetron::subtract(ref, r5, diff);
+
+    TypeParam v(0);
+    Gadgetron::norm2(diff, v);
+    EXPECT_NEAR(v, 0, 1e-6);
+
+    hoNDArray< std::complex<TypeParam> > a(RO, E1, E2, 8, this->Array.begin());
+    Gadgetron::subtract(a, rr, diff);
+    Gadgetron::norm2(diff, v);
+    EXPECT_NEAR(v, 0, 0.001);
+}
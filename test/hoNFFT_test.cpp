@@ -138,3 +138,110 @@ TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, randomTestOne)
 
     EXPECT_LE(v/norm_ref, 0.00001);
 }
+
+TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, batchedChannelsMatchSingleChannels)
+{
+    typedef float T;
+
+    size_t num = 4000;
+    size_t CHA = 4;
+
+    hoNDArray<vector_td<T, 2>> traj(num);
+    hoNDArray< std::complex<T> > data(num, CHA);
+    hoNDArray< T > w(num);
+
+    for(size_t n=0; n<num; n++)
+    {
+        T r = T(0.49)*n/num;
+        T phi = T(0.05)*n;
+        traj(n)[0] = r*std::cos(phi);
+        traj(n)[1] = r*std::sin(phi);
+        w(n) = r + T(0.01);
+        for (size_t cha=0; cha<CHA; cha++)
+            data(n, cha) = std::complex<T>(std::cos(T(0.001)*n*(cha+1)), std::sin(T(0.002)*n+cha));
+    }
+
+    vector_td< size_t, 2 > dims;
+    dims[0] = 64;
+    dims[1] = 64;
+
+    hoNFFT_plan<T, 2> plan(dims, 1.5, 5.5);
+    plan.preprocess(traj);
+
+    size_t G = (size_t)(1.5*dims[0]);
+
+    hoNDArray< std::complex<T> > dataBatch(data);
+    hoNDArray< std::complex<T> > resBatch(G, G, CHA);
+    plan.compute(dataBatch, resBatch, w, hoNFFT_plan<T, 2>::NFFT_BACKWARDS_NC2C);
+
+    for (size_t cha=0; cha<CHA; cha++)
+    {
+        hoNDArray< std::complex<T> > dataCha(num);
+        std::copy(data.begin()+cha*num, data.begin()+(cha+1)*num, dataCha.begin());
+
+        hoNDArray< std::complex<T> > resCha(G, G);
+        plan.compute(dataCha, resCha, w, hoNFFT_plan<T, 2>::NFFT_BACKWARDS_NC2C);
+
+        for (size_t i=0; i<G*G; i++)
+        {
+            EXPECT_FLOAT_EQ(resCha[i].real(), resBatch[cha*G*G+i].real());
+            EXPECT_FLOAT_EQ(resCha[i].imag(), resBatch[cha*G*G+i].imag());
+        }
+    }
+}
+
+TYPED_TEST(hoNFFT_2D_NC2C_BACKWARDS, specialisedFootprintsMatchSparseMatrix)
+{
+    typedef float T;
+
+    size_t num = 3000;
+
+    hoNDArray<vector_td<T, 2>> traj(num);
+    hoNDArray< std::complex<T> > data(num);
+
+    for(size_t n=0; n<num; n++)
+    {
+        T r = T(0.49)*n/num;
+        T phi = T(0.07)*n;
+        traj(n)[0] = r*std::cos(phi);
+        traj(n)[1] = r*std::sin(phi);
+        data(n) = std::complex<T>(std::cos(T(0.003)*n), std::sin(T(0.005)*n));
+    }
+
+    vector_td< size_t, 2 > dims;
+    dims[0] = 48;
+    dims[1] = 48;
+
+    size_t G = (size_t)(1.5*dims[0]);
+
+    // 3, 4, 5, 6 and 8 have their own convolutions, 7 takes the generic one; the sparse matrices are always generic
+    const T widths[] = { 3, 4, 5, 6, 7, 8 };
+    for (size_t t=0; t<sizeof(widths)/sizeof(T); t++)
+    {
+        hoNFFT_plan<T, 2> plan(dims, 1.5, widths[t]);
+        hoNFFT_plan<T, 2> planSparse(dims, 1.5, widths[t]);
+        plan.preprocess(traj, hoNFFT_plan<T, 2>::NFFT_PREP_CONVOLVE);
+        planSparse.preprocess(traj, hoNFFT_plan<T, 2>::NFFT_PREP_SPARSE_MATRIX);
+
+        hoNDArray< std::complex<T> > d(data), dSparse(data);
+        hoNDArray< std::complex<T> > m(G, G), mSparse(G, G);
+        plan.convolve(d, m, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+        planSparse.convolve(dSparse, mSparse, hoNFFT_plan<T, 2>::NFFT_CONV_NC2C);
+
+        for (size_t i=0; i<G*G; i++)
+        {
+            EXPECT_NEAR(m[i].real(), mSparse[i].real(), 1e-4);
+            EXPECT_NEAR(m[i].imag(), mSparse[i].imag(), 1e-4);
+        }
+
+        hoNDArray< std::complex<T> > s(num), sSparse(num);
+        plan.convolve(m, s, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+        planSparse.convolve(m, sSparse, hoNFFT_plan<T, 2>::NFFT_CONV_C2NC);
+
+        for (size_t i=0; i<num; i++)
+        {
+            EXPECT_NEAR(s[i].real(), sSparse[i].real(), 1e-3);
+            EXPECT_NEAR(s[i].imag(), sSparse[i].imag(), 1e-3);
+        }
+    }
+}
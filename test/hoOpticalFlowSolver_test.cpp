@@ -0,0 +1,74 @@
+#include "hoHSOpticalFlowSolver.h"
+#include "hoCKOpticalFlowSolver.h"
+
+#include <gtest/gtest.h>
+
+using namespace Gadgetron;
+
+namespace
+{
+    template<class SOLVER> class core_solver_access : public SOLVER
+    {
+    public:
+        boost::shared_ptr< hoNDArray<float> > run(hoNDArray<float>* gradient_image) { return this->core_solver(gradient_image, 0x0); }
+    };
+
+    // gradient image [X Y batch D+1] of a uniform motion along x with the temporal gradient -vx, and a varying y gradient
+    hoNDArray<float> uniform_motion_gradient(size_t X, size_t Y, size_t B, float vx)
+    {
+        hoNDArray<float> g(X, Y, B, 3);
+        for (size_t b = 0; b < B; b++)
+            for (size_t y = 0; y < Y; y++)
+                for (size_t x = 0; x < X; x++)
+                {
+                    g(x, y, b, 0) = 1.0f;
+                    g(x, y, b, 1) = 0.1f*(float)((x + 2 * y) % 5);
+                    g(x, y, b, 2) = -vx;
+                }
+        return g;
+    }
+}
+
+TEST(hoOpticalFlowSolver, hornSchunckConvergesToUniformMotion)
+{
+    hoNDArray<float> g = uniform_motion_gradient(17, 12, 2, 0.5f);
+
+    for (int n = 0; n < 2; n++)
+    {
+        core_solver_access< hoHSOpticalFlowSolver<float, 2> > solver;
+        solver.set_limit(1e-6f);
+        solver.set_max_num_iterations_per_level(2000);
+        solver.set_sor_relaxation(n == 0 ? 1.0f : 1.5f);
+        solver.set_convergence_check_interval(n == 0 ? 1 : 5);
+
+        boost::shared_ptr< hoNDArray<float> > u = solver.run(&g);
+        ASSERT_EQ(17 * 12 * 2 * 2, u->get_number_of_elements());
+
+        for (size_t i = 0; i < 17 * 12 * 2; i++)
+        {
+            EXPECT_NEAR(0.5f, (*u)(i), 1e-3f);
+            EXPECT_NEAR(0.0f, (*u)(i + 17 * 12 * 2), 1e-3f);
+        }
+    }
+}
+
+TEST(hoOpticalFlowSolver, corneliusKanadeSatisfiesConstraint)
+{
+    hoNDArray<float> g = uniform_motion_gradient(16, 13, 1, 0.25f);
+
+    core_solver_access< hoCKOpticalFlowSolver<float, 2> > solver;
+    solver.set_limit(1e-7f);
+    solver.set_max_num_iterations_per_level(5000);
+    solver.set_sor_relaxation(1.2f);
+
+    boost::shared_ptr< hoNDArray<float> > u = solver.run(&g);
+    ASSERT_EQ(16 * 13 * 3, u->get_number_of_elements());
+
+    // the displacements and the intensity change explain the temporal gradient
+    const size_t N = 16 * 13;
+    for (size_t i = 0; i < N; i++)
+    {
+        float r = (*u)(i)*g(i) + (*u)(i + N)*g(i + N) + g(i + 2 * N) - (*u)(i + 2 * N);
+        EXPECT_NEAR(0.0f, r, 2e-3f);
+    }
+}
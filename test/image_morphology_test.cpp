@@ -83,3 +83,139 @@ TYPED_TEST(image_morphology_test, bwlabel)
     EXPECT_EQ(areas[2], (end_ro[2] - start_ro[2] + 1)*(end_e1[2] - start_e1[2] + 1));
     EXPECT_EQ(areas[3], (end_ro[3] - start_ro[3] + 1)*(end_e1[3] - start_e1[3] + 1));
 }
+
+namespace
+{
+    // the former bwlabel_2d: region growing from every pixel off the border
+    template <typename T>
+    void bwlabel_2d_region_growing(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_8_connected)
+    {
+        size_t COL = input.get_size(0);
+        size_t ROW = input.get_size(1);
+
+        label.create(COL, ROW);
+        Gadgetron::clear(label);
+
+        unsigned int currLabel = 1;
+        for (size_t r = 1; r < ROW - 1; r++)
+        {
+            for (size_t c = 1; c < COL - 1; c++)
+            {
+                if (input(c, r) == object_value && label(c, r) == 0)
+                {
+                    Gadgetron::region_growing_2d(input, object_value, label, c, r, currLabel++, is_8_connected);
+                }
+            }
+        }
+    }
+
+    // random blobs, with some pixels on the border only
+    template <typename T>
+    void random_blobs(hoNDArray<T>& a, unsigned int seed)
+    {
+        size_t num = a.get_number_of_elements();
+        for (size_t n = 0; n < num; n++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            a(n) = ((seed >> 16) % 100 < 45) ? T(1) : T(0);
+        }
+    }
+}
+
+TYPED_TEST(image_morphology_test, bwlabelMatchesRegionGrowing)
+{
+    size_t sizes[3][2] = { { 37, 23 }, { 512, 389 }, { 2, 40 } };
+
+    for (size_t s = 0; s < 3; s++)
+    {
+        hoNDArray<TypeParam> aImage(sizes[s][0], sizes[s][1]);
+        random_blobs(aImage, (unsigned int)(17 + s));
+
+        for (int conn = 0; conn < 2; conn++)
+        {
+            hoNDArray<unsigned int> label, ref;
+            Gadgetron::bwlabel_2d(aImage, (TypeParam)1, label, conn == 1);
+            bwlabel_2d_region_growing(aImage, (TypeParam)1, ref, conn == 1);
+
+            ASSERT_EQ(label.get_number_of_elements(), ref.get_number_of_elements());
+            for (size_t n = 0; n < ref.get_number_of_elements(); n++) ASSERT_EQ(label(n), ref(n));
+        }
+    }
+}
+
+TYPED_TEST(image_morphology_test, bwlabelBatch)
+{
+    size_t RO = 64, E1 = 48, N = 5;
+
+    hoNDArray<TypeParam> images(RO, E1, N);
+    random_blobs(images, 3);
+
+    hoNDArray<unsigned int> label;
+    Gadgetron::bwlabel_2d_batch(images, (TypeParam)1, label, true);
+    ASSERT_EQ(label.get_number_of_elements(), images.get_number_of_elements());
+
+    for (size_t n = 0; n < N; n++)
+    {
+        hoNDArray<TypeParam> im(RO, E1, images.begin() + n*RO*E1);
+
+        hoNDArray<unsigned int> ref;
+        Gadgetron::bwlabel_2d(im, (TypeParam)1, ref, true);
+
+        for (size_t i = 0; i < RO*E1; i++) ASSERT_EQ(label(i + n*RO*E1), ref(i));
+    }
+}
+
+TYPED_TEST(image_morphology_test, bwlabel3D)
+{
+    size_t RO = 40, E1 = 31, E2 = 70;
+
+    hoNDArray<TypeParam> vol(RO, E1, E2);
+    random_blobs(vol, 11);
+
+    for (int conn = 0; conn < 2; conn++)
+    {
+        hoNDArray<unsigned int> label;
+        Gadgetron::bwlabel_3d(vol, (TypeParam)1, label, conn == 1);
+
+        // flood fill every component in raster order
+        hoNDArray<unsigned int> ref(RO, E1, E2);
+        Gadgetron::clear(ref);
+
+        unsigned int currLabel = 0;
+        for (size_t n = 0; n < vol.get_number_of_elements(); n++)
+        {
+            if (vol(n) != (TypeParam)1 || ref(n) != 0) continue;
+
+            ref(n) = ++currLabel;
+            std::vector<size_t> stack(1, n);
+            while (!stack.empty())
+            {
+                size_t p = stack.back();
+                stack.pop_back();
+
+                long long x = p % RO, y = (p / RO) % E1, z = p / (RO*E1);
+                for (long long dz = -1; dz <= 1; dz++)
+                    for (long long dy = -1; dy <= 1; dy++)
+                        for (long long dx = -1; dx <= 1; dx++)
+                        {
+                            if (conn == 0 && std::abs(dx) + std::abs(dy) + std::abs(dz) != 1) continue;
+                            long long nx = x + dx, ny = y + dy, nz = z + dz;
+                            if (nx < 0 || ny < 0 || nz < 0 || nx >= (long long)RO || ny >= (long long)E1 || nz >= (long long)E2) continue;
+
+                            size_t q = nx + ny*RO + nz*RO*E1;
+                            if (vol(q) == (TypeParam)1 && ref(q) == 0)
+                            {
+                                ref(q) = currLabel;
+                                stack.push_back(q);
+                            }
+                        }
+            }
+        }
+
+        for (size_t n = 0; n < ref.get_number_of_elements(); n++) ASSERT_EQ(label(n), ref(n));
+
+        std::vector<unsigned int> labels, areas;
+        Gadgetron::bwlabel_area_2d(label, labels, areas);
+        EXPECT_EQ(labels.size(), currLabel);
+    }
+}
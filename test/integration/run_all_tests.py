@@ -13,6 +13,9 @@ def main():
     parser.add_argument('-p', '--port', type=int, default=9003, help="Port of gadgetron instance")
     parser.add_argument('-e', '--external', action='store_true', help="External, do not start gadgetron")
     parser.add_argument('-a', '--address', default="localhost", help="Address of gadgetron host (external)")
+    parser.add_argument('--performance', action='store_true', help="Run the performance mode of every test case")
+    parser.add_argument('-N', '--repetitions', type=int, default=8, help="Number of times each dataset is replayed (performance)")
+    parser.add_argument('-M', '--connections', type=int, default=2, help="Number of concurrent connections (performance)")
     parser.add_argument('test_case_list_file', help="List of test cases")
     args = parser.parse_args()
 
@@ -38,10 +41,12 @@ def main():
         client_log_filename = os.path.join(pwd, out_folder, "client.log")
 
         # Now run the test
+        cmd = ["python", "run_gadgetron_test.py", "-I", ismrmrd_home, "-G", gadgetron_home, t, "-a", str(args.address), "-p", str(args.port)]
         if args.external:
-            r = subprocess.call(["python", "run_gadgetron_test.py", "-I", ismrmrd_home, "-G", gadgetron_home, t, "-a", str(args.address), "-p", str(args.port), "-e"])
-        else:
-            r = subprocess.call(["python", "run_gadgetron_test.py", "-I", ismrmrd_home, "-G", gadgetron_home, t, "-a", str(args.address), "-p", str(args.port)])
+            cmd.append("-e")
+        if args.performance:
+            cmd += ["--performance", "-N", str(args.repetitions), "-M", str(args.connections)]
+        r = subprocess.call(cmd)
 
         # Grab the log files and append to master logs
         gadgetron_outfile.write("==============================================\n")
@@ -8,9 +8,140 @@ import os
 import shutil
 import platform
 import re
+import json
+import threading
+
+
+def read_timing(timing_file):
+    """Reads the event times written by gadgetron_ismrmrd_client -k."""
+    images = []
+    events = dict()
+    with open(timing_file) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) != 2:
+                continue
+            if fields[0] == 'image':
+                images.append(float(fields[1]))
+            else:
+                events[fields[0]] = float(fields[1])
+    return images, events
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    v = sorted(values)
+    return v[min(len(v) - 1, int(p * len(v)))]
+
+
+def run_performance(environment, case_name, host, port, ismrmrd_file, gadgetron_configuration, out_folder,
+                    repetitions, connections, baseline_file, tolerance, save_baseline):
+    """Replays the dataset repetitions times over connections concurrent connections.
+
+    Records the time to the first image, the time between consecutive images of a connection
+    (per-image latency) and the acquisitions per second sustained over all connections, and
+    compares them against the baseline of the case, if there is one.
+    """
+    print("Running performance test: %d repetitions over %d connections" % (repetitions, connections))
+
+    f = h5py.File(ismrmrd_file, 'r')
+    acquisitions_per_run = f['dataset/data'].shape[0]
+    f.close()
+
+    pending = list(range(repetitions))
+    lock = threading.Lock()
+    failures = []
+
+    def worker():
+        while True:
+            with lock:
+                if not pending:
+                    return
+                run = pending.pop(0)
+
+            result_h5 = os.path.join(out_folder, "performance_%d.h5" % run)
+            timing_file = os.path.join(out_folder, "performance_%d.txt" % run)
+            log_file = os.path.join(out_folder, "performance_%d.log" % run)
+            with open(log_file, "w") as lf:
+                r = subprocess.call(["gadgetron_ismrmrd_client", "-a", host, "-p", port, "-f", ismrmrd_file, "-c",
+                                     gadgetron_configuration, "-G", gadgetron_configuration, "-o", result_h5,
+                                     "-k", timing_file],
+                                    env=environment, stdout=lf, stderr=lf)
+            if r != 0 or not os.path.isfile(timing_file):
+                with lock:
+                    failures.append(run)
+
+    start_time = time.time()
+    threads = [threading.Thread(target=worker) for c in range(connections)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    wall_time = time.time() - start_time
+
+    if failures:
+        print("Failed to run gadgetron_ismrmrd_client for repetition(s) " + str(sorted(failures)))
+        return False
+
+    first_image = []
+    image_latency = []
+    for run in range(repetitions):
+        images, events = read_timing(os.path.join(out_folder, "performance_%d.txt" % run))
+        if not images:
+            print("No images received in repetition %d" % run)
+            return False
+        first_image.append(images[0])
+        image_latency += [b - a for a, b in zip(images[:-1], images[1:])]
+
+    measured = {
+        'time_to_first_image': percentile(first_image, 0.5),
+        'image_latency': percentile(image_latency, 0.95) if image_latency else 0.0,
+        'acquisitions_per_second': repetitions * acquisitions_per_run / wall_time,
+    }
+
+    print("   --Wall time                  : %.3f s" % wall_time)
+    print("   --Time to first image (p50)  : %.3f s" % measured['time_to_first_image'])
+    print("   --Per-image latency (p95)    : %.3f s" % measured['image_latency'])
+    print("   --Acquisitions per second    : %.1f" % measured['acquisitions_per_second'])
+
+    key = "%s/%dx%d" % (case_name, repetitions, connections)
+    baselines = dict()
+    if baseline_file and os.path.isfile(baseline_file):
+        with open(baseline_file) as bf:
+            baselines = json.load(bf)
+
+    if save_baseline:
+        baselines[key] = measured
+        with open(baseline_file, "w") as bf:
+            json.dump(baselines, bf, indent=2, sort_keys=True)
+        print("   --Baseline saved for " + key)
+        return True
+
+    if key not in baselines:
+        print("   --No baseline for " + key + ", nothing to compare")
+        return True
+
+    baseline = baselines[key]
+    result = True
+    # times may grow and the throughput may drop by the tolerance
+    for name in ['time_to_first_image', 'image_latency']:
+        limit = baseline[name] * (1 + tolerance)
+        ok = measured[name] <= limit
+        print("   --Comparing %s : %.3f (baseline: %.3f, limit: %.3f) %s" %
+              (name, measured[name], baseline[name], limit, "" if ok else "REGRESSION"))
+        result = result and ok
+
+    limit = baseline['acquisitions_per_second'] * (1 - tolerance)
+    ok = measured['acquisitions_per_second'] >= limit
+    print("   --Comparing acquisitions_per_second : %.1f (baseline: %.1f, limit: %.1f) %s" %
+          (measured['acquisitions_per_second'], baseline['acquisitions_per_second'], limit, "" if ok else "REGRESSION"))
+    result = result and ok
+
+    return result
 
 
-def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True):
+def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True, performance=None):
     print("Running test case: " + testcase_cfg_file)
 
     pwd = os.getcwd()
@@ -61,6 +192,13 @@ def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True):
     comparison_threshold_values = config.getfloat('TEST', 'comparison_threshold_values')
     comparison_threshold_scales = config.getfloat('TEST', 'comparison_threshold_scales')
 
+    # the client sends the acquisition data through a shared memory ring of this size (MB) over a local socket
+    if config.has_option('TEST', 'shared_memory'):
+        shared_memory = config.getint('TEST', 'shared_memory')
+    else:
+        shared_memory = 0
+    local_socket = "/tmp/gadgetron_test_" + port + ".sock"
+
     dependency_1 = os.path.join(pwd, out_folder, "dependency_1.h5")
     dependency_2 = os.path.join(pwd, out_folder, "dependency_2.h5")
     dependency_3 = os.path.join(pwd, out_folder, "dependency_3.h5")
@@ -116,7 +254,10 @@ def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True):
     #Start the Gadgetron if needed
     if start_gadgetron:
         with open(gadgetron_log_filename, "w") as gf:
-            gp = subprocess.Popen(["gadgetron", "-p", port, "-R", "19080", "-l", "8004"], env=environment, stdout=gf, stderr=gf)
+            gadgetron_cmd = ["gadgetron", "-p", port, "-R", "19080", "-l", "8004"]
+            if shared_memory > 0:
+                gadgetron_cmd += ["-u", local_socket]
+            gp = subprocess.Popen(gadgetron_cmd, env=environment, stdout=gf, stderr=gf)
 
             node_p = list()
             if nodes > 0:
@@ -199,6 +340,9 @@ def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True):
     if (need_matlab_support and (not has_matlab_support)):
         print("Test skipped because Matlab is not available")
         skipping_test = True
+    if (shared_memory > 0 and (not start_gadgetron or platform.system() == "Windows")):
+        print("Test skipped because shared memory needs a Gadgetron started by the test on a Unix host")
+        skipping_test = True
 
     if skipping_test:
         print("System Requirements: Actual/Required")
@@ -287,14 +431,27 @@ def run_test(environment, testcase_cfg_file, host, port, start_gadgetron=True):
         print("Running Gadgetron recon on data measurement")
         r = 0
         start_time = time.time()
-        r = subprocess.call(["gadgetron_ismrmrd_client", "-a", host, "-p", port, "-f" , ismrmrd_result, "-c",
-                             gadgetron_configuration, "-G", gadgetron_configuration, "-o", result_h5],
-                            env=environment, stdout=cf, stderr=cf)
+        client_cmd = ["gadgetron_ismrmrd_client", "-a", host, "-p", port, "-f" , ismrmrd_result, "-c",
+                      gadgetron_configuration, "-G", gadgetron_configuration, "-o", result_h5]
+        if shared_memory > 0:
+            client_cmd += ["-U", local_socket, "-M", str(shared_memory)]
+        r = subprocess.call(client_cmd, env=environment, stdout=cf, stderr=cf)
         print("Elapsed time: " + str(time.time()-start_time))
         if r != 0:
             print("Failed to run gadgetron_ismrmrd_client!")
             success = False
 
+    if success and performance:
+        # the tolerance of a case overrides the one given on the command line
+        tolerance = performance['tolerance']
+        if config.has_option('PERFORMANCE', 'tolerance'):
+            tolerance = config.getfloat('PERFORMANCE', 'tolerance')
+        case_name = os.path.splitext(os.path.basename(testcase_cfg_file))[0]
+        success = run_performance(environment, case_name, host, port, ismrmrd_result, gadgetron_configuration,
+                                  os.path.join(pwd, out_folder), performance['repetitions'],
+                                  performance['connections'], performance['baseline'], tolerance,
+                                  performance['save_baseline'])
+
     if start_gadgetron:
         gp.terminate()
         if nodes > 0:
@@ -369,6 +526,12 @@ def main():
     parser.add_argument('-p', '--port', type=int, default=9003, help="Port of gadgetron instance")
     parser.add_argument('-e', '--external', action='store_true', help="External, do not start gadgetron")
     parser.add_argument('-a', '--address', default="localhost", help="Address of gadgetron host (external)")
+    parser.add_argument('--performance', action='store_true', help="Replay the dataset and compare the timings against the baseline")
+    parser.add_argument('-N', '--repetitions', type=int, default=8, help="Number of times the dataset is replayed (performance)")
+    parser.add_argument('-M', '--connections', type=int, default=2, help="Number of concurrent connections (performance)")
+    parser.add_argument('--baseline', default=os.path.join(os.path.dirname(os.path.realpath(__file__)), "performance_baselines.json"), help="File with the performance baselines")
+    parser.add_argument('--tolerance', type=float, default=0.25, help="Allowed relative deviation from the baseline (performance)")
+    parser.add_argument('--save-baseline', action='store_true', help="Store the measured timings as the baseline instead of comparing")
     parser.add_argument('case_file', help="Test case file")
     args = parser.parse_args()
 
@@ -438,10 +601,16 @@ def main():
     print("  -- " + libpath + " : " + myenv[libpath])
     print("  -- TEST CASE       : " + test_case)
 
+    performance = None
+    if args.performance:
+        performance = {'repetitions': max(1, args.repetitions), 'connections': max(1, args.connections),
+                       'baseline': os.path.realpath(args.baseline), 'tolerance': args.tolerance,
+                       'save_baseline': args.save_baseline}
+
     if (args.external):
-        test_result = run_test(myenv, test_case, host, port, start_gadgetron=False)
+        test_result = run_test(myenv, test_case, host, port, start_gadgetron=False, performance=performance)
     else:
-        test_result = run_test(myenv, test_case, host, port, start_gadgetron=True)
+        test_result = run_test(myenv, test_case, host, port, start_gadgetron=True, performance=performance)
 
     if test_result:
         print("TEST: " + test_case + " SUCCESS")
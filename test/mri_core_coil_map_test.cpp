@@ -0,0 +1,181 @@
+#include "hoNDArray.h"
+#include "mri_core_coil_map_estimation.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+using namespace Gadgetron;
+
+namespace
+{
+    typedef std::complex<float> T;
+    typedef std::complex<double> Td;
+
+    long long wrap(long long i, long long n)
+    {
+        return ((i % n) + n) % n;
+    }
+
+    void normalize(std::vector<Td>& v)
+    {
+        double n = 0;
+        for (size_t k = 0; k < v.size(); k++) n += std::norm(v[k]);
+        n = std::sqrt(n);
+        for (size_t k = 0; k < v.size(); k++) v[k] /= n;
+    }
+
+    // Inati coil map of one pixel from the full window data matrix
+    void reference_Inati(const hoNDArray<T>& data, long long RO, long long E1, long long E2, long long CHA,
+                         long long ks, long long kz, size_t power, long long ro, long long e1, long long e2, std::vector<Td>& V)
+    {
+        std::vector< std::vector<Td> > D;
+        for (long long z = -kz / 2; z <= kz / 2; z++)
+        {
+            for (long long y = -ks / 2; y <= ks / 2; y++)
+            {
+                for (long long x = -ks / 2; x <= ks / 2; x++)
+                {
+                    std::vector<Td> row(CHA);
+                    for (long long cha = 0; cha < CHA; cha++)
+                    {
+                        row[cha] = data.at(wrap(ro + x, RO) + wrap(e1 + y, E1)*RO + wrap(e2 + z, E2)*RO*E1 + cha*RO*E1*E2);
+                    }
+                    D.push_back(row);
+                }
+            }
+        }
+
+        V.assign(CHA, Td(0));
+        for (size_t n = 0; n < D.size(); n++)
+            for (long long cha = 0; cha < CHA; cha++) V[cha] += D[n][cha];
+        normalize(V);
+
+        for (size_t po = 0; po < power; po++)
+        {
+            std::vector<Td> V2(CHA, Td(0));
+            for (long long i = 0; i < CHA; i++)
+            {
+                for (long long j = 0; j < CHA; j++)
+                {
+                    Td m(0);
+                    for (size_t n = 0; n < D.size(); n++) m += std::conj(D[n][i])*D[n][j];
+                    V2[i] += m*V[j];
+                }
+            }
+            V = V2;
+            normalize(V);
+        }
+
+        Td phase(0);
+        for (size_t n = 0; n < D.size(); n++)
+            for (long long cha = 0; cha < CHA; cha++) phase += D[n][cha] * V[cha];
+        phase /= std::abs(phase);
+
+        for (long long cha = 0; cha < CHA; cha++) V[cha] = std::conj(V[cha])*phase;
+    }
+
+    void fill_random(hoNDArray<T>& data)
+    {
+        srand(42);
+        for (size_t n = 0; n < data.get_number_of_elements(); n++)
+        {
+            data[n] = T(rand() / (float)RAND_MAX - 0.3f, rand() / (float)RAND_MAX - 0.5f);
+        }
+    }
+}
+
+TEST(mri_core_coil_map, Inati2DMatchesFullWindow)
+{
+    long long RO = 37, E1 = 41, CHA = 4, ks = 7;
+    size_t power = 3;
+
+    hoNDArray<T> data(RO, E1, CHA);
+    fill_random(data);
+
+    hoNDArray<T> coilMap;
+    coil_map_2d_Inati(data, coilMap, ks, power);
+    ASSERT_TRUE(data.dimensions_equal(&coilMap));
+
+    std::vector<Td> V;
+    for (long long e1 = 0; e1 < E1; e1++)
+    {
+        for (long long ro = 0; ro < RO; ro++)
+        {
+            reference_Inati(data, RO, E1, 1, CHA, ks, 1, power, ro, e1, 0, V);
+            for (long long cha = 0; cha < CHA; cha++)
+            {
+                T v = coilMap[ro + e1*RO + cha*RO*E1];
+                EXPECT_NEAR(V[cha].real(), v.real(), 1e-4);
+                EXPECT_NEAR(V[cha].imag(), v.imag(), 1e-4);
+            }
+        }
+    }
+}
+
+TEST(mri_core_coil_map, Inati3DMatchesFullWindow)
+{
+    long long RO = 23, E1 = 19, E2 = 5, CHA = 3, ks = 5, kz = 3;
+    size_t power = 2;
+
+    hoNDArray<T> data(RO, E1, E2, CHA);
+    fill_random(data);
+
+    hoNDArray<T> coilMap;
+    coil_map_3d_Inati(data, coilMap, ks, kz, power);
+    ASSERT_TRUE(data.dimensions_equal(&coilMap));
+
+    std::vector<Td> V;
+    for (long long e2 = 0; e2 < E2; e2++)
+    {
+        for (long long e1 = 0; e1 < E1; e1++)
+        {
+            for (long long ro = 0; ro < RO; ro++)
+            {
+                reference_Inati(data, RO, E1, E2, CHA, ks, kz, power, ro, e1, e2, V);
+                for (long long cha = 0; cha < CHA; cha++)
+                {
+                    T v = coilMap[ro + e1*RO + e2*RO*E1 + cha*RO*E1*E2];
+                    EXPECT_NEAR(V[cha].real(), v.real(), 1e-4);
+                    EXPECT_NEAR(V[cha].imag(), v.imag(), 1e-4);
+                }
+            }
+        }
+    }
+}
+
+TEST(mri_core_coil_map, matchOfCoilMap)
+{
+    size_t RO = 16, E1 = 12, E2 = 1, CHA = 4, N = 2;
+
+    // data of two images which follow the coil map, normalized over the channels
+    hoNDArray<T> coilMap(RO, E1, E2, CHA, N), data(RO, E1, E2, CHA, N);
+    fill_random(coilMap);
+
+    for (size_t n = 0; n < N; n++)
+    {
+        for (size_t p = 0; p < RO*E1*E2; p++)
+        {
+            float sos = 0;
+            for (size_t cha = 0; cha < CHA; cha++) sos += std::norm(coilMap(p + cha*RO*E1*E2 + n*RO*E1*E2*CHA));
+
+            T rho((float)(p % 5) + 1.0f, (float)(p % 3));
+            for (size_t cha = 0; cha < CHA; cha++)
+            {
+                size_t i = p + cha*RO*E1*E2 + n*RO*E1*E2*CHA;
+                coilMap(i) /= std::sqrt(sos);
+                data(i) = coilMap(i) * rho;
+            }
+        }
+    }
+
+    EXPECT_NEAR(1.0f, coil_map_match(data, coilMap, 3), 1e-4);
+
+    // swapped channels in the second image do not fit
+    hoNDArray<T> swapped(coilMap);
+    for (size_t p = 0; p < RO*E1*E2; p++) std::swap(swapped(p + RO*E1*E2*CHA), swapped(p + RO*E1*E2*(CHA + 1)));
+
+    EXPECT_LT(coil_map_match(data, swapped, 3), 0.9f);
+}
@@ -0,0 +1,147 @@
+#include "hoNDArray.h"
+#include "hoNDArray_elemwise.h"
+#include "mri_core_image_conversion.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+using namespace Gadgetron;
+
+namespace
+{
+    typedef std::complex<float> T;
+
+    void make_image(size_t RO, size_t E1, hoNDArray<T>& im)
+    {
+        std::mt19937 gen(5);
+        std::normal_distribution<float> noise(0, 2);
+
+        im.create(RO, E1);
+        for (size_t e1 = 0; e1 < E1; e1++)
+        {
+            for (size_t ro = 0; ro < RO; ro++)
+            {
+                float x = (float(ro) - RO / 2.0f) / RO;
+                float y = (float(e1) - E1 / 2.0f) / E1;
+                float mag = ((x*x + y*y) < 0.16f) ? 300.0f * (1.0f + x) : 0.0f;
+                im(ro, e1) = std::polar(mag, 2.0f*x - y) + T(noise(gen), noise(gen));
+            }
+        }
+    }
+
+    // ComplexToFloatGadget, AutoScaleGadget and FloatToFixPointGadget one after the other
+    template <typename FT>
+    void reference_conversion(const hoNDArray<T>& x, uint16_t image_type, float auto_scale_max_value, FT min_intensity, FT max_intensity, FT intensity_offset, hoNDArray<FT>& r)
+    {
+        hoNDArray<float> d;
+        if (image_type == ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE) Gadgetron::abs(x, d);
+        else if (image_type == ISMRMRD::ISMRMRD_IMTYPE_REAL) Gadgetron::complex_to_real(x, d);
+        else if (image_type == ISMRMRD::ISMRMRD_IMTYPE_IMAG) Gadgetron::complex_to_imag(x, d);
+        else Gadgetron::argument(x, d);
+
+        size_t N = d.get_number_of_elements();
+        float* pd = d.begin();
+
+        if (image_type == ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE && auto_scale_max_value > 0)
+        {
+            unsigned int histogram_bins = 100;
+
+            float max = 0.0f;
+            for (size_t i = 0; i < N; i++) if (pd[i] > max) max = pd[i];
+
+            std::vector<size_t> histogram(histogram_bins, 0);
+            for (size_t i = 0; i < N; i++)
+            {
+                size_t bin = static_cast<size_t>(floor((pd[i] / max)*histogram_bins));
+                if (bin >= histogram_bins) bin = histogram_bins - 1;
+                histogram[bin]++;
+            }
+
+            long long cumsum = 0;
+            size_t counter = 0;
+            while (cumsum < (0.99*N)) cumsum += (long long)(histogram[counter++]);
+            max = (counter + 1)*(max / histogram_bins);
+
+            float scale = auto_scale_max_value / max;
+            for (size_t i = 0; i < N; i++) pd[i] *= scale;
+        }
+
+        r.create(x.get_dimensions());
+        for (size_t i = 0; i < N; i++)
+        {
+            float pix_val = pd[i];
+            if (image_type == ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE)
+            {
+                pix_val = std::abs(pix_val);
+            }
+            else if (image_type == ISMRMRD::ISMRMRD_IMTYPE_PHASE)
+            {
+                pix_val *= (float)(intensity_offset / 3.14159265);
+                pix_val += intensity_offset;
+            }
+            else
+            {
+                pix_val = pix_val + intensity_offset;
+            }
+
+            if (pix_val < (float)min_intensity) pix_val = (float)min_intensity;
+            if (pix_val > (float)max_intensity) pix_val = (float)max_intensity;
+            r(i) = (image_type == ISMRMRD::ISMRMRD_IMTYPE_PHASE) ? static_cast<FT>(pix_val) : static_cast<FT>(pix_val + 0.5);
+        }
+    }
+}
+
+TEST(mri_core_image_conversion, same_as_gadgets)
+{
+    hoNDArray<T> im;
+    make_image(300, 277, im);
+
+    uint16_t types[4] = { ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE, ISMRMRD::ISMRMRD_IMTYPE_REAL, ISMRMRD::ISMRMRD_IMTYPE_IMAG, ISMRMRD::ISMRMRD_IMTYPE_PHASE };
+
+    for (size_t t = 0; t < 4; t++)
+    {
+        for (int auto_scale = 0; auto_scale < 2; auto_scale++)
+        {
+            float max_value = auto_scale ? 2048.0f : 0.0f;
+
+            hoNDArray<unsigned short> r, r_ref;
+            complex_to_fix_point<unsigned short>(im, types[t], max_value, 0, 4095, 2048, r);
+            reference_conversion<unsigned short>(im, types[t], max_value, 0, 4095, 2048, r_ref);
+
+            ASSERT_EQ(r.get_number_of_elements(), r_ref.get_number_of_elements());
+            for (size_t n = 0; n < r.get_number_of_elements(); n++) ASSERT_EQ(r(n), r_ref(n)) << "type " << types[t] << " pixel " << n;
+
+            hoNDArray<short> s, s_ref;
+            complex_to_fix_point<short>(im, types[t], max_value, -2048, 2047, 0, s);
+            reference_conversion<short>(im, types[t], max_value, -2048, 2047, 0, s_ref);
+
+            for (size_t n = 0; n < s.get_number_of_elements(); n++) ASSERT_EQ(s(n), s_ref(n)) << "type " << types[t] << " pixel " << n;
+        }
+    }
+}
+
+TEST(mri_core_image_conversion, auto_scale)
+{
+    hoNDArray<T> im;
+    make_image(64, 64, im);
+
+    hoNDArray<unsigned short> r;
+    float scale = complex_to_fix_point<unsigned short>(im, ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE, 1000.0f, 0, 4095, 0, r);
+    EXPECT_GT(scale, 0.0f);
+
+    // the 99th percentile is close to the max value
+    std::vector<unsigned short> v(r.begin(), r.end());
+    std::sort(v.begin(), v.end());
+    EXPECT_LE(v[(size_t)(0.99*v.size())], 1000);
+    EXPECT_GT(v[(size_t)(0.99*v.size())], 800);
+
+    // zero images are not scaled
+    hoNDArray<T> zero(16, 16);
+    zero.fill(T(0));
+    EXPECT_EQ(complex_to_fix_point<unsigned short>(zero, ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE, 1000.0f, 0, 4095, 0, r), 1.0f);
+    for (size_t n = 0; n < r.get_number_of_elements(); n++) EXPECT_EQ(r(n), 0);
+}
@@ -0,0 +1,105 @@
+#include "hoNDArray.h"
+#include "hoNDArray_elemwise.h"
+#include "mri_core_kspace_filter.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+namespace
+{
+    void fill_data(hoNDArray<T>& data)
+    {
+        for (size_t n = 0; n < data.get_number_of_elements(); n++) data(n) = T((float)(n % 11) - 5.0f, (float)(n % 7) + 1.0f);
+    }
+
+    void expect_equal(const hoNDArray<T>& a, const hoNDArray<T>& b)
+    {
+        ASSERT_EQ(a.get_number_of_elements(), b.get_number_of_elements());
+        for (size_t n = 0; n < a.get_number_of_elements(); n++)
+        {
+            EXPECT_NEAR(a(n).real(), b(n).real(), 1e-4f);
+            EXPECT_NEAR(a(n).imag(), b(n).imag(), 1e-4f);
+        }
+    }
+}
+
+TEST(mri_core_kspace_filter, fusedFilterMatchesFilterProduct)
+{
+    size_t RO = 32, E1 = 24, E2 = 8, CHA = 3;
+
+    hoNDArray<T> data(RO, E1, E2, CHA);
+    fill_data(data);
+
+    hoNDArray<T> fRO, fE1, fE2;
+    generate_symmetric_filter(RO, fRO, ISMRMRD_FILTER_GAUSSIAN, 1.0);
+    generate_symmetric_filter(E1, fE1, ISMRMRD_FILTER_HANNING);
+    generate_symmetric_filter(E2, fE2, ISMRMRD_FILTER_TAPERED_HANNING, 1.0, 2);
+
+    hoNDArray<T> fxyz;
+    compute_3d_filter(fRO, fE1, fE2, fxyz);
+
+    hoNDArray<T> ref;
+    Gadgetron::multiply(data, fxyz, ref);
+
+    hoNDArray<T> res;
+    apply_kspace_filter(data, fRO, fE1, fE2, res);
+    expect_equal(ref, res);
+
+    // in place
+    hoNDArray<T> inplace(data);
+    apply_kspace_filter(inplace, fRO, fE1, fE2, inplace);
+    expect_equal(ref, inplace);
+
+    // a missing filter is not applied along its dimension
+    hoNDArray<T> ones(E1);
+    ones.fill(T(1.0f));
+    compute_3d_filter(fRO, ones, fE2, fxyz);
+    Gadgetron::multiply(data, fxyz, ref);
+
+    apply_kspace_filter_ROE2(data, fRO, fE2, res);
+    expect_equal(ref, res);
+}
+
+TEST(mri_core_kspace_filter, filterCache)
+{
+    hoKSpaceFilterCache<T>* cache = hoKSpaceFilterCache<T>::instance();
+    cache->clear();
+
+    hoNDArray<T> f, g;
+    cache->symmetric_filter(64, 0, 63, ISMRMRD_FILTER_HANNING, 1.0, 0.15, f);
+    EXPECT_EQ(1, cache->size());
+
+    generate_symmetric_filter(64, g, ISMRMRD_FILTER_HANNING, 1.0, 10);
+    expect_equal(g, f);
+
+    // the filter handed out is the cached one, writing to it leaves the cache unchanged
+    f.fill(T(0.0f));
+    cache->symmetric_filter(64, 0, 63, ISMRMRD_FILTER_HANNING, 1.0, 0.15, f);
+    EXPECT_EQ(1, cache->size());
+    expect_equal(g, f);
+
+    // partially sampled kspace gets a filter over the sampled range, with unit noise gain over it
+    cache->symmetric_filter(64, 16, 47, ISMRMRD_FILTER_HANNING, 1.0, 0.15, f);
+    EXPECT_EQ(2, cache->size());
+    ASSERT_EQ(64, f.get_number_of_elements());
+    EXPECT_EQ(0.0f, std::abs(f(0)));
+
+    double sos = 0;
+    for (size_t n = 16; n <= 47; n++) sos += std::norm(f(n));
+    EXPECT_NEAR(1.0, sos / 32, 1e-4);
+
+    cache->symmetric_filter(64, 0, 63, ISMRMRD_FILTER_NONE, 1.0, 0.15, f);
+    EXPECT_EQ(0, f.get_number_of_elements());
+
+    cache->asymmetric_filter(64, 20, 63, ISMRMRD_FILTER_TAPERED_HANNING, 8, true, f);
+    generate_asymmetric_filter(64, 20, 63, g, ISMRMRD_FILTER_TAPERED_HANNING, 8, true);
+    expect_equal(g, f);
+    EXPECT_EQ(3, cache->size());
+
+    cache->clear();
+    EXPECT_EQ(0, cache->size());
+}
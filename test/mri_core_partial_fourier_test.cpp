@@ -0,0 +1,119 @@
+#include "hoNDArray.h"
+#include "hoNDFFT.h"
+#include "mri_core_partial_fourier.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+namespace
+{
+    typedef std::complex<float> T;
+
+    // disks with a slowly varying phase, different for every coil, [RO E1 E2 CHA]
+    void make_images(size_t RO, size_t E1, size_t E2, size_t CHA, hoNDArray<T>& im)
+    {
+        im.create(RO, E1, E2, CHA);
+
+        for (size_t cha = 0; cha < CHA; cha++)
+        {
+            for (size_t e2 = 0; e2 < E2; e2++)
+            {
+                for (size_t e1 = 0; e1 < E1; e1++)
+                {
+                    for (size_t ro = 0; ro < RO; ro++)
+                    {
+                        float x = (float(ro) - RO / 2.0f) / RO;
+                        float y = (float(e1) - E1 / 2.0f) / E1;
+                        float z = (E2 > 1) ? (float(e2) - E2 / 2.0f) / E2 : 0.0f;
+
+                        float mag = ((x*x + y*y + z*z) < 0.09f) ? 1.0f : 0.0f;
+                        if ((x - 0.1f)*(x - 0.1f) + y*y < 0.01f) mag += 0.5f;
+                        float phi = 0.7f*cha + 0.5f*x - 0.3f*y + 0.2f*z;
+
+                        im(ro, e1, e2, cha) = std::polar(mag, phi);
+                    }
+                }
+            }
+        }
+    }
+
+    double rel_error(const hoNDArray<T>& a, const hoNDArray<T>& ref)
+    {
+        double d = 0, r = 0;
+        for (size_t n = 0; n < ref.get_number_of_elements(); n++)
+        {
+            d += std::norm(a(n) - ref(n));
+            r += std::norm(ref(n));
+        }
+        return std::sqrt(d / r);
+    }
+
+    void zero_outside(hoNDArray<T>& kspace, size_t startE1, size_t startE2)
+    {
+        size_t RO = kspace.get_size(0);
+        size_t E1 = kspace.get_size(1);
+        size_t E2 = kspace.get_size(2);
+        size_t N = kspace.get_number_of_elements() / (RO*E1*E2);
+
+        for (size_t n = 0; n < N; n++)
+            for (size_t e2 = 0; e2 < E2; e2++)
+                for (size_t e1 = 0; e1 < E1; e1++)
+                    if (e1 < startE1 || e2 < startE2)
+                        for (size_t ro = 0; ro < RO; ro++) kspace(ro + e1*RO + e2*RO*E1 + n*RO*E1*E2) = 0;
+    }
+}
+
+TEST(mri_core_partial_fourier, POCS_2D)
+{
+    size_t RO = 64, E1 = 64, CHA = 3;
+
+    hoNDArray<T> im, kspace_full;
+    make_images(RO, E1, 1, CHA, im);
+    hoNDFFT<float>::instance()->fft2c(im, kspace_full);
+
+    size_t startE1 = 20;
+    hoNDArray<T> kspace(kspace_full);
+    zero_outside(kspace, startE1, 0);
+
+    hoNDArray<T> res;
+    partial_fourier_POCS(kspace, 0, RO - 1, startE1, E1 - 1, 0, 0, 0, 0, 0, 10, 1e-6, res);
+
+    ASSERT_EQ(res.get_number_of_elements(), kspace.get_number_of_elements());
+    EXPECT_LT(rel_error(res, kspace_full), 0.5*rel_error(kspace, kspace_full));
+
+    // the acquired region is kept without a transition band
+    for (size_t cha = 0; cha < CHA; cha++)
+        for (size_t e1 = startE1; e1 < E1; e1++)
+            for (size_t ro = 0; ro < RO; ro++)
+                EXPECT_EQ(res(ro, e1, 0, cha), kspace(ro, e1, 0, cha));
+
+    // every image is handled on its own, one coil gives the same result as all of them
+    hoNDArray<T> kspace1(RO, E1, 1, 1, kspace.begin() + RO*E1), res1;
+    partial_fourier_POCS(kspace1, 0, RO - 1, startE1, E1 - 1, 0, 0, 0, 0, 0, 10, 1e-6, res1);
+
+    for (size_t n = 0; n < RO*E1; n++)
+        EXPECT_NEAR(std::abs(res1(n) - res(n + RO*E1)), 0, 1e-4);
+}
+
+TEST(mri_core_partial_fourier, POCS_3D_transition_band)
+{
+    size_t RO = 32, E1 = 32, E2 = 16, CHA = 2;
+
+    hoNDArray<T> im, kspace_full;
+    make_images(RO, E1, E2, CHA, im);
+    hoNDFFT<float>::instance()->fft3c(im, kspace_full);
+
+    size_t startE1 = 8, startE2 = 4;
+    hoNDArray<T> kspace(kspace_full);
+    zero_outside(kspace, startE1, startE2);
+
+    hoNDArray<T> res;
+    partial_fourier_POCS(kspace, 0, RO - 1, startE1, E1 - 1, startE2, E2 - 1, 0, 4, 2, 10, 1e-6, res);
+
+    ASSERT_EQ(res.get_number_of_elements(), kspace.get_number_of_elements());
+    EXPECT_LT(rel_error(res, kspace_full), 0.5*rel_error(kspace, kspace_full));
+}
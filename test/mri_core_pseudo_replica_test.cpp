@@ -0,0 +1,112 @@
+#include "hoNDArray.h"
+#include "mri_core_pseudo_replica.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+TEST(mri_core_pseudo_replica, noise)
+{
+    size_t N = 100000;
+    hoNDArray<T> noise(N), noise2(N);
+
+    generate_complex_gaussian_noise(noise, 2.0f, 7);
+    generate_complex_gaussian_noise(noise2, 2.0f, 7);
+
+    double sr = 0, si = 0, vr = 0, vi = 0, cri = 0;
+    for (size_t n = 0; n < N; n++)
+    {
+        EXPECT_EQ(noise(n), noise2(n));
+
+        sr += noise(n).real();
+        si += noise(n).imag();
+        vr += noise(n).real()*noise(n).real();
+        vi += noise(n).imag()*noise(n).imag();
+        cri += noise(n).real()*noise(n).imag();
+    }
+
+    EXPECT_NEAR(sr / N, 0, 0.03);
+    EXPECT_NEAR(si / N, 0, 0.03);
+    EXPECT_NEAR(std::sqrt(vr / N), 2, 0.03);
+    EXPECT_NEAR(std::sqrt(vi / N), 2, 0.03);
+    EXPECT_NEAR(cri / N, 0, 0.05);
+
+    // another seed gives other noise
+    generate_complex_gaussian_noise(noise2, 2.0f, 8);
+    size_t num_equal = 0;
+    for (size_t n = 0; n < N; n++) if (noise(n) == noise2(n)) num_equal++;
+    EXPECT_EQ(num_equal, 0);
+}
+
+TEST(mri_core_pseudo_replica, sampled_kspace_noise)
+{
+    size_t RO = 32, E1 = 16, CHA = 4;
+    hoNDArray<T> kspace(RO, E1, 1, CHA), noise, noise_all(RO, E1, 1, CHA);
+
+    for (size_t n = 0; n < kspace.get_number_of_elements(); n++)
+    {
+        size_t e1 = (n / RO) % E1;
+        kspace(n) = (e1 % 2 == 0) ? T(1.0f, 0.5f) : T(0);
+    }
+
+    generate_sampled_kspace_noise(kspace, 1.0f, 3, noise);
+    generate_complex_gaussian_noise(noise_all, 1.0f, 3);
+
+    ASSERT_EQ(noise.get_number_of_elements(), kspace.get_number_of_elements());
+    for (size_t n = 0; n < kspace.get_number_of_elements(); n++)
+    {
+        if (kspace(n) == T(0))
+            EXPECT_EQ(noise(n), T(0));
+        else
+            EXPECT_EQ(noise(n), noise_all(n));
+    }
+}
+
+TEST(mri_core_pseudo_replica, accumulator)
+{
+    size_t N = 50, R = 200;
+    hoNDArray<T> replica(N);
+
+    std::vector<double> s(N, 0), s2(N, 0);
+
+    PseudoReplicaAccumulator<T> acc;
+    for (size_t r = 0; r < R; r++)
+    {
+        generate_complex_gaussian_noise(replica, 0.1f, 100 + r);
+
+        for (size_t n = 0; n < N; n++)
+        {
+            replica(n) += T(10.0f + n, 0.0f);
+
+            double m = std::abs(replica(n));
+            s[n] += m;
+            s2[n] += m*m;
+        }
+
+        acc.add(replica);
+    }
+
+    EXPECT_EQ(acc.number_of_replicas(), R);
+
+    hoNDArray<float> mean, std_map;
+    acc.get_mean(mean);
+    acc.get_std(std_map);
+
+    for (size_t n = 0; n < N; n++)
+    {
+        double m = s[n] / R;
+        double v = s2[n] / R - m*m;
+
+        EXPECT_NEAR(mean(n), m, 1e-3);
+        EXPECT_NEAR(std_map(n), std::sqrt(v), 1e-3);
+        EXPECT_NEAR(std_map(n), 0.1, 0.03);
+    }
+
+    acc.clear();
+    EXPECT_EQ(acc.number_of_replicas(), 0);
+}
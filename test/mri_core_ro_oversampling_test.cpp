@@ -0,0 +1,77 @@
+#include "hoNDArray.h"
+#include "mri_core_ro_oversampling.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <cmath>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+TEST(mri_core_ro_oversampling, halfbandFilter)
+{
+    std::vector<float> taps;
+    float centerTap;
+    generate_halfband_filter(16, taps, centerTap);
+
+    ASSERT_EQ(16, taps.size());
+
+    // unit gain at DC, times sqrt(2)
+    double sum = centerTap;
+    for (size_t j = 0; j < taps.size(); j++) sum += 2 * taps[j];
+    EXPECT_NEAR(std::sqrt(2.0), sum, 1e-5);
+
+    // half of the gain at the half-band edge
+    EXPECT_NEAR(std::sqrt(2.0) / 2, centerTap, 1e-6);
+    EXPECT_GT(taps[0], 0.0f);
+    EXPECT_LT(taps[1], 0.0f);
+}
+
+TEST(mri_core_ro_oversampling, halfbandKeepsPassband)
+{
+    size_t RO = 256, CHA = 3, E1 = 5;
+
+    // a signal within the central half of the oversampled band
+    hoNDArray<T> data(RO, CHA, E1);
+    for (size_t e1 = 0; e1 < E1; e1++)
+    {
+        for (size_t cha = 0; cha < CHA; cha++)
+        {
+            for (size_t ro = 0; ro < RO; ro++)
+            {
+                double p = 2 * M_PI * ro / RO;
+                data(ro, cha, e1) = T((float)std::cos(7 * p + cha), (float)std::sin(-19 * p + e1)) + T((float)(0.5*std::cos(31 * p)), 0.0f);
+            }
+        }
+    }
+
+    std::vector<float> taps;
+    float centerTap;
+    generate_halfband_filter(32, taps, centerTap);
+
+    hoNDArray<T> res;
+    remove_ro_oversampling_halfband(data, taps, centerTap, res);
+
+    ASSERT_EQ(RO / 2, res.get_size(0));
+    ASSERT_EQ(CHA, res.get_size(1));
+    ASSERT_EQ(E1, res.get_size(2));
+
+    // away from the zero-extended edges the samples are kept, with the unitary fft scaling
+    float s = std::sqrt(2.0f);
+    for (size_t e1 = 0; e1 < E1; e1++)
+    {
+        for (size_t cha = 0; cha < CHA; cha++)
+        {
+            for (size_t m = taps.size(); m < RO / 2 - taps.size(); m++)
+            {
+                EXPECT_NEAR(s*data(2 * m, cha, e1).real(), res(m, cha, e1).real(), 1e-3f);
+                EXPECT_NEAR(s*data(2 * m, cha, e1).imag(), res(m, cha, e1).imag(), 1e-3f);
+            }
+        }
+    }
+
+    // odd readout length is refused
+    hoNDArray<T> odd(RO - 1, CHA);
+    EXPECT_ANY_THROW(remove_ro_oversampling_halfband(odd, taps, centerTap, res));
+}
@@ -0,0 +1,150 @@
+#include "hoNDArray.h"
+#include "mri_core_sense.h"
+
+#include <gtest/gtest.h>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+using namespace Gadgetron;
+
+typedef std::complex<float> T;
+
+namespace
+{
+    // smooth coil sensitivities, normalized to sum of squares 1
+    void make_coil_map(size_t RO, size_t E1, size_t E2, size_t CHA, hoNDArray<T>& coilMap)
+    {
+        coilMap.create(RO, E1, E2, CHA);
+
+        for (size_t e2 = 0; e2 < E2; e2++)
+        {
+            for (size_t e1 = 0; e1 < E1; e1++)
+            {
+                for (size_t ro = 0; ro < RO; ro++)
+                {
+                    float sos = 0;
+                    for (size_t c = 0; c < CHA; c++)
+                    {
+                        float a = 6.2831853f * c / CHA;
+                        float x = (float)ro / RO - 0.5f - 0.4f*std::cos(a);
+                        float y = (float)e1 / E1 - 0.5f - 0.4f*std::sin(a);
+                        float z = (float)e2 / E2 - 0.5f - 0.4f*std::cos(2.0f*a);
+                        T v = std::polar(std::exp(-2.0f*(x*x + y*y + z*z)), a + 1.5f*y);
+                        coilMap(ro, e1, e2, c) = v;
+                        sos += std::norm(v);
+                    }
+
+                    for (size_t c = 0; c < CHA; c++) coilMap(ro, e1, e2, c) /= std::sqrt(sos);
+                }
+            }
+        }
+    }
+
+    // zero filled aliased images of uniform undersampling, every alias gets the phase of the first sampled line
+    void make_aliased_image(const hoNDArray<T>& coilMap, const hoNDArray<T>& rho, size_t acceFactorE1, size_t acceFactorE2, hoNDArray<T>& aliased)
+    {
+        size_t RO = coilMap.get_size(0);
+        size_t E1 = coilMap.get_size(1);
+        size_t E2 = coilMap.get_size(2);
+        size_t CHA = coilMap.get_size(3);
+
+        aliased.create(RO, E1, E2, CHA);
+
+        float R = (float)(acceFactorE1*acceFactorE2);
+
+        for (size_t c = 0; c < CHA; c++)
+        {
+            for (size_t e2 = 0; e2 < E2; e2++)
+            {
+                for (size_t e1 = 0; e1 < E1; e1++)
+                {
+                    for (size_t ro = 0; ro < RO; ro++)
+                    {
+                        T v(0);
+                        for (size_t b = 0; b < acceFactorE2; b++)
+                        {
+                            for (size_t a = 0; a < acceFactorE1; a++)
+                            {
+                                size_t ae1 = (e1 + a*E1 / acceFactorE1) % E1;
+                                size_t ae2 = (e2 + b*E2 / acceFactorE2) % E2;
+                                T p = std::polar(1.0f, -6.2831853f*(a*1.0f / acceFactorE1 + b*2.0f / acceFactorE2));
+                                v += p * coilMap(ro, ae1, ae2, c) * rho(ro, ae1, ae2);
+                            }
+                        }
+
+                        aliased(ro, e1, e2, c) = v / R;
+                    }
+                }
+            }
+        }
+    }
+
+    void check_unfolding(size_t RO, size_t E1, size_t E2, size_t CHA, size_t acceFactorE1, size_t acceFactorE2)
+    {
+        hoNDArray<T> coilMap;
+        make_coil_map(RO, E1, E2, CHA, coilMap);
+
+        hoNDArray<T> rho(RO, E1, E2);
+        for (size_t n = 0; n < rho.get_number_of_elements(); n++) rho(n) = T((float)(n % 7) + 1.0f, (float)(n % 5) - 2.0f);
+
+        hoNDArray<T> aliased;
+        make_aliased_image(coilMap, rho, acceFactorE1, acceFactorE2, aliased);
+
+        hoNDArray<T> unmixCoeff;
+        hoNDArray<float> gFactor;
+        sense_unmixing_coeff(coilMap, acceFactorE1, acceFactorE2, 1e-6, unmixCoeff, gFactor);
+
+        ASSERT_EQ(RO, unmixCoeff.get_size(0));
+        ASSERT_EQ(CHA, unmixCoeff.get_size(3));
+        ASSERT_EQ(RO*E1*E2, gFactor.get_number_of_elements());
+
+        for (size_t n = 0; n < RO*E1*E2; n++)
+        {
+            T v(0);
+            for (size_t c = 0; c < CHA; c++) v += unmixCoeff(n + c*RO*E1*E2) * aliased(n + c*RO*E1*E2);
+
+            EXPECT_NEAR(rho(n).real(), v.real(), 1e-2f*std::abs(rho(n)));
+            EXPECT_NEAR(rho(n).imag(), v.imag(), 1e-2f*std::abs(rho(n)));
+            EXPECT_GE(gFactor(n), 0.99f);
+        }
+    }
+}
+
+TEST(mri_core_sense, unfolding_2D)
+{
+    check_unfolding(24, 32, 1, 8, 2, 1);
+    check_unfolding(24, 30, 1, 8, 3, 1);
+}
+
+TEST(mri_core_sense, unfolding_3D)
+{
+    check_unfolding(12, 16, 8, 8, 2, 2);
+}
+
+TEST(mri_core_sense, no_acceleration)
+{
+    // without acceleration the unmixing coefficients are the conjugated coil map
+    hoNDArray<T> coilMap, unmixCoeff;
+    hoNDArray<float> gFactor;
+    make_coil_map(16, 16, 1, 4, coilMap);
+
+    sense_unmixing_coeff(coilMap, 1, 1, 0, unmixCoeff, gFactor);
+
+    for (size_t n = 0; n < coilMap.get_number_of_elements(); n++)
+    {
+        EXPECT_NEAR(std::conj(coilMap(n)).real(), unmixCoeff(n).real(), 1e-4f);
+        EXPECT_NEAR(std::conj(coilMap(n)).imag(), unmixCoeff(n).imag(), 1e-4f);
+    }
+
+    for (size_t n = 0; n < gFactor.get_number_of_elements(); n++) EXPECT_NEAR(1.0f, gFactor(n), 1e-4f);
+}
+
+TEST(mri_core_sense, incompatible_size)
+{
+    hoNDArray<T> coilMap, unmixCoeff;
+    hoNDArray<float> gFactor;
+    make_coil_map(8, 10, 1, 4, coilMap);
+
+    EXPECT_ANY_THROW(sense_unmixing_coeff(coilMap, 3, 1, 0.001, unmixCoeff, gFactor));
+}
@@ -185,3 +185,62 @@ TYPED_TEST(pattern_recognition_test, kmeans_test)
 
     EXPECT_LE( std::sqrt(sumD) / N, 2.0);
 }
+
+TYPED_TEST(pattern_recognition_test, kmeans_bounded_minibatch_test)
+{
+    std::default_random_engine generator;
+    std::normal_distribution<float> distribution(0.0f, 1.0f);
+
+    Gadgetron::kmeans<float> km;
+
+    km.max_iter_ = 100;
+    km.replicates_ = 1;
+    km.perform_online_update_ = false;
+
+    // four clusters in 3 dimensions
+    size_t P = 3;
+    size_t N = 8000;
+    size_t K = 4;
+
+    hoNDArray<float> X;
+    X.create(P, N);
+
+    size_t n, p;
+    for (n = 0; n < N; n++)
+    {
+        size_t c = n % K;
+        for (p = 0; p < P; p++)
+        {
+            X(p, n) = distribution(generator) + ((c >> p) & 1) * 6.0f;
+        }
+    }
+
+    hoNDArray<float> C_for_initial;
+    km.get_initial_guess_kmeansplusplus(X, K, C_for_initial);
+
+    std::vector<size_t> IDX, IDX_bounded, IDX_minibatch;
+    hoNDArray<float> C_res, C_bounded, C_minibatch;
+    float sumD, sumD_bounded, sumD_minibatch;
+
+    km.use_triangle_inequality_ = false;
+    km.run(X, K, C_for_initial, IDX, C_res, sumD);
+
+    // the triangle inequality only skips distance computations
+    km.use_triangle_inequality_ = true;
+    km.run(X, K, C_for_initial, IDX_bounded, C_bounded, sumD_bounded);
+
+    EXPECT_EQ(IDX.size(), IDX_bounded.size());
+    size_t num_diff = 0;
+    for (n = 0; n < N; n++)
+    {
+        if (IDX[n] != IDX_bounded[n]) num_diff++;
+    }
+    EXPECT_EQ(num_diff, 0);
+    EXPECT_NEAR(sumD_bounded / sumD, 1.0f, 1e-3f);
+
+    km.max_iter_ = 50;
+    km.run_minibatch(X, K, C_for_initial, 256, IDX_minibatch, C_minibatch, sumD_minibatch);
+
+    EXPECT_EQ(IDX_minibatch.size(), N);
+    EXPECT_LE(sumD_minibatch / sumD, 1.05f);
+}
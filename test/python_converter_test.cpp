@@ -88,6 +88,32 @@ TYPED_TEST(python_converter_test, numpy_hoNDArray)
     EXPECT_EQ(evens.get_number_of_elements(), 50);
 }
 
+TYPED_TEST(python_converter_test, numpy_hoNDArray_shared)
+{
+    GDEBUG_STREAM(" --------------------------------------------------------------------------------------------------");
+    GDEBUG_STREAM("Hand an hoNDArray over to numpy without copying");
+    initialize_python();
+    register_converter< hoNDArray<float> >();
+
+    hoNDArray<float> arr(8, 6, 4);
+    for (size_t n = 0; n < arr.get_number_of_elements(); n++) arr(n) = (float)n;
+    float* pData = arr.begin();
+
+    GILLock gl;
+    boost::python::object pyarr = hoNDArray_to_numpy_array_shared<float>::convert(std::move(arr));
+    EXPECT_EQ(arr.get_number_of_elements(), 0);
+    EXPECT_EQ(NumPyArray_DATA(pyarr.ptr()), (void*)pData);
+    EXPECT_EQ(NumPyArray_DIM(pyarr.ptr(), 0), 8);
+    EXPECT_EQ(NumPyArray_DIM(pyarr.ptr(), 2), 4);
+    EXPECT_FLOAT_EQ(boost::python::extract<float>(pyarr[boost::python::make_tuple(3, 2, 1)]), 3 + 2 * 8 + 1 * 48);
+
+    // the array is Fortran ordered, so it is converted back with a single copy
+    hoNDArray<float> back = boost::python::extract< hoNDArray<float> >(pyarr);
+    EXPECT_EQ(back.get_size(1), 6);
+    EXPECT_NE(back.begin(), pData);
+    EXPECT_FLOAT_EQ(back(3 + 2 * 8 + 1 * 48), 3 + 2 * 8 + 1 * 48);
+}
+
 TYPED_TEST(python_converter_test, ismrmrd_imageheader)
 {
     {
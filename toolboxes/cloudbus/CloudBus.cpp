@@ -32,7 +32,6 @@ namespace Gadgetron
 	}
 
 	char* buffer = new char[msg_size];
-	cloud_bus_->nodes_.clear();
 	if ((recv_cnt = cloud_bus_->peer().recv_n (buffer, msg_size)) <= 0) {
 	  GDEBUG("Failed to read message from relay. Relay must have disconnected\n");
 	  delete [] buffer;
@@ -40,16 +39,46 @@ namespace Gadgetron
 	}
       
 	uint32_t msg_id = *((uint32_t*)buffer);
-	if (msg_id != GADGETRON_CLOUDBUS_NODE_LIST_REPLY) {
+	switch (msg_id) {
+	case (GADGETRON_CLOUDBUS_NODE_LIST_REPLY):
+	  {
+	    std::unique_lock<std::mutex> lk(cloud_bus_->mtx_);
+	    deserialize(cloud_bus_->nodes_, buffer+4, msg_size-4);
+	    lk.unlock();
+	    cloud_bus_->node_list_condition_.notify_all();
+	    break;
+	  }
+	case (GADGETRON_CLOUDBUS_NODE_LIST_SNAPSHOT):
+	  {
+	    std::unique_lock<std::mutex> lk(cloud_bus_->mtx_);
+	    cloud_bus_->sequence_ = *((uint32_t*)(buffer+4));
+	    deserialize(cloud_bus_->nodes_, buffer+8, msg_size-8);
+	    cloud_bus_->subscribed_ = true;
+	    lk.unlock();
+	    cloud_bus_->node_list_condition_.notify_all();
+	    break;
+	  }
+	case (GADGETRON_CLOUDBUS_NODE_LIST_DELTA):
+	  {
+	    GadgetronNodeDelta d;
+	    deserialize(d, buffer+4, msg_size-4);
+	    cloud_bus_->apply_node_delta(d);
+	    break;
+	  }
+	case (GADGETRON_CLOUDBUS_BEST_NODES_REPLY):
+	  {
+	    std::unique_lock<std::mutex> lk(cloud_bus_->mtx_);
+	    deserialize(cloud_bus_->best_nodes_, buffer+4, msg_size-4);
+	    cloud_bus_->best_nodes_valid_ = true;
+	    lk.unlock();
+	    cloud_bus_->node_list_condition_.notify_all();
+	    break;
+	  }
+	default:
 	  GERROR("Unexpected message id = %d\n", msg_id);
+	  delete [] buffer;
 	  return -1;
 	}
-	{
-	  std::unique_lock<std::mutex> lk(cloud_bus_->mtx_);
-	  deserialize(cloud_bus_->nodes_, buffer+4, msg_size-4);
-	  lk.unlock();
-	  cloud_bus_->node_list_condition_.notify_all();
-	}
 	delete [] buffer;
 
       }
@@ -106,6 +135,11 @@ namespace Gadgetron
     node_info_.compute_capability = c;
   }
 
+  uint32_t CloudBus::compute_capability()
+  {
+    return node_info_.compute_capability;
+  }
+
   unsigned int CloudBus::active_reconstructions()
   {
     return node_info_.active_reconstructions;
@@ -153,6 +187,11 @@ namespace Gadgetron
     this->peer().close_writer(); 
     this->peer().close();
     connected_ = false;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      subscribed_ = false;
+      best_nodes_valid_ = false;
+    }
     if (reader_task_) {
       delete reader_task_;
       reader_task_ = 0;
@@ -168,11 +207,15 @@ namespace Gadgetron
   
   int CloudBus::svc(void)
   {
-    
+    auto last_attempt = std::chrono::steady_clock::now() - std::chrono::milliseconds(GADGETRON_CLOUDBUS_RECONNECT_MS);
     while (true) {
       if (connected_) {
-	//
-      } else {
+	//Heartbeat
+	if (!query_mode_) {
+	  send_node_info();
+	}
+      } else if (std::chrono::steady_clock::now() - last_attempt >= std::chrono::milliseconds(GADGETRON_CLOUDBUS_RECONNECT_MS)) {
+          last_attempt = std::chrono::steady_clock::now();
           if (relay_port_ > 0) {
               std::string connect_addr(relay_inet_addr_);
               if (connect_addr == "localhost") {
@@ -196,48 +239,149 @@ namespace Gadgetron
                       if (!query_mode_) {
                           send_node_info();
                       }
+                      subscribe();
                   } 
               }
           }
       }
-      //Sleep for 5 seconds
-      ACE_Time_Value tv (5);
-      ACE_OS::sleep (tv);	  	
+      ACE_Time_Value tv (0, GADGETRON_CLOUDBUS_HEARTBEAT_MS*1000);
+      ACE_OS::sleep (tv);
     }
     return 0;
   }
 
+  void CloudBus::send_message(uint32_t id, const char* payload, size_t len)
+  {
+    if (!connected_) return;
+    std::vector<char> buffer(len+8);
+    *((uint32_t*)(&buffer[0])) = len+4;
+    *((uint32_t*)(&buffer[4])) = id;
+    if (len) memcpy(&buffer[8], payload, len);
+    std::lock_guard<std::mutex> lk(send_mtx_);
+    this->peer().send_n(&buffer[0],buffer.size());
+  }
+
   void CloudBus::send_node_info()
   {
     size_t buf_len = calculate_node_info_length(node_info_);
     try {
-      char* buffer = new char[4+4+buf_len];
-      *((uint32_t*)buffer) = buf_len+4;
-      *((uint32_t*)(buffer + 4)) = GADGETRON_CLOUDBUS_NODE_INFO;
-      if (connected_) {
-	serialize(node_info_,buffer + 8,buf_len);
-	this->peer().send_n(buffer,buf_len+8);
-      }
-      delete [] buffer;
+      std::vector<char> buffer(buf_len);
+      serialize(node_info_,&buffer[0],buf_len);
+      send_message(GADGETRON_CLOUDBUS_NODE_INFO,&buffer[0],buf_len);
     } catch (...) {
       GERROR("Failed to send gadgetron node info\n");
       throw;
     }
   }
 
+  void CloudBus::subscribe()
+  {
+    send_message(GADGETRON_CLOUDBUS_NODE_LIST_SUBSCRIBE);
+
+    size_t k;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      k = best_k_;
+    }
+    if (k > 0) {
+      uint32_t kk = k;
+      send_message(GADGETRON_CLOUDBUS_BEST_NODES_SUBSCRIBE,(char*)(&kk),4);
+    }
+  }
+
+  void CloudBus::apply_node_delta(GadgetronNodeDelta& d)
+  {
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (!subscribed_) return;
+
+    //A missed delta leaves the list in an unknown state, a new snapshot replaces it
+    if (d.sequence != sequence_+1) {
+      GDEBUG("CloudBus missed node list changes (sequence %d after %d), subscribing again\n", d.sequence, sequence_);
+      subscribed_ = false;
+      lk.unlock();
+      send_message(GADGETRON_CLOUDBUS_NODE_LIST_SUBSCRIBE);
+      return;
+    }
+    sequence_ = d.sequence;
+
+    for (auto r = d.removed.begin(); r != d.removed.end(); r++) {
+      for (auto it = nodes_.begin(); it != nodes_.end(); it++) {
+	if (it->uuid == *r) {
+	  nodes_.erase(it);
+	  break;
+	}
+      }
+    }
+
+    for (auto u = d.updated.begin(); u != d.updated.end(); u++) {
+      //The relay sends the changes of this node as well
+      if (u->uuid == node_info_.uuid) continue;
+      auto it = nodes_.begin();
+      for (; it != nodes_.end(); it++) {
+	if (it->uuid == u->uuid) break;
+      }
+      if (it != nodes_.end()) {
+	*it = *u;
+      } else {
+	nodes_.push_back(*u);
+      }
+    }
+    lk.unlock();
+    node_list_condition_.notify_all();
+  }
+
   void CloudBus::update_node_info()
   {
     if (connected_) {
-      uint32_t req[2];
-      req[0] = 4;
-      req[1] = GADGETRON_CLOUDBUS_NODE_LIST_QUERY;
+      std::unique_lock<std::mutex> lk(mtx_);
+      //With a subscription the relay keeps the list up to date
+      if (subscribed_) return;
+      lk.unlock();
 
-      this->peer().send_n((char*)(&req),8);
-      {
-	std::unique_lock<std::mutex> lk(mtx_);
-	node_list_condition_.wait_for(lk, std::chrono::milliseconds(100));
+      //Relays without subscriptions answer queries only
+      send_message(GADGETRON_CLOUDBUS_NODE_LIST_QUERY);
+
+      lk.lock();
+      node_list_condition_.wait_for(lk, std::chrono::milliseconds(100));
+    }
+  }
+
+  void CloudBus::get_best_nodes(size_t k, std::vector<GadgetronNodeInfo>& nodes)
+  {
+    if (use_lb_endpoint_ || k == 0) {
+      get_node_info(nodes);
+      select_best_nodes(nodes, k ? k : nodes.size());
+      return;
+    }
+
+    bool request = false;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (best_k_ != k) {
+	best_k_ = k;
+	best_nodes_valid_ = false;
+	request = true;
       }
     }
+    if (request) {
+      uint32_t kk = k;
+      send_message(GADGETRON_CLOUDBUS_BEST_NODES_SUBSCRIBE,(char*)(&kk),4);
+    }
+
+    {
+      std::unique_lock<std::mutex> lk(mtx_);
+      if (connected_ && !best_nodes_valid_) {
+	node_list_condition_.wait_for(lk, std::chrono::milliseconds(100), [this]() { return best_nodes_valid_; });
+      }
+      if (best_nodes_valid_) {
+	nodes = best_nodes_;
+	return;
+      }
+    }
+
+    //Relays without best nodes subscriptions do not answer, the best nodes are taken from the node list
+    get_node_info(nodes);
+    select_best_nodes(nodes, k);
   }
   
   void CloudBus::print_nodes()
@@ -289,6 +433,10 @@ namespace Gadgetron
     , connected_(false)
     , reader_task_(0)
     , use_lb_endpoint_(false)
+    , subscribed_(false)
+    , sequence_(0)
+    , best_k_(0)
+    , best_nodes_valid_(false)
   {
     node_info_.port = gadgetron_port_;
     node_info_.rest_port = rest_port_;
@@ -30,6 +30,17 @@
 #define GADGETRON_DEFAULT_RELAY_PORT 8002
 #define MAXHOSTNAMELENGTH 1024
 
+//Nodes send their node info as a heartbeat, the relay drops nodes that
+//have sent heartbeats before but have been silent for the timeout
+#define GADGETRON_CLOUDBUS_HEARTBEAT_MS 150
+#define GADGETRON_CLOUDBUS_NODE_TIMEOUT_MS 600
+#define GADGETRON_CLOUDBUS_RECONNECT_MS 5000
+
+//The relay collects the node list changes and sends them to the subscribers as one delta per flush interval
+#define GADGETRON_CLOUDBUS_RELAY_FLUSH_MS 50
+#define GADGETRON_CLOUDBUS_RELAY_SEND_TIMEOUT_MS 1000
+#define GADGETRON_CLOUDBUS_RELAY_MAX_CONNECTIONS 65536
+
 #include "cloudbus_io.h"
 
 namespace Gadgetron
@@ -84,10 +95,16 @@ namespace Gadgetron
     void set_lb_endpoint(std::string addr, uint32_t port);
     
     void set_compute_capability(uint32_t c);
+    uint32_t compute_capability();
 
     void send_node_info();    
     void update_node_info();
     void get_node_info(std::vector<GadgetronNodeInfo>& nodes);
+    /**
+       The best k nodes of the cluster, ranked by node_is_better. The first call subscribes to the best k nodes
+       at the relay, which sends them whenever they change; the node list is not transferred for this query.
+    */
+    void get_best_nodes(size_t k, std::vector<GadgetronNodeInfo>& nodes);
     void print_nodes();
     size_t get_number_of_nodes();
 
@@ -103,6 +120,10 @@ namespace Gadgetron
     CloudBus(int port, const char* addr);
     CloudBus(); 
 
+    void send_message(uint32_t id, const char* payload = 0, size_t len = 0);
+    void subscribe();
+    void apply_node_delta(GadgetronNodeDelta& d);
+
     static CloudBus* instance_;
     static const char* relay_inet_addr_;
     static int relay_port_;
@@ -116,9 +137,19 @@ namespace Gadgetron
 
     GadgetronNodeInfo node_info_;
     std::vector<GadgetronNodeInfo> nodes_;
+
+    //The relay keeps nodes_ up to date with deltas after the snapshot of the subscription
+    bool subscribed_;
+    uint32_t sequence_;
+
+    //Best nodes subscription, best_k_ = 0 for none
+    size_t best_k_;
+    bool best_nodes_valid_;
+    std::vector<GadgetronNodeInfo> best_nodes_;
     
     std::mutex mtx_;
     std::condition_variable node_list_condition_;
+    std::mutex send_mtx_;
   
     /*
     ACE_Thread_Mutex mtx_;
@@ -104,4 +104,74 @@ namespace Gadgetron
     return pos;
   }
 
+  size_t calculate_node_delta_length(GadgetronNodeDelta& d)
+  {
+    size_t length = 4 + 4 + calculate_node_info_list_length(d.updated) + 4;
+    for (std::vector<std::string>::iterator it = d.removed.begin();
+	 it != d.removed.end(); it++)
+      {
+	length += 4 + it->size();
+      }
+    return length;
+  }
+
+  size_t serialize(GadgetronNodeDelta& d, char* buffer, size_t buf_len)
+  {
+    if (calculate_node_delta_length(d) > buf_len) throw std::runtime_error("Buffer too short for serializing node delta");
+
+    size_t pos = 0;
+    *((uint32_t*)(buffer + pos)) = d.sequence; pos += 4;
+    pos += serialize(d.updated, buffer+pos, buf_len-pos);
+
+    *((uint32_t*)(buffer + pos)) = d.removed.size(); pos += 4;
+    for (std::vector<std::string>::iterator it = d.removed.begin();
+	 it != d.removed.end(); it++)
+      {
+	*((uint32_t*)(buffer + pos)) = it->size(); pos += 4;
+	memcpy ((buffer+pos), it->c_str(), it->size()); pos += it->size();
+      }
+
+    return pos;
+  }
+
+  size_t deserialize(GadgetronNodeDelta& d, char* buffer, size_t buf_len)
+  {
+    if (buf_len < 12) throw std::runtime_error("Provided buffer is too small to hold node delta");
+
+    size_t pos = 0;
+    d.sequence = *((uint32_t*)(buffer + pos)); pos += 4;
+    pos += deserialize(d.updated, buffer+pos, buf_len-pos);
+
+    uint32_t num_removed = *((uint32_t*)(buffer + pos)); pos += 4;
+    d.removed.clear();
+    for (unsigned int i = 0; i < num_removed; i++) {
+      size_t uuid_size = *((uint32_t*)(buffer+pos)); pos += 4;
+      d.removed.push_back(std::string(buffer+pos,uuid_size)); pos += uuid_size;
+    }
+
+    return pos;
+  }
+
+  bool node_is_better(const GadgetronNodeInfo& a, const GadgetronNodeInfo& b)
+  {
+    //(active + 1)/capability compared without division
+    uint64_t ca = (a.compute_capability > 0) ? a.compute_capability : 1;
+    uint64_t cb = (b.compute_capability > 0) ? b.compute_capability : 1;
+    uint64_t la = ((uint64_t)a.active_reconstructions + 1)*cb;
+    uint64_t lb = ((uint64_t)b.active_reconstructions + 1)*ca;
+    if (la != lb) return la < lb;
+    if (a.last_recon != b.last_recon) return a.last_recon < b.last_recon;
+    return a.uuid < b.uuid;
+  }
+
+  void select_best_nodes(std::vector<GadgetronNodeInfo>& nl, size_t k)
+  {
+    if (k < nl.size()) {
+      std::partial_sort(nl.begin(), nl.begin()+k, nl.end(), node_is_better);
+      nl.resize(k);
+    } else {
+      std::sort(nl.begin(), nl.end(), node_is_better);
+    }
+  }
+
 }
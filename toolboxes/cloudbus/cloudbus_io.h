@@ -8,6 +8,7 @@
 #include <chrono>
 #include <ctime>
 #include <stdexcept>
+#include <algorithm>
 
 #include "cloudbus_export.h"
 
@@ -19,6 +20,11 @@ namespace Gadgetron
     GADGETRON_CLOUDBUS_NODE_INFO = 1,
     GADGETRON_CLOUDBUS_NODE_LIST_QUERY = 2,
     GADGETRON_CLOUDBUS_NODE_LIST_REPLY = 3,
+    GADGETRON_CLOUDBUS_NODE_LIST_SUBSCRIBE = 4,
+    GADGETRON_CLOUDBUS_NODE_LIST_SNAPSHOT = 5,
+    GADGETRON_CLOUDBUS_NODE_LIST_DELTA = 6,
+    GADGETRON_CLOUDBUS_BEST_NODES_SUBSCRIBE = 7,
+    GADGETRON_CLOUDBUS_BEST_NODES_REPLY = 8,
     GADGETRON_CLOUDBUS_MESSAGE_MAX
   };
   
@@ -33,6 +39,15 @@ namespace Gadgetron
     std::time_t last_recon;
   };
 
+  //Changes of the node list since the previous delta of the relay. A subscriber that
+  //misses a sequence number subscribes again to get a new snapshot of the list.
+  struct EXPORTCLOUDBUS GadgetronNodeDelta
+  {
+    uint32_t sequence;
+    std::vector<GadgetronNodeInfo> updated;
+    std::vector<std::string> removed;
+  };
+
   EXPORTCLOUDBUS size_t calculate_node_info_length(GadgetronNodeInfo& n);
 
   EXPORTCLOUDBUS size_t serialize(GadgetronNodeInfo& n, char* buffer, size_t buf_len);
@@ -42,6 +57,18 @@ namespace Gadgetron
 
   EXPORTCLOUDBUS size_t serialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len);
   EXPORTCLOUDBUS size_t deserialize(std::vector<GadgetronNodeInfo>& nl, char* buffer, size_t buf_len);
+
+  EXPORTCLOUDBUS size_t calculate_node_delta_length(GadgetronNodeDelta& d);
+
+  EXPORTCLOUDBUS size_t serialize(GadgetronNodeDelta& d, char* buffer, size_t buf_len);
+  EXPORTCLOUDBUS size_t deserialize(GadgetronNodeDelta& d, char* buffer, size_t buf_len);
+
+  //Ranking of the nodes for the best nodes queries: fewest active reconstructions per
+  //compute capability first, then the node that has been idle the longest
+  EXPORTCLOUDBUS bool node_is_better(const GadgetronNodeInfo& a, const GadgetronNodeInfo& b);
+
+  //Sorts the best k nodes of the list to the front and drops the rest
+  EXPORTCLOUDBUS void select_best_nodes(std::vector<GadgetronNodeInfo>& nl, size_t k);
 }
 
 #endif
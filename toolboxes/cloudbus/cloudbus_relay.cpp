@@ -6,8 +6,10 @@
 #include "ace/SOCK_Stream.h"
 #include "ace/Reactor_Notification_Strategy.h"
 #include "ace/Stream.h"
+#include "ace/Dev_Poll_Reactor.h"
 
 #include <map>
+#include <set>
 #include <chrono>
 
 #include "log.h"
@@ -18,11 +20,20 @@ namespace Gadgetron{
   //Forward declaration
   class CloudBusNodeController;
 
+  /**
+     Accepts the node connections and keeps the node list of the cluster.
+
+     Subscribers receive a snapshot of the list once and afterwards only the changes, which the relay
+     collects and sends as one delta per flush interval. Heartbeats that do not change a node cause no
+     traffic, so the relay sends O(changes x subscribers) instead of a full list per query. Subscribers
+     of the best K nodes receive the K best nodes whenever they change.
+  */
   class CloudBusRelayAcceptor : public ACE_Event_Handler
   {
   public:
     CloudBusRelayAcceptor()
       : mtx_("CLOUDBUSRELAYMTX")
+      , sequence_(0)
     {
 
     }
@@ -38,6 +49,11 @@ namespace Gadgetron{
 	GERROR("error opening acceptor\n");
 	return -1;
       }
+      ACE_Time_Value interval(0, GADGETRON_CLOUDBUS_RELAY_FLUSH_MS*1000);
+      if (this->reactor ()->schedule_timer(this, 0, interval, interval) == -1) {
+	GERROR("error scheduling the node list flush\n");
+	return -1;
+      }
       return this->reactor ()->register_handler(this, ACE_Event_Handler::ACCEPT_MASK);
     }
 
@@ -48,12 +64,15 @@ namespace Gadgetron{
 
     virtual int handle_input (ACE_HANDLE fd = ACE_INVALID_HANDLE);
 
+    virtual int handle_timeout (const ACE_Time_Value& current_time, const void* act = 0);
+
     virtual int handle_close (ACE_HANDLE handle,
 			      ACE_Reactor_Mask close_mask)
     {
       GDEBUG("Close CloudBus Relay Acceptor\n");
 
       if (this->acceptor_.get_handle () != ACE_INVALID_HANDLE) {
+	this->reactor ()->cancel_timer (this);
 	ACE_Reactor_Mask m =
 	  ACE_Event_Handler::ACCEPT_MASK | ACE_Event_Handler::DONT_CALL;
 	this->reactor ()->remove_handler (this, m);
@@ -65,11 +84,31 @@ namespace Gadgetron{
     void add_node(CloudBusNodeController* c, GadgetronNodeInfo n)
     {
       mtx_.acquire();
-      auto t = std::chrono::system_clock::from_time_t(n.last_recon);
-      std::chrono::duration<double> time_since_last_recon =
-	std::chrono::system_clock::now() - t;
-      GDEBUG("Adding node: %s, %s, %d, (active reconstructions: %d, last recon %f s)\n",
-	     n.uuid.c_str(), n.address.c_str(), n.port, n.active_reconstructions, time_since_last_recon.count());
+      auto now = std::chrono::steady_clock::now();
+      std::map<CloudBusNodeController*,GadgetronNodeInfo>::iterator it = node_map_.find(c);
+      bool changed = (it == node_map_.end()) ||
+	(expired_.count(c) > 0) ||
+	(it->second.active_reconstructions != n.active_reconstructions) ||
+	(it->second.compute_capability != n.compute_capability);
+
+      //A node that resends its info within the timeout is sending heartbeats
+      auto ls = last_seen_.find(c);
+      if (ls != last_seen_.end() &&
+	  (now - ls->second) < std::chrono::milliseconds(GADGETRON_CLOUDBUS_NODE_TIMEOUT_MS)) {
+	heartbeat_.insert(c);
+      }
+      last_seen_[c] = now;
+      expired_.erase(c);
+
+      if (changed) {
+	auto t = std::chrono::system_clock::from_time_t(n.last_recon);
+	std::chrono::duration<double> time_since_last_recon =
+	  std::chrono::system_clock::now() - t;
+	GDEBUG("Adding node: %s, %s, %d, (active reconstructions: %d, last recon %f s)\n",
+	       n.uuid.c_str(), n.address.c_str(), n.port, n.active_reconstructions, time_since_last_recon.count());
+	updated_[n.uuid] = n;
+	removed_.erase(n.uuid);
+      }
       node_map_[c] = n;
       mtx_.release();
     }
@@ -81,29 +120,84 @@ namespace Gadgetron{
       if (it != node_map_.end()) {
 	GadgetronNodeInfo n = it->second;
 	GDEBUG("Deleting node: %s, %s, %d\n", n.uuid.c_str(), n.address.c_str(), n.port);
+	if (!expired_.count(c)) remove_uuid(n.uuid);
 	node_map_.erase(c);
       }
+      last_seen_.erase(c);
+      heartbeat_.erase(c);
+      expired_.erase(c);
+      subscribers_.erase(c);
+      best_subscribers_.erase(c);
       mtx_.release();
     }
 
     void get_node_list(std::vector<GadgetronNodeInfo>& nl, CloudBusNodeController* exclude = 0)
     {
       mtx_.acquire();
-      std::map<CloudBusNodeController*, GadgetronNodeInfo>::iterator it = node_map_.begin();
+      collect_nodes(nl, exclude);
+      mtx_.release();
+    }
+
+    /// Sends a snapshot of the node list to c and the deltas after it
+    void subscribe(CloudBusNodeController* c);
+
+    /// Sends the best k nodes to c whenever they change
+    void subscribe_best_nodes(CloudBusNodeController* c, uint32_t k);
+
+  protected:
+
+    //All alive nodes except exclude, the caller holds the mutex
+    void collect_nodes(std::vector<GadgetronNodeInfo>& nl, CloudBusNodeController* exclude)
+    {
       nl.clear();
+      nl.reserve(node_map_.size());
+      std::map<CloudBusNodeController*, GadgetronNodeInfo>::iterator it = node_map_.begin();
       while (it != node_map_.end()) {
-	if (it->first != exclude) {
+	//Nodes that stopped sending heartbeats are considered failed
+	if (it->first != exclude && !expired_.count(it->first)) {
 	  nl.push_back(it->second);
 	}
 	it++;
       }
-      mtx_.release();
     }
 
-  protected:
+    void remove_uuid(const std::string& uuid)
+    {
+      updated_.erase(uuid);
+      removed_.insert(uuid);
+    }
+
+    //Marks the nodes that stopped sending heartbeats as removed, the caller holds the mutex
+    void expire_nodes()
+    {
+      auto now = std::chrono::steady_clock::now();
+      for (std::set<CloudBusNodeController*>::iterator it = heartbeat_.begin(); it != heartbeat_.end(); it++) {
+	if (expired_.count(*it)) continue;
+	if ((now - last_seen_[*it]) >= std::chrono::milliseconds(GADGETRON_CLOUDBUS_NODE_TIMEOUT_MS)) {
+	  GDEBUG("Node %s stopped sending heartbeats\n", node_map_[*it].uuid.c_str());
+	  expired_.insert(*it);
+	  remove_uuid(node_map_[*it].uuid);
+	}
+      }
+    }
+
+    void send_best_nodes(CloudBusNodeController* c, uint32_t k, std::string& last_sent);
+
     ACE_SOCK_Acceptor acceptor_;
     std::map<CloudBusNodeController*, GadgetronNodeInfo> node_map_;
+    std::map<CloudBusNodeController*, std::chrono::steady_clock::time_point> last_seen_;
+    std::set<CloudBusNodeController*> heartbeat_;
+    std::set<CloudBusNodeController*> expired_;
     ACE_Thread_Mutex mtx_;
+
+    //Changes since the last flush
+    uint32_t sequence_;
+    std::map<std::string, GadgetronNodeInfo> updated_;
+    std::set<std::string> removed_;
+
+    std::set<CloudBusNodeController*> subscribers_;
+    //k and the serialized list last sent to each best nodes subscriber
+    std::map<CloudBusNodeController*, std::pair<uint32_t, std::string> > best_subscribers_;
   };
 
 
@@ -178,19 +272,19 @@ namespace Gadgetron{
 	{
 	  //Get list of all nodes except myself
 	  this->acceptor_->get_node_list(nl,this);
-	  size_t buf_len = calculate_node_info_list_length(nl) + 4;
-	  char* buffer = new char[buf_len+8];
-	  *((uint32_t*)buffer) = buf_len+4;
-	  *((uint32_t*)(buffer+4)) = GADGETRON_CLOUDBUS_NODE_LIST_REPLY;
-	  try {
-	    serialize(nl,buffer+8,buf_len);
-	    this->peer().send_n(buffer,buf_len+8);
-	  } catch (...) {
-	    GERROR("Error serializing and sending node list\n");
-	    throw;
-	  }
+	  this->send_node_list(GADGETRON_CLOUDBUS_NODE_LIST_REPLY, nl);
 	  break;
 	}
+      case (GADGETRON_CLOUDBUS_NODE_LIST_SUBSCRIBE):
+	this->acceptor_->subscribe(this);
+	break;
+      case (GADGETRON_CLOUDBUS_BEST_NODES_SUBSCRIBE):
+	if (msg_size < 8) {
+	  GERROR("Best nodes subscription without the number of nodes\n");
+	  break;
+	}
+	this->acceptor_->subscribe_best_nodes(this, *((uint32_t*)(buffer+4)));
+	break;
       default:
 	GERROR("Unknow message ID = %d\n", msg_id);
       }
@@ -230,6 +324,37 @@ namespace Gadgetron{
       acceptor_ = a;
     }
 
+    /// Sends a message of id with the payload; a subscriber that does not take its messages
+    /// within the send timeout is skipped, it notices the gap in the deltas and subscribes again
+    int send_message(uint32_t id, const char* payload, size_t len)
+    {
+      std::vector<char> buffer(len+8);
+      *((uint32_t*)(&buffer[0])) = len+4;
+      *((uint32_t*)(&buffer[4])) = id;
+      if (len) memcpy(&buffer[8], payload, len);
+
+      ACE_Time_Value timeout(GADGETRON_CLOUDBUS_RELAY_SEND_TIMEOUT_MS/1000, (GADGETRON_CLOUDBUS_RELAY_SEND_TIMEOUT_MS%1000)*1000);
+      if (this->peer().send_n(&buffer[0], buffer.size(), &timeout) != (ssize_t)buffer.size()) {
+	GERROR("Failed to send message %d to CloudBus node\n", id);
+	return -1;
+      }
+      return 0;
+    }
+
+    int send_node_list(uint32_t id, std::vector<GadgetronNodeInfo>& nl, uint32_t sequence = 0, bool with_sequence = false)
+    {
+      size_t offset = with_sequence ? 4 : 0;
+      std::vector<char> payload(calculate_node_info_list_length(nl) + 4 + offset);
+      try {
+	if (with_sequence) *((uint32_t*)(&payload[0])) = sequence;
+	serialize(nl, &payload[offset], payload.size()-offset);
+      } catch (...) {
+	GERROR("Error serializing node list\n");
+	throw;
+      }
+      return send_message(id, &payload[0], payload.size());
+    }
+
   private:
     ACE_Reactor_Notification_Strategy notifier_;
     ACE_Stream<ACE_MT_SYNCH> stream_;
@@ -256,6 +381,77 @@ namespace Gadgetron{
     return 0;
   }
 
+  void CloudBusRelayAcceptor::subscribe(CloudBusNodeController* c)
+  {
+    std::vector<GadgetronNodeInfo> nl;
+    uint32_t sequence;
+    mtx_.acquire();
+    subscribers_.insert(c);
+    collect_nodes(nl, c);
+    sequence = sequence_;
+    mtx_.release();
+
+    //The pending changes follow with sequence + 1 and are already part of the snapshot, applying them again is harmless
+    c->send_node_list(GADGETRON_CLOUDBUS_NODE_LIST_SNAPSHOT, nl, sequence, true);
+  }
+
+  void CloudBusRelayAcceptor::subscribe_best_nodes(CloudBusNodeController* c, uint32_t k)
+  {
+    mtx_.acquire();
+    std::pair<uint32_t, std::string>& s = best_subscribers_[c];
+    s.first = k;
+    s.second.clear();
+    send_best_nodes(c, k, s.second);
+    mtx_.release();
+  }
+
+  void CloudBusRelayAcceptor::send_best_nodes(CloudBusNodeController* c, uint32_t k, std::string& last_sent)
+  {
+    std::vector<GadgetronNodeInfo> nl;
+    collect_nodes(nl, c);
+    select_best_nodes(nl, k);
+
+    std::string payload(calculate_node_info_list_length(nl) + 4, '\0');
+    serialize(nl, &payload[0], payload.size());
+
+    //last_sent is empty after a new subscription, so the first list is always sent
+    if (payload == last_sent) return;
+    if (c->send_message(GADGETRON_CLOUDBUS_BEST_NODES_REPLY, payload.c_str(), payload.size()) == 0) {
+      last_sent = payload;
+    }
+  }
+
+  int CloudBusRelayAcceptor::handle_timeout (const ACE_Time_Value& current_time, const void* act)
+  {
+    mtx_.acquire();
+    expire_nodes();
+
+    if (!updated_.empty() || !removed_.empty()) {
+      GadgetronNodeDelta d;
+      d.sequence = ++sequence_;
+      for (std::map<std::string, GadgetronNodeInfo>::iterator it = updated_.begin(); it != updated_.end(); it++) {
+	d.updated.push_back(it->second);
+      }
+      d.removed.assign(removed_.begin(), removed_.end());
+      updated_.clear();
+      removed_.clear();
+
+      //One serialized delta for all subscribers
+      std::vector<char> payload(calculate_node_delta_length(d));
+      serialize(d, &payload[0], payload.size());
+      for (std::set<CloudBusNodeController*>::iterator it = subscribers_.begin(); it != subscribers_.end(); it++) {
+	(*it)->send_message(GADGETRON_CLOUDBUS_NODE_LIST_DELTA, &payload[0], payload.size());
+      }
+
+      for (auto it = best_subscribers_.begin(); it != best_subscribers_.end(); it++) {
+	send_best_nodes(it->first, it->second.first, it->second.second);
+      }
+    }
+
+    mtx_.release();
+    return 0;
+  }
+
 
 }
 
@@ -281,6 +477,13 @@ int main(int argc, char** argv)
   
   ACE_INET_Addr port_to_listen (port_no);
 
+  //The select based default reactor is limited to FD_SETSIZE connections and scans all handles
+  //per event, the epoll based reactor scales to the connections of large clusters
+#if defined (ACE_HAS_EVENT_POLL) || defined (ACE_HAS_DEV_POLL)
+  ACE_Reactor* reactor = new ACE_Reactor(new ACE_Dev_Poll_Reactor(GADGETRON_CLOUDBUS_RELAY_MAX_CONNECTIONS), 1);
+  ACE_Reactor::instance(reactor, 1);
+#endif
+
   Gadgetron::CloudBusRelayAcceptor acceptor;
 
   acceptor.reactor (ACE_Reactor::instance ());
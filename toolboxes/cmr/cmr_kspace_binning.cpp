@@ -146,6 +146,20 @@ CmrKSpaceBinning<T>::~CmrKSpaceBinning()
 
 template <typename T> 
 void CmrKSpaceBinning<T>::process_binning_recon()
+{
+    try
+    {
+        this->process_binning();
+        this->process_binned_recon();
+    }
+    catch(...)
+    {
+        GADGET_THROW("Exceptions happened in CmrKSpaceBinning<T>::process_binning_recon() ... ");
+    }
+}
+
+template <typename T> 
+void CmrKSpaceBinning<T>::process_binning()
 {
     try
     {
@@ -232,18 +246,29 @@ void CmrKSpaceBinning<T>::process_binning_recon()
         // -----------------------------------------------------
         // all time stamps and raw full kspace is filled now
         // binning can be performed
-        std::vector<size_t> slices_not_processing;
-        this->compute_kspace_binning(bestHB, slices_not_processing);
+        slices_not_processing_.clear();
+        this->compute_kspace_binning(bestHB, slices_not_processing_);
         if(binning_obj_.full_kspace_raw_.delete_data_on_destruct()) binning_obj_.full_kspace_raw_.clear();
+    }
+    catch(...)
+    {
+        GADGET_THROW("Exceptions happened in CmrKSpaceBinning<T>::process_binning() ... ");
+    }
+}
 
+template <typename T> 
+void CmrKSpaceBinning<T>::process_binned_recon()
+{
+    try
+    {
         // -----------------------------------------------------
         // perform recon on the binned kspace 
         // -----------------------------------------------------
-        this->perform_recon_binned_kspace(slices_not_processing);
+        this->perform_recon_binned_kspace(slices_not_processing_);
     }
     catch(...)
     {
-        GADGET_THROW("Exceptions happened in CmrKSpaceBinning<T>::process_binning_recon() ... ");
+        GADGET_THROW("Exceptions happened in CmrKSpaceBinning<T>::process_binned_recon() ... ");
     }
 }
 
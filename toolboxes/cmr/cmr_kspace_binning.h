@@ -160,6 +160,12 @@ namespace Gadgetron {
         // ======================================================================================
         virtual void process_binning_recon();
 
+        /// the two stages of process_binning_recon, which can be pipelined over slices
+        /// process_binning : raw data recon, time stamps, respiratory navigator and kspace binning
+        /// process_binned_recon : recon on the binned kspace; only uses the binning results of process_binning
+        virtual void process_binning();
+        virtual void process_binned_recon();
+
         // ------------------------------------
         /// binning object, storing the kspace data and results
         // ------------------------------------
@@ -302,6 +308,9 @@ namespace Gadgetron {
 
     protected:
 
+        /// slices not processed by the binned recon, as found by compute_kspace_binning
+        std::vector<size_t> slices_not_processing_;
+
         // ======================================================================================
         // perform every steps
         // ======================================================================================
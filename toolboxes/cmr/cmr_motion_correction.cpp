@@ -379,6 +379,7 @@ void perform_moco_fixed_key_frame_2DT(Gadgetron::hoNDImageContainer2D< hoNDImage
         reg.setDefaultParameters((unsigned int)level, false);
 
         reg.container_reg_mode_ = GT_IMAGE_REG_CONTAINER_FIXED_REFERENCE;
+        reg.dynamic_scheduling_ = true;
         reg.bg_value_ = -1;
 
         reg.container_reg_transformation_ = (bidirectional_moco ? GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD_BIDIRECTIONAL : GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD);
@@ -545,6 +546,7 @@ void perform_moco_pair_wise_frame_2DT(const Gadgetron::hoNDArray<T>& target, con
         reg.setDefaultParameters((unsigned int)level, false);
 
         reg.container_reg_mode_ = GT_IMAGE_REG_CONTAINER_PAIR_WISE;
+        reg.dynamic_scheduling_ = true;
         reg.bg_value_ = -1;
 
         reg.container_reg_transformation_ = (bidirectional_moco ? GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD_BIDIRECTIONAL : GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD);
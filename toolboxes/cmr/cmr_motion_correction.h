@@ -64,6 +64,7 @@ namespace Gadgetron {
     /// input: [RO E1 N]
     /// the 2D image series are motion corrected and deformation fields are stored in reg.deformation_field_
     /// reg_strength : regularization strength in the unit of pixel
+    /// reg can be a cuImageRegContainer2DRegistration of the gpu registration toolbox to compute the deformation fields on the GPU
     template <typename T> EXPORTCMR void perform_moco_fixed_key_frame_2DT(const Gadgetron::hoNDArray<T>& input, size_t key_frame, bool warp_input, Gadgetron::hoImageRegContainer2DRegistration<Gadgetron::hoNDImage<T, 2>, Gadgetron::hoNDImage<T, 2>, T >& reg);
 
     template <typename T> EXPORTCMR void perform_moco_fixed_key_frame_2DT(const Gadgetron::hoNDArray<T>& input, size_t key_frame,
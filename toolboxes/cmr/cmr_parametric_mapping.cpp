@@ -19,120 +19,140 @@
 #include "hoNDArray_linalg.h"
 
 #include <boost/math/special_functions/sign.hpp>
+#include <algorithm>
 
 namespace Gadgetron { 
 
+// fill the small holes of one map, pLabel holds the labelled holes of the map
 template <typename T>
-void perform_hole_filling(hoNDArray<T>& map, T hole, size_t max_size_of_holes, bool is_8_connected)
+static void perform_hole_filling_on_map(hoNDImage<T, 2>& curr_map, const unsigned int* pLabel, T minV, size_t max_size_of_holes)
 {
-    try
-    {
-        hoNDArray<unsigned int> label;
+    size_t RO = curr_map.get_size(0);
+    size_t E1 = curr_map.get_size(1);
 
-        size_t RO = map.get_size(0);
-        size_t E1 = map.get_size(1);
+    T v = Gadgetron::norm2(curr_map);
+    if (v <= 1e-3) return; // empty map
 
-        size_t num = map.get_number_of_elements() / (RO*E1);
+    T maxV;
+    Gadgetron::maxValue(curr_map, maxV);
 
-        std::vector<size_t> dim(2);
-        dim[0] = RO;
-        dim[1] = E1;
+    hoNDArray<unsigned int> label(RO, E1, const_cast<unsigned int*>(pLabel));
 
-        size_t t;
-        for (t = 0; t < num; t++)
+    std::vector<unsigned int> labels, areas;
+    GADGET_CATCH_THROW(Gadgetron::bwlabel_area_2d(label, labels, areas));
+
+    bool needHoleFilling = false;
+    size_t numHoles = labels.size();
+
+    size_t n;
+    for (n = 0; n < numHoles; n++)
+    {
+        if (areas[n] <= max_size_of_holes)
         {
-            hoNDImage<T, 2> curr_map;
-            curr_map.create(dim, map.begin() + t*RO*E1);
+            needHoleFilling = true;
+            break;
+        }
+    }
 
-            T v = Gadgetron::norm2(curr_map);
-            if (v <= 1e-3) continue; // empty map
+    if (!needHoleFilling) return;
 
-            T maxV;
-            Gadgetron::maxValue(curr_map, maxV);
+    size_t gridSize[2];
+    gridSize[0] = 3;
+    gridSize[1] = 3;
 
-            T minV;
-            Gadgetron::minValue(map, minV);
+    size_t numOfRefinement = 0;
+    size_t numOfControlPts = gridSize[0];
+    while (numOfControlPts < RO)
+    {
+        numOfRefinement++;
+        numOfControlPts = 2 * numOfControlPts - 1;
+    }
 
-            label.clear();
-            GADGET_CATCH_THROW(Gadgetron::bwlabel_2d(curr_map, hole, label, is_8_connected));
+    typedef typename Gadgetron::BSplineFFD2D<T, float, 1>::MaskArrayType MaskArrayType;
 
-            std::vector<unsigned int> labels, areas;
-            GADGET_CATCH_THROW(Gadgetron::bwlabel_area_2d(label, labels, areas));
+    MaskArrayType mask;
+    mask.create(RO, E1);
+    Gadgetron::fill(mask, float(1));
 
-            bool needHoleFilling = false;
-            size_t numHoles = labels.size();
+    for (n = 0; n < RO*E1; n++)
+    {
+        unsigned int l = label(n);
 
-            size_t n;
-            for (n = 0; n < numHoles; n++)
+        if (l > 0)
+        {
+            size_t p;
+            for (p = 0; p < labels.size(); p++)
             {
-                if (areas[n] <= max_size_of_holes)
-                {
-                    needHoleFilling = true;
-                    break;
-                }
+                if (l == labels[p]) break;
             }
 
-            if (needHoleFilling)
+            if (areas[p] <= max_size_of_holes)
             {
-                size_t gridSize[2];
-                gridSize[0] = 3;
-                gridSize[1] = 3;
+                mask(n) = 0;
+            }
+        }
+    }
 
-                size_t numOfRefinement = 0;
-                size_t numOfControlPts = gridSize[0];
-                while (numOfControlPts < RO)
-                {
-                    numOfRefinement++;
-                    numOfControlPts = 2 * numOfControlPts - 1;
-                }
+    T totalResidual(0);
+    Gadgetron::BSplineFFD2D<T, float, 1> ffd(curr_map, gridSize[0], gridSize[1]);
 
-                typedef typename Gadgetron::BSplineFFD2D<T, float, 1>::MaskArrayType MaskArrayType;
+    ffd.ffdApproxImage(&curr_map, mask, totalResidual, numOfRefinement);
 
-                MaskArrayType mask;
-                mask.create(RO, E1);
-                Gadgetron::fill(mask, float(1));
+    hoNDImage<T, 2> flowDual(curr_map);
+    ffd.evaluateFFDOnImage(flowDual);
 
-                for (n = 0; n < RO*E1; n++)
-                {
-                    unsigned int l = label(n);
+    for (n = 0; n < RO*E1; n++)
+    {
+        if (mask(n) == 0)
+        {
+            T v(0);
+            v = flowDual(n);
+            if (v >= 0.9*minV && v <= 1.1*maxV) curr_map(n) = v;
+        }
+    }
+}
 
-                    if (l > 0)
-                    {
-                        size_t p;
-                        for (p = 0; p < labels.size(); p++)
-                        {
-                            if (l == labels[p]) break;
-                        }
+template <typename T>
+void perform_hole_filling(hoNDArray<T>& map, T hole, size_t max_size_of_holes, bool is_8_connected)
+{
+    try
+    {
+        size_t RO = map.get_size(0);
+        size_t E1 = map.get_size(1);
 
-                        if (areas[p] <= max_size_of_holes)
-                        {
-                            mask(n) = 0;
-                        }
-                    }
-                }
+        size_t num = map.get_number_of_elements() / (RO*E1);
+
+        std::vector<size_t> dim(2);
+        dim[0] = RO;
+        dim[1] = E1;
 
-                T totalResidual(0);
-                Gadgetron::BSplineFFD2D<T, float, 1> ffd(curr_map, gridSize[0], gridSize[1]);
+        // the holes of all maps are labelled in one batch, and the minimum is taken before any map is filled
+        hoNDArray<unsigned int> label;
+        GADGET_CATCH_THROW(Gadgetron::bwlabel_2d_batch(map, hole, label, is_8_connected));
 
-                ffd.ffdApproxImage(&curr_map, mask, totalResidual, numOfRefinement);
+        T minV;
+        Gadgetron::minValue(map, minV);
 
-                hoNDImage<T, 2> flowDual(curr_map);
-                ffd.evaluateFFDOnImage(flowDual);
+        bool failed = false;
 
-                for (n = 0; n < RO*E1; n++)
-                {
-                    if (mask(n) == 0)
-                    {
-                        std::vector<size_t> pt(3);
-                        curr_map.calculate_index(n, pt);
+        long long t;
+#pragma omp parallel for default(none) private(t) shared(map, label, dim, RO, E1, num, minV, max_size_of_holes, failed) schedule(dynamic) if(num>1)
+        for (t = 0; t < (long long)num; t++)
+        {
+            try
+            {
+                hoNDImage<T, 2> curr_map;
+                curr_map.create(dim, map.begin() + t*RO*E1);
 
-                        T v(0);
-                        v = flowDual(n);
-                        if (v >= 0.9*minV && v <= 1.1*maxV) curr_map(n) = v;
-                    }
-                }
+                perform_hole_filling_on_map(curr_map, label.begin() + t*RO*E1, minV, max_size_of_holes);
+            }
+            catch (...)
+            {
+                failed = true;
             }
         }
+
+        GADGET_CHECK_THROW(!failed);
     }
     catch (...)
     {
@@ -153,14 +173,35 @@ void perform_hole_filling(Gadgetron::hoNDImageContainer2D< hoMRImage<T, 2> >& ma
         size_t row = maps.rows();
         std::vector<size_t> cols = maps.cols();
 
+        std::vector< hoMRImage<T, 2>* > images;
+
         size_t r, c;
         for (r = 0; r < row; r++)
         {
             for (c = 0; c < cols[r]; c++)
             {
-                GADGET_CATCH_THROW( Gadgetron::perform_hole_filling(maps(r, c), hole, max_size_of_holes, is_8_connected) );
+                images.push_back(&maps(r, c));
             }
         }
+
+        // the maps of the series are filled in parallel
+        bool failed = false;
+
+        long long n;
+#pragma omp parallel for default(none) private(n) shared(images, hole, max_size_of_holes, is_8_connected, failed) schedule(dynamic) if(images.size()>1)
+        for (n = 0; n < (long long)images.size(); n++)
+        {
+            try
+            {
+                Gadgetron::perform_hole_filling(*images[n], hole, max_size_of_holes, is_8_connected);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+        }
+
+        GADGET_CHECK_THROW(!failed);
     }
     catch (...)
     {
@@ -188,6 +229,9 @@ CmrParametricMapping<T>::CmrParametricMapping()
 
     max_map_value_ = -1;
 
+    batch_size_ = 64;
+    batch_fitting_ = false;
+
     verbose_ = false;
     perform_timing_ = false;
 
@@ -256,7 +300,10 @@ void CmrParametricMapping<T>::perform_parametric_mapping()
 
         if (this->perform_timing_) { gt_timer_.start("perform pixel-wise mapping ... "); }
 
-        long long ro, e1;
+        size_t batch_size = (this->batch_size_ > 0) ? this->batch_size_ : 1;
+
+        std::vector<size_t> pixels;
+        pixels.reserve(RO*E1);
 
         for (slc = 0; slc < SLC; slc++)
         {
@@ -281,49 +328,73 @@ void CmrParametricMapping<T>::perform_parametric_mapping()
                     pMaskCurr = pMask + s*RO*E1 + slc*S*RO*E1;
                 }
 
-#pragma omp parallel private(e1, ro, n) shared(RO, E1, pMask, pMaskCurr, pData, pMap, pMapSD, pPara, pParaSD, num_ti, NUM)
+                // background pixels are not fitted at all
+                pixels.clear();
+                for (size_t offset = 0; offset < RO*E1; offset++)
+                {
+                    if (pMaskCurr == NULL || pMaskCurr[offset] > 0) pixels.push_back(offset);
+                }
+
+                long long num_pixels = (long long)pixels.size();
+                long long num_batches = (num_pixels + (long long)batch_size - 1) / (long long)batch_size;
+                long long b;
+
+#pragma omp parallel private(b, n) shared(pixels, num_pixels, num_batches, batch_size, pData, pMap, pMapSD, pPara, pParaSD, num_ti, NUM, RO, E1)
                 {
+                    hoNDArray<T> yi_batch(batch_size, num_ti);
+                    hoNDArray<T> bi_batch(batch_size, NUM);
+                    std::vector<T> map_batch(batch_size, 0);
+
                     std::vector<T> yi(num_ti, 0);
-                    std::vector<T> guess(NUM + 1, 0);
-                    std::vector<T> bi(NUM + 1, 0);
+                    std::vector<T> bi(NUM, 0);
                     std::vector<T> sd(NUM + 1, 0);
 
-                    T map_v(0), map_sd(0);
+                    T map_sd(0);
 
-#pragma omp for 
-                    for (e1 = 0; e1 < E1; e1++)
+#pragma omp for schedule(dynamic)
+                    for (b = 0; b < num_batches; b++)
                     {
-                        for (ro = 0; ro < RO; ro++)
-                        {
-                            long long offset = ro + e1*RO;
+                        size_t first = (size_t)b*batch_size;
+                        size_t B = std::min(batch_size, (size_t)num_pixels - first);
 
-                            if (pMask != NULL)
-                            {
-                                if (pMaskCurr[offset] <= 0)
-                                    continue;
-                            }
+                        if (yi_batch.get_size(0) != B)
+                        {
+                            yi_batch.create(B, num_ti);
+                            bi_batch.create(B, NUM);
+                            map_batch.resize(B);
+                        }
 
-                            // get data vector
-                            for (n = 0; n < num_ti; n++)
+                        // gather the signals, every time point is contiguous over the batch
+                        size_t p;
+                        for (n = 0; n < num_ti; n++)
+                        {
+                            const T* pDataN = pData + n*RO*E1;
+                            T* pY = yi_batch.begin() + n*B;
+                            for (p = 0; p < B; p++)
                             {
-                                yi[n] = pData[offset + n*RO*E1];
+                                pY[p] = pDataN[pixels[first + p]];
                             }
+                        }
 
-                            // estimate initial para
-                            this->get_initial_guess(ti_, yi, guess);
+                        // perform mapping
+                        this->compute_map_batch(ti_, yi_batch, bi_batch, map_batch);
 
-                            // perform mapping
-                            this->compute_map(ti_, yi, guess, bi, map_v);
+                        for (p = 0; p < B; p++)
+                        {
+                            size_t offset = pixels[first + p];
 
-                            pMap[offset] = map_v;
+                            pMap[offset] = map_batch[p];
                             for (n = 0; n < NUM; n++)
                             {
-                                pPara[offset + n*RO*E1] = bi[n];
+                                pPara[offset + n*RO*E1] = bi_batch(p, n);
                             }
 
                             // compute SD if needed
                             if (this->compute_SD_maps_)
                             {
+                                for (n = 0; n < num_ti; n++) yi[n] = yi_batch(p, n);
+                                for (n = 0; n < NUM; n++) bi[n] = bi_batch(p, n);
+
                                 try
                                 {
                                     this->compute_sd(ti_, yi, bi, sd, map_sd);
@@ -408,6 +479,30 @@ void CmrParametricMapping<T>::compute_map(const std::vector<T>& ti, const std::v
     map_v = 0;
 }
 
+template <typename T>
+void CmrParametricMapping<T>::compute_map_batch(const VectorType& ti, const hoNDArray<T>& yi, hoNDArray<T>& bi, VectorType& map_v)
+{
+    size_t B = yi.get_size(0);
+    size_t num_ti = yi.get_size(1);
+    size_t NUM = this->get_num_of_paras();
+
+    VectorType y(num_ti, 0), guess(NUM, 0), b(NUM, 0);
+
+    if (bi.get_size(0) != B || bi.get_size(1) != NUM) bi.create(B, NUM);
+    map_v.resize(B, 0);
+
+    size_t p, n;
+    for (p = 0; p < B; p++)
+    {
+        for (n = 0; n < num_ti; n++) y[n] = yi(p, n);
+
+        this->get_initial_guess(ti, y, guess);
+        this->compute_map(ti, y, guess, b, map_v[p]);
+
+        for (n = 0; n < NUM; n++) bi(p, n) = b[n];
+    }
+}
+
 template <typename T>
 void CmrParametricMapping<T>::compute_sd(const std::vector<T>& ti, const std::vector<T>& yi, const std::vector<T>& bi, std::vector<T>& sd, T& map_sd)
 {
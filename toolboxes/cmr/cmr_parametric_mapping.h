@@ -105,6 +105,12 @@ namespace Gadgetron {
         /// maximal valid value of map
         T max_map_value_;
 
+        /// pixels inside the mask are fitted in batches of this size
+        size_t batch_size_;
+        /// if true, signal models with a batched solver fit the pixels of a batch together
+        /// otherwise, every pixel is fitted with compute_map
+        bool batch_fitting_;
+
         // ======================================================================================
         /// parameter for debugging
         // ======================================================================================
@@ -133,6 +139,12 @@ namespace Gadgetron {
         /// compute map values for every parameters in bi
         virtual void compute_map(const VectorType& ti, const VectorType& yi, const VectorType& guess, VectorType& bi, T& map_v);
 
+        /// compute map values for a batch of pixels
+        /// yi: [B num_ti] signal of B pixels, every time point is stored contiguously for all pixels
+        /// bi: [B NUM] parameters, map_v: [B] map values
+        /// by default, every pixel is fitted with get_initial_guess and compute_map
+        virtual void compute_map_batch(const VectorType& ti, const hoNDArray<T>& yi, hoNDArray<T>& bi, VectorType& map_v);
+
         /// compute SD values for every parameters in bi
         virtual void compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd);
 
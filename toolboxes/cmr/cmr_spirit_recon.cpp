@@ -9,6 +9,7 @@
 #include "mri_core_spirit.h"
 #include "hoNDArray_reductions.h"
 #include "hoNDFFT.h"
+#include "GadgetronThreadBudget.h"
 #include "hoSPIRIT2DOperator.h"
 #include "hoLsqrSolver.h"
 #include "hoSPIRIT2DTDataFidelityOperator.h"
@@ -63,7 +64,7 @@ namespace Gadgetron {
 
 #ifdef USE_OMP
             int numThreads = (int)num;
-            if (numThreads > omp_get_num_procs()) numThreads = omp_get_num_procs();
+            if (numThreads > GadgetronThreadBudget::num_threads()) numThreads = GadgetronThreadBudget::num_threads();
             GDEBUG_CONDITION_STREAM(print_iter, "numThreads : " << numThreads);
 #endif // USE_OMP
 
@@ -80,6 +81,7 @@ namespace Gadgetron {
                 hoSPIRIT2DOperator< T >& spirit = *oper;
                 spirit.use_non_centered_fft_ = true;
                 spirit.no_null_space_ = false;
+                spirit.use_blocked_kernel_ = true;
 
                 if (ref_N == 1 && ref_S == 1)
                 {
@@ -268,6 +270,7 @@ namespace Gadgetron {
                 std::vector<size_t> dims;
                 acq->get_dimensions(dims);
                 hoSPIRIT2DTDataFidelityOperator< T > spirit(&dims);
+                spirit.use_blocked_kernel_ = true;
                 spirit.set_forward_kernel(*ker, false);
                 spirit.set_acquired_points(*acq);
 
@@ -324,6 +327,7 @@ namespace Gadgetron {
                 acq->get_dimensions(dims);
 
                 hoSPIRIT2DTOperator< T > spirit(&dims);
+                spirit.use_blocked_kernel_ = true;
                 spirit.set_forward_kernel(*ker, false);
                 spirit.set_acquired_points(*acq);
                 spirit.no_null_space_ = true;
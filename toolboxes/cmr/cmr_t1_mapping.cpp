@@ -15,9 +15,125 @@
 #include "curveFittingCostFunction.h"
 
 #include <boost/math/special_functions/sign.hpp>
+#include <algorithm>
+#include <list>
+#include <mutex>
 
 namespace Gadgetron { 
 
+template <typename T>
+CmrT1SRDictionary<T>::CmrT1SRDictionary(const std::vector<T>& ti, T min_T1, T max_T1, size_t num_atoms) : ti_(ti)
+{
+    GADGET_CHECK_THROW(min_T1 > 0 && max_T1 > min_T1 && num_atoms > 1);
+
+    size_t num = ti.size();
+
+    t1_.resize(num_atoms);
+    atoms_.resize(num*num_atoms, 0);
+    norms_.resize(num_atoms, 0);
+
+    double ratio = std::log((double)max_T1 / (double)min_T1) / (double)(num_atoms - 1);
+
+    size_t k, n;
+    for (k = 0; k < num_atoms; k++)
+    {
+        t1_[k] = (T)(min_T1 * std::exp(ratio*k));
+
+        double norm = 0;
+        for (n = 0; n < num; n++)
+        {
+            double v = 1.0 - std::exp(-(double)ti[n] / (double)t1_[k]);
+            atoms_[k + n*num_atoms] = (T)v;
+            norm += v*v;
+        }
+
+        norm = std::sqrt(norm);
+        norms_[k] = (T)norm;
+        for (n = 0; n < num; n++)
+        {
+            if (norm > 0) atoms_[k + n*num_atoms] /= (T)norm;
+        }
+    }
+}
+
+template <typename T>
+boost::shared_ptr< CmrT1SRDictionary<T> > CmrT1SRDictionary<T>::get(const std::vector<T>& ti, T min_T1, T max_T1, size_t num_atoms)
+{
+    static std::mutex cache_mutex;
+    static std::list< boost::shared_ptr< CmrT1SRDictionary<T> > > cache;
+    const size_t cache_size = 4;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    typename std::list< boost::shared_ptr< CmrT1SRDictionary<T> > >::iterator iter;
+    for (iter = cache.begin(); iter != cache.end(); ++iter)
+    {
+        const CmrT1SRDictionary<T>& d = **iter;
+        if (d.ti_ == ti && d.t1_.size() == num_atoms && d.t1_.front() == min_T1 && std::abs(d.t1_.back() - max_T1) <= T(1e-3)*max_T1)
+        {
+            boost::shared_ptr< CmrT1SRDictionary<T> > res = *iter;
+            cache.erase(iter);
+            cache.push_front(res);
+            return res;
+        }
+    }
+
+    boost::shared_ptr< CmrT1SRDictionary<T> > res(new CmrT1SRDictionary<T>(ti, min_T1, max_T1, num_atoms));
+    cache.push_front(res);
+    if (cache.size() > cache_size) cache.pop_back();
+
+    return res;
+}
+
+template <typename T>
+void CmrT1SRDictionary<T>::match(const T* y, T& A, T& T1) const
+{
+    this->match_batch(y, 1, &A, &T1);
+}
+
+template <typename T>
+void CmrT1SRDictionary<T>::match_batch(const T* y, size_t B, T* A, T* T1) const
+{
+    size_t num = ti_.size();
+    size_t K = t1_.size();
+
+    std::vector<T> best(B, -1), dot(B);
+    std::vector<size_t> best_k(B, 0);
+
+    size_t k, n, p;
+    for (k = 0; k < K; k++)
+    {
+        std::fill(dot.begin(), dot.end(), T(0));
+        for (n = 0; n < num; n++)
+        {
+            const T a = atoms_[k + n*K];
+            const T* pY = y + n*B;
+            for (p = 0; p < B; p++)
+            {
+                dot[p] += a*pY[p];
+            }
+        }
+
+        for (p = 0; p < B; p++)
+        {
+            bool better = dot[p] > best[p];
+            best[p] = better ? dot[p] : best[p];
+            best_k[p] = better ? k : best_k[p];
+        }
+    }
+
+    for (p = 0; p < B; p++)
+    {
+        // A is the projection of the signal onto the unnormalized atom
+        A[p] = (best[p] > 0) ? best[p] / norms_[best_k[p]] : T(0);
+        T1[p] = t1_[best_k[p]];
+    }
+}
+
+template class EXPORTCMR CmrT1SRDictionary< float >;
+
+// ------------------------------------------------------------
+
 template <typename T> 
 CmrT1SRMapping<T>::CmrT1SRMapping() : BaseClass()
 {
@@ -27,6 +143,11 @@ CmrT1SRMapping<T>::CmrT1SRMapping() : BaseClass()
 
     // maximal allowed T1
     max_map_value_ = 2500;
+
+    dictionary_initialization_ = false;
+    dictionary_min_T1_ = 10;
+    dictionary_max_T1_ = 0;
+    dictionary_size_ = 256;
 }
 
 template <typename T> 
@@ -34,6 +155,30 @@ CmrT1SRMapping<T>::~CmrT1SRMapping()
 {
 }
 
+template <typename T>
+void CmrT1SRMapping<T>::perform_parametric_mapping()
+{
+    try
+    {
+        dictionary_.reset();
+
+        if (dictionary_initialization_ && !ti_.empty())
+        {
+            T max_T1 = (dictionary_max_T1_ > 0) ? dictionary_max_T1_ : max_map_value_;
+            if (max_T1 > dictionary_min_T1_)
+            {
+                dictionary_ = CmrT1SRDictionary<T>::get(ti_, dictionary_min_T1_, max_T1, dictionary_size_);
+            }
+        }
+
+        BaseClass::perform_parametric_mapping();
+    }
+    catch (...)
+    {
+        GADGET_THROW("Exceptions happened in CmrT1SRMapping<T>::perform_parametric_mapping(...) ... ");
+    }
+}
+
 template <typename T>
 void CmrT1SRMapping<T>::get_initial_guess(const VectorType& ti, const VectorType& yi, VectorType& guess)
 {
@@ -50,6 +195,17 @@ void CmrT1SRMapping<T>::get_initial_guess(const VectorType& ti, const VectorType
 
     // T1
     if (!ti.empty()) guess[1] = ti[ti.size() / 2];
+
+    if (dictionary_ && dictionary_->ti_.size() == yi.size())
+    {
+        T A, T1;
+        dictionary_->match(&yi[0], A, T1);
+        if (A > 0)
+        {
+            guess[0] = A;
+            guess[1] = T1;
+        }
+    }
 }
 
 template <typename T>
@@ -96,6 +252,161 @@ void CmrT1SRMapping<T>::compute_map(const VectorType& ti, const VectorType& yi,
     }
 }
 
+template <typename T>
+void CmrT1SRMapping<T>::compute_map_batch(const VectorType& ti, const hoNDArray<T>& yi, hoNDArray<T>& bi, VectorType& map_v)
+{
+    try
+    {
+        if (!batch_fitting_)
+        {
+            BaseClass::compute_map_batch(ti, yi, bi, map_v);
+            return;
+        }
+
+        size_t B = yi.get_size(0);
+        size_t num = yi.get_size(1);
+        GADGET_CHECK_THROW(num <= ti.size());
+
+        if (bi.get_size(0) != B || bi.get_size(1) != 2) bi.create(B, 2);
+        map_v.resize(B, 0);
+
+        T* pA = bi.begin();
+        T* pT1 = bi.begin() + B;
+        const T* pY = yi.begin();
+
+        // lanes of the batch: damping, current cost, normal equations and trial parameters
+        std::vector<T> lambda(B, T(1e-3)), cost(B, 0), active(B, 1);
+        std::vector<T> haa(B), hat(B), htt(B), ga(B), gt(B), trial_A(B), trial_T1(B), trial_cost(B);
+
+        size_t p, n;
+
+        // initial guess, as in get_initial_guess
+        for (p = 0; p < B; p++)
+        {
+            T maxY = pY[p];
+            for (n = 1; n < num; n++) maxY = std::max(maxY, pY[p + n*B]);
+            pA[p] = maxY;
+            pT1[p] = (num > 0) ? ti[num / 2] : T(1200);
+        }
+
+        if (dictionary_ && dictionary_->ti_.size() == num)
+        {
+            std::vector<T> dict_A(B), dict_T1(B);
+            dictionary_->match_batch(pY, B, &dict_A[0], &dict_T1[0]);
+
+            for (p = 0; p < B; p++)
+            {
+                if (dict_A[p] > 0)
+                {
+                    pA[p] = dict_A[p];
+                    pT1[p] = dict_T1[p];
+                }
+            }
+        }
+
+        const T eps = T(FLT_EPSILON);
+        const T tol = T(1e-6);
+
+        size_t iter;
+        for (iter = 0; iter < max_iter_; iter++)
+        {
+            std::fill(haa.begin(), haa.end(), T(0));
+            std::fill(hat.begin(), hat.end(), T(0));
+            std::fill(htt.begin(), htt.end(), T(0));
+            std::fill(ga.begin(), ga.end(), T(0));
+            std::fill(gt.begin(), gt.end(), T(0));
+            std::fill(cost.begin(), cost.end(), T(0));
+
+            // residuals and jacobian of y = A - A*exp(-ti/T1)
+            for (n = 0; n < num; n++)
+            {
+                const T t = ti[n];
+                const T* pYn = pY + n*B;
+                for (p = 0; p < B; p++)
+                {
+                    T T1 = std::max(pT1[p], eps);
+                    T rT = T(1) / T1;
+                    T e = std::exp(-t*rT);
+                    T ja = T(1) - e;
+                    T jt = -pA[p] * e * t * rT * rT;
+                    T r = pA[p] * ja - pYn[p];
+
+                    haa[p] += ja*ja;
+                    hat[p] += ja*jt;
+                    htt[p] += jt*jt;
+                    ga[p] += ja*r;
+                    gt[p] += jt*r;
+                    cost[p] += r*r;
+                }
+            }
+
+            // damped step
+            for (p = 0; p < B; p++)
+            {
+                T d = T(1) + lambda[p];
+                T a11 = haa[p] * d;
+                T a22 = htt[p] * d;
+                T det = a11*a22 - hat[p] * hat[p];
+                T rdet = (std::abs(det) > eps*eps) ? T(1) / det : T(0);
+
+                trial_A[p] = pA[p] - (a22*ga[p] - hat[p] * gt[p]) * rdet;
+                trial_T1[p] = pT1[p] - (a11*gt[p] - hat[p] * ga[p]) * rdet;
+                trial_cost[p] = 0;
+            }
+
+            for (n = 0; n < num; n++)
+            {
+                const T t = ti[n];
+                const T* pYn = pY + n*B;
+                for (p = 0; p < B; p++)
+                {
+                    T T1 = std::max(trial_T1[p], eps);
+                    T r = trial_A[p] * (T(1) - std::exp(-t / T1)) - pYn[p];
+                    trial_cost[p] += r*r;
+                }
+            }
+
+            // accept the steps which reduce the cost, converged pixels are not changed any more
+            size_t num_active = 0;
+            for (p = 0; p < B; p++)
+            {
+                bool accept = (active[p] > 0) && (trial_T1[p] > 0) && (trial_cost[p] < cost[p]);
+
+                T dA = std::abs(trial_A[p] - pA[p]);
+                T dT1 = std::abs(trial_T1[p] - pT1[p]);
+                bool converged = accept && (dA <= tol*std::abs(pA[p])) && (dT1 <= tol*std::abs(pT1[p]));
+
+                if (accept)
+                {
+                    pA[p] = trial_A[p];
+                    pT1[p] = trial_T1[p];
+                }
+
+                lambda[p] = accept ? lambda[p] * T(0.1) : lambda[p] * T(10);
+                if (converged || lambda[p] > T(1e10) || cost[p] <= eps) active[p] = 0;
+
+                if (active[p] > 0) num_active++;
+            }
+
+            if (num_active == 0) break;
+        }
+
+        for (p = 0; p < B; p++)
+        {
+            map_v[p] = 0;
+            if (pA[p] > 0 && pT1[p] > 0)
+            {
+                map_v[p] = pT1[p];
+                if (map_v[p] > max_map_value_) map_v[p] = hole_marking_value_;
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Exceptions happened in CmrT1SRMapping<T>::compute_map_batch(...) ... ");
+    }
+}
+
 template <typename T>
 void CmrT1SRMapping<T>::compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd)
 {
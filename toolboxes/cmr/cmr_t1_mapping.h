@@ -8,6 +8,7 @@
 #pragma once
 
 #include "cmr_parametric_mapping.h"
+#include <boost/shared_ptr.hpp>
 
 namespace Gadgetron { 
 
@@ -15,6 +16,33 @@ namespace Gadgetron {
 // T1 Saturation recovery
 // y = A * ( 1-exp(-ti/T1) )
 
+/// dictionary of saturation recovery curves for a list of saturation times
+/// for a fixed T1 the model is linear in A, so a signal is matched to the atom with the largest normalized correlation
+template <typename T>
+class EXPORTCMR CmrT1SRDictionary
+{
+public:
+
+    /// num_atoms T1 values, logarithmically spaced in [min_T1 max_T1]
+    CmrT1SRDictionary(const std::vector<T>& ti, T min_T1, T max_T1, size_t num_atoms);
+
+    /// dictionaries are cached for the last used saturation times and T1 ranges, e.g. for every protocol
+    static boost::shared_ptr< CmrT1SRDictionary<T> > get(const std::vector<T>& ti, T min_T1, T max_T1, size_t num_atoms);
+
+    /// match one signal, y has ti.size() points
+    void match(const T* y, T& A, T& T1) const;
+
+    /// match B signals in the [B num_ti] layout of CmrParametricMapping::compute_map_batch
+    void match_batch(const T* y, size_t B, T* A, T* T1) const;
+
+    std::vector<T> ti_;
+    std::vector<T> t1_;
+    /// normalized atoms, [num_ti num_atoms]
+    std::vector<T> atoms_;
+    /// norms of the atoms before normalization
+    std::vector<T> norms_;
+};
+
 template <typename T>
 class EXPORTCMR CmrT1SRMapping : public CmrParametricMapping<T>
 {
@@ -35,17 +63,31 @@ public:
     /// parameter for t1 SR mapping
     // ======================================================================================
 
+    /// if true, the fitting is initialized by the best matching atom of a T1 dictionary
+    bool dictionary_initialization_;
+    /// T1 range and number of atoms of the dictionary; if dictionary_max_T1_ <= 0, max_map_value_ is used
+    T dictionary_min_T1_;
+    T dictionary_max_T1_;
+    size_t dictionary_size_;
 
     // ======================================================================================
     // perform every steps
     // ======================================================================================
 
+    /// fetch the dictionary for ti_ if needed and perform the mapping
+    virtual void perform_parametric_mapping();
+
     /// provide initial guess for the mapping
     virtual void get_initial_guess(const VectorType& ti, const VectorType& yi, VectorType& guess);
 
     /// compute map values for every parameters in bi
     virtual void compute_map(const VectorType& ti, const VectorType& yi, const VectorType& guess, VectorType& bi, T& map_v);
 
+    /// compute map values for a batch of pixels
+    /// if batch_fitting_ is true, all pixels are fitted together by a Levenberg-Marquardt solver
+    /// the pixels are processed in lock step, so the inner loops run over the pixels and vectorise
+    virtual void compute_map_batch(const VectorType& ti, const hoNDArray<T>& yi, hoNDArray<T>& bi, VectorType& map_v);
+
     /// compute SD values for every parameters in bi
     virtual void compute_sd(const VectorType& ti, const VectorType& yi, const VectorType& bi, VectorType& sd, T& map_sd);
 
@@ -71,6 +113,8 @@ public:
     using BaseClass::max_fun_eval_;
     using BaseClass::thres_fun_;
     using BaseClass::max_map_value_;
+    using BaseClass::batch_size_;
+    using BaseClass::batch_fitting_;
 
     using BaseClass::verbose_;
     using BaseClass::debug_folder_;
@@ -78,6 +122,10 @@ public:
     using BaseClass::gt_timer_local_;
     using BaseClass::gt_timer_;
     using BaseClass::gt_exporter_;
+
+protected:
+
+    boost::shared_ptr< CmrT1SRDictionary<T> > dictionary_;
 };
 
 }
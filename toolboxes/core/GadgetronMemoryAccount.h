@@ -0,0 +1,260 @@
+/** \file GadgetronMemoryAccount.h
+    \brief Accounting of the array memory held per stream and per gadget.
+
+    A GadgetronMemoryAccount counts the bytes of host (hoNDArray) and device (cuNDArray) array
+    memory allocated while it is the current account of the thread. Accounts form a tree: the
+    stream controller owns the account of the stream, every gadget an account below it, and the
+    bytes charged to a gadget are charged to the stream as well.
+
+    The allocators report every buffer to the GadgetronMemoryTracker, which charges it to the
+    current account and remembers the account by address, so the buffer is credited back to the
+    same account when it is released, on whatever thread that happens. A buffer stays with the
+    gadget that allocated it while it is passed down the stream. Buffers allocated without a
+    current account (outside of the gadgets) are not tracked and cost one thread local lookup.
+
+    As with GadgetronProfile, the current account of the thread is set with a scope; the Gadget
+    does this around process() and process_config().
+*/
+
+#ifndef __GADGETRONMEMORYACCOUNT_H
+#define __GADGETRONMEMORYACCOUNT_H
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class GadgetronMemoryAccount : public std::enable_shared_from_this<GadgetronMemoryAccount>
+  {
+  public:
+    enum Kind { HOST = 0, DEVICE = 1, NUMBER_OF_KINDS = 2 };
+
+    /// A new account, charged to parent as well if there is one
+    static std::shared_ptr<GadgetronMemoryAccount> create(const std::string& name,
+                                                          std::shared_ptr<GadgetronMemoryAccount> parent = std::shared_ptr<GadgetronMemoryAccount>())
+    {
+      std::shared_ptr<GadgetronMemoryAccount> account(new GadgetronMemoryAccount(name, parent));
+      if (parent) {
+        std::lock_guard<std::mutex> guard(parent->mutex_);
+        parent->children_.push_back(account);
+      }
+      return account;
+    }
+
+    /// Account the calling thread charges its allocations to, 0 if there is none
+    static GadgetronMemoryAccount*& current()
+    {
+      static thread_local GadgetronMemoryAccount* account = 0;
+      return account;
+    }
+
+    const std::string& name() const { return name_; }
+
+    /// Bytes currently held
+    size_t bytes(Kind k) const { return (size_t)bytes_[k].load(std::memory_order_relaxed); }
+
+    /// Largest number of bytes held at any time
+    size_t peak_bytes(Kind k) const { return (size_t)peak_[k].load(std::memory_order_relaxed); }
+
+    /// Charges n bytes (credits them if n is negative) to this account and its parents
+    void add(Kind k, int64_t n)
+    {
+      int64_t b = bytes_[k].fetch_add(n, std::memory_order_relaxed) + n;
+      int64_t p = peak_[k].load(std::memory_order_relaxed);
+      while (b > p && !peak_[k].compare_exchange_weak(p, b, std::memory_order_relaxed)) {}
+
+      if (parent_) parent_->add(k, n);
+    }
+
+    /// The accounts created with this one as parent that still exist
+    std::vector< std::shared_ptr<GadgetronMemoryAccount> > children()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      std::vector< std::shared_ptr<GadgetronMemoryAccount> > live;
+      std::vector< std::weak_ptr<GadgetronMemoryAccount> > kept;
+      for (size_t i = 0; i < children_.size(); i++) {
+        std::shared_ptr<GadgetronMemoryAccount> c = children_[i].lock();
+        if (c) {
+          live.push_back(c);
+          kept.push_back(c);
+        }
+      }
+      children_.swap(kept);
+      return live;
+    }
+
+    /// One line per account in MB, children are indented under their parent
+    void print(std::ostream& os, size_t depth = 0)
+    {
+      if (depth == 0) {
+        os << std::setw(50) << std::left << "account"
+           << std::right
+           << std::setw(12) << "host"
+           << std::setw(12) << "host peak"
+           << std::setw(12) << "device"
+           << std::setw(12) << "device peak" << "\n";
+      }
+
+      std::ios::fmtflags flags = os.flags();
+      os << std::fixed << std::setprecision(1);
+      os << std::setw(50) << std::left << std::string(2 * depth, ' ') + name_
+         << std::right
+         << std::setw(12) << bytes(HOST) / 1048576.0
+         << std::setw(12) << peak_bytes(HOST) / 1048576.0
+         << std::setw(12) << bytes(DEVICE) / 1048576.0
+         << std::setw(12) << peak_bytes(DEVICE) / 1048576.0 << "\n";
+      os.flags(flags);
+
+      std::vector< std::shared_ptr<GadgetronMemoryAccount> > c = this->children();
+      for (size_t i = 0; i < c.size(); i++) c[i]->print(os, depth + 1);
+    }
+
+  protected:
+    GadgetronMemoryAccount(const std::string& name, std::shared_ptr<GadgetronMemoryAccount> parent)
+      : name_(name)
+      , parent_(parent)
+    {
+      for (size_t k = 0; k < NUMBER_OF_KINDS; k++) {
+        bytes_[k].store(0);
+        peak_[k].store(0);
+      }
+    }
+
+    std::string name_;
+    std::shared_ptr<GadgetronMemoryAccount> parent_;
+    std::atomic<int64_t> bytes_[NUMBER_OF_KINDS];
+    std::atomic<int64_t> peak_[NUMBER_OF_KINDS];
+
+    std::mutex mutex_;
+    std::vector< std::weak_ptr<GadgetronMemoryAccount> > children_;
+  };
+
+  /**
+     Makes an account the current account of the thread for the lifetime of the scope, the
+     previous account is restored at the end. A scope with account 0 leaves the current one.
+   */
+  class GadgetronMemoryAccountScope
+  {
+  public:
+    GadgetronMemoryAccountScope(GadgetronMemoryAccount* account)
+      : account_(account)
+      , previous_(GadgetronMemoryAccount::current())
+    {
+      if (account_) GadgetronMemoryAccount::current() = account_;
+    }
+
+    ~GadgetronMemoryAccountScope()
+    {
+      if (account_) GadgetronMemoryAccount::current() = previous_;
+    }
+
+  protected:
+    GadgetronMemoryAccount* account_;
+    GadgetronMemoryAccount* previous_;
+  };
+
+  /**
+     Remembers the account of every tracked buffer by address. The buffers are spread over
+     NUMBER_OF_SHARDS maps with a lock each, so the allocating threads rarely contend.
+   */
+  class GadgetronMemoryTracker
+  {
+  public:
+    enum { NUMBER_OF_SHARDS = 64 };
+
+    static GadgetronMemoryTracker& instance()
+    {
+      // Never deleted, arrays with static storage duration may be released after the end of main
+      static GadgetronMemoryTracker* tracker = new GadgetronMemoryTracker;
+      return *tracker;
+    }
+
+    /// Charges a new buffer to the current account of the thread, if there is one
+    void allocated(void* ptr, size_t nbytes, GadgetronMemoryAccount::Kind kind)
+    {
+      GadgetronMemoryAccount* a = GadgetronMemoryAccount::current();
+      if (!a || !ptr) return;
+
+      Entry e;
+      e.account = a->shared_from_this();
+      e.bytes = nbytes;
+      e.kind = kind;
+
+      Shard& s = shard(ptr);
+      {
+        std::lock_guard<std::mutex> guard(s.mutex);
+        s.entries[ptr] = e;
+      }
+      tracked_.fetch_add(1, std::memory_order_relaxed);
+      bytes_[kind].fetch_add(nbytes, std::memory_order_relaxed);
+      a->add(kind, (int64_t)nbytes);
+    }
+
+    /// Credits a buffer back to the account it was charged to, untracked buffers are ignored
+    void released(void* ptr)
+    {
+      if (!ptr || tracked_.load(std::memory_order_relaxed) == 0) return;
+
+      Entry e;
+      Shard& s = shard(ptr);
+      {
+        std::lock_guard<std::mutex> guard(s.mutex);
+        std::unordered_map<void*, Entry>::iterator it = s.entries.find(ptr);
+        if (it == s.entries.end()) return;
+        e = it->second;
+        s.entries.erase(it);
+      }
+      tracked_.fetch_sub(1, std::memory_order_relaxed);
+      bytes_[e.kind].fetch_sub(e.bytes, std::memory_order_relaxed);
+      e.account->add(e.kind, -(int64_t)e.bytes);
+    }
+
+    /// Bytes of all tracked buffers of a kind
+    size_t bytes(GadgetronMemoryAccount::Kind kind) const { return bytes_[kind].load(std::memory_order_relaxed); }
+
+    size_t number_of_buffers() const { return tracked_.load(std::memory_order_relaxed); }
+
+  protected:
+    GadgetronMemoryTracker() : tracked_(0)
+    {
+      for (size_t k = 0; k < GadgetronMemoryAccount::NUMBER_OF_KINDS; k++) bytes_[k].store(0);
+    }
+
+    struct Entry
+    {
+      Entry() : bytes(0), kind(GadgetronMemoryAccount::HOST) {}
+
+      std::shared_ptr<GadgetronMemoryAccount> account;
+      size_t bytes;
+      GadgetronMemoryAccount::Kind kind;
+    };
+
+    struct Shard
+    {
+      std::mutex mutex;
+      std::unordered_map<void*, Entry> entries;
+    };
+
+    Shard& shard(void* ptr)
+    {
+      //Buffers are at least cache line aligned, the low bits carry no information
+      return shards_[(reinterpret_cast<uintptr_t>(ptr) >> 6) % NUMBER_OF_SHARDS];
+    }
+
+    Shard shards_[NUMBER_OF_SHARDS];
+    std::atomic<size_t> tracked_;
+    std::atomic<size_t> bytes_[GadgetronMemoryAccount::NUMBER_OF_KINDS];
+  };
+}
+
+#endif //__GADGETRONMEMORYACCOUNT_H
@@ -0,0 +1,243 @@
+/** \file GadgetronMetrics.h
+    \brief Process wide registry of counters and histograms, exported in the Prometheus text format.
+
+    Components that count events (FFT plan cache hits, solver iterations, bytes received) register
+    a counter or histogram once and update it with atomic operations. State that is already kept
+    elsewhere (memory pool usage, the statistics of running streams) is exported by a collector,
+    a function that writes its samples when the metrics are read.
+
+    The ReST server of the Gadgetron serves write() at /metrics.
+*/
+
+#ifndef __GADGETRONMETRICS_H
+#define __GADGETRONMETRICS_H
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <cstdint>
+
+namespace Gadgetron{
+
+  /// Monotonically increasing count, add() is lock-free
+  class GadgetronMetricCounter
+  {
+  public:
+    GadgetronMetricCounter() : value_(0) {}
+
+    void add(uint64_t v = 1) { value_.fetch_add(v, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+  protected:
+    std::atomic<uint64_t> value_;
+  };
+
+  /**
+     Histogram with power of two buckets: bucket b counts the values up to 2^b - 1 that are not
+     counted in a lower bucket, the last bucket everything larger. add() is lock-free.
+   */
+  class GadgetronMetricHistogram
+  {
+  public:
+    enum { NUMBER_OF_BUCKETS = 40 };
+
+    GadgetronMetricHistogram() : count_(0), sum_(0)
+    {
+      for (size_t b = 0; b < NUMBER_OF_BUCKETS; b++) buckets_[b].store(0, std::memory_order_relaxed);
+    }
+
+    void add(uint64_t v)
+    {
+      size_t b = 0;
+      while (v >> b && b < NUMBER_OF_BUCKETS - 1) b++;
+      buckets_[b].fetch_add(1, std::memory_order_relaxed);
+      count_.fetch_add(1, std::memory_order_relaxed);
+      sum_.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t bucket(size_t b) const { return buckets_[b].load(std::memory_order_relaxed); }
+
+    /// Largest value counted in bucket b
+    static uint64_t bucket_upper_bound(size_t b) { return (uint64_t(1) << b) - 1; }
+
+  protected:
+    std::atomic<uint64_t> buckets_[NUMBER_OF_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+  };
+
+  class GadgetronMetrics
+  {
+  public:
+
+    /// Writes the samples of one or more metrics, it must not call back into the registry
+    typedef std::function<void(std::ostream&)> Collector;
+
+    static GadgetronMetrics& instance()
+    {
+      static GadgetronMetrics metrics;
+      return metrics;
+    }
+
+    /// The counter of this name, created on first use. The reference stays valid for the life time of the process.
+    GadgetronMetricCounter& counter(const std::string& name, const std::string& help)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      Entry<GadgetronMetricCounter>& e = counters_[name];
+      if (!e.metric) {
+        e.metric.reset(new GadgetronMetricCounter());
+        e.help = help;
+      }
+      return *e.metric;
+    }
+
+    /// The histogram of this name, created on first use. The reference stays valid for the life time of the process.
+    GadgetronMetricHistogram& histogram(const std::string& name, const std::string& help)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      Entry<GadgetronMetricHistogram>& e = histograms_[name];
+      if (!e.metric) {
+        e.metric.reset(new GadgetronMetricHistogram());
+        e.help = help;
+      }
+      return *e.metric;
+    }
+
+    /// Adds or replaces the collector registered under key
+    void add_collector(const std::string& key, Collector c)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      collectors_[key] = c;
+    }
+
+    void remove_collector(const std::string& key)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      collectors_.erase(key);
+    }
+
+    /// All metrics in the Prometheus text exposition format (version 0.0.4)
+    void write(std::ostream& os)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      for (CounterMap::const_iterator it = counters_.begin(); it != counters_.end(); ++it) {
+        write_header(os, it->first, it->second.help, "counter");
+        write_sample(os, it->first, "", it->second.metric->value());
+      }
+
+      for (HistogramMap::const_iterator it = histograms_.begin(); it != histograms_.end(); ++it) {
+        write_header(os, it->first, it->second.help, "histogram");
+        const GadgetronMetricHistogram& h = *it->second.metric;
+
+        //empty buckets at the top are left out, +Inf has the total
+        size_t last = 0;
+        for (size_t b = 0; b < GadgetronMetricHistogram::NUMBER_OF_BUCKETS - 1; b++) {
+          if (h.bucket(b) > 0) last = b;
+        }
+
+        uint64_t accum = 0;
+        for (size_t b = 0; b <= last; b++) {
+          accum += h.bucket(b);
+          write_bucket(os, it->first, "", GadgetronMetricHistogram::bucket_upper_bound(b), accum);
+        }
+        write_histogram_totals(os, it->first, "", h.count(), h.sum());
+      }
+
+      for (std::map<std::string, Collector>::const_iterator it = collectors_.begin(); it != collectors_.end(); ++it) {
+        it->second(os);
+      }
+    }
+
+    std::string write()
+    {
+      std::stringstream ss;
+      this->write(ss);
+      return ss.str();
+    }
+
+    // --------------------------------------------------------------------------
+    // helpers for collectors, labels are given as 'a="x",b="y"' without braces
+
+    static void write_header(std::ostream& os, const std::string& name, const std::string& help, const char* type)
+    {
+      os << "# HELP " << name << " " << help << "\n";
+      os << "# TYPE " << name << " " << type << "\n";
+    }
+
+    template <typename T>
+    static void write_sample(std::ostream& os, const std::string& name, const std::string& labels, T value)
+    {
+      os << name;
+      if (!labels.empty()) os << "{" << labels << "}";
+      os << " " << value << "\n";
+    }
+
+    /// A cumulative bucket of a histogram, counting the values <= upper
+    template <typename T>
+    static void write_bucket(std::ostream& os, const std::string& name, const std::string& labels, T upper, uint64_t cumulative_count)
+    {
+      os << name << "_bucket{";
+      if (!labels.empty()) os << labels << ",";
+      os << "le=\"" << upper << "\"} " << cumulative_count << "\n";
+    }
+
+    /// The +Inf bucket, _sum and _count of a histogram
+    template <typename T>
+    static void write_histogram_totals(std::ostream& os, const std::string& name, const std::string& labels, uint64_t count, T sum)
+    {
+      os << name << "_bucket{";
+      if (!labels.empty()) os << labels << ",";
+      os << "le=\"+Inf\"} " << count << "\n";
+      write_sample(os, name + "_sum", labels, sum);
+      write_sample(os, name + "_count", labels, count);
+    }
+
+    /// Label value with backslash, double quote and line feed escaped
+    static std::string escape_label(const std::string& s)
+    {
+      std::string r;
+      r.reserve(s.size());
+      for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' || s[i] == '"') {
+          r += '\\';
+          r += s[i];
+        } else if (s[i] == '\n') {
+          r += "\\n";
+        } else {
+          r += s[i];
+        }
+      }
+      return r;
+    }
+
+  protected:
+    GadgetronMetrics() {}
+
+    template <typename M> struct Entry
+    {
+      std::unique_ptr<M> metric;
+      std::string help;
+    };
+
+    typedef std::map<std::string, Entry<GadgetronMetricCounter> > CounterMap;
+    typedef std::map<std::string, Entry<GadgetronMetricHistogram> > HistogramMap;
+
+    std::mutex mutex_;
+    CounterMap counters_;
+    HistogramMap histograms_;
+    std::map<std::string, Collector> collectors_;
+  };
+}
+
+#endif //__GADGETRONMETRICS_H
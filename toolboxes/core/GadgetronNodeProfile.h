@@ -0,0 +1,173 @@
+/** \file GadgetronNodeProfile.h
+    \brief Performance settings tuned for the machine the gadgetron runs on.
+
+    The profile is written by gadgetron_autotune, which benchmarks the choices on the node, and is
+    loaded by the gadgetron at startup from <gadgetron home>/share/gadgetron/config/node_profile.txt.
+    Nodes of a heterogeneous fleet thereby run with their own settings from the same installation.
+
+    The file has one "key = value" per line, lines starting with # are comments. The keys read are
+
+      threads                     total of the GadgetronThreadBudget, GADGETRON_NUM_THREADS wins
+      fftw.rigor                  estimate, measure, patient or exhaustive: the plans taken from the
+                                  fftw wisdom, estimate does not use the wisdom
+      wavelet.threads             threads of the loop over the arrays in hoNDWavelet, 0 for all
+      registration.threads        default max_num_of_threads_ of hoImageRegContainer2DRegistration
+      gadget.<class>.<property>   default of a property of every gadget of the class, the values in
+                                  the stream configuration win, e.g. gadget.GrappaGadget.use_gpu = false
+
+    Settings missing in the profile keep the defaults of the code. GADGETRON_NODE_PROFILE=0 in the
+    environment switches the profile off.
+*/
+
+#ifndef __GADGETRONNODEPROFILE_H
+#define __GADGETRONNODEPROFILE_H
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace Gadgetron{
+
+  class GadgetronNodeProfile
+  {
+  public:
+    static GadgetronNodeProfile& instance()
+    {
+      static GadgetronNodeProfile profile;
+      return profile;
+    }
+
+    static std::string filename(const std::string& gadgetron_home)
+    {
+      return gadgetron_home + "/share/gadgetron/config/node_profile.txt";
+    }
+
+    static bool enabled()
+    {
+      const char* env = std::getenv("GADGETRON_NODE_PROFILE");
+      return !(env && std::string(env) == "0");
+    }
+
+    /// Parses "key = value" lines, returns false on a line which is neither a setting, a comment nor empty
+    static bool parse(std::istream& is, std::map<std::string, std::string>& settings)
+    {
+      std::string line;
+      while (std::getline(is, line)) {
+        std::string s = trim(line);
+        if (s.empty() || s[0] == '#') continue;
+
+        size_t eq = s.find('=');
+        if (eq == std::string::npos) return false;
+
+        std::string key = trim(s.substr(0, eq));
+        if (key.empty()) return false;
+        settings[key] = trim(s.substr(eq + 1));
+      }
+      return true;
+    }
+
+    /// Replaces the settings by those of the file, nothing changes if it cannot be read
+    bool load(const std::string& filename)
+    {
+      std::ifstream f(filename.c_str());
+      if (!f) return false;
+
+      std::map<std::string, std::string> settings;
+      if (!parse(f, settings)) return false;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      settings_.swap(settings);
+      return true;
+    }
+
+    /// comment is written at the top of the file, a # is put before each of its lines
+    bool save(const std::string& filename, const std::string& comment = "") const
+    {
+      std::ofstream f(filename.c_str());
+      if (!f) return false;
+
+      std::stringstream c(comment);
+      std::string line;
+      while (std::getline(c, line)) f << "# " << line << "\n";
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& s : settings_) f << s.first << " = " << s.second << "\n";
+      return bool(f);
+    }
+
+    bool has(const std::string& key) const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return settings_.count(key) > 0;
+    }
+
+    std::string get(const std::string& key, const std::string& default_value = "") const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto s = settings_.find(key);
+      return (s != settings_.end()) ? s->second : default_value;
+    }
+
+    int get_int(const std::string& key, int default_value) const
+    {
+      std::stringstream s(this->get(key));
+      int v;
+      return (s >> v) ? v : default_value;
+    }
+
+    void set(const std::string& key, const std::string& value)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      settings_[key] = value;
+    }
+
+    void set(const std::string& key, int value)
+    {
+      this->set(key, std::to_string(value));
+    }
+
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      settings_.clear();
+    }
+
+    /// Settings of the keys starting with prefix, with the prefix taken off
+    std::map<std::string, std::string> with_prefix(const std::string& prefix) const
+    {
+      std::map<std::string, std::string> res;
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto s = settings_.lower_bound(prefix); s != settings_.end() && s->first.compare(0, prefix.size(), prefix) == 0; ++s) {
+        if (s->first.size() > prefix.size()) res[s->first.substr(prefix.size())] = s->second;
+      }
+      return res;
+    }
+
+    /// Property defaults of the gadgets of a class, see gadget.<class>.<property>
+    std::map<std::string, std::string> gadget_properties(const std::string& classname) const
+    {
+      return this->with_prefix("gadget." + classname + ".");
+    }
+
+  protected:
+    GadgetronNodeProfile() {}
+
+    static std::string trim(const std::string& s)
+    {
+      size_t b = s.find_first_not_of(" \t\r");
+      if (b == std::string::npos) return "";
+      size_t e = s.find_last_not_of(" \t\r");
+      return s.substr(b, e - b + 1);
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::string> settings_;
+  };
+}
+
+#endif //__GADGETRONNODEPROFILE_H
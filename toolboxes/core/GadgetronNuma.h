@@ -0,0 +1,243 @@
+/** \file GadgetronNuma.h
+    \brief Placement of streams on the NUMA nodes of the machine.
+
+    On a machine with several NUMA nodes a started stream is placed on the node with the fewest
+    streams, if the node has at least as many cores as the share of the stream in the
+    GadgetronThreadBudget. The gadget threads of the stream are pinned to the cores of the node
+    while they process messages, and array buffers of at least bind_threshold() bytes allocated
+    for the stream (by the gadgets or by the reader of the connection) are bound to the memory of
+    the node with mbind(MPOL_PREFERRED), so FFTs and matrix products touch local memory only.
+    A single stream keeps the whole machine and is not pinned.
+
+    The nodes are read from /sys/devices/system/node, libnuma is not needed. Placement is switched
+    off with GADGETRON_NUMA=0 in the environment. On other systems than Linux nothing is placed.
+*/
+
+#ifndef __GADGETRONNUMA_H
+#define __GADGETRONNUMA_H
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstddef>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+namespace Gadgetron{
+
+  class GadgetronNuma
+  {
+  public:
+    enum
+    {
+      /// Smaller buffers come from the heap of the allocating thread and are not bound
+      DEFAULT_BIND_THRESHOLD = 1 << 20
+    };
+
+    static GadgetronNuma& instance()
+    {
+      static GadgetronNuma numa;
+      return numa;
+    }
+
+    /// Node the calling thread works for, -1 if it has none
+    static int& current_node()
+    {
+      static thread_local int node = -1;
+      return node;
+    }
+
+    /// Cpus of a cpulist as in /sys/devices/system/node/node0/cpulist, e.g. "0-7,16-23"
+    static std::vector<int> parse_cpulist(const std::string& list)
+    {
+      std::vector<int> cpus;
+      std::stringstream ss(list);
+      std::string range;
+      while (std::getline(ss, range, ',')) {
+        if (range.find_first_of("0123456789") == std::string::npos) continue;
+        size_t dash = range.find('-');
+        int first = std::atoi(range.substr(0, dash).c_str());
+        int last = (dash == std::string::npos) ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int c = first; c <= last; c++) cpus.push_back(c);
+      }
+      return cpus;
+    }
+
+    size_t number_of_nodes() const { return cpus_.size(); }
+
+    const std::vector<int>& cpus(int node) const { return cpus_[node]; }
+
+    /// True if streams are placed on nodes
+    bool enabled() const { return enabled_; }
+
+    size_t bind_threshold() const { return bind_threshold_; }
+
+    /**
+       Node for a stream with a share of threads, -1 if the stream is better spread over the
+       machine. Every node handed out has to be returned with release().
+     */
+    int place(int threads)
+    {
+      if (!enabled_) return -1;
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      int node = -1;
+      for (size_t n = 0; n < cpus_.size(); n++) {
+        if ((int)cpus_[n].size() < threads) continue;
+        if (node < 0 || streams_[n] < streams_[node]) node = (int)n;
+      }
+      if (node >= 0) streams_[node]++;
+      return node;
+    }
+
+    void release(int node)
+    {
+      if (node < 0 || node >= (int)streams_.size()) return;
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (streams_[node] > 0) streams_[node]--;
+    }
+
+    /// Number of streams placed on a node
+    int streams(int node)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return streams_[node];
+    }
+
+    /**
+       Pins the calling thread to the cores of a node, -1 returns it to the cores the process
+       started with. Nothing is done if the thread is on the node already.
+     */
+    void bind_thread(int node)
+    {
+      if (node >= (int)cpus_.size()) node = -1;
+      int& bound = bound_node();
+      if (bound == node) return;
+
+#ifdef __linux__
+      cpu_set_t set;
+      if (node < 0) {
+        set = process_cpus_;
+      } else {
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < cpus_[node].size(); i++) {
+          if (cpus_[node][i] < CPU_SETSIZE) CPU_SET(cpus_[node][i], &set);
+        }
+      }
+      if (sched_setaffinity(0, sizeof(set), &set) != 0) return;
+#endif // __linux__
+
+      bound = node;
+    }
+
+    /// Prefers the memory of a node for the pages of a buffer which have not been touched yet
+    void bind_memory(void* ptr, size_t nbytes, int node) const
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+      if (!enabled_ || !ptr || node < 0 || node >= (int)cpus_.size()) return;
+
+      //Only the pages that lie entirely within the buffer
+      size_t page = (size_t)sysconf(_SC_PAGESIZE);
+      size_t start = ((size_t)ptr + page - 1) / page * page;
+      size_t end = ((size_t)ptr + nbytes) / page * page;
+      if (end <= start) return;
+
+      const size_t bits = 8 * sizeof(unsigned long);
+      std::vector<unsigned long> mask(node / bits + 1, 0);
+      mask[node / bits] = 1UL << (node % bits);
+
+      const int MPOL_PREFERRED_MODE = 1;
+      syscall(SYS_mbind, (void*)start, end - start, MPOL_PREFERRED_MODE, &mask[0], mask.size() * bits + 1, 0);
+#endif // __linux__
+    }
+
+    /// Binds a new buffer to the node of the calling thread, if it has one and the buffer is large enough
+    void bind_buffer(void* ptr, size_t nbytes) const
+    {
+      int node = current_node();
+      if (node >= 0 && nbytes >= bind_threshold_) this->bind_memory(ptr, nbytes, node);
+    }
+
+  protected:
+    GadgetronNuma() : enabled_(false), bind_threshold_(DEFAULT_BIND_THRESHOLD)
+    {
+#ifdef __linux__
+      if (sched_getaffinity(0, sizeof(process_cpus_), &process_cpus_) != 0) return;
+
+      for (int n = 0; ; n++) {
+        std::ostringstream name;
+        name << "/sys/devices/system/node/node" << n << "/cpulist";
+        std::ifstream f(name.str().c_str());
+        if (!f) break;
+
+        std::string list;
+        std::getline(f, list);
+
+        //Only the cores the process may run on
+        std::vector<int> all = parse_cpulist(list), cpus;
+        for (size_t i = 0; i < all.size(); i++) {
+          if (all[i] < CPU_SETSIZE && CPU_ISSET(all[i], &process_cpus_)) cpus.push_back(all[i]);
+        }
+        cpus_.push_back(cpus);
+      }
+      streams_.resize(cpus_.size(), 0);
+
+      const char* env = std::getenv("GADGETRON_NUMA");
+      enabled_ = (cpus_.size() > 1) && !(env && std::string(env) == "0");
+#endif // __linux__
+    }
+
+    /// Node the calling thread is pinned to, -1 if it is not pinned
+    static int& bound_node()
+    {
+      static thread_local int node = -1;
+      return node;
+    }
+
+    bool enabled_;
+    size_t bind_threshold_;
+    std::vector< std::vector<int> > cpus_;
+    std::vector<int> streams_;
+    std::mutex mutex_;
+
+#ifdef __linux__
+    cpu_set_t process_cpus_;
+#endif // __linux__
+  };
+
+  /**
+     Makes a node the node of the calling thread for the lifetime of the scope, so large arrays
+     allocated within are bound to it. With pin the thread is moved to the cores of the node as
+     well; it stays there after the scope, until a scope for another node moves it on.
+   */
+  class GadgetronNumaScope
+  {
+  public:
+    GadgetronNumaScope(int node, bool pin)
+      : previous_(GadgetronNuma::current_node())
+    {
+      if (pin) GadgetronNuma::instance().bind_thread(node);
+      GadgetronNuma::current_node() = node;
+    }
+
+    ~GadgetronNumaScope()
+    {
+      GadgetronNuma::current_node() = previous_;
+    }
+
+  protected:
+    int previous_;
+  };
+}
+
+#endif //__GADGETRONNUMA_H
@@ -0,0 +1,353 @@
+/** \file GadgetronProfile.h
+    \brief Aggregated timings of nested profiling zones.
+
+    A GadgetronProfile collects the durations of named zones and keeps, per zone, the number of
+    calls, the total, mean, minimum and maximum time and a histogram for the percentiles. Zones
+    nest: a zone opened while another one is active on the same thread is recorded under the path
+    "outer/inner", so the report shows where the time of a gadget goes step by step.
+
+    As with GadgetronTrace, the profile of the current thread is set with a GadgetronProfileScope
+    (the Gadget does this around process() when the stream is profiled) and zones opened without a
+    current profile cost one thread local lookup. Zones are opened with GADGETRON_PROFILE_ZONE or,
+    for the existing instrumentation, with GadgetronTimer.
+
+    The zones completed on a thread can also be listed one by one, in the order they complete, by
+    making a GadgetronProfile::Record current with a GadgetronProfileRecordScope. This gives the
+    breakdown of a single call, e.g. for the timing attributes of the images it produced.
+
+    Times are taken from std::chrono::steady_clock, which is monotonic.
+*/
+
+#ifndef __GADGETRONPROFILE_H
+#define __GADGETRONPROFILE_H
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Gadgetron{
+
+  /**
+     Histogram of durations in nano-seconds. Every power of two is split into SUB_BINS bins, so
+     the percentiles are resolved to within 1/SUB_BINS of their value.
+   */
+  class GadgetronProfileHistogram
+  {
+  public:
+    enum { SUB_BITS = 3, SUB_BINS = 1 << SUB_BITS, OCTAVES = 48, NUMBER_OF_BINS = OCTAVES * SUB_BINS };
+
+    GadgetronProfileHistogram() : count_(0)
+    {
+      for (size_t b = 0; b < NUMBER_OF_BINS; b++) bins_[b] = 0;
+    }
+
+    void add(uint64_t v)
+    {
+      bins_[bin_index(v)]++;
+      count_++;
+    }
+
+    /// Upper bound of the bin holding percentile p (0 < p <= 1)
+    uint64_t percentile(double p) const
+    {
+      if (count_ == 0) return 0;
+
+      uint64_t target = (uint64_t)(p * count_ + 0.5);
+      if (target < 1) target = 1;
+
+      uint64_t accum = 0;
+      for (size_t b = 0; b < NUMBER_OF_BINS; b++) {
+        accum += bins_[b];
+        if (accum >= target) return bin_upper_bound(b);
+      }
+      return bin_upper_bound(NUMBER_OF_BINS - 1);
+    }
+
+    /// Values below SUB_BINS have a bin each, above that the leading SUB_BITS+1 bits select the bin
+    static size_t bin_index(uint64_t v)
+    {
+      if (v < SUB_BINS) return (size_t)v;
+
+      size_t msb = 0;
+      for (uint64_t t = v; t > 1; t >>= 1) msb++;
+
+      size_t octave = msb - SUB_BITS + 1;
+      size_t sub = (size_t)(v >> (msb - SUB_BITS)) - SUB_BINS;
+      size_t b = octave * SUB_BINS + sub;
+      return (b < NUMBER_OF_BINS) ? b : NUMBER_OF_BINS - 1;
+    }
+
+    static uint64_t bin_upper_bound(size_t b)
+    {
+      if (b < SUB_BINS) return b;
+
+      size_t octave = b / SUB_BINS;
+      size_t sub = b % SUB_BINS;
+      size_t shift = octave - 1;
+      return ((uint64_t)(SUB_BINS + sub + 1) << shift) - 1;
+    }
+
+  protected:
+    uint64_t bins_[NUMBER_OF_BINS];
+    uint64_t count_;
+  };
+
+  class GadgetronProfile
+  {
+  public:
+
+    /// Orders zone paths so that every zone directly follows its parent and siblings
+    struct PathLess
+    {
+      bool operator()(const std::string& a, const std::string& b) const
+      {
+        size_t n = a.size() < b.size() ? a.size() : b.size();
+        for (size_t i = 0; i < n; i++) {
+          if (a[i] == b[i]) continue;
+          if (a[i] == '/') return true;
+          if (b[i] == '/') return false;
+          return (unsigned char)a[i] < (unsigned char)b[i];
+        }
+        return a.size() < b.size();
+      }
+    };
+
+    struct Zone
+    {
+      Zone() : count(0), total_ns(0), min_ns(0), max_ns(0) {}
+
+      uint64_t count;
+      uint64_t total_ns;
+      uint64_t min_ns;
+      uint64_t max_ns;
+      GadgetronProfileHistogram histogram;
+
+      double mean_ns() const { return count > 0 ? (double)total_ns / (double)count : 0.0; }
+
+      /// Percentile p resolved to the histogram bins, never above the maximum
+      uint64_t percentile_ns(double p) const
+      {
+        uint64_t v = histogram.percentile(p);
+        return v < max_ns ? v : max_ns;
+      }
+    };
+
+    typedef std::map<std::string, Zone, PathLess> ZoneMap;
+
+    /// Path and duration of the zones completed on a thread, in the order they completed
+    struct Record
+    {
+      std::vector< std::pair<std::string, int64_t> > zones;
+    };
+
+    /// Nano-seconds on a monotonic clock
+    static int64_t now_ns()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Profile the calling thread records into, 0 if there is none
+    static GadgetronProfile*& current()
+    {
+      static thread_local GadgetronProfile* profile = 0;
+      return profile;
+    }
+
+    /// Record the zones completed on the calling thread are added to, 0 if there is none
+    static Record*& current_record()
+    {
+      static thread_local Record* record = 0;
+      return record;
+    }
+
+    /// Path of the zone the calling thread is in, empty outside of all zones
+    static std::string& current_path()
+    {
+      static thread_local std::string path;
+      return path;
+    }
+
+    /// Path of a zone opened now on the calling thread
+    static std::string child_path(const char* name)
+    {
+      const std::string& parent = current_path();
+      return parent.empty() ? std::string(name) : parent + "/" + name;
+    }
+
+    void add(const std::string& path, int64_t duration_ns)
+    {
+      uint64_t d = duration_ns > 0 ? (uint64_t)duration_ns : 0;
+
+      Record* record = current_record();
+      if (record) record->zones.push_back(std::make_pair(path, (int64_t)d));
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      Zone& z = zones_[path];
+      if (z.count == 0 || d < z.min_ns) z.min_ns = d;
+      if (d > z.max_ns) z.max_ns = d;
+      z.count++;
+      z.total_ns += d;
+      z.histogram.add(d);
+    }
+
+    size_t number_of_zones()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return zones_.size();
+    }
+
+    /// Copy of the zones, keyed by path
+    ZoneMap zones()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return zones_;
+    }
+
+    /// One line per zone in milli-seconds, nested zones are indented under their parent
+    void print(std::ostream& os)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      os << std::setw(60) << std::left << "zone"
+         << std::right
+         << std::setw(10) << "count"
+         << std::setw(12) << "total"
+         << std::setw(10) << "mean"
+         << std::setw(10) << "p50"
+         << std::setw(10) << "p99"
+         << std::setw(10) << "max" << "\n";
+
+      std::ios::fmtflags flags = os.flags();
+      os << std::fixed << std::setprecision(3);
+
+      for (ZoneMap::const_iterator it = zones_.begin(); it != zones_.end(); ++it) {
+        const std::string& path = it->first;
+        const Zone& z = it->second;
+
+        size_t depth = 0;
+        size_t start = 0;
+        for (size_t i = 0; i < path.size(); i++) {
+          if (path[i] == '/') {
+            depth++;
+            start = i + 1;
+          }
+        }
+
+        std::string label = std::string(2 * depth, ' ') + path.substr(start);
+        os << std::setw(60) << std::left << label
+           << std::right
+           << std::setw(10) << z.count
+           << std::setw(12) << z.total_ns / 1e6
+           << std::setw(10) << z.mean_ns() / 1e6
+           << std::setw(10) << z.percentile_ns(0.5) / 1e6
+           << std::setw(10) << z.percentile_ns(0.99) / 1e6
+           << std::setw(10) << z.max_ns / 1e6 << "\n";
+      }
+
+      os.flags(flags);
+    }
+
+  protected:
+    std::mutex mutex_;
+    ZoneMap zones_;
+  };
+
+  /**
+     Makes a profile the current profile of the thread for the lifetime of the scope, the previous
+     profile is restored at the end. The zone path of the thread starts from the top.
+   */
+  class GadgetronProfileScope
+  {
+  public:
+    GadgetronProfileScope(GadgetronProfile* profile)
+      : profile_(profile)
+      , previous_(GadgetronProfile::current())
+    {
+      if (profile_) {
+        GadgetronProfile::current() = profile_;
+        previous_path_.swap(GadgetronProfile::current_path());
+      }
+    }
+
+    ~GadgetronProfileScope()
+    {
+      if (profile_) {
+        GadgetronProfile::current() = previous_;
+        GadgetronProfile::current_path().swap(previous_path_);
+      }
+    }
+
+  protected:
+    GadgetronProfile* profile_;
+    GadgetronProfile* previous_;
+    std::string previous_path_;
+  };
+
+  /// Makes a record the current record of the thread for the lifetime of the scope
+  class GadgetronProfileRecordScope
+  {
+  public:
+    GadgetronProfileRecordScope(GadgetronProfile::Record* record)
+      : previous_(GadgetronProfile::current_record())
+    {
+      GadgetronProfile::current_record() = record;
+    }
+
+    ~GadgetronProfileRecordScope()
+    {
+      GadgetronProfile::current_record() = previous_;
+    }
+
+  protected:
+    GadgetronProfile::Record* previous_;
+  };
+
+  /// Records the lifetime of the scope as a zone of the current profile, if there is one
+  class GadgetronProfileZone
+  {
+  public:
+    GadgetronProfileZone(const char* name)
+      : profile_(GadgetronProfile::current())
+      , parent_length_(0)
+      , begin_ns_(0)
+    {
+      if (profile_) {
+        std::string& path = GadgetronProfile::current_path();
+        parent_length_ = path.size();
+        if (!path.empty()) path += "/";
+        path += name;
+        begin_ns_ = GadgetronProfile::now_ns();
+      }
+    }
+
+    ~GadgetronProfileZone()
+    {
+      if (profile_) {
+        std::string& path = GadgetronProfile::current_path();
+        profile_->add(path, GadgetronProfile::now_ns() - begin_ns_);
+        path.resize(parent_length_);
+      }
+    }
+
+  protected:
+    GadgetronProfile* profile_;
+    size_t parent_length_;
+    int64_t begin_ns_;
+  };
+}
+
+#define GADGETRON_PROFILE_CONCAT_(a, b) a##b
+#define GADGETRON_PROFILE_CONCAT(a, b) GADGETRON_PROFILE_CONCAT_(a, b)
+
+/// Profiles the rest of the enclosing block as a zone of the given name
+#define GADGETRON_PROFILE_ZONE(name) Gadgetron::GadgetronProfileZone GADGETRON_PROFILE_CONCAT(gadgetron_profile_zone_, __LINE__)(name)
+
+#endif //__GADGETRONPROFILE_H
@@ -0,0 +1,235 @@
+/** \file GadgetronThreadBudget.h
+    \brief Share of the cores for the OpenMP regions of the gadgets.
+
+    Every gadget thread which enters an OpenMP region by default starts a team of one thread per
+    core. With several busy gadgets and several connections the machine is oversubscribed many
+    times over. The GadgetronThreadBudget divides the cores instead: every running stream gets an
+    equal share of the total, and the share of a stream is divided among its gadgets which are
+    busy in process() at the moment.
+
+    As with GadgetronMemoryAccount, the stream controller owns the budget of the stream and the
+    Gadget sets a scope around process() and process_config(). The scope sets the OpenMP thread
+    count of the calling thread to the share, so existing parallel regions follow the budget
+    without changes. Code which sizes its own work by the number of cores asks num_threads().
+
+    The total is the number of cores, or GADGETRON_NUM_THREADS if it is set in the environment. The
+    gadgetron otherwise takes the total from the node profile, see GadgetronNodeProfile.
+
+    Batch streams (offline reprocessing) give way to the real-time streams of the scanner: while
+    a real-time stream is running every batch stream is throttled to one thread and the real-time
+    streams divide the rest. Without real-time streams batch streams share like any other.
+
+    When a stream is started it is also placed on a NUMA node if its share fits, see GadgetronNuma.
+*/
+
+#ifndef __GADGETRONTHREADBUDGET_H
+#define __GADGETRONTHREADBUDGET_H
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+
+#include "GadgetronNuma.h"
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif // USE_OMP
+
+namespace Gadgetron{
+
+  class GadgetronThreadBudget
+  {
+  public:
+
+    /**
+       Budget of one stream. The stream counts towards the total while it is started,
+       so a stream which is configured but not yet running takes no share.
+     */
+    class Stream
+    {
+    public:
+      Stream() : started_(false), batch_(false), busy_(0), node_(-1) {}
+
+      ~Stream() { this->stop(); }
+
+      void start()
+      {
+        bool started = false;
+        if (started_.compare_exchange_strong(started, true)) {
+          GadgetronThreadBudget& budget = GadgetronThreadBudget::instance();
+          //A batch stream is never counted as a real-time stream in between
+          if (batch_) budget.batch_streams_.fetch_add(1);
+          budget.streams_.fetch_add(1);
+          node_.store(GadgetronNuma::instance().place(budget.stream_share(batch_)));
+        }
+      }
+
+      void stop()
+      {
+        bool started = true;
+        if (started_.compare_exchange_strong(started, false)) {
+          GadgetronNuma::instance().release(node_.exchange(-1));
+          GadgetronThreadBudget& budget = GadgetronThreadBudget::instance();
+          budget.streams_.fetch_sub(1);
+          if (batch_) budget.batch_streams_.fetch_sub(1);
+        }
+      }
+
+      /// Marks the stream as a batch stream, must be set before start()
+      void set_batch(bool batch) { if (!started_) batch_ = batch; }
+
+      bool batch() const { return batch_; }
+
+      /// NUMA node the stream was placed on when it was started, -1 if it is spread over the machine
+      int node() const { return node_.load(std::memory_order_relaxed); }
+
+      /// Number of gadgets of the stream in process() right now
+      int busy() const { return busy_.load(std::memory_order_relaxed); }
+
+      /// Threads for one of the busy gadgets
+      int share() const
+      {
+        int b = this->busy();
+        int s = GadgetronThreadBudget::instance().stream_share(batch_) / (b > 1 ? b : 1);
+        return (s > 1) ? s : 1;
+      }
+
+    protected:
+      friend class GadgetronThreadBudgetScope;
+
+      std::atomic<bool> started_;
+      bool batch_;
+      std::atomic<int> busy_;
+      std::atomic<int> node_;
+    };
+
+    static GadgetronThreadBudget& instance()
+    {
+      static GadgetronThreadBudget budget;
+      return budget;
+    }
+
+    /// Threads of the calling thread, 0 outside of a budget scope
+    static int& current()
+    {
+      static thread_local int threads = 0;
+      return threads;
+    }
+
+    /// Threads the calling code may use, its share inside a gadget and the total elsewhere
+    static int num_threads()
+    {
+      int n = current();
+      return (n > 0) ? n : instance().total();
+    }
+
+    int total() const { return total_.load(std::memory_order_relaxed); }
+
+    /// Overrides the total number of threads, values < 1 go back to the number of cores
+    void set_total(int n)
+    {
+      total_.store((n > 0) ? n : number_of_cores());
+    }
+
+    /// Number of started streams
+    int streams() const { return streams_.load(std::memory_order_relaxed); }
+
+    /// Number of started batch streams
+    int batch_streams() const { return batch_streams_.load(std::memory_order_relaxed); }
+
+    /// Number of started real-time streams
+    int realtime_streams() const
+    {
+      int r = this->streams() - this->batch_streams();
+      return (r > 0) ? r : 0;
+    }
+
+    /// Threads for a started stream, batch streams get one while real-time streams are running
+    int stream_share(bool batch = false) const
+    {
+      int n = this->streams();
+      int b = this->batch_streams();
+      int r = this->realtime_streams();
+
+      int s = 0;
+      if (r > 0 && b > 0) {
+        if (batch) return 1;
+        s = (this->total() - b) / r;
+      } else {
+        s = this->total() / (n > 1 ? n : 1);
+      }
+      return (s > 1) ? s : 1;
+    }
+
+    static int number_of_cores()
+    {
+#ifdef USE_OMP
+      int n = omp_get_num_procs();
+#else
+      int n = (int)std::thread::hardware_concurrency();
+#endif // USE_OMP
+      return (n > 0) ? n : 1;
+    }
+
+  protected:
+    GadgetronThreadBudget() : streams_(0), batch_streams_(0)
+    {
+      const char* env = std::getenv("GADGETRON_NUM_THREADS");
+      total_.store(number_of_cores());
+      if (env) this->set_total(std::atoi(env));
+    }
+
+    std::atomic<int> total_;
+    std::atomic<int> streams_;
+    std::atomic<int> batch_streams_;
+  };
+
+  /**
+     Counts the calling thread as a busy gadget of a stream for the lifetime of the scope and
+     limits its OpenMP threads to its share, at most max_threads if that is > 0. The previous
+     thread count is restored at the end. A scope with stream 0 changes nothing.
+   */
+  class GadgetronThreadBudgetScope
+  {
+  public:
+    GadgetronThreadBudgetScope(GadgetronThreadBudget::Stream* stream, int max_threads = 0)
+      : stream_(stream)
+      , previous_(GadgetronThreadBudget::current())
+      , previous_omp_(0)
+    {
+      if (!stream_) return;
+
+      stream_->busy_.fetch_add(1);
+      int n = stream_->share();
+      if (max_threads > 0 && n > max_threads) n = max_threads;
+      GadgetronThreadBudget::current() = n;
+
+#ifdef USE_OMP
+      previous_omp_ = omp_get_max_threads();
+      omp_set_num_threads(n);
+#endif // USE_OMP
+    }
+
+    ~GadgetronThreadBudgetScope()
+    {
+      if (!stream_) return;
+
+      stream_->busy_.fetch_sub(1);
+      GadgetronThreadBudget::current() = previous_;
+
+#ifdef USE_OMP
+      omp_set_num_threads(previous_omp_);
+#endif // USE_OMP
+    }
+
+  protected:
+    GadgetronThreadBudget::Stream* stream_;
+    int previous_;
+    int previous_omp_;
+  };
+}
+
+#endif //__GADGETRONTHREADBUDGET_H
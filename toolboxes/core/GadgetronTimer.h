@@ -1,5 +1,9 @@
 /** \file GadgetronTimer.h
     \brief Generic timer class to measure runtime performance.
+
+    Timed steps are recorded as zones of the current GadgetronProfile, nested under the zone the
+    thread is in, and show up on the timeline of the current GadgetronTrace. Without a profile
+    the time is logged when the timer stops.
 */
 
 #ifndef __GADGETRONTIMER_H
@@ -7,14 +11,11 @@
 
 #pragma once
 
-#ifdef WIN32 
-#include <windows.h>
-#else 
-#include <sys/time.h>
-#endif
-
 #include <string>
+#include <chrono>
 #include "log.h"
+#include "GadgetronTrace.h"
+#include "GadgetronProfile.h"
 
 namespace Gadgetron{
 
@@ -60,12 +61,9 @@ namespace Gadgetron{
 
     virtual void start()
     {
-#ifdef WIN32
-        QueryPerformanceFrequency(&frequency_);
-        QueryPerformanceCounter(&start_);
-#else
-        gettimeofday(&start_, NULL);
-#endif
+        trace_begin_us_ = GadgetronTrace::current() ? GadgetronTrace::now_us() : 0;
+        if (GadgetronProfile::current()) profile_path_ = GadgetronProfile::child_path(name_.c_str());
+        start_ = std::chrono::steady_clock::now();
     }
 
     void start(const char* name)
@@ -76,15 +74,24 @@ namespace Gadgetron{
 
     virtual double stop()
     {
-        double time_in_us = 0.0;
-#ifdef WIN32
-        QueryPerformanceCounter(&end_);
-        time_in_us = (end_.QuadPart * (1.0e6/ frequency_.QuadPart)) - start_.QuadPart * (1.0e6 / frequency_.QuadPart);
-#else
-        gettimeofday(&end_, NULL);
-        time_in_us = ((end_.tv_sec * 1e6) + end_.tv_usec) - ((start_.tv_sec * 1e6) + start_.tv_usec);
-#endif
-	GDEBUG("%s:%f ms\n", name_.c_str(), time_in_us/1000.0);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        int64_t time_in_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+        double time_in_us = time_in_ns / 1000.0;
+
+        //Timed steps are aggregated in the profile of the stream, if it is profiled
+        GadgetronProfile* profile = GadgetronProfile::current();
+        if (profile && !profile_path_.empty()) {
+            profile->add(profile_path_, time_in_ns);
+        } else {
+            GDEBUG("%s:%f ms\n", name_.c_str(), time_in_us/1000.0);
+        }
+        profile_path_.clear();
+
+        //Timed steps show up on the timeline of the connection, if it is traced
+        GadgetronTrace* trace = GadgetronTrace::current();
+        if (trace && trace_begin_us_ > 0) {
+            trace->add(name_, "step", trace_begin_us_, GadgetronTrace::now_us());
+        }
         return time_in_us;
     }
 
@@ -92,18 +99,16 @@ namespace Gadgetron{
 
   protected:
 
-#ifdef WIN32
-    LARGE_INTEGER frequency_;
-    LARGE_INTEGER start_;
-    LARGE_INTEGER end_;
-#else
-    timeval start_;
-    timeval end_;
-#endif
+    std::chrono::steady_clock::time_point start_;
 
     std::string name_;
 
+    //zone the timed step is recorded under, set by start() if the thread is profiled
+    std::string profile_path_;
+
     bool timing_in_destruction_;
+
+    int64_t trace_begin_us_ = 0;
   };
 }
 
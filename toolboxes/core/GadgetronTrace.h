@@ -0,0 +1,192 @@
+/** \file GadgetronTrace.h
+    \brief Collector of timeline events, written in the Chrome trace event format.
+
+    A GadgetronTrace records complete ("X") events with begin time, duration and thread. The files
+    can be opened in chrome://tracing or https://ui.perfetto.dev and show every gadget and every
+    timed sub-step on one timeline.
+
+    The trace of the current thread is set with a GadgetronTraceScope, events recorded while the
+    scope is active (e.g. by GadgetronTimer) go to that trace. Without a current trace nothing is
+    recorded, so the instrumentation costs one thread local lookup when tracing is off.
+*/
+
+#ifndef __GADGETRONTRACE_H
+#define __GADGETRONTRACE_H
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+
+namespace Gadgetron{
+
+  class GadgetronTrace
+  {
+  public:
+
+    /// Events beyond this number are counted but not stored
+    enum { MAX_EVENTS = 1 << 20 };
+
+    struct Event
+    {
+      std::string name;
+      const char* category;
+      int64_t begin_us;
+      int64_t duration_us;
+      uint32_t thread;
+      int64_t message; //-1 if the event does not belong to a message
+    };
+
+    GadgetronTrace() : dropped_(0)
+    {
+    }
+
+    /// Microseconds on a monotonic clock, the time base of all events
+    static int64_t now_us()
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Small, stable number of the calling thread
+    static uint32_t thread_number()
+    {
+      static std::atomic<uint32_t> next_thread(1);
+      static thread_local uint32_t number = next_thread.fetch_add(1);
+      return number;
+    }
+
+    /// Trace the calling thread records into, 0 if there is none
+    static GadgetronTrace*& current()
+    {
+      static thread_local GadgetronTrace* trace = 0;
+      return trace;
+    }
+
+    void add(const std::string& name, const char* category, int64_t begin_us, int64_t end_us, int64_t message = -1)
+    {
+      Event e;
+      e.name = name;
+      e.category = category;
+      e.begin_us = begin_us;
+      e.duration_us = end_us - begin_us;
+      e.thread = thread_number();
+      e.message = message;
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (events_.size() >= MAX_EVENTS) {
+        dropped_++;
+        return;
+      }
+      events_.push_back(e);
+    }
+
+    size_t number_of_events()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return events_.size();
+    }
+
+    /// Writes the events as a Chrome trace JSON object
+    void write(std::ostream& os)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      int64_t t0 = 0;
+      for (size_t i = 0; i < events_.size(); i++) {
+        if (i == 0 || events_[i].begin_us < t0) t0 = events_[i].begin_us;
+      }
+
+      os << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped_ << "},\"traceEvents\":[";
+      for (size_t i = 0; i < events_.size(); i++) {
+        const Event& e = events_[i];
+        if (i > 0) os << ",";
+        os << "\n{\"name\":\"";
+        write_escaped(os, e.name);
+        os << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+           << ",\"ts\":" << (e.begin_us - t0) << ",\"dur\":" << e.duration_us;
+        if (e.message >= 0) {
+          os << ",\"args\":{\"message\":" << e.message << "}";
+        }
+        os << "}";
+      }
+      os << "\n]}\n";
+    }
+
+    bool write(const std::string& filename)
+    {
+      std::ofstream f(filename.c_str());
+      if (!f.is_open()) return false;
+      this->write(f);
+      return f.good();
+    }
+
+  protected:
+
+    static void write_escaped(std::ostream& os, const std::string& s)
+    {
+      for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\') {
+          os << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int)(unsigned char)c);
+          os << buf;
+        } else {
+          os << c;
+        }
+      }
+    }
+
+    std::mutex mutex_;
+    std::vector<Event> events_;
+    size_t dropped_;
+  };
+
+  /**
+     Makes a trace the current trace of the thread and records one event spanning the lifetime
+     of the scope. Scopes nest, the previous trace is restored at the end.
+   */
+  class GadgetronTraceScope
+  {
+  public:
+    GadgetronTraceScope(GadgetronTrace* trace, const char* name, const char* category, int64_t message = -1)
+      : trace_(trace)
+      , previous_(GadgetronTrace::current())
+      , name_(name)
+      , category_(category)
+      , message_(message)
+      , begin_us_(0)
+    {
+      if (trace_) {
+        GadgetronTrace::current() = trace_;
+        begin_us_ = GadgetronTrace::now_us();
+      }
+    }
+
+    ~GadgetronTraceScope()
+    {
+      if (trace_) {
+        trace_->add(name_, category_, begin_us_, GadgetronTrace::now_us(), message_);
+        GadgetronTrace::current() = previous_;
+      }
+    }
+
+  protected:
+    GadgetronTrace* trace_;
+    GadgetronTrace* previous_;
+    const char* name_;
+    const char* category_;
+    int64_t message_;
+    int64_t begin_us_;
+  };
+}
+
+#endif //__GADGETRONTRACE_H
@@ -0,0 +1,234 @@
+/** \file GadgetronUnitScheduler.h
+    \brief Split of a loop over independent units between the cpu threads and the GPUs of the node.
+
+    The cpu threads take one unit at a time. Every GPU has a driver thread of its own, which takes a
+    range of units per call so that the device is kept busy. The size of a range follows the throughput
+    measured so far: a GPU takes half of its share of the units left, its share being its rate over the
+    combined rate of the cpu threads and all GPUs (guided self-scheduling). Every backend takes work as
+    long as any is left and the split follows the measured rates while the loop runs, so the loop ends
+    about when the combined capacity of the node allows.
+
+    The time per unit of the cpu threads and of every GPU is kept between runs as an exponential average,
+    a scheduler used for the same kind of units starts the next run with ranges of the right size. A
+    backend which is not measured yet counts as one cpu thread.
+
+    A GPU whose work throws takes no more units in this run, its range is done by the cpu threads. The
+    first exception of the cpu work ends the run and is thrown again by run().
+*/
+
+#ifndef __GADGETRONUNITSCHEDULER_H
+#define __GADGETRONUNITSCHEDULER_H
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <cmath>
+
+namespace Gadgetron{
+
+  class GadgetronUnitScheduler
+  {
+  public:
+
+    /// processes the units [first, first+count), the cpu work is called with count 1
+    typedef std::function<void(size_t first, size_t count)> Work;
+
+    GadgetronUnitScheduler() : cpu_seconds_(0), cpu_units_(0) {}
+
+    /**
+       Runs the units [0, num) on cpu_threads OpenMP threads and the GPUs of gpus, one driver thread each.
+       With cpu_threads 0 the cpu only takes the units of a GPU which failed, without GPUs one thread is used at least.
+     */
+    void run(size_t num, const Work& cpu, int cpu_threads, const std::vector<Work>& gpus)
+    {
+      size_t G = gpus.size();
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (gpu_seconds_.size() != G) gpu_seconds_.assign(G, 0);
+        gpu_failed_.assign(G, false);
+        gpu_units_.assign(G, 0);
+        cpu_units_ = 0;
+        returned_.clear();
+        error_ = std::exception_ptr();
+      }
+
+      if (num == 0) return;
+
+      if (cpu_threads < 0) cpu_threads = 0;
+      if (G == 0 && cpu_threads == 0) cpu_threads = 1;
+
+      std::atomic<size_t> next(0);
+      std::atomic<bool> stop(false);
+
+      std::vector<std::thread> drivers;
+      for (size_t g = 0; g < G; g++)
+      {
+        drivers.push_back(std::thread([&, g]() { this->drive_gpu(g, gpus[g], num, cpu_threads, next, stop); }));
+      }
+
+      if (cpu_threads > 0) this->run_cpu(cpu, cpu_threads, num, next, stop);
+
+      for (size_t g = 0; g < G; g++) drivers[g].join();
+
+      // units of a GPU which failed after the cpu threads had finished, or without cpu threads
+      this->run_cpu(cpu, std::max(cpu_threads, 1), num, next, stop);
+
+      if (error_) std::rethrow_exception(error_);
+    }
+
+    /// whether the work of GPU g threw in the last run
+    bool gpu_failed(size_t g) const { return g < gpu_failed_.size() && gpu_failed_[g]; }
+
+    /// units done by the cpu and by GPU g in the last run
+    size_t cpu_units() const { return cpu_units_; }
+    size_t gpu_units(size_t g) const { return (g < gpu_units_.size()) ? gpu_units_[g] : 0; }
+
+    /// measured seconds per unit of a cpu thread and of GPU g, 0 before the first measurement
+    double cpu_seconds_per_unit() const { return cpu_seconds_; }
+    double gpu_seconds_per_unit(size_t g) const { return (g < gpu_seconds_.size()) ? gpu_seconds_[g] : 0; }
+
+    /// forgets the measurements, e.g. when the size of the units changes
+    void reset_measurements()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      cpu_seconds_ = 0;
+      std::fill(gpu_seconds_.begin(), gpu_seconds_.end(), 0.0);
+    }
+
+  protected:
+
+    struct Range
+    {
+      size_t first;
+      size_t count;
+    };
+
+    static double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void measure(double& average, double seconds)
+    {
+      average = (average > 0) ? 0.7*average + 0.3*seconds : seconds;
+    }
+
+    /// half of the share of GPU g of the remaining units, at least one
+    size_t gpu_range(size_t g, size_t remaining, int cpu_threads)
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      double unmeasured = (cpu_seconds_ > 0) ? 1.0 / cpu_seconds_ : 1.0;
+      double total = cpu_threads * unmeasured;
+      for (size_t k = 0; k < gpu_seconds_.size(); k++)
+      {
+        if (!gpu_failed_[k]) total += (gpu_seconds_[k] > 0) ? 1.0 / gpu_seconds_[k] : unmeasured;
+      }
+      double rate = (gpu_seconds_[g] > 0) ? 1.0 / gpu_seconds_[g] : unmeasured;
+
+      size_t count = (size_t)std::ceil(0.5 * remaining * rate / total);
+      return (count > 0) ? count : 1;
+    }
+
+    void drive_gpu(size_t g, const Work& work, size_t num, int cpu_threads, std::atomic<size_t>& next, std::atomic<bool>& stop)
+    {
+      while (!stop)
+      {
+        size_t taken = next.load();
+        if (taken >= num) break;
+
+        size_t count = this->gpu_range(g, num - taken, cpu_threads);
+        size_t first = next.fetch_add(count);
+        if (first >= num) break;
+        if (first + count > num) count = num - first;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        try
+        {
+          work(first, count);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> guard(mutex_);
+          Range r = { first, count };
+          returned_.push_back(r);
+          gpu_failed_[g] = true;
+          break;
+        }
+
+        double seconds = seconds_since(start);
+        std::lock_guard<std::mutex> guard(mutex_);
+        measure(gpu_seconds_[g], seconds / count);
+        gpu_units_[g] += count;
+      }
+    }
+
+    /// next unit of the cpu, from the ranges of failed GPUs first
+    bool cpu_unit(size_t num, std::atomic<size_t>& next, size_t& unit)
+    {
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!returned_.empty())
+        {
+          Range& r = returned_.back();
+          unit = r.first++;
+          if (--r.count == 0) returned_.pop_back();
+          return true;
+        }
+      }
+
+      if (next.load() >= num) return false;
+      unit = next.fetch_add(1);
+      return unit < num;
+    }
+
+    void run_cpu(const Work& work, int threads, size_t num, std::atomic<size_t>& next, std::atomic<bool>& stop)
+    {
+#pragma omp parallel num_threads(threads) if(threads>1)
+      {
+        size_t unit;
+        while (!stop && this->cpu_unit(num, next, unit))
+        {
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+          try
+          {
+            work(unit, 1);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (!error_) error_ = std::current_exception();
+            stop = true;
+            break;
+          }
+
+          double seconds = seconds_since(start);
+          std::lock_guard<std::mutex> guard(mutex_);
+          measure(cpu_seconds_, seconds);
+          cpu_units_++;
+        }
+      }
+    }
+
+    std::mutex mutex_;
+
+    double cpu_seconds_;
+    std::vector<double> gpu_seconds_;
+
+    size_t cpu_units_;
+    std::vector<size_t> gpu_units_;
+    std::vector<bool> gpu_failed_;
+
+    std::vector<Range> returned_;
+    std::exception_ptr error_;
+  };
+}
+
+#endif // __GADGETRONUNITSCHEDULER_H
@@ -17,6 +17,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/cast.hpp>
 
+#include "NDArrayDimensions.h"
+
 namespace Gadgetron{
 
     template <typename T> class NDArray
@@ -28,8 +30,6 @@ namespace Gadgetron{
 
         NDArray () : data_(0), elements_(0), delete_data_on_destruct_(true)
         {
-            dimensions_ = boost::shared_ptr< std::vector<size_t> >( new std::vector<size_t> );
-            offsetFactors_ = boost::shared_ptr< std::vector<size_t> >( new std::vector<size_t> );
         }
 
         virtual ~NDArray() {}
@@ -52,28 +52,17 @@ namespace Gadgetron{
 
         template<class S> bool dimensions_equal(const NDArray<S> *a) const
         {
-            //boost::shared_ptr<std::vector<size_t > > adims = a->get_dimensions();
-            //return ((this->dimensions_->size() == adims->size()) &&
-            //    std::equal(this->dimensions_->begin(), this->dimensions_->end(), adims->begin()));
-
-            std::vector<size_t>* dim;
-            a->get_dimensions(dim);
-
-            if ( this->dimensions_->size() != dim->size() ) return false;
-
-            size_t NDim = this->dimensions_->size();
-            for ( size_t d=0; d<NDim; d++ )
-            {
-                if ( (*this->dimensions_)[d] != (*dim)[d] ) return false;
-            }
-
-            return true;
+            return this->dimensions_ == a->dimensions();
         }
 
         size_t get_number_of_dimensions() const;
 
         size_t get_size(size_t dimension) const;
 
+        /// Dimensions of the array, without a copy
+        const NDArrayDimensions& dimensions() const { return dimensions_; }
+
+        /// Copies of the dimensions, for code written against std::vector
         boost::shared_ptr< std::vector<size_t> > get_dimensions() const;
         void get_dimensions(std::vector<size_t>*& dim) const;
         void get_dimensions(std::vector<size_t>& dim) const;
@@ -100,12 +89,14 @@ namespace Gadgetron{
         size_t calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a, size_t q, size_t u) const;
 
         size_t get_offset_factor(size_t dim) const;
+        const NDArrayDimensions& offset_factors() const { return offsetFactors_; }
         void get_offset_factor(std::vector<size_t>& offset) const;
         boost::shared_ptr< std::vector<size_t> > get_offset_factor() const;
 
         size_t get_offset_factor_lastdim() const;
 
         void calculate_offset_factors(const std::vector<size_t>& dimensions);
+        void calculate_offset_factors(const NDArrayDimensions& dimensions);
         static void calculate_offset_factors(const std::vector<size_t>& dimensions, std::vector<size_t>& offsetFactors);
 
         std::vector<size_t> calculate_index( size_t offset ) const;
@@ -163,32 +154,31 @@ namespace Gadgetron{
 
     protected:
 
-        boost::shared_ptr< std::vector<size_t> > dimensions_;
-        boost::shared_ptr< std::vector<size_t> > offsetFactors_;
+        NDArrayDimensions dimensions_;
+        NDArrayDimensions offsetFactors_;
         T* data_;
         size_t elements_;
         bool delete_data_on_destruct_;
+
+        //Only filled for get_dimensions(std::vector<size_t>*&)
+        mutable std::vector<size_t> dimensions_vector_;
     };
 
     template <typename T> 
     inline void NDArray<T>::create(std::vector<size_t> *dimensions) 
     {
         if(!dimensions) throw std::runtime_error("NDArray<T>::create(): 0x0 pointer provided");
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp = *dimensions;
-        dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
+        dimensions_ = *dimensions;
         allocate_memory();
-        calculate_offset_factors(*dimensions_);
+        calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
     inline void NDArray<T>::create(std::vector<size_t>& dimensions) 
     {
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp = dimensions;
-        dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
+        dimensions_ = dimensions;
         allocate_memory();
-        calculate_offset_factors(*dimensions_);
+        calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
@@ -202,32 +192,22 @@ namespace Gadgetron{
     {
         if (!dimensions) throw std::runtime_error("NDArray<T>::create(): 0x0 pointer provided");
         if (!data) throw std::runtime_error("NDArray<T>::create(): 0x0 pointer provided");    
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp = *dimensions;
-        dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
+        dimensions_ = *dimensions;
         this->data_ = data;
         this->delete_data_on_destruct_ = delete_data_on_destruct;
-        this->elements_ = 1;
-        for (size_t i = 0; i < this->dimensions_->size(); i++){
-            this->elements_ *= (*this->dimensions_)[i];
-        }
-        calculate_offset_factors(*dimensions_);
+        this->elements_ = dimensions_.product();
+        calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
     void NDArray<T>::create(std::vector<size_t> &dimensions, T* data, bool delete_data_on_destruct) 
     {
         if (!data) throw std::runtime_error("NDArray<T>::create(): 0x0 pointer provided");    
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp = dimensions;
-        dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
+        dimensions_ = dimensions;
         this->data_ = data;
         this->delete_data_on_destruct_ = delete_data_on_destruct;
-        this->elements_ = 1;
-        for (size_t i = 0; i < this->dimensions_->size(); i++){
-            this->elements_ *= (*this->dimensions_)[i];
-        }
-        calculate_offset_factors(*dimensions_);
+        this->elements_ = dimensions_.product();
+        calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
@@ -240,14 +220,14 @@ namespace Gadgetron{
     template <typename T> 
     inline void NDArray<T>::squeeze()
     {
-        boost::shared_ptr< std::vector<size_t> > new_dimensions( new std::vector<size_t> ); 
-        for (size_t i = 0; i < dimensions_->size(); i++){
-            if ((*dimensions_)[i] != 1){
-                new_dimensions->push_back((*dimensions_)[i]);
+        size_t n = 0;
+        for (size_t i = 0; i < dimensions_.size(); i++){
+            if (dimensions_[i] != 1){
+                dimensions_[n++] = dimensions_[i];
             }
         }    
-        dimensions_ = new_dimensions;
-        this->calculate_offset_factors(*dimensions_);
+        dimensions_.resize(n);
+        this->calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
@@ -262,10 +242,8 @@ namespace Gadgetron{
             throw std::runtime_error("NDArray<T>::reshape : Number of elements cannot change during reshape");    
 
         // Copy the input dimensions array
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp = *dims;
-        dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        this->calculate_offset_factors(*dimensions_);
+        dimensions_ = *dims;
+        this->calculate_offset_factors(dimensions_);
     }
 
     template <typename T> 
@@ -277,34 +255,23 @@ namespace Gadgetron{
     template <typename T> 
     inline bool NDArray<T>::dimensions_equal(std::vector<size_t> *d) const
     {
-        //return ((this->dimensions_->size() == d->size()) &&
-        //    std::equal(this->dimensions_->begin(), this->dimensions_->end(), d->begin()));
-
-        if ( this->dimensions_->size() != d->size() ) return false;
-
-        size_t NDim = this->dimensions_->size();
-        for ( size_t ii=0; ii<NDim; ii++ )
-        {
-            if ( (*this->dimensions_)[ii] != (*d)[ii] ) return false;
-        }
-
-        return true;
+        return this->dimensions_ == *d;
     }
 
     template <typename T> 
     inline size_t NDArray<T>::get_number_of_dimensions() const
     {
-        return (size_t)dimensions_->size();
+        return (size_t)dimensions_.size();
     }
 
     template <typename T> 
     inline size_t NDArray<T>::get_size(size_t dimension) const
     {
-        if (dimension >= dimensions_->size()){
+        if (dimension >= dimensions_.size()){
             return 1;
         }
         else{
-            return (*dimensions_)[dimension];
+            return dimensions_[dimension];
         }
     }
 
@@ -312,21 +279,20 @@ namespace Gadgetron{
     inline boost::shared_ptr< std::vector<size_t> > NDArray<T>::get_dimensions() const
     {
         // Make copy to ensure that the receiver cannot alter the array dimensions
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp=*dimensions_;
-        return boost::shared_ptr< std::vector<size_t> >(tmp); 
+        return boost::shared_ptr< std::vector<size_t> >(new std::vector<size_t>(dimensions_.begin(), dimensions_.end()));
     }
 
     template <typename T> 
     inline void NDArray<T>::get_dimensions(std::vector<size_t>*& dim) const
     {
-        dim = dimensions_.get();
+        dimensions_vector_.assign(dimensions_.begin(), dimensions_.end());
+        dim = &dimensions_vector_;
     }
 
     template <typename T> 
     inline void NDArray<T>::get_dimensions(std::vector<size_t>& dim) const
     {
-        dim = *dimensions_;
+        dim.assign(dimensions_.begin(), dimensions_.end());
     }
 
     template <typename T> 
@@ -376,96 +342,94 @@ namespace Gadgetron{
     inline size_t NDArray<T>::calculate_offset(const std::vector<size_t>& ind) const
     {
         size_t offset = ind[0];
-        for( size_t i = 1; i < dimensions_->size(); i++ )
-            offset += ind[i] * (*offsetFactors_)[i];
+        for( size_t i = 1; i < dimensions_.size(); i++ )
+            offset += ind[i] * offsetFactors_[i];
         return offset;
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==2);
-        return x + y * (*offsetFactors_)[1];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==2);
+        return x + y * offsetFactors_[1];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==3);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==3);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==4);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==4);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==5);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3] + p * (*offsetFactors_)[4];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==5);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3] + p * offsetFactors_[4];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==6);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3] + p * (*offsetFactors_)[4] + r * (*offsetFactors_)[5];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==6);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3] + p * offsetFactors_[4] + r * offsetFactors_[5];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==7);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3] + p * (*offsetFactors_)[4] + r * (*offsetFactors_)[5] + a * (*offsetFactors_)[6];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==7);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3] + p * offsetFactors_[4] + r * offsetFactors_[5] + a * offsetFactors_[6];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a, size_t q) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==8);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3] + p * (*offsetFactors_)[4] + r * (*offsetFactors_)[5] + a * (*offsetFactors_)[6] + q * (*offsetFactors_)[7];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==8);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3] + p * offsetFactors_[4] + r * offsetFactors_[5] + a * offsetFactors_[6] + q * offsetFactors_[7];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::calculate_offset(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a, size_t q, size_t u) const
     {
-        GADGET_DEBUG_CHECK_THROW(dimensions_->size()==9);
-        return x + y * (*offsetFactors_)[1] + z * (*offsetFactors_)[2] + s * (*offsetFactors_)[3] + p * (*offsetFactors_)[4] + r * (*offsetFactors_)[5] + a * (*offsetFactors_)[6] + q * (*offsetFactors_)[7]+ u * (*offsetFactors_)[8];
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==9);
+        return x + y * offsetFactors_[1] + z * offsetFactors_[2] + s * offsetFactors_[3] + p * offsetFactors_[4] + r * offsetFactors_[5] + a * offsetFactors_[6] + q * offsetFactors_[7]+ u * offsetFactors_[8];
     }
 
     template <typename T> 
     inline size_t NDArray<T>::get_offset_factor(size_t dim) const
     {
-        if ( dim >= (*dimensions_).size() )
+        if ( dim >= dimensions_.size() )
             throw std::runtime_error("NDArray<T>::get_offset_factor : index out of range");
-        return (*offsetFactors_)[dim];
+        return offsetFactors_[dim];
     }
 
     template <typename T> 
     inline void NDArray<T>::get_offset_factor(std::vector<size_t>& offset) const
     {
-        offset=*offsetFactors_;
+        offset.assign(offsetFactors_.begin(), offsetFactors_.end());
     }
 
     template <typename T> 
     inline size_t NDArray<T>::get_offset_factor_lastdim() const
     {
-        if( dimensions_->size() == 0 )
+        if( dimensions_.size() == 0 )
             throw std::runtime_error("NDArray<T>::get_offset_factor_lastdim : array is empty");
 
-        return get_offset_factor(dimensions_->size()-1);
+        return get_offset_factor(dimensions_.size()-1);
     }
 
     template <typename T> 
     inline boost::shared_ptr< std::vector<size_t> > NDArray<T>::get_offset_factor() const
     {
-        std::vector<size_t> *tmp = new std::vector<size_t>;
-        *tmp=*offsetFactors_;
-        return boost::shared_ptr< std::vector<size_t> >(tmp); 
+        return boost::shared_ptr< std::vector<size_t> >(new std::vector<size_t>(offsetFactors_.begin(), offsetFactors_.end()));
     }
 
     template <typename T> 
@@ -487,29 +451,30 @@ namespace Gadgetron{
     template <typename T> 
     inline void NDArray<T>::calculate_offset_factors(const std::vector<size_t>& dimensions)
     {
-        if ( offsetFactors_.get() == NULL ){
-            std::vector<size_t> *tmp = new std::vector<size_t>;
-            offsetFactors_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        }
-        offsetFactors_->resize(dimensions.size());
+        this->calculate_offset_factors(NDArrayDimensions(dimensions));
+    }
+
+    template <typename T> 
+    inline void NDArray<T>::calculate_offset_factors(const NDArrayDimensions& dimensions)
+    {
+        offsetFactors_.resize(dimensions.size());
+        size_t k = 1;
         for( size_t i = 0; i < dimensions.size(); i++ ){
-            size_t k = 1;
-            for( size_t j = 0; j < i; j++ )
-                k *= dimensions[j];
-            (*offsetFactors_)[i] = k;
+            offsetFactors_[i] = k;
+            k *= dimensions[i];
         }
     }
 
     template <typename T> 
     inline std::vector<size_t> NDArray<T>::calculate_index( size_t offset ) const
     {
-        if( dimensions_->size() == 0 )
+        if( dimensions_.size() == 0 )
             throw std::runtime_error("NDArray<T>::calculate_index : array is empty");
 
-        std::vector<size_t> index(dimensions_->size());
-        for( long long i = dimensions_->size()-1; i>=0; i-- ){
-            index[i] = offset / (*offsetFactors_)[i];
-            offset %= (*offsetFactors_)[i];
+        std::vector<size_t> index(dimensions_.size());
+        for( long long i = dimensions_.size()-1; i>=0; i-- ){
+            index[i] = offset / offsetFactors_[i];
+            offset %= offsetFactors_[i];
         }
         return index;
     }
@@ -517,13 +482,13 @@ namespace Gadgetron{
     template <typename T> 
     inline void NDArray<T>::calculate_index( size_t offset, std::vector<size_t>& index ) const
     {
-        if( dimensions_->size() == 0 )
+        if( dimensions_.size() == 0 )
             throw std::runtime_error("NDArray<T>::calculate_index : array is empty");
 
-        index.resize(dimensions_->size(), 0);
-        for( long long i = dimensions_->size()-1; i>=0; i-- ){
-            index[i] = offset / (*offsetFactors_)[i];
-            offset %= (*offsetFactors_)[i];
+        index.resize(dimensions_.size(), 0);
+        for( long long i = dimensions_.size()-1; i>=0; i-- ){
+            index[i] = offset / offsetFactors_[i];
+            offset %= offsetFactors_[i];
         }
     }
 
@@ -550,14 +515,8 @@ namespace Gadgetron{
         this->data_ = 0;
         this->elements_ = 0;
 
-        if ( !this->dimensions_ ){
-            this->dimensions_->clear();
-            this->offsetFactors_->clear();
-        }
-        else{
-            this->dimensions_ = boost::shared_ptr< std::vector<size_t> >( new std::vector<size_t> );
-            this->offsetFactors_ = boost::shared_ptr< std::vector<size_t> >( new std::vector<size_t> );
-        }
+        this->dimensions_.clear();
+        this->offsetFactors_.clear();
     } 
 
     template <typename T> 
@@ -721,13 +680,13 @@ namespace Gadgetron{
     template <typename T> 
     inline bool NDArray<T>::point_in_range(const std::vector<size_t>& ind) const
     {
-        unsigned int D = (*dimensions_).size();
+        unsigned int D = dimensions_.size();
         if ( ind.size() != D ) return false;
 
         unsigned int ii;
         for ( ii=0; ii<D; ii++ )
         {
-            if ( ind[ii]>=(*dimensions_)[ii] )
+            if ( ind[ii]>=dimensions_[ii] )
             {
                 return false;
             }
@@ -739,64 +698,64 @@ namespace Gadgetron{
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==1);
-        return (x<(*dimensions_)[0]);
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==1);
+        return (x<dimensions_[0]);
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==2);
-        return ((x<(*dimensions_)[0]) && (y<(*dimensions_)[1]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==2);
+        return ((x<dimensions_[0]) && (y<dimensions_[1]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==3);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==3);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==4);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==4);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s, size_t p) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==5);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]) && (p<(*dimensions_)[4]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==5);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]) && (p<dimensions_[4]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==6);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]) && (p<(*dimensions_)[4]) && (r<(*dimensions_)[5]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==6);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]) && (p<dimensions_[4]) && (r<dimensions_[5]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==7);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]) && (p<(*dimensions_)[4]) && (r<(*dimensions_)[5]) && (a<(*dimensions_)[6]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==7);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]) && (p<dimensions_[4]) && (r<dimensions_[5]) && (a<dimensions_[6]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a, size_t q) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==8);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]) && (p<(*dimensions_)[4]) && (r<(*dimensions_)[5]) && (a<(*dimensions_)[6]) && (q<(*dimensions_)[7]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==8);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]) && (p<dimensions_[4]) && (r<dimensions_[5]) && (a<dimensions_[6]) && (q<dimensions_[7]));
     }
 
     template <typename T> 
     inline bool NDArray<T>::point_in_range(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r, size_t a, size_t q, size_t u) const
     {
-        GADGET_DEBUG_CHECK_THROW((*dimensions_).size()==9);
-        return ( (x<(*dimensions_)[0]) && (y<(*dimensions_)[1]) && (z<(*dimensions_)[2]) && (s<(*dimensions_)[3]) && (p<(*dimensions_)[4]) && (r<(*dimensions_)[5]) && (a<(*dimensions_)[6]) && (q<(*dimensions_)[7]) && (u<(*dimensions_)[8]));
+        GADGET_DEBUG_CHECK_THROW(dimensions_.size()==9);
+        return ( (x<dimensions_[0]) && (y<dimensions_[1]) && (z<dimensions_[2]) && (s<dimensions_[3]) && (p<dimensions_[4]) && (r<dimensions_[5]) && (a<dimensions_[6]) && (q<dimensions_[7]) && (u<dimensions_[8]));
     }
 }
 
@@ -0,0 +1,154 @@
+/** \file NDArrayDimensions.h
+    \brief Dimensions and offset factors of an NDArray, stored within the array object.
+
+    Arrays used to keep their dimensions and offset factors in two shared vectors, which cost
+    four heap allocations and atomic reference counting for every array, including the small
+    per-readout arrays and the temporaries of the solvers. NDArrayDimensions stores up to
+    INLINE_CAPACITY values in place and only goes to the heap for arrays with more dimensions.
+
+    The interface follows std::vector<size_t> for the parts the arrays use, and converts to
+    and from std::vector<size_t> for code written against the vector interface.
+*/
+
+#ifndef NDARRAYDIMENSIONS_H
+#define NDARRAYDIMENSIONS_H
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+namespace Gadgetron{
+
+    class NDArrayDimensions
+    {
+    public:
+
+        enum { INLINE_CAPACITY = 10 };
+
+        typedef size_t value_type;
+        typedef size_t* iterator;
+        typedef const size_t* const_iterator;
+
+        NDArrayDimensions() : size_(0), capacity_(INLINE_CAPACITY), data_(inline_) {}
+
+        NDArrayDimensions(const std::vector<size_t>& v) : size_(0), capacity_(INLINE_CAPACITY), data_(inline_)
+        {
+            this->assign(v.empty() ? 0 : &v[0], v.size());
+        }
+
+        NDArrayDimensions(const NDArrayDimensions& d) : size_(0), capacity_(INLINE_CAPACITY), data_(inline_)
+        {
+            this->assign(d.data_, d.size_);
+        }
+
+        ~NDArrayDimensions()
+        {
+            if (data_ != inline_) delete [] data_;
+        }
+
+        NDArrayDimensions& operator=(const NDArrayDimensions& d)
+        {
+            if (this != &d) this->assign(d.data_, d.size_);
+            return *this;
+        }
+
+        NDArrayDimensions& operator=(const std::vector<size_t>& v)
+        {
+            this->assign(v.empty() ? 0 : &v[0], v.size());
+            return *this;
+        }
+
+        /// Copy for the code which needs a std::vector
+        operator std::vector<size_t>() const
+        {
+            return std::vector<size_t>(data_, data_ + size_);
+        }
+
+        std::vector<size_t> to_vector() const
+        {
+            return std::vector<size_t>(data_, data_ + size_);
+        }
+
+        void assign(const size_t* values, size_t n)
+        {
+            this->reserve(n);
+            if (n > 0) std::memmove(data_, values, n*sizeof(size_t));
+            size_ = n;
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        size_t& operator[](size_t i) { return data_[i]; }
+        const size_t& operator[](size_t i) const { return data_[i]; }
+
+        size_t* data() { return data_; }
+        const size_t* data() const { return data_; }
+
+        iterator begin() { return data_; }
+        iterator end() { return data_ + size_; }
+        const_iterator begin() const { return data_; }
+        const_iterator end() const { return data_ + size_; }
+
+        void clear() { size_ = 0; }
+
+        void resize(size_t n, size_t value = 0)
+        {
+            this->reserve(n);
+            for (size_t i = size_; i < n; i++) data_[i] = value;
+            size_ = n;
+        }
+
+        void push_back(size_t value)
+        {
+            if (size_ == capacity_) this->reserve(2*capacity_);
+            data_[size_++] = value;
+        }
+
+        /// Product of the values, 1 for no dimensions
+        size_t product() const
+        {
+            size_t n = 1;
+            for (size_t i = 0; i < size_; i++) n *= data_[i];
+            return n;
+        }
+
+        bool operator==(const NDArrayDimensions& d) const
+        {
+            return (size_ == d.size_) && (size_ == 0 || std::memcmp(data_, d.data_, size_*sizeof(size_t)) == 0);
+        }
+
+        bool operator!=(const NDArrayDimensions& d) const { return !(*this == d); }
+
+        bool operator==(const std::vector<size_t>& v) const
+        {
+            return (size_ == v.size()) && (size_ == 0 || std::memcmp(data_, &v[0], size_*sizeof(size_t)) == 0);
+        }
+
+        bool operator!=(const std::vector<size_t>& v) const { return !(*this == v); }
+
+    protected:
+
+        void reserve(size_t n)
+        {
+            if (n <= capacity_) return;
+
+            size_t* d = new size_t[n];
+            if (size_ > 0) std::memcpy(d, data_, size_*sizeof(size_t));
+            if (data_ != inline_) delete [] data_;
+            data_ = d;
+            capacity_ = n;
+        }
+
+        size_t size_;
+        size_t capacity_;
+        size_t* data_;
+        size_t inline_[INLINE_CAPACITY];
+    };
+
+    inline bool operator==(const std::vector<size_t>& v, const NDArrayDimensions& d) { return d == v; }
+    inline bool operator!=(const std::vector<size_t>& v, const NDArrayDimensions& d) { return d != v; }
+}
+
+#endif //NDARRAYDIMENSIONS_H
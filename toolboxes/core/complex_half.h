@@ -0,0 +1,140 @@
+/** \file complex_half.h
+    \brief Half precision (IEEE 754 binary16) storage types for the cpu and gpu.
+
+    half_float and complex_half are storage types only, there is no arithmetic on them. Data is
+    kept in half precision to halve the memory and bandwidth of large buffers and converted to
+    float for any computation, e.g. with complex_to_half/half_to_complex of hoNDArray_half.h.
+
+    binary16 has an 11 bit significand, a relative rounding error of 2^-11 (about -66 dB), and
+    covers magnitudes from 6e-8 to 65504. Larger values become infinite, so data must be scaled
+    into that range before it is stored.
+*/
+
+#pragma once
+
+#include "core_defines.h"
+
+#include <complex>
+
+namespace Gadgetron{
+
+  /**
+   * \class half_float
+   * \brief IEEE 754 binary16 value, converted from float with round to nearest even.
+   */
+  class half_float
+  {
+  public:
+
+    unsigned short bits;
+
+    __inline__ __host__ __device__ half_float() {}
+
+    __inline__ __host__ __device__ half_float(float f) : bits(from_float(f)) {}
+
+    __inline__ __host__ __device__ operator float() const
+    {
+      return to_float(bits);
+    }
+
+    static __inline__ __host__ __device__ unsigned short from_float(float f)
+    {
+      union { float f; unsigned int u; } v;
+      v.f = f;
+
+      const unsigned int sign = (v.u >> 16) & 0x8000u;
+      const unsigned int a = v.u & 0x7FFFFFFFu;
+
+      // inf and nan, a nan stays a (quiet) nan
+      if (a >= 0x7F800000u) {
+        return (unsigned short)(sign | 0x7C00u | ((a > 0x7F800000u) ? (0x0200u | ((a >> 13) & 0x03FFu)) : 0u));
+      }
+
+      // at least 65520, rounds to inf
+      if (a >= 0x477FF000u) return (unsigned short)(sign | 0x7C00u);
+
+      // below 2^-14, subnormal or zero
+      if (a < 0x38800000u) {
+        if (a <= 0x33000000u) return (unsigned short)sign;
+
+        const unsigned int e = a >> 23;
+        const unsigned int m = (a & 0x007FFFFFu) | 0x00800000u;
+        const unsigned int shift = 126u - e;
+        const unsigned int rem = m & ((1u << shift) - 1u);
+        const unsigned int halfway = 1u << (shift - 1u);
+
+        unsigned int r = m >> shift;
+        if (rem > halfway || (rem == halfway && (r & 1u))) r++;
+        return (unsigned short)(sign | r);
+      }
+
+      // normal, rebias the exponent and round the 13 dropped significand bits
+      unsigned int r = (a - 0x38000000u) >> 13;
+      const unsigned int rem = a & 0x1FFFu;
+      if (rem > 0x1000u || (rem == 0x1000u && (r & 1u))) r++;
+      return (unsigned short)(sign | r);
+    }
+
+    static __inline__ __host__ __device__ float to_float(unsigned short h)
+    {
+      const unsigned int sign = ((unsigned int)h & 0x8000u) << 16;
+      const unsigned int e = ((unsigned int)h >> 10) & 0x1Fu;
+      const unsigned int m = (unsigned int)h & 0x03FFu;
+
+      union { float f; unsigned int u; } v;
+
+      if (e == 0) {
+        // zero or subnormal, m * 2^-24
+        v.f = (float)m * 5.9604644775390625e-8f;
+        v.u |= sign;
+      } else if (e == 31) {
+        // inf, or a nan made quiet like the hardware conversions do
+        v.u = sign | 0x7F800000u | (m << 13) | (m ? 0x00400000u : 0u);
+      } else {
+        v.u = sign | ((e + 112u) << 23) | (m << 13);
+      }
+
+      return v.f;
+    }
+  };
+
+  /**
+   * \class complex_half
+   * \brief Complex value stored as two half_float, the same layout as std::complex<float> at half the size.
+   */
+  class complex_half
+  {
+  public:
+
+    half_float vec[2];
+
+    __inline__ __host__ __device__ complex_half() {}
+
+    __inline__ __host__ __device__ complex_half(float real, float imag)
+    {
+      vec[0] = half_float(real);
+      vec[1] = half_float(imag);
+    }
+
+    complex_half(const std::complex<float>& c)
+    {
+      vec[0] = half_float(c.real());
+      vec[1] = half_float(c.imag());
+    }
+
+    __inline__ __host__ __device__ float real() const
+    {
+      return (float)vec[0];
+    }
+
+    __inline__ __host__ __device__ float imag() const
+    {
+      return (float)vec[1];
+    }
+
+    operator std::complex<float>() const
+    {
+      return std::complex<float>(real(), imag());
+    }
+  };
+}
@@ -122,6 +122,23 @@ namespace Gadgetron
         T evaluateBSpline(const T* coeff, const std::vector<size_t>& dimension, unsigned int SplineDegree, 
                         bspline_float_type** weight, const std::vector<coord_type>& pos);
 
+        /// evaluate BSpline on a regular grid
+        /// pos[d] holds the sampling locations along dimension d, res has the size [pos[0].size() pos[1].size() ...]
+        /// the weights are computed once per axis and applied as separable 1D passes
+        bool evaluateBSplineOnGrid(const hoNDArray<T>& coeff, unsigned int SplineDegree,
+                        const std::vector<unsigned int>& derivative,
+                        const std::vector< std::vector<coord_type> >& pos, hoNDArray<T>& res);
+
+        /// compute the interpolation weights and locations for a set of sampling locations along one dimension
+        /// weight and index have the size [SplineDegree+1 pos.size()]
+        static void computeBSplineGridWeights(size_t len, unsigned int SplineDegree, unsigned int dx,
+                        const std::vector<coord_type>& pos,
+                        std::vector<bspline_float_type>& weight, std::vector<long long>& index);
+
+        /// apply the pre-computed weights along the middle dimension of in [inner len outer], giving out [inner N outer]
+        static void applyBSplineGridWeights(const T* in, size_t inner, size_t len, size_t outer, unsigned int SplineDegree,
+                        const bspline_float_type* weight, const long long* index, size_t N, T* out);
+
         /// compute the BSpline based derivative for an ND array
         /// derivative indicates the order of derivatives for every dimension
         bool computeBSplineDerivative(const hoNDArray<T>& data, const hoNDArray<T>& coeff, unsigned int SplineDegree, const std::vector<unsigned int>& derivative, hoNDArray<T>& deriv);
@@ -790,7 +790,7 @@ namespace Gadgetron
             computeBSplineInterpolationLocationsAndWeights(dimension[ii], SplineDegree, derivative[ii], pos[ii], weight[ii], index[ii]);
         }
 
-        std::vector<size_t> splineDimension(D, SplineDegree);
+        std::vector<size_t> splineDimension(D, SplineDegree+1);
         std::vector<size_t> splineInd(D, 0);
         std::vector<size_t> coeffInd(D, 0);
 
@@ -800,7 +800,7 @@ namespace Gadgetron
         std::vector<size_t> coeffOffsetFactors(D, 0);
         hoNDArray<T>::calculate_offset_factors(dimension, coeffOffsetFactors);
 
-        unsigned int num = (unsigned int)std::pow( (double)SplineDegree, (double)D);
+        unsigned int num = (unsigned int)std::pow( (double)(SplineDegree+1), (double)D);
 
         T res = 0;
 
@@ -847,7 +847,7 @@ namespace Gadgetron
 
         T res=0;
         unsigned int ix;
-        for ( ix=0; ix<SplineDegree; ix++ )
+        for ( ix=0; ix<=SplineDegree; ix++ )
         {
             res += coeff[ xIndex[ix] ] * xWeight[ix];
         }
@@ -1437,7 +1437,7 @@ namespace Gadgetron
             BSplineInterpolationMirrorBoundaryCondition(SplineDegree, index[ii], dimension[ii]);
         }
 
-        std::vector<size_t> splineDimension(D, SplineDegree);
+        std::vector<size_t> splineDimension(D, SplineDegree+1);
         std::vector<size_t> splineInd(D, 0);
         std::vector<size_t> coeffInd(D, 0);
 
@@ -1447,7 +1447,7 @@ namespace Gadgetron
         std::vector<size_t> coeffOffsetFactors(D, 0);
         hoNDArray<T>::calculate_offset_factors(dimension, coeffOffsetFactors);
 
-        unsigned int num = pow(SplineDegree, D);
+        unsigned int num = (unsigned int)std::pow( (double)(SplineDegree+1), (double)D);
 
         T res = 0;
 
@@ -1482,6 +1482,125 @@ namespace Gadgetron
         return this->evaluateBSpline(coeff, dimension, SplineDegree, weight, &pos[0]);
     }
 
+    template <typename T, unsigned int D> 
+    bool hoNDBSpline<T, D>::evaluateBSplineOnGrid(const hoNDArray<T>& coeff, unsigned int SplineDegree, 
+                                                const std::vector<unsigned int>& derivative, 
+                                                const std::vector< std::vector<coord_type> >& pos, hoNDArray<T>& res)
+    {
+        try
+        {
+            size_t NDim = coeff.get_number_of_dimensions();
+            GADGET_CHECK_RETURN_FALSE(pos.size()==NDim);
+            GADGET_CHECK_RETURN_FALSE(derivative.size()>=NDim);
+            GADGET_CHECK_RETURN_FALSE(SplineDegree<10);
+            GADGET_CHECK_RETURN_FALSE(&res!=&coeff);
+
+            std::vector<size_t> dim(NDim);
+            coeff.get_dimensions(dim);
+
+            std::vector<size_t> dimRes(dim);
+            for ( size_t d=0; d<NDim; d++ ) dimRes[d] = pos[d].size();
+
+            // the array goes through [N0 s1 s2 ...], [N0 N1 s2 ...], ... with one buffer per pass
+            hoNDArray<T> buf[2];
+            const T* pIn = coeff.begin();
+
+            std::vector<bspline_float_type> weight;
+            std::vector<long long> index;
+
+            for ( size_t d=0; d<NDim; d++ )
+            {
+                computeBSplineGridWeights(dim[d], SplineDegree, derivative[d], pos[d], weight, index);
+
+                size_t inner = 1;
+                for ( size_t ii=0; ii<d; ii++ ) inner *= dimRes[ii];
+
+                size_t outer = 1;
+                for ( size_t ii=d+1; ii<NDim; ii++ ) outer *= dim[ii];
+
+                std::vector<size_t> dimOut(dimRes.begin(), dimRes.begin()+d+1);
+                dimOut.insert(dimOut.end(), dim.begin()+d+1, dim.end());
+
+                hoNDArray<T>& out = (d==NDim-1) ? res : buf[d%2];
+                if ( out.get_number_of_elements()!=inner*pos[d].size()*outer ) out.create(dimOut);
+
+                applyBSplineGridWeights(pIn, inner, dim[d], outer, SplineDegree, &weight[0], &index[0], pos[d].size(), out.begin());
+
+                pIn = out.begin();
+            }
+
+            res.reshape(dimRes);
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Errors happened in hoNDBSpline<T, D>::evaluateBSplineOnGrid(...) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
+    template <typename T, unsigned int D> 
+    void hoNDBSpline<T, D>::computeBSplineGridWeights(size_t len, unsigned int SplineDegree, unsigned int dx, 
+                                                    const std::vector<coord_type>& pos, 
+                                                    std::vector<bspline_float_type>& weight, std::vector<long long>& index)
+    {
+        size_t N = pos.size();
+        size_t S = SplineDegree + 1;
+
+        weight.resize(S*N);
+        index.resize(S*N);
+
+        for ( size_t n=0; n<N; n++ )
+        {
+            computeBSplineInterpolationLocationsAndWeights(len, SplineDegree, dx, pos[n], &weight[n*S], &index[n*S]);
+        }
+    }
+
+    template <typename T, unsigned int D> 
+    void hoNDBSpline<T, D>::applyBSplineGridWeights(const T* in, size_t inner, size_t len, size_t outer, unsigned int SplineDegree, 
+                                                    const bspline_float_type* weight, const long long* index, size_t N, T* out)
+    {
+        size_t S = SplineDegree + 1;
+        long long num = (long long)(N*outer);
+
+        long long ii;
+        #pragma omp parallel for default(none) private(ii) shared(in, inner, len, outer, S, weight, index, N, out, num) if(num*inner>64*1024)
+        for ( ii=0; ii<num; ii++ )
+        {
+            size_t n = ii % N;
+            size_t o = ii / N;
+
+            const bspline_float_type* w = weight + n*S;
+            const long long* ind = index + n*S;
+
+            const T* pIn = in + o*inner*len;
+            T* pOut = out + (o*N + n)*inner;
+
+            if ( inner==1 )
+            {
+                // same summation order as the point-wise evaluateBSpline
+                T v = 0;
+                for ( size_t k=0; k<S; k++ ) v += pIn[ind[k]] * w[k];
+                pOut[0] = v;
+                continue;
+            }
+
+            for ( size_t i=0; i<inner; i++ ) pOut[i] = 0;
+
+            for ( size_t k=0; k<S; k++ )
+            {
+                const T* pLine = pIn + ind[k]*inner;
+                bspline_float_type wk = w[k];
+
+                for ( size_t i=0; i<inner; i++ )
+                {
+                    pOut[i] += pLine[i] * wk;
+                }
+            }
+        }
+    }
+
     template <typename T, unsigned int D> 
     bool hoNDBSpline<T, D>::computeBSplineDerivative(const hoNDArray<T>& data, const hoNDArray<T>& coeff, unsigned int SplineDegree, const std::vector<unsigned int>& derivative, hoNDArray<T>& deriv)
     {
@@ -2077,7 +2196,7 @@ namespace Gadgetron
     inline void hoNDBSpline<T, D>::BSplineDiscreteFirstOrderDerivative(bspline_float_type x, unsigned int SplineDegree, bspline_float_type* weight, long long* xIndex)
     {
         unsigned int k;
-        for ( k=0; k<SplineDegree; k++ )
+        for ( k=0; k<=SplineDegree; k++ )
         {
             weight[k] = BSplineFirstOrderDerivative(x-xIndex[k], SplineDegree);
         }
@@ -2087,7 +2206,7 @@ namespace Gadgetron
     inline void hoNDBSpline<T, D>::BSplineDiscreteSecondOrderDerivative(bspline_float_type x, unsigned int SplineDegree, bspline_float_type* weight, long long* xIndex)
     {
         unsigned int k;
-        for ( k=0; k<SplineDegree; k++ )
+        for ( k=0; k<=SplineDegree; k++ )
         {
             weight[k] = BSplineSecondOrderDerivative(x-xIndex[k], SplineDegree);
         }
@@ -174,14 +174,14 @@ bool ho2DArray<T>::createArray(size_t sx, size_t sy, T* data, bool delete_data_o
 template <typename T> 
 inline T& ho2DArray<T>::operator()(size_t x , size_t y)
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1]);
     return accesser_[y][x];
 }
 
 template <typename T> 
 inline const T& ho2DArray<T>::operator()(size_t x , size_t y) const
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1]);
     return accesser_[y][x];
 }
 
@@ -194,8 +194,8 @@ bool ho2DArray<T>::init_accesser()
 
         if ( elements_ > 0 )
         {
-            size_t sx = (*dimensions_)[0];
-            size_t sy = (*dimensions_)[1];
+            size_t sx = dimensions_[0];
+            size_t sy = dimensions_[1];
 
             accesser_ = new T*[sy];
             if( accesser_ == NULL) return false;
@@ -246,10 +246,10 @@ void ho2DArray<T>::print(std::ostream& os) const
     BaseClass::print(os);
     size_t x, y;
     os << "-------------------------------------------" << std::endl;
-    for (y=0; y<(*dimensions_)[1]; y++) 
+    for (y=0; y<dimensions_[1]; y++) 
     {
         os << "y " << y << "\t";
-        for (x=0; x<(*dimensions_)[0]; x++)
+        for (x=0; x<dimensions_[0]; x++)
         {
             os << (*this)(x,y) << "\t";
         }
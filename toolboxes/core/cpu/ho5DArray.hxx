@@ -183,14 +183,14 @@ bool ho5DArray<T>::createArray(size_t sx, size_t sy, size_t sz, size_t ss, size_
 template <typename T> 
 inline T& ho5DArray<T>::operator()(size_t x, size_t y, size_t z, size_t s, size_t p)
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1] && z<(*dimensions_)[2] && s<(*dimensions_)[3] && p<(*dimensions_)[4]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1] && z<dimensions_[2] && s<dimensions_[3] && p<dimensions_[4]);
     return accesser_[p][s][z][y][x];
 }
 
 template <typename T> 
 inline const T& ho5DArray<T>::operator()(size_t x, size_t y, size_t z, size_t s, size_t p) const
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1] && z<(*dimensions_)[2] && s<(*dimensions_)[3] && p<(*dimensions_)[4]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1] && z<dimensions_[2] && s<dimensions_[3] && p<dimensions_[4]);
     return accesser_[p][s][z][y][x];
 }
 
@@ -203,11 +203,11 @@ bool ho5DArray<T>::init_accesser()
 
         if ( elements_ > 0 )
         {
-            size_t sx = (*dimensions_)[0];
-            size_t sy = (*dimensions_)[1];
-            size_t sz = (*dimensions_)[2];
-            size_t ss = (*dimensions_)[3];
-            size_t sp = (*dimensions_)[4];
+            size_t sx = dimensions_[0];
+            size_t sy = dimensions_[1];
+            size_t sz = dimensions_[2];
+            size_t ss = dimensions_[3];
+            size_t sp = dimensions_[4];
 
             size_t y, z, s, p;
 
@@ -320,17 +320,17 @@ void ho5DArray<T>::print(std::ostream& os) const
     BaseClass::print(os);
     size_t x, y, z, s, p;
     os << "-------------------------------------------" << std::endl;
-    for (p=0; p<(*dimensions_)[4]; p++) 
+    for (p=0; p<dimensions_[4]; p++) 
     {
-        for (s=0; s<(*dimensions_)[3]; s++) 
+        for (s=0; s<dimensions_[3]; s++) 
         {
-            for (z=0; z<(*dimensions_)[2]; z++) 
+            for (z=0; z<dimensions_[2]; z++) 
             {
                 os << "ho5DArray (:, :, " << z << ", " << s << ", " << p << ") = " << std::endl;
-                for (y=0; y<(*dimensions_)[1]; y++) 
+                for (y=0; y<dimensions_[1]; y++) 
                 {
                     os << "y " << y << "\t";
-                    for (x=0; x<(*dimensions_)[0]; x++)
+                    for (x=0; x<dimensions_[0]; x++)
                     {
                         os << (*this)(x,y,z,s,p) << "\t";
                     }
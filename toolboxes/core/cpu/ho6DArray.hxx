@@ -43,7 +43,7 @@ template <typename T>
 ho6DArray<T>::ho6DArray(size_t sx, size_t sy, size_t sz, size_t ss, size_t sp, size_t sr, T* data, bool delete_data_on_destruct)
 : BaseClass(sx, sy, sz, ss, sp, sr, data, delete_data_on_destruct), accesser_(NULL)
 {
-    GADGET_CHECK_THROW(dimensions_->size()==6);
+    GADGET_CHECK_THROW(dimensions_.size()==6);
     GADGET_CHECK_THROW(init_accesser());
 }
 
@@ -187,14 +187,14 @@ bool ho6DArray<T>::createArray(size_t sx, size_t sy, size_t sz, size_t ss, size_
 template <typename T> 
 inline T& ho6DArray<T>::operator()(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r)
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1] && z<(*dimensions_)[2] && s<(*dimensions_)[3] && p<(*dimensions_)[4] && r<(*dimensions_)[5]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1] && z<dimensions_[2] && s<dimensions_[3] && p<dimensions_[4] && r<dimensions_[5]);
     return accesser_[r][p][s][z][y][x];
 }
 
 template <typename T> 
 inline const T& ho6DArray<T>::operator()(size_t x, size_t y, size_t z, size_t s, size_t p, size_t r) const
 {
-    GADGET_DEBUG_CHECK_THROW(x<(*dimensions_)[0] && y<(*dimensions_)[1] && z<(*dimensions_)[2] && s<(*dimensions_)[3] && p<(*dimensions_)[4] && r<(*dimensions_)[5]);
+    GADGET_DEBUG_CHECK_THROW(x<dimensions_[0] && y<dimensions_[1] && z<dimensions_[2] && s<dimensions_[3] && p<dimensions_[4] && r<dimensions_[5]);
     return accesser_[r][p][s][z][y][x];
 }
 
@@ -207,12 +207,12 @@ bool ho6DArray<T>::init_accesser()
 
         if ( elements_ > 0 )
         {
-            size_t sx = (*dimensions_)[0];
-            size_t sy = (*dimensions_)[1];
-            size_t sz = (*dimensions_)[2];
-            size_t ss = (*dimensions_)[3];
-            size_t sp = (*dimensions_)[4];
-            size_t sr = (*dimensions_)[5];
+            size_t sx = dimensions_[0];
+            size_t sy = dimensions_[1];
+            size_t sz = dimensions_[2];
+            size_t ss = dimensions_[3];
+            size_t sp = dimensions_[4];
+            size_t sr = dimensions_[5];
 
             size_t y, z, s, p, r;
 
@@ -364,19 +364,19 @@ void ho6DArray<T>::print(std::ostream& os) const
     BaseClass::print(os);
     size_t x, y, z, s, p, r;
     os << "-------------------------------------------" << std::endl;
-    for (r=0; r<(*dimensions_)[5]; r++) 
+    for (r=0; r<dimensions_[5]; r++) 
     {
-        for (p=0; p<(*dimensions_)[4]; p++) 
+        for (p=0; p<dimensions_[4]; p++) 
         {
-            for (s=0; s<(*dimensions_)[3]; s++) 
+            for (s=0; s<dimensions_[3]; s++) 
             {
-                for (z=0; z<(*dimensions_)[2]; z++) 
+                for (z=0; z<dimensions_[2]; z++) 
                 {
                     os << "ho6DArray (:, :, " << z << ", " << s << ", " << p << ", " << r << ") = " << std::endl;
-                    for (y=0; y<(*dimensions_)[1]; y++) 
+                    for (y=0; y<dimensions_[1]; y++) 
                     {
                         os << "y " << y << "\t";
-                        for (x=0; x<(*dimensions_)[0]; x++)
+                        for (x=0; x<dimensions_[0]; x++)
                         {
                             os << (*this)(x,y,z,s,p,r) << "\t";
                         }
@@ -7,6 +7,8 @@
 #include "NDArray.h"
 #include "complext.h"
 #include "vector_td.h"
+#include "hoNDArrayMemoryPool.h"
+#include "hoNDArrayAllocator.h"
 
 #include "cpucore_export.h"
 
@@ -14,6 +16,10 @@
 #include <float.h>
 #include <boost/shared_ptr.hpp>
 #include <stdexcept>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#include <utility>
 
 namespace Gadgetron{
 
@@ -121,6 +127,45 @@ namespace Gadgetron{
 
     T& operator[]( size_t idx );
 
+    // Non-const element access detaches a shared buffer first, see share()
+    using BaseClass::get_data_ptr;
+    T* get_data_ptr();
+
+    template <typename... I> T& operator()( I&&... ind )
+    {
+      if ( shared_data_ ) this->detach();
+      return BaseClass::operator()(std::forward<I>(ind)...);
+    }
+
+    template <typename... I> const T& operator()( I&&... ind ) const
+    {
+      return BaseClass::operator()(std::forward<I>(ind)...);
+    }
+
+    /// Turns the buffer into a reference counted, copy-on-write buffer.
+    /// Copies of the array (copy constructor, assignment) then reference the same memory
+    /// instead of copying it; the first write through a non-const accessor (get_data_ptr(),
+    /// begin(), operator(), operator[], create() with new dimensions, ...) of an array whose
+    /// buffer is still referenced elsewhere copies it. Writes through a const array or a raw
+    /// pointer taken before the copy are not seen and change all references.
+    /// Arrays that do not own their memory are left as they are.
+    void share();
+
+    /// Whether the buffer is referenced by another array
+    bool is_shared() const;
+
+    /// Gives this array a private copy of a shared buffer
+    void detach();
+
+    /// Changes the dimensions to ones with at most as many elements, keeping the buffer and its leading elements.
+    /// Nothing is reallocated; the memory past the new number of elements stays allocated until the buffer is freed.
+    void shrink(const std::vector<size_t>& dimensions);
+
+    /// out references the contiguous block of the given dimensions starting at element offset.
+    /// The block is copied if this array is not in shared mode. The whole buffer stays alive
+    /// as long as out does.
+    void get_shared_sub_array(size_t offset, const std::vector<size_t>& dimensions, hoNDArray<T>& out);
+
     //T& operator()( size_t idx );
     //const T& operator()( size_t idx ) const;
 
@@ -135,6 +180,8 @@ namespace Gadgetron{
         this->create(aArray.get_dimensions());
       }
 
+      this->detach();
+
       long long i;
       #pragma omp parallel for default(none) private(i) shared(aArray)
       for ( i=0; i<(long long)elements_; i++ )
@@ -163,6 +210,28 @@ namespace Gadgetron{
     virtual void allocate_memory();
     virtual void deallocate_memory();
 
+    // Whether the buffer of this array can be handed to a shared buffer
+    bool is_sharable() const;
+
+    // Frees a shared buffer the way hoNDArray allocated it; lives in the control block of the
+    // buffer and carries its mutex, which serializes the copies of detach()
+    struct SharedDataDeleter
+    {
+      SharedDataDeleter() : mutex(std::make_shared<std::mutex>()) {}
+
+      std::shared_ptr<std::mutex> mutex;
+
+      void operator()(T* data) const
+      {
+        hoNDArray<T> a;
+        a.data_ = data;
+      }
+    };
+
+    // Set in shared mode, data_ points into it and delete_data_on_destruct_ stays true;
+    // deallocate_memory() then drops the reference instead of freeing
+    boost::shared_ptr<T> shared_data_;
+
     // Generic allocator / deallocator
     //
 
@@ -199,12 +268,12 @@ namespace Gadgetron{
 
     template<class TYPE, unsigned int D> void _allocate_memory( size_t size, vector_td<TYPE,D>** data )
     {
-      *data = (vector_td<TYPE,D>*) malloc( size*sizeof(vector_td<TYPE,D>) );
+      *data = (vector_td<TYPE,D>*) hoNDArrayAllocator::instance().allocate( size*sizeof(vector_td<TYPE,D>) );
     }
 
     template<class TYPE, unsigned int D>  void _deallocate_memory( vector_td<TYPE,D>* data )
     {
-      free( data );
+      hoNDArrayAllocator::instance().deallocate( data );
     }
   };
 }
@@ -251,15 +251,16 @@ namespace Gadgetron
         if(!a) throw std::runtime_error("hoNDArray<T>::hoNDArray(): 0x0 pointer provided");
         this->data_ = 0;
 
-        std::vector<size_t>* tmp = new std::vector<size_t>;
-        this->dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        *(this->dimensions_) = *(a->dimensions_);
+        this->dimensions_ = a->dimensions_;
+        this->offsetFactors_ = a->offsetFactors_;
 
-        tmp = new std::vector<size_t>;
-        this->offsetFactors_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        *(this->offsetFactors_) = *(a->offsetFactors_);
-
-        if ( !this->dimensions_->empty() )
+        if ( a->shared_data_ )
+        {
+            this->elements_ = a->elements_;
+            this->data_ = a->data_;
+            this->shared_data_ = a->shared_data_;
+        }
+        else if ( !this->dimensions_.empty() )
         {
             allocate_memory();
             memcpy( this->data_, a->data_, this->elements_*sizeof(T) );
@@ -275,15 +276,16 @@ namespace Gadgetron
     {
         this->data_ = 0;
 
-        std::vector<size_t>* tmp = new std::vector<size_t>;
-        this->dimensions_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        *(this->dimensions_) = *(a.dimensions_);
-
-        tmp = new std::vector<size_t>;
-        this->offsetFactors_ = boost::shared_ptr< std::vector<size_t> >(tmp);
-        *(this->offsetFactors_) = *(a.offsetFactors_);
+        this->dimensions_ = a.dimensions_;
+        this->offsetFactors_ = a.offsetFactors_;
 
-        if ( !this->dimensions_->empty() )
+        if ( a.shared_data_ )
+        {
+            this->elements_ = a.elements_;
+            this->data_ = a.data_;
+            this->shared_data_ = a.shared_data_;
+        }
+        else if ( !this->dimensions_.empty() )
         {
             allocate_memory();
             memcpy( this->data_, a.data_, this->elements_*sizeof(T) );
@@ -298,12 +300,13 @@ namespace Gadgetron
     template <typename T>
     hoNDArray<T>::hoNDArray(hoNDArray<T>&& a) : NDArray<T>::NDArray(){
     	data_ = a.data_;
-    	*this->dimensions_ = *a.dimensions_;
+    	this->dimensions_ = a.dimensions_;
     	this->elements_ = a.elements_;
-    	a.dimensions_.reset();
+    	a.dimensions_.clear();
     	a.data_ = nullptr;
     	this->offsetFactors_ = a.offsetFactors_;
-    	a.offsetFactors_.reset();
+    	a.offsetFactors_.clear();
+    	this->shared_data_.swap(a.shared_data_);
     }
 #endif
     template <typename T> 
@@ -316,15 +319,27 @@ namespace Gadgetron
             return *this;
         }
 
+        // A shared buffer is referenced, unless this array writes into memory it does not own
+        if ( rhs.shared_data_ && this->delete_data_on_destruct_ && this->is_sharable() ){
+            deallocate_memory();
+            this->dimensions_ = rhs.dimensions_;
+            this->offsetFactors_ = rhs.offsetFactors_;
+            this->elements_ = rhs.elements_;
+            this->data_ = rhs.data_;
+            this->shared_data_ = rhs.shared_data_;
+            return *this;
+        }
+
         // Are the dimensions the same? Then we can just memcpy
         if (this->dimensions_equal(&rhs)){
+            this->detach();
             memcpy(this->data_, rhs.data_, this->elements_*sizeof(T));
         }
         else{
             deallocate_memory();
             this->data_ = 0;
-            *(this->dimensions_) = *(rhs.dimensions_);
-            *(this->offsetFactors_) = *(rhs.offsetFactors_);
+            this->dimensions_ = rhs.dimensions_;
+            this->offsetFactors_ = rhs.offsetFactors_;
             allocate_memory();
             memcpy( this->data_, rhs.data_, this->elements_*sizeof(T) );
         }
@@ -338,13 +353,14 @@ namespace Gadgetron
         if ( &rhs == this ) return *this;
 
         this->clear();
-        *this->dimensions_ = *rhs.dimensions_;
-        *this->offsetFactors_ = *rhs.offsetFactors_;
+        this->dimensions_ = rhs.dimensions_;
+        this->offsetFactors_ = rhs.offsetFactors_;
         this->elements_ = rhs.elements_;
-        rhs.dimensions_.reset();
-        rhs.offsetFactors_.reset();
+        rhs.dimensions_.clear();
+        rhs.offsetFactors_.clear();
         data_ = rhs.data_;
         rhs.data_ = nullptr;
+        this->shared_data_.swap(rhs.shared_data_);
         return *this;
     }
 #endif
@@ -679,9 +695,17 @@ namespace Gadgetron
         std::fill(this->get_data_ptr(), this->get_data_ptr()+this->get_number_of_elements(), value);
     }
 
+    template <typename T> 
+    inline T* hoNDArray<T>::get_data_ptr()
+    {
+        if ( shared_data_ ) this->detach();
+        return this->data_;
+    }
+
     template <typename T> 
     inline T* hoNDArray<T>::begin()
     {
+        if ( shared_data_ ) this->detach();
         return this->data_;
     }
 
@@ -694,6 +718,7 @@ namespace Gadgetron
     template <typename T> 
     inline T* hoNDArray<T>::end()
     {
+        if ( shared_data_ ) this->detach();
         return (this->data_+this->elements_);
     }
 
@@ -789,7 +814,7 @@ namespace Gadgetron
             BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
         }
 
-        if ( start.size() != (*dimensions_).size() ){
+        if ( start.size() != dimensions_.size() ){
             BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
         }
 
@@ -800,12 +825,14 @@ namespace Gadgetron
             return;
         }
 
+        out.detach();
+
         std::vector<size_t> end(start.size());
 
         size_t ii;
         for ( ii=0; ii<start.size(); ii++ ){
             end[ii] = start[ii] + size[ii] - 1;
-            if ( end[ii] >= (*dimensions_)[ii] ){
+            if ( end[ii] >= dimensions_[ii] ){
                 BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
             }
         }
@@ -833,10 +860,96 @@ namespace Gadgetron
             }
 
             // now, copy size[0] elements:
-            memcpy( &out.data_[ind1D], &((*this)( ind )), size[0]*sizeof(T) );
+            memcpy( &out.data_[ind1D], this->data_ + this->calculate_offset( ind ), size[0]*sizeof(T) );
         }                       
     }
 
+    template <typename T> 
+    void hoNDArray<T>::get_shared_sub_array(size_t offset, const std::vector<size_t>& dimensions, hoNDArray<T>& out)
+    {
+        size_t n = 1;
+        for ( size_t ii=0; ii<dimensions.size(); ii++ ) n *= dimensions[ii];
+
+        if ( dimensions.empty() || offset + n > this->elements_ ){
+            BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_shared_sub_array failed"));
+        }
+
+        if ( !shared_data_ || !out.delete_data_on_destruct_ || !out.is_sharable() ){
+            std::vector<size_t> dims(dimensions);
+            out.create(dims);
+            memcpy( out.get_data_ptr(), this->data_ + offset, n*sizeof(T) );
+            return;
+        }
+
+        // aliases the control block of the whole buffer, which is freed by the last reference
+        boost::shared_ptr<T> sub(shared_data_, this->data_ + offset);
+
+        out.deallocate_memory();
+        out.dimensions_ = dimensions;
+        out.calculate_offset_factors(out.dimensions_);
+        out.elements_ = n;
+        out.data_ = sub.get();
+        out.shared_data_.swap(sub);
+    }
+
+    template <typename T> 
+    void hoNDArray<T>::shrink(const std::vector<size_t>& dimensions)
+    {
+        size_t n = 1;
+        for ( size_t ii=0; ii<dimensions.size(); ii++ ) n *= dimensions[ii];
+
+        if ( dimensions.empty() || n > this->elements_ ){
+            BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::shrink failed"));
+        }
+
+        this->dimensions_ = dimensions;
+        this->calculate_offset_factors(this->dimensions_);
+        this->elements_ = n;
+    }
+
+    template <typename T> 
+    void hoNDArray<T>::share()
+    {
+        if ( shared_data_ || !this->data_ || !this->delete_data_on_destruct_ || !this->is_sharable() ) return;
+        shared_data_.reset(this->data_, SharedDataDeleter());
+    }
+
+    template <typename T> 
+    bool hoNDArray<T>::is_shared() const
+    {
+        return shared_data_ && !shared_data_.unique();
+    }
+
+    template <typename T> 
+    void hoNDArray<T>::detach()
+    {
+        // a buffer no other array references is written in place, without locking
+        if ( !shared_data_ || shared_data_.unique() ) return;
+
+        // threads writing into the same shared array are serialized on the copy by the mutex of the buffer
+        std::shared_ptr<std::mutex> buffer_mutex = boost::get_deleter<SharedDataDeleter>(shared_data_)->mutex;
+        std::lock_guard<std::mutex> guard(*buffer_mutex);
+        if ( !shared_data_ || shared_data_.unique() ) return;
+
+        T* data = 0;
+        this->_allocate_memory(this->elements_, &data);
+        if ( data == 0x0 )
+        {
+            BOOST_THROW_EXCEPTION( bad_alloc("hoNDArray<>::detach failed"));
+        }
+
+        memcpy( data, this->data_, this->elements_*sizeof(T) );
+        this->data_ = data;
+        shared_data_.reset();
+    }
+
+    template <typename T> 
+    bool hoNDArray<T>::is_sharable() const
+    {
+        // subclasses may allocate differently (pinned, mapped memory) or cache pointers into data_
+        return typeid(*this) == typeid(hoNDArray<T>);
+    }
+
     template <typename T> 
     void hoNDArray<T>::printContent(std::ostream& os) const
     {
@@ -847,11 +960,11 @@ namespace Gadgetron
 
         size_t i;
 
-        os << "Array dimension is : " << dimensions_->size() << endl;
+        os << "Array dimension is : " << dimensions_.size() << endl;
 
         os << "Array size is : ";
-        for (i=0; i<dimensions_->size(); i++ ) 
-            os << (*dimensions_)[i] << " "; 
+        for (i=0; i<dimensions_.size(); i++ ) 
+            os << dimensions_[i] << " "; 
         os << endl;
 
         int elemTypeSize = sizeof(T);
@@ -892,12 +1005,12 @@ namespace Gadgetron
     {
         deallocate_memory();
 
-        if ( !this->dimensions_->empty() )
+        if ( !this->dimensions_.empty() )
         {
-            this->elements_ = (*this->dimensions_)[0];
-            for (size_t i = 1; i < this->dimensions_->size(); i++)
+            this->elements_ = this->dimensions_[0];
+            for (size_t i = 1; i < this->dimensions_.size(); i++)
             {
-                this->elements_ *= (*this->dimensions_)[i];
+                this->elements_ *= this->dimensions_[i];
             }
 
             if ( this->elements_ > 0 )
@@ -923,6 +1036,12 @@ namespace Gadgetron
     template <typename T> 
     void hoNDArray<T>::deallocate_memory()
     {
+        if ( shared_data_ ){
+            shared_data_.reset();
+            this->data_ = 0x0;
+            return;
+        }
+
         if (!(this->delete_data_on_destruct_)) {
              throw std::runtime_error("You don't own this data.  You cannot deallocate its memory.");
         }
@@ -936,73 +1055,73 @@ namespace Gadgetron
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, float** data )
     {
-        *data = (float*) malloc( size*sizeof(float) );
+        *data = (float*) hoNDArrayAllocator::instance().allocate( size*sizeof(float) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( float* data )
     {
-        free(data);
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, double** data )
     {
-        *data = (double*) malloc( size*sizeof(double) );
+        *data = (double*) hoNDArrayAllocator::instance().allocate( size*sizeof(double) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( double* data )
     {
-        free(data);
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<float>** data )
     {
-        *data = (std::complex<float>*) malloc( size*sizeof(std::complex<float>) );
+        *data = (std::complex<float>*) hoNDArrayAllocator::instance().allocate( size*sizeof(std::complex<float>) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( std::complex<float>* data )
     {
-        free(data);
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, std::complex<double>** data )
     {
-        *data = (std::complex<double>*) malloc( size*sizeof(std::complex<double>) );
+        *data = (std::complex<double>*) hoNDArrayAllocator::instance().allocate( size*sizeof(std::complex<double>) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( std::complex<double>* data )
     {
-        free(data);
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, float_complext** data )
     {
-        *data = (float_complext*) malloc( size*sizeof(float_complext) );
+        *data = (float_complext*) hoNDArrayAllocator::instance().allocate( size*sizeof(float_complext) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( float_complext* data )
     {
-        free( data );
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_allocate_memory( size_t size, double_complext** data )
     {
-        *data = (double_complext*) malloc( size*sizeof(double_complext) );
+        *data = (double_complext*) hoNDArrayAllocator::instance().allocate( size*sizeof(double_complext) );
     }
 
     template <typename T> 
     inline void hoNDArray<T>::_deallocate_memory( double_complext* data )
     {
-        free( data );
+        if ( !hoNDArrayMemoryPool::instance().deallocate(data) ) hoNDArrayAllocator::instance().deallocate(data);
     }
 
     template <typename T> 
@@ -1010,7 +1129,7 @@ namespace Gadgetron
     {
         if ( buf != NULL ) delete[] buf;
 
-        size_t NDim = dimensions_->size();
+        size_t NDim = dimensions_.size();
 
         // number of dimensions + dimension vector + contents
         len = sizeof(size_t) + sizeof(size_t)*NDim + sizeof(T)*elements_;
@@ -1020,7 +1139,7 @@ namespace Gadgetron
         memcpy(buf, &NDim, sizeof(size_t));
         if ( NDim > 0 )
         {
-            memcpy(buf+sizeof(size_t), &((*dimensions_)[0]), sizeof(size_t)*NDim);
+            memcpy(buf+sizeof(size_t), dimensions_.data(), sizeof(size_t)*NDim);
             memcpy(buf+sizeof(size_t)+sizeof(size_t)*NDim, this->data_, sizeof(T)*elements_);
         }
 
@@ -1040,6 +1159,7 @@ namespace Gadgetron
 
             // allocate memory
             this->create(&dimensions);
+            this->detach();
 
             // copy the content
             memcpy(this->data_, buf+sizeof(size_t)+sizeof(size_t)*NDim, sizeof(T)*elements_);
@@ -0,0 +1,279 @@
+/** \file   hoNDArrayAllocator.h
+    \brief  Aligned, optionally huge page backed allocation of hoNDArray data buffers.
+
+            All buffers are aligned to at least alignment() bytes (64 by default, one cache line and
+            one AVX-512 vector), so SIMD kernels and FFTW plans can rely on aligned data. Buffers of at
+            least huge_page_threshold() bytes can in addition be backed by huge pages:
+
+              HUGE_PAGES_TRANSPARENT  the buffer is aligned to 2 MB and marked with MADV_HUGEPAGE
+              HUGE_PAGES_EXPLICIT     the buffer is mapped from the hugetlbfs pool (MAP_HUGETLB), falls
+                                      back to transparent huge pages if no huge pages are reserved
+
+            Except for explicitly mapped huge pages all buffers come from posix_memalign and can be
+            released with free(), as before. Explicit mappings are recognised by address in deallocate().
+
+            The policy is set globally with set_policy() (initialised from the environment variables
+            GADGETRON_ARRAY_ALIGNMENT, GADGETRON_HUGE_PAGES=none|transparent|explicit and
+            GADGETRON_HUGE_PAGE_THRESHOLD_MB), or for the arrays created by one thread within the lifetime
+            of a hoNDArrayAllocationScope.
+
+            Buffers allocated while a GadgetronMemoryAccount is current are charged to that account.
+            Large buffers allocated for a stream placed on a NUMA node are bound to that node (see GadgetronNuma).
+*/
+
+#pragma once
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#include "GadgetronMemoryAccount.h"
+#include "GadgetronNuma.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace Gadgetron{
+
+  class hoNDArrayAllocator
+  {
+  public:
+
+    enum HugePageMode
+    {
+      HUGE_PAGES_NONE = 0,
+      HUGE_PAGES_TRANSPARENT,
+      HUGE_PAGES_EXPLICIT
+    };
+
+    enum
+    {
+      DEFAULT_ALIGNMENT = 64,
+      HUGE_PAGE_SIZE = 2 << 20,
+      DEFAULT_HUGE_PAGE_THRESHOLD = 32 << 20
+    };
+
+    struct Policy
+    {
+      Policy(size_t a = DEFAULT_ALIGNMENT, HugePageMode m = HUGE_PAGES_NONE, size_t t = DEFAULT_HUGE_PAGE_THRESHOLD)
+        : alignment(a), huge_pages(m), huge_page_threshold(t) {}
+
+      size_t alignment;
+      HugePageMode huge_pages;
+      size_t huge_page_threshold;
+    };
+
+    static hoNDArrayAllocator& instance()
+    {
+      static hoNDArrayAllocator allocator;
+      return allocator;
+    }
+
+    /// Policy in effect for the calling thread
+    Policy policy() const
+    {
+      const Policy* p = scoped_policy();
+      if (p) return *p;
+      return Policy(alignment_.load(std::memory_order_relaxed),
+                    static_cast<HugePageMode>(huge_pages_.load(std::memory_order_relaxed)),
+                    huge_page_threshold_.load(std::memory_order_relaxed));
+    }
+
+    /// Sets the global policy, the alignment is rounded up to a power of two of at least sizeof(void*)
+    void set_policy(const Policy& p)
+    {
+      alignment_.store(valid_alignment(p.alignment), std::memory_order_relaxed);
+      huge_pages_.store(p.huge_pages, std::memory_order_relaxed);
+      huge_page_threshold_.store(p.huge_page_threshold, std::memory_order_relaxed);
+    }
+
+    void* allocate(size_t nbytes)
+    {
+      return this->allocate(nbytes, this->policy());
+    }
+
+    void* allocate(size_t nbytes, const Policy& p)
+    {
+      void* ptr = this->allocate_untracked(nbytes, p);
+      GadgetronMemoryTracker::instance().allocated(ptr, nbytes, GadgetronMemoryAccount::HOST);
+      return ptr;
+    }
+
+    void deallocate(void* ptr)
+    {
+      if (!ptr) return;
+
+      GadgetronMemoryTracker::instance().released(ptr);
+      this->deallocate_untracked(ptr);
+    }
+
+    /// Allocation that is not charged to the current memory account, e.g. for the slabs of a pool
+    void* allocate_untracked(size_t nbytes, const Policy& p)
+    {
+      if (nbytes == 0) nbytes = 1;
+
+#ifndef _WIN32
+      bool huge = (p.huge_pages != HUGE_PAGES_NONE) && (nbytes >= p.huge_page_threshold);
+
+      if (huge && p.huge_pages == HUGE_PAGES_EXPLICIT) {
+        void* ptr = this->map_huge_pages(nbytes);
+        if (ptr) {
+          GadgetronNuma::instance().bind_buffer(ptr, round_up(nbytes, HUGE_PAGE_SIZE));
+          return ptr;
+        }
+      }
+
+      size_t alignment = huge ? HUGE_PAGE_SIZE : valid_alignment(p.alignment);
+      size_t size = huge ? round_up(nbytes, HUGE_PAGE_SIZE) : nbytes;
+
+      void* ptr = 0;
+      if (posix_memalign(&ptr, alignment, size) != 0) return 0;
+
+#ifdef MADV_HUGEPAGE
+      if (huge) madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+      GadgetronNuma::instance().bind_buffer(ptr, size);
+      return ptr;
+#else
+      //_aligned_malloc memory could not be released with free(), Windows keeps the malloc alignment
+      return malloc(nbytes);
+#endif
+    }
+
+    void deallocate_untracked(void* ptr)
+    {
+      if (!ptr) return;
+
+#ifndef _WIN32
+      if (has_mappings_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        std::map<void*, size_t>::iterator it = mappings_.find(ptr);
+        if (it != mappings_.end()) {
+          munmap(it->first, it->second);
+          mappings_.erase(it);
+          return;
+        }
+      }
+#endif
+      free(ptr);
+    }
+
+    /// Memory currently mapped from explicit huge pages
+    size_t explicit_huge_page_bytes()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      size_t total = 0;
+      for (std::map<void*, size_t>::iterator it = mappings_.begin(); it != mappings_.end(); ++it) {
+        total += it->second;
+      }
+      return total;
+    }
+
+    static size_t valid_alignment(size_t a)
+    {
+      size_t v = sizeof(void*);
+      while (v < a) v <<= 1;
+      return v;
+    }
+
+  protected:
+    friend class hoNDArrayAllocationScope;
+
+    static const Policy*& scoped_policy()
+    {
+      static thread_local const Policy* p = 0;
+      return p;
+    }
+
+    static size_t round_up(size_t n, size_t m)
+    {
+      return ((n + m - 1) / m) * m;
+    }
+
+    hoNDArrayAllocator()
+      : alignment_(DEFAULT_ALIGNMENT)
+      , huge_pages_(HUGE_PAGES_NONE)
+      , huge_page_threshold_(DEFAULT_HUGE_PAGE_THRESHOLD)
+      , has_mappings_(false)
+    {
+      const char* a = std::getenv("GADGETRON_ARRAY_ALIGNMENT");
+      if (a && std::atol(a) > 0) alignment_.store(valid_alignment(std::atol(a)));
+
+      const char* h = std::getenv("GADGETRON_HUGE_PAGES");
+      if (h) {
+        std::string mode(h);
+        if (mode == "transparent") huge_pages_.store(HUGE_PAGES_TRANSPARENT);
+        else if (mode == "explicit") huge_pages_.store(HUGE_PAGES_EXPLICIT);
+      }
+
+      const char* t = std::getenv("GADGETRON_HUGE_PAGE_THRESHOLD_MB");
+      if (t && std::atol(t) > 0) huge_page_threshold_.store(size_t(std::atol(t)) << 20);
+    }
+
+    ~hoNDArrayAllocator()
+    {
+      //Mappings are intentionally not released; arrays may outlive static destruction
+    }
+
+    hoNDArrayAllocator(const hoNDArrayAllocator&);
+    hoNDArrayAllocator& operator=(const hoNDArrayAllocator&);
+
+    void* map_huge_pages(size_t nbytes)
+    {
+#if !defined(_WIN32) && defined(MAP_HUGETLB)
+      size_t size = round_up(nbytes, HUGE_PAGE_SIZE);
+      void* ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (ptr == MAP_FAILED) return 0;
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      mappings_[ptr] = size;
+      has_mappings_.store(true, std::memory_order_release);
+      return ptr;
+#else
+      return 0;
+#endif
+    }
+
+    std::atomic<size_t> alignment_;
+    std::atomic<int> huge_pages_;
+    std::atomic<size_t> huge_page_threshold_;
+
+    std::mutex mutex_;
+    std::map<void*, size_t> mappings_;
+    std::atomic<bool> has_mappings_;
+  };
+
+  /**
+     Allocation policy for the arrays created by the calling thread while the scope exists, e.g.
+
+       {
+         hoNDArrayAllocationScope scope(hoNDArrayAllocator::Policy(64, hoNDArrayAllocator::HUGE_PAGES_EXPLICIT, 0));
+         kspace.create(RO, E1, E2, CHA);
+       }
+   */
+  class hoNDArrayAllocationScope
+  {
+  public:
+    hoNDArrayAllocationScope(const hoNDArrayAllocator::Policy& p)
+      : policy_(p)
+      , previous_(hoNDArrayAllocator::scoped_policy())
+    {
+      policy_.alignment = hoNDArrayAllocator::valid_alignment(policy_.alignment);
+      hoNDArrayAllocator::scoped_policy() = &policy_;
+    }
+
+    ~hoNDArrayAllocationScope()
+    {
+      hoNDArrayAllocator::scoped_policy() = previous_;
+    }
+
+  protected:
+    hoNDArrayAllocator::Policy policy_;
+    const hoNDArrayAllocator::Policy* previous_;
+  };
+}
@@ -0,0 +1,157 @@
+
+#include "hoNDArrayMapped.h"
+
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+namespace Gadgetron
+{
+
+hoNDArrayFileMapping::hoNDArrayFileMapping() : data_(0), bytes_(0), writable_(false)
+{
+}
+
+hoNDArrayFileMapping::~hoNDArrayFileMapping()
+{
+    this->unmap();
+}
+
+#ifdef _WIN32
+
+void hoNDArrayFileMapping::open(const std::string& filename, bool writable)
+{
+    throw std::runtime_error("hoNDArrayMapped::open_file: memory-mapped arrays are not supported on this platform");
+}
+
+void hoNDArrayFileMapping::create(const std::string& filename, size_t bytes)
+{
+    throw std::runtime_error("hoNDArrayMapped::create_file: memory-mapped arrays are not supported on this platform");
+}
+
+void hoNDArrayFileMapping::advise(Advice a, size_t offset, size_t len)
+{
+}
+
+void hoNDArrayFileMapping::flush(bool async)
+{
+}
+
+void hoNDArrayFileMapping::unmap()
+{
+}
+
+#else
+
+namespace
+{
+    void* map_fd(int fd, size_t bytes, bool shared, const std::string& filename)
+    {
+        void* p = mmap(0, bytes, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            std::string err(strerror(errno));
+            ::close(fd);
+            throw std::runtime_error("hoNDArrayMapped: cannot map " + filename + ": " + err);
+        }
+        ::close(fd);
+        return p;
+    }
+}
+
+void hoNDArrayFileMapping::open(const std::string& filename, bool writable)
+{
+    this->unmap();
+
+    int fd = ::open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("hoNDArrayMapped::open_file: cannot open " + filename + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::string err(strerror(errno));
+        ::close(fd);
+        throw std::runtime_error("hoNDArrayMapped::open_file: cannot stat " + filename + ": " + err);
+    }
+
+    filename_ = filename;
+    writable_ = writable;
+
+    // an empty file cannot be mapped, the caller sees a mapping of size 0
+    if (st.st_size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    data_ = map_fd(fd, (size_t)st.st_size, writable, filename);
+    bytes_ = (size_t)st.st_size;
+}
+
+void hoNDArrayFileMapping::create(const std::string& filename, size_t bytes)
+{
+    this->unmap();
+
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("hoNDArrayMapped::create_file: cannot create " + filename + ": " + strerror(errno));
+    }
+
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        std::string err(strerror(errno));
+        ::close(fd);
+        throw std::runtime_error("hoNDArrayMapped::create_file: cannot size " + filename + ": " + err);
+    }
+
+    data_ = map_fd(fd, bytes, true, filename);
+    bytes_ = bytes;
+    writable_ = true;
+    filename_ = filename;
+}
+
+void hoNDArrayFileMapping::advise(Advice a, size_t offset, size_t len)
+{
+    if (!data_ || offset >= bytes_ || len == 0) return;
+    if (len > bytes_ - offset) len = bytes_ - offset;
+
+    int advice = MADV_NORMAL;
+    switch (a) {
+        case ADVISE_SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case ADVISE_RANDOM:     advice = MADV_RANDOM; break;
+        case ADVISE_WILLNEED:   advice = MADV_WILLNEED; break;
+        case ADVISE_DONTNEED:   advice = MADV_DONTNEED; break;
+        default: break;
+    }
+
+    // madvise wants a page aligned start
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t b = offset - offset % page;
+    madvise(static_cast<char*>(data_) + b, offset + len - b, advice);
+}
+
+void hoNDArrayFileMapping::flush(bool async)
+{
+    if (!data_) return;
+    if (msync(data_, bytes_, async ? MS_ASYNC : MS_SYNC) != 0) {
+        throw std::runtime_error("hoNDArrayMapped::flush: msync failed for " + filename_ + ": " + strerror(errno));
+    }
+}
+
+void hoNDArrayFileMapping::unmap()
+{
+    if (data_) munmap(data_, bytes_);
+
+    data_ = 0;
+    bytes_ = 0;
+    writable_ = false;
+    filename_.clear();
+}
+
+#endif // _WIN32
+
+}
@@ -0,0 +1,265 @@
+/** \file   hoNDArrayMapped.h
+    \brief  File backed hoNDArray, the data is memory-mapped instead of read into RAM.
+
+            The file has the layout of write_nd_array (hoNDArray_fileio.h): the number of dimensions
+            and the dimensions as int, followed by the raw data. A mapped array is a hoNDArray that
+            borrows the mapped memory, so solvers, FFTs and the elementwise functions work on it
+            unchanged, and the kernel pages data in and out as it is touched:
+
+              hoNDArrayMapped< std::complex<float> > kspace;
+              kspace.open_file("/scratch/flow4d.bin", hoNDArrayMapped< std::complex<float> >::MAP_READ);
+              kspace.advise(hoNDArrayMapped< std::complex<float> >::ADVISE_SEQUENTIAL);
+              Gadgetron::hoNDFFT<float>::instance()->ifft3c(kspace);   // pages are copy-on-write
+
+            MAP_READ maps the file copy-on-write, the array can be modified but the file is never
+            changed. MAP_READ_WRITE maps it shared, changes go to the file (made durable by flush() or
+            close()). create_file() makes a new file of the given dimensions and maps it read-write.
+
+            Like any array borrowing its memory, a mapped array cannot be recreated with other
+            dimensions; close() it first. The data starts right after the header, so types
+            with an alignment above 4 bytes need an even number of dimensions+1 header entries;
+            open_file() and create_file() throw otherwise. Mapping is only supported on POSIX systems.
+
+            The system calls are in hoNDArrayMapped.cpp (hoNDArrayFileMapping), this header does not
+            pull in any platform headers.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+#include "cpucore_export.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace Gadgetron{
+
+  /**
+     A mapped file, the platform specific part of hoNDArrayMapped. The methods throw std::runtime_error
+     on failure, and on platforms without memory mapping.
+   */
+  class EXPORTCPUCORE hoNDArrayFileMapping
+  {
+  public:
+
+    enum Advice
+    {
+      ADVISE_NORMAL = 0,
+      ADVISE_SEQUENTIAL,
+      ADVISE_RANDOM,
+      ADVISE_WILLNEED,
+      ADVISE_DONTNEED
+    };
+
+    hoNDArrayFileMapping();
+    ~hoNDArrayFileMapping();
+
+    /// Maps an existing file, shared if writable, copy-on-write otherwise
+    void open(const std::string& filename, bool writable);
+
+    /// Creates (or truncates) a file of the given size and maps it shared
+    void create(const std::string& filename, size_t bytes);
+
+    /// Advice for the pages overlapping the byte range [offset, offset+len)
+    void advise(Advice a, size_t offset, size_t len);
+
+    /// Writes changed pages back to a shared mapping
+    void flush(bool async);
+
+    void unmap();
+
+    void* data() const { return data_; }
+    size_t size() const { return bytes_; }
+    bool writable() const { return writable_; }
+    const std::string& filename() const { return filename_; }
+
+  private:
+
+    void* data_;
+    size_t bytes_;
+    bool writable_;
+    std::string filename_;
+
+    hoNDArrayFileMapping(const hoNDArrayFileMapping&);
+    hoNDArrayFileMapping& operator=(const hoNDArrayFileMapping&);
+  };
+
+  template <typename T> class hoNDArrayMapped : public hoNDArray<T>
+  {
+  public:
+
+    typedef hoNDArray<T> BaseClass;
+
+    enum MapMode
+    {
+      MAP_READ = 0,
+      MAP_READ_WRITE
+    };
+
+    enum Advice
+    {
+      ADVISE_NORMAL = hoNDArrayFileMapping::ADVISE_NORMAL,
+      ADVISE_SEQUENTIAL = hoNDArrayFileMapping::ADVISE_SEQUENTIAL,
+      ADVISE_RANDOM = hoNDArrayFileMapping::ADVISE_RANDOM,
+      ADVISE_WILLNEED = hoNDArrayFileMapping::ADVISE_WILLNEED,
+      ADVISE_DONTNEED = hoNDArrayFileMapping::ADVISE_DONTNEED
+    };
+
+    hoNDArrayMapped() : header_bytes_(0), mode_(MAP_READ)
+    {
+    }
+
+    virtual ~hoNDArrayMapped()
+    {
+      this->unmap();
+    }
+
+    /// Maps an existing file in the write_nd_array layout
+    void open_file(const std::string& filename, MapMode mode = MAP_READ)
+    {
+      this->close();
+
+      file_.open(filename, mode == MAP_READ_WRITE);
+      mode_ = mode;
+
+      if (file_.size() < sizeof(int)) {
+        this->unmap();
+        throw std::runtime_error("hoNDArrayMapped::open_file: " + filename + " has no header");
+      }
+
+      const int* header = static_cast<const int*>(file_.data());
+      size_t ndim = (size_t)header[0];
+      if (header[0] < 0 || (ndim + 1)*sizeof(int) > file_.size()) {
+        this->unmap();
+        throw std::runtime_error("hoNDArrayMapped::open_file: " + filename + " has an invalid header");
+      }
+
+      std::vector<size_t> dims(ndim);
+      size_t N = ndim ? 1 : 0;
+      for (size_t i = 0; i < ndim; i++) {
+        dims[i] = (size_t)header[i + 1];
+        N *= dims[i];
+      }
+
+      header_bytes_ = (ndim + 1)*sizeof(int);
+      if (header_bytes_ + N*sizeof(T) > file_.size()) {
+        this->unmap();
+        throw std::runtime_error("hoNDArrayMapped::open_file: " + filename + " is shorter than its header says");
+      }
+
+      this->attach(dims);
+    }
+
+    /// Creates (or truncates) a file for an array of the given dimensions and maps it read-write
+    void create_file(const std::string& filename, const std::vector<size_t>& dimensions)
+    {
+      this->close();
+
+      size_t N = dimensions.empty() ? 0 : 1;
+      for (size_t i = 0; i < dimensions.size(); i++) N *= dimensions[i];
+
+      size_t header_bytes = (dimensions.size() + 1)*sizeof(int);
+      file_.create(filename, header_bytes + N*sizeof(T));
+      mode_ = MAP_READ_WRITE;
+
+      int* header = static_cast<int*>(file_.data());
+      header[0] = (int)dimensions.size();
+      for (size_t i = 0; i < dimensions.size(); i++) header[i + 1] = (int)dimensions[i];
+
+      header_bytes_ = header_bytes;
+      std::vector<size_t> dims(dimensions);
+      this->attach(dims);
+    }
+
+    /**
+       Tells the kernel how the elements [first, first+count) will be accessed, all of them for count == 0.
+       ADVISE_DONTNEED releases the pages of the range; in MAP_READ mode local changes to them are lost.
+     */
+    void advise(Advice a, size_t first = 0, size_t count = 0)
+    {
+      if (!file_.data()) return;
+
+      size_t N = this->get_number_of_elements();
+      if (first >= N) return;
+      if (count == 0 || first + count > N) count = N - first;
+
+      file_.advise(static_cast<hoNDArrayFileMapping::Advice>(a), header_bytes_ + first*sizeof(T), count*sizeof(T));
+    }
+
+    /// Writes changed pages back to the file (MAP_READ_WRITE only)
+    void flush(bool async = false)
+    {
+      if (!file_.data() || mode_ != MAP_READ_WRITE) return;
+      file_.flush(async);
+    }
+
+    /// Flushes and unmaps the file, the array becomes empty
+    void close()
+    {
+      if (!file_.data()) return;
+      this->flush();
+      this->unmap();
+    }
+
+    bool is_mapped() const { return file_.data() != 0 && this->data_ == this->mapped_data(); }
+
+    MapMode mode() const { return mode_; }
+
+    const std::string& filename() const { return file_.filename(); }
+
+  protected:
+
+    hoNDArrayFileMapping file_;
+    size_t header_bytes_;
+    MapMode mode_;
+
+    T* mapped_data() const
+    {
+      return file_.data() ? reinterpret_cast<T*>(static_cast<char*>(file_.data()) + header_bytes_) : 0;
+    }
+
+    void attach(std::vector<size_t>& dims)
+    {
+      if (header_bytes_ % alignof(T) != 0) {
+        std::string f(file_.filename());
+        this->unmap();
+        throw std::runtime_error("hoNDArrayMapped: data in " + f + " is not aligned for this element type");
+      }
+
+      if (dims.empty()) {
+        this->detach();
+      } else {
+        BaseClass::create(dims, this->mapped_data(), false);
+      }
+    }
+
+    /// Makes the array empty without freeing the borrowed data
+    void detach()
+    {
+      this->data_ = 0;
+      this->elements_ = 0;
+      this->delete_data_on_destruct_ = true;
+      this->dimensions_.clear();
+      this->offsetFactors_.clear();
+    }
+
+    void unmap()
+    {
+      if (!file_.data()) return;
+
+      if (this->data_ == this->mapped_data()) {
+        this->detach();
+      }
+
+      file_.unmap();
+      header_bytes_ = 0;
+    }
+
+  private:
+
+    // the mapping is owned by one array
+    hoNDArrayMapped(const hoNDArrayMapped<T>&);
+    hoNDArrayMapped<T>& operator=(const hoNDArrayMapped<T>&);
+  };
+}
@@ -0,0 +1,345 @@
+/** \file   hoNDArrayMemoryPool.h
+    \brief  Size-classed slab pool for hoNDArray data buffers.
+
+            Buffers are carved out of large slabs and recycled through per size class free lists,
+            so repeated allocation of equally sized arrays (e.g. one readout per acquisition message)
+            does not go to the system allocator in steady state.
+
+            Memory from the pool is handed to an hoNDArray with create(dims, data, true). When the
+            array releases its data, hoNDArray::_deallocate_memory first offers the pointer to the pool,
+            which recognises its own blocks by address; all other pointers are released by the
+            hoNDArrayAllocator as before. Total slab memory is bounded by max_slab_bytes(); beyond that
+            allocate() falls back to the hoNDArrayAllocator.
+
+            Every size class has its own lock, so readers of different acquisition sizes do not
+            contend. Slabs are aligned to and sized in multiples of SLAB_GRANULE, the slab of a pointer
+            is looked up in a page map of granules without taking a lock; every array released in the
+            process passes through deallocate(). A slab whose blocks are all free again is given back
+            to the system while the free lists hold more than free_high_water_bytes().
+*/
+
+#pragma once
+
+#include "hoNDArrayAllocator.h"
+#include "GadgetronMetrics.h"
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+
+namespace Gadgetron{
+
+  class hoNDArrayMemoryPool
+  {
+  public:
+
+    enum
+    {
+      MIN_BLOCK_SIZE_LOG2 = 12,     // 4 KB
+      MAX_BLOCK_SIZE_LOG2 = 24,     // 16 MB
+      NUMBER_OF_CLASSES = MAX_BLOCK_SIZE_LOG2 - MIN_BLOCK_SIZE_LOG2 + 1
+    };
+
+    static const size_t DEFAULT_SLAB_SIZE = size_t(4) << 20;
+    static const size_t DEFAULT_MAX_SLAB_BYTES = size_t(1) << 30;
+    static const size_t DEFAULT_FREE_HIGH_WATER_BYTES = size_t(256) << 20;
+
+    /// Alignment and size unit of the slabs, one page map entry each
+    static const size_t SLAB_GRANULE = DEFAULT_SLAB_SIZE;
+
+    static hoNDArrayMemoryPool& instance()
+    {
+      static hoNDArrayMemoryPool pool;
+      return pool;
+    }
+
+    /// Allocate a buffer for n elements of type T
+    template <typename T> T* allocate(size_t n)
+    {
+      return reinterpret_cast<T*>(this->allocate_bytes(n*sizeof(T)));
+    }
+
+    /// Allocate a buffer of at least nbytes; falls back to the hoNDArrayAllocator for sizes outside the size classes
+    void* allocate_bytes(size_t nbytes)
+    {
+      size_t c = size_class(nbytes);
+      if (c >= NUMBER_OF_CLASSES) {
+        return hoNDArrayAllocator::instance().allocate(nbytes);
+      }
+
+      SizeClass& sc = classes_[c];
+      std::lock_guard<std::mutex> guard(sc.mutex);
+
+      if (sc.free_list.empty() && !this->add_slab(c)) {
+        return hoNDArrayAllocator::instance().allocate(nbytes);
+      }
+
+      char* block = sc.free_list.back();
+      sc.free_list.pop_back();
+      this->find_slab(block)->used++;
+      free_bytes_.fetch_sub(block_size(c), std::memory_order_relaxed);
+
+      GadgetronMemoryTracker::instance().allocated(block, block_size(c), GadgetronMemoryAccount::HOST);
+      return block;
+    }
+
+    /**
+       Return a buffer to the pool.
+       @return false if the pointer does not belong to the pool, the caller must then release it itself
+     */
+    bool deallocate(void* ptr)
+    {
+      if (!ptr || !has_slabs_.load(std::memory_order_acquire)) return false;
+
+      char* p = reinterpret_cast<char*>(ptr);
+
+      //The slab of a block in use cannot be released, the lookup needs no lock
+      Slab* slab = this->find_slab(p);
+      if (!slab) return false;
+
+      size_t c = slab->size_class;
+      SizeClass& sc = classes_[c];
+      std::lock_guard<std::mutex> guard(sc.mutex);
+
+      sc.free_list.push_back(p);
+      GadgetronMemoryTracker::instance().released(p);
+      size_t free_bytes = free_bytes_.fetch_add(block_size(c), std::memory_order_relaxed) + block_size(c);
+
+      if (--slab->used == 0 && free_bytes > free_high_water_bytes_.load(std::memory_order_relaxed)) {
+        this->release_slab(slab);
+      }
+      return true;
+    }
+
+    /// Upper limit of the memory reserved for slabs
+    size_t max_slab_bytes() const
+    {
+      return max_slab_bytes_.load(std::memory_order_relaxed);
+    }
+
+    void set_max_slab_bytes(size_t b)
+    {
+      max_slab_bytes_.store(b, std::memory_order_relaxed);
+    }
+
+    /// Free list memory above which empty slabs are given back to the system
+    size_t free_high_water_bytes() const
+    {
+      return free_high_water_bytes_.load(std::memory_order_relaxed);
+    }
+
+    void set_free_high_water_bytes(size_t b)
+    {
+      free_high_water_bytes_.store(b, std::memory_order_relaxed);
+    }
+
+    /// Memory currently reserved for slabs
+    size_t slab_bytes() const
+    {
+      return slab_bytes_.load(std::memory_order_relaxed);
+    }
+
+    /// Memory currently held in free lists
+    size_t free_bytes() const
+    {
+      return free_bytes_.load(std::memory_order_relaxed);
+    }
+
+    static size_t block_size(size_t c)
+    {
+      return size_t(1) << (c + MIN_BLOCK_SIZE_LOG2);
+    }
+
+    /// Size class of a request, NUMBER_OF_CLASSES if it is too large for the pool
+    static size_t size_class(size_t nbytes)
+    {
+      size_t c = 0;
+      while (c < NUMBER_OF_CLASSES && block_size(c) < nbytes) c++;
+      return c;
+    }
+
+  protected:
+
+    struct Slab
+    {
+      char* start;
+      size_t bytes;
+      void* allocation;  //What the hoNDArrayAllocator returned, start is aligned within it
+      size_t size_class;
+      size_t used;       //Blocks handed out, guarded by the lock of the size class
+    };
+
+    struct SizeClass
+    {
+      std::mutex mutex;
+      std::vector<char*> free_list;
+    };
+
+    //Page map of the slab granules, two levels cover 48 bit addresses
+    enum
+    {
+      GRANULE_LOG2 = 22,
+      LEAF_BITS = 13,
+      ROOT_BITS = 48 - GRANULE_LOG2 - LEAF_BITS
+    };
+
+    struct Leaf
+    {
+      std::atomic<Slab*> slabs[size_t(1) << LEAF_BITS];
+    };
+
+    hoNDArrayMemoryPool()
+      : max_slab_bytes_(DEFAULT_MAX_SLAB_BYTES)
+      , free_high_water_bytes_(DEFAULT_FREE_HIGH_WATER_BYTES)
+      , slab_bytes_(0)
+      , free_bytes_(0)
+      , has_slabs_(false)
+    {
+      static_assert((size_t(1) << GRANULE_LOG2) == SLAB_GRANULE, "one page map entry per slab granule");
+
+      for (size_t r = 0; r < (size_t(1) << ROOT_BITS); r++) root_[r].store(0, std::memory_order_relaxed);
+
+      GadgetronMetrics::instance().add_collector("host_memory_pool", [this](std::ostream& os) {
+        GadgetronMetrics::write_header(os, "gadgetron_host_memory_pool_slab_bytes", "Memory reserved for slabs of the hoNDArray memory pool", "gauge");
+        GadgetronMetrics::write_sample(os, "gadgetron_host_memory_pool_slab_bytes", "", this->slab_bytes());
+        GadgetronMetrics::write_header(os, "gadgetron_host_memory_pool_free_bytes", "Memory held in the free lists of the hoNDArray memory pool", "gauge");
+        GadgetronMetrics::write_sample(os, "gadgetron_host_memory_pool_free_bytes", "", this->free_bytes());
+      });
+    }
+
+    ~hoNDArrayMemoryPool()
+    {
+      GadgetronMetrics::instance().remove_collector("host_memory_pool");
+      //Slabs are intentionally not released; arrays with pooled memory may outlive static destruction
+    }
+
+    hoNDArrayMemoryPool(const hoNDArrayMemoryPool&);
+    hoNDArrayMemoryPool& operator=(const hoNDArrayMemoryPool&);
+
+    Slab* find_slab(const char* p) const
+    {
+      uintptr_t g = reinterpret_cast<uintptr_t>(p) >> GRANULE_LOG2;
+      if (g >> (ROOT_BITS + LEAF_BITS)) return 0;
+
+      Leaf* leaf = root_[g >> LEAF_BITS].load(std::memory_order_acquire);
+      if (!leaf) return 0;
+      return leaf->slabs[g & ((uintptr_t(1) << LEAF_BITS) - 1)].load(std::memory_order_acquire);
+    }
+
+    /// Enters or clears the granules of a slab, must be called with map_mutex_ held
+    bool map_slab(Slab* slab, Slab* value)
+    {
+      uintptr_t first = reinterpret_cast<uintptr_t>(slab->start) >> GRANULE_LOG2;
+      uintptr_t last = (reinterpret_cast<uintptr_t>(slab->start) + slab->bytes - 1) >> GRANULE_LOG2;
+      if (last >> (ROOT_BITS + LEAF_BITS)) return false;
+
+      for (uintptr_t g = first; g <= last; g++) {
+        std::atomic<Leaf*>& entry = root_[g >> LEAF_BITS];
+        Leaf* leaf = entry.load(std::memory_order_relaxed);
+        if (!leaf) {
+          if (!value) continue;
+          leaf = new Leaf;
+          for (size_t k = 0; k < (size_t(1) << LEAF_BITS); k++) leaf->slabs[k].store(0, std::memory_order_relaxed);
+          entry.store(leaf, std::memory_order_release);
+        }
+        leaf->slabs[g & ((uintptr_t(1) << LEAF_BITS) - 1)].store(value, std::memory_order_release);
+      }
+      return true;
+    }
+
+    /// Must be called with the lock of size class c held
+    bool add_slab(size_t c)
+    {
+      size_t bsize = block_size(c);
+      size_t nblocks = (bsize >= DEFAULT_SLAB_SIZE) ? 1 : DEFAULT_SLAB_SIZE/bsize;
+      size_t ssize = nblocks*bsize;
+
+      //Reserve the budget first, the size classes add slabs concurrently
+      size_t reserved = slab_bytes_.fetch_add(ssize, std::memory_order_relaxed);
+      if (reserved + ssize > max_slab_bytes_.load(std::memory_order_relaxed)) {
+        slab_bytes_.fetch_sub(ssize, std::memory_order_relaxed);
+        return false;
+      }
+
+      //A granule must not be shared with other memory. Where the allocator does not align
+      //(Windows keeps the malloc alignment) the slab is aligned within a larger allocation.
+      hoNDArrayAllocator& allocator = hoNDArrayAllocator::instance();
+      void* allocation = allocator.allocate_untracked(ssize, hoNDArrayAllocator::Policy(SLAB_GRANULE));
+      char* start = reinterpret_cast<char*>(allocation);
+      if (allocation && reinterpret_cast<uintptr_t>(allocation) % SLAB_GRANULE != 0) {
+        allocator.deallocate_untracked(allocation);
+        allocation = allocator.allocate_untracked(ssize + SLAB_GRANULE, hoNDArrayAllocator::Policy(hoNDArrayAllocator::DEFAULT_ALIGNMENT));
+        uintptr_t a = reinterpret_cast<uintptr_t>(allocation);
+        start = reinterpret_cast<char*>((a + SLAB_GRANULE - 1) & ~uintptr_t(SLAB_GRANULE - 1));
+      }
+
+      if (!allocation) {
+        slab_bytes_.fetch_sub(ssize, std::memory_order_relaxed);
+        return false;
+      }
+
+      Slab* slab = new Slab;
+      slab->start = start;
+      slab->bytes = ssize;
+      slab->allocation = allocation;
+      slab->size_class = c;
+      slab->used = 0;
+
+      {
+        std::lock_guard<std::mutex> guard(map_mutex_);
+        if (!this->map_slab(slab, slab)) {
+          allocator.deallocate_untracked(allocation);
+          delete slab;
+          slab_bytes_.fetch_sub(ssize, std::memory_order_relaxed);
+          return false;
+        }
+      }
+
+      std::vector<char*>& free_list = classes_[c].free_list;
+      free_list.reserve(free_list.size() + nblocks);
+      for (size_t b = nblocks; b > 0; b--) {
+        free_list.push_back(start + (b-1)*bsize);
+      }
+      free_bytes_.fetch_add(ssize, std::memory_order_relaxed);
+
+      has_slabs_.store(true, std::memory_order_release);
+      return true;
+    }
+
+    /// Gives an empty slab back to the system, must be called with the lock of its size class held
+    void release_slab(Slab* slab)
+    {
+      std::vector<char*>& free_list = classes_[slab->size_class].free_list;
+      char* start = slab->start;
+      char* end = slab->start + slab->bytes;
+      free_list.erase(std::remove_if(free_list.begin(), free_list.end(),
+                                     [start, end](char* b) { return b >= start && b < end; }),
+                      free_list.end());
+      free_bytes_.fetch_sub(slab->bytes, std::memory_order_relaxed);
+
+      {
+        std::lock_guard<std::mutex> guard(map_mutex_);
+        this->map_slab(slab, 0);
+      }
+
+      hoNDArrayAllocator::instance().deallocate_untracked(slab->allocation);
+      slab_bytes_.fetch_sub(slab->bytes, std::memory_order_relaxed);
+      delete slab;
+    }
+
+    SizeClass classes_[NUMBER_OF_CLASSES];
+
+    std::mutex map_mutex_;
+    std::atomic<Leaf*> root_[size_t(1) << ROOT_BITS];
+
+    std::atomic<size_t> max_slab_bytes_;
+    std::atomic<size_t> free_high_water_bytes_;
+    std::atomic<size_t> slab_bytes_;
+    std::atomic<size_t> free_bytes_;
+    std::atomic<bool> has_slabs_;
+  };
+}
@@ -0,0 +1,253 @@
+/** \file   hoNDArrayScratch.h
+    \brief  Thread local scratch arena for short lived temporary arrays.
+
+            Every thread owns an arena of large chunks, memory is handed out by advancing an offset
+            and given back all at once by rewinding the arena to an earlier mark. Nothing is locked and,
+            once the chunks have been touched, nothing is page faulted either, which makes the arena
+            suitable for the per slice and per OpenMP thread temporaries of the reconstruction code.
+
+            Temporaries are created inside a hoNDArrayScratchScope, which rewinds the arena of the
+            calling thread when it ends:
+
+              {
+                hoNDArrayScratchScope scratch;
+
+                hoNDArray<T> buf;
+                hoNDArrayScratch::instance().create(buf, RO, E1);
+                ...
+              }
+
+            The arrays do not own their memory (create(dims, data, false)); they must not be used
+            after the scope has ended. Scopes nest. When the outermost scope of a thread ends, chunks
+            beyond max_retained_bytes() are returned to the hoNDArrayAllocator.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+#include "hoMatrix.h"
+#include "hoNDArrayAllocator.h"
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+namespace Gadgetron{
+
+  class hoNDArrayScratch
+  {
+  public:
+
+    enum
+    {
+      ALIGNMENT = 64,
+      DEFAULT_CHUNK_SIZE = 16 << 20,
+      DEFAULT_MAX_RETAINED_BYTES = 256 << 20
+    };
+
+    struct Mark
+    {
+      size_t chunk;
+      size_t offset;
+    };
+
+    /// Arena of the calling thread
+    static hoNDArrayScratch& instance()
+    {
+      static thread_local hoNDArrayScratch scratch;
+      return scratch;
+    }
+
+    /// Buffer of at least nbytes, aligned to ALIGNMENT
+    void* allocate_bytes(size_t nbytes)
+    {
+      nbytes = round_up(nbytes == 0 ? 1 : nbytes, ALIGNMENT);
+
+      while (current_ < chunks_.size()) {
+        Chunk& c = chunks_[current_];
+        if (c.size - offset_ >= nbytes) {
+          char* ptr = c.data + offset_;
+          offset_ += nbytes;
+          used_ += nbytes;
+          if (used_ > peak_) peak_ = used_;
+          return ptr;
+        }
+
+        //Too small for this request, the rest of the chunk is reused after the next rewind
+        used_ += c.size - offset_;
+        current_++;
+        offset_ = 0;
+      }
+
+      Chunk c;
+      c.size = round_up(nbytes > DEFAULT_CHUNK_SIZE ? nbytes : (size_t)DEFAULT_CHUNK_SIZE, hoNDArrayAllocator::DEFAULT_ALIGNMENT);
+      c.data = reinterpret_cast<char*>(hoNDArrayAllocator::instance().allocate_untracked(c.size, hoNDArrayAllocator::instance().policy()));
+      if (!c.data) throw std::bad_alloc();
+
+      chunks_.push_back(c);
+      reserved_ += c.size;
+
+      current_ = chunks_.size() - 1;
+      offset_ = nbytes;
+      used_ += nbytes;
+      if (used_ > peak_) peak_ = used_;
+      return c.data;
+    }
+
+    template <typename T> T* allocate(size_t n)
+    {
+      return reinterpret_cast<T*>(this->allocate_bytes(n*sizeof(T)));
+    }
+
+    /// Creates an array on scratch memory, the array does not own the memory
+    template <typename T> void create(hoNDArray<T>& a, std::vector<size_t>& dimensions)
+    {
+      size_t n = 1;
+      for (size_t i = 0; i < dimensions.size(); i++) n *= dimensions[i];
+      a.create(dimensions, this->allocate<T>(n), false);
+    }
+
+    template <typename T> void create(hoNDArray<T>& a, size_t len)
+    {
+      a.create(len, this->allocate<T>(len), false);
+    }
+
+    template <typename T> void create(hoNDArray<T>& a, size_t sx, size_t sy)
+    {
+      a.create(sx, sy, this->allocate<T>(sx*sy), false);
+    }
+
+    template <typename T> void create(hoNDArray<T>& a, size_t sx, size_t sy, size_t sz)
+    {
+      a.create(sx, sy, sz, this->allocate<T>(sx*sy*sz), false);
+    }
+
+    template <typename T> void create(hoMatrix<T>& m, size_t rows, size_t cols)
+    {
+      m.createMatrix(rows, cols, this->allocate<T>(rows*cols), false);
+    }
+
+    Mark mark() const
+    {
+      Mark m;
+      m.chunk = current_;
+      m.offset = offset_;
+      return m;
+    }
+
+    /// Gives back everything allocated after the mark was taken
+    void rewind(const Mark& m)
+    {
+      if (m.chunk > current_ || (m.chunk == current_ && m.offset >= offset_)) return;
+
+      size_t released = offset_;
+      for (size_t c = m.chunk; c < current_; c++) released += chunks_[c].size;
+      released -= m.offset;
+
+      used_ -= released;
+      current_ = m.chunk;
+      offset_ = m.offset;
+    }
+
+    /// Gives back all scratch memory of the thread
+    void reset()
+    {
+      Mark m;
+      m.chunk = 0;
+      m.offset = 0;
+      this->rewind(m);
+      this->trim();
+    }
+
+    /// Bytes currently handed out, including the unused tails of skipped chunks
+    size_t used_bytes() const { return used_; }
+
+    /// Largest used_bytes() seen by this thread
+    size_t peak_bytes() const { return peak_; }
+
+    /// Bytes held in chunks
+    size_t reserved_bytes() const { return reserved_; }
+
+    size_t max_retained_bytes() const { return max_retained_; }
+    void set_max_retained_bytes(size_t b) { max_retained_ = b; }
+
+  protected:
+    friend class hoNDArrayScratchScope;
+
+    struct Chunk
+    {
+      char* data;
+      size_t size;
+    };
+
+    hoNDArrayScratch()
+      : current_(0)
+      , offset_(0)
+      , used_(0)
+      , peak_(0)
+      , reserved_(0)
+      , max_retained_(DEFAULT_MAX_RETAINED_BYTES)
+      , depth_(0)
+    {
+    }
+
+    ~hoNDArrayScratch()
+    {
+      for (size_t c = 0; c < chunks_.size(); c++) {
+        hoNDArrayAllocator::instance().deallocate_untracked(chunks_[c].data);
+      }
+    }
+
+    hoNDArrayScratch(const hoNDArrayScratch&);
+    hoNDArrayScratch& operator=(const hoNDArrayScratch&);
+
+    /// Releases unused chunks at the end of the arena while more than max_retained_bytes() is reserved
+    void trim()
+    {
+      size_t in_use = (current_ == 0 && offset_ == 0) ? 0 : current_ + 1;
+      while (reserved_ > max_retained_ && chunks_.size() > in_use) {
+        hoNDArrayAllocator::instance().deallocate_untracked(chunks_.back().data);
+        reserved_ -= chunks_.back().size;
+        chunks_.pop_back();
+      }
+    }
+
+    static size_t round_up(size_t n, size_t m)
+    {
+      return ((n + m - 1) / m) * m;
+    }
+
+    std::vector<Chunk> chunks_;
+    size_t current_;
+    size_t offset_;
+    size_t used_;
+    size_t peak_;
+    size_t reserved_;
+    size_t max_retained_;
+    size_t depth_;
+  };
+
+  /**
+     Rewinds the scratch arena of the calling thread to its state at construction
+   */
+  class hoNDArrayScratchScope
+  {
+  public:
+    hoNDArrayScratchScope()
+      : scratch_(hoNDArrayScratch::instance())
+      , mark_(scratch_.mark())
+    {
+      scratch_.depth_++;
+    }
+
+    ~hoNDArrayScratchScope()
+    {
+      scratch_.rewind(mark_);
+      if (--scratch_.depth_ == 0) scratch_.trim();
+    }
+
+  protected:
+    hoNDArrayScratch& scratch_;
+    hoNDArrayScratch::Mark mark_;
+  };
+}
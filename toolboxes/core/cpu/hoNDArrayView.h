@@ -0,0 +1,270 @@
+/** \file   hoNDArrayView.h
+    \brief  Non-owning strided view of a sub-block of a hoNDArray.
+
+            A view is a data pointer, the sizes of its dimensions and the distance in elements between
+            neighbouring entries of every dimension. Views are cheap to create and copy; selecting a
+            coil, an N/S range or a slice of a [RO E1 E2 CHA N S SLC] buffer does not touch the data:
+
+              hoNDArrayView< std::complex<float> > v(data);      // whole array
+              v = v.slice(6, slc).range(4, n, 1);                // [RO E1 E2 CHA 1 S] of one slice
+
+            The memory stays owned by the array the view was made from and must outlive the view.
+
+            Most views of such buffers consist of a few large contiguous blocks (the leading packed
+            dimensions, e.g. RO x E1 x E2 x CHA). for_each_block() hands these blocks out as borrowed
+            hoNDArrays, which is how the elementwise functions (hoNDArrayView_math.h) and hoNDFFT work
+            on views without copying.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+
+namespace Gadgetron{
+
+  template <typename T> class hoNDArrayView
+  {
+  public:
+
+    typedef T element_type;
+
+    hoNDArrayView() : data_(0)
+    {
+    }
+
+    /// View of a whole array
+    hoNDArrayView(hoNDArray<T>& a) : data_(a.get_data_ptr())
+    {
+      a.get_dimensions(dimensions_);
+      strides_.resize(dimensions_.size());
+      size_t s = 1;
+      for (size_t d = 0; d < dimensions_.size(); d++) {
+        strides_[d] = s;
+        s *= dimensions_[d];
+      }
+    }
+
+    /// General view, strides are in elements
+    hoNDArrayView(T* data, const std::vector<size_t>& dimensions, const std::vector<size_t>& strides)
+      : data_(data), dimensions_(dimensions), strides_(strides)
+    {
+      if (dimensions_.size() != strides_.size()) {
+        throw std::runtime_error("hoNDArrayView: dimensions and strides differ in length");
+      }
+    }
+
+    T* get_data_ptr() const { return data_; }
+
+    size_t get_number_of_dimensions() const { return dimensions_.size(); }
+
+    size_t get_size(size_t d) const { return d < dimensions_.size() ? dimensions_[d] : 1; }
+
+    size_t get_stride(size_t d) const { return strides_[d]; }
+
+    const std::vector<size_t>& get_dimensions() const { return dimensions_; }
+
+    const std::vector<size_t>& get_strides() const { return strides_; }
+
+    size_t get_number_of_elements() const
+    {
+      if (dimensions_.empty()) return 0;
+      size_t n = 1;
+      for (size_t d = 0; d < dimensions_.size(); d++) n *= dimensions_[d];
+      return n;
+    }
+
+    bool dimensions_equal(const std::vector<size_t>& dims) const
+    {
+      return dims == dimensions_;
+    }
+
+    template <typename S> bool dimensions_equal(const hoNDArrayView<S>& v) const
+    {
+      return v.get_dimensions() == dimensions_;
+    }
+
+    /// Element at a multi-dimensional index
+    T& operator()(const std::vector<size_t>& ind) const
+    {
+      size_t offset = 0;
+      for (size_t d = 0; d < ind.size(); d++) offset += ind[d]*strides_[d];
+      return data_[offset];
+    }
+
+    T& operator()(size_t x, size_t y) const
+    {
+      return data_[x*strides_[0] + y*strides_[1]];
+    }
+
+    T& operator()(size_t x, size_t y, size_t z) const
+    {
+      return data_[x*strides_[0] + y*strides_[1] + z*strides_[2]];
+    }
+
+    /// Element at a linear index, counted in the order of a packed array of the same dimensions
+    T& at(size_t i) const
+    {
+      size_t offset = 0;
+      for (size_t d = 0; d < dimensions_.size(); d++) {
+        offset += (i % dimensions_[d])*strides_[d];
+        i /= dimensions_[d];
+      }
+      return data_[offset];
+    }
+
+    /// Dimension d restricted to [start, start+len)
+    hoNDArrayView<T> range(size_t d, size_t start, size_t len) const
+    {
+      if (d >= dimensions_.size() || start + len > dimensions_[d]) {
+        throw std::runtime_error("hoNDArrayView::range: out of bounds");
+      }
+      hoNDArrayView<T> v(*this);
+      v.data_ += start*strides_[d];
+      v.dimensions_[d] = len;
+      return v;
+    }
+
+    /// Entry index of dimension d, the dimension is removed
+    hoNDArrayView<T> slice(size_t d, size_t index) const
+    {
+      if (d >= dimensions_.size() || index >= dimensions_[d]) {
+        throw std::runtime_error("hoNDArrayView::slice: out of bounds");
+      }
+      hoNDArrayView<T> v(*this);
+      v.data_ += index*strides_[d];
+      v.dimensions_.erase(v.dimensions_.begin() + d);
+      v.strides_.erase(v.strides_.begin() + d);
+      return v;
+    }
+
+    /// Number of leading dimensions laid out as in a packed array
+    size_t contiguous_dimensions() const
+    {
+      size_t s = 1;
+      size_t d = 0;
+      while (d < dimensions_.size() && (strides_[d] == s || dimensions_[d] == 1)) {
+        s *= dimensions_[d];
+        d++;
+      }
+      return d;
+    }
+
+    bool is_contiguous() const
+    {
+      return this->contiguous_dimensions() == dimensions_.size();
+    }
+
+    /**
+       Wraps the view in an array borrowing its memory.
+       @return false if the view is not contiguous, a is not changed then
+     */
+    bool as_array(hoNDArray<T>& a) const
+    {
+      if (!this->is_contiguous()) return false;
+      std::vector<size_t> dims(dimensions_);
+      a.create(dims, data_, false);
+      return true;
+    }
+
+    /**
+       Calls f(block) for every contiguous block of the view; block borrows the memory and has the
+       leading min(k, contiguous_dimensions()) dimensions of the view, all of them for k == 0.
+     */
+    template <typename F> void for_each_block(F f, size_t k = 0) const
+    {
+      size_t nc = this->contiguous_dimensions();
+      if (k == 0 || k > nc) k = nc;
+
+      std::vector<size_t> block_dims(dimensions_.begin(), dimensions_.begin() + k);
+      if (block_dims.empty()) block_dims.push_back(1);
+
+      hoNDArray<T> block;
+      std::vector<size_t> outer;
+      while (this->next_block(k, outer)) {
+        block.create(block_dims, data_ + this->outer_offset(k, outer), false);
+        f(block);
+      }
+    }
+
+    /// Copies the view into a packed array of the same dimensions
+    void copy_to(hoNDArray<T>& a) const
+    {
+      std::vector<size_t> dims(dimensions_);
+      a.create(dims);
+
+      size_t k = this->contiguous_dimensions();
+      size_t len = this->block_length(k);
+
+      T* pA = a.begin();
+      std::vector<size_t> outer;
+      while (this->next_block(k, outer)) {
+        memcpy(pA, data_ + this->outer_offset(k, outer), len*sizeof(T));
+        pA += len;
+      }
+    }
+
+    /// Copies a packed array of the same number of elements into the view
+    void copy_from(const hoNDArray<T>& a) const
+    {
+      if (a.get_number_of_elements() != this->get_number_of_elements()) {
+        throw std::runtime_error("hoNDArrayView::copy_from: number of elements differs");
+      }
+
+      size_t k = this->contiguous_dimensions();
+      size_t len = this->block_length(k);
+
+      const T* pA = a.begin();
+      std::vector<size_t> outer;
+      while (this->next_block(k, outer)) {
+        memcpy(data_ + this->outer_offset(k, outer), pA, len*sizeof(T));
+        pA += len;
+      }
+    }
+
+    /// Number of elements of a block of the leading k dimensions
+    size_t block_length(size_t k) const
+    {
+      size_t n = 1;
+      for (size_t d = 0; d < k; d++) n *= dimensions_[d];
+      return n;
+    }
+
+    /// Offset of the block with index outer over dimensions k and above
+    size_t outer_offset(size_t k, const std::vector<size_t>& outer) const
+    {
+      size_t offset = 0;
+      for (size_t d = k; d < dimensions_.size(); d++) offset += outer[d-k]*strides_[d];
+      return offset;
+    }
+
+    /**
+       Steps through the blocks of the leading k dimensions. Start with an empty outer index;
+       returns false after the last block.
+     */
+    bool next_block(size_t k, std::vector<size_t>& outer) const
+    {
+      if (this->get_number_of_elements() == 0) return false;
+
+      if (outer.empty()) {
+        outer.assign(dimensions_.size() - k + 1, 0);
+        return true;
+      }
+
+      for (size_t d = k; d < dimensions_.size(); d++) {
+        if (++outer[d-k] < dimensions_[d]) return true;
+        outer[d-k] = 0;
+      }
+      return false;
+    }
+
+  protected:
+
+    T* data_;
+    std::vector<size_t> dimensions_;
+    std::vector<size_t> strides_;
+  };
+}
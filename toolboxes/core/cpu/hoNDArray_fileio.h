@@ -3,6 +3,7 @@
 #pragma once
 
 #include "hoNDArray.h"
+#include "hoNDArrayMapped.h"
 
 #include <iostream>
 #include <fstream>
@@ -62,5 +63,21 @@ template <class T> boost::shared_ptr< hoNDArray<T> > read_nd_array(const char* f
   
   return out;
 }
+
+/// Maps a file written by write_nd_array instead of reading it, see hoNDArrayMapped
+template <class T> boost::shared_ptr< hoNDArrayMapped<T> > map_nd_array(const char* filename, bool writable = false)
+{
+  boost::shared_ptr< hoNDArrayMapped<T> > out( new hoNDArrayMapped<T>() );
+
+  try {
+    out->open_file(filename, writable ? hoNDArrayMapped<T>::MAP_READ_WRITE : hoNDArrayMapped<T>::MAP_READ);
+  }
+  catch (const std::exception& e) {
+    GDEBUG_STREAM("ERROR: Cannot map file " << filename << " : " << e.what() << std::endl);
+    return boost::shared_ptr< hoNDArrayMapped<T> >();
+  }
+
+  return out;
+}
 }
 #endif
@@ -3,6 +3,9 @@
 #include "hoNDArray.h"
 #include "vector_td_utilities.h"
 
+#include <algorithm>
+#include <cstring>
+
 #ifdef USE_OMP
 #include <omp.h>
 #endif
@@ -65,6 +68,153 @@ namespace Gadgetron {
     size_t current_idx_;
   };
 
+  /**
+     Copies in, of dimensions dims, to out with output dimension k taken from input dimension order[k];
+     order must be a complete permutation.
+
+     Dimensions of size 1 are dropped and dimensions that stay neighbours are merged first. If the
+     input's first dimension stays in front, it is copied as one block (memcpy); what is left is a
+     transpose of the input's first remaining dimension with the one that becomes first in the output,
+     looped over the other dimensions. That transpose is done in cache sized tiles, and the tiles of
+     all outer positions are shared out over the OpenMP threads. 2D transposes and swaps of
+     neighbouring dimensions are the single-tile-loop cases of this.
+   */
+  template<class T> void
+  permute_tiled(const T* in, T* out, const std::vector<size_t>& dims, const std::vector<size_t>& order)
+  {
+    const size_t nDim = dims.size();
+
+    size_t N = 1;
+    for (size_t i = 0; i < nDim; i++) N *= dims[i];
+    if (N == 0) return;
+
+    // output dimensions as [first input dimension, number of input dimensions] groups,
+    // leaving out size 1 dimensions and merging the neighbours
+    std::vector<size_t> group_start, group_len;
+    for (size_t k = 0; k < nDim; k++) {
+      size_t d = order[k];
+      if (dims[d] == 1) continue;
+      if (!group_start.empty()) {
+        size_t g = group_start.size() - 1;
+        size_t next = group_start[g] + group_len[g];
+        while (next < d && dims[next] == 1) next++;
+        if (next == d) {
+          group_len[g] = d - group_start[g] + 1;
+          continue;
+        }
+      }
+      group_start.push_back(d);
+      group_len.push_back(1);
+    }
+
+    const size_t nG = group_start.size();
+
+    // reduced problem: rd are the input dimensions, output dimension k is input dimension ro[k]
+    std::vector<size_t> rank(nG), rd(nG, 1), ro(nG);
+    for (size_t g = 0; g < nG; g++) {
+      rank[g] = 0;
+      for (size_t h = 0; h < nG; h++) {
+        if (group_start[h] < group_start[g]) rank[g]++;
+      }
+      ro[g] = rank[g];
+      for (size_t i = group_start[g]; i < group_start[g] + group_len[g]; i++) rd[rank[g]] *= dims[i];
+    }
+
+    bool identity = true;
+    for (size_t g = 0; g < nG; g++) {
+      if (ro[g] != g) identity = false;
+    }
+
+    if (identity) {
+      memcpy(out, in, sizeof(T)*N);
+      return;
+    }
+
+    // a first input dimension that stays first is copied as a block of L elements
+    size_t L = 1;
+    if (ro[0] == 0) {
+      L = rd[0];
+      rd.erase(rd.begin());
+      ro.erase(ro.begin());
+      for (size_t k = 0; k < ro.size(); k++) ro[k]--;
+    }
+
+    const size_t nR = rd.size();
+
+    std::vector<size_t> in_stride(nR), out_stride(nR);
+    size_t s = L;
+    for (size_t j = 0; j < nR; j++) {
+      in_stride[j] = s;
+      s *= rd[j];
+    }
+    s = L;
+    for (size_t k = 0; k < nR; k++) {
+      out_stride[ro[k]] = s;
+      s *= rd[ro[k]];
+    }
+
+    // transpose of input dimension 0 with input dimension a, the first of the output
+    const size_t a = ro[0];
+    const size_t n0 = rd[0], na = rd[a];
+    const size_t in_stride_a = in_stride[a];
+    const size_t out_stride_0 = out_stride[0];
+
+    std::vector<size_t> outer_size, outer_in_stride, outer_out_stride;
+    for (size_t j = 1; j < nR; j++) {
+      if (j == a) continue;
+      outer_size.push_back(rd[j]);
+      outer_in_stride.push_back(in_stride[j]);
+      outer_out_stride.push_back(out_stride[j]);
+    }
+    const size_t nOuter = outer_size.size();
+
+    // tile edge, about 128 bytes of blocks per tile row
+    size_t B = 128 / (L*sizeof(T));
+    if (B < 1) B = 1;
+    if (B > 64) B = 64;
+
+    const size_t t0 = (n0 + B - 1) / B;
+    const size_t ta = (na + B - 1) / B;
+    const long long num_tiles = (long long)((N / (L*n0*na)) * t0 * ta);
+
+    long long t;
+#pragma omp parallel for default(none) private(t) shared(in, out, outer_size, outer_in_stride, outer_out_stride) firstprivate(L, n0, na, in_stride_a, out_stride_0, nOuter, B, t0, ta, num_tiles) if (N > 64*1024)
+    for (t = 0; t < num_tiles; t++) {
+      size_t m = (size_t)t;
+      const size_t i0_start = (m % t0) * B; m /= t0;
+      const size_t ia_start = (m % ta) * B; m /= ta;
+
+      size_t offset_in = 0, offset_out = 0;
+      for (size_t j = 0; j < nOuter; j++) {
+        size_t ind = m % outer_size[j];
+        m /= outer_size[j];
+        offset_in += ind*outer_in_stride[j];
+        offset_out += ind*outer_out_stride[j];
+      }
+
+      const size_t i0_end = std::min(i0_start + B, n0);
+      const size_t ia_end = std::min(ia_start + B, na);
+
+      if (L == 1) {
+        for (size_t i0 = i0_start; i0 < i0_end; i0++) {
+          const T* pIn = in + offset_in + i0;
+          T* pOut = out + offset_out + i0*out_stride_0;
+          for (size_t ia = ia_start; ia < ia_end; ia++) {
+            pOut[ia] = pIn[ia*in_stride_a];
+          }
+        }
+      } else {
+        for (size_t i0 = i0_start; i0 < i0_end; i0++) {
+          const T* pIn = in + offset_in + i0*L;
+          T* pOut = out + offset_out + i0*out_stride_0;
+          for (size_t ia = ia_start; ia < ia_end; ia++) {
+            memcpy(pOut + ia*L, pIn + ia*in_stride_a, sizeof(T)*L);
+          }
+        }
+      }
+    }
+  }
+
   template<class T> boost::shared_ptr< hoNDArray<T> > shift_dim( hoNDArray<T> *in, int shift )  
   {
     if( in == 0x0 ) {
@@ -156,68 +306,7 @@ namespace Gadgetron {
       }
     }
 
-    T* o = out->get_data_ptr();
-
-    // if memcpy can be used during permute
-    size_t stride = 1;
-    size_t num_dim_memcpy = 0;
-    for (size_t i = 0; i < dim_order_int.size(); i++) {
-        if (dim_order_int[i]==i){
-            stride *= in->get_size(i);
-            num_dim_memcpy = i;
-        }
-        else{
-            break;
-        }
-    }
-
-    if (stride == 1) {
-        // point by point assignment is needed
-        ArrayIterator it(in->get_dimensions().get(), &dim_order_int);
-        for (size_t i = 0; i < in->get_number_of_elements(); i++) {
-            o[i] = in->get_data_ptr()[it.get_current_idx()];
-            it.advance();
-        }
-    }
-    else {
-        // memcpy can be used
-
-        size_t nDim = in->get_number_of_dimensions();
-        size_t num_memcpy = in->get_number_of_elements() / stride;
-
-        if (num_dim_memcpy == nDim - 1){
-            memcpy(out->begin(), in->begin(), in->get_number_of_bytes());
-            return;
-        }
-
-        // for the array index calculation
-        std::vector<size_t> dim_permute(nDim-num_dim_memcpy-1);
-        for (size_t i = num_dim_memcpy+1; i < dim_order_int.size(); i++) {
-            dim_permute[i - num_dim_memcpy - 1] = in->get_size(i);
-        }
-
-        size_t n;
-
-        hoNDArray<T> permuteArray(dim_permute, in->begin(), false);
-
-        // starting index for in and out array for every permute memcpy operation
-        std::vector<size_t> ind_permute_in(dim_permute.size(), 0), ind_in(nDim, 0), ind_out(nDim, 0);
-
-        for (n = 0; n < num_memcpy; n++) {
-            permuteArray.calculate_index(n, ind_permute_in);
-            memcpy(&ind_in[0] + num_dim_memcpy + 1, &ind_permute_in[0], sizeof(size_t)*ind_permute_in.size());
-
-            // permute the indexes
-            for (size_t i = 0; i < nDim; i++) {
-                ind_out[i] = ind_in[dim_order_int[i]];
-            }
-
-            size_t offset_in = in->calculate_offset(ind_in);
-            size_t offset_out = out->calculate_offset(ind_out);
-
-            memcpy(o + offset_out, in->begin() + offset_in, sizeof(T)*stride);
-        }
-    }
+    permute_tiled(in->begin(), out->begin(), *in->get_dimensions(), dim_order_int);
   }
 
   // Expand array to new dimension
@@ -257,6 +257,10 @@ namespace Gadgetron
         virtual T operator()( coord_type x, coord_type y, coord_type z, coord_type s, coord_type p, coord_type r, coord_type a, coord_type q );
         virtual T operator()( coord_type x, coord_type y, coord_type z, coord_type s, coord_type p, coord_type r, coord_type a, coord_type q, coord_type u );
 
+        /// resample the array on a regular grid, pos[d] holds the sampling locations along dimension d
+        /// res has the size [pos[0].size() pos[1].size() ...]; points outside the array are given by the boundary handler
+        void evaluateOnGrid(const std::vector< std::vector<coord_type> >& pos, hoNDArray<T>& res);
+
      protected:
 
         using BaseClass::array_;
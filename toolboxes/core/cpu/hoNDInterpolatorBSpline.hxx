@@ -336,4 +336,56 @@ namespace Gadgetron
             return (*bh_)(anchor[0], anchor[1], anchor[2], anchor[3], anchor[4], anchor[5], anchor[6], anchor[7], anchor[8]);
         }
     }
+
+    template <typename ArrayType, unsigned int D> 
+    void hoNDInterpolatorBSpline<ArrayType, D>::evaluateOnGrid(const std::vector< std::vector<coord_type> >& pos, hoNDArray<T>& res)
+    {
+        GADGET_CHECK_THROW(pos.size()==D);
+        GADGET_CHECK_THROW(bspline_.evaluateBSplineOnGrid(coeff_, order_, derivative_, pos, res));
+
+        // anchors and in-range flags per axis, as in operator()
+        std::vector< std::vector<long long> > anchor(D);
+        std::vector< std::vector<bool> > inRange(D);
+
+        unsigned int ii;
+        bool allInRange = true;
+        for ( ii=0; ii<D; ii++ )
+        {
+            size_t N = pos[ii].size();
+            anchor[ii].resize(N);
+            inRange[ii].resize(N);
+
+            for ( size_t n=0; n<N; n++ )
+            {
+                anchor[ii][n] = static_cast<long long>(std::floor(pos[ii][n]));
+                inRange[ii][n] = (anchor[ii][n]>=0 && anchor[ii][n]<(long long)array_->get_size(ii)-1);
+                if ( !inRange[ii][n] ) allInRange = false;
+            }
+        }
+
+        if ( allInRange ) return;
+
+        std::vector<size_t> dimRes(D);
+        for ( ii=0; ii<D; ii++ ) dimRes[ii] = pos[ii].size();
+
+        std::vector<size_t> ind(D);
+        std::vector<long long> a(D);
+
+        size_t N = res.get_number_of_elements();
+        for ( size_t n=0; n<N; n++ )
+        {
+            size_t r = n;
+            bool in = true;
+            for ( ii=0; ii<D; ii++ )
+            {
+                ind[ii] = r % dimRes[ii];
+                r /= dimRes[ii];
+
+                a[ii] = anchor[ii][ind[ii]];
+                in = in && inRange[ii][ind[ii]];
+            }
+
+            if ( !in ) res(n) = (*bh_)(a);
+        }
+    }
 }
@@ -0,0 +1,288 @@
+/** \file       hoNDInterpolatorStatic.h
+    \brief      N-dimensional nearest neighbour and linear interpolators with static dispatch
+
+                hoNDInterpolator and hoNDBoundaryHandler are called through virtual functions, for every
+                point and for every neighbour of a point near the border. Here the dimension, the order
+                (0 nearest neighbour, 1 linear) and the boundary condition are template parameters, so a
+                loop over points of a concrete hoNDInterpolatorStatic type inlines the whole interpolation.
+
+                The values are those of hoNDInterpolatorNearestNeighbor and hoNDInterpolatorLinear with the
+                hoNDBoundaryHandler of the same boundary condition. The interface is that of hoNDInterpolator,
+                so the function templates of hoNDImage_util take either; see also resampleImage with the
+                interpolator and boundary condition given as enums.
+
+                The kernels are selected by overloading on the order and dimension (no if constexpr in C++14):
+                2D and 3D have their own kernels, other dimensions loop over the 2^D neighbours.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+#include "hoNDImage.h"
+#include "hoNDBoundaryHandler.h"
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+namespace Gadgetron
+{
+    /// maps the index i of a dimension of size n by the boundary condition BC
+    /// returns false if the point takes the fixed value
+    template <GT_BOUNDARY_CONDITION BC> struct hoNDBoundaryPolicy;
+
+    template <> struct hoNDBoundaryPolicy<GT_BOUNDARY_CONDITION_FIXEDVALUE>
+    {
+        static inline bool index(long long& i, long long n) { return (i>=0 && i<n); }
+    };
+
+    template <> struct hoNDBoundaryPolicy<GT_BOUNDARY_CONDITION_BORDERVALUE>
+    {
+        static inline bool index(long long& i, long long n)
+        {
+            if ( i < 0 ) i = 0;
+            else if ( i >= n ) i = n-1;
+            return true;
+        }
+    };
+
+    template <> struct hoNDBoundaryPolicy<GT_BOUNDARY_CONDITION_PERIODIC>
+    {
+        static inline bool index(long long& i, long long n)
+        {
+            if ( i<0 || i>=n )
+            {
+                i %= n;
+                if ( i < 0 ) i += n;
+            }
+            return true;
+        }
+    };
+
+    template <> struct hoNDBoundaryPolicy<GT_BOUNDARY_CONDITION_MIRROR>
+    {
+        static inline bool index(long long& i, long long n)
+        {
+            if ( i < 0 ) i = -i;
+            else if ( i >= n ) i = 2*n-i-2;
+            return true;
+        }
+    };
+
+    /// all interpolation calls are thread-safe
+    template <typename ArrayType, unsigned int D, unsigned int Order, GT_BOUNDARY_CONDITION BC>
+    class hoNDInterpolatorStatic
+    {
+    public:
+
+        static_assert(D >= 1, "hoNDInterpolatorStatic needs at least one dimension");
+        static_assert(Order <= 1, "hoNDInterpolatorStatic supports nearest neighbour (0) and linear (1) interpolation");
+
+        typedef hoNDInterpolatorStatic<ArrayType, D, Order, BC> Self;
+        typedef typename ArrayType::value_type T;
+        typedef typename ArrayType::coord_type coord_type;
+        typedef hoNDBoundaryPolicy<BC> BoundaryPolicy;
+
+        /// v is the value outside the array for the fixed value boundary condition
+        hoNDInterpolatorStatic(T v=T(0)) : data_(NULL), value_(v)
+        {
+            for ( unsigned int d=0; d<D; d++ ) { size_[d] = 0; offset_[d] = 0; }
+        }
+
+        hoNDInterpolatorStatic(ArrayType& a, T v=T(0)) : value_(v) { this->setArray(a); }
+
+        void setArray(ArrayType& a)
+        {
+            data_ = a.begin();
+
+            for ( unsigned int d=0; d<D; d++ )
+            {
+                size_[d] = (long long)a.get_size(d);
+                offset_[d] = (d==0) ? 1 : offset_[d-1]*size_[d-1];
+            }
+        }
+
+        void setFixedValue(T v) { value_ = v; }
+
+        /// access the pixel value, pos has D coordinates
+        inline T operator()( const coord_type* pos ) const
+        {
+            return this->interpolate(pos, std::integral_constant<unsigned int, Order>(), std::integral_constant<unsigned int, D>());
+        }
+
+        inline T operator()( const std::vector<coord_type>& pos ) const { return this->operator()(&pos[0]); }
+
+        /// the coordinates after the first D are ignored, the missing ones are 0
+        inline T operator()( coord_type x ) const { coord_type pos[D+4] = { x }; return this->operator()(pos); }
+        inline T operator()( coord_type x, coord_type y ) const { coord_type pos[D+4] = { x, y }; return this->operator()(pos); }
+        inline T operator()( coord_type x, coord_type y, coord_type z ) const { coord_type pos[D+4] = { x, y, z }; return this->operator()(pos); }
+        inline T operator()( coord_type x, coord_type y, coord_type z, coord_type s ) const { coord_type pos[D+4] = { x, y, z, s }; return this->operator()(pos); }
+
+    protected:
+
+        typedef std::integral_constant<unsigned int, 0> NearestNeighbor;
+        typedef std::integral_constant<unsigned int, 1> Linear;
+
+        /// value at an index, through the boundary condition if it is outside
+        inline T value(const long long* ind) const
+        {
+            size_t offset = 0;
+            for ( unsigned int d=0; d<D; d++ )
+            {
+                long long i = ind[d];
+                if ( !BoundaryPolicy::index(i, size_[d]) ) return value_;
+                offset += (size_t)i*offset_[d];
+            }
+
+            return data_[offset];
+        }
+
+        inline T value(long long x, long long y) const
+        {
+            if ( !BoundaryPolicy::index(x, size_[0]) || !BoundaryPolicy::index(y, size_[1]) ) return value_;
+            return data_[x + y*offset_[1]];
+        }
+
+        inline T value(long long x, long long y, long long z) const
+        {
+            if ( !BoundaryPolicy::index(x, size_[0]) || !BoundaryPolicy::index(y, size_[1]) || !BoundaryPolicy::index(z, size_[2]) ) return value_;
+            return data_[x + y*offset_[1] + z*offset_[2]];
+        }
+
+        template <unsigned int N>
+        inline T interpolate(const coord_type* pos, NearestNeighbor, std::integral_constant<unsigned int, N>) const
+        {
+            long long ind[D];
+            for ( unsigned int d=0; d<D; d++ ) ind[d] = static_cast<long long>(pos[d]+0.5);
+            return this->value(ind);
+        }
+
+        inline T interpolate(const coord_type* pos, Linear, std::integral_constant<unsigned int, 2>) const
+        {
+            long long ix = static_cast<long long>(std::floor(pos[0]));
+            coord_type dx = pos[0] - ix;
+            coord_type dx_prime = coord_type(1.0)-dx;
+
+            long long iy = static_cast<long long>(std::floor(pos[1]));
+            coord_type dy = pos[1] - iy;
+            coord_type dy_prime = coord_type(1.0)-dy;
+
+            T v00, v10, v01, v11;
+
+            if ( ix>=0 && ix<size_[0]-1 && iy>=0 && iy<size_[1]-1 )
+            {
+                const T* data = data_ + ix + iy*offset_[1];
+                v00 = data[0]; v10 = data[1];
+                v01 = data[offset_[1]]; v11 = data[offset_[1]+1];
+            }
+            else
+            {
+                v00 = this->value(ix, iy);   v10 = this->value(ix+1, iy);
+                v01 = this->value(ix, iy+1); v11 = this->value(ix+1, iy+1);
+            }
+
+            return (    (v00   *   dx_prime    *dy_prime
+                    +   v10    *   dx          *dy_prime)
+                    +   (v01   *   dx_prime    *dy
+                    +   v11    *   dx          *dy) );
+        }
+
+        inline T interpolate(const coord_type* pos, Linear, std::integral_constant<unsigned int, 3>) const
+        {
+            long long ix = static_cast<long long>(std::floor(pos[0]));
+            coord_type dx = pos[0] - ix;
+            coord_type dx_prime = coord_type(1.0)-dx;
+
+            long long iy = static_cast<long long>(std::floor(pos[1]));
+            coord_type dy = pos[1] - iy;
+            coord_type dy_prime = coord_type(1.0)-dy;
+
+            long long iz = static_cast<long long>(std::floor(pos[2]));
+            coord_type dz = pos[2] - iz;
+            coord_type dz_prime = coord_type(1.0)-dz;
+
+            T v000, v100, v010, v110, v001, v101, v011, v111;
+
+            if ( ix>=0 && ix<size_[0]-1 && iy>=0 && iy<size_[1]-1 && iz>=0 && iz<size_[2]-1 )
+            {
+                const T* data = data_ + ix + iy*offset_[1] + iz*offset_[2];
+                size_t sx = offset_[1], sxy = offset_[2];
+                v000 = data[0];         v100 = data[1];
+                v010 = data[sx];        v110 = data[sx+1];
+                v001 = data[sxy];       v101 = data[sxy+1];
+                v011 = data[sxy+sx];    v111 = data[sxy+sx+1];
+            }
+            else
+            {
+                v000 = this->value(ix, iy, iz);       v100 = this->value(ix+1, iy, iz);
+                v010 = this->value(ix, iy+1, iz);     v110 = this->value(ix+1, iy+1, iz);
+                v001 = this->value(ix, iy, iz+1);     v101 = this->value(ix+1, iy, iz+1);
+                v011 = this->value(ix, iy+1, iz+1);   v111 = this->value(ix+1, iy+1, iz+1);
+            }
+
+            return (    (v000   *   dx_prime     *dy_prime   *dz_prime
+                    +   v100    *   dx           *dy_prime   *dz_prime)
+                    +   (v010   *   dx_prime     *dy         *dz_prime
+                    +   v110    *   dx           *dy         *dz_prime)
+                    +   (v001   *   dx_prime     *dy_prime   *dz
+                    +   v101    *   dx           *dy_prime   *dz)
+                    +   (v011   *   dx_prime     *dy         *dz
+                    +   v111    *   dx           *dy         *dz) );
+        }
+
+        template <unsigned int N>
+        inline T interpolate(const coord_type* pos, Linear, std::integral_constant<unsigned int, N>) const
+        {
+            long long anchor[D];
+            coord_type weights[D], weightsMinusOne[D];
+
+            bool inRange = true;
+            for ( unsigned int d=0; d<D; d++ )
+            {
+                anchor[d] = static_cast<long long>(std::floor(pos[d]));
+                weights[d] = pos[d] - anchor[d];
+                weightsMinusOne[d] = coord_type(1.0) - weights[d];
+                inRange = inRange && (anchor[d]>=0 && anchor[d]<size_[d]-1);
+            }
+
+            T res(0);
+            long long ind[D];
+
+            for ( unsigned int n=0; n<(1u<<D); n++ )
+            {
+                coord_type weightAll(1.0);
+                for ( unsigned int d=0; d<D; d++ )
+                {
+                    if ( (n>>d) & 1 )
+                    {
+                        ind[d] = anchor[d]+1;
+                        weightAll *= weights[d];
+                    }
+                    else
+                    {
+                        ind[d] = anchor[d];
+                        weightAll *= weightsMinusOne[d];
+                    }
+                }
+
+                if ( inRange )
+                {
+                    size_t offset = 0;
+                    for ( unsigned int d=0; d<D; d++ ) offset += (size_t)ind[d]*offset_[d];
+                    res += weightAll * data_[offset];
+                }
+                else
+                {
+                    res += weightAll * this->value(ind);
+                }
+            }
+
+            return res;
+        }
+
+        const T* data_;
+        long long size_[D];
+        size_t offset_[D];
+        T value_;
+    };
+}
@@ -158,7 +158,7 @@ namespace Gadgetron
             BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
         }
 
-        if ( start.size() != (*dimensions_).size() )
+        if ( start.size() != dimensions_.size() )
         {
             BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
         }
@@ -177,7 +177,7 @@ namespace Gadgetron
         for ( ii=0; ii<start.size(); ii++ )
         {
             end[ii] = start[ii] + size[ii] - 1;
-            if ( end[ii] >= (*dimensions_)[ii] )
+            if ( end[ii] >= dimensions_[ii] )
             {
                 BOOST_THROW_EXCEPTION( runtime_error("hoNDArray<>::get_sub_array failed"));
             }
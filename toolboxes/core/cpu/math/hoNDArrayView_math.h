@@ -0,0 +1,141 @@
+/** \file   hoNDArrayView_math.h
+    \brief  Elementwise functions and reductions on hoNDArrayView.
+
+            The functions take the contiguous blocks of the views as borrowed arrays and call the
+            hoNDArray functions of the same name on them, so a view costs one call per block.
+            Views in a binary function must have the same dimensions; their strides may differ.
+*/
+
+#pragma once
+
+#include "hoNDArrayView.h"
+#include "hoNDArray_elemwise.h"
+#include "hoNDArray_reductions.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace Gadgetron{
+
+  /// Calls f(bx, by) for the matching contiguous blocks of two views of equal dimensions
+  template <typename T, typename S, typename F>
+  void for_each_block(const hoNDArrayView<T>& x, const hoNDArrayView<S>& y, F f)
+  {
+    if (!x.dimensions_equal(y)) {
+      throw std::runtime_error("for_each_block: views have different dimensions");
+    }
+
+    size_t k = std::min(x.contiguous_dimensions(), y.contiguous_dimensions());
+    std::vector<size_t> block_dims(x.get_dimensions().begin(), x.get_dimensions().begin() + k);
+    if (block_dims.empty()) block_dims.push_back(1);
+
+    hoNDArray<T> bx;
+    hoNDArray<S> by;
+    std::vector<size_t> outer;
+    while (x.next_block(k, outer)) {
+      bx.create(block_dims, x.get_data_ptr() + x.outer_offset(k, outer), false);
+      by.create(block_dims, y.get_data_ptr() + y.outer_offset(k, outer), false);
+      f(bx, by);
+    }
+  }
+
+  /// Calls f(bx, by, br) for the matching contiguous blocks of three views of equal dimensions
+  template <typename T, typename S, typename R, typename F>
+  void for_each_block(const hoNDArrayView<T>& x, const hoNDArrayView<S>& y, const hoNDArrayView<R>& r, F f)
+  {
+    if (!x.dimensions_equal(y) || !x.dimensions_equal(r)) {
+      throw std::runtime_error("for_each_block: views have different dimensions");
+    }
+
+    size_t k = std::min(std::min(x.contiguous_dimensions(), y.contiguous_dimensions()), r.contiguous_dimensions());
+    std::vector<size_t> block_dims(x.get_dimensions().begin(), x.get_dimensions().begin() + k);
+    if (block_dims.empty()) block_dims.push_back(1);
+
+    hoNDArray<T> bx;
+    hoNDArray<S> by;
+    hoNDArray<R> br;
+    std::vector<size_t> outer;
+    while (x.next_block(k, outer)) {
+      bx.create(block_dims, x.get_data_ptr() + x.outer_offset(k, outer), false);
+      by.create(block_dims, y.get_data_ptr() + y.outer_offset(k, outer), false);
+      br.create(block_dims, r.get_data_ptr() + r.outer_offset(k, outer), false);
+      f(bx, by, br);
+    }
+  }
+
+  template <typename T> void clear(const hoNDArrayView<T>& x)
+  {
+    x.for_each_block([](hoNDArray<T>& b) { Gadgetron::clear(b); });
+  }
+
+  template <typename T> void fill(const hoNDArrayView<T>& x, T val)
+  {
+    x.for_each_block([val](hoNDArray<T>& b) { Gadgetron::fill(b, val); });
+  }
+
+  template <typename T, typename S> void scal(S a, const hoNDArrayView<T>& x)
+  {
+    x.for_each_block([a](hoNDArray<T>& b) { Gadgetron::scal(a, b); });
+  }
+
+  /// r = x + y
+  template <typename T> void add(const hoNDArrayView<T>& x, const hoNDArrayView<T>& y, const hoNDArrayView<T>& r)
+  {
+    for_each_block(x, y, r, [](hoNDArray<T>& bx, hoNDArray<T>& by, hoNDArray<T>& br) { Gadgetron::add(bx, by, br); });
+  }
+
+  /// r = x - y
+  template <typename T> void subtract(const hoNDArrayView<T>& x, const hoNDArrayView<T>& y, const hoNDArrayView<T>& r)
+  {
+    for_each_block(x, y, r, [](hoNDArray<T>& bx, hoNDArray<T>& by, hoNDArray<T>& br) { Gadgetron::subtract(bx, by, br); });
+  }
+
+  /// r = x * y
+  template <typename T> void multiply(const hoNDArrayView<T>& x, const hoNDArrayView<T>& y, const hoNDArrayView<T>& r)
+  {
+    for_each_block(x, y, r, [](hoNDArray<T>& bx, hoNDArray<T>& by, hoNDArray<T>& br) { Gadgetron::multiply(bx, by, br); });
+  }
+
+  /// y = a*x + y
+  template <typename T> void axpy(T a, const hoNDArrayView<T>& x, const hoNDArrayView<T>& y)
+  {
+    for_each_block(x, y, [a](hoNDArray<T>& bx, hoNDArray<T>& by) { Gadgetron::axpy(a, bx, by, by); });
+  }
+
+  /// Copies x into y
+  template <typename T> void copy(const hoNDArrayView<T>& x, const hoNDArrayView<T>& y)
+  {
+    for_each_block(x, y, [](hoNDArray<T>& bx, hoNDArray<T>& by) { memcpy(by.begin(), bx.begin(), bx.get_number_of_bytes()); });
+  }
+
+  template <typename T> T sum(const hoNDArrayView<T>& x)
+  {
+    T r(0);
+    x.for_each_block([&r](hoNDArray<T>& b) { r += Gadgetron::sum(&b); });
+    return r;
+  }
+
+  template <typename T> typename realType<T>::Type norm2(const hoNDArrayView<T>& x)
+  {
+    typedef typename realType<T>::Type value_type;
+    value_type r(0);
+    x.for_each_block([&r](hoNDArray<T>& b) { value_type n = Gadgetron::norm2(b); r += n*n; });
+    return std::sqrt(r);
+  }
+
+  template <typename T> typename realType<T>::Type norm1(const hoNDArrayView<T>& x)
+  {
+    typename realType<T>::Type r(0);
+    x.for_each_block([&r](hoNDArray<T>& b) { r += Gadgetron::norm1(b); });
+    return r;
+  }
+
+  /// x dot conj(y)
+  template <typename T> T dotc(const hoNDArrayView<T>& x, const hoNDArrayView<T>& y)
+  {
+    T r(0);
+    for_each_block(x, y, [&r](hoNDArray<T>& bx, hoNDArray<T>& by) { r += Gadgetron::dotc(bx, by); });
+    return r;
+  }
+}
@@ -0,0 +1,301 @@
+#include "hoNDArray_batched.h"
+#include "hoNDArray_simd.h"
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef USE_OMP
+    #include <omp.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define GADGETRON_BATCHED_X86
+    #include <immintrin.h>
+#endif
+
+#define NumBatchUseThreading 4*1024
+
+namespace Gadgetron{
+
+  namespace
+  {
+    // Matrices are passed as interleaved real/imaginary values, entry e of batch element b is at 2*(b + N*e)
+
+    // ----------------------------------------------------------------------------
+    // portable kernels, run along the batch for every matrix entry
+    // ----------------------------------------------------------------------------
+
+    template <typename R, size_t KC>
+    void gemv_scalar(size_t start, size_t len, size_t N, size_t M, size_t Kr, const R* A, size_t rs, size_t cs, const R* x, bool conjX, R* r)
+    {
+      const size_t K = KC ? KC : Kr;
+      const R s = conjX ? R(-1) : R(1);
+      const size_t end = start + len;
+
+      for (size_t i = 0; i < M; i++) {
+        R* pr = r + 2*N*i;
+        for (size_t b = start; b < end; b++) {
+          pr[2*b] = 0;
+          pr[2*b+1] = 0;
+        }
+
+        for (size_t k = 0; k < K; k++) {
+          const R* pa = A + 2*N*(i*rs + k*cs);
+          const R* px = x + 2*N*k;
+          for (size_t b = start; b < end; b++) {
+            const R ar = pa[2*b], ai = pa[2*b+1], xr = px[2*b], xi = s*px[2*b+1];
+            pr[2*b] += ar*xr - ai*xi;
+            pr[2*b+1] += ar*xi + ai*xr;
+          }
+        }
+      }
+    }
+
+    template <typename R>
+    void gemv_scalar_dispatch(size_t start, size_t len, size_t N, size_t M, size_t K, const R* A, size_t rs, size_t cs, const R* x, bool conjX, R* r)
+    {
+      gemv_scalar<R, 0>(start, len, N, M, K, A, rs, cs, x, conjX, r);
+    }
+
+#ifdef GADGETRON_BATCHED_X86
+
+    // ----------------------------------------------------------------------------
+    // AVX2 + FMA, 4 pixels per register; real and imaginary products are summed
+    // separately and combined once per entry of r
+    // ----------------------------------------------------------------------------
+
+    template <size_t KC>
+    __attribute__((target("avx2,fma")))
+    void gemv_avx2(size_t start, size_t len, size_t N, size_t M, size_t Kr, const float* A, size_t rs, size_t cs, const float* x, bool conjX, float* r)
+    {
+      const size_t K = KC ? KC : Kr;
+      const __m256 sign = conjX ? _mm256_set1_ps(-0.0f) : _mm256_setzero_ps();
+      const size_t end = start + len;
+
+      size_t b = start;
+      for (; b + 4 <= end; b += 4) {
+        for (size_t i = 0; i < M; i++) {
+          __m256 accA = _mm256_setzero_ps();
+          __m256 accB = _mm256_setzero_ps();
+          for (size_t k = 0; k < K; k++) {
+            __m256 a = _mm256_loadu_ps(A + 2*(N*(i*rs + k*cs) + b));
+            __m256 v = _mm256_loadu_ps(x + 2*(N*k + b));
+            accA = _mm256_fmadd_ps(a, _mm256_moveldup_ps(v), accA);
+            accB = _mm256_fmadd_ps(_mm256_permute_ps(a, 0xB1), _mm256_xor_ps(_mm256_movehdup_ps(v), sign), accB);
+          }
+          _mm256_storeu_ps(r + 2*(N*i + b), _mm256_addsub_ps(accA, accB));
+        }
+      }
+
+      if (b < end) gemv_scalar<float, KC>(b, end - b, N, M, K, A, rs, cs, x, conjX, r);
+    }
+
+    void gemv_avx2_dispatch(size_t start, size_t len, size_t N, size_t M, size_t K, const float* A, size_t rs, size_t cs, const float* x, bool conjX, float* r)
+    {
+      switch (K) {
+        case 8: gemv_avx2<8>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+        case 16: gemv_avx2<16>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+        case 20: gemv_avx2<20>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+        case 32: gemv_avx2<32>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+        case 64: gemv_avx2<64>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+        default: gemv_avx2<0>(start, len, N, M, K, A, rs, cs, x, conjX, r); break;
+      }
+    }
+
+#endif // GADGETRON_BATCHED_X86
+
+    // ----------------------------------------------------------------------------
+    // Cholesky and triangular solves, in blocks of pixels
+    // ----------------------------------------------------------------------------
+
+    const size_t BatchBlock = 64;
+
+    template <typename R>
+    void potrf_scalar(size_t start, size_t len, size_t N, size_t M, R* A)
+    {
+      R inv[BatchBlock];
+
+      for (size_t b0 = start; b0 < start + len; b0 += BatchBlock) {
+        const size_t b1 = std::min(b0 + BatchBlock, start + len);
+
+        for (size_t j = 0; j < M; j++) {
+          R* ajj = A + 2*N*(j + M*j);
+          for (size_t k = 0; k < j; k++) {
+            const R* ljk = A + 2*N*(j + M*k);
+            for (size_t b = b0; b < b1; b++) ajj[2*b] -= ljk[2*b]*ljk[2*b] + ljk[2*b+1]*ljk[2*b+1];
+          }
+
+          for (size_t b = b0; b < b1; b++) {
+            const R d = ajj[2*b];
+            if (d > 0) {
+              const R l = std::sqrt(d);
+              ajj[2*b] = l;
+              inv[b - b0] = R(1)/l;
+            } else {
+              ajj[2*b] = 0;
+              inv[b - b0] = 0;
+            }
+            ajj[2*b+1] = 0;
+          }
+
+          for (size_t i = j + 1; i < M; i++) {
+            R* aij = A + 2*N*(i + M*j);
+            for (size_t k = 0; k < j; k++) {
+              // aij -= L(i,k) * conj(L(j,k))
+              const R* lik = A + 2*N*(i + M*k);
+              const R* ljk = A + 2*N*(j + M*k);
+              for (size_t b = b0; b < b1; b++) {
+                aij[2*b] -= lik[2*b]*ljk[2*b] + lik[2*b+1]*ljk[2*b+1];
+                aij[2*b+1] -= lik[2*b+1]*ljk[2*b] - lik[2*b]*ljk[2*b+1];
+              }
+            }
+            for (size_t b = b0; b < b1; b++) {
+              aij[2*b] *= inv[b - b0];
+              aij[2*b+1] *= inv[b - b0];
+            }
+          }
+        }
+      }
+    }
+
+    template <typename R>
+    void potrs_scalar(size_t start, size_t len, size_t N, size_t M, size_t P, const R* L, R* B)
+    {
+      for (size_t b0 = start; b0 < start + len; b0 += BatchBlock) {
+        const size_t b1 = std::min(b0 + BatchBlock, start + len);
+
+        for (size_t p = 0; p < P; p++) {
+          R* x = B + 2*N*M*p;
+
+          // L y = b
+          for (size_t i = 0; i < M; i++) {
+            R* xi = x + 2*N*i;
+            for (size_t k = 0; k < i; k++) {
+              const R* lik = L + 2*N*(i + M*k);
+              const R* xk = x + 2*N*k;
+              for (size_t b = b0; b < b1; b++) {
+                xi[2*b] -= lik[2*b]*xk[2*b] - lik[2*b+1]*xk[2*b+1];
+                xi[2*b+1] -= lik[2*b]*xk[2*b+1] + lik[2*b+1]*xk[2*b];
+              }
+            }
+            const R* lii = L + 2*N*(i + M*i);
+            for (size_t b = b0; b < b1; b++) {
+              const R s = (lii[2*b] > 0) ? R(1)/lii[2*b] : R(0);
+              xi[2*b] *= s;
+              xi[2*b+1] *= s;
+            }
+          }
+
+          // L^H x = y
+          for (size_t i = M; i-- > 0; ) {
+            R* xi = x + 2*N*i;
+            for (size_t k = i + 1; k < M; k++) {
+              // xi -= conj(L(k,i)) * xk
+              const R* lki = L + 2*N*(k + M*i);
+              const R* xk = x + 2*N*k;
+              for (size_t b = b0; b < b1; b++) {
+                xi[2*b] -= lki[2*b]*xk[2*b] + lki[2*b+1]*xk[2*b+1];
+                xi[2*b+1] -= lki[2*b]*xk[2*b+1] - lki[2*b+1]*xk[2*b];
+              }
+            }
+            const R* lii = L + 2*N*(i + M*i);
+            for (size_t b = b0; b < b1; b++) {
+              const R s = (lii[2*b] > 0) ? R(1)/lii[2*b] : R(0);
+              xi[2*b] *= s;
+              xi[2*b+1] *= s;
+            }
+          }
+        }
+      }
+    }
+
+    // ----------------------------------------------------------------------------
+    // dispatch
+    // ----------------------------------------------------------------------------
+
+    /// Runs f(offset, length) over [0, N), split over the OpenMP threads for large N.
+    /// Chunks start at multiples of 4 so that the vector kernels only see one tail.
+    template <typename F> void split(size_t N, F f)
+    {
+#ifdef USE_OMP
+      if (N > NumBatchUseThreading && !omp_in_parallel()) {
+        #pragma omp parallel
+        {
+          size_t nt = (size_t)omp_get_num_threads();
+          size_t t = (size_t)omp_get_thread_num();
+          size_t chunk = ((N + nt - 1) / nt + 3) & ~(size_t)3;
+          size_t start = t*chunk;
+          if (start < N) f(start, (start + chunk > N) ? N - start : chunk);
+        }
+        return;
+      }
+#endif
+      f(0, N);
+    }
+
+    typedef void (*gemv_kernel_float)(size_t, size_t, size_t, size_t, size_t, const float*, size_t, size_t, const float*, bool, float*);
+
+    gemv_kernel_float gemv_kernel_for_float()
+    {
+#ifdef GADGETRON_BATCHED_X86
+      if (hoNDArraySimd::level() >= hoNDArraySimd::SIMD_AVX2) return gemv_avx2_dispatch;
+#endif
+      return gemv_scalar_dispatch<float>;
+    }
+
+    template <typename R, typename Kernel>
+    void gemv_impl(Kernel kernel, size_t N, size_t M, size_t Kn, const R* A, bool transA, const R* x, bool conjX, R* r)
+    {
+      // strides of the entries of op(A), counted in matrices
+      const size_t rs = transA ? Kn : 1;
+      const size_t cs = transA ? 1 : M;
+      split(N, [=](size_t s, size_t n) { kernel(s, n, N, M, Kn, A, rs, cs, x, conjX, r); });
+    }
+  }
+
+  void hoNDArrayBatched::gemv(size_t N, size_t M, size_t K, const std::complex<float>* A, bool transA, const std::complex<float>* x, bool conjX, std::complex<float>* r)
+  {
+    gemv_impl(gemv_kernel_for_float(), N, M, K, reinterpret_cast<const float*>(A), transA, reinterpret_cast<const float*>(x), conjX, reinterpret_cast<float*>(r));
+  }
+
+  void hoNDArrayBatched::gemv(size_t N, size_t M, size_t K, const std::complex<double>* A, bool transA, const std::complex<double>* x, bool conjX, std::complex<double>* r)
+  {
+    gemv_impl(gemv_scalar_dispatch<double>, N, M, K, reinterpret_cast<const double*>(A), transA, reinterpret_cast<const double*>(x), conjX, reinterpret_cast<double*>(r));
+  }
+
+  void hoNDArrayBatched::gemm(size_t N, size_t M, size_t K, size_t P, const std::complex<float>* A, bool transA, const std::complex<float>* B, bool conjB, std::complex<float>* C)
+  {
+    for (size_t p = 0; p < P; p++) gemv(N, M, K, A, transA, B + N*K*p, conjB, C + N*M*p);
+  }
+
+  void hoNDArrayBatched::gemm(size_t N, size_t M, size_t K, size_t P, const std::complex<double>* A, bool transA, const std::complex<double>* B, bool conjB, std::complex<double>* C)
+  {
+    for (size_t p = 0; p < P; p++) gemv(N, M, K, A, transA, B + N*K*p, conjB, C + N*M*p);
+  }
+
+  void hoNDArrayBatched::potrf(size_t N, size_t M, std::complex<float>* A)
+  {
+    float* pA = reinterpret_cast<float*>(A);
+    split(N, [=](size_t s, size_t n) { potrf_scalar(s, n, N, M, pA); });
+  }
+
+  void hoNDArrayBatched::potrf(size_t N, size_t M, std::complex<double>* A)
+  {
+    double* pA = reinterpret_cast<double*>(A);
+    split(N, [=](size_t s, size_t n) { potrf_scalar(s, n, N, M, pA); });
+  }
+
+  void hoNDArrayBatched::potrs(size_t N, size_t M, size_t P, const std::complex<float>* L, std::complex<float>* B)
+  {
+    const float* pL = reinterpret_cast<const float*>(L);
+    float* pB = reinterpret_cast<float*>(B);
+    split(N, [=](size_t s, size_t n) { potrs_scalar(s, n, N, M, P, pL, pB); });
+  }
+
+  void hoNDArrayBatched::potrs(size_t N, size_t M, size_t P, const std::complex<double>* L, std::complex<double>* B)
+  {
+    const double* pL = reinterpret_cast<const double*>(L);
+    double* pB = reinterpret_cast<double*>(B);
+    split(N, [=](size_t s, size_t n) { potrs_scalar(s, n, N, M, P, pL, pB); });
+  }
+}
@@ -0,0 +1,52 @@
+/** \file   hoNDArray_batched.h
+    \brief  Linear algebra on batches of small complex matrices, one matrix per pixel.
+
+            The matrices of a batch are stored entry by entry with the batch index innermost: entry (i, j)
+            of the M x K column-major matrix of batch element b is at A[b + N*(i + M*j)]. This is the
+            layout of the channel dimensions of an image array, e.g. for [RO E1 CHA] and N = RO*E1 a
+            pixel's channels form a CHA x 1 vector and for [RO E1 srcCHA dstCHA] a srcCHA x dstCHA matrix.
+
+            gemv and gemm of std::complex<float> use AVX2/FMA kernels across 4 pixels when
+            hoNDArraySimd::level() allows it. The kernels are specialised at compile time for 8, 16, 20,
+            32 and 64 summed entries (the usual coil counts), other sizes use a generic loop. All other
+            cases use portable loops that run along the batch. Large batches are split over the OpenMP
+            threads.
+
+            Outputs must not overlap the inputs.
+*/
+
+#pragma once
+
+#include "cpucore_math_export.h"
+
+#include <complex>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTCPUCOREMATH hoNDArrayBatched
+  {
+  public:
+
+    /// r = op(A) * x for every batch element; x has K entries, r has M.
+    /// op(A) is A (M x K) or, with transA, the transpose of A stored as K x M.
+    /// With conjX, x is conjugated.
+    static void gemv(size_t N, size_t M, size_t K, const std::complex<float>* A, bool transA, const std::complex<float>* x, bool conjX, std::complex<float>* r);
+    static void gemv(size_t N, size_t M, size_t K, const std::complex<double>* A, bool transA, const std::complex<double>* x, bool conjX, std::complex<double>* r);
+
+    /// C = op(A) * B for every batch element; B is K x P, C is M x P.
+    /// With conjB, B is conjugated.
+    static void gemm(size_t N, size_t M, size_t K, size_t P, const std::complex<float>* A, bool transA, const std::complex<float>* B, bool conjB, std::complex<float>* C);
+    static void gemm(size_t N, size_t M, size_t K, size_t P, const std::complex<double>* A, bool transA, const std::complex<double>* B, bool conjB, std::complex<double>* C);
+
+    /// Cholesky factorisation A = L*L^H of Hermitian positive definite M x M matrices, in place.
+    /// Only the lower triangle is read, L replaces it; the strict upper triangle is not changed.
+    /// A pivot that is not positive is set to zero, potrs then solves the corresponding unknown as zero.
+    static void potrf(size_t N, size_t M, std::complex<float>* A);
+    static void potrf(size_t N, size_t M, std::complex<double>* A);
+
+    /// Solves L*L^H X = B with L from potrf, B (M x P) is replaced by X
+    static void potrs(size_t N, size_t M, size_t P, const std::complex<float>* L, std::complex<float>* B);
+    static void potrs(size_t N, size_t M, size_t P, const std::complex<double>* L, std::complex<double>* B);
+  };
+}
@@ -2,6 +2,7 @@
 #include "hoNDArray_reductions.h"
 #include "complext.h"
 #include "hoArmadillo.h"
+#include "hoNDArray_simd.h"
 
 #ifdef USE_OMP
     #include <omp.h>
@@ -367,6 +368,29 @@ namespace Gadgetron{
 
     }
 
+    // complex float, the vectorised kernels of hoNDArraySimd
+    inline void multiply_impl(size_t sizeX, size_t sizeY, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+    {
+      if (sizeY>sizeX) {
+          throw std::runtime_error("Multiply cannot broadcast when the size of x is less than the size of y.");
+      }
+
+      if (sizeX==sizeY) {
+          hoNDArraySimd::multiply(sizeX, x, y, r);
+          return;
+      }
+
+      // Broadcasting, large blocks are split over the threads by the kernel itself
+      long long outerloopsize = sizeX/sizeY;
+      long long outer;
+#ifdef USE_OMP
+#pragma omp parallel for default(none) private(outer) shared(outerloopsize, x, y, r, sizeY) if (sizeX>=NumElementsUseThreading && sizeY<=NumElementsUseThreading)
+#endif
+      for (outer=0; outer<outerloopsize; outer++) {
+          hoNDArraySimd::multiply(sizeY, x + outer*sizeY, y, r + outer*sizeY);
+      }
+    }
+
     template <class T, class S>
     void multiply(const hoNDArray<T>& x, const hoNDArray<S>& y, hoNDArray<typename mathReturnType<T,S>::type >& r)
     {
@@ -622,6 +646,29 @@ namespace Gadgetron{
 
     }
 
+    // complex float, the vectorised kernels of hoNDArraySimd
+    inline void multiplyConj_impl(size_t sizeX, size_t sizeY, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+    {
+      if (sizeY>sizeX) {
+          throw std::runtime_error("MultiplyConj cannot broadcast when the size of x is less than the size of y.");
+      }
+
+      if (sizeX==sizeY) {
+          hoNDArraySimd::multiplyConj(sizeX, x, y, r);
+          return;
+      }
+
+      // Broadcasting, large blocks are split over the threads by the kernel itself
+      long long outerloopsize = sizeX/sizeY;
+      long long outer;
+#ifdef USE_OMP
+#pragma omp parallel for default(none) private(outer) shared(outerloopsize, x, y, r, sizeY) if (sizeX>=NumElementsUseThreading && sizeY<=NumElementsUseThreading)
+#endif
+      for (outer=0; outer<outerloopsize; outer++) {
+          hoNDArraySimd::multiplyConj(sizeY, x + outer*sizeY, y, r + outer*sizeY);
+      }
+    }
+
     template <class T, class S>
     void multiplyConj(const hoNDArray<T>& x, const hoNDArray<S>& y, hoNDArray<typename mathReturnType<T,S>::type >& r)
     {
@@ -666,14 +713,7 @@ namespace Gadgetron{
 
     inline void conjugate(size_t N, const  std::complex<float> * x,  std::complex<float> * r)
     {
-        long long n;
-
-        #pragma omp parallel for default(none) private(n) shared(N, x, r) if (N>NumElementsUseThreading)
-        for ( n=0; n<(long long)N; n++ )
-        {
-            reinterpret_cast<float(&)[2]>(r[n])[0] = reinterpret_cast< const float(&)[2]>(x[n])[0];
-            reinterpret_cast<float(&)[2]>(r[n])[1] = -(reinterpret_cast< const float(&)[2]>(x[n])[1]);
-        }
+        hoNDArraySimd::conjugate(N, x, r);
     }
 
     inline void conjugate(size_t N, const  std::complex<double> * x,  std::complex<double> * r)
@@ -869,16 +909,7 @@ namespace Gadgetron{
 
     inline void abs(size_t N, const  std::complex<float> * x, float* r)
     {
-        long long n;
-
-        #pragma omp parallel for default(none) private(n) shared(N, x, r) if (N>NumElementsUseThreading)
-        for ( n=0; n<(long long)N; n++ )
-        {
-            const  std::complex<float> & c = x[n];
-            const float re = c.real();
-            const float im = c.imag();
-            r[n]= std::sqrt( (re*re) + (im * im) );
-        }
+        hoNDArraySimd::abs(N, x, r);
     }
 
     inline void abs(size_t N, const  std::complex<double> * x, double* r)
@@ -2013,25 +2044,7 @@ namespace Gadgetron{
 
     inline void axpy( std::complex<float>  a, size_t N, const  std::complex<float> * x, const  std::complex<float> * y,  std::complex<float> * r)
     {
-        long long n;
-
-        #pragma omp parallel for default(none) private(n) shared(N, r, a, x, y) if(N>NumElementsUseThreading)
-        for ( n=0; n<(long long)N; ++n)
-        {
-            const  std::complex<float> & vx = x[n];
-            const float re1 = vx.real();
-            const float im1 = vx.imag();
-
-            const  std::complex<float> & vy = y[n];
-            const float re2 = vy.real();
-            const float im2 = vy.imag();
-
-            const float ar = a.real();
-            const float ai = a.imag();
-
-            reinterpret_cast<float(&)[2]>(r[n])[0] = re2 + ar*re1 - ai*im1;
-            reinterpret_cast<float(&)[2]>(r[n])[1] = im2 + ar*im1 + ai*re1;
-        }
+        hoNDArraySimd::axpy(a, N, x, y, r);
     }
 
     inline void axpy( std::complex<double>  a, size_t N, const  std::complex<double> * x, const  std::complex<double> * y,  std::complex<double> * r)
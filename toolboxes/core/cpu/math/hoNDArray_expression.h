@@ -0,0 +1,309 @@
+/** \file   hoNDArray_expression.h
+    \brief  Lazy elementwise expressions on hoNDArray, evaluated in one fused loop.
+
+    A chain of elementwise functions from hoNDArray_elemwise.h makes one pass over memory and one
+    temporary array per operation. An expression instead records the operations and evaluates
+    them element by element in a single (OpenMP parallel, vectorisable) loop:
+
+      // a = b .* conj(c) + d
+      Gadgetron::evaluate(expr(b) * conj(expr(c)) + expr(d), a);
+
+      // r = |x|^2 * 0.5f
+      Gadgetron::evaluate(norm(expr(x)) * 0.5f, r);
+
+    Arrays enter an expression through expr(); the operators +, -, * and / combine expressions
+    with each other and with scalars, conj(), abs(), norm(), real() and imag() act on expressions.
+    All arrays of an expression must have the same number of elements; the result is created with
+    the dimensions of the first array and may be one of the operands.
+
+    An expression only refers to its arrays, it must be evaluated while they exist.
+ */
+
+#pragma once
+
+#include "hoNDArray.h"
+
+#include <complex>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#ifdef USE_OMP
+    #include <omp.h>
+#endif // USE_OMP
+
+namespace Gadgetron{
+
+  /// Base of all expressions, E is the expression type itself
+  template <typename E> struct hoNDExpression
+  {
+    const E& self() const { return static_cast<const E&>(*this); }
+  };
+
+  // ------------------------------------------------------------------------
+  // leaves
+  // ------------------------------------------------------------------------
+
+  template <typename T> class hoNDExpressionArray : public hoNDExpression< hoNDExpressionArray<T> >
+  {
+  public:
+    typedef T value_type;
+
+    hoNDExpressionArray(const hoNDArray<T>& a) : array_(&a), data_(a.begin()), n_(a.get_number_of_elements())
+    {
+    }
+
+    T operator[](size_t i) const { return data_[i]; }
+
+    /// Dimensions of the first array of the expression, false if there is none
+    bool dimensions(std::vector<size_t>& dims) const { array_->get_dimensions(dims); return true; }
+
+    size_t size() const { return n_; }
+
+    bool conforms(size_t n) const { return n_ == n; }
+
+  protected:
+    const hoNDArray<T>* array_;
+    const T* data_;
+    size_t n_;
+  };
+
+  template <typename T> class hoNDExpressionScalar : public hoNDExpression< hoNDExpressionScalar<T> >
+  {
+  public:
+    typedef T value_type;
+
+    hoNDExpressionScalar(const T& v) : v_(v)
+    {
+    }
+
+    T operator[](size_t) const { return v_; }
+
+    bool dimensions(std::vector<size_t>&) const { return false; }
+
+    size_t size() const { return 0; }
+
+    bool conforms(size_t) const { return true; }
+
+  protected:
+    T v_;
+  };
+
+  /// Array leaf of an expression
+  template <typename T> inline hoNDExpressionArray<T> expr(const hoNDArray<T>& a)
+  {
+    return hoNDExpressionArray<T>(a);
+  }
+
+  // ------------------------------------------------------------------------
+  // nodes
+  // ------------------------------------------------------------------------
+
+  template <typename L, typename R, typename Op> class hoNDExpressionBinary : public hoNDExpression< hoNDExpressionBinary<L, R, Op> >
+  {
+  public:
+    typedef decltype(Op::apply(typename L::value_type(), typename R::value_type())) value_type;
+
+    hoNDExpressionBinary(const L& l, const R& r) : l_(l), r_(r)
+    {
+    }
+
+    value_type operator[](size_t i) const { return Op::apply(l_[i], r_[i]); }
+
+    bool dimensions(std::vector<size_t>& dims) const { return l_.dimensions(dims) || r_.dimensions(dims); }
+
+    size_t size() const { return l_.size() ? l_.size() : r_.size(); }
+
+    bool conforms(size_t n) const { return l_.conforms(n) && r_.conforms(n); }
+
+    const L& left() const { return l_; }
+    const R& right() const { return r_; }
+
+  protected:
+    L l_;
+    R r_;
+  };
+
+  template <typename E, typename Op> class hoNDExpressionUnary : public hoNDExpression< hoNDExpressionUnary<E, Op> >
+  {
+  public:
+    typedef decltype(Op::apply(typename E::value_type())) value_type;
+
+    hoNDExpressionUnary(const E& e) : e_(e)
+    {
+    }
+
+    value_type operator[](size_t i) const { return Op::apply(e_[i]); }
+
+    bool dimensions(std::vector<size_t>& dims) const { return e_.dimensions(dims); }
+
+    size_t size() const { return e_.size(); }
+
+    bool conforms(size_t n) const { return e_.conforms(n); }
+
+  protected:
+    E e_;
+  };
+
+  // ------------------------------------------------------------------------
+  // operations
+  // ------------------------------------------------------------------------
+
+  struct hoNDExpressionAdd      { template <typename A, typename B> static auto apply(const A& a, const B& b) -> decltype(a + b) { return a + b; } };
+  struct hoNDExpressionSubtract { template <typename A, typename B> static auto apply(const A& a, const B& b) -> decltype(a - b) { return a - b; } };
+  struct hoNDExpressionMultiply { template <typename A, typename B> static auto apply(const A& a, const B& b) -> decltype(a * b) { return a * b; } };
+  struct hoNDExpressionDivide   { template <typename A, typename B> static auto apply(const A& a, const B& b) -> decltype(a / b) { return a / b; } };
+  struct hoNDExpressionNegate   { template <typename A> static A apply(const A& a) { return -a; } };
+
+  struct hoNDExpressionConj
+  {
+    template <typename A> static A apply(const A& a) { return a; }
+    template <typename A> static std::complex<A> apply(const std::complex<A>& a) { return std::complex<A>(a.real(), -a.imag()); }
+  };
+
+  struct hoNDExpressionAbs
+  {
+    template <typename A> static A apply(const A& a) { return std::abs(a); }
+    template <typename A> static A apply(const std::complex<A>& a) { return std::sqrt(a.real()*a.real() + a.imag()*a.imag()); }
+  };
+
+  /// Squared magnitude
+  struct hoNDExpressionNorm
+  {
+    template <typename A> static A apply(const A& a) { return a*a; }
+    template <typename A> static A apply(const std::complex<A>& a) { return a.real()*a.real() + a.imag()*a.imag(); }
+  };
+
+  struct hoNDExpressionReal
+  {
+    template <typename A> static A apply(const A& a) { return a; }
+    template <typename A> static A apply(const std::complex<A>& a) { return a.real(); }
+  };
+
+  struct hoNDExpressionImag
+  {
+    template <typename A> static A apply(const A&) { return A(0); }
+    template <typename A> static A apply(const std::complex<A>& a) { return a.imag(); }
+  };
+
+#define GADGETRON_HONDEXPRESSION_BINARY_OPERATOR(OP, NAME)                                                                   \
+  template <typename L, typename R> inline hoNDExpressionBinary<L, R, NAME>                                                 \
+  operator OP (const hoNDExpression<L>& l, const hoNDExpression<R>& r)                                                       \
+  {                                                                                                                          \
+    return hoNDExpressionBinary<L, R, NAME>(l.self(), r.self());                                                             \
+  }                                                                                                                          \
+  template <typename L> inline hoNDExpressionBinary<L, hoNDExpressionScalar<typename L::value_type>, NAME>                   \
+  operator OP (const hoNDExpression<L>& l, const typename L::value_type& s)                                                  \
+  {                                                                                                                          \
+    return hoNDExpressionBinary<L, hoNDExpressionScalar<typename L::value_type>, NAME>(l.self(), s);                         \
+  }                                                                                                                          \
+  template <typename R> inline hoNDExpressionBinary<hoNDExpressionScalar<typename R::value_type>, R, NAME>                   \
+  operator OP (const typename R::value_type& s, const hoNDExpression<R>& r)                                                  \
+  {                                                                                                                          \
+    return hoNDExpressionBinary<hoNDExpressionScalar<typename R::value_type>, R, NAME>(s, r.self());                         \
+  }
+
+  GADGETRON_HONDEXPRESSION_BINARY_OPERATOR(+, hoNDExpressionAdd)
+  GADGETRON_HONDEXPRESSION_BINARY_OPERATOR(-, hoNDExpressionSubtract)
+  GADGETRON_HONDEXPRESSION_BINARY_OPERATOR(*, hoNDExpressionMultiply)
+  GADGETRON_HONDEXPRESSION_BINARY_OPERATOR(/, hoNDExpressionDivide)
+
+#undef GADGETRON_HONDEXPRESSION_BINARY_OPERATOR
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionNegate> operator-(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionNegate>(e.self());
+  }
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionConj> conj(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionConj>(e.self());
+  }
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionAbs> abs(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionAbs>(e.self());
+  }
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionNorm> norm(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionNorm>(e.self());
+  }
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionReal> real(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionReal>(e.self());
+  }
+
+  template <typename E> inline hoNDExpressionUnary<E, hoNDExpressionImag> imag(const hoNDExpression<E>& e)
+  {
+    return hoNDExpressionUnary<E, hoNDExpressionImag>(e.self());
+  }
+
+  // ------------------------------------------------------------------------
+  // evaluation
+  // ------------------------------------------------------------------------
+
+  /// Number of elements from which evaluate() runs in parallel
+  enum { hoNDExpressionNumElementsUseThreading = 64*1024 };
+
+  /// r = e, in one pass over the data
+  template <typename E, typename T> void evaluate(const hoNDExpression<E>& e, hoNDArray<T>& r)
+  {
+    const E& x = e.self();
+
+    std::vector<size_t> dims;
+    if (!x.dimensions(dims)) {
+      throw std::runtime_error("evaluate: expression has no array");
+    }
+
+    size_t n = x.size();
+    if (!x.conforms(n)) {
+      throw std::runtime_error("evaluate: arrays of the expression differ in size");
+    }
+
+    if (r.get_number_of_elements() != n) {
+      r.create(dims);
+    }
+
+    T* pR = r.begin();
+    long long N = (long long)n;
+    long long i;
+
+#pragma omp parallel for private(i) if (N > hoNDExpressionNumElementsUseThreading)
+    for (i = 0; i < N; i++) {
+      pR[i] = static_cast<T>(x[i]);
+    }
+  }
+
+  /// Sum of the elements of an expression, in one pass over the data
+  template <typename E> typename E::value_type evaluate_sum(const hoNDExpression<E>& e)
+  {
+    const E& x = e.self();
+
+    size_t n = x.size();
+    if (!x.conforms(n)) {
+      throw std::runtime_error("evaluate_sum: arrays of the expression differ in size");
+    }
+
+    typedef typename E::value_type value_type;
+    value_type sum = value_type(0);
+    long long N = (long long)n;
+
+#pragma omp parallel if (N > hoNDExpressionNumElementsUseThreading)
+    {
+      value_type partial = value_type(0);
+      long long i;
+
+#pragma omp for
+      for (i = 0; i < N; i++) {
+        partial += x[i];
+      }
+
+#pragma omp critical
+      sum += partial;
+    }
+
+    return sum;
+  }
+}
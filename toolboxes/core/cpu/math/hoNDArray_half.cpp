@@ -0,0 +1,223 @@
+#include "hoNDArray_half.h"
+#include "hoNDArray_simd.h"
+
+#ifdef USE_OMP
+    #include <omp.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define GADGETRON_HALF_X86
+    #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    #define GADGETRON_HALF_NEON
+    #include <arm_neon.h>
+#endif
+
+#define NumElementsUseThreading 64*1024
+
+namespace Gadgetron{
+
+  namespace
+  {
+    // ----------------------------------------------------------------------------
+    // scalar kernels, also used for the tails of the vector kernels
+    // ----------------------------------------------------------------------------
+
+    void to_half_scalar(size_t N, const float* x, unsigned short* r)
+    {
+      for (size_t n = 0; n < N; n++) r[n] = half_float::from_float(x[n]);
+    }
+
+    void to_float_scalar(size_t N, const unsigned short* x, float* r)
+    {
+      for (size_t n = 0; n < N; n++) r[n] = half_float::to_float(x[n]);
+    }
+
+#ifdef GADGETRON_HALF_X86
+
+    // ----------------------------------------------------------------------------
+    // F16C, 8 values per register
+    // ----------------------------------------------------------------------------
+
+    __attribute__((target("avx,f16c")))
+    void to_half_f16c(size_t N, const float* x, unsigned short* r)
+    {
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + n), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(r + n), h);
+      }
+      to_half_scalar(N - n, x + n, r + n);
+    }
+
+    __attribute__((target("avx,f16c")))
+    void to_float_f16c(size_t N, const unsigned short* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + n));
+        _mm256_storeu_ps(r + n, _mm256_cvtph_ps(h));
+      }
+      to_float_scalar(N - n, x + n, r + n);
+    }
+
+    // ----------------------------------------------------------------------------
+    // AVX-512, 16 values per register
+    // ----------------------------------------------------------------------------
+
+    __attribute__((target("avx512f")))
+    void to_half_avx512(size_t N, const float* x, unsigned short* r)
+    {
+      size_t n = 0;
+      for (; n + 16 <= N; n += 16) {
+        __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(x + n), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + n), h);
+      }
+      to_half_f16c(N - n, x + n, r + n);
+    }
+
+    __attribute__((target("avx512f")))
+    void to_float_avx512(size_t N, const unsigned short* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 16 <= N; n += 16) {
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + n));
+        _mm512_storeu_ps(r + n, _mm512_cvtph_ps(h));
+      }
+      to_float_f16c(N - n, x + n, r + n);
+    }
+
+    bool has_f16c()
+    {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx") != 0 && __builtin_cpu_supports("f16c") != 0;
+    }
+
+#endif // GADGETRON_HALF_X86
+
+#ifdef GADGETRON_HALF_NEON
+
+    // ----------------------------------------------------------------------------
+    // NEON, 4 values per register
+    // ----------------------------------------------------------------------------
+
+    void to_half_neon(size_t N, const float* x, unsigned short* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        vst1_u16(r + n, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(x + n))));
+      }
+      to_half_scalar(N - n, x + n, r + n);
+    }
+
+    void to_float_neon(size_t N, const unsigned short* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        vst1q_f32(r + n, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(x + n))));
+      }
+      to_float_scalar(N - n, x + n, r + n);
+    }
+
+#endif // GADGETRON_HALF_NEON
+
+    typedef void (*to_half_kernel)(size_t, const float*, unsigned short*);
+    typedef void (*to_float_kernel)(size_t, const unsigned short*, float*);
+
+    struct Kernels
+    {
+      to_half_kernel to_half;
+      to_float_kernel to_float;
+    };
+
+    Kernels kernels()
+    {
+      Kernels k = { to_half_scalar, to_float_scalar };
+
+      hoNDArraySimd::Level l = hoNDArraySimd::level();
+
+#ifdef GADGETRON_HALF_X86
+      static const bool f16c = has_f16c();
+      if (l == hoNDArraySimd::SIMD_AVX512) {
+        k.to_half = to_half_avx512;
+        k.to_float = to_float_avx512;
+      } else if (l == hoNDArraySimd::SIMD_AVX2 && f16c) {
+        k.to_half = to_half_f16c;
+        k.to_float = to_float_f16c;
+      }
+#endif // GADGETRON_HALF_X86
+
+#ifdef GADGETRON_HALF_NEON
+      if (l == hoNDArraySimd::SIMD_NEON) {
+        k.to_half = to_half_neon;
+        k.to_float = to_float_neon;
+      }
+#endif // GADGETRON_HALF_NEON
+
+      return k;
+    }
+
+    /// Runs f(offset, length) over [0, N), split over the OpenMP threads for large N
+    template <typename F> void split(size_t N, F f)
+    {
+#ifdef USE_OMP
+      if (N > NumElementsUseThreading) {
+        #pragma omp parallel
+        {
+          size_t nt = (size_t)omp_get_num_threads();
+          size_t t = (size_t)omp_get_thread_num();
+          size_t chunk = (N + nt - 1) / nt;
+          size_t start = t*chunk;
+          if (start < N) f(start, (start + chunk > N) ? N - start : chunk);
+        }
+        return;
+      }
+#endif
+      f(0, N);
+    }
+  }
+
+  void hoNDArrayHalf::to_half(size_t N, const float* x, half_float* r)
+  {
+    to_half_kernel k = kernels().to_half;
+    unsigned short* pr = reinterpret_cast<unsigned short*>(r);
+    split(N, [=](size_t s, size_t n) { k(n, x + s, pr + s); });
+  }
+
+  void hoNDArrayHalf::to_half(size_t N, const std::complex<float>* x, complex_half* r)
+  {
+    to_half(2*N, reinterpret_cast<const float*>(x), reinterpret_cast<half_float*>(r));
+  }
+
+  void hoNDArrayHalf::to_float(size_t N, const half_float* x, float* r)
+  {
+    to_float_kernel k = kernels().to_float;
+    const unsigned short* px = reinterpret_cast<const unsigned short*>(x);
+    split(N, [=](size_t s, size_t n) { k(n, px + s, r + s); });
+  }
+
+  void hoNDArrayHalf::to_float(size_t N, const complex_half* x, std::complex<float>* r)
+  {
+    to_float(2*N, reinterpret_cast<const half_float*>(x), reinterpret_cast<float*>(r));
+  }
+
+  void complex_to_half(const hoNDArray< std::complex<float> >& x, hoNDArray<complex_half>& r)
+  {
+    if (!r.dimensions_equal(&x)) {
+      r.create(x.get_dimensions());
+    }
+
+    hoNDArrayHalf::to_half(x.get_number_of_elements(), x.begin(), r.begin());
+  }
+
+  void half_to_complex(const hoNDArray<complex_half>& x, hoNDArray< std::complex<float> >& r)
+  {
+    if (!r.dimensions_equal(&x)) {
+      r.create(x.get_dimensions());
+    }
+
+    hoNDArrayHalf::to_float(x.get_number_of_elements(), x.begin(), r.begin());
+  }
+}
@@ -0,0 +1,46 @@
+/** \file   hoNDArray_half.h
+    \brief  Conversion between float and half precision (complex_half.h) storage.
+
+            Large buffers, e.g. the buffered k-space of BucketToBufferGadget, can be kept as
+            hoNDArray<complex_half> and converted to std::complex<float> where they are processed:
+
+              hoNDArray<complex_half> store;
+              Gadgetron::complex_to_half(kspace, store);
+              ...
+              Gadgetron::half_to_complex(store, kspace);
+
+            The kernels use F16C or AVX-512 on x86 and NEON on AArch64, following the level of
+            hoNDArraySimd (and so GADGETRON_SIMD), and round to nearest even like the scalar code.
+            Large arrays are split over the OpenMP threads.
+*/
+
+#pragma once
+
+#include "cpucore_math_export.h"
+#include "complex_half.h"
+#include "hoNDArray.h"
+
+#include <complex>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTCPUCOREMATH hoNDArrayHalf
+  {
+  public:
+
+    /// r = half(x)
+    static void to_half(size_t N, const float* x, half_float* r);
+    static void to_half(size_t N, const std::complex<float>* x, complex_half* r);
+
+    /// r = float(x)
+    static void to_float(size_t N, const half_float* x, float* r);
+    static void to_float(size_t N, const complex_half* x, std::complex<float>* r);
+  };
+
+  /// r = half(x), r is created with the dimensions of x if needed
+  EXPORTCPUCOREMATH void complex_to_half(const hoNDArray< std::complex<float> >& x, hoNDArray<complex_half>& r);
+
+  /// r = float(x), r is created with the dimensions of x if needed
+  EXPORTCPUCOREMATH void half_to_complex(const hoNDArray<complex_half>& x, hoNDArray< std::complex<float> >& r);
+}
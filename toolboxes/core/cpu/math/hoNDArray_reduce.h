@@ -0,0 +1,164 @@
+/** \file   hoNDArray_reduce.h
+    \brief  Deterministic, parallel reduction engine behind the functions of hoNDArray_reductions.
+
+            The data is cut into blocks of ReduceBlockSize elements. Each block is reduced with eight
+            interleaved accumulators, which the compiler turns into SIMD lanes without reassociating
+            anything, and the block results are then combined pairwise in a fixed tree. Threads only
+            decide who reduces which block, so the result depends on the number of elements but never
+            on the number of threads, and the rounding error of a sum grows with log(N) instead of N.
+
+              float s = hoNDReduce::sum<float>(N, [pX](size_t i) { return pX[i]*pX[i]; });
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+#include "complext.h"
+
+#ifdef USE_OMP
+    #include <omp.h>
+#endif // USE_OMP
+
+namespace Gadgetron{
+
+  struct hoNDReduce
+  {
+    enum
+    {
+      ReduceBlockSize = 4096,
+      ReduceNumElementsUseThreading = 64*1024
+    };
+
+    /// |re|+|im| for complex values, as BLAS i?amax and ?asum use it
+    static float abs1(float v) { return std::abs(v); }
+    static double abs1(double v) { return std::abs(v); }
+    template <typename T> static T abs1(const std::complex<T>& v) { return std::abs(v.real()) + std::abs(v.imag()); }
+    template <typename T> static T abs1(const complext<T>& v) { return std::abs(v.real()) + std::abs(v.imag()); }
+
+    /// sqrt(re*re + im*im) for complex values
+    static float magnitude(float v) { return std::abs(v); }
+    static double magnitude(double v) { return std::abs(v); }
+    template <typename T> static T magnitude(const std::complex<T>& v) { return std::sqrt(v.real()*v.real() + v.imag()*v.imag()); }
+    template <typename T> static T magnitude(const complext<T>& v) { return std::sqrt(v.real()*v.real() + v.imag()*v.imag()); }
+
+    /// Squared magnitude
+    static float norm(float v) { return v*v; }
+    static double norm(double v) { return v*v; }
+    template <typename T> static T norm(const std::complex<T>& v) { return v.real()*v.real() + v.imag()*v.imag(); }
+    template <typename T> static T norm(const complext<T>& v) { return v.real()*v.real() + v.imag()*v.imag(); }
+
+    /// a*b and a*conj(b), spelled out so complex products are not routed through the C99 NaN checks
+    static float mul(float a, float b) { return a*b; }
+    static double mul(double a, double b) { return a*b; }
+    template <typename C> static C mul(const C& a, const C& b)
+    {
+      return C(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+    }
+
+    static float mul_conj(float a, float b) { return a*b; }
+    static double mul_conj(double a, double b) { return a*b; }
+    template <typename C> static C mul_conj(const C& a, const C& b)
+    {
+      return C(a.real()*b.real() + a.imag()*b.imag(), a.imag()*b.real() - a.real()*b.imag());
+    }
+
+    /// Sum of f(i) for i in [first, first+len), eight interleaved accumulators
+    template <typename S, typename F> static S sum_block(size_t first, size_t len, const F& f)
+    {
+      S a0(0), a1(0), a2(0), a3(0), a4(0), a5(0), a6(0), a7(0);
+
+      size_t i = first;
+      const size_t end = first + len;
+      for (; i + 8 <= end; i += 8) {
+        a0 += f(i);
+        a1 += f(i + 1);
+        a2 += f(i + 2);
+        a3 += f(i + 3);
+        a4 += f(i + 4);
+        a5 += f(i + 5);
+        a6 += f(i + 6);
+        a7 += f(i + 7);
+      }
+      for (; i < end; i++) a0 += f(i);
+
+      return ((a0 + a1) + (a2 + a3)) + ((a4 + a5) + (a6 + a7));
+    }
+
+    /// Combines r[0..n) pairwise in place, the result is left in r[0]
+    template <typename S, typename C> static void combine_pairwise(std::vector<S>& r, const C& c)
+    {
+      const size_t n = r.size();
+      for (size_t step = 1; step < n; step *= 2) {
+        for (size_t i = 0; i + step < n; i += 2*step) {
+          r[i] = c(r[i], r[i + step]);
+        }
+      }
+    }
+
+    /// Sum of f(i) for i in [0, N)
+    template <typename S, typename F> static S sum(size_t N, const F& f)
+    {
+      if (N == 0) return S(0);
+
+      const size_t nb = (N + ReduceBlockSize - 1) / ReduceBlockSize;
+      if (nb == 1) return sum_block<S>(0, N, f);
+
+      std::vector<S> partial(nb);
+      long long b;
+
+#pragma omp parallel for private(b) shared(partial, f) if (N > ReduceNumElementsUseThreading)
+      for (b = 0; b < (long long)nb; b++) {
+        const size_t first = (size_t)b*ReduceBlockSize;
+        partial[b] = sum_block<S>(first, std::min((size_t)ReduceBlockSize, N - first), f);
+      }
+
+      combine_pairwise(partial, [](const S& x, const S& y) { return x + y; });
+      return partial[0];
+    }
+
+    /**
+       Index of the element with the largest f(i), the first one of equal values, 0 for N == 0.
+       With less = true the index of the smallest.
+     */
+    template <typename F> static size_t arg_extreme(size_t N, const F& f, bool less = false)
+    {
+      if (N == 0) return 0;
+
+      typedef decltype(f(0)) value_type;
+      typedef std::pair<value_type, size_t> Candidate;
+
+      // a before b, b only wins if it is strictly better; on ties the lower index stays
+      auto better = [less](const Candidate& a, const Candidate& b) {
+        return less ? (b.first < a.first) : (b.first > a.first);
+      };
+
+      const size_t nb = (N + ReduceBlockSize - 1) / ReduceBlockSize;
+      std::vector<Candidate> partial(nb);
+      long long b;
+
+#pragma omp parallel for private(b) shared(partial, f) if (N > ReduceNumElementsUseThreading)
+      for (b = 0; b < (long long)nb; b++) {
+        const size_t first = (size_t)b*ReduceBlockSize;
+        const size_t end = std::min(first + ReduceBlockSize, N);
+
+        Candidate c(f(first), first);
+        for (size_t i = first + 1; i < end; i++) {
+          value_type v = f(i);
+          if (less ? (v < c.first) : (v > c.first)) {
+            c.first = v;
+            c.second = i;
+          }
+        }
+        partial[b] = c;
+      }
+
+      combine_pairwise(partial, [&better](const Candidate& x, const Candidate& y) { return better(x, y) ? y : x; });
+      return partial[0].second;
+    }
+  };
+}
@@ -1,5 +1,6 @@
 #include "hoNDArray_reductions.h"
 #include "hoArmadillo.h"
+#include "hoNDArray_reduce.h"
 
 #ifndef lapack_int
     #define lapack_int int
@@ -15,40 +16,39 @@
 
 #define NumElementsUseThreading 64*1024
 
-//Declaration of BLAS and LAPACK routines
-extern "C"
-{
-    /// Finds the index of the element with the maximal absolute value.
-    lapack_int isamax_(lapack_int* N, float* x, lapack_int* incx);
-    lapack_int idamax_(lapack_int* N, double* x, lapack_int* incx);
-    lapack_int icamax_(lapack_int* N, lapack_complex_float* x, lapack_int* incx);
-    lapack_int izamax_(lapack_int* N, lapack_complex_double* x, lapack_int* incx);
-}
-
 namespace Gadgetron{
 
     // --------------------------------------------------------------------------------
 
     template<class REAL> REAL max(hoNDArray<REAL>* data){
-        return as_arma_col(data).max();
+        if (data == 0x0 || data->get_number_of_elements() == 0)
+            throw std::runtime_error("Gadgetron::max(): Invalid input array");
+
+        const REAL* pX = data->begin();
+        return pX[hoNDReduce::arg_extreme(data->get_number_of_elements(), [pX](size_t i) { return pX[i]; })];
     }
 
     // --------------------------------------------------------------------------------
 
     template<class REAL> REAL min(hoNDArray<REAL>* data){
-        return as_arma_col(data).min();
+        if (data == 0x0 || data->get_number_of_elements() == 0)
+            throw std::runtime_error("Gadgetron::min(): Invalid input array");
+
+        const REAL* pX = data->begin();
+        return pX[hoNDReduce::arg_extreme(data->get_number_of_elements(), [pX](size_t i) { return pX[i]; }, true)];
     }
 
     // --------------------------------------------------------------------------------
 
     template<class T> T mean(hoNDArray<T>* data){
-        return (typename stdType<T>::Type) arma::mean(as_arma_col(data));
+        return sum(data) / typename realType<T>::Type(data->get_number_of_elements());
     }
 
     // --------------------------------------------------------------------------------
 
     template<class T> T sum(hoNDArray<T>* data){
-        return (typename stdType<T>::Type) arma::sum(as_arma_col(data));
+        const T* pX = data->begin();
+        return hoNDReduce::sum<T>(data->get_number_of_elements(), [pX](size_t i) { return pX[i]; });
     }
 
     // --------------------------------------------------------------------------------
@@ -79,70 +79,21 @@ namespace Gadgetron{
         if( x->get_number_of_elements() != y->get_number_of_elements() )
             throw std::runtime_error("Gadgetron::dot(): Array sizes mismatch");
 
-        arma::Col<typename stdType<T>::Type> xM = as_arma_col(x);
-        arma::Col<typename stdType<T>::Type> yM = as_arma_col(y);
-        typename stdType<T>::Type res = (cc) ? arma::cdot(xM,yM) : arma::dot(xM,yM);
-        return *((T*)(&res));
-    }
-
-    // --------------------------------------------------------------------------------
-
-    inline void asum(size_t N, const float* x, float& r)
-    {
-        long long i;
-        float sum(0);
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            sum += std::abs(x[i]);
-        }
-
-        r = sum;
-    }
-
-    inline void asum(size_t N, const double* x, double& r)
-    {
-        long long i;
-        double sum(0);
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            sum += std::abs(x[i]);
-        }
+        const T* pX = x->begin();
+        const T* pY = y->begin();
+        size_t N = x->get_number_of_elements();
 
-        r = sum;
+        // cc: conj(x) dot y
+        if (cc) return hoNDReduce::sum<T>(N, [pX, pY](size_t i) { return hoNDReduce::mul_conj(pY[i], pX[i]); });
+        return hoNDReduce::sum<T>(N, [pX, pY](size_t i) { return hoNDReduce::mul(pX[i], pY[i]); });
     }
 
-    inline void asum(size_t N, const  std::complex<float> * x, float& r)
-    {
-        long long i;
-        float sum(0);
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const  std::complex<float> & c = x[i];
-            const float re = c.real();
-            const float im = c.imag();
-            sum += ( std::abs(re) + std::abs(im) );
-        }
-
-        r = sum;
-    }
+    // --------------------------------------------------------------------------------
 
-    inline void asum(size_t N, const  std::complex<double> * x, double& r)
+    template <typename T> inline
+    void asum(size_t N, const T* x, typename realType<T>::Type& r)
     {
-        long long i;
-        double sum(0);
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const  std::complex<double> & c = x[i];
-            const double re = c.real();
-            const double im = c.imag();
-            sum += ( std::abs(re) + std::abs(im) );
-        }
-
-        r = sum;
+        r = hoNDReduce::sum<typename realType<T>::Type>(N, [x](size_t i) { return hoNDReduce::abs1(x[i]); });
     }
 
     template<class T> void asum(const hoNDArray<T>& x, typename realType<T>::Type& r)
@@ -172,9 +123,7 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::asum(): Invalid input array");
 
-        typedef typename realType<T>::Type realT;
-        arma::Col<typename stdType<T>::Type> xM = as_arma_col(x);
-        return realT(arma::norm(xM,1));
+        return asum(*x);
     }
 
     template<class T> T asum( hoNDArray< std::complex<T> > *x )
@@ -182,7 +131,7 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::asum(): Invalid input array");
 
-        return arma::norm(arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x))),1);
+        return asum(*x);
     }
 
     template<class T> T asum( hoNDArray< complext<T> > *x )
@@ -190,68 +139,15 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::asum(): Invalid input array");
 
-        return arma::norm(arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x))),1);
+        return asum(*x);
     }
 
     // --------------------------------------------------------------------------------
 
-    template <typename T> inline 
+    template <typename T> inline
     void norm1(size_t N, const T* x, typename realType<T>::Type& r)
     {
-        long long n;
-
-        typename realType<T>::Type norm1Sum(0);
-
-        #pragma omp parallel for private(n) reduction(+:norm1Sum) if (N>NumElementsUseThreading)
-        for (n=0; n<(long long)N; n++)
-        {
-            const T& c = x[n];
-            norm1Sum += std::abs(c);
-        }
-
-        r = norm1Sum;
-    }
-
-    inline void norm1(size_t N, const  std::complex<float> * x, float& r)
-    {
-        long long i;
-        float sum = 0.0f;
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const std::complex<float>& c = x[i];
-            const float re = c.real();
-            const float im = c.imag();
-            sum += std::sqrt( (re*re) + (im * im) );
-        }
-
-        r = sum;
-    }
-
-    inline void norm1(size_t N, const  complext<float> * x, float& r)
-    {
-        norm1(N, (std::complex<float> *)x, r);
-    }
-
-    inline void norm1(size_t N, const  std::complex<double> * x, double& r)
-    {
-        long long i;
-        double sum = 0.0;
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const std::complex<double>& c = x[i];
-            const double re = c.real();
-            const double im = c.imag();
-            sum += std::sqrt( (re*re) + (im * im) );
-        }
-
-        r = sum;
-    }
-
-    inline void norm1(size_t N, const  complext<double> * x, double& r)
-    {
-        norm1(N, (std::complex<double> *)x, r);
+        r = hoNDReduce::sum<typename realType<T>::Type>(N, [x](size_t i) { return hoNDReduce::magnitude(x[i]); });
     }
 
     template <typename T> 
@@ -296,82 +192,10 @@ namespace Gadgetron{
 
     // --------------------------------------------------------------------------------
 
-    inline void norm2(size_t N, const float* x, float& r)
-    {
-        long long i;
-
-        float sum(0);
-
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const float& re = x[i];
-            sum += ( re*re );
-        }
-
-        r = std::sqrt(sum);
-    }
-
-    inline void norm2(size_t N, const double* x, double& r)
+    template <typename T> inline
+    void norm2(size_t N, const T* x, typename realType<T>::Type& r)
     {
-        long long i;
-
-        double sum(0);
-
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const double& re = x[i];
-            sum += ( re*re );
-        }
-
-        r = std::sqrt(sum);
-    }
-
-    inline void norm2(size_t N, const  std::complex<float> * x, float& r)
-    {
-        long long i;
-
-        float sum(0);
-
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const std::complex<float>& c = x[i];
-            const float re = c.real();
-            const float im = c.imag();
-            sum += ( (re*re) + (im * im) );
-        }
-
-        r = std::sqrt(sum);
-    }
-
-    inline void norm2(size_t N, const  complext<float> * x, float& r)
-    {
-        norm2(N, (std::complex<float> *)x, r);
-    }
-
-    inline void norm2(size_t N, const  std::complex<double> * x, double& r)
-    {
-        long long i;
-
-        double sum(0);
-
-        #pragma omp parallel for private(i) reduction(+:sum) if (N>NumElementsUseThreading)
-        for (i = 0; i < (long long)N; i++)
-        {
-            const std::complex<double>& c = x[i];
-            const double re = c.real();
-            const double im = c.imag();
-            sum += ( (re*re) + (im * im) );
-        }
-
-        r = std::sqrt(sum);
-    }
-
-    inline void norm2(size_t N, const  complext<double> * x, double& r)
-    {
-        norm2(N, (std::complex<double> *)x, r);
+        r = std::sqrt(hoNDReduce::sum<typename realType<T>::Type>(N, [x](size_t i) { return hoNDReduce::norm(x[i]); }));
     }
 
     template <typename T> 
@@ -454,11 +278,8 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amin(): Invalid input array");
 
-        typedef typename realType<T>::Type realT;
-        arma::Col<realT> xM = arma::abs(as_arma_col(x));
-        arma::uword idx;
-        realT min = xM.min(idx);
-        return idx;
+        const auto* pX = x->begin();
+        return hoNDReduce::arg_extreme(x->get_number_of_elements(), [pX](size_t i) { return hoNDReduce::abs1(pX[i]); }, true);
     }
 
     template<class T> size_t amin( hoNDArray< std::complex<T> > *x )
@@ -466,10 +287,8 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amin(): Invalid input array");
 
-        arma::Col<T> xM = arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x)));
-        arma::uword idx;
-        T min = xM.min(idx);
-        return idx;
+        const auto* pX = x->begin();
+        return hoNDReduce::arg_extreme(x->get_number_of_elements(), [pX](size_t i) { return hoNDReduce::abs1(pX[i]); }, true);
     }
 
     template<class T> size_t amin( hoNDArray< complext<T> > *x )
@@ -477,10 +296,8 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amin(): Invalid input array");
 
-        arma::Col<T> xM = arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x)));
-        arma::uword idx;
-        T min = xM.min(idx);
-        return idx;
+        const auto* pX = x->begin();
+        return hoNDReduce::arg_extreme(x->get_number_of_elements(), [pX](size_t i) { return hoNDReduce::abs1(pX[i]); }, true);
     }
 
     // --------------------------------------------------------------------------------
@@ -520,36 +337,11 @@ namespace Gadgetron{
 
     // --------------------------------------------------------------------------------
 
-    inline size_t amax(size_t N, const float* x)
+    // index of the first element of the largest |re|+|im|, as BLAS i?amax
+    template <typename T> inline
+    size_t amax(size_t N, const T* x)
     {
-        lapack_int num = (lapack_int)(N);
-        lapack_int incx = 1;
-
-        return isamax_(&num, (float*)(x), &incx) - size_t(1);
-    }
-
-    inline size_t amax(size_t N, const double* x)
-    {
-        lapack_int num = (lapack_int)(N);
-        lapack_int incx = 1;
-
-        return idamax_(&num, (double*)(x), &incx) - size_t(1);
-    }
-
-    inline size_t amax(size_t N, const  std::complex<float> * x)
-    {
-        lapack_int num = (lapack_int)(N);
-        lapack_int incx = 1;
-
-        return icamax_(&num, (lapack_complex_float*)(x), &incx) - size_t(1);
-    }
-
-    inline size_t amax(size_t N, const  std::complex<double> * x)
-    {
-        lapack_int num = (lapack_int)(N);
-        lapack_int incx = 1;
-
-        return izamax_(&num, (lapack_complex_double*)(x), &incx) - size_t(1);
+        return hoNDReduce::arg_extreme(N, [x](size_t i) { return hoNDReduce::abs1(x[i]); });
     }
 
     template<class T> size_t amax(const hoNDArray<T>& x)
@@ -567,11 +359,7 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amax(): Invalid input array");
 
-        typedef typename realType<T>::Type realT;
-        arma::Col<realT> xM = arma::abs(as_arma_col(x));
-        arma::uword idx;
-        realT max = xM.max(idx);
-        return idx;
+        return amax(x->get_number_of_elements(), x->begin());
     }
 
     template<class T> size_t amax( hoNDArray< std::complex<T> > *x )
@@ -579,10 +367,7 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amax(): Invalid input array");
 
-        arma::Col<T> xM = arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x)));
-        arma::uword idx;
-        T max = xM.max(idx);
-        return idx;
+        return amax(x->get_number_of_elements(), x->begin());
     }
 
     template<class T> size_t amax( hoNDArray< complext<T> > *x )
@@ -590,10 +375,7 @@ namespace Gadgetron{
         if( x == 0x0 )
             throw std::runtime_error("Gadgetron::amax(): Invalid input array");
 
-        arma::Col<T> xM = arma::abs(real(as_arma_col(x)))+arma::abs(imag(as_arma_col(x)));
-        arma::uword idx;
-        T max = xM.max(idx);
-        return idx;
+        return amax(x->get_number_of_elements(), x->begin());
     }
 
     // --------------------------------------------------------------------------------
@@ -679,92 +461,10 @@ namespace Gadgetron{
 
     // --------------------------------------------------------------------------------
 
-    inline void dotc(size_t N, const  std::complex<float> * x, const  std::complex<float> * y,  std::complex<float> & r)
-    {
-        long long n;
-
-        float sa(0), sb(0);
-
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const float a = x[n].real();
-            const float b = x[n].imag();
-            const float c = y[n].real();
-            const float d = y[n].imag();
-
-            sa += (a*c + b*d);
-            sb += (c*b - a*d);
-        }
-
-        reinterpret_cast<float(&)[2]>(r)[0] = sa;
-        reinterpret_cast<float(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotc(size_t N, const  std::complex<double> * x, const  std::complex<double> * y,  std::complex<double> & r)
+    template <typename T> inline
+    void dotc(size_t N, const T* x, const T* y, T& r)
     {
-        long long n;
-
-        double sa(0), sb(0);
-
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const double a = x[n].real();
-            const double b = x[n].imag();
-            const double c = y[n].real();
-            const double d = y[n].imag();
-
-            sa += (a*c + b*d);
-            sb += (c*b - a*d);
-        }
-
-        reinterpret_cast<double(&)[2]>(r)[0] = sa;
-        reinterpret_cast<double(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotc(size_t N, const  complext<float> * x, const  complext<float> * y,  complext<float> & r)
-    {
-        long long n;
-
-        float sa(0), sb(0);
-
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const float a = x[n].real();
-            const float b = x[n].imag();
-            const float c = y[n].real();
-            const float d = y[n].imag();
-
-            sa += (a*c + b*d);
-            sb += (c*b - a*d);
-        }
-
-        reinterpret_cast<float(&)[2]>(r)[0] = sa;
-        reinterpret_cast<float(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotc(size_t N, const  complext<double> * x, const  complext<double> * y,  complext<double> & r)
-    {
-        long long n;
-
-        double sa(0), sb(0);
-
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const double a = x[n].real();
-            const double b = x[n].imag();
-            const double c = y[n].real();
-            const double d = y[n].imag();
-
-            sa += (a*c + b*d);
-            sb += (c*b - a*d);
-        }
-
-        reinterpret_cast<double(&)[2]>(r)[0] = sa;
-        reinterpret_cast<double(&)[2]>(r)[1] = sb;
+        r = hoNDReduce::sum<T>(N, [x, y](size_t i) { return hoNDReduce::mul_conj(x[i], y[i]); });
     }
 
     template <typename T> 
@@ -794,118 +494,10 @@ namespace Gadgetron{
 
     // --------------------------------------------------------------------------------
 
-    inline void dotu(size_t N, const float* x, const float* y, float& r)
-    {
-        long long n;
-
-        float res(0);
-
-        #pragma omp parallel for private(n) reduction(+:res) if (N>NumElementsUseThreading)
-        for (n=0; n<(long long)N; n++)
-        {
-            res += x[n]*y[n];
-        }
-
-        r = res;
-    }
-
-    inline void dotu(size_t N, const double* x, const double* y, double& r)
-    {
-        long long n;
-
-        double res(0);
-
-        #pragma omp parallel for private(n) reduction(+:res) if (N>NumElementsUseThreading)
-        for (n=0; n<(long long)N; n++)
-        {
-            res += x[n]*y[n];
-        }
-
-        r = res;
-    }
-
-    inline void dotu(size_t N, const  std::complex<float> * x, const  std::complex<float> * y,  std::complex<float> & r)
-    {
-        long long n;
-
-        float sa(0), sb(0);
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const float a = x[n].real();
-            const float b = x[n].imag();
-            const float c = y[n].real();
-            const float d = y[n].imag();
-
-            sa += (a*c - b*d);
-            sb += (c*b + a*d);
-        }
-
-        reinterpret_cast<float(&)[2]>(r)[0] = sa;
-        reinterpret_cast<float(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotu(size_t N, const  std::complex<double> * x, const  std::complex<double> * y,  std::complex<double> & r)
+    template <typename T> inline
+    void dotu(size_t N, const T* x, const T* y, T& r)
     {
-        long long n;
-
-        double sa(0), sb(0);
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const double a = x[n].real();
-            const double b = x[n].imag();
-            const double c = y[n].real();
-            const double d = y[n].imag();
-
-            sa += (a*c - b*d);
-            sb += (c*b + a*d);
-        }
-
-        reinterpret_cast<double(&)[2]>(r)[0] = sa;
-        reinterpret_cast<double(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotu(size_t N, const  complext<float> * x, const  complext<float> * y,  complext<float> & r)
-    {
-        long long n;
-
-        float sa(0), sb(0);
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const float a = x[n].real();
-            const float b = x[n].imag();
-            const float c = y[n].real();
-            const float d = y[n].imag();
-
-            sa += (a*c - b*d);
-            sb += (c*b + a*d);
-        }
-
-        reinterpret_cast<float(&)[2]>(r)[0] = sa;
-        reinterpret_cast<float(&)[2]>(r)[1] = sb;
-    }
-
-    inline void dotu(size_t N, const  complext<double> * x, const  complext<double> * y,  complext<double> & r)
-    {
-        long long n;
-
-        double sa(0), sb(0);
-        #pragma omp parallel for private(n) reduction(+:sa) reduction(+:sb) if (N>NumElementsUseThreading)
-        for (n = 0; n < (long long)N; n++)
-        {
-            const double a = x[n].real();
-            const double b = x[n].imag();
-            const double c = y[n].real();
-            const double d = y[n].imag();
-
-            sa += (a*c - b*d);
-            sb += (c*b + a*d);
-        }
-
-        reinterpret_cast<double(&)[2]>(r)[0] = sa;
-        reinterpret_cast<double(&)[2]>(r)[1] = sb;
+        r = hoNDReduce::sum<T>(N, [x, y](size_t i) { return hoNDReduce::mul(x[i], y[i]); });
     }
 
     template <typename T> 
@@ -0,0 +1,855 @@
+#include "hoNDArray_simd.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <atomic>
+
+#ifdef USE_OMP
+    #include <omp.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define GADGETRON_SIMD_X86
+    #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    #define GADGETRON_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+#define NumElementsUseThreading 64*1024
+
+namespace Gadgetron{
+
+  namespace
+  {
+    // ----------------------------------------------------------------------------
+    // scalar kernels, also used for the tails of the vector kernels
+    // ----------------------------------------------------------------------------
+
+    void multiply_scalar(size_t N, const float* x, const float* y, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float a = x[2*n], b = x[2*n+1], c = y[2*n], d = y[2*n+1];
+        r[2*n] = a*c - b*d;
+        r[2*n+1] = a*d + b*c;
+      }
+    }
+
+    void multiplyConj_scalar(size_t N, const float* x, const float* y, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float a = x[2*n], b = x[2*n+1], c = y[2*n], d = y[2*n+1];
+        r[2*n] = a*c + b*d;
+        r[2*n+1] = b*c - a*d;
+      }
+    }
+
+    void abs_scalar(size_t N, const float* x, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float a = x[2*n], b = x[2*n+1];
+        r[n] = std::sqrt(a*a + b*b);
+      }
+    }
+
+    void conjugate_scalar(size_t N, const float* x, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        r[2*n] = x[2*n];
+        r[2*n+1] = -x[2*n+1];
+      }
+    }
+
+    void axpy_scalar(float ar, float ai, size_t N, const float* x, const float* y, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float a = x[2*n], b = x[2*n+1];
+        r[2*n] = y[2*n] + ar*a - ai*b;
+        r[2*n+1] = y[2*n+1] + ar*b + ai*a;
+      }
+    }
+
+    // F floats of the interleaved lines, the real taps scale real and imaginary parts alike
+    void halfband_scalar(size_t F, size_t P, float h0, const float* h, const float* e, const float* o, float* r)
+    {
+      for (size_t q = 0; q < F; q++) {
+        const float* oq = o + q;
+        float acc = h0*e[q];
+        for (size_t j = 0; j < P; j++) acc += h[j]*(*(oq - 2*j - 2) + oq[2*j]);
+        r[q] = acc;
+      }
+    }
+
+    // sin and cos of 2*pi*t, with t reduced to [-1/8, 1/8] turns around the nearest quarter turn
+    inline void sincos_turns(float t, float& c, float& s)
+    {
+      const float q = std::floor(4.0f*t + 0.5f);
+      const float a = 6.28318530718f*(t - 0.25f*q);
+      const float a2 = a*a;
+      const float sa = a*(1.0f + a2*(-1.66666667e-1f + a2*(8.33333333e-3f + a2*(-1.98412698e-4f))));
+      const float ca = 1.0f + a2*(-0.5f + a2*(4.16666667e-2f + a2*(-1.38888889e-3f + a2*2.48015873e-5f)));
+
+      switch ((int)((long long)q & 3)) {
+        case 0: c = ca; s = sa; break;
+        case 1: c = -sa; s = ca; break;
+        case 2: c = -ca; s = -sa; break;
+        default: c = sa; s = -ca; break;
+      }
+    }
+
+    // r[n] = x[n]*exp(i*2*pi*(c0 + c1*n + c2*n^2))
+    void multiplyPhase_scalar(size_t N, float c0, float c1, float c2, const float* x, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float fn = (float)n;
+        float c, s;
+        sincos_turns(c0 + fn*(c1 + fn*c2), c, s);
+        const float a = x[2*n], b = x[2*n+1];
+        r[2*n] = a*c - b*s;
+        r[2*n+1] = a*s + b*c;
+      }
+    }
+
+    // r = (|x| + |y|)/2 * exp(i*(arg(y) - arg(x))), as y*conj(x) scaled; a zero x or y has the phase 0
+    void phaseDifference_scalar(size_t N, const float* x, const float* y, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const float a = x[2*n], b = x[2*n+1], c = y[2*n], d = y[2*n+1];
+        const float ax = std::sqrt(a*a + b*b), ay = std::sqrt(c*c + d*d);
+        const float den = ax*ay;
+        if (den > 0) {
+          const float g = 0.5f*(ax + ay)/den;
+          r[2*n] = g*(c*a + d*b);
+          r[2*n+1] = g*(d*a - c*b);
+        } else {
+          r[2*n] = 0.5f*(c + a);
+          r[2*n+1] = 0.5f*(d - b);
+        }
+      }
+    }
+
+#ifdef GADGETRON_SIMD_X86
+
+    // ----------------------------------------------------------------------------
+    // AVX2 + FMA, 4 complex values per register
+    // ----------------------------------------------------------------------------
+
+    __attribute__((target("avx2,fma")))
+    void multiply_avx2(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        __m256 a = _mm256_loadu_ps(x + 2*n);
+        __m256 b = _mm256_loadu_ps(y + 2*n);
+        __m256 t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(b));
+        _mm256_storeu_ps(r + 2*n, _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(b), t));
+      }
+      multiply_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void multiplyConj_avx2(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        __m256 a = _mm256_loadu_ps(x + 2*n);
+        __m256 b = _mm256_loadu_ps(y + 2*n);
+        __m256 t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(b));
+        _mm256_storeu_ps(r + 2*n, _mm256_fmsubadd_ps(a, _mm256_moveldup_ps(b), t));
+      }
+      multiplyConj_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void abs_avx2(size_t N, const float* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m256 a = _mm256_loadu_ps(x + 2*n);
+        __m256 b = _mm256_loadu_ps(x + 2*n + 8);
+        // within 128 bit lanes: [c0 c1 c4 c5 | c2 c3 c6 c7]
+        __m256 s = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+        s = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), 0xD8));
+        _mm256_storeu_ps(r + n, _mm256_sqrt_ps(s));
+      }
+      abs_scalar(N - n, x + 2*n, r + n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void conjugate_avx2(size_t N, const float* x, float* r)
+    {
+      const __m256 sign = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        _mm256_storeu_ps(r + 2*n, _mm256_xor_ps(_mm256_loadu_ps(x + 2*n), sign));
+      }
+      conjugate_scalar(N - n, x + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void axpy_avx2(float ar, float ai, size_t N, const float* x, const float* y, float* r)
+    {
+      const __m256 vr = _mm256_set1_ps(ar);
+      const __m256 vi = _mm256_set1_ps(ai);
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        __m256 a = _mm256_loadu_ps(x + 2*n);
+        __m256 t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), vi);
+        __m256 p = _mm256_fmaddsub_ps(a, vr, t);
+        _mm256_storeu_ps(r + 2*n, _mm256_add_ps(p, _mm256_loadu_ps(y + 2*n)));
+      }
+      axpy_scalar(ar, ai, N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void halfband_avx2(size_t F, size_t P, float h0, const float* h, const float* e, const float* o, float* r)
+    {
+      const __m256 v0 = _mm256_set1_ps(h0);
+      size_t q = 0;
+      for (; q + 8 <= F; q += 8) {
+        __m256 acc = _mm256_mul_ps(v0, _mm256_loadu_ps(e + q));
+        for (size_t j = 0; j < P; j++) {
+          __m256 s = _mm256_add_ps(_mm256_loadu_ps(o + q - 2*j - 2), _mm256_loadu_ps(o + q + 2*j));
+          acc = _mm256_fmadd_ps(_mm256_set1_ps(h[j]), s, acc);
+        }
+        _mm256_storeu_ps(r + q, acc);
+      }
+      halfband_scalar(F - q, P, h0, h, e + q, o + q, r + q);
+    }
+
+    // cos and sin of 2*pi*t for 8 phases in turns, see sincos_turns
+    __attribute__((target("avx2,fma")))
+    inline void sincos_turns_avx2(__m256 t, __m256& c, __m256& s)
+    {
+      const __m256 q = _mm256_round_ps(_mm256_mul_ps(t, _mm256_set1_ps(4.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      const __m256 a = _mm256_mul_ps(_mm256_set1_ps(6.28318530718f), _mm256_fnmadd_ps(q, _mm256_set1_ps(0.25f), t));
+      const __m256 a2 = _mm256_mul_ps(a, a);
+
+      __m256 sp = _mm256_fmadd_ps(a2, _mm256_set1_ps(-1.98412698e-4f), _mm256_set1_ps(8.33333333e-3f));
+      sp = _mm256_fmadd_ps(a2, sp, _mm256_set1_ps(-1.66666667e-1f));
+      sp = _mm256_fmadd_ps(a2, sp, _mm256_set1_ps(1.0f));
+      const __m256 sa = _mm256_mul_ps(a, sp);
+
+      __m256 cp = _mm256_fmadd_ps(a2, _mm256_set1_ps(2.48015873e-5f), _mm256_set1_ps(-1.38888889e-3f));
+      cp = _mm256_fmadd_ps(a2, cp, _mm256_set1_ps(4.16666667e-2f));
+      cp = _mm256_fmadd_ps(a2, cp, _mm256_set1_ps(-0.5f));
+      const __m256 ca = _mm256_fmadd_ps(a2, cp, _mm256_set1_ps(1.0f));
+
+      // odd quadrants swap cos and sin, quadrants 1, 2 negate cos and 2, 3 negate sin
+      const __m256i qi = _mm256_cvtps_epi32(q);
+      const __m256 swap = _mm256_castsi256_ps(_mm256_slli_epi32(qi, 31));
+      const __m256 negc = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(_mm256_add_epi32(qi, _mm256_set1_epi32(1)), 1), 31));
+      const __m256 negs = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(qi, 1), 31));
+      c = _mm256_xor_ps(_mm256_blendv_ps(ca, sa, swap), negc);
+      s = _mm256_xor_ps(_mm256_blendv_ps(sa, ca, swap), negs);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void multiplyPhase_avx2(size_t N, float c0, float c1, float c2, const float* x, float* r)
+    {
+      const __m256 v0 = _mm256_set1_ps(c0), v1 = _mm256_set1_ps(c1), v2 = _mm256_set1_ps(c2);
+      __m256 fn = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m256 c, s;
+        sincos_turns_avx2(_mm256_fmadd_ps(fn, _mm256_fmadd_ps(fn, v2, v1), v0), c, s);
+        fn = _mm256_add_ps(fn, _mm256_set1_ps(8.0f));
+
+        // interleave to [c0 s0 c1 s1 c2 s2 c3 s3] and [c4 s4 ... c7 s7]
+        const __m256 l = _mm256_unpacklo_ps(c, s), h = _mm256_unpackhi_ps(c, s);
+        const __m256 e0 = _mm256_permute2f128_ps(l, h, 0x20), e1 = _mm256_permute2f128_ps(l, h, 0x31);
+
+        __m256 a = _mm256_loadu_ps(x + 2*n);
+        __m256 t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(e0));
+        _mm256_storeu_ps(r + 2*n, _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(e0), t));
+
+        a = _mm256_loadu_ps(x + 2*n + 8);
+        t = _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(e1));
+        _mm256_storeu_ps(r + 2*n + 8, _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(e1), t));
+      }
+      const float fm = (float)n;
+      multiplyPhase_scalar(N - n, c0 + fm*(c1 + fm*c2), c1 + 2*fm*c2, c2, x + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void phaseDifference_avx2(size_t N, const float* x, const float* y, float* r)
+    {
+      const __m256 half = _mm256_set1_ps(0.5f);
+      const __m256 sign = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        const __m256 a = _mm256_loadu_ps(x + 2*n);
+        const __m256 b = _mm256_loadu_ps(y + 2*n);
+
+        // |x| and |y| in both floats of every complex value
+        __m256 sx = _mm256_mul_ps(a, a), sy = _mm256_mul_ps(b, b);
+        sx = _mm256_add_ps(sx, _mm256_permute_ps(sx, 0xB1));
+        sy = _mm256_add_ps(sy, _mm256_permute_ps(sy, 0xB1));
+        const __m256 ax = _mm256_sqrt_ps(sx), ay = _mm256_sqrt_ps(sy);
+        const __m256 den = _mm256_mul_ps(ax, ay);
+
+        // y*conj(x)
+        const __m256 t = _mm256_mul_ps(_mm256_permute_ps(b, 0xB1), _mm256_movehdup_ps(a));
+        const __m256 p = _mm256_fmsubadd_ps(b, _mm256_moveldup_ps(a), t);
+
+        const __m256 g = _mm256_div_ps(_mm256_mul_ps(half, _mm256_add_ps(ax, ay)), den);
+        const __m256 z = _mm256_mul_ps(half, _mm256_add_ps(b, _mm256_xor_ps(a, sign)));
+        const __m256 nz = _mm256_cmp_ps(den, _mm256_setzero_ps(), _CMP_GT_OQ);
+        _mm256_storeu_ps(r + 2*n, _mm256_blendv_ps(z, _mm256_mul_ps(g, p), nz));
+      }
+      phaseDifference_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    // ----------------------------------------------------------------------------
+    // AVX-512, 8 complex values per register
+    // ----------------------------------------------------------------------------
+
+    __attribute__((target("avx512f")))
+    void multiply_avx512(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m512 a = _mm512_loadu_ps(x + 2*n);
+        __m512 b = _mm512_loadu_ps(y + 2*n);
+        __m512 t = _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(b));
+        _mm512_storeu_ps(r + 2*n, _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(b), t));
+      }
+      multiply_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx512f")))
+    void multiplyConj_avx512(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m512 a = _mm512_loadu_ps(x + 2*n);
+        __m512 b = _mm512_loadu_ps(y + 2*n);
+        __m512 t = _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(b));
+        _mm512_storeu_ps(r + 2*n, _mm512_fmsubadd_ps(a, _mm512_moveldup_ps(b), t));
+      }
+      multiplyConj_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx512f")))
+    void abs_avx512(size_t N, const float* x, float* r)
+    {
+      const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+      size_t n = 0;
+      for (; n + 16 <= N; n += 16) {
+        __m512 a = _mm512_loadu_ps(x + 2*n);
+        __m512 b = _mm512_loadu_ps(x + 2*n + 16);
+        a = _mm512_mul_ps(a, a);
+        b = _mm512_mul_ps(b, b);
+        a = _mm512_add_ps(a, _mm512_permute_ps(a, 0xB1));
+        b = _mm512_add_ps(b, _mm512_permute_ps(b, 0xB1));
+        _mm512_storeu_ps(r + n, _mm512_sqrt_ps(_mm512_permutex2var_ps(a, even, b)));
+      }
+      abs_scalar(N - n, x + 2*n, r + n);
+    }
+
+    __attribute__((target("avx512f")))
+    void conjugate_avx512(size_t N, const float* x, float* r)
+    {
+      const __m512i sign = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m512i v = _mm512_castps_si512(_mm512_loadu_ps(x + 2*n));
+        _mm512_storeu_ps(r + 2*n, _mm512_castsi512_ps(_mm512_xor_si512(v, sign)));
+      }
+      conjugate_scalar(N - n, x + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx512f")))
+    void axpy_avx512(float ar, float ai, size_t N, const float* x, const float* y, float* r)
+    {
+      const __m512 vr = _mm512_set1_ps(ar);
+      const __m512 vi = _mm512_set1_ps(ai);
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        __m512 a = _mm512_loadu_ps(x + 2*n);
+        __m512 t = _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), vi);
+        __m512 p = _mm512_fmaddsub_ps(a, vr, t);
+        _mm512_storeu_ps(r + 2*n, _mm512_add_ps(p, _mm512_loadu_ps(y + 2*n)));
+      }
+      axpy_scalar(ar, ai, N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx512f")))
+    void halfband_avx512(size_t F, size_t P, float h0, const float* h, const float* e, const float* o, float* r)
+    {
+      const __m512 v0 = _mm512_set1_ps(h0);
+      size_t q = 0;
+      for (; q + 16 <= F; q += 16) {
+        __m512 acc = _mm512_mul_ps(v0, _mm512_loadu_ps(e + q));
+        for (size_t j = 0; j < P; j++) {
+          __m512 s = _mm512_add_ps(_mm512_loadu_ps(o + q - 2*j - 2), _mm512_loadu_ps(o + q + 2*j));
+          acc = _mm512_fmadd_ps(_mm512_set1_ps(h[j]), s, acc);
+        }
+        _mm512_storeu_ps(r + q, acc);
+      }
+      halfband_scalar(F - q, P, h0, h, e + q, o + q, r + q);
+    }
+
+    // cos and sin of 2*pi*t for 16 phases in turns, see sincos_turns
+    __attribute__((target("avx512f")))
+    inline void sincos_turns_avx512(__m512 t, __m512& c, __m512& s)
+    {
+      const __m512 q = _mm512_roundscale_ps(_mm512_mul_ps(t, _mm512_set1_ps(4.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      const __m512 a = _mm512_mul_ps(_mm512_set1_ps(6.28318530718f), _mm512_fnmadd_ps(q, _mm512_set1_ps(0.25f), t));
+      const __m512 a2 = _mm512_mul_ps(a, a);
+
+      __m512 sp = _mm512_fmadd_ps(a2, _mm512_set1_ps(-1.98412698e-4f), _mm512_set1_ps(8.33333333e-3f));
+      sp = _mm512_fmadd_ps(a2, sp, _mm512_set1_ps(-1.66666667e-1f));
+      sp = _mm512_fmadd_ps(a2, sp, _mm512_set1_ps(1.0f));
+      const __m512 sa = _mm512_mul_ps(a, sp);
+
+      __m512 cp = _mm512_fmadd_ps(a2, _mm512_set1_ps(2.48015873e-5f), _mm512_set1_ps(-1.38888889e-3f));
+      cp = _mm512_fmadd_ps(a2, cp, _mm512_set1_ps(4.16666667e-2f));
+      cp = _mm512_fmadd_ps(a2, cp, _mm512_set1_ps(-0.5f));
+      const __m512 ca = _mm512_fmadd_ps(a2, cp, _mm512_set1_ps(1.0f));
+
+      const __m512i qi = _mm512_cvtps_epi32(q);
+      const __mmask16 swap = _mm512_test_epi32_mask(qi, _mm512_set1_epi32(1));
+      const __m512i negc = _mm512_slli_epi32(_mm512_srli_epi32(_mm512_add_epi32(qi, _mm512_set1_epi32(1)), 1), 31);
+      const __m512i negs = _mm512_slli_epi32(_mm512_srli_epi32(qi, 1), 31);
+      c = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_mask_blend_ps(swap, ca, sa)), negc));
+      s = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_mask_blend_ps(swap, sa, ca)), negs));
+    }
+
+    __attribute__((target("avx512f")))
+    void multiplyPhase_avx512(size_t N, float c0, float c1, float c2, const float* x, float* r)
+    {
+      const __m512 v0 = _mm512_set1_ps(c0), v1 = _mm512_set1_ps(c1), v2 = _mm512_set1_ps(c2);
+      const __m512i lo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+      const __m512i hi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+      __m512 fn = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+      size_t n = 0;
+      for (; n + 16 <= N; n += 16) {
+        __m512 c, s;
+        sincos_turns_avx512(_mm512_fmadd_ps(fn, _mm512_fmadd_ps(fn, v2, v1), v0), c, s);
+        fn = _mm512_add_ps(fn, _mm512_set1_ps(16.0f));
+
+        const __m512 e0 = _mm512_permutex2var_ps(c, lo, s), e1 = _mm512_permutex2var_ps(c, hi, s);
+
+        __m512 a = _mm512_loadu_ps(x + 2*n);
+        __m512 t = _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(e0));
+        _mm512_storeu_ps(r + 2*n, _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(e0), t));
+
+        a = _mm512_loadu_ps(x + 2*n + 16);
+        t = _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(e1));
+        _mm512_storeu_ps(r + 2*n + 16, _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(e1), t));
+      }
+      const float fm = (float)n;
+      multiplyPhase_scalar(N - n, c0 + fm*(c1 + fm*c2), c1 + 2*fm*c2, c2, x + 2*n, r + 2*n);
+    }
+
+    __attribute__((target("avx512f")))
+    void phaseDifference_avx512(size_t N, const float* x, const float* y, float* r)
+    {
+      const __m512 half = _mm512_set1_ps(0.5f);
+      const __m512i sign = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        const __m512 a = _mm512_loadu_ps(x + 2*n);
+        const __m512 b = _mm512_loadu_ps(y + 2*n);
+
+        __m512 sx = _mm512_mul_ps(a, a), sy = _mm512_mul_ps(b, b);
+        sx = _mm512_add_ps(sx, _mm512_permute_ps(sx, 0xB1));
+        sy = _mm512_add_ps(sy, _mm512_permute_ps(sy, 0xB1));
+        const __m512 ax = _mm512_sqrt_ps(sx), ay = _mm512_sqrt_ps(sy);
+        const __m512 den = _mm512_mul_ps(ax, ay);
+
+        const __m512 t = _mm512_mul_ps(_mm512_permute_ps(b, 0xB1), _mm512_movehdup_ps(a));
+        const __m512 p = _mm512_fmsubadd_ps(b, _mm512_moveldup_ps(a), t);
+
+        const __m512 g = _mm512_div_ps(_mm512_mul_ps(half, _mm512_add_ps(ax, ay)), den);
+        const __m512 ca = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), sign));
+        const __m512 z = _mm512_mul_ps(half, _mm512_add_ps(b, ca));
+        const __mmask16 nz = _mm512_cmp_ps_mask(den, _mm512_setzero_ps(), _CMP_GT_OQ);
+        _mm512_storeu_ps(r + 2*n, _mm512_mask_blend_ps(nz, z, _mm512_mul_ps(g, p)));
+      }
+      phaseDifference_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+#endif // GADGETRON_SIMD_X86
+
+#ifdef GADGETRON_SIMD_NEON
+
+    // ----------------------------------------------------------------------------
+    // NEON, 4 complex values de-interleaved into real and imaginary registers
+    // ----------------------------------------------------------------------------
+
+    void multiply_neon(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4x2_t b = vld2q_f32(y + 2*n);
+        float32x4x2_t c;
+        c.val[0] = vfmsq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+        c.val[1] = vfmaq_f32(vmulq_f32(a.val[0], b.val[1]), a.val[1], b.val[0]);
+        vst2q_f32(r + 2*n, c);
+      }
+      multiply_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    void multiplyConj_neon(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4x2_t b = vld2q_f32(y + 2*n);
+        float32x4x2_t c;
+        c.val[0] = vfmaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+        c.val[1] = vfmsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+        vst2q_f32(r + 2*n, c);
+      }
+      multiplyConj_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    void abs_neon(size_t N, const float* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4_t s = vfmaq_f32(vmulq_f32(a.val[0], a.val[0]), a.val[1], a.val[1]);
+        vst1q_f32(r + n, vsqrtq_f32(s));
+      }
+      abs_scalar(N - n, x + 2*n, r + n);
+    }
+
+    void conjugate_neon(size_t N, const float* x, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        a.val[1] = vnegq_f32(a.val[1]);
+        vst2q_f32(r + 2*n, a);
+      }
+      conjugate_scalar(N - n, x + 2*n, r + 2*n);
+    }
+
+    void axpy_neon(float ar, float ai, size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4x2_t c = vld2q_f32(y + 2*n);
+        c.val[0] = vfmsq_n_f32(vfmaq_n_f32(c.val[0], a.val[0], ar), a.val[1], ai);
+        c.val[1] = vfmaq_n_f32(vfmaq_n_f32(c.val[1], a.val[1], ar), a.val[0], ai);
+        vst2q_f32(r + 2*n, c);
+      }
+      axpy_scalar(ar, ai, N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+    void halfband_neon(size_t F, size_t P, float h0, const float* h, const float* e, const float* o, float* r)
+    {
+      size_t q = 0;
+      for (; q + 4 <= F; q += 4) {
+        float32x4_t acc = vmulq_n_f32(vld1q_f32(e + q), h0);
+        for (size_t j = 0; j < P; j++) {
+          float32x4_t s = vaddq_f32(vld1q_f32(o + q - 2*j - 2), vld1q_f32(o + q + 2*j));
+          acc = vfmaq_n_f32(acc, s, h[j]);
+        }
+        vst1q_f32(r + q, acc);
+      }
+      halfband_scalar(F - q, P, h0, h, e + q, o + q, r + q);
+    }
+
+    // cos and sin of 2*pi*t for 4 phases in turns, see sincos_turns
+    inline void sincos_turns_neon(float32x4_t t, float32x4_t& c, float32x4_t& s)
+    {
+      const float32x4_t q = vrndnq_f32(vmulq_n_f32(t, 4.0f));
+      const float32x4_t a = vmulq_n_f32(vfmsq_n_f32(t, q, 0.25f), 6.28318530718f);
+      const float32x4_t a2 = vmulq_f32(a, a);
+
+      float32x4_t sp = vfmaq_n_f32(vdupq_n_f32(8.33333333e-3f), a2, -1.98412698e-4f);
+      sp = vfmaq_f32(vdupq_n_f32(-1.66666667e-1f), a2, sp);
+      sp = vfmaq_f32(vdupq_n_f32(1.0f), a2, sp);
+      const float32x4_t sa = vmulq_f32(a, sp);
+
+      float32x4_t cp = vfmaq_n_f32(vdupq_n_f32(-1.38888889e-3f), a2, 2.48015873e-5f);
+      cp = vfmaq_f32(vdupq_n_f32(4.16666667e-2f), a2, cp);
+      cp = vfmaq_f32(vdupq_n_f32(-0.5f), a2, cp);
+      const float32x4_t ca = vfmaq_f32(vdupq_n_f32(1.0f), a2, cp);
+
+      const uint32x4_t qi = vreinterpretq_u32_s32(vcvtq_s32_f32(q));
+      const uint32x4_t swap = vtstq_u32(qi, vdupq_n_u32(1));
+      const uint32x4_t negc = vshlq_n_u32(vshrq_n_u32(vaddq_u32(qi, vdupq_n_u32(1)), 1), 31);
+      const uint32x4_t negs = vshlq_n_u32(vshrq_n_u32(qi, 1), 31);
+      c = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, sa, ca)), negc));
+      s = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, ca, sa)), negs));
+    }
+
+    void multiplyPhase_neon(size_t N, float c0, float c1, float c2, const float* x, float* r)
+    {
+      const float32x4_t v0 = vdupq_n_f32(c0), v1 = vdupq_n_f32(c1), v2 = vdupq_n_f32(c2);
+      const float init[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+      float32x4_t fn = vld1q_f32(init);
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4_t c, s;
+        sincos_turns_neon(vfmaq_f32(v0, fn, vfmaq_f32(v1, fn, v2)), c, s);
+        fn = vaddq_f32(fn, vdupq_n_f32(4.0f));
+
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4x2_t b;
+        b.val[0] = vfmsq_f32(vmulq_f32(a.val[0], c), a.val[1], s);
+        b.val[1] = vfmaq_f32(vmulq_f32(a.val[0], s), a.val[1], c);
+        vst2q_f32(r + 2*n, b);
+      }
+      const float fm = (float)n;
+      multiplyPhase_scalar(N - n, c0 + fm*(c1 + fm*c2), c1 + 2*fm*c2, c2, x + 2*n, r + 2*n);
+    }
+
+    void phaseDifference_neon(size_t N, const float* x, const float* y, float* r)
+    {
+      size_t n = 0;
+      for (; n + 4 <= N; n += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2*n);
+        float32x4x2_t b = vld2q_f32(y + 2*n);
+
+        const float32x4_t ax = vsqrtq_f32(vfmaq_f32(vmulq_f32(a.val[0], a.val[0]), a.val[1], a.val[1]));
+        const float32x4_t ay = vsqrtq_f32(vfmaq_f32(vmulq_f32(b.val[0], b.val[0]), b.val[1], b.val[1]));
+        const float32x4_t den = vmulq_f32(ax, ay);
+        const uint32x4_t nz = vcgtq_f32(den, vdupq_n_f32(0.0f));
+        const float32x4_t g = vdivq_f32(vmulq_n_f32(vaddq_f32(ax, ay), 0.5f), den);
+
+        float32x4x2_t c;
+        c.val[0] = vbslq_f32(nz, vmulq_f32(g, vfmaq_f32(vmulq_f32(b.val[0], a.val[0]), b.val[1], a.val[1])), vmulq_n_f32(vaddq_f32(b.val[0], a.val[0]), 0.5f));
+        c.val[1] = vbslq_f32(nz, vmulq_f32(g, vfmsq_f32(vmulq_f32(b.val[1], a.val[0]), b.val[0], a.val[1])), vmulq_n_f32(vsubq_f32(b.val[1], a.val[1]), 0.5f));
+        vst2q_f32(r + 2*n, c);
+      }
+      phaseDifference_scalar(N - n, x + 2*n, y + 2*n, r + 2*n);
+    }
+
+#endif // GADGETRON_SIMD_NEON
+
+    // ----------------------------------------------------------------------------
+    // dispatch
+    // ----------------------------------------------------------------------------
+
+    typedef void (*binary_kernel)(size_t, const float*, const float*, float*);
+    typedef void (*unary_kernel)(size_t, const float*, float*);
+    typedef void (*axpy_kernel)(float, float, size_t, const float*, const float*, float*);
+    typedef void (*halfband_kernel)(size_t, size_t, float, const float*, const float*, const float*, float*);
+    typedef void (*phase_kernel)(size_t, float, float, float, const float*, float*);
+
+    struct Kernels
+    {
+      binary_kernel multiply;
+      binary_kernel multiplyConj;
+      unary_kernel abs;
+      unary_kernel conjugate;
+      axpy_kernel axpy;
+      halfband_kernel halfband;
+      phase_kernel multiplyPhase;
+      binary_kernel phaseDifference;
+    };
+
+    Kernels kernels_for(hoNDArraySimd::Level l)
+    {
+      Kernels k = { multiply_scalar, multiplyConj_scalar, abs_scalar, conjugate_scalar, axpy_scalar, halfband_scalar,
+                    multiplyPhase_scalar, phaseDifference_scalar };
+
+#ifdef GADGETRON_SIMD_X86
+      if (l == hoNDArraySimd::SIMD_AVX512) {
+        Kernels v = { multiply_avx512, multiplyConj_avx512, abs_avx512, conjugate_avx512, axpy_avx512, halfband_avx512,
+                      multiplyPhase_avx512, phaseDifference_avx512 };
+        k = v;
+      } else if (l == hoNDArraySimd::SIMD_AVX2) {
+        Kernels v = { multiply_avx2, multiplyConj_avx2, abs_avx2, conjugate_avx2, axpy_avx2, halfband_avx2,
+                      multiplyPhase_avx2, phaseDifference_avx2 };
+        k = v;
+      }
+#endif
+
+#ifdef GADGETRON_SIMD_NEON
+      if (l == hoNDArraySimd::SIMD_NEON) {
+        Kernels v = { multiply_neon, multiplyConj_neon, abs_neon, conjugate_neon, axpy_neon, halfband_neon,
+                      multiplyPhase_neon, phaseDifference_neon };
+        k = v;
+      }
+#endif
+
+      return k;
+    }
+
+    hoNDArraySimd::Level detect()
+    {
+#ifdef GADGETRON_SIMD_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")) return hoNDArraySimd::SIMD_AVX512;
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return hoNDArraySimd::SIMD_AVX2;
+#endif
+
+#ifdef GADGETRON_SIMD_NEON
+      return hoNDArraySimd::SIMD_NEON;
+#endif
+
+      return hoNDArraySimd::SIMD_SCALAR;
+    }
+
+    struct Dispatch
+    {
+      Dispatch() : detected(detect())
+      {
+        hoNDArraySimd::Level l = detected;
+
+        const char* env = std::getenv("GADGETRON_SIMD");
+        if (env) {
+          std::string s(env);
+          hoNDArraySimd::Level cap = l;
+          if (s == "scalar") cap = hoNDArraySimd::SIMD_SCALAR;
+          else if (s == "neon") cap = hoNDArraySimd::SIMD_NEON;
+          else if (s == "avx2") cap = hoNDArraySimd::SIMD_AVX2;
+          else if (s == "avx512") cap = hoNDArraySimd::SIMD_AVX512;
+          if (cap < l) l = cap;
+        }
+
+        this->select(l);
+      }
+
+      void select(hoNDArraySimd::Level l)
+      {
+        if (l > detected) l = detected;
+        // NEON and the x86 levels exclude each other, a level that is not in the build falls back to scalar
+        if ((detected == hoNDArraySimd::SIMD_NEON) != (l == hoNDArraySimd::SIMD_NEON)) l = hoNDArraySimd::SIMD_SCALAR;
+
+        kernels = kernels_for(l);
+        level.store(l);
+      }
+
+      hoNDArraySimd::Level detected;
+      std::atomic<int> level;
+      Kernels kernels;
+    };
+
+    Dispatch& dispatch()
+    {
+      static Dispatch d;
+      return d;
+    }
+
+    /// Runs f(offset, length) over [0, N), split over the OpenMP threads for large N
+    template <typename F> void split(size_t N, F f)
+    {
+#ifdef USE_OMP
+      if (N > NumElementsUseThreading) {
+        #pragma omp parallel
+        {
+          size_t nt = (size_t)omp_get_num_threads();
+          size_t t = (size_t)omp_get_thread_num();
+          size_t chunk = (N + nt - 1) / nt;
+          size_t start = t*chunk;
+          if (start < N) f(start, (start + chunk > N) ? N - start : chunk);
+        }
+        return;
+      }
+#endif
+      f(0, N);
+    }
+  }
+
+  hoNDArraySimd::Level hoNDArraySimd::level()
+  {
+    return static_cast<Level>(dispatch().level.load());
+  }
+
+  hoNDArraySimd::Level hoNDArraySimd::detected()
+  {
+    return dispatch().detected;
+  }
+
+  void hoNDArraySimd::set_level(Level l)
+  {
+    dispatch().select(l);
+  }
+
+  const char* hoNDArraySimd::name(Level l)
+  {
+    switch (l) {
+      case SIMD_NEON: return "neon";
+      case SIMD_AVX2: return "avx2";
+      case SIMD_AVX512: return "avx512";
+      default: return "scalar";
+    }
+  }
+
+  void hoNDArraySimd::multiply(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+  {
+    binary_kernel k = dispatch().kernels.multiply;
+    const float* px = reinterpret_cast<const float*>(x);
+    const float* py = reinterpret_cast<const float*>(y);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) { k(n, px + 2*s, py + 2*s, pr + 2*s); });
+  }
+
+  void hoNDArraySimd::multiplyConj(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+  {
+    binary_kernel k = dispatch().kernels.multiplyConj;
+    const float* px = reinterpret_cast<const float*>(x);
+    const float* py = reinterpret_cast<const float*>(y);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) { k(n, px + 2*s, py + 2*s, pr + 2*s); });
+  }
+
+  void hoNDArraySimd::abs(size_t N, const std::complex<float>* x, float* r)
+  {
+    unary_kernel k = dispatch().kernels.abs;
+    const float* px = reinterpret_cast<const float*>(x);
+    split(N, [=](size_t s, size_t n) { k(n, px + 2*s, r + s); });
+  }
+
+  void hoNDArraySimd::conjugate(size_t N, const std::complex<float>* x, std::complex<float>* r)
+  {
+    unary_kernel k = dispatch().kernels.conjugate;
+    const float* px = reinterpret_cast<const float*>(x);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) { k(n, px + 2*s, pr + 2*s); });
+  }
+
+  void hoNDArraySimd::axpy(std::complex<float> a, size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+  {
+    axpy_kernel k = dispatch().kernels.axpy;
+    const float ar = a.real();
+    const float ai = a.imag();
+    const float* px = reinterpret_cast<const float*>(x);
+    const float* py = reinterpret_cast<const float*>(y);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) { k(ar, ai, n, px + 2*s, py + 2*s, pr + 2*s); });
+  }
+
+  void hoNDArraySimd::halfband(size_t M, size_t P, float h0, const float* h, const std::complex<float>* e, const std::complex<float>* o, std::complex<float>* r)
+  {
+    halfband_kernel k = dispatch().kernels.halfband;
+    k(2*M, P, h0, h, reinterpret_cast<const float*>(e), reinterpret_cast<const float*>(o), reinterpret_cast<float*>(r));
+  }
+
+  void hoNDArraySimd::multiplyPhase(size_t N, double c0, double c1, double c2, const std::complex<float>* x, std::complex<float>* r)
+  {
+    phase_kernel k = dispatch().kernels.multiplyPhase;
+    const float* px = reinterpret_cast<const float*>(x);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) {
+      // the polynomial around the start of the block, with whole turns removed from the constant term
+      const double ds = (double)s;
+      double a0 = c0 + ds*(c1 + ds*c2);
+      a0 -= std::floor(a0);
+      k(n, (float)a0, (float)(c1 + 2*ds*c2), (float)c2, px + 2*s, pr + 2*s);
+    });
+  }
+
+  void hoNDArraySimd::phaseDifference(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r)
+  {
+    binary_kernel k = dispatch().kernels.phaseDifference;
+    const float* px = reinterpret_cast<const float*>(x);
+    const float* py = reinterpret_cast<const float*>(y);
+    float* pr = reinterpret_cast<float*>(r);
+    split(N, [=](size_t s, size_t n) { k(n, px + 2*s, py + 2*s, pr + 2*s); });
+  }
+}
@@ -0,0 +1,73 @@
+/** \file   hoNDArray_simd.h
+    \brief  Hand vectorised elementwise kernels for std::complex<float> with runtime CPU dispatch.
+
+            The kernels back multiply, multiplyConj, abs, conjugate and axpy of hoNDArray_elemwise for
+            complex float arrays; halfband is the polyphase filter of the readout oversampling removal;
+            multiplyPhase and phaseDifference are the per-pixel phase corrections of the phase contrast chain. On x86 the AVX-512 or AVX2/FMA version is picked at run time from
+            the CPU the process runs on, on AArch64 the NEON version is always used; everywhere else
+            the portable scalar loops are used. Large arrays are split over the OpenMP threads.
+
+            The environment variable GADGETRON_SIMD=scalar|neon|avx2|avx512 caps the level, e.g. to
+            compare results or timings against the scalar code.
+*/
+
+#pragma once
+
+#include "cpucore_math_export.h"
+
+#include <complex>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTCPUCOREMATH hoNDArraySimd
+  {
+  public:
+
+    enum Level
+    {
+      SIMD_SCALAR = 0,
+      SIMD_NEON,
+      SIMD_AVX2,
+      SIMD_AVX512
+    };
+
+    /// Level of the kernels in use
+    static Level level();
+
+    /// Best level supported by the CPU and the build
+    static Level detected();
+
+    /// Selects a level, capped at detected()
+    static void set_level(Level l);
+
+    static const char* name(Level l);
+
+    /// r = x .* y
+    static void multiply(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r);
+
+    /// r = x .* conj(y)
+    static void multiplyConj(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r);
+
+    /// r = |x|
+    static void abs(size_t N, const std::complex<float>* x, float* r);
+
+    /// r = conj(x)
+    static void conjugate(size_t N, const std::complex<float>* x, std::complex<float>* r);
+
+    /// r = a*x + y
+    static void axpy(std::complex<float> a, size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r);
+
+    /// Half-band decimation by 2 of a line x, given as its even samples e[m] = x[2m] and odd samples o[m] = x[2m+1]
+    /// r[m] = h0*e[m] + sum_j h[j]*(o[m-j-1] + o[m+j]), j < P, for m < M
+    /// o must be readable from o[-P] to o[M+P-1]
+    static void halfband(size_t M, size_t P, float h0, const float* h, const std::complex<float>* e, const std::complex<float>* o, std::complex<float>* r);
+
+    /// r[n] = x[n]*exp(i*2*pi*(c0 + c1*n + c2*n^2)), the phase polynomial is given in turns
+    /// sin and cos are polynomial approximations, accurate to about 1e-6 after the reduction to a quarter turn
+    static void multiplyPhase(size_t N, double c0, double c1, double c2, const std::complex<float>* x, std::complex<float>* r);
+
+    /// r = (|x| + |y|)/2 * exp(i*(arg(y) - arg(x))), the phase difference with the mean magnitude
+    static void phaseDifference(size_t N, const std::complex<float>* x, const std::complex<float>* y, std::complex<float>* r);
+  };
+}
@@ -18,6 +18,7 @@
 #include "hoNDArray_reductions.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDInterpolator.h"
+#include "hoNDInterpolatorStatic.h"
 
 namespace Gadgetron
 {
@@ -30,8 +31,22 @@ namespace Gadgetron
 
     /// perform the gaussian filter for every dimension
     /// sigma is in the unit of pixel
+    /// the recursive Deriche smoothing filter is used, the cost does not depend on sigma; its kernel is close to, but
+    /// wider at the tails than, the gaussian, see filterGaussianRecursive
+    /// without mem the lines are filtered in blocks side by side and the blocks run in parallel (see filterGaussianMultiple),
+    /// with mem, a buffer of twice the largest size, the lines are filtered one by one
     template<class ArrayType, class T2> bool filterGaussian(ArrayType& x, T2 sigma[], typename ArrayType::value_type* mem=NULL);
 
+    /// perform the gaussian filter for every dimension with the third order recursive filter of Young and van Vliet
+    /// the kernel is within a few percent of the peak of the gaussian for sigma of 3 pixels and more, sigma below 0.5 is taken as 0.5
+    /// the cost per pixel does not depend on sigma; the lines are filtered in blocks side by side and the blocks run in parallel
+    /// the border-value boundary condition is used
+    template<class ArrayType, class T2> bool filterGaussianRecursive(ArrayType& x, T2 sigma[]);
+
+    /// perform the gaussian filter of filterGaussian on several arrays of the same size in one pass over every dimension
+    /// the lines along the slower dimensions are filtered in blocks of adjacent lines, the blocks run in parallel
+    template<class ArrayType, class T2> bool filterGaussianMultiple(std::vector<ArrayType*>& x, T2 sigma[]);
+
     /// perform midian filter
     /// w is the window size
     template<class ArrayType> bool filterMedian(const ArrayType& img, size_t w[], ArrayType& img_out);
@@ -54,6 +69,11 @@ namespace Gadgetron
     template<typename ImageType, typename InterpolatorType> 
     bool resampleImage(const ImageType& in, InterpolatorType& interp, const std::vector<size_t>& dim_out, ImageType& out);
 
+    /// resample the image with the interpolator and boundary condition given by type
+    /// nearest neighbour and linear interpolation use the statically dispatched hoNDInterpolatorStatic
+    template<typename ImageType> 
+    bool resampleImage(const ImageType& in, GT_IMAGE_INTERPOLATOR interp, GT_BOUNDARY_CONDITION bh, const std::vector<size_t>& dim_out, ImageType& out);
+
     /// reduce image size by 2 with averaging across two neighbors
     template<typename ImageType, typename BoundaryHandlerType> 
     bool downsampleImageBy2WithAveraging(const ImageType& in, BoundaryHandlerType& bh, ImageType& out);
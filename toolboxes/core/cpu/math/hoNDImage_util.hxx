@@ -285,6 +285,68 @@ namespace Gadgetron
         return true;
     }
 
+    template<typename ImageType, unsigned int Order> 
+    bool resampleImageStatic(const ImageType& in, GT_BOUNDARY_CONDITION bh, const std::vector<size_t>& dim_out, ImageType& out)
+    {
+        const unsigned int D = ImageType::NDIM;
+
+        switch (bh)
+        {
+            case GT_BOUNDARY_CONDITION_FIXEDVALUE:
+            {
+                hoNDInterpolatorStatic<ImageType, D, Order, GT_BOUNDARY_CONDITION_FIXEDVALUE> interp;
+                return Gadgetron::resampleImage(in, interp, dim_out, out);
+            }
+
+            case GT_BOUNDARY_CONDITION_BORDERVALUE:
+            {
+                hoNDInterpolatorStatic<ImageType, D, Order, GT_BOUNDARY_CONDITION_BORDERVALUE> interp;
+                return Gadgetron::resampleImage(in, interp, dim_out, out);
+            }
+
+            case GT_BOUNDARY_CONDITION_PERIODIC:
+            {
+                hoNDInterpolatorStatic<ImageType, D, Order, GT_BOUNDARY_CONDITION_PERIODIC> interp;
+                return Gadgetron::resampleImage(in, interp, dim_out, out);
+            }
+
+            case GT_BOUNDARY_CONDITION_MIRROR:
+            {
+                hoNDInterpolatorStatic<ImageType, D, Order, GT_BOUNDARY_CONDITION_MIRROR> interp;
+                return Gadgetron::resampleImage(in, interp, dim_out, out);
+            }
+
+            default:
+                GERROR_STREAM("Unrecognized boundary handler type : " << bh);
+        }
+
+        return false;
+    }
+
+    template<typename ImageType> 
+    bool resampleImage(const ImageType& in, GT_IMAGE_INTERPOLATOR interp, GT_BOUNDARY_CONDITION bh, const std::vector<size_t>& dim_out, ImageType& out)
+    {
+        if ( interp == GT_IMAGE_INTERPOLATOR_NEARESTNEIGHBOR )
+        {
+            return Gadgetron::resampleImageStatic<ImageType, 0>(in, bh, dim_out, out);
+        }
+
+        if ( interp == GT_IMAGE_INTERPOLATOR_LINEAR )
+        {
+            return Gadgetron::resampleImageStatic<ImageType, 1>(in, bh, dim_out, out);
+        }
+
+        boost::shared_ptr< hoNDBoundaryHandler<ImageType> > pBH(createBoundaryHandler<ImageType>(bh));
+        boost::shared_ptr< hoNDInterpolator<ImageType> > pInterp(createInterpolator<ImageType, ImageType::NDIM>(interp));
+        if ( !pBH || !pInterp ) return false;
+
+        pBH->setArray( const_cast< ImageType& >(in) );
+        pInterp->setArray( const_cast< ImageType& >(in) );
+        pInterp->setBoundaryHandler(*pBH);
+
+        return Gadgetron::resampleImage(in, *pInterp, dim_out, out);
+    }
+
     template<typename ImageType, typename BoundaryHandlerType> 
     bool downsampleImageBy2WithAveraging(const ImageType& in, BoundaryHandlerType& bh, ImageType& out)
     {
@@ -1394,6 +1456,13 @@ namespace Gadgetron
         {
             typedef typename ArrayType::value_type T;
 
+            // without scratch memory of the caller, filter in blocks of lines in parallel
+            if ( mem == NULL )
+            {
+                std::vector<ArrayType*> imgs(1, &img);
+                return Gadgetron::filterGaussianMultiple(imgs, sigma);
+            }
+
             size_t D = img.get_number_of_dimensions();
 
             if ( D == 1 )
@@ -1847,4 +1916,333 @@ namespace Gadgetron
 
         return true;
     }
+
+    template <class T, class T2>
+    inline void DericheCoefficients(T2 sigma, T& a1, T& a2, T& a3, T& a4, T& b1, T& b2)
+    {
+        if ( sigma < 1e-6 ) sigma = (T2)(1e-6);
+
+        T alpha = (T)(1.4105/sigma);
+        T e_alpha = (T)( std::exp( (double)(-alpha) ) );
+        T e_alpha_sqr = e_alpha*e_alpha;
+        T k = ( (1-e_alpha)*(1-e_alpha) ) / ( 1 + 2*alpha*e_alpha - e_alpha_sqr );
+
+        a1 = k;
+        a2 = k * e_alpha * (alpha-1);
+        a3 = k * e_alpha * (alpha+1);
+        a4 = -k * e_alpha_sqr;
+
+        b1 = 2 * e_alpha;
+        b2 = -e_alpha_sqr;
+    }
+
+    // DericheSmoothing of L lines at once, with the zero boundary condition
+    // sample i of line l is at pData[i*stride + l], so the inner loops run over L contiguous values
+    // forward: buffer of N*L values
+    template <class T, class R>
+    inline void DericheSmoothingInterleaved(T* pData, size_t N, size_t stride, size_t L, T* forward, R a1, R a2, R a3, R a4, R b1, R b2)
+    {
+        const size_t maxL = 16;
+        GADGET_DEBUG_CHECK_THROW(L <= maxL);
+
+        size_t i, l;
+
+        // left to right
+        for ( l=0; l<L; l++ ) forward[l] = a1*pData[l];
+
+        if ( N > 1 )
+        {
+            for ( l=0; l<L; l++ ) forward[L+l] = a1*pData[stride+l] + a2*pData[l] + b1*forward[l];
+        }
+
+        for ( i=2; i<N; i++ )
+        {
+            const T* x = pData + i*stride;
+            const T* xm = x - stride;
+            T* f = forward + i*L;
+            const T* f1 = f - L;
+            const T* f2 = f1 - L;
+
+            for ( l=0; l<L; l++ ) f[l] = (a1*x[l] + a2*xm[l]) + (b1*f1[l] + b2*f2[l]);
+        }
+
+        // right to left, added to the forward result in place; x1, x2 keep the input at i+1 and i+2
+        T r1[maxL], r2[maxL], x1[maxL], x2[maxL];
+        for ( l=0; l<L; l++ ) { r1[l] = 0; r2[l] = 0; x1[l] = 0; x2[l] = 0; }
+
+        for ( i=N; i-->0; )
+        {
+            T* x = pData + i*stride;
+            const T* f = forward + i*L;
+
+            for ( l=0; l<L; l++ )
+            {
+                T r = (a3*x1[l] + a4*x2[l]) + (b1*r1[l] + b2*r2[l]);
+                x2[l] = x1[l]; x1[l] = x[l];
+                r2[l] = r1[l]; r1[l] = r;
+                x[l] = f[l] + r;
+            }
+        }
+    }
+
+    template <class T>
+    struct DericheLineFilter
+    {
+        typedef typename realType<T>::Type R;
+
+        template <class T2> DericheLineFilter(T2 sigma) { DericheCoefficients(sigma, a1, a2, a3, a4, b1, b2); }
+
+        size_t work_size(size_t N, size_t L) const { return N*L; }
+
+        void operator()(T* pData, size_t N, size_t stride, size_t L, T* work) const
+        {
+            Gadgetron::DericheSmoothingInterleaved(pData, N, stride, L, work, a1, a2, a3, a4, b1, b2);
+        }
+
+        R a1, a2, a3, a4, b1, b2;
+    };
+
+    // Young and van Vliet, "Recursive implementation of the Gaussian filter", Signal Processing 44:139-151, 1995,
+    // with the boundary conditions of Triggs and Sdika, "Boundary conditions for Young-van Vliet recursive filtering",
+    // IEEE Trans Signal Processing 54:2365-2367, 2006.
+    // M gives the state of the backward recursion at the end of a line from the last forward values, as if the line
+    // continued with its last value.
+    template <class R, class T2>
+    inline void YoungVanVlietCoefficients(T2 sigma, R& B, R& a1, R& a2, R& a3, R M[9])
+    {
+        double s = (sigma < 0.5) ? 0.5 : (double)sigma;
+        double q = (s >= 2.5) ? (0.98711*s - 0.96330) : (3.97156 - 4.14554*std::sqrt(1 - 0.26891*s));
+
+        double b0 = 1.57825 + 2.44413*q + 1.4281*q*q + 0.422205*q*q*q;
+        double c1 = (2.44413*q + 2.85619*q*q + 1.26661*q*q*q)/b0;
+        double c2 = -(1.4281*q*q + 1.26661*q*q*q)/b0;
+        double c3 = (0.422205*q*q*q)/b0;
+
+        double m[9];
+        m[0] = -c3*c1 + 1 - c3*c3 - c2;
+        m[1] = (c3 + c1)*(c2 + c3*c1);
+        m[2] = c3*(c1 + c3*c2);
+        m[3] = c1 + c3*c2;
+        m[4] = -(c2 - 1)*(c2 + c3*c1);
+        m[5] = -(c3*c1 + c3*c3 + c2 - 1)*c3;
+        m[6] = c3*c1 + c2 + c1*c1 - c2*c2;
+        m[7] = c1*c2 + c3*c2*c2 - c1*c3*c3 - c3*c3*c3 - c3*c2 + c3;
+        m[8] = c3*(c1 + c3*c2);
+
+        double norm = (1 + c1 - c2 + c3)*(1 - c1 - c2 - c3)*(1 + c2 + (c1 - c3)*c3);
+        for ( size_t ii=0; ii<9; ii++ ) M[ii] = (R)(m[ii]/norm);
+
+        // B from the rounded coefficients, so that the gain at zero frequency is one in the precision of R
+        a1 = (R)c1; a2 = (R)c2; a3 = (R)c3;
+        B = R(1) - (a1 + a2 + a3);
+    }
+
+    // Young-van Vliet smoothing of L lines at once, sample i of line l at pData[i*stride + l]
+    // forward: buffer of (N+3)*L values, the first 3*L hold the forward values before the line
+    template <class T, class R>
+    inline void YoungVanVlietSmoothingInterleaved(T* pData, size_t N, size_t stride, size_t L, T* forward, R B, R a1, R a2, R a3, const R M[9])
+    {
+        size_t i, l;
+
+        // before the line, the steady state of its first value
+        for ( l=0; l<L; l++ )
+        {
+            forward[l] = pData[l]; forward[L+l] = pData[l]; forward[2*L+l] = pData[l];
+        }
+
+        for ( i=0; i<N; i++ )
+        {
+            const T* x = pData + i*stride;
+            T* f = forward + (i+3)*L;
+            const T* f1 = f - L;
+            const T* f2 = f1 - L;
+            const T* f3 = f2 - L;
+
+            for ( l=0; l<L; l++ ) f[l] = B*x[l] + (a1*f1[l] + a2*f2[l] + a3*f3[l]);
+        }
+
+        // after the line, the steady state of its last value
+        const T* fN1 = forward + (N+2)*L;
+        const T* fN2 = fN1 - L;
+        const T* fN3 = fN2 - L;
+
+        T y1[16], y2[16], y3[16];
+        for ( l=0; l<L; l++ )
+        {
+            const T v = pData[(N-1)*stride + l];
+            const T u0 = B*(fN1[l] - v), u1 = B*(fN2[l] - v), u2 = B*(fN3[l] - v);
+
+            y1[l] = M[0]*u0 + M[1]*u1 + M[2]*u2 + v;
+            y2[l] = M[3]*u0 + M[4]*u1 + M[5]*u2 + v;
+            y3[l] = M[6]*u0 + M[7]*u1 + M[8]*u2 + v;
+
+            pData[(N-1)*stride + l] = y1[l];
+        }
+
+        for ( i=N-1; i-->0; )
+        {
+            T* x = pData + i*stride;
+            const T* f = forward + (i+3)*L;
+
+            for ( l=0; l<L; l++ )
+            {
+                T y = B*f[l] + (a1*y1[l] + a2*y2[l] + a3*y3[l]);
+                y3[l] = y2[l]; y2[l] = y1[l]; y1[l] = y;
+                x[l] = y;
+            }
+        }
+    }
+
+    template <class T>
+    struct YoungVanVlietLineFilter
+    {
+        typedef typename realType<T>::Type R;
+
+        template <class T2> YoungVanVlietLineFilter(T2 sigma) { YoungVanVlietCoefficients(sigma, B, a1, a2, a3, M); }
+
+        size_t work_size(size_t N, size_t L) const { return (N+3)*L; }
+
+        void operator()(T* pData, size_t N, size_t stride, size_t L, T* work) const
+        {
+            Gadgetron::YoungVanVlietSmoothingInterleaved(pData, N, stride, L, work, B, a1, a2, a3, M);
+        }
+
+        R B, a1, a2, a3, M[9];
+    };
+
+    // filters the lines along dimension d of all arrays with the line filter, in blocks of B lines side by side
+    // the lines along the first dimension are transposed into a buffer for that, the blocks run in parallel
+    template<class ArrayType, class LineFilter>
+    void filterLinesBlocked(std::vector<ArrayType*>& imgs, size_t d, const LineFilter& filter)
+    {
+        typedef typename ArrayType::value_type T;
+
+        const size_t B = 16;
+
+        const long long K = (long long)imgs.size();
+        const size_t total = imgs[0]->get_number_of_elements();
+        const size_t N = imgs[0]->get_size(d);
+
+        size_t inner = 1, outer = 1;
+        for ( size_t ii=0; ii<d; ii++ ) inner *= imgs[0]->get_size(ii);
+        for ( size_t ii=d+1; ii<imgs[0]->get_number_of_dimensions(); ii++ ) outer *= imgs[0]->get_size(ii);
+
+        if ( d == 0 )
+        {
+            const size_t num_blocks = (outer + B - 1)/B;
+            const long long num = K*(long long)num_blocks;
+            long long n;
+
+#pragma omp parallel private(n) if(K*total>64*1024)
+            {
+                std::vector<T> buf(N*B), work(filter.work_size(N, B));
+
+#pragma omp for
+                for ( n=0; n<num; n++ )
+                {
+                    const size_t k = n/num_blocks;
+                    const size_t y0 = (n%num_blocks)*B;
+                    const size_t L = std::min(B, outer-y0);
+
+                    T* p = imgs[k]->begin() + y0*N;
+
+                    size_t i, l;
+                    for ( l=0; l<L; l++ )
+                    {
+                        for ( i=0; i<N; i++ ) buf[i*L+l] = p[l*N+i];
+                    }
+
+                    filter(&buf[0], N, L, L, &work[0]);
+
+                    for ( l=0; l<L; l++ )
+                    {
+                        for ( i=0; i<N; i++ ) p[l*N+i] = buf[i*L+l];
+                    }
+                }
+            }
+        }
+        else
+        {
+            const size_t num_blocks = (inner + B - 1)/B;
+            const long long num = K*(long long)(outer*num_blocks);
+            long long n;
+
+#pragma omp parallel private(n) if(K*total>64*1024)
+            {
+                std::vector<T> work(filter.work_size(N, B));
+
+#pragma omp for
+                for ( n=0; n<num; n++ )
+                {
+                    const size_t k = n/(outer*num_blocks);
+                    const size_t r = n%(outer*num_blocks);
+                    const size_t o = r/num_blocks;
+                    const size_t x0 = (r%num_blocks)*B;
+                    const size_t L = std::min(B, inner-x0);
+
+                    T* p = imgs[k]->begin() + o*inner*N + x0;
+                    filter(p, N, inner, L, &work[0]);
+                }
+            }
+        }
+    }
+
+    template<class ArrayType, class T2> 
+    bool filterGaussianMultiple(std::vector<ArrayType*>& imgs, T2 sigma[])
+    {
+        try
+        {
+            typedef typename ArrayType::value_type T;
+
+            if ( imgs.empty() ) return true;
+
+            const size_t K = imgs.size();
+            const size_t D = imgs[0]->get_number_of_dimensions();
+            const size_t total = imgs[0]->get_number_of_elements();
+
+            for ( size_t k=1; k<K; k++ )
+            {
+                GADGET_CHECK_RETURN_FALSE(imgs[k]->get_number_of_dimensions()==D && imgs[k]->get_number_of_elements()==total);
+            }
+
+            if ( total == 0 ) return true;
+
+            for ( size_t d=0; d<D; d++ )
+            {
+                if ( sigma[d] > 0 ) Gadgetron::filterLinesBlocked(imgs, d, DericheLineFilter<T>(sigma[d]));
+            }
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Errors happened in filterGaussianMultiple(std::vector<ArrayType*>& imgs, T sigma[]) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
+    template<class ArrayType, class T2> 
+    bool filterGaussianRecursive(ArrayType& img, T2 sigma[])
+    {
+        try
+        {
+            typedef typename ArrayType::value_type T;
+
+            if ( img.get_number_of_elements() == 0 ) return true;
+
+            std::vector<ArrayType*> imgs(1, &img);
+
+            for ( size_t d=0; d<img.get_number_of_dimensions(); d++ )
+            {
+                if ( sigma[d] > 0 ) Gadgetron::filterLinesBlocked(imgs, d, YoungVanVlietLineFilter<T>(sigma[d]));
+            }
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Errors happened in filterGaussianRecursive(ArrayType& img, T sigma[]) ... ");
+            return false;
+        }
+
+        return true;
+    }
 }
@@ -0,0 +1,191 @@
+#include "hoNDInterpolator_simd.h"
+#include "hoNDArray_simd.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define GADGETRON_INTERP_X86
+    #include <immintrin.h>
+#endif
+
+namespace Gadgetron{
+
+  namespace
+  {
+    // ----------------------------------------------------------------------------
+    // scalar kernels, also used for the tails of the vector kernels
+    // the cell index is clamped, so points outside the interior never read outside the image
+    // ----------------------------------------------------------------------------
+
+    inline long long cell(float x, size_t s)
+    {
+      // written so a NaN ends up in cell 0
+      float f = std::floor(x);
+      if ( !(f > 0) ) return 0;
+      if ( f > (float)(s-2) ) return (long long)(s-2);
+      return (long long)f;
+    }
+
+    void linear2D_scalar(const float* im, size_t sx, size_t sy, size_t N, const float* x, const float* y, float* r)
+    {
+      for (size_t n = 0; n < N; n++) {
+        const long long ix = cell(x[n], sx);
+        const long long iy = cell(y[n], sy);
+        const float dx = x[n] - ix, dx_prime = 1.0f - dx;
+        const float dy = y[n] - iy, dy_prime = 1.0f - dy;
+
+        const float* p = im + ix + iy*sx;
+        r[n] = (p[0]*dx_prime*dy_prime + p[1]*dx*dy_prime)
+             + (p[sx]*dx_prime*dy + p[sx+1]*dx*dy);
+      }
+    }
+
+    void linear3D_scalar(const float* im, size_t sx, size_t sy, size_t sz, size_t N, const float* x, const float* y, const float* z, float* r)
+    {
+      const size_t sxy = sx*sy;
+      for (size_t n = 0; n < N; n++) {
+        const long long ix = cell(x[n], sx);
+        const long long iy = cell(y[n], sy);
+        const long long iz = cell(z[n], sz);
+        const float dx = x[n] - ix, dx_prime = 1.0f - dx;
+        const float dy = y[n] - iy, dy_prime = 1.0f - dy;
+        const float dz = z[n] - iz, dz_prime = 1.0f - dz;
+
+        const float* p = im + ix + iy*sx + iz*sxy;
+        r[n] = ((p[0]*dx_prime*dy_prime + p[1]*dx*dy_prime)
+             + (p[sx]*dx_prime*dy + p[sx+1]*dx*dy))*dz_prime
+             + ((p[sxy]*dx_prime*dy_prime + p[sxy+1]*dx*dy_prime)
+             + (p[sxy+sx]*dx_prime*dy + p[sxy+sx+1]*dx*dy))*dz;
+      }
+    }
+
+#ifdef GADGETRON_INTERP_X86
+
+    // ----------------------------------------------------------------------------
+    // AVX2 + FMA, 8 points per register, the 4 (8) neighbours are gathered
+    // ----------------------------------------------------------------------------
+
+    __attribute__((target("avx2,fma")))
+    inline __m256i cell_avx2(__m256 f, __m256 upper)
+    {
+      // max/min return the second operand for a NaN, so a NaN ends up in cell 0
+      f = _mm256_min_ps(upper, _mm256_max_ps(f, _mm256_setzero_ps()));
+      return _mm256_cvttps_epi32(f);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void linear2D_avx2(const float* im, size_t sx, size_t sy, size_t N, const float* x, const float* y, float* r)
+    {
+      const __m256i vsx = _mm256_set1_epi32((int)sx);
+      const __m256 ux = _mm256_set1_ps((float)(sx-2));
+      const __m256 uy = _mm256_set1_ps((float)(sy-2));
+
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        const __m256 px = _mm256_loadu_ps(x + n);
+        const __m256 py = _mm256_loadu_ps(y + n);
+
+        const __m256i ix = cell_avx2(_mm256_floor_ps(px), ux);
+        const __m256i iy = cell_avx2(_mm256_floor_ps(py), uy);
+        const __m256 dx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(ix));
+        const __m256 dy = _mm256_sub_ps(py, _mm256_cvtepi32_ps(iy));
+
+        const __m256i o = _mm256_add_epi32(ix, _mm256_mullo_epi32(iy, vsx));
+        const __m256 v00 = _mm256_i32gather_ps(im, o, 4);
+        const __m256 v10 = _mm256_i32gather_ps(im + 1, o, 4);
+        const __m256 v01 = _mm256_i32gather_ps(im + sx, o, 4);
+        const __m256 v11 = _mm256_i32gather_ps(im + sx + 1, o, 4);
+
+        const __m256 a = _mm256_fmadd_ps(dx, _mm256_sub_ps(v10, v00), v00);
+        const __m256 b = _mm256_fmadd_ps(dx, _mm256_sub_ps(v11, v01), v01);
+        _mm256_storeu_ps(r + n, _mm256_fmadd_ps(dy, _mm256_sub_ps(b, a), a));
+      }
+      linear2D_scalar(im, sx, sy, N - n, x + n, y + n, r + n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void linear3D_avx2(const float* im, size_t sx, size_t sy, size_t sz, size_t N, const float* x, const float* y, const float* z, float* r)
+    {
+      const size_t sxy = sx*sy;
+      const __m256i vsx = _mm256_set1_epi32((int)sx);
+      const __m256i vsxy = _mm256_set1_epi32((int)sxy);
+      const __m256 ux = _mm256_set1_ps((float)(sx-2));
+      const __m256 uy = _mm256_set1_ps((float)(sy-2));
+      const __m256 uz = _mm256_set1_ps((float)(sz-2));
+
+      size_t n = 0;
+      for (; n + 8 <= N; n += 8) {
+        const __m256 px = _mm256_loadu_ps(x + n);
+        const __m256 py = _mm256_loadu_ps(y + n);
+        const __m256 pz = _mm256_loadu_ps(z + n);
+
+        const __m256i ix = cell_avx2(_mm256_floor_ps(px), ux);
+        const __m256i iy = cell_avx2(_mm256_floor_ps(py), uy);
+        const __m256i iz = cell_avx2(_mm256_floor_ps(pz), uz);
+        const __m256 dx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(ix));
+        const __m256 dy = _mm256_sub_ps(py, _mm256_cvtepi32_ps(iy));
+        const __m256 dz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(iz));
+
+        const __m256i o = _mm256_add_epi32(_mm256_add_epi32(ix, _mm256_mullo_epi32(iy, vsx)), _mm256_mullo_epi32(iz, vsxy));
+
+        const float* p0 = im;
+        const float* p1 = im + sxy;
+
+        __m256 v00 = _mm256_i32gather_ps(p0, o, 4);
+        __m256 v10 = _mm256_i32gather_ps(p0 + 1, o, 4);
+        __m256 v01 = _mm256_i32gather_ps(p0 + sx, o, 4);
+        __m256 v11 = _mm256_i32gather_ps(p0 + sx + 1, o, 4);
+        __m256 a = _mm256_fmadd_ps(dx, _mm256_sub_ps(v10, v00), v00);
+        __m256 b = _mm256_fmadd_ps(dx, _mm256_sub_ps(v11, v01), v01);
+        const __m256 c0 = _mm256_fmadd_ps(dy, _mm256_sub_ps(b, a), a);
+
+        v00 = _mm256_i32gather_ps(p1, o, 4);
+        v10 = _mm256_i32gather_ps(p1 + 1, o, 4);
+        v01 = _mm256_i32gather_ps(p1 + sx, o, 4);
+        v11 = _mm256_i32gather_ps(p1 + sx + 1, o, 4);
+        a = _mm256_fmadd_ps(dx, _mm256_sub_ps(v10, v00), v00);
+        b = _mm256_fmadd_ps(dx, _mm256_sub_ps(v11, v01), v01);
+        const __m256 c1 = _mm256_fmadd_ps(dy, _mm256_sub_ps(b, a), a);
+
+        _mm256_storeu_ps(r + n, _mm256_fmadd_ps(dz, _mm256_sub_ps(c1, c0), c0));
+      }
+      linear3D_scalar(im, sx, sy, sz, N - n, x + n, y + n, z + n, r + n);
+    }
+
+#endif // GADGETRON_INTERP_X86
+
+    bool use_avx2()
+    {
+#ifdef GADGETRON_INTERP_X86
+      // the AVX-512 level implies AVX2
+      hoNDArraySimd::Level l = hoNDArraySimd::level();
+      return (l == hoNDArraySimd::SIMD_AVX2 || l == hoNDArraySimd::SIMD_AVX512);
+#else
+      return false;
+#endif
+    }
+  }
+
+  void hoNDInterpolatorSimd::linear2D(const float* im, size_t sx, size_t sy, size_t N, const float* x, const float* y, float* r)
+  {
+#ifdef GADGETRON_INTERP_X86
+    if (use_avx2()) {
+      linear2D_avx2(im, sx, sy, N, x, y, r);
+      return;
+    }
+#endif
+    linear2D_scalar(im, sx, sy, N, x, y, r);
+  }
+
+  void hoNDInterpolatorSimd::linear3D(const float* im, size_t sx, size_t sy, size_t sz, size_t N, const float* x, const float* y, const float* z, float* r)
+  {
+#ifdef GADGETRON_INTERP_X86
+    if (use_avx2()) {
+      linear3D_avx2(im, sx, sy, sz, N, x, y, z, r);
+      return;
+    }
+#endif
+    linear3D_scalar(im, sx, sy, sz, N, x, y, z, r);
+  }
+}
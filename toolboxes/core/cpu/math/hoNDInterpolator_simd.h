@@ -0,0 +1,45 @@
+/** \file   hoNDInterpolator_simd.h
+    \brief  Vectorised linear interpolation of float images at many points.
+
+            hoNDInterpolatorLinear evaluates one point per virtual call and checks the boundary for
+            every point. These kernels interpolate a whole batch of points, e.g. one row of a warped
+            image, with AVX2 gathers on x86 (following the level of hoNDArraySimd, and so GADGETRON_SIMD)
+            and scalar loops elsewhere.
+
+            The kernels do not apply a boundary condition. A point gives the interpolated value only
+            if it is an interior point, i.e. 0 <= x < sx-1 (and the same for y and z), see interior2D/3D;
+            for other points an arbitrary value is written, and the caller evaluates them with the
+            boundary handler instead. The image must have at least 2 pixels along every dimension and
+            fewer than 2^31 pixels.
+*/
+
+#pragma once
+
+#include "cpucore_math_export.h"
+
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTCPUCOREMATH hoNDInterpolatorSimd
+  {
+  public:
+
+    /// r[n] = image(x[n], y[n]) of the sx*sy image im
+    static void linear2D(const float* im, size_t sx, size_t sy, size_t N, const float* x, const float* y, float* r);
+
+    /// r[n] = image(x[n], y[n], z[n]) of the sx*sy*sz image im
+    static void linear3D(const float* im, size_t sx, size_t sy, size_t sz, size_t N, const float* x, const float* y, const float* z, float* r);
+
+    /// whether the linear interpolation at the point needs no boundary handling
+    static inline bool interior2D(size_t sx, size_t sy, float x, float y)
+    {
+      return (x >= 0 && x < (float)(sx-1) && y >= 0 && y < (float)(sy-1));
+    }
+
+    static inline bool interior3D(size_t sx, size_t sy, size_t sz, float x, float y, float z)
+    {
+      return (x >= 0 && x < (float)(sx-1) && y >= 0 && y < (float)(sy-1) && z >= 0 && z < (float)(sz-1));
+    }
+  };
+}
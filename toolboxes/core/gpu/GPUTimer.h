@@ -10,6 +10,7 @@
 #include <iostream>
 #include <string>
 #include <cuda_runtime_api.h>
+#include "GadgetronProfile.h"
 
 namespace Gadgetron{
 
@@ -44,6 +45,7 @@ namespace Gadgetron{
 
         virtual void start()
         {
+            if (GadgetronProfile::current()) profile_path_ = GadgetronProfile::child_path(name_.c_str());
             cudaEventCreate(&start_event_);
             cudaEventCreate(&stop_event_);
             cudaEventRecord( start_event_, 0 );
@@ -58,7 +60,14 @@ namespace Gadgetron{
             cudaEventDestroy( start_event_ );
             cudaEventDestroy( stop_event_ );
 
-            GDEBUG_STREAM(name_ << ": " << time << " ms" << std::endl; std::cout.flush());
+            //GPU time of the step goes to the profile of the stream, if it is profiled
+            GadgetronProfile* profile = GadgetronProfile::current();
+            if (profile && !profile_path_.empty()) {
+                profile->add(profile_path_, (int64_t)(time * 1e6));
+            } else {
+                GDEBUG_STREAM(name_ << ": " << time << " ms" << std::endl; std::cout.flush());
+            }
+            profile_path_.clear();
         }
 
         void set_timing_in_destruction(bool timing) { timing_in_destruction_ = timing; }
@@ -67,6 +76,7 @@ namespace Gadgetron{
         cudaEvent_t stop_event_;
 
         std::string name_;
+        std::string profile_path_;
         bool timing_in_destruction_;
     };
 }
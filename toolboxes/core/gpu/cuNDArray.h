@@ -9,6 +9,8 @@
 #include "complext.h"
 #include "GadgetronCuException.h"
 #include "check_CUDA.h"
+#include "cudaMemoryCache.h"
+#include "GadgetronMemoryAccount.h"
 #include <boost/shared_ptr.hpp>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
@@ -90,6 +92,12 @@ namespace Gadgetron{
         virtual boost::shared_ptr< hoNDArray<T> > to_host() const;
         virtual void to_host( hoNDArray<T> *out ) const;
 
+        // Asynchronous copies on a stream, the arrays must have the same number of elements.
+        // The host memory should be pinned (e.g. a hoCuNDArray) to overlap with work on other streams,
+        // it must stay valid until the stream has completed the copy.
+        void from_host_async( const hoNDArray<T>& in, cudaStream_t stream );
+        void to_host_async( hoNDArray<T>& out, cudaStream_t stream ) const;
+
         virtual void set_device(int device);
         int get_device();
 
@@ -122,7 +130,7 @@ namespace Gadgetron{
     {
         cudaGetDevice(&this->device_);
         this->data_ = 0;
-        this->dimensions_ = a.get_dimensions();
+        this->dimensions_ = a.dimensions();
         allocate_memory();
         if (a.device_ == this->device_) {
             CUDA_CALL(cudaMemcpy(this->data_, a.data_, this->elements_*sizeof(T), cudaMemcpyDeviceToDevice));
@@ -135,7 +143,7 @@ namespace Gadgetron{
             if (err !=cudaSuccess) {
                 deallocate_memory();
                 this->data_ = 0;
-                this->dimensions_->clear();
+                this->dimensions_.clear();
                 throw cuda_error(err);
             }
         }
@@ -146,7 +154,7 @@ namespace Gadgetron{
     {
         cudaGetDevice(&this->device_);
         this->data_ = 0;
-        this->dimensions_ = a->get_dimensions();
+        this->dimensions_ = a->dimensions();
         allocate_memory();
         if (a->device_ == this->device_) {
             CUDA_CALL(cudaMemcpy(this->data_, a->data_, this->elements_*sizeof(T), cudaMemcpyDeviceToDevice));
@@ -159,7 +167,7 @@ namespace Gadgetron{
             if (err !=cudaSuccess) {
                 deallocate_memory();
                 this->data_ = 0;
-                this->dimensions_->clear();
+                this->dimensions_.clear();
                 throw cuda_error(err);
             }
         }
@@ -172,9 +180,9 @@ namespace Gadgetron{
     {
     	device_ = a.device_;
     	this->data_ = a.data_;
-    	*this->dimensions_ = *a.dimensions_;
+    	this->dimensions_ = a.dimensions_;
     	this->elements_ = a.elements_;
-    	a.dimensions_.reset();
+    	a.dimensions_.clear();
     	a.data_=nullptr;
     }
 #endif
@@ -182,12 +190,12 @@ namespace Gadgetron{
     cuNDArray<T>::cuNDArray(const hoNDArray<T> &a) : NDArray<T>::NDArray() 
     {
         cudaGetDevice(&this->device_);
-        this->dimensions_ = a.get_dimensions();
+        this->dimensions_ = a.dimensions();
         allocate_memory();
         if (cudaMemcpy(this->data_, a.get_data_ptr(), this->elements_*sizeof(T), cudaMemcpyHostToDevice) != cudaSuccess) {
             deallocate_memory();
             this->data_ = 0;
-            this->dimensions_->clear();
+            this->dimensions_.clear();
         }
     }
 
@@ -195,12 +203,12 @@ namespace Gadgetron{
     cuNDArray<T>::cuNDArray(hoNDArray<T> *a) : NDArray<T>::NDArray() 
     {
         cudaGetDevice(&this->device_);
-        this->dimensions_ = a->get_dimensions();
+        this->dimensions_ = a->dimensions();
         allocate_memory();
         if (cudaMemcpy(this->data_, a->get_data_ptr(), this->elements_*sizeof(T), cudaMemcpyHostToDevice) != cudaSuccess) {
             deallocate_memory();
             this->data_ = 0;
-            this->dimensions_->clear();
+            this->dimensions_.clear();
         }
     }
 
@@ -380,9 +388,9 @@ namespace Gadgetron{
 
     	if (&rhs == this) return *this;
     	this->clear();
-    	*this->dimensions_ = *rhs.dimensions_;
+    	this->dimensions_ = rhs.dimensions_;
     	this->elements_ = rhs.elements_;
-    	rhs.dimensions_.reset();
+    	rhs.dimensions_.clear();
     	device_ = rhs.device_;
     	this->data_ = rhs.data_;
     	rhs.data_ = nullptr;
@@ -404,7 +412,7 @@ namespace Gadgetron{
             if( !dimensions_match ){
                 deallocate_memory();
                 this->elements_ = rhs.elements_;
-                this->dimensions_ = rhs.get_dimensions();
+                this->dimensions_ = rhs.dimensions();
                 allocate_memory();
             }
             if (this->device_ == rhs.device_) {
@@ -448,7 +456,7 @@ namespace Gadgetron{
             if( !dimensions_match ){
                 deallocate_memory();
                 this->elements_ = rhs.get_number_of_elements();
-                this->dimensions_ = rhs.get_dimensions();
+                this->dimensions_ = rhs.dimensions();
                 allocate_memory();
             }
             if (cudaMemcpy(this->get_data_ptr(), rhs.get_data_ptr(), this->get_number_of_elements()*sizeof(T),
@@ -689,7 +697,7 @@ namespace Gadgetron{
     template <typename T> 
     inline boost::shared_ptr< hoNDArray<T> > cuNDArray<T>::to_host() const
     {
-        boost::shared_ptr< hoNDArray<T> > ret(new hoNDArray<T>(this->dimensions_.get()));
+        boost::shared_ptr< hoNDArray<T> > ret(new hoNDArray<T>(this->dimensions_.to_vector()));
         if (cudaMemcpy(ret->get_data_ptr(), this->data_, this->elements_*sizeof(T), cudaMemcpyDeviceToHost) != cudaSuccess) {
             throw cuda_error("cuNDArray::to_host(): failed to copy memory from device");
         }
@@ -713,6 +721,30 @@ namespace Gadgetron{
         }
     }
 
+    template <typename T> 
+    inline void cuNDArray<T>::from_host_async( const hoNDArray<T>& in, cudaStream_t stream )
+    {
+        if( in.get_number_of_elements() != this->get_number_of_elements() ){
+            throw std::runtime_error("cuNDArray::from_host_async(): array size mismatch.");
+        }
+
+        if( cudaMemcpyAsync( this->data_, in.get_data_ptr(), this->elements_*sizeof(T), cudaMemcpyHostToDevice, stream) != cudaSuccess) {
+            throw cuda_error("cuNDArray::from_host_async(): failed to copy memory to device");
+        }
+    }
+
+    template <typename T> 
+    inline void cuNDArray<T>::to_host_async( hoNDArray<T>& out, cudaStream_t stream ) const
+    {
+        if( out.get_number_of_elements() != this->get_number_of_elements() ){
+            throw std::runtime_error("cuNDArray::to_host_async(): array size mismatch.");
+        }
+
+        if( cudaMemcpyAsync( out.get_data_ptr(), this->data_, this->elements_*sizeof(T), cudaMemcpyDeviceToHost, stream) != cudaSuccess) {
+            throw cuda_error("cuNDArray::to_host_async(): failed to copy memory from device");
+        }
+    }
+
     template <typename T> 
     inline void cuNDArray<T>::set_device(int device)
     {
@@ -808,10 +840,10 @@ namespace Gadgetron{
         deallocate_memory();
 
         this->elements_ = 1;
-        if (this->dimensions_->empty())
+        if (this->dimensions_.empty())
             throw std::runtime_error("cuNDArray::allocate_memory() : dimensions is empty.");
-        for (size_t i = 0; i < this->dimensions_->size(); i++) {
-            this->elements_ *= (*this->dimensions_)[i];
+        for (size_t i = 0; i < this->dimensions_.size(); i++) {
+            this->elements_ *= this->dimensions_[i];
         } 
 
         size_t size = this->elements_ * sizeof(T);
@@ -827,20 +859,23 @@ namespace Gadgetron{
             }
         }
 
-        if (cudaMalloc((void**) &this->data_,size) != cudaSuccess) {
+        // Goes through the cache, cudaMalloc synchronizes the device
+        this->data_ = (T*) cudaMemoryCache::instance()->allocate(size);
+        if (!this->data_) {
             size_t free = 0, total = 0;
             cudaMemGetInfo(&free, &total);
             std::stringstream err("cuNDArray::allocate_memory() : Error allocating CUDA memory");
             err << "CUDA Memory: " << free << " (" << total << ")";
 
             err << "   memory requested: " << size << "( ";
-            for (size_t i = 0; i < this->dimensions_->size(); i++) {
-                std::cerr << (*this->dimensions_)[i] << " ";
+            for (size_t i = 0; i < this->dimensions_.size(); i++) {
+                std::cerr << this->dimensions_[i] << " ";
             }
             err << ")";
             this->data_ = 0;
             throw std::runtime_error(err.str());
         }
+        GadgetronMemoryTracker::instance().allocated(this->data_, size, GadgetronMemoryAccount::DEVICE);
 
         if (device_ != device_no_old) {
             if (cudaSetDevice(device_no_old) != cudaSuccess) {
@@ -860,7 +895,8 @@ namespace Gadgetron{
                 CUDA_CALL(cudaSetDevice(device_));
             }
 
-            CUDA_CALL(cudaFree(this->data_));
+            GadgetronMemoryTracker::instance().released(this->data_);
+            cudaMemoryCache::instance()->deallocate(this->data_);
             if (device_ != device_no_old) {
                 CUDA_CALL(cudaSetDevice(device_no_old));
             }
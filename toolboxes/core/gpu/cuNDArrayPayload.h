@@ -0,0 +1,121 @@
+/** \file   cuNDArrayPayload.h
+    \brief  Device resident array for the payload of messages between GPU gadgets.
+
+            A GPU gadget that produces an array on the device wraps it in a cuNDArrayPayload instead of
+            downloading it. The payload records the device of the array and an event on the stream of the
+            producer. A consumer on the same device gets the array itself, after its stream is made to wait
+            for the event; a consumer on another device gets a copy. The host copy is only downloaded when
+            a host gadget asks for it, and only once.
+
+            The device array is shared by all consumers and must be treated as read-only. Copies of a
+            payload share the array, the event and the host copy.
+*/
+
+#pragma once
+
+#include "cuNDArray.h"
+#include "hoNDArray.h"
+
+#include <cuda_runtime_api.h>
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <mutex>
+
+namespace Gadgetron{
+
+  template<class T> class cuNDArrayPayload
+  {
+  public:
+
+    cuNDArrayPayload() {}
+
+    /// Wraps array once the work queued on stream up to now, which produces the array, is done
+    cuNDArrayPayload( boost::shared_ptr< cuNDArray<T> > array, cudaStream_t stream = 0 )
+      : state_(new State)
+    {
+      state_->array = array;
+      state_->device = array->get_device();
+      state_->stream = stream;
+      state_->serial = next_serial();
+
+      int current;
+      CUDA_CALL(cudaGetDevice(&current));
+      if( current != state_->device ) CUDA_CALL(cudaSetDevice(state_->device));
+      CUDA_CALL(cudaEventCreateWithFlags(&state_->ready, cudaEventDisableTiming));
+      CUDA_CALL(cudaEventRecord(state_->ready, stream));
+      if( current != state_->device ) CUDA_CALL(cudaSetDevice(current));
+    }
+
+    bool empty() const { return !state_.get(); }
+
+    int get_device() const { return state_->device; }
+
+    cudaStream_t get_stream() const { return state_->stream; }
+
+    /// Unique number of the payload, e.g. to key caches on its content without a download
+    unsigned long long get_serial() const { return state_->serial; }
+
+    boost::shared_ptr< std::vector<size_t> > get_dimensions() const { return state_->array->get_dimensions(); }
+
+    size_t get_size( size_t dim ) const { return state_->array->get_size(dim); }
+
+    size_t get_number_of_elements() const { return state_->array->get_number_of_elements(); }
+
+    /// The array for use on the current device by work queued on stream
+    boost::shared_ptr< cuNDArray<T> > device_array( cudaStream_t stream = 0 ) const
+    {
+      int current;
+      CUDA_CALL(cudaGetDevice(&current));
+
+      if( current == state_->device ){
+        CUDA_CALL(cudaStreamWaitEvent(stream, state_->ready, 0));
+        return state_->array;
+      }
+
+      CUDA_CALL(cudaEventSynchronize(state_->ready));
+      return boost::shared_ptr< cuNDArray<T> >( new cuNDArray<T>(*state_->array) );
+    }
+
+    /// The host copy, downloaded at the first call
+    boost::shared_ptr< hoNDArray<T> > host_array() const
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+
+      if( !state_->host.get() ){
+        int current;
+        CUDA_CALL(cudaGetDevice(&current));
+        if( current != state_->device ) CUDA_CALL(cudaSetDevice(state_->device));
+        CUDA_CALL(cudaEventSynchronize(state_->ready));
+        state_->host = state_->array->to_host();
+        if( current != state_->device ) CUDA_CALL(cudaSetDevice(current));
+      }
+
+      return state_->host;
+    }
+
+  protected:
+
+    struct State
+    {
+      State() : device(-1), stream(0), ready(0), serial(0) {}
+      ~State(){ if( ready ) cudaEventDestroy(ready); }
+
+      boost::shared_ptr< cuNDArray<T> > array;
+      int device;
+      cudaStream_t stream;
+      cudaEvent_t ready;
+      unsigned long long serial;
+
+      std::mutex mutex;
+      boost::shared_ptr< hoNDArray<T> > host;
+    };
+
+    static unsigned long long next_serial()
+    {
+      static std::atomic<unsigned long long> serial(0);
+      return ++serial;
+    }
+
+    boost::shared_ptr<State> state_;
+  };
+}
@@ -0,0 +1,281 @@
+/** \file cuNDArray_expression.h
+    \brief Lazy element-wise expressions on cuNDArrays, evaluated in a single fused kernel.
+
+    Each of the element-wise operators of cuNDArray_operators.h and cuNDArray_elemwise.h is a kernel launch and a
+    full pass over device memory, so a chain such as
+
+      tmp = *x; tmp *= mask; tmp += b; *y += tmp;
+
+    reads and writes the arrays four times. The expressions of this file build the chain as a type instead,
+
+      assign( *y, lazy(*y) + lazy(*x)*lazy(mask) + lazy(b) );
+
+    and assign() instantiates one kernel for the type, which reads every input once and writes the output once.
+
+    The operands are arrays wrapped by lazy() and scalars (float, double, complext<float> and complext<double>).
+    The operators are +, -, * and / and the functions are abs, abs_square, sqrt, conj and real.
+    An array with fewer elements than the expression is repeated over the batch, as in the operators of
+    cuNDArray_operators.h. The output may appear in the expression, as each element is only read at its own index.
+
+    Only for inclusion in .cu files, as the expressions are instantiated in the kernels of the calling translation unit.
+*/
+
+#pragma once
+
+#include "cuNDArray.h"
+#include "complext.h"
+#include "check_CUDA.h"
+#include "cudaDeviceManager.h"
+
+#include <boost/utility/enable_if.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Gadgetron{
+
+  /// Base of all expressions, E is the expression type
+  template<class E> struct cuNDA_expression
+  {
+    const E& self() const { return static_cast<const E&>(*this); }
+  };
+
+  template<class S> struct cuNDA_expression_scalar : boost::false_type {};
+  template<> struct cuNDA_expression_scalar<float> : boost::true_type {};
+  template<> struct cuNDA_expression_scalar<double> : boost::true_type {};
+  template<> struct cuNDA_expression_scalar< complext<float> > : boost::true_type {};
+  template<> struct cuNDA_expression_scalar< complext<double> > : boost::true_type {};
+
+  namespace cuNDA_expression_detail{
+
+    // Sizes of the operands of a binary expression, 0 for scalars
+    inline size_t combine_sizes( size_t a, size_t b )
+    {
+      if( a == 0 ) return b;
+      if( b == 0 ) return a;
+      if( std::max(a,b) % std::min(a,b) )
+        throw std::runtime_error("cuNDA_expression: the arrays have incompatible dimensions");
+      return std::max(a,b);
+    }
+
+    // Devices of the operands of a binary expression, -1 for scalars
+    inline int combine_devices( int a, int b )
+    {
+      if( a >= 0 && b >= 0 && a != b )
+        throw std::runtime_error("cuNDA_expression: the arrays reside on different devices");
+      return (a >= 0) ? a : b;
+    }
+
+    __inline__ __device__ float expr_abs( float x ){ return fabsf(x); }
+    __inline__ __device__ double expr_abs( double x ){ return fabs(x); }
+    template<class T> __inline__ __device__ T expr_abs( const complext<T>& x ){ return Gadgetron::abs(x); }
+
+    __inline__ __device__ float expr_sqrt( float x ){ return sqrtf(x); }
+    __inline__ __device__ double expr_sqrt( double x ){ return ::sqrt(x); }
+    template<class T> __inline__ __device__ complext<T> expr_sqrt( const complext<T>& x ){ return Gadgetron::sqrt(x); }
+
+    template<class T> struct op_abs {
+      typedef typename realType<T>::Type result_type;
+      __inline__ __device__ result_type operator()( const T& x ) const { return expr_abs(x); }
+    };
+
+    template<class T> struct op_abs_square {
+      typedef typename realType<T>::Type result_type;
+      __inline__ __device__ result_type operator()( const T& x ) const { return Gadgetron::norm(x); }
+    };
+
+    template<class T> struct op_sqrt {
+      typedef T result_type;
+      __inline__ __device__ result_type operator()( const T& x ) const { return expr_sqrt(x); }
+    };
+
+    template<class T> struct op_conj {
+      typedef T result_type;
+      __inline__ __device__ result_type operator()( const T& x ) const { return Gadgetron::conj(x); }
+    };
+
+    template<class T> struct op_real {
+      typedef typename realType<T>::Type result_type;
+      __inline__ __device__ result_type operator()( const T& x ) const { return Gadgetron::real(x); }
+    };
+
+    template<class A, class B> struct op_plus {
+      typedef decltype(A()+B()) result_type;
+      __inline__ __device__ result_type operator()( const A& a, const B& b ) const { return a+b; }
+    };
+
+    template<class A, class B> struct op_minus {
+      typedef decltype(A()-B()) result_type;
+      __inline__ __device__ result_type operator()( const A& a, const B& b ) const { return a-b; }
+    };
+
+    template<class A, class B> struct op_multiplies {
+      typedef decltype(A()*B()) result_type;
+      __inline__ __device__ result_type operator()( const A& a, const B& b ) const { return a*b; }
+    };
+
+    template<class A, class B> struct op_divides {
+      typedef decltype(A()/B()) result_type;
+      __inline__ __device__ result_type operator()( const A& a, const B& b ) const { return a/b; }
+    };
+  }
+
+  /// An array operand, repeated over the batch if it is smaller than the expression
+  template<class T> class cuNDA_expression_array : public cuNDA_expression< cuNDA_expression_array<T> >
+  {
+  public:
+    typedef T value_type;
+
+    explicit cuNDA_expression_array( const cuNDArray<T>& a )
+      : data_(a.get_data_ptr()), elements_(a.get_number_of_elements()), device_(a.get_device()) {}
+
+    __inline__ __device__ T operator()( size_t i ) const { return data_[(i < elements_) ? i : i%elements_]; }
+
+    size_t size() const { return elements_; }
+    int device() const { return device_; }
+
+  protected:
+    const T* data_;
+    size_t elements_;
+    int device_;
+  };
+
+  template<class T> class cuNDA_expression_constant : public cuNDA_expression< cuNDA_expression_constant<T> >
+  {
+  public:
+    typedef T value_type;
+
+    explicit cuNDA_expression_constant( const T& value ) : value_(value) {}
+
+    __inline__ __device__ T operator()( size_t ) const { return value_; }
+
+    size_t size() const { return 0; }
+    int device() const { return -1; }
+
+  protected:
+    T value_;
+  };
+
+  template<template<class> class F, class E> class cuNDA_expression_unary : public cuNDA_expression< cuNDA_expression_unary<F,E> >
+  {
+  public:
+    typedef F<typename E::value_type> op_type;
+    typedef typename op_type::result_type value_type;
+
+    explicit cuNDA_expression_unary( const E& e ) : e_(e) {}
+
+    __inline__ __device__ value_type operator()( size_t i ) const { return op_type()(e_(i)); }
+
+    size_t size() const { return e_.size(); }
+    int device() const { return e_.device(); }
+
+  protected:
+    E e_;
+  };
+
+  template<template<class,class> class F, class L, class R> class cuNDA_expression_binary
+    : public cuNDA_expression< cuNDA_expression_binary<F,L,R> >
+  {
+  public:
+    typedef F<typename L::value_type, typename R::value_type> op_type;
+    typedef typename op_type::result_type value_type;
+
+    cuNDA_expression_binary( const L& l, const R& r )
+      : l_(l), r_(r),
+        size_(cuNDA_expression_detail::combine_sizes(l.size(), r.size())),
+        device_(cuNDA_expression_detail::combine_devices(l.device(), r.device())) {}
+
+    __inline__ __device__ value_type operator()( size_t i ) const { return op_type()(l_(i), r_(i)); }
+
+    size_t size() const { return size_; }
+    int device() const { return device_; }
+
+  protected:
+    L l_;
+    R r_;
+    size_t size_;
+    int device_;
+  };
+
+  /// Wraps an array as an operand of an expression. The array must outlive the evaluation of the expression.
+  template<class T> cuNDA_expression_array<T> lazy( const cuNDArray<T>& a )
+  {
+    return cuNDA_expression_array<T>(a);
+  }
+
+#define GADGETRON_CUNDA_EXPRESSION_FUNCTION( NAME, OP )                                                   \
+  template<class E> cuNDA_expression_unary<cuNDA_expression_detail::OP, E>                                \
+  NAME( const cuNDA_expression<E>& e )                                                                    \
+  {                                                                                                       \
+    return cuNDA_expression_unary<cuNDA_expression_detail::OP, E>(e.self());                              \
+  }
+
+  GADGETRON_CUNDA_EXPRESSION_FUNCTION( abs, op_abs )
+  GADGETRON_CUNDA_EXPRESSION_FUNCTION( abs_square, op_abs_square )
+  GADGETRON_CUNDA_EXPRESSION_FUNCTION( sqrt, op_sqrt )
+  GADGETRON_CUNDA_EXPRESSION_FUNCTION( conj, op_conj )
+  GADGETRON_CUNDA_EXPRESSION_FUNCTION( real, op_real )
+
+#undef GADGETRON_CUNDA_EXPRESSION_FUNCTION
+
+#define GADGETRON_CUNDA_EXPRESSION_OPERATOR( SYMBOL, OP )                                                 \
+  template<class L, class R> cuNDA_expression_binary<cuNDA_expression_detail::OP, L, R>                   \
+  operator SYMBOL ( const cuNDA_expression<L>& l, const cuNDA_expression<R>& r )                          \
+  {                                                                                                       \
+    return cuNDA_expression_binary<cuNDA_expression_detail::OP, L, R>(l.self(), r.self());                \
+  }                                                                                                       \
+                                                                                                          \
+  template<class L, class S> typename boost::enable_if< cuNDA_expression_scalar<S>,                       \
+    cuNDA_expression_binary<cuNDA_expression_detail::OP, L, cuNDA_expression_constant<S> > >::type        \
+  operator SYMBOL ( const cuNDA_expression<L>& l, const S& s )                                            \
+  {                                                                                                       \
+    return cuNDA_expression_binary<cuNDA_expression_detail::OP, L, cuNDA_expression_constant<S> >         \
+      (l.self(), cuNDA_expression_constant<S>(s));                                                        \
+  }                                                                                                       \
+                                                                                                          \
+  template<class S, class R> typename boost::enable_if< cuNDA_expression_scalar<S>,                       \
+    cuNDA_expression_binary<cuNDA_expression_detail::OP, cuNDA_expression_constant<S>, R > >::type        \
+  operator SYMBOL ( const S& s, const cuNDA_expression<R>& r )                                            \
+  {                                                                                                       \
+    return cuNDA_expression_binary<cuNDA_expression_detail::OP, cuNDA_expression_constant<S>, R >         \
+      (cuNDA_expression_constant<S>(s), r.self());                                                        \
+  }
+
+  GADGETRON_CUNDA_EXPRESSION_OPERATOR( +, op_plus )
+  GADGETRON_CUNDA_EXPRESSION_OPERATOR( -, op_minus )
+  GADGETRON_CUNDA_EXPRESSION_OPERATOR( *, op_multiplies )
+  GADGETRON_CUNDA_EXPRESSION_OPERATOR( /, op_divides )
+
+#undef GADGETRON_CUNDA_EXPRESSION_OPERATOR
+
+  template<class T, class E> __global__ void
+  cuNDA_expression_assign_kernel( T* out, const E e, size_t number_of_elements )
+  {
+    for( size_t idx = (size_t)blockIdx.x*blockDim.x + threadIdx.x; idx < number_of_elements; idx += (size_t)blockDim.x*gridDim.x ){
+      out[idx] = T(e(idx));
+    }
+  }
+
+  /// Evaluates the expression into out in one kernel. Out must already have the size of the expression,
+  /// or a multiple of it to repeat the expression over a batch.
+  template<class T, class E> void assign( cuNDArray<T>& out, const cuNDA_expression<E>& expression, cudaStream_t stream = 0 )
+  {
+    const E& e = expression.self();
+    const size_t number_of_elements = out.get_number_of_elements();
+
+    if( e.size() > 0 && number_of_elements % e.size() )
+      throw std::runtime_error("assign: the output array does not match the size of the expression");
+
+    if( e.device() >= 0 && e.device() != out.get_device() )
+      throw std::runtime_error("assign: the expression and the output array reside on different devices");
+
+    if( number_of_elements == 0 ) return;
+
+    const int device = out.get_device();
+    const size_t block = 256;
+    const size_t grid = std::min( (number_of_elements+block-1)/block, (size_t)cudaDeviceManager::Instance()->max_griddim(device) );
+
+    cuNDA_expression_assign_kernel<T,E><<< (unsigned int)grid, (unsigned int)block, 0, stream >>>( out.get_data_ptr(), e, number_of_elements );
+    CHECK_FOR_CUDA_ERROR();
+  }
+}
@@ -0,0 +1,60 @@
+#include "cuNDArray_half.h"
+#include "setup_grid.h"
+#include "check_CUDA.h"
+
+namespace Gadgetron {
+
+  __global__ void complex_to_half_kernel( const float_complext * __restrict__ in, complex_half * __restrict__ out, unsigned int number_of_elements )
+  {
+    const unsigned int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
+    if( idx < number_of_elements ){
+      const float_complext v = in[idx];
+      out[idx] = complex_half(v.vec[0], v.vec[1]);
+    }
+  }
+
+  __global__ void half_to_complex_kernel( const complex_half * __restrict__ in, float_complext * __restrict__ out, unsigned int number_of_elements )
+  {
+    const unsigned int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
+    if( idx < number_of_elements ){
+      const complex_half v = in[idx];
+      out[idx] = float_complext(v.real(), v.imag());
+    }
+  }
+
+  void complex_to_half( cuNDArray<float_complext> *in, cuNDArray<complex_half> *out )
+  {
+    if( in == 0x0 || out == 0x0 )
+      throw std::runtime_error("complex_to_half: illegal input pointer");
+
+    if( !out->dimensions_equal(in) )
+      out->create(in->get_dimensions());
+
+    unsigned int number_of_elements = in->get_number_of_elements();
+    if( number_of_elements == 0 ) return;
+
+    dim3 blockDim; dim3 gridDim;
+    setup_grid( number_of_elements, &blockDim, &gridDim );
+
+    complex_to_half_kernel<<< gridDim, blockDim >>>( in->get_data_ptr(), out->get_data_ptr(), number_of_elements );
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  void half_to_complex( cuNDArray<complex_half> *in, cuNDArray<float_complext> *out )
+  {
+    if( in == 0x0 || out == 0x0 )
+      throw std::runtime_error("half_to_complex: illegal input pointer");
+
+    if( !out->dimensions_equal(in) )
+      out->create(in->get_dimensions());
+
+    unsigned int number_of_elements = in->get_number_of_elements();
+    if( number_of_elements == 0 ) return;
+
+    dim3 blockDim; dim3 gridDim;
+    setup_grid( number_of_elements, &blockDim, &gridDim );
+
+    half_to_complex_kernel<<< gridDim, blockDim >>>( in->get_data_ptr(), out->get_data_ptr(), number_of_elements );
+    CHECK_FOR_CUDA_ERROR();
+  }
+}
@@ -0,0 +1,24 @@
+/**
+ * @file cuNDArray_half.h
+ * @brief Conversion between float and half precision (complex_half.h) device arrays.
+ */
+#pragma once
+
+#include "cuNDArray.h"
+#include "complex_half.h"
+#include "complext.h"
+#include "gpucore_export.h"
+
+namespace Gadgetron{
+
+/**
+ * @brief Converts to half precision, out is created with the dimensions of in if needed
+ */
+EXPORTGPUCORE void complex_to_half( cuNDArray<float_complext> *in, cuNDArray<complex_half> *out );
+
+/**
+ * @brief Converts to single precision, out is created with the dimensions of in if needed
+ */
+EXPORTGPUCORE void half_to_complex( cuNDArray<complex_half> *in, cuNDArray<float_complext> *out );
+
+}
@@ -40,6 +40,98 @@ namespace Gadgetron {
     }
   }
 
+  // Tile of the transpose kernel, 32x32 elements read and written by 32x8 threads
+  //
+
+  static const unsigned int TRANSPOSE_TILE = 32;
+  static const unsigned int TRANSPOSE_ROWS = 8;
+
+  // Batched transpose of the A x B matrices of in (A the fastest varying) into the B x A matrices of out.
+  // Reads and writes are coalesced along the rows of a tile in shared memory, padded by one column against bank conflicts.
+  template <class T>
+  __global__ void cuNDArray_transpose_kernel(const T* __restrict__ in, T* __restrict__ out,
+                                             unsigned int A, unsigned int B, unsigned int C)
+  {
+    __shared__ __align__(16) unsigned char tile_buffer[TRANSPOSE_TILE*(TRANSPOSE_TILE+1)*sizeof(T)];
+    T* tile = reinterpret_cast<T*>(tile_buffer);
+
+    const size_t AB = (size_t)A*B;
+
+    for (unsigned int c = blockIdx.z; c < C; c += gridDim.z) {
+      for (unsigned int b0 = blockIdx.y*TRANSPOSE_TILE; b0 < B; b0 += gridDim.y*TRANSPOSE_TILE) {
+
+        const unsigned int a0 = blockIdx.x*TRANSPOSE_TILE;
+        const T* in_c = in + c*AB;
+        T* out_c = out + c*AB;
+
+        unsigned int a = a0 + threadIdx.x;
+        for (unsigned int j = threadIdx.y; j < TRANSPOSE_TILE; j += TRANSPOSE_ROWS) {
+          unsigned int b = b0 + j;
+          if (a < A && b < B)
+            tile[j*(TRANSPOSE_TILE+1) + threadIdx.x] = in_c[a + (size_t)b*A];
+        }
+
+        __syncthreads();
+
+        unsigned int b = b0 + threadIdx.x;
+        for (unsigned int j = threadIdx.y; j < TRANSPOSE_TILE; j += TRANSPOSE_ROWS) {
+          a = a0 + j;
+          if (a < A && b < B)
+            out_c[b + (size_t)a*B] = tile[threadIdx.x*(TRANSPOSE_TILE+1) + j];
+        }
+
+        __syncthreads();
+      }
+    }
+  }
+
+  // Returns true and the sizes if order swaps the dimensions [0,k) with the dimensions [k,m), keeping the dimensions from m,
+  // i.e. order = [k..m-1, 0..k-1, m..n-1], which is a batched transpose of the [0,k) x [k,m) matrices
+  static bool permute_is_transpose( const std::vector<size_t>& dims, const std::vector<size_t>& order,
+                                    size_t& A, size_t& B, size_t& C )
+  {
+    const size_t n = order.size();
+    const size_t k = order[0];
+    if (k == 0) return false;
+
+    size_t m = k;
+    size_t i = 0;
+    while (i < n && order[i] == m) { i++; m++; }
+    for (size_t d = 0; d < k; d++, i++)
+      if (i >= n || order[i] != d) return false;
+    for (; i < n; i++)
+      if (order[i] != i) return false;
+
+    A = 1; B = 1; C = 1;
+    for (size_t d = 0; d < k; d++) A *= dims[d];
+    for (size_t d = k; d < m; d++) B *= dims[d];
+    for (size_t d = m; d < n; d++) C *= dims[d];
+    return true;
+  }
+
+  template <class T> void cuNDArray_transpose( const T* in, T* out, size_t A, size_t B, size_t C )
+  {
+    int device = cudaDeviceManager::Instance()->getCurrentDevice();
+    unsigned int max_griddim = (unsigned int)cudaDeviceManager::Instance()->max_griddim(device);
+
+    dim3 blockDim(TRANSPOSE_TILE, TRANSPOSE_ROWS, 1);
+    dim3 gridDim((unsigned int)((A+TRANSPOSE_TILE-1)/TRANSPOSE_TILE),
+                 (unsigned int)std::min<size_t>((B+TRANSPOSE_TILE-1)/TRANSPOSE_TILE, 65535),
+                 (unsigned int)std::min<size_t>(C, 65535));
+
+    if (gridDim.x > max_griddim)
+      throw cuda_error("cuNDArray_transpose: the fastest varying dimensions are too large");
+
+    cuNDArray_transpose_kernel<<< gridDim, blockDim >>>( in, out, (unsigned int)A, (unsigned int)B, (unsigned int)C );
+
+    cudaError_t err = cudaGetLastError();
+    if( err != cudaSuccess ){
+      std::stringstream ss;
+      ss <<"cuNDArray_transpose : Error during kernel call: " << cudaGetErrorString(err);
+      throw cuda_error(ss.str());
+    }
+  }
+
   template <class T> void cuNDArray_permute( cuNDArray<T>* in,
                                              cuNDArray<T>* out,
                                              std::vector<size_t> *order,
@@ -63,6 +155,16 @@ namespace Gadgetron {
       }
     }
 
+    // Swaps of two groups of dimensions, such as moving the coil dimension to the front or back,
+    // are batched transposes that read and write through shared memory tiles
+    {
+      size_t A, B, C;
+      if (shift_mode == 0 && permute_is_transpose(*in->get_dimensions(), *order, A, B, C) && A > 1 && B > 1) {
+        cuNDArray_transpose(in_ptr, out_ptr, A, B, C);
+        return;
+      }
+    }
+
     unsigned int* dims        = new unsigned int[in->get_number_of_dimensions()];
     unsigned int* strides_out = new unsigned int[in->get_number_of_dimensions()];
 
@@ -7,12 +7,32 @@
 #include <cuda_runtime_api.h>
 #include <stdlib.h>
 #include <sstream>
+#include <map>
 
 namespace Gadgetron{
 
+  // The mutexes protect the handle pools only, not the use of the handles
   static boost::shared_array<boost::mutex> _mutex;
   static boost::shared_array<boost::mutex> _sparseMutex;
 
+  // Protects the device scheduling
+  static boost::mutex _scheduleMutex;
+
+  // The handles leased by the calling thread, per device.
+  // A stack per device to allow nested leases.
+
+  static std::map< int, std::vector<cublasHandle_t> >& leasedHandles()
+  {
+    static thread_local std::map< int, std::vector<cublasHandle_t> > leases;
+    return leases;
+  }
+
+  static std::map< int, std::vector<cusparseHandle_t> >& leasedSparseHandles()
+  {
+    static thread_local std::map< int, std::vector<cusparseHandle_t> > leases;
+    return leases;
+  }
+
   cudaDeviceManager* cudaDeviceManager::_instance = 0;
 
   cudaDeviceManager::cudaDeviceManager() {
@@ -42,8 +62,11 @@ namespace Gadgetron{
     _max_griddim = std::vector<int>(_num_devices,0);
     _major = std::vector<int>(_num_devices,0);
     _minor = std::vector<int>(_num_devices,0);
-    _handle = std::vector<cublasHandle_t>(_num_devices, (cublasContext*)0x0);
-    _sparse_handle = std::vector<cusparseHandle_t>(_num_devices, (cusparseHandle_t)0x0);
+    _handles = std::vector< std::vector<cublasHandle_t> >(_num_devices);
+    _free_handles = std::vector< std::vector<cublasHandle_t> >(_num_devices);
+    _sparse_handles = std::vector< std::vector<cusparseHandle_t> >(_num_devices);
+    _free_sparse_handles = std::vector< std::vector<cusparseHandle_t> >(_num_devices);
+    _scheduled_keys = std::vector<size_t>(_num_devices, 0);
 
     for( int device=0; device<_num_devices; device++ ){
 
@@ -75,10 +98,10 @@ namespace Gadgetron{
   {
 
     for (int device = 0; device < _num_devices; device++){
-      if (_handle[device] != NULL)
-        cublasDestroy(_handle[device]);
-      if (_sparse_handle[device] != NULL)
-      	cusparseDestroy(_sparse_handle[device]);
+      for (size_t i = 0; i < _handles[device].size(); i++)
+        cublasDestroy(_handles[device][i]);
+      for (size_t i = 0; i < _sparse_handles[device].size(); i++)
+      	cusparseDestroy(_sparse_handles[device][i]);
     }
   }
 
@@ -180,18 +203,41 @@ namespace Gadgetron{
 
   cublasHandle_t cudaDeviceManager::lockHandle(int device)
   {
-    _mutex[device].lock();
-    if (_handle[device] == NULL){
-      cublasStatus_t ret = cublasCreate(&_handle[device]);
+    return lockHandle(device, 0);
+  }
+
+  cublasHandle_t cudaDeviceManager::lockHandle(int device, cudaStream_t stream)
+  {
+    cublasHandle_t handle = NULL;
+    {
+      boost::mutex::scoped_lock lock(_mutex[device]);
+      if (!_free_handles[device].empty()){
+        handle = _free_handles[device].back();
+        _free_handles[device].pop_back();
+      }
+    }
+
+    if (handle == NULL){
+      // A handle is associated with the device current at its creation
+      int old_device;
+      CUDA_CALL(cudaGetDevice(&old_device));
+      CUDA_CALL(cudaSetDevice(device));
+      cublasStatus_t ret = cublasCreate(&handle);
+      CUDA_CALL(cudaSetDevice(old_device));
       if (ret != CUBLAS_STATUS_SUCCESS) {
       	std::stringstream ss;
       	ss << "Error: unable to create cublas handle for device " << device << " : ";
         ss << gadgetron_getCublasErrorString(ret) << std::endl;
       	throw cuda_error(ss.str());
       }
-      cublasSetPointerMode( _handle[device], CUBLAS_POINTER_MODE_HOST );
+      cublasSetPointerMode( handle, CUBLAS_POINTER_MODE_HOST );
+      boost::mutex::scoped_lock lock(_mutex[device]);
+      _handles[device].push_back(handle);
     }
-    return _handle[device];
+
+    cublasSetStream( handle, stream );
+    leasedHandles()[device].push_back(handle);
+    return handle;
   }
 
   void cudaDeviceManager::unlockHandle()
@@ -203,7 +249,15 @@ namespace Gadgetron{
 
   void cudaDeviceManager::unlockHandle(int device)
   {
-    _mutex[device].unlock();
+    std::vector<cublasHandle_t> &leases = leasedHandles()[device];
+    if (leases.empty())
+      throw std::runtime_error("cudaDeviceManager::unlockHandle: no cublas handle leased by this thread");
+
+    cublasHandle_t handle = leases.back();
+    leases.pop_back();
+
+    boost::mutex::scoped_lock lock(_mutex[device]);
+    _free_handles[device].push_back(handle);
   }
 
   cusparseHandle_t cudaDeviceManager::lockSparseHandle()
@@ -215,19 +269,40 @@ namespace Gadgetron{
 
   cusparseHandle_t cudaDeviceManager::lockSparseHandle(int device)
   {
-    _sparseMutex[device].lock();
-    if (_sparse_handle[device] == NULL){
-      cusparseStatus_t ret = cusparseCreate(&_sparse_handle[device]);
+    return lockSparseHandle(device, 0);
+  }
+
+  cusparseHandle_t cudaDeviceManager::lockSparseHandle(int device, cudaStream_t stream)
+  {
+    cusparseHandle_t handle = NULL;
+    {
+      boost::mutex::scoped_lock lock(_sparseMutex[device]);
+      if (!_free_sparse_handles[device].empty()){
+        handle = _free_sparse_handles[device].back();
+        _free_sparse_handles[device].pop_back();
+      }
+    }
+
+    if (handle == NULL){
+      int old_device;
+      CUDA_CALL(cudaGetDevice(&old_device));
+      CUDA_CALL(cudaSetDevice(device));
+      cusparseStatus_t ret = cusparseCreate(&handle);
+      CUDA_CALL(cudaSetDevice(old_device));
       if (ret != CUSPARSE_STATUS_SUCCESS) {
       	std::stringstream ss;
       	ss << "Error: unable to create cusparse handle for device " << device << " : ";
         ss << gadgetron_getCusparseErrorString(ret) << std::endl;
       	throw cuda_error(ss.str());
       }
-      cusparseSetPointerMode(_sparse_handle[device],CUSPARSE_POINTER_MODE_HOST);
-      //cublasSetPointerMode( _handle[device], CUBLAS_POINTER_MODE_HOST );
+      cusparseSetPointerMode( handle, CUSPARSE_POINTER_MODE_HOST );
+      boost::mutex::scoped_lock lock(_sparseMutex[device]);
+      _sparse_handles[device].push_back(handle);
     }
-    return _sparse_handle[device];
+
+    cusparseSetStream( handle, stream );
+    leasedSparseHandles()[device].push_back(handle);
+    return handle;
   }
 
   void cudaDeviceManager::unlockSparseHandle()
@@ -239,9 +314,148 @@ namespace Gadgetron{
 
   void cudaDeviceManager::unlockSparseHandle(int device)
   {
-    _sparseMutex[device].unlock();
+    std::vector<cusparseHandle_t> &leases = leasedSparseHandles()[device];
+    if (leases.empty())
+      throw std::runtime_error("cudaDeviceManager::unlockSparseHandle: no cusparse handle leased by this thread");
+
+    cusparseHandle_t handle = leases.back();
+    leases.pop_back();
+
+    boost::mutex::scoped_lock lock(_sparseMutex[device]);
+    _free_sparse_handles[device].push_back(handle);
+  }
+
+  size_t cudaDeviceManager::getNumberOfHandles(int device)
+  {
+    boost::mutex::scoped_lock lock(_mutex[device]);
+    return _handles[device].size();
+  }
+
+  size_t cudaDeviceManager::getNumberOfSparseHandles(int device)
+  {
+    boost::mutex::scoped_lock lock(_sparseMutex[device]);
+    return _sparse_handles[device].size();
+  }
+
+
+  cudaMemoryCache::Statistics cudaDeviceManager::getMemoryCacheStatistics()
+  {
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+    return getMemoryCacheStatistics(device);
+  }
+
+  cudaMemoryCache::Statistics cudaDeviceManager::getMemoryCacheStatistics(int device)
+  {
+    return cudaMemoryCache::instance()->statistics(device);
+  }
+
+  void cudaDeviceManager::releaseCachedMemory()
+  {
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+    releaseCachedMemory(device);
+  }
+
+  void cudaDeviceManager::releaseCachedMemory(int device)
+  {
+    cudaMemoryCache::instance()->release_cached_memory(device);
+  }
+
+  void cudaDeviceManager::setMaxCachedMemory(size_t bytes)
+  {
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+    setMaxCachedMemory(device, bytes);
+  }
+
+  void cudaDeviceManager::setMaxCachedMemory(int device, size_t bytes)
+  {
+    cudaMemoryCache::instance()->set_max_cached_bytes(device, bytes);
+  }
+
+  void cudaDeviceManager::setMemoryCaching(bool enable)
+  {
+    cudaMemoryCache::instance()->set_enabled(enable);
+  }
+
+  cudaPinnedMemoryPool::Statistics cudaDeviceManager::getPinnedMemoryPoolStatistics()
+  {
+    return cudaPinnedMemoryPool::instance()->statistics();
+  }
+
+  void cudaDeviceManager::releasePinnedMemory()
+  {
+    cudaPinnedMemoryPool::instance()->release_cached_memory();
+  }
+
+  void cudaDeviceManager::setMaxPinnedMemory(size_t bytes)
+  {
+    cudaPinnedMemoryPool::instance()->set_max_cached_bytes(bytes);
   }
 
+  void cudaDeviceManager::setPinnedMemoryPooling(bool enable)
+  {
+    cudaPinnedMemoryPool::instance()->set_enabled(enable);
+  }
+
+  int cudaDeviceManager::scheduleDevice(const void* key)
+  {
+    boost::mutex::scoped_lock lock(_scheduleMutex);
+
+    std::map< const void*, std::pair<int, size_t> >::iterator it = _scheduled.find(key);
+    if (it != _scheduled.end()) {
+      it->second.second++;
+      return it->second.first;
+    }
+
+    int best = 0;
+    size_t best_load = 0, best_free = 0;
+    for (int device = 0; device < _num_devices; device++) {
+      size_t leased_handles;
+      {
+        boost::mutex::scoped_lock handle_lock(_mutex[device]);
+        leased_handles = _handles[device].size() - _free_handles[device].size();
+      }
+      size_t load = _scheduled_keys[device] + leased_handles;
+      size_t free = getFreeMemory(device) + getMemoryCacheStatistics(device).bytes_cached;
+
+      if (device == 0 || load < best_load || (load == best_load && free > best_free)) {
+        best = device;
+        best_load = load;
+        best_free = free;
+      }
+    }
+
+    _scheduled[key] = std::make_pair(best, size_t(1));
+    _scheduled_keys[best]++;
+    return best;
+  }
+
+  void cudaDeviceManager::releaseDevice(const void* key)
+  {
+    boost::mutex::scoped_lock lock(_scheduleMutex);
+
+    std::map< const void*, std::pair<int, size_t> >::iterator it = _scheduled.find(key);
+    if (it == _scheduled.end()) return;
+
+    if (--it->second.second == 0) {
+      _scheduled_keys[it->second.first]--;
+      _scheduled.erase(it);
+    }
+  }
+
+  int cudaDeviceManager::selectDevice(int requested, const void* key)
+  {
+    if (requested < 0) return scheduleDevice(key);
+    return requested % _num_devices;
+  }
+
+  size_t cudaDeviceManager::getNumberOfScheduledKeys(int device)
+  {
+    boost::mutex::scoped_lock lock(_scheduleMutex);
+    return _scheduled_keys[device];
+  }
 
   int cudaDeviceManager::getCurrentDevice()
   {
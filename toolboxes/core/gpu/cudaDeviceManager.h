@@ -3,8 +3,11 @@
 #include "gpucore_export.h"
 
 #include <vector>
+#include <map>
 #include <cublas_v2.h>
 #include "cuSparseMatrix.h"
+#include "cudaMemoryCache.h"
+#include "cudaPinnedMemoryPool.h"
 
 namespace Gadgetron{
 
@@ -48,21 +51,67 @@ namespace Gadgetron{
     size_t getTotalMemory();
     size_t getTotalMemory(int device);
 
-    // Access to Cublas is protected by a mutex
-    // Despite what the Cublas manual claims, we have not found it thread safe.
+    // A cublas/cusparse handle must not be used by two threads at the same time.
+    // lockHandle leases a handle from a per-device pool to the calling thread until it calls unlockHandle,
+    // so concurrent threads get different handles and do not serialise on their BLAS calls.
+    // The handle is bound to the given stream (the default stream if none is given) for the lease.
 
     cublasHandle_t lockHandle();
     cublasHandle_t lockHandle(int device);
+    cublasHandle_t lockHandle(int device, cudaStream_t stream);
 
     void unlockHandle();
     void unlockHandle(int device);
 
     cusparseHandle_t lockSparseHandle();
     cusparseHandle_t lockSparseHandle(int device);
+    cusparseHandle_t lockSparseHandle(int device, cudaStream_t stream);
 
     void unlockSparseHandle();
     void unlockSparseHandle(int device);
 
+    // Number of handles created for the device so far, i.e. the peak number of concurrent leases
+    size_t getNumberOfHandles(int device);
+    size_t getNumberOfSparseHandles(int device);
+
+    // The device memory of the cuNDArrays is cached, see cudaMemoryCache.h
+    //
+
+    cudaMemoryCache::Statistics getMemoryCacheStatistics();
+    cudaMemoryCache::Statistics getMemoryCacheStatistics(int device);
+
+    void releaseCachedMemory();
+    void releaseCachedMemory(int device);
+
+    void setMaxCachedMemory(size_t bytes);
+    void setMaxCachedMemory(int device, size_t bytes);
+
+    void setMemoryCaching(bool enable);
+
+    // The page-locked host memory of the hoCuNDArrays is pooled, see cudaPinnedMemoryPool.h
+    //
+
+    cudaPinnedMemoryPool::Statistics getPinnedMemoryPoolStatistics();
+    void releasePinnedMemory();
+    void setMaxPinnedMemory(size_t bytes);
+    void setPinnedMemoryPooling(bool enable);
+
+    // Device scheduling for work that may run on any device.
+    // scheduleDevice places a key (e.g. the stream of a gadget) on the least loaded device: the fewest
+    // scheduled keys and leased cublas handles, then the most free memory (cached device memory counts as free).
+    // Further calls with the same key return the same device, so the gadgets of a stream share one device.
+    // Every call has to be matched by a call of releaseDevice with the key.
+
+    int scheduleDevice(const void* key);
+    void releaseDevice(const void* key);
+
+    // Device for a requested device number: the number itself (modulo the number of devices),
+    // or a scheduled device for key if the number is < 0, to be released with releaseDevice
+    int selectDevice(int requested, const void* key);
+
+    // Number of keys scheduled on the device
+    size_t getNumberOfScheduledKeys(int device);
+
 
   private:
 
@@ -82,8 +131,52 @@ namespace Gadgetron{
     std::vector<int> _max_griddim;
     std::vector<int> _major;
     std::vector<int> _minor;
-    std::vector<cublasHandle_t> _handle;
-    std::vector<cusparseHandle_t> _sparse_handle;
+    std::vector< std::vector<cublasHandle_t> > _handles; // all handles per device
+    std::vector< std::vector<cublasHandle_t> > _free_handles;
+    std::vector< std::vector<cusparseHandle_t> > _sparse_handles;
+    std::vector< std::vector<cusparseHandle_t> > _free_sparse_handles;
+    std::map< const void*, std::pair<int, size_t> > _scheduled; // device and number of requests per key
+    std::vector<size_t> _scheduled_keys; // keys per device
     static cudaDeviceManager * _instance;
   };
+
+  // The device of a gadget with a deviceno property, see cudaDeviceManager::selectDevice.
+  // A deviceno >= 0 is used as it is. A deviceno < 0 leaves the device to the scheduler; the gadgets select
+  // with their stream controller as the key, so all gadgets of a stream share one device and it stays
+  // scheduled until the last of them releases it (scheduleDevice/releaseDevice count the requests per key).
+  // A scheduled device is released when the selection is destroyed or makes another selection.
+
+  class cudaDeviceSelection
+  {
+  public:
+    cudaDeviceSelection() : _device(-1), _key(0), _scheduled(false) {}
+    ~cudaDeviceSelection() { release(); }
+
+    int select(int requested, const void* key)
+    {
+      release();
+      _device = cudaDeviceManager::Instance()->selectDevice(requested, key);
+      _key = key;
+      _scheduled = (requested < 0);
+      return _device;
+    }
+
+    void release()
+    {
+      if (_scheduled) cudaDeviceManager::Instance()->releaseDevice(_key);
+      _scheduled = false;
+      _device = -1;
+    }
+
+    int device() const { return _device; }
+    bool scheduled() const { return _scheduled; }
+
+  private:
+    cudaDeviceSelection(const cudaDeviceSelection&);
+    cudaDeviceSelection& operator=(const cudaDeviceSelection&);
+
+    int _device;
+    const void* _key;
+    bool _scheduled;
+  };
 }
@@ -0,0 +1,300 @@
+#include "cudaMemoryCache.h"
+#include "check_CUDA.h"
+#include "GadgetronMetrics.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/shared_array.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Gadgetron{
+
+  namespace {
+
+    struct Block
+    {
+      size_t size;
+      cudaStream_t stream;
+    };
+
+    struct DeviceCache
+    {
+      DeviceCache() : max_cached_bytes(0) {}
+
+      boost::mutex mutex;
+      std::map< std::pair<cudaStream_t, size_t>, std::vector<void*> > free_blocks;
+      std::map<void*, Block> used_blocks;
+      cudaMemoryCache::Statistics statistics;
+      size_t max_cached_bytes;
+    };
+
+    boost::shared_array<DeviceCache> _caches;
+    std::atomic<bool> _enabled(true);
+
+    // Restores the current device when it goes out of scope
+    struct DeviceGuard
+    {
+      DeviceGuard(int device) : old_device(-1)
+      {
+        CUDA_CALL(cudaGetDevice(&old_device));
+        if (device != old_device) CUDA_CALL(cudaSetDevice(device));
+      }
+
+      ~DeviceGuard()
+      {
+        int device;
+        if (cudaGetDevice(&device) == cudaSuccess && device != old_device) cudaSetDevice(old_device);
+      }
+
+      int old_device;
+    };
+  }
+
+  cudaMemoryCache::cudaMemoryCache()
+  {
+    if (cudaGetDeviceCount(&_num_devices) != cudaSuccess) {
+      _num_devices = 0;
+      throw cuda_error("Error: no Cuda devices present.");
+    }
+
+    _caches = boost::shared_array<DeviceCache>(new DeviceCache[_num_devices]);
+
+    for (int device = 0; device < _num_devices; device++) {
+      cudaDeviceProp deviceProp;
+      if (cudaGetDeviceProperties(&deviceProp, device) != cudaSuccess) {
+        throw cuda_error("Error: unable to determine device properties.");
+      }
+      _caches[device].max_cached_bytes = deviceProp.totalGlobalMem / 4;
+    }
+
+    const char* env = std::getenv("GADGETRON_CUDA_MEMORY_CACHE");
+    if (env && std::string(env) == "0") {
+      _enabled = false;
+    }
+  }
+
+  cudaMemoryCache::~cudaMemoryCache()
+  {
+  }
+
+  cudaMemoryCache* cudaMemoryCache::instance()
+  {
+    // Never deleted, cuNDArrays with static storage duration may be released after the end of main
+    static cudaMemoryCache* cache = new cudaMemoryCache;
+    static bool exported = export_metrics(cache);
+    (void)exported;
+    return cache;
+  }
+
+  bool cudaMemoryCache::export_metrics(cudaMemoryCache* cache)
+  {
+    GadgetronMetrics::instance().add_collector("gpu_memory_cache", [cache](std::ostream& os) {
+      std::vector<Statistics> s(cache->_num_devices);
+      for (int device = 0; device < cache->_num_devices; device++) s[device] = cache->statistics(device);
+
+      const char* names[] = { "gadgetron_gpu_memory_cache_bytes_in_use", "gadgetron_gpu_memory_cache_bytes_cached",
+                              "gadgetron_gpu_memory_cache_allocations_total", "gadgetron_gpu_memory_cache_hits_total" };
+      const char* help[] = { "Device memory handed out by the cache", "Device memory held in the free lists of the cache",
+                             "Device memory allocations through the cache", "Device memory allocations served from the free lists" };
+      const char* types[] = { "gauge", "gauge", "counter", "counter" };
+
+      for (int m = 0; m < 4; m++) {
+        GadgetronMetrics::write_header(os, names[m], help[m], types[m]);
+        for (int device = 0; device < cache->_num_devices; device++) {
+          size_t v = (m == 0) ? s[device].bytes_in_use : (m == 1) ? s[device].bytes_cached :
+                     (m == 2) ? s[device].allocations : s[device].cache_hits;
+          GadgetronMetrics::write_sample(os, names[m], "device=\"" + std::to_string(device) + "\"", v);
+        }
+      }
+    });
+    return true;
+  }
+
+  size_t cudaMemoryCache::bin_size(size_t size)
+  {
+    const size_t small_granularity = 512;
+    const size_t large_granularity = size_t(128) << 10;
+    const size_t small_limit = size_t(1) << 20;
+
+    size_t g = (size <= small_limit) ? small_granularity : large_granularity;
+    if (size == 0) return g;
+    return ((size + g - 1) / g) * g;
+  }
+
+  void* cudaMemoryCache::allocate(size_t size, cudaStream_t stream)
+  {
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+
+    void* ptr = 0;
+
+    if (!_enabled) {
+      if (cudaMalloc(&ptr, size) != cudaSuccess) {
+        cudaGetLastError();
+        return 0;
+      }
+      return ptr;
+    }
+
+    size_t bin = bin_size(size);
+    DeviceCache& c = _caches[device];
+
+    {
+      boost::mutex::scoped_lock lock(c.mutex);
+      c.statistics.allocations++;
+
+      std::map< std::pair<cudaStream_t, size_t>, std::vector<void*> >::iterator it = c.free_blocks.find(std::make_pair(stream, bin));
+      if (it != c.free_blocks.end() && !it->second.empty()) {
+        ptr = it->second.back();
+        it->second.pop_back();
+
+        Block b = { bin, stream };
+        c.used_blocks[ptr] = b;
+
+        c.statistics.cache_hits++;
+        c.statistics.bytes_cached -= bin;
+        c.statistics.bytes_in_use += bin;
+        if (c.statistics.bytes_in_use > c.statistics.peak_bytes_in_use) c.statistics.peak_bytes_in_use = c.statistics.bytes_in_use;
+        return ptr;
+      }
+    }
+
+    if (cudaMalloc(&ptr, bin) != cudaSuccess) {
+      // The memory may be held in the free lists
+      cudaGetLastError();
+      release_cached_memory(device);
+
+      if (cudaMalloc(&ptr, bin) != cudaSuccess) {
+        cudaGetLastError();
+        return 0;
+      }
+    }
+
+    boost::mutex::scoped_lock lock(c.mutex);
+
+    Block b = { bin, stream };
+    c.used_blocks[ptr] = b;
+
+    c.statistics.device_allocations++;
+    c.statistics.bytes_in_use += bin;
+    if (c.statistics.bytes_in_use > c.statistics.peak_bytes_in_use) c.statistics.peak_bytes_in_use = c.statistics.bytes_in_use;
+
+    return ptr;
+  }
+
+  void cudaMemoryCache::deallocate(void* ptr)
+  {
+    if (!ptr) return;
+
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+
+    DeviceCache& c = _caches[device];
+
+    {
+      boost::mutex::scoped_lock lock(c.mutex);
+
+      std::map<void*, Block>::iterator it = c.used_blocks.find(ptr);
+      if (it != c.used_blocks.end()) {
+        Block b = it->second;
+        c.used_blocks.erase(it);
+        c.statistics.bytes_in_use -= b.size;
+
+        if (_enabled && (c.statistics.bytes_cached + b.size <= c.max_cached_bytes)) {
+          c.free_blocks[std::make_pair(b.stream, b.size)].push_back(ptr);
+          c.statistics.bytes_cached += b.size;
+          return;
+        }
+
+        c.statistics.device_frees++;
+      }
+    }
+
+    CUDA_CALL(cudaFree(ptr));
+  }
+
+  void cudaMemoryCache::release_cached_memory(int device)
+  {
+    if (device < 0 || device >= _num_devices) {
+      throw cuda_error("cudaMemoryCache::release_cached_memory: invalid device no");
+    }
+
+    DeviceCache& c = _caches[device];
+
+    std::map< std::pair<cudaStream_t, size_t>, std::vector<void*> > blocks;
+    {
+      boost::mutex::scoped_lock lock(c.mutex);
+      blocks.swap(c.free_blocks);
+      c.statistics.bytes_cached = 0;
+      for (std::map< std::pair<cudaStream_t, size_t>, std::vector<void*> >::iterator it = blocks.begin(); it != blocks.end(); it++) {
+        c.statistics.device_frees += it->second.size();
+      }
+    }
+
+    if (blocks.empty()) return;
+
+    DeviceGuard guard(device);
+    for (std::map< std::pair<cudaStream_t, size_t>, std::vector<void*> >::iterator it = blocks.begin(); it != blocks.end(); it++) {
+      for (size_t n = 0; n < it->second.size(); n++) {
+        CUDA_CALL(cudaFree(it->second[n]));
+      }
+    }
+  }
+
+  void cudaMemoryCache::release_cached_memory()
+  {
+    for (int device = 0; device < _num_devices; device++) {
+      release_cached_memory(device);
+    }
+  }
+
+  size_t cudaMemoryCache::max_cached_bytes(int device)
+  {
+    boost::mutex::scoped_lock lock(_caches[device].mutex);
+    return _caches[device].max_cached_bytes;
+  }
+
+  void cudaMemoryCache::set_max_cached_bytes(int device, size_t bytes)
+  {
+    bool release = false;
+    {
+      boost::mutex::scoped_lock lock(_caches[device].mutex);
+      _caches[device].max_cached_bytes = bytes;
+      release = (_caches[device].statistics.bytes_cached > bytes);
+    }
+
+    if (release) release_cached_memory(device);
+  }
+
+  cudaMemoryCache::Statistics cudaMemoryCache::statistics(int device)
+  {
+    boost::mutex::scoped_lock lock(_caches[device].mutex);
+    return _caches[device].statistics;
+  }
+
+  void cudaMemoryCache::reset_statistics(int device)
+  {
+    boost::mutex::scoped_lock lock(_caches[device].mutex);
+    Statistics& s = _caches[device].statistics;
+    s.allocations = 0;
+    s.cache_hits = 0;
+    s.device_allocations = 0;
+    s.device_frees = 0;
+    s.peak_bytes_in_use = s.bytes_in_use;
+  }
+
+  bool cudaMemoryCache::enabled()
+  {
+    return _enabled;
+  }
+
+  void cudaMemoryCache::set_enabled(bool e)
+  {
+    _enabled = e;
+    if (!e) release_cached_memory();
+  }
+}
@@ -0,0 +1,85 @@
+/** \file   cudaMemoryCache.h
+    \brief  Caching allocator for the device memory of the cuNDArrays.
+
+            cudaMalloc and cudaFree both synchronize the device, and the iterative solvers create and
+            destroy temporaries in every iteration. Memory released by a cuNDArray is therefore kept in
+            per device free lists, binned by size and by the stream it was allocated for, and handed out
+            again to the next allocation of the same bin on the same device and stream. Work on one stream
+            is executed in order, so a block is never reused before the kernels using it have finished.
+
+            Bins are multiples of 512 bytes up to 1 MB and multiples of 128 KB above. The cached memory of
+            a device is bounded by max_cached_bytes() (a quarter of the device memory by default); beyond
+            that released blocks are freed. If cudaMalloc fails, the cached memory of the device is released
+            and the allocation is retried.
+
+            Pointers that were not allocated here (e.g. arrays wrapping external device memory) are
+            released with cudaFree. The cache is enabled by default, it is disabled with set_enabled(false)
+            or with the environment variable GADGETRON_CUDA_MEMORY_CACHE=0.
+            The cache is managed per device through the cudaDeviceManager.
+*/
+
+#pragma once
+
+#include "gpucore_export.h"
+
+#include <cuda_runtime_api.h>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTGPUCORE cudaMemoryCache
+  {
+  public:
+
+    struct Statistics
+    {
+      Statistics() : allocations(0), cache_hits(0), device_allocations(0), device_frees(0),
+                     bytes_in_use(0), bytes_cached(0), peak_bytes_in_use(0) {}
+
+      size_t allocations;         // calls to allocate()
+      size_t cache_hits;          // allocations served from the free lists
+      size_t device_allocations;  // calls to cudaMalloc
+      size_t device_frees;        // calls to cudaFree
+      size_t bytes_in_use;        // handed out and not released, in bins
+      size_t bytes_cached;        // held in the free lists
+      size_t peak_bytes_in_use;
+    };
+
+    static cudaMemoryCache* instance();
+
+    /// Allocate at least size bytes on the current device for use on stream, 0 if the device is out of memory
+    void* allocate(size_t size, cudaStream_t stream = 0);
+
+    /// Release memory of the current device, the pointer may come from cudaMalloc directly
+    void deallocate(void* ptr);
+
+    /// Free the cached blocks of a device, or of all devices
+    void release_cached_memory(int device);
+    void release_cached_memory();
+
+    size_t max_cached_bytes(int device);
+    void set_max_cached_bytes(int device, size_t bytes);
+
+    Statistics statistics(int device);
+    void reset_statistics(int device);
+
+    /// Disabling the cache releases all cached memory, blocks in use are freed when they are released
+    bool enabled();
+    void set_enabled(bool e);
+
+    static size_t bin_size(size_t size);
+
+  private:
+
+    // Use the instance() method to access the singleton
+    //
+
+    cudaMemoryCache();
+    ~cudaMemoryCache();
+
+    // Registers the statistics of all devices with the GadgetronMetrics
+    static bool export_metrics(cudaMemoryCache* cache);
+
+    int _num_devices;
+  };
+}
@@ -0,0 +1,215 @@
+#include "cudaPinnedMemoryPool.h"
+#include "check_CUDA.h"
+#include "GadgetronMetrics.h"
+
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Gadgetron{
+
+  namespace {
+
+    boost::mutex _mutex;
+    std::map< size_t, std::vector<void*> > _free_blocks;
+    std::map< void*, size_t > _used_blocks;
+    cudaPinnedMemoryPool::Statistics _statistics;
+    size_t _max_cached_bytes = size_t(1) << 30;
+    std::atomic<bool> _enabled(true);
+
+    void* host_alloc(size_t size)
+    {
+      void* ptr = 0;
+      if (cudaHostAlloc(&ptr, size, cudaHostAllocPortable) != cudaSuccess) {
+        cudaGetLastError();
+        return 0;
+      }
+      return ptr;
+    }
+  }
+
+  cudaPinnedMemoryPool::cudaPinnedMemoryPool()
+  {
+    const char* env = std::getenv("GADGETRON_CUDA_PINNED_MEMORY_POOL");
+    if (env && std::string(env) == "0") {
+      _enabled = false;
+    }
+  }
+
+  cudaPinnedMemoryPool::~cudaPinnedMemoryPool()
+  {
+  }
+
+  cudaPinnedMemoryPool* cudaPinnedMemoryPool::instance()
+  {
+    // Never deleted, hoCuNDArrays with static storage duration may be released after the end of main
+    static cudaPinnedMemoryPool* pool = new cudaPinnedMemoryPool;
+    static bool exported = export_metrics(pool);
+    (void)exported;
+    return pool;
+  }
+
+  bool cudaPinnedMemoryPool::export_metrics(cudaPinnedMemoryPool* pool)
+  {
+    GadgetronMetrics::instance().add_collector("pinned_memory_pool", [pool](std::ostream& os) {
+      Statistics s = pool->statistics();
+
+      GadgetronMetrics::write_header(os, "gadgetron_pinned_memory_pool_bytes_in_use", "Page-locked host memory handed out by the pool", "gauge");
+      GadgetronMetrics::write_sample(os, "gadgetron_pinned_memory_pool_bytes_in_use", "", s.bytes_in_use);
+      GadgetronMetrics::write_header(os, "gadgetron_pinned_memory_pool_bytes_cached", "Page-locked host memory held in the free lists of the pool", "gauge");
+      GadgetronMetrics::write_sample(os, "gadgetron_pinned_memory_pool_bytes_cached", "", s.bytes_cached);
+      GadgetronMetrics::write_header(os, "gadgetron_pinned_memory_pool_allocations_total", "Page-locked allocations through the pool", "counter");
+      GadgetronMetrics::write_sample(os, "gadgetron_pinned_memory_pool_allocations_total", "", s.allocations);
+      GadgetronMetrics::write_header(os, "gadgetron_pinned_memory_pool_hits_total", "Page-locked allocations served from the free lists", "counter");
+      GadgetronMetrics::write_sample(os, "gadgetron_pinned_memory_pool_hits_total", "", s.cache_hits);
+    });
+    return true;
+  }
+
+  size_t cudaPinnedMemoryPool::bin_size(size_t size)
+  {
+    const size_t small_granularity = size_t(4) << 10;
+    const size_t large_granularity = size_t(1) << 20;
+
+    size_t g = (size <= large_granularity) ? small_granularity : large_granularity;
+    if (size == 0) return g;
+    return ((size + g - 1) / g) * g;
+  }
+
+  void* cudaPinnedMemoryPool::allocate(size_t size)
+  {
+    if (!_enabled) {
+      return host_alloc(size);
+    }
+
+    size_t bin = bin_size(size);
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _statistics.allocations++;
+
+      std::map< size_t, std::vector<void*> >::iterator it = _free_blocks.find(bin);
+      if (it != _free_blocks.end() && !it->second.empty()) {
+        void* ptr = it->second.back();
+        it->second.pop_back();
+        _used_blocks[ptr] = bin;
+
+        _statistics.cache_hits++;
+        _statistics.bytes_cached -= bin;
+        _statistics.bytes_in_use += bin;
+        if (_statistics.bytes_in_use > _statistics.peak_bytes_in_use) _statistics.peak_bytes_in_use = _statistics.bytes_in_use;
+        return ptr;
+      }
+    }
+
+    void* ptr = host_alloc(bin);
+    if (!ptr) {
+      // The memory may be held in the free lists
+      release_cached_memory();
+      ptr = host_alloc(bin);
+      if (!ptr) return 0;
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _used_blocks[ptr] = bin;
+
+    _statistics.host_allocations++;
+    _statistics.bytes_in_use += bin;
+    if (_statistics.bytes_in_use > _statistics.peak_bytes_in_use) _statistics.peak_bytes_in_use = _statistics.bytes_in_use;
+
+    return ptr;
+  }
+
+  void cudaPinnedMemoryPool::deallocate(void* ptr)
+  {
+    if (!ptr) return;
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+
+      std::map< void*, size_t >::iterator it = _used_blocks.find(ptr);
+      if (it != _used_blocks.end()) {
+        size_t bin = it->second;
+        _used_blocks.erase(it);
+        _statistics.bytes_in_use -= bin;
+
+        if (_enabled && (_statistics.bytes_cached + bin <= _max_cached_bytes)) {
+          _free_blocks[bin].push_back(ptr);
+          _statistics.bytes_cached += bin;
+          return;
+        }
+
+        _statistics.host_frees++;
+      }
+    }
+
+    CUDA_CALL(cudaFreeHost(ptr));
+  }
+
+  void cudaPinnedMemoryPool::release_cached_memory()
+  {
+    std::map< size_t, std::vector<void*> > blocks;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      blocks.swap(_free_blocks);
+      _statistics.bytes_cached = 0;
+      for (std::map< size_t, std::vector<void*> >::iterator it = blocks.begin(); it != blocks.end(); it++) {
+        _statistics.host_frees += it->second.size();
+      }
+    }
+
+    for (std::map< size_t, std::vector<void*> >::iterator it = blocks.begin(); it != blocks.end(); it++) {
+      for (size_t n = 0; n < it->second.size(); n++) {
+        CUDA_CALL(cudaFreeHost(it->second[n]));
+      }
+    }
+  }
+
+  size_t cudaPinnedMemoryPool::max_cached_bytes()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _max_cached_bytes;
+  }
+
+  void cudaPinnedMemoryPool::set_max_cached_bytes(size_t bytes)
+  {
+    bool release = false;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _max_cached_bytes = bytes;
+      release = (_statistics.bytes_cached > bytes);
+    }
+
+    if (release) release_cached_memory();
+  }
+
+  cudaPinnedMemoryPool::Statistics cudaPinnedMemoryPool::statistics()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _statistics;
+  }
+
+  void cudaPinnedMemoryPool::reset_statistics()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _statistics.allocations = 0;
+    _statistics.cache_hits = 0;
+    _statistics.host_allocations = 0;
+    _statistics.host_frees = 0;
+    _statistics.peak_bytes_in_use = _statistics.bytes_in_use;
+  }
+
+  bool cudaPinnedMemoryPool::enabled()
+  {
+    return _enabled;
+  }
+
+  void cudaPinnedMemoryPool::set_enabled(bool e)
+  {
+    _enabled = e;
+    if (!e) release_cached_memory();
+  }
+}
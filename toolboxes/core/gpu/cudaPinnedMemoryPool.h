@@ -0,0 +1,82 @@
+/** \file   cudaPinnedMemoryPool.h
+    \brief  Pool of page-locked host buffers for the hoCuNDArrays.
+
+            cudaMallocHost and cudaFreeHost take milliseconds and serialize the driver, and the out-of-core
+            hoCu solvers and operators create and destroy page-locked temporaries all the time. Buffers
+            released by a hoCuNDArray are therefore kept in free lists binned by size and handed out again
+            to the next allocation of the same size class.
+
+            Size classes are multiples of 4 KB up to 1 MB and multiples of 1 MB above. The memory held in
+            the free lists is bounded by max_cached_bytes() (1 GB by default); beyond that released buffers
+            are freed. The buffers are allocated portable, they can be used with all devices.
+
+            Unlike cudaFreeHost, deallocate() does not wait for the device. A buffer used for an asynchronous
+            copy must not be released before the copy is complete.
+
+            Pointers that were not allocated here are released with cudaFreeHost. The pool is enabled by
+            default, it is disabled with set_enabled(false) or with the environment variable
+            GADGETRON_CUDA_PINNED_MEMORY_POOL=0.
+*/
+
+#pragma once
+
+#include "gpucore_export.h"
+
+#include <cuda_runtime_api.h>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  class EXPORTGPUCORE cudaPinnedMemoryPool
+  {
+  public:
+
+    struct Statistics
+    {
+      Statistics() : allocations(0), cache_hits(0), host_allocations(0), host_frees(0),
+                     bytes_in_use(0), bytes_cached(0), peak_bytes_in_use(0) {}
+
+      size_t allocations;         // calls to allocate()
+      size_t cache_hits;          // allocations served from the free lists
+      size_t host_allocations;    // calls to cudaHostAlloc
+      size_t host_frees;          // calls to cudaFreeHost
+      size_t bytes_in_use;        // handed out and not released, in size classes
+      size_t bytes_cached;        // held in the free lists
+      size_t peak_bytes_in_use;
+    };
+
+    static cudaPinnedMemoryPool* instance();
+
+    /// Allocate at least size bytes of page-locked host memory, 0 if the allocation fails
+    void* allocate(size_t size);
+
+    /// Release a buffer, the pointer may come from cudaMallocHost directly
+    void deallocate(void* ptr);
+
+    /// Free the buffers held in the free lists
+    void release_cached_memory();
+
+    size_t max_cached_bytes();
+    void set_max_cached_bytes(size_t bytes);
+
+    Statistics statistics();
+    void reset_statistics();
+
+    /// Disabling the pool releases all cached memory, buffers in use are freed when they are released
+    bool enabled();
+    void set_enabled(bool e);
+
+    static size_t bin_size(size_t size);
+
+  private:
+
+    // Use the instance() method to access the singleton
+    //
+
+    cudaPinnedMemoryPool();
+    ~cudaPinnedMemoryPool();
+
+    // Registers the statistics of the pool with the GadgetronMetrics
+    static bool export_metrics(cudaPinnedMemoryPool* pool);
+  };
+}
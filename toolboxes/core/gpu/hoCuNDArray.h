@@ -11,6 +11,7 @@
 #include "hoNDArray.h"
 #include "cuNDArray.h"
 #include "check_CUDA.h"
+#include "cudaPinnedMemoryPool.h"
 
 namespace Gadgetron{
 
@@ -26,7 +27,7 @@ namespace Gadgetron{
     	this->data_ = other.data_;
     	this->dimensions_ = other.dimensions_;
     	this->elements_ = other.elements_;
-    	other.dimensions_.reset();
+    	other.dimensions_.clear();
     	other.data_ = nullptr;
     }
 #endif
@@ -114,8 +115,8 @@ namespace Gadgetron{
         else{
             deallocate_memory();
             this->data_ = 0;
-            *(this->dimensions_) = *(rhs.dimensions_);
-            *(this->offsetFactors_) = *(rhs.offsetFactors_);
+            this->dimensions_ = rhs.dimensions_;
+            this->offsetFactors_ = rhs.offsetFactors_;
             this->allocate_memory();
             memcpy( this->data_, rhs.data_, this->elements_*sizeof(T) );
         }
@@ -148,8 +149,8 @@ namespace Gadgetron{
         this->dimensions_ = rhs.dimensions_;
         this->offsetFactors_ = rhs.offsetFactors_;
         this->elements_ = rhs.elements_;
-        rhs.dimensions_.reset();
-        rhs.offsetFactors_.reset();
+        rhs.dimensions_.clear();
+        rhs.offsetFactors_.clear();
         this->data_ = rhs.data_;
         rhs.data_ = nullptr;
         return *this;
@@ -161,20 +162,24 @@ namespace Gadgetron{
     {
       this->deallocate_memory();
       this->elements_ = 1;
-      if (this->dimensions_->empty())
+      if (this->dimensions_.empty())
         throw std::runtime_error("hoCuNDArray::allocate_memory() : dimensions is empty.");
-      for (size_t i = 0; i < this->dimensions_->size(); i++) {
-        this->elements_ *= (*this->dimensions_)[i];
+      for (size_t i = 0; i < this->dimensions_.size(); i++) {
+        this->elements_ *= this->dimensions_[i];
       }
 
+      // Page-locked memory is recycled through the pool, see cudaPinnedMemoryPool.h
       size_t size = this->elements_ * sizeof(T);
-      CUDA_CALL(cudaMallocHost((void**)&this->data_,size));
+      this->data_ = static_cast<T*>(cudaPinnedMemoryPool::instance()->allocate(size));
+      if (!this->data_) {
+        throw cuda_error("hoCuNDArray::allocate_memory() : unable to allocate page-locked memory.");
+      }
     }
 
     virtual void deallocate_memory()
     {
       if (this->data_) {
-        CUDA_CALL(cudaFreeHost(this->data_));
+        cudaPinnedMemoryPool::instance()->deallocate(this->data_);
         this->data_ = 0;
       }
     }
@@ -17,12 +17,15 @@
 #include "setup_grid.h"
 
 #include <cuda_runtime_api.h>
+#include <cuda_fp16.h>
 #include <math_constants.h>
 #include <cufft.h>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
 #include <vector>
+#include <thread>
+#include <exception>
 
 #define PS_ORIGIN_CENTERING
 #define IS_ORIGIN_CENTERING
@@ -40,6 +43,17 @@ image_tex( NORMALIZED_TC, cudaFilterModeLinear, cudaAddressModeBorder );
 static texture<float, cudaTextureType2DLayered, cudaReadModeElementType> 
 projections_tex( NORMALIZED_TC, cudaFilterModeLinear, cudaAddressModeBorder );
 
+// The projections of the binned backprojection are stored as fp16, they are read as float
+//
+
+static texture<float, cudaTextureType2DLayered, cudaReadModeElementType> 
+projections_half_tex( NORMALIZED_TC, cudaFilterModeLinear, cudaAddressModeBorder );
+
+// Bins backprojected by one kernel, each accumulates in a register of the thread
+//
+
+#define MAX_BINS_PER_PASS 16
+
 namespace Gadgetron 
 {
 
@@ -663,6 +677,96 @@ conebeam_forwards_projection( hoCuNDArray<float> *projections,
 
 }
 
+// Metric position of the image voxel 'co'
+//
+
+static __inline__ __device__ floatd3
+backprojection_voxel_position( const intd3 &co, const intd3 &is_dims_in_pixels_int, const floatd3 &is_dims_in_mm )
+{
+#ifdef IS_ORIGIN_CENTERING
+	const floatd3 is_pc = floatd3(co[0], co[1], co[2]) + floatd3(0.5);
+#else
+	const floatd3 is_pc = floatd3(co[0], co[1], co[2]);
+#endif
+
+	// Normalized image space coordinate [-0.5, 0.5[
+	//
+
+	const floatd3 is_dims_in_pixels(is_dims_in_pixels_int[0],is_dims_in_pixels_int[1],is_dims_in_pixels_int[2]);
+
+#ifdef FLIP_Z_AXIS
+	floatd3 is_nc = is_pc / is_dims_in_pixels - floatd3(0.5f);
+	is_nc[2] *= -1.0f;
+#else
+	const floatd3 is_nc = is_pc / is_dims_in_pixels - floatd3(0.5f);
+#endif
+
+	// Image space coordinate in metric units
+	//
+
+	return is_nc * is_dims_in_mm;
+}
+
+// Normalized texture coordinate on the projection plate of the metric image position 'pos',
+// for the projection at 'angle' (in radians)
+//
+
+static __inline__ __device__ floatd2
+backprojection_plate_coordinate( const floatd3 &pos, float angle, const floatd2 &offset,
+		const floatd2 &ps_dims_in_pixels, const floatd2 &ps_dims_in_mm, float SDD, float SAD )
+{
+	// Projection rotation matrix
+	//
+
+	const float3x3 inverseRotation = calcRotationMatrixAroundZ(-angle);
+
+	// Rotated image coordinate (local to the projection's coordinate system)
+	//
+
+	const floatd3 pos_proj = mul(inverseRotation, pos);
+
+	// Project the image position onto the projection plate.
+	// Account for half-fan and sag offsets.
+	//
+
+	const floatd3 startPoint = floatd3(0.0f, -SAD, 0.0f);
+	floatd3 dir = pos_proj - startPoint;
+	dir = dir / dir[1];
+	const floatd3 endPoint = startPoint + dir * SDD;
+	const floatd2 endPoint2d = floatd2(endPoint[0], endPoint[2]) - offset;
+
+	// Convert metric projection coordinates into pixel coordinates
+	//
+
+#ifndef PS_ORIGIN_CENTERING
+	return ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f)) + floatd2(0.5f)/ps_dims_in_pixels;
+	//return ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f)) * ps_dims_in_pixels + floatd2(0.5f);
+#else
+	return ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f));
+#endif
+}
+
+// Distance weight of filtered backprojection
+//
+
+static __inline__ __device__ float
+backprojection_fbp_weight( const floatd3 &pos, float angle, float SAD )
+{
+	// Equation 3.59, page 96 and equation 10.2, page 386
+	// in Computed Tomography 2nd edition, Jiang Hsieh
+	//
+
+	const float xx = pos[0];
+	const float yy = pos[1];
+	const float beta = angle;
+	const float r = hypotf(xx,yy);
+	const float phi = atan2f(yy,xx);
+	const float D = SAD;
+	const float ym = r*sinf(beta-phi);
+	const float U = (D+ym)/D;
+	return 1.0f/(U*U);
+}
+
 template <bool FBP> __global__ void
 conebeam_backwards_projection_kernel( float * __restrict__ image,
 		const float * __restrict__ angles,
@@ -675,40 +779,23 @@ conebeam_backwards_projection_kernel( float * __restrict__ image,
 		float num_projections_in_bin,
 		float SDD,
 		float SAD,
-		bool accumulate )
+		bool accumulate,
+		int slab_offset, // First slice of the image held in 'image'
+		int slab_size )  // Number of slices held in 'image'
 {
 	// Image voxel to backproject into (pixel coordinate and index)
 	//
 
 	const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
-	const int num_elements = prod(is_dims_in_pixels_int);
+	const intd3 slab_dims(is_dims_in_pixels_int[0], is_dims_in_pixels_int[1], slab_size);
+	const int num_elements = prod(slab_dims);
 
 	if( idx < num_elements ){
 
-		const intd3 co = idx_to_co<3>(idx, is_dims_in_pixels_int);
-
-#ifdef IS_ORIGIN_CENTERING
-		const floatd3 is_pc = floatd3(co[0], co[1], co[2]) + floatd3(0.5);
-#else
-		const floatd3 is_pc = floatd3(co[0], co[1], co[2]);
-#endif
-
-		// Normalized image space coordinate [-0.5, 0.5[
-		//
-
-		const floatd3 is_dims_in_pixels(is_dims_in_pixels_int[0],is_dims_in_pixels_int[1],is_dims_in_pixels_int[2]);
-
-#ifdef FLIP_Z_AXIS
-		floatd3 is_nc = is_pc / is_dims_in_pixels - floatd3(0.5f);
-		is_nc[2] *= -1.0f;
-#else
-		const floatd3 is_nc = is_pc / is_dims_in_pixels - floatd3(0.5f);
-#endif
-
-		// Image space coordinate in metric units
-		//
+		intd3 co = idx_to_co<3>(idx, slab_dims);
+		co[2] += slab_offset;
 
-		const floatd3 pos = is_nc * is_dims_in_mm;
+		const floatd3 pos = backprojection_voxel_position(co, is_dims_in_pixels_int, is_dims_in_mm);
 
 		// Read the existing output value for accumulation at this point.
 		// The cost of this fetch is hidden by the loop
@@ -727,57 +814,13 @@ conebeam_backwards_projection_kernel( float * __restrict__ image,
 
 			const float angle = degrees2radians(angles[projection]);
 
-			// Projection rotation matrix
-			//
-
-			const float3x3 inverseRotation = calcRotationMatrixAroundZ(-angle);
-
-			// Rotated image coordinate (local to the projection's coordinate system)
-			//
-
-			const floatd3 pos_proj = mul(inverseRotation, pos);
-
-			// Project the image position onto the projection plate.
-			// Account for half-fan and sag offsets.
-			//
-
-			const floatd3 startPoint = floatd3(0.0f, -SAD, 0.0f);
-			floatd3 dir = pos_proj - startPoint;
-			dir = dir / dir[1];
-			const floatd3 endPoint = startPoint + dir * SDD;
-			const floatd2 endPoint2d = floatd2(endPoint[0], endPoint[2]) - offsets[projection];
-
-			// Convert metric projection coordinates into pixel coordinates
-			//
-
-#ifndef PS_ORIGIN_CENTERING
-			floatd2 ps_pc = ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f)) + floatd2(0.5f)/ps_dims_in_pixels;
-			//floatd2 ps_pc = ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f)) * ps_dims_in_pixels + floatd2(0.5f);
-#else
-			floatd2 ps_pc = ((endPoint2d / ps_dims_in_mm) + floatd2(0.5f));
-#endif
+			const floatd2 ps_pc = backprojection_plate_coordinate
+					( pos, angle, offsets[projection], ps_dims_in_pixels, ps_dims_in_mm, SDD, SAD );
 
 			// Apply filter (filtered backprojection mode only)
 			//
 
-			float weight = 1.0;
-
-			if( FBP ){
-
-				// Equation 3.59, page 96 and equation 10.2, page 386
-				// in Computed Tomography 2nd edition, Jiang Hsieh
-				//
-
-				const float xx = pos[0];
-				const float yy = pos[1];
-				const float beta = angle;
-				const float r = hypotf(xx,yy);
-				const float phi = atan2f(yy,xx);
-				const float D = SAD;
-				const float ym = r*sinf(beta-phi);
-				const float U = (D+ym)/D;
-				weight = 1.0f/(U*U);
-			}
+			const float weight = (FBP) ? backprojection_fbp_weight(pos, angle, SAD) : 1.0f;
 
 			// Read the projection data (bilinear interpolation enabled) and accumulate
 			//
@@ -1104,7 +1147,8 @@ void conebeam_backwards_projection( hoCuNDArray<float> *projections,
 		conebeam_backwards_projection_kernel<FBP><<< dimGrid, dimBlock, 0, mainStream >>>
 				( image_device->get_data_ptr(), raw_angles, raw_offsets,
 						is_dims_in_pixels, is_dims_in_mm, ps_dims_in_pixels, ps_dims_in_mm,
-						projections_in_batch, num_projections_in_bin, SDD, SAD, (batch==0) ? accumulate : true );
+						projections_in_batch, num_projections_in_bin, SDD, SAD, (batch==0) ? accumulate : true,
+						0, matrix_size_z );
 
 		CHECK_FOR_CUDA_ERROR();
 
@@ -1138,14 +1182,956 @@ void conebeam_backwards_projection( hoCuNDArray<float> *projections,
 	CHECK_FOR_CUDA_ERROR();
 }
 
-// Template instantiations
+//
+// Streamed projections
+// - the projection batches pass through a ring of device buffers, one per stream, so the host-device
+//   transfers of some batches overlap the computations on the others
+// - the work is spread over one host thread per device
 //
 
-template void conebeam_backwards_projection<false>
-( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
-		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>* );
+// Runs fun(device, i) on one host thread per device, the first error is rethrown
+//
 
-template void conebeam_backwards_projection<true>
-( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
+template<class F> static void
+for_each_device( const std::vector<int> &devices, F fun )
+{
+	std::vector<std::exception_ptr> errors(devices.size());
+	std::vector<std::thread> threads;
+
+	for( size_t i=0; i<devices.size(); i++ ){
+		threads.push_back( std::thread( [&,i]() {
+			try{
+				CUDA_CALL(cudaSetDevice(devices[i]));
+				fun(devices[i], i);
+			}
+			catch(...){
+				errors[i] = std::current_exception();
+			}
+		}));
+	}
+
+	for( size_t i=0; i<threads.size(); i++ )
+		threads[i].join();
+
+	for( size_t i=0; i<errors.size(); i++ )
+		if( errors[i] )
+			std::rethrow_exception(errors[i]);
+}
+
+// All devices of the system if none are given
+//
+
+static std::vector<int>
+streaming_devices( std::vector<int> devices )
+{
+	if( devices.empty() ){
+		int num_devices;
+		CUDA_CALL(cudaGetDeviceCount(&num_devices));
+		for( int i=0; i<num_devices; i++ )
+			devices.push_back(i);
+	}
+
+	if( devices.empty() )
+		throw std::runtime_error("Error: conebeam projection: no devices available");
+
+	return devices;
+}
+
+// Copies the projections [from_projection;to_projection[ of a bin between the host array (holding all bins)
+// and a device batch buffer. Sequentially numbered projections are copied in one operation.
+//
+
+static void
+copy_binned_projections( float *host_projections, float *batch_DevPtr,
+		const std::vector<unsigned int> &indices, int from_projection, int to_projection,
+		size_t projection_size, cudaMemcpyKind kind, cudaStream_t stream )
+{
+	int p = from_projection;
+
+	while( p<to_projection ) {
+
+		int num_sequential_projections = 1;
+		while( p+num_sequential_projections < to_projection &&
+				indices[p+num_sequential_projections]==(indices[p+num_sequential_projections-1]+1) ){
+			num_sequential_projections++;
+		}
+
+		float *host = host_projections+indices[p]*projection_size;
+		float *device = batch_DevPtr+(p-from_projection)*projection_size;
+		size_t bytes = projection_size*num_sequential_projections*sizeof(float);
+
+		if( kind == cudaMemcpyHostToDevice )
+			CUDA_CALL(cudaMemcpyAsync( device, host, bytes, kind, stream ));
+		else
+			CUDA_CALL(cudaMemcpyAsync( host, device, bytes, kind, stream ));
+
+		p += num_sequential_projections;
+	}
+}
+
+// A copy of 'in' on 'device', or a view of 'in' if it resides there already
+//
+
+static boost::shared_ptr< cuNDArray<float> >
+array_on_device( cuNDArray<float> *in, int device )
+{
+	if( in->get_device() == device )
+		return boost::shared_ptr< cuNDArray<float> >( new cuNDArray<float>(in->get_dimensions(), in->get_data_ptr()) );
+
+	boost::shared_ptr< cuNDArray<float> > out( new cuNDArray<float>(in->get_dimensions(), device) );
+	CUDA_CALL(cudaMemcpyPeer( out->get_data_ptr(), device, in->get_data_ptr(), in->get_device(), in->get_number_of_bytes() ));
+	return out;
+}
+
+void
+conebeam_forwards_projection_streamed( hoCuNDArray<float> *projections,
+		hoCuNDArray<float> *image,
+		std::vector<float> angles,
+		std::vector<floatd2> offsets,
+		std::vector<unsigned int> indices,
+		int projections_per_batch,
+		float samples_per_pixel,
+		floatd3 is_dims_in_mm,
+		floatd2 ps_dims_in_mm,
+		float SDD,
+		float SAD,
+		std::vector<int> devices,
+		int num_streams )
+{
+	//
+	// Validate the input
+	//
+
+	if( projections == 0x0 || image == 0x0 ){
+		throw std::runtime_error("Error: conebeam_forwards_projection_streamed: illegal array pointer provided");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: conebeam_forwards_projection_streamed: projections array must be three-dimensional");
+	}
+
+	if( image->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: conebeam_forwards_projection_streamed: image array must be three-dimensional");
+	}
+
+	if( projections->get_size(2) != angles.size() || projections->get_size(2) != offsets.size() ) {
+		throw std::runtime_error("Error: conebeam_forwards_projection_streamed: inconsistent sizes of input arrays/vectors");
+	}
+
+	devices = streaming_devices(devices);
+
+	if( num_streams < 1 )
+		num_streams = 1;
+
+	int projection_res_x = projections->get_size(0);
+	int projection_res_y = projections->get_size(1);
+	size_t projection_size = size_t(projection_res_x)*projection_res_y;
+
+	int num_projections_in_bin = indices.size();
+	int num_projections_in_all_bins = projections->get_size(2);
+
+	int matrix_size_x = image->get_size(0);
+	int matrix_size_y = image->get_size(1);
+	int matrix_size_z = image->get_size(2);
+
+	if( projections_per_batch > num_projections_in_bin )
+		projections_per_batch = num_projections_in_bin;
+
+	int num_batches = (num_projections_in_bin+projections_per_batch-1) / projections_per_batch;
+
+	std::vector<float> angles_vec;
+	std::vector<floatd2> offsets_vec;
+
+	for( int p=0; p<indices.size(); p++ ){
+
+		int from_id = indices[p];
+
+		if( from_id >= num_projections_in_all_bins ) {
+			throw std::runtime_error("Error: conebeam_forwards_projection_streamed: illegal index in bin");
+		}
+
+		angles_vec.push_back(angles[from_id]);
+		offsets_vec.push_back(offsets[from_id]);
+	}
+
+	//
+	// The batches are dealt out to the devices in turn.
+	// Every device holds the entire image as its texture, the rays cross all of it.
+	//
+
+	for_each_device( devices, [&]( int device, size_t d ) {
+
+		// Build texture from input image
+		//
+
+		cudaFuncSetCacheConfig(conebeam_forwards_projection_kernel, cudaFuncCachePreferL1);
+		cudaChannelFormatDesc channelDesc = cudaCreateChannelDesc<float>();
+		cudaExtent extent;
+		extent.width = matrix_size_x;
+		extent.height = matrix_size_y;
+		extent.depth = matrix_size_z;
+
+		cudaMemcpy3DParms cpy_params = {0};
+		cpy_params.kind = cudaMemcpyHostToDevice;
+		cpy_params.extent = extent;
+
+		cudaArray *image_array;
+		cudaMalloc3DArray(&image_array, &channelDesc, extent);
+		CHECK_FOR_CUDA_ERROR();
+
+		cpy_params.dstArray = image_array;
+		cpy_params.srcPtr = make_cudaPitchedPtr
+				((void*)image->get_data_ptr(), extent.width*sizeof(float), extent.width, extent.height);
+		cudaMemcpy3D(&cpy_params);
+		CHECK_FOR_CUDA_ERROR();
+
+		cudaBindTextureToArray(image_tex, image_array, channelDesc);
+		CHECK_FOR_CUDA_ERROR();
+
+		thrust::device_vector<float> angles_devVec(angles_vec);
+		thrust::device_vector<floatd2> offsets_devVec(offsets_vec);
+
+		// One projections buffer per stream
+		//
+
+		std::vector<float*> projections_DevPtrs(num_streams);
+		std::vector<cudaStream_t> streams(num_streams);
+
+		for( int s=0; s<num_streams; s++ ){
+			CUDA_CALL(cudaMalloc( (void**) &projections_DevPtrs[s], projection_size*projections_per_batch*sizeof(float) ));
+			CUDA_CALL(cudaStreamCreateWithFlags( &streams[s], cudaStreamNonBlocking ));
+		}
+
+		floatd3 is_dims_in_pixels(matrix_size_x, matrix_size_y, matrix_size_z);
+		intd2 ps_dims_in_pixels(projection_res_x, projection_res_y);
+
+		//
+		// Iterate over the batches of this device.
+		// A stream downloads its batch while the next stream computes, and reuses its buffer in stream order.
+		//
+
+		for( int batch=int(d), n=0; batch<num_batches; batch+=int(devices.size()), n++ ){
+
+			const int s = n % num_streams;
+
+			int from_projection = batch * projections_per_batch;
+			int to_projection = std::min( (batch+1) * projections_per_batch, num_projections_in_bin );
+			int projections_in_batch = to_projection-from_projection;
+
+			dim3 dimBlock, dimGrid;
+			setup_grid( projection_size*projections_in_batch, &dimBlock, &dimGrid );
+
+			float* raw_angles = thrust::raw_pointer_cast(&angles_devVec[from_projection]);
+			floatd2* raw_offsets = thrust::raw_pointer_cast(&offsets_devVec[from_projection]);
+
+			conebeam_forwards_projection_kernel<<< dimGrid, dimBlock, 0, streams[s] >>>
+					( projections_DevPtrs[s], raw_angles, raw_offsets,
+							is_dims_in_pixels, is_dims_in_mm, ps_dims_in_pixels, ps_dims_in_mm,
+							projections_in_batch, SDD, SAD, samples_per_pixel*float(matrix_size_x) );
+			CHECK_FOR_CUDA_ERROR();
+
+			copy_binned_projections( projections->get_data_ptr(), projections_DevPtrs[s], indices,
+					from_projection, to_projection, projection_size, cudaMemcpyDeviceToHost, streams[s] );
+		}
+
+		// Cleanup
+		//
+
+		for( int s=0; s<num_streams; s++ ){
+			CUDA_CALL(cudaStreamSynchronize(streams[s]));
+			CUDA_CALL(cudaStreamDestroy(streams[s]));
+			CUDA_CALL(cudaFree(projections_DevPtrs[s]));
+		}
+
+		cudaUnbindTexture(image_tex);
+		cudaFreeArray(image_array);
+		CHECK_FOR_CUDA_ERROR();
+	});
+}
+
+template <bool FBP>
+void conebeam_backwards_projection_streamed( hoCuNDArray<float> *projections,
+		hoCuNDArray<float> *image,
+		std::vector<float> angles,
+		std::vector<floatd2> offsets,
+		std::vector<unsigned int> indices,
+		int projections_per_batch,
+		intd3 is_dims_in_pixels,
+		floatd3 is_dims_in_mm,
+		floatd2 ps_dims_in_mm,
+		float SDD,
+		float SAD,
+		bool short_scan,
+		bool use_offset_correction,
+		bool accumulate,
+		cuNDArray<float> *cosine_weights,
+		cuNDArray<float> *frequency_filter,
+		std::vector<int> devices,
+		int num_streams
+)
+{
+	//
+	// Validate the input
+	//
+
+	if( projections == 0x0 || image == 0x0 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: illegal array pointer provided");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: projections array must be three-dimensional");
+	}
+
+	if( image->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: image array must be three-dimensional");
+	}
+
+	if( projections->get_size(2) != angles.size() || projections->get_size(2) != offsets.size() ) {
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: inconsistent sizes of input arrays/vectors");
+	}
+
+	if( FBP && !(cosine_weights && frequency_filter) ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: for _filtered_ backprojection both cosine weights and a filter must be provided");
+	}
+
+	devices = streaming_devices(devices);
+
+	if( num_streams < 1 )
+		num_streams = 1;
+
+	// Some utility variables
+	//
+
+	int matrix_size_x = image->get_size(0);
+	int matrix_size_y = image->get_size(1);
+	int matrix_size_z = image->get_size(2);
+
+	int projection_res_x = projections->get_size(0);
+	int projection_res_y = projections->get_size(1);
+	size_t projection_size = size_t(projection_res_x)*projection_res_y;
+
+	floatd2 ps_dims_in_pixels(projection_res_x, projection_res_y);
+
+	int num_projections_in_all_bins = projections->get_size(2);
+	int num_projections_in_bin = indices.size();
+
+	if( projections_per_batch > num_projections_in_bin )
+		projections_per_batch = num_projections_in_bin;
+
+	int num_batches = (num_projections_in_bin+projections_per_batch-1) / projections_per_batch;
+
+	std::vector<float> angles_vec;
+	std::vector<floatd2> offsets_vec;
+
+	for( int p=0; p<indices.size(); p++ ){
+
+		int from_id = indices[p];
+
+		if( from_id >= num_projections_in_all_bins ) {
+			throw std::runtime_error("Error: conebeam_backwards_projection_streamed: illegal index in bin");
+		}
+
+		angles_vec.push_back(angles[from_id]);
+		offsets_vec.push_back(offsets[from_id]);
+	}
+
+	//
+	// Split the image into slabs of whole slices, at least one per device.
+	// There are more slabs than devices if a slab would not fit next to the projection buffers.
+	//
+
+	const size_t slice_bytes = size_t(matrix_size_x)*matrix_size_y*sizeof(float);
+	const size_t batch_bytes = projection_size*projections_per_batch*sizeof(float);
+
+	// A buffer per stream, the texture array and for FBP the zero padded projections and their spectrum
+	const size_t batch_buffer_bytes = batch_bytes*(num_streams+1+(FBP ? 4 : 0));
+
+	size_t free_bytes = cudaDeviceManager::Instance()->getFreeMemory(devices[0]);
+	for( size_t d=1; d<devices.size(); d++ )
+		free_bytes = std::min(free_bytes, cudaDeviceManager::Instance()->getFreeMemory(devices[d]));
+
+	// Leave a tenth in reserve for cuFFT plans and the angles/offsets
+	free_bytes -= free_bytes/10;
+
+	if( free_bytes < batch_buffer_bytes+slice_bytes ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_streamed: insufficient device memory, reduce the number of projections per batch or streams");
+	}
+
+	int slab_size = int( std::min( (free_bytes-batch_buffer_bytes)/slice_bytes,
+			(matrix_size_z+devices.size()-1)/devices.size() ) );
+	int num_slabs = (matrix_size_z+slab_size-1)/slab_size;
+
+	for_each_device( devices, [&]( int device, size_t d ) {
+
+		// The filters are given on the device of the caller
+		//
+
+		boost::shared_ptr< cuNDArray<float> > device_cosine_weights, device_frequency_filter;
+
+		if( FBP ){
+			device_cosine_weights = array_on_device(cosine_weights, device);
+			device_frequency_filter = array_on_device(frequency_filter, device);
+		}
+
+		thrust::device_vector<float> angles_devVec(angles_vec);
+		thrust::device_vector<floatd2> offsets_devVec(offsets_vec);
+
+		// One projections buffer per upload stream.
+		// 'uploaded' signals a full buffer to the default stream, 'consumed' an empty one to the upload stream.
+		//
+
+		std::vector<float*> projections_DevPtrs(num_streams);
+		std::vector<cudaStream_t> streams(num_streams);
+		std::vector<cudaEvent_t> uploaded(num_streams), consumed(num_streams);
+
+		for( int s=0; s<num_streams; s++ ){
+			CUDA_CALL(cudaMalloc( (void**) &projections_DevPtrs[s], batch_bytes ));
+			CUDA_CALL(cudaStreamCreateWithFlags( &streams[s], cudaStreamNonBlocking ));
+			CUDA_CALL(cudaEventCreateWithFlags( &uploaded[s], cudaEventDisableTiming ));
+			CUDA_CALL(cudaEventCreateWithFlags( &consumed[s], cudaEventDisableTiming ));
+		}
+
+		auto upload = [&]( int batch ) {
+
+			const int s = batch % num_streams;
+			int from_projection = batch * projections_per_batch;
+			int to_projection = std::min( (batch+1) * projections_per_batch, num_projections_in_bin );
+
+			CUDA_CALL(cudaStreamWaitEvent( streams[s], consumed[s], 0 ));
+			copy_binned_projections( projections->get_data_ptr(), projections_DevPtrs[s], indices,
+					from_projection, to_projection, projection_size, cudaMemcpyHostToDevice, streams[s] );
+			CUDA_CALL(cudaEventRecord( uploaded[s], streams[s] ));
+		};
+
+		// The texture array is written and read in the default stream only,
+		// a single one bound for the duration suffices
+		//
+
+		cudaChannelFormatDesc channelDesc = cudaCreateChannelDesc<float>();
+		cudaExtent array_extent;
+		array_extent.width = projection_res_x;
+		array_extent.height = projection_res_y;
+		array_extent.depth = projections_per_batch;
+
+		cudaArray *projections_array;
+		cudaMalloc3DArray( &projections_array, &channelDesc, array_extent, cudaArrayLayered );
+		CHECK_FOR_CUDA_ERROR();
+
+		cudaBindTextureToArray( projections_tex, projections_array, channelDesc );
+		CHECK_FOR_CUDA_ERROR();
+
+		cudaFuncSetCacheConfig(conebeam_backwards_projection_kernel<FBP>, cudaFuncCachePreferL1);
+
+		//
+		// Iterate over the slabs of this device, all projections are streamed through for each
+		//
+
+		for( int slab=int(d); slab<num_slabs; slab+=int(devices.size()) ){
+
+			const int slab_offset = slab*slab_size;
+			const int slab_slices = std::min(slab_size, matrix_size_z-slab_offset);
+			const size_t slab_elements = size_t(matrix_size_x)*matrix_size_y*slab_slices;
+			float *image_slab = image->get_data_ptr()+size_t(slab_offset)*matrix_size_x*matrix_size_y;
+
+			std::vector<size_t> slab_dims;
+			slab_dims.push_back(matrix_size_x);
+			slab_dims.push_back(matrix_size_y);
+			slab_dims.push_back(slab_slices);
+
+			cuNDArray<float> image_device(&slab_dims);
+
+			if( accumulate )
+				CUDA_CALL(cudaMemcpy( image_device.get_data_ptr(), image_slab, slab_elements*sizeof(float), cudaMemcpyHostToDevice ));
+
+			for( int batch=0; batch<std::min(num_streams, num_batches); batch++ )
+				upload(batch);
+
+			for( int batch=0; batch<num_batches; batch++ ){
+
+				const int s = batch % num_streams;
+
+				int from_projection = batch * projections_per_batch;
+				int to_projection = std::min( (batch+1) * projections_per_batch, num_projections_in_bin );
+				int projections_in_batch = to_projection-from_projection;
+
+				float* raw_angles = thrust::raw_pointer_cast(&angles_devVec[from_projection]);
+				floatd2* raw_offsets = thrust::raw_pointer_cast(&offsets_devVec[from_projection]);
+
+				// Filter and backproject in the default stream once the batch has arrived
+				//
+
+				CUDA_CALL(cudaStreamWaitEvent( 0, uploaded[s], 0 ));
+
+				std::vector<size_t> dims;
+				dims.push_back(projection_res_x);
+				dims.push_back(projection_res_y);
+				dims.push_back(projections_in_batch);
+
+				cuNDArray<float> projections_batch(&dims, projections_DevPtrs[s]);
+
+				if( FBP ){
+
+					projections_batch *= *device_cosine_weights;
+
+					if( short_scan ){
+						float delta = std::atan(ps_dims_in_mm[0]/(2.0f*SDD));
+						redundancy_correct( &projections_batch, raw_angles, delta );
+					}
+
+					uint64d3 pad_dims(dims[0]<<1, dims[1], dims[2]);
+					boost::shared_ptr< cuNDArray<float> > padded_projections = pad<float,3>( pad_dims, &projections_batch );
+					boost::shared_ptr< cuNDArray<complext<float> > > complex_projections = cb_fft( padded_projections.get() );
+					*complex_projections *= *device_frequency_filter;
+					cb_ifft( complex_projections.get(), padded_projections.get() );
+					uint64d3 crop_offsets(dims[0]>>1, 0, 0);
+					crop<float,3>( crop_offsets, padded_projections.get(), &projections_batch );
+
+					if (use_offset_correction)
+						offset_correct( &projections_batch, raw_offsets, ps_dims_in_mm, SAD, SDD );
+
+				} else if (use_offset_correction)
+					offset_correct_sqrt( &projections_batch, raw_offsets, ps_dims_in_mm, SAD, SDD );
+
+				cudaExtent extent = array_extent;
+				extent.depth = projections_in_batch;
+
+				cudaMemcpy3DParms cpy_params = {0};
+				cpy_params.extent = extent;
+				cpy_params.dstArray = projections_array;
+				cpy_params.kind = cudaMemcpyDeviceToDevice;
+				cpy_params.srcPtr =
+						make_cudaPitchedPtr( (void*)projections_batch.get_data_ptr(), projection_res_x*sizeof(float),
+								projection_res_x, projection_res_y );
+				CUDA_CALL(cudaMemcpy3DAsync( &cpy_params, 0 ));
+
+				// The buffer is free for the upload of a later batch while this one is backprojected
+				//
+
+				CUDA_CALL(cudaEventRecord( consumed[s], 0 ));
+
+				if( batch+num_streams < num_batches )
+					upload(batch+num_streams);
+
+				dim3 dimBlock, dimGrid;
+				setup_grid( slab_elements, &dimBlock, &dimGrid );
+
+				conebeam_backwards_projection_kernel<FBP><<< dimGrid, dimBlock >>>
+						( image_device.get_data_ptr(), raw_angles, raw_offsets,
+								is_dims_in_pixels, is_dims_in_mm, ps_dims_in_pixels, ps_dims_in_mm,
+								projections_in_batch, num_projections_in_bin, SDD, SAD, (batch==0) ? accumulate : true,
+								slab_offset, slab_slices );
+
+				CHECK_FOR_CUDA_ERROR();
+			}
+
+			// Copy the slab from device to host
+			//
+
+			CUDA_CALL(cudaMemcpy( image_slab, image_device.get_data_ptr(), slab_elements*sizeof(float), cudaMemcpyDeviceToHost ));
+		}
+
+		// Cleanup
+		//
+
+		cudaUnbindTexture(projections_tex);
+		cudaFreeArray(projections_array);
+
+		for( int s=0; s<num_streams; s++ ){
+			CUDA_CALL(cudaStreamSynchronize(streams[s]));
+			CUDA_CALL(cudaStreamDestroy(streams[s]));
+			CUDA_CALL(cudaEventDestroy(uploaded[s]));
+			CUDA_CALL(cudaEventDestroy(consumed[s]));
+			CUDA_CALL(cudaFree(projections_DevPtrs[s]));
+		}
+
+		CHECK_FOR_CUDA_ERROR();
+	});
+}
+
+//
+// Binned backprojection
+// - all bins are backprojected in one pass over the projections, a projection belonging to several bins
+//   is uploaded, filtered and read from the texture once for them
+// - the texture holds the projections as fp16, halving the texture memory and the cache footprint
+//
+
+__global__ static void
+float_to_half_kernel( const float * __restrict__ in, __half * __restrict__ out, unsigned int num_elements )
+{
+	const unsigned int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
+
+	if( idx < num_elements )
+		out[idx] = __float2half(in[idx]);
+}
+
+template <bool FBP> __global__ void
+conebeam_backwards_projection_binned_kernel( float * __restrict__ image, // The volumes of the bins of the pass
+		const float * __restrict__ angles,
+		const floatd2 * __restrict__ offsets,
+		const unsigned int * __restrict__ bin_masks, // Bit b is set if the projection is in bin b of the pass
+		const float * __restrict__ bin_weights, // One over the number of projections in each bin of the pass
+		intd3 is_dims_in_pixels_int,
+		floatd3 is_dims_in_mm,
+		floatd2 ps_dims_in_pixels,
+		floatd2 ps_dims_in_mm,
+		int num_projections_in_batch,
+		int num_bins_in_pass,
+		float SDD,
+		float SAD )
+{
+	const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
+	const int num_elements = prod(is_dims_in_pixels_int);
+
+	if( idx < num_elements ){
+
+		const intd3 co = idx_to_co<3>(idx, is_dims_in_pixels_int);
+		const floatd3 pos = backprojection_voxel_position(co, is_dims_in_pixels_int, is_dims_in_mm);
+
+		// The loops over the bins are unrolled to keep the results in registers
+		//
+
+		float result[MAX_BINS_PER_PASS];
+
+#pragma unroll
+		for( int b = 0; b < MAX_BINS_PER_PASS; b++ )
+			result[b] = 0.0f;
+
+		for( int projection = 0; projection < num_projections_in_batch; projection++ ) {
+
+			const float angle = degrees2radians(angles[projection]);
+
+			const floatd2 ps_pc = backprojection_plate_coordinate
+					( pos, angle, offsets[projection], ps_dims_in_pixels, ps_dims_in_mm, SDD, SAD );
+
+			const float weight = (FBP) ? backprojection_fbp_weight(pos, angle, SAD) : 1.0f;
+			const float value = weight * tex2DLayered( projections_half_tex, ps_pc[0], ps_pc[1], projection );
+			const unsigned int mask = bin_masks[projection];
+
+#pragma unroll
+			for( int b = 0; b < MAX_BINS_PER_PASS; b++ )
+				if( mask & (1u<<b) ) result[b] += value;
+		}
+
+#pragma unroll
+		for( int b = 0; b < MAX_BINS_PER_PASS; b++ )
+			if( b < num_bins_in_pass )
+				image[b*num_elements+idx] += result[b] * bin_weights[b];
+	}
+}
+
+template <bool FBP>
+void conebeam_backwards_projection_binned( hoCuNDArray<float> *projections,
+		hoCuNDArray<float> *image,
+		std::vector<float> angles,
+		std::vector<floatd2> offsets,
+		const std::vector< std::vector<unsigned int> > &bins,
+		int projections_per_batch,
+		intd3 is_dims_in_pixels,
+		floatd3 is_dims_in_mm,
+		floatd2 ps_dims_in_mm,
+		float SDD,
+		float SAD,
+		bool short_scan,
+		bool use_offset_correction,
+		bool accumulate,
+		cuNDArray<float> *cosine_weights,
+		cuNDArray<float> *frequency_filter
+)
+{
+	//
+	// Validate the input
+	//
+
+	if( projections == 0x0 || image == 0x0 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: illegal array pointer provided");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: projections array must be three-dimensional");
+	}
+
+	const int num_bins = bins.size();
+
+	if( num_bins == 0 ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: no bins provided");
+	}
+
+	if( !(image->get_number_of_dimensions() == 4 && image->get_size(3) == size_t(num_bins)) &&
+			!(image->get_number_of_dimensions() == 3 && num_bins == 1) ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: image array must be four-dimensional with one volume per bin");
+	}
+
+	if( projections->get_size(2) != angles.size() || projections->get_size(2) != offsets.size() ) {
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: inconsistent sizes of input arrays/vectors");
+	}
+
+	if( FBP && !(cosine_weights && frequency_filter) ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: for _filtered_ backprojection both cosine weights and a filter must be provided");
+	}
+
+	// Some utility variables
+	//
+
+	const int matrix_size_x = image->get_size(0);
+	const int matrix_size_y = image->get_size(1);
+	const int matrix_size_z = image->get_size(2);
+	const size_t num_volume_elements = size_t(matrix_size_x)*matrix_size_y*matrix_size_z;
+
+	const int projection_res_x = projections->get_size(0);
+	const int projection_res_y = projections->get_size(1);
+	const size_t projection_size = size_t(projection_res_x)*projection_res_y;
+
+	floatd2 ps_dims_in_pixels(projection_res_x, projection_res_y);
+
+	const int num_projections_in_all_bins = projections->get_size(2);
+
+	for( int b=0; b<num_bins; b++ )
+		for( size_t p=0; p<bins[b].size(); p++ )
+			if( bins[b][p] >= (unsigned int)num_projections_in_all_bins )
+				throw std::runtime_error("Error: conebeam_backwards_projection_binned: illegal index in bin");
+
+	if( projections_per_batch > num_projections_in_all_bins )
+		projections_per_batch = num_projections_in_all_bins;
+
+	if( projections_per_batch < 1 )
+		projections_per_batch = 1;
+
+	//
+	// As many bins per pass as fit on the device next to the projection buffers, at most MAX_BINS_PER_PASS.
+	// Every further pass uploads and filters the projections of its bins again.
+	//
+
+	const size_t volume_bytes = num_volume_elements*sizeof(float);
+	const size_t batch_bytes = projection_size*projections_per_batch*sizeof(float);
+
+	// The float batch, its fp16 copy and texture array, and for FBP the zero padded projections and their spectrum
+	const size_t batch_buffer_bytes = batch_bytes*(2+(FBP ? 4 : 0));
+
+	int device;
+	CUDA_CALL(cudaGetDevice(&device));
+	size_t free_bytes = cudaDeviceManager::Instance()->getFreeMemory(device);
+
+	// Leave a tenth in reserve for cuFFT plans and the angles/offsets
+	free_bytes -= free_bytes/10;
+
+	if( free_bytes < batch_buffer_bytes+volume_bytes ){
+		throw std::runtime_error("Error: conebeam_backwards_projection_binned: insufficient device memory, reduce the number of projections per batch");
+	}
+
+	const int bins_per_pass = int( std::min( std::min( (free_bytes-batch_buffer_bytes)/volume_bytes, size_t(MAX_BINS_PER_PASS) ), size_t(num_bins) ) );
+	const int num_passes = (num_bins+bins_per_pass-1)/bins_per_pass;
+
+	// Device buffers of a batch
+	//
+
+	std::vector<size_t> batch_dims;
+	batch_dims.push_back(projection_res_x);
+	batch_dims.push_back(projection_res_y);
+	batch_dims.push_back(projections_per_batch);
+
+	cuNDArray<float> projections_buffer(&batch_dims);
+
+	__half *half_DevPtr;
+	CUDA_CALL(cudaMalloc( (void**) &half_DevPtr, projection_size*projections_per_batch*sizeof(__half) ));
+
+	cudaChannelFormatDesc channelDesc = cudaCreateChannelDescHalf();
+	cudaExtent array_extent;
+	array_extent.width = projection_res_x;
+	array_extent.height = projection_res_y;
+	array_extent.depth = projections_per_batch;
+
+	cudaArray *projections_array;
+	cudaMalloc3DArray( &projections_array, &channelDesc, array_extent, cudaArrayLayered );
+	CHECK_FOR_CUDA_ERROR();
+
+	cudaBindTextureToArray( projections_half_tex, projections_array, channelDesc );
+	CHECK_FOR_CUDA_ERROR();
+
+	cudaFuncSetCacheConfig(conebeam_backwards_projection_binned_kernel<FBP>, cudaFuncCachePreferL1);
+
+	for( int pass=0; pass<num_passes; pass++ ){
+
+		const int first_bin = pass*bins_per_pass;
+		const int bins_in_pass = std::min(bins_per_pass, num_bins-first_bin);
+
+		// The projections of the bins of the pass in acquisition order, and the bins each belongs to
+		//
+
+		std::vector<unsigned int> masks(num_projections_in_all_bins, 0);
+		std::vector<float> bin_weights(MAX_BINS_PER_PASS, 0.0f);
+
+		for( int b=0; b<bins_in_pass; b++ ){
+			const std::vector<unsigned int> &bin = bins[first_bin+b];
+			for( size_t p=0; p<bin.size(); p++ )
+				masks[bin[p]] |= (1u<<b);
+			if( !bin.empty() )
+				bin_weights[b] = 1.0f/float(bin.size());
+		}
+
+		std::vector<unsigned int> indices;
+		std::vector<unsigned int> masks_vec;
+		std::vector<float> angles_vec;
+		std::vector<floatd2> offsets_vec;
+
+		for( int id=0; id<num_projections_in_all_bins; id++ ){
+			if( masks[id] ){
+				indices.push_back(id);
+				masks_vec.push_back(masks[id]);
+				angles_vec.push_back(angles[id]);
+				offsets_vec.push_back(offsets[id]);
+			}
+		}
+
+		const int num_projections_in_pass = indices.size();
+		const int num_batches = (num_projections_in_pass+projections_per_batch-1) / projections_per_batch;
+
+		thrust::device_vector<unsigned int> masks_devVec(masks_vec);
+		thrust::device_vector<float> angles_devVec(angles_vec);
+		thrust::device_vector<floatd2> offsets_devVec(offsets_vec);
+		thrust::device_vector<float> bin_weights_devVec(bin_weights);
+
+		// The volumes of the bins of the pass are consecutive in 'image'
+		//
+
+		float *image_pass = image->get_data_ptr()+size_t(first_bin)*num_volume_elements;
+
+		std::vector<size_t> pass_dims;
+		pass_dims.push_back(matrix_size_x);
+		pass_dims.push_back(matrix_size_y);
+		pass_dims.push_back(matrix_size_z);
+		pass_dims.push_back(bins_in_pass);
+
+		cuNDArray<float> image_device(&pass_dims);
+
+		if( accumulate )
+			CUDA_CALL(cudaMemcpy( image_device.get_data_ptr(), image_pass, image_device.get_number_of_bytes(), cudaMemcpyHostToDevice ));
+		else
+			clear(&image_device);
+
+		for( int batch=0; batch<num_batches; batch++ ){
+
+			int from_projection = batch * projections_per_batch;
+			int to_projection = std::min( (batch+1) * projections_per_batch, num_projections_in_pass );
+			int projections_in_batch = to_projection-from_projection;
+
+			float* raw_angles = thrust::raw_pointer_cast(&angles_devVec[from_projection]);
+			floatd2* raw_offsets = thrust::raw_pointer_cast(&offsets_devVec[from_projection]);
+			unsigned int* raw_masks = thrust::raw_pointer_cast(&masks_devVec[from_projection]);
+
+			copy_binned_projections( projections->get_data_ptr(), projections_buffer.get_data_ptr(), indices,
+					from_projection, to_projection, projection_size, cudaMemcpyHostToDevice, 0 );
+
+			std::vector<size_t> dims;
+			dims.push_back(projection_res_x);
+			dims.push_back(projection_res_y);
+			dims.push_back(projections_in_batch);
+
+			cuNDArray<float> projections_batch(&dims, projections_buffer.get_data_ptr());
+
+			// Filter in float, as the other backprojections do
+			//
+
+			if( FBP ){
+
+				projections_batch *= *cosine_weights;
+
+				if( short_scan ){
+					float delta = std::atan(ps_dims_in_mm[0]/(2.0f*SDD));
+					redundancy_correct( &projections_batch, raw_angles, delta );
+				}
+
+				uint64d3 pad_dims(dims[0]<<1, dims[1], dims[2]);
+				boost::shared_ptr< cuNDArray<float> > padded_projections = pad<float,3>( pad_dims, &projections_batch );
+				boost::shared_ptr< cuNDArray<complext<float> > > complex_projections = cb_fft( padded_projections.get() );
+				*complex_projections *= *frequency_filter;
+				cb_ifft( complex_projections.get(), padded_projections.get() );
+				uint64d3 crop_offsets(dims[0]>>1, 0, 0);
+				crop<float,3>( crop_offsets, padded_projections.get(), &projections_batch );
+
+				if (use_offset_correction)
+					offset_correct( &projections_batch, raw_offsets, ps_dims_in_mm, SAD, SDD );
+
+			} else if (use_offset_correction)
+				offset_correct_sqrt( &projections_batch, raw_offsets, ps_dims_in_mm, SAD, SDD );
+
+			// Convert to fp16 and copy into the texture array
+			//
+
+			const unsigned int num_batch_elements = projection_size*projections_in_batch;
+
+			dim3 dimBlock, dimGrid;
+			setup_grid( num_batch_elements, &dimBlock, &dimGrid );
+
+			float_to_half_kernel<<< dimGrid, dimBlock >>>( projections_batch.get_data_ptr(), half_DevPtr, num_batch_elements );
+			CHECK_FOR_CUDA_ERROR();
+
+			cudaExtent extent = array_extent;
+			extent.depth = projections_in_batch;
+
+			cudaMemcpy3DParms cpy_params = {0};
+			cpy_params.extent = extent;
+			cpy_params.dstArray = projections_array;
+			cpy_params.kind = cudaMemcpyDeviceToDevice;
+			cpy_params.srcPtr =
+					make_cudaPitchedPtr( (void*)half_DevPtr, projection_res_x*sizeof(__half),
+							projection_res_x, projection_res_y );
+			CUDA_CALL(cudaMemcpy3DAsync( &cpy_params, 0 ));
+
+			// Backproject into all bins of the pass
+			//
+
+			setup_grid( num_volume_elements, &dimBlock, &dimGrid );
+
+			conebeam_backwards_projection_binned_kernel<FBP><<< dimGrid, dimBlock >>>
+					( image_device.get_data_ptr(), raw_angles, raw_offsets, raw_masks,
+							thrust::raw_pointer_cast(&bin_weights_devVec[0]),
+							is_dims_in_pixels, is_dims_in_mm, ps_dims_in_pixels, ps_dims_in_mm,
+							projections_in_batch, bins_in_pass, SDD, SAD );
+
+			CHECK_FOR_CUDA_ERROR();
+		}
+
+		// Copy the volumes of the pass from device to host
+		//
+
+		CUDA_CALL(cudaMemcpy( image_pass, image_device.get_data_ptr(), image_device.get_number_of_bytes(), cudaMemcpyDeviceToHost ));
+	}
+
+	// Cleanup
+	//
+
+	cudaUnbindTexture(projections_half_tex);
+	cudaFreeArray(projections_array);
+	CUDA_CALL(cudaFree(half_DevPtr));
+	CHECK_FOR_CUDA_ERROR();
+}
+
+// Template instantiations
+//
+
+template void conebeam_backwards_projection<false>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
+		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>* );
+
+template void conebeam_backwards_projection<true>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
+		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>* );
+
+template void conebeam_backwards_projection_streamed<false>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
+		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>*,
+		std::vector<int>, int );
+
+template void conebeam_backwards_projection_streamed<true>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, std::vector<unsigned int>,
+		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>*,
+		std::vector<int>, int );
+
+template void conebeam_backwards_projection_binned<false>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, const std::vector< std::vector<unsigned int> >&,
+		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>* );
+
+template void conebeam_backwards_projection_binned<true>
+( hoCuNDArray<float>*, hoCuNDArray<float>*, std::vector<float>, std::vector<floatd2>, const std::vector< std::vector<unsigned int> >&,
 		int, intd3, floatd3, floatd2, float, float, bool, bool, bool, cuNDArray<float>*, cuNDArray<float>* );
 }
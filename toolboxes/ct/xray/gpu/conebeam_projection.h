@@ -73,4 +73,73 @@ void apply_offset_correct(hoCuNDArray<float>* projections,std::vector<floatd2>&
         cuNDArray<float> *cosine_weights = 0x0,
         cuNDArray<float> *frequency_filter = 0x0
   );
+
+  // Backprojection of all bins onto a 4D image [x y z bins] in one pass over the projections.
+  // - a projection is uploaded, filtered and read once for all bins it belongs to, 4D costs about as much as 3D
+  // - the projections are stored as fp16 in the texture (about three significant digits), interpolated in hardware
+  // - up to 16 bins are backprojected per pass, and fewer if their volumes do not fit on the device
+  //
+
+  template <bool FBP> EXPORTGPUXRAY void conebeam_backwards_projection_binned( 
+        hoCuNDArray<float> *projections,
+        hoCuNDArray<float> *image,
+        std::vector<float> angles, 
+        std::vector<floatd2> offsets, 
+        const std::vector< std::vector<unsigned int> > &bins,
+        int projections_per_batch,
+        intd3 is_dims_in_pixels, 
+        floatd3 is_dims_in_mm, 
+        floatd2 ps_dims_in_mm,
+        float SDD, 
+        float SAD,
+        bool short_scan,
+        bool use_offset_correction,
+        bool accumulate, 
+        cuNDArray<float> *cosine_weights = 0x0,
+        cuNDArray<float> *frequency_filter = 0x0
+  );
+
+  // Streamed versions of the above for data larger than the device memory.
+  // - the projection batches pass through 'num_streams' device buffers, so the transfers of some batches overlap the computations on others
+  // - the forwards projection deals the batches out to the devices, each holding the entire image
+  // - the backprojection splits the image into slabs of slices over the devices, and into more slabs if one would not fit
+  // - an empty device list means all devices of the system
+  //
+
+  EXPORTGPUXRAY void conebeam_forwards_projection_streamed
+    ( hoCuNDArray<float> *projections,
+				hoCuNDArray<float> *image,
+				std::vector<float> angles, 
+				std::vector<floatd2> offsets, 
+				std::vector<unsigned int> indices,
+				int projections_per_batch, 
+				float samples_per_pixel,
+				floatd3 is_dims_in_mm, 
+				floatd2 ps_dims_in_mm,
+				float SDD, 
+				float SAD,
+				std::vector<int> devices,
+				int num_streams
+  );
+
+  template <bool FBP> EXPORTGPUXRAY void conebeam_backwards_projection_streamed( 
+        hoCuNDArray<float> *projections,
+        hoCuNDArray<float> *image,
+        std::vector<float> angles, 
+        std::vector<floatd2> offsets, 
+        std::vector<unsigned int> indices,
+        int projections_per_batch,
+        intd3 is_dims_in_pixels, 
+        floatd3 is_dims_in_mm, 
+        floatd2 ps_dims_in_mm,
+        float SDD, 
+        float SAD,
+        bool short_scan,
+        bool use_offset_correction,
+        bool accumulate, 
+        cuNDArray<float> *cosine_weights,
+        cuNDArray<float> *frequency_filter,
+        std::vector<int> devices,
+        int num_streams
+  );
 }
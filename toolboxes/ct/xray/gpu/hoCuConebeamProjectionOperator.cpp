@@ -133,6 +133,48 @@ void hoCuConebeamProjectionOperator
 	hoCuNDArray<float> *projections2 = projections;
 	if (accumulate)
 	  projections2 = new hoCuNDArray<float>(projections->get_dimensions());
+	// All bins at once, each projection is read once for every bin it belongs to
+	//
+
+	if( use_binned_backprojection_ ){
+
+		floatd2 ps_dims_in_mm = acquisition_->get_geometry()->get_FOV();
+		intd3 is_dims_in_pixels( image->get_size(0), image->get_size(1), image->get_size(2) );
+
+		float SDD = acquisition_->get_geometry()->get_SDD();
+		float SAD = acquisition_->get_geometry()->get_SAD();
+
+		if( use_fbp_ ){
+
+			if( !cosine_weights_.get() )
+				compute_cosine_weights();
+
+			if( !frequency_filter_.get() )
+				compute_default_frequency_filter();
+
+			conebeam_backwards_projection_binned<true>
+			( projections, image,
+					acquisition_->get_geometry()->get_angles(),
+					acquisition_->get_geometry()->get_offsets(),
+					binning_->get_bins(),
+					projections_per_batch_,
+					is_dims_in_pixels, is_dims_in_mm_, ps_dims_in_mm,
+					SDD, SAD, short_scan_, use_offset_correction_, accumulate,
+					cosine_weights_.get(), frequency_filter_.get() );
+		}
+		else
+			conebeam_backwards_projection_binned<false>
+		( projections, image,
+				acquisition_->get_geometry()->get_angles(),
+				acquisition_->get_geometry()->get_offsets(),
+				binning_->get_bins(),
+				projections_per_batch_,
+				is_dims_in_pixels, is_dims_in_mm_, ps_dims_in_mm,
+				SDD, SAD, short_scan_, use_offset_correction_, accumulate );
+
+		return;
+	}
+
 	// Iterate over the temporal dimension.
 	// I.e. reconstruct one 3D volume at a time.
 	//
@@ -13,7 +13,7 @@
 
 namespace Gadgetron{
   
-  class EXPORTGPUXRAY hoCuConebeamProjectionOperator : public linearOperator< hoCuNDArray<float> >
+  class EXPORTGPUXRAY hoCuConebeamProjectionOperator : public virtual linearOperator< hoCuNDArray<float> >
   {
   public:
     hoCuConebeamProjectionOperator() : linearOperator< hoCuNDArray<float> >()
@@ -25,6 +25,7 @@ namespace Gadgetron{
       preprocessed_ = false;
       use_offset_correction_ = false;
       allow_offset_correction_override_ = true;
+      use_binned_backprojection_ = false;
     }
 
     virtual ~hoCuConebeamProjectionOperator() {}
@@ -97,6 +98,12 @@ namespace Gadgetron{
       return use_offset_correction_;
     }
 
+    // Backproject all bins in one pass over the projections, read from an fp16 texture,
+    // see conebeam_backwards_projection_binned
+    inline void set_use_binned_backprojection( bool use_binned ){
+      use_binned_backprojection_ = use_binned;
+    }
+
     inline void set_num_projections_per_batch( unsigned int projections_per_batch ){
       projections_per_batch_ = projections_per_batch;
     }
@@ -141,6 +148,7 @@ namespace Gadgetron{
     bool short_scan_;
     bool use_offset_correction_;
     bool allow_offset_correction_override_;
+    bool use_binned_backprojection_;
     boost::shared_ptr< cuNDArray<float> > cosine_weights_;
     boost::shared_ptr< cuNDArray<float> > frequency_filter_;
   };
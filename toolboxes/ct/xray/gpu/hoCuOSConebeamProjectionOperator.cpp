@@ -0,0 +1,229 @@
+#include "hoCuOSConebeamProjectionOperator.h"
+#include "conebeam_projection.h"
+#include "vector_td_operators.h"
+#include "cuNDArray_operators.h"
+
+#include <cstring>
+#include <vector>
+
+namespace Gadgetron
+{
+
+void hoCuOSConebeamProjectionOperator
+::setup( boost::shared_ptr<CBCT_acquisition> acquisition, floatd3 is_dims_in_mm )
+{
+	hoCuStreamingConebeamProjectionOperator::setup( acquisition, is_dims_in_mm );
+
+	if( !binning_.get() ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::setup: binning not provided");
+	}
+
+	const int S = this->get_number_of_subsets();
+	if( S < 1 ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::setup: at least one subset is needed");
+	}
+
+	std::vector<float> &angles = acquisition_->get_geometry()->get_angles();
+	std::vector<floatd2> &offsets = acquisition_->get_geometry()->get_offsets();
+	if( angles.size() != offsets.size() || angles.size() < size_t(S) ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::setup: fewer projections than subsets");
+	}
+
+	// Projection p is projection p/S of subset p%S
+	//
+
+	subset_angles_.assign( S, std::vector<float>() );
+	subset_offsets_.assign( S, std::vector<floatd2>() );
+	for( size_t p=0; p<angles.size(); p++ ){
+		subset_angles_[p%S].push_back(angles[p]);
+		subset_offsets_[p%S].push_back(offsets[p]);
+	}
+
+	subset_bins_.assign( S, std::vector< std::vector<unsigned int> >(binning_->get_number_of_bins()) );
+	for( unsigned int b=0; b<binning_->get_number_of_bins(); b++ ){
+		std::vector<unsigned int> bin = binning_->get_bin(b);
+		for( size_t i=0; i<bin.size(); i++ )
+			subset_bins_[bin[i]%S][b].push_back(bin[i]/S);
+	}
+
+	std::vector<size_t> dims;
+	dims.push_back(acquisition_->get_projections()->get_size(0));
+	dims.push_back(acquisition_->get_projections()->get_size(1));
+	dims.push_back(angles.size());
+	this->set_codomain_dimensions(&dims);
+}
+
+boost::shared_ptr< std::vector<size_t> > hoCuOSConebeamProjectionOperator
+::get_codomain_dimensions( int subset )
+{
+	if( subset < 0 || size_t(subset) >= subset_angles_.size() ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::get_codomain_dimensions: subset out of range or setup not performed");
+	}
+
+	boost::shared_ptr< std::vector<size_t> > dims( new std::vector<size_t>(this->codomain_dims_) );
+	dims->back() = subset_angles_[subset].size();
+	return dims;
+}
+
+std::vector<int> hoCuOSConebeamProjectionOperator
+::subset_devices( int subset )
+{
+	if( devices_.size() > 1 )
+		return std::vector<int>( 1, devices_[subset%devices_.size()] );
+
+	return devices_;
+}
+
+void hoCuOSConebeamProjectionOperator
+::order_projections( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool to_subsets )
+{
+	if( in == 0x0 || out == 0x0 || in->get_number_of_elements() != out->get_number_of_elements() ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::order_projections: illegal array pointer or size");
+	}
+
+	const size_t S = subset_angles_.size();
+	const size_t P = in->get_size(in->get_number_of_dimensions()-1);
+	const size_t projection_size = in->get_number_of_elements()/P;
+
+	size_t q = 0;
+	for( size_t s=0; s<S; s++ ){
+		for( size_t p=s; p<P; p+=S, q++ ){
+			if( to_subsets )
+				memcpy( out->get_data_ptr()+q*projection_size, in->get_data_ptr()+p*projection_size, projection_size*sizeof(float) );
+			else
+				memcpy( out->get_data_ptr()+p*projection_size, in->get_data_ptr()+q*projection_size, projection_size*sizeof(float) );
+		}
+	}
+}
+
+void hoCuOSConebeamProjectionOperator
+::mult_M( hoCuNDArray<float> *image, hoCuNDArray<float> *projections, int subset, bool accumulate )
+{
+	// Validate the input
+	//
+
+	if( image == 0x0 || projections == 0x0 ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_M: illegal array pointer provided");
+	}
+
+	if( (image->get_number_of_dimensions() != 4) &&  (image->get_number_of_dimensions() != 3) ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_M: image array must be four or three -dimensional");
+	}
+
+	if( subset < 0 || size_t(subset) >= subset_angles_.size() ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::mult_M: subset out of range or setup not performed");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 || projections->get_size(2) != subset_angles_[subset].size() ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_M: projections array does not match the subset");
+	}
+
+	hoCuNDArray<float> *projections2 = projections;
+	if (accumulate){
+	  projections2 = new hoCuNDArray<float>(projections->get_dimensions());
+	  clear(projections2);
+	}
+
+	floatd2 ps_dims_in_mm = acquisition_->get_geometry()->get_FOV();
+	float SDD = acquisition_->get_geometry()->get_SDD();
+	float SAD = acquisition_->get_geometry()->get_SAD();
+
+	std::vector<size_t> dims_3d = *image->get_dimensions();
+	if (dims_3d.size()==4)
+		dims_3d.pop_back();
+
+	size_t num_3d_elements = dims_3d[0]*dims_3d[1]*dims_3d[2];
+
+	for( int b=0; b<binning_->get_number_of_bins(); b++ ) {
+
+		if( subset_bins_[subset][b].empty() )
+			continue;
+
+		hoCuNDArray<float> image_3d(&dims_3d, image->get_data_ptr()+b*num_3d_elements);
+
+		conebeam_forwards_projection_streamed( projections2, &image_3d,
+				subset_angles_[subset], subset_offsets_[subset], subset_bins_[subset][b],
+				projections_per_batch_, samples_per_pixel_,
+				is_dims_in_mm_, ps_dims_in_mm,
+				SDD, SAD, subset_devices(subset), num_streams_ );
+	}
+
+	if (use_offset_correction_)
+	  apply_offset_correct( projections2, subset_offsets_[subset], ps_dims_in_mm, SDD, SAD );
+
+	if (accumulate){
+	  *projections += *projections2;
+	  delete projections2;
+	}
+}
+
+void hoCuOSConebeamProjectionOperator
+::mult_MH( hoCuNDArray<float> *projections, hoCuNDArray<float> *image, int subset, bool accumulate )
+{
+	// Validate the input
+	//
+
+	if( image == 0x0 || projections == 0x0 ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_MH: illegal array pointer provided");
+	}
+
+	if( (image->get_number_of_dimensions() != 4) &&  (image->get_number_of_dimensions() != 3) ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_MH: image array must be four or three -dimensional");
+	}
+
+	if( subset < 0 || size_t(subset) >= subset_angles_.size() ){
+		throw std::runtime_error( "Error: hoCuOSConebeamProjectionOperator::mult_MH: subset out of range or setup not performed");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 || projections->get_size(2) != subset_angles_[subset].size() ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_MH: projections array does not match the subset");
+	}
+
+	if( use_fbp_ ){
+		throw std::runtime_error("Error: hoCuOSConebeamProjectionOperator::mult_MH: filtered backprojection is not available on subsets");
+	}
+
+	floatd2 ps_dims_in_mm = acquisition_->get_geometry()->get_FOV();
+	intd3 is_dims_in_pixels( image->get_size(0), image->get_size(1), image->get_size(2) );
+
+	float SDD = acquisition_->get_geometry()->get_SDD();
+	float SAD = acquisition_->get_geometry()->get_SAD();
+
+	std::vector<size_t> dims_3d = *image->get_dimensions();
+	if (dims_3d.size() ==4)
+		dims_3d.pop_back();
+
+	size_t num_3d_elements = dims_3d[0]*dims_3d[1]*dims_3d[2];
+
+	for( int b=0; b<binning_->get_number_of_bins(); b++ ) {
+
+		hoCuNDArray<float> image_3d(&dims_3d, image->get_data_ptr()+b*num_3d_elements);
+
+		if( subset_bins_[subset][b].empty() ){
+			if( !accumulate )
+				clear(&image_3d);
+			continue;
+		}
+
+		conebeam_backwards_projection_streamed<false>
+		( projections, &image_3d,
+				subset_angles_[subset], subset_offsets_[subset], subset_bins_[subset][b],
+				projections_per_batch_,
+				is_dims_in_pixels, is_dims_in_mm_, ps_dims_in_mm,
+				SDD, SAD, short_scan_, use_offset_correction_, accumulate,
+				0x0, 0x0,
+				subset_devices(subset), num_streams_ );
+	}
+}
+
+std::future<void> hoCuOSConebeamProjectionOperator
+::mult_M_async( hoCuNDArray<float> *image, hoCuNDArray<float> *projections, int subset, bool accumulate )
+{
+	// The streamed projection selects its devices on its own threads, the calling thread is left alone
+	//
+
+	return std::async( std::launch::async, [this, image, projections, subset, accumulate]() {
+		this->mult_M( image, projections, subset, accumulate );
+	});
+}
+}
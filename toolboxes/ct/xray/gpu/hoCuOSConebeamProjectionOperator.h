@@ -0,0 +1,65 @@
+#pragma once
+
+#include "hoCuStreamingConebeamProjectionOperator.h"
+#include "subsetOperator.h"
+
+#include <future>
+#include <vector>
+
+namespace Gadgetron{
+
+  /**
+     Conebeam projection operator on ordered subsets of the projections, the encoding operator of osMOMSolver and osSPSSolver.
+
+     Projection p belongs to subset p modulo the number of subsets, so every subset covers the whole angular range.
+     The projections passed to the operator are in subset order, see order_projections. With more than one device
+     the subsets are dealt out to the devices, subset s runs on device s modulo the number of devices. mult_M_async
+     runs the forwards projection of a subset on a thread of its own, so the solvers can project the next subset while
+     the current one is backprojected and applied, on the next device if there is more than one.
+
+     The binning has to be provided to setup. Filtered backprojection is not available on subsets.
+   */
+  class EXPORTGPUXRAY hoCuOSConebeamProjectionOperator
+    : public virtual subsetOperator< hoCuNDArray<float> >, public hoCuStreamingConebeamProjectionOperator
+  {
+  public:
+    hoCuOSConebeamProjectionOperator( int number_of_subsets )
+      : subsetOperator< hoCuNDArray<float> >(number_of_subsets), hoCuStreamingConebeamProjectionOperator()
+    {
+    }
+
+    virtual ~hoCuOSConebeamProjectionOperator() {}
+
+    using hoCuConebeamProjectionOperator::setup;
+    virtual void setup( boost::shared_ptr<CBCT_acquisition> acquisition,
+                        floatd3 is_dims_in_mm );
+
+    virtual void mult_M( hoCuNDArray<float> *in, hoCuNDArray<float> *out, int subset, bool accumulate );
+    virtual void mult_MH( hoCuNDArray<float> *in, hoCuNDArray<float> *out, int subset, bool accumulate );
+
+    virtual void mult_M( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool accumulate = false ){
+      subsetOperator< hoCuNDArray<float> >::mult_M(in, out, accumulate);
+    }
+
+    virtual void mult_MH( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool accumulate = false ){
+      subsetOperator< hoCuNDArray<float> >::mult_MH(in, out, accumulate);
+    }
+
+    virtual std::future<void> mult_M_async( hoCuNDArray<float> *in, hoCuNDArray<float> *out, int subset, bool accumulate );
+
+    using linearOperator< hoCuNDArray<float> >::get_codomain_dimensions;
+    virtual boost::shared_ptr< std::vector<size_t> > get_codomain_dimensions( int subset );
+
+    // Copies projections in acquisition order to subset order, and back if to_subsets is false
+    void order_projections( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool to_subsets = true );
+
+  protected:
+    // The devices of a subset, a single one if there are several
+    std::vector<int> subset_devices( int subset );
+
+    // angles, offsets and bins of every subset, the bins hold the indices within the subset
+    std::vector< std::vector<float> > subset_angles_;
+    std::vector< std::vector<floatd2> > subset_offsets_;
+    std::vector< std::vector< std::vector<unsigned int> > > subset_bins_;
+  };
+}
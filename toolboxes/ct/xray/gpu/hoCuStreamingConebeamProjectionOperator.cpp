@@ -0,0 +1,165 @@
+#include "hoCuStreamingConebeamProjectionOperator.h"
+#include "conebeam_projection.h"
+#include "vector_td_operators.h"
+#include "cuNDArray_operators.h"
+
+#include <vector>
+
+namespace Gadgetron
+{
+
+void hoCuStreamingConebeamProjectionOperator
+::mult_M( hoCuNDArray<float> *image, hoCuNDArray<float> *projections, bool accumulate )
+{
+	// Validate the input
+	//
+
+	if( image == 0x0 || projections == 0x0 ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_M: illegal array pointer provided");
+	}
+
+	if( (image->get_number_of_dimensions() != 4) &&  (image->get_number_of_dimensions() != 3) ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_M: image array must be four or three -dimensional");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_M: projections array must be three-dimensional");
+	}
+
+	if( !preprocessed_ ){
+		throw std::runtime_error( "Error: hoCuStreamingConebeamProjectionOperator::mult_M: setup not performed");
+	}
+
+	if( !binning_.get() ){
+		throw std::runtime_error( "Error: hoCuStreamingConebeamProjectionOperator::mult_M: binning not provided");
+	}
+
+	if( projections->get_size(2) != acquisition_->get_geometry()->get_angles().size() ||
+			projections->get_size(2) != acquisition_->get_geometry()->get_offsets().size() ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_M: inconsistent sizes of input arrays/vectors");
+	}
+
+	hoCuNDArray<float> *projections2 = projections;
+	if (accumulate)
+	  projections2 = new hoCuNDArray<float>(projections->get_dimensions());
+
+	// Iterate over the temporal dimension.
+	// I.e. project one 3D volume at a time.
+	//
+
+	for( int b=0; b<binning_->get_number_of_bins(); b++ ) {
+
+		floatd2 ps_dims_in_mm = acquisition_->get_geometry()->get_FOV();
+
+		float SDD = acquisition_->get_geometry()->get_SDD();
+		float SAD = acquisition_->get_geometry()->get_SAD();
+
+		std::vector<size_t> dims_3d = *image->get_dimensions();
+		if (dims_3d.size()==4)
+			dims_3d.pop_back();
+
+		size_t num_3d_elements = dims_3d[0]*dims_3d[1]*dims_3d[2];
+
+		hoCuNDArray<float> image_3d(&dims_3d, image->get_data_ptr()+b*num_3d_elements);
+
+		conebeam_forwards_projection_streamed( projections2, &image_3d,
+				acquisition_->get_geometry()->get_angles(),
+				acquisition_->get_geometry()->get_offsets(),
+				binning_->get_bin(b),
+				projections_per_batch_, samples_per_pixel_,
+				is_dims_in_mm_, ps_dims_in_mm,
+				SDD, SAD, devices_, num_streams_ );
+	}
+
+	if (use_offset_correction_ && !use_fbp_)
+	  this->offset_correct(projections2);
+	if (accumulate){
+	  *projections += *projections2;
+	  delete projections2;
+	}
+}
+
+void hoCuStreamingConebeamProjectionOperator
+::mult_MH( hoCuNDArray<float> *projections, hoCuNDArray<float> *image, bool accumulate )
+{
+	// Validate the input
+	//
+
+	if( image == 0x0 || projections == 0x0 ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_MH: illegal array pointer provided");
+	}
+
+	if( (image->get_number_of_dimensions() != 4) &&  (image->get_number_of_dimensions() != 3) ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_MH: image array must be four or three -dimensional");
+	}
+
+	if( projections->get_number_of_dimensions() != 3 ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_MH: projections array must be three-dimensional");
+	}
+
+	if( !preprocessed_ ){
+		throw std::runtime_error( "Error: hoCuStreamingConebeamProjectionOperator::mult_MH: setup not performed");
+	}
+
+	if( !binning_.get() ){
+		throw std::runtime_error( "Error: hoCuStreamingConebeamProjectionOperator::mult_MH: binning not provided");
+	}
+
+	if( projections->get_size(2) != acquisition_->get_geometry()->get_angles().size() ||
+			projections->get_size(2) != acquisition_->get_geometry()->get_offsets().size() ){
+		throw std::runtime_error("Error: hoCuStreamingConebeamProjectionOperator::mult_MH: inconsistent sizes of input arrays/vectors");
+	}
+
+	// Iterate over the temporal dimension.
+	// I.e. reconstruct one 3D volume at a time.
+	//
+
+	for( int b=0; b<binning_->get_number_of_bins(); b++ ) {
+
+		floatd2 ps_dims_in_mm = acquisition_->get_geometry()->get_FOV();
+		intd3 is_dims_in_pixels( image->get_size(0), image->get_size(1), image->get_size(2) );
+
+		float SDD = acquisition_->get_geometry()->get_SDD();
+		float SAD = acquisition_->get_geometry()->get_SAD();
+
+		std::vector<size_t> dims_3d = *image->get_dimensions();
+		if (dims_3d.size() ==4)
+			dims_3d.pop_back();
+
+		size_t num_3d_elements = dims_3d[0]*dims_3d[1]*dims_3d[2];
+
+		hoCuNDArray<float> image_3d(&dims_3d, image->get_data_ptr()+b*num_3d_elements);
+
+		if( use_fbp_ ){
+
+			if( !cosine_weights_.get() )
+				compute_cosine_weights();
+
+			if( !frequency_filter_.get() )
+				compute_default_frequency_filter();
+
+			conebeam_backwards_projection_streamed<true>
+			( projections, &image_3d,
+					acquisition_->get_geometry()->get_angles(),
+					acquisition_->get_geometry()->get_offsets(),
+					binning_->get_bin(b),
+					projections_per_batch_,
+					is_dims_in_pixels, is_dims_in_mm_, ps_dims_in_mm,
+					SDD, SAD, short_scan_, use_offset_correction_, accumulate,
+					cosine_weights_.get(), frequency_filter_.get(),
+					devices_, num_streams_ );
+		}
+		else
+			conebeam_backwards_projection_streamed<false>
+			( projections, &image_3d,
+					acquisition_->get_geometry()->get_angles(),
+					acquisition_->get_geometry()->get_offsets(),
+					binning_->get_bin(b),
+					projections_per_batch_,
+					is_dims_in_pixels, is_dims_in_mm_, ps_dims_in_mm,
+					SDD, SAD, short_scan_, use_offset_correction_, accumulate,
+					0x0, 0x0,
+					devices_, num_streams_ );
+	}
+}
+}
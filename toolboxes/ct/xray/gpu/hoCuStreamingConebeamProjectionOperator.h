@@ -0,0 +1,52 @@
+#pragma once
+
+#include "hoCuConebeamProjectionOperator.h"
+
+#include <vector>
+
+namespace Gadgetron{
+
+  /**
+     Conebeam projection operator for acquisitions and images larger than the device memory.
+
+     The projection batches are pipelined through one device buffer per stream, so the host-device
+     transfers of some batches overlap the projections of others. The forwards projection deals the
+     batches out to the devices, each holding the entire image. The backprojection (and FDK) splits
+     the image into slabs of slices, one per device, and into more slabs if one would not fit.
+   */
+  class EXPORTGPUXRAY hoCuStreamingConebeamProjectionOperator : public hoCuConebeamProjectionOperator
+  {
+  public:
+    hoCuStreamingConebeamProjectionOperator() : hoCuConebeamProjectionOperator()
+    {
+      num_streams_ = 3;
+    }
+
+    virtual ~hoCuStreamingConebeamProjectionOperator() {}
+
+    virtual void mult_M( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool accumulate = false );
+    virtual void mult_MH( hoCuNDArray<float> *in, hoCuNDArray<float> *out, bool accumulate = false );
+
+    // The devices to use, all devices of the system if none are set
+    inline void set_devices( std::vector<int> devices ){
+      devices_ = devices;
+    }
+
+    inline std::vector<int> get_devices(){
+      return devices_;
+    }
+
+    // The number of projection batches in flight on each device
+    inline void set_num_streams( unsigned int num_streams ){
+      num_streams_ = num_streams;
+    }
+
+    inline unsigned int get_num_streams(){
+      return num_streams_;
+    }
+
+  protected:
+    std::vector<int> devices_;
+    unsigned int num_streams_;
+  };
+}
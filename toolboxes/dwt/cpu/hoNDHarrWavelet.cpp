@@ -1,8 +1,13 @@
 
 #include "hoNDHarrWavelet.h"
+#include "hoNDArrayScratch.h"
+#include <algorithm>
 
 namespace Gadgetron{
 
+// number of neighbouring lines processed together along E2, the tiles fit into the L1/L2 cache
+static const long long WAV_LINES_PER_TILE = 256;
+
 template<typename T> 
 hoNDHarrWavelet<T>::hoNDHarrWavelet()
 {
@@ -13,34 +18,97 @@ hoNDHarrWavelet<T>::~hoNDHarrWavelet()
 {
 }
 
+template<typename T>
+void hoNDHarrWavelet<T>::harr_d(const T* x0, const T* x1, T* l, T* h, size_t num)
+{
+    const value_type* pX0 = reinterpret_cast<const value_type*>(x0);
+    const value_type* pX1 = reinterpret_cast<const value_type*>(x1);
+    value_type* pL = reinterpret_cast<value_type*>(l);
+    value_type* pH = reinterpret_cast<value_type*>(h);
+
+    size_t V = num * sizeof(T) / sizeof(value_type);
+    for (size_t v = 0; v < V; v++)
+    {
+        value_type a = pX0[v];
+        value_type b = pX1[v];
+        pL[v] = (a + b) * (value_type)(0.5);
+        pH[v] = (a - b) * (value_type)(0.5);
+    }
+}
+
+template<typename T>
+void hoNDHarrWavelet<T>::harr_r(const T* l0, const T* l1, const T* h0, const T* h1, T* r, size_t num)
+{
+    const value_type* pL0 = reinterpret_cast<const value_type*>(l0);
+    const value_type* pL1 = reinterpret_cast<const value_type*>(l1);
+    const value_type* pH0 = reinterpret_cast<const value_type*>(h0);
+    const value_type* pH1 = reinterpret_cast<const value_type*>(h1);
+    value_type* pR = reinterpret_cast<value_type*>(r);
+
+    size_t V = num * sizeof(T) / sizeof(value_type);
+    for (size_t v = 0; v < V; v++)
+    {
+        pR[v] = ((pL0[v] + pL1[v]) + (pH0[v] - pH1[v])) * (value_type)(0.5);
+    }
+}
+
+template<typename T>
+void hoNDHarrWavelet<T>::dwt_lines(T* x, T* h, size_t len, size_t stride, size_t num_lines, T* buf)
+{
+    // the first sample is needed again by the last one
+    memcpy(buf, x, sizeof(T)*num_lines);
+
+    for (size_t k = 0; k + 1 < len; k++)
+    {
+        this->harr_d(x + k*stride, x + (k + 1)*stride, x + k*stride, h + k*stride, num_lines);
+    }
+
+    this->harr_d(x + (len - 1)*stride, buf, x + (len - 1)*stride, h + (len - 1)*stride, num_lines);
+}
+
+template<typename T>
+void hoNDHarrWavelet<T>::idwt_lines(const T* l, const T* h, T* r, size_t len, size_t stride, size_t num_lines, T* buf)
+{
+    // the last sample is needed again by the first one
+    memcpy(buf, l + (len - 1)*stride, sizeof(T)*num_lines);
+
+    for (size_t k = len - 1; k > 0; k--)
+    {
+        this->harr_r(l + k*stride, l + (k - 1)*stride, h + k*stride, h + (k - 1)*stride, r + k*stride, num_lines);
+    }
+
+    this->harr_r(l, buf, h, h + (len - 1)*stride, r, num_lines);
+}
+
+template<typename T>
+void hoNDHarrWavelet<T>::dwt_row(T* x, T* h, size_t len, T* buf)
+{
+    this->harr_d(x, x + 1, buf, h, len - 1);
+    this->harr_d(x + len - 1, x, buf + len - 1, h + len - 1, 1);
+    memcpy(x, buf, sizeof(T)*len);
+}
+
+template<typename T>
+void hoNDHarrWavelet<T>::idwt_row(const T* l, const T* h, T* r, size_t len)
+{
+    this->harr_r(l + 1, l, h + 1, h, r + 1, len - 1);
+    this->harr_r(l, l + len - 1, h, h + len - 1, r, 1);
+}
+
 template<typename T>
 void hoNDHarrWavelet<T>::dwt1D(const T* const in, T* out, size_t RO, size_t level)
 {
     memcpy(out, in, sizeof(T)*RO);
 
+    hoNDArrayScratchScope scratch;
+    T* buf_ro = hoNDArrayScratch::instance().allocate<T>(RO);
+
     for (size_t n = 0; n < level; n++)
     {
         T* l = out;
         T* h = l + n * RO + RO;
 
-        T v1 = l[0];
-        size_t ro;
-        for (ro = 0; ro < RO - 1; ro++)
-        {
-            const T& t = l[ro + 1];
-            h[ro] = l[ro] - t;
-            l[ro] += t;
-        }
-
-        // periodic boundary condition
-        h[RO - 1] = l[RO - 1] - v1;
-        l[RO - 1] += v1;
-
-        for (ro = 0; ro < RO; ro++)
-        {
-            l[ro] *= (value_type)(0.5);
-            h[ro] *= (value_type)(0.5);
-        }
+        this->dwt_row(l, h, RO, buf_ro);
     }
 }
 
@@ -49,92 +117,43 @@ void hoNDHarrWavelet<T>::idwt1D(const T* const in, T* out, size_t RO, size_t lev
 {
     memcpy(out, in, sizeof(T)*RO);
 
+    hoNDArrayScratchScope scratch;
+    T* buf_ro = hoNDArrayScratch::instance().allocate<T>(RO);
+
     long long n;
     for (n = (long long)level - 1; n >= 0; n--)
     {
         T* l = out;
         const T* const h = in + n * RO + RO;
 
-        T v1 = l[RO - 1];
-
-        size_t ro;
-        for (ro = RO - 1; ro > 0; ro--)
-        {
-            l[ro] = (l[ro] + l[ro - 1]) + (h[ro] - h[ro - 1]);
-        }
-
-        l[0] = (l[0] + v1) + (h[0] - h[RO - 1]);
-
-        for (ro = 0; ro < RO; ro++)
-        {
-            l[ro] *= (value_type)(0.5);
-        }
+        this->idwt_row(l, h, buf_ro, RO);
+        memcpy(out, buf_ro, sizeof(T)*RO);
     }
 }
 
 template<typename T>
 void hoNDHarrWavelet<T>::dwt2D(const T* const in, T* out, size_t RO, size_t E1, size_t level)
 {
-    value_type scaleFactor = 0.5;
-
     memcpy(out, in, sizeof(T)*RO*E1);
 
+    hoNDArrayScratchScope scratch;
+    T* buf_ro = hoNDArrayScratch::instance().allocate<T>(RO);
+
     for (size_t n = 0; n<level; n++)
     {
         T* LH = out + (3 * n + 1)*RO*E1;
-
-        long long ro;
-        for (ro = 0; ro<(long long)RO; ro++)
-        {
-            T v1 = out[ro];
-
-            long long ii = ro, e1;
-            for (e1 = 0; e1<(long long)E1 - 1; e1++)
-            {
-                LH[ii] = out[ii] - out[ii + RO];
-                out[ii] += out[ii + RO];
-                ii += RO;
-            }
-
-            LH[ii] = out[ii] - v1;
-            out[ii] += v1;
-        }
-
-        this->apply_harr_scal(RO*E1, scaleFactor, out);
-        this->apply_harr_scal(RO*E1, scaleFactor, LH);
-
         T* HL = LH + RO*E1;
         T* HH = HL + RO*E1;
 
-        long long e1;
-        for (e1 = 0; e1<(long long)E1; e1++)
-        {
-            T v1 = out[e1*RO];
-            T v2 = LH[e1*RO];
-
-            size_t ii = e1*RO;
-            for (long long ro = 0; ro<(long long)RO - 1; ro++)
-            {
-                HH[ii] = LH[ii] - LH[ii + 1];
-                LH[ii] += LH[ii + 1];
-
-                HL[ii] = out[ii] - out[ii + 1];
-                out[ii] += out[ii + 1];
-
-                ii++;
-            }
+        // along E1, all RO lines at once
+        this->dwt_lines(out, LH, E1, RO, RO, buf_ro);
 
-            HH[ii] = LH[ii] - v2;
-            LH[ii] += v2;
-
-            HL[ii] = out[ii] - v1;
-            out[ii] += v1;
+        // along RO
+        for (size_t e1 = 0; e1<E1; e1++)
+        {
+            this->dwt_row(out + e1*RO, HL + e1*RO, RO, buf_ro);
+            this->dwt_row(LH + e1*RO, HH + e1*RO, RO, buf_ro);
         }
-
-        this->apply_harr_scal(RO*E1, scaleFactor, out);
-        this->apply_harr_scal(RO*E1, scaleFactor, LH);
-        this->apply_harr_scal(RO*E1, scaleFactor, HL);
-        this->apply_harr_scal(RO*E1, scaleFactor, HH);
     }
 }
 
@@ -143,10 +162,10 @@ void hoNDHarrWavelet<T>::idwt2D(const T* const in, T* out, size_t RO, size_t E1,
 {
     memcpy(out, in, sizeof(T)*RO*E1);
 
-    hoNDArray<T> tmp(RO*E1);
-    T* pTmp = tmp.begin();
-
-    value_type scaleFactor = 0.5;
+    hoNDArrayScratchScope scratch;
+    hoNDArrayScratch& s = hoNDArrayScratch::instance();
+    T* pTmp = s.allocate<T>(RO*E1);
+    T* buf_ro = s.allocate<T>(RO);
 
     long long n;
     for (n = (long long)level - 1; n >= 0; n--)
@@ -155,48 +174,17 @@ void hoNDHarrWavelet<T>::idwt2D(const T* const in, T* out, size_t RO, size_t E1,
         const T* const HL = LH + RO*E1;
         const T* const HH = HL + RO*E1;
 
-        long long e1;
-        for (e1 = 0; e1<(long long)E1; e1++)
-        {
-            size_t ii = e1*RO + RO - 1;
-
-            T vLL = out[ii];
-            T vLH = LH[ii];
-            T vHL = HL[ii];
-            T vHH = HH[ii];
-
-            for (long long ro = RO - 1; ro>0; ro--)
-            {
-                out[ii] += out[ii - 1] + HL[ii] - HL[ii - 1];
-                pTmp[ii] = LH[ii] + LH[ii - 1] + HH[ii] - HH[ii - 1];
-
-                ii--;
-            }
-
-            out[ii] += vLL + HL[ii] - vHL;
-            pTmp[ii] = LH[ii] + vLH + HH[ii] - vHH;
-        }
-
-        this->apply_harr_scal(RO*E1, scaleFactor, out);
-        this->apply_harr_scal(RO*E1, scaleFactor, pTmp);
-
-        long long ro;
-        for (ro = 0; ro<(long long)RO; ro++)
+        // along RO
+        for (size_t e1 = 0; e1<E1; e1++)
         {
-            size_t ii = (E1 - 1)*RO + ro;
-            T vLL = out[ii];
-            T vLH = pTmp[ii];
+            this->idwt_row(out + e1*RO, HL + e1*RO, buf_ro, RO);
+            memcpy(out + e1*RO, buf_ro, sizeof(T)*RO);
 
-            for (long long e1 = E1 - 1; e1>0; e1--)
-            {
-                out[ii] += pTmp[ii] + out[ii - RO] - pTmp[ii - RO];
-                ii -= RO;
-            }
-
-            out[ro] += pTmp[ro] + vLL - vLH;
+            this->idwt_row(LH + e1*RO, HH + e1*RO, pTmp + e1*RO, RO);
         }
 
-        this->apply_harr_scal(RO*E1, scaleFactor, out);
+        // along E1, all RO lines at once
+        this->idwt_lines(out, pTmp, out, E1, RO, RO, buf_ro);
     }
 }
 
@@ -210,6 +198,9 @@ void hoNDHarrWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t E1,
         long long N2D = RO*E1;
         long long N3D = RO*E1*E2;
 
+        // the lines along E2 are processed in tiles of neighbouring lines
+        long long num_tiles = (N2D + WAV_LINES_PER_TILE - 1) / WAV_LINES_PER_TILE;
+
         // process order E2, E1, RO
 
         for (size_t n = 0; n<level; n++)
@@ -226,171 +217,62 @@ void hoNDHarrWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t E1,
             // ------------------------------------------
             // E2
             // ------------------------------------------
-            long long e1;
-#pragma omp parallel for default(none) private(e1) shared(RO, E1, E2, N2D, lll, hll)
-            for (e1 = 0; e1<(long long)E1; e1++)
+            long long t;
+#pragma omp parallel private(t) shared(E2, N2D, num_tiles, lll, hll)
             {
-                for (size_t ro = 0; ro<RO; ro++)
+                hoNDArrayScratchScope scratch;
+                T* buf = hoNDArrayScratch::instance().allocate<T>(WAV_LINES_PER_TILE);
+#pragma omp for
+                for (t = 0; t < num_tiles; t++)
                 {
-                    size_t ind = ro + e1*RO;
-
-                    T v1 = lll[ind];
-                    for (size_t e2 = 0; e2<E2 - 1; e2++)
-                    {
-                        size_t ind3d = ind + e2*N2D;
-
-                        const T& t = lll[ind3d + N2D];
-                        hll[ind3d] = lll[ind3d] - t;
-                        lll[ind3d] += t;
-                    }
-
-                    if (E2 > 1)
-                    {
-                        size_t ind3d = ind + (E2 - 1)*N2D;
+                    long long start = t*WAV_LINES_PER_TILE;
+                    long long num_lines = std::min((long long)WAV_LINES_PER_TILE, N2D - start);
 
-                        hll[ind3d] = lll[ind3d] - v1;
-                        lll[ind3d] += v1;
-                    }
+                    this->dwt_lines(lll + start, hll + start, E2, N2D, num_lines, buf);
                 }
             }
 
-            this->apply_harr_scal(N3D, (value_type)(0.5), lll);
-            this->apply_harr_scal(N3D, (value_type)(0.5), hll);
-
             // ------------------------------------------
             // E1
             // ------------------------------------------
 
             long long e2;
 
-#pragma omp parallel for default(none) private(e2) shared(RO, E1, E2, N2D, lll, lhl, hll, hhl)
-            for (e2 = 0; e2<(long long)E2; e2++)
+#pragma omp parallel private(e2) shared(RO, E1, E2, N2D, lll, lhl, hll, hhl)
             {
-                size_t ind3D = e2*N2D;
-                for (size_t ro = 0; ro<RO; ro++)
+                hoNDArrayScratchScope scratch;
+                T* buf = hoNDArrayScratch::instance().allocate<T>(RO);
+#pragma omp for
+                for (e2 = 0; e2 < (long long)E2; e2++)
                 {
-                    T v1 = lll[ro + ind3D];
-                    T v2 = hll[ro + ind3D];
-
-                    size_t ind;
-                    for (size_t e1 = 0; e1<E1 - 1; e1++)
-                    {
-                        ind = ro + ind3D + e1*RO;
-
-                        const T& t1 = lll[ind + RO];
-                        lhl[ind] = lll[ind] - t1;
-                        lll[ind] += t1;
-
-                        const T& t2 = hll[ind + RO];
-                        hhl[ind] = hll[ind] - t2;
-                        hll[ind] += t2;
-                    }
-
-                    ind = ro + ind3D + (E1 - 1)*RO;
-
-                    lhl[ind] = lll[ind] - v1;
-                    lll[ind] += v1;
-
-                    hhl[ind] = hll[ind] - v2;
-                    hll[ind] += v2;
+                    size_t ind3D = e2*N2D;
+                    this->dwt_lines(lll + ind3D, lhl + ind3D, E1, RO, RO, buf);
+                    this->dwt_lines(hll + ind3D, hhl + ind3D, E1, RO, RO, buf);
                 }
             }
 
-#pragma omp parallel sections
-            {
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), lll);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), lhl);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hll);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hhl);
-            }
-
             // ------------------------------------------
             // RO
             // ------------------------------------------
 
-#pragma omp parallel for default(none) private(e2) shared(RO, E1, E2, N2D, lll, hll, lhl, hhl, llh, hlh, lhh, hhh)
-            for (e2 = 0; e2<(long long)E2; e2++)
+#pragma omp parallel private(e2) shared(RO, E1, E2, N2D, lll, hll, lhl, hhl, llh, hlh, lhh, hhh)
             {
-                for (size_t e1 = 0; e1<E1; e1++)
+                hoNDArrayScratchScope scratch;
+                T* buf = hoNDArrayScratch::instance().allocate<T>(RO);
+#pragma omp for
+                for (e2 = 0; e2 < (long long)E2; e2++)
                 {
-                    size_t ind3D = e1*RO + e2*N2D;
-
-                    T v1 = lll[ind3D];
-                    T v2 = lhl[ind3D];
-                    T v3 = hll[ind3D];
-                    T v4 = hhl[ind3D];
-
-                    size_t ind;
-                    for (size_t ro = 0; ro<RO - 1; ro++)
+                    for (size_t e1 = 0; e1 < E1; e1++)
                     {
-                        ind = ind3D + ro;
-
-                        const T& t1 = lll[ind + 1];
-                        llh[ind] = lll[ind] - t1;
-                        lll[ind] += t1;
-
-                        const T& t2 = lhl[ind + 1];
-                        lhh[ind] = lhl[ind] - t2;
-                        lhl[ind] += t2;
-
-                        const T& t3 = hll[ind + 1];
-                        hlh[ind] = hll[ind] - t3;
-                        hll[ind] += t3;
+                        size_t ind3D = e1*RO + e2*N2D;
 
-                        const T& t4 = hhl[ind + 1];
-                        hhh[ind] = hhl[ind] - t4;
-                        hhl[ind] += t4;
+                        this->dwt_row(lll + ind3D, llh + ind3D, RO, buf);
+                        this->dwt_row(lhl + ind3D, lhh + ind3D, RO, buf);
+                        this->dwt_row(hll + ind3D, hlh + ind3D, RO, buf);
+                        this->dwt_row(hhl + ind3D, hhh + ind3D, RO, buf);
                     }
-
-                    ind = ind3D + RO - 1;
-
-                    llh[ind] = lll[ind] - v1;
-                    lll[ind] += v1;
-
-                    lhh[ind] = lhl[ind] - v2;
-                    lhl[ind] += v2;
-
-                    hlh[ind] = hll[ind] - v3;
-                    hll[ind] += v3;
-
-                    hhh[ind] = hhl[ind] - v4;
-                    hhl[ind] += v4;
                 }
             }
-
-#pragma omp parallel sections
-            {
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), lll);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), llh);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), lhl);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), lhh);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hll);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hlh);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hhl);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), hhh);
-            }
         }
     }
     catch (...)
@@ -409,17 +291,15 @@ void hoNDHarrWavelet<T>::idwt3D(const T* const in, T* out, size_t RO, size_t E1,
         long long N2D = RO*E1;
         long long N3D = RO*E1*E2;
 
-        hoNDArray<T> LL(N3D);
-        T* pLL = LL.begin();
+        long long num_tiles = (N2D + WAV_LINES_PER_TILE - 1) / WAV_LINES_PER_TILE;
 
-        hoNDArray<T> HL(N3D);
-        T* pHL = HL.begin();
-
-        hoNDArray<T> LH(N3D);
-        T* pLH = LH.begin();
-
-        hoNDArray<T> HH(N3D);
-        T* pHH = HH.begin();
+        // the buffers are shared by the threads of the parallel regions below
+        hoNDArrayScratchScope scratch;
+        hoNDArrayScratch& s = hoNDArrayScratch::instance();
+        T* pLL = s.allocate<T>(N3D);
+        T* pHL = s.allocate<T>(N3D);
+        T* pLH = s.allocate<T>(N3D);
+        T* pHH = s.allocate<T>(N3D);
 
         long long n;
         for (n = (long long)level - 1; n >= 0; n--)
@@ -446,98 +326,49 @@ void hoNDHarrWavelet<T>::idwt3D(const T* const in, T* out, size_t RO, size_t E1,
                 {
                     size_t ind3D = e1*RO + e2*N2D;
 
-                    size_t ind;
-                    for (size_t ro = RO - 1; ro>0; ro--)
-                    {
-                        ind = ind3D + ro;
-                        pLL[ind] = (lll[ind] + lll[ind - 1]) + (llh[ind] - llh[ind - 1]);
-                        pLH[ind] = (lhl[ind] + lhl[ind - 1]) + (lhh[ind] - lhh[ind - 1]);
-                        pHL[ind] = (hll[ind] + hll[ind - 1]) + (hlh[ind] - hlh[ind - 1]);
-                        pHH[ind] = (hhl[ind] + hhl[ind - 1]) + (hhh[ind] - hhh[ind - 1]);
-                    }
-
-                    ind = ind3D + RO - 1;
-
-                    pLL[ind3D] = (lll[ind3D] + lll[ind]) + (llh[ind3D] - llh[ind]);
-                    pLH[ind3D] = (lhl[ind3D] + lhl[ind]) + (lhh[ind3D] - lhh[ind]);
-                    pHL[ind3D] = (hll[ind3D] + hll[ind]) + (hlh[ind3D] - hlh[ind]);
-                    pHH[ind3D] = (hhl[ind3D] + hhl[ind]) + (hhh[ind3D] - hhh[ind]);
+                    this->idwt_row(lll + ind3D, llh + ind3D, pLL + ind3D, RO);
+                    this->idwt_row(lhl + ind3D, lhh + ind3D, pLH + ind3D, RO);
+                    this->idwt_row(hll + ind3D, hlh + ind3D, pHL + ind3D, RO);
+                    this->idwt_row(hhl + ind3D, hhh + ind3D, pHH + ind3D, RO);
                 }
             }
 
-#pragma omp parallel sections
-            {
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), pLL);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), pLH);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), pHL);
-
-#pragma omp section
-                this->apply_harr_scal(N3D, (value_type)(0.5), pHH);
-            }
-
             // ------------------------------------------
             // E1
             // ------------------------------------------
 
-#pragma omp parallel for default(none) private(e2) shared(RO, E1, E2, N2D, pLL, pHL, pLH, pHH) 
-            for (e2 = 0; e2<(long long)E2; e2++)
+#pragma omp parallel private(e2) shared(RO, E1, E2, N2D, pLL, pHL, pLH, pHH) 
             {
-                size_t ind3D = e2*N2D;
-                for (size_t ro = 0; ro<RO; ro++)
+                hoNDArrayScratchScope scratch;
+                T* buf = hoNDArrayScratch::instance().allocate<T>(RO);
+#pragma omp for
+                for (e2 = 0; e2 < (long long)E2; e2++)
                 {
-                    size_t ind = ro + (E1 - 1)* RO + ind3D;
-
-                    T v1 = pLL[ind];
-                    T v2 = pHL[ind];
-
-                    for (size_t e1 = E1 - 1; e1>0; e1--)
-                    {
-                        ind = ro + e1*RO + ind3D;
-                        pLL[ind] = (pLL[ind] + pLL[ind - RO]) + (pLH[ind] - pLH[ind - RO]);
-                        pHL[ind] = (pHL[ind] + pHL[ind - RO]) + (pHH[ind] - pHH[ind - RO]);
-                    }
-
-                    ind = ro + ind3D;
-
-                    pLL[ind] = (pLL[ind] + v1) + (pLH[ind] - pLH[ind + (E1 - 1)* RO]);
-                    pHL[ind] = (pHL[ind] + v2) + (pHH[ind] - pHH[ind + (E1 - 1)* RO]);
+                    size_t ind3D = e2*N2D;
+                    this->idwt_lines(pLL + ind3D, pLH + ind3D, pLL + ind3D, E1, RO, RO, buf);
+                    this->idwt_lines(pHL + ind3D, pHH + ind3D, pHL + ind3D, E1, RO, RO, buf);
                 }
             }
 
-            this->apply_harr_scal(N3D, (value_type)(0.5), pLL);
-            this->apply_harr_scal(N3D, (value_type)(0.5), pHL);
-
             // ------------------------------------------
             // E2
             // ------------------------------------------
 
-            long long e1;
+            long long t;
 
-#pragma omp parallel for default(none) private(e1) shared(RO, E1, E2, N2D, pLL,pHL, out) 
-            for (e1 = 0; e1<(long long)E1; e1++)
+#pragma omp parallel private(t) shared(E2, N2D, num_tiles, pLL, pHL, out)
             {
-                for (size_t ro = 0; ro<RO; ro++)
+                hoNDArrayScratchScope scratch;
+                T* buf = hoNDArrayScratch::instance().allocate<T>(WAV_LINES_PER_TILE);
+#pragma omp for
+                for (t = 0; t < num_tiles; t++)
                 {
-                    size_t ind2D = ro + e1*RO;
+                    long long start = t*WAV_LINES_PER_TILE;
+                    long long num_lines = std::min((long long)WAV_LINES_PER_TILE, N2D - start);
 
-                    size_t ind;
-                    for (size_t e2 = E2 - 1; e2>0; e2--)
-                    {
-                        ind = ind2D + e2*N2D;
-                        out[ind] = (pLL[ind] + pLL[ind - N2D]) + (pHL[ind] - pHL[ind - N2D]);
-                    }
-
-                    ind = ind2D + (E2 - 1)*N2D;
-                    out[ind2D] = (pLL[ind2D] + pLL[ind]) + (pHL[ind2D] - pHL[ind]);
+                    this->idwt_lines(pLL + start, pHL + start, out + start, E2, N2D, num_lines, buf);
                 }
             }
-
-            this->apply_harr_scal(N3D, (value_type)(0.5), out);
         }
     }
     catch (...)
@@ -41,43 +41,25 @@ namespace Gadgetron{
         /// in: [RO 1+7*level] array
         virtual void idwt3D(const T* const in, T* out, size_t RO, size_t E1, size_t E2, size_t level);
 
-        /// utility functions
-        template <typename T2> 
-        void apply_harr_scal(size_t N, T2 a, T2* x)
-        {
-            for (size_t n = 0; n < N; n++)
-            {
-                x[n] *= a;
-            }
-        }
-
-        template <typename T2>
-        void apply_harr_scal(size_t N, T2 a, std::complex<T2>* x)
-        {
-            for (size_t n = 0; n < N; n++)
-            {
-                const  std::complex<T2> & c = x[n];
-                const T2 re = c.real();
-                const T2 im = c.imag();
-
-                reinterpret_cast<T2(&)[2]>(x[n])[0] = re*a;
-                reinterpret_cast<T2(&)[2]>(x[n])[1] = im*a;
-            }
-        }
-
-        template <typename T2>
-        void apply_harr_scal(size_t N, T2 a, complext<T2>* x)
-        {
-            for (size_t n = 0; n < N; n++)
-            {
-                const complext<T2> & c = x[n];
-                const T2 re = c.real();
-                const T2 im = c.imag();
-
-                reinterpret_cast<T2(&)[2]>(x[n])[0] = re*a;
-                reinterpret_cast<T2(&)[2]>(x[n])[1] = im*a;
-            }
-        }
+        /// harr kernels, they work on the real and imaginary parts as one real array,
+        /// so the loops over neighbouring samples or lines are vectorized
+        /// periodic boundary condition is used
+
+        /// l = (x0+x1)/2, h = (x0-x1)/2 for num values; l may be x0
+        void harr_d(const T* x0, const T* x1, T* l, T* h, size_t num);
+        /// r = ((l0+l1) + (h0-h1))/2 for num values; r may be l0
+        void harr_r(const T* l0, const T* l1, const T* h0, const T* h1, T* r, size_t num);
+
+        /// decomposition along a dimension with the given stride, for num_lines neighbouring lines at once
+        /// x[k*stride + line] is sample k of a line; x is replaced by the low pass, buf holds num_lines values
+        void dwt_lines(T* x, T* h, size_t len, size_t stride, size_t num_lines, T* buf);
+        /// reconstruction along a dimension with the given stride; r may be l, buf holds num_lines values
+        void idwt_lines(const T* l, const T* h, T* r, size_t len, size_t stride, size_t num_lines, T* buf);
+
+        /// decomposition along the contiguous dimension, x is replaced by the low pass, buf holds len values
+        void dwt_row(T* x, T* h, size_t len, T* buf);
+        /// reconstruction along the contiguous dimension, r must not be l or h
+        void idwt_row(const T* l, const T* h, T* r, size_t len);
     };
 }
 
@@ -1,9 +1,14 @@
 
 #include "hoNDRedundantWavelet.h"
+#include "hoNDArrayScratch.h"
 #include <sstream>
+#include <algorithm>
 
 namespace Gadgetron{
 
+// number of neighbouring lines filtered together along E2, the tiles fit into the L1/L2 cache
+static const long long WAV_LINES_PER_TILE = 256;
+
 template<typename T> 
 hoNDRedundantWavelet<T>::hoNDRedundantWavelet()
 {
@@ -51,6 +56,8 @@ void hoNDRedundantWavelet<T>::compute_wavelet_filter(const std::vector<T>& s)
         {
             fh_r_[n] = -fh_r_[n];
         }
+
+        this->prepare_filter();
     }
     catch (...)
     {
@@ -133,74 +140,202 @@ void hoNDRedundantWavelet<T>::set_wavelet_filter(const std::vector<T>& fl_d, con
     fh_d_ = fh_d;
     fl_r_ = fl_r;
     fh_r_ = fh_r;
+
+    this->prepare_filter();
 }
 
 template<typename T>
-void hoNDRedundantWavelet<T>::filter_d(const T* const in, size_t len_in, size_t stride_in, T* out_l, T* out_h, size_t stride_out)
+void hoNDRedundantWavelet<T>::prepare_filter()
 {
     size_t len = fl_d_.size();
 
-    size_t n, m;
-    for (n = 0; n < len_in-len+1; n++)
+    fl_d_real_.resize(len);
+    fh_d_real_.resize(len);
+    fl_r_real_.resize(len);
+    fh_r_real_.resize(len);
+
+    for (size_t n = 0; n < len; n++)
     {
-        T vl = 0;
-        T vh = 0;
+        GADGET_CHECK_THROW(imag(fl_d_[n]) == 0 && imag(fh_d_[n]) == 0 && imag(fl_r_[n]) == 0 && imag(fh_r_[n]) == 0);
+
+        fl_d_real_[n] = real(fl_d_[n]);
+        fh_d_real_[n] = real(fh_d_[n]);
+        fl_r_real_[n] = real(fl_r_[n]);
+        fh_r_real_[n] = real(fh_r_[n]);
+    }
+}
+
+template<typename T>
+void hoNDRedundantWavelet<T>::filter_d_lines(const T* const in, size_t len_in, size_t stride, size_t num_lines, T* out_l, T* out_h)
+{
+    size_t len = fl_d_real_.size();
+    size_t V = num_lines * sizeof(T) / sizeof(value_type);
+
+    size_t n, m, v;
+    for (n = 0; n < len_in; n++)
+    {
+        value_type* pL = reinterpret_cast<value_type*>(out_l + n*stride);
+        value_type* pH = reinterpret_cast<value_type*>(out_h + n*stride);
+
+        for (v = 0; v < V; v++)
+        {
+            pL[v] = 0;
+            pH[v] = 0;
+        }
+
         for (m = 0; m < len; m++)
         {
-            vl += in[(n + m)*stride_in] * fl_d_[len - m - 1];
-            vh += in[(n + m)*stride_in] * fh_d_[len - m - 1];
+            size_t k = (n + m) % len_in;
+
+            const value_type* pIn = reinterpret_cast<const value_type*>(in + k*stride);
+            value_type a = fl_d_real_[len - m - 1];
+            value_type b = fh_d_real_[len - m - 1];
+
+            for (v = 0; v < V; v++)
+            {
+                pL[v] += a * pIn[v];
+                pH[v] += b * pIn[v];
+            }
         }
+    }
+}
+
+template<typename T>
+void hoNDRedundantWavelet<T>::filter_d_row(const T* const in, size_t len_in, T* out_l, T* out_h)
+{
+    size_t len = fl_d_real_.size();
+    size_t C = sizeof(T) / sizeof(value_type);
+
+    const value_type* pIn = reinterpret_cast<const value_type*>(in);
+    value_type* pL = reinterpret_cast<value_type*>(out_l);
+    value_type* pH = reinterpret_cast<value_type*>(out_h);
 
-        out_l[n*stride_out] = vl;
-        out_h[n*stride_out] = vh;
+    // samples whose window does not wrap around, accumulated one filter tap at a time
+    size_t num_inner = (len_in >= len) ? len_in - len + 1 : 0;
+    size_t V = num_inner * C;
+
+    size_t n, m, v, c;
+    for (v = 0; v < V; v++)
+    {
+        pL[v] = 0;
+        pH[v] = 0;
     }
 
-    for (n = len_in - len + 1; n < len_in; n++)
+    for (m = 0; m < len; m++)
     {
-        T vl = 0;
-        T vh = 0;
-        for (m = 0; m < len; m++)
+        const value_type* pInM = pIn + m*C;
+        value_type a = fl_d_real_[len - m - 1];
+        value_type b = fh_d_real_[len - m - 1];
+
+        for (v = 0; v < V; v++)
         {
-            size_t k = n + m;
-            if (k >= len_in) k -= len_in;
-            vl += in[k*stride_in] * fl_d_[len - m - 1];
-            vh += in[k*stride_in] * fh_d_[len - m - 1];
+            pL[v] += a * pInM[v];
+            pH[v] += b * pInM[v];
         }
+    }
 
-        out_l[n*stride_out] = vl;
-        out_h[n*stride_out] = vh;
+    // periodic boundary
+    for (n = num_inner; n < len_in; n++)
+    {
+        for (c = 0; c < C; c++)
+        {
+            value_type vl = 0;
+            value_type vh = 0;
+            for (m = 0; m < len; m++)
+            {
+                value_type x = pIn[((n + m) % len_in)*C + c];
+                vl += x * fl_d_real_[len - m - 1];
+                vh += x * fh_d_real_[len - m - 1];
+            }
+
+            pL[n*C + c] = vl;
+            pH[n*C + c] = vh;
+        }
     }
 }
 
 template<typename T>
-void hoNDRedundantWavelet<T>::filter_r(const T* const in_l, const T* const in_h, size_t len_in, size_t stride_in, T* out, size_t stride_out)
+void hoNDRedundantWavelet<T>::filter_r_lines(const T* const in_l, const T* const in_h, size_t len_in, size_t stride, size_t num_lines, T* out)
 {
-    long long len = fl_r_.size();
+    long long len = fl_r_real_.size();
+    size_t V = num_lines * sizeof(T) / sizeof(value_type);
 
     long long n, m;
-    for (n = len-1; n < (long long)len_in; n++)
+    size_t v;
+    for (n = 0; n < (long long)len_in; n++)
     {
-        T v = 0;
+        value_type* pOut = reinterpret_cast<value_type*>(out + n*stride);
+
+        for (v = 0; v < V; v++)
+        {
+            pOut[v] = 0;
+        }
+
         for (m = 0; m < len; m++)
         {
-            size_t k = (n + m + 1 - len)*stride_in;
-            v += (in_l[k] * fl_r_[len - m - 1]) + (in_h[k] * fh_r_[len - m - 1]);
+            long long k = (n + m + 1 - len) % (long long)len_in;
+            if (k < 0) k += len_in;
+
+            const value_type* pL = reinterpret_cast<const value_type*>(in_l + k*stride);
+            const value_type* pH = reinterpret_cast<const value_type*>(in_h + k*stride);
+            value_type a = fl_r_real_[len - m - 1];
+            value_type b = fh_r_real_[len - m - 1];
+
+            for (v = 0; v < V; v++)
+            {
+                pOut[v] += a * pL[v] + b * pH[v];
+            }
         }
+    }
+}
+
+template<typename T>
+void hoNDRedundantWavelet<T>::filter_r_row(const T* const in_l, const T* const in_h, size_t len_in, T* out)
+{
+    long long len = fl_r_real_.size();
+    long long C = sizeof(T) / sizeof(value_type);
+    long long N = len_in;
 
-        out[n*stride_out] = v;
+    const value_type* pL = reinterpret_cast<const value_type*>(in_l);
+    const value_type* pH = reinterpret_cast<const value_type*>(in_h);
+    value_type* pOut = reinterpret_cast<value_type*>(out);
+
+    // samples [len-1, len_in) do not wrap around, accumulated one filter tap at a time
+    long long num_head = std::min(len - 1, N);
+
+    long long n, m, v, c;
+    for (v = num_head*C; v < N*C; v++)
+    {
+        pOut[v] = 0;
     }
 
-    for (n = 0; n < len -1; n++)
+    for (m = 0; m < len; m++)
     {
-        T v = 0;
-        for (m = 0; m < len; m++)
+        long long offset = (m + 1 - len)*C;
+        value_type a = fl_r_real_[len - m - 1];
+        value_type b = fh_r_real_[len - m - 1];
+
+        for (v = num_head*C; v < N*C; v++)
         {
-            long long k = (n + m + 1 - len);
-            if (k < 0) k += len_in;
-            v += (in_l[k*stride_in] * fl_r_[len - m - 1]) + (in_h[k*stride_in] * fh_r_[len - m - 1]);
+            pOut[v] += a * pL[v + offset] + b * pH[v + offset];
         }
+    }
 
-        out[n*stride_out] = v;
+    // periodic boundary
+    for (n = 0; n < num_head; n++)
+    {
+        for (c = 0; c < C; c++)
+        {
+            value_type r = 0;
+            for (m = 0; m < len; m++)
+            {
+                long long k = (n + m + 1 - len) % N;
+                if (k < 0) k += N;
+                r += pL[k*C + c] * fl_r_real_[len - m - 1] + pH[k*C + c] * fh_r_real_[len - m - 1];
+            }
+
+            pOut[n*C + c] = r;
+        }
     }
 }
 
@@ -209,16 +344,17 @@ void hoNDRedundantWavelet<T>::dwt1D(const T* const in, T* out, size_t RO, size_t
 {
     memcpy(out, in, sizeof(T)*RO);
 
-    std::vector<T> buf_ro(RO);
+    hoNDArrayScratchScope scratch;
+    T* buf_ro = hoNDArrayScratch::instance().allocate<T>(RO);
 
     for (size_t n = 0; n < level; n++)
     {
         T* l = out;
         T* h = l + n * RO + RO;
 
-        this->filter_d(l, RO, 1, &buf_ro[0], h, 1);
+        this->filter_d_row(l, RO, buf_ro, h);
 
-        memcpy(out, &buf_ro[0], sizeof(T)*RO);
+        memcpy(out, buf_ro, sizeof(T)*RO);
     }
 }
 
@@ -227,7 +363,8 @@ void hoNDRedundantWavelet<T>::idwt1D(const T* const in, T* out, size_t RO, size_
 {
     memcpy(out, in, sizeof(T)*RO);
 
-    std::vector<T> buf_ro(RO);
+    hoNDArrayScratchScope scratch;
+    T* buf_ro = hoNDArrayScratch::instance().allocate<T>(RO);
 
     long long n;
     for (n = (long long)level - 1; n >= 0; n--)
@@ -235,8 +372,8 @@ void hoNDRedundantWavelet<T>::idwt1D(const T* const in, T* out, size_t RO, size_
         T* l = out;
         const T* const h = in + n * RO + RO;
 
-        this->filter_r(l, h, RO, 1, &buf_ro[0], 1);
-        memcpy(out, &buf_ro[0], sizeof(T)*RO);
+        this->filter_r_row(l, h, RO, buf_ro);
+        memcpy(out, buf_ro, sizeof(T)*RO);
     }
 }
 
@@ -245,36 +382,31 @@ void hoNDRedundantWavelet<T>::dwt2D(const T* const in, T* out, size_t RO, size_t
 {
     memcpy(out, in, sizeof(T)*RO*E1);
 
-    std::vector<T> buf_l(E1), buf_h(E1), buf_ro(RO);
+    hoNDArrayScratchScope scratch;
+    hoNDArrayScratch& s = hoNDArrayScratch::instance();
+    T* buf = s.allocate<T>(RO*E1);
+    T* buf_ro = s.allocate<T>(RO);
 
     for (size_t n = 0; n<level; n++)
     {
         T* LH = out + (3 * n + 1)*RO*E1;
 
-        size_t ro, e1;
-        // along E1
-        for (ro = 0; ro < RO; ro++)
-        {
-            this->filter_d(out + ro, E1, RO, &buf_l[0], &buf_h[0], 1);
-
-            for (e1 = 0; e1<E1; e1++)
-            {
-                out[ro + e1*RO] = buf_l[e1];
-                LH[ro + e1*RO] = buf_h[e1];
-            }
-        }
+        // along E1, all RO lines at once
+        this->filter_d_lines(out, E1, RO, RO, buf, LH);
+        memcpy(out, buf, sizeof(T)*RO*E1);
 
         T* HL = LH + RO*E1;
         T* HH = HL + RO*E1;
 
         // along RO
+        size_t e1;
         for (e1 = 0; e1<E1; e1++)
         {
-            this->filter_d(out + e1*RO, RO, 1, &buf_ro[0], HL + e1*RO, 1);
-            memcpy(out + e1*RO, &buf_ro[0], sizeof(T)*RO);
+            this->filter_d_row(out + e1*RO, RO, buf_ro, HL + e1*RO);
+            memcpy(out + e1*RO, buf_ro, sizeof(T)*RO);
 
-            this->filter_d(LH + e1*RO, RO, 1, &buf_ro[0], HH + e1*RO, 1);
-            memcpy(LH + e1*RO, &buf_ro[0], sizeof(T)*RO);
+            this->filter_d_row(LH + e1*RO, RO, buf_ro, HH + e1*RO);
+            memcpy(LH + e1*RO, buf_ro, sizeof(T)*RO);
         }
     }
 }
@@ -284,10 +416,11 @@ void hoNDRedundantWavelet<T>::idwt2D(const T* const in, T* out, size_t RO, size_
 {
     memcpy(out, in, sizeof(T)*RO*E1);
 
-    std::vector<T> buf_ro(RO), buf_e1(E1);
-
-    hoNDArray<T> tmp(RO*E1);
-    T* pTmp = tmp.begin();
+    hoNDArrayScratchScope scratch;
+    hoNDArrayScratch& s = hoNDArrayScratch::instance();
+    T* buf = s.allocate<T>(RO*E1);
+    T* buf_ro = s.allocate<T>(RO);
+    T* pTmp = s.allocate<T>(RO*E1);
 
     long long n;
     for (n = (long long)level - 1; n >= 0; n--)
@@ -296,26 +429,19 @@ void hoNDRedundantWavelet<T>::idwt2D(const T* const in, T* out, size_t RO, size_
         const T* const HL = LH + RO*E1;
         const T* const HH = HL + RO*E1;
 
-        size_t ro, e1;
         // along RO
+        size_t e1;
         for (e1 = 0; e1<E1; e1++)
         {
-            this->filter_r(out + e1*RO, HL + e1*RO, RO, 1, &buf_ro[0], 1);
-            memcpy(out + e1*RO, &buf_ro[0], sizeof(T)*RO);
+            this->filter_r_row(out + e1*RO, HL + e1*RO, RO, buf_ro);
+            memcpy(out + e1*RO, buf_ro, sizeof(T)*RO);
 
-            this->filter_r(LH + e1*RO, HH + e1*RO, RO, 1, pTmp + e1*RO, 1);
+            this->filter_r_row(LH + e1*RO, HH + e1*RO, RO, pTmp + e1*RO);
         }
 
-        // along e1
-        for (ro = 0; ro<RO; ro++)
-        {
-            this->filter_r(out + ro, pTmp + ro, E1, RO, &buf_e1[0], 1);
-
-            for (e1 = 0; e1<E1; e1++)
-            {
-                out[ro + e1*RO] = buf_e1[e1];
-            }
-        }
+        // along E1, all RO lines at once
+        this->filter_r_lines(out, pTmp, E1, RO, RO, buf);
+        memcpy(out, buf, sizeof(T)*RO*E1);
     }
 }
 
@@ -329,6 +455,13 @@ void hoNDRedundantWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t
         long long N2D = RO*E1;
         long long N3D = RO*E1*E2;
 
+        // the lines along E2 are filtered in tiles of neighbouring lines
+        long long num_tiles = (N2D + WAV_LINES_PER_TILE - 1) / WAV_LINES_PER_TILE;
+
+        // the buffer is shared by the threads of the parallel regions below, every thread works on its own part
+        hoNDArrayScratchScope scratch;
+        T* buf = hoNDArrayScratch::instance().allocate<T>(N3D);
+
         // process order E2, E1, RO
 
         for (size_t n = 0; n<level; n++)
@@ -345,32 +478,18 @@ void hoNDRedundantWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t
             // ------------------------------------------
             // E2
             // ------------------------------------------
-            long long e1;
-#pragma omp parallel private(e1) shared(RO, E1, E2, N2D, lll, hll)
+            long long t;
+#pragma omp parallel for private(t) shared(E2, N2D, num_tiles, lll, hll, buf)
+            for (t = 0; t < num_tiles; t++)
             {
-                std::vector<T> buf_e2(E2), buf_l(E2), buf_h(E2);
-#pragma omp for
-                for (e1 = 0; e1 < (long long)E1; e1++)
+                long long start = t*WAV_LINES_PER_TILE;
+                long long num_lines = std::min((long long)WAV_LINES_PER_TILE, N2D - start);
+
+                this->filter_d_lines(lll + start, E2, N2D, num_lines, buf + start, hll + start);
+
+                for (size_t e2 = 0; e2 < E2; e2++)
                 {
-                    for (size_t ro = 0; ro < RO; ro++)
-                    {
-                        size_t ind = ro + e1*RO;
-
-                        for (size_t e2 = 0; e2 < E2; e2++)
-                        {
-                            size_t ind3d = ind + e2*N2D;
-                            buf_e2[e2] = lll[ind3d];
-                        }
-
-                        this->filter_d(&buf_e2[0], E2, 1, &buf_l[0], &buf_h[0], 1);
-
-                        for (size_t e2 = 0; e2 < E2; e2++)
-                        {
-                            size_t ind3d = ind + e2*N2D;
-                            lll[ind3d] = buf_l[e2];
-                            hll[ind3d] = buf_h[e2];
-                        }
-                    }
+                    memcpy(lll + start + e2*N2D, buf + start + e2*N2D, sizeof(T)*num_lines);
                 }
             }
 
@@ -380,38 +499,16 @@ void hoNDRedundantWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t
 
             long long e2;
 
-#pragma omp parallel private(e2) shared(RO, E1, E2, N2D, lll, lhl, hll, hhl)
+#pragma omp parallel for private(e2) shared(RO, E1, E2, N2D, lll, lhl, hll, hhl, buf)
+            for (e2 = 0; e2 < (long long)E2; e2++)
             {
-                std::vector<T> buf_e1(E1), buf_l(E1), buf_h(E1);
-                std::vector<T> buf_e1_2(E1), buf_l_2(E1), buf_h_2(E1);
-#pragma omp for
-                for (e2 = 0; e2 < (long long)E2; e2++)
-                {
-                    size_t ind3D = e2*N2D;
-                    for (size_t ro = 0; ro < RO; ro++)
-                    {
-                        size_t ind;
-                        for (size_t e1 = 0; e1 < E1; e1++)
-                        {
-                            ind = ro + ind3D + e1*RO;
-                            buf_e1[e1] = lll[ind];
-                            buf_e1_2[e1] = hll[ind];
-                        }
-
-                        this->filter_d(&buf_e1[0], E1, 1, &buf_l[0], &buf_h[0], 1);
-                        this->filter_d(&buf_e1_2[0], E1, 1, &buf_l_2[0], &buf_h_2[0], 1);
-
-                        for (size_t e1 = 0; e1 < E1; e1++)
-                        {
-                            ind = ro + ind3D + e1*RO;
-                            lll[ind] = buf_l[e1];
-                            lhl[ind] = buf_h[e1];
-
-                            hll[ind] = buf_l_2[e1];
-                            hhl[ind] = buf_h_2[e1];
-                        }
-                    }
-                }
+                size_t ind3D = e2*N2D;
+
+                this->filter_d_lines(lll + ind3D, E1, RO, RO, buf + ind3D, lhl + ind3D);
+                memcpy(lll + ind3D, buf + ind3D, sizeof(T)*N2D);
+
+                this->filter_d_lines(hll + ind3D, E1, RO, RO, buf + ind3D, hhl + ind3D);
+                memcpy(hll + ind3D, buf + ind3D, sizeof(T)*N2D);
             }
 
             // ------------------------------------------
@@ -420,7 +517,8 @@ void hoNDRedundantWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t
 
 #pragma omp parallel private(e2) shared(RO, E1, E2, N2D, lll, hll, lhl, hhl, llh, hlh, lhh, hhh)
             {
-                std::vector<T> buf_l(RO);
+                hoNDArrayScratchScope scratch_thread;
+                T* buf_l = hoNDArrayScratch::instance().allocate<T>(RO);
 #pragma omp for
                 for (e2 = 0; e2 < (long long)E2; e2++)
                 {
@@ -428,17 +526,17 @@ void hoNDRedundantWavelet<T>::dwt3D(const T* const in, T* out, size_t RO, size_t
                     {
                         size_t ind3D = e1*RO + e2*N2D;
 
-                        this->filter_d(lll + ind3D, RO, 1, &buf_l[0], llh + ind3D, 1);
-                        memcpy(lll + ind3D, &buf_l[0], sizeof(T)*RO);
+                        this->filter_d_row(lll + ind3D, RO, buf_l, llh + ind3D);
+                        memcpy(lll + ind3D, buf_l, sizeof(T)*RO);
 
-                        this->filter_d(lhl + ind3D, RO, 1, &buf_l[0], lhh + ind3D, 1);
-                        memcpy(lhl + ind3D, &buf_l[0], sizeof(T)*RO);
+                        this->filter_d_row(lhl + ind3D, RO, buf_l, lhh + ind3D);
+                        memcpy(lhl + ind3D, buf_l, sizeof(T)*RO);
 
-                        this->filter_d(hll + ind3D, RO, 1, &buf_l[0], hlh + ind3D, 1);
-                        memcpy(hll + ind3D, &buf_l[0], sizeof(T)*RO);
+                        this->filter_d_row(hll + ind3D, RO, buf_l, hlh + ind3D);
+                        memcpy(hll + ind3D, buf_l, sizeof(T)*RO);
 
-                        this->filter_d(hhl + ind3D, RO, 1, &buf_l[0], hhh + ind3D, 1);
-                        memcpy(hhl + ind3D, &buf_l[0], sizeof(T)*RO);
+                        this->filter_d_row(hhl + ind3D, RO, buf_l, hhh + ind3D);
+                        memcpy(hhl + ind3D, buf_l, sizeof(T)*RO);
                     }
                 }
             }
@@ -460,17 +558,16 @@ void hoNDRedundantWavelet<T>::idwt3D(const T* const in, T* out, size_t RO, size_
         long long N2D = RO*E1;
         long long N3D = RO*E1*E2;
 
-        hoNDArray<T> LL(N3D);
-        T* pLL = LL.begin();
+        long long num_tiles = (N2D + WAV_LINES_PER_TILE - 1) / WAV_LINES_PER_TILE;
 
-        hoNDArray<T> HL(N3D);
-        T* pHL = HL.begin();
-
-        hoNDArray<T> LH(N3D);
-        T* pLH = LH.begin();
-
-        hoNDArray<T> HH(N3D);
-        T* pHH = HH.begin();
+        // the buffers are shared by the threads of the parallel regions below
+        hoNDArrayScratchScope scratch;
+        hoNDArrayScratch& s = hoNDArrayScratch::instance();
+        T* pLL = s.allocate<T>(N3D);
+        T* pHL = s.allocate<T>(N3D);
+        T* pLH = s.allocate<T>(N3D);
+        T* pHH = s.allocate<T>(N3D);
+        T* buf = s.allocate<T>(N3D);
 
         long long n;
         for (n = (long long)level - 1; n >= 0; n--)
@@ -496,10 +593,10 @@ void hoNDRedundantWavelet<T>::idwt3D(const T* const in, T* out, size_t RO, size_
                 {
                     size_t ind3D = e1*RO + e2*N2D;
 
-                    this->filter_r(lll + ind3D, llh + ind3D, RO, 1, pLL + ind3D, 1);
-                    this->filter_r(lhl + ind3D, lhh + ind3D, RO, 1, pLH + ind3D, 1);
-                    this->filter_r(hll + ind3D, hlh + ind3D, RO, 1, pHL + ind3D, 1);
-                    this->filter_r(hhl + ind3D, hhh + ind3D, RO, 1, pHH + ind3D, 1);
+                    this->filter_r_row(lll + ind3D, llh + ind3D, RO, pLL + ind3D);
+                    this->filter_r_row(lhl + ind3D, lhh + ind3D, RO, pLH + ind3D);
+                    this->filter_r_row(hll + ind3D, hlh + ind3D, RO, pHL + ind3D);
+                    this->filter_r_row(hhl + ind3D, hhh + ind3D, RO, pHH + ind3D);
                 }
             }
 
@@ -507,44 +604,30 @@ void hoNDRedundantWavelet<T>::idwt3D(const T* const in, T* out, size_t RO, size_
             // E1
             // ------------------------------------------
 
-#pragma omp parallel private(e2) shared(RO, E1, E2, N2D, pLL, pHL, pLH, pHH)
+#pragma omp parallel for private(e2) shared(RO, E1, E2, N2D, pLL, pHL, pLH, pHH, buf)
+            for (e2 = 0; e2 < (long long)E2; e2++)
             {
-                std::vector<T> buf_l(E1), buf_l_2(E1);
-#pragma omp for
-                for (e2 = 0; e2 < (long long)E2; e2++)
-                {
-                    size_t ind3D = e2*N2D;
-                    for (size_t ro = 0; ro < RO; ro++)
-                    {
-                        size_t ind = ro + ind3D;
+                size_t ind3D = e2*N2D;
 
-                        this->filter_r(pLL + ind, pLH + ind, E1, RO, &buf_l[0], 1);
-                        this->filter_r(pHL + ind, pHH + ind, E1, RO, &buf_l_2[0], 1);
+                this->filter_r_lines(pLL + ind3D, pLH + ind3D, E1, RO, RO, buf + ind3D);
+                memcpy(pLL + ind3D, buf + ind3D, sizeof(T)*N2D);
 
-                        for (size_t e1 = 0; e1 < E1; e1++)
-                        {
-                            ind = ro + e1*RO + ind3D;
-                            pLL[ind] = buf_l[e1];
-                            pHL[ind] = buf_l_2[e1];
-                        }
-                    }
-                }
+                this->filter_r_lines(pHL + ind3D, pHH + ind3D, E1, RO, RO, buf + ind3D);
+                memcpy(pHL + ind3D, buf + ind3D, sizeof(T)*N2D);
             }
 
             // ------------------------------------------
             // E2
             // ------------------------------------------
 
-            long long e1;
-
-#pragma omp parallel for private(e1) shared(RO, E1, E2, N2D, pLL,pHL, out) 
-            for (e1 = 0; e1<(long long)E1; e1++)
+            long long t;
+#pragma omp parallel for private(t) shared(E2, N2D, num_tiles, pLL, pHL, out)
+            for (t = 0; t < num_tiles; t++)
             {
-                for (size_t ro = 0; ro<RO; ro++)
-                {
-                    size_t ind2D = ro + e1*RO;
-                    this->filter_r(pLL + ind2D, pHL + ind2D, E2, N2D, out+ind2D, N2D);
-                }
+                long long start = t*WAV_LINES_PER_TILE;
+                long long num_lines = std::min((long long)WAV_LINES_PER_TILE, N2D - start);
+
+                this->filter_r_lines(pLL + start, pHL + start, E2, N2D, num_lines, out + start);
             }
         }
     }
@@ -22,7 +22,8 @@ namespace Gadgetron{
         virtual ~hoNDRedundantWavelet();
 
         /// these compute_wavelet_filter should be called first before calling transform
-        /// transform is NOT thread-safe, since some class member variables are used as buffer for computation
+        /// the filters are only read by transform, which takes its buffers from the thread local scratch arena;
+        /// once the filters are set, transform can be called from several threads at once
 
         /// utility function to compute wavelet filter from commonly used wavelet scale functions
         /// wav_name : "db2", "db3", "db4", "db5"
@@ -62,10 +63,30 @@ namespace Gadgetron{
         /// in: [RO 1+7*level] array
         virtual void idwt3D(const T* const in, T* out, size_t RO, size_t E1, size_t E2, size_t level);
 
-        /// perform decomposition filter
-        void filter_d(const T* const in, size_t len_in, size_t stride_in, T* out_l, T* out_h, size_t stride_out);
-        /// perform reconstruction filter
-        void filter_r(const T* const in_l, const T* const in_h, size_t len_in, size_t stride_in, T* out, size_t stride_out);
+        /// filter coefficients as real numbers, used by the filter kernels
+        std::vector<value_type> fl_d_real_;
+        std::vector<value_type> fh_d_real_;
+        std::vector<value_type> fl_r_real_;
+        std::vector<value_type> fh_r_real_;
+
+        /// fill the real filter coefficients, all wavelet filters are real
+        void prepare_filter();
+
+        /// the filter kernels work on the real and imaginary parts as one real array and multiply them with the
+        /// real filter coefficients; the inner loops run over neighbouring samples or lines, so they are vectorized
+        /// periodic boundary condition is used
+
+        /// decomposition filter along a dimension with the given stride, for num_lines neighbouring lines at once
+        /// in[k*stride + line] is sample k of a line; out_l and out_h have the layout of in and must not be in
+        void filter_d_lines(const T* const in, size_t len_in, size_t stride, size_t num_lines, T* out_l, T* out_h);
+        /// decomposition filter along the contiguous dimension, out_l and out_h must not be in
+        void filter_d_row(const T* const in, size_t len_in, T* out_l, T* out_h);
+
+        /// reconstruction filter along a dimension with the given stride, for num_lines neighbouring lines at once
+        /// out must not be in_l or in_h
+        void filter_r_lines(const T* const in_l, const T* const in_h, size_t len_in, size_t stride, size_t num_lines, T* out);
+        /// reconstruction filter along the contiguous dimension, out must not be in_l or in_h
+        void filter_r_row(const T* const in_l, const T* const in_h, size_t len_in, T* out);
     };
 }
 
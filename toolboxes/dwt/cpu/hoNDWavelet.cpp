@@ -1,5 +1,6 @@
 
 #include "hoNDWavelet.h"
+#include "GadgetronNodeProfile.h"
 
 namespace Gadgetron{
 
@@ -94,62 +95,97 @@ void hoNDWavelet<T>::transform(const hoNDArray<T>& in, hoNDArray<T>& out, size_t
 
         out.create(&dimOut);
 
+        size_t num = in.get_number_of_elements() / N;
+
+        this->transform(in.begin(), out.begin(), in.get_size(0), in.get_size(1), in.get_size(2), num, NDim, level, forward);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoNDWavelet<T>::transform(...) ... ");
+    }
+}
+
+template<typename T>
+void hoNDWavelet<T>::transform(const T* in, T* out, size_t RO, size_t E1, size_t E2, size_t num, size_t NDim, size_t level, bool forward)
+{
+    try
+    {
+        GADGET_CHECK_THROW(NDim >= 1 && NDim <= 3);
+
+        size_t N = RO;
+        size_t W = 1 + level;
+        if (NDim == 2)
+        {
+            N = RO*E1;
+            W = 1 + 3 * level;
+        }
+        else if (NDim == 3)
+        {
+            N = RO*E1*E2;
+            W = 1 + 7 * level;
+        }
+
+        size_t NIn = (forward) ? N : N*W;
+        size_t NOut = (forward) ? N*W : N;
+
         if (level == 0)
         {
-            memcpy(out.begin(), in.begin(), in.get_number_of_bytes());
+            memcpy(out, in, sizeof(T)*N*num);
             return;
         }
 
-        long long num = in.get_number_of_elements() / N;
+        // the 1D and 2D kernels run on one thread, the 3D kernels are parallelized internally
+        // and are run one after another, unless there are enough arrays to keep all threads busy
+        bool parallelOverNum = (NDim == 1) ? (num > 16) : (num > 1);
+#ifdef USE_OMP
+        if (NDim == 3)
+        {
+            parallelOverNum = (num >= (size_t)omp_get_max_threads());
+        }
+#endif // USE_OMP
+
+        // the node profile may limit the threads of the loop over the arrays, within the budget of the caller
+        int numThreads = GadgetronNodeProfile::instance().get_int("wavelet.threads", 0);
+#ifdef USE_OMP
+        if (numThreads <= 0 || numThreads > omp_get_max_threads()) numThreads = omp_get_max_threads();
+#else
+        numThreads = 1;
+#endif // USE_OMP
 
         long long n;
 
-        if (NDim == 1)
+#pragma omp parallel for default(none) private(n) shared(in, out, RO, E1, E2, num, NDim, level, forward, NIn, NOut) schedule(dynamic) if(parallelOverNum) num_threads(numThreads)
+        for (n = 0; n < (long long)num; n++)
         {
-#pragma omp parallel for default(none) private(n) shared(num, in, out, N, NOut, level, forward) if(num>16)
-            for (n = 0; n < num; n++)
-            {
-                const T* pIn = in.begin() + n*N;
-                T* pOut = out.begin() + n*NOut;
+            const T* pIn = in + n*NIn;
+            T* pOut = out + n*NOut;
 
+            if (NDim == 1)
+            {
                 if (forward)
-                    this->dwt1D(pIn, pOut, in.get_size(0), level);
+                    this->dwt1D(pIn, pOut, RO, level);
                 else
-                    this->idwt1D(pIn, pOut, in.get_size(0), level);
+                    this->idwt1D(pIn, pOut, RO, level);
             }
-        }
-        else if (NDim == 2)
-        {
-#pragma omp parallel for default(none) private(n) shared(num, in, out, N, NOut, level, forward) if(num>8)
-            for (n = 0; n < num; n++)
+            else if (NDim == 2)
             {
-                const T* pIn = in.begin() + n*N;
-                T* pOut = out.begin() + n*NOut;
-
                 if (forward)
-                    this->dwt2D(pIn, pOut, in.get_size(0), in.get_size(1), level);
+                    this->dwt2D(pIn, pOut, RO, E1, level);
                 else
-                    this->idwt2D(pIn, pOut, in.get_size(0), in.get_size(1), level);
+                    this->idwt2D(pIn, pOut, RO, E1, level);
             }
-        }
-        else  if (NDim == 3)
-        {
-#pragma omp parallel for default(none) private(n) shared(num, in, out, N, NOut, level, forward) if(num>8)
-            for (n = 0; n < num; n++)
+            else
             {
-                const T* pIn = in.begin() + n*N;
-                T* pOut = out.begin() + n*NOut;
-
                 if (forward)
-                    this->dwt3D(pIn, pOut, in.get_size(0), in.get_size(1), in.get_size(2), level);
+                    this->dwt3D(pIn, pOut, RO, E1, E2, level);
                 else
-                    this->idwt3D(pIn, pOut, in.get_size(0), in.get_size(1), in.get_size(2), level);
+                    this->idwt3D(pIn, pOut, RO, E1, E2, level);
             }
         }
     }
     catch (...)
     {
-        GADGET_THROW("Errors in hoNDWavelet<T>::transform(...) ... ");
+        GADGET_THROW("Errors in hoNDWavelet<T>::transform(batch) ... ");
     }
 }
 
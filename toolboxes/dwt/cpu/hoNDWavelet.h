@@ -37,6 +37,16 @@ namespace Gadgetron{
         /// if forward==false, the role of in and out is switched and inverse wavelet transform is performed
         virtual void transform(const hoNDArray<T>& in, hoNDArray<T>& out, size_t NDim, size_t level, bool forward);
 
+        /// batched transform on caller provided buffers
+        /// in, out: num arrays stored one after another, e.g. the coils or frames of a multi-coil series
+        /// for the forward transform, every input array is [RO E1 E2] and every output array is [RO E1 E2 W]
+        /// W = 1+level, 1+3*level or 1+7*level for NDim==1, 2 or 3; unused sizes (E1 for NDim==1, E2 for NDim<3) are ignored
+        /// for the inverse transform (forward==false) the roles of in and out are switched
+        /// the arrays are distributed over the threads; all temporary memory is taken from the thread local
+        /// scratch arena (hoNDArrayScratch), so once the filters are set, both transform functions can be
+        /// called from several threads at once on the same wavelet object
+        virtual void transform(const T* in, T* out, size_t RO, size_t E1, size_t E2, size_t num, size_t NDim, size_t level, bool forward);
+
     protected:
 
         /// implementation for 1D dwt and idwt
@@ -63,6 +63,118 @@ void AddEdge(Traits::vertex_descriptor &v1, Traits::vertex_descriptor &v2, prope
 }
 
 namespace Gadgetron {
+
+  namespace {
+
+    // Residuals of the signal of every pixel [S N P] after projection onto the signal model, for the
+    // field map candidates fmLo(p) to fmHi(p) and minimized over the R2* candidates. Candidates that
+    // are not evaluated get a residual larger than that of any evaluated one.
+    // residual is [num_fm P], r2starIndex [P num_fm], fmIndex [P]
+    void fatwater_residuals(const hoNDArray< std::complex<float> >& signals,
+                            const hoNDArray< std::complex<float> >& Ps,
+                            const hoNDArray<uint16_t>& fmLo,
+                            const hoNDArray<uint16_t>& fmHi,
+                            hoNDArray<float>& residual,
+                            hoNDArray<uint16_t>& r2starIndex,
+                            hoNDArray<uint16_t>& fmIndex)
+    {
+        const size_t S = signals.get_size(0);
+        const size_t N = signals.get_size(1);
+        const long long P = signals.get_size(2);
+        const size_t nte = Ps.get_size(0);
+        const size_t num_fm = Ps.get_size(2);
+        const size_t num_r2star = Ps.get_size(3);
+
+        residual.create(num_fm, P);
+        r2starIndex.create(P, num_fm);
+        fmIndex.create(P);
+        r2starIndex.fill(0);
+
+#ifdef USE_OMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+        for (long long p = 0; p < P; p++) {
+
+            const std::complex<float>* sig = signals.begin() + p*S*N;
+
+            float norm2 = 0;
+            for (size_t k = 0; k < S*N; k++) norm2 += std::norm(sig[k]);
+            const float notEvaluated = 1.0 + std::sqrt(norm2);
+
+            float* res = residual.begin() + p*num_fm;
+            for (size_t k3 = 0; k3 < num_fm; k3++) res[k3] = notEvaluated;
+
+            const size_t lo = fmLo.begin()[p];
+            const size_t hi = fmHi.begin()[p];
+
+            float minResidual2 = notEvaluated;
+            fmIndex[p] = lo;
+
+            for (size_t k3 = lo; k3 <= hi; k3++) {
+
+                float minResidual = notEvaluated;
+
+                for (size_t k4 = 0; k4 < num_r2star; k4++) {
+
+                    // Apply projector
+                    const std::complex<float>* proj = Ps.begin() + (k3 + k4*num_fm)*nte*nte;
+
+                    float curResidual = 0;
+                    for (size_t n = 0; n < N; n++) {
+                        for (size_t i = 0; i < nte; i++) {
+                            std::complex<float> r = 0;
+                            for (size_t j = 0; j < nte; j++) r += proj[i + j*nte] * sig[j + n*S];
+                            curResidual += std::norm(r);
+                        }
+                    }
+                    curResidual = std::sqrt(curResidual);
+
+                    if (curResidual < minResidual) {
+                        minResidual = curResidual;
+                        r2starIndex[p + k3*P] = k4;
+                    }
+                }
+                res[k3] = minResidual;
+
+                if (minResidual < minResidual2) {
+                    minResidual2 = minResidual;
+                    fmIndex[p] = k3;
+                }
+            }
+        }
+    }
+
+    // Signal [S N X*Y] averaged over blocks of f x f pixels
+    hoNDArray< std::complex<float> > downsample_signals(const hoNDArray< std::complex<float> >& signals, size_t X, size_t Y, size_t f)
+    {
+        const size_t SN = signals.get_size(0)*signals.get_size(1);
+        const size_t Xf = (X + f - 1) / f;
+        const size_t Yf = (Y + f - 1) / f;
+
+        hoNDArray< std::complex<float> > out(signals.get_size(0), signals.get_size(1), Xf*Yf);
+        out.fill(0);
+
+        for (size_t y = 0; y < Y; y++) {
+            for (size_t x = 0; x < X; x++) {
+                const std::complex<float>* in = signals.begin() + (x + y*X)*SN;
+                std::complex<float>* o = out.begin() + (x/f + (y/f)*Xf)*SN;
+                for (size_t k = 0; k < SN; k++) o[k] += in[k];
+            }
+        }
+
+        // Blocks on the far edges may be partial
+        for (size_t yf = 0; yf < Yf; yf++) {
+            for (size_t xf = 0; xf < Xf; xf++) {
+                float count = float(std::min(f, X - xf*f) * std::min(f, Y - yf*f));
+                std::complex<float>* o = out.begin() + (xf + yf*Xf)*SN;
+                for (size_t k = 0; k < SN; k++) o[k] /= count;
+            }
+        }
+
+        return out;
+    }
+  }
+
     hoNDArray< std::complex<float> > fatwater_separation(hoNDArray< std::complex<float> >& data, FatWaterParameters p, FatWaterAlgorithm a)
     {
 
@@ -277,64 +389,58 @@ namespace Gadgetron {
 	}
 
 
-	// Need to check that S = nte
+	if (S != nte) {
+	  throw std::runtime_error("fatwater_separation: the number of echoes (S) does not match the number of echo times");
+	}
+
 	// N should be the number of contrasts (eg: for PSIR)
-	hoMatrix< std::complex<float> > tempResVector(S,N);
-	hoMatrix< std::complex<float> > tempSignal(S,N);
-	hoNDArray<float> residual(num_fm,X,Y);
-	hoNDArray<uint16_t> r2starIndex(X,Y,num_fm);
-	hoNDArray<uint16_t> fmIndex(X,Y);
-	float curResidual, minResidual, minResidual2;
+	hoNDArray< std::complex<float> > signals(S,N,X*Y);
 	for( int k1=0;k1<X;k1++) {
 	  for( int k2=0;k2<Y;k2++) {
-	    // Get current signal
 	    for( int k4=0;k4<N;k4++) {
 	      for( int k5=0;k5<S;k5++) {
-		tempSignal(k5,k4) = data(k1,k2,0,0,k4,k5,0);
-		if (k1==107 && k2==144) {
-		  tempSignal(k5,k4) = std::complex<float>(1000.0,0.0);;
-		  GDEBUG(" (%d,%d) -->  %f + i %f \n",k5,k4, tempSignal(k5,k4).real(),tempSignal(k5,k4).imag());
-		}
-
+		signals(k5,k4,k1+k2*X) = data(k1,k2,0,0,k4,k5,0);
 	      }
 	    }
+	  }
+	}
 
-	    minResidual2 = 1.0 + nrm2(&tempSignal);
-
-	    for(int k3=0;k3<num_fm;k3++) {
-
-	      minResidual = 1.0 + nrm2(&tempSignal);
-
-	      for(int k4=0;k4<num_r2star;k4++) {
-		// Get current projector matrix
-		for( int k5=0;k5<nte;k5++) {
-		  for( int k6=0;k6<nte;k6++) {
-		    P(k5,k6) = Ps(k5,k6,k3,k4);
-		  }
-		}
-
-		// Apply projector
-		gemm( tempResVector, P, false, tempSignal, false );
-
-		curResidual = nrm2(&tempResVector);
-
-		if (curResidual < minResidual) {
-		  minResidual = curResidual;
-		  r2starIndex(k1,k2,k3) = k4;
-		}
-	      }
-	      residual(k3,k1,k2) = minResidual;
-
-	      if (minResidual < minResidual2) {
-		minResidual2 = minResidual;
-		fmIndex(k1,k2) = k3;
-	      }
-
-	      if (k1==107 && k2==144) {
-		GDEBUG(" %f -->  %f \n",fms[k3],minResidual);
+	// Field map search, coarse to fine if multiple resolutions are requested:
+	// every level searches the candidates around the field map of the level below it,
+	// the coarsest searches all of them
+	hoNDArray<float> residual;         // [num_fm X*Y]
+	hoNDArray<uint16_t> r2starIndex;   // [X*Y num_fm]
+	hoNDArray<uint16_t> fmIndex;       // [X*Y]
+
+	uint16_t levels = a.multiResolutionLevels_;
+	while (levels > 0 && (size_t(1) << levels) > std::max(X,Y)) levels--;
+
+	size_t Xprev = 0;
+	for (int level = levels; level >= 0; level--) {
+	  const size_t f = size_t(1) << level;
+	  const size_t Xl = (X + f - 1) / f;
+	  const size_t Yl = (Y + f - 1) / f;
+
+	  hoNDArray<uint16_t> fmLo(Xl*Yl), fmHi(Xl*Yl);
+	  for (size_t y = 0; y < Yl; y++) {
+	    for (size_t x = 0; x < Xl; x++) {
+	      if (level == levels) {
+		fmLo[x + y*Xl] = 0;
+		fmHi[x + y*Xl] = num_fm - 1;
+	      } else {
+		int coarse = fmIndex[x/2 + (y/2)*Xprev];
+		fmLo[x + y*Xl] = std::max(0, coarse - int(a.multiResolutionSearchWindow_));
+		fmHi[x + y*Xl] = std::min(int(num_fm) - 1, coarse + int(a.multiResolutionSearchWindow_));
 	      }
 	    }
 	  }
+
+	  if (level > 0) {
+	    fatwater_residuals(downsample_signals(signals, X, Y, f), Ps, fmLo, fmHi, residual, r2starIndex, fmIndex);
+	  } else {
+	    fatwater_residuals(signals, Ps, fmLo, fmHi, residual, r2starIndex, fmIndex);
+	  }
+	  Xprev = Xl;
 	}
 
 
@@ -404,31 +510,39 @@ namespace Gadgetron {
 
 
 	//Do final calculations once the field map is done
-	hoMatrix< std::complex<float> > curWaterFat(2,N);
-	hoMatrix< std::complex<float> > AhA(2,2);
 	// Do fat-water separation with current field map and R2* estimates
-	for( int k1=0;k1<X;k1++) {
-	  for( int k2=0;k2<Y;k2++) {
+#ifdef USE_OMP
+#pragma omp parallel
+#endif
+	{
+	  hoMatrix< std::complex<float> > curWaterFat(2,N);
+	  hoMatrix< std::complex<float> > AhA(2,2);
+	  hoMatrix< std::complex<float> > pixelSignal(S,N);
+	  hoMatrix< std::complex<float> > pixelPsi(nte,nspecies);
+
+#ifdef USE_OMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+	  for (long long p = 0; p < (long long)X*Y; p++) {
+	    const size_t k1 = p % X;
+	    const size_t k2 = p / X;
 
 	    // Get current signal
-	    for( int k4=0;k4<N;k4++) {
-	      for( int k5=0;k5<S;k5++) {
-		tempSignal(k5,k4) = data(k1,k2,0,0,k4,k5,0);
-	      }
-	    }
+	    memcpy(pixelSignal.begin(), signals.begin() + p*S*N, sizeof(std::complex<float>)*S*N);
+
 	    // Get current Psi matrix
-	    fm = fms[fmIndex(k1,k2)];
-	    r2star = r2stars[r2starIndex(k1,k2,fmIndex(k1,k2))];
+	    const float pfm = fms[fmIndex[p]];
+	    const float pr2star = r2stars[r2starIndex[p + fmIndex[p]*X*Y]];
 	    for( int k3=0;k3<nte;k3++) {
-	      curModulation = exp(-r2star*echoTimes[k3])*std::complex<float>(cos(2*PI*echoTimes[k3]*fm),sin(2*PI*echoTimes[k3]*fm));
+	      std::complex<float> modulation = exp(-pr2star*echoTimes[k3])*std::complex<float>(cos(2*PI*echoTimes[k3]*pfm),sin(2*PI*echoTimes[k3]*pfm));
 	      for( int k4=0;k4<nspecies;k4++) {
-		psiMatrix(k3,k4) = phiMatrix(k3,k4)*curModulation;
+		pixelPsi(k3,k4) = phiMatrix(k3,k4)*modulation;
 	      }
 	    }
 
 	    // Solve for water and fat
-	    gemm( curWaterFat, psiMatrix, true, tempSignal, false );
-	    herk( AhA, psiMatrix, 'L', true );
+	    gemm( curWaterFat, pixelPsi, true, pixelSignal, false );
+	    herk( AhA, pixelPsi, 'L', true );
 	    //	    AhA.copyLowerTriToUpper();
 	    for (int ka=0;ka<AhA.get_size(0);ka++ ) {
 	      for (int kb=ka+1;kb<AhA.get_size(1);kb++ ) {
@@ -442,7 +556,6 @@ namespace Gadgetron {
 		out(k1,k2,0,0,k4,k5,0) = curWaterFat(k5,k4);
 	      }
 	    }
-
 	  }
 	}
 
@@ -38,7 +38,20 @@ namespace Gadgetron
     
     struct FatWaterAlgorithm
     {
+        FatWaterAlgorithm()
+        : multiResolutionLevels_(0)
+        , multiResolutionSearchWindow_(5)
+        {}
+
         std::vector<ChemicalSpecies> species_;
+
+        /**
+           Coarse to fine field map search: levels below the full resolution, each halving it.
+           The coarsest level searches all field map candidates, the finer ones only those
+           within multiResolutionSearchWindow_ of the field map of the level below.
+         */
+        uint16_t multiResolutionLevels_;
+        uint16_t multiResolutionSearchWindow_;
     };
 
     /**
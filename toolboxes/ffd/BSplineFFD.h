@@ -9,6 +9,29 @@
 
 namespace Gadgetron { 
 
+/// sum of the 4^A control points from c on, weighted with the tensor product of the BSpline weights w[a][0..3] of every dimension a
+/// the recursion is resolved at compile time, so the sum is fully unrolled
+template <typename T, typename W, unsigned int A>
+struct BSplineFFDContraction
+{
+    static inline T apply(const T* c, const size_t* stride, const W (*w)[4])
+    {
+        return BSplineFFDContraction<T, W, A-1>::apply(c,                 stride, w) * w[A-1][0]
+             + BSplineFFDContraction<T, W, A-1>::apply(c +   stride[A-1], stride, w) * w[A-1][1]
+             + BSplineFFDContraction<T, W, A-1>::apply(c + 2*stride[A-1], stride, w) * w[A-1][2]
+             + BSplineFFDContraction<T, W, A-1>::apply(c + 3*stride[A-1], stride, w) * w[A-1][3];
+    }
+};
+
+template <typename T, typename W>
+struct BSplineFFDContraction<T, W, 1>
+{
+    static inline T apply(const T* c, const size_t* stride, const W (*w)[4])
+    {
+        return c[0]*w[0][0] + c[1]*w[0][1] + c[2]*w[0][2] + c[3]*w[0][3];
+    }
+};
+
 template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut>
 class BSplineFFD : public FFDBase<T, CoordType, DIn, DOut>
 {
@@ -132,6 +155,23 @@ public:
     /// print info
     virtual void print(std::ostream& os) const;
 
+    /// evaluate the FFD at N points, pts is [DIn N] in FFD grid, r is [DOut N]
+    /// the points are evaluated without virtual calls, with the sum over the 4^DIn control points unrolled
+    virtual bool evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const;
+
+    /// evaluate the FFD on the tensor product grid of the FFD grid locations pg[d] along every dimension
+    /// target[d] is created with the size [pg[0].size() pg[1].size() ...]
+    /// the BSpline weights are computed once per grid line and applied with one contraction per dimension,
+    /// so the cost per point is close to 4*DIn operations instead of 4^DIn
+    virtual bool evaluateFFDOnGrid(const std::vector<CoordType> pg[D], ArrayType target[DOut]) const;
+
+    /// if the FFD grid and the target are not rotated, the grid locations of every dimension only depend on
+    /// the index along this dimension and the evaluation is done with evaluateFFDOnGrid
+    using BaseClass::evaluateFFDOnImage;
+    using BaseClass::evaluateFFDOnArray;
+    virtual bool evaluateFFDOnImage(ImageType target[DOut]) const;
+    virtual bool evaluateFFDOnArray(ArrayType target[DOut]) const;
+
     /// compute four BSpline basis functions
     static bspline_float_type BSpline0(bspline_float_type t)
     {
@@ -807,6 +847,326 @@ inline bool BSplineFFD<T, CoordType, DIn, DOut>::initializeBFFD(const ImageType&
     return this->initializeBFFD(im, start, end, gridCtrlPtNum);
 }
 
+template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
+bool BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const
+{
+    try
+    {
+        size_t N = pts.get_size(1);
+        GADGET_CHECK_RETURN_FALSE(pts.get_size(0)==DIn);
+
+        if ( r.get_size(1)!=N || r.get_size(0)!=DOut )
+        {
+            r.create(DOut, N);
+        }
+
+        size_t dimCtrl[DIn], stride[DIn];
+
+        unsigned int d;
+        for ( d=0; d<DIn; d++ )
+        {
+            dimCtrl[d] = this->ctrl_pt_[0].get_size(d);
+            stride[d] = (d==0) ? 1 : stride[d-1]*dimCtrl[d-1];
+        }
+
+        const T* pCtrl[DOut];
+        for ( d=0; d<DOut; d++ )
+        {
+            pCtrl[d] = this->ctrl_pt_[d].begin();
+        }
+
+        const CoordType* pPts = pts.begin();
+        T* pR = r.begin();
+
+        long long n;
+#pragma omp parallel for private(n) shared(N, pPts, pR, pCtrl, dimCtrl, stride)
+        for ( n=0; n<(long long)N; n++ )
+        {
+            const CoordType* pt = pPts + n*DIn;
+            T* v = pR + n*DOut;
+
+            // first of the four control points and their weights along every dimension
+            bspline_float_type w[DIn][4];
+            size_t offset = 0;
+            bool inside = true;
+
+            unsigned int dd;
+            for ( dd=0; dd<DIn; dd++ )
+            {
+                long long ix = (long long)std::floor(pt[dd]);
+                CoordType delta = pt[dd]-(CoordType)ix;
+                long long lx = FFD_MKINT(BSPLINELUTSIZE*delta);
+                if ( lx >= BSPLINELUTSIZE ) lx = BSPLINELUTSIZE-1;
+
+                long long first = ix - 1 + BSPLINEPADDINGSIZE;
+                if ( first<0 || first+3>=(long long)dimCtrl[dd] )
+                {
+                    inside = false;
+                    break;
+                }
+
+                offset += first*stride[dd];
+
+                w[dd][0] = this->LUT_[lx][0];
+                w[dd][1] = this->LUT_[lx][1];
+                w[dd][2] = this->LUT_[lx][2];
+                w[dd][3] = this->LUT_[lx][3];
+            }
+
+            for ( dd=0; dd<DOut; dd++ )
+            {
+                v[dd] = inside ? BSplineFFDContraction<T, bspline_float_type, DIn>::apply(pCtrl[dd]+offset, stride, w) : T(0);
+            }
+        }
+    }
+    catch(...)
+    {
+        GERROR_STREAM("Error happened in BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const ... ");
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
+bool BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnGrid(const std::vector<CoordType> pg[D], ArrayType target[DOut]) const
+{
+    try
+    {
+        size_t dimOut[DIn], dimCtrl[DIn];
+
+        // per grid line, the first of the four control points and their weights
+        std::vector<size_t> first[DIn];
+        std::vector<bspline_float_type> w[DIn];
+
+        unsigned int d;
+        for ( d=0; d<DIn; d++ )
+        {
+            dimOut[d] = pg[d].size();
+            dimCtrl[d] = this->ctrl_pt_[0].get_size(d);
+
+            GADGET_CHECK_RETURN_FALSE(dimOut[d]>0);
+
+            first[d].resize(dimOut[d]);
+            w[d].resize(4*dimOut[d]);
+
+            for ( size_t i=0; i<dimOut[d]; i++ )
+            {
+                long long ix = (long long)std::floor(pg[d][i]);
+                CoordType delta = pg[d][i]-(CoordType)ix;
+                long long lx = FFD_MKINT(BSPLINELUTSIZE*delta);
+                if ( lx >= BSPLINELUTSIZE ) lx = BSPLINELUTSIZE-1;
+
+                long long f = ix - 1 + BSPLINEPADDINGSIZE;
+                GADGET_CHECK_RETURN_FALSE( f>=0 && f+3<(long long)dimCtrl[d] );
+
+                first[d][i] = (size_t)f;
+                for ( size_t k=0; k<4; k++ )
+                {
+                    w[d][4*i+k] = this->LUT_[lx][k];
+                }
+            }
+        }
+
+        std::vector<size_t> dim_target(dimOut, dimOut+DIn);
+
+        std::vector<T> buf[2];
+        size_t currBuf = 0;
+
+        unsigned int dOut;
+        for ( dOut=0; dOut<DOut; dOut++ )
+        {
+            target[dOut].create(dim_target);
+
+            // contract the control points along the last dimension first, [c0 ... cD-1] -> [c0 ... sD-1] -> ... -> [s0 ... sD-1]
+            size_t dimCurr[DIn];
+            for ( d=0; d<DIn; d++ ) dimCurr[d] = dimCtrl[d];
+
+            const T* src = this->ctrl_pt_[dOut].begin();
+
+            for ( long long a=DIn-1; a>=0; a-- )
+            {
+                size_t inner = 1, outer = 1;
+                for ( d=0; d<a; d++ ) inner *= dimCurr[d];
+                for ( d=a+1; d<DIn; d++ ) outer *= dimCurr[d];
+
+                size_t nIn = dimCurr[a];
+                size_t nOut = dimOut[a];
+
+                T* dst;
+                if ( a == 0 )
+                {
+                    dst = target[dOut].begin();
+                }
+                else
+                {
+                    buf[currBuf].resize(inner*nOut*outer);
+                    dst = &buf[currBuf][0];
+                    currBuf = 1 - currBuf;
+                }
+
+                const size_t* pFirst = &first[a][0];
+                const bspline_float_type* pW = &w[a][0];
+
+                long long n;
+#pragma omp parallel for private(n) shared(inner, outer, nIn, nOut, src, dst, pFirst, pW)
+                for ( n=0; n<(long long)(outer*nOut); n++ )
+                {
+                    size_t o = n / nOut;
+                    size_t i = n - o*nOut;
+
+                    const T* s = src + (o*nIn + pFirst[i])*inner;
+                    T* t = dst + (o*nOut + i)*inner;
+
+                    bspline_float_type w0 = pW[4*i];
+                    bspline_float_type w1 = pW[4*i+1];
+                    bspline_float_type w2 = pW[4*i+2];
+                    bspline_float_type w3 = pW[4*i+3];
+
+                    for ( size_t k=0; k<inner; k++ )
+                    {
+                        t[k] = s[k]*w0 + s[k+inner]*w1 + s[k+2*inner]*w2 + s[k+3*inner]*w3;
+                    }
+                }
+
+                dimCurr[a] = nOut;
+                src = dst;
+            }
+        }
+    }
+    catch(...)
+    {
+        GERROR_STREAM("Error happened in BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnGrid(const std::vector<CoordType> pg[D], ArrayType target[DOut]) const ... ");
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
+bool BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnImage(ImageType target[DOut]) const
+{
+    try
+    {
+        bool separable = true;
+
+        unsigned int d, e;
+        for ( d=0; d<DIn; d++ )
+        {
+            for ( e=0; e<DIn; e++ )
+            {
+                if ( e==d ) continue;
+                if ( std::abs(this->ctrl_pt_[0].get_axis(d, e))>FLT_EPSILON || std::abs(target[0].get_axis(d, e))>FLT_EPSILON ) separable = false;
+            }
+        }
+
+        if ( !separable )
+        {
+            return BaseClass::evaluateFFDOnImage(target);
+        }
+
+        // grid location along every dimension, from the pixels on the lines through the first pixel
+        std::vector<CoordType> pg[D];
+
+        size_t ind[DIn];
+        typename ImageType::coord_type pt_w[DIn];
+        CoordType pt_wc[DIn], pt_g[DIn];
+
+        for ( d=0; d<DIn; d++ )
+        {
+            size_t N = target[0].get_size(d);
+            pg[d].resize(N);
+
+            for ( e=0; e<DIn; e++ ) ind[e] = 0;
+
+            for ( size_t i=0; i<N; i++ )
+            {
+                ind[d] = i;
+                target[0].image_to_world(ind, pt_w);
+                for ( e=0; e<DIn; e++ ) pt_wc[e] = (CoordType)pt_w[e];
+                GADGET_CHECK_RETURN_FALSE(this->world_to_grid(pt_wc, pt_g));
+                pg[d][i] = pt_g[d];
+            }
+        }
+
+        ArrayType r[DOut];
+        GADGET_CHECK_RETURN_FALSE(this->evaluateFFDOnGrid(pg, r));
+
+        for ( d=0; d<DOut; d++ )
+        {
+            GADGET_CHECK_RETURN_FALSE(target[d].get_number_of_elements()==r[d].get_number_of_elements());
+            memcpy(target[d].begin(), r[d].begin(), r[d].get_number_of_bytes());
+        }
+    }
+    catch(...)
+    {
+        GERROR_STREAM("Error happened in BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnImage(ImageType target[DOut]) const ... ");
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
+bool BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnArray(ArrayType target[DOut]) const
+{
+    try
+    {
+        bool separable = (target[0].get_number_of_dimensions()==DIn);
+
+        unsigned int d, e;
+        for ( d=0; d<DIn; d++ )
+        {
+            for ( e=0; e<DIn; e++ )
+            {
+                if ( e==d ) continue;
+                if ( std::abs(this->ctrl_pt_[0].get_axis(d, e))>FLT_EPSILON ) separable = false;
+            }
+        }
+
+        if ( !separable )
+        {
+            return BaseClass::evaluateFFDOnArray(target);
+        }
+
+        // the array indexes are the world coordinates
+        std::vector<CoordType> pg[D];
+
+        CoordType pt_w[DIn], pt_g[DIn];
+
+        for ( d=0; d<DIn; d++ )
+        {
+            size_t N = target[0].get_size(d);
+            pg[d].resize(N);
+
+            for ( e=0; e<DIn; e++ ) pt_w[e] = 0;
+
+            for ( size_t i=0; i<N; i++ )
+            {
+                pt_w[d] = (CoordType)i;
+                GADGET_CHECK_RETURN_FALSE(this->world_to_grid(pt_w, pt_g));
+                pg[d][i] = pt_g[d];
+            }
+        }
+
+        ArrayType r[DOut];
+        GADGET_CHECK_RETURN_FALSE(this->evaluateFFDOnGrid(pg, r));
+
+        for ( d=0; d<DOut; d++ )
+        {
+            GADGET_CHECK_RETURN_FALSE(target[d].get_number_of_elements()==r[d].get_number_of_elements());
+            memcpy(target[d].begin(), r[d].begin(), r[d].get_number_of_bytes());
+        }
+    }
+    catch(...)
+    {
+        GERROR_STREAM("Error happened in BSplineFFD<T, CoordType, DIn, DOut>::evaluateFFDOnArray(ArrayType target[DOut]) const ... ");
+        return false;
+    }
+
+    return true;
+}
+
 template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
 void BSplineFFD<T, CoordType, DIn, DOut>::print(std::ostream& os) const
 {
@@ -193,10 +193,12 @@ bool BSplineFFD2D<T, CoordType, DOut>::evaluateFFD2D(CoordType px, CoordType py,
         long long ix = (long long)std::floor(px);
         CoordType deltaX = px-(CoordType)ix;
         long long lx = FFD_MKINT(BSPLINELUTSIZE*deltaX);
+        if ( lx >= BSPLINELUTSIZE ) lx = BSPLINELUTSIZE-1;
 
         long long iy = (long long)std::floor(py);
         CoordType deltaY = py-(CoordType)iy;
         long long ly = FFD_MKINT(BSPLINELUTSIZE*deltaY);
+        if ( ly >= BSPLINELUTSIZE ) ly = BSPLINELUTSIZE-1;
 
         unsigned int d, jj;
         size_t offset[4];
@@ -203,14 +203,17 @@ bool BSplineFFD3D<T, CoordType, DOut>::evaluateFFD3D(CoordType px, CoordType py,
         long long ix = (long long)std::floor(px);
         CoordType deltaX = px-(CoordType)ix;
         long long lx = FFD_MKINT(BSPLINELUTSIZE*deltaX);
+        if ( lx >= BSPLINELUTSIZE ) lx = BSPLINELUTSIZE-1;
 
         long long iy = (long long)std::floor(py);
         CoordType deltaY = py-(CoordType)iy;
         long long ly = FFD_MKINT(BSPLINELUTSIZE*deltaY);
+        if ( ly >= BSPLINELUTSIZE ) ly = BSPLINELUTSIZE-1;
 
         long long iz = (long long)std::floor(pz);
         CoordType deltaZ = pz-(CoordType)iz;
         long long lz = FFD_MKINT(BSPLINELUTSIZE*deltaZ);
+        if ( lz >= BSPLINELUTSIZE ) lz = BSPLINELUTSIZE-1;
 
         unsigned int d, jj, kk;
         size_t offset[4][4]; // z, y
@@ -213,18 +213,22 @@ bool BSplineFFD4D<T, CoordType, DOut>::evaluateFFD4D(CoordType px, CoordType py,
         long long ix = (long long)std::floor(px);
         CoordType deltaX = px-(CoordType)ix;
         long long lx = FFD_MKINT(BSPLINELUTSIZE*deltaX);
+        if ( lx >= BSPLINELUTSIZE ) lx = BSPLINELUTSIZE-1;
 
         long long iy = (long long)std::floor(py);
         CoordType deltaY = py-(CoordType)iy;
         long long ly = FFD_MKINT(BSPLINELUTSIZE*deltaY);
+        if ( ly >= BSPLINELUTSIZE ) ly = BSPLINELUTSIZE-1;
 
         long long iz = (long long)std::floor(pz);
         CoordType deltaZ = pz-(CoordType)iz;
         long long lz = FFD_MKINT(BSPLINELUTSIZE*deltaZ);
+        if ( lz >= BSPLINELUTSIZE ) lz = BSPLINELUTSIZE-1;
 
         long long is = (long long)std::floor(ps);
         CoordType deltaS = ps-(CoordType)is;
         long long ls = FFD_MKINT(BSPLINELUTSIZE*deltaS);
+        if ( ls >= BSPLINELUTSIZE ) ls = BSPLINELUTSIZE-1;
 
         unsigned int d, jj, kk, ss;
         size_t offset[4][4][4]; // s, z, y
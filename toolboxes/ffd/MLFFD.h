@@ -56,6 +56,9 @@ public:
     /// the input points are in the FFD grid
     virtual bool evaluateFFD(const CoordType pt[D], T r[DOut]) const;
 
+    /// evaluate the FFD at N points, the levels are evaluated in turn over all points
+    virtual bool evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const;
+
     /// evaluate the 1st order derivative of FFD at a grid location
     /// deriv: derivative for all D dimensions and all DOut values
     virtual bool evaluateFFDDerivative(const CoordType pt[D], T deriv[D][DOut]) const;
@@ -160,6 +163,46 @@ inline bool MLFFD<T, CoordType, DIn, DOut>::evaluateFFD(const CoordType pt[D], T
     return true;
 }
 
+template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
+bool MLFFD<T, CoordType, DIn, DOut>::evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const
+{
+    try
+    {
+        size_t N = pts.get_size(1);
+        GADGET_CHECK_RETURN_FALSE(pts.get_size(0)==DIn);
+
+        if ( r.get_size(1)!=N || r.get_size(0)!=DOut )
+        {
+            r.create(DOut, N);
+        }
+        Gadgetron::clear(r);
+
+        ValueArrayType rLevel;
+
+        size_t ii;
+        for (ii=0; ii<ml_ffd_.size(); ii++)
+        {
+            if ( ml_ffd_[ii] == NULL ) continue;
+
+            GADGET_CHECK_RETURN_FALSE(ml_ffd_[ii]->evaluateFFDArray(pts, rLevel));
+
+            T* pR = r.begin();
+            const T* pL = rLevel.begin();
+            for ( size_t n=0; n<DOut*N; n++ )
+            {
+                pR[n] += pL[n];
+            }
+        }
+    }
+    catch(...)
+    {
+        GERROR_STREAM("Error happened in MLFFD<T, CoordType, DIn, DOut>::evaluateFFDArray(const CoordArrayType& pts, ValueArrayType& r) const ... ");
+        return false;
+    }
+
+    return true;
+}
+
 template <typename T, typename CoordType, unsigned int DIn, unsigned int DOut> 
 inline bool MLFFD<T, CoordType, DIn, DOut>::evaluateFFDDerivative(const CoordType pt[D], T deriv[D][DOut]) const
 {
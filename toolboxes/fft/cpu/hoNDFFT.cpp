@@ -7,17 +7,227 @@
 #include "hoMatrix.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDArray_math.h"
+#include "hoNDArrayScratch.h"
+#include "GadgetronMetrics.h"
+
+#include <cstdio>
 
 namespace Gadgetron{
 
 template<typename T> hoNDFFT<T>* hoNDFFT<T>::instance()
     																{
-	if (!instance_) instance_ = new hoNDFFT<T>();
+	// made once, also when the first calls come from several threads
+	static hoNDFFT<T>* inst = new hoNDFFT<T>();
+	instance_ = inst;
 	return instance_;
     																}
 
 template<class T> hoNDFFT<T>* hoNDFFT<T>::instance_ = NULL;
 
+template<class T> template <typename F> typename fftw_types<T>::plan * hoNDFFT<T>::cached_plan_(const PlanKey& key, F make)
+{
+	static GadgetronMetricCounter& hits = GadgetronMetrics::instance().counter("gadgetron_fft_plan_cache_hits_total", "FFTW plans found in the plan cache");
+	static GadgetronMetricCounter& misses = GadgetronMetrics::instance().counter("gadgetron_fft_plan_cache_misses_total", "FFTW plans created because they were not in the plan cache");
+
+	// entries this thread has used before are found without locking
+	static thread_local PlanCache local_cache;
+	typename PlanCache::const_iterator it = local_cache.find(key);
+	if (it != local_cache.end())
+	{
+		hits.add();
+		return it->second;
+	}
+
+	typename fftw_types<T>::plan * p = 0;
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+
+		typename PlanCache::const_iterator g = plan_cache_.find(key);
+		if (g != plan_cache_.end())
+		{
+			p = g->second;
+			hits.add();
+		}
+		else
+		{
+			misses.add();
+			p = make();
+			if (p == NULL)
+			{
+				throw std::runtime_error("hoNDFFT: failed to create fft plan");
+			}
+			plan_cache_[key] = p;
+		}
+	}
+
+	local_cache[key] = p;
+	return p;
+}
+
+template<class T> template <typename F> typename fftw_types<T>::plan * hoNDFFT<T>::plan_with_wisdom_(unsigned flags, F make)
+{
+	// only the plans the transforms make on their own data, with FFTW_ESTIMATE, are affected
+	if (flags != FFTW_ESTIMATE || wisdom_rigor_ == FFTW_ESTIMATE) return make(flags);
+
+	if (wisdom_learn_) return make(wisdom_rigor_);
+
+	typename fftw_types<T>::plan * p = make(wisdom_rigor_ | FFTW_WISDOM_ONLY);
+	if (p != NULL) return p;
+
+	return make(flags);
+}
+
+template<class T> bool hoNDFFT<T>::load_wisdom(const std::string& filename)
+{
+	FILE* f = fopen(filename.c_str(), "r");
+	if (f == NULL) return false;
+
+	int res = 0;
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		res = fftw_import_wisdom_from_file_(f);
+	}
+	fclose(f);
+
+	if (res == 0) GWARN_STREAM("hoNDFFT: could not read fftw wisdom from " << filename);
+	return (res != 0);
+}
+
+template<class T> bool hoNDFFT<T>::save_wisdom(const std::string& filename)
+{
+	// written next to the file and renamed, readers see either the old or the new wisdom
+	std::string tmp = filename + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "w");
+	if (f == NULL)
+	{
+		GERROR_STREAM("hoNDFFT: could not open " << tmp << " for the fftw wisdom");
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		fftw_export_wisdom_to_file_(f);
+	}
+
+	bool good = (ferror(f) == 0);
+	good = (fclose(f) == 0) && good;
+	if (!good || std::rename(tmp.c_str(), filename.c_str()) != 0)
+	{
+		GERROR_STREAM("hoNDFFT: could not write the fftw wisdom to " << filename);
+		std::remove(tmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+template<class T> void hoNDFFT<T>::use_wisdom(unsigned rigor)
+{
+	std::lock_guard<std::mutex> guard(mutex_);
+	wisdom_rigor_ = rigor;
+	wisdom_learn_ = false;
+}
+
+template<class T> void hoNDFFT<T>::learn_wisdom(unsigned rigor)
+{
+	std::lock_guard<std::mutex> guard(mutex_);
+	wisdom_rigor_ = rigor;
+	wisdom_learn_ = true;
+}
+
+template<class T> std::string hoNDFFT<T>::wisdom_filename(const std::string& gadgetron_home)
+{
+	return gadgetron_home + "/share/gadgetron/fftw/wisdom_" + (sizeof(T) == sizeof(float) ? "float" : "double") + ".txt";
+}
+
+template<class T> typename fftw_types<T>::plan * hoNDFFT<T>::fftw_plan_many_dft_cached_(int rank, const int *n, int howmany,
+                                          ComplexType *in, int istride, int idist,
+                                          ComplexType *out, int ostride, int odist,
+                                          int sign, unsigned flags)
+{
+	PlanKey key;
+	key.geometry.push_back(0);
+	key.geometry.push_back(rank);
+	for (int d = 0; d < rank; d++) key.geometry.push_back(n[d]);
+	key.geometry.push_back(howmany);
+	key.geometry.push_back(istride);
+	key.geometry.push_back(idist);
+	key.geometry.push_back(ostride);
+	key.geometry.push_back(odist);
+	key.sign = sign;
+	key.flags = flags;
+	key.in_place = (in == out);
+	key.in_alignment = fftw_alignment_of_(in);
+	key.out_alignment = fftw_alignment_of_(out);
+
+	return cached_plan_(key, [&]() {
+		return plan_with_wisdom_(flags, [&](unsigned f) {
+			return fftw_plan_many_dft_(rank, n, howmany, in, NULL, istride, idist, out, NULL, ostride, odist, sign, f);
+		});
+	});
+}
+
+template<class T> typename fftw_types<T>::plan * hoNDFFT<T>::fftw_plan_guru_dft_cached_(const std::vector<fftw_iodim64>& dims,
+                                          const std::vector<fftw_iodim64>& howmany_dims,
+                                          ComplexType *in, ComplexType *out, int sign, unsigned flags)
+{
+	PlanKey key;
+	key.geometry.push_back(1);
+	key.geometry.push_back((long long)dims.size());
+	for (size_t d = 0; d < dims.size(); d++)
+	{
+		key.geometry.push_back(dims[d].n);
+		key.geometry.push_back(dims[d].is);
+		key.geometry.push_back(dims[d].os);
+	}
+	key.geometry.push_back((long long)howmany_dims.size());
+	for (size_t d = 0; d < howmany_dims.size(); d++)
+	{
+		key.geometry.push_back(howmany_dims[d].n);
+		key.geometry.push_back(howmany_dims[d].is);
+		key.geometry.push_back(howmany_dims[d].os);
+	}
+	key.sign = sign;
+	key.flags = flags;
+	key.in_place = (in == out);
+	key.in_alignment = fftw_alignment_of_(in);
+	key.out_alignment = fftw_alignment_of_(out);
+
+	return cached_plan_(key, [&]() {
+		return plan_with_wisdom_(flags, [&](unsigned f) {
+			return fftw_plan_guru64_dft_((int)dims.size(), dims.empty() ? NULL : &dims[0],
+				(int)howmany_dims.size(), howmany_dims.empty() ? NULL : &howmany_dims[0], in, out, sign, f);
+		});
+	});
+}
+
+template<class T> typename fftw_types<T>::plan * hoNDFFT<T>::fftw_plan_real_cached_(bool r2c, int rank, const int *n, int howmany,
+                                          T *real, ComplexType *cplx, unsigned flags)
+{
+	const int len = n[rank-1];
+	int dist = 1;
+	for (int d = 0; d < rank-1; d++) dist *= n[d];
+	const int real_dist = dist*len;
+	const int cplx_dist = dist*(len/2+1);
+
+	PlanKey key;
+	key.geometry.push_back(2);
+	key.geometry.push_back(rank);
+	for (int d = 0; d < rank; d++) key.geometry.push_back(n[d]);
+	key.geometry.push_back(howmany);
+	key.sign = r2c ? FFTW_FORWARD : FFTW_BACKWARD;
+	key.flags = flags;
+	key.in_place = false;
+	key.in_alignment = r2c ? fftw_alignment_of_((ComplexType*)real) : fftw_alignment_of_(cplx);
+	key.out_alignment = r2c ? fftw_alignment_of_(cplx) : fftw_alignment_of_((ComplexType*)real);
+
+	return cached_plan_(key, [&]() {
+		return plan_with_wisdom_(flags, [&](unsigned f) {
+			if (r2c) return fftw_plan_many_dft_r2c_(rank, n, howmany, real, real_dist, cplx, cplx_dist, f);
+			return fftw_plan_many_dft_c2r_(rank, n, howmany, cplx, cplx_dist, real, real_dist, f);
+		});
+	});
+}
 
 template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* input, size_t dim_to_transform, int sign)
    {
@@ -76,27 +286,30 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
        total_dist = trafos*dist;
 
 
-       //Allocate storage and make plan
+       //Allocate storage and get the plan, measured once for every length
        {
            std::lock_guard<std::mutex> guard(mutex_);
            fft_storage = (ComplexType*)fftw_malloc_(sizeof(T)*length*2);
-           if (fft_storage == 0)
-           {
-               GDEBUG_STREAM("Failed to allocate buffer for FFT" << std::endl);
-               return;
-           }
-           fft_buffer = fft_storage;
-
-           unsigned planner_flags = FFTW_MEASURE | FFTW_DESTROY_INPUT;
+       }
+       if (fft_storage == 0)
+       {
+           GDEBUG_STREAM("Failed to allocate buffer for FFT" << std::endl);
+           return;
+       }
+       fft_buffer = fft_storage;
 
-           fft_plan = fftw_plan_dft_1d_(length, fft_storage, fft_storage, sign, planner_flags);
+       unsigned planner_flags = FFTW_MEASURE | FFTW_DESTROY_INPUT;
 
-           if (fft_plan == 0)
-           {
-               fftw_free_(fft_storage);
-               GDEBUG_STREAM("Failed to create plan for FFT" << std::endl);
-               return;
-           }
+       try
+       {
+           fft_plan = fftw_plan_many_dft_cached_(1, &length, 1, fft_storage, 1, length, fft_storage, 1, length, sign, planner_flags);
+       }
+       catch (...)
+       {
+           std::lock_guard<std::mutex> guard(mutex_);
+           fftw_free_(fft_storage);
+           GDEBUG_STREAM("Failed to create plan for FFT" << std::endl);
+           return;
        }
 
        //Grab address of data
@@ -125,7 +338,7 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
                    }
                }
 
-               fftw_execute_(fft_plan);
+               fftw_execute_dft_(fft_plan, fft_buffer, fft_buffer);
 
                {
                    int j, idx3 = idx2;
@@ -144,14 +357,9 @@ template<class T> void hoNDFFT<T>::fft_int_uneven(hoNDArray< ComplexType >* inpu
            } //Loop over transformations
        } //Loop over chunks
 
-       //clean up
+       //clean up, the plan stays in the cache
        {
            std::lock_guard<std::mutex> guard(mutex_);
-           if (fft_plan != 0)
-           {
-               fftw_destroy_plan_(fft_plan);
-           }
-
            if (fft_storage != 0)
            {
                fftw_free_(fft_storage);
@@ -219,37 +427,23 @@ template<class T> void hoNDFFT<T>::fft_int(hoNDArray< ComplexType >* input, size
 //Grab address of data
 	ComplexType* data_ptr = input->get_data_ptr();
 
-	//Allocate storage and make plan
-	{
-            std::lock_guard<std::mutex> guard(mutex_);
-            unsigned planner_flags = FFTW_ESTIMATE;
-            fft_plan = fftw_plan_many_dft_(1,&length,trafos,data_ptr,&length,stride,dist,data_ptr,&length,stride,dist,sign,planner_flags);
-            //fftw_print_plan_(fft_plan);
-            if (fft_plan == NULL)
-	    {
-                throw std::runtime_error("hoNDFFT: failed to create fft plan");
-            }
-	}
+	//Get the plan for every chunk, chunks of different alignment need different plans;
+	//a geometry fftw cannot plan throws here, outside the parallel loop
+	unsigned planner_flags = FFTW_ESTIMATE;
+	fft_plan = fftw_plan_many_dft_cached_(1,&length,trafos,data_ptr,stride,dist,data_ptr,stride,dist,sign,planner_flags);
 
-#pragma omp parallel for
+#pragma omp parallel for private(fft_plan)
 	for (int k = 0; k < chunks; k++)
+	{
+		fft_plan = fftw_plan_many_dft_cached_(1,&length,trafos,data_ptr+k*chunk_size,stride,dist,data_ptr+k*chunk_size,stride,dist,sign,planner_flags);
 		fftw_execute_dft_(fft_plan,data_ptr+k*chunk_size,data_ptr+k*chunk_size);
+	}
 
 //Flip frequencies to center DC freq
 	if (sign == FFTW_FORWARD)
 		timeswitch(input,dim_to_transform);
 
 
-	//clean up
-	{
-            std::lock_guard<std::mutex> guard(mutex_);
-            if (fft_plan != 0)
-	    {
-                fftw_destroy_plan_(fft_plan);
-            }
-	}
-
-
 	*input *= scale;
 }
 template<typename T>
@@ -284,7 +478,10 @@ void hoNDFFT<T>::fftshiftPivot1D(ComplexType* a, size_t x, size_t n, size_t pivo
 
 #pragma omp parallel private(counter) shared(n, x, pivot, a) if ( n > 256 )
 	{
-		hoNDArray< ComplexType > aTmp(x);
+		hoNDArrayScratchScope scratch_scope;
+
+		hoNDArray< ComplexType > aTmp;
+		hoNDArrayScratch::instance().create(aTmp, x);
 
 #pragma omp for
 		for ( counter=0; counter<(long long)n; counter++ )
@@ -397,7 +594,10 @@ void hoNDFFT<T>::fftshiftPivot2D(ComplexType* a, size_t x, size_t y, size_t n, s
 
 #pragma omp parallel private(tt) shared(a, x, y, n, pivotx, pivoty) if (n>16)
 	{
-		hoNDArray< ComplexType > aTmp(x*y);
+		hoNDArrayScratchScope scratch_scope;
+
+		hoNDArray< ComplexType > aTmp;
+		hoNDArrayScratch::instance().create(aTmp, x*y);
 		ComplexType* rc = aTmp.begin();
 
 #pragma omp for
@@ -580,7 +780,10 @@ void hoNDFFT<T>::fftshiftPivot3D(ComplexType* a, size_t x, size_t y, size_t z, s
 
 #pragma omp parallel private(tt) shared(a, x, y, z, n, pivotx, pivoty, pivotz) if (n>16)
 	{
-		hoNDArray< ComplexType > aTmp(x*y*z);
+		hoNDArrayScratchScope scratch_scope;
+
+		hoNDArray< ComplexType > aTmp;
+		hoNDArrayScratch::instance().create(aTmp, x*y*z);
 
 #pragma omp for
 		for ( tt=0; tt<(long long)n; tt++ )
@@ -761,6 +964,8 @@ inline void hoNDFFT<T>::ifft1(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::fft1c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, a, 1, true);
+
 	ifftshift1D(a);
 	fft1(a);
 	fftshift1D(a);
@@ -769,6 +974,8 @@ inline void hoNDFFT<T>::fft1c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::ifft1c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, a, 1, false);
+
 	ifftshift1D(a);
 	ifft1(a);
 	fftshift1D(a);
@@ -777,6 +984,8 @@ inline void hoNDFFT<T>::ifft1c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::fft1c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, r, 1, true);
+
 	ifftshift1D(a, r);
 	fft1(r);
 	fftshift1D(r);
@@ -786,6 +995,8 @@ inline void hoNDFFT<T>::fft1c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft1c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, r, 1, false);
+
 	ifftshift1D(a, r);
 	ifft1(r);
 	fftshift1D(r);
@@ -794,6 +1005,8 @@ inline void hoNDFFT<T>::ifft1c(const hoNDArray< ComplexType >& a, hoNDArray< Com
 template<typename T>
 inline void hoNDFFT<T>::fft1c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, r, 1, true);
+
 	ifftshift1D(a, r);
 	fft1(r, buf);
 	fftshift1D(buf, r);
@@ -802,6 +1015,8 @@ inline void hoNDFFT<T>::fft1c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft1c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 1)) return fftNc_even(a, r, 1, false);
+
 	ifftshift1D(a, r);
 	ifft1(r, buf);
 	fftshift1D(buf, r);
@@ -851,6 +1066,8 @@ inline void hoNDFFT<T>::ifft2(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::fft2c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, a, 2, true);
+
 	ifftshift2D(a);
 	fft2(a);
 	fftshift2D(a);
@@ -860,6 +1077,8 @@ inline void hoNDFFT<T>::fft2c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::ifft2c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, a, 2, false);
+
 	ifftshift2D(a);
 	ifft2(a);
 	fftshift2D(a);
@@ -868,6 +1087,8 @@ inline void hoNDFFT<T>::ifft2c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::fft2c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, r, 2, true);
+
 	ifftshift2D(a, r);
 	fft2(r);
 	fftshift2D(r);
@@ -876,6 +1097,8 @@ inline void hoNDFFT<T>::fft2c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft2c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, r, 2, false);
+
 	ifftshift2D(a, r);
 	ifft2(r);
 	fftshift2D(r);
@@ -884,6 +1107,8 @@ inline void hoNDFFT<T>::ifft2c(const hoNDArray< ComplexType >& a, hoNDArray< Com
 template<typename T>
 inline void hoNDFFT<T>::fft2c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, r, 2, true);
+
 	ifftshift2D(a, r);
 	fft2(r, buf);
 	fftshift2D(buf, r);
@@ -892,6 +1117,8 @@ inline void hoNDFFT<T>::fft2c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft2c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 2)) return fftNc_even(a, r, 2, false);
+
 	ifftshift2D(a, r);
 	ifft2(r, buf);
 	fftshift2D(buf, r);
@@ -940,6 +1167,8 @@ inline void hoNDFFT<T>::ifft3(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::fft3c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, a, 3, true);
+
 	ifftshift3D(a);
 	fft3(a);
 	fftshift3D(a);
@@ -948,6 +1177,8 @@ inline void hoNDFFT<T>::fft3c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::ifft3c(hoNDArray< ComplexType >& a)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, a, 3, false);
+
 	ifftshift3D(a);
 	ifft3(a);
 	fftshift3D(a);
@@ -956,6 +1187,8 @@ inline void hoNDFFT<T>::ifft3c(hoNDArray< ComplexType >& a)
 template<typename T>
 inline void hoNDFFT<T>::fft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, r, 3, true);
+
 	ifftshift3D(a, r);
 	fft3(r);
 	fftshift3D(r);
@@ -964,6 +1197,8 @@ inline void hoNDFFT<T>::fft3c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, r, 3, false);
+
 	ifftshift3D(a, r);
 	ifft3(r);
 	fftshift3D(r);
@@ -972,6 +1207,8 @@ inline void hoNDFFT<T>::ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< Com
 template<typename T>
 inline void hoNDFFT<T>::fft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, r, 3, true);
+
 	ifftshift3D(a, r);
 	fft3(r, buf);
 	fftshift3D(buf, r);
@@ -980,29 +1217,711 @@ inline void hoNDFFT<T>::fft3c(const hoNDArray< ComplexType >& a, hoNDArray< Comp
 template<typename T>
 inline void hoNDFFT<T>::ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf)
 {
+	if (even_sizes(a, 3)) return fftNc_even(a, r, 3, false);
+
 	ifftshift3D(a, r);
 	ifft3(r, buf);
 	fftshift3D(buf, r);
 }
 
+// -----------------------------------------------------------------------------------------
+
+namespace
+{
+	// r = s*(-1)^(i0+..+iD-1)*a over the first D dimensions of size n, all even, for rows of n[0] elements
+	template <typename C, typename R> void checkerboard(const C* a, C* r, const std::vector<size_t>& n, size_t D, size_t N, R s, int num_thr)
+	{
+		const size_t n0 = n[0];
+		const size_t rows = N/n0;
+		long long row;
+
+#pragma omp parallel for private(row) shared(a, r, n) if (num_thr > 1) num_threads(num_thr)
+		for (row = 0; row < (long long)rows; row++)
+		{
+			size_t parity = 0;
+			size_t q = (size_t)row;
+			for (size_t d = 1; d < D; d++)
+			{
+				parity += q % n[d];
+				q /= n[d];
+			}
+
+			const R sr = (parity & 1) ? -s : s;
+			const C* pa = a + row*n0;
+			C* pr = r + row*n0;
+			for (size_t i = 0; i < n0; i += 2)
+			{
+				pr[i] = pa[i]*sr;
+				pr[i+1] = pa[i+1]*(-sr);
+			}
+		}
+	}
+}
+
+template<typename T>
+bool hoNDFFT<T>::even_sizes(const hoNDArray< ComplexType >& a, size_t D)
+{
+	if (a.get_number_of_dimensions() < D) return false;
+	for (size_t d = 0; d < D; d++)
+	{
+		if (a.get_size(d) % 2) return false;
+	}
+	return true;
+}
+
+template<typename T>
+void hoNDFFT<T>::fftNc_even(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, size_t D, bool forward)
+{
+	// for even n, fftshift(fft(ifftshift(x)))[k] = (-1)^(n/2) (-1)^k fft((-1)^m x[m])[k], the same for the inverse
+	if ( &r != &a && !r.dimensions_equal(&a) )
+	{
+		r.create(a.get_dimensions());
+	}
+
+	const size_t N = a.get_number_of_elements();
+	if (N == 0) return;
+
+	std::vector<size_t> dim(D);
+	int n[3];
+	size_t len = 1;
+	T scale = 1;
+	for (size_t d = 0; d < D; d++)
+	{
+		dim[d] = a.get_size(d);
+		n[D-1-d] = (int)dim[d];
+		len *= dim[d];
+		if ((dim[d]/2) % 2) scale = -scale;
+	}
+	scale *= T(1.0/std::sqrt(T(len)));
+
+	const int num = (int)(N/len);
+	int num_thr = 1;
+	if (D == 1) num_thr = get_num_threads_fft1(dim[0], num);
+	else if (D == 2) num_thr = get_num_threads_fft2(dim[1], dim[0], num);
+	else num_thr = get_num_threads_fft3(dim[2], dim[1], dim[0], num);
+
+	checkerboard(a.begin(), r.begin(), dim, D, N, T(1), num_thr);
+
+	const int sign = forward ? FFTW_FORWARD : FFTW_BACKWARD;
+	const int dist = (int)len;
+	ComplexType* pr = r.begin();
+
+	typename fftw_types<T>::plan * p;
+
+	if ( num_thr > 1 )
+	{
+		p = fftw_plan_many_dft_cached_((int)D, n, 1, pr, 1, dist, pr, 1, dist, sign, FFTW_ESTIMATE);
+
+		int k;
+#pragma omp parallel for private(k, p) shared(n, pr) num_threads(num_thr)
+		for ( k=0; k<num; k++ )
+		{
+			p = fftw_plan_many_dft_cached_((int)D, n, 1, pr+k*dist, 1, dist, pr+k*dist, 1, dist, sign, FFTW_ESTIMATE);
+			fftw_execute_dft_(p, pr+k*dist, pr+k*dist);
+		}
+	}
+	else
+	{
+		p = fftw_plan_many_dft_cached_((int)D, n, num, pr, 1, dist, pr, 1, dist, sign, FFTW_ESTIMATE);
+		fftw_execute_dft_(p, pr, pr);
+	}
+
+	checkerboard(pr, pr, dim, D, N, scale, num_thr);
+}
+
+// -----------------------------------------------------------------------------------------
+
+namespace
+{
+	// r[i] = a[(i + p[d]) % n[d]] along every dimension d < p.size(), a and r of dimensions n
+	template <typename V> void shift_copy(const V* a, V* r, const std::vector<size_t>& n, const std::vector<size_t>& p)
+	{
+		size_t N = 1;
+		for (size_t d = 0; d < n.size(); d++) N *= n[d];
+
+		const size_t n0 = n[0];
+		const size_t p0 = p.empty() ? 0 : p[0] % n0;
+		const size_t rows = N/n0;
+		long long row;
+
+#pragma omp parallel for private(row) shared(a, r, n, p) if (N > 64*1024)
+		for (row = 0; row < (long long)rows; row++)
+		{
+			size_t q = (size_t)row;
+			size_t src = 0;
+			size_t stride = 1;
+			for (size_t d = 1; d < n.size(); d++)
+			{
+				const size_t i = q % n[d];
+				q /= n[d];
+				src += ((d < p.size()) ? (i + p[d]) % n[d] : i)*stride;
+				stride *= n[d];
+			}
+
+			const V* pa = a + src*n0;
+			V* pr = r + row*n0;
+			memcpy(pr, pa + p0, sizeof(V)*(n0 - p0));
+			memcpy(pr + n0 - p0, pa, sizeof(V)*p0);
+		}
+	}
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_real_int(T* x, ComplexType* r, const std::vector<size_t>& dims, size_t D, bool r2c)
+{
+	int n[3];
+	size_t len = 1;
+	for (size_t d = 0; d < D; d++)
+	{
+		n[D-1-d] = (int)dims[d];
+		len *= dims[d];
+	}
+	const size_t lenc = len/dims[0]*(dims[0]/2+1);
+
+	size_t N = 1;
+	for (size_t d = 0; d < dims.size(); d++) N *= dims[d];
+	const int num = (int)(N/len);
+
+	int num_thr = 1;
+	if (D == 1) num_thr = get_num_threads_fft1(dims[0], num);
+	else if (D == 2) num_thr = get_num_threads_fft2(dims[1], dims[0], num);
+	else num_thr = get_num_threads_fft3(dims[2], dims[1], dims[0], num);
+
+	typename fftw_types<T>::plan * p;
+
+	if ( num_thr > 1 )
+	{
+		p = fftw_plan_real_cached_(r2c, (int)D, n, 1, x, r, FFTW_ESTIMATE);
+
+		int k;
+#pragma omp parallel for private(k, p) shared(n, x, r) num_threads(num_thr)
+		for ( k=0; k<num; k++ )
+		{
+			p = fftw_plan_real_cached_(r2c, (int)D, n, 1, x+k*len, r+k*lenc, FFTW_ESTIMATE);
+			if (r2c) fftw_execute_dft_r2c_(p, x+k*len, r+k*lenc);
+			else fftw_execute_dft_c2r_(p, r+k*lenc, x+k*len);
+		}
+	}
+	else
+	{
+		p = fftw_plan_real_cached_(r2c, (int)D, n, num, x, r, FFTW_ESTIMATE);
+		if (r2c) fftw_execute_dft_r2c_(p, x, r);
+		else fftw_execute_dft_c2r_(p, r, x);
+	}
+
+	const T scale = T(1.0/std::sqrt(T(len)));
+	long long i;
+	if (r2c)
+	{
+		const long long M = (long long)(lenc*num);
+#pragma omp parallel for private(i) shared(r) if (num_thr > 1) num_threads(num_thr)
+		for (i = 0; i < M; i++) r[i] *= scale;
+	}
+	else
+	{
+		const long long M = (long long)(len*num);
+#pragma omp parallel for private(i) shared(x) if (num_thr > 1) num_threads(num_thr)
+		for (i = 0; i < M; i++) x[i] *= scale;
+	}
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_r2c(const hoNDArray<T>& x, hoNDArray< ComplexType >& r, size_t D, bool centered)
+{
+	if (D < 1 || D > 3 || x.get_number_of_dimensions() < D) throw std::runtime_error("hoNDFFT::fft_r2c: only the first 1, 2 or 3 dimensions can be transformed");
+
+	std::vector<size_t> dims = *x.get_dimensions();
+	std::vector<size_t> rdims(dims);
+	rdims[0] = dims[0]/2 + 1;
+
+	if ( !r.dimensions_equal(&rdims) )
+	{
+		r.create(rdims);
+	}
+
+	if (x.get_number_of_elements() == 0) return;
+
+	// the planner takes non-const arrays, an FFTW_ESTIMATE r2c plan does not write to its input
+	if (!centered) return fft_real_int(const_cast<T*>(x.begin()), r.begin(), dims, D, true);
+
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray<T> xs;
+	hoNDArrayScratch::instance().create(xs, dims);
+
+	std::vector<size_t> p(D);
+	for (size_t d = 0; d < D; d++) p[d] = ifftshiftPivot(dims[d]);
+	shift_copy(x.begin(), xs.begin(), dims, p);
+
+	if (D == 1) return fft_real_int(xs.begin(), r.begin(), dims, D, true);
+
+	hoNDArray< ComplexType > rs;
+	hoNDArrayScratch::instance().create(rs, rdims);
+	fft_real_int(xs.begin(), rs.begin(), dims, D, true);
+
+	// dimension 0 holds the frequencies 0 .. n0/2 and stays as it is
+	std::vector<size_t> q(D, 0);
+	for (size_t d = 1; d < D; d++) q[d] = fftshiftPivot(dims[d]);
+	shift_copy(rs.begin(), r.begin(), rdims, q);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_c2r(const hoNDArray< ComplexType >& r, hoNDArray<T>& x, size_t D, size_t n0, bool centered)
+{
+	if (D < 1 || D > 3 || r.get_number_of_dimensions() < D) throw std::runtime_error("hoNDFFT::ifft_c2r: only the first 1, 2 or 3 dimensions can be transformed");
+	if (n0/2 + 1 != r.get_size(0)) throw std::runtime_error("hoNDFFT::ifft_c2r: n0 does not match the size of the first dimension");
+
+	std::vector<size_t> rdims = *r.get_dimensions();
+	std::vector<size_t> dims(rdims);
+	dims[0] = n0;
+
+	if ( !x.dimensions_equal(&dims) )
+	{
+		x.create(dims);
+	}
+
+	if (x.get_number_of_elements() == 0) return;
+
+	hoNDArrayScratchScope scratch_scope;
+
+	// c2r overwrites its input
+	hoNDArray< ComplexType > rs;
+	hoNDArrayScratch::instance().create(rs, rdims);
+	if (centered)
+	{
+		std::vector<size_t> q(D, 0);
+		for (size_t d = 1; d < D; d++) q[d] = ifftshiftPivot(dims[d]);
+		shift_copy(r.begin(), rs.begin(), rdims, q);
+	}
+	else
+	{
+		memcpy(rs.begin(), r.begin(), r.get_number_of_bytes());
+	}
+
+	if (!centered) return fft_real_int(x.begin(), rs.begin(), dims, D, false);
+
+	hoNDArray<T> xs;
+	hoNDArrayScratch::instance().create(xs, dims);
+	fft_real_int(xs.begin(), rs.begin(), dims, D, false);
+
+	std::vector<size_t> p(D);
+	for (size_t d = 0; d < D; d++) p[d] = fftshiftPivot(dims[d]);
+	shift_copy(xs.begin(), x.begin(), dims, p);
+}
+
+// -----------------------------------------------------------------------------------------
+
+template<typename T>
+void hoNDFFT<T>::fft_view(const hoNDArrayView< ComplexType >& a, size_t D, bool forward)
+{
+	if (a.get_number_of_dimensions() < D) throw std::runtime_error("hoNDFFT::fft_view: view has fewer dimensions than transformed");
+
+	if (a.contiguous_dimensions() >= D)
+	{
+		// every block holds complete transforms
+		a.for_each_block([this, D, forward](hoNDArray< ComplexType >& b)
+		{
+			if (D == 1) { if (forward) this->fft1c(b); else this->ifft1c(b); }
+			else if (D == 2) { if (forward) this->fft2c(b); else this->ifft2c(b); }
+			else { if (forward) this->fft3c(b); else this->ifft3c(b); }
+		});
+		return;
+	}
+
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray< ComplexType > buf;
+	std::vector<size_t> dims(a.get_dimensions());
+	hoNDArrayScratch::instance().create(buf, dims);
+
+	a.copy_to(buf);
+	if (D == 1) { if (forward) this->fft1c(buf); else this->ifft1c(buf); }
+	else if (D == 2) { if (forward) this->fft2c(buf); else this->ifft2c(buf); }
+	else { if (forward) this->fft3c(buf); else this->ifft3c(buf); }
+	a.copy_from(buf);
+}
+
+namespace
+{
+	// exp(sign*2*pi*i*num/n), exact on the quarter turns so shifts by n/2 of even sizes stay exact
+	template <typename C> C unit_root(long long num, long long n, int sign)
+	{
+		num %= n;
+		if (num < 0) num += n;
+
+		if (num == 0) return C(1, 0);
+		if (2*num == n) return C(-1, 0);
+		if (4*num == n) return C(0, (sign > 0) ? 1 : -1);
+		if (4*num == 3*n) return C(0, (sign > 0) ? -1 : 1);
+
+		const double a = sign*2.0*M_PI*double(num)/double(n);
+		return C(std::cos(a), std::sin(a));
+	}
+}
+
+template<typename T>
+void hoNDFFT<T>::modulate(const hoNDArrayView< ComplexType >& a, const std::vector< std::vector<ComplexType> >& w, int num_threads)
+{
+	const size_t D = a.get_number_of_dimensions();
+	const size_t n0 = a.get_size(0);
+	const size_t s0 = a.get_stride(0);
+	const size_t rows = a.get_number_of_elements()/n0;
+	ComplexType* data = a.get_data_ptr();
+
+	long long r;
+
+#pragma omp parallel for private(r) shared(a, w, data) if (num_threads > 1) num_threads(num_threads)
+	for (r = 0; r < (long long)rows; r++)
+	{
+		size_t rem = (size_t)r;
+		size_t offset = 0;
+		ComplexType g(1);
+
+		for (size_t d = 1; d < D; d++)
+		{
+			const size_t i = rem % a.get_size(d);
+			rem /= a.get_size(d);
+			offset += i*a.get_stride(d);
+			if (!w[d].empty()) g *= w[d][i];
+		}
+
+		ComplexType* p = data + offset;
+		if (w[0].empty())
+		{
+			for (size_t i = 0; i < n0; i++) p[i*s0] *= g;
+		}
+		else
+		{
+			const ComplexType* w0 = &w[0][0];
+			for (size_t i = 0; i < n0; i++) p[i*s0] *= g*w0[i];
+		}
+	}
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_many_int(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, bool forward, int num_threads)
+{
+	const size_t D = a.get_number_of_dimensions();
+	const size_t N = a.get_number_of_elements();
+	if (N == 0 || dims_to_transform.empty()) return;
+
+	std::vector<bool> transformed(D, false);
+	for (size_t i = 0; i < dims_to_transform.size(); i++)
+	{
+		size_t d = dims_to_transform[i];
+		if (d >= D) throw std::runtime_error("hoNDFFT::fft_many: transform dimension larger than dimension of the view");
+		if (transformed[d]) throw std::runtime_error("hoNDFFT::fft_many: dimension to transform given twice");
+		transformed[d] = true;
+	}
+
+	const int sign = forward ? FFTW_FORWARD : FFTW_BACKWARD;
+
+	// fftw lists dimensions from the slowest to the fastest one, sizes of 1 are left out
+	std::vector<fftw_iodim64> dims, howmany_dims;
+	size_t elements_in_ft = 1;
+	for (size_t d = D; d-- > 0; )
+	{
+		fftw_iodim64 io;
+		io.n = (ptrdiff_t)a.get_size(d);
+		io.is = (ptrdiff_t)a.get_stride(d);
+		io.os = io.is;
+
+		if (transformed[d])
+		{
+			elements_in_ft *= a.get_size(d);
+			if (io.n > 1) dims.push_back(io);
+		}
+		else if (io.n > 1)
+		{
+			howmany_dims.push_back(io);
+		}
+	}
+
+	if (dims.empty())
+	{
+		// only transforms of length 1, which do nothing
+		return;
+	}
+
+	// centering: c = shift(fft(ishift(x))) = post .* fft(pre .* x) along every transformed dimension,
+	// with h = floor(n/2), pre[m] = e^(-s*2*pi*i*h*m/n) and post[k] = e^(s*2*pi*i*h*(h-k)/n)
+	std::vector< std::vector<ComplexType> > pre(D), post(D);
+	bool first = true;
+	for (size_t d = 0; d < D; d++)
+	{
+		if (!transformed[d]) continue;
+
+		const long long n = (long long)a.get_size(d);
+		const long long h = n/2;
+		if (h == 0) continue;
+
+		pre[d].resize(n);
+		post[d].resize(n);
+		for (long long k = 0; k < n; k++)
+		{
+			pre[d][k] = unit_root<ComplexType>(-h*k, n, sign);
+			post[d][k] = unit_root<ComplexType>(h*(h - k), n, sign);
+		}
+
+		if (first)
+		{
+			const T scale = T(1.0/std::sqrt(double(elements_in_ft)));
+			for (long long k = 0; k < n; k++) post[d][k] *= scale;
+			first = false;
+		}
+	}
+
+	// threads split the largest batch dimension
+	int nt = num_threads;
+	if (nt <= 0) nt = (N > 128*128*8) ? this->get_max_num_threads() : 1;
+
+	size_t split = howmany_dims.size();
+	for (size_t i = 0; i < howmany_dims.size(); i++)
+	{
+		if (split == howmany_dims.size() || howmany_dims[i].n > howmany_dims[split].n) split = i;
+	}
+	if (split == howmany_dims.size()) nt = 1;
+	else if ((size_t)nt > (size_t)howmany_dims[split].n) nt = (int)howmany_dims[split].n;
+
+	const size_t count = (nt > 1) ? (size_t)howmany_dims[split].n : 1;
+	const size_t chunk = (count + nt - 1)/nt;
+	const size_t num_chunks = (count + chunk - 1)/chunk;
+
+	ComplexType* data = a.get_data_ptr();
+
+	// plans are fetched before the parallel loop, so failures throw on this thread
+	std::vector<typename fftw_types<T>::plan *> plans(num_chunks);
+	std::vector<ComplexType*> ptrs(num_chunks);
+	for (size_t c = 0; c < num_chunks; c++)
+	{
+		std::vector<fftw_iodim64> hd(howmany_dims);
+		ptrs[c] = data;
+		if (nt > 1)
+		{
+			const size_t first_index = c*chunk;
+			hd[split].n = (ptrdiff_t)std::min(chunk, count - first_index);
+			ptrs[c] = data + first_index*howmany_dims[split].is;
+		}
+		plans[c] = fftw_plan_guru_dft_cached_(dims, hd, ptrs[c], ptrs[c], sign, FFTW_ESTIMATE);
+	}
+
+	modulate(a, pre, nt);
+
+	long long c;
+#pragma omp parallel for private(c) shared(plans, ptrs) if (num_chunks > 1) num_threads(nt)
+	for (c = 0; c < (long long)num_chunks; c++)
+	{
+		fftw_execute_dft_(plans[c], ptrs[c], ptrs[c]);
+	}
+
+	modulate(a, post, nt);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_many(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, int num_threads)
+{
+	fft_many_int(a, dims_to_transform, true, num_threads);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_many(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, int num_threads)
+{
+	fft_many_int(a, dims_to_transform, false, num_threads);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_resize_int(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r, bool pad, bool forward)
+{
+	const size_t D = size.size();
+	if (D < 1 || D > 3 || a.get_number_of_dimensions() < D) throw std::runtime_error("hoNDFFT::fft_resize: only the first 1, 2 or 3 dimensions can be resized");
+	if (!offset.empty() && offset.size() != D) throw std::runtime_error("hoNDFFT::fft_resize: offset and size differ in length");
+	if (&a == &r) throw std::runtime_error("hoNDFFT::fft_resize: output array cannot be the input array");
+
+	std::vector<size_t> dims = *a.get_dimensions();
+	std::vector<size_t> rdims(dims);
+
+	// the smaller array is at start in the larger one, by default its centre as for Gadgetron::pad and Gadgetron::crop
+	std::vector<size_t> len(D), start(D);
+	for (size_t d = 0; d < D; d++)
+	{
+		if (pad ? (size[d] < dims[d]) : (size[d] > dims[d])) throw std::runtime_error("hoNDFFT::fft_resize: size mismatch");
+
+		rdims[d] = size[d];
+		len[d] = pad ? dims[d] : size[d];
+
+		const size_t larger = pad ? size[d] : dims[d];
+		start[d] = offset.empty() ? (larger/2 - len[d]/2) : offset[d];
+		if (start[d] + len[d] > larger) throw std::runtime_error("hoNDFFT::fft_resize: offset out of bounds");
+	}
+
+	if ( !r.dimensions_equal(&rdims) )
+	{
+		r.create(rdims);
+	}
+
+	if (r.get_number_of_elements() == 0) return;
+
+	std::vector<size_t> transform_dim(1);
+
+	if (pad)
+	{
+		memset(r.begin(), 0, r.get_number_of_bytes());
+
+		hoNDArrayView< ComplexType > window(r);
+		for (size_t d = 0; d < D; d++) window = window.range(d, start[d], len[d]);
+		window.copy_from(a);
+
+		// dimension d along the lines that are not zero, those of a in the dimensions after it
+		for (size_t d = 0; d < D; d++)
+		{
+			hoNDArrayView< ComplexType > lines(r);
+			for (size_t e = d+1; e < D; e++) lines = lines.range(e, start[e], len[e]);
+
+			transform_dim[0] = d;
+			fft_many_int(lines, transform_dim, forward, 0);
+		}
+
+		return;
+	}
+
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray< ComplexType > buf;
+	hoNDArrayScratch::instance().create(buf, dims);
+	memcpy(buf.begin(), a.begin(), a.get_number_of_bytes());
+
+	// dimension d along the lines that are kept, those of the centre in the dimensions before it
+	for (size_t d = 0; d < D; d++)
+	{
+		hoNDArrayView< ComplexType > lines(buf);
+		for (size_t e = 0; e < d; e++) lines = lines.range(e, start[e], len[e]);
+
+		transform_dim[0] = d;
+		fft_many_int(lines, transform_dim, forward, 0);
+	}
+
+	hoNDArrayView< ComplexType > window(buf);
+	for (size_t d = 0; d < D; d++) window = window.range(d, start[d], len[d]);
+	window.copy_to(r);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, std::vector<size_t>(), r, true, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, offset, r, true, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, std::vector<size_t>(), r, true, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, offset, r, true, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, std::vector<size_t>(), r, false, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, offset, r, false, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, std::vector<size_t>(), r, false, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r)
+{
+	fft_resize_int(a, size, offset, r, false, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft1c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 1, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft1c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 1, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft2c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 2, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft2c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 2, false);
+}
+
+template<typename T>
+void hoNDFFT<T>::fft3c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 3, true);
+}
+
+template<typename T>
+void hoNDFFT<T>::ifft3c(const hoNDArrayView< ComplexType >& a)
+{
+	fft_view(a, 3, false);
+}
+
 template<typename T>
 void hoNDFFT<T>::fft1(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray< ComplexType > res;
+	hoNDArrayScratch::instance().create(res, *a.get_dimensions());
+	memcpy(res.begin(), a.begin(), a.get_number_of_bytes());
+
 	fft1(res, a, forward);
 }
 
 template<typename T>
 void hoNDFFT<T>::fft2(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray< ComplexType > res;
+	hoNDArrayScratch::instance().create(res, *a.get_dimensions());
+	memcpy(res.begin(), a.begin(), a.get_number_of_bytes());
+
 	fft2(res, a, forward);
 }
 
 template<typename T>
 void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, bool forward)
 {
-	hoNDArray< ComplexType > res(a);
+	hoNDArrayScratchScope scratch_scope;
+
+	hoNDArray< ComplexType > res;
+	hoNDArrayScratch::instance().create(res, *a.get_dimensions());
+	memcpy(res.begin(), a.begin(), a.get_number_of_bytes());
+
 	fft3(res, a, forward);
 }
 
@@ -1020,66 +1939,31 @@ void hoNDFFT<T>::fft1(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 
 	int n;
 
+	int sign = forward ? FFTW_FORWARD : FFTW_BACKWARD;
 
 	typename fftw_types<T>::plan * p;
 
 	if( num_thr > 1 )
 	{
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			if ( forward )
-			{
-				p = fftw_plan_dft_1d_(n0,a.get_data_ptr(),r.get_data_ptr(),FFTW_FORWARD,FFTW_ESTIMATE);
-			}
-			else
-			{
-				p = fftw_plan_dft_1d_(n0,a.get_data_ptr(),r.get_data_ptr(),FFTW_BACKWARD,FFTW_ESTIMATE);
-			}
-		}
+		p = fftw_plan_many_dft_cached_(1, &n0, 1, a.get_data_ptr(), 1, n0, r.get_data_ptr(), 1, n0, sign, FFTW_ESTIMATE);
 
-#pragma omp parallel for private(n) shared(num, p, a, n0, r) num_threads(num_thr)
+#pragma omp parallel for private(n, p) shared(num, a, n0, r, sign) num_threads(num_thr)
 		for ( n=0; n<num; n++ )
 		{
+			p = fftw_plan_many_dft_cached_(1, &n0, 1, a.get_data_ptr()+n*n0, 1, n0, r.get_data_ptr()+n*n0, 1, n0, sign, FFTW_ESTIMATE);
 			fftw_execute_dft_(p, a.get_data_ptr()+n*n0,
 					r.get_data_ptr()+n*n0);
 		}
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
 	}
 	else
 	{
 		// multiple fft interface
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			if ( forward )
-			{
-				p = fftw_plan_many_dft_(1, &n0, num,
-						a.get_data_ptr(), NULL,
-						1, n0,
-						r.get_data_ptr(), NULL,
-						1, n0,
-						FFTW_FORWARD, FFTW_ESTIMATE);
-			}
-			else
-			{
-				p = fftw_plan_many_dft_(1, &n0, num,
-						a.get_data_ptr(),NULL,
-						1, n0,
-						r.get_data_ptr(), NULL,
-						1, n0,
-						FFTW_BACKWARD, FFTW_ESTIMATE);
-			}
-		}
+		p = fftw_plan_many_dft_cached_(1, &n0, num,
+				a.get_data_ptr(), 1, n0,
+				r.get_data_ptr(), 1, n0,
+				sign, FFTW_ESTIMATE);
 
-		fftw_execute_(p);
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
+		fftw_execute_dft_(p, a.get_data_ptr(), r.get_data_ptr());
 	}
 
 	r *= fftRatio;
@@ -1100,56 +1984,33 @@ void hoNDFFT<T>::fft2(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 
 	int n;
 
+	int sign = forward ? FFTW_FORWARD : FFTW_BACKWARD;
+	int dims[] = {n0, n1};
+	int dist = n0*n1;
 
 	typename fftw_types<T>::plan * p;
 
 	if ( num_thr > 1 )
 	{
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			p = fftw_plan_dft_2d_(n0, n1,
-					a.begin(),
-					r.begin(),
-					forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
-		}
+		p = fftw_plan_many_dft_cached_(2, dims, 1, a.begin(), 1, dist, r.begin(), 1, dist, sign, FFTW_ESTIMATE);
 
-#pragma omp parallel for private(n) shared(num, p, a, n0, n1, r) num_threads(num_thr)
+#pragma omp parallel for private(n, p) shared(num, a, dims, dist, r, sign) num_threads(num_thr)
 		for ( n=0; n<num; n++ )
 		{
-			fftw_execute_dft_(p, a.begin()+n*n0*n1,
-					r.begin()+n*n0*n1);
-		}
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
+			p = fftw_plan_many_dft_cached_(2, dims, 1, a.begin()+n*dist, 1, dist, r.begin()+n*dist, 1, dist, sign, FFTW_ESTIMATE);
+			fftw_execute_dft_(p, a.begin()+n*dist,
+					r.begin()+n*dist);
 		}
 	}
 	else
 	{
 		// multiple fft interface
+		p = fftw_plan_many_dft_cached_(2, dims, num,
+				a.begin(), 1, dist,
+				r.begin(), 1, dist,
+				sign, FFTW_ESTIMATE);
 
-		int n[] = {n0, n1};
-		int idist = n0*n1;
-		int odist = n0*n1;
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			p = fftw_plan_many_dft_(2, n, num,
-					a.begin(), NULL,
-					1, idist,
-					r.begin(), NULL,
-					1, odist,
-					forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
-
-		}
-
-		fftw_execute_(p);
-
-		{
-                        std::lock_guard<std::mutex> guard(mutex_);
-			fftw_destroy_plan_(p);
-		}
+		fftw_execute_dft_(p, a.begin(), r.begin());
 	}
 
 	r *= fftRatio;
@@ -1172,27 +2033,20 @@ void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 
 	long long n;
 
-	typename fftw_types<T>::plan * p;
+	int sign = forward ? FFTW_FORWARD : FFTW_BACKWARD;
+	int dims[] = {n0, n1, n2};
+	int dist = n0*n1*n2;
 
-	{
-                std::lock_guard<std::mutex> guard(mutex_);
-		p = fftw_plan_dft_3d_(n0, n1, n2,
-				a.get_data_ptr(),
-				r.get_data_ptr(),
-				forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+	typename fftw_types<T>::plan * p;
 
-	}
+	p = fftw_plan_many_dft_cached_(3, dims, 1, a.get_data_ptr(), 1, dist, r.get_data_ptr(), 1, dist, sign, FFTW_ESTIMATE);
 
-#pragma omp parallel for private(n) shared(num, p, a, n0, n1, n2, r) if (num_thr > 1) num_threads(num_thr)
+#pragma omp parallel for private(n, p) shared(num, a, dims, dist, r, sign) if (num_thr > 1) num_threads(num_thr)
 	for ( n=0; n<num; n++ )
 	{
-		fftw_execute_dft_(p, a.begin()+n*n0*n1*n2,
-				r.begin()+n*n0*n1*n2);
-	}
-
-	{
-                std::lock_guard<std::mutex> guard(mutex_);
-		fftw_destroy_plan_(p);
+		p = fftw_plan_many_dft_cached_(3, dims, 1, a.begin()+n*dist, 1, dist, r.begin()+n*dist, 1, dist, sign, FFTW_ESTIMATE);
+		fftw_execute_dft_(p, a.begin()+n*dist,
+				r.begin()+n*dist);
 	}
 
 	r *= fftRatio;
@@ -1202,19 +2056,21 @@ void hoNDFFT<T>::fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r,
 template<typename T>
 inline int hoNDFFT<T>::get_num_threads_fft1(size_t n0, size_t num)
 {
-	if ( num_of_max_threads_ == 1 ) return 1;
+	int max_threads = this->get_max_num_threads();
+
+	if ( max_threads == 1 ) return 1;
 
 	if ( n0*num>1024*128 )
 	{
-		return num_of_max_threads_;
+		return max_threads;
 	}
 	else if ( n0*num>512*128 )
 	{
-		return ( (num_of_max_threads_>8) ? 8 : num_of_max_threads_);
+		return ( (max_threads>8) ? 8 : max_threads);
 	}
 	else if ( n0*num>256*128 )
 	{
-		return ( (num_of_max_threads_>4) ? 4 : num_of_max_threads_);
+		return ( (max_threads>4) ? 4 : max_threads);
 	}
 	else if ( n0*num>128*128 )
 	{
@@ -1227,19 +2083,21 @@ inline int hoNDFFT<T>::get_num_threads_fft1(size_t n0, size_t num)
 template<typename T>
 inline int hoNDFFT<T>::get_num_threads_fft2(size_t n0, size_t n1, size_t num)
 {
-	if ( num_of_max_threads_ == 1 ) return 1;
+	int max_threads = this->get_max_num_threads();
+
+	if ( max_threads == 1 ) return 1;
 
 	if ( n0*n1*num>128*128*64 )
 	{
-		return num_of_max_threads_;
+		return max_threads;
 	}
 	else if ( n0*n1*num>128*128*32 )
 	{
-		return ( (num_of_max_threads_>8) ? 8 : num_of_max_threads_);
+		return ( (max_threads>8) ? 8 : max_threads);
 	}
 	else if ( n0*n1*num>128*128*16 )
 	{
-		return ( (num_of_max_threads_>4) ? 4 : num_of_max_threads_);
+		return ( (max_threads>4) ? 4 : max_threads);
 	}
 	else if ( n0*n1*num>128*128*8 )
 	{
@@ -1252,11 +2110,13 @@ inline int hoNDFFT<T>::get_num_threads_fft2(size_t n0, size_t n1, size_t num)
 template<typename T>
 inline int hoNDFFT<T>::get_num_threads_fft3(size_t n0, size_t n1, size_t n2, size_t num)
 {
-	if ( num_of_max_threads_ == 1 ) return 1;
+	int max_threads = this->get_max_num_threads();
+
+	if ( max_threads == 1 ) return 1;
 
-	if ( num >= num_of_max_threads_ )
+	if ( num >= max_threads )
 	{
-		return num_of_max_threads_;
+		return max_threads;
 	}
 
 	return 1;
@@ -1399,10 +2259,66 @@ template<> typename fftw_types<double>::plan * hoNDFFT<double>::fftw_plan_many_d
 	return fftw_plan_many_dft(rank,n,howmany,(fftw_complex*)in,inembed,istride,idist,(fftw_complex*)out,onembed,ostride,odist,sign,flags);
 }
 
+template<> typename fftw_types<float>::plan * hoNDFFT<float>::fftw_plan_guru64_dft_(int rank, const fftw_iodim64 *dims,
+		int howmany_rank, const fftw_iodim64 *howmany_dims,
+		ComplexType *in, ComplexType *out, int sign, unsigned flags){
+	return fftwf_plan_guru64_dft(rank,dims,howmany_rank,howmany_dims,(fftwf_complex*)in,(fftwf_complex*)out,sign,flags);
+}
+
+template<> typename fftw_types<double>::plan * hoNDFFT<double>::fftw_plan_guru64_dft_(int rank, const fftw_iodim64 *dims,
+		int howmany_rank, const fftw_iodim64 *howmany_dims,
+		ComplexType *in, ComplexType *out, int sign, unsigned flags){
+	return fftw_plan_guru64_dft(rank,dims,howmany_rank,howmany_dims,(fftw_complex*)in,(fftw_complex*)out,sign,flags);
+}
+
+template<> typename fftw_types<float>::plan * hoNDFFT<float>::fftw_plan_many_dft_r2c_(int rank, const int *n, int howmany,
+		float *in, int idist, ComplexType *out, int odist, unsigned flags){
+	return fftwf_plan_many_dft_r2c(rank,n,howmany,in,NULL,1,idist,(fftwf_complex*)out,NULL,1,odist,flags);
+}
+
+template<> typename fftw_types<double>::plan * hoNDFFT<double>::fftw_plan_many_dft_r2c_(int rank, const int *n, int howmany,
+		double *in, int idist, ComplexType *out, int odist, unsigned flags){
+	return fftw_plan_many_dft_r2c(rank,n,howmany,in,NULL,1,idist,(fftw_complex*)out,NULL,1,odist,flags);
+}
+
+template<> typename fftw_types<float>::plan * hoNDFFT<float>::fftw_plan_many_dft_c2r_(int rank, const int *n, int howmany,
+		ComplexType *in, int idist, float *out, int odist, unsigned flags){
+	return fftwf_plan_many_dft_c2r(rank,n,howmany,(fftwf_complex*)in,NULL,1,idist,out,NULL,1,odist,flags);
+}
+
+template<> typename fftw_types<double>::plan * hoNDFFT<double>::fftw_plan_many_dft_c2r_(int rank, const int *n, int howmany,
+		ComplexType *in, int idist, double *out, int odist, unsigned flags){
+	return fftw_plan_many_dft_c2r(rank,n,howmany,(fftw_complex*)in,NULL,1,idist,out,NULL,1,odist,flags);
+}
+
+template<> void hoNDFFT<float>::fftw_execute_dft_r2c_( fftwf_plan_s * ptr, float* in, ComplexType* out){
+	fftwf_execute_dft_r2c(ptr, in, (fftwf_complex*)out);
+}
+
+template<> void hoNDFFT<double>::fftw_execute_dft_r2c_( fftw_plan_s * ptr, double* in, ComplexType* out){
+	fftw_execute_dft_r2c(ptr, in, (fftw_complex*)out);
+}
+
+template<> void hoNDFFT<float>::fftw_execute_dft_c2r_( fftwf_plan_s * ptr, ComplexType* in, float* out){
+	fftwf_execute_dft_c2r(ptr, (fftwf_complex*)in, out);
+}
+
+template<> void hoNDFFT<double>::fftw_execute_dft_c2r_( fftw_plan_s * ptr, ComplexType* in, double* out){
+	fftw_execute_dft_c2r(ptr, (fftw_complex*)in, out);
+}
+
 template<> void hoNDFFT<float>::fftw_destroy_plan_( typename fftw_types<float>::plan * p ){
 	fftwf_destroy_plan(p);
 }
 
+template<> int hoNDFFT<float>::fftw_alignment_of_( ComplexType* p ){
+	return fftwf_alignment_of((float*)p);
+}
+
+template<> int hoNDFFT<double>::fftw_alignment_of_( ComplexType* p ){
+	return fftw_alignment_of((double*)p);
+}
+
 template<> void hoNDFFT<double>::fftw_destroy_plan_( typename fftw_types<double>::plan * p ){
 	fftw_destroy_plan(p);
 }
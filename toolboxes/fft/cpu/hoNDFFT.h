@@ -6,12 +6,17 @@
 #define hoNDFFT_H
 
 #include "hoNDArray.h"
+#include "hoNDArrayView.h"
 #include "cpufft_export.h"
+#include "GadgetronThreadBudget.h"
 
 #include <mutex>
+#include <map>
+#include <tuple>
 #include <iostream>
 #include <fftw3.h>
 #include <complex>
+#include <string>
 
 #ifdef USE_OMP
     #include "omp.h"
@@ -37,6 +42,10 @@ template<> struct fftw_types<double>{
     This class is a singleton because the planning and memory allocation routines of FFTW are NOT threadsafe.
     The class' template type is a REAL, ie. float or double.
 
+    Plans are made once per transform geometry and kept in a plan cache. Every thread keeps its own copy of
+    the cache entries it has used, so repeated transforms of the same size from any number of threads find
+    their plan without taking the planner lock and execute it on their own arrays with fftw_execute_dft.
+
 		Note that scaling is 1/sqrt(N) fir both FFT and IFFT, where N is the number of elements along the FFT dimensions
     Access using e.g.
     FFT<float>::instance()
@@ -129,6 +138,7 @@ template<> struct fftw_types<double>{
         void ifft1(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r);
 
         // centered 1D fft
+        // for even sizes the shifts are applied as a sign modulation, without extra passes over the data
         void fft1c(hoNDArray< ComplexType >& a);
         void ifft1c(hoNDArray< ComplexType >& a);
 
@@ -174,6 +184,77 @@ template<> struct fftw_types<double>{
         void fft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf);
         void ifft3c(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, hoNDArray< ComplexType >& buf);
 
+        // centered 1D, 2D and 3D fft of a strided view, in-place
+        // views whose leading dimensions are packed are transformed block by block, others through a scratch copy
+        void fft1c(const hoNDArrayView< ComplexType >& a);
+        void ifft1c(const hoNDArrayView< ComplexType >& a);
+
+        void fft2c(const hoNDArrayView< ComplexType >& a);
+        void ifft2c(const hoNDArrayView< ComplexType >& a);
+
+        void fft3c(const hoNDArrayView< ComplexType >& a);
+        void ifft3c(const hoNDArrayView< ComplexType >& a);
+
+        /**
+           Centered fft of the dimensions dims_to_transform of a strided view, in-place and batched over all its
+           other dimensions with one FFTW plan, e.g. dims_to_transform = {0, 1} transforms every image of a
+           [RO E1 CHA N S] array in one call. Any number of dimensions in any order can be transformed; the
+           result equals fftshift(fft(ifftshift(a))) along each of them, scaled like fft2c.
+           num_threads threads split the largest of the other dimensions, 0 picks the number like fft2c does.
+        */
+        void fft_many(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, int num_threads = 0);
+        void ifft_many(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, int num_threads = 0);
+
+        /**
+           Real to complex fft of the first D (1, 2 or 3) dimensions of x, batched over the others. Only the non-redundant
+           half of the hermitian spectrum of real data is computed, r is [n0/2+1 n1 ...] for x of [n0 n1 ...], at about half
+           the work and memory of a complex fft. ifft_c2r is the inverse, n0 is the size of the real dimension 0 since
+           n0/2+1 is the same for 2m and 2m+1. Both are scaled by 1/sqrt(N) like fft2.
+           With centered = true x is centered like for fft2c, and so is r in all transformed dimensions but 0, which holds
+           the frequencies 0 .. n0/2.
+        */
+        void fft_r2c(const hoNDArray<T>& x, hoNDArray< ComplexType >& r, size_t D, bool centered = false);
+        void ifft_c2r(const hoNDArray< ComplexType >& r, hoNDArray<T>& x, size_t D, size_t n0, bool centered = false);
+
+        /**
+           Pruned centered fft of the first size.size() (1, 2 or 3) dimensions, to resize an image in the other domain.
+           fft_pad and ifft_pad transform a zero-padded to size, r = fftNc(pad(a)) with the centering of Gadgetron::pad;
+           every dimension is only transformed along the lines holding data of a, so the 2x zero-fill interpolation of
+           an image skips half of the transforms of the first dimension. fft_crop and ifft_crop keep the centre of size
+           of the transform, r = crop(fftNc(a)) with the centering of Gadgetron::crop; every dimension is only transformed
+           along the lines of the centre of the dimensions transformed before it.
+           Both are scaled by 1/sqrt(N) of the larger of the two sizes, like fft2c. r must not be a.
+           The versions with offset place a at, or take r from, offset in the larger array instead of its centre,
+           e.g. for the sampled region of a partial Fourier k-space.
+        */
+        void fft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r);
+        void ifft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r);
+
+        void fft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r);
+        void ifft_pad(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r);
+
+        void fft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r);
+        void ifft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, hoNDArray< ComplexType >& r);
+
+        void fft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r);
+        void ifft_crop(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r);
+
+        /**
+           FFTW wisdom, the tuned plans of a site kept in a file (see gadgetron_fftw_wisdom). After use_wisdom(FFTW_MEASURE)
+           a transform takes the tuned plan when the wisdom has one for its problem and an FFTW_ESTIMATE plan otherwise,
+           so it never measures on, and overwrites, the data it transforms. With learn_wisdom every new plan is measured
+           with the given rigor instead; that overwrites the data being transformed and is meant for the tuning tool only.
+           Call these before the first transform, plans already in the cache are kept.
+        */
+        bool load_wisdom(const std::string& filename);
+        bool save_wisdom(const std::string& filename);
+
+        void use_wisdom(unsigned rigor = FFTW_MEASURE);
+        void learn_wisdom(unsigned rigor = FFTW_MEASURE);
+
+        /// Wisdom file of this precision, <gadgetron_home>/share/gadgetron/fftw/wisdom_float.txt or wisdom_double.txt
+        static std::string wisdom_filename(const std::string& gadgetron_home);
+
     protected:
 
         //We are making these protected since this class is a singleton
@@ -182,13 +263,67 @@ template<> struct fftw_types<double>{
 
 
 #ifdef USE_OMP
-            num_of_max_threads_ = omp_get_num_procs();
+            num_of_max_threads_ = GadgetronThreadBudget::instance().total();
 #else
             num_of_max_threads_ = 1;
 #endif // USE_OMP
+
+            wisdom_rigor_ = FFTW_ESTIMATE;
+            wisdom_learn_ = false;
+        }
+
+        virtual ~hoNDFFT()
+        {
+            for (typename PlanCache::iterator it = plan_cache_.begin(); it != plan_cache_.end(); ++it) fftw_destroy_plan_(it->second);
+            fftw_cleanup_();
         }
 
-        virtual ~hoNDFFT() { fftw_cleanup_(); }
+        /// Geometry of a cached plan, and what fftw requires to reuse a plan on other arrays
+        struct PlanKey
+        {
+            // sizes and strides, in the terms of the planner function that makes the plan
+            std::vector<long long> geometry;
+            int sign;
+            unsigned flags;
+            bool in_place;
+            int in_alignment, out_alignment;
+
+            bool operator<(const PlanKey& k) const
+            {
+                return std::tie(geometry, sign, flags, in_place, in_alignment, out_alignment)
+                    < std::tie(k.geometry, k.sign, k.flags, k.in_place, k.in_alignment, k.out_alignment);
+            }
+        };
+
+        typedef std::map<PlanKey, typename fftw_types<T>::plan*> PlanCache;
+
+        /// Plan for key from the cache, make() creates it under mutex_ on the first request
+        template <typename F> typename fftw_types<T>::plan * cached_plan_(const PlanKey& key, F make);
+
+        /// make(flags) with the flags the wisdom settings give for a plan requested with flags, called under mutex_
+        template <typename F> typename fftw_types<T>::plan * plan_with_wisdom_(unsigned flags, F make);
+
+        /**
+           Plan for howmany transforms of rank 1 to 3 from in to out, made on first use and then taken from the cache.
+           The plan executes with fftw_execute_dft_ on any pair of arrays with the alignment and in-placeness of in and out.
+           Plans with FFTW_MEASURE overwrite in and out while they are made.
+        */
+        typename fftw_types<T>::plan * fftw_plan_many_dft_cached_(int rank, const int *n, int howmany,
+                                          ComplexType *in, int istride, int idist,
+                                          ComplexType *out, int ostride, int odist,
+                                          int sign, unsigned flags);
+
+        /// Guru plan of the transform dims batched over howmany_dims (strides in elements), cached like fftw_plan_many_dft_cached_
+        typename fftw_types<T>::plan * fftw_plan_guru_dft_cached_(const std::vector<fftw_iodim64>& dims,
+                                          const std::vector<fftw_iodim64>& howmany_dims,
+                                          ComplexType *in, ComplexType *out, int sign, unsigned flags);
+
+        /// Cached plan for howmany r2c (or c2r) transforms of n from real to cplx (or back), packed one after the other
+        typename fftw_types<T>::plan * fftw_plan_real_cached_(bool r2c, int rank, const int *n, int howmany,
+                                          T *real, ComplexType *cplx, unsigned flags);
+
+        // r2c from x to r, or c2r from r to x, of the first D dimensions of dims, scaled by 1/sqrt(N); c2r overwrites r
+        void fft_real_int(T* x, ComplexType* r, const std::vector<size_t>& dims, size_t D, bool r2c);
 
         void fft_int(hoNDArray< ComplexType >* input, size_t dim_to_transform, int sign);
 
@@ -215,13 +350,33 @@ template<> struct fftw_types<double>{
                                           int sign, unsigned flags);
         typename fftw_types<T>::plan * fftw_plan_dft_(int rank, ComplexType*, ComplexType*, int, unsigned);
 
+        typename fftw_types<T>::plan * fftw_plan_guru64_dft_(int rank, const fftw_iodim64 *dims,
+                                          int howmany_rank, const fftw_iodim64 *howmany_dims,
+                                          ComplexType *in, ComplexType *out, int sign, unsigned flags);
+
+        typename fftw_types<T>::plan * fftw_plan_many_dft_r2c_(int rank, const int *n, int howmany,
+                                          T *in, int idist, ComplexType *out, int odist, unsigned flags);
+        typename fftw_types<T>::plan * fftw_plan_many_dft_c2r_(int rank, const int *n, int howmany,
+                                          ComplexType *in, int idist, T *out, int odist, unsigned flags);
+
+        void  fftw_execute_dft_r2c_(typename fftw_types<T>::plan * p, T*, ComplexType*);
+        void  fftw_execute_dft_c2r_(typename fftw_types<T>::plan * p, ComplexType*, T*);
+
         void  fftw_destroy_plan_(typename fftw_types<T>::plan *);
+        int   fftw_alignment_of_(ComplexType*);
 
 
 
         static hoNDFFT<T>* instance_;
         std::mutex mutex_;
 
+        // all plans made so far, guarded by mutex_
+        PlanCache plan_cache_;
+
+        // rigor of the plans taken from (or, when learning, added to) the wisdom; FFTW_ESTIMATE if it is not used
+        unsigned wisdom_rigor_;
+        bool wisdom_learn_;
+
         int num_of_max_threads_;
 
         // the fft and ifft shift pivot for a certain length
@@ -265,6 +420,30 @@ template<> struct fftw_types<double>{
         void fft2(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward);
         void fft3(hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, bool forward);
 
+        // centered fft of the first D dimensions, used by fft1c, fft2c and fft3c when all of them have even size;
+        // the shifts are then a checkerboard sign, applied while copying a to r and folded into the scaling
+        bool even_sizes(const hoNDArray< ComplexType >& a, size_t D);
+        void fftNc_even(const hoNDArray< ComplexType >& a, hoNDArray< ComplexType >& r, size_t D, bool forward);
+
+        // centered fft of the first D dimensions of a view
+        void fft_view(const hoNDArrayView< ComplexType >& a, size_t D, bool forward);
+
+        // batched centered fft of any dimensions of a view
+        void fft_many_int(const hoNDArrayView< ComplexType >& a, const std::vector<size_t>& dims_to_transform, bool forward, int num_threads);
+
+        // fft_pad, ifft_pad (pad true) and fft_crop, ifft_crop (pad false), centered for an empty offset
+        void fft_resize_int(const hoNDArray< ComplexType >& a, const std::vector<size_t>& size, const std::vector<size_t>& offset, hoNDArray< ComplexType >& r, bool pad, bool forward);
+
+        // multiplies every element of a by the product of w[d][i_d] over the dimensions d with a non-empty w[d]
+        void modulate(const hoNDArrayView< ComplexType >& a, const std::vector< std::vector<ComplexType> >& w, int num_threads);
+
+        // threads available to the calling gadget, at most num_of_max_threads_
+        int get_max_num_threads() const
+        {
+            int n = GadgetronThreadBudget::num_threads();
+            return (n < num_of_max_threads_) ? n : num_of_max_threads_;
+        }
+
         // get the number of threads used for fft
         int get_num_threads_fft1(size_t n0, size_t num);
         int get_num_threads_fft2(size_t n0, size_t n1, size_t num);
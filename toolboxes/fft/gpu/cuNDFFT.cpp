@@ -1,4 +1,5 @@
 #include "cuNDFFT.h"
+#include "cuNDFFTPlanCache.h"
 #include "vector_td.h"
 #include "cuNDArray.h"
 #include "cuNDArray_utils.h"
@@ -7,6 +8,7 @@
 #include <cufft.h>
 #include <cuComplex.h>
 #include <sstream>
+#include <algorithm>
 
 namespace Gadgetron{
 
@@ -31,6 +33,37 @@ template<> cufftResult_t cuNDA_FFT_execute<float>( cufftHandle plan, cuNDArray<f
 template<> cufftResult_t cuNDA_FFT_execute<double>( cufftHandle plan, cuNDArray<double_complext> *in_out, int direction ){
 	return cufftExecZ2Z(plan, (cuDoubleComplex*)in_out->get_data_ptr(), (cuDoubleComplex*)in_out->get_data_ptr(), direction); }
 
+template<class T> cufftResult_t cuNDA_FFT_execute( cufftHandle plan, complext<T> *in_out, int direction );
+
+template<> cufftResult_t cuNDA_FFT_execute<float>( cufftHandle plan, float_complext *in_out, int direction ){
+	return cufftExecC2C(plan, (cuFloatComplex*)in_out, (cuFloatComplex*)in_out, direction); }
+
+template<> cufftResult_t cuNDA_FFT_execute<double>( cufftHandle plan, double_complext *in_out, int direction ){
+	return cufftExecZ2Z(plan, (cuDoubleComplex*)in_out, (cuDoubleComplex*)in_out, direction); }
+
+template<class T> cufftType_t get_r2c_type();
+template<> cufftType_t get_r2c_type<float>() { return CUFFT_R2C; }
+template<> cufftType_t get_r2c_type<double>() { return CUFFT_D2Z; }
+
+template<class T> cufftType_t get_c2r_type();
+template<> cufftType_t get_c2r_type<float>() { return CUFFT_C2R; }
+template<> cufftType_t get_c2r_type<double>() { return CUFFT_Z2D; }
+
+template<class T> cufftResult_t cuNDA_FFT_execute_r2c( cufftHandle plan, T *in, complext<T> *out );
+template<class T> cufftResult_t cuNDA_FFT_execute_c2r( cufftHandle plan, complext<T> *in, T *out );
+
+template<> cufftResult_t cuNDA_FFT_execute_r2c<float>( cufftHandle plan, float *in, float_complext *out ){
+	return cufftExecR2C(plan, (cufftReal*)in, (cuFloatComplex*)out); }
+
+template<> cufftResult_t cuNDA_FFT_execute_r2c<double>( cufftHandle plan, double *in, double_complext *out ){
+	return cufftExecD2Z(plan, (cufftDoubleReal*)in, (cuDoubleComplex*)out); }
+
+template<> cufftResult_t cuNDA_FFT_execute_c2r<float>( cufftHandle plan, float_complext *in, float *out ){
+	return cufftExecC2R(plan, (cuFloatComplex*)in, (cufftReal*)out); }
+
+template<> cufftResult_t cuNDA_FFT_execute_c2r<double>( cufftHandle plan, double_complext *in, double *out ){
+	return cufftExecZ2D(plan, (cuDoubleComplex*)in, (cufftDoubleReal*)out); }
+
 template<class T> void
 cuNDFFT<T>::fft_int( cuNDArray< complext<T> > *input, std::vector<size_t> *dims_to_transform, int direction, bool do_scale )
 {
@@ -89,6 +122,53 @@ cuNDFFT<T>::fft_int( cuNDArray< complext<T> > *input, std::vector<size_t> *dims_
 		}
 	}
 
+	// A contiguous block of dimensions [lo, lo+ndim) is transformed in place with strides:
+	// the dimensions below lo are the batch of one cufftPlanMany (istride = distance of the
+	// block elements, idist = 1), executed once per index of the dimensions above the block.
+	// This saves the two permutes, which cost more than the transform itself.
+	size_t lo = array_ndim;
+	size_t hi = 0;
+	for (size_t i = 0; i < dims_to_transform->size(); i++) {
+		lo = std::min(lo, (*dims_to_transform)[i]);
+		hi = std::max(hi, (*dims_to_transform)[i]);
+	}
+
+	if (must_permute && hi - lo + 1 == ndim) {
+		size_t inner = 1;
+		for (size_t i = 0; i < lo; i++) inner *= (*array_dims)[i];
+		size_t elements_in_ft = 1;
+		std::vector<int> int_dims;
+		for (size_t i = hi+1; i-- > lo; ) {
+			int_dims.push_back((int)(*array_dims)[i]);
+			elements_in_ft *= (*array_dims)[i];
+		}
+		size_t outer = input->get_number_of_elements() / (inner*elements_in_ft);
+
+		if (direction == CUFFT_INVERSE)
+			for (size_t i =0; i < dims_to_transform->size(); i++)
+				timeswitch(input,dims_to_transform->at(i));
+
+		{
+			cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+				cuNDFFTPlanCache::key(get_transform_type<T>(), int_dims, true, (int)inner, 1, (int)inner, 1, (int)inner));
+
+			for (size_t o = 0; o < outer; o++) {
+				if( cuNDA_FFT_execute<T>( plan.handle(), input->get_data_ptr() + o*inner*elements_in_ft, direction ) != CUFFT_SUCCESS ) {
+					throw std::runtime_error("cuNDFFT FFT execute failed");;
+				}
+			}
+		}
+
+		if (direction == CUFFT_FORWARD)
+			for (size_t i =0; i < dims_to_transform->size(); i++)
+				timeswitch(input,dims_to_transform->at(i));
+
+		if (do_scale) {
+			*input *= 1/std::sqrt(T(elements_in_ft));
+		}
+		return;
+	}
+
 	reverse_dim_order = std::vector<size_t>(array_ndim,0);
 	for (size_t i = 0; i < array_ndim; i++) {
 		reverse_dim_order[new_dim_order[i]] = i;
@@ -101,22 +181,10 @@ cuNDFFT<T>::fft_int( cuNDArray< complext<T> > *input, std::vector<size_t> *dims_
 		elements_in_ft *= dims[i];
 	batches = input->get_number_of_elements() / elements_in_ft;
 
-	cufftHandle plan;
-	cufftResult ftres;
-
 	std::vector<int> int_dims;
 	for( unsigned int i=0; i<dims.size(); i++ )
 		int_dims.push_back((int)dims[i]);
 
-	ftres = cufftPlanMany(&plan,ndim,&int_dims[0], &int_dims[0], 1, elements_in_ft, &int_dims[0], 1, elements_in_ft, get_transform_type<T>(), batches);
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan failed: " << ftres;
-		throw std::runtime_error(ss.str());;
-	}
-
-
-
 	if (must_permute)
 		*input = *permute(input,&new_dim_order);
 
@@ -124,16 +192,15 @@ cuNDFFT<T>::fft_int( cuNDArray< complext<T> > *input, std::vector<size_t> *dims_
 		for (size_t i =0; i < dims_to_transform->size(); i++)
 			timeswitch(input,dims_to_transform->at(i));
 
-	if( cuNDA_FFT_execute<T>( plan, input, direction ) != CUFFT_SUCCESS ) {
-		throw std::runtime_error("cuNDFFT FFT execute failed");;
-	}
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_transform_type<T>(), int_dims, true, 1, (int)elements_in_ft, 1, (int)elements_in_ft, (int)batches));
 
-	ftres = cufftDestroy( plan );
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan destroy failed: " << ftres;
-		throw std::runtime_error(ss.str());;
+		if( cuNDA_FFT_execute<T>( plan.handle(), input, direction ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
 	}
+
 	if (direction == CUFFT_FORWARD)
 		for (size_t i =0; i < dims_to_transform->size(); i++)
 			timeswitch(input,dims_to_transform->at(i));
@@ -148,30 +215,19 @@ cuNDFFT<T>::fft_int( cuNDArray< complext<T> > *input, std::vector<size_t> *dims_
 
 template<class T> void
 cuNDFFT<T>::fft1_int(cuNDArray<complext<T> > *input, int direction, bool do_scale) {
-	cufftHandle plan;
-	cufftResult ftres;
-
 	std::vector<int> int_dims {int(input->get_size(0))};
 	int elements_in_ft = input->get_size(0);
 	int batches = input->get_number_of_elements()/elements_in_ft;
-	ftres = cufftPlanMany(&plan,1,&int_dims[0], &int_dims[0], 1, elements_in_ft, &int_dims[0], 1, elements_in_ft, get_transform_type<T>(), batches);
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan failed: " << ftres;
-		throw std::runtime_error(ss.str());;
-	}
 	if (direction == CUFFT_INVERSE)
 		timeswitch1D(input);
 
-	if( cuNDA_FFT_execute<T>( plan, input, direction ) != CUFFT_SUCCESS ) {
-		throw std::runtime_error("cuNDFFT FFT execute failed");;
-	}
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_transform_type<T>(), int_dims, true, 1, elements_in_ft, 1, elements_in_ft, batches));
 
-	ftres = cufftDestroy( plan );
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan destroy failed: " << ftres;
-		throw std::runtime_error(ss.str());;
+		if( cuNDA_FFT_execute<T>( plan.handle(), input, direction ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
 	}
 
 	if (direction == CUFFT_FORWARD)
@@ -184,30 +240,19 @@ cuNDFFT<T>::fft1_int(cuNDArray<complext<T> > *input, int direction, bool do_scal
 
 template<class T> void
 cuNDFFT<T>::fft2_int(cuNDArray<complext<T> > *input, int direction, bool do_scale) {
-	cufftHandle plan;
-	cufftResult ftres;
-
 	std::vector<int> int_dims {int(input->get_size(0)),int(input->get_size(1))};
 	int elements_in_ft = input->get_size(0)*input->get_size(1);
 	int batches = input->get_number_of_elements()/elements_in_ft;
-	ftres = cufftPlanMany(&plan,2,&int_dims[0], &int_dims[0], 1, elements_in_ft, &int_dims[0], 1, elements_in_ft, get_transform_type<T>(), batches);
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan failed: " << ftres;
-		throw std::runtime_error(ss.str());;
-	}
 	if (direction == CUFFT_INVERSE)
 		timeswitch2D(input);
 
-	if( cuNDA_FFT_execute<T>( plan, input, direction ) != CUFFT_SUCCESS ) {
-		throw std::runtime_error("cuNDFFT FFT execute failed");;
-	}
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_transform_type<T>(), int_dims, true, 1, elements_in_ft, 1, elements_in_ft, batches));
 
-	ftres = cufftDestroy( plan );
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan destroy failed: " << ftres;
-		throw std::runtime_error(ss.str());;
+		if( cuNDA_FFT_execute<T>( plan.handle(), input, direction ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
 	}
 
 	if (direction == CUFFT_FORWARD)
@@ -218,30 +263,19 @@ cuNDFFT<T>::fft2_int(cuNDArray<complext<T> > *input, int direction, bool do_scal
 }
 template<class T> void
 cuNDFFT<T>::fft3_int(cuNDArray<complext<T> > *input, int direction, bool do_scale) {
-	cufftHandle plan;
-	cufftResult ftres;
-
 	std::vector<int> int_dims {int(input->get_size(0)),int(input->get_size(1)),int(input->get_size(2))};
 	int elements_in_ft = input->get_size(0)*input->get_size(1)*input->get_size(2);
 	int batches = input->get_number_of_elements()/elements_in_ft;
-	ftres = cufftPlanMany(&plan,3,&int_dims[0], &int_dims[0], 1, elements_in_ft, &int_dims[0], 1, elements_in_ft, get_transform_type<T>(), batches);
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan failed: " << ftres;
-		throw std::runtime_error(ss.str());;
-	}
 	if (direction == CUFFT_INVERSE)
 		timeswitch3D(input);
 
-	if( cuNDA_FFT_execute<T>( plan, input, direction ) != CUFFT_SUCCESS ) {
-		throw std::runtime_error("cuNDFFT FFT execute failed");;
-	}
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_transform_type<T>(), int_dims, true, 1, elements_in_ft, 1, elements_in_ft, batches));
 
-	ftres = cufftDestroy( plan );
-	if (ftres != CUFFT_SUCCESS) {
-		std::stringstream ss;
-		ss << "cuNDFFT FFT plan destroy failed: " << ftres;
-		throw std::runtime_error(ss.str());;
+		if( cuNDA_FFT_execute<T>( plan.handle(), input, direction ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
 	}
 
 	if (direction == CUFFT_FORWARD)
@@ -324,6 +358,85 @@ cuNDFFT<T>::ifft3( cuNDArray< complext<T> > *input, bool do_scale )
 {
 	fft3_int(input, CUFFT_INVERSE, do_scale);
 }
+template<class T> void
+cuNDFFT<T>::fft_r2c( cuNDArray<T> *in, cuNDArray<complext<T> > *out, unsigned int D, bool do_scale )
+{
+	if (D < 1 || D > 3 || in->get_number_of_dimensions() < D)
+		throw std::runtime_error("cuNDFFT::fft_r2c: only the first 1, 2 or 3 dimensions can be transformed");
+
+	std::vector<size_t> dims = *in->get_dimensions();
+	std::vector<size_t> out_dims(dims);
+	out_dims[0] = dims[0]/2+1;
+	if (!out->dimensions_equal(&out_dims))
+		out->create(&out_dims);
+
+	std::vector<int> int_dims;
+	size_t elements_in_ft = 1;
+	for (size_t i = D; i-- > 0; ) {
+		int_dims.push_back((int)dims[i]);
+		elements_in_ft *= dims[i];
+	}
+	size_t elements_out = elements_in_ft/dims[0]*out_dims[0];
+	int batches = (int)(in->get_number_of_elements()/elements_in_ft);
+
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_r2c_type<T>(), int_dims, false, 1, (int)elements_in_ft, 1, (int)elements_out, batches));
+
+		if( cuNDA_FFT_execute_r2c<T>( plan.handle(), in->get_data_ptr(), out->get_data_ptr() ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
+	}
+
+	for (unsigned int i = 0; i < D; i++)
+		timeswitch(out,i);
+
+	if (do_scale) {
+		*out *= 1/std::sqrt(T(elements_in_ft));
+	}
+}
+
+template<class T> void
+cuNDFFT<T>::ifft_c2r( cuNDArray<complext<T> > *in, cuNDArray<T> *out, unsigned int D, size_t n0, bool do_scale )
+{
+	if (D < 1 || D > 3 || in->get_number_of_dimensions() < D)
+		throw std::runtime_error("cuNDFFT::ifft_c2r: only the first 1, 2 or 3 dimensions can be transformed");
+	if (n0/2+1 != in->get_size(0))
+		throw std::runtime_error("cuNDFFT::ifft_c2r: n0 does not match the size of the first dimension");
+
+	std::vector<size_t> dims = *in->get_dimensions();
+	dims[0] = n0;
+	if (!out->dimensions_equal(&dims))
+		out->create(&dims);
+
+	std::vector<int> int_dims;
+	size_t elements_in_ft = 1;
+	for (size_t i = D; i-- > 0; ) {
+		int_dims.push_back((int)dims[i]);
+		elements_in_ft *= dims[i];
+	}
+	size_t elements_in = elements_in_ft/n0*in->get_size(0);
+	int batches = (int)(out->get_number_of_elements()/elements_in_ft);
+
+	// c2r overwrites its input
+	cuNDArray<complext<T> > tmp(*in);
+	for (unsigned int i = 0; i < D; i++)
+		timeswitch(&tmp,i);
+
+	{
+		cuNDFFTPlan plan = cuNDFFTPlanCache::instance()->plan(
+			cuNDFFTPlanCache::key(get_c2r_type<T>(), int_dims, false, 1, (int)elements_in, 1, (int)elements_in_ft, batches));
+
+		if( cuNDA_FFT_execute_c2r<T>( plan.handle(), tmp.get_data_ptr(), out->get_data_ptr() ) != CUFFT_SUCCESS ) {
+			throw std::runtime_error("cuNDFFT FFT execute failed");;
+		}
+	}
+
+	if (do_scale) {
+		*out *= 1/std::sqrt(T(elements_in_ft));
+	}
+}
+
 // Instantiation
 template class EXPORTGPUFFT cuNDFFT<float>;
 template class EXPORTGPUFFT cuNDFFT<double>;
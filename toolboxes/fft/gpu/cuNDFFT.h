@@ -41,6 +41,14 @@ namespace Gadgetron{
     void ifft2(cuNDArray<complext<T> > *image, bool do_scale = true);
     void ifft3(cuNDArray<complext<T> > *image, bool do_scale = true);
 
+    /**
+       Real to complex fft of the first D (1, 2 or 3) dimensions of in, batched over the others. out is the
+       non-redundant half [n0/2+1 n1 ...] of the spectrum, the first n0/2+1 entries along dimension 0 of fft(in),
+       with the same timeswitch. ifft_c2r is the inverse, n0 is the size of the real dimension 0.
+    */
+    void fft_r2c ( cuNDArray<T> *in, cuNDArray<complext<T> > *out, unsigned int D, bool do_scale = true );
+    void ifft_c2r( cuNDArray<complext<T> > *in, cuNDArray<T> *out, unsigned int D, size_t n0, bool do_scale = true );
+
 
   protected:   
     cuNDFFT() {}
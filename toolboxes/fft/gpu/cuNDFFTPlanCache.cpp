@@ -0,0 +1,200 @@
+#include "cuNDFFTPlanCache.h"
+#include "cudaMemoryCache.h"
+#include "check_CUDA.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace Gadgetron{
+
+  namespace {
+
+    // Restores the current device when it goes out of scope
+    struct DeviceGuard
+    {
+      DeviceGuard(int device) : old_device(-1)
+      {
+        CUDA_CALL(cudaGetDevice(&old_device));
+        if (device != old_device) CUDA_CALL(cudaSetDevice(device));
+      }
+
+      ~DeviceGuard()
+      {
+        int device;
+        if (cudaGetDevice(&device) == cudaSuccess && device != old_device) cudaSetDevice(old_device);
+      }
+
+      int old_device;
+    };
+
+    void check_cufft( cufftResult res, const char* what )
+    {
+      if (res != CUFFT_SUCCESS) {
+        std::stringstream ss;
+        ss << "cuNDFFTPlanCache: " << what << " failed: " << res;
+        throw std::runtime_error(ss.str());
+      }
+    }
+  }
+
+  bool cuNDFFTPlanKey::operator<( const cuNDFFTPlanKey& o ) const
+  {
+    return std::tie(device, stream, type, n, embed, istride, idist, ostride, odist, batch) <
+      std::tie(o.device, o.stream, o.type, o.n, o.embed, o.istride, o.idist, o.ostride, o.odist, o.batch);
+  }
+
+  cuNDFFTPlanCache* cuNDFFTPlanCache::instance()
+  {
+    // Never deleted, the plans and work areas may outlive the cuda runtime at exit
+    static cuNDFFTPlanCache* cache = new cuNDFFTPlanCache;
+    return cache;
+  }
+
+  cuNDFFTPlanCache::cuNDFFTPlanCache() : max_plans_(64), clock_(0) {}
+
+  cuNDFFTPlanCache::~cuNDFFTPlanCache() {}
+
+  cuNDFFTPlanKey cuNDFFTPlanCache::key( cufftType type, const std::vector<int>& n, bool embed,
+                                        int istride, int idist, int ostride, int odist, int batch, cudaStream_t stream )
+  {
+    cuNDFFTPlanKey k;
+    CUDA_CALL(cudaGetDevice(&k.device));
+    k.stream = stream;
+    k.type = type;
+    k.n = n;
+    k.embed = embed;
+    k.istride = istride;
+    k.idist = idist;
+    k.ostride = ostride;
+    k.odist = odist;
+    k.batch = batch;
+    return k;
+  }
+
+  cuNDFFTPlan cuNDFFTPlanCache::plan( const cuNDFFTPlanKey& key )
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.find(key);
+    if (it != plans_.end()) {
+      it->second.last_use = ++clock_;
+      return cuNDFFTPlan(std::move(lock), it->second.handle);
+    }
+
+    Entry entry;
+    entry.last_use = ++clock_;
+    entry.work_size = 0;
+
+    check_cufft(cufftCreate(&entry.handle), "plan creation");
+
+    try {
+      check_cufft(cufftSetAutoAllocation(entry.handle, 0), "disabling the work area allocation");
+
+      int* embed = key.embed ? const_cast<int*>(&key.n[0]) : NULL;
+      check_cufft(cufftMakePlanMany(entry.handle, (int)key.n.size(), const_cast<int*>(&key.n[0]),
+                                    embed, key.istride, key.idist, embed, key.ostride, key.odist,
+                                    key.type, key.batch, &entry.work_size), "plan creation");
+
+      check_cufft(cufftSetStream(entry.handle, key.stream), "binding the plan to the stream");
+
+      set_work_area(key, entry);
+    }
+    catch (...) {
+      cufftDestroy(entry.handle);
+      throw;
+    }
+
+    plans_[key] = entry;
+    evict(key.device);
+
+    return cuNDFFTPlan(std::move(lock), entry.handle);
+  }
+
+  void cuNDFFTPlanCache::set_work_area( const cuNDFFTPlanKey& key, Entry& entry )
+  {
+    WorkArea& area = work_areas_[std::make_pair(key.device, key.stream)];
+
+    if (entry.work_size > area.size) {
+
+      // The area is released to the memory cache for the same stream, which reuses it only after the transforms queued before
+      void* ptr = cudaMemoryCache::instance()->allocate(entry.work_size, key.stream);
+      if (!ptr) throw std::runtime_error("cuNDFFTPlanCache: unable to allocate the work area");
+
+      if (area.ptr) cudaMemoryCache::instance()->deallocate(area.ptr);
+      area.ptr = ptr;
+      area.size = entry.work_size;
+
+      for (std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.begin(); it != plans_.end(); it++) {
+        if (it->first.device == key.device && it->first.stream == key.stream && it->second.work_size > 0)
+          check_cufft(cufftSetWorkArea(it->second.handle, area.ptr), "setting the work area");
+      }
+    }
+
+    if (entry.work_size > 0)
+      check_cufft(cufftSetWorkArea(entry.handle, area.ptr), "setting the work area");
+  }
+
+  void cuNDFFTPlanCache::evict( int device )
+  {
+    size_t plans_on_device = 0;
+    for (std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.begin(); it != plans_.end(); it++)
+      if (it->first.device == device) plans_on_device++;
+
+    while (plans_on_device > max_plans_) {
+      std::map<cuNDFFTPlanKey, Entry>::iterator oldest = plans_.end();
+      for (std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.begin(); it != plans_.end(); it++) {
+        if (it->first.device == device && (oldest == plans_.end() || it->second.last_use < oldest->second.last_use))
+          oldest = it;
+      }
+
+      cufftDestroy(oldest->second.handle);
+      plans_.erase(oldest);
+      plans_on_device--;
+    }
+  }
+
+  void cuNDFFTPlanCache::clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.begin(); it != plans_.end(); it++) {
+      DeviceGuard guard(it->first.device);
+      cufftDestroy(it->second.handle);
+    }
+    plans_.clear();
+
+    for (std::map< std::pair<int, cudaStream_t>, WorkArea >::iterator it = work_areas_.begin(); it != work_areas_.end(); it++) {
+      DeviceGuard guard(it->first.first);
+      if (it->second.ptr) cudaMemoryCache::instance()->deallocate(it->second.ptr);
+    }
+    work_areas_.clear();
+  }
+
+  size_t cuNDFFTPlanCache::max_plans()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_plans_;
+  }
+
+  void cuNDFFTPlanCache::set_max_plans( size_t plans )
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_plans_ = (plans > 0) ? plans : 1;
+
+    std::vector<int> devices;
+    for (std::map<cuNDFFTPlanKey, Entry>::iterator it = plans_.begin(); it != plans_.end(); it++)
+      if (devices.empty() || devices.back() != it->first.device) devices.push_back(it->first.device);
+
+    for (size_t i = 0; i < devices.size(); i++) {
+      DeviceGuard guard(devices[i]);
+      evict(devices[i]);
+    }
+  }
+
+  size_t cuNDFFTPlanCache::number_of_plans()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plans_.size();
+  }
+}
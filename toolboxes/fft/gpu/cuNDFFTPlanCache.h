@@ -0,0 +1,116 @@
+/** \file   cuNDFFTPlanCache.h
+    \brief  Cache of the cuFFT plans of cuNDFFT.
+
+            Creating a cuFFT plan takes far longer than executing it for the image sizes of a reconstruction,
+            and every plan allocates a work area of its own. The plans of cuNDFFT are therefore kept here,
+            keyed by device, stream, type, transform sizes, strides and batch, and reused by the following
+            transforms of the same shape.
+
+            The plans are created without a work area. All plans of a device and stream share one work area,
+            allocated from the cudaMemoryCache and grown to the largest plan. The transforms of one stream are
+            executed in order, so they never use the shared area at the same time. Each plan is bound to the
+            stream of its key.
+
+            At most max_plans() plans are kept per device (64 by default), the least recently used plan is
+            destroyed beyond that.
+*/
+
+#pragma once
+
+#include "gpufft_export.h"
+
+#include <cufft.h>
+#include <cuda_runtime_api.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Gadgetron{
+
+  struct EXPORTGPUFFT cuNDFFTPlanKey
+  {
+    cuNDFFTPlanKey() : device(0), stream(0), type(CUFFT_C2C), embed(false), istride(1), idist(0), ostride(1), odist(0), batch(1) {}
+
+    int device;
+    cudaStream_t stream;
+    cufftType type;
+    std::vector<int> n;   // sizes of the transform, slowest varying dimension first
+    bool embed;           // n is passed as inembed and onembed, the strides are used
+    int istride, idist;
+    int ostride, odist;
+    int batch;
+
+    bool operator<( const cuNDFFTPlanKey& other ) const;
+  };
+
+  /// A cached plan, the cache is locked for the lifetime of the object
+  class EXPORTGPUFFT cuNDFFTPlan
+  {
+  public:
+    cuNDFFTPlan( std::unique_lock<std::mutex> lock, cufftHandle handle ) : lock_(std::move(lock)), handle_(handle) {}
+
+    cufftHandle handle() const { return handle_; }
+
+  private:
+    std::unique_lock<std::mutex> lock_;
+    cufftHandle handle_;
+  };
+
+  class EXPORTGPUFFT cuNDFFTPlanCache
+  {
+  public:
+
+    static cuNDFFTPlanCache* instance();
+
+    /// Plan of the transform described by key, created on first use. Throws if cuFFT fails.
+    /// The device of the key must be the current device.
+    cuNDFFTPlan plan( const cuNDFFTPlanKey& key );
+
+    /// Key of a transform on the current device and the given stream
+    static cuNDFFTPlanKey key( cufftType type, const std::vector<int>& n, bool embed,
+                               int istride, int idist, int ostride, int odist, int batch, cudaStream_t stream = 0 );
+
+    /// Destroys all plans and releases the work areas
+    void clear();
+
+    size_t max_plans();
+    void set_max_plans( size_t plans );
+
+    size_t number_of_plans();
+
+  private:
+
+    // Use the instance() method to access the singleton
+    //
+
+    cuNDFFTPlanCache();
+    ~cuNDFFTPlanCache();
+
+    struct Entry
+    {
+      cufftHandle handle;
+      size_t work_size;
+      unsigned long long last_use;
+    };
+
+    struct WorkArea
+    {
+      WorkArea() : ptr(0), size(0) {}
+      void* ptr;
+      size_t size;
+    };
+
+    // Grows the work area of the device and stream of key to the work size of entry and sets it on the plans using it
+    void set_work_area( const cuNDFFTPlanKey& key, Entry& entry );
+
+    // Destroys the least recently used plans of a device beyond max_plans_
+    void evict( int device );
+
+    std::mutex mutex_;
+    size_t max_plans_;
+    unsigned long long clock_;
+    std::map<cuNDFFTPlanKey, Entry> plans_;
+    std::map< std::pair<int, cudaStream_t>, WorkArea > work_areas_;
+  };
+}
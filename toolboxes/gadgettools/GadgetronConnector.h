@@ -63,6 +63,15 @@ namespace Gadgetron{
     }
 
     virtual int svc(void)
+    {
+      int rval = this->write_messages();
+
+      //Nothing is sent any more, producers must not block on a bounded queue
+      this->msg_queue()->deactivate();
+      return rval;
+    }
+
+    int write_messages()
     {
       ACE_Message_Block *mb = 0;
       ACE_Time_Value nowait (ACE_OS::gettimeofday ());
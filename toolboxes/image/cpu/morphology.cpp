@@ -8,10 +8,198 @@
 #include <iostream>
 #include <stack>
 #include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif // USE_OMP
 
 namespace Gadgetron
 {
 
+namespace
+{
+    const unsigned int UF_BACKGROUND = std::numeric_limits<unsigned int>::max();
+
+    // union-find on voxel indices, the root of a set is its smallest index
+    inline unsigned int uf_find(std::vector<unsigned int>& parent, unsigned int p)
+    {
+        while (parent[p] != p)
+        {
+            parent[p] = parent[parent[p]];
+            p = parent[p];
+        }
+
+        return p;
+    }
+
+    inline void uf_union(std::vector<unsigned int>& parent, unsigned int a, unsigned int b)
+    {
+        a = uf_find(parent, a);
+        b = uf_find(parent, b);
+
+        if (a < b) parent[b] = a;
+        else if (b < a) parent[a] = b;
+    }
+
+    // label the components of the sx*sy*sz volume by union-find
+    // the volume is cut into blocks along y (2D) or z (3D), which are labelled in parallel and then joined at their first row or slice
+    // with interior_seeds only the components with a voxel off the border of the 2D image are kept, as with region growing from these seeds
+    // the kept components are numbered from 1 in raster order of their first (seed) voxel
+    template <typename T>
+    void bwlabel_union_find(const T* input, size_t sx, size_t sy, size_t sz, T object_value, bool full_connectivity, bool interior_seeds, bool parallel, unsigned int* label)
+    {
+        size_t num = sx*sy*sz;
+        if (num == 0) return;
+        GADGET_CHECK_THROW(num < (size_t)UF_BACKGROUND);
+
+        // neighbours which come before a voxel in raster order
+        std::vector<long long> ox, oy, oz;
+        long long dx, dy, dz;
+        for (dz = (sz > 1) ? -1 : 0; dz <= 0; dz++)
+        {
+            for (dy = -1; dy <= 1; dy++)
+            {
+                for (dx = -1; dx <= 1; dx++)
+                {
+                    bool before = (dz < 0) || (dz == 0 && dy < 0) || (dz == 0 && dy == 0 && dx < 0);
+                    if (!before) continue;
+                    if (!full_connectivity && (std::abs(dx) + std::abs(dy) + std::abs(dz)) > 1) continue;
+
+                    ox.push_back(dx);
+                    oy.push_back(dy);
+                    oz.push_back(dz);
+                }
+            }
+        }
+
+        size_t numNeighbor = ox.size();
+
+        bool along_z = (sz > 1);
+        long long len = (long long)(along_z ? sz : sy);
+
+        long long numBlocks = 1;
+#ifdef USE_OMP
+        if (parallel) numBlocks = std::min((long long)omp_get_max_threads(), len / 16);
+#endif // USE_OMP
+        if (numBlocks < 1) numBlocks = 1;
+
+        std::vector<unsigned int> parent(num);
+
+        long long b;
+#pragma omp parallel for default(none) private(b) shared(input, sx, sy, sz, object_value, ox, oy, oz, numNeighbor, along_z, len, numBlocks, parent) if(numBlocks>1)
+        for (b = 0; b < numBlocks; b++)
+        {
+            long long start = b*len / numBlocks;
+            long long end = (b + 1)*len / numBlocks;
+
+            long long z0 = along_z ? start : 0, z1 = along_z ? end : 1;
+            long long y0 = along_z ? 0 : start, y1 = along_z ? (long long)sy : end;
+
+            for (long long z = z0; z < z1; z++)
+            {
+                for (long long y = y0; y < y1; y++)
+                {
+                    for (long long x = 0; x < (long long)sx; x++)
+                    {
+                        size_t p = x + y*sx + z*sx*sy;
+
+                        if (!(std::abs(input[p] - object_value) < FLT_EPSILON))
+                        {
+                            parent[p] = UF_BACKGROUND;
+                            continue;
+                        }
+
+                        parent[p] = (unsigned int)p;
+
+                        for (size_t k = 0; k < numNeighbor; k++)
+                        {
+                            long long nx = x + ox[k], ny = y + oy[k], nz = z + oz[k];
+                            if (nx < 0 || nx >= (long long)sx || ny < 0 || ny >= (long long)sy || nz < 0) continue;
+                            if ((along_z ? nz : ny) < start) continue; // in the previous block
+
+                            size_t q = nx + ny*sx + nz*sx*sy;
+                            if (parent[q] != UF_BACKGROUND) uf_union(parent, (unsigned int)p, (unsigned int)q);
+                        }
+                    }
+                }
+            }
+        }
+
+        // join every block to the previous one
+        for (b = 1; b < numBlocks; b++)
+        {
+            long long start = b*len / numBlocks;
+
+            long long z0 = along_z ? start : 0, z1 = along_z ? start + 1 : 1;
+            long long y0 = along_z ? 0 : start, y1 = along_z ? (long long)sy : start + 1;
+
+            for (long long z = z0; z < z1; z++)
+            {
+                for (long long y = y0; y < y1; y++)
+                {
+                    for (long long x = 0; x < (long long)sx; x++)
+                    {
+                        size_t p = x + y*sx + z*sx*sy;
+                        if (parent[p] == UF_BACKGROUND) continue;
+
+                        for (size_t k = 0; k < numNeighbor; k++)
+                        {
+                            long long nx = x + ox[k], ny = y + oy[k], nz = z + oz[k];
+                            if (nx < 0 || nx >= (long long)sx || ny < 0 || ny >= (long long)sy) continue;
+                            if ((along_z ? nz : ny) >= start) continue;
+
+                            size_t q = nx + ny*sx + nz*sx*sy;
+                            if (parent[q] != UF_BACKGROUND) uf_union(parent, (unsigned int)p, (unsigned int)q);
+                        }
+                    }
+                }
+            }
+        }
+
+        // the root of every voxel, parent is not changed any more
+        long long n;
+#pragma omp parallel for default(none) private(n) shared(num, parent, label) if(numBlocks>1)
+        for (n = 0; n < (long long)num; n++)
+        {
+            unsigned int r = parent[n];
+            if (r != UF_BACKGROUND)
+            {
+                while (parent[r] != r) r = parent[r];
+            }
+            label[n] = r;
+        }
+
+        // number the components, parent now holds the number of every root
+        std::fill(parent.begin(), parent.end(), 0);
+
+        unsigned int currLabel = 0;
+        for (size_t z = 0; z < sz; z++)
+        {
+            for (size_t y = 0; y < sy; y++)
+            {
+                if (interior_seeds && (y < 1 || y + 1 >= sy)) continue;
+
+                for (size_t x = 0; x < sx; x++)
+                {
+                    if (interior_seeds && (x < 1 || x + 1 >= sx)) continue;
+
+                    unsigned int r = label[x + y*sx + z*sx*sy];
+                    if (r != UF_BACKGROUND && parent[r] == 0) parent[r] = ++currLabel;
+                }
+            }
+        }
+
+#pragma omp parallel for default(none) private(n) shared(num, parent, label) if(numBlocks>1)
+        for (n = 0; n < (long long)num; n++)
+        {
+            label[n] = (label[n] == UF_BACKGROUND) ? 0 : parent[label[n]];
+        }
+    }
+}
+
 template <typename T> 
 void region_growing_2d(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label_array, size_t x, size_t y, unsigned int label, bool is_8_connected)
 {
@@ -122,38 +310,86 @@ void bwlabel_2d(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned in
     {
         size_t COL = input.get_size(0);
         size_t ROW = input.get_size(1);
-        size_t num = input.get_number_of_elements();
 
         label.create(COL, ROW);
-        Gadgetron::clear(label);
 
-        size_t currLabel = 1;
+        bwlabel_union_find(input.begin(), COL, ROW, 1, object_value, is_8_connected, true, true, label.begin());
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors happened in bwlabel_2d(...) ... ");
+    }
+}
+
+template EXPORTIMAGE void bwlabel_2d(const hoNDArray<int>& input, int object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+template EXPORTIMAGE void bwlabel_2d(const hoNDArray<float>& input, float object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+template EXPORTIMAGE void bwlabel_2d(const hoNDArray<double>& input, double object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+
+// --------------------------------------------------------------------------------------------
+
+template <typename T> 
+void bwlabel_2d_batch(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_8_connected)
+{
+    try
+    {
+        size_t COL = input.get_size(0);
+        size_t ROW = input.get_size(1);
+        size_t N = input.get_number_of_elements() / (COL*ROW);
+
+        label.create(input.get_dimensions());
 
-        size_t r, c;
-        for (r = 1; r < ROW - 1; r++)
+        bool failed = false;
+
+        long long n;
+#pragma omp parallel for default(none) private(n) shared(input, object_value, label, is_8_connected, COL, ROW, N, failed) schedule(dynamic)
+        for (n = 0; n < (long long)N; n++)
         {
-            for (c = 1; c < COL - 1; c++)
+            try
             {
-                if (std::abs(input(c, r) - object_value) < FLT_EPSILON)
-                {
-                    if (label(c, r) == 0)
-                    {
-                        Gadgetron::region_growing_2d(input, object_value, label, c, r, currLabel, is_8_connected);
-                        currLabel++;
-                    }
-                }
+                bwlabel_union_find(input.begin() + n*COL*ROW, COL, ROW, 1, object_value, is_8_connected, true, false, label.begin() + n*COL*ROW);
+            }
+            catch (...)
+            {
+                failed = true;
             }
         }
+
+        GADGET_CHECK_THROW(!failed);
     }
     catch (...)
     {
-        GADGET_THROW("Errors happened in bwlabel_2d(...) ... ");
+        GADGET_THROW("Errors happened in bwlabel_2d_batch(...) ... ");
     }
 }
 
-template EXPORTIMAGE void bwlabel_2d(const hoNDArray<int>& input, int object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
-template EXPORTIMAGE void bwlabel_2d(const hoNDArray<float>& input, float object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
-template EXPORTIMAGE void bwlabel_2d(const hoNDArray<double>& input, double object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+template EXPORTIMAGE void bwlabel_2d_batch(const hoNDArray<int>& input, int object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+template EXPORTIMAGE void bwlabel_2d_batch(const hoNDArray<float>& input, float object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+template EXPORTIMAGE void bwlabel_2d_batch(const hoNDArray<double>& input, double object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+
+// --------------------------------------------------------------------------------------------
+
+template <typename T> 
+void bwlabel_3d(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_26_connected)
+{
+    try
+    {
+        size_t RO = input.get_size(0);
+        size_t E1 = input.get_size(1);
+        size_t E2 = input.get_size(2);
+
+        label.create(RO, E1, E2);
+
+        bwlabel_union_find(input.begin(), RO, E1, E2, object_value, is_26_connected, false, true, label.begin());
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors happened in bwlabel_3d(...) ... ");
+    }
+}
+
+template EXPORTIMAGE void bwlabel_3d(const hoNDArray<int>& input, int object_value, hoNDArray<unsigned int>& label, bool is_26_connected);
+template EXPORTIMAGE void bwlabel_3d(const hoNDArray<float>& input, float object_value, hoNDArray<unsigned int>& label, bool is_26_connected);
+template EXPORTIMAGE void bwlabel_3d(const hoNDArray<double>& input, double object_value, hoNDArray<unsigned int>& label, bool is_26_connected);
 
 // --------------------------------------------------------------------------------------------
 
@@ -238,52 +474,53 @@ void bwlabel_area_2d(const hoNDArray<unsigned int>& label_array, std::vector<uns
         areas.clear();
 
         size_t num = label_array.get_number_of_elements();
+        const unsigned int* pLabel = label_array.begin();
 
+        unsigned int maxLabel = 0;
         size_t n;
         for (n = 0; n < num; n++)
         {
-            unsigned int v = label_array(n);
-            if (v>0)
-            {
-                size_t numLabel = labels.size();
-
-                bool labelExist = false;
-                for (size_t ll = 0; ll < numLabel; ll++)
-                {
-                    if (labels[ll] == v)
-                    {
-                        labelExist = true;
-                        break;
-                    }
-                }
-
-                if (!labelExist)
-                {
-                    labels.push_back(v);
-                }
-            }
+            if (pLabel[n] > maxLabel) maxLabel = pLabel[n];
         }
 
-        size_t numLabels = labels.size();
-
-        if (numLabels == 0) return;
+        if (maxLabel == 0) return;
 
-        areas.resize(numLabels, 0);
-
-        for (n = 0; n < num; n++)
+        if (maxLabel <= num)
         {
-            unsigned int v = label_array(n);
-            if (v>0)
+            // labels of bwlabel_2d/3d are consecutive, count them in a table
+            std::vector<unsigned int> count(maxLabel + 1, 0);
+            for (n = 0; n < num; n++)
             {
-                size_t l;
-                for (l = 0; l < numLabels; l++)
+                unsigned int v = pLabel[n];
+                if (v > 0)
                 {
-                    if (v == labels[l]) break;
+                    if (count[v] == 0) labels.push_back(v);
+                    count[v]++;
                 }
+            }
 
-                if (l<numLabels)
+            areas.resize(labels.size());
+            for (n = 0; n < labels.size(); n++) areas[n] = count[labels[n]];
+        }
+        else
+        {
+            std::unordered_map<unsigned int, size_t> index;
+            for (n = 0; n < num; n++)
+            {
+                unsigned int v = pLabel[n];
+                if (v > 0)
                 {
-                    areas[l]++;
+                    std::unordered_map<unsigned int, size_t>::iterator it = index.find(v);
+                    if (it == index.end())
+                    {
+                        index[v] = labels.size();
+                        labels.push_back(v);
+                        areas.push_back(1);
+                    }
+                    else
+                    {
+                        areas[it->second]++;
+                    }
                 }
             }
         }
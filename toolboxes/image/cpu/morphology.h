@@ -30,10 +30,27 @@ namespace Gadgetron
     /// perfrom connected component labelling
     /// input: a 2D array, with object pixels equal to object_value
     /// label: connected component label matrix, 0 is background
+    /// the components are found by union-find, in parallel over blocks of rows for large images;
+    /// as for region growing from every seed, only components with a pixel off the image border are labelled,
+    /// in the raster order of their first such pixel
     template <typename T> EXPORTIMAGE
     void bwlabel_2d(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
 
+    /// perform bwlabel_2d for every 2D image of input [RO E1 ...], in parallel over the images
+    /// label has the size of input, the labels of every image start at 1
+    template <typename T> EXPORTIMAGE
+    void bwlabel_2d_batch(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_8_connected);
+
+    /// perfrom 3D connected component labelling
+    /// input: a 3D array, with object voxels equal to object_value
+    /// label: connected component label array, 0 is background; all components are labelled, in raster order of their first voxel
+    /// is_26_connected: whether to label 26-connected objects; if false, 6-connected objects are labelled
+    /// the volumes of the components are given by bwlabel_area_2d, which takes label arrays of any dimension
+    template <typename T> EXPORTIMAGE
+    void bwlabel_3d(const hoNDArray<T>& input, T object_value, hoNDArray<unsigned int>& label, bool is_26_connected);
+
     /// for the labelled array, find all regions and their areas
+    /// labels are listed in the order of their first pixel
     EXPORTIMAGE void bwlabel_area_2d(const hoNDArray<unsigned int>& label_array, std::vector<unsigned int>& labels, std::vector<unsigned int>& areas);
 
     /// clean foreground and background using bwlabel
@@ -8,24 +8,24 @@
 namespace Gadgetron{
 
 template<typename T> 
-hoNDKLT<T>::hoNDKLT()
+hoNDKLT<T>::hoNDKLT() : output_length_(0)
 {
 }
 
 template<typename T>
-hoNDKLT<T>::hoNDKLT(const hoNDArray<T>& data, size_t dim, size_t output_length)
+hoNDKLT<T>::hoNDKLT(const hoNDArray<T>& data, size_t dim, size_t output_length) : output_length_(0)
 {
     this->prepare(data, dim, output_length);
 }
 
 template<typename T>
-hoNDKLT<T>::hoNDKLT(const hoNDArray<T>& data, size_t dim, value_type thres)
+hoNDKLT<T>::hoNDKLT(const hoNDArray<T>& data, size_t dim, value_type thres) : output_length_(0)
 {
     this->prepare(data, dim, thres);
 }
 
 template<typename T>
-hoNDKLT<T>::hoNDKLT(const Self& v)
+hoNDKLT<T>::hoNDKLT(const Self& v) : output_length_(0)
 {
     *this = v;
 }
@@ -489,6 +489,169 @@ void hoNDKLT<T>::prepare(const hoNDArray<T>& data, size_t dim, std::vector<size_
     }
 }
 
+template<typename T>
+void hoNDKLT<T>::data_2D(const hoNDArray<T>& data, size_t dim, hoNDArray<T>& buf, hoNDArray<T>& data2D)
+{
+    size_t NDim = data.get_number_of_dimensions();
+    GADGET_CHECK_THROW(dim<NDim);
+
+    std::vector<size_t> dimD;
+    data.get_dimensions(dimD);
+
+    size_t N = dimD[dim];
+    size_t num = data.get_number_of_elements() / N;
+
+    size_t K = 1;
+    for (size_t n = dim + 1; n < NDim; n++) K *= dimD[n];
+
+    if (K == 1)
+    {
+        data2D.create(num, N, const_cast<T*>(data.begin()));
+        return;
+    }
+
+    std::vector<size_t> dimOrder(NDim), dimPermuted(dimD);
+
+    size_t l;
+    for (l = 0; l<NDim; l++)
+    {
+        dimOrder[l] = l;
+    }
+
+    dimOrder[dim] = NDim - 1;
+    dimOrder[NDim - 1] = dim;
+
+    dimPermuted[dim] = dimD[NDim - 1];
+    dimPermuted[NDim - 1] = dimD[dim];
+
+    buf.create(dimPermuted);
+    Gadgetron::permute(const_cast<hoNDArray<T>* >(&data), &buf, &dimOrder);
+
+    data2D.create(num, N, buf.begin());
+}
+
+template<typename T>
+void hoNDKLT<T>::prepare_randomized(const hoNDArray<T>& data, size_t dim, size_t output_length, bool remove_mean, size_t oversampling, size_t power_iterations)
+{
+    try
+    {
+        size_t NDim = data.get_number_of_dimensions();
+        GADGET_CHECK_THROW(dim<NDim);
+
+        size_t N = data.get_size(dim);
+        size_t L = output_length + oversampling;
+
+        if (output_length == 0 || L >= N)
+        {
+            this->prepare(data, dim, output_length, remove_mean);
+            return;
+        }
+
+        hoNDArray<T> buf, data2D;
+        this->data_2D(data, dim, buf, data2D);
+
+        size_t M = data2D.get_size(0);
+
+        // the data is only copied if the mean is removed
+        arma::Mat<T> A(data2D.begin(), M, N, remove_mean, true);
+        if (remove_mean)
+        {
+            A.each_row() -= arma::mean(A, 0);
+        }
+
+        // orthonormal basis Q [M L] of the range of the sketch A*Omega,
+        // the power iterations sharpen it towards the leading singular vectors
+        arma::Mat<T> Omega = arma::randn< arma::Mat<T> >(N, L);
+        arma::Mat<T> Q, Z, R;
+
+        GADGET_CHECK_THROW(arma::qr_econ(Q, R, A*Omega));
+        for (size_t it = 0; it < power_iterations; it++)
+        {
+            GADGET_CHECK_THROW(arma::qr_econ(Z, R, A.t()*Q));
+            GADGET_CHECK_THROW(arma::qr_econ(Q, R, A*Z));
+        }
+
+        // the right singular vectors of the small [L N] projection are those of A
+        arma::Mat<T> B = Q.t()*A;
+        arma::Mat<T> Um, Vm;
+        arma::Col<value_type> Sv;
+        GADGET_CHECK_THROW(arma::svd_econ(Um, Sv, Vm, B, 'b'));
+
+        output_length_ = output_length;
+        V_.create(N, output_length_);
+        E_.create(output_length_, 1);
+
+        size_t n;
+        for (n = 0; n < output_length_; n++)
+        {
+            memcpy(V_.begin() + n*N, Vm.colptr(n), sizeof(T)*N);
+            E_(n) = Sv(n)*Sv(n); // the E is eigen value, the square of singular value
+        }
+
+        M_.create(N, output_length_, V_.begin());
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoNDKLT<T>::prepare_randomized(...) ... ");
+    }
+}
+
+template<typename T>
+void hoNDKLT<T>::update(const hoNDArray<T>& data, size_t dim, size_t max_modes)
+{
+    try
+    {
+        size_t NDim = data.get_number_of_dimensions();
+        GADGET_CHECK_THROW(dim<NDim);
+
+        size_t N = data.get_size(dim);
+
+        hoNDArray<T> buf, data2D;
+        this->data_2D(data, dim, buf, data2D);
+
+        arma::Mat<T> A(data2D.begin(), data2D.get_size(0), N, false, true);
+
+        // Gram matrix of all data so far, V*E*V' of the modes kept plus A'*A of the new data
+        arma::Mat<T> G = A.t()*A;
+
+        if (V_.get_number_of_elements() > 0)
+        {
+            GADGET_CHECK_THROW(V_.get_size(0) == N);
+
+            size_t K = V_.get_size(1);
+            arma::Mat<T> V(V_.begin(), N, K, false, true);
+
+            arma::Col<T> e(K);
+            for (size_t k = 0; k < K; k++) e(k) = E_(k);
+
+            G += V*arma::diagmat(e)*V.t();
+        }
+
+        arma::Col<value_type> ev;
+        arma::Mat<T> Vm;
+        GADGET_CHECK_THROW(arma::eig_sym(ev, Vm, G));
+
+        // make the first eigen channel with the largest eigen value
+        size_t K = (max_modes > 0 && max_modes < N) ? max_modes : N;
+        V_.create(N, K);
+        E_.create(K, 1);
+
+        size_t k;
+        for (k = 0; k < K; k++)
+        {
+            memcpy(V_.begin() + k*N, Vm.colptr(N - 1 - k), sizeof(T)*N);
+            E_(k) = ev(N - 1 - k);
+        }
+
+        if (output_length_ == 0 || output_length_ > K) output_length_ = K;
+        M_.create(N, output_length_, V_.begin());
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoNDKLT<T>::update(...) ... ");
+    }
+}
+
 template<typename T>
 void hoNDKLT<T>::transform(const hoNDArray<T>& in, hoNDArray<T>& out, size_t dim) const
 {
@@ -582,21 +745,15 @@ void hoNDKLT<T>::KL_filter(const hoNDArray<T>& in, hoNDArray<T>& out, size_t dim
         size_t N = V_.get_size(0);
         size_t num = in.get_number_of_elements() / N;
 
-        hoMatrix<T> E(N, N);
-        memcpy(E.begin(), V_.begin(), sizeof(T)*N*N);
+        // V_ may only hold the leading modes
+        if (mode_kept > V_.get_size(1)) mode_kept = V_.get_size(1);
 
-        size_t r, c;
-        for (c = mode_kept; c<N; c++)
-        {
-            for (r = 0; r<N; r++)
-            {
-                E(r, c) = T(0);
-            }
-        }
+        hoMatrix<T> E(N, N);
+        Gadgetron::clear(E);
+        memcpy(E.begin(), V_.begin(), sizeof(T)*N*mode_kept);
 
         hoMatrix<T> ET;
         ET.createMatrix(N, N);
-        memcpy(ET.begin(), V_.begin(), sizeof(T)*N*N);
 
         Gadgetron::conjugatetrans(E, ET);
 
@@ -674,17 +831,16 @@ void hoNDKLT<T>::output_length(size_t length)
 {
     if (M_.get_size(0) == V_.get_size(0))
     {
-        GADGET_CHECK_THROW(V_.get_size(0) == V_.get_size(1));
-
         size_t N = M_.get_size(0);
+        size_t K = V_.get_size(1);
 
-        if (length > 0 && length <= N)
+        if (length > 0 && length <= K)
         {
             output_length_ = length;
         }
         else
         {
-            output_length_ = N;
+            output_length_ = K;
         }
 
         M_.create(N, output_length_, V_.begin());
@@ -53,6 +53,18 @@ namespace Gadgetron{
         void prepare(const hoNDArray<T>& data, size_t dim, std::vector<size_t>& untransformed, size_t output_length = 0, bool remove_mean = true);
         void prepare(const hoNDArray<T>& data, size_t dim, std::vector<size_t>& untransformed, value_type thres = (value_type)0.001, bool remove_mean = true);
 
+        /// compute only the leading output_length modes with a randomized SVD (Halko, Martinsson and Tropp, SIAM Review 53(2), 2011)
+        /// the data is sketched with output_length+oversampling random vectors and refined with power_iterations subspace iterations,
+        /// all with matrix-matrix products; the eigen vector matrix then has the size of [data.get_size(dim) output_length]
+        /// output_length == 0, or a sketch as large as the data, falls back to the full SVD of prepare
+        void prepare_randomized(const hoNDArray<T>& data, size_t dim, size_t output_length, bool remove_mean = true, size_t oversampling = 10, size_t power_iterations = 2);
+
+        /// streaming update of the transform with more data, e.g. as profiles arrive
+        /// the modes computed so far (by prepare, prepare_randomized or earlier updates) are combined with the new data
+        /// a default constructed object starts from no data; the mean is not removed
+        /// at most max_modes modes are kept, 0 means all
+        void update(const hoNDArray<T>& data, size_t dim, size_t max_modes = 0);
+
         /// apply the transform
         /// The input array size must meet in.get_size(dim) == M.get_size(0)
         /// out array will have out.get_size(dim)==out_length
@@ -81,9 +93,9 @@ namespace Gadgetron{
 
         /// KL tranformation matrix
         hoNDArray<T> M_;
-        /// eigen vector matrix
+        /// eigen vector matrix, [N N] or [N modes] if only the leading modes are computed
         hoNDArray<T> V_;
-        /// eigen value array, ascending order
+        /// eigen value array, descending order
         hoNDArray<T> E_;
         /// length of output dimension
         size_t output_length_;
@@ -99,6 +111,9 @@ namespace Gadgetron{
 
         /// compute number of kept channels
         void compute_num_kept(value_type thres);
+
+        /// view of the data as a 2D array [num data.get_size(dim)], permuted into buf if dim is not the last dimension
+        void data_2D(const hoNDArray<T>& data, size_t dim, hoNDArray<T>& buf, hoNDArray<T>& data2D);
     };
 }
 
@@ -6,21 +6,276 @@
 #include <time.h>
 #include <cstring>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
 
 
 namespace Gadgetron
 {
+  namespace
+  {
+    struct LogRecord
+    {
+      unsigned long long seq;
+      std::chrono::system_clock::time_point time;
+      GadgetronLogLevel level;
+      const char* filename;
+      int lineno;
+      std::string message;
+    };
+
+    bool operator<(const LogRecord& a, const LogRecord& b) { return a.seq < b.seq; }
+
+    /**
+       Single producer, single consumer ring of log records. The producer is the thread owning
+       the ring, the consumer whoever holds the drain mutex. Slots keep their message buffers,
+       so a thread logging in a loop does not allocate once its slots have grown.
+     */
+    class LogRing
+    {
+    public:
+      LogRing(size_t capacity) : slots_(capacity), head_(0), tail_(0) {}
+
+      ///Next free slot, 0 if the ring is full
+      LogRecord* reserve()
+      {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) >= slots_.size()) return 0;
+        return &slots_[t % slots_.size()];
+      }
+
+      ///Publishes the slot returned by reserve
+      void commit()
+      {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+
+      ///Copies the published records to batch[n...], returns the new n
+      size_t pop_all(std::vector<LogRecord>& batch, size_t n)
+      {
+        size_t h = head_.load(std::memory_order_relaxed);
+        size_t t = tail_.load(std::memory_order_acquire);
+        for (; h != t; h++, n++) {
+          if (n == batch.size()) batch.resize(2 * n + 64);
+          LogRecord& slot = slots_[h % slots_.size()];
+          LogRecord& r = batch[n];
+          r.seq = slot.seq;
+          r.time = slot.time;
+          r.level = slot.level;
+          r.filename = slot.filename;
+          r.lineno = slot.lineno;
+          r.message.assign(slot.message);
+        }
+        head_.store(h, std::memory_order_release);
+        return n;
+      }
+
+      bool empty() const
+      {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+      }
+
+    protected:
+      std::vector<LogRecord> slots_;
+      std::atomic<size_t> head_;
+      std::atomic<size_t> tail_;
+    };
+
+    const size_t LOG_RING_CAPACITY = 1024;
+    const std::chrono::milliseconds LOG_FLUSH_INTERVAL(10);
+
+    thread_local std::shared_ptr<LogRing> thread_ring;
+
+    ///Time stamp, level and file location of a message
+    void format_prefix(GadgetronLogger* logger, std::string& out, GadgetronLogLevel LEVEL,
+                       std::chrono::system_clock::time_point curtime, const char* filename, int lineno)
+    {
+      if (logger->isOutputOptionEnabled(GADGETRON_LOG_PRINT_DATETIME)) {
+        time_t rawtime;
+        struct tm timebuf;
+        struct tm * timeinfo = &timebuf;
+
+        rawtime = std::chrono::system_clock::to_time_t(curtime);
+#ifdef _WIN32
+        localtime_s ( timeinfo, &rawtime );
+#else
+        localtime_r ( &rawtime, timeinfo );
+#endif
+
+        auto duration = curtime.time_since_epoch();
+        int micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count() % 1000000;
+
+        //Time the format MM-DD HH:MM:SS.uuu
+        char timestr[22];sprintf(timestr, "%02d-%02d %02d:%02d:%02d.%03d ",
+                                 timeinfo->tm_mon+1, timeinfo->tm_mday,
+                                 timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, micros/1000);
+
+        out += std::string(timestr);
+      }
+
+      if (logger->isOutputOptionEnabled(GADGETRON_LOG_PRINT_LEVEL)) {
+        switch (LEVEL) {
+        case GADGETRON_LOG_LEVEL_DEBUG:
+          out += "DEBUG ";
+          break;
+        case GADGETRON_LOG_LEVEL_INFO:
+          out += "INFO ";
+          break;
+        case GADGETRON_LOG_LEVEL_WARNING:
+          out += "WARNING ";
+          break;
+        case GADGETRON_LOG_LEVEL_ERROR:
+          out += "ERROR ";
+          break;
+        default:
+          ;
+        }
+      }
+
+      if (logger->isOutputOptionEnabled(GADGETRON_LOG_PRINT_FILELOC)) {
+        const char* base_start = filename;
+        if (!logger->isOutputOptionEnabled(GADGETRON_LOG_PRINT_FOLDER)) {
+          base_start = strrchr(filename,'/');
+          if (!base_start) {
+            base_start = strrchr(filename,'\\'); //Maybe using backslashes
+          }
+          base_start = base_start ? base_start + 1 : filename;
+        }
+        char linenostr[16];sprintf(linenostr, "%d", lineno);
+        out += std::string("[") + std::string(base_start);
+        out += std::string(":") + std::string(linenostr);
+        out += std::string("] ");
+      }
+    }
+
+    ///Formats the message into out, replacing it, reuses the capacity of out
+    void format_message(std::string& out, const char* cformatting, va_list args)
+    {
+      va_list args_copy;
+      va_copy(args_copy, args);
+
+      size_t avail = std::max(out.capacity(), (size_t)256);
+      out.resize(avail);
+      int n = vsnprintf(&out[0], avail, cformatting, args);
+      if (n < 0) {
+        out.clear();
+      } else if ((size_t)n >= avail) {
+        out.resize(n + 1);
+        vsnprintf(&out[0], n + 1, cformatting, args_copy);
+        out.resize(n);
+      } else {
+        out.resize(n);
+      }
+
+      va_end(args_copy);
+    }
+  }
+
+  struct GadgetronLogger::AsyncState
+  {
+    AsyncState() : active(false), seq(0), batch(256), stop(false) {}
+
+    std::atomic<bool> active;
+    std::atomic<unsigned long long> seq;
+
+    //rings of all threads that have logged, kept until drained after the thread has gone
+    std::mutex rings_mutex;
+    std::vector< std::shared_ptr<LogRing> > rings;
+
+    std::mutex drain_mutex;
+    std::vector<LogRecord> batch;
+    std::string output;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stop;
+    std::thread flusher;
+
+    ///Writes all published records in the order they were logged
+    void drain(GadgetronLogger* logger)
+    {
+      std::lock_guard<std::mutex> guard(drain_mutex);
+
+      std::vector< std::shared_ptr<LogRing> > current;
+      {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        current = rings;
+      }
+
+      size_t n = 0;
+      for (size_t k = 0; k < current.size(); k++) n = current[k]->pop_all(batch, n);
+      current.clear();
+
+      if (n > 0) {
+        std::sort(batch.begin(), batch.begin() + n);
+
+        output.clear();
+        for (size_t k = 0; k < n; k++) {
+          format_prefix(logger, output, batch[k].level, batch[k].time, batch[k].filename, batch[k].lineno);
+          output += batch[k].message;
+        }
+        fwrite(output.data(), 1, output.size(), stdout);
+        fflush(stdout);
+      }
+
+      //forget the rings of threads that have exited
+      std::lock_guard<std::mutex> lock(rings_mutex);
+      for (size_t k = 0; k < rings.size(); ) {
+        if (rings[k].use_count() == 1 && rings[k]->empty()) {
+          rings[k] = rings.back();
+          rings.pop_back();
+        } else {
+          k++;
+        }
+      }
+    }
+
+    void run(GadgetronLogger* logger)
+    {
+      for (;;) {
+        bool stopping;
+        {
+          std::unique_lock<std::mutex> lock(wake_mutex);
+          if (!stop) wake.wait_for(lock, LOG_FLUSH_INTERVAL);
+          stopping = stop;
+        }
+        drain(logger);
+        if (stopping) break;
+      }
+    }
+
+    void notify()
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex);
+      wake.notify_one();
+    }
+  };
+
+  namespace
+  {
+    void stop_asynchronous_output_at_exit()
+    {
+      GadgetronLogger::instance()->disableAsynchronousOutput();
+    }
+  }
+
   GadgetronLogger* GadgetronLogger::instance()
   {
-    if (!instance_) instance_ = new GadgetronLogger();
-    return instance_;
+    //thread safe initialisation, the first message may come from any thread
+    static GadgetronLogger* logger = (instance_ = new GadgetronLogger());
+    return logger;
   }
   
   GadgetronLogger* GadgetronLogger::instance_ = NULL;
   
   GadgetronLogger::GadgetronLogger()
-    : level_mask_(GADGETRON_LOG_LEVEL_MAX,false)
+    : level_bits_(0)
     , print_mask_(GADGETRON_LOG_PRINT_MAX, false)
+    , async_(NULL)
   {
     char* log_mask = getenv(GADGETRON_LOG_MASK_ENVIRONMENT);
     if ( log_mask != NULL) {
@@ -31,29 +286,29 @@ namespace Gadgetron
       if (log_mask_str.find("ALL") != std::string::npos) {
 	enableAllOutputOptions();
 	enableAllLogLevels();
-	return;
-      }
-      
-      if (log_mask_str.find("LEVEL_DEBUG") != std::string::npos) 
-	enableLogLevel(GADGETRON_LOG_LEVEL_DEBUG);
+      } else {
 
-      if (log_mask_str.find("LEVEL_INFO") != std::string::npos) 
-	enableLogLevel(GADGETRON_LOG_LEVEL_INFO);
+        if (log_mask_str.find("LEVEL_DEBUG") != std::string::npos) 
+	  enableLogLevel(GADGETRON_LOG_LEVEL_DEBUG);
 
-      if (log_mask_str.find("LEVEL_WARNING") != std::string::npos) 
-	enableLogLevel(GADGETRON_LOG_LEVEL_WARNING);
+        if (log_mask_str.find("LEVEL_INFO") != std::string::npos) 
+	  enableLogLevel(GADGETRON_LOG_LEVEL_INFO);
 
-      if (log_mask_str.find("LEVEL_ERROR") != std::string::npos) 
-	enableLogLevel(GADGETRON_LOG_LEVEL_ERROR);
+        if (log_mask_str.find("LEVEL_WARNING") != std::string::npos) 
+	  enableLogLevel(GADGETRON_LOG_LEVEL_WARNING);
 
-      if (log_mask_str.find("PRINT_FILELOC") != std::string::npos) 
-	enableOutputOption(GADGETRON_LOG_PRINT_FILELOC);
+        if (log_mask_str.find("LEVEL_ERROR") != std::string::npos) 
+	  enableLogLevel(GADGETRON_LOG_LEVEL_ERROR);
 
-      if (log_mask_str.find("PRINT_LEVEL") != std::string::npos) 
-	enableOutputOption(GADGETRON_LOG_PRINT_LEVEL);
-      
-      if (log_mask_str.find("PRINT_DATETIME") != std::string::npos) 
-	enableOutputOption(GADGETRON_LOG_PRINT_DATETIME);
+        if (log_mask_str.find("PRINT_FILELOC") != std::string::npos) 
+	  enableOutputOption(GADGETRON_LOG_PRINT_FILELOC);
+
+        if (log_mask_str.find("PRINT_LEVEL") != std::string::npos) 
+	  enableOutputOption(GADGETRON_LOG_PRINT_LEVEL);
+
+        if (log_mask_str.find("PRINT_DATETIME") != std::string::npos) 
+	  enableOutputOption(GADGETRON_LOG_PRINT_DATETIME);
+      }
     } else {
       enableLogLevel(GADGETRON_LOG_LEVEL_DEBUG);
       enableLogLevel(GADGETRON_LOG_LEVEL_INFO);
@@ -74,6 +329,11 @@ namespace Gadgetron
          fflush(stdout);
        }
     }
+
+    char *log_async = getenv(GADGETRON_LOG_ASYNC_ENVIRONMENT);
+    if (log_async != NULL && std::string(log_async) != "0") {
+      enableAsynchronousOutput();
+    }
   }
 
 
@@ -82,111 +342,110 @@ namespace Gadgetron
     //Check if we should log this message
     if (!isLevelEnabled(LEVEL)) return;
 
-    const char* fmt = cformatting;
-    std::string fmt_str;
-    bool append_cformatting_needed = false; //Will be set to true if we add any additional labels
-
-    if (isOutputOptionEnabled(GADGETRON_LOG_PRINT_DATETIME)) {
-      time_t rawtime;
-      struct tm * timeinfo;
-
-      auto curtime= std::chrono::system_clock::now();
-      rawtime = std::chrono::system_clock::to_time_t(curtime);
-      timeinfo = localtime ( &rawtime );
-
-      auto duration = curtime.time_since_epoch();
-      int micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count() % 1000000;
-
-      //Time the format MM-DD HH:MM:SS.uuu
-      char timestr[22];sprintf(timestr, "%02d-%02d %02d:%02d:%02d.%03d ",
-			       timeinfo->tm_mon+1, timeinfo->tm_mday,
-			       timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, micros/1000);
-
-      fmt_str += std::string(timestr);
-      append_cformatting_needed = true;
-    }
-
-    if (isOutputOptionEnabled(GADGETRON_LOG_PRINT_LEVEL)) {
-      switch (LEVEL) {
-      case GADGETRON_LOG_LEVEL_DEBUG:
-	fmt_str += "DEBUG ";
-	break;
-      case GADGETRON_LOG_LEVEL_INFO:
-	fmt_str += "INFO ";
-	break;
-      case GADGETRON_LOG_LEVEL_WARNING:
-	fmt_str += "WARNING ";
-	break;
-      case GADGETRON_LOG_LEVEL_ERROR:
-	fmt_str += "ERROR ";
-	break;
-      default:
-	;
+    auto curtime = std::chrono::system_clock::now();
+
+    va_list args;
+    va_start (args, cformatting);
+
+    if (async_ && async_->active.load(std::memory_order_acquire)) {
+      if (!thread_ring) {
+        thread_ring = std::make_shared<LogRing>(LOG_RING_CAPACITY);
+        std::lock_guard<std::mutex> lock(async_->rings_mutex);
+        async_->rings.push_back(thread_ring);
       }
-      append_cformatting_needed = true;
-    }
-
-    if (isOutputOptionEnabled(GADGETRON_LOG_PRINT_FILELOC)) {
-      if (!isOutputOptionEnabled(GADGETRON_LOG_PRINT_FOLDER)) {
-	const char* base_start = strrchr(filename,'/');
-	if (!base_start) {
-	  base_start = strrchr(filename,'\\'); //Maybe using backslashes
-	}
-	if (base_start) {
-	  base_start++;
-	  fmt_str += std::string("[") + std::string(base_start);
-	} else {
-	  std::string("[") + std::string(filename);
-	}
-      } else {
-	fmt_str += std::string("[") + std::string(filename);
+
+      //wait for the flusher rather than drop messages
+      LogRecord* r = thread_ring->reserve();
+      while (!r) {
+        async_->notify();
+        std::this_thread::yield();
+        r = thread_ring->reserve();
       }
-      char linenostr[8];sprintf(linenostr, "%d", lineno);
-      fmt_str += std::string(":") + std::string(linenostr);
-      fmt_str += std::string("] ");
-      append_cformatting_needed = true;
-    }
 
-    if (append_cformatting_needed) {
-      fmt_str += std::string(cformatting); 
-      fmt = fmt_str.c_str();      
+      r->seq = async_->seq.fetch_add(1, std::memory_order_relaxed);
+      r->time = curtime;
+      r->level = LEVEL;
+      r->filename = filename; //__FILE__, lives as long as the program
+      r->lineno = lineno;
+      format_message(r->message, cformatting, args);
+      thread_ring->commit();
+
+      if (LEVEL == GADGETRON_LOG_LEVEL_ERROR) async_->notify();
+    } else {
+      std::string line;
+      format_prefix(this, line, LEVEL, curtime, filename, lineno);
+
+      std::string message;
+      format_message(message, cformatting, args);
+      line += message;
+
+      fwrite(line.data(), 1, line.size(), stdout);
+      fflush(stdout);
     }
 
-    va_list args;
-    va_start (args, cformatting);
-    vprintf(fmt, args);
     va_end (args);
+  }
+
+  void GadgetronLogger::enableAsynchronousOutput()
+  {
+    if (!async_) {
+      async_ = new AsyncState();
+      std::atexit(stop_asynchronous_output_at_exit);
+    }
+    if (async_->active.load()) return;
+
+    async_->stop = false;
+    async_->flusher = std::thread(&AsyncState::run, async_, this);
+    async_->active.store(true, std::memory_order_release);
+  }
+
+  void GadgetronLogger::disableAsynchronousOutput()
+  {
+    if (!async_ || !async_->active.load()) return;
+
+    async_->active.store(false, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(async_->wake_mutex);
+      async_->stop = true;
+      async_->wake.notify_one();
+    }
+    if (async_->flusher.joinable()) async_->flusher.join();
+    async_->drain(this);
+  }
+
+  bool GadgetronLogger::isAsynchronousOutputEnabled() const
+  {
+    return async_ && async_->active.load();
+  }
+
+  void GadgetronLogger::flush()
+  {
+    if (async_) async_->drain(this);
     fflush(stdout);
   }
 
   void GadgetronLogger::enableLogLevel(GadgetronLogLevel LEVEL)
   {
-    if (LEVEL < level_mask_.size()) {
-      level_mask_[LEVEL] = true;
+    if (LEVEL < GADGETRON_LOG_LEVEL_MAX) {
+      level_bits_ |= (1u << LEVEL);
     }
   }
 
   void GadgetronLogger::disableLogLevel(GadgetronLogLevel LEVEL)
   {
-    if (LEVEL < level_mask_.size()) {
-      level_mask_[LEVEL] = false;
+    if (LEVEL < GADGETRON_LOG_LEVEL_MAX) {
+      level_bits_ &= ~(1u << LEVEL);
     }
   }
   
-  bool GadgetronLogger::isLevelEnabled(GadgetronLogLevel LEVEL)
-  {
-    if (LEVEL >= level_mask_.size()) return false;
-    return level_mask_[LEVEL];
-  }
-  
   void GadgetronLogger::enableAllLogLevels()
   {
-    level_mask_.assign(GADGETRON_LOG_LEVEL_MAX,true);
+    level_bits_ = (1u << GADGETRON_LOG_LEVEL_MAX) - 1;
   }
 
   void GadgetronLogger::disableAllLogLevels()
   {
-    level_mask_.assign(GADGETRON_LOG_LEVEL_MAX,false);
+    level_bits_ = 0;
   }
 
   void GadgetronLogger::enableOutputOption(GadgetronLogOutput OUTPUT) 
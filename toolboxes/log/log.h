@@ -9,6 +9,16 @@
 
 #define GADGETRON_LOG_MASK_ENVIRONMENT "GADGETRON_LOG_MASK"
 #define GADGETRON_LOG_FILE_ENVIRONMENT "GADGETRON_LOG_FILE"
+#define GADGETRON_LOG_ASYNC_ENVIRONMENT "GADGETRON_LOG_ASYNC"
+
+/**
+   Log levels below this level are compiled out of the logging macros, e.g. building with
+   -DGADGETRON_LOG_COMPILE_LEVEL=2 leaves only warnings and errors. GVERBOSE is compiled in only
+   if debug messages are. The default keeps all levels.
+ */
+#ifndef GADGETRON_LOG_COMPILE_LEVEL
+#define GADGETRON_LOG_COMPILE_LEVEL 0
+#endif
 
 namespace Gadgetron
 {
@@ -85,6 +95,17 @@ namespace Gadgetron
      
      Any (or no) seperator is allowed between the levels and ourput options.
 
+     By default a message is formatted and written to stdout on the calling thread. If the
+     environment variable GADGETRON_LOG_ASYNC is set to anything but 0 (or
+     @enableAsynchronousOutput is called), the calling thread only formats the message text into
+     a ring buffer of its own; time stamp, level and file location are added and the messages
+     written out by a background thread. Messages are written in the order they were logged,
+     errors wake the background thread straight away. Output still pending when the process
+     exits is flushed, output pending when it crashes is lost.
+
+     The macros check the log level before the arguments are evaluated, a disabled level costs
+     a single test. Levels below GADGETRON_LOG_COMPILE_LEVEL are removed at compile time.
+
    */
   class EXPORTGADGETRONLOG GadgetronLogger
   {
@@ -97,7 +118,10 @@ namespace Gadgetron
 
     void enableLogLevel(GadgetronLogLevel LEVEL);
     void disableLogLevel(GadgetronLogLevel LEVEL);
-    bool isLevelEnabled(GadgetronLogLevel LEVEL);
+    bool isLevelEnabled(GadgetronLogLevel LEVEL) const
+    {
+      return LEVEL < GADGETRON_LOG_LEVEL_MAX && (level_bits_ & (1u << LEVEL)) != 0;
+    }
     void enableAllLogLevels();
     void disableAllLogLevels();
 
@@ -107,19 +131,40 @@ namespace Gadgetron
     void enableAllOutputOptions();
     void disableAllOutputOptions();
 
+    ///Write messages from a background thread, meant to be switched at start up
+    void enableAsynchronousOutput();
+    ///Flushes the pending messages and returns to writing on the calling thread
+    void disableAsynchronousOutput();
+    bool isAsynchronousOutputEnabled() const;
+
+    ///Blocks until all messages logged so far have been written
+    void flush();
+
   protected:
     GadgetronLogger();
     static GadgetronLogger* instance_;
-    std::vector<bool> level_mask_;
+    unsigned int level_bits_;
     std::vector<bool> print_mask_;
+
+    struct AsyncState;
+    AsyncState* async_;
   };
 }
 
-#define GDEBUG(...)   Gadgetron::GadgetronLogger::instance()->log(Gadgetron::GADGETRON_LOG_LEVEL_DEBUG,   __FILE__, __LINE__, __VA_ARGS__)
-#define GINFO(...)    Gadgetron::GadgetronLogger::instance()->log(Gadgetron::GADGETRON_LOG_LEVEL_INFO,    __FILE__, __LINE__, __VA_ARGS__)
-#define GWARN(...)    Gadgetron::GadgetronLogger::instance()->log(Gadgetron::GADGETRON_LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
-#define GERROR(...)   Gadgetron::GadgetronLogger::instance()->log(Gadgetron::GADGETRON_LOG_LEVEL_ERROR,   __FILE__, __LINE__, __VA_ARGS__)
-#define GVERBOSE(...) Gadgetron::GadgetronLogger::instance()->log(Gadgetron::GADGETRON_LOG_LEVEL_VERBOSE,   __FILE__, __LINE__, __VA_ARGS__)
+#define GADGETRON_LOG_COMPILED_IN(LEVEL) \
+  ((LEVEL) == Gadgetron::GADGETRON_LOG_LEVEL_VERBOSE ? GADGETRON_LOG_COMPILE_LEVEL <= 0 : (LEVEL) >= GADGETRON_LOG_COMPILE_LEVEL)
+
+#define GADGETRON_LOG_ENABLED(LEVEL) \
+  (GADGETRON_LOG_COMPILED_IN(LEVEL) && Gadgetron::GadgetronLogger::instance()->isLevelEnabled(LEVEL))
+
+#define GADGETRON_LOG(LEVEL, ...) \
+  (GADGETRON_LOG_ENABLED(LEVEL) ? Gadgetron::GadgetronLogger::instance()->log(LEVEL, __FILE__, __LINE__, __VA_ARGS__) : (void)0)
+
+#define GDEBUG(...)   GADGETRON_LOG(Gadgetron::GADGETRON_LOG_LEVEL_DEBUG,   __VA_ARGS__)
+#define GINFO(...)    GADGETRON_LOG(Gadgetron::GADGETRON_LOG_LEVEL_INFO,    __VA_ARGS__)
+#define GWARN(...)    GADGETRON_LOG(Gadgetron::GADGETRON_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define GERROR(...)   GADGETRON_LOG(Gadgetron::GADGETRON_LOG_LEVEL_ERROR,   __VA_ARGS__)
+#define GVERBOSE(...) GADGETRON_LOG(Gadgetron::GADGETRON_LOG_LEVEL_VERBOSE, __VA_ARGS__)
 
 #define GEXCEPTION(err, message);	  \
   {					  \
@@ -129,42 +174,21 @@ namespace Gadgetron
     GDEBUG(gdb.c_str());		  \
  }
 
-//Stream syntax log level functions
-#define GDEBUG_STREAM(message)				\
-  {							\
-    std::stringstream gadget_msg_dep_str;		\
-    gadget_msg_dep_str  << message << std::endl;	\
-    GDEBUG(gadget_msg_dep_str.str().c_str());		\
+//Stream syntax log level functions, the message is only built if the level is enabled
+#define GADGETRON_LOG_STREAM(LEVEL, message)					\
+  {										\
+    if (GADGETRON_LOG_ENABLED(LEVEL)) {						\
+      std::stringstream gadget_msg_dep_str;					\
+      gadget_msg_dep_str  << message << std::endl;				\
+      GADGETRON_LOG(LEVEL, "%s", gadget_msg_dep_str.str().c_str());		\
+    }										\
   }
 
-#define GINFO_STREAM(message)				\
-  {							\
-    std::stringstream gadget_msg_dep_str;		\
-    gadget_msg_dep_str  << message << std::endl;	\
-    GINFO(gadget_msg_dep_str.str().c_str());		\
-  }
-
-#define GWARN_STREAM(message)					\
-  {								\
-    std::stringstream gadget_msg_dep_str;			\
-    gadget_msg_dep_str  << message << std::endl;		\
-    GWARN(gadget_msg_dep_str.str().c_str());			\
-  }
-
-#define GERROR_STREAM(message)					\
-  {								\
-    std::stringstream gadget_msg_dep_str;			\
-    gadget_msg_dep_str  << message << std::endl;		\
-    GERROR(gadget_msg_dep_str.str().c_str());			\
-  }
-
-#define GVERBOSE_STREAM(message)					\
-  {								\
-    std::stringstream gadget_msg_dep_str;			\
-    gadget_msg_dep_str  << message << std::endl;		\
-    GVERBOSE(gadget_msg_dep_str.str().c_str());			\
-  }
-     
+#define GDEBUG_STREAM(message)   GADGETRON_LOG_STREAM(Gadgetron::GADGETRON_LOG_LEVEL_DEBUG,   message)
+#define GINFO_STREAM(message)    GADGETRON_LOG_STREAM(Gadgetron::GADGETRON_LOG_LEVEL_INFO,    message)
+#define GWARN_STREAM(message)    GADGETRON_LOG_STREAM(Gadgetron::GADGETRON_LOG_LEVEL_WARNING, message)
+#define GERROR_STREAM(message)   GADGETRON_LOG_STREAM(Gadgetron::GADGETRON_LOG_LEVEL_ERROR,   message)
+#define GVERBOSE_STREAM(message) GADGETRON_LOG_STREAM(Gadgetron::GADGETRON_LOG_LEVEL_VERBOSE, message)
 
 //Older debugging macros
 //TODO: Review and check that they are up to date
@@ -40,11 +40,13 @@ template<class T> struct MatlabConverter {
 		for (size_t i = 0; i < ndim; i++)
 			dims[i] = input->get_size(i);
 
-		T* raw_data = (T*) mxCalloc(input->get_number_of_elements(),sizeof(T));
+		// no need to zero the memory, all of it is written below
+		T* raw_data = (T*) mxMalloc(input->get_number_of_bytes());
 		memcpy(raw_data,input->get_data_ptr(),input->get_number_of_bytes());
 		auto result =  mxCreateNumericMatrix(0,0,MatlabClassID<T>::value,isComplex<T>::value);
 		mxSetDimensions(result,dims,ndim);
 		mxSetData(result,raw_data);
+		delete [] dims;
 		return result;
 
 	}
@@ -156,19 +158,22 @@ template<class REAL> struct MatlabConverter<complext<REAL>> {
 		for (size_t i = 0; i < ndim; i++)
 			dims[i] = input->get_size(i);
 
-		REAL* real_data = (REAL*) mxCalloc(input->get_number_of_elements(),sizeof(REAL));
-		REAL* imag_data = (REAL*) mxCalloc(input->get_number_of_elements(),sizeof(REAL));
+		// Matlab keeps real and imaginary parts apart, the split below writes all of the memory
+		size_t N = input->get_number_of_elements();
+		REAL* real_data = (REAL*) mxMalloc(N*sizeof(REAL));
+		REAL* imag_data = (REAL*) mxMalloc(N*sizeof(REAL));
 
-		complext<REAL>* raw_data = input->get_data_ptr();
-		for (size_t i = 0; i < input->get_number_of_elements(); i++){
-			real_data[i] = real(raw_data[i]);
-			imag_data[i] = imag(raw_data[i]);
+		const REAL* raw_data = reinterpret_cast<const REAL*>(input->get_data_ptr());
+		for (size_t i = 0; i < N; i++){
+			real_data[i] = raw_data[2*i];
+			imag_data[i] = raw_data[2*i+1];
 		}
 
 		auto result  =  mxCreateNumericMatrix(0,0,MatlabClassID<REAL>::value,isComplex<complext<REAL>>::value);
 		mxSetDimensions(result,dims,ndim);
 		mxSetData(result,real_data);
 		mxSetImagData(result,imag_data);
+		delete [] dims;
 
 		auto ndims_test = mxGetNumberOfDimensions(result); // LA: shouldn't this be removed ?
 
@@ -790,6 +795,7 @@ mxArray* GetSplitReconData(IsmrmrdDataBuffered* buffer, size_t index_begin, size
     mxSetDimensions(mxdata, packet_dims, packet_ndim);
     mxSetData      (mxdata, real_data);
     mxSetImagData  (mxdata, imag_data);
+    delete [] packet_dims;
     
     return mxdata;
 }
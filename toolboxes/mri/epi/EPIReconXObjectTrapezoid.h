@@ -26,6 +26,12 @@ template <typename T> class EPIReconXObjectTrapezoid : public EPIReconXObject<T>
   virtual int apply(ISMRMRD::AcquisitionHeader &hdr_in, hoNDArray <T> &data_in, 
 		    ISMRMRD::AcquisitionHeader &hdr_out, hoNDArray <T> &data_out);
 
+  // Resamples a batch of readouts of the same polarity with one matrix-matrix product.
+  // data_in holds the readouts one after the other (e.g. [numSamples_ CHA N]), data_out is
+  // resized to [reconNx_ CHA*N] unless it has that size already. The reverse flag of hdr_in
+  // selects the operator, as in apply().
+  int applyBatch(ISMRMRD::AcquisitionHeader &hdr_in, hoNDArray <T> &data_in, hoNDArray <T> &data_out);
+
   using EPIReconXObject<T>::filterPos_;
   using EPIReconXObject<T>::filterNeg_;
   using EPIReconXObject<T>::slicePosition;
@@ -52,6 +58,7 @@ template <typename T> class EPIReconXObjectTrapezoid : public EPIReconXObject<T>
   bool operatorComputed_;
 
   float calcOffCenterDistance(ISMRMRD::AcquisitionHeader& hdr_in);
+  void computeOperator(ISMRMRD::AcquisitionHeader& hdr_in);
 };
 
 template <typename T> EPIReconXObjectTrapezoid<T>::EPIReconXObjectTrapezoid()
@@ -153,103 +160,108 @@ template <typename T> int EPIReconXObjectTrapezoid<T>::computeTrajectory()
 }
 
 
-template <typename T> int EPIReconXObjectTrapezoid<T>::apply(ISMRMRD::AcquisitionHeader &hdr_in, hoNDArray <T> &data_in, 
-		    ISMRMRD::AcquisitionHeader &hdr_out, hoNDArray <T> &data_out)
+template <typename T> void EPIReconXObjectTrapezoid<T>::computeOperator(ISMRMRD::AcquisitionHeader &hdr_in)
 {
-  if (!operatorComputed_) {
-    // Compute the reconstruction operator
-    int Km = floor(encodeNx_ / 2.0);
-    int Ne = 2*Km + 1;
-    int p,q; // counters
-
-    // resize the reconstruction operator
-    Mpos_.create(reconNx_,numSamples_);
-    Mneg_.create(reconNx_,numSamples_);
-
-    // evenly spaced k-space locations
-    arma::vec keven = arma::linspace<arma::vec>(-Km, Km, Ne);
-    //keven.print("keven =");
-
-    // image domain locations [-0.5,...,0.5)
-    arma::vec x = arma::linspace<arma::vec>(-0.5,(reconNx_-1.)/(2.*reconNx_),reconNx_);
-    //x.print("x =");
-
-    // DFT operator
-    // Going from k space to image space, we use the IFFT sign convention
-    arma::cx_mat F(reconNx_, Ne);
-    double fftscale = 1.0 / std::sqrt((double)Ne);
-    for (p=0; p<reconNx_; p++) {
-      for (q=0; q<Ne; q++) {
+  int Km = floor(encodeNx_ / 2.0);
+  int Ne = 2*Km + 1;
+  int p,q; // counters
+
+  // resize the reconstruction operator
+  Mpos_.create(reconNx_,numSamples_);
+  Mneg_.create(reconNx_,numSamples_);
+
+  // evenly spaced k-space locations
+  arma::vec keven = arma::linspace<arma::vec>(-Km, Km, Ne);
+  //keven.print("keven =");
+
+  // image domain locations [-0.5,...,0.5)
+  arma::vec x = arma::linspace<arma::vec>(-0.5,(reconNx_-1.)/(2.*reconNx_),reconNx_);
+  //x.print("x =");
+
+  // DFT operator
+  // Going from k space to image space, we use the IFFT sign convention
+  arma::cx_mat F(reconNx_, Ne);
+  double fftscale = 1.0 / std::sqrt((double)Ne);
+  for (p=0; p<reconNx_; p++) {
+    for (q=0; q<Ne; q++) {
 	F(p,q) = fftscale * std::exp(std::complex<double>(0.0,1.0*2*M_PI*keven(q)*x(p)));
-      }
     }
-    //F.print("F =");
-
-    // forward operators
-    arma::mat Qp(numSamples_, Ne);
-    arma::mat Qn(numSamples_, Ne);
-    for (p=0; p<numSamples_; p++) {
-      //GDEBUG_STREAM(trajectoryPos_(p) << "    " << trajectoryNeg_(p) << std::endl);
-      for (q=0; q<Ne; q++) {
+  }
+  //F.print("F =");
+
+  // forward operators
+  arma::mat Qp(numSamples_, Ne);
+  arma::mat Qn(numSamples_, Ne);
+  for (p=0; p<numSamples_; p++) {
+    //GDEBUG_STREAM(trajectoryPos_(p) << "    " << trajectoryNeg_(p) << std::endl);
+    for (q=0; q<Ne; q++) {
 	Qp(p,q) = sinc(trajectoryPos_(p)-keven(q));
 	Qn(p,q) = sinc(trajectoryNeg_(p)-keven(q));
-      }
     }
+  }
 
-    //Qp.print("Qp =");
-    //Qn.print("Qn =");
-
-    // recon operators
-    arma::cx_mat Mp(reconNx_,numSamples_);
-    arma::cx_mat Mn(reconNx_,numSamples_);
-    Mp = F * arma::pinv(Qp);
-    Mn = F * arma::pinv(Qn);
-
-    /////    Compute the off-center correction:     /////
-
-    // Compute the off-center distance in the RO direction:
-    float roOffCenterDistance = calcOffCenterDistance( hdr_in );
-
-    arma::Col<typename realType<T>::Type> my_keven = arma::linspace< arma::Col<typename realType<T>::Type> >(0, numSamples_ -1, numSamples_);
-    // find the offset:
-    // PV: maybe find not just exactly 0, but a very small number?
-    arma::Col<typename realType<T>::Type> trajectoryPosArma = as_arma_col(&trajectoryPos_);
-    arma::uvec n = find( trajectoryPosArma==0, 1, "first");
-    my_keven -= arma::as_scalar(n);
-    // Scale it:
-    // We have to find the maximum k-trajectory (absolute) increment:
-    arma::Col<typename realType<T>::Type> Delta_k = arma::abs( trajectoryPosArma.subvec(1,numSamples_-1) - trajectoryPosArma.subvec(0,numSamples_-2) );
-    my_keven *= Delta_k.max();
-
-    // off-center corrections:
-    arma::Col<T> myExponent = arma::zeros< arma::Col<T> >(numSamples_);
-    myExponent.set_imag( 2*M_PI*roOffCenterDistance/encodeFOV_*(trajectoryPosArma-my_keven) );
-    arma::Col<T> offCenterCorrN = arma::exp( myExponent );
-    myExponent.set_imag( 2*M_PI*roOffCenterDistance/encodeFOV_*(as_arma_col(&trajectoryNeg_)+my_keven) );
-    arma::Col<T> offCenterCorrP = arma::exp( myExponent );
-
-    //    GDEBUG_STREAM("roOffCenterDistance_: " << roOffCenterDistance_ << ";       encodeFOV_: " << encodeFOV_);
-    //    for (q=0; q<numSamples_; q++) {
-    //      GDEBUG_STREAM("keven(" << q << "): " << my_keven(q) << ";       trajectoryPosArma(" << q << "): " << trajectoryPosArma(q) );
-    //      GDEBUG_STREAM("offCenterCorrP(" << q << "):" << offCenterCorrP(q) );
-    //    }
-
-    // Finally, combine the off-center correction with the recon operator:
-    Mp = Mp * diagmat(offCenterCorrP);
-    Mn = Mn * diagmat(offCenterCorrN);
-    // and save it into the NDArray members:
-    for (p=0; p<reconNx_; p++) {
-      for (q=0; q<numSamples_; q++) {
-        Mpos_(p,q) = Mp(p,q);
-        Mneg_(p,q) = Mn(p,q);
-      }
+  //Qp.print("Qp =");
+  //Qn.print("Qn =");
+
+  // recon operators
+  arma::cx_mat Mp(reconNx_,numSamples_);
+  arma::cx_mat Mn(reconNx_,numSamples_);
+  Mp = F * arma::pinv(Qp);
+  Mn = F * arma::pinv(Qn);
+
+  /////    Compute the off-center correction:     /////
+
+  // Compute the off-center distance in the RO direction:
+  float roOffCenterDistance = calcOffCenterDistance( hdr_in );
+
+  arma::Col<typename realType<T>::Type> my_keven = arma::linspace< arma::Col<typename realType<T>::Type> >(0, numSamples_ -1, numSamples_);
+  // find the offset:
+  // PV: maybe find not just exactly 0, but a very small number?
+  arma::Col<typename realType<T>::Type> trajectoryPosArma = as_arma_col(&trajectoryPos_);
+  arma::uvec n = find( trajectoryPosArma==0, 1, "first");
+  my_keven -= arma::as_scalar(n);
+  // Scale it:
+  // We have to find the maximum k-trajectory (absolute) increment:
+  arma::Col<typename realType<T>::Type> Delta_k = arma::abs( trajectoryPosArma.subvec(1,numSamples_-1) - trajectoryPosArma.subvec(0,numSamples_-2) );
+  my_keven *= Delta_k.max();
+
+  // off-center corrections:
+  arma::Col<T> myExponent = arma::zeros< arma::Col<T> >(numSamples_);
+  myExponent.set_imag( 2*M_PI*roOffCenterDistance/encodeFOV_*(trajectoryPosArma-my_keven) );
+  arma::Col<T> offCenterCorrN = arma::exp( myExponent );
+  myExponent.set_imag( 2*M_PI*roOffCenterDistance/encodeFOV_*(as_arma_col(&trajectoryNeg_)+my_keven) );
+  arma::Col<T> offCenterCorrP = arma::exp( myExponent );
+
+  //    GDEBUG_STREAM("roOffCenterDistance_: " << roOffCenterDistance_ << ";       encodeFOV_: " << encodeFOV_);
+  //    for (q=0; q<numSamples_; q++) {
+  //      GDEBUG_STREAM("keven(" << q << "): " << my_keven(q) << ";       trajectoryPosArma(" << q << "): " << trajectoryPosArma(q) );
+  //      GDEBUG_STREAM("offCenterCorrP(" << q << "):" << offCenterCorrP(q) );
+  //    }
+
+  // Finally, combine the off-center correction with the recon operator:
+  Mp = Mp * diagmat(offCenterCorrP);
+  Mn = Mn * diagmat(offCenterCorrN);
+  // and save it into the NDArray members:
+  for (p=0; p<reconNx_; p++) {
+    for (q=0; q<numSamples_; q++) {
+      Mpos_(p,q) = Mp(p,q);
+      Mneg_(p,q) = Mn(p,q);
     }
-    
-    //Mp.print("Mp =");
-    //Mn.print("Mn =");
+  }
+  
+  //Mp.print("Mp =");
+  //Mn.print("Mn =");
+
+  // set the operator computed flag
+  operatorComputed_ = true;
+}
 
-    // set the operator computed flag
-    operatorComputed_ = true;
+template <typename T> int EPIReconXObjectTrapezoid<T>::apply(ISMRMRD::AcquisitionHeader &hdr_in, hoNDArray <T> &data_in, 
+		    ISMRMRD::AcquisitionHeader &hdr_out, hoNDArray <T> &data_out)
+{
+  if (!operatorComputed_) {
+    // Compute the reconstruction operator
+    computeOperator(hdr_in);
   }
 
   // convert to armadillo representation of matrices and vectors
@@ -275,6 +287,30 @@ template <typename T> int EPIReconXObjectTrapezoid<T>::apply(ISMRMRD::Acquisitio
   return 0;
 }
 
+template <typename T> int EPIReconXObjectTrapezoid<T>::applyBatch(ISMRMRD::AcquisitionHeader &hdr_in, hoNDArray <T> &data_in, hoNDArray <T> &data_out)
+{
+  if (!operatorComputed_) {
+    computeOperator(hdr_in);
+  }
+
+  if (data_in.get_size(0) != (size_t)numSamples_) {
+    GERROR_STREAM("EPIReconXObjectTrapezoid::applyBatch, expected " << numSamples_ << " samples per readout, got " << data_in.get_size(0));
+    return -1;
+  }
+
+  // All readouts of the batch as the columns of one matrix
+  size_t N = data_in.get_number_of_elements() / numSamples_;
+  hoNDArray<T> in(numSamples_, N, data_in.begin());
+
+  if (hdr_in.isFlagSet(ISMRMRD::ISMRMRD_ACQ_IS_REVERSE)) {
+    Gadgetron::gemm(data_out, Mneg_, in);
+  } else {
+    Gadgetron::gemm(data_out, Mpos_, in);
+  }
+
+  return 0;
+}
+
 template <typename T> float EPIReconXObjectTrapezoid<T>::calcOffCenterDistance(ISMRMRD::AcquisitionHeader& hdr_in)
 {
   // armadillo vectors with the position and readout direction:
@@ -10,6 +10,8 @@
 #include "cuNDArray_math.h"
 #include "CSI_utils.h"
 
+#include <boost/make_shared.hpp>
+
 namespace Gadgetron {
 
 
@@ -27,31 +29,28 @@ template<class T> CSIOperator<T>::~CSIOperator() {
 }
 
 
+template<class T> cuNDArray<complext<T>>* CSIOperator<T>::spectral_buffer(std::vector<size_t> dims){
+	//The codomain of the spatial operator has the frequencies in place of the echoes; the buffer stays on the device between the solver iterations
+	dims[1] = frequencies.size();
+	if (!tmp_ || *tmp_->get_dimensions() != dims)
+		tmp_ = boost::make_shared<cuNDArray<complext<T>>>(dims);
+	return tmp_.get();
+}
+
 template<class T> void CSIOperator<T>::mult_MH(cuNDArray<complext<T>> *in , cuNDArray<complext<T>> * out, bool accumulate){
 
-	std::vector<size_t> kdim = *in->get_dimensions();
-	kdim[1] =frequencies.size(); //Set to number of time samples rather than number of frequencies
-	cuNDArray<complext<T>> tmp(kdim);
-	//senseOp->mult_MH(in,out,accumulate);
+	cuNDArray<complext<T>>* tmp = spectral_buffer(*in->get_dimensions());
 
-	CSI_dft(&tmp,in,&frequencies,dtt_,dte_);
-	senseOp->mult_MH(&tmp,out,accumulate);
-	//cuNDFFT<float>::instance()->fft(&tmp,0u); //FFT along the TE dimension
+	CSI_dft(tmp,in,&frequencies,dtt_,dte_);
+	senseOp->mult_MH(tmp,out,accumulate);
 }
 
 template<class T> void CSIOperator<T>::mult_M(cuNDArray<complext<T>> *in , cuNDArray<complext<T>> * out, bool accumulate){
-	cuNDArray<complext<T>>* out_tmp = out;
-	if (accumulate) out_tmp = new cuNDArray<complext<T>>(out->get_dimensions());
-	std::vector<size_t> kdim = *out->get_dimensions();
-	kdim[1] =frequencies.size();
-	cuNDArray<complext<T>> tmp(kdim);
-	senseOp->mult_M(in,&tmp,accumulate);
-
-	CSI_dftH(&tmp,out_tmp,&frequencies,dtt_,dte_);
-	if (accumulate){
-		*out += *out_tmp;
-		delete out_tmp;
-	}
+
+	cuNDArray<complext<T>>* tmp = spectral_buffer(*out->get_dimensions());
+
+	senseOp->mult_M(in,tmp,false);
+	CSI_dftH(tmp,out,&frequencies,dtt_,dte_,accumulate);
 }
 
 
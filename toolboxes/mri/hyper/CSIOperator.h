@@ -34,10 +34,18 @@ public:
 	T get_pointtime(){return dtt_;}
 
 protected:
+	/**
+	 * Device buffer between the spatial (senseOp) and the spectral (CSI_dft) part of the operator,
+	 * with the dimensions dims of the data and the frequencies in the second dimension.
+	 * It is allocated once and reused by every application of the operator.
+	 */
+	cuNDArray<complext<T>>* spectral_buffer(std::vector<size_t> dims);
+
 	boost::shared_ptr<linearOperator<cuNDArray<complext<T>>>> senseOp;
 	T dte_; //Time between echoes
 	T dtt_; //Time between k-space points
 	thrust::device_vector<T> frequencies;
+	boost::shared_ptr<cuNDArray<complext<T>>> tmp_;
 };
 
 } /* namespace Gadgetron */
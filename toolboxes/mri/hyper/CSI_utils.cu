@@ -10,93 +10,96 @@
 using namespace Gadgetron;
 
 
-template<class T> static __global__ void dft_kernel(complext<T>* __restrict__ kspace, const complext<T>* __restrict__ tspace, T* __restrict__ frequencies, unsigned int spiral_length, unsigned int echoes, unsigned int nfreqs,T dte, T dtt){
-	const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x + threadIdx.x;
-	if (idx < spiral_length*nfreqs ){
+/**
+ * The kernels run over all batches (e.g. coils) in one launch, with a grid stride loop over the elements of all batches.
+ * The phase factors along the summation are advanced by a complex rotation per step instead of a complex exponential,
+ * and the normalization by the number of echoes and the accumulation are applied on the write of the result.
+ */
+template<class T> static __global__ void dft_kernel(complext<T>* __restrict__ kspace, const complext<T>* __restrict__ tspace, const T* __restrict__ frequencies, unsigned int spiral_length, unsigned int echoes, unsigned int nfreqs, size_t batches, T dte, T dtt, T scale, bool accumulate){
+	const size_t k_elements = size_t(spiral_length)*nfreqs;
+	const size_t t_elements = size_t(spiral_length)*echoes;
+	for (size_t idx = size_t(blockIdx.x)*blockDim.x + threadIdx.x; idx < k_elements*batches; idx += size_t(blockDim.x)*gridDim.x){
+		const size_t batch = idx/k_elements;
+		const size_t k = idx%k_elements;
+		const unsigned int kpoint = k%spiral_length;
+		const T frequency = frequencies[k/spiral_length];
+		const complext<T>* t = tspace + batch*t_elements + kpoint;
+
+		complext<T> w = exp(complext<T>(0,-frequency*2*CUDART_PI_F*dtt*kpoint));
+		const complext<T> step = exp(complext<T>(0,-frequency*2*CUDART_PI_F*dte));
 		complext<T> result = 0;
-		T frequency = frequencies[idx/spiral_length];
-		T time_offset = dtt*(idx%spiral_length);
-		unsigned int kpoint = idx%spiral_length;
-		for (unsigned int i =0; i < echoes; i++){
-			result += exp(complext<T>(0,-frequency*2*CUDART_PI_F*(dte*i+time_offset)))*tspace[kpoint+i*spiral_length];
+		for (unsigned int i = 0; i < echoes; i++){
+			result += w*t[i*spiral_length];
+			w *= step;
 		}
-		kspace[idx] = result;
+
+		if (accumulate)
+			kspace[idx] += result*scale;
+		else
+			kspace[idx] = result*scale;
 	}
 }
 
-template<class T> static __global__ void dftH_kernel(const complext<T>* __restrict__ kspace, complext<T>* __restrict__ tspace, T* __restrict__ frequencies, unsigned int spiral_length, unsigned int echoes, unsigned int nfreqs,T dte, T dtt){
-	const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x + threadIdx.x;
-	if (idx < spiral_length*echoes ){
+template<class T> static __global__ void dftH_kernel(const complext<T>* __restrict__ kspace, complext<T>* __restrict__ tspace, const T* __restrict__ frequencies, unsigned int spiral_length, unsigned int echoes, unsigned int nfreqs, size_t batches, T dte, T dtt, T scale, bool accumulate){
+	const size_t k_elements = size_t(spiral_length)*nfreqs;
+	const size_t t_elements = size_t(spiral_length)*echoes;
+	for (size_t idx = size_t(blockIdx.x)*blockDim.x + threadIdx.x; idx < t_elements*batches; idx += size_t(blockDim.x)*gridDim.x){
+		const size_t batch = idx/t_elements;
+		const size_t t = idx%t_elements;
+		const unsigned int kpoint = t%spiral_length;
+		const T timeshift = dte*(t/spiral_length)+dtt*kpoint;
+		const complext<T>* kp = kspace + batch*k_elements + kpoint;
+
 		complext<T> result = 0;
-		unsigned int kpoint = idx%spiral_length;
-		T timeshift = dte*(idx/spiral_length)+dtt*kpoint;
-		for (unsigned int i =0; i < nfreqs; i++){
-			result += exp(complext<T>(0,frequencies[i]*2*CUDART_PI_F*timeshift))*kspace[kpoint+i*spiral_length];
+		for (unsigned int i = 0; i < nfreqs; i++){
+			result += exp(complext<T>(0,frequencies[i]*2*CUDART_PI_F*timeshift))*kp[i*spiral_length];
 		}
-		tspace[idx] = result;
+
+		if (accumulate)
+			tspace[idx] += result*scale;
+		else
+			tspace[idx] = result*scale;
 	}
 }
 
+//Launch configuration of the grid stride loops
+static void csi_launch_dims(size_t elements, dim3& dimGrid, dim3& dimBlock){
+	int threadsPerBlock = std::min<size_t>(std::max<size_t>(elements,1),cudaDeviceManager::Instance()->max_blockdim());
+	size_t blocks = (elements+threadsPerBlock-1)/threadsPerBlock;
+	dimBlock = dim3(threadsPerBlock);
+	dimGrid = dim3(std::max<size_t>(std::min<size_t>(blocks,cudaDeviceManager::Instance()->max_griddim()),1));
+}
 
 
 template<class T>
 void Gadgetron::CSI_dft(cuNDArray<complext<T> >* kspace,
-		cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte) {
+		cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte, bool accumulate) {
 
 	size_t elements = kspace->get_size(0)*kspace->get_size(1);
 	size_t batches = kspace->get_number_of_elements()/elements;
-	size_t t_elements = tspace->get_size(0)*tspace->get_size(1);
-	int threadsPerBlock = std::min<int>(elements,cudaDeviceManager::Instance()->max_blockdim());
-	dim3 dimBlock(threadsPerBlock);
-	int totalBlocksPerGrid = (elements+threadsPerBlock-1)/threadsPerBlock;
-	dim3 dimGrid(totalBlocksPerGrid);
-
 	std::vector<size_t> dims = *tspace->get_dimensions();
-	if (totalBlocksPerGrid > cudaDeviceManager::Instance()->max_griddim())
-		throw std::runtime_error("CSIOperator: Input dimensions too large");
-
-	cudaFuncSetCacheConfig(dft_kernel<T>,cudaFuncCachePreferL1);
-	for (int i = 0; i< batches; i++){
-
-		//size_t batchSize = dimGrid.x*dimBlock.x;
-
-		// Invoke kernel
-		dft_kernel<T><<<dimGrid, dimBlock>>>(kspace->get_data_ptr()+i*elements,tspace->get_data_ptr()+i*t_elements,thrust::raw_pointer_cast(frequencies->data()),dims[0],dims[1], frequencies->size(),dte,dtt);
-		CHECK_FOR_CUDA_ERROR();
-		cudaThreadSynchronize();
 
-	}
-
-	*kspace /= T(dims[1]);
+	dim3 dimGrid, dimBlock;
+	csi_launch_dims(elements*batches,dimGrid,dimBlock);
 
+	cudaFuncSetCacheConfig(dft_kernel<T>,cudaFuncCachePreferL1);
+	dft_kernel<T><<<dimGrid, dimBlock>>>(kspace->get_data_ptr(),tspace->get_data_ptr(),thrust::raw_pointer_cast(frequencies->data()),dims[0],dims[1], frequencies->size(),batches,dte,dtt,T(1)/T(dims[1]),accumulate);
+	CHECK_FOR_CUDA_ERROR();
 }
 
 template<class T>
 void Gadgetron::CSI_dftH(cuNDArray<complext<T> >* kspace,
-		cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte) {
-	size_t k_elements = kspace->get_size(0)*kspace->get_size(1);
+		cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte, bool accumulate) {
 	size_t elements = tspace->get_size(0)*tspace->get_size(1);
-
 	size_t batches = tspace->get_number_of_elements()/elements;
-	int threadsPerBlock = std::min<int>(elements,cudaDeviceManager::Instance()->max_blockdim());
-	dim3 dimBlock(threadsPerBlock);
-	int totalBlocksPerGrid = (elements+threadsPerBlock-1)/threadsPerBlock;
-	dim3 dimGrid(totalBlocksPerGrid);
+	std::vector<size_t> dims = *tspace->get_dimensions();
 
-	if (totalBlocksPerGrid > cudaDeviceManager::Instance()->max_griddim())
-		throw std::runtime_error("CSIOperator: Input dimensions too large");
+	dim3 dimGrid, dimBlock;
+	csi_launch_dims(elements*batches,dimGrid,dimBlock);
 
-	//size_t batchSize = dimGrid.x*dimBlock.x;
 	cudaFuncSetCacheConfig(dftH_kernel<T>,cudaFuncCachePreferL1);
-
-	std::vector<size_t> dims = *tspace->get_dimensions();
-
-	for (int i =0; i< batches; i++){
-		// Invoke kernel
-		dftH_kernel<T><<<dimGrid, dimBlock>>>(kspace->get_data_ptr()+i*k_elements,tspace->get_data_ptr()+i*elements,thrust::raw_pointer_cast(frequencies->data()),dims[0],dims[1], frequencies->size(),dte,dtt);
-		CHECK_FOR_CUDA_ERROR();
-	}
-	*tspace /= T(dims[1]);
+	dftH_kernel<T><<<dimGrid, dimBlock>>>(kspace->get_data_ptr(),tspace->get_data_ptr(),thrust::raw_pointer_cast(frequencies->data()),dims[0],dims[1], frequencies->size(),batches,dte,dtt,T(1)/T(dims[1]),accumulate);
+	CHECK_FOR_CUDA_ERROR();
 }
 
 template<class T>
@@ -169,8 +172,8 @@ void Gadgetron::mult_freq(cuNDArray<complext<T> >* in_out, cuNDArray<complext<T>
 
 
 
-template EXPORTHYPER void Gadgetron::CSI_dft<float>(cuNDArray<float_complext>* kspace,cuNDArray<float_complext>* tspace, thrust::device_vector<float>* frequencies, float dtt, float dte);
-template EXPORTHYPER void Gadgetron::CSI_dftH<float>(cuNDArray<float_complext>* kspace,cuNDArray<float_complext>* tspace, thrust::device_vector<float>* frequencies, float dtt, float dte);
+template EXPORTHYPER void Gadgetron::CSI_dft<float>(cuNDArray<float_complext>* kspace,cuNDArray<float_complext>* tspace, thrust::device_vector<float>* frequencies, float dtt, float dte, bool accumulate);
+template EXPORTHYPER void Gadgetron::CSI_dftH<float>(cuNDArray<float_complext>* kspace,cuNDArray<float_complext>* tspace, thrust::device_vector<float>* frequencies, float dtt, float dte, bool accumulate);
 
 
 template EXPORTHYPER boost::shared_ptr<cuNDArray<float_complext> > Gadgetron::calculate_frequency_calibration<float>(cuNDArray<float_complext>* time_track, thrust::device_vector<float>* frequencies,cuNDArray<float_complext> * csm,float dtt,float dte);
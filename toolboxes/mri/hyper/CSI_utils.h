@@ -20,8 +20,10 @@ namespace Gadgetron {
 	 * @param frequencies The frequencies on which to do DFT.
 	 * @param dtt Time step between points in the first dimension of the tspace
 	 * @param dte Time step between points in the second dimension of the tspace
+	 * @param accumulate Add the result to kspace instead of overwriting it
+	 * All batches of the tspace (the dimensions after the second) are transformed in one kernel launch.
 	 */
-	template<class T> EXPORTHYPER void CSI_dft(cuNDArray<complext<T> >* kspace, cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte);
+	template<class T> EXPORTHYPER void CSI_dft(cuNDArray<complext<T> >* kspace, cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dtt, T dte, bool accumulate = false);
 	/**
 	 * Performs the adjoint of the non-cartesian discrete fourier transform.
 	 * @param kspace The input kspace
@@ -29,8 +31,9 @@ namespace Gadgetron {
 	 * @param frequencies Frequencies on which to do DFT.
 	 * @param dte Time step between points in the first dimension of the tspace
 	 * @param dtt Time step between points in the second dimension of the tspace
+	 * @param accumulate Add the result to tspace instead of overwriting it
 	 */
-	template<class T> EXPORTHYPER void CSI_dftH(cuNDArray<complext<T> >* kspace, cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dte, T dtt);
+	template<class T> EXPORTHYPER void CSI_dftH(cuNDArray<complext<T> >* kspace, cuNDArray<complext<T> >* tspace, thrust::device_vector<T>* frequencies, T dte, T dtt, bool accumulate = false);
 
 	template<class T> EXPORTHYPER boost::shared_ptr<cuNDArray<complext<T> > 	> calculate_frequency_calibration(cuNDArray<complext<T> >* time_track, thrust::device_vector<T>* frequencies,cuNDArray<complext<T> > * csm,T dtt,T dte);
 
@@ -22,22 +22,10 @@ public:
 }
 
 	virtual  void mult_M(cuNDArray<float_complext> * in, cuNDArray<float_complext>* out,bool accumulate){
-		auto tmp_out  = out;
-		if (accumulate) tmp_out = new cuNDArray<float_complext>(*out);
-		CSI_dftH(in,tmp_out,&freqs,dte,dtt);
-		if (accumulate){
-			*out += *tmp_out;
-			delete tmp_out;
-		}
+		CSI_dftH(in,out,&freqs,dte,dtt,accumulate);
 	}
 	virtual  void mult_MH(cuNDArray<float_complext> * in, cuNDArray<float_complext>* out,bool accumulate){
-		auto tmp_out  = out;
-		if (accumulate) tmp_out = new cuNDArray<float_complext>(*out);
-		CSI_dft(tmp_out,in,&freqs,dte,dtt);
-		if (accumulate){
-			*out += *tmp_out;
-			delete tmp_out;
-		}
+		CSI_dft(out,in,&freqs,dte,dtt,accumulate);
 	}
 	void set_frequencies(std::vector<float> & freq) { freqs=thrust::device_vector<float>(freq.begin(),freq.end());
 	}
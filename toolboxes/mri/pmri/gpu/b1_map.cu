@@ -1,6 +1,7 @@
 #include "b1_map.h"
 #include "cuNDArray_operators.h"
 #include "cuNDArray_elemwise.h"
+#include "cuNDArray_blas.h"
 #include "vector_td_utilities.h"
 #include "real_utilities.h"
 #include "real_utilities_device.h"
@@ -19,7 +20,7 @@ namespace Gadgetron{
   const int kernel_width = 7;
 
   template<class REAL, unsigned int D> static void smooth_correlation_matrices( cuNDArray<complext<REAL> >*, cuNDArray<complext<REAL> >*);
-  template<class REAL> static boost::shared_ptr< cuNDArray<complext<REAL> > > extract_csm( cuNDArray<complext<REAL> >*, unsigned int, unsigned int);
+  template<class REAL> static boost::shared_ptr< cuNDArray<complext<REAL> > > extract_csm( cuNDArray<complext<REAL> >*, unsigned int, unsigned int, cuNDArray<complext<REAL> >*, unsigned int);
   template<class REAL> static void set_phase_reference( cuNDArray<complext<REAL> >*, unsigned int, unsigned int);
   template<class T> static void find_stride( cuNDArray<T> *in, unsigned int dim, unsigned int *stride, std::vector<size_t> *dims );
   template<class T> static boost::shared_ptr< cuNDArray<T> > correlation( cuNDArray<T> *in );
@@ -30,7 +31,7 @@ namespace Gadgetron{
   //
 
   template<class REAL, unsigned int D> boost::shared_ptr< cuNDArray<complext<REAL> > >
-  estimate_b1_map( cuNDArray<complext<REAL> > *data_in, int target_coils)
+  estimate_b1_map( cuNDArray<complext<REAL> > *data_in, cuNDArray<complext<REAL> > *csm_prev, unsigned int iterations, int target_coils )
   {
 
     if( data_in->get_number_of_dimensions() < 2 ){
@@ -38,28 +39,30 @@ namespace Gadgetron{
       return boost::shared_ptr< cuNDArray<complext<REAL> > >();
     }
 
-    if( data_in->get_number_of_dimensions()-1 != D ){
+    // [D dims, CHA] for a single map or [D dims, N, CHA] for a batch of N maps
+    if( data_in->get_number_of_dimensions()-1 != D && data_in->get_number_of_dimensions()-2 != D ){
       cout << endl << "estimate_b1_map:: dimensionality mismatch." << endl; 
       return boost::shared_ptr< cuNDArray<complext<REAL> > >();
     }
 
+    const unsigned int coil_dim = data_in->get_number_of_dimensions()-1;
+
     int target_coils_int = 0;
-    if ((target_coils <= 0) || (target_coils > data_in->get_size(D))) {
-      target_coils_int = data_in->get_size(D);
+    if ((target_coils <= 0) || (target_coils > data_in->get_size(coil_dim))) {
+      target_coils_int = data_in->get_size(coil_dim);
     } else {
       target_coils_int = target_coils;
     }
 
-    vector<unsigned int> image_dims, dims_to_xform;
-    unsigned int pixels_per_coil = 1;
-  
-    for( unsigned int i=0; i<D; i++ ){
-      image_dims.push_back(data_in->get_size(i));
-      dims_to_xform.push_back(i);
-      pixels_per_coil *= data_in->get_size(i);
+    unsigned int ncoils = data_in->get_size(coil_dim);
+
+    // Pixels of all maps in the batch
+    unsigned int pixels_per_coil = data_in->get_number_of_elements()/ncoils;
+
+    if( csm_prev && csm_prev->get_number_of_elements() != (size_t)pixels_per_coil*target_coils_int ){
+      cout << endl << "estimate_b1_map:: previous csm does not match the data, ignored." << endl; 
+      csm_prev = 0x0;
     }
-  
-    unsigned int ncoils = data_in->get_size(D);
 
     // Make a copy of input data, but only the target coils
     boost::shared_ptr< cuNDArray<complext<REAL> > > data_out;
@@ -68,7 +71,7 @@ namespace Gadgetron{
       data_out = boost::shared_ptr< cuNDArray<complext<REAL> > >(_data_out);
     } else {
       std::vector<size_t> odims = *(data_in->get_dimensions().get());
-      odims[D] = target_coils_int;
+      odims[coil_dim] = target_coils_int;
       cuNDArray<complext<REAL> > *_data_out = new cuNDArray<complext<REAL> >(&odims);
       data_out = boost::shared_ptr< cuNDArray<complext<REAL> > >(_data_out);
 
@@ -84,7 +87,7 @@ namespace Gadgetron{
     }
   
     // Normalize by the RSS of the coils
-    rss_normalize( data_out.get(), D );
+    rss_normalize( data_out.get(), coil_dim );
   
     // Now calculate the correlation matrices
     boost::shared_ptr<cuNDArray<complext<REAL> > > corrm = correlation( data_out.get() );
@@ -99,7 +102,7 @@ namespace Gadgetron{
     corrm.reset();
 
     // Get the dominant eigenvector for each correlation matrix.
-    boost::shared_ptr<cuNDArray<complext<REAL> > > csm = extract_csm<REAL>( corrm_smooth.get(), ncoils, pixels_per_coil );
+    boost::shared_ptr<cuNDArray<complext<REAL> > > csm = extract_csm<REAL>( corrm_smooth.get(), ncoils, pixels_per_coil, csm_prev, iterations );
     corrm_smooth.reset();
   
     // Set phase according to reference (coil 0)
@@ -108,6 +111,28 @@ namespace Gadgetron{
     return csm;
   }
 
+  template<class REAL, unsigned int D> boost::shared_ptr< cuNDArray<complext<REAL> > >
+  estimate_b1_map( cuNDArray<complext<REAL> > *data_in, int target_coils)
+  {
+    return estimate_b1_map<REAL,D>( data_in, 0x0, 2, target_coils );
+  }
+
+  template<class REAL> REAL
+  b1_map_relative_change( cuNDArray<complext<REAL> > *csm, cuNDArray<complext<REAL> > *csm_prev )
+  {
+    if( csm->get_number_of_elements() != csm_prev->get_number_of_elements() ){
+      throw std::runtime_error("b1_map_relative_change: csm dimensions mismatch");
+    }
+
+    REAL prev_norm = nrm2(csm_prev);
+    if( prev_norm <= REAL(0) ) return REAL(1);
+
+    cuNDArray<complext<REAL> > diff(*csm);
+    diff -= *csm_prev;
+
+    return nrm2(&diff)/prev_norm;
+  }
+
   template<class T> static void find_stride( cuNDArray<T> *in, unsigned int dim,
 					     unsigned int *stride, std::vector<size_t> *dims )
   {
@@ -599,7 +624,8 @@ namespace Gadgetron{
 
   // Extract CSM
   template<class REAL> __global__ static void
-  extract_csm_kernel( const complext<REAL> * __restrict__ corrm, complext<REAL> * __restrict__ csm, unsigned int num_batches, unsigned int num_elements, complext<REAL> * __restrict__ tmp_v )
+  extract_csm_kernel( const complext<REAL> * __restrict__ corrm, complext<REAL> * __restrict__ csm, unsigned int num_batches, unsigned int num_elements, complext<REAL> * __restrict__ tmp_v,
+                      const complext<REAL> * __restrict__ csm_prev, unsigned int iterations )
   {
     const unsigned int idx = blockIdx.x*blockDim.x + threadIdx.x;
 
@@ -608,11 +634,25 @@ namespace Gadgetron{
       // Get the dominant eigenvector for each correlation matrix.
       // Copying Peter Kellman's approach we use the power method:
       //  b_k+1 = A*b_k / ||A*b_k||
-    
-      const unsigned int iterations = 2;
+      // The iterations start from the previous map if given, it is close to the eigenvector when the coil images change little.
+      // Pixels where the previous map vanishes start from the constant vector.
 
-      for( unsigned int c=0; c<num_batches; c++){
-	csm[c*num_elements+idx] = complext<REAL>(1);
+      REAL prev_norm = REAL(0);
+      if( csm_prev ){
+	for( unsigned int c=0; c<num_batches; c++){
+	  prev_norm += norm(csm_prev[c*num_elements+idx]);
+	}
+      }
+
+      if( prev_norm > REAL(1e-12) ){
+	for( unsigned int c=0; c<num_batches; c++){
+	  csm[c*num_elements+idx] = csm_prev[c*num_elements+idx];
+	}
+      }
+      else{
+	for( unsigned int c=0; c<num_batches; c++){
+	  csm[c*num_elements+idx] = complext<REAL>(1);
+	}
       }
     
       for( unsigned int it=0; it<iterations; it++ ){
@@ -647,7 +687,8 @@ namespace Gadgetron{
 
   // Extract CSM
   template<class REAL> __host__ static
-  boost::shared_ptr<cuNDArray<complext<REAL> > > extract_csm(cuNDArray<complext<REAL> > *corrm_in, unsigned int number_of_batches, unsigned int number_of_elements )
+  boost::shared_ptr<cuNDArray<complext<REAL> > > extract_csm(cuNDArray<complext<REAL> > *corrm_in, unsigned int number_of_batches, unsigned int number_of_elements,
+                                                              cuNDArray<complext<REAL> > *csm_prev, unsigned int iterations )
   {
     vector<size_t> image_dims;
 
@@ -672,7 +713,8 @@ namespace Gadgetron{
 
     if( out != 0x0 && tmp_v != 0x0 )
       extract_csm_kernel<REAL><<< gridDim, blockDim >>>
-	( corrm_in->get_data_ptr(), out->get_data_ptr(), number_of_batches, number_of_elements, tmp_v->get_data_ptr() );
+	( corrm_in->get_data_ptr(), out->get_data_ptr(), number_of_batches, number_of_elements, tmp_v->get_data_ptr(),
+	  (csm_prev) ? csm_prev->get_data_ptr() : 0x0, iterations );
 
     CHECK_FOR_CUDA_ERROR();
   
@@ -723,11 +765,16 @@ namespace Gadgetron{
 
   //template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<float> > > estimate_b1_map<float,1>(cuNDArray<complext<float> >*, int);
   template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<float> > > estimate_b1_map<float,2>(cuNDArray<complext<float> >*, int);
+  template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<float> > > estimate_b1_map<float,2>(cuNDArray<complext<float> >*, cuNDArray<complext<float> >*, unsigned int, int);
   //template boost::shared_ptr< cuNDArray<complext<float> > > estimate_b1_map<float,3>(cuNDArray<complext<float> >*, int);
   //template boost::shared_ptr< cuNDArray<complext<float> > > estimate_b1_map<float,4>(cuNDArray<complext<float> >*, int);
 
   //template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<double> > > estimate_b1_map<double,1>(cuNDArray<complext<double> >*, int);
   template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<double> > > estimate_b1_map<double,2>(cuNDArray<complext<double> >*, int);
+  template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<double> > > estimate_b1_map<double,2>(cuNDArray<complext<double> >*, cuNDArray<complext<double> >*, unsigned int, int);
   //template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<double> > > estimate_b1_map<double,3>(cuNDArray<complext<double> >*, int);
   //template EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<double> > > estimate_b1_map<double,4>(cuNDArray<complext<double> >*, int);
+
+  template EXPORTGPUPMRI float b1_map_relative_change<float>(cuNDArray<complext<float> >*, cuNDArray<complext<float> >*);
+  template EXPORTGPUPMRI double b1_map_relative_change<double>(cuNDArray<complext<double> >*, cuNDArray<complext<double> >*);
 }
@@ -15,18 +15,35 @@ namespace Gadgetron{
 
   /** 
    * \brief Estimate b1 map (coil sensitivities) of single or double precision according to REAL and of dimensionality D.
-   * \param data Reconstructed reference images from the individual coils. Dimensionality is D+1 where the latter dimensions denotes the coil images.
-   * \param taget_coils Denotes the number of target coils. Cannot exceed the size of dimension D of the data. A negative value indicates that sensitivity maps are computed for the full coil image dimension.
+   * \param data Reconstructed reference images from the individual coils. Dimensionality is D+1 where the latter dimensions denotes the coil images,
+   * or D+2 for a batch of N maps [D dims, N, CHA], e.g. of several slices, estimated together in the same kernel launches.
+   * \param taget_coils Denotes the number of target coils. Cannot exceed the size of the coil dimension of the data. A negative value indicates that sensitivity maps are computed for the full coil image dimension.
    */
   template<class REAL, unsigned int D> EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<REAL> > >
   estimate_b1_map( cuNDArray<complext<REAL> > *data, int target_coils = -1 );
 
+  /**
+   * \brief As above, with the power iterations for the dominant eigenvector started from a previous estimate.
+   * For a temporal series of reference images the previous map is close to the new one, and a single iteration is usually sufficient.
+   * \param csm_prev Previous map of the dimensions of the result, or 0x0 to start from the constant vector.
+   * \param iterations Number of power iterations, 2 without a previous map in the method above.
+   */
+  template<class REAL, unsigned int D> EXPORTGPUPMRI boost::shared_ptr< cuNDArray<complext<REAL> > >
+  estimate_b1_map( cuNDArray<complext<REAL> > *data, cuNDArray<complext<REAL> > *csm_prev, unsigned int iterations, int target_coils = -1 );
+
+  /**
+   * \brief Relative change ||csm-csm_prev||/||csm_prev|| between two b1 maps, to decide how often a map needs to be estimated.
+   */
+  template<class REAL> EXPORTGPUPMRI REAL
+  b1_map_relative_change( cuNDArray<complext<REAL> > *csm, cuNDArray<complext<REAL> > *csm_prev );
+
     /** 
    * \brief Estimate b1 map (coil sensitivities) of single or double precision using the NIH Souheil method
    * \param data [RO E1 CHA] for single 2D or [RO E1 N CHA] for multiple 2D reconstructed reference images from the individual coils. 
+   * \param warm_start Start the power iterations from the V1 of the previous call instead of the summed columns of D, if V1 matches the data.
    */
   template<class REAL> EXPORTGPUPMRI bool
   estimate_b1_map_2D_NIH_Souheil( cuNDArray<complext<REAL> >* data, cuNDArray<complext<REAL> >* csm, size_t ks, size_t power,
                                   cuNDArray<complext<REAL> >& D, cuNDArray<complext<REAL> >& DH_D, 
-                                  cuNDArray<complext<REAL> >& V1, cuNDArray<complext<REAL> >& U1 );
+                                  cuNDArray<complext<REAL> >& V1, cuNDArray<complext<REAL> >& U1, bool warm_start = false );
 }
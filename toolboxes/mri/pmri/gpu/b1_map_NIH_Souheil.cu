@@ -37,7 +37,7 @@ namespace Gadgetron{
     template<class REAL> EXPORTGPUPMRI bool
     estimate_b1_map_2D_NIH_Souheil( cuNDArray<complext<REAL> >* data, cuNDArray<complext<REAL> >* csm, size_t ks, size_t power, 
                                     cuNDArray<complext<REAL> >& D, cuNDArray<complext<REAL> >& DH_D, 
-                                    cuNDArray<complext<REAL> >& V1, cuNDArray<complext<REAL> >& U1)
+                                    cuNDArray<complext<REAL> >& V1, cuNDArray<complext<REAL> >& U1, bool warm_start)
     {
         if( data->get_number_of_dimensions() < 2 )
         {
@@ -73,7 +73,7 @@ namespace Gadgetron{
         //}
 
         {
-            computeV1( data, &D, &DH_D, &V1, csm, power, kss);
+            computeV1( data, &D, &DH_D, &V1, csm, power, kss, warm_start && V1.get_number_of_elements()==data->get_number_of_elements() );
         }
 
         //{
@@ -460,7 +460,7 @@ namespace Gadgetron{
     }
 
     template<class T>
-    void computeV1( cuNDArray<T>* data, cuNDArray<T>* D, cuNDArray<T>* DH_D, cuNDArray<T>* V1, cuNDArray<T>* V, int power, int kss)
+    void computeV1( cuNDArray<T>* data, cuNDArray<T>* D, cuNDArray<T>* DH_D, cuNDArray<T>* V1, cuNDArray<T>* V, int power, int kss, bool warm_start)
     {
         size_t RO = data->get_size(0);
         size_t E1 = data->get_size(1);
@@ -493,8 +493,11 @@ namespace Gadgetron{
 
         dim3 gridDim((RO*E1*N+blockDim.x-1)/blockDim.x);
 
-        // Invoke kernel
-        computeV1_kernel<T><<< gridDim, blockDim >>>( D->get_data_ptr(), V1->get_data_ptr(), RO, E1, N, CHA, kss );
+        // Invoke kernel, a warm start keeps the V1 of the previous estimation as the initial vector
+        if ( !warm_start )
+        {
+            computeV1_kernel<T><<< gridDim, blockDim >>>( D->get_data_ptr(), V1->get_data_ptr(), RO, E1, N, CHA, kss );
+        }
 
         // power method
         dim3 blockDim2(16, 16);
@@ -643,5 +646,5 @@ namespace Gadgetron{
     //
     template EXPORTGPUPMRI bool estimate_b1_map_2D_NIH_Souheil<float>( cuNDArray<complext<float> >* data, cuNDArray<complext<float> >* csm, size_t ks, size_t power,
                                     cuNDArray<complext<float> >& D, cuNDArray<complext<float> >& DH_D, 
-                                    cuNDArray<complext<float> >& V1, cuNDArray<complext<float> >& U1 );
+                                    cuNDArray<complext<float> >& V1, cuNDArray<complext<float> >& U1, bool warm_start );
 }
@@ -50,6 +50,7 @@ namespace Gadgetron{
 
     if( !nfft_plan_->is_setup() || matrix_size_changed || matrix_size_os_changed || kernel_changed ){
       nfft_plan_->setup( matrix_size_, matrix_size_os_, W );
+      preprocessed_trajectory_.reset();
     }
     
     std::vector<size_t> dims = to_std_vector(matrix_size_os_);    
@@ -74,7 +75,36 @@ namespace Gadgetron{
   template<class REAL, unsigned int D, bool ATOMICS> 
   bool cuBuffer<REAL,D,ATOMICS>::add_frame_data( cuNDArray<_complext> *samples, cuNDArray<_reald> *trajectory )
   {
-    if( !samples || !trajectory ){
+    if( !trajectory ){
+      throw std::runtime_error("cuBuffer::add_frame_data: illegal input pointer");
+    }
+
+    nfft_plan_->preprocess( trajectory, cuNFFT_plan<REAL,D,ATOMICS>::NFFT_PREP_NC2C );
+    preprocessed_trajectory_.reset();
+
+    return add_preprocessed_frame_data( samples );
+  }
+
+  template<class REAL, unsigned int D, bool ATOMICS> 
+  bool cuBuffer<REAL,D,ATOMICS>::add_frame_data( cuNDArray<_complext> *samples, boost::shared_ptr< cuNDArray<_reald> > trajectory )
+  {
+    if( !trajectory.get() ){
+      throw std::runtime_error("cuBuffer::add_frame_data: illegal input pointer");
+    }
+
+    // Holding on to the array guarantees that an equal pointer means the same trajectory
+    if( trajectory != preprocessed_trajectory_ ){
+      nfft_plan_->preprocess( trajectory.get(), cuNFFT_plan<REAL,D,ATOMICS>::NFFT_PREP_NC2C );
+      preprocessed_trajectory_ = trajectory;
+    }
+
+    return add_preprocessed_frame_data( samples );
+  }
+
+  template<class REAL, unsigned int D, bool ATOMICS> 
+  bool cuBuffer<REAL,D,ATOMICS>::add_preprocessed_frame_data( cuNDArray<_complext> *samples )
+  {
+    if( !samples ){
       throw std::runtime_error("cuBuffer::add_frame_data: illegal input pointer");
     }
 
@@ -92,11 +122,6 @@ namespace Gadgetron{
     cuNDArray<_complext> cur_buffer(acc_buffer_->get_dimensions().get(),
 				    cyc_buffer_->get_data_ptr()+cur_idx_*acc_buffer_->get_number_of_elements());
 
-    // Preprocess frame
-    //
-
-    nfft_plan_->preprocess( trajectory, cuNFFT_plan<REAL,D,ATOMICS>::NFFT_PREP_NC2C );
-    
     // Convolve to form k-space frame (accumulation mode)
     //
     
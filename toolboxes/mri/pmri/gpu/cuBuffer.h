@@ -37,12 +37,18 @@ namespace Gadgetron{
     // Boolean return value indicates whether the accumulation buffer has changed (i.e. a cycle has been completed)
     virtual bool add_frame_data( cuNDArray<_complext> *samples, cuNDArray<_reald> *trajectory ); 
 
+    // As above, but the nfft preprocessing is reused while the same trajectory array is passed for consecutive frames
+    virtual bool add_frame_data( cuNDArray<_complext> *samples, boost::shared_ptr< cuNDArray<_reald> > trajectory );
+
     virtual boost::shared_ptr< cuNDArray< complext<REAL> > > get_accumulated_coil_images();
 
     // Workaround for weird boost/g++ error
     virtual boost::shared_ptr< cuNDArray< complext<REAL> > > get_combined_coil_image() = 0;
     
   protected:
+    // Convolves a frame with the current preprocessing of the plan into the buffer
+    bool add_preprocessed_frame_data( cuNDArray<_complext> *samples );
+
     _uint64d matrix_size_, matrix_size_os_;
     REAL W_;
     unsigned int num_coils_;
@@ -54,6 +60,7 @@ namespace Gadgetron{
     boost::shared_ptr< cuNDArray<_complext> > acc_image_;
     boost::shared_ptr< cuNDArray<REAL> > dcw_;
     boost::shared_ptr< cuNFFT_plan<REAL,D,ATOMICS> > nfft_plan_;
+    boost::shared_ptr< cuNDArray<_reald> > preprocessed_trajectory_;
   };
 
   // To prevent the use of atomics with doubles.
@@ -0,0 +1,98 @@
+#include "cuCirculantPreconditioner.h"
+#include "cuNDArray_operators.h"
+#include "cuNDFFT.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Gadgetron{
+
+  template<class REAL, unsigned int D> void
+  cuCirculantPreconditioner<REAL,D>::set_toeplitz_kernel( cuNDArray< complext<REAL> > *kernel, REAL regularization, REAL min_relative_eigenvalue )
+  {
+    if( !kernel || kernel->get_number_of_dimensions() < D ){
+      throw std::runtime_error("cuCirculantPreconditioner::set_toeplitz_kernel: invalid kernel");
+    }
+
+    // The kernel is of twice the matrix size in the first D dimensions, followed by the frames
+    std::vector<size_t> dims2 = *kernel->get_dimensions();
+    std::vector<size_t> dims = dims2;
+    for( unsigned int d=0; d<D; d++ ){
+      if( dims2[d] % 2 ){
+        throw std::runtime_error("cuCirculantPreconditioner::set_toeplitz_kernel: odd kernel size");
+      }
+      dims[d] = dims2[d]/2;
+    }
+
+    size_t num_image = 1, num_image2 = 1;
+    for( unsigned int d=0; d<D; d++ ){
+      num_image *= dims[d];
+      num_image2 *= dims2[d];
+    }
+    const size_t frames = kernel->get_number_of_elements()/num_image2;
+
+    boost::shared_ptr< hoNDArray< complext<REAL> > > h_kernel = kernel->to_host();
+    hoNDArray< complext<REAL> > h_weights(&dims);
+
+    for( size_t f=0; f<frames; f++ ){
+
+      // The centered spectra share the zero frequency: image index i is kernel index 2i
+      std::vector<REAL> lambda(num_image);
+      REAL max_lambda = REAL(0);
+      for( size_t i=0; i<num_image; i++ ){
+        size_t idx = i, idx2 = 0, stride2 = 1;
+        for( unsigned int d=0; d<D; d++ ){
+          idx2 += 2*(idx%dims[d])*stride2;
+          idx /= dims[d];
+          stride2 *= dims2[d];
+        }
+        lambda[i] = real(h_kernel->get_data_ptr()[f*num_image2+idx2]);
+        max_lambda = std::max( max_lambda, lambda[i] );
+      }
+
+      const REAL min_lambda = min_relative_eigenvalue*max_lambda;
+      complext<REAL> *w = h_weights.get_data_ptr()+f*num_image;
+      for( size_t i=0; i<num_image; i++ ){
+        REAL l = std::max( lambda[i], min_lambda ) + regularization;
+        w[i] = complext<REAL>( (l > REAL(0)) ? REAL(1)/std::sqrt(l) : REAL(1) );
+      }
+    }
+
+    this->set_weights( boost::shared_ptr< cuNDArray< complext<REAL> > >( new cuNDArray< complext<REAL> >(&h_weights) ) );
+  }
+
+  template<class REAL, unsigned int D> void
+  cuCirculantPreconditioner<REAL,D>::apply( cuNDArray< complext<REAL> > *in, cuNDArray< complext<REAL> > *out )
+  {
+    if( !this->weights_.get() ){
+      throw std::runtime_error( "cuCirculantPreconditioner::apply(): weights not set");
+    }
+
+    if ( !in || !out || in->get_number_of_elements() != out->get_number_of_elements()) {
+      throw std::runtime_error("cuCirculantPreconditioner::apply(): input and output dimensions mismatch");
+    }
+
+    if (in->get_number_of_elements() % this->weights_->get_number_of_elements()) {
+      throw std::runtime_error( "cuCirculantPreconditioner::apply(): unexpected dimensionality of computed weights" );
+    }
+
+    std::vector<size_t> dims_to_transform;
+    for( unsigned int d=0; d<D; d++ )
+      dims_to_transform.push_back(d);
+
+    if( in != out )
+      *out = *in;
+    cuNDFFT<REAL>::instance()->fft( out, &dims_to_transform );
+    *out *= *this->weights_;
+    cuNDFFT<REAL>::instance()->ifft( out, &dims_to_transform );
+  }
+
+  //
+  // Instantiations
+  //
+
+  template class EXPORTGPUPMRI cuCirculantPreconditioner<float,2>;
+  template class EXPORTGPUPMRI cuCirculantPreconditioner<float,3>;
+  template class EXPORTGPUPMRI cuCirculantPreconditioner<double,2>;
+  template class EXPORTGPUPMRI cuCirculantPreconditioner<double,3>;
+}
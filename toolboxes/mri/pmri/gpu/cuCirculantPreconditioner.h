@@ -0,0 +1,41 @@
+/** \file cuCirculantPreconditioner.h
+    \brief Circulant preconditioner for the non-Cartesian normal equations.
+
+    The normal operator E^H E of a non-Cartesian encoding is close to a convolution with the point
+    spread function of the trajectory, i.e. a Toeplitz matrix. Its eigenvalues are approximated by
+    the spectrum of the Toeplitz kernel of cuNFFT_plan::preprocess_toeplitz sampled on the image grid
+    (every second frequency of the 2x grid), which is the circulant approximation of the Toeplitz matrix.
+    The preconditioner applies fft, a multiplication by 1/sqrt(lambda+regularization), and ifft.
+    As for the diagonal preconditioner the solver applies it twice.
+
+    The coil sensitivities are assumed normalized to a unit sum of squares. With strongly varying
+    coil sensitivities the diagonal preconditioner of cuCgPreconditioner may be the better choice.
+*/
+
+#pragma once
+
+#include "cuCgPreconditioner.h"
+#include "cuNDArray.h"
+#include "complext.h"
+#include "gpupmri_export.h"
+
+namespace Gadgetron{
+
+  template<class REAL, unsigned int D> class EXPORTGPUPMRI cuCirculantPreconditioner : public cuCgPreconditioner< complext<REAL> >
+  {
+  public:
+
+    cuCirculantPreconditioner() : cuCgPreconditioner< complext<REAL> >() {}
+    virtual ~cuCirculantPreconditioner() {}
+
+    // Computes the weights from the Toeplitz kernel of a cuNFFT_plan (see cuNFFT_plan::get_toeplitz_kernel).
+    // The regularization is added to the eigenvalues, e.g. the weight of an image regularization operator.
+    // Eigenvalues below min_relative_eigenvalue times the largest one are clamped to it.
+    virtual void set_toeplitz_kernel( cuNDArray< complext<REAL> > *kernel, REAL regularization, REAL min_relative_eigenvalue = REAL(1e-3) );
+
+    // The weights in the frequency domain, of the image size (and frames)
+    virtual boost::shared_ptr< cuNDArray< complext<REAL> > > get_weights() { return this->weights_; }
+
+    virtual void apply( cuNDArray< complext<REAL> > *in, cuNDArray< complext<REAL> > *out );
+  };
+}
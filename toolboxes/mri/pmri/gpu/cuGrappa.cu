@@ -0,0 +1,691 @@
+#include "cuGrappa.h"
+#include "htgrappa.h"
+#include "cuNDArray_elemwise.h"
+#include "cuNDFFT.h"
+#include "CUBLASContextProvider.h"
+#include "check_CUDA.h"
+#include "setup_grid.h"
+#include "complext.h"
+
+#include <cublas_v2.h>
+#include <thrust/device_vector.h>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+namespace Gadgetron {
+
+  namespace {
+
+    __inline__ __device__ size_t grappa_thread_index()
+    {
+      return ((size_t)blockIdx.y*gridDim.x + blockIdx.x)*blockDim.x + threadIdx.x;
+    }
+
+    // one row of the system of grappa2d_calib per thread, A(rInd, col) = acsSrc(ro+kro, e1+kE1[ke1], src), B(rInd, col) = acsDst(ro, e1+oE1[oe1], dst)
+    template <class T> __global__ void grappa2d_system_kernel(const T* __restrict__ src, const T* __restrict__ dst,
+                                                              int RO, int E1, int srcCHA, int dstCHA, int kROhalf,
+                                                              const int* __restrict__ kE1, int kNE1, const int* __restrict__ oE1, int oNE1,
+                                                              int sRO, int sE1, int lenRO, size_t rowA,
+                                                              T* __restrict__ A, T* __restrict__ B)
+    {
+      const size_t rInd = grappa_thread_index();
+      if (rInd >= rowA) return;
+
+      const int e1 = (int)(rInd/lenRO) + sE1;
+      const int ro = (int)(rInd%lenRO) + sRO;
+      const size_t N = (size_t)RO*E1;
+
+      size_t col = 0;
+      for (int c = 0; c < srcCHA; c++) {
+        for (int ke1 = 0; ke1 < kNE1; ke1++) {
+          const T* pSrc = src + c*N + (size_t)(e1+kE1[ke1])*RO + ro;
+          for (int kro = -kROhalf; kro <= kROhalf; kro++) {
+            A[rInd + (col++)*rowA] = pSrc[kro];
+          }
+        }
+      }
+
+      col = 0;
+      for (int oe1 = 0; oe1 < oNE1; oe1++) {
+        for (int d = 0; d < dstCHA; d++) {
+          B[rInd + (col++)*rowA] = dst[d*N + (size_t)(e1+oE1[oe1])*RO + ro];
+        }
+      }
+    }
+
+    // convKer(-kro + kRO + 1, oE1[oe1] - kE1[ke1] + maxKE1, src, dst) = ker(kro + kROhalf, ke1, src, dst, oe1)
+    template <class T> __global__ void grappa2d_convolution_kernel_kernel(const T* __restrict__ ker, int kRO, int kNE1, int srcCHA, int dstCHA, int oNE1,
+                                                                          const int* __restrict__ kE1, const int* __restrict__ oE1, int maxKE1,
+                                                                          int convKRO, int convKE1, T* __restrict__ convKer)
+    {
+      const size_t idx = grappa_thread_index();
+      if (idx >= (size_t)kRO*kNE1*srcCHA*dstCHA*oNE1) return;
+
+      size_t i = idx;
+      const int kro = (int)(i%kRO); i /= kRO;
+      const int ke1 = (int)(i%kNE1); i /= kNE1;
+      const int src = (int)(i%srcCHA); i /= srcCHA;
+      const int dst = (int)(i%dstCHA);
+      const int oe1 = (int)(i/dstCHA);
+
+      const int x = (kRO/2 - kro) + kRO + 1;
+      const int y = oE1[oe1] - kE1[ke1] + maxKE1;
+
+      convKer[x + convKRO*(y + (size_t)convKE1*(src + (size_t)srcCHA*dst))] = ker[idx];
+    }
+
+    // the unit diagonal of the kernels not fitting the acquired lines
+    template <class T> __global__ void grappa2d_convolution_kernel_identity(int dstCHA, int srcCHA, int x, int y, int convKRO, int convKE1, T* __restrict__ convKer)
+    {
+      const size_t dst = grappa_thread_index();
+      if (dst >= (size_t)dstCHA) return;
+
+      convKer[x + convKRO*(y + (size_t)convKE1*(dst + (size_t)srcCHA*dst))] = T(1);
+    }
+
+    // pad convKer to the image size, keeping the centre like pad(...), and scale it
+    template <class T, class REAL> __global__ void grappa2d_pad_kernel(const T* __restrict__ convKer, int convKRO, int convKE1, size_t num,
+                                                                       int RO, int E1, REAL scale, T* __restrict__ kIm)
+    {
+      const size_t idx = grappa_thread_index();
+      if (idx >= num) return;
+
+      const int x = (int)(idx%convKRO);
+      const int y = (int)((idx/convKRO)%convKE1);
+      const size_t c = idx/((size_t)convKRO*convKE1);
+
+      kIm[(x + RO/2 - convKRO/2) + (size_t)RO*((y + E1/2 - convKE1/2) + (size_t)E1*c)] = convKer[idx]*scale;
+    }
+
+    // unmixCoeff(:, src) = sum over dst of kIm(:, src, dst)*conj(coilMap(:, dst)), gFactor = sqrt(sum of |unmixCoeff|^2) * gScale
+    template <class T, class REAL> __global__ void grappa2d_unmixing_kernel(const T* __restrict__ kIm, const T* __restrict__ coilMap, size_t N,
+                                                                            int srcCHA, int dstCHA, REAL gScale,
+                                                                            T* __restrict__ unmixCoeff, REAL* __restrict__ gFactor)
+    {
+      const size_t idx = grappa_thread_index();
+      if (idx >= N) return;
+
+      REAL g = 0;
+      for (int src = 0; src < srcCHA; src++) {
+        T coeff(0);
+        for (int dst = 0; dst < dstCHA; dst++) {
+          coeff += kIm[idx + N*(src + (size_t)srcCHA*dst)] * conj(coilMap[idx + N*dst]);
+        }
+        unmixCoeff[idx + N*src] = coeff;
+        g += norm(coeff);
+      }
+
+      gFactor[idx] = sqrt(g)*gScale;
+    }
+
+    // complexIm(:, n) = scale * sum over the first useCHA channels of aliasedIm(:, cha, n)*unmixCoeff(:, cha, min(n, refN-1))
+    template <class T, class REAL> __global__ void grappa2d_apply_unmix_kernel(const T* __restrict__ aliasedIm, const T* __restrict__ unmixCoeff, size_t N,
+                                                                               int CHA, int uCHA, int useCHA, int numN, int refN, REAL scale,
+                                                                               T* __restrict__ complexIm)
+    {
+      const size_t idx = grappa_thread_index();
+      if (idx >= N*numN) return;
+
+      const size_t p = idx%N;
+      const int n = (int)(idx/N);
+      const int usedN = (n < refN) ? n : refN - 1;
+
+      const T* pIm = aliasedIm + N*CHA*n + p;
+      const T* pUnmix = unmixCoeff + N*uCHA*usedN + p;
+
+      T res(0);
+      for (int cha = 0; cha < useCHA; cha++) {
+        res += pIm[N*cha] * pUnmix[N*cha];
+      }
+
+      complexIm[idx] = res*scale;
+    }
+
+    // page locks a host array for the asynchronous copies, they are staged by the driver if that is not possible
+    class cuGrappaPinnedHost
+    {
+    public:
+      cuGrappaPinnedHost(const void* p, size_t bytes) : p_(const_cast<void*>(p)), pinned_(false)
+      {
+        if (bytes == 0) return;
+        pinned_ = (cudaHostRegister(p_, bytes, cudaHostRegisterPortable) == cudaSuccess);
+        if (!pinned_) cudaGetLastError();
+      }
+
+      ~cuGrappaPinnedHost()
+      {
+        if (pinned_) cudaHostUnregister(p_);
+      }
+
+    private:
+      void* p_;
+      bool pinned_;
+    };
+
+    // copy stream and events of the two buffer slots of a unit pipeline, the compute runs on the default stream
+    // the destructor waits for the outstanding copies, so it must be destroyed before the device buffers
+    class cuGrappaPipeline
+    {
+    public:
+      cuGrappaPipeline()
+      {
+        CUDA_CALL(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+        for (int s = 0; s < 2; s++) {
+          CUDA_CALL(cudaEventCreateWithFlags(&uploaded[s], cudaEventDisableTiming));
+          CUDA_CALL(cudaEventCreateWithFlags(&computed[s], cudaEventDisableTiming));
+          CUDA_CALL(cudaEventCreateWithFlags(&downloaded[s], cudaEventDisableTiming));
+        }
+      }
+
+      ~cuGrappaPipeline()
+      {
+        cudaStreamSynchronize(stream);
+        for (int s = 0; s < 2; s++) {
+          cudaEventDestroy(uploaded[s]);
+          cudaEventDestroy(computed[s]);
+          cudaEventDestroy(downloaded[s]);
+        }
+        cudaStreamDestroy(stream);
+      }
+
+      template <class T> void upload(T* d, const T* h, size_t num)
+      {
+        CUDA_CALL(cudaMemcpyAsync(d, h, num*sizeof(T), cudaMemcpyHostToDevice, stream));
+      }
+
+      template <class T> void download(T* h, const T* d, size_t num)
+      {
+        CUDA_CALL(cudaMemcpyAsync(h, d, num*sizeof(T), cudaMemcpyDeviceToHost, stream));
+      }
+
+      /// the default stream waits until the inputs of the slot are uploaded and its previous results downloaded
+      void begin_compute(int slot, bool wait_download)
+      {
+        CUDA_CALL(cudaStreamWaitEvent(0, uploaded[slot], 0));
+        if (wait_download) CUDA_CALL(cudaStreamWaitEvent(0, downloaded[slot], 0));
+      }
+
+      void end_compute(int slot)
+      {
+        CUDA_CALL(cudaEventRecord(computed[slot], 0));
+        CUDA_CALL(cudaStreamWaitEvent(stream, computed[slot], 0));
+      }
+
+      cudaStream_t stream;
+      cudaEvent_t uploaded[2], computed[2], downloaded[2];
+    };
+
+    void grappa2d_conv_kernel_size(size_t kRO, const std::vector<int>& kE1, size_t& convKRO, size_t& convKE1, int& maxKE1)
+    {
+      kRO = 2*(kRO/2) + 1;
+      maxKE1 = std::max(std::abs(kE1.front()), std::abs(kE1.back()));
+      convKRO = 2*kRO + 3;
+      convKE1 = 2*maxKE1 + 1;
+    }
+
+    // ifft2c of hoNDFFT on the first two dimensions, batched over the others
+    // ifft2 applies the timeswitch before the transform only, the second one centres the result; for an even size
+    // n the two timeswitches leave a sign (-1)^(n/2) per dimension, which is taken out. Odd sizes are not supported.
+    template <class REAL> void grappa2d_ifft2c(cuNDArray< complext<REAL> >& x)
+    {
+      const size_t RO = x.get_size(0);
+      const size_t E1 = x.get_size(1);
+
+      if (RO%2 != 0 || E1%2 != 0) {
+        throw std::runtime_error("cuGrappa: odd image sizes are not supported, use the cpu");
+      }
+
+      cuNDFFT<REAL>::instance()->ifft2(&x);
+      timeswitch2D(&x);
+
+      if ((RO/2 + E1/2)%2 != 0) x *= REAL(-1);
+    }
+
+    void grappa_check_cublas(cublasStatus_t stat, const char* msg)
+    {
+      if (stat != CUBLAS_STATUS_SUCCESS) {
+        std::stringstream ss;
+        ss << msg << ", cublas error code " << stat;
+        throw std::runtime_error(ss.str());
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_calib(const cuNDArray<T>& acsSrc, const cuNDArray<T>& acsDst, double thres, size_t kRO,
+                                           const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<T>& ker)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    if (acsSrc.get_size(0) != acsDst.get_size(0) || acsSrc.get_size(1) != acsDst.get_size(1) || acsSrc.get_size(2) < acsDst.get_size(2)) {
+      throw std::runtime_error("cuGrappa2d_calib: the source and destination references do not match");
+    }
+
+    if (kE1.empty() || oE1.empty()) {
+      throw std::runtime_error("cuGrappa2d_calib: empty kernel pattern");
+    }
+
+    const size_t RO = acsSrc.get_size(0);
+    const size_t E1 = acsSrc.get_size(1);
+    const size_t srcCHA = acsSrc.get_size(2);
+    const size_t dstCHA = acsDst.get_size(2);
+
+    const long long kROhalf = kRO/2;
+    kRO = 2*kROhalf + 1;
+
+    const size_t kNE1 = kE1.size();
+    const size_t oNE1 = oE1.size();
+
+    const long long sRO = kROhalf;
+    const long long eRO = (long long)RO - 1 - kROhalf;
+    const long long sE1 = std::abs(kE1[0]);
+    const long long eE1 = (long long)E1 - 1 - kE1[kNE1-1];
+
+    if (eRO < sRO || eE1 < sE1) {
+      throw std::runtime_error("cuGrappa2d_calib: the reference is too small for the kernel");
+    }
+
+    const size_t lenRO = eRO - sRO + 1;
+    const size_t rowA = (eE1 - sE1 + 1)*lenRO;
+    const size_t colA = kRO*kNE1*srcCHA;
+    const size_t colB = dstCHA*oNE1;
+
+    cuNDArray<T> A(rowA, colA);
+    cuNDArray<T> B(rowA, colB);
+
+    thrust::device_vector<int> d_kE1(kE1.begin(), kE1.end());
+    thrust::device_vector<int> d_oE1(oE1.begin(), oE1.end());
+
+    dim3 blockDim, gridDim;
+    setup_grid(rowA, &blockDim, &gridDim);
+
+    grappa2d_system_kernel<<< gridDim, blockDim >>>(acsSrc.get_data_ptr(), acsDst.get_data_ptr(), (int)RO, (int)E1, (int)srcCHA, (int)dstCHA, (int)kROhalf,
+                                                    thrust::raw_pointer_cast(&d_kE1[0]), (int)kNE1, thrust::raw_pointer_cast(&d_oE1[0]), (int)oNE1,
+                                                    (int)sRO, (int)sE1, (int)lenRO, rowA, A.get_data_ptr(), B.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+
+    // normal equations, the lower triangle of AHA like the herk of SolveLinearSystem_Tikhonov
+    cuNDArray<T> AHA(colA, colA);
+    cuNDArray<T> AHB(colA, colB);
+
+    int device;
+    CUDA_CALL(cudaGetDevice(&device));
+    cublasHandle_t handle = *CUBLASContextProvider::instance()->getCublasHandle(device);
+
+    const float one = 1, zero = 0;
+    grappa_check_cublas(cublasCherk(handle, CUBLAS_FILL_MODE_LOWER, CUBLAS_OP_C, (int)colA, (int)rowA,
+                                    &one, (const cuComplex*)A.get_data_ptr(), (int)rowA,
+                                    &zero, (cuComplex*)AHA.get_data_ptr(), (int)colA), "cuGrappa2d_calib: failed to form AHA");
+
+    const T alpha(1), beta(0);
+    grappa_check_cublas(cublasCgemm(handle, CUBLAS_OP_C, CUBLAS_OP_N, (int)colA, (int)colB, (int)rowA,
+                                    (const cuComplex*)&alpha, (const cuComplex*)A.get_data_ptr(), (int)rowA,
+                                    (const cuComplex*)B.get_data_ptr(), (int)rowA,
+                                    (const cuComplex*)&beta, (cuComplex*)AHB.get_data_ptr(), (int)colA), "cuGrappa2d_calib: failed to form AHB");
+
+    // the system is too small for the gpu to pay off, it is solved on the cpu like htgrappa does
+    hoNDArray<T> AHA_h(colA, colA);
+    hoNDArray<T> AHB_h(colA, colB);
+    AHA.to_host(&AHA_h);
+    AHB.to_host(&AHB_h);
+
+    T* pAHA = AHA_h.get_data_ptr();
+
+    double trA = 0;
+    for (size_t c = 0; c < colA; c++) trA += abs(pAHA[c + c*colA]);
+
+    const double value = trA*thres/colA;
+    for (size_t c = 0; c < colA; c++) pAHA[c + c*colA] = T((REAL)(abs(pAHA[c + c*colA]) + value));
+
+    // the data are expected to be SNR unit scaled, see SolveLinearSystem_Tikhonov
+    if (trA/colA < 4.0) {
+      const REAL scalingFactor = (REAL)(colA*4.0/trA);
+      for (size_t i = 0; i < AHA_h.get_number_of_elements(); i++) pAHA[i] *= scalingFactor;
+      for (size_t i = 0; i < AHB_h.get_number_of_elements(); i++) AHB_h[i] *= scalingFactor;
+    }
+
+    ht_grappa_solve_spd_system(&AHA_h, &AHB_h);
+
+    std::vector<size_t> dims(5);
+    dims[0] = kRO; dims[1] = kNE1; dims[2] = srcCHA; dims[3] = dstCHA; dims[4] = oNE1;
+    if (!ker.dimensions_equal(&dims)) ker.create(&dims);
+
+    CUDA_CALL(cudaMemcpy(ker.get_data_ptr(), AHB_h.get_data_ptr(), AHB_h.get_number_of_bytes(), cudaMemcpyHostToDevice));
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_convert_to_convolution_kernel(const cuNDArray<T>& ker, const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<T>& convKer)
+  {
+    const size_t kRO = ker.get_size(0);
+    const size_t kNE1 = ker.get_size(1);
+    const size_t srcCHA = ker.get_size(2);
+    const size_t dstCHA = ker.get_size(3);
+    const size_t oNE1 = ker.get_size(4);
+
+    if (kNE1 != kE1.size() || oNE1 != oE1.size()) {
+      throw std::runtime_error("cuGrappa2d_convert_to_convolution_kernel: the kernel does not match the kernel pattern");
+    }
+
+    size_t convKRO, convKE1;
+    int maxKE1;
+    grappa2d_conv_kernel_size(kRO, kE1, convKRO, convKE1, maxKE1);
+
+    std::vector<size_t> dims(4);
+    dims[0] = convKRO; dims[1] = convKE1; dims[2] = srcCHA; dims[3] = dstCHA;
+    if (!convKer.dimensions_equal(&dims)) convKer.create(&dims);
+    clear(&convKer);
+
+    thrust::device_vector<int> d_kE1(kE1.begin(), kE1.end());
+    thrust::device_vector<int> d_oE1(oE1.begin(), oE1.end());
+
+    dim3 blockDim, gridDim;
+    setup_grid(ker.get_number_of_elements(), &blockDim, &gridDim);
+
+    grappa2d_convolution_kernel_kernel<<< gridDim, blockDim >>>(ker.get_data_ptr(), (int)kRO, (int)kNE1, (int)srcCHA, (int)dstCHA, (int)oNE1,
+                                                                thrust::raw_pointer_cast(&d_kE1[0]), thrust::raw_pointer_cast(&d_oE1[0]), maxKE1,
+                                                                (int)convKRO, (int)convKE1, convKer.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+
+    if (oE1[0] != 0) {
+      setup_grid(dstCHA, &blockDim, &gridDim);
+      grappa2d_convolution_kernel_identity<<< gridDim, blockDim >>>((int)dstCHA, (int)srcCHA, (int)kRO + 1, maxKE1, (int)convKRO, (int)convKE1, convKer.get_data_ptr());
+      CHECK_FOR_CUDA_ERROR();
+    }
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_image_domain_kernel(const cuNDArray<T>& convKer, size_t RO, size_t E1, cuNDArray<T>& kIm)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    const size_t convKRO = convKer.get_size(0);
+    const size_t convKE1 = convKer.get_size(1);
+    const size_t srcCHA = convKer.get_size(2);
+    const size_t dstCHA = convKer.get_size(3);
+
+    if (convKRO > RO || convKE1 > E1) {
+      throw std::runtime_error("cuGrappa2d_image_domain_kernel: the kernel is larger than the image");
+    }
+
+    std::vector<size_t> dims(4);
+    dims[0] = RO; dims[1] = E1; dims[2] = srcCHA; dims[3] = dstCHA;
+    if (!kIm.dimensions_equal(&dims)) kIm.create(&dims);
+    clear(&kIm);
+
+    dim3 blockDim, gridDim;
+    setup_grid(convKer.get_number_of_elements(), &blockDim, &gridDim);
+
+    grappa2d_pad_kernel<<< gridDim, blockDim >>>(convKer.get_data_ptr(), (int)convKRO, (int)convKE1, convKer.get_number_of_elements(),
+                                                 (int)RO, (int)E1, (REAL)std::sqrt((double)(RO*E1)), kIm.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+
+    grappa2d_ifft2c(kIm);
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_unmixing_coeff(const cuNDArray<T>& kIm, const cuNDArray<T>& coilMap, size_t acceFactorE1,
+                                                    cuNDArray<T>& unmixCoeff, cuNDArray<typename realType<T>::Type>& gFactor)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    const size_t RO = kIm.get_size(0);
+    const size_t E1 = kIm.get_size(1);
+    const size_t srcCHA = kIm.get_size(2);
+    const size_t dstCHA = kIm.get_size(3);
+
+    if (acceFactorE1 < 1) {
+      throw std::runtime_error("cuGrappa2d_unmixing_coeff: the acceleration factor must be at least 1");
+    }
+
+    if (coilMap.get_size(0) != RO || coilMap.get_size(1) != E1 || coilMap.get_size(2) != dstCHA) {
+      throw std::runtime_error("cuGrappa2d_unmixing_coeff: the coil map does not match the image domain kernel");
+    }
+
+    std::vector<size_t> dimUnmixing(3);
+    dimUnmixing[0] = RO; dimUnmixing[1] = E1; dimUnmixing[2] = srcCHA;
+    if (!unmixCoeff.dimensions_equal(&dimUnmixing)) unmixCoeff.create(&dimUnmixing);
+
+    std::vector<size_t> dimGFactor(2);
+    dimGFactor[0] = RO; dimGFactor[1] = E1;
+    if (!gFactor.dimensions_equal(&dimGFactor)) gFactor.create(&dimGFactor);
+
+    dim3 blockDim, gridDim;
+    setup_grid(RO*E1, &blockDim, &gridDim);
+
+    grappa2d_unmixing_kernel<<< gridDim, blockDim >>>(kIm.get_data_ptr(), coilMap.get_data_ptr(), RO*E1, (int)srcCHA, (int)dstCHA,
+                                                      (REAL)(1.0/acceFactorE1), unmixCoeff.get_data_ptr(), gFactor.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_apply_unmix_coeff_aliased_image(const cuNDArray<T>& aliasedIm, const cuNDArray<T>& unmixCoeff,
+                                                                     typename realType<T>::Type scale, cuNDArray<T>& complexIm)
+  {
+    const size_t RO = aliasedIm.get_size(0);
+    const size_t E1 = aliasedIm.get_size(1);
+    const size_t CHA = aliasedIm.get_size(2);
+    const size_t N = aliasedIm.get_number_of_elements()/(RO*E1*CHA);
+
+    const size_t uCHA = unmixCoeff.get_size(2);
+    const size_t refN = unmixCoeff.get_number_of_elements()/(RO*E1*uCHA);
+
+    if (unmixCoeff.get_size(0) != RO || unmixCoeff.get_size(1) != E1 || refN == 0) {
+      throw std::runtime_error("cuGrappa2d_apply_unmix_coeff_aliased_image: the unmixing coefficients do not match the aliased images");
+    }
+
+    std::vector<size_t> dims(3);
+    dims[0] = RO; dims[1] = E1; dims[2] = N;
+    if (complexIm.get_number_of_elements() != RO*E1*N) complexIm.create(&dims);
+
+    dim3 blockDim, gridDim;
+    setup_grid(RO*E1*N, &blockDim, &gridDim);
+
+    grappa2d_apply_unmix_kernel<<< gridDim, blockDim >>>(aliasedIm.get_data_ptr(), unmixCoeff.get_data_ptr(), RO*E1, (int)CHA, (int)uCHA,
+                                                         (int)std::min(CHA, uCHA), (int)N, (int)refN, scale, complexIm.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_calib_unmixing_coeff(const hoNDArray<T>& acsSrc, const hoNDArray<T>& acsDst, const hoNDArray<T>& coilMap,
+                                                          size_t acceFactorE1, double thres, size_t kRO, const std::vector<int>& kE1, const std::vector<int>& oE1,
+                                                          hoNDArray<T>& convKer, hoNDArray<T>& unmixCoeff, hoNDArray<typename realType<T>::Type>& gFactor)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    const size_t refRO = acsSrc.get_size(0);
+    const size_t refE1 = acsSrc.get_size(1);
+    const size_t srcCHA = acsSrc.get_size(2);
+    const size_t dstCHA = acsDst.get_size(2);
+    const size_t RO = coilMap.get_size(0);
+    const size_t E1 = coilMap.get_size(1);
+
+    const size_t numSrc = refRO*refE1*srcCHA;
+    const size_t numDst = refRO*refE1*dstCHA;
+    const size_t numCoil = RO*E1*dstCHA;
+
+    const size_t U = acsSrc.get_number_of_elements()/numSrc;
+
+    if (acsDst.get_number_of_elements() != numDst*U || coilMap.get_number_of_elements() != numCoil*U) {
+      throw std::runtime_error("cuGrappa2d_calib_unmixing_coeff: the references and the coil map do not have the same units");
+    }
+
+    size_t convKRO, convKE1;
+    int maxKE1;
+    grappa2d_conv_kernel_size(kRO, kE1, convKRO, convKE1, maxKE1);
+
+    const size_t numConv = convKRO*convKE1*srcCHA*dstCHA;
+    const size_t numUnmix = RO*E1*srcCHA;
+    const size_t numG = RO*E1;
+
+    std::vector<size_t> dims(5);
+    dims[0] = convKRO; dims[1] = convKE1; dims[2] = srcCHA; dims[3] = dstCHA; dims[4] = U;
+    if (convKer.get_number_of_elements() != numConv*U) convKer.create(&dims);
+
+    dims.resize(4);
+    dims[0] = RO; dims[1] = E1; dims[2] = srcCHA; dims[3] = U;
+    if (unmixCoeff.get_number_of_elements() != numUnmix*U) unmixCoeff.create(&dims);
+
+    dims.resize(3);
+    dims[0] = RO; dims[1] = E1; dims[2] = U;
+    if (gFactor.get_number_of_elements() != numG*U) gFactor.create(&dims);
+
+    if (U == 0) return;
+
+    cuGrappaPinnedHost pinSrc(acsSrc.get_data_ptr(), acsSrc.get_number_of_bytes());
+    cuGrappaPinnedHost pinDst(acsDst.get_data_ptr(), acsDst.get_number_of_bytes());
+    cuGrappaPinnedHost pinCoil(coilMap.get_data_ptr(), coilMap.get_number_of_bytes());
+    cuGrappaPinnedHost pinConv(convKer.get_data_ptr(), convKer.get_number_of_bytes());
+    cuGrappaPinnedHost pinUnmix(unmixCoeff.get_data_ptr(), unmixCoeff.get_number_of_bytes());
+    cuGrappaPinnedHost pinG(gFactor.get_data_ptr(), gFactor.get_number_of_bytes());
+
+    // two slots of unit buffers
+    cuNDArray<T> dSrc[2], dDst[2], dCoil[2], dConv[2], dUnmix[2];
+    cuNDArray<REAL> dG[2];
+    for (int s = 0; s < 2 && s < (int)U; s++) {
+      dSrc[s].create(refRO, refE1, srcCHA);
+      dDst[s].create(refRO, refE1, dstCHA);
+      dCoil[s].create(RO, E1, dstCHA);
+      dConv[s].create(convKRO, convKE1, srcCHA, dstCHA);
+      dUnmix[s].create(RO, E1, srcCHA);
+      dG[s].create(RO, E1);
+    }
+
+    cuNDArray<T> ker, kIm;
+
+    cuGrappaPipeline pipe;
+
+    for (size_t u = 0; u < U; u++) {
+      const int slot = (int)(u%2);
+
+      // the inputs of the next unit go to the other slot, released by the compute of unit u-1
+      for (size_t v = (u == 0) ? 0 : u + 1; v <= u + 1 && v < U; v++) {
+        const int vslot = (int)(v%2);
+        pipe.upload(dSrc[vslot].get_data_ptr(), acsSrc.get_data_ptr() + v*numSrc, numSrc);
+        pipe.upload(dDst[vslot].get_data_ptr(), acsDst.get_data_ptr() + v*numDst, numDst);
+        pipe.upload(dCoil[vslot].get_data_ptr(), coilMap.get_data_ptr() + v*numCoil, numCoil);
+        CUDA_CALL(cudaEventRecord(pipe.uploaded[vslot], pipe.stream));
+      }
+
+      pipe.begin_compute(slot, u >= 2);
+
+      // the host solves the normal equations of this unit while the copy stream moves the neighbouring units
+      cuGrappa2d_calib(dSrc[slot], dDst[slot], thres, kRO, kE1, oE1, ker);
+      cuGrappa2d_convert_to_convolution_kernel(ker, kE1, oE1, dConv[slot]);
+      cuGrappa2d_image_domain_kernel(dConv[slot], RO, E1, kIm);
+      cuGrappa2d_unmixing_coeff(kIm, dCoil[slot], acceFactorE1, dUnmix[slot], dG[slot]);
+
+      pipe.end_compute(slot);
+
+      pipe.download(convKer.get_data_ptr() + u*numConv, dConv[slot].get_data_ptr(), numConv);
+      pipe.download(unmixCoeff.get_data_ptr() + u*numUnmix, dUnmix[slot].get_data_ptr(), numUnmix);
+      pipe.download(gFactor.get_data_ptr() + u*numG, dG[slot].get_data_ptr(), numG);
+      CUDA_CALL(cudaEventRecord(pipe.downloaded[slot], pipe.stream));
+    }
+
+    CUDA_CALL(cudaStreamSynchronize(pipe.stream));
+  }
+
+  // ------------------------------------------------------------------------
+
+  template <class T> void cuGrappa2d_image_domain_unwrapping(const hoNDArray<T>& kspace, const hoNDArray<T>& unmixCoeff,
+                                                             typename realType<T>::Type scale, hoNDArray<T>& complexIm)
+  {
+    typedef typename realType<T>::Type REAL;
+
+    const size_t RO = kspace.get_size(0);
+    const size_t E1 = kspace.get_size(1);
+    const size_t CHA = kspace.get_size(2);
+    const size_t N = kspace.get_size(3);
+    const size_t S = kspace.get_size(4);
+    const size_t SLC = kspace.get_size(5);
+
+    const size_t uCHA = unmixCoeff.get_size(2);
+    const size_t refN = unmixCoeff.get_size(3);
+    const size_t refS = unmixCoeff.get_size(4);
+
+    if (unmixCoeff.get_size(0) != RO || unmixCoeff.get_size(1) != E1 || unmixCoeff.get_size(5) != SLC || refN == 0 || refS == 0) {
+      throw std::runtime_error("cuGrappa2d_image_domain_unwrapping: the unmixing coefficients do not match the kspace");
+    }
+
+    const size_t numK = RO*E1*CHA*N;
+    const size_t numU = RO*E1*uCHA*refN;
+    const size_t numR = RO*E1*N;
+    const size_t U = S*SLC;
+
+    std::vector<size_t> dims(5);
+    dims[0] = RO; dims[1] = E1; dims[2] = N; dims[3] = S; dims[4] = SLC;
+    if (complexIm.get_number_of_elements() != numR*U) complexIm.create(&dims);
+
+    if (U == 0 || numR == 0) return;
+
+    cuGrappaPinnedHost pinK(kspace.get_data_ptr(), kspace.get_number_of_bytes());
+    cuGrappaPinnedHost pinU(unmixCoeff.get_data_ptr(), unmixCoeff.get_number_of_bytes());
+    cuGrappaPinnedHost pinR(complexIm.get_data_ptr(), complexIm.get_number_of_bytes());
+
+    cuNDArray<T> dK[2], dU[2], dR[2];
+    for (int s = 0; s < 2 && s < (int)U; s++) {
+      dK[s].create(RO, E1, CHA, N);
+      dU[s].create(RO, E1, uCHA, refN);
+      dR[s].create(RO, E1, N);
+    }
+
+    cuGrappaPipeline pipe;
+
+    for (size_t u = 0; u < U; u++) {
+      const int slot = (int)(u%2);
+
+      for (size_t v = (u == 0) ? 0 : u + 1; v <= u + 1 && v < U; v++) {
+        const int vslot = (int)(v%2);
+        const size_t s = v%S;
+        const size_t slc = v/S;
+        const size_t usedS = (s < refS) ? s : refS - 1;
+        pipe.upload(dK[vslot].get_data_ptr(), kspace.get_data_ptr() + v*numK, numK);
+        pipe.upload(dU[vslot].get_data_ptr(), unmixCoeff.get_data_ptr() + (usedS + refS*slc)*numU, numU);
+        CUDA_CALL(cudaEventRecord(pipe.uploaded[vslot], pipe.stream));
+      }
+
+      pipe.begin_compute(slot, u >= 2);
+
+      // aliased images in place, then the channel combination
+      grappa2d_ifft2c(dK[slot]);
+      cuGrappa2d_apply_unmix_coeff_aliased_image(dK[slot], dU[slot], scale, dR[slot]);
+
+      pipe.end_compute(slot);
+
+      pipe.download(complexIm.get_data_ptr() + u*numR, dR[slot].get_data_ptr(), numR);
+      CUDA_CALL(cudaEventRecord(pipe.downloaded[slot], pipe.stream));
+    }
+
+    CUDA_CALL(cudaStreamSynchronize(pipe.stream));
+  }
+
+  // ------------------------------------------------------------------------
+
+  template EXPORTGPUPMRI void cuGrappa2d_calib(const cuNDArray<float_complext>& acsSrc, const cuNDArray<float_complext>& acsDst, double thres, size_t kRO,
+                                               const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<float_complext>& ker);
+
+  template EXPORTGPUPMRI void cuGrappa2d_convert_to_convolution_kernel(const cuNDArray<float_complext>& ker, const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<float_complext>& convKer);
+
+  template EXPORTGPUPMRI void cuGrappa2d_image_domain_kernel(const cuNDArray<float_complext>& convKer, size_t RO, size_t E1, cuNDArray<float_complext>& kIm);
+
+  template EXPORTGPUPMRI void cuGrappa2d_unmixing_coeff(const cuNDArray<float_complext>& kIm, const cuNDArray<float_complext>& coilMap, size_t acceFactorE1,
+                                                        cuNDArray<float_complext>& unmixCoeff, cuNDArray<float>& gFactor);
+
+  template EXPORTGPUPMRI void cuGrappa2d_apply_unmix_coeff_aliased_image(const cuNDArray<float_complext>& aliasedIm, const cuNDArray<float_complext>& unmixCoeff,
+                                                                         float scale, cuNDArray<float_complext>& complexIm);
+
+  template EXPORTGPUPMRI void cuGrappa2d_calib_unmixing_coeff(const hoNDArray<float_complext>& acsSrc, const hoNDArray<float_complext>& acsDst, const hoNDArray<float_complext>& coilMap,
+                                                              size_t acceFactorE1, double thres, size_t kRO, const std::vector<int>& kE1, const std::vector<int>& oE1,
+                                                              hoNDArray<float_complext>& convKer, hoNDArray<float_complext>& unmixCoeff, hoNDArray<float>& gFactor);
+
+  template EXPORTGPUPMRI void cuGrappa2d_image_domain_unwrapping(const hoNDArray<float_complext>& kspace, const hoNDArray<float_complext>& unmixCoeff,
+                                                                 float scale, hoNDArray<float_complext>& complexIm);
+}
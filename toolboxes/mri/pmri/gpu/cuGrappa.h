@@ -0,0 +1,59 @@
+/** \file cuGrappa.h
+    \brief Image domain 2D GRAPPA of mri_core_grappa.h on the gpu - calibration, image domain kernel, unmixing coefficients and unwrapping.
+
+    The functions follow grappa2d_calib, grappa2d_convert_to_convolution_kernel, grappa2d_image_domain_kernel,
+    grappa2d_unmixing_coeff and apply_unmix_coeff_aliased_image and give the same results up to the float rounding.
+    The kernel pattern kE1/oE1 is the one of grappa2d_kerPattern. The image sizes RO and E1 must be even, the
+    centred transforms throw otherwise.
+*/
+
+#pragma once
+
+#include "gpupmri_export.h"
+#include "cuNDArray.h"
+#include "hoNDArray.h"
+#include "complext.h"
+
+#include <vector>
+
+namespace Gadgetron
+{
+  /// calibrate the kernel ker [kRO kNE1 srcCHA dstCHA oNE1] from acsSrc [RO E1 srcCHA] and acsDst [RO E1 dstCHA]
+  /// the normal equations are formed on the gpu and solved on the cpu, with the Tikhonov regularization of SolveLinearSystem_Tikhonov
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_calib(const cuNDArray<T>& acsSrc, const cuNDArray<T>& acsDst, double thres, size_t kRO,
+                        const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<T>& ker);
+
+  /// convert ker to the convolution kernel convKer [convKRO convKE1 srcCHA dstCHA]
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_convert_to_convolution_kernel(const cuNDArray<T>& ker, const std::vector<int>& kE1, const std::vector<int>& oE1, cuNDArray<T>& convKer);
+
+  /// image domain kernel kIm [RO E1 srcCHA dstCHA] of convKer
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_image_domain_kernel(const cuNDArray<T>& convKer, size_t RO, size_t E1, cuNDArray<T>& kIm);
+
+  /// unmixing coefficients unmixCoeff [RO E1 srcCHA] and gFactor [RO E1] from kIm [RO E1 srcCHA dstCHA] and coilMap [RO E1 dstCHA]
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_unmixing_coeff(const cuNDArray<T>& kIm, const cuNDArray<T>& coilMap, size_t acceFactorE1,
+                                 cuNDArray<T>& unmixCoeff, cuNDArray<typename realType<T>::Type>& gFactor);
+
+  /// complexIm [RO E1 N] from aliasedIm [RO E1 CHA N] and unmixCoeff [RO E1 uCHA refN], scaled by scale
+  /// the first min(CHA, uCHA) channels are combined and the last unmixing coefficients are used for n >= refN
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_apply_unmix_coeff_aliased_image(const cuNDArray<T>& aliasedIm, const cuNDArray<T>& unmixCoeff,
+                                                  typename realType<T>::Type scale, cuNDArray<T>& complexIm);
+
+  /// calibrate every unit of acsSrc [refRO refE1 srcCHA U] and acsDst [refRO refE1 dstCHA U] with coilMap [RO E1 dstCHA U]
+  /// into convKer [convKRO convKE1 srcCHA dstCHA U], unmixCoeff [RO E1 srcCHA U] and gFactor [RO E1 U]
+  /// while a unit is calibrated, the inputs of the next unit are uploaded and the results of the previous unit downloaded on a second stream
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_calib_unmixing_coeff(const hoNDArray<T>& acsSrc, const hoNDArray<T>& acsDst, const hoNDArray<T>& coilMap,
+                                       size_t acceFactorE1, double thres, size_t kRO, const std::vector<int>& kE1, const std::vector<int>& oE1,
+                                       hoNDArray<T>& convKer, hoNDArray<T>& unmixCoeff, hoNDArray<typename realType<T>::Type>& gFactor);
+
+  /// unwrap kspace [RO E1 CHA N S SLC] with unmixCoeff [RO E1 uCHA refN refS SLC] into complexIm [RO E1 N S SLC], scaled by scale
+  /// the last unmixing coefficients are used for n >= refN and s >= refS, the kspace of the next S/SLC unit is uploaded while a unit is unwrapped
+  template <class T> EXPORTGPUPMRI
+  void cuGrappa2d_image_domain_unwrapping(const hoNDArray<T>& kspace, const hoNDArray<T>& unmixCoeff,
+                                          typename realType<T>::Type scale, hoNDArray<T>& complexIm);
+}
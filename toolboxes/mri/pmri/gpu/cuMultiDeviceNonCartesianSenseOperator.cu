@@ -0,0 +1,370 @@
+#include "cuMultiDeviceNonCartesianSenseOperator.h"
+#include "vector_td_utilities.h"
+#include "check_CUDA.h"
+
+#include <thread>
+#include <exception>
+
+using namespace Gadgetron;
+
+namespace {
+
+  // Copies 'dims' worth of elements, starting at 'offset' in 'in', to a new array on 'device'
+  template<class T> boost::shared_ptr< cuNDArray<T> >
+  copy_to_device( cuNDArray<T> *in, size_t offset, std::vector<size_t> dims, int device )
+  {
+    boost::shared_ptr< cuNDArray<T> > out( new cuNDArray<T>(&dims, device) );
+    CUDA_CALL(cudaMemcpyPeer( out->get_data_ptr(), device, in->get_data_ptr()+offset, in->get_device(),
+                              out->get_number_of_elements()*sizeof(T) ));
+    return out;
+  }
+
+  // A view of 'dims' worth of elements of 'in' if 'in' resides on 'device', a copy on 'device' otherwise
+  template<class T> boost::shared_ptr< cuNDArray<T> >
+  view_on_device( cuNDArray<T> *in, size_t offset, std::vector<size_t> dims, int device )
+  {
+    if( in->get_device() == device )
+      return boost::shared_ptr< cuNDArray<T> >( new cuNDArray<T>(&dims, in->get_data_ptr()+offset) );
+    return copy_to_device( in, offset, dims, device );
+  }
+}
+
+template<class REAL, unsigned int D, bool ATOMICS>
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::cuMultiDeviceNonCartesianSenseOperator( std::vector<int> devices )
+  : cuSenseOperator<REAL,D>(), devices_(devices), is_preprocessed_(false), use_toeplitz_(false)
+{
+  if( devices_.empty() ){
+    int num_devices;
+    CUDA_CALL(cudaGetDeviceCount(&num_devices));
+    for( int i=0; i<num_devices; i++ )
+      devices_.push_back(i);
+  }
+
+  if( devices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator: no devices available");
+  }
+
+  // Enable peer access between all pairs of devices that support it.
+  // cudaMemcpyPeer stages the transfers through the host for the others.
+
+  int cur_device;
+  CUDA_CALL(cudaGetDevice(&cur_device));
+
+  for( size_t i=0; i<devices_.size(); i++ ){
+    CUDA_CALL(cudaSetDevice(devices_[i]));
+    for( size_t j=0; j<devices_.size(); j++ ){
+      int can_access = 0;
+      if( i == j || cudaDeviceCanAccessPeer(&can_access, devices_[i], devices_[j]) != cudaSuccess || !can_access )
+        continue;
+      if( cudaDeviceEnablePeerAccess(devices_[j], 0) != cudaSuccess )
+        cudaGetLastError(); // already enabled
+    }
+  }
+
+  CUDA_CALL(cudaSetDevice(cur_device));
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> template<class F> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::for_each_slice( F fun )
+{
+  std::vector<std::exception_ptr> errors(slices_.size());
+  std::vector<std::thread> threads;
+
+  for( size_t i=0; i<slices_.size(); i++ ){
+    threads.push_back( std::thread( [&,i]() {
+      try{
+        CUDA_CALL(cudaSetDevice(slices_[i].device));
+        fun(slices_[i], i);
+      }
+      catch(...){
+        errors[i] = std::current_exception();
+      }
+    }));
+  }
+
+  for( size_t i=0; i<threads.size(); i++ )
+    threads[i].join();
+
+  for( size_t i=0; i<errors.size(); i++ ){
+    if( errors[i] )
+      std::rethrow_exception(errors[i]);
+  }
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::reduce( std::vector< boost::shared_ptr< cuNDArray< complext<REAL> > > > &partials,
+                                                               cuNDArray< complext<REAL> > *out, bool out_written )
+{
+  int cur_device;
+  CUDA_CALL(cudaGetDevice(&cur_device));
+  CUDA_CALL(cudaSetDevice(out->get_device()));
+
+  if( !out_written ){
+    clear(out);
+  }
+
+  for( size_t i=0; i<partials.size(); i++ ){
+    if( partials[i].get() )
+      *out += *partials[i];
+  }
+
+  CUDA_CALL(cudaSetDevice(cur_device));
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::mult_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate )
+{
+  if( !in || !out ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_M : 0x0 input/output not accepted");
+  }
+  if ( !in->dimensions_equal(&this->domain_dims_) || !out->dimensions_equal(&this->codomain_dims_)){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_M: input/output arrays do not match specified domain/codomains");
+  }
+  if( slices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_M: csm not set");
+  }
+
+  const size_t samples_per_coil = out->get_number_of_elements()/this->ncoils_;
+  const int home = out->get_device();
+
+  // Only the coils computed on the home device can be written (or accumulated) in place
+  std::vector< boost::shared_ptr< cuNDArray< complext<REAL> > > > results(slices_.size());
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t idx ){
+      std::vector<size_t> codims = *slice.op->get_codomain_dimensions();
+      boost::shared_ptr< cuNDArray< complext<REAL> > > image = view_on_device( in, 0, this->domain_dims_, slice.device );
+
+      if( slice.device == home ){
+        cuNDArray< complext<REAL> > out_view( &codims, out->get_data_ptr()+slice.coil_offset*samples_per_coil );
+        slice.op->mult_M( image.get(), &out_view, accumulate );
+      }
+      else{
+        cuNDArray< complext<REAL> > tmp(&codims);
+        slice.op->mult_M( image.get(), &tmp );
+        if( accumulate )
+          results[idx] = copy_to_device( &tmp, 0, codims, home );
+        else
+          CUDA_CALL(cudaMemcpyPeer( out->get_data_ptr()+slice.coil_offset*samples_per_coil, home,
+                                    tmp.get_data_ptr(), slice.device, tmp.get_number_of_elements()*sizeof(complext<REAL>) ));
+      }
+    });
+
+  if( accumulate ){
+    int cur_device;
+    CUDA_CALL(cudaGetDevice(&cur_device));
+    CUDA_CALL(cudaSetDevice(home));
+    for( size_t i=0; i<slices_.size(); i++ ){
+      if( !results[i].get() ) continue;
+      std::vector<size_t> codims = *results[i]->get_dimensions();
+      cuNDArray< complext<REAL> > out_view( &codims, out->get_data_ptr()+slices_[i].coil_offset*samples_per_coil );
+      out_view += *results[i];
+    }
+    CUDA_CALL(cudaSetDevice(cur_device));
+  }
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::mult_MH( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate )
+{
+  if( !in || !out ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH : 0x0 input/output not accepted");
+  }
+  if ( !in->dimensions_equal(&this->codomain_dims_) || !out->dimensions_equal(&this->domain_dims_)){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH: input/output arrays do not match specified domain/codomains");
+  }
+  if( slices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH: csm not set");
+  }
+
+  const size_t samples_per_coil = in->get_number_of_elements()/this->ncoils_;
+  const int home = out->get_device();
+
+  std::vector< boost::shared_ptr< cuNDArray< complext<REAL> > > > partials(slices_.size());
+  bool out_written = accumulate;
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t idx ){
+      std::vector<size_t> codims = *slice.op->get_codomain_dimensions();
+      boost::shared_ptr< cuNDArray< complext<REAL> > > data =
+        view_on_device( in, slice.coil_offset*samples_per_coil, codims, slice.device );
+
+      if( slice.device == home ){
+        slice.op->mult_MH( data.get(), out, accumulate );
+      }
+      else{
+        cuNDArray< complext<REAL> > tmp(&this->domain_dims_);
+        slice.op->mult_MH( data.get(), &tmp );
+        partials[idx] = copy_to_device( &tmp, 0, this->domain_dims_, home );
+      }
+    });
+
+  for( size_t i=0; i<slices_.size(); i++ )
+    out_written |= (slices_[i].device == home);
+
+  reduce( partials, out, out_written );
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::mult_MH_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate )
+{
+  if( !in || !out ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH_M : 0x0 input/output not accepted");
+  }
+  if ( !in->dimensions_equal(&this->domain_dims_) || !out->dimensions_equal(&this->domain_dims_)){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH_M: input/output arrays do not match specified domain");
+  }
+  if( slices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::mult_MH_M: csm not set");
+  }
+
+  const int home = out->get_device();
+
+  std::vector< boost::shared_ptr< cuNDArray< complext<REAL> > > > partials(slices_.size());
+  bool out_written = accumulate;
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t idx ){
+      boost::shared_ptr< cuNDArray< complext<REAL> > > image = view_on_device( in, 0, this->domain_dims_, slice.device );
+
+      if( slice.device == home ){
+        slice.op->mult_MH_M( image.get(), out, accumulate );
+      }
+      else{
+        cuNDArray< complext<REAL> > tmp(&this->domain_dims_);
+        slice.op->mult_MH_M( image.get(), &tmp );
+        partials[idx] = copy_to_device( &tmp, 0, this->domain_dims_, home );
+      }
+    });
+
+  for( size_t i=0; i<slices_.size(); i++ )
+    out_written |= (slices_[i].device == home);
+
+  reduce( partials, out, out_written );
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::set_csm( boost::shared_ptr< cuNDArray< complext<REAL> > > csm )
+{
+  if( this->domain_dims_.empty() || this->codomain_dims_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::set_csm: domain/codomain dimensions must be set before the csm");
+  }
+
+  if( csm.get() && csm->get_number_of_dimensions() != D+1 ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::set_csm: batched coil maps are not supported");
+  }
+
+  cuSenseOperator<REAL,D>::set_csm(csm);
+
+  if( this->codomain_dims_.back() != this->ncoils_ ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::set_csm: last codomain dimension does not match the number of coils");
+  }
+
+  // Split the coils into contiguous ranges of (almost) equal size.
+  // The operators (and their NFFT plans) are kept as long as the split does not change.
+
+  const unsigned int num_slices = std::min<unsigned int>( devices_.size(), this->ncoils_ );
+  std::vector<DeviceSlice> slices(num_slices);
+  unsigned int coil_offset = 0;
+  for( unsigned int i=0; i<num_slices; i++ ){
+    slices[i].device = devices_[i];
+    slices[i].coil_offset = coil_offset;
+    slices[i].ncoils = this->ncoils_/num_slices + ((i < this->ncoils_%num_slices) ? 1 : 0);
+    coil_offset += slices[i].ncoils;
+  }
+
+  bool keep_operators = (slices.size() == slices_.size());
+  for( size_t i=0; keep_operators && i<slices.size(); i++ )
+    keep_operators = (slices[i].ncoils == slices_[i].ncoils);
+
+  if( keep_operators ){
+    for( size_t i=0; i<slices.size(); i++ )
+      slices[i].op = slices_[i].op;
+  }
+  else{
+    is_preprocessed_ = false;
+  }
+
+  slices_ = slices;
+
+  const size_t elements_per_coil = csm->get_number_of_elements()/this->ncoils_;
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t ){
+      std::vector<size_t> codims = this->codomain_dims_;
+      codims.back() = slice.ncoils;
+
+      if( !slice.op.get() ){
+        slice.op = boost::shared_ptr< cuNonCartesianSenseOperator<REAL,D,ATOMICS> >( new cuNonCartesianSenseOperator<REAL,D,ATOMICS>() );
+        slice.op->set_use_toeplitz( use_toeplitz_ );
+        if( dcw_.get() )
+          slice.op->set_dcw( view_on_device( dcw_.get(), 0, *dcw_->get_dimensions(), slice.device ) );
+      }
+      slice.op->set_domain_dimensions( &this->domain_dims_ );
+      slice.op->set_codomain_dimensions( &codims );
+
+      std::vector<size_t> csm_dims = *csm->get_dimensions();
+      csm_dims.back() = slice.ncoils;
+      slice.op->set_csm( copy_to_device( csm.get(), slice.coil_offset*elements_per_coil, csm_dims, slice.device ) );
+    });
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W )
+{
+  if( slices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::setup: csm not set");
+  }
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t ){
+      slice.op->setup( matrix_size, matrix_size_os, W );
+    });
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::preprocess( cuNDArray<_reald> *trajectory )
+{
+  if( trajectory == 0x0 ){
+    throw std::runtime_error( "cuMultiDeviceNonCartesianSenseOperator: cannot preprocess 0x0 trajectory.");
+  }
+  if( slices_.empty() ){
+    throw std::runtime_error("cuMultiDeviceNonCartesianSenseOperator::preprocess: csm not set");
+  }
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t ){
+      slice.op->set_use_toeplitz( use_toeplitz_ );
+      slice.op->preprocess( view_on_device( trajectory, 0, *trajectory->get_dimensions(), slice.device ).get() );
+    });
+
+  is_preprocessed_ = true;
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuMultiDeviceNonCartesianSenseOperator<REAL,D,ATOMICS>::set_dcw( boost::shared_ptr< cuNDArray<REAL> > dcw )
+{
+  dcw_ = dcw;
+
+  if( !dcw_.get() || slices_.empty() )
+    return;
+
+  for_each_slice( [&]( DeviceSlice &slice, size_t ){
+      slice.op->set_dcw( view_on_device( dcw_.get(), 0, *dcw_->get_dimensions(), slice.device ) );
+    });
+}
+
+//
+// Instantiations
+//
+
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,1,true>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,1,false>;
+
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,2,true>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,2,false>;
+
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,3,true>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,3,false>;
+
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,4,true>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<float,4,false>;
+
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<double,1,false>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<double,2,false>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<double,3,false>;
+template class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<double,4,false>;
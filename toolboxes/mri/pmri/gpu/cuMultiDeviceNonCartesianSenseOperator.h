@@ -0,0 +1,78 @@
+/** \file cuMultiDeviceNonCartesianSenseOperator.h
+    \brief Non-Cartesian Sense operator distributing the coils over several GPUs.
+
+    The coils are split into contiguous ranges, one per device. Each device holds its
+    part of the coil sensitivity maps and its own cuNonCartesianSenseOperator (and cuNFFT_plan).
+    Images and k-space data reside on the device of the arrays passed to mult_M/mult_MH,
+    the "home" device. Coil ranges are copied between the devices with peer-to-peer transfers
+    (cudaMemcpyPeer, staged through the host if peer access is not available) and the partial
+    coil combinations are summed on the home device.
+    To the solvers the operator behaves exactly like a cuNonCartesianSenseOperator.
+*/
+
+#pragma once
+
+#include "cuNonCartesianSenseOperator.h"
+
+namespace Gadgetron{
+
+  template<class REAL, unsigned int D, bool ATOMICS = false> class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator : public cuSenseOperator<REAL,D>
+  {
+
+  public:
+
+    typedef typename uint64d<D>::Type _uint64d;
+    typedef typename reald<REAL,D>::Type _reald;
+
+    // An empty device list selects all devices in the system
+    cuMultiDeviceNonCartesianSenseOperator( std::vector<int> devices = std::vector<int>() );
+    virtual ~cuMultiDeviceNonCartesianSenseOperator() {}
+
+    inline std::vector<int> get_devices() { return devices_; }
+    inline boost::shared_ptr< cuNDArray<REAL> > get_dcw() { return dcw_; }
+    inline bool is_preprocessed() { return is_preprocessed_; }
+
+    virtual void mult_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
+    virtual void mult_MH( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
+
+    // Every device applies the normal operator of its coils, only the image is transferred
+    virtual void mult_MH_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
+
+    // The domain and codomain dimensions must be set before the csm.
+    // The last codomain dimension is the coil dimension.
+    virtual void set_csm( boost::shared_ptr< cuNDArray< complext<REAL> > > csm );
+
+    virtual void setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W );
+    virtual void preprocess( cuNDArray<_reald> *trajectory );
+    virtual void set_dcw( boost::shared_ptr< cuNDArray<REAL> > dcw );
+
+    inline void set_use_toeplitz( bool use_toeplitz ) { use_toeplitz_ = use_toeplitz; }
+    inline bool get_use_toeplitz() { return use_toeplitz_; }
+
+  protected:
+
+    struct DeviceSlice {
+      int device;
+      unsigned int coil_offset;
+      unsigned int ncoils;
+      boost::shared_ptr< cuNonCartesianSenseOperator<REAL,D,ATOMICS> > op;
+    };
+
+    // Runs fun(slice) for every slice in its own host thread with the slice's device current.
+    // Exceptions thrown by a slice are rethrown after all threads have finished.
+    template<class F> void for_each_slice( F fun );
+
+    // Adds the partial images computed on the other devices to out
+    void reduce( std::vector< boost::shared_ptr< cuNDArray< complext<REAL> > > > &partials,
+                 cuNDArray< complext<REAL> > *out, bool out_written );
+
+    std::vector<int> devices_;
+    std::vector<DeviceSlice> slices_;
+    boost::shared_ptr< cuNDArray<REAL> > dcw_;
+    bool is_preprocessed_;
+    bool use_toeplitz_;
+  };
+
+  //Atomics can't be used with doubles
+  template<unsigned int D> class EXPORTGPUPMRI cuMultiDeviceNonCartesianSenseOperator<double,D,true>{};
+}
@@ -53,6 +53,35 @@ cuNonCartesianSenseOperator<REAL,D,ATOMICS>::mult_MH( cuNDArray< complext<REAL>
   this->mult_csm_conj_sum( &tmp, out );
 }
 
+template<class REAL, unsigned int D, bool ATOMICS> void
+cuNonCartesianSenseOperator<REAL,D,ATOMICS>::mult_MH_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate )
+{
+  if( !use_toeplitz_ || !plan_->is_toeplitz_preprocessed() ){
+    cuSenseOperator<REAL,D>::mult_MH_M( in, out, accumulate );
+    return;
+  }
+
+  if( !in || !out ){
+    throw std::runtime_error("cuNonCartesianSenseOperator::mult_MH_M : 0x0 input/output not accepted");
+  }
+  if ( !in->dimensions_equal(&this->domain_dims_) || !out->dimensions_equal(&this->domain_dims_)){
+    throw std::runtime_error("cuNonCartesianSenseOperator::mult_MH_M: input/output arrays do not match specified domain");
+  }
+
+  std::vector<size_t> full_dimensions = *this->get_domain_dimensions();
+  full_dimensions.push_back(this->ncoils_);
+  cuNDArray< complext<REAL> > tmp(&full_dimensions), tmp_out(&full_dimensions);
+  this->mult_csm( in, &tmp );
+
+  plan_->mult_MH_M_toeplitz( &tmp, &tmp_out );
+
+  if( !accumulate ){
+    clear(out);
+  }
+
+  this->mult_csm_conj_sum( &tmp_out, out );
+}
+
 template<class REAL, unsigned int D, bool ATOMICS> void
 cuNonCartesianSenseOperator<REAL,D,ATOMICS>::setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W )
 {  
@@ -71,6 +100,9 @@ cuNonCartesianSenseOperator<REAL,D,ATOMICS>::preprocess( cuNDArray<_reald> *traj
     throw std::runtime_error("cuNonCartesianSenseOperator::preprocess : operator domain dimensions not set");
   }
   plan_->preprocess( trajectory, cuNFFT_plan<REAL,D,ATOMICS>::NFFT_PREP_ALL );
+  if( use_toeplitz_ ){
+    plan_->preprocess_toeplitz( trajectory, dcw_.get() );
+  }
   is_preprocessed_ = true;
 }
 
@@ -20,6 +20,7 @@ namespace Gadgetron{
     cuNonCartesianSenseOperator() : cuSenseOperator<REAL,D>() { 
       plan_ = boost::shared_ptr< cuNFFT_plan<REAL, D, ATOMICS> >( new cuNFFT_plan<REAL, D, ATOMICS>() );
       is_preprocessed_ = false;
+      use_toeplitz_ = false;
     }
     
     virtual ~cuNonCartesianSenseOperator() {}
@@ -31,16 +32,24 @@ namespace Gadgetron{
     virtual void mult_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
     virtual void mult_MH( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
 
+    // Applies the normal operator with the Toeplitz kernel of the plan if use_toeplitz is set
+    virtual void mult_MH_M( cuNDArray< complext<REAL> >* in, cuNDArray< complext<REAL> >* out, bool accumulate = false );
+
     virtual void setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W );
     virtual void preprocess( cuNDArray<_reald> *trajectory );
     virtual void set_dcw( boost::shared_ptr< cuNDArray<REAL> > dcw );
 
+    // Compute a Toeplitz kernel for mult_MH_M in preprocess, with the dcw set before
+    inline void set_use_toeplitz( bool use_toeplitz ) { use_toeplitz_ = use_toeplitz; }
+    inline bool get_use_toeplitz() { return use_toeplitz_; }
+
 
   
   protected:
     boost::shared_ptr< cuNFFT_plan<REAL, D, ATOMICS> > plan_;
     boost::shared_ptr< cuNDArray<REAL> > dcw_;
     bool is_preprocessed_;
+    bool use_toeplitz_;
   };
   
   //Atomics can't be used with doubles
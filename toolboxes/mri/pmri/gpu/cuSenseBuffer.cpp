@@ -1,7 +1,29 @@
 #include "cuSenseBuffer.h"
+#include "b1_map.h"
+
+#include <algorithm>
 
 namespace Gadgetron {
 
+  // The b1 map estimation is instantiated for 2D only
+  template<class REAL, unsigned int D> struct cuSenseBufferCsm
+  {
+    static boost::shared_ptr< cuNDArray< complext<REAL> > > 
+    estimate( cuNDArray< complext<REAL> > *, cuNDArray< complext<REAL> > *, unsigned int )
+    {
+      throw std::runtime_error("cuSenseBuffer::update_csm: csm estimation is only available for 2D buffers");
+    }
+  };
+
+  template<class REAL> struct cuSenseBufferCsm<REAL,2>
+  {
+    static boost::shared_ptr< cuNDArray< complext<REAL> > > 
+    estimate( cuNDArray< complext<REAL> > *data, cuNDArray< complext<REAL> > *csm_prev, unsigned int iterations )
+    {
+      return (csm_prev) ? estimate_b1_map<REAL,2>( data, csm_prev, iterations ) : estimate_b1_map<REAL,2>( data );
+    }
+  };
+
   template<class REAL, unsigned int D, bool ATOMICS>
   void cuSenseBuffer<REAL,D,ATOMICS>
   ::setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W, 
@@ -39,6 +61,58 @@ namespace Gadgetron {
     return image;
   }
   
+  template<class REAL, unsigned int D, bool ATOMICS>
+  void cuSenseBuffer<REAL,D,ATOMICS>::set_csm_update( unsigned int warm_start_iterations, REAL change_threshold, unsigned int max_update_interval )
+  {
+    csm_warm_start_iterations_ = warm_start_iterations;
+    csm_change_threshold_ = change_threshold;
+    csm_max_update_interval_ = std::max(max_update_interval, 1u);
+    csm_update_interval_ = 1;
+    csm_updates_skipped_ = 0;
+  }
+
+  template<class REAL, unsigned int D, bool ATOMICS>
+  boost::shared_ptr< cuNDArray<complext<REAL> > > cuSenseBuffer<REAL,D,ATOMICS>::update_csm()
+  {
+    // The accumulated coil images are also used for the regularization image, so they are updated on every call
+    boost::shared_ptr< cuNDArray<_complext> > coil_images = this->get_accumulated_coil_images();
+
+    if( coil_images.get() == 0x0 ){
+      throw std::runtime_error("cuSenseBuffer::update_csm: unable to acquire accumulated coil images");
+    }
+
+    if( csm_.get() && csm_->get_number_of_elements() == coil_images->get_number_of_elements() && 
+        ++csm_updates_skipped_ < csm_update_interval_ ){
+      return csm_;
+    }
+
+    csm_updates_skipped_ = 0;
+
+    boost::shared_ptr< cuNDArray<_complext> > csm_prev;
+    if( csm_.get() && csm_->get_number_of_elements() == coil_images->get_number_of_elements() )
+      csm_prev = csm_;
+
+    boost::shared_ptr< cuNDArray<_complext> > csm = cuSenseBufferCsm<REAL,D>::estimate
+      ( coil_images.get(), (csm_warm_start_iterations_ > 0) ? csm_prev.get() : 0x0, csm_warm_start_iterations_ );
+
+    if( csm.get() == 0x0 ){
+      throw std::runtime_error("cuSenseBuffer::update_csm: csm estimation failed");
+    }
+
+    // Adapt the update interval to the change of the csm
+    if( csm_prev.get() ){
+      csm_change_ = b1_map_relative_change<REAL>( csm.get(), csm_prev.get() );
+
+      if( csm_change_ < csm_change_threshold_ )
+        csm_update_interval_ = std::min(2*csm_update_interval_, csm_max_update_interval_);
+      else
+        csm_update_interval_ = 1;
+    }
+
+    set_csm(csm);
+    return csm;
+  }
+
   //
   // Instantiations
   //
@@ -16,7 +16,9 @@ namespace Gadgetron{
     typedef typename cuBuffer<REAL,D,ATOMICS>::_uint64d  _uint64d;
     typedef typename cuBuffer<REAL,D,ATOMICS>::_reald    _reald;
 
-    cuSenseBuffer() : cuBuffer<REAL,D,ATOMICS>() {}
+    cuSenseBuffer() : cuBuffer<REAL,D,ATOMICS>(), 
+      csm_warm_start_iterations_(0), csm_change_threshold_(REAL(0)), csm_max_update_interval_(1),
+      csm_update_interval_(1), csm_updates_skipped_(0), csm_change_(REAL(1)) {}
     virtual ~cuSenseBuffer() {}
 
     virtual void setup( _uint64d matrix_size, _uint64d matrix_size_os, REAL W, 
@@ -28,8 +30,26 @@ namespace Gadgetron{
     
     virtual boost::shared_ptr< cuNDArray< complext<REAL> > > get_combined_coil_image();
 
+    // Temporal csm updates (2D buffers only):
+    // - warm_start_iterations: power iterations started from the current csm, 0 to estimate every csm from scratch
+    // - change_threshold: while the relative change of consecutive csm estimates stays below, the update interval is doubled
+    // - max_update_interval: largest number of calls of update_csm per estimation, 1 to estimate at every call
+    virtual void set_csm_update( unsigned int warm_start_iterations, REAL change_threshold, unsigned int max_update_interval );
+
+    // Updates the accumulated coil images and, when the update interval has passed, estimates and sets the csm from them
+    virtual boost::shared_ptr< cuNDArray<_complext> > update_csm();
+
+    // Relative change of the csm at its last estimation
+    inline REAL get_csm_change(){ return csm_change_; }
+
   protected:
     boost::shared_ptr< cuNDArray<_complext> > csm_;
+    unsigned int csm_warm_start_iterations_;
+    REAL csm_change_threshold_;
+    unsigned int csm_max_update_interval_;
+    unsigned int csm_update_interval_;
+    unsigned int csm_updates_skipped_;
+    REAL csm_change_;
     boost::shared_ptr< cuNonCartesianSenseOperator<REAL,D,ATOMICS> > E_;    
   };
   
@@ -14,6 +14,7 @@ namespace Gadgetron{
     cuSenseBuffer<REAL,D,ATOMICS>::setup( matrix_size, matrix_size_os, W, num_coils, num_cycles, num_sub_cycles );
     
     D_ = boost::shared_ptr< cuCgPreconditioner<_complext> >( new cuCgPreconditioner<_complext>() );
+    precon_csm_.reset();
     
     cg_.set_encoding_operator( this->E_ );
     cg_.set_preconditioner( D_ );    
@@ -55,14 +56,17 @@ namespace Gadgetron{
     
     *rhs *= this->get_normalization_factor();
 
-    // Define preconditioning weights
+    // Define preconditioning weights, unless they were computed for the current csm already
     //
 
-    boost::shared_ptr< cuNDArray<REAL> > _precon_weights = sum(abs_square(this->csm_.get()).get(), D);
-    reciprocal_sqrt_inplace(_precon_weights.get());	
-    boost::shared_ptr< cuNDArray<_complext> > precon_weights = real_to_complex<_complext>( _precon_weights.get() );
-    _precon_weights.reset();
-    D_->set_weights( precon_weights ); 
+    if( precon_csm_ != this->csm_ ){
+      boost::shared_ptr< cuNDArray<REAL> > _precon_weights = sum(abs_square(this->csm_.get()).get(), D);
+      reciprocal_sqrt_inplace(_precon_weights.get());	
+      boost::shared_ptr< cuNDArray<_complext> > precon_weights = real_to_complex<_complext>( _precon_weights.get() );
+      _precon_weights.reset();
+      D_->set_weights( precon_weights ); 
+      precon_csm_ = this->csm_;
+    }
 
     // Solve
     //
@@ -32,6 +32,7 @@ namespace Gadgetron{
   protected:    
     cuCgSolver<_complext> cg_;
     boost::shared_ptr< cuCgPreconditioner<_complext> > D_;
+    boost::shared_ptr< cuNDArray<_complext> > precon_csm_; // the csm the preconditioner weights were computed from
   };
   
   // To prevent the use of atomics with doubles.
@@ -25,7 +25,9 @@ namespace Gadgetron{
     
     virtual void set_csm( boost::shared_ptr<ARRAY_TYPE> csm )
     {
-      if( csm.get() && csm->get_number_of_dimensions() == D+1 ) {
+      // D+1 dimensions: [image, coils], shared by all frames
+      // D+2 dimensions: [image, coils, batch], one set of coil maps per batch member (see cuCgSolver::set_batch_size)
+      if( csm.get() && (csm->get_number_of_dimensions() == D+1 || csm->get_number_of_dimensions() == D+2) ) {
 	csm_ = csm;      
 	ncoils_ = csm_->get_size(D);
       }
@@ -6,10 +6,11 @@ namespace Gadgetron{
 
   template<class REAL> __global__ void 
   mult_csm_kernel( const complext<REAL> * __restrict__ in, complext<REAL> * __restrict__ out, complext<REAL> *csm,
-		   size_t image_elements, unsigned int nframes, unsigned int ncoils )
+		   size_t image_elements, unsigned int nframes, unsigned int ncoils, unsigned int frames_per_csm )
   {
     unsigned int idx = blockIdx.x*blockDim.x+threadIdx.x;
     if( idx < image_elements) {
+      csm += (blockIdx.y/frames_per_csm)*image_elements*ncoils;
       complext<REAL> _in = in[idx+blockIdx.y*image_elements];
       for( unsigned int i=0; i<ncoils; i++) {
 	out[idx + blockIdx.y*image_elements + i*image_elements*nframes] =  _in * csm[idx+i*image_elements];
@@ -37,7 +38,9 @@ namespace Gadgetron{
       throw std::runtime_error("mult_csm: input dimensionality cannot exceed output dimensionality");
     }
 
-    if( csm->get_number_of_dimensions() != D+1 ) {
+    // A csm of D+2 dimensions holds one set of coil maps per batch member (e.g. slice),
+    // the frames are split evenly between the sets
+    if( csm->get_number_of_dimensions() != D+1 && csm->get_number_of_dimensions() != D+2 ) {
       throw std::runtime_error("mult_csm: input dimensionality of csm not as expected");
     }
 
@@ -46,12 +49,17 @@ namespace Gadgetron{
       num_image_elements *= in->get_size(d);
   
     unsigned int num_frames = in->get_number_of_elements() / num_image_elements;
+    unsigned int num_csm_sets = (csm->get_number_of_dimensions() == D+2) ? csm->get_size(D+1) : 1;
+
+    if( num_frames % num_csm_sets ){
+      throw std::runtime_error("mult_csm: the frames do not split into the csm sets");
+    }
   
     dim3 blockDim(256);
     dim3 gridDim((num_image_elements+blockDim.x-1)/blockDim.x, num_frames);
 
     mult_csm_kernel<REAL><<< gridDim, blockDim >>>
-      ( in->get_data_ptr(), out->get_data_ptr(), csm->get_data_ptr(), num_image_elements, num_frames, csm->get_size(D) );
+      ( in->get_data_ptr(), out->get_data_ptr(), csm->get_data_ptr(), num_image_elements, num_frames, csm->get_size(D), num_frames/num_csm_sets );
 
     cudaError_t err = cudaGetLastError();
     if( err != cudaSuccess ){
@@ -65,10 +73,11 @@ namespace Gadgetron{
 
   template <class REAL> __global__ void 
   mult_csm_conj_sum_kernel(const  complext<REAL> * __restrict__ in, complext<REAL> * __restrict__ out, const complext<REAL> * __restrict__ csm,
-			    size_t image_elements, unsigned int nframes, unsigned int ncoils )
+			    size_t image_elements, unsigned int nframes, unsigned int ncoils, unsigned int frames_per_csm )
   {
     unsigned int idx = blockIdx.x*blockDim.x+threadIdx.x;
     if( idx < image_elements ) {
+      csm += (blockIdx.y/frames_per_csm)*image_elements*ncoils;
       complext<REAL> _out =complext<REAL>(0);
       for( unsigned int i = 0; i < ncoils; i++ ) {
 	_out += in[idx+blockIdx.y*image_elements+i*nframes*image_elements] * conj(csm[idx+i*image_elements]);
@@ -97,7 +106,9 @@ namespace Gadgetron{
       throw std::runtime_error("mult_csm_conj_sum: output dimensionality cannot exceed input dimensionality");
     }
 
-    if( csm->get_number_of_dimensions() != D+1 ) {
+    // A csm of D+2 dimensions holds one set of coil maps per batch member (e.g. slice),
+    // the frames are split evenly between the sets
+    if( csm->get_number_of_dimensions() != D+1 && csm->get_number_of_dimensions() != D+2 ) {
       throw std::runtime_error("mult_csm_conj_sum: input dimensionality of csm not as expected");
     }
 
@@ -106,12 +117,17 @@ namespace Gadgetron{
       num_image_elements *= out->get_size(d);
   
     unsigned int num_frames = out->get_number_of_elements() / num_image_elements;
+    unsigned int num_csm_sets = (csm->get_number_of_dimensions() == D+2) ? csm->get_size(D+1) : 1;
+
+    if( num_frames % num_csm_sets ){
+      throw std::runtime_error("mult_csm_conj_sum: the frames do not split into the csm sets");
+    }
 
     dim3 blockDim(256);
     dim3 gridDim((num_image_elements+blockDim.x-1)/blockDim.x, num_frames);
 
     mult_csm_conj_sum_kernel<REAL><<< gridDim, blockDim >>>
-      ( in->get_data_ptr(), out->get_data_ptr(), csm->get_data_ptr(), num_image_elements, num_frames, csm->get_size(D) );
+      ( in->get_data_ptr(), out->get_data_ptr(), csm->get_data_ptr(), num_image_elements, num_frames, csm->get_size(D), num_frames/num_csm_sets );
 
     cudaError_t err = cudaGetLastError();
     if( err != cudaSuccess ){
@@ -17,6 +17,7 @@
 #include "htgrappa.h"
 
 #include <cublas_v2.h>
+#include <cufft.h>
 //#include <cula_lapack_device.h>
 
 namespace Gadgetron {
@@ -127,62 +128,17 @@ namespace Gadgetron {
     }
   }
 
-  boost::shared_ptr< cuNDArray<float_complext> > 
-  estimate_spirit_kernels( cuNDArray<float_complext> *_kspace, unsigned int kernel_size )
+  // Normal equations A^H A x = A^H b of the explicit system matrix A, 
+  // one row per k-space position and one column per coil and kernel element
+  static void
+  form_normal_equations( cuNDArray<float_complext> *kspace, unsigned int kernel_size,
+                         cuNDArray<float_complext> *AHA, cuNDArray<float_complext> *rhs )
   {
-    // Calibration is performed in k-space. 
-    // The result is Fourier transformed and returned as image space kernels.
-    // The convolution is expressed explicitly as a matrix equation an solved using BLAS/LAPACK.
-    //
-
-    if( _kspace == 0x0 ){
-      throw std::runtime_error("estimate_spirit_kernels: 0x0 input array");
-    }
-    
-    if( _kspace->get_number_of_dimensions() != 3 ) {
-      throw std::runtime_error("estimate_spirit_kernels: Only 2D spirit is supported currently");
-    }
-
-    if( (kernel_size%2) == 0 ) {
-      throw std::runtime_error("estimate_spirit_kernels: The kernel size should be odd");
-    }
-
-
-    // Normalize input array to an average intensity of one per element
-    //
-    std::vector<size_t> old_dims = *_kspace->get_dimensions();
-    std::vector<size_t> dims= old_dims;
-    /*dims[0] /= 2;
-    dims[1] /= 2;*/
-    //dims[0]=36;
-    //dims[1]=36;
-    //cuNDArray<float_complext> kspace(_kspace);
-    cuNDArray<float_complext> kspace(dims);
-
-    vector_td<size_t,2> offset((old_dims[0]-dims[0])/2,(old_dims[1]-dims[1])/2);
-    crop<float_complext,2>(offset,_kspace,&kspace);
-    float sum = nrm2(&kspace);    
-    float_complext in_max = kspace[amax(&kspace)];
-    kspace /= (float(kspace.get_number_of_elements())/sum);
-    unsigned int num_coils = kspace.get_size(kspace.get_number_of_dimensions()-1);
-    unsigned int elements_per_coil = kspace.get_number_of_elements()/num_coils;
-    
-    std::vector<size_t> out_dims;
-    out_dims.push_back(_kspace->get_size(0)); out_dims.push_back(_kspace->get_size(1));
-    out_dims.push_back(num_coils*num_coils);
-    
-    boost::shared_ptr< cuNDArray<float_complext> > kernel_images
-      ( new cuNDArray<float_complext>(&out_dims) );
-
-    // Clear to ones in case we terminate early
-    //
-
-    fill(kernel_images.get(), float_complext(1.0f/num_coils));
-
     // Form m x n system matrix A
     //
 
-    unsigned int m = elements_per_coil;
+    unsigned int num_coils = kspace->get_size(kspace->get_number_of_dimensions()-1);
+    unsigned int m = kspace->get_number_of_elements()/num_coils;
     unsigned int n = num_coils*(kernel_size*kernel_size-1);
 
     std::vector<size_t> A_dims; A_dims.push_back(m); A_dims.push_back(n);    
@@ -192,11 +148,11 @@ namespace Gadgetron {
     //
 
     dim3 blockDim; dim3 gridDim;
-    setup_grid( kspace.get_number_of_elements(), &blockDim, &gridDim );
+    setup_grid( kspace->get_number_of_elements(), &blockDim, &gridDim );
     
     compute_system_matrix_kernel<<< gridDim, blockDim >>>
-      ( intd2(kspace.get_size(0), kspace.get_size(1)), num_coils, kernel_size,
-        kspace.get_data_ptr(), A.get_data_ptr() );
+      ( intd2(kspace->get_size(0), kspace->get_size(1)), num_coils, kernel_size,
+        kspace->get_data_ptr(), A.get_data_ptr() );
 
     CHECK_FOR_CUDA_ERROR();    
 
@@ -214,19 +170,6 @@ namespace Gadgetron {
     cublasStatus_t stat;
     cublasHandle_t handle = *CUBLASContextProvider::instance()->getCublasHandle();
 
-    std::vector<size_t> AHA_dims(2,n);
-    cuNDArray<float_complext> AHA(&AHA_dims);
-
-    // Initialize AHA to identity (Tikhonov regularization)
-    //
-
-    float_complext one(1.0f);
-    clear(&AHA);
-    for( unsigned int i=0; i<n; i++ ){
-      cudaMemcpy( AHA.get_data_ptr()+i*n+i, &one, sizeof(float_complext), cudaMemcpyHostToDevice );
-    }
-    CHECK_FOR_CUDA_ERROR();
-
     float_complext alpha(1.0f);
     //float_complext beta(0.1f*in_max); // Tikhonov regularization weight
     float_complext beta(0.0f); // Tikhonov regularization weight
@@ -237,7 +180,7 @@ namespace Gadgetron {
                         (cuFloatComplex*) A.get_data_ptr(), m,
                         (cuFloatComplex*) A.get_data_ptr(), m,
                         (cuFloatComplex*) &beta, 
-                        (cuFloatComplex*) AHA.get_data_ptr(), n );
+                        (cuFloatComplex*) AHA->get_data_ptr(), n );
     
     if (stat != CUBLAS_STATUS_SUCCESS) {
       std::cerr << "CUBLAS error code " << stat << std::endl;
@@ -248,25 +191,22 @@ namespace Gadgetron {
     static int counter = 0;
     char filename[256];
     sprintf((char*)filename, "_AHA_%d.cplx", counter);
-    write_nd_array<float_complext>( AHA.to_host().get(), filename );
+    write_nd_array<float_complext>( AHA->to_host().get(), filename );
     counter++;
     */
 
     // Multiply A^H with each coil image (to form the rhs)
     //
 
-    std::vector<size_t> rhs_dims; rhs_dims.push_back(n); rhs_dims.push_back(num_coils);    
-    cuNDArray<float_complext> rhs(&rhs_dims); clear(&rhs);
-
     beta = float_complext(0.0f);
 
     stat = cublasCgemm( handle, CUBLAS_OP_C, CUBLAS_OP_N,
                         n, num_coils, m,
                         (cuFloatComplex*) &alpha,
                         (cuFloatComplex*) A.get_data_ptr(), m,
-                        (cuFloatComplex*) kspace.get_data_ptr(), m,
+                        (cuFloatComplex*) kspace->get_data_ptr(), m,
                         (cuFloatComplex*) &beta, 
-                        (cuFloatComplex*) rhs.get_data_ptr(), n );
+                        (cuFloatComplex*) rhs->get_data_ptr(), n );
     
     if (stat != CUBLAS_STATUS_SUCCESS) {
       std::cerr << "CUBLAS error code " << stat << std::endl;
@@ -277,11 +217,202 @@ namespace Gadgetron {
     static int counter = 0;
     char filename[256];
     sprintf((char*)filename, "_rhs_%d.cplx", counter);
-    write_nd_array<float_complext>( rhs.to_host().get(), filename );
+    write_nd_array<float_complext>( rhs->to_host().get(), filename );
     counter++;
     */
+  }
+
+  // Index shift of kernel element kernel_idx in the k-space of width dims[0], as in compute_system_matrix_kernel
+  __device__ static int 
+  kernel_element_shift( int kernel_idx, int kernel_size, int width )
+  {
+    const int half_kernel_size = kernel_size>>1;
+    const int center = (kernel_size*kernel_size)>>1;
+    const int idx = (kernel_idx < center) ? kernel_idx : kernel_idx+1; // The central point is not part of the kernel
+    const int i = idx%kernel_size - half_kernel_size;
+    const int j = idx/kernel_size - half_kernel_size;
+    return j*width+i;
+  }
+
+  static __global__ void 
+  cross_spectra_kernel( int elements_per_coil,
+                        int num_coils,
+                        int coil,
+                        const float_complext * __restrict__ spectra,
+                        float_complext * __restrict__ cross_spectra )
+  {
+    const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
 
+    if( idx < elements_per_coil*num_coils ){
+      const int f = idx%elements_per_coil;
+      cross_spectra[idx] = conj(spectra[coil*elements_per_coil+f])*spectra[idx];
+    }
+  }
 
+  static __global__ void 
+  gather_normal_equations_kernel( intd2 dims,
+                                  int num_coils,
+                                  int kernel_size,
+                                  int coil,
+                                  const float_complext * __restrict__ correlations,
+                                  float_complext * __restrict__ AHA,
+                                  float_complext * __restrict__ rhs )
+  {
+    // One thread per entry of the rows of 'coil' in AHA (column major, n x n) and rhs (column major, n x num_coils).
+    // correlations holds elements_per_coil*R(d) for all coils c2, with R(d) = sum_p conj(k_coil[p]) k_c2[p+d].
+    // A has the entries A[m,(c,s)] = k_c[m-s], hence
+    //   AHA[(coil,s1),(c2,s2)] = R(s1-s2) and rhs[(coil,s1),c2] = R(s1).
+    //
+
+    const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x+threadIdx.x;
+    const int num_kernel_elements = kernel_size*kernel_size-1;
+    const int elements_per_coil = prod(dims);
+    const int n = num_coils*num_kernel_elements;
+
+    if( idx < num_kernel_elements*num_coils*(num_kernel_elements+1) ){
+
+      const int k1 = idx%num_kernel_elements;
+      const int c2 = (idx/num_kernel_elements)%num_coils;
+      const int k2 = idx/(num_kernel_elements*num_coils); // num_kernel_elements denotes the rhs
+      
+      const int row = coil*num_kernel_elements + k1;
+      const int s1 = kernel_element_shift( k1, kernel_size, dims[0] );
+      const float scale = 1.0f/float(elements_per_coil);
+
+      if( k2 < num_kernel_elements ){
+        const int s2 = kernel_element_shift( k2, kernel_size, dims[0] );
+        const int d = ((s1-s2)%elements_per_coil+elements_per_coil)%elements_per_coil;
+        AHA[(c2*num_kernel_elements+k2)*n+row] = scale*correlations[c2*elements_per_coil+d];
+      }
+      else{
+        const int d = (s1%elements_per_coil+elements_per_coil)%elements_per_coil;
+        rhs[c2*n+row] = scale*correlations[c2*elements_per_coil+d];
+      }
+    }
+  }
+
+  // The same normal equations from the circular cross-correlations of the coils, computed by FFTs.
+  // A shifts the k-space circularly (over the linear index), so every entry of A^H A and A^H b is a cross-correlation 
+  // of two coils at the difference of the kernel shifts. The cost is independent of the number of rows of A.
+  static void
+  form_normal_equations_fft( cuNDArray<float_complext> *kspace, unsigned int kernel_size,
+                             cuNDArray<float_complext> *AHA, cuNDArray<float_complext> *rhs )
+  {
+    const int num_coils = kspace->get_size(kspace->get_number_of_dimensions()-1);
+    const int elements_per_coil = kspace->get_number_of_elements()/num_coils;
+    const int num_kernel_elements = kernel_size*kernel_size-1;
+
+    cufftHandle plan;
+    if( cufftPlan1d( &plan, elements_per_coil, CUFFT_C2C, num_coils ) != CUFFT_SUCCESS ) {
+      throw std::runtime_error("estimate_spirit_kernels: failed to create cufft plan");
+    }
+
+    // Spectra of the coils over the linear k-space index
+    //
+
+    cuNDArray<float_complext> spectra(*kspace);
+    cuNDArray<float_complext> cross_spectra(*kspace->get_dimensions());
+
+    if( cufftExecC2C( plan, (cufftComplex*)spectra.get_data_ptr(), (cufftComplex*)spectra.get_data_ptr(), CUFFT_FORWARD ) != CUFFT_SUCCESS ) {
+      cufftDestroy(plan);
+      throw std::runtime_error("estimate_spirit_kernels: cufft error computing the coil spectra");
+    }
+
+    dim3 blockDim; dim3 gridDim;
+    dim3 blockDimGather; dim3 gridDimGather;
+    setup_grid( elements_per_coil*num_coils, &blockDim, &gridDim );
+    setup_grid( num_kernel_elements*num_coils*(num_kernel_elements+1), &blockDimGather, &gridDimGather );
+
+    // One block row of the normal equations per coil
+    //
+
+    for( int coil=0; coil<num_coils; coil++ ){
+
+      cross_spectra_kernel<<< gridDim, blockDim >>>
+        ( elements_per_coil, num_coils, coil, spectra.get_data_ptr(), cross_spectra.get_data_ptr() );
+
+      if( cufftExecC2C( plan, (cufftComplex*)cross_spectra.get_data_ptr(), (cufftComplex*)cross_spectra.get_data_ptr(), CUFFT_INVERSE ) != CUFFT_SUCCESS ) {
+        cufftDestroy(plan);
+        throw std::runtime_error("estimate_spirit_kernels: cufft error computing the coil correlations");
+      }
+
+      gather_normal_equations_kernel<<< gridDimGather, blockDimGather >>>
+        ( intd2(kspace->get_size(0), kspace->get_size(1)), num_coils, kernel_size, coil,
+          cross_spectra.get_data_ptr(), AHA->get_data_ptr(), rhs->get_data_ptr() );
+    }
+
+    cufftDestroy(plan);
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  boost::shared_ptr< cuNDArray<float_complext> > 
+  estimate_spirit_kernels( cuNDArray<float_complext> *_kspace, unsigned int kernel_size, bool fft_calibration )
+  {
+    // Calibration is performed in k-space. 
+    // The result is Fourier transformed and returned as image space kernels.
+    // The convolution is expressed as a matrix equation an solved using BLAS/LAPACK.
+    // The normal equations are formed from the explicit matrix, or from the coil cross-correlations (fft_calibration).
+    // They share the matrix A^H A between all target coils, so a single Cholesky factorization solves for all coils.
+    //
+
+    if( _kspace == 0x0 ){
+      throw std::runtime_error("estimate_spirit_kernels: 0x0 input array");
+    }
+    
+    if( _kspace->get_number_of_dimensions() != 3 ) {
+      throw std::runtime_error("estimate_spirit_kernels: Only 2D spirit is supported currently");
+    }
+
+    if( (kernel_size%2) == 0 ) {
+      throw std::runtime_error("estimate_spirit_kernels: The kernel size should be odd");
+    }
+
+
+    // Normalize input array to an average intensity of one per element
+    //
+    std::vector<size_t> old_dims = *_kspace->get_dimensions();
+    std::vector<size_t> dims= old_dims;
+    /*dims[0] /= 2;
+    dims[1] /= 2;*/
+    //dims[0]=36;
+    //dims[1]=36;
+    //cuNDArray<float_complext> kspace(_kspace);
+    cuNDArray<float_complext> kspace(dims);
+
+    vector_td<size_t,2> offset((old_dims[0]-dims[0])/2,(old_dims[1]-dims[1])/2);
+    crop<float_complext,2>(offset,_kspace,&kspace);
+    float sum = nrm2(&kspace);    
+    float_complext in_max = kspace[amax(&kspace)];
+    kspace /= (float(kspace.get_number_of_elements())/sum);
+    unsigned int num_coils = kspace.get_size(kspace.get_number_of_dimensions()-1);
+    
+    std::vector<size_t> out_dims;
+    out_dims.push_back(_kspace->get_size(0)); out_dims.push_back(_kspace->get_size(1));
+    out_dims.push_back(num_coils*num_coils);
+    
+    boost::shared_ptr< cuNDArray<float_complext> > kernel_images
+      ( new cuNDArray<float_complext>(&out_dims) );
+
+    // Clear to ones in case we terminate early
+    //
+
+    fill(kernel_images.get(), float_complext(1.0f/num_coils));
+
+    // Form the normal equations of the n kernel weights for every coil
+    //
+
+    unsigned int n = num_coils*(kernel_size*kernel_size-1);
+
+    std::vector<size_t> AHA_dims(2,n);
+    cuNDArray<float_complext> AHA(&AHA_dims);
+
+    std::vector<size_t> rhs_dims; rhs_dims.push_back(n); rhs_dims.push_back(num_coils);    
+    cuNDArray<float_complext> rhs(&rhs_dims);
+
+    if( fft_calibration )
+      form_normal_equations_fft( &kspace, kernel_size, &AHA, &rhs );
+    else
+      form_normal_equations( &kspace, kernel_size, &AHA, &rhs );
 
     //CGELS is used rather than a more conventional solver as it is part of CULA free.
     /*
@@ -332,6 +463,7 @@ namespace Gadgetron {
     // Fill k-spaces with the computed kernels at the center
     //
 
+    dim3 blockDim; dim3 gridDim;
     setup_grid( kernel_images->get_number_of_elements(), &blockDim, &gridDim );
     
     write_convolution_masks_kernel<<< gridDim, blockDim >>>
@@ -342,7 +474,6 @@ namespace Gadgetron {
 
     // Batch FFT into image space
     //
-    A.clear();
     AHA.clear();
     rhs.clear();
 
@@ -145,6 +145,72 @@ namespace Gadgetron
   };
 
 
+  /**
+     Contiguous storage of readouts, used by the @IsmrmrdAcquisitionBucket instead of one
+     set of GadgetContainerMessages per readout. The headers, the samples and the trajectories
+     are kept in one array each and readout i is addressed by index.
+     The samples of readout i are [number_of_samples, active_channels] from data(i),
+     its trajectory is [trajectory_dimensions, number_of_samples] from traj(i).
+   */
+  class IsmrmrdAcquisitionSlab
+  {
+  public:
+    size_t size() const { return headers_.size(); }
+    bool empty() const { return headers_.empty(); }
+
+    /// reserves the storage of a number of readouts, e.g. the size of the previous bucket
+    void reserve(size_t readouts, size_t samples_per_readout, size_t traj_per_readout)
+    {
+      headers_.reserve(readouts);
+      sample_offset_.reserve(readouts);
+      traj_offset_.reserve(readouts);
+      samples_.reserve(readouts*samples_per_readout);
+      if (traj_per_readout > 0) trajectories_.reserve(readouts*traj_per_readout);
+    }
+
+    /// copies a readout into the slab
+    void add(const ISMRMRD::AcquisitionHeader& head, const hoNDArray< std::complex<float> >& data, const hoNDArray<float>* traj = 0)
+    {
+      headers_.push_back(head);
+
+      sample_offset_.push_back(samples_.size());
+      samples_.insert(samples_.end(), data.begin(), data.begin() + data.get_number_of_elements());
+
+      traj_offset_.push_back(trajectories_.size());
+      if (traj && (head.trajectory_dimensions > 0)) {
+        trajectories_.insert(trajectories_.end(), traj->begin(), traj->begin() + traj->get_number_of_elements());
+      }
+    }
+
+    ISMRMRD::AcquisitionHeader& header(size_t i) { return headers_[i]; }
+    const ISMRMRD::AcquisitionHeader& header(size_t i) const { return headers_[i]; }
+
+    const std::complex<float>* data(size_t i) const { return &samples_[0] + sample_offset_[i]; }
+
+    /// 0 if the readout has no trajectory
+    const float* traj(size_t i) const
+    {
+      bool has_traj = (i+1 < traj_offset_.size()) ? (traj_offset_[i+1] > traj_offset_[i]) : (trajectories_.size() > traj_offset_[i]);
+      return has_traj ? &trajectories_[0] + traj_offset_[i] : 0;
+    }
+
+    void clear()
+    {
+      headers_.clear();
+      samples_.clear();
+      trajectories_.clear();
+      sample_offset_.clear();
+      traj_offset_.clear();
+    }
+
+  protected:
+    std::vector<ISMRMRD::AcquisitionHeader> headers_;
+    std::vector< std::complex<float> > samples_;
+    std::vector<float> trajectories_;
+    std::vector<size_t> sample_offset_;
+    std::vector<size_t> traj_offset_;
+  };
+
   /**
 
      This class serves as the storage unit for buffered data. 
@@ -158,10 +224,24 @@ namespace Gadgetron
   class IsmrmrdAcquisitionBucket
   {
   public:
+    IsmrmrdAcquisitionBucket() : end_of_trigger_(true) {}
+
+    /**
+       false for the buckets of a streamed trigger (see AcquisitionAccumulateTriggerGadget::stream_readouts),
+       these carry one readout each and their stats give the expected extent of the whole trigger.
+       The last bucket of a trigger has end_of_trigger_ set.
+    */
+    bool end_of_trigger_;
+
     std::vector< IsmrmrdAcquisitionData > data_;
     std::vector< IsmrmrdAcquisitionData > ref_;
     std::vector< IsmrmrdAcquisitionBucketStats > datastats_;
     std::vector< IsmrmrdAcquisitionBucketStats > refstats_;
+
+    /// readouts in contiguous storage, see AcquisitionAccumulateTriggerGadget::compact_buckets.
+    /// These come in addition to data_ and ref_ and are covered by the same stats.
+    IsmrmrdAcquisitionSlab data_slab_;
+    IsmrmrdAcquisitionSlab ref_slab_;
   };
   
 }
@@ -7,8 +7,12 @@
 #include "mri_core_coil_map_estimation.h"
 #include "hoMatrix.h"
 #include "hoNDArray_linalg.h"
+#include "hoNDArray_batched.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDArray_reductions.h"
+#include "GadgetronThreadBudget.h"
+#include <algorithm>
+#include <vector>
 
 #ifdef USE_OMP
     #include <omp.h>
@@ -17,200 +21,370 @@
 namespace Gadgetron
 {
 
-template<typename T> 
-void coil_map_2d_Inati(const hoNDArray<T>& data, hoNDArray<T>& coilMap, size_t ks, size_t power)
+// ------------------------------------------------------------------------
+// Inati coil map with sliding window sums
+//
+// For the data matrix D of a window ([window CHA]), the coil map only needs
+// D^H*D and the window sum of D: the power iteration works on D^H*D, and the
+// phase of U1 = D*V1 summed over the window equals sum(D)*V1.
+// Both are window sums, which are updated incrementally: moving the window
+// along E1 adds and removes kz rows, and the RO window of every line is a
+// running sum. The cost per pixel does not depend on ks and the full window
+// is never gathered.
+// The Hermitian matrix is stored as upper triangle in [pair RO] layout with
+// separate real and imaginary parts, so the updates, the power iteration and
+// the normalization of a whole line run in inner loops over RO.
+// ------------------------------------------------------------------------
+
+template<typename T>
+class InatiSlidingWindow
 {
-    try
+public:
+
+    typedef typename realType<T>::Type value_type;
+
+    InatiSlidingWindow(const T* pData, long long RO, long long E1, long long E2, long long CHA, long long halfKs, long long halfKz, size_t power)
+        : pData_(pData), RO_(RO), E1_(E1), E2_(E2), CHA_(CHA), halfKs_(halfKs), halfKz_(halfKz), power_(power)
     {
-        typedef typename realType<T>::Type value_type;
+        P_ = CHA*(CHA + 1) / 2;
+
+        // accumulate in double, the sums are updated many times along E1
+        colRe_.resize(P_*RO, 0);
+        colIm_.resize(P_*RO, 0);
+        colSumRe_.resize(CHA*RO, 0);
+        colSumIm_.resize(CHA*RO, 0);
+
+        rowRe_.resize(CHA*RO);
+        rowIm_.resize(CHA*RO);
+
+        mRe_.resize(P_*RO);
+        mIm_.resize(P_*RO);
+        sRe_.resize(CHA*RO);
+        sIm_.resize(CHA*RO);
+
+        vRe_.resize(CHA*RO);
+        vIm_.resize(CHA*RO);
+        v1Re_.resize(CHA*RO);
+        v1Im_.resize(CHA*RO);
+        norm_.resize(RO);
+    }
 
-        long long RO = data.get_size(0);
-        long long E1 = data.get_size(1);
-        long long CHA = data.get_size(2);
+    /// compute the coil map for lines [e1Start, e1End) of plane e2
+    void compute(long long e2, long long e1Start, long long e1End, T* pSen)
+    {
+        std::fill(colRe_.begin(), colRe_.end(), 0.0);
+        std::fill(colIm_.begin(), colIm_.end(), 0.0);
+        std::fill(colSumRe_.begin(), colSumRe_.end(), 0.0);
+        std::fill(colSumIm_.begin(), colSumIm_.end(), 0.0);
 
-        long long N = data.get_number_of_elements() / (RO*E1*CHA);
-        GADGET_CHECK_THROW(N == 1);
+        long long ke1, ke2;
+        for (ke2 = -halfKz_; ke2 <= halfKz_; ke2++)
+        {
+            for (ke1 = -halfKs_; ke1 <= halfKs_; ke1++)
+            {
+                this->addRow(e1Start + ke1, e2 + ke2, 1.0);
+            }
+        }
 
-        const T* pData = data.begin();
+        long long e1;
+        for (e1 = e1Start; e1 < e1End; e1++)
+        {
+            if (e1 > e1Start)
+            {
+                for (ke2 = -halfKz_; ke2 <= halfKz_; ke2++)
+                {
+                    this->addRow(e1 - 1 - halfKs_, e2 + ke2, -1.0);
+                    this->addRow(e1 + halfKs_, e2 + ke2, 1.0);
+                }
+            }
 
-        if (!data.dimensions_equal(&coilMap))
+            this->computeLine(pSen + e2*RO_*E1_ + e1*RO_);
+        }
+    }
+
+protected:
+
+    static long long wrap(long long i, long long n)
+    {
+        i %= n;
+        return (i < 0) ? i + n : i;
+    }
+
+    void addRow(long long e1, long long e2, double sign)
+    {
+        e1 = wrap(e1, E1_);
+        e2 = wrap(e2, E2_);
+
+        long long ro, cha, i, j, p;
+
+        for (cha = 0; cha < CHA_; cha++)
         {
-            coilMap = data;
+            const T* pRow = pData_ + cha*RO_*E1_*E2_ + e2*RO_*E1_ + e1*RO_;
+            double* pRe = &rowRe_[cha*RO_];
+            double* pIm = &rowIm_[cha*RO_];
+            double* pSumRe = &colSumRe_[cha*RO_];
+            double* pSumIm = &colSumIm_[cha*RO_];
+
+            for (ro = 0; ro < RO_; ro++)
+            {
+                pRe[ro] = pRow[ro].real();
+                pIm[ro] = pRow[ro].imag();
+                pSumRe[ro] += sign*pRe[ro];
+                pSumIm[ro] += sign*pIm[ro];
+            }
         }
-        T* pSen = coilMap.begin();
 
-        if (ks % 2 != 1)
+        // conj(x_i)*x_j for j >= i
+        p = 0;
+        for (i = 0; i < CHA_; i++)
         {
-            ks++;
+            const double* pRe_i = &rowRe_[i*RO_];
+            const double* pIm_i = &rowIm_[i*RO_];
+
+            for (j = i; j < CHA_; j++)
+            {
+                const double* pRe_j = &rowRe_[j*RO_];
+                const double* pIm_j = &rowIm_[j*RO_];
+                double* pCRe = &colRe_[p*RO_];
+                double* pCIm = &colIm_[p*RO_];
+
+                for (ro = 0; ro < RO_; ro++)
+                {
+                    pCRe[ro] += sign*(pRe_i[ro] * pRe_j[ro] + pIm_i[ro] * pIm_j[ro]);
+                    pCIm[ro] += sign*(pRe_i[ro] * pIm_j[ro] - pIm_i[ro] * pRe_j[ro]);
+                }
+
+                p++;
+            }
         }
+    }
 
-        size_t kss = ks*ks;
-        long long halfKs = (long long)ks / 2;
+    /// periodic window sum of length 2*halfKs+1 along RO
+    void windowSum(const double* pIn, value_type* pOut)
+    {
+        long long ro, kro;
 
-        long long e1;
+        double sum = 0;
+        for (kro = -halfKs_; kro <= halfKs_; kro++)
+        {
+            sum += pIn[wrap(kro, RO_)];
+        }
+        pOut[0] = (value_type)sum;
 
-        #pragma omp parallel private(e1) shared(ks, RO, E1, CHA, pSen, pData, halfKs, power, kss)
+        for (ro = 1; ro < RO_; ro++)
         {
-            hoNDArray<T> D(ks*ks, CHA);
-            T* pD = D.begin();
+            sum += pIn[wrap(ro + halfKs_, RO_)] - pIn[wrap(ro - 1 - halfKs_, RO_)];
+            pOut[ro] = (value_type)sum;
+        }
+    }
 
-            hoNDArray<T> DC(ks*ks, CHA);
-            T* pDC = DC.begin();
+    void normalize(value_type* pRe, value_type* pIm)
+    {
+        long long ro, cha;
 
-            hoNDArray<T> DH_D(CHA, CHA);
-            Gadgetron::clear(DH_D);
+        std::fill(norm_.begin(), norm_.end(), value_type(0));
+        for (cha = 0; cha < CHA_; cha++)
+        {
+            const value_type* pR = pRe + cha*RO_;
+            const value_type* pI = pIm + cha*RO_;
+            for (ro = 0; ro < RO_; ro++)
+            {
+                norm_[ro] += pR[ro] * pR[ro] + pI[ro] * pI[ro];
+            }
+        }
 
-            hoNDArray<T> U1(ks*ks, 1);
-            T* pU1 = U1.begin();
+        for (ro = 0; ro < RO_; ro++)
+        {
+            norm_[ro] = (norm_[ro] > 0) ? value_type(1) / std::sqrt(norm_[ro]) : value_type(0);
+        }
 
-            hoNDArray<T> V1(CHA, 1);
-            T* pV1 = V1.begin();
+        for (cha = 0; cha < CHA_; cha++)
+        {
+            value_type* pR = pRe + cha*RO_;
+            value_type* pI = pIm + cha*RO_;
+            for (ro = 0; ro < RO_; ro++)
+            {
+                pR[ro] *= norm_[ro];
+                pI[ro] *= norm_[ro];
+            }
+        }
+    }
 
-            hoNDArray<T> V(CHA, 1);
+    void computeLine(T* pSen)
+    {
+        long long ro, cha, i, j, p;
 
-            Gadgetron::clear(D);
-            Gadgetron::clear(DC);
-            Gadgetron::clear(DH_D);
-            Gadgetron::clear(U1);
-            Gadgetron::clear(V1);
-            Gadgetron::clear(V);
+        for (p = 0; p < P_; p++)
+        {
+            this->windowSum(&colRe_[p*RO_], &mRe_[p*RO_]);
+            this->windowSum(&colIm_[p*RO_], &mIm_[p*RO_]);
+        }
 
-            T phaseU1;
+        for (cha = 0; cha < CHA_; cha++)
+        {
+            this->windowSum(&colSumRe_[cha*RO_], &sRe_[cha*RO_]);
+            this->windowSum(&colSumIm_[cha*RO_], &sIm_[cha*RO_]);
+        }
 
-            value_type v1Norm(1), u1Norm(1);
+        // V1 is the normalized window sum
+        std::copy(sRe_.begin(), sRe_.end(), v1Re_.begin());
+        std::copy(sIm_.begin(), sIm_.end(), v1Im_.begin());
+        this->normalize(&v1Re_[0], &v1Im_[0]);
 
-            long long cha, ro, kro, ke1, de1, dro;
-            size_t po;
+        // power iteration V = (D^H*D)*V1, for all pixels of the line together
+        size_t po;
+        for (po = 0; po < power_; po++)
+        {
+            std::fill(vRe_.begin(), vRe_.end(), value_type(0));
+            std::fill(vIm_.begin(), vIm_.end(), value_type(0));
 
-            #pragma omp for
-            for (e1 = 0; e1<(int)E1; e1++)
+            p = 0;
+            for (i = 0; i < CHA_; i++)
             {
-                for (ro = 0; ro<(long long)RO; ro++)
+                for (j = i; j < CHA_; j++)
                 {
-                    // fill the data matrix D
-                    if (e1 >= halfKs && e1<E1 - halfKs && ro >= halfKs && ro<RO - halfKs)
-                    {
-                        for (cha = 0; cha<CHA; cha++)
-                        {
-                            const T* pDataCurr = pData + cha*RO*E1;
-                            int ind = 0;
-                            for (ke1 = -halfKs; ke1 <= halfKs; ke1++)
-                            {
-                                de1 = e1 + ke1;
-                                for (kro = -halfKs; kro <= halfKs; kro++)
-                                {
-                                    pD[ind + cha*kss] = pDataCurr[de1*RO + ro + kro];
-                                    ind++;
-                                }
-                            }
-                        }
-                    }
-                    else
+                    const value_type* pMRe = &mRe_[p*RO_];
+                    const value_type* pMIm = &mIm_[p*RO_];
+
+                    value_type* pVRe_i = &vRe_[i*RO_];
+                    value_type* pVIm_i = &vIm_[i*RO_];
+                    const value_type* pV1Re_j = &v1Re_[j*RO_];
+                    const value_type* pV1Im_j = &v1Im_[j*RO_];
+
+                    // V_i += M_ij * V1_j
+                    for (ro = 0; ro < RO_; ro++)
                     {
-                        for (cha = 0; cha<CHA; cha++)
-                        {
-                            const T* pDataCurr = pData + cha*RO*E1;
-                            int ind = 0;
-                            for (ke1 = -halfKs; ke1 <= halfKs; ke1++)
-                            {
-                                de1 = e1 + ke1;
-                                if (de1 < 0) de1 += E1;
-                                if (de1 >= E1) de1 -= E1;
-
-                                for (kro = -halfKs; kro <= halfKs; kro++)
-                                {
-                                    dro = ro + kro;
-                                    if (dro < 0) dro += RO;
-                                    if (dro >= RO) dro -= RO;
-
-                                    pD[ind + cha*kss] = pDataCurr[de1*RO + dro];
-                                    ind++;
-                                }
-                            }
-                        }
+                        pVRe_i[ro] += pMRe[ro] * pV1Re_j[ro] - pMIm[ro] * pV1Im_j[ro];
+                        pVIm_i[ro] += pMRe[ro] * pV1Im_j[ro] + pMIm[ro] * pV1Re_j[ro];
                     }
 
-                    T* pTmp;
-                    for (cha = 0; cha<CHA; cha++)
+                    if (j > i)
                     {
-                        pTmp = pD + cha*kss;
-                        pV1[cha] = pTmp[0];
-                        for (po = 1; po<kss; po++)
+                        value_type* pVRe_j = &vRe_[j*RO_];
+                        value_type* pVIm_j = &vIm_[j*RO_];
+                        const value_type* pV1Re_i = &v1Re_[i*RO_];
+                        const value_type* pV1Im_i = &v1Im_[i*RO_];
+
+                        // V_j += conj(M_ij) * V1_i
+                        for (ro = 0; ro < RO_; ro++)
                         {
-                            pV1[cha] += pTmp[po];
+                            pVRe_j[ro] += pMRe[ro] * pV1Re_i[ro] + pMIm[ro] * pV1Im_i[ro];
+                            pVIm_j[ro] += pMRe[ro] * pV1Im_i[ro] - pMIm[ro] * pV1Re_i[ro];
                         }
                     }
 
-                    value_type sum(0);
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        const T& c = pV1[cha];
-                        const value_type re = c.real();
-                        const value_type im = c.imag();
-                        sum += ((re*re) + (im * im));
-                    }
-                    v1Norm = std::sqrt(sum);
+                    p++;
+                }
+            }
 
-                    value_type v1NormInv = (value_type)1.0 / v1Norm;
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        pV1[cha] *= v1NormInv;
-                    }
+            v1Re_.swap(vRe_);
+            v1Im_.swap(vIm_);
+            this->normalize(&v1Re_[0], &v1Im_[0]);
+        }
 
-                    memcpy(pDC, pD, sizeof(T)*ks*ks*CHA);
-                    gemm(DH_D, DC, true, D, false);
+        // phase of U1 summed over the window, sum(D)*V1
+        std::vector<value_type>& phaseRe = vRe_;
+        std::vector<value_type>& phaseIm = vIm_;
+        std::fill(phaseRe.begin(), phaseRe.begin() + RO_, value_type(0));
+        std::fill(phaseIm.begin(), phaseIm.begin() + RO_, value_type(0));
 
-                    for (po = 0; po<power; po++)
-                    {
-                        gemm(V, DH_D, false, V1, false);
-                        memcpy(V1.begin(), V.begin(), V.get_number_of_bytes());
+        for (cha = 0; cha < CHA_; cha++)
+        {
+            const value_type* pSRe = &sRe_[cha*RO_];
+            const value_type* pSIm = &sIm_[cha*RO_];
+            const value_type* pV1Re = &v1Re_[cha*RO_];
+            const value_type* pV1Im = &v1Im_[cha*RO_];
 
-                        sum = 0;
-                        for (cha = 0; cha<CHA; cha++)
-                        {
-                            const T& c = pV1[cha];
-                            const value_type re = c.real();
-                            const value_type im = c.imag();
-                            sum += ((re*re) + (im * im));
-                        }
-                        v1Norm = std::sqrt(sum);
+            for (ro = 0; ro < RO_; ro++)
+            {
+                phaseRe[ro] += pSRe[ro] * pV1Re[ro] - pSIm[ro] * pV1Im[ro];
+                phaseIm[ro] += pSRe[ro] * pV1Im[ro] + pSIm[ro] * pV1Re[ro];
+            }
+        }
 
-                        value_type v1NormInv = (value_type)1.0 / v1Norm;
-                        for (cha = 0; cha<CHA; cha++)
-                        {
-                            pV1[cha] *= v1NormInv;
-                        }
-                    }
+        for (ro = 0; ro < RO_; ro++)
+        {
+            value_type a = std::sqrt(phaseRe[ro] * phaseRe[ro] + phaseIm[ro] * phaseIm[ro]);
+            value_type aInv = (a > 0) ? value_type(1) / a : value_type(0);
+            phaseRe[ro] *= aInv;
+            phaseIm[ro] *= aInv;
+        }
 
-                    gemm(U1, D, false, V1, false);
+        // put the mean object phase to coil map, conj(V1)*phase
+        for (cha = 0; cha < CHA_; cha++)
+        {
+            const value_type* pV1Re = &v1Re_[cha*RO_];
+            const value_type* pV1Im = &v1Im_[cha*RO_];
+            T* pSenCha = pSen + cha*RO_*E1_*E2_;
 
-                    phaseU1 = pU1[0];
-                    for (po = 1; po<kss; po++)
-                    {
-                        phaseU1 += pU1[po];
-                    }
-                    phaseU1 /= std::abs(phaseU1);
+            for (ro = 0; ro < RO_; ro++)
+            {
+                pSenCha[ro] = T(pV1Re[ro] * phaseRe[ro] + pV1Im[ro] * phaseIm[ro], pV1Re[ro] * phaseIm[ro] - pV1Im[ro] * phaseRe[ro]);
+            }
+        }
+    }
 
-                    const value_type c = phaseU1.real();
-                    const value_type d = phaseU1.imag();
+    const T* pData_;
+    long long RO_, E1_, E2_, CHA_, P_;
+    long long halfKs_, halfKz_;
+    size_t power_;
 
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        const T& v = pV1[cha];
-                        const value_type a = v.real();
-                        const value_type b = v.imag();
+    std::vector<double> colRe_, colIm_, colSumRe_, colSumIm_, rowRe_, rowIm_;
+    std::vector<value_type> mRe_, mIm_, sRe_, sIm_, vRe_, vIm_, v1Re_, v1Im_, norm_;
+};
 
-                        reinterpret_cast< value_type(&)[2] >(pV1[cha])[0] = a*c + b*d;
-                        reinterpret_cast< value_type(&)[2] >(pV1[cha])[1] = a*d - b*c;
-                    }
+template<typename T>
+void coil_map_Inati_sliding_window(const T* pData, long long RO, long long E1, long long E2, long long CHA, size_t ks, size_t kz, size_t power, T* pSen)
+{
+    long long halfKs = (long long)ks / 2;
+    long long halfKz = (long long)kz / 2;
 
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        pSen[cha*RO*E1 + e1*RO + ro] = V1(cha, 0);
-                    }
-                }
-            }
+    // every block of lines starts with a full window sum, which is amortized over the block
+    long long block = std::max<long long>(32, 4 * halfKs);
+    long long numBlocksE1 = (E1 + block - 1) / block;
+    long long numBlocks = numBlocksE1*E2;
+
+    long long n;
+
+#pragma omp parallel private(n) shared(pData, RO, E1, E2, CHA, halfKs, halfKz, power, pSen, block, numBlocksE1, numBlocks)
+    {
+        InatiSlidingWindow<T> window(pData, RO, E1, E2, CHA, halfKs, halfKz, power);
+
+#pragma omp for schedule(dynamic)
+        for (n = 0; n < numBlocks; n++)
+        {
+            long long e2 = n / numBlocksE1;
+            long long e1Start = (n % numBlocksE1)*block;
+            long long e1End = std::min(e1Start + block, E1);
+
+            window.compute(e2, e1Start, e1End, pSen);
+        }
+    }
+}
+
+template<typename T> 
+void coil_map_2d_Inati(const hoNDArray<T>& data, hoNDArray<T>& coilMap, size_t ks, size_t power)
+{
+    try
+    {
+        long long RO = data.get_size(0);
+        long long E1 = data.get_size(1);
+        long long CHA = data.get_size(2);
+
+        long long N = data.get_number_of_elements() / (RO*E1*CHA);
+        GADGET_CHECK_THROW(N == 1);
+
+        if (!data.dimensions_equal(&coilMap))
+        {
+            coilMap = data;
+        }
+
+        if (ks % 2 != 1)
+        {
+            ks++;
         }
+
+        coil_map_Inati_sliding_window(data.begin(), RO, E1, 1, CHA, ks, 1, power, coilMap.begin());
     }
     catch (...)
     {
@@ -229,8 +403,6 @@ void coil_map_3d_Inati(const hoNDArray<T>& data, hoNDArray<T>& coilMap, size_t k
 {
     try
     {
-        typedef typename realType<T>::Type value_type;
-
         long long RO = data.get_size(0);
         long long E1 = data.get_size(1);
         long long E2 = data.get_size(2);
@@ -239,13 +411,10 @@ void coil_map_3d_Inati(const hoNDArray<T>& data, hoNDArray<T>& coilMap, size_t k
         long long N = data.get_number_of_elements() / (RO*E1*E2*CHA);
         GADGET_CHECK_THROW(N == 1);
 
-        const T* pData = data.begin();
-
         if (!data.dimensions_equal(&coilMap))
         {
             coilMap = data;
         }
-        T* pSen = coilMap.begin();
 
         if (ks % 2 != 1)
         {
@@ -257,134 +426,7 @@ void coil_map_3d_Inati(const hoNDArray<T>& data, hoNDArray<T>& coilMap, size_t k
             kz++;
         }
 
-        size_t kss = ks*ks*kz;
-        long long halfKs = (long long)ks / 2;
-        long long halfKz = (long long)kz / 2;
-
-        long long e2;
-
-        #pragma omp parallel default(none) private(e2) shared(ks, kz, RO, E1, E2, CHA, pSen, pData, halfKs, halfKz, power, kss)
-        {
-            hoMatrix<T> D(kss, CHA);
-            hoMatrix<T> DC(kss, CHA);
-            hoMatrix<T> DH_D(CHA, CHA);
-
-            hoMatrix<T> U1(kss, 1);
-            hoMatrix<T> V1(CHA, 1);
-            hoMatrix<T> V(CHA, 1);
-
-            Gadgetron::clear(D);
-            Gadgetron::clear(DC);
-            Gadgetron::clear(DH_D);
-            Gadgetron::clear(U1);
-            Gadgetron::clear(V1);
-            Gadgetron::clear(V);
-
-            T phaseU1;
-
-            value_type v1Norm(1);
-
-            long long cha, ro, e1, kro, dro, ke1, de1, ke2, de2;
-            size_t po;
-
-            #pragma omp for
-            for (e2 = 0; e2<(long long)E2; e2++)
-            {
-                for (e1 = 0; e1<(long long)E1; e1++)
-                {
-                    for (ro = 0; ro<(long long)RO; ro++)
-                    {
-                        // fill the data matrix D
-                        if (e2 >= halfKz && e2<E2 - halfKz && e1 >= halfKs && e1<E1 - halfKs && ro >= halfKs && ro<RO - halfKs)
-                        {
-                            for (cha = 0; cha<CHA; cha++)
-                            {
-                                const T* pDataCurr = pData + cha*RO*E1*E2;
-                                long long ind = 0;
-                                for (ke2 = -halfKz; ke2 <= halfKz; ke2++)
-                                {
-                                    de2 = e2 + ke2;
-                                    for (ke1 = -halfKs; ke1 <= halfKs; ke1++)
-                                    {
-                                        de1 = e1 + ke1;
-                                        for (kro = -halfKs; kro <= halfKs; kro++)
-                                        {
-                                            D(ind++, cha) = pDataCurr[de2*RO*E1 + de1*RO + ro + kro];
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        else
-                        {
-                            for (cha = 0; cha<CHA; cha++)
-                            {
-                                const T* pDataCurr = pData + cha*RO*E1*E2;
-                                long long ind = 0;
-                                for (ke2 = -halfKz; ke2 <= halfKz; ke2++)
-                                {
-                                    de2 = e2 + ke2;
-                                    if (de2 < 0) de2 += E2;
-                                    if (de2 >= E2) de2 -= E2;
-
-                                    for (ke1 = -halfKs; ke1 <= halfKs; ke1++)
-                                    {
-                                        de1 = e1 + ke1;
-                                        if (de1 < 0) de1 += E1;
-                                        if (de1 >= E1) de1 -= E1;
-
-                                        for (kro = -halfKs; kro <= halfKs; kro++)
-                                        {
-                                            dro = ro + kro;
-                                            if (dro < 0) dro += RO;
-                                            if (dro >= RO) dro -= RO;
-
-                                            D(ind++, cha) = pDataCurr[de2*RO*E1 + de1*RO + dro];
-                                        }
-                                    }
-                                }
-                            }
-                        }
-
-                        // compute V1
-                        D.sumOverCol(V1);
-                        norm2(V1, v1Norm);
-                        scal((value_type)1.0 / v1Norm, V1);
-
-                        memcpy(DC.begin(), D.begin(), sizeof(T)*kss*CHA);
-                        gemm(DH_D, DC, true, D, false);
-                        // gemm(DH_D, D, true, D, false);
-
-                        for (po = 0; po<power; po++)
-                        {
-                            gemm(V, DH_D, false, V1, false);
-                            V1 = V;
-                            norm2(V1, v1Norm);
-                            scal((value_type)1.0 / v1Norm, V1);
-                        }
-
-                        // compute U1
-                        gemm(U1, D, false, V1, false);
-
-                        phaseU1 = U1(0, 0);
-                        for (po = 1; po<kss; po++)
-                        {
-                            phaseU1 += U1(po, 0);
-                        }
-                        phaseU1 /= std::abs(phaseU1);
-
-                        // put the mean object phase to coil map
-                        conjugate(V1, V1);
-                        scal(phaseU1, V1);
-
-                        for (cha = 0; cha<CHA; cha++)
-                        {
-                            pSen[cha*RO*E1*E2 + e2*RO*E1 + e1*RO + ro] = V1(cha, 0);
-                        }
-                    }
-                }
-            }
-        }
+        coil_map_Inati_sliding_window(data.begin(), RO, E1, E2, CHA, ks, kz, power, coilMap.begin());
     }
     catch (...)
     {
@@ -655,7 +697,7 @@ template<typename T> void coil_map_Inati(const hoNDArray<T>& data, hoNDArray<T>&
         else
         {
 #ifdef USE_OMP
-            int num_procs = omp_get_num_procs();
+            int num_procs = GadgetronThreadBudget::num_threads();
 #pragma omp parallel for default(none) private(n) shared(num, RO, E1, CHA, data, coilMap, ks, power) if(num>num_procs/2)
 #endif // USE_OMP
             for (n = 0; n < (long long)num; n++)
@@ -716,7 +758,7 @@ template<typename T> void coil_map_Inati_Iter(const hoNDArray<T>& data, hoNDArra
         else
         {
 #ifdef USE_OMP
-            int num_procs = omp_get_num_procs();
+            int num_procs = GadgetronThreadBudget::num_threads();
 #pragma omp parallel for default(none) private(n) shared(num, RO, E1, CHA, data, coilMap, ks, iterNum, thres) if(num>num_procs/2)
 #endif // USE_OMP
             for (n = 0; n < (long long)num; n++)
@@ -788,24 +830,12 @@ void coil_combine(const hoNDArray<T>& data, const hoNDArray<T>& coilMap, size_t
             }
         }
 
-        std::vector<size_t> dimCombinedN(dimChaN);
-        dimCombinedN[cha_dim] = 1;
-
         std::vector<size_t> dimCoilMapChaN(dimChaN);
         dimCoilMapChaN[cha_dim+1] = coilN;
 
-        std::vector<size_t> dimCha(cha_dim + 1, 1);
-        for (n = 0; n < cha_dim + 1; n++)
-        {
-            if (n < NDim) dimCha[n] = dim[n];
-        }
-
-        std::vector<size_t> dimCombinedChaOne(dimCha);
-        dimCombinedChaOne[cha_dim] = 1;
+        size_t CHA = data.get_size(cha_dim);
 
         size_t nn;
-        hoNDArray<T> dataTmp(dimChaN);
-        hoNDArray<T> combinedCurr(dimCombinedN);
 
         for (nn = 0; nn < num; nn++)
         {
@@ -816,47 +846,72 @@ void coil_combine(const hoNDArray<T>& data, const hoNDArray<T>& coilMap, size_t
 
             hoNDArray<T> coilMapCurr(dimCoilMapChaN, const_cast<T*>(coilMap.begin()) + nn_coil*perChaSize*coilN);
 
-            if (coilN == N)
+            // combined = sum over cha of data .* conj(coilMap), per pixel
+            long long d;
+
+#pragma omp parallel for default(none) private(d) shared(nn, N, coilN, CHA, perChaSize, perCombinedSize, dataCurr, coilMapCurr, combined) if(N>6)
+            for (d = 0; d < (long long)N; d++)
             {
-                Gadgetron::multiplyConj(dataCurr, coilMapCurr, dataTmp);
-                GADGET_CATCH_THROW(Gadgetron::sum_over_dimension(dataTmp, combinedCurr, cha_dim));
+                size_t d_coil = d;
+                if (d_coil >= coilN) d_coil = coilN - 1;
 
-                memcpy(combined.begin() + nn*perCombinedSize*N, combinedCurr.begin(), combinedCurr.get_number_of_bytes());
+                hoNDArrayBatched::gemv(perCombinedSize, 1, CHA, dataCurr.begin() + d*perChaSize, false, coilMapCurr.begin() + d_coil*perChaSize, true, combined.begin() + nn*perCombinedSize*N + d*perCombinedSize);
             }
-            else
-            {
-                long long d;
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in coil_combine(...) ... ");
+    }
+}
 
-#pragma omp parallel default(none) private(d)shared(nn, N, coilN, cha_dim, dimCha, dimCombinedChaOne, perChaSize, perCombinedSize, dataCurr, coilMapCurr, combined) if(N>6)
-                {
-                    hoNDArray<T> dataTmpN(dimCha);
-                    hoNDArray<T> combinedCurrN(dimCombinedChaOne);
+template EXPORTMRICORE void coil_combine(const hoNDArray< std::complex<float> >& data, const hoNDArray< std::complex<float> >& coilMap, size_t cha_dim, hoNDArray< std::complex<float> >& combined);
+template EXPORTMRICORE void coil_combine(const hoNDArray< std::complex<double> >& data, const hoNDArray< std::complex<double> >& coilMap, size_t cha_dim, hoNDArray< std::complex<double> >& combined);
 
-#pragma omp for 
-                    for (d = 0; d < (long long)N; d++)
-                    {
-                        size_t d_coil = d;
-                        if (d_coil >= coilN) d_coil = coilN - 1;
+// ------------------------------------------------------------------------
 
-                        hoNDArray<T> dataCurrN(dimCha, dataCurr.begin() + d*perChaSize);
-                        hoNDArray<T> coilMapCurrN(dimCha, coilMapCurr.begin() + d_coil*perChaSize);
+template<typename T>
+typename realType<T>::Type coil_map_match(const hoNDArray<T>& data, const hoNDArray<T>& coilMap, size_t cha_dim)
+{
+    typedef typename realType<T>::Type value_type;
 
-                        Gadgetron::multiplyConj(dataCurrN, coilMapCurrN, dataTmpN);
-                        Gadgetron::sum_over_dimension(dataTmpN, combinedCurrN, cha_dim);
+    try
+    {
+        GADGET_CHECK_THROW(data.dimensions_equal(&coilMap));
+        GADGET_CHECK_THROW(data.get_number_of_dimensions() > cha_dim);
 
-                        memcpy(combined.begin() + nn*perCombinedSize*N + d*perCombinedSize, combinedCurrN.begin(), combinedCurrN.get_number_of_bytes());
-                    }
-                }
-            }
+        size_t perCombinedSize = 1;
+        for (size_t n = 0; n < cha_dim; n++) perCombinedSize *= data.get_size(n);
+
+        size_t CHA = data.get_size(cha_dim);
+        size_t num = data.get_number_of_elements() / (perCombinedSize*CHA);
+
+        hoNDArray<T> combined(perCombinedSize);
+
+        value_type match = 1;
+
+        for (size_t nn = 0; nn < num; nn++)
+        {
+            const T* pData = data.begin() + nn*perCombinedSize*CHA;
+
+            hoNDArrayBatched::gemv(perCombinedSize, 1, CHA, pData, false, coilMap.begin() + nn*perCombinedSize*CHA, true, combined.begin());
+
+            double energy = 0, captured = 0;
+            for (size_t i = 0; i < perCombinedSize*CHA; i++) energy += std::norm(pData[i]);
+            for (size_t i = 0; i < perCombinedSize; i++) captured += std::norm(combined(i));
+
+            if (energy > 0 && captured / energy < match) match = (value_type)(captured / energy);
         }
+
+        return match;
     }
     catch (...)
     {
-        GADGET_THROW("Errors in coil_combine(...) ... ");
+        GADGET_THROW("Errors in coil_map_match(...) ... ");
     }
 }
 
-template EXPORTMRICORE void coil_combine(const hoNDArray< std::complex<float> >& data, const hoNDArray< std::complex<float> >& coilMap, size_t cha_dim, hoNDArray< std::complex<float> >& combined);
-template EXPORTMRICORE void coil_combine(const hoNDArray< std::complex<double> >& data, const hoNDArray< std::complex<double> >& coilMap, size_t cha_dim, hoNDArray< std::complex<double> >& combined);
+template EXPORTMRICORE float coil_map_match(const hoNDArray< std::complex<float> >& data, const hoNDArray< std::complex<float> >& coilMap, size_t cha_dim);
+template EXPORTMRICORE double coil_map_match(const hoNDArray< std::complex<double> >& data, const hoNDArray< std::complex<double> >& coilMap, size_t cha_dim);
 
 }
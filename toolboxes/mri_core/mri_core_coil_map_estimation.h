@@ -64,4 +64,10 @@ namespace Gadgetron
     // coilMap: [RO E1 E2 CHA ... ]
     // combined: [RO E1 E2 ...]
     template<typename T> EXPORTMRICORE void coil_combine(const hoNDArray<T>& data, const hoNDArray<T>& coilMap, size_t cha_dim, hoNDArray<T>& combined);
+
+    // fraction of the image energy captured by the coil combination with a normalized coil map, to check whether a coil map fits the data
+    // data: in image domain, [RO E1 E2 CHA ...] for cha_dim=3
+    // coilMap: the same size as data
+    // returns the smallest fraction over the images after the cha_dim, an image without energy counts as 1
+    template<typename T> EXPORTMRICORE typename realType<T>::Type coil_map_match(const hoNDArray<T>& data, const hoNDArray<T>& coilMap, size_t cha_dim = 3);
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <set>
 #include "hoNDArray.h"
+#include "hoNDArray_half.h"
 #include <boost/optional.hpp>
 
 namespace Gadgetron 
@@ -110,6 +111,10 @@ namespace Gadgetron
     //7D, fixed order [E0, E1, E2, CHA, N, S, LOC]
     hoNDArray< std::complex<float> > data_;
     
+    //7D, fixed order [E0, E1, E2, CHA, N, S, LOC]
+    //Only present if the buffer is kept in half precision, data_ is empty then until load_data(), which the gadgets call on receipt
+    boost::optional< hoNDArray<complex_half> > data_half_;
+
     //7D, fixed order [TRAJ, E0, E1, E2, N, S, LOC]
     boost::optional<hoNDArray<float>> trajectory_;
     
@@ -118,6 +123,25 @@ namespace Gadgetron
     
     SamplingDescription sampling_;
 
+    // converts a half precision buffer to single precision data_ and releases it
+    void load_data()
+    {
+      if (data_half_)
+      {
+        half_to_complex(*data_half_, data_);
+        data_half_ = boost::none;
+      }
+    }
+
+    // makes the arrays copy-on-write, copies of the buffer then reference the same memory
+    void share()
+    {
+      data_.share();
+      if (data_half_) data_half_->share();
+      if (trajectory_) trajectory_->share();
+      headers_.share();
+    }
+
     // function to check if it's empty
   };
   
@@ -130,6 +154,18 @@ namespace Gadgetron
   public:
     IsmrmrdDataBuffered data_;
     boost::optional<IsmrmrdDataBuffered> ref_;
+
+    void load_data()
+    {
+      data_.load_data();
+      if (ref_) ref_->load_data();
+    }
+
+    void share()
+    {
+      data_.share();
+      if (ref_) ref_->share();
+    }
   };
 
   /**
@@ -139,6 +175,18 @@ namespace Gadgetron
   {
   public:
     std::vector<IsmrmrdReconBit> rbit_;
+
+    // converts all half precision buffers to single precision
+    void load_data()
+    {
+      for (size_t n = 0; n < rbit_.size(); n++) rbit_[n].load_data();
+    }
+
+    // makes all arrays copy-on-write, see hoNDArray::share()
+    void share()
+    {
+      for (size_t n = 0; n < rbit_.size(); n++) rbit_[n].share();
+    }
   };
 
   
@@ -157,7 +205,13 @@ namespace Gadgetron
     //3D, fixed order [N, S, LOC]
     //This element is optional (length is 0 if not present)
     std::vector< ISMRMRD::MetaContainer > meta_;
-    
+
+    // makes the arrays copy-on-write, copies of the image array then reference the same memory
+    void share()
+    {
+      data_.share();
+      headers_.share();
+    }
   };
 
 }
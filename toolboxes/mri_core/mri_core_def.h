@@ -26,6 +26,16 @@ namespace Gadgetron
     #define GADGETRON_IMAGE_INVERSIONTIME                  "GADGETRON_TI"
     #define GADGETRON_IMAGE_SATURATIONTIME                 "GADGETRON_TS"
 
+    /// timing of the reconstruction in ms, attached if the recon gadgets are asked to
+    #define GADGETRON_TIMING_BUFFERED                      "GADGETRON_TimingBuffered"
+    #define GADGETRON_TIMING_ZONES                         "GADGETRON_TimingZones"
+    #define GADGETRON_TIMING_RECON                         "GADGETRON_TimingRecon"
+    #define GADGETRON_TIMING_POSTPROCESSING                "GADGETRON_TimingPostProcessing"
+    #define GADGETRON_TIMING_LATENCY                       "GADGETRON_TimingLatency"
+    /// steady clock in ms when the recon started and sent the image, replaced by the latency when the image is written
+    #define GADGETRON_TIMING_RECON_START                   "GADGETRON_TimingReconStart"
+    #define GADGETRON_TIMING_RECON_END                     "GADGETRON_TimingReconEnd"
+
     /// role of image data
     #define GADGETRON_DATA_ROLE                            "GADGETRON_DataRole"
     #define GADGETRON_IMAGE_REGULAR                        "Image"
@@ -8,60 +8,386 @@
 #include "hoNDArray_elemwise.h"
 #include "hoNDArray_utils.h"
 #include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/stat.h>
+#endif // _WIN32
 
 namespace Gadgetron
 {
-    template <typename T> 
-    void save_dependency_data(const std::string& ismrmrd_header, const hoNDArray<T>& scc_array, const ISMRMRD::AcquisitionHeader& scc_header, 
-                            const hoNDArray<T>& body_array, const ISMRMRD::AcquisitionHeader& body_header, const std::string& filename)
+    namespace
     {
-        char* buf = NULL;
-        char* buf_scc_array = NULL;
-        char* buf_body_array = NULL;
+        std::string folder_of(const std::string& filename)
+        {
+            return boost::filesystem::path(filename).parent_path().string();
+        }
 
-        try
+        std::string name_of(const std::string& filename)
         {
-            std::ofstream outfile;
-            outfile.open( filename.c_str(), std::ios::out | std::ios::binary );
+            return boost::filesystem::path(filename).filename().string();
+        }
 
-            if (outfile.good())
+        std::string strip_separator(const std::string& folder)
+        {
+            std::string f(folder);
+            while (f.size() > 1 && (f[f.size() - 1] == '/' || f[f.size() - 1] == '\\')) f.erase(f.size() - 1);
+            return f;
+        }
+    }
+
+    DependencyStore* DependencyStore::instance()
+    {
+        static DependencyStore store;
+        return &store;
+    }
+
+    DependencyStore::DependencyStore() : bytes_(0), capacity_(size_t(256) * 1024 * 1024), stop_(false)
+    {
+        const char* s = std::getenv("GADGETRON_DEPENDENCY_CACHE_MB");
+        if (s && std::atoi(s) >= 0) capacity_ = size_t(std::atoi(s)) * 1024 * 1024;
+
+        writer_thread_ = std::thread(&DependencyStore::writer, this);
+    }
+
+    DependencyStore::~DependencyStore()
+    {
+        // the pending writes are finished before the server exits
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        pending_cv_.notify_all();
+        if (writer_thread_.joinable()) writer_thread_.join();
+    }
+
+    void DependencyStore::cache(const std::string& filename, Content content)
+    {
+        this->uncache(filename);
+
+        Entry e;
+        e.filename = filename;
+        e.content = content;
+        entries_.push_front(e);
+        bytes_ += content->size();
+
+        this->shrink();
+    }
+
+    void DependencyStore::uncache(const std::string& filename)
+    {
+        for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        {
+            if (it->filename == filename)
             {
-                GDEBUG_STREAM( "Write out the dependency data file : " << filename );
+                bytes_ -= it->content->size();
+                entries_.erase(it);
+                return;
+            }
+        }
+    }
 
-                size_t len_ismrmrd_header = ismrmrd_header.length();
+    void DependencyStore::shrink()
+    {
+        while (bytes_ > capacity_ && !entries_.empty())
+        {
+            bytes_ -= entries_.back().content->size();
+            entries_.pop_back();
+        }
+    }
 
-                size_t len_scc_array = 0;
-                GADGET_CHECK_THROW(scc_array.serialize(buf_scc_array, len_scc_array));
+    bool DependencyStore::read(const std::string& filename, std::string& content)
+    {
+        Content c;
+        if (!this->read(filename, c)) return false;
+        content = *c;
+        return true;
+    }
 
-                size_t len_body_array = 0;
-                GADGET_CHECK_THROW(body_array.serialize(buf_body_array, len_body_array));
+    bool DependencyStore::read(const std::string& filename, Content& content)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            std::map<std::string, PendingWrite>::iterator p = pending_.find(filename);
+            if (p != pending_.end())
+            {
+                content = p->second.content;
+                return true;
+            }
+
+            if (writing_ == filename)
+            {
+                content = writing_content_;
+                return true;
+            }
+
+            for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+            {
+                if (it->filename == filename)
+                {
+                    entries_.splice(entries_.begin(), entries_, it);
+                    content = entries_.front().content;
+                    return true;
+                }
+            }
+        }
+
+        std::ifstream infile(filename.c_str(), std::ios::in | std::ios::binary);
+        if (!infile.good()) return false;
+
+        std::ostringstream buf;
+        buf << infile.rdbuf();
+        if (infile.bad()) return false;
+
+        Content c(new std::string(buf.str()));
+        content = c;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // a write in the mean time is newer than what was read
+        if (pending_.find(filename) == pending_.end() && writing_ != filename)
+        {
+            this->cache(filename, c);
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<void> DependencyStore::derived(const std::string& filename, const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        {
+            if (it->filename != filename) continue;
+
+            std::map<std::string, std::shared_ptr<void> >::const_iterator d = it->derived.find(key);
+            if (d == it->derived.end()) break;
+
+            entries_.splice(entries_.begin(), entries_, it);
+            return d->second;
+        }
+
+        return std::shared_ptr<void>();
+    }
+
+    void DependencyStore::set_derived(const std::string& filename, const Content& content, const std::string& key, std::shared_ptr<void> data)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        {
+            // written again since the caller read it
+            if (it->filename == filename)
+            {
+                if (it->content == content) it->derived[key] = data;
+                return;
+            }
+        }
+    }
+
+    void DependencyStore::write(const std::string& filename, const std::string& content, bool world_writable)
+    {
+        Content c(new std::string(content));
 
-                outfile.write( reinterpret_cast<char*>(&len_ismrmrd_header), sizeof(size_t) );
-                outfile.write( ismrmrd_header.c_str(), len_ismrmrd_header );
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            PendingWrite w;
+            w.content = c;
+            w.world_writable = world_writable;
+            pending_[filename] = w;
+
+            this->cache(filename, c);
+
+            std::map<std::string, FolderIndex>::iterator f = folders_.find(folder_of(filename));
+            if (f != folders_.end()) f->second.names.insert(name_of(filename));
+        }
+
+        pending_cv_.notify_one();
+    }
+
+    void DependencyStore::remove(const std::string& filename)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            pending_.erase(filename);
+            this->uncache(filename);
+
+            std::map<std::string, FolderIndex>::iterator f = folders_.find(folder_of(filename));
+            if (f != folders_.end()) f->second.names.erase(name_of(filename));
+
+            written_cv_.wait(lock, [this, &filename]() { return writing_ != filename; });
+        }
+
+        boost::system::error_code ec;
+        boost::filesystem::remove(boost::filesystem::path(filename), ec);
+        if (ec)
+        {
+            GERROR_STREAM("Failed to remove dependency file " << filename << " : " << ec.message());
+        }
+    }
+
+    void DependencyStore::list(const std::string& folder, std::vector<std::string>& names)
+    {
+        names.clear();
+
+        std::string key = strip_separator(folder);
+        boost::filesystem::path p(key);
+
+        boost::system::error_code ec;
+        std::time_t t = boost::filesystem::last_write_time(p, ec);
+        if (ec) t = 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // the listing is kept in memory until the folder changes
+        std::map<std::string, FolderIndex>::iterator f = folders_.find(key);
+        if (f == folders_.end() || f->second.last_write_time != t)
+        {
+            FolderIndex index;
+            index.last_write_time = t;
+
+            if (!ec && boost::filesystem::is_directory(p, ec))
+            {
+                for (boost::filesystem::directory_iterator it(p, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    index.names.insert(it->path().filename().string());
+                }
+            }
+
+            f = folders_.insert(std::make_pair(key, index)).first;
+            f->second = index;
+        }
+
+        std::set<std::string> all(f->second.names);
+        for (std::map<std::string, PendingWrite>::const_iterator w = pending_.begin(); w != pending_.end(); ++w)
+        {
+            if (folder_of(w->first) == key) all.insert(name_of(w->first));
+        }
+        if (!writing_.empty() && folder_of(writing_) == key) all.insert(name_of(writing_));
+
+        names.assign(all.begin(), all.end());
+    }
+
+    void DependencyStore::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        written_cv_.wait(lock, [this]() { return pending_.empty() && writing_.empty(); });
+    }
+
+    void DependencyStore::set_capacity(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = bytes;
+        this->shrink();
+    }
+
+    size_t DependencyStore::capacity()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
 
-                outfile.write( reinterpret_cast<char*>(&len_scc_array), sizeof(size_t) );
-                outfile.write( buf_scc_array, len_scc_array );
+    size_t DependencyStore::size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
 
-                outfile.write( reinterpret_cast<char*>(&len_body_array), sizeof(size_t) );
-                outfile.write( buf_body_array, len_body_array );
+    void DependencyStore::writer()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
 
-                outfile.write( reinterpret_cast<const char*>(&scc_header), sizeof(ISMRMRD::AcquisitionHeader) );
-                outfile.write( reinterpret_cast<const char*>(&body_header), sizeof(ISMRMRD::AcquisitionHeader) );
+        for (;;)
+        {
+            pending_cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) return;
 
+            std::map<std::string, PendingWrite>::iterator it = pending_.begin();
+            std::string filename = it->first;
+            PendingWrite w = it->second;
+            pending_.erase(it);
+
+            writing_ = filename;
+            writing_content_ = w.content;
+            lock.unlock();
+
+            std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary);
+            if (outfile.good())
+            {
+                GDEBUG_STREAM("Write out the dependency data file : " << filename);
+                outfile.write(w.content->data(), w.content->size());
                 outfile.close();
+
+#ifndef _WIN32
+                if (w.world_writable && chmod(filename.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0)
+                {
+                    GDEBUG_STREAM("Changing the permission of the dependency data file failed : " << filename);
+                }
+#endif // _WIN32
             }
             else
             {
                 GERROR_STREAM("Failed to open dependency data file for writing : " << filename);
             }
+
+            lock.lock();
+            writing_.clear();
+            writing_content_.reset();
+            written_cv_.notify_all();
         }
-        catch (...)
+    }
+
+    // ------------------------------------------------------------------------
+
+    template <typename T> 
+    void save_dependency_data(const std::string& ismrmrd_header, const hoNDArray<T>& scc_array, const ISMRMRD::AcquisitionHeader& scc_header, 
+                            const hoNDArray<T>& body_array, const ISMRMRD::AcquisitionHeader& body_header, const std::string& filename)
+    {
+        char* buf_scc_array = NULL;
+        char* buf_body_array = NULL;
+
+        try
         {
-            GADGET_THROW("Errors in save_dependency_data(...) ... ");
+            size_t len_ismrmrd_header = ismrmrd_header.length();
+
+            size_t len_scc_array = 0;
+            GADGET_CHECK_THROW(scc_array.serialize(buf_scc_array, len_scc_array));
+
+            size_t len_body_array = 0;
+            GADGET_CHECK_THROW(body_array.serialize(buf_body_array, len_body_array));
+
+            std::ostringstream outfile(std::ios::out | std::ios::binary);
+
+            outfile.write( reinterpret_cast<char*>(&len_ismrmrd_header), sizeof(size_t) );
+            outfile.write( ismrmrd_header.c_str(), len_ismrmrd_header );
+
+            outfile.write( reinterpret_cast<char*>(&len_scc_array), sizeof(size_t) );
+            outfile.write( buf_scc_array, len_scc_array );
+
+            outfile.write( reinterpret_cast<char*>(&len_body_array), sizeof(size_t) );
+            outfile.write( buf_body_array, len_body_array );
 
-            if(buf!=NULL) delete [] buf;
+            outfile.write( reinterpret_cast<const char*>(&scc_header), sizeof(ISMRMRD::AcquisitionHeader) );
+            outfile.write( reinterpret_cast<const char*>(&body_header), sizeof(ISMRMRD::AcquisitionHeader) );
+
+            delete [] buf_scc_array;
+            delete [] buf_body_array;
+
+            // written to the dependency folder in the background
+            DependencyStore::instance()->write(filename, outfile.str());
+        }
+        catch (...)
+        {
             if(buf_scc_array!=NULL) delete [] buf_scc_array;
             if(buf_body_array!=NULL) delete [] buf_body_array;
+
+            GADGET_THROW("Errors in save_dependency_data(...) ... ");
         }
     }
 
@@ -76,11 +402,11 @@ namespace Gadgetron
     {
         try
         {
-            std::ifstream infile;
-            infile.open (filename.c_str(), std::ios::in|std::ios::binary);
-
-            if (infile.good())
+            std::string content;
+            if (DependencyStore::instance()->read(filename, content))
             {
+                std::istringstream infile(content, std::ios::in|std::ios::binary);
+
                 size_t xml_length;
                 infile.read( reinterpret_cast<char*>(&xml_length), sizeof(size_t));
 
@@ -112,8 +438,6 @@ namespace Gadgetron
 
                 infile.read( reinterpret_cast<char*>(&scc_header), sizeof(ISMRMRD::AcquisitionHeader));
                 infile.read( reinterpret_cast<char*>(&body_header), sizeof(ISMRMRD::AcquisitionHeader));
-
-                infile.close();
             }
             else
             {
@@ -11,8 +11,123 @@
 #include "mri_core_data.h"
 #include "ismrmrd/xml.h"
 
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <ctime>
+
 namespace Gadgetron
 {
+    /**
+       Server wide store of the dependency files (noise covariances, coil sensitivity scans).
+
+       Every series of a study reads the same dependency files. The store keeps the contents of the files it
+       has read or written in memory and drops the least recently used ones beyond capacity() bytes. Writes go
+       to memory at once and to the dependency folder on a background thread, later writes of the same file
+       replace the pending ones. Reads see pending writes, so the disk is only touched for files that are not
+       in memory. The capacity is initialised from GADGETRON_DEPENDENCY_CACHE_MB (256 MB by default).
+
+       Readers can keep data computed from a cached file with it (a parsed noise covariance and its prewhitener,
+       for instance), so the next series skips the computation. Such data is dropped with the file contents,
+       when the file is written again, removed or evicted.
+
+       The store assumes it is the only writer of the dependency folder while the server runs; files written
+       by other processes are picked up once they are not cached (again).
+    */
+    class EXPORTMRICORE DependencyStore
+    {
+    public:
+
+        typedef std::shared_ptr<const std::string> Content;
+
+        static DependencyStore* instance();
+
+        /// contents of the file, returns false if it does not exist and is not waiting to be written
+        bool read(const std::string& filename, std::string& content);
+        bool read(const std::string& filename, Content& content);
+
+        /// data computed from the cached contents of the file under key, empty if there is none
+        std::shared_ptr<void> derived(const std::string& filename, const std::string& key);
+
+        /// keeps data computed from the contents returned by read(), ignored if the file has changed or is not cached
+        void set_derived(const std::string& filename, const Content& content, const std::string& key, std::shared_ptr<void> data);
+
+        /// keeps the contents in memory and writes the file in the background, world_writable as chmod 777
+        void write(const std::string& filename, const std::string& content, bool world_writable = false);
+
+        /// removes the file from memory and disk
+        void remove(const std::string& filename);
+
+        /// names (without the folder) of the files in folder, including the ones waiting to be written
+        void list(const std::string& folder, std::vector<std::string>& names);
+
+        /// blocks until all pending writes are on disk
+        void flush();
+
+        /// capacity of the memory cache in bytes, pending writes are kept regardless
+        void set_capacity(size_t bytes);
+        size_t capacity();
+
+        /// bytes held in the memory cache
+        size_t size();
+
+    protected:
+
+        DependencyStore();
+        ~DependencyStore();
+
+        struct Entry
+        {
+            std::string filename;
+            Content content;
+            std::map<std::string, std::shared_ptr<void> > derived;
+        };
+
+        struct PendingWrite
+        {
+            Content content;
+            bool world_writable;
+        };
+
+        struct FolderIndex
+        {
+            std::time_t last_write_time;
+            std::set<std::string> names;
+        };
+
+        /// mutex_ must be held
+        void cache(const std::string& filename, Content content);
+        void uncache(const std::string& filename);
+        void shrink();
+
+        void writer();
+
+        std::mutex mutex_;
+        std::condition_variable pending_cv_;
+        std::condition_variable written_cv_;
+
+        /// most recently used first
+        std::list<Entry> entries_;
+        size_t bytes_;
+        size_t capacity_;
+
+        std::map<std::string, PendingWrite> pending_;
+        /// the write on its way to disk
+        std::string writing_;
+        Content writing_content_;
+        bool stop_;
+
+        std::map<std::string, FolderIndex> folders_;
+
+        std::thread writer_thread_;
+    };
+
     /// data: [RO E1 E2 SLC PHS CON REP SET SEG AVE]
 
     /// ismrmd_header : ismrmrd protocol
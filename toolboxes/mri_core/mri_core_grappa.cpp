@@ -26,8 +26,10 @@
 #include "mri_core_utility.h"
 #include "hoMatrix.h"
 #include "hoNDArray_linalg.h"
+#include "hoNDArray_batched.h"
 #include "hoNDFFT.h"
 #include "hoNDArray_utils.h"
+#include "hoNDArrayScratch.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDArray_reductions.h"
 
@@ -131,16 +133,16 @@ void grappa2d_calib(const hoNDArray<T>& acsSrc, const hoNDArray<T>& acsDst, doub
         size_t colA = kRO*kNE1*srcCHA;
         size_t colB = dstCHA*oNE1;
 
+        hoNDArrayScratchScope scratch_scope;
+
         hoMatrix<T> A;
         hoMatrix<T> B;
         hoMatrix<T> x( colA, colB );
 
-        hoNDArray<T> A_mem(rowA, colA);
-        A.createMatrix( rowA, colA, A_mem.begin() );
+        hoNDArrayScratch::instance().create(A, rowA, colA);
         T* pA = A.begin();
 
-        hoNDArray<T> B_mem(rowA, colB);
-        B.createMatrix( A.rows(), colB, B_mem.begin() );
+        hoNDArrayScratch::instance().create(B, A.rows(), colB);
         T* pB = B.begin();
 
         long long e1;
@@ -430,7 +432,6 @@ void grappa2d_unmixing_coeff(const hoNDArray<T>& kerIm, const hoNDArray<T>& coil
         {
             unmixCoeff.create(RO, E1, srcCHA);
         }
-        Gadgetron::clear(&unmixCoeff);
 
         std::vector<size_t> dimGFactor(2);
         dimGFactor[0] = RO; dimGFactor[1] = E1;
@@ -440,42 +441,18 @@ void grappa2d_unmixing_coeff(const hoNDArray<T>& kerIm, const hoNDArray<T>& coil
         }
         Gadgetron::clear(&gFactor);
 
-        int src;
-
-        T* pKerIm = const_cast<T*>(kerIm.begin());
-        T* pCoilMap = const_cast<T*>(coilMap.begin());
-        T* pCoeff = unmixCoeff.begin();
-
-        std::vector<size_t> dim(2);
-        dim[0] = RO;
-        dim[1] = E1;
-
-#pragma omp parallel default(none) private(src) shared(RO, E1, srcCHA, dstCHA, pKerIm, pCoilMap, pCoeff, dim)
-        {
-            hoNDArray<T> coeff2D, coeffTmp(&dim);
-            hoNDArray<T> coilMap2D;
-            hoNDArray<T> kerIm2D;
-
-#pragma omp for
-            for (src = 0; src<(int)srcCHA; src++)
-            {
-                coeff2D.create(&dim, pCoeff + src*RO*E1);
+        // unmixCoeff(src) = sum over dst of kerIm(src, dst) * conj(coilMap(dst)), per pixel
+        hoNDArrayBatched::gemv(RO*E1, srcCHA, dstCHA, kerIm.begin(), false, coilMap.begin(), true, unmixCoeff.begin());
 
-                for (size_t dst = 0; dst<dstCHA; dst++)
-                {
-                    kerIm2D.create(&dim, pKerIm + src*RO*E1 + dst*RO*E1*srcCHA);
-                    coilMap2D.create(&dim, pCoilMap + dst*RO*E1);
-                    Gadgetron::multiplyConj(kerIm2D, coilMap2D, coeffTmp);
-                    Gadgetron::add(coeff2D, coeffTmp, coeff2D);
-                }
-            }
-        }
+        hoNDArrayScratchScope scratch_scope;
 
-        hoNDArray<T> conjUnmixCoeff(unmixCoeff);
-        Gadgetron::multiplyConj(unmixCoeff, conjUnmixCoeff, conjUnmixCoeff);
+        hoNDArray<T> conjUnmixCoeff;
+        hoNDArrayScratch::instance().create(conjUnmixCoeff, RO, E1, srcCHA);
+        Gadgetron::multiplyConj(unmixCoeff, unmixCoeff, conjUnmixCoeff);
         // Gadgetron::sumOverLastDimension(conjUnmixCoeff, gFactor);
 
-        hoNDArray<T> gFactorBuf(RO, E1, 1);
+        hoNDArray<T> gFactorBuf;
+        hoNDArrayScratch::instance().create(gFactorBuf, RO, E1, 1);
         Gadgetron::sum_over_dimension(conjUnmixCoeff, gFactorBuf, 2);
         Gadgetron::sqrt(gFactorBuf, gFactorBuf);
         Gadgetron::scal((value_type)(1.0 / acceFactorE1), gFactorBuf);
@@ -541,31 +518,13 @@ void grappa2d_image_domain_unwrapping_aliased_image(const hoNDArray<T>& aliasedI
 
         size_t num = aliasedIm.get_number_of_elements() / (RO*E1*srcCHA);
 
+        // complexIm(dst) = sum over src of kerIm(src, dst) * aliasedIm(src), per pixel
         long long n;
 
-#pragma omp parallel default(none) private(n) shared(kerIm, num, aliasedIm, RO, E1, srcCHA, dstCHA, complexIm) if(num>=16)
+#pragma omp parallel for default(none) private(n) shared(kerIm, num, aliasedIm, RO, E1, srcCHA, dstCHA, complexIm) if(num>=16)
+        for (n = 0; n < (long long)num; n++)
         {
-            hoNDArray<T> unwrappedBuffer;
-            unwrappedBuffer.create(RO, E1, srcCHA);
-
-            hoNDArray<T> unwrappedIm2D;
-            unwrappedIm2D.create(RO, E1, 1);
-
-#pragma omp for 
-            for (n = 0; n < (long long)num; n++)
-            {
-                hoNDArray<T> bufIm(RO, E1, srcCHA, const_cast<T*>(aliasedIm.begin() + n*RO*E1*srcCHA));
-
-                for (size_t dcha = 0; dcha < dstCHA; dcha++)
-                {
-                    hoNDArray<T> kerSrcCha(RO, E1, srcCHA, const_cast<T*>(kerIm.begin() + dcha*RO*E1*srcCHA));
-
-                    Gadgetron::multiply(kerSrcCha, bufIm, unwrappedBuffer);
-                    Gadgetron::sum_over_dimension(unwrappedBuffer, unwrappedIm2D, 2);
-
-                    memcpy(complexIm.begin() + n*RO*E1*dstCHA + dcha*RO*E1, unwrappedIm2D.begin(), sizeof(T)*RO*E1);
-                }
-            }
+            hoNDArrayBatched::gemv(RO*E1, dstCHA, srcCHA, kerIm.begin(), true, aliasedIm.begin() + n*RO*E1*srcCHA, false, complexIm.begin() + n*RO*E1*dstCHA);
         }
     }
     catch (...)
@@ -632,10 +591,18 @@ void apply_unmix_coeff_aliased_image(const hoNDArray<T>& aliasedIm, const hoNDAr
             complexIm.create(&dim);
         }
 
-        hoNDArray<T> buffer2DT(aliasedIm);
+        size_t N = aliasedIm.get_size(0)*aliasedIm.get_size(1);
+        size_t CHA = aliasedIm.get_size(2);
 
-        Gadgetron::multiply(aliasedIm, unmixCoeff, buffer2DT);
-        Gadgetron::sum_over_dimension(buffer2DT, complexIm, 2);
+        size_t num = aliasedIm.get_number_of_elements() / (N*CHA);
+        size_t numCoeff = unmixCoeff.get_number_of_elements() / (N*CHA);
+        GADGET_CHECK_THROW(numCoeff>0 && num%numCoeff==0);
+
+        // complexIm = sum over CHA of aliasedIm .* unmixCoeff, the coefficients repeat over the higher dimensions
+        for (size_t n = 0; n < num; n++)
+        {
+            hoNDArrayBatched::gemv(N, 1, CHA, unmixCoeff.begin() + (n%numCoeff)*N*CHA, false, aliasedIm.begin() + n*N*CHA, false, complexIm.begin() + n*N);
+        }
     }
     catch (...)
     {
@@ -775,14 +742,14 @@ void grappa3d_calib(const hoNDArray<T>& acsSrc, const hoNDArray<T>& acsDst,
 
         size_t rowA = lenRO*lenE1*lenE2;
 
+        hoNDArrayScratchScope scratch_scope;
+
         hoMatrix<T> A, B, x(colA, colB);
 
-        hoNDArray<T> A_mem(rowA, colA);
-        A.createMatrix(rowA, colA, A_mem.begin());
+        hoNDArrayScratch::instance().create(A, rowA, colA);
         T* pA = A.begin();
 
-        hoNDArray<T> B_mem(rowA, colB);
-        B.createMatrix(rowA, colB, B_mem.begin());
+        hoNDArrayScratch::instance().create(B, rowA, colB);
         T* pB = B.begin();
 
         long long e2;
@@ -1537,8 +1504,10 @@ void apply_unmix_coeff_aliased_image_3D(const hoNDArray<T>& aliasedIm, const hoN
             complexIm.create(RO, E1, E2, N);
         }
 
+        hoNDArrayScratchScope scratch_scope;
+
         hoNDArray<T> buffer;
-        buffer.create(dim);
+        hoNDArrayScratch::instance().create(buffer, dim);
 
         Gadgetron::multiply(aliasedIm, unmixCoeff, buffer);
 
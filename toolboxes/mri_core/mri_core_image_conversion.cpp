@@ -0,0 +1,193 @@
+
+/** \file   mri_core_image_conversion.cpp
+    \brief  Conversion of reconstructed complex images to the fix point values sent to the client
+    \author Hui Xue
+*/
+
+#include "mri_core_image_conversion.h"
+#include "hoNDArray_simd.h"
+#include <cmath>
+#include <vector>
+
+#ifdef USE_OMP
+    #include "omp.h"
+#endif // USE_OMP
+
+namespace Gadgetron
+{
+    /// number of pixels converted at a time, the magnitude of a block stays in the cache
+    static const long long image_conversion_block_size = 4096;
+
+    /// images with more pixels are split over the threads
+    static const long long image_conversion_num_elements_threading = 64 * 1024;
+
+    /// histogram bins of the auto scaling
+    static const unsigned int image_conversion_histogram_bins = 100;
+
+    template <typename T>
+    inline T image_conversion_clamp_round(float v, float minV, float maxV)
+    {
+        if (v < minV) v = minV;
+        if (v > maxV) v = maxV;
+        return static_cast<T>(v + 0.5);
+    }
+
+    /// scaling factor which brings the 99th percentile of the magnitude to max_value, same steps as AutoScaleGadget
+    static float image_conversion_auto_scale(const float* d, long long N, float max_value)
+    {
+        float max = 0.0f;
+        long long i;
+
+#pragma omp parallel for default(none) private(i) shared(d, N) reduction(max:max) if(N>image_conversion_num_elements_threading)
+        for (i = 0; i < N; i++)
+        {
+            if (d[i] > max) max = d[i];
+        }
+
+        if (max <= 0) return 1.0f;
+
+        std::vector<size_t> histogram(image_conversion_histogram_bins, 0);
+
+#pragma omp parallel default(none) shared(d, N, max, histogram) if(N>image_conversion_num_elements_threading)
+        {
+            std::vector<size_t> hist(image_conversion_histogram_bins, 0);
+
+#pragma omp for
+            for (long long n = 0; n < N; n++)
+            {
+                size_t bin = static_cast<size_t>(std::floor((d[n] / max)*image_conversion_histogram_bins));
+                if (bin >= image_conversion_histogram_bins) bin = image_conversion_histogram_bins - 1;
+                hist[bin]++;
+            }
+
+#pragma omp critical
+            {
+                for (size_t b = 0; b < image_conversion_histogram_bins; b++) histogram[b] += hist[b];
+            }
+        }
+
+        long long cumsum = 0;
+        size_t counter = 0;
+        while (cumsum < (0.99*N))
+        {
+            cumsum += (long long)(histogram[counter++]);
+        }
+        max = (counter + 1)*(max / image_conversion_histogram_bins);
+
+        return max_value / max;
+    }
+
+    template <typename T>
+    float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value,
+        T min_intensity, T max_intensity, T intensity_offset, hoNDArray<T>& r)
+    {
+        float scale = 1.0f;
+
+        try
+        {
+            r.create(x.get_dimensions());
+
+            const std::complex<float>* pX = x.begin();
+            T* pR = r.begin();
+
+            long long N = (long long)x.get_number_of_elements();
+            long long i;
+
+            float minV = (float)min_intensity;
+            float maxV = (float)max_intensity;
+
+            switch (image_type)
+            {
+                case ISMRMRD::ISMRMRD_IMTYPE_MAGNITUDE:
+                {
+                    if (auto_scale_max_value > 0 && N > 0)
+                    {
+                        // the histogram needs the maximum first, so the magnitude of the whole image is kept
+                        std::vector<float> mag(N);
+                        hoNDArraySimd::abs(N, pX, &mag[0]);
+
+                        scale = image_conversion_auto_scale(&mag[0], N, auto_scale_max_value);
+
+                        const float* pM = &mag[0];
+#pragma omp parallel for default(none) private(i) shared(N, pM, pR, scale, minV, maxV) if(N>image_conversion_num_elements_threading)
+                        for (i = 0; i < N; i++)
+                        {
+                            float v = pM[i] * scale;
+                            pR[i] = image_conversion_clamp_round<T>(std::abs(v), minV, maxV);
+                        }
+                    }
+                    else
+                    {
+                        long long numBlocks = (N + image_conversion_block_size - 1) / image_conversion_block_size;
+                        long long b;
+
+#pragma omp parallel default(none) private(b) shared(N, numBlocks, pX, pR, minV, maxV) if(N>image_conversion_num_elements_threading)
+                        {
+                            std::vector<float> buf(image_conversion_block_size);
+
+#pragma omp for
+                            for (b = 0; b < numBlocks; b++)
+                            {
+                                long long start = b*image_conversion_block_size;
+                                long long len = (start + image_conversion_block_size > N) ? N - start : image_conversion_block_size;
+
+                                hoNDArraySimd::abs((size_t)len, pX + start, &buf[0]);
+
+                                for (long long k = 0; k < len; k++)
+                                {
+                                    pR[start + k] = image_conversion_clamp_round<T>(std::abs(buf[k]), minV, maxV);
+                                }
+                            }
+                        }
+                    }
+                }
+                break;
+
+                case ISMRMRD::ISMRMRD_IMTYPE_REAL:
+                case ISMRMRD::ISMRMRD_IMTYPE_IMAG:
+                {
+                    bool is_real = (image_type == ISMRMRD::ISMRMRD_IMTYPE_REAL);
+
+#pragma omp parallel for default(none) private(i) shared(N, pX, pR, minV, maxV, intensity_offset, is_real) if(N>image_conversion_num_elements_threading)
+                    for (i = 0; i < N; i++)
+                    {
+                        float v = (is_real ? pX[i].real() : pX[i].imag()) + intensity_offset;
+                        pR[i] = image_conversion_clamp_round<T>(v, minV, maxV);
+                    }
+                }
+                break;
+
+                case ISMRMRD::ISMRMRD_IMTYPE_PHASE:
+                {
+                    float phase_scale = (float)(intensity_offset / 3.14159265);
+
+#pragma omp parallel for default(none) private(i) shared(N, pX, pR, minV, maxV, intensity_offset, phase_scale) if(N>image_conversion_num_elements_threading)
+                    for (i = 0; i < N; i++)
+                    {
+                        float v = std::arg(pX[i]);
+                        v *= phase_scale;
+                        v += intensity_offset;
+                        if (v < minV) v = minV;
+                        if (v > maxV) v = maxV;
+                        pR[i] = static_cast<T>(v);
+                    }
+                }
+                break;
+
+                default:
+                    GADGET_THROW("Unknown image type in complex_to_fix_point(...) ... ");
+            }
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors in complex_to_fix_point(...) ... ");
+        }
+
+        return scale;
+    }
+
+    template EXPORTMRICORE float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value, unsigned short min_intensity, unsigned short max_intensity, unsigned short intensity_offset, hoNDArray<unsigned short>& r);
+    template EXPORTMRICORE float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value, short min_intensity, short max_intensity, short intensity_offset, hoNDArray<short>& r);
+    template EXPORTMRICORE float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value, unsigned int min_intensity, unsigned int max_intensity, unsigned int intensity_offset, hoNDArray<unsigned int>& r);
+    template EXPORTMRICORE float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value, int min_intensity, int max_intensity, int intensity_offset, hoNDArray<int>& r);
+}
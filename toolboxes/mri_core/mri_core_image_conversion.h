@@ -0,0 +1,26 @@
+
+/** \file   mri_core_image_conversion.h
+    \brief  Conversion of reconstructed complex images to the fix point values sent to the client
+    \author Hui Xue
+*/
+
+#pragma once
+
+#include "mri_core_export.h"
+#include "hoNDArray.h"
+#include "ismrmrd/ismrmrd.h"
+
+namespace Gadgetron
+{
+    /// convert a complex image to fix point values in one pass over the image
+    /// the values are the same as from ComplexToFloatGadget, AutoScaleGadget and FloatToFixPointGadget one after the other
+    /// x: complex image
+    /// image_type: ISMRMRD image type, magnitude, real, imag or phase
+    /// auto_scale_max_value: if > 0, a magnitude image is scaled so that its 99th percentile, from a 100 bin histogram, becomes this value
+    /// min_intensity, max_intensity: values are clamped to this range
+    /// intensity_offset: added to real and imag images, phase images are mapped from [-pi pi] to [0 2*intensity_offset]
+    /// r: fix point image, same size as x
+    /// return the auto scaling factor, 1 if the image is not scaled
+    template <typename T> EXPORTMRICORE float complex_to_fix_point(const hoNDArray< std::complex<float> >& x, uint16_t image_type, float auto_scale_max_value,
+        T min_intensity, T max_intensity, T intensity_offset, hoNDArray<T>& r);
+}
@@ -6,7 +6,9 @@
 
 #include "mri_core_kspace_filter.h"
 #include "hoNDArray_elemwise.h"
+#include "hoNDArray_utils.h"
 #include <boost/algorithm/string.hpp>
+#include <sstream>
 
 #ifdef M_PI
     #undef M_PI
@@ -515,6 +517,167 @@ template EXPORTMRICORE void generate_symmetric_filter_ref(size_t len, size_t sta
 
 // ------------------------------------------------------------------------
 
+template <typename T>
+hoKSpaceFilterCache<T>* hoKSpaceFilterCache<T>::instance()
+{
+    static hoKSpaceFilterCache<T> cache;
+    return &cache;
+}
+
+template <typename T>
+bool hoKSpaceFilterCache<T>::find(const std::string& key, hoNDArray<T>& filter)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    for (typename std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->key == key)
+        {
+            entries_.splice(entries_.begin(), entries_, it);
+            filter = entries_.front().filter;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename T>
+void hoKSpaceFilterCache<T>::insert(const std::string& key, hoNDArray<T>& filter)
+{
+    filter.share();
+
+    Entry e;
+    e.key = key;
+    e.filter = filter;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    for (typename std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->key == key)
+        {
+            entries_.erase(it);
+            break;
+        }
+    }
+
+    entries_.push_front(e);
+    while (entries_.size() > MAX_ENTRIES) entries_.pop_back();
+}
+
+template <typename T>
+size_t hoKSpaceFilterCache<T>::size()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return entries_.size();
+}
+
+template <typename T>
+void hoKSpaceFilterCache<T>::clear()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_.clear();
+}
+
+template <typename T>
+void hoKSpaceFilterCache<T>::symmetric_filter(size_t len, size_t start, size_t end, ISMRMRDKSPACEFILTER filterType, double sigma, double width, hoNDArray<T>& filter)
+{
+    try
+    {
+        if (len == 0 || filterType == ISMRMRD_FILTER_NONE)
+        {
+            filter.clear();
+            return;
+        }
+
+        GADGET_CHECK_THROW(start <= end && end < len);
+
+        std::ostringstream key;
+        key << "symmetric " << len << " " << start << " " << end << " " << filterType << " " << sigma << " " << width;
+        if (this->find(key.str(), filter)) return;
+
+        if (start == 0 || end == len - 1)
+        {
+            generate_symmetric_filter(len, filter, filterType, sigma, (size_t)std::ceil(width*len));
+        }
+        else
+        {
+            // the symmetric range around the kspace center enclosing [start end]
+            size_t hmin = (len / 2 > start) ? len / 2 - start : 0;
+            size_t hmax = (end > len / 2) ? end - len / 2 : 0;
+            size_t r = (hmax > hmin) ? 2 * hmax + 1 : 2 * hmin + 1;
+            if (r > len) r = len;
+
+            hoNDArray<T> f;
+            generate_symmetric_filter(r, f, filterType, sigma, (size_t)std::ceil(width*r));
+            Gadgetron::pad(len, &f, &filter);
+        }
+
+        if (start != 0 || end != len - 1)
+        {
+            // compensate the scaling from start to end
+            double sos = 0;
+            for (size_t ii = start; ii <= end; ii++) sos += std::norm(filter(ii));
+
+            if (sos > 0)
+            {
+                typename realType<T>::Type scale = (typename realType<T>::Type)(1.0 / std::sqrt(sos / (end - start + 1)));
+                for (size_t ii = 0; ii < len; ii++) filter(ii) *= scale;
+            }
+        }
+
+        this->insert(key.str(), filter);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoKSpaceFilterCache<T>::symmetric_filter(...) ... ");
+    }
+}
+
+template <typename T>
+void hoKSpaceFilterCache<T>::asymmetric_filter(size_t len, size_t start, size_t end, ISMRMRDKSPACEFILTER filterType, size_t width, bool densityComp, hoNDArray<T>& filter)
+{
+    try
+    {
+        std::ostringstream key;
+        key << "asymmetric " << len << " " << start << " " << end << " " << filterType << " " << width << " " << densityComp;
+        if (this->find(key.str(), filter)) return;
+
+        generate_asymmetric_filter(len, start, end, filter, filterType, width, densityComp);
+        this->insert(key.str(), filter);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoKSpaceFilterCache<T>::asymmetric_filter(...) ... ");
+    }
+}
+
+template <typename T>
+void hoKSpaceFilterCache<T>::symmetric_filter_ref(size_t len, size_t start, size_t end, hoNDArray<T>& filter)
+{
+    try
+    {
+        std::ostringstream key;
+        key << "ref " << len << " " << start << " " << end;
+        if (this->find(key.str(), filter)) return;
+
+        generate_symmetric_filter_ref(len, start, end, filter);
+        this->insert(key.str(), filter);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoKSpaceFilterCache<T>::symmetric_filter_ref(...) ... ");
+    }
+}
+
+template class EXPORTMRICORE hoKSpaceFilterCache<float>;
+template class EXPORTMRICORE hoKSpaceFilterCache<double>;
+template class EXPORTMRICORE hoKSpaceFilterCache< std::complex<float> >;
+template class EXPORTMRICORE hoKSpaceFilterCache< std::complex<double> >;
+
+// ------------------------------------------------------------------------
+
 template <typename T> 
 void compute_2d_filter(const hoNDArray<T>& fx, const hoNDArray<T>& fy, hoNDArray<T>& fxy)
 {
@@ -718,6 +881,72 @@ void compute_3d_filter(const hoNDArray<double>& fx, const hoNDArray<double>& fy,
 
 // ------------------------------------------------------------------------
 
+template <typename T>
+void apply_kspace_filter(const hoNDArray<T>& data, const hoNDArray<T>& fRO, const hoNDArray<T>& fE1, const hoNDArray<T>& fE2, hoNDArray<T>& dataFiltered)
+{
+    try
+    {
+        size_t RO = data.get_size(0);
+        size_t E1 = data.get_size(1);
+        size_t E2 = data.get_size(2);
+
+        GADGET_CHECK_THROW(fRO.get_number_of_elements() == 0 || fRO.get_number_of_elements() == RO);
+        GADGET_CHECK_THROW(fE1.get_number_of_elements() == 0 || fE1.get_number_of_elements() == E1);
+        GADGET_CHECK_THROW(fE2.get_number_of_elements() == 0 || fE2.get_number_of_elements() == E2);
+
+        if (&dataFiltered != &data && !dataFiltered.dimensions_equal(&data))
+        {
+            dataFiltered.create(data.get_dimensions());
+        }
+
+        size_t num = data.get_number_of_elements();
+        if (num == 0) return;
+
+        // every line along RO is scaled by fE1*fE2 of its position, the RO filter is applied in the same pass
+        // the result pointer is taken first, so that an in-place call sees the buffer after any copy-on-write
+        T* pRes = dataFiltered.begin();
+        const T* pData = data.begin();
+
+        const T* pRO = (fRO.get_number_of_elements() > 0) ? fRO.begin() : NULL;
+        const T* pE1 = (fE1.get_number_of_elements() > 0) ? fE1.begin() : NULL;
+        const T* pE2 = (fE2.get_number_of_elements() > 0) ? fE2.begin() : NULL;
+
+        long long numLines = (long long)(num / RO);
+        long long n;
+
+#pragma omp parallel for private(n) shared(pRes, pData, pRO, pE1, pE2, RO, E1, E2, numLines) if(num>64*1024)
+        for (n = 0; n < numLines; n++)
+        {
+            T f = T(1.0);
+            if (pE1) f *= pE1[n % E1];
+            if (pE2) f *= pE2[(n / E1) % E2];
+
+            const T* pD = pData + n*RO;
+            T* pR = pRes + n*RO;
+
+            if (pRO)
+            {
+                for (size_t ro = 0; ro < RO; ro++) pR[ro] = pD[ro] * (pRO[ro] * f);
+            }
+            else
+            {
+                for (size_t ro = 0; ro < RO; ro++) pR[ro] = pD[ro] * f;
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in apply_kspace_filter(...) ... ");
+    }
+}
+
+template EXPORTMRICORE void apply_kspace_filter(const hoNDArray<float>& data, const hoNDArray<float>& fRO, const hoNDArray<float>& fE1, const hoNDArray<float>& fE2, hoNDArray<float>& dataFiltered);
+template EXPORTMRICORE void apply_kspace_filter(const hoNDArray<double>& data, const hoNDArray<double>& fRO, const hoNDArray<double>& fE1, const hoNDArray<double>& fE2, hoNDArray<double>& dataFiltered);
+template EXPORTMRICORE void apply_kspace_filter(const hoNDArray< std::complex<float> >& data, const hoNDArray< std::complex<float> >& fRO, const hoNDArray< std::complex<float> >& fE1, const hoNDArray< std::complex<float> >& fE2, hoNDArray< std::complex<float> >& dataFiltered);
+template EXPORTMRICORE void apply_kspace_filter(const hoNDArray< std::complex<double> >& data, const hoNDArray< std::complex<double> >& fRO, const hoNDArray< std::complex<double> >& fE1, const hoNDArray< std::complex<double> >& fE2, hoNDArray< std::complex<double> >& dataFiltered);
+
+// ------------------------------------------------------------------------
+
 template <typename T>
 void apply_kspace_filter_RO(hoNDArray<T>& data, const hoNDArray<T>& fRO)
 {
@@ -765,13 +994,7 @@ void apply_kspace_filter_E1(const hoNDArray<T>& data, const hoNDArray<T>& fE1, h
     {
         GADGET_CHECK_THROW(data.get_size(1) == fE1.get_number_of_elements());
 
-        hoNDArray<T> fRO(data.get_size(0));
-        fRO.fill(T(1.0));
-
-        hoNDArray<T> fxy;
-        compute_2d_filter(fRO, fE1, fxy);
-
-        Gadgetron::multiply(data, fxy, dataFiltered);
+        apply_kspace_filter(data, hoNDArray<T>(), fE1, hoNDArray<T>(), dataFiltered);
     }
     catch (...)
     {
@@ -817,10 +1040,7 @@ void apply_kspace_filter_ROE1(const hoNDArray<T>& data, const hoNDArray<T>& fRO,
         GADGET_CHECK_THROW(data.get_size(0) == fRO.get_size(0));
         GADGET_CHECK_THROW(data.get_size(1) == fE1.get_size(0));
 
-        hoNDArray<T> fROE1;
-        compute_2d_filter(fRO, fE1, fROE1);
-
-        Gadgetron::multiply(data, fROE1, dataFiltered);
+        apply_kspace_filter(data, fRO, fE1, hoNDArray<T>(), dataFiltered);
     }
     catch (...)
     {
@@ -842,16 +1062,7 @@ void apply_kspace_filter_E2(const hoNDArray<T>& data, const hoNDArray<T>& fE2, h
     {
         GADGET_CHECK_THROW(data.get_size(2) == fE2.get_number_of_elements());
 
-        hoNDArray<T> fRO(data.get_size(0));
-        fRO.fill(T(1.0));
-
-        hoNDArray<T> fE1(data.get_size(1));
-        fE1.fill(T(1.0));
-
-        hoNDArray<T> fxyz;
-        compute_3d_filter(fRO, fE1, fE2, fxyz);
-
-        Gadgetron::multiply(data, fxyz, dataFiltered);
+        apply_kspace_filter(data, hoNDArray<T>(), hoNDArray<T>(), fE2, dataFiltered);
     }
     catch (...)
     {
@@ -874,13 +1085,7 @@ void apply_kspace_filter_ROE2(const hoNDArray<T>& data, const hoNDArray<T>& fRO,
         GADGET_CHECK_THROW(data.get_size(0) == fRO.get_number_of_elements());
         GADGET_CHECK_THROW(data.get_size(2) == fE2.get_number_of_elements());
 
-        hoNDArray<T> fE1(data.get_size(1));
-        fE1.fill(T(1.0));
-
-        hoNDArray<T> fxyz;
-        compute_3d_filter(fRO, fE1, fE2, fxyz);
-
-        Gadgetron::multiply(data, fxyz, dataFiltered);
+        apply_kspace_filter(data, fRO, hoNDArray<T>(), fE2, dataFiltered);
     }
     catch (...)
     {
@@ -903,13 +1108,7 @@ void apply_kspace_filter_E1E2(const hoNDArray<T>& data, const hoNDArray<T>& fE1,
         GADGET_CHECK_THROW(data.get_size(1) == fE1.get_number_of_elements());
         GADGET_CHECK_THROW(data.get_size(2) == fE2.get_number_of_elements());
 
-        hoNDArray<T> fRO(data.get_size(0));
-        fRO.fill(T(1.0));
-
-        hoNDArray<T> fxyz;
-        compute_3d_filter(fRO, fE1, fE2, fxyz);
-
-        Gadgetron::multiply(data, fxyz, dataFiltered);
+        apply_kspace_filter(data, hoNDArray<T>(), fE1, fE2, dataFiltered);
     }
     catch (...)
     {
@@ -957,10 +1156,7 @@ void apply_kspace_filter_ROE1E2(const hoNDArray<T>& data, const hoNDArray<T>& fR
         GADGET_CHECK_THROW(data.get_size(1) == fE1.get_number_of_elements());
         GADGET_CHECK_THROW(data.get_size(2) == fE2.get_number_of_elements());
 
-        hoNDArray<T> fxyz;
-        compute_3d_filter(fRO, fE1, fE2, fxyz);
-
-        Gadgetron::multiply(data, fxyz, dataFiltered);
+        apply_kspace_filter(data, fRO, fE1, fE2, dataFiltered);
     }
     catch (...)
     {
@@ -9,6 +9,10 @@
 #include "mri_core_export.h"
 #include "hoNDArray.h"
 
+#include <list>
+#include <mutex>
+#include <string>
+
 namespace Gadgetron
 {
     /// ------------------------------------------------------------------------
@@ -50,10 +54,63 @@ namespace Gadgetron
     /// start, end: the data range within len
     template <typename T> EXPORTMRICORE void generate_symmetric_filter_ref(size_t len, size_t start, size_t end, hoNDArray<T>& filter);
 
+    /// ------------------------------------------------------------------------
+    /// filter cache
+    /// ------------------------------------------------------------------------
+    /// process wide cache of generated 1D filters
+    /// the filters only depend on the length, filter type, sigma, width and sampling limits, which are the same for every image of a series
+    /// entries are keyed by these parameters and the least recently used ones are dropped beyond MAX_ENTRIES
+    /// the filters handed out share their buffer with the cache and are copied on the first write
+    template <typename T> class EXPORTMRICORE hoKSpaceFilterCache
+    {
+    public:
+
+        enum { MAX_ENTRIES = 128 };
+
+        static hoKSpaceFilterCache<T>* instance();
+
+        /// symmetric filter of the kspace sampled over [start end] of len
+        /// if the sampling touches either end of len, the filter covers all of len; otherwise it covers the symmetric range around len/2 enclosing [start end] and is zero padded to len
+        /// a filter not covering all of len is scaled to keep the noise level over [start end]
+        /// width: length of the transition band, as a fraction of the filter length
+        /// if filterType is ISMRMRD_FILTER_NONE, filter is cleared
+        void symmetric_filter(size_t len, size_t start, size_t end, ISMRMRDKSPACEFILTER filterType, double sigma, double width, hoNDArray<T>& filter);
+
+        /// cached generate_asymmetric_filter
+        void asymmetric_filter(size_t len, size_t start, size_t end, ISMRMRDKSPACEFILTER filterType, size_t width, bool densityComp, hoNDArray<T>& filter);
+
+        /// cached generate_symmetric_filter_ref
+        void symmetric_filter_ref(size_t len, size_t start, size_t end, hoNDArray<T>& filter);
+
+        size_t size();
+        void clear();
+
+    protected:
+
+        hoKSpaceFilterCache() {}
+
+        struct Entry
+        {
+            std::string key;
+            hoNDArray<T> filter;
+        };
+
+        bool find(const std::string& key, hoNDArray<T>& filter);
+        void insert(const std::string& key, hoNDArray<T>& filter);
+
+        std::mutex mutex_;
+        /// most recently used first
+        std::list<Entry> entries_;
+    };
+
     /// ------------------------------------------------------------------------
     /// applying filter
     /// ------------------------------------------------------------------------
 
+    /// apply the separable filter fRO*fE1*fE2 in a single pass over data [RO E1 E2 ...]
+    /// an empty filter is not applied along its dimension; dataFiltered can be data
+    template <typename T> EXPORTMRICORE void apply_kspace_filter(const hoNDArray<T>& data, const hoNDArray<T>& fRO, const hoNDArray<T>& fE1, const hoNDArray<T>& fE2, hoNDArray<T>& dataFiltered);
+
     /// compute 2D filter from two 1D filters
     template <typename T> EXPORTMRICORE void compute_2d_filter(const hoNDArray<T>& fx, const hoNDArray<T>& fy, hoNDArray<T>& fxy);
     EXPORTMRICORE void compute_2d_filter(const hoNDArray<float>& fx, const hoNDArray<float>& fy, hoNDArray< std::complex<float> >& fxy);
@@ -234,6 +234,94 @@ namespace Gadgetron
 
     // ------------------------------------------------------------------------
 
+    /// POCS of one image, run by partial_fourier_POCS for every [RO E1 E2] image of the kspace
+    /// k: acquired kspace of the image, filter: kspace filter for the homodyne phase estimation
+    /// phase, im, imPOCS, kIter: [RO E1 E2] buffers of the calling thread, reused for all its images
+    /// r: result kspace, the kspace of the last iteration before (keep_iter == true) or after the acquired region is restored
+    template <typename T>
+    void partial_fourier_POCS_image(const T* k, const T* filter, bool is3D,
+                                    size_t startRO, size_t endRO, size_t startE1, size_t endE1, size_t startE2, size_t endE2,
+                                    size_t iter, double thres, bool keep_iter,
+                                    hoNDArray<T>& phase, hoNDArray<T>& im, hoNDArray<T>& imPOCS, hoNDArray<T>& kIter, T* r)
+    {
+        typedef typename realType<T>::Type value_type;
+
+        size_t RO = phase.get_size(0);
+        size_t E1 = phase.get_size(1);
+        size_t N = phase.get_number_of_elements();
+
+        hoNDFFT<value_type>* fft = hoNDFFT<value_type>::instance();
+
+        // complex image phase of the filtered kspace
+        T* pPhase = phase.begin();
+        for (size_t n = 0; n < N; n++) pPhase[n] = k[n] * filter[n];
+
+        if (is3D) fft->ifft3c(phase); else fft->ifft2c(phase);
+
+        const value_type eps = std::numeric_limits<value_type>::epsilon();
+        for (size_t n = 0; n < N; n++)
+        {
+            value_type m = std::abs(pPhase[n]);
+            if (m < eps) m += eps;
+            pPhase[n] /= m;
+        }
+
+        // complex image, initialized as not filtered complex image
+        memcpy(im.begin(), k, sizeof(T)*N);
+        if (is3D) fft->ifft3c(im); else fft->ifft2c(im);
+
+        T* pK = kIter.begin();
+        memcpy(pK, k, sizeof(T)*N);
+
+        // current and updated complex image, swapped after every iteration
+        hoNDArray<T>* cur = &im;
+        hoNDArray<T>* next = &imPOCS;
+
+        for (size_t ii = 0; ii < iter; ii++)
+        {
+            const T* pIm = cur->begin();
+            for (size_t n = 0; n < N; n++) pK[n] = std::abs(pIm[n]) * pPhase[n];
+
+            // go back to kspace
+            if (is3D) fft->fft3c(kIter); else fft->fft2c(kIter);
+
+            if (keep_iter) memcpy(r, pK, sizeof(T)*N);
+
+            // restore the acquired region
+            for (size_t e2 = startE2; e2 <= endE2; e2++)
+            {
+                for (size_t e1 = startE1; e1 <= endE1; e1++)
+                {
+                    size_t offset = e2*E1*RO + e1*RO + startRO;
+                    memcpy(pK + offset, k + offset, sizeof(T)*(endRO - startRO + 1));
+                }
+            }
+
+            // update complex image
+            if (is3D) fft->ifft3c(kIter, *next); else fft->ifft2c(kIter, *next);
+
+            // compute threshold to stop the iteration
+            const T* pPOCS = next->begin();
+            value_type diff = 0, prev = 0;
+            for (size_t n = 0; n < N; n++)
+            {
+                diff += std::norm(pPOCS[n] - pIm[n]);
+                prev += std::norm(pIm[n]);
+            }
+
+            std::swap(cur, next);
+
+            if (std::sqrt(diff) < thres*std::sqrt(prev))
+            {
+                break;
+            }
+        }
+
+        if (!keep_iter) memcpy(r, pK, sizeof(T)*N);
+    }
+
+    // ------------------------------------------------------------------------
+
     /// kspace: input kspae [RO E1 E2 ...]
     /// if is3D==false, 2D POCS is performed, otherwise 3D POCS is performed
     /// startRO, endRO, startE1, endE1, startE2, endE2: acquired kspace range
@@ -304,116 +392,62 @@ namespace Gadgetron
             hoNDArray<T> filterE1(E1);
             Gadgetron::generate_symmetric_filter_ref(E1, startE1, endE1, filterE1);
 
-            hoNDArray<T> filterE2(E2);
+            hoNDArray<T> filter;
             if (is3D)
             {
+                hoNDArray<T> filterE2(E2);
                 Gadgetron::generate_symmetric_filter_ref(E2, startE2, endE2, filterE2);
-            }
-
-            hoNDArray<T> kspaceIter(kspace);
-            // magnitude of complex images
-            hoNDArray<typename realType<T>::Type> mag(kspace.get_dimensions());
-            hoNDArray<T> magComplex(kspace.get_dimensions());
-
-            // kspace filter
-            hoNDArray<T> buffer_partial_fourier(kspaceIter), buffer(kspaceIter);
-
-            if (is3D)
-            {
-                Gadgetron::apply_kspace_filter_ROE1E2(kspaceIter, filterRO, filterE1, filterE2, buffer_partial_fourier);
-
-                // go to image domain
-                Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft3c(buffer_partial_fourier);
+                Gadgetron::compute_3d_filter(filterRO, filterE1, filterE2, filter);
             }
             else
             {
-                Gadgetron::apply_kspace_filter_ROE1(kspaceIter, filterRO, filterE1, buffer_partial_fourier);
-
-                // go to image domain
-                Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft2c(buffer_partial_fourier);
+                Gadgetron::compute_2d_filter(filterRO, filterE1, filter);
             }
 
-            // get the complex image phase for the filtered kspace
-            Gadgetron::abs(buffer_partial_fourier, mag);
-            Gadgetron::addEpsilon(mag);
-            magComplex.copyFrom(mag);
-            Gadgetron::divide(buffer_partial_fourier, magComplex, buffer);
+            bool keep_iter = (transit_band_RO != 0 || transit_band_E1 != 0 || transit_band_E2 != 0);
 
-            // complex images, initialized as not filtered complex image
-            hoNDArray<T> complexIm(kspaceIter);
+            // every image is iterated to convergence on its own, in buffers of the thread working on it
+            size_t imSize = RO*E1*E2;
+            size_t N = kspace.get_number_of_elements() / imSize;
 
-            if (is3D)
-            {
-                Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft3c(kspaceIter, complexIm);
-            }
-            else
-            {
-                Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft2c(kspaceIter, complexIm);
-            }
+            std::vector<size_t> dimIm(3);
+            dimIm[0] = RO;
+            dimIm[1] = E1;
+            dimIm[2] = E2;
 
-            hoNDArray<T> complexImPOCS(complexIm);
+            const T* pKspace = kspace.begin();
+            const T* pFilter = filter.begin();
+            T* pRes = res.begin();
 
-            // the kspace during iteration is buffered here
-            hoNDArray<T> buffer_partial_fourier_Iter(kspaceIter);
+            bool failed = false;
 
-            size_t ii;
-            for (ii = 0; ii<iter; ii++)
+            long long n;
+#pragma omp parallel default(none) private(n) shared(N, imSize, dimIm, pKspace, pFilter, pRes, is3D, startRO, endRO, startE1, endE1, startE2, endE2, iter, thres, keep_iter, failed) if(N>1)
             {
-                Gadgetron::abs(complexImPOCS, mag);
-                magComplex.copyFrom(mag);
-                Gadgetron::multiply(magComplex, buffer, complexImPOCS);
-
-                // go back to kspace
-                if (is3D)
-                {
-                    Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->fft3c(complexImPOCS, kspaceIter);
-                }
-                else
-                {
-                    Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->fft2c(complexImPOCS, kspaceIter);
-                }
-
-                // buffer kspace during iteration
-                buffer_partial_fourier_Iter = kspaceIter;
-
-                // restore the acquired region
-                partial_fourier_reset_kspace(kspace, kspaceIter, startRO, endRO, startE1, endE1, startE2, endE2);
-
-                if (is3D)
-                {
-                    // update complex image
-                    Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft3c(kspaceIter, complexImPOCS);
-                }
-                else
-                {
-                    // update complex image
-                    Gadgetron::hoNDFFT<typename realType<T>::Type>::instance()->ifft2c(kspaceIter, complexImPOCS);
-                }
+                hoNDArray<T> phase(dimIm), im(dimIm), imPOCS(dimIm), kIter(dimIm);
 
-                // compute threshold to stop the iteration
-                Gadgetron::subtract(complexImPOCS, complexIm, buffer_partial_fourier);
-                typename realType<T>::Type diff, prev;
-                Gadgetron::norm2(complexIm, prev);
-                Gadgetron::norm2(buffer_partial_fourier, diff);
-
-                typename realType<T>::Type t = diff / prev;
-
-                if (t < thres)
+#pragma omp for schedule(dynamic)
+                for (n = 0; n < (long long)N; n++)
                 {
-                    break;
+                    try
+                    {
+                        partial_fourier_POCS_image(pKspace + n*imSize, pFilter, is3D,
+                            startRO, endRO, startE1, endE1, startE2, endE2,
+                            iter, thres, keep_iter, phase, im, imPOCS, kIter, pRes + n*imSize);
+                    }
+                    catch (...)
+                    {
+#pragma omp critical
+                        failed = true;
+                    }
                 }
-
-                complexIm = complexImPOCS;
             }
 
-            if (transit_band_RO == 0 && transit_band_E1 == 0 && transit_band_E2==0)
-            {
-                res = kspaceIter;
-            }
-            else
+            GADGET_CHECK_THROW(!failed);
+
+            if (keep_iter)
             {
-                Gadgetron::partial_fourier_transition_band(kspace, buffer_partial_fourier_Iter, startRO, endRO, startE1, endE1, startE2, endE2, transit_band_RO, transit_band_E1, transit_band_E2);
-                res = buffer_partial_fourier_Iter;
+                Gadgetron::partial_fourier_transition_band(kspace, res, startRO, endRO, startE1, endE1, startE2, endE2, transit_band_RO, transit_band_E1, transit_band_E2);
             }
         }
         catch (...)
@@ -441,7 +475,7 @@ namespace Gadgetron
         {
             if (start == 0 || end == len - 1)
             {
-                Gadgetron::generate_asymmetric_filter(len, start, end, filter_pf, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len*filter_pf_width), filter_pf_density_comp);
+                hoKSpaceFilterCache<T>::instance()->asymmetric_filter(len, start, end, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len*filter_pf_width), filter_pf_density_comp, filter_pf);
             }
             else
             {
@@ -452,13 +486,13 @@ namespace Gadgetron
                 if (len_end > len_start)
                 {
                     hoNDArray<T> fil(len_end);
-                    Gadgetron::generate_asymmetric_filter(len_end, len_end - fil_len, len_end - 1, fil, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len_end*filter_pf_width), filter_pf_density_comp);
+                    hoKSpaceFilterCache<T>::instance()->asymmetric_filter(len_end, len_end - fil_len, len_end - 1, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len_end*filter_pf_width), filter_pf_density_comp, fil);
                     Gadgetron::pad(len, &fil, &filter_pf);
                 }
                 else
                 {
                     hoNDArray<T> fil(len_start);
-                    Gadgetron::generate_asymmetric_filter(len_start, 0, fil_len - 1, fil, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len_start*filter_pf_width), filter_pf_density_comp);
+                    hoKSpaceFilterCache<T>::instance()->asymmetric_filter(len_start, 0, fil_len - 1, ISMRMRD_FILTER_TAPERED_HANNING, (size_t)(len_start*filter_pf_width), filter_pf_density_comp, fil);
                     Gadgetron::pad(len, &fil, &filter_pf);
                 }
             }
@@ -501,80 +535,19 @@ namespace Gadgetron
                 Gadgetron::compute_partial_fourier_filter(E1, startE1, endE1, filter_pf_width_E1, filter_pf_density_comp, filter_pf_E1);
             }
 
-            res = kspace;
-
             size_t lenE2 = endE2 - startE2 + 1;
-
-            if (E2 > 1)
-            {
-                if (filter_pf_E2.get_size(0) != E2 && lenE2 < E2)
-                {
-                    Gadgetron::compute_partial_fourier_filter(E2, startE2, endE2, filter_pf_width_E2, filter_pf_density_comp, filter_pf_E2);
-                }
-
-                if ((filter_pf_RO.get_number_of_elements() == RO) && (filter_pf_E1.get_number_of_elements() == E1) && (filter_pf_E2.get_number_of_elements() == E2))
-                {
-                    Gadgetron::apply_kspace_filter_ROE1E2(kspace, filter_pf_RO, filter_pf_E1, filter_pf_E2, res);
-                }
-                else
-                {
-                    if ((filter_pf_RO.get_number_of_elements() == RO)
-                        || (filter_pf_E1.get_number_of_elements() == E1)
-                        || (filter_pf_E2.get_number_of_elements() == E2))
-                    {
-                        hoNDArray<T> kspace_copy(kspace);
-
-                        hoNDArray<T>* pSrc = const_cast<hoNDArray<T>*>(&kspace_copy);
-                        hoNDArray<T>* pDst = &res;
-
-                        bool filterPerformed = false;
-
-                        if (filter_pf_RO.get_number_of_elements() == RO)
-                        {
-                            Gadgetron::apply_kspace_filter_RO(*pSrc, filter_pf_RO, *pDst);
-                            std::swap(pSrc, pDst);
-                            filterPerformed = true;
-                        }
-
-                        if (filter_pf_E1.get_number_of_elements() == E1)
-                        {
-                            Gadgetron::apply_kspace_filter_E1(*pSrc, filter_pf_E1, *pDst);
-                            std::swap(pSrc, pDst);
-                            filterPerformed = true;
-                        }
-
-                        if (filter_pf_E2.get_number_of_elements() == E2)
-                        {
-                            Gadgetron::apply_kspace_filter_E2(*pSrc, filter_pf_E2, *pDst);
-                            std::swap(pSrc, pDst);
-                            filterPerformed = true;
-                        }
-
-                        if (filterPerformed && pDst != &res)
-                        {
-                            res = *pDst;
-                        }
-                    }
-                }
-            }
-            else
+            if (E2 > 1 && filter_pf_E2.get_size(0) != E2 && lenE2 < E2)
             {
-                if ((filter_pf_RO.get_number_of_elements() == RO) && (filter_pf_E1.get_number_of_elements() == E1))
-                {
-                    Gadgetron::apply_kspace_filter_ROE1(kspace, filter_pf_RO, filter_pf_E1, res);
-                }
-                else
-                {
-                    if (filter_pf_RO.get_number_of_elements() == RO && filter_pf_E1.get_number_of_elements() != E1)
-                    {
-                        Gadgetron::apply_kspace_filter_RO(kspace, filter_pf_RO, res);
-                    }
-                    else if (filter_pf_RO.get_number_of_elements() != RO && filter_pf_E1.get_number_of_elements() == E1)
-                    {
-                        Gadgetron::apply_kspace_filter_E1(kspace, filter_pf_E1, res);
-                    }
-                }
+                Gadgetron::compute_partial_fourier_filter(E2, startE2, endE2, filter_pf_width_E2, filter_pf_density_comp, filter_pf_E2);
             }
+
+            // the filters of the kspace size are applied in one pass, the others are left out
+            hoNDArray<T> none;
+            const hoNDArray<T>& fRO = (filter_pf_RO.get_number_of_elements() == RO) ? filter_pf_RO : none;
+            const hoNDArray<T>& fE1 = (filter_pf_E1.get_number_of_elements() == E1) ? filter_pf_E1 : none;
+            const hoNDArray<T>& fE2 = (E2 > 1 && filter_pf_E2.get_number_of_elements() == E2) ? filter_pf_E2 : none;
+
+            Gadgetron::apply_kspace_filter(kspace, fRO, fE1, fE2, res);
         }
         catch (...)
         {
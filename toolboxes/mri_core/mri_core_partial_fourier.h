@@ -19,6 +19,7 @@ namespace Gadgetron
     /// iter: number of maximal iterations for POCS
     /// thres: threshold to stop the iteration
     /// res: [RO E1 E2 CHA N S SLC], result of POCS
+    /// every [RO E1 E2] image is iterated on its own until its change falls below thres, the images are processed in parallel
     template <typename T> EXPORTMRICORE void partial_fourier_POCS(const hoNDArray<T>& kspace,
         size_t startRO, size_t endRO, size_t startE1, size_t endE1, size_t startE2, size_t endE2,
         size_t transit_band_RO, size_t transit_band_E1, size_t transit_band_E2,
@@ -0,0 +1,209 @@
+
+/** \file   mri_core_pseudo_replica.cpp
+    \brief  Implementation of the pseudo replica noise generation and std map accumulation for MRI SNR measurement
+    \author Hui Xue
+*/
+
+#include "mri_core_pseudo_replica.h"
+#include <cmath>
+#include <cstring>
+
+namespace Gadgetron
+{
+    // ------------------------------------------------------------------------
+
+    /// number of noise samples drawn from one seeded generator
+    static const size_t pseudo_replica_noise_block_size = 4096;
+
+    /// splitmix64, used to seed the generator of every block
+    static inline unsigned long long pseudo_replica_splitmix64(unsigned long long& x)
+    {
+        unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /// xorshift128+ generator
+    class PseudoReplicaRNG
+    {
+    public:
+
+        PseudoReplicaRNG(unsigned long long seed, unsigned long long block)
+        {
+            unsigned long long x = seed ^ (block * 0xD1B54A32D192ED03ULL);
+            s_[0] = pseudo_replica_splitmix64(x);
+            s_[1] = pseudo_replica_splitmix64(x);
+            if (s_[0] == 0 && s_[1] == 0) s_[1] = 1;
+        }
+
+        /// uniform in (0, 1]
+        double uniform()
+        {
+            unsigned long long s1 = s_[0];
+            const unsigned long long s0 = s_[1];
+            s_[0] = s0;
+            s1 ^= s1 << 23;
+            s_[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+            return (double)(((s_[1] + s0) >> 11) + 1) * (1.0 / 9007199254740992.0);
+        }
+
+        /// one complex sample, real and imaginary parts are N(0, sigma^2), by the Box-Muller transform
+        template <typename T> T complex_gaussian(typename realType<T>::Type sigma)
+        {
+            double r = sigma * std::sqrt(-2.0 * std::log(uniform()));
+            double phi = 6.283185307179586 * uniform();
+            return T((typename realType<T>::Type)(r*std::cos(phi)), (typename realType<T>::Type)(r*std::sin(phi)));
+        }
+
+    protected:
+        unsigned long long s_[2];
+    };
+
+    /// noise of all elements, if mask is not NULL, elements where mask is zero are set to zero
+    /// the noise drawn for an element does not depend on the mask
+    template <typename T>
+    void pseudo_replica_fill_noise(T* pNoise, const T* mask, size_t N, typename realType<T>::Type sigma, unsigned long long seed)
+    {
+        long long numBlocks = (long long)((N + pseudo_replica_noise_block_size - 1) / pseudo_replica_noise_block_size);
+
+        long long b;
+#pragma omp parallel for default(none) private(b) shared(pNoise, mask, N, sigma, seed, numBlocks) schedule(static) if(numBlocks>1)
+        for (b = 0; b < numBlocks; b++)
+        {
+            PseudoReplicaRNG rng(seed, (unsigned long long)b);
+
+            size_t start = (size_t)b * pseudo_replica_noise_block_size;
+            size_t end = start + pseudo_replica_noise_block_size;
+            if (end > N) end = N;
+
+            for (size_t i = start; i < end; i++)
+            {
+                T v = rng.template complex_gaussian<T>(sigma);
+                pNoise[i] = (mask == NULL || mask[i] != T(0)) ? v : T(0);
+            }
+        }
+    }
+
+    template <typename T>
+    void generate_complex_gaussian_noise(hoNDArray<T>& noise, typename realType<T>::Type sigma, unsigned long long seed)
+    {
+        try
+        {
+            pseudo_replica_fill_noise(noise.begin(), (const T*)NULL, noise.get_number_of_elements(), sigma, seed);
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors in generate_complex_gaussian_noise(...) ... ");
+        }
+    }
+
+    template EXPORTMRICORE void generate_complex_gaussian_noise(hoNDArray< std::complex<float> >& noise, float sigma, unsigned long long seed);
+    template EXPORTMRICORE void generate_complex_gaussian_noise(hoNDArray< std::complex<double> >& noise, double sigma, unsigned long long seed);
+
+    // ------------------------------------------------------------------------
+
+    template <typename T>
+    void generate_sampled_kspace_noise(const hoNDArray<T>& kspace, typename realType<T>::Type sigma, unsigned long long seed, hoNDArray<T>& noise)
+    {
+        try
+        {
+            if (!noise.dimensions_equal(&kspace))
+            {
+                noise.create(kspace.get_dimensions());
+            }
+
+            pseudo_replica_fill_noise(noise.begin(), kspace.begin(), kspace.get_number_of_elements(), sigma, seed);
+        }
+        catch (...)
+        {
+            GADGET_THROW("Errors in generate_sampled_kspace_noise(...) ... ");
+        }
+    }
+
+    template EXPORTMRICORE void generate_sampled_kspace_noise(const hoNDArray< std::complex<float> >& kspace, float sigma, unsigned long long seed, hoNDArray< std::complex<float> >& noise);
+    template EXPORTMRICORE void generate_sampled_kspace_noise(const hoNDArray< std::complex<double> >& kspace, double sigma, unsigned long long seed, hoNDArray< std::complex<double> >& noise);
+
+    // ------------------------------------------------------------------------
+
+    template <typename T>
+    PseudoReplicaAccumulator<T>::PseudoReplicaAccumulator() : num_(0)
+    {
+    }
+
+    template <typename T>
+    PseudoReplicaAccumulator<T>::~PseudoReplicaAccumulator()
+    {
+    }
+
+    template <typename T>
+    void PseudoReplicaAccumulator<T>::clear()
+    {
+        num_ = 0;
+        mean_.clear();
+        m2_.clear();
+    }
+
+    template <typename T>
+    void PseudoReplicaAccumulator<T>::add(const hoNDArray<T>& replica)
+    {
+        if (num_ == 0)
+        {
+            mean_.create(replica.get_dimensions());
+            m2_.create(replica.get_dimensions());
+            memset(mean_.begin(), 0, mean_.get_number_of_bytes());
+            memset(m2_.begin(), 0, m2_.get_number_of_bytes());
+        }
+        else
+        {
+            GADGET_CHECK_THROW(replica.get_number_of_elements() == mean_.get_number_of_elements());
+        }
+
+        num_++;
+
+        const T* pR = replica.begin();
+        value_type* pMean = mean_.begin();
+        value_type* pM2 = m2_.begin();
+        value_type inv_num = (value_type)(1.0 / num_);
+
+        long long N = (long long)replica.get_number_of_elements();
+
+        long long ii;
+#pragma omp parallel for default(none) private(ii) shared(pR, pMean, pM2, inv_num, N) if(N>64*1024)
+        for (ii = 0; ii < N; ii++)
+        {
+            value_type x = std::abs(pR[ii]);
+            value_type d = x - pMean[ii];
+            pMean[ii] += d * inv_num;
+            pM2[ii] += d * (x - pMean[ii]);
+        }
+    }
+
+    template <typename T>
+    void PseudoReplicaAccumulator<T>::get_mean(hoNDArray<value_type>& mean) const
+    {
+        GADGET_CHECK_THROW(num_ > 0);
+        mean = mean_;
+    }
+
+    template <typename T>
+    void PseudoReplicaAccumulator<T>::get_std(hoNDArray<value_type>& std_map) const
+    {
+        GADGET_CHECK_THROW(num_ > 0);
+
+        std_map.create(m2_.get_dimensions());
+
+        const value_type* pM2 = m2_.begin();
+        value_type* pStd = std_map.begin();
+        value_type inv_num = (value_type)(1.0 / num_);
+
+        size_t N = m2_.get_number_of_elements();
+        for (size_t ii = 0; ii < N; ii++)
+        {
+            pStd[ii] = std::sqrt(pM2[ii] * inv_num);
+        }
+    }
+
+    template class EXPORTMRICORE PseudoReplicaAccumulator< std::complex<float> >;
+    template class EXPORTMRICORE PseudoReplicaAccumulator< std::complex<double> >;
+}
@@ -0,0 +1,56 @@
+
+/** \file   mri_core_pseudo_replica.h
+    \brief  Implementation of the pseudo replica noise generation and std map accumulation for MRI SNR measurement
+    \author Hui Xue
+*/
+
+#pragma once
+
+#include "mri_core_export.h"
+#include "hoNDArray.h"
+
+namespace Gadgetron
+{
+    /// fill noise with complex gaussian noise, real and imaginary parts are N(0, sigma^2)
+    /// the noise is generated in parallel from blocks seeded by seed and the block index, so it only depends on seed and not on the number of threads
+    template <typename T> EXPORTMRICORE void generate_complex_gaussian_noise(hoNDArray<T>& noise, typename realType<T>::Type sigma, unsigned long long seed);
+
+    /// generate complex gaussian noise for the sampled locations of kspace, zero elsewhere
+    /// kspace: [RO E1 E2 CHA N S SLC], a location is sampled if its value is not zero
+    /// noise: same size as kspace
+    template <typename T> EXPORTMRICORE void generate_sampled_kspace_noise(const hoNDArray<T>& kspace, typename realType<T>::Type sigma, unsigned long long seed, hoNDArray<T>& noise);
+
+    /// pixel-wise mean and std of the magnitude of pseudo replicas
+    /// the replicas are accumulated one by one with the Welford algorithm, so they do not need to be kept
+    template <typename T>
+    class EXPORTMRICORE PseudoReplicaAccumulator
+    {
+    public:
+
+        typedef typename realType<T>::Type value_type;
+
+        PseudoReplicaAccumulator();
+        ~PseudoReplicaAccumulator();
+
+        /// clear the accumulated replicas
+        void clear();
+
+        /// add the magnitude of a replica, all replicas must have the same size
+        void add(const hoNDArray<T>& replica);
+
+        /// number of replicas added
+        size_t number_of_replicas() const { return num_; }
+
+        /// mean magnitude, same size as the replicas
+        void get_mean(hoNDArray<value_type>& mean) const;
+
+        /// std of the magnitude, normalized by the number of replicas, same size as the replicas
+        void get_std(hoNDArray<value_type>& std_map) const;
+
+    protected:
+
+        size_t num_;
+        hoNDArray<value_type> mean_;
+        hoNDArray<value_type> m2_;
+    };
+}
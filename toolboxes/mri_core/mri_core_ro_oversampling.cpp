@@ -0,0 +1,171 @@
+
+/** \file   mri_core_ro_oversampling.cpp
+    \brief  Removal of the readout oversampling of cartesian acquisitions
+    \author Hui Xue
+*/
+
+#include "mri_core_ro_oversampling.h"
+#include "hoNDArray_simd.h"
+#include "hoNDFFT.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef USE_OMP
+    #include "omp.h"
+#endif // USE_OMP
+
+#ifdef M_PI
+    #undef M_PI
+#endif // M_PI
+#define M_PI 3.14159265358979323846
+
+namespace Gadgetron
+{
+
+namespace
+{
+    // modified Bessel function of the first kind of order 0, for the Kaiser window
+    double bessel_i0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (size_t k = 1; k < 64; k++)
+        {
+            double t = x / (2.0*k);
+            term *= t*t;
+            sum += term;
+            if (term < 1e-12*sum) break;
+        }
+
+        return sum;
+    }
+}
+
+void generate_halfband_filter(size_t P, std::vector<float>& taps, float& centerTap, double beta)
+{
+    try
+    {
+        GADGET_CHECK_THROW(P > 0);
+
+        // the window reaches zero one tap beyond the last odd tap
+        double L = 2.0*P;
+        double w0 = bessel_i0(beta);
+
+        std::vector<double> h(P);
+        double sum = 0;
+        for (size_t j = 0; j < P; j++)
+        {
+            double k = 2.0*j + 1;
+            double r = k / L;
+            double w = bessel_i0(beta*std::sqrt(1.0 - r*r)) / w0;
+            h[j] = ((j % 2 == 0) ? 1.0 : -1.0) / (M_PI*k) * w;
+            sum += 2 * h[j];
+        }
+
+        // unit gain at DC with the center tap 0.5, times sqrt(2) for the unitary fft scaling
+        double scale = std::sqrt(2.0);
+
+        taps.resize(P);
+        for (size_t j = 0; j < P; j++) taps[j] = (float)(h[j] * 0.5 / sum * scale);
+        centerTap = (float)(0.5*scale);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in generate_halfband_filter(...) ... ");
+    }
+}
+
+void remove_ro_oversampling_halfband(const hoNDArray< std::complex<float> >& data, const std::vector<float>& taps, float centerTap, hoNDArray< std::complex<float> >& res)
+{
+    try
+    {
+        size_t RO = data.get_size(0);
+        GADGET_CHECK_THROW(RO % 2 == 0);
+        GADGET_CHECK_THROW(!taps.empty());
+
+        size_t M = RO / 2;
+        size_t P = taps.size();
+
+        std::vector<size_t> dim;
+        data.get_dimensions(dim);
+        dim[0] = M;
+        if (!res.dimensions_equal(&dim))
+        {
+            res.create(dim);
+        }
+
+        long long num = (long long)(data.get_number_of_elements() / RO);
+        if (num == 0) return;
+
+        std::complex<float>* pRes = res.begin();
+        const std::complex<float>* pData = data.begin();
+        const float* h = &taps[0];
+
+#pragma omp parallel default(none) shared(pRes, pData, h, RO, M, P, num, centerTap) if(num>64)
+        {
+            // the even samples, and the odd samples with P zeros on both sides
+            std::vector< std::complex<float> > even(M), odd(M + 2 * P, std::complex<float>(0));
+
+            long long n;
+
+#pragma omp for
+            for (n = 0; n < num; n++)
+            {
+                const std::complex<float>* x = pData + n*RO;
+                for (size_t m = 0; m < M; m++)
+                {
+                    even[m] = x[2 * m];
+                    odd[P + m] = x[2 * m + 1];
+                }
+
+                hoNDArraySimd::halfband(M, P, centerTap, h, &even[0], &odd[P], pRes + n*M);
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in remove_ro_oversampling_halfband(...) ... ");
+    }
+}
+
+void remove_ro_oversampling_fft(hoNDArray< std::complex<float> >& data, double ratio, hoNDArray< std::complex<float> >& res)
+{
+    try
+    {
+        GADGET_CHECK_THROW(ratio >= 1.0);
+
+        size_t RO = data.get_size(0);
+        size_t dRO = (size_t)(RO / ratio);
+        GADGET_CHECK_THROW(dRO > 0);
+
+        std::vector<size_t> dim;
+        data.get_dimensions(dim);
+        dim[0] = dRO;
+        if (!res.dimensions_equal(&dim))
+        {
+            res.create(dim);
+        }
+
+        size_t num = data.get_number_of_elements() / RO;
+        if (num == 0) return;
+
+        hoNDFFT<float>::instance()->ifft(&data, 0);
+
+        size_t start = (RO - dRO) / 2;
+        const std::complex<float>* pData = data.begin();
+        std::complex<float>* pRes = res.begin();
+
+        for (size_t n = 0; n < num; n++)
+        {
+            memcpy(pRes + n*dRO, pData + n*RO + start, sizeof(std::complex<float>)*dRO);
+        }
+
+        hoNDFFT<float>::instance()->fft(&res, 0);
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in remove_ro_oversampling_fft(...) ... ");
+    }
+}
+
+}
@@ -0,0 +1,37 @@
+
+/** \file   mri_core_ro_oversampling.h
+    \brief  Removal of the readout oversampling of cartesian acquisitions
+
+            The fft version transforms the readouts to image domain, keeps the center pixels and transforms back.
+            The half-band version filters the 2x oversampled readouts with a long half-band lowpass and keeps every
+            other sample; only the odd taps of a half-band filter are nonzero besides the center tap, so the filter is
+            applied as its two polyphase branches: the even samples are scaled by the center tap and the odd samples
+            are filtered with the odd taps. It avoids the two ffts per readout, at the price of a transition band of
+            width of about 4/(number of taps) of the readout bandwidth at the edges of the field of view.
+
+    \author Hui Xue
+*/
+
+#pragma once
+
+#include "mri_core_export.h"
+#include "hoNDArray.h"
+
+namespace Gadgetron {
+
+    /// half-band lowpass for the decimation by 2 of oversampled readouts, a Kaiser windowed sinc of 4*P-1 taps
+    /// taps: the P odd taps h[1], h[3], ..., h[2P-1]; the filter is symmetric and its other even taps are zero
+    /// centerTap: h[0]
+    /// the taps are scaled by sqrt(2), so the results have the scaling of the removal with unitary ffts
+    EXPORTMRICORE void generate_halfband_filter(size_t P, std::vector<float>& taps, float& centerTap, double beta = 8.0);
+
+    /// remove the 2x readout oversampling of data [RO ...] with the half-band filter of generate_halfband_filter
+    /// every line along RO is filtered and decimated by 2, readout samples outside the line are taken as zero
+    /// RO must be even; res: [RO/2 ...]
+    EXPORTMRICORE void remove_ro_oversampling_halfband(const hoNDArray< std::complex<float> >& data, const std::vector<float>& taps, float centerTap, hoNDArray< std::complex<float> >& res);
+
+    /// remove the readout oversampling of data [RO ...] by an inverse fft along RO, keeping the center RO/ratio pixels and a fft
+    /// all lines are transformed together; data is left in image domain
+    /// res: [RO/ratio ...]
+    EXPORTMRICORE void remove_ro_oversampling_fft(hoNDArray< std::complex<float> >& data, double ratio, hoNDArray< std::complex<float> >& res);
+}
@@ -0,0 +1,165 @@
+
+/** \file   mri_core_sense.cpp
+    \brief  SENSE unfolding for 2D and 3D cartesian MRI parallel imaging with uniform undersampling
+    \author Hui Xue
+
+    References to the implementation can be found in:
+
+    Pruessmann KP, Weiger M, Scheidegger MB, Boesiger P.
+    SENSE: Sensitivity encoding for fast MRI.
+    Magnetic Resonance in Medicine 1999;42(5):952-962.
+
+    The zero filled image of a pixel x is I(x) = 1/R * sum_r p_r * S(x_r) * rho(x_r) over its R aliases x_r, x_0 = x,
+    where the phases p_r, p_0 = 1, only depend on the first sampled line. Since the regularised inverse of S*diag(p) is
+    diag(p)' times the one of S, the row of x_0 does not depend on the phases and the unmixing coefficients of all
+    pixels of a group of aliases are the rows of R * inv(S'*S + lamda*I)*S'.
+*/
+
+#include "mri_core_sense.h"
+#include "hoNDArray_batched.h"
+#include "hoNDArrayScratch.h"
+
+#ifdef USE_OMP
+    #include "omp.h"
+#endif // USE_OMP
+
+namespace Gadgetron
+{
+
+template <typename T>
+void sense_unmixing_coeff(const hoNDArray<T>& coilMap, size_t acceFactorE1, size_t acceFactorE2, double thres, hoNDArray<T>& unmixCoeff, hoNDArray< typename realType<T>::Type >& gFactor)
+{
+    try
+    {
+        typedef typename realType<T>::Type value_type;
+
+        size_t RO = coilMap.get_size(0);
+        size_t E1 = coilMap.get_size(1);
+        size_t E2 = coilMap.get_size(2);
+        size_t CHA = coilMap.get_size(3);
+
+        GADGET_CHECK_THROW(acceFactorE1 >= 1);
+        GADGET_CHECK_THROW(acceFactorE2 >= 1);
+        GADGET_CHECK_THROW(E1 % acceFactorE1 == 0);
+        GADGET_CHECK_THROW(E2 % acceFactorE2 == 0);
+
+        std::vector<size_t> dimUnmixing(4);
+        dimUnmixing[0] = RO; dimUnmixing[1] = E1; dimUnmixing[2] = E2; dimUnmixing[3] = CHA;
+        if (!unmixCoeff.dimensions_equal(&dimUnmixing))
+        {
+            unmixCoeff.create(RO, E1, E2, CHA);
+        }
+
+        std::vector<size_t> dimGFactor(3);
+        dimGFactor[0] = RO; dimGFactor[1] = E1; dimGFactor[2] = E2;
+        if (!gFactor.dimensions_equal(&dimGFactor))
+        {
+            gFactor.create(RO, E1, E2);
+        }
+
+        size_t R = acceFactorE1*acceFactorE2;
+        size_t redE1 = E1 / acceFactorE1;
+        size_t redE2 = E2 / acceFactorE2;
+
+        // one group of aliases for every pixel of a reduced E2 plane, the planes are unfolded one after another
+        size_t N = RO*redE1;
+
+        hoNDArrayScratchScope scratch_scope;
+
+        // S [CHA R], S' [R CHA] and S'*S [R R] of every group, the group index is innermost
+        hoNDArray<T> sensitivity, sensitivityH, A;
+        hoNDArrayScratch::instance().create(sensitivity, N*CHA*R);
+        hoNDArrayScratch::instance().create(sensitivityH, N*R*CHA);
+        hoNDArrayScratch::instance().create(A, N*R*R);
+
+        T* pS = sensitivity.begin();
+        T* pSH = sensitivityH.begin();
+        T* pA = A.begin();
+
+        const T* pCoilMap = coilMap.begin();
+        T* pUnmix = unmixCoeff.begin();
+        value_type* pGFactor = gFactor.begin();
+
+        long long c;
+
+        for (size_t e2 = 0; e2 < redE2; e2++)
+        {
+#pragma omp parallel for default(none) private(c) shared(pCoilMap, RO, E1, E2, CHA, R, N, acceFactorE1, redE1, redE2, e2, pS, pSH) if(CHA>4)
+            for (c = 0; c < (long long)CHA; c++)
+            {
+                for (size_t r = 0; r < R; r++)
+                {
+                    size_t aE1 = (r % acceFactorE1)*redE1;
+                    size_t aE2 = e2 + (r / acceFactorE1)*redE2;
+
+                    for (size_t e1 = 0; e1 < redE1; e1++)
+                    {
+                        const T* pC = pCoilMap + RO*(e1 + aE1 + E1*(aE2 + E2*c));
+                        T* pSr = pS + N*(c + CHA*r) + e1*RO;
+                        T* pSHr = pSH + N*(r + R*c) + e1*RO;
+
+                        for (size_t ro = 0; ro < RO; ro++)
+                        {
+                            pSr[ro] = pC[ro];
+                            pSHr[ro] = std::conj(pC[ro]);
+                        }
+                    }
+                }
+            }
+
+            hoNDArrayBatched::gemm(N, R, CHA, R, pSH, false, pS, false, pA);
+
+            // regularization relative to the signal of the group, the background without signal is unfolded to zero
+            for (size_t b = 0; b < N; b++)
+            {
+                value_type trace = 0;
+                for (size_t r = 0; r < R; r++) trace += pA[b + N*(r + R*r)].real();
+
+                value_type lamda = (value_type)thres * trace / R;
+                for (size_t r = 0; r < R; r++) pA[b + N*(r + R*r)] += lamda;
+            }
+
+            // inv(S'*S + lamda*I)*S' replaces S'
+            hoNDArrayBatched::potrf(N, R, pA);
+            hoNDArrayBatched::potrs(N, R, CHA, pA, pSH);
+
+            long long r;
+
+#pragma omp parallel for default(none) private(r) shared(pUnmix, pGFactor, RO, E1, E2, CHA, R, N, acceFactorE1, redE1, redE2, e2, pSH) if(R>1)
+            for (r = 0; r < (long long)R; r++)
+            {
+                size_t aE1 = (r % acceFactorE1)*redE1;
+                size_t aE2 = e2 + (r / acceFactorE1)*redE2;
+
+                for (size_t e1 = 0; e1 < redE1; e1++)
+                {
+                    value_type* pG = pGFactor + RO*(e1 + aE1 + E1*aE2);
+                    for (size_t ro = 0; ro < RO; ro++) pG[ro] = 0;
+
+                    for (size_t cha = 0; cha < CHA; cha++)
+                    {
+                        const T* pX = pSH + N*(r + R*cha) + e1*RO;
+                        T* pU = pUnmix + RO*(e1 + aE1 + E1*(aE2 + E2*cha));
+
+                        for (size_t ro = 0; ro < RO; ro++)
+                        {
+                            pU[ro] = pX[ro] * (value_type)R;
+                            pG[ro] += std::norm(pU[ro]);
+                        }
+                    }
+
+                    for (size_t ro = 0; ro < RO; ro++) pG[ro] = std::sqrt(pG[ro]) / R;
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in sense_unmixing_coeff(const hoNDArray<T>& coilMap, size_t acceFactorE1, size_t acceFactorE2, double thres, hoNDArray<T>& unmixCoeff, hoNDArray<T>& gFactor) ... ");
+    }
+}
+
+template EXPORTMRICORE void sense_unmixing_coeff(const hoNDArray< std::complex<float> >& coilMap, size_t acceFactorE1, size_t acceFactorE2, double thres, hoNDArray< std::complex<float> >& unmixCoeff, hoNDArray<float>& gFactor);
+template EXPORTMRICORE void sense_unmixing_coeff(const hoNDArray< std::complex<double> >& coilMap, size_t acceFactorE1, size_t acceFactorE2, double thres, hoNDArray< std::complex<double> >& unmixCoeff, hoNDArray<double>& gFactor);
+
+}
@@ -0,0 +1,22 @@
+
+/** \file   mri_core_sense.h
+    \brief  SENSE unfolding for 2D and 3D cartesian MRI parallel imaging with uniform undersampling
+    \author Hui Xue
+*/
+
+#pragma once
+
+#include "mri_core_export.h"
+#include "hoNDArray.h"
+
+namespace Gadgetron {
+
+    /// compute image domain unmixing coefficients of a regularised SENSE unfolding from the coil sensitivity
+    /// every pixel is unfolded together with its acceFactorE1*acceFactorE2 - 1 aliases, shifted by E1/acceFactorE1 and E2/acceFactorE2
+    /// the unmixing coefficients are applied to the aliased images the same way as the grappa unmixing coefficients, e.g. with apply_unmix_coeff_aliased_image_3D
+    /// coilMap: [RO E1 E2 CHA] coil sensitivity map, E1 and E2 must be multiples of the acceleration factors
+    /// thres: regularization, relative to the mean of the diagonal of S'*S for every group of aliases
+    /// unmixCoeff: [RO E1 E2 CHA] unmixing coefficient
+    /// gFactor: [RO E1 E2], gfactor
+    template <typename T> EXPORTMRICORE void sense_unmixing_coeff(const hoNDArray<T>& coilMap, size_t acceFactorE1, size_t acceFactorE2, double thres, hoNDArray<T>& unmixCoeff, hoNDArray< typename realType<T>::Type >& gFactor);
+}
@@ -63,7 +63,8 @@ namespace Gadgetron{
 
     template<class Real, unsigned int D>
     void hoNFFT_plan<Real, D>::preprocess(
-        const hoNDArray<typename reald<Real, D>::Type>& k
+        const hoNDArray<typename reald<Real, D>::Type>& k,
+        NFFT_prep_mode mode
     )
     {
         if(k.get_number_of_elements() == 0)
@@ -76,6 +77,15 @@ namespace Gadgetron{
 
         this->k = k;
         initialize();
+        sort_into_tiles();
+        toeplitz_kernel.clear();
+
+        if(mode == NFFT_PREP_SPARSE_MATRIX){
+            compute_sparse_matrices();
+        }else{
+            c2nc_row_start.clear(); c2nc_cols.clear(); c2nc_weights.clear();
+            nc2c_row_start.clear(); nc2c_cols.clear(); nc2c_weights.clear();
+        }
     }
 
     template<class Real, unsigned int D>
@@ -113,7 +123,7 @@ namespace Gadgetron{
                 convolve(d, m, NFFT_CONV_C2NC);
                 
                 if(w.get_number_of_elements() != 0){
-                    if(m.get_number_of_elements() != w.get_number_of_elements())
+                    if(m.get_number_of_elements()%w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     m /= w;
@@ -122,7 +132,7 @@ namespace Gadgetron{
             }
             case NFFT_FORWARDS_NC2C:{
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != d.get_number_of_elements())
+                    if(d.get_number_of_elements()%w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompitalbe dimensions");
 
                     d *= w;
@@ -136,7 +146,7 @@ namespace Gadgetron{
             }
             case NFFT_BACKWARDS_NC2C:{
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != d.get_number_of_elements())
+                    if(d.get_number_of_elements()%w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     d *= w;
@@ -154,7 +164,7 @@ namespace Gadgetron{
                 convolve(d, m, NFFT_CONV_C2NC);
 
                 if(w.get_number_of_elements() != 0){
-                    if(w.get_number_of_elements() != m.get_number_of_elements())
+                    if(m.get_number_of_elements()%w.get_number_of_elements() != 0)
                         throw std::runtime_error("Incompatible dimensions");
 
                     m *= w;
@@ -189,6 +199,122 @@ namespace Gadgetron{
         compute(tmp, out, w, NFFT_FORWARDS_C2NC);
     }
 
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::preprocess_toeplitz(
+        hoNDArray<Real>& w
+    )
+    {
+        const size_t N = k.get_number_of_elements();
+        if(N == 0)
+            throw std::runtime_error("Toeplitz kernel needs a preprocessed trajectory");
+
+        if(w.get_number_of_elements() != 0 && w.get_number_of_elements() != N)
+            throw std::runtime_error("Incompatible dimensions");
+
+        hoNDArray<ComplexType> weights(N);
+        Real sum = 0;
+        for(size_t i = 0; i < N; i++){
+            Real v = (w.get_number_of_elements() != 0) ? w[i] : Real(1);
+            weights[i] = v;
+            sum += v;
+        }
+
+        size_t G[3] = {1, 1, 1}, G2[3] = {1, 1, 1};
+        std::vector<size_t> dims, dims2;
+        typename uint64d<D>::Type n2 = n;
+        for(size_t d = 0; d < D; d++){
+            G[d] = (size_t)(osf*n[d]);
+            G2[d] = 2*G[d];
+            dims.push_back(G[d]);
+            dims2.push_back(G2[d]);
+            n2[d] = 2*n[d];
+        }
+
+        hoNDArray<Real> none((size_t)0);
+
+        // E^H of the weights is c*sum(w) at the image center, with the scale c of this plan
+        hoNDArray<ComplexType> tmp(weights), image(dims);
+        compute(tmp, image, none, NFFT_BACKWARDS_NC2C);
+        ComplexType c = image[G[0]/2+G[0]*((G[1]/2)+G[1]*(G[2]/2))]/sum;
+
+        // point spread function on the 2x grid, normalized to the scale c^H c of E^H E
+        hoNFFT_plan<Real, D> plan2(n2, osf, wg);
+        plan2.preprocess(k);
+        hoNDArray<ComplexType> psf(dims2);
+        tmp = weights;
+        plan2.compute(tmp, psf, none, NFFT_BACKWARDS_NC2C);
+        ComplexType c2 = psf[G2[0]/2+G2[0]*((G2[1]/2)+G2[1]*(G2[2]/2))]/sum;
+        ComplexType scale = std::norm(c)/c2;
+
+        toeplitz_kernel = psf;
+        toeplitz_kernel *= scale;
+
+        // psf is the column of the circulant embedding belonging to the center pixel, and the
+        // centered fft diagonalizes circulant matrices too: the eigenvalues are fft(psf)/fft(delta)
+        hoNDArray<ComplexType> delta(dims2);
+        delta.fill(0);
+        delta[G2[0]/2+G2[0]*((G2[1]/2)+G2[1]*(G2[2]/2))] = 1;
+        fft(toeplitz_kernel, NFFT_FORWARDS);
+        fft(delta, NFFT_FORWARDS);
+        toeplitz_kernel /= delta;
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::mult_MH_M_toeplitz(
+        hoNDArray<complext<Real>> &in,
+        hoNDArray<complext<Real>> &out
+    )
+    {
+        hoNDArray<ComplexType>* pin = reinterpret_cast<hoNDArray<ComplexType>*>(&in);
+        hoNDArray<ComplexType>* pout = reinterpret_cast<hoNDArray<ComplexType>*>(&out);
+
+        this->mult_MH_M_toeplitz(*pin, *pout);
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::mult_MH_M_toeplitz(
+        hoNDArray<ComplexType> &in,
+        hoNDArray<ComplexType> &out
+    )
+    {
+        if(toeplitz_kernel.get_number_of_elements() == 0)
+            throw std::runtime_error("Toeplitz kernel not computed, call preprocess_toeplitz");
+
+        size_t G[3] = {1, 1, 1}, G2[3] = {1, 1, 1};
+        for(size_t d = 0; d < D; d++){
+            G[d] = (size_t)(osf*n[d]);
+            G2[d] = 2*G[d];
+        }
+        const size_t num_image = G[0]*G[1]*G[2];
+
+        if(in.get_number_of_elements() == 0 || in.get_number_of_elements()%num_image != 0)
+            throw std::runtime_error("Incompatible dimensions");
+
+        if(!out.dimensions_equal(&in))
+            out.create(in.get_dimensions());
+
+        hoNDArray<ComplexType> buf(toeplitz_kernel.get_dimensions());
+
+        for(size_t b = 0; b < in.get_number_of_elements()/num_image; b++){
+            const ComplexType* pi = in.get_data_ptr()+b*num_image;
+            ComplexType* po = out.get_data_ptr()+b*num_image;
+
+            // zero pad into the first corner of the 2x grid
+            buf.fill(0);
+            for(size_t z = 0; z < G[2]; z++)
+                for(size_t y = 0; y < G[1]; y++)
+                    std::copy(pi+G[0]*(y+G[1]*z), pi+G[0]*(y+G[1]*z)+G[0], buf.begin()+G2[0]*(y+G2[1]*z));
+
+            fft(buf, NFFT_FORWARDS);
+            buf *= toeplitz_kernel;
+            fft(buf, NFFT_BACKWARDS);
+
+            for(size_t z = 0; z < G[2]; z++)
+                for(size_t y = 0; y < G[1]; y++)
+                    std::copy(buf.begin()+G2[0]*(y+G2[1]*z), buf.begin()+G2[0]*(y+G2[1]*z)+G[0], po+G[0]*(y+G[1]*z));
+        }
+    }
+
     template<class Real, unsigned int D>
     void hoNFFT_plan<Real, D>::convolve(
         hoNDArray<ComplexType> &d,
@@ -196,10 +322,46 @@ namespace Gadgetron{
         NFFT_conv_mode mode
     )
     {
+        if(!c2nc_row_start.empty()){
+            // sparse matrix mode, d is the non cartesian side for NC2C and the grid for C2NC
+            const bool nc2c = (mode == NFFT_CONV_NC2C);
+            const std::vector<size_t>& rows = nc2c ? nc2c_row_start : c2nc_row_start;
+            const std::vector<size_t>& cols = nc2c ? nc2c_cols : c2nc_cols;
+            const std::vector<Real>& w = nc2c ? nc2c_weights : c2nc_weights;
+
+            const long long R = (long long)rows.size()-1;
+            const size_t X = (nc2c ? c2nc_row_start.size() : nc2c_row_start.size())-1;
+            const size_t C = d.get_number_of_elements()/X;
+            if(C == 0 || d.get_number_of_elements() != C*X || m.get_number_of_elements() != C*R)
+                throw std::runtime_error("Incompatible dimensions");
+
+            const ComplexType* px = d.get_data_ptr();
+            ComplexType* pr = m.get_data_ptr();
+
+            // the arrays of a batch share the weights of every row
+#pragma omp parallel if(R > 4096)
+            {
+                std::vector<ComplexType> v(C);
+
+#pragma omp for schedule(static)
+                for(long long r = 0; r < R; r++){
+                    std::fill(v.begin(), v.end(), ComplexType(0));
+                    for(size_t e = rows[r]; e < rows[r+1]; e++)
+                        for(size_t c = 0; c < C; c++)
+                            v[c] += px[c*X+cols[e]]*w[e];
+                    for(size_t c = 0; c < C; c++)
+                        pr[c*R+r] = v[c];
+                }
+            }
+
+            if(nc2c) zero_grid_edges(m);
+            return;
+        }
+
         if(mode == NFFT_CONV_NC2C)
-            convolve_NFFT_NC2C(d, m);
+            (this->*nc2c_convolution)(d, m);
         else
-            convolve_NFFT_C2NC(d, m);
+            (this->*c2nc_convolution)(d, m);
     }
 
     template<class Real, unsigned int D>
@@ -244,13 +406,14 @@ namespace Gadgetron{
         bool fourierDomain
     )
     {
+        // d may hold a batch of grids, da is applied to each of them
         if(fourierDomain){
-            if(da.get_number_of_elements() != d.get_number_of_elements())
+            if(d.get_number_of_elements()%da.get_number_of_elements() != 0)
                 throw std::runtime_error("Incompatiblef deapodization dimensions");
             
             d *= da;
         }else{
-            if(da.get_number_of_elements() != d.get_number_of_elements())
+            if(d.get_number_of_elements()%da.get_number_of_elements() != 0)
                 throw std::runtime_error("Incompatible deapodization dimensions");
 
             d /= da;
@@ -266,15 +429,23 @@ namespace Gadgetron{
         Real tmp = kw*(osf-0.5);
         beta = M_PI*std::sqrt(tmp*tmp-0.8);
 
-        p.create(kosf*kwidth+1);
-        for(size_t i = 0; i < kosf*kwidth+1; i++){
+        // kernel table, kosf samples per grid point, linearly interpolated in sample_weights;
+        // zero from kmax on, with one more zero so that the interpolation never reads past the end
+        const size_t kmax = (size_t)std::floor(kosf*kwidth);
+        p.create(kmax+2);
+        for(size_t i = 0; i <= kmax; i++){
             Real om = Real(i)/Real(kosf*kwidth);
             p[i] = bessi0(beta*std::sqrt(1-om*om));
         }
         Real pConst = p[0];
         for(auto it = p.begin(); it != p.end(); it++)
             *it /= pConst;
-        p[kosf*kwidth] = 0;
+        p[kmax] = 0;
+        p[kmax+1] = 0;
+
+        footprint = 0;
+        for(int l = -kwidth; l < kwidth+1; l++) footprint++;
+        select_convolutions();
         
         // Need to fix to allow for flexibility in dimensions
         hoNDArray<Real> dax(osf*n[0]);
@@ -314,8 +485,8 @@ namespace Gadgetron{
                 da.create(osf*n[0], osf*n[1], osf*n[2]);
                 for(size_t i = 0; i < osf*n[0]; i++)
                     for(size_t j = 0; j < osf*n[1]; j++)
-                        for(size_t k = 0; k < osf*n[3]; k++)
-                            da[i+n[1]*j*osf+n[2]*k*osf] = dax[i]*dax[j]*dax[k];
+                        for(size_t k = 0; k < osf*n[2]; k++)
+                            da[i+(j+k*n[1]*osf)*n[0]*osf] = dax[i]*dax[j]*dax[k];
                 nx.create(k.get_number_of_elements());
                 ny.create(k.get_number_of_elements());
                 nz.create(k.get_number_of_elements());
@@ -331,215 +502,394 @@ namespace Gadgetron{
     }
 
     template<class Real, unsigned int D>
+    template<int FixedL>
     void hoNFFT_plan<Real, D>::convolve_NFFT_C2NC(
         hoNDArray<ComplexType> &m,
         hoNDArray<ComplexType> &d
     )
     {
-        switch(D){
-            case 1:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        Real nxt = std::round(nx[i]+lx);
-                        Real kkx = std::min(
-                            std::round(kosf*std::abs(nx[i]-nxt)),
-                            std::floor(kosf*kwidth)
-                        );
-                        Real kwx = p[kkx];
-                        nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                        d[i] += m[(size_t)nxt]*kwx;
+        // a compile time footprint makes every loop over it a constant trip count
+        const int L = (FixedL > 0) ? FixedL : footprint;
+        const int Ld[3] = {L, (D > 1) ? L : 1, (D > 2) ? L : 1};
+
+        long long G[3] = {1, 1, 1};
+        for(size_t dim = 0; dim < D; dim++)
+            G[dim] = (long long)(osf*n[dim]);
+
+        const long long N = (long long)k.get_number_of_elements();
+        const size_t num_grid = (size_t)(G[0]*G[1]*G[2]);
+        const size_t C = m.get_number_of_elements()/num_grid;
+        if(C == 0 || m.get_number_of_elements() != C*num_grid || d.get_number_of_elements() != C*N)
+            throw std::runtime_error("Incompatible dimensions");
+
+        // a batch of C grids is interpolated with the coil innermost, every kernel weight is
+        // applied to the C values of a grid point in one contiguous loop
+        const ComplexType* pm = m.get_data_ptr();
+        std::vector<ComplexType> interleaved;
+        if(C > 1){
+            interleaved.resize(num_grid*C);
+#pragma omp parallel for schedule(static)
+            for(long long g = 0; g < (long long)num_grid; g++)
+                for(size_t c = 0; c < C; c++)
+                    interleaved[g*C+c] = pm[c*num_grid+g];
+            pm = &interleaved[0];
+        }
+
+        ComplexType* pd = d.get_data_ptr();
+        const size_t C2 = 2*C;
+
+        // every sample only reads the grid, the samples are interpolated in parallel
+#pragma omp parallel if(N > 256)
+        {
+            std::vector<long long> ix(3*L);
+            std::vector<Real> w(3*L);
+            std::vector<Real> acc(C2);
+
+#pragma omp for schedule(static)
+            for(long long i = 0; i < N; i++){
+                sample_weights<FixedL>(i, L, &ix[0], &w[0]);
+                std::fill(acc.begin(), acc.end(), Real(0));
+
+                // x innermost, so that every row of the kernel footprint is read in order
+                for(int jz = 0; jz < Ld[2]; jz++){
+                    for(int jy = 0; jy < Ld[1]; jy++){
+                        const Real wyz = w[L+jy]*w[2*L+jz];
+                        const ComplexType* row = pm+C*G[0]*(ix[L+jy]+G[1]*ix[2*L+jz]);
+                        for(int jx = 0; jx < Ld[0]; jx++){
+                            const Real wx = w[jx]*wyz;
+                            const Real* g = reinterpret_cast<const Real*>(row+C*ix[jx]);
+                            for(size_t c = 0; c < C2; c++)
+                                acc[c] += g[c]*wx;
+                        }
                     }
                 }
-                break;                
+                for(size_t c = 0; c < C; c++)
+                    pd[c*N+i] = ComplexType(acc[2*c], acc[2*c+1]);
             }
-            case 2:{
-                d.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            Real nxt = std::round(nx[i]+lx);
-                            Real nyt = std::round(ny[i]+ly);
-
-                            Real kkx = std::min(
-                                std::round(kosf*std::abs(nx[i]-nxt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kky = std::min(
-                                std::round(kosf*std::abs(ny[i]-nyt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kwx = p[kkx]; Real kwy = p[kky];
-
-                            nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                            nyt = std::max(nyt, Real(0)); nyt = std::min(nyt, osf*n[1]-1);
-
-                            d[i] += m[(size_t)(nxt+nyt*osf*n[1])]*kwx*kwy;
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::select_convolutions()
+    {
+        // the footprints of the kernel widths 3, 4, 5, 6 and 8, any other footprint takes the generic loops
+        switch(footprint){
+            case 4:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<4>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<4>;
+                break;
+            case 5:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<5>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<5>;
+                break;
+            case 6:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<6>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<6>;
+                break;
+            case 7:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<7>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<7>;
+                break;
+            case 9:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<9>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<9>;
+                break;
+            default:
+                c2nc_convolution = &hoNFFT_plan::convolve_NFFT_C2NC<0>;
+                nc2c_convolution = &hoNFFT_plan::convolve_NFFT_NC2C<0>;
+                break;
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::sort_into_tiles()
+    {
+        // kernel offsets reach floor(kwidth)+1 grid points from the nearest grid point of a sample
+        tile_halo = (size_t)std::ceil(kwidth)+2;
+        tile_size = std::max((D == 1) ? size_t(1024) : ((D == 2) ? size_t(32) : size_t(16)), 2*tile_halo);
+
+        size_t num_all_tiles = 1;
+        for(size_t d = 0; d < D; d++){
+            size_t g = (size_t)(osf*n[d]);
+            num_tiles[d] = (g+tile_size-1)/tile_size;
+            num_all_tiles *= num_tiles[d];
+        }
+
+        const size_t N = k.get_number_of_elements();
+        std::vector<size_t> tile_of_sample(N);
+        for(size_t i = 0; i < N; i++){
+            Real c[3] = {nx[i], (D > 1) ? ny[i] : Real(0), (D > 2) ? nz[i] : Real(0)};
+            size_t t = 0;
+            for(int d = D-1; d >= 0; d--){
+                Real g = std::round(c[d]);
+                g = std::max(g, Real(0)); g = std::min(g, osf*n[d]-1);
+                t = t*num_tiles[d]+(size_t)g/tile_size;
+            }
+            tile_of_sample[i] = t;
+        }
+
+        // counting sort, the samples of a tile stay in acquisition order
+        tile_start.assign(num_all_tiles+1, 0);
+        for(size_t i = 0; i < N; i++)
+            tile_start[tile_of_sample[i]+1]++;
+        for(size_t t = 0; t < num_all_tiles; t++)
+            tile_start[t+1] += tile_start[t];
+
+        tile_samples.resize(N);
+        std::vector<size_t> pos(tile_start.begin(), tile_start.end()-1);
+        for(size_t i = 0; i < N; i++)
+            tile_samples[pos[tile_of_sample[i]]++] = i;
+    }
+
+    template<class Real, unsigned int D>
+    template<int FixedL>
+    void hoNFFT_plan<Real, D>::sample_weights(size_t i, int L, long long* ix, Real* w)
+    {
+        if(FixedL > 0) L = FixedL;
+        const Real kmax = std::floor(kosf*kwidth);
+        const int l0 = -kwidth;
+        const Real* pk = p.get_data_ptr();
+        Real c[3] = {nx[i], (D > 1) ? ny[i] : Real(0), (D > 2) ? nz[i] : Real(0)};
+
+        for(size_t dim = 0; dim < D; dim++){
+            // nearest grid point, floor(c+0.5) without a call into libm
+            long long r = (long long)(c[dim]+Real(0.5));
+            if(Real(r) > c[dim]+Real(0.5)) r--;
+
+            const long long first = r+l0;
+            const long long last = (long long)(osf*n[dim])-1;
+
+            // one pass over the L grid points without branches or calls, the weights are
+            // interpolated between the two nearest table entries
+            Real* wd = w+dim*L;
+            long long* id = ix+dim*L;
+            for(int j = 0; j < L; j++){
+                long long pt = first+j;
+                Real kk = std::min(kosf*std::abs(c[dim]-Real(pt)), kmax);
+                size_t k0 = (size_t)kk;
+                Real t = kk-Real(k0);
+                wd[j] = pk[k0]+t*(pk[k0+1]-pk[k0]);
+                id[j] = std::min(std::max(pt, 0LL), last);
+            }
+        }
+        for(size_t dim = D; dim < 3; dim++){
+            w[dim*L] = Real(1);
+            ix[dim*L] = 0;
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::compute_sparse_matrices()
+    {
+        const int L = footprint;
+        const int Ld[3] = {L, (D > 1) ? L : 1, (D > 2) ? L : 1};
+
+        long long G[3] = {1, 1, 1};
+        for(size_t dim = 0; dim < D; dim++)
+            G[dim] = (long long)(osf*n[dim]);
+
+        const size_t N = k.get_number_of_elements();
+        const size_t E = (size_t)Ld[0]*Ld[1]*Ld[2];
+        const size_t num_grid = (size_t)(G[0]*G[1]*G[2]);
+
+        c2nc_row_start.resize(N+1);
+        for(size_t i = 0; i <= N; i++)
+            c2nc_row_start[i] = i*E;
+        c2nc_cols.resize(N*E);
+        c2nc_weights.resize(N*E);
+
+#pragma omp parallel
+        {
+            std::vector<long long> ix(3*L);
+            std::vector<Real> w(3*L);
+
+#pragma omp for schedule(static)
+            for(long long i = 0; i < (long long)N; i++){
+                sample_weights<0>(i, L, &ix[0], &w[0]);
+
+                size_t e = i*E;
+                for(int jx = 0; jx < Ld[0]; jx++){
+                    for(int jy = 0; jy < Ld[1]; jy++){
+                        for(int jz = 0; jz < Ld[2]; jz++){
+                            c2nc_cols[e] = ix[jx]+G[0]*(ix[L+jy]+G[1]*ix[2*L+jz]);
+                            c2nc_weights[e] = w[jx]*w[L+jy]*w[2*L+jz];
+                            e++;
                         }
                     }
                 }
-                break;
             }
-            case 3:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            for(int lz = -kwidth; lz = kwidth+1; lz++){
-                                Real nxt = std::round(nx[i]+lx);
-                                Real nyt = std::round(ny[i]+ly);
-                                Real nzt = std::round(nz[i]+lz);
-
-                                Real kkx = std::min(
-                                    std::round(kosf*std::abs(nx[i]-nxt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kky = std::min(
-                                    std::round(kosf*std::abs(ny[i]-nyt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kkz = std::min(
-                                    std::round(kosf*std::abs(nz[i]-nzt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kwx = p[kkx];
-                                Real kwy = p[kky];
-                                Real kwz = p[kkz];
-
-                                nxt = std::max(nxt, Real(0));
-                                nxt = std::min(nxt, osf*n[0]-1);
-
-                                nyt = std::max(nxt, Real(0));
-                                nyt = std::min(nyt, osf*n[1]-1);
-
-                                nzt = std::max(nzt, Real(0));
-                                nzt = std::min(nzt, osf*n[2]-1);
-
-                                d[i] += m[(size_t)(nxt+nyt*osf*n[1]+nzt*osf*n[2])]*kwx*kwy*kwz;
-                            }
-                        }
+        }
+
+        // transpose by a counting sort on the grid points, the samples of a row stay in order
+        nc2c_row_start.assign(num_grid+1, 0);
+        for(size_t e = 0; e < N*E; e++)
+            nc2c_row_start[c2nc_cols[e]+1]++;
+        for(size_t g = 0; g < num_grid; g++)
+            nc2c_row_start[g+1] += nc2c_row_start[g];
+
+        nc2c_cols.resize(N*E);
+        nc2c_weights.resize(N*E);
+        std::vector<size_t> pos(nc2c_row_start.begin(), nc2c_row_start.end()-1);
+        for(size_t i = 0; i < N; i++){
+            for(size_t e = i*E; e < (i+1)*E; e++){
+                size_t t = pos[c2nc_cols[e]]++;
+                nc2c_cols[t] = i;
+                nc2c_weights[t] = c2nc_weights[e];
+            }
+        }
+    }
+
+    template<class Real, unsigned int D>
+    void hoNFFT_plan<Real, D>::zero_grid_edges(hoNDArray<ComplexType> &m)
+    {
+        size_t num_grid = 1;
+        for(size_t d = 0; d < D; d++)
+            num_grid *= (size_t)(osf*n[d]);
+
+        for(size_t b = 0; b < m.get_number_of_elements()/num_grid; b++){
+            ComplexType* pm = m.get_data_ptr()+b*num_grid;
+            switch(D){
+                case 1:{
+                    pm[0] = 0;
+                    pm[num_grid-1] = 0;
+                    break;
+                }
+                case 2:
+                case 3:{
+                    for(size_t i = 0; i < n[0]*osf; i++){
+                        pm[i] = 0;
+                        pm[(size_t)(n[0]*osf)+i] = 0;
+                        pm[(size_t)(n[0]*osf*(n[0]*osf-1))+i] = 0;
+                        pm[(size_t)(n[0]*osf*i)+(size_t)(n[0]*osf-1)] = 0;
                     }
+                    break;
                 }
-                break;    
             }
         }
     }
 
     template<class Real, unsigned int D>
+    template<int FixedL>
     void hoNFFT_plan<Real, D>::convolve_NFFT_NC2C(
         hoNDArray<ComplexType> &d,
         hoNDArray<ComplexType> &m
     )
     {
-        switch(D){
-            case 1:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        Real nxt = std::round(nx[i]+lx);
-                        Real kkx = std::min(
-                            std::round(kosf*std::abs(nx[i]-nxt)),
-                            std::floor(kosf*kwidth)
-                        );
-                        Real kwx = p[kkx];
-                        nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                        m[(size_t)nxt] += dw*kwx;
+        m.fill(0);
+
+        // grid, tile and tile buffer sizes, unused dimensions have size 1
+        long long G[3] = {1, 1, 1};
+        long long T[3] = {1, 1, 1};
+        long long B[3] = {1, 1, 1};
+        size_t nt[3] = {1, 1, 1};
+        for(size_t i = 0; i < D; i++){
+            G[i] = (long long)(osf*n[i]);
+            T[i] = (long long)tile_size;
+            B[i] = (long long)(tile_size+2*tile_halo);
+            nt[i] = num_tiles[i];
+        }
+        const long long h = (long long)tile_halo;
+
+        const int L = (FixedL > 0) ? FixedL : footprint;
+        const int Ld[3] = {L, (D > 1) ? L : 1, (D > 2) ? L : 1};
+
+        const size_t N = k.get_number_of_elements();
+        const size_t num_grid = (size_t)(G[0]*G[1]*G[2]);
+        const size_t C = d.get_number_of_elements()/N;
+        if(C == 0 || d.get_number_of_elements() != C*N || m.get_number_of_elements() != C*num_grid)
+            throw std::runtime_error("Incompatible dimensions");
+
+        // a batch of C arrays is gridded with the coil innermost, in the samples and in the tile
+        // buffers, so every kernel weight is computed once and applied to the C values in one loop
+        const ComplexType* pd = d.get_data_ptr();
+        std::vector<ComplexType> interleaved;
+        if(C > 1){
+            interleaved.resize(N*C);
+#pragma omp parallel for schedule(static)
+            for(long long i = 0; i < (long long)N; i++)
+                for(size_t c = 0; c < C; c++)
+                    interleaved[i*C+c] = pd[c*N+i];
+            pd = &interleaved[0];
+        }
+        const size_t C2 = 2*C;
+
+        ComplexType* pm = m.get_data_ptr();
+
+        // tiles of equal parity in every dimension are at least 2*tile_halo apart, their buffers
+        // are added to m concurrently; the parity classes are merged one after the other
+        for(size_t parity = 0; parity < (size_t(1) << D); parity++){
+            std::vector<size_t> tiles;
+            for(size_t tz = 0; tz < nt[2]; tz++)
+                for(size_t ty = 0; ty < nt[1]; ty++)
+                    for(size_t tx = 0; tx < nt[0]; tx++){
+                        size_t c = (tx & 1) | ((ty & 1) << 1) | ((tz & 1) << 2);
+                        size_t t = tx+nt[0]*(ty+nt[1]*tz);
+                        if(c == parity && tile_start[t+1] > tile_start[t])
+                            tiles.push_back(t);
                     }
-                }
 
-                m[0] = 0;
-                m[m.get_number_of_elements()] = 0;
-                break;
-            }
-            case 2:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            Real nxt = std::round(nx[i]+lx);
-                            Real nyt = std::round(ny[i]+ly);
-
-                            Real kkx = std::min(
-                                std::round(kosf*std::abs(nx[i]-nxt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kky = std::min(
-                                std::round(kosf*std::abs(ny[i]-nyt)),
-                                std::floor(kosf*kwidth)
-                            );
-                            Real kwx = p[kkx]; Real kwy = p[kky];
-
-                            nxt = std::max(nxt, Real(0)); nxt = std::min(nxt, osf*n[0]-1);
-                            nyt = std::max(nyt, Real(0)); nyt = std::min(nyt, osf*n[1]-1);
-
-                            m[(size_t)(nxt+nyt*osf*n[1])] += dw*kwx*kwy;
+            long long num = (long long)tiles.size();
+
+#pragma omp parallel if(num > 1)
+            {
+                std::vector<ComplexType> buf(B[0]*B[1]*B[2]*C);
+                std::vector<long long> ix(3*L);
+                std::vector<Real> w(3*L);
+
+#pragma omp for schedule(dynamic)
+                for(long long it = 0; it < num; it++){
+                    size_t t = tiles[it];
+                    long long o[3];
+                    o[0] = (long long)(t%nt[0])*T[0]-((D > 0) ? h : 0);
+                    o[1] = (long long)((t/nt[0])%nt[1])*T[1]-((D > 1) ? h : 0);
+                    o[2] = (long long)(t/(nt[0]*nt[1]))*T[2]-((D > 2) ? h : 0);
+
+                    std::fill(buf.begin(), buf.end(), ComplexType(0));
+
+                    for(size_t s = tile_start[t]; s < tile_start[t+1]; s++){
+                        size_t i = tile_samples[s];
+                        const Real* ds = reinterpret_cast<const Real*>(pd+i*C);
+
+                        // buffer positions and kernel weights along every dimension
+                        sample_weights<FixedL>(i, L, &ix[0], &w[0]);
+                        for(size_t dim = 0; dim < 3; dim++)
+                            for(int j = 0; j < Ld[dim]; j++)
+                                ix[dim*L+j] -= o[dim];
+
+                        for(int jz = 0; jz < Ld[2]; jz++){
+                            for(int jy = 0; jy < Ld[1]; jy++){
+                                const Real wyz = w[L+jy]*w[2*L+jz];
+                                ComplexType* row = &buf[C*B[0]*(ix[L+jy]+B[1]*ix[2*L+jz])];
+                                for(int jx = 0; jx < Ld[0]; jx++){
+                                    const Real wt = w[jx]*wyz;
+                                    Real* g = reinterpret_cast<Real*>(row+C*ix[jx]);
+                                    for(size_t c = 0; c < C2; c++)
+                                        g[c] += ds[c]*wt;
+                                }
+                            }
                         }
                     }
 
-                    for(size_t i = 0; i < n[0]*osf; i++){
-                        m[i] = 0;
-                        m[n[0]*osf+i] = 0;
-                        m[n[0]*osf*(n[0]*osf-1)+i] = 0;
-                        m[n[0]*osf*i+(n[0]*osf-1)] = 0;
+                    // add the part of the buffer inside the grid to m
+                    long long lo[3], hi[3];
+                    for(size_t dim = 0; dim < 3; dim++){
+                        lo[dim] = std::max(o[dim], 0LL);
+                        hi[dim] = std::min(o[dim]+B[dim], G[dim]);
                     }
-                }
-                break;
-            }
-            case 3:{
-                m.fill(0);
-                for(size_t i = 0; i < k.get_number_of_elements(); i++){
-                    ComplexType dw = d[i];
-                    for(int lx = -kwidth; lx < kwidth+1; lx++){
-                        for(int ly = -kwidth; ly < kwidth+1; ly++){
-                            for(int lz = -kwidth; lz = kwidth+1; lz++){
-                                Real nxt = std::round(nx[i]+lx);
-                                Real nyt = std::round(ny[i]+ly);
-                                Real nzt = std::round(nz[i]+lz);
-
-                                Real kkx = std::min(
-                                    std::round(kosf*std::abs(nx[i]-nxt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kky = std::min(
-                                    std::round(kosf*std::abs(ny[i]-nyt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kkz = std::min(
-                                    std::round(kosf*std::abs(nz[i]-nzt)),
-                                    std::floor(kosf*kwidth)
-                                );
-                                Real kwx = p[kkx];
-                                Real kwy = p[kky];
-                                Real kwz = p[kkz];
-
-                                nxt = std::max(nxt, Real(0));
-                                nxt = std::min(nxt, osf*n[0]-1);
-
-                                nyt = std::max(nxt, Real(0));
-                                nyt = std::min(nyt, osf*n[1]-1);
-
-                                nzt = std::max(nzt, Real(0));
-                                nzt = std::min(nzt, osf*n[2]-1);
-
-                                m[(size_t)(nxt+nyt*osf*n[1]+nzt*osf*n[2])] +=
-                                    dw*kwx*kwy*kwz;
-                            }
+                    for(long long z = lo[2]; z < hi[2]; z++){
+                        for(long long y = lo[1]; y < hi[1]; y++){
+                            const ComplexType* pb = &buf[C*((lo[0]-o[0])+B[0]*((y-o[1])+B[1]*(z-o[2])))];
+                            ComplexType* pr = pm+lo[0]+G[0]*(y+G[1]*z);
+                            for(long long x = lo[0]; x < hi[0]; x++, pr++)
+                                for(size_t c = 0; c < C; c++)
+                                    pr[c*num_grid] += *pb++;
                         }
                     }
                 }
-
-                for(size_t i = 0; i < n[0]*osf; i++){
-                    m[i] = 0;
-                    m[n[0]*osf+i] = 0;
-                    m[n[0]*osf*(n[0]*osf-1)+i] = 0;
-                    m[n[0]*osf*i+(n[0]*osf-1)] = 0;
-                    // Need to add two more
-                }
-                break;
             }
         }
+
+        zero_grid_edges(m);
     }
 
     template<class Real, unsigned int D>
@@ -14,6 +14,7 @@
 #include "vector_td.h"
 #include "complext.h"
 #include <complex>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -68,15 +69,34 @@ namespace Gadgetron{
 
             ~hoNFFT_plan();
 
+            /**
+                Enum defining the preprocessing mode
+            */
+
+            enum NFFT_prep_mode{
+                NFFT_PREP_CONVOLVE, /** evaluate the kernel weights in every convolution */
+                NFFT_PREP_SPARSE_MATRIX /** precompute the convolutions as sparse matrices */
+            };
+
             /** 
                 Perform NFFT preprocessing for a given trajectory
 
+                The samples are also sorted into square (cubic in 3D) tiles of the oversampled grid
+                here, the NC2C convolution then grids the tiles in parallel, see convolve_NFFT_NC2C.
+
                 \param k: the NFFT non cartesian trajectory
                 \param mode: enum specifying the preprocessing mode
+
+                With NFFT_PREP_SPARSE_MATRIX the C2NC convolution is built once as a CSR matrix with a
+                row per sample, and the NC2C convolution as its transpose with a row per grid point.
+                Both are then applied by a parallel sparse matrix vector product, which is faster for
+                iterative reconstructions on a fixed trajectory at the cost of (2*ceil(kwidth)+1)^D
+                weights and indices per sample, held twice.
             */
 
             void preprocess(
-                const hoNDArray<typename reald<Real, D>::Type>& k
+                const hoNDArray<typename reald<Real, D>::Type>& k,
+                NFFT_prep_mode mode = NFFT_PREP_CONVOLVE
             );
 
             /**
@@ -98,6 +118,12 @@ namespace Gadgetron{
                 \param w: optional density compensation if not iterative 
                     provide a 0x0 if non density compensation
                 \param mode: enum specifyiing the mode of operation
+
+                d and m may hold a batch of arrays after their first dimensions, e.g. the coils
+                of a multi-channel acquisition as [samples CHA] and [grid CHA]. The batch is
+                gridded in one pass over the trajectory, every kernel weight is computed once
+                for all arrays, and the grids are transformed with one batched FFT. w is
+                applied to every array of the batch.
             */
 
             void compute(
@@ -132,6 +158,38 @@ namespace Gadgetron{
                 hoNDArray<complext<Real>> &out
             );
 
+            /**
+                Precompute the Toeplitz kernel of the normal operator E^H W E, with E^H the
+                NFFT_BACKWARDS_NC2C of this plan and W the density weights. The point spread function
+                is gridded once on a twice as large grid and its circulant embedding transformed, so
+                mult_MH_M_toeplitz costs two FFTs of the 2x grid and a pointwise multiply.
+
+                \param w: density compensation weights, a 0x0 array for none
+
+                Note: preprocess has to be called first
+            */
+
+            void preprocess_toeplitz(
+                hoNDArray<Real>& w
+            );
+
+            /**
+                Apply the normal operator with the Toeplitz kernel of preprocess_toeplitz
+
+                \param in: images on the (oversampled) grid of compute, more than one is allowed
+                \param out: E^H W E in, created with the dimensions of in if needed
+            */
+
+            void mult_MH_M_toeplitz(
+                hoNDArray<ComplexType> &in,
+                hoNDArray<ComplexType> &out
+            );
+
+            void mult_MH_M_toeplitz(
+                hoNDArray<complext<Real>> &in,
+                hoNDArray<complext<Real>> &out
+            );
+
         /**
             Utilities
         */
@@ -206,19 +264,71 @@ namespace Gadgetron{
 
             void initialize();
 
+            /**
+                Sort the samples by the grid tile of their nearest grid point
+            */
+
+            void sort_into_tiles();
+
+            /**
+                Build the CSR matrices of NFFT_PREP_SPARSE_MATRIX
+            */
+
+            void compute_sparse_matrices();
+
+            /**
+                Pick the convolutions for the kernel footprint, see convolve_NFFT_C2NC
+            */
+
+            void select_convolutions();
+
+            /**
+                Kernel weights and grid points of sample i along every dimension, L of each.
+                The weights are linearly interpolated in the kernel table p. FixedL > 0 replaces L.
+
+                \param i: the sample
+                \param ix: grid coordinates, ix[dim*L+j]
+                \param w: kernel weights, w[dim*L+j]
+            */
+
+            template<int FixedL>
+            void sample_weights(size_t i, int L, long long* ix, Real* w);
+
+            /**
+                Zero the edges of the gridded matrix after a NC2C convolution
+            */
+
+            void zero_grid_edges(hoNDArray<ComplexType> &m);
+
             /**
                 Dedicated convolutions
 
                 The two methods below are entirely symmetric in 
                 thier implementation. They could probably be
                 combined for conciseness.
+
+                Both are templates on the footprint L = 2*floor(kwidth)+2 (2*kwidth+1 for an integer
+                kwidth), so that the loops over it have a constant trip count and are unrolled. The
+                footprints 4, 5, 6, 7 and 9 of the kernel widths 3, 4, 5, 6 and 8 are instantiated,
+                FixedL = 0 takes the footprint at run time for all others. preprocess selects
+                the instantiation once, see select_convolutions.
             */
 
+            template<int FixedL>
             void convolve_NFFT_C2NC(
                 hoNDArray<ComplexType> &d,
                 hoNDArray<ComplexType> &m
             );
 
+            /**
+                The NC2C convolution is tiled: every thread grids the samples of one tile into a
+                private copy of the tile and its halo of kernel width, which is then added to m.
+                Tiles are at least twice the halo in size, so the tiles of one of the 2^D parity
+                classes never overlap and are merged without locks, one class after the other.
+                The result does not depend on the number of threads.
+            */
+
+            template<int FixedL>
             void convolve_NFFT_NC2C(
                 hoNDArray<ComplexType> &d,
                 hoNDArray<ComplexType> &m
@@ -246,6 +356,26 @@ namespace Gadgetron{
 
             hoNDArray<typename reald<Real, D>::Type> k;
 
+            // grid points of the kernel along a dimension, and the convolutions instantiated for it
+            int footprint;
+            typedef void (hoNFFT_plan::*Convolution)(hoNDArray<ComplexType>&, hoNDArray<ComplexType>&);
+            Convolution c2nc_convolution, nc2c_convolution;
+
+            // grid tiles of the NC2C convolution: tile_size points per dimension, plus tile_halo on each side
+            size_t tile_size, tile_halo;
+            size_t num_tiles[D];
+
+            // the samples of tile t are tile_samples[tile_start[t]] .. tile_samples[tile_start[t+1]-1]
+            std::vector<size_t> tile_start, tile_samples;
+
+            // CSR matrices of NFFT_PREP_SPARSE_MATRIX, empty otherwise; C2NC has a row per sample,
+            // NC2C is its transpose with a row per grid point
+            std::vector<size_t> c2nc_row_start, c2nc_cols, nc2c_row_start, nc2c_cols;
+            std::vector<Real> c2nc_weights, nc2c_weights;
+
+            // spectrum of the circulant embedded point spread function on the 2x grid, see preprocess_toeplitz
+            hoNDArray<ComplexType> toeplitz_kernel;
+
     };
 
 }
@@ -26,10 +26,10 @@
 template<class REAL, unsigned int D> static __inline__ __device__ void
 NFFT_iterate_body( typename reald<REAL,D>::Type alpha, typename reald<REAL,D>::Type beta, 
 		   REAL W, vector_td<unsigned int, D> matrix_size_os, 
-		   unsigned int number_of_batches, const complext<REAL> * __restrict__ samples,  complext<REAL> * __restrict__ image,
+		   unsigned int number_of_batches, complext<REAL> * __restrict__ image,
 		   unsigned int double_warp_size_power, REAL half_W, REAL one_over_W, vector_td<REAL,D> matrix_size_os_real, 
 		   unsigned int frame, unsigned int num_frames,
-		   unsigned int num_samples_per_batch, unsigned int sample_idx_in_batch, 
+		   unsigned int sharedMemFirstSampleIdx, 
 		   vector_td<REAL,D> sample_position, vector_td<int,D> grid_position )
 {
   // Calculate the distance between current sample and the grid cell
@@ -51,10 +51,14 @@ NFFT_iterate_body( typename reald<REAL,D>::Type alpha, typename reald<REAL,D>::T
   // Resolve wrapping of grid position
   resolve_wrap<D>( grid_position, matrix_size_os );
 
+  REAL *shared_mem = (REAL*) _shared_mem;
+
   for( unsigned int batch=0; batch<number_of_batches; batch++ ){
 
-    // Read the grid sample value from global memory
-    complext<REAL> sample_value = samples[sample_idx_in_batch+batch*num_samples_per_batch];
+    // Read the sample value staged in shared memory
+    complext<REAL> sample_value;
+    sample_value.vec[0] = shared_mem[sharedMemFirstSampleIdx+(batch<<double_warp_size_power)];
+    sample_value.vec[1] = shared_mem[sharedMemFirstSampleIdx+(batch<<double_warp_size_power)+warpSize];
     
     // Determine the grid cell idx
     unsigned int grid_idx = 
@@ -73,11 +77,11 @@ NFFT_iterate_body( typename reald<REAL,D>::Type alpha, typename reald<REAL,D>::T
 template<class REAL> __inline__ __device__ void
 NFFT_iterate( typename reald<REAL,1>::Type alpha, typename reald<REAL,1>::Type beta, 
 	      REAL W, vector_td<unsigned int,1> matrix_size_os, 
-	      unsigned int number_of_batches, const complext<REAL> * __restrict__ samples, complext<REAL> * __restrict__ image,
+	      unsigned int number_of_batches, complext<REAL> * __restrict__ image,
 	      unsigned int double_warp_size_power, REAL half_W, REAL one_over_W, 
 	      vector_td<REAL,1> matrix_size_os_real, 
 	      unsigned int frame, unsigned int num_frames, 
-	      unsigned int num_samples_per_batch, unsigned int sample_idx_in_batch, 
+	      unsigned int sharedMemFirstSampleIdx, 
 	      vector_td<REAL,1> sample_position, vector_td<int,1> lower_limit, vector_td<int,1> upper_limit )
 {
   // Iterate through all grid cells influencing the corresponding sample
@@ -85,9 +89,9 @@ NFFT_iterate( typename reald<REAL,1>::Type alpha, typename reald<REAL,1>::Type b
     
     const intd<1>::Type grid_position(x);
     
-    NFFT_iterate_body<REAL,1>( alpha, beta, W, matrix_size_os, number_of_batches, samples, image, double_warp_size_power, 
+    NFFT_iterate_body<REAL,1>( alpha, beta, W, matrix_size_os, number_of_batches, image, double_warp_size_power, 
 			       half_W, one_over_W, matrix_size_os_real, frame, num_frames,
-			       num_samples_per_batch, sample_idx_in_batch, sample_position, grid_position );
+			       sharedMemFirstSampleIdx, sample_position, grid_position );
   }
 }
 
@@ -98,11 +102,11 @@ NFFT_iterate( typename reald<REAL,1>::Type alpha, typename reald<REAL,1>::Type b
 template<class REAL> __inline__ __device__ void
 NFFT_iterate( typename reald<REAL,2>::Type alpha, typename reald<REAL,2>::Type beta, 
 	      REAL W, vector_td<unsigned int,2> matrix_size_os, 
-	      unsigned int number_of_batches, const complext<REAL> * __restrict__ samples, complext<REAL> * __restrict__ image,
+	      unsigned int number_of_batches, complext<REAL> * __restrict__ image,
 	      unsigned int double_warp_size_power, REAL half_W, REAL one_over_W, 
 	      vector_td<REAL,2> matrix_size_os_real, 
 	      unsigned int frame, unsigned int num_frames, 
-	      unsigned int num_samples_per_batch, unsigned int sample_idx_in_batch, 
+	      unsigned int sharedMemFirstSampleIdx, 
 	      vector_td<REAL,2> sample_position, vector_td<int,2> lower_limit, vector_td<int,2> upper_limit )
 {
   // Iterate through all grid cells influencing the corresponding sample
@@ -111,9 +115,9 @@ NFFT_iterate( typename reald<REAL,2>::Type alpha, typename reald<REAL,2>::Type b
       
       const intd<2>::Type grid_position(x,y);
       
-      NFFT_iterate_body<REAL,2>( alpha, beta, W, matrix_size_os, number_of_batches, samples, image, double_warp_size_power, 
+      NFFT_iterate_body<REAL,2>( alpha, beta, W, matrix_size_os, number_of_batches, image, double_warp_size_power, 
 				 half_W, one_over_W, matrix_size_os_real, frame, num_frames,
-				 num_samples_per_batch, sample_idx_in_batch, sample_position, grid_position );
+				 sharedMemFirstSampleIdx, sample_position, grid_position );
     }
   }
 }
@@ -125,11 +129,11 @@ NFFT_iterate( typename reald<REAL,2>::Type alpha, typename reald<REAL,2>::Type b
 template<class REAL> __inline__ __device__ void
 NFFT_iterate( typename reald<REAL,3>::Type alpha, typename reald<REAL,3>::Type beta, 
 	      REAL W, vector_td<unsigned int,3> matrix_size_os, 
-	      unsigned int number_of_batches, const complext<REAL> * __restrict__ samples, complext<REAL> * __restrict__ image,
+	      unsigned int number_of_batches, complext<REAL> * __restrict__ image,
 	      unsigned int double_warp_size_power, REAL half_W, REAL one_over_W, 
 	      vector_td<REAL,3> matrix_size_os_real, 
 	      unsigned int frame, unsigned int num_frames, 	      
-	      unsigned int num_samples_per_batch, unsigned int sample_idx_in_batch, 
+	      unsigned int sharedMemFirstSampleIdx, 
 	      vector_td<REAL,3> sample_position, vector_td<int,3> lower_limit, vector_td<int,3> upper_limit )
 {
   // Iterate through all grid cells influencing the corresponding sample
@@ -139,9 +143,9 @@ NFFT_iterate( typename reald<REAL,3>::Type alpha, typename reald<REAL,3>::Type b
 	
 	const intd<3>::Type grid_position(x,y,z);
 	
-	NFFT_iterate_body<REAL,3>( alpha, beta, W, matrix_size_os, number_of_batches, samples, image, double_warp_size_power, 
+	NFFT_iterate_body<REAL,3>( alpha, beta, W, matrix_size_os, number_of_batches, image, double_warp_size_power, 
 				   half_W, one_over_W, matrix_size_os_real, frame, num_frames,
-				   num_samples_per_batch, sample_idx_in_batch, sample_position, grid_position );
+				   sharedMemFirstSampleIdx, sample_position, grid_position );
       }
     }
   }
@@ -154,11 +158,11 @@ NFFT_iterate( typename reald<REAL,3>::Type alpha, typename reald<REAL,3>::Type b
 template<class REAL> __inline__ __device__ void
 NFFT_iterate( typename reald<REAL,4>::Type alpha, typename reald<REAL,4>::Type beta, 
 	      REAL W, vector_td<unsigned int,4> matrix_size_os, 
-	      unsigned int number_of_batches, const complext<REAL> * __restrict__ samples, complext<REAL> * __restrict image,
+	      unsigned int number_of_batches, complext<REAL> * __restrict image,
 	      unsigned int double_warp_size_power, REAL half_W, REAL one_over_W,
 	      vector_td<REAL,4> matrix_size_os_real, 
 	      unsigned int frame, unsigned int num_frames, 
-	      unsigned int num_samples_per_batch, unsigned int sample_idx_in_batch, 
+	      unsigned int sharedMemFirstSampleIdx, 
 	      vector_td<REAL,4> sample_position, vector_td<int,4> lower_limit, vector_td<int,4> upper_limit )
 {
   // Iterate through all grid cells influencing the corresponding sample
@@ -169,9 +173,9 @@ NFFT_iterate( typename reald<REAL,4>::Type alpha, typename reald<REAL,4>::Type b
 	  
 	  const intd<4>::Type grid_position(x,y,z,w);
 	  
-	  NFFT_iterate_body<REAL,4>( alpha, beta, W, matrix_size_os, number_of_batches, samples, image, double_warp_size_power, 
+	  NFFT_iterate_body<REAL,4>( alpha, beta, W, matrix_size_os, number_of_batches, image, double_warp_size_power, 
 				     half_W, one_over_W, matrix_size_os_real, frame, num_frames,
-				     num_samples_per_batch, sample_idx_in_batch, sample_position, grid_position );
+				     sharedMemFirstSampleIdx, sample_position, grid_position );
 	}
       }
     }
@@ -218,10 +222,24 @@ NFFT_H_atomic_convolve_kernel( typename reald<REAL,D>::Type alpha, typename real
   const vector_td<int,D> lower_limit = vector_td<int,D>( ceil(sample_position-half_W_vec));
   const vector_td<int,D> upper_limit = vector_td<int,D>( floor(sample_position+half_W_vec));
 
+  // Stage the sample values of all batches (coils) in shared memory. They are then read once from global memory 
+  // rather than once per grid cell. The layout (bank threadIdx.x%warp_size) is the same as in the other convolutions.
+  const unsigned int scatterSharedMemStart = (threadIdx.x/warpSize)*warpSize;
+  const unsigned int scatterSharedMemStartOffset = threadIdx.x&(warpSize-1); 
+  const unsigned int sharedMemFirstSampleIdx = scatterSharedMemStart*(num_batches<<1) + scatterSharedMemStartOffset;
+
+  REAL *shared_mem = (REAL*) _shared_mem;
+
+  for( unsigned int batch=0; batch<num_batches; batch++ ){
+    const complext<REAL> sample_value = samples[sample_idx_in_batch+batch*num_samples_per_batch];
+    shared_mem[sharedMemFirstSampleIdx+(batch<<double_warp_size_power)] = sample_value.vec[0];
+    shared_mem[sharedMemFirstSampleIdx+(batch<<double_warp_size_power)+warpSize] = sample_value.vec[1];
+  }
+
   // Output to the grid
-  NFFT_iterate<REAL>( alpha, beta, W, matrix_size_os, num_batches, samples, image, double_warp_size_power, 
+  NFFT_iterate<REAL>( alpha, beta, W, matrix_size_os, num_batches, image, double_warp_size_power, 
 		      half_W, one_over_W, matrix_size_os_real, 
-		      frame, num_frames, num_samples_per_batch, sample_idx_in_batch, 
+		      frame, num_frames, sharedMemFirstSampleIdx, 
 		      sample_position, lower_limit, upper_limit );
 #endif
 }
@@ -169,3 +169,119 @@ write_pairs( typename uintd<D>::Type matrix_size_os, typename uintd<D>::Type mat
 
  CHECK_FOR_CUDA_ERROR();
 }
+
+//
+// Tiled NFFT_H preprocessing kernels, see cuNFFT_plan::set_preprocessing_memory_budget.
+// The cells are processed in ranges [cell_begin;cell_end), a sample only outputs the cells of its footprint inside the range.
+//
+
+template<class REAL, unsigned int D> __inline__ __device__ unsigned int
+footprint( const vector_td<REAL,D> &p, REAL half_W, vector_td<unsigned int,D> &lower_limit )
+{
+  unsigned int num_cells = 1;
+  for( unsigned int dim=0; dim<D; dim++ ){
+    lower_limit.vec[dim] = (unsigned int)ceil(p.vec[dim]-half_W);
+    num_cells *= (unsigned int)floor(p.vec[dim]+half_W)-lower_limit.vec[dim]+1;
+  }
+  return num_cells;
+}
+
+template<class REAL, unsigned int D> __inline__ __device__ unsigned int
+footprint_cell( const vector_td<REAL,D> &p, REAL half_W, const vector_td<unsigned int,D> &lower_limit, unsigned int i,
+                const vector_td<unsigned int,D> &matrix_size_os_wrap, unsigned int frame_offset )
+{
+  // x fastest, as in output_pairs
+  vector_td<unsigned int,D> co;
+  for( unsigned int dim=0; dim<D; dim++ ){
+    unsigned int extent = (unsigned int)floor(p.vec[dim]+half_W)-lower_limit.vec[dim]+1;
+    co.vec[dim] = lower_limit.vec[dim]+i%extent;
+    i /= extent;
+  }
+  return co_to_idx<D>(co, matrix_size_os_wrap)+frame_offset;
+}
+
+template<class REAL, unsigned int D> __global__ void
+count_pairs_per_cell_kernel( vector_td<unsigned int,D> matrix_size_os_wrap, unsigned int num_samples_per_frame, REAL half_W,
+                             const vector_td<REAL,D> * __restrict__ traj_positions, unsigned int * __restrict__ cell_counts )
+{
+  unsigned int sample_idx = blockIdx.x*blockDim.x + threadIdx.x;
+  unsigned int frame = blockIdx.y;
+
+  if( sample_idx<num_samples_per_frame ){
+
+    sample_idx += frame*num_samples_per_frame;
+    vector_td<REAL,D> p = traj_positions[sample_idx];
+    vector_td<unsigned int,D> lower_limit;
+    unsigned int num_cells = footprint<REAL,D>( p, half_W, lower_limit );
+    unsigned int frame_offset = frame*prod(matrix_size_os_wrap);
+    for( unsigned int i=0; i<num_cells; i++ )
+      atomicAdd( &cell_counts[footprint_cell<REAL,D>( p, half_W, lower_limit, i, matrix_size_os_wrap, frame_offset )], 1u );
+  }
+}
+
+template<class REAL, unsigned int D, class KEY> __global__ void
+range_pairs_kernel( vector_td<unsigned int,D> matrix_size_os_wrap, unsigned int num_samples_per_frame, REAL half_W,
+                    unsigned int cell_begin, unsigned int cell_end, const vector_td<REAL,D> * __restrict__ traj_positions,
+                    unsigned int * __restrict__ sample_counts, const unsigned int * __restrict__ write_offsets,
+                    KEY * __restrict__ tuples_first, unsigned int * __restrict__ tuples_last )
+{
+  unsigned int sample_idx = blockIdx.x*blockDim.x + threadIdx.x;
+  unsigned int frame = blockIdx.y;
+
+  if( sample_idx<num_samples_per_frame ){
+
+    sample_idx += frame*num_samples_per_frame;
+    vector_td<REAL,D> p = traj_positions[sample_idx];
+    vector_td<unsigned int,D> lower_limit;
+    unsigned int num_cells = footprint<REAL,D>( p, half_W, lower_limit );
+    unsigned int frame_offset = frame*prod(matrix_size_os_wrap);
+
+    // Without write offsets only count the pairs of the sample in the range
+    unsigned int pair_idx = 0;
+    unsigned int write_offset = (write_offsets==0x0 || sample_idx==0) ? 0 : write_offsets[sample_idx-1];
+    for( unsigned int i=0; i<num_cells; i++ ){
+      unsigned int cell = footprint_cell<REAL,D>( p, half_W, lower_limit, i, matrix_size_os_wrap, frame_offset );
+      if( cell<cell_begin || cell>=cell_end )
+        continue;
+      if( write_offsets ){
+        tuples_first[write_offset+pair_idx] = KEY(cell-cell_begin);
+        tuples_last[write_offset+pair_idx] = sample_idx;
+      }
+      pair_idx++;
+    }
+    if( !write_offsets )
+      sample_counts[sample_idx] = pair_idx;
+  }
+}
+
+template <class REAL, unsigned int D> void 
+count_pairs_per_cell( typename uintd<D>::Type matrix_size_os_wrap, unsigned int num_samples_per_frame, unsigned int num_frames, REAL W, 
+                      const typename reald<REAL,D>::Type * __restrict__ traj_positions, unsigned int * __restrict__ cell_counts )
+{
+  dim3 blockDim(256);
+  dim3 gridDim((int)ceil((double)num_samples_per_frame/(double)blockDim.x), num_frames);
+
+  REAL half_W = REAL(0.5)*W;
+  count_pairs_per_cell_kernel<REAL,D><<< gridDim, blockDim >>>
+    ( matrix_size_os_wrap, num_samples_per_frame, half_W, traj_positions, cell_counts );
+
+  CHECK_FOR_CUDA_ERROR();
+}
+
+// Counts the pairs of every sample in the range if write_offsets is 0x0, otherwise writes them with range relative cell indices
+template <class REAL, unsigned int D, class KEY> void 
+range_pairs( typename uintd<D>::Type matrix_size_os_wrap, unsigned int num_samples_per_frame, unsigned int num_frames, REAL W,
+             unsigned int cell_begin, unsigned int cell_end, const typename reald<REAL,D>::Type * __restrict__ traj_positions,
+             unsigned int * __restrict__ sample_counts, const unsigned int * __restrict__ write_offsets,
+             KEY * __restrict__ tuples_first, unsigned int * __restrict__ tuples_last )
+{
+  dim3 blockDim(256);
+  dim3 gridDim((int)ceil((double)num_samples_per_frame/(double)blockDim.x), num_frames);
+
+  REAL half_W = REAL(0.5)*W;
+  range_pairs_kernel<REAL,D,KEY><<< gridDim, blockDim >>>
+    ( matrix_size_os_wrap, num_samples_per_frame, half_W, cell_begin, cell_end, traj_positions, 
+      sample_counts, write_offsets, tuples_first, tuples_last );
+
+  CHECK_FOR_CUDA_ERROR();
+}
@@ -17,6 +17,7 @@
 #include <thrust/sort.h>
 #include <thrust/binary_search.h>
 #include <thrust/extrema.h>
+#include <thrust/copy.h>
 // Includes - Gadgetron
 #include "cuNFFT.h"
 #include "cuNDFFT.h"
@@ -42,6 +43,7 @@
 #include <cmath>
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
 
 //using namespace std;
 using std::vector;
@@ -49,9 +51,9 @@ using namespace thrust;
 using namespace Gadgetron;
 
 // Kernel configuration  
-#define NFFT_MAX_COILS_COMPUTE_1x    8
-#define NFFT_MAX_COILS_COMPUTE_2x   16
 #define NFFT_THREADS_PER_KERNEL    192
+#define NFFT_MIN_THREADS_PER_KERNEL 64
+#define NFFT_SHARED_MEM_RESERVE_1x 256
 
 // Reference to shared memory
 extern __shared__ char _shared_mem[];
@@ -66,6 +68,55 @@ extern __shared__ char _shared_mem[];
 // Default template arguments requires c++-0x ?
 typedef float dummy;
 
+//
+// Coil batching of the convolutions.
+// A thread convolves all batches (coils) of its frame at once, so the trajectory and the Kaiser-Bessel weights are
+// loaded and computed once per sample and grid cell for all coils. The per-coil values are held in shared memory, 
+// two reals per coil and thread. The block size is reduced before the coils of a frame are split over several launches.
+//
+
+struct NFFT_coil_batching
+{
+  unsigned int threads_per_block;
+  unsigned int domain_size_coils;
+  unsigned int domain_size_coils_tail;
+  unsigned int num_repetitions;
+
+  inline unsigned int coils( unsigned int repetition ) const {
+    return (repetition==num_repetitions-1) ? domain_size_coils_tail : domain_size_coils;
+  }
+};
+
+template<class REAL> static NFFT_coil_batching
+NFFT_setup_coil_batching( int device, unsigned int num_batches )
+{
+  const size_t bytes_per_coil = sizeof(complext<REAL>);
+  const unsigned int warp_size = cudaDeviceManager::Instance()->warp_size(device);
+  size_t shared_mem = cudaDeviceManager::Instance()->shared_mem_per_block(device);
+
+  // Compute model 1.x passes the kernel arguments in shared memory
+  if( cudaDeviceManager::Instance()->major_version(device) == 1 )
+    shared_mem = (shared_mem > NFFT_SHARED_MEM_RESERVE_1x) ? shared_mem-NFFT_SHARED_MEM_RESERVE_1x : 0;
+
+  if( num_batches == 0 ) num_batches = 1;
+
+  NFFT_coil_batching b;
+  b.threads_per_block = NFFT_THREADS_PER_KERNEL;
+
+  while( b.threads_per_block >= NFFT_MIN_THREADS_PER_KERNEL+warp_size &&
+         size_t(num_batches)*b.threads_per_block*bytes_per_coil > shared_mem )
+    b.threads_per_block -= warp_size;
+
+  unsigned int max_coils = (unsigned int)(shared_mem/(b.threads_per_block*bytes_per_coil));
+  if( max_coils == 0 ) max_coils = 1;
+
+  b.num_repetitions = (num_batches+max_coils-1)/max_coils;
+  b.domain_size_coils = (b.num_repetitions==1) ? num_batches : max_coils;
+  b.domain_size_coils_tail = num_batches-(b.num_repetitions-1)*b.domain_size_coils;
+
+  return b;
+}
+
 // The declaration of atomic/non-atomic NC2C convolution
 // We would love to hide this inside the class, but the compiler core dumps on us when we try...
 //
@@ -313,7 +364,10 @@ void Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::preprocess( cuNDArray<typename real
   
   CHECK_FOR_CUDA_ERROR();
 
-  if( !( mode == NFFT_PREP_C2NC || ATOMICS )){
+  if( !( mode == NFFT_PREP_C2NC || ATOMICS ) && preprocessing_memory_budget > 0 ){
+    preprocess_NC2C_tiled();
+  }
+  else if( !( mode == NFFT_PREP_C2NC || ATOMICS )){
 
     // allocate storage for and compute temporary prefix-sum variable (#cells influenced per sample)
     device_vector<unsigned int> c_p_s(trajectory_int->get_number_of_elements());
@@ -371,6 +425,81 @@ void Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::preprocess( cuNDArray<typename real
   }
 }
 
+// Sorts the pairs of the cells [cell_begin;cell_end) into tuples_last, from the range's first pair on
+//
+template<class REAL, unsigned int D, class KEY> static void
+sort_pairs_in_range( vector_td<unsigned int,D> matrix_size_os_wrap, unsigned int number_of_samples, unsigned int number_of_frames, REAL W,
+                     unsigned int cell_begin, unsigned int cell_end, unsigned int num_pairs,
+                     device_vector< vector_td<REAL,D> > &trajectory_positions, device_vector<unsigned int> &sample_counts,
+                     device_vector<unsigned int>::iterator tuples_last )
+{
+  range_pairs<REAL,D,KEY>( matrix_size_os_wrap, number_of_samples, number_of_frames, W, cell_begin, cell_end,
+                           raw_pointer_cast(&trajectory_positions[0]), raw_pointer_cast(&sample_counts[0]), 0x0, (KEY*)0x0, 0x0 );
+  inclusive_scan( sample_counts.begin(), sample_counts.end(), sample_counts.begin() );
+
+  device_vector<KEY> range_first(num_pairs);
+  device_vector<unsigned int> range_last(num_pairs);
+  CHECK_FOR_CUDA_ERROR();
+
+  range_pairs<REAL,D,KEY>( matrix_size_os_wrap, number_of_samples, number_of_frames, W, cell_begin, cell_end,
+                           raw_pointer_cast(&trajectory_positions[0]), 0x0, raw_pointer_cast(&sample_counts[0]),
+                           raw_pointer_cast(&range_first[0]), raw_pointer_cast(&range_last[0]) );
+
+  // The pairs are written in sample order and the sort is stable, as in the untiled preprocessing
+  stable_sort_by_key( range_first.begin(), range_first.end(), range_last.begin() );
+  thrust::copy( range_last.begin(), range_last.end(), tuples_last );
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> 
+void Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::preprocess_NC2C_tiled()
+{
+  const vector_td<unsigned int,D> matrix_size_os_wrap( matrix_size_os+matrix_size_wrap );
+  const unsigned int num_cells = number_of_frames*prod(matrix_size_os_wrap);
+
+  // The number of pairs of every cell gives the buckets directly: bucket_begin is its exclusive and bucket_end its inclusive prefix sum
+  bucket_begin = new device_vector<unsigned int>(num_cells);
+  bucket_end   = new device_vector<unsigned int>(num_cells, 0);
+  CHECK_FOR_CUDA_ERROR();
+
+  count_pairs_per_cell<REAL,D>( matrix_size_os_wrap, number_of_samples, number_of_frames, W,
+                                raw_pointer_cast(&(*trajectory_positions)[0]), raw_pointer_cast(&(*bucket_end)[0]) );
+  exclusive_scan( bucket_end->begin(), bucket_end->end(), bucket_begin->begin() );
+  inclusive_scan( bucket_end->begin(), bucket_end->end(), bucket_end->begin() );
+
+  const unsigned int num_pairs = bucket_end->back();
+  tuples_last = new device_vector<unsigned int>(num_pairs);
+  CHECK_FOR_CUDA_ERROR();
+
+  // A range holds its pairs twice during the sort (keys and samples, plus the sort's buffers of both),
+  // a range of at most 65536 cells keys them by 16 bit range relative cell indices
+  const size_t bytes_per_pair = 4*sizeof(unsigned int);
+  const unsigned int max_pairs = (unsigned int)std::max( size_t(1), std::min( size_t(num_pairs), preprocessing_memory_budget/bytes_per_pair ));
+
+  device_vector<unsigned int> sample_counts(trajectory_positions->size());
+
+  unsigned int cell_begin = 0;
+  while( cell_begin < num_cells ){
+
+    // The largest range from cell_begin with at most max_pairs pairs, at least one cell
+    const unsigned int pair_begin = (*bucket_begin)[cell_begin];
+    unsigned int cell_end = (unsigned int)( thrust::upper_bound( bucket_end->begin()+cell_begin, bucket_end->end(), pair_begin+max_pairs )-bucket_end->begin() );
+    if( cell_end == cell_begin ) cell_end++;
+
+    const unsigned int num_range_pairs = (*bucket_end)[cell_end-1]-pair_begin;
+
+    if( num_range_pairs > 0 ){
+      if( cell_end-cell_begin <= 65536 )
+        sort_pairs_in_range<REAL,D,unsigned short>( matrix_size_os_wrap, number_of_samples, number_of_frames, W, cell_begin, cell_end, num_range_pairs,
+                                                    *trajectory_positions, sample_counts, tuples_last->begin()+pair_begin );
+      else
+        sort_pairs_in_range<REAL,D,unsigned int>( matrix_size_os_wrap, number_of_samples, number_of_frames, W, cell_begin, cell_end, num_range_pairs,
+                                                  *trajectory_positions, sample_counts, tuples_last->begin()+pair_begin );
+    }
+
+    cell_begin = cell_end;
+  }
+}
+
 template<class REAL, unsigned int D, bool ATOMICS> void
 Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::compute( cuNDArray<complext<REAL> > *in, cuNDArray<complext<REAL> > *out,
                                                  cuNDArray<REAL> *dcw, NFFT_comp_mode mode )
@@ -616,6 +745,148 @@ Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::mult_MH_M( cuNDArray<complext<REAL> > *i
   CHECK_FOR_CUDA_ERROR();
 }
 
+template<class REAL, unsigned int D, bool ATOMICS> void
+Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::preprocess_toeplitz( cuNDArray<typename reald<REAL,D>::Type> *trajectory, cuNDArray<REAL> *dcw )
+{
+  if( !trajectory || trajectory->get_number_of_elements() != number_of_samples*number_of_frames ){
+    throw std::runtime_error("Error: cuNFFT_plan::preprocess_toeplitz: invalid trajectory");
+  }
+
+  if( !preprocessed_NC2C ){
+    throw std::runtime_error("Error: cuNFFT_plan::preprocess_toeplitz: the plan must be preprocessed for NC2C");
+  }
+
+  cuNDArray<typename reald<REAL,D>::Type> *trajectory_int = 0x0;
+  cuNDArray<REAL> *dcw_int = 0x0;
+  int old_device;
+
+  if( !prepare<typename reald<REAL,D>::Type, REAL, dummy>(device, &old_device, trajectory, &trajectory_int, dcw, &dcw_int ) ){
+    throw cuda_error("Error: cuNFFT_plan::preprocess_toeplitz: device preparation error.");
+  }
+
+  // The samples carry the weights dcw^2 of mult_MH_M; compute multiplies by the second dcw
+  std::vector<size_t> sample_dims;
+  sample_dims.push_back(number_of_samples);
+  sample_dims.push_back(number_of_frames);
+  cuNDArray<complext<REAL> > samples(&sample_dims);
+  fill( &samples, complext<REAL>(1) );
+  if( dcw_int ) samples *= *dcw_int;
+
+  // Sum of the weights per frame, the exact point spread function at its center
+  std::vector<REAL> weight_sum(number_of_frames, REAL(0));
+  {
+    boost::shared_ptr< hoNDArray<REAL> > w = dcw_int ? dcw_int->to_host() : boost::shared_ptr< hoNDArray<REAL> >();
+    for( size_t i=0; i<number_of_samples*number_of_frames; i++ ){
+      REAL v = w.get() ? w->get_data_ptr()[i%w->get_number_of_elements()] : REAL(1);
+      weight_sum[i/number_of_samples] += v*v;
+    }
+  }
+
+  typename uint64d<D>::Type matrix_size2 = matrix_size, matrix_size_os2 = matrix_size_os;
+  for( unsigned int d=0; d<D; d++ ){
+    matrix_size2[d] *= 2;
+    matrix_size_os2[d] *= 2;
+  }
+
+  std::vector<size_t> image_dims = to_std_vector(matrix_size);
+  std::vector<size_t> image_dims2 = to_std_vector(matrix_size2);
+  if( number_of_frames > 1 ){
+    image_dims.push_back(number_of_frames);
+    image_dims2.push_back(number_of_frames);
+  }
+
+  // E^H of the weights, c*sum(w) at the image center with the scale c of this plan
+  cuNDArray<complext<REAL> > image(&image_dims);
+  compute( &samples, &image, dcw_int, NFFT_BACKWARDS_NC2C );
+
+  // The point spread function on the 2x grid
+  cuNFFT_plan<REAL,D,ATOMICS> plan2( matrix_size2, matrix_size_os2, W, device );
+  plan2.preprocess( trajectory_int, NFFT_PREP_NC2C );
+  cuNDArray<complext<REAL> > psf(&image_dims2);
+  plan2.compute( &samples, &psf, dcw_int, NFFT_BACKWARDS_NC2C );
+
+  // Normalize the psf of every frame to the scale c^H c of the normal operator, and place a
+  // delta at the center pixel. The psf is the column of the circulant embedding belonging to
+  // that pixel, and the centered FFT diagonalizes circulant matrices: the eigenvalues are fft(psf)/fft(delta)
+  boost::shared_ptr< hoNDArray<complext<REAL> > > h_image = image.to_host();
+  boost::shared_ptr< hoNDArray<complext<REAL> > > h_psf = psf.to_host();
+  hoNDArray<complext<REAL> > h_delta(&image_dims2);
+  h_delta.fill(complext<REAL>(0));
+
+  const size_t num_image = prod(matrix_size), num_image2 = prod(matrix_size2);
+  const size_t center = co_to_idx<D>(matrix_size>>1, matrix_size);
+  const size_t center2 = co_to_idx<D>(matrix_size2>>1, matrix_size2);
+
+  for( unsigned int f=0; f<number_of_frames; f++ ){
+    complext<REAL> c = h_image->get_data_ptr()[f*num_image+center]/weight_sum[f];
+    complext<REAL> c2 = h_psf->get_data_ptr()[f*num_image2+center2]/weight_sum[f];
+    complext<REAL> scale = complext<REAL>(norm(c))/c2;
+
+    complext<REAL> *p = h_psf->get_data_ptr()+f*num_image2;
+    for( size_t i=0; i<num_image2; i++ ) p[i] *= scale;
+    h_delta.get_data_ptr()[f*num_image2+center2] = complext<REAL>(1);
+  }
+
+  toeplitz_kernel = boost::shared_ptr< cuNDArray<complext<REAL> > >( new cuNDArray<complext<REAL> >(h_psf.get()) );
+  cuNDArray<complext<REAL> > delta(&h_delta);
+
+  typename uint64d<D>::Type _dims_to_transform = counting_vec<size_t,D>();
+  vector<size_t> dims_to_transform = to_std_vector( _dims_to_transform );
+  cuNDFFT<REAL>::instance()->fft( toeplitz_kernel.get(), &dims_to_transform );
+  cuNDFFT<REAL>::instance()->fft( &delta, &dims_to_transform );
+  *toeplitz_kernel /= delta;
+
+  restore<typename reald<REAL,D>::Type, REAL, dummy>(old_device, trajectory, trajectory, trajectory_int, dcw, dcw_int );
+
+  CHECK_FOR_CUDA_ERROR();
+}
+
+template<class REAL, unsigned int D, bool ATOMICS> void
+Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::mult_MH_M_toeplitz( cuNDArray<complext<REAL> > *in, cuNDArray<complext<REAL> > *out )
+{
+  if( !toeplitz_kernel.get() ){
+    throw std::runtime_error("Error: cuNFFT_plan::mult_MH_M_toeplitz: call preprocess_toeplitz first");
+  }
+
+  if( !in || !out || in->get_number_of_elements() != out->get_number_of_elements() ){
+    throw std::runtime_error("Error: cuNFFT_plan::mult_MH_M_toeplitz: in/out image sizes mismatch");
+  }
+
+  typename uint64d<D>::Type image_dims = from_std_vector<size_t,D>(*in->get_dimensions());
+  if( !(image_dims == matrix_size) ){
+    throw std::runtime_error("Error: cuNFFT_plan::mult_MH_M_toeplitz: the image must have the matrix size");
+  }
+
+  cuNDArray<complext<REAL> > *in_int = 0x0, *out_int = 0x0;
+  int old_device;
+
+  if( !prepare<complext<REAL>, complext<REAL>, dummy>(device, &old_device, in, &in_int, out, &out_int ) ){
+    throw cuda_error("Error: cuNFFT_plan::mult_MH_M_toeplitz: device preparation error.");
+  }
+
+  // Zero pad to the 2x grid, multiply the spectrum and crop; the frames of the kernel repeat over
+  // any further (coil) dimension of the image
+  vector<size_t> vec_dims = to_std_vector(matrix_size);
+  for( unsigned int d=0; d<D; d++ ) vec_dims[d] *= 2;
+  for( unsigned int d=D; d<in->get_number_of_dimensions(); d++ )
+    vec_dims.push_back(in->get_size(d));
+
+  cuNDArray<complext<REAL> > working_image(&vec_dims);
+  pad<complext<REAL>, D>( in_int, &working_image );
+
+  typename uint64d<D>::Type _dims_to_transform = counting_vec<size_t,D>();
+  vector<size_t> dims_to_transform = to_std_vector( _dims_to_transform );
+  cuNDFFT<REAL>::instance()->fft( &working_image, &dims_to_transform );
+  working_image *= *toeplitz_kernel;
+  cuNDFFT<REAL>::instance()->ifft( &working_image, &dims_to_transform );
+
+  crop<complext<REAL>, D>( matrix_size>>1, &working_image, out_int );
+
+  restore<complext<REAL>, complext<REAL>, dummy>(old_device, out, out, out_int, in, in_int );
+
+  CHECK_FOR_CUDA_ERROR();
+}
+
 template<class REAL, unsigned int D, bool ATOMICS> void
 Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::convolve( cuNDArray<complext<REAL> > *in, cuNDArray<complext<REAL> > *out,
                                                   cuNDArray<REAL> *dcw, NFFT_conv_mode mode, bool accumulate )
@@ -834,6 +1105,9 @@ void Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::barebones()
   trajectory_positions = 0x0;
   tuples_last = bucket_begin = bucket_end = 0x0;
 
+  // Untiled NC2C preprocessing
+  preprocessing_memory_budget = 0;
+
   // and specify the device
   if (cudaGetDevice(&device) != cudaSuccess) {
     throw cuda_error("Error: cuNFFT_plan::barebones:: unable to get device no");
@@ -869,6 +1143,8 @@ void Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::wipe( NFFT_wipe_mode mode )
     preprocessed_C2NC = preprocessed_NC2C = false;
   }
 
+  toeplitz_kernel.reset();
+
   if( device != old_device && cudaSetDevice(old_device) != cudaSuccess) {
     throw cuda_error("Error: cuNFFT_plan::wipe: unable to restore device no");
   }
@@ -1034,33 +1310,14 @@ Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::convolve_NFFT_C2NC( cuNDArray<complext<R
     Setup grid and threads
   */
 
-  size_t threads_per_block;
-  unsigned int max_coils;
-    
-  threads_per_block = NFFT_THREADS_PER_KERNEL;
-  
-  if( cudaDeviceManager::Instance()->major_version(device) == 1 ){
-    max_coils = NFFT_MAX_COILS_COMPUTE_1x;
-  }
-  else{
-    max_coils = NFFT_MAX_COILS_COMPUTE_2x;
-  }
-  
-  // We can (only) convolve max_coils batches per run due to shared memory issues. 
-  unsigned int domain_size_coils_desired = num_batches;
-  unsigned int num_repetitions = domain_size_coils_desired/max_coils + 
-    ( ((domain_size_coils_desired%max_coils)==0) ? 0 : 1 );
-  unsigned int domain_size_coils = (num_repetitions==1) ? domain_size_coils_desired : max_coils;
-  unsigned int domain_size_coils_tail = (num_repetitions==1) ? domain_size_coils_desired : domain_size_coils_desired - (num_repetitions-1)*domain_size_coils;
+  // We can (only) convolve as many batches per run as fit in shared memory. 
+  NFFT_coil_batching batching = NFFT_setup_coil_batching<REAL>( device, num_batches );
+  unsigned int domain_size_coils = batching.domain_size_coils;
 
   // Block and Grid dimensions
-  dim3 dimBlock( (unsigned int)threads_per_block );
+  dim3 dimBlock( batching.threads_per_block );
   dim3 dimGrid( (number_of_samples+dimBlock.x-1)/dimBlock.x, number_of_frames );
 
-  // Calculate how much shared memory to use per thread
-  size_t bytes_per_thread = domain_size_coils * sizeof( vector_td<REAL,D> );
-  size_t bytes_per_thread_tail = domain_size_coils_tail * sizeof( vector_td<REAL,D> );
-
   unsigned int double_warp_size_power=0;
   unsigned int __tmp = cudaDeviceManager::Instance()->warp_size(device)<<1;
   while(__tmp!=1){
@@ -1074,11 +1331,11 @@ Gadgetron::cuNFFT_plan<REAL,D,ATOMICS>::convolve_NFFT_C2NC( cuNDArray<complext<R
     Invoke kernel
   */
 
-  for( unsigned int repetition = 0; repetition<num_repetitions; repetition++ ){
+  for( unsigned int repetition = 0; repetition<batching.num_repetitions; repetition++ ){
     NFFT_convolve_kernel<REAL,D>
-      <<<dimGrid, dimBlock, ((repetition==num_repetitions-1) ? dimBlock.x*bytes_per_thread_tail : dimBlock.x*bytes_per_thread)>>>
+      <<<dimGrid, dimBlock, dimBlock.x*batching.coils(repetition)*sizeof(complext<REAL>)>>>
       ( alpha, beta, W, vector_td<unsigned int,D>(matrix_size_os), vector_td<unsigned int,D>(matrix_size_wrap), number_of_samples,
-        (repetition==num_repetitions-1) ? domain_size_coils_tail : domain_size_coils, 
+        batching.coils(repetition), 
         raw_pointer_cast(&(*trajectory_positions)[0]), 
         image->get_data_ptr()+repetition*prod(matrix_size_os)*number_of_frames*domain_size_coils,
         samples->get_data_ptr()+repetition*number_of_samples*number_of_frames*domain_size_coils, 
@@ -1136,27 +1393,14 @@ _convolve_NFFT_NC2C<float,D,true>{ // True: use atomic operations variant
     //  Setup grid and threads
     //
     
-    size_t threads_per_block;
-    unsigned int max_coils;
-    
-    threads_per_block = NFFT_THREADS_PER_KERNEL;
-    max_coils = NFFT_MAX_COILS_COMPUTE_2x;
-    
-    // We can (only) convolve domain_size_coils batches per run due to shared memory issues. 
-    unsigned int domain_size_coils_desired = num_batches;
-    unsigned int num_repetitions = domain_size_coils_desired/max_coils + 
-      ( ((domain_size_coils_desired%max_coils)==0) ? 0 : 1 );
-    unsigned int domain_size_coils = (num_repetitions==1) ? domain_size_coils_desired : max_coils;
-    unsigned int domain_size_coils_tail = (num_repetitions==1) ? domain_size_coils_desired : domain_size_coils_desired - (num_repetitions-1)*domain_size_coils;
+    // We can (only) convolve as many batches per run as fit in shared memory (the staged sample values). 
+    NFFT_coil_batching batching = NFFT_setup_coil_batching<float>( device, num_batches );
+    unsigned int domain_size_coils = batching.domain_size_coils;
     
     // Block and Grid dimensions
-    dim3 dimBlock( (unsigned int)threads_per_block ); 
+    dim3 dimBlock( batching.threads_per_block ); 
     dim3 dimGrid( (number_of_samples+dimBlock.x-1)/dimBlock.x, number_of_frames );
     
-    // Calculate how much shared memory to use per thread
-    size_t bytes_per_thread = domain_size_coils * sizeof( vector_td<float,D> );
-    size_t bytes_per_thread_tail = domain_size_coils_tail * sizeof( vector_td<float,D> );
-    
     unsigned int double_warp_size_power=0, __tmp = cudaDeviceManager::Instance()->warp_size(device)<<1;
     while(__tmp!=1){
       __tmp>>=1;
@@ -1173,12 +1417,12 @@ _convolve_NFFT_NC2C<float,D,true>{ // True: use atomic operations variant
     // Invoke kernel
     //
     
-    for( unsigned int repetition = 0; repetition<num_repetitions; repetition++ ){
+    for( unsigned int repetition = 0; repetition<batching.num_repetitions; repetition++ ){
       
       NFFT_H_atomic_convolve_kernel<float,D>
-        <<<dimGrid, dimBlock, ((repetition==num_repetitions-1) ? dimBlock.x*bytes_per_thread_tail : dimBlock.x*bytes_per_thread)>>>
+        <<<dimGrid, dimBlock, dimBlock.x*batching.coils(repetition)*sizeof(complext<float>)>>>
         ( alpha, beta, W, vector_td<unsigned int,D>(matrix_size_os), vector_td<unsigned int,D>(matrix_size_wrap), number_of_samples,
-          (repetition==num_repetitions-1) ? domain_size_coils_tail : domain_size_coils,
+          batching.coils(repetition),
           raw_pointer_cast(&(*trajectory_positions)[0]), 
           samples->get_data_ptr()+repetition*number_of_samples*number_of_frames*domain_size_coils,
           image->get_data_ptr()+repetition*prod(matrix_size_os)*number_of_frames*domain_size_coils,
@@ -1233,33 +1477,14 @@ _convolve_NFFT_NC2C<REAL,D,false>{ // False: use non-atomic operations variant
     // Setup grid and threads
     //
     
-    size_t threads_per_block;
-    unsigned int max_coils;
-    
-    threads_per_block = NFFT_THREADS_PER_KERNEL;
-    
-    if( cudaDeviceManager::Instance()->major_version(device) == 1 ){
-      max_coils = NFFT_MAX_COILS_COMPUTE_1x;
-    }
-    else{
-      max_coils = NFFT_MAX_COILS_COMPUTE_2x;
-    }
-    
-    // We can (only) convolve domain_size_coils batches per run due to shared memory issues. 
-    unsigned int domain_size_coils_desired = num_batches;
-    unsigned int num_repetitions = domain_size_coils_desired/max_coils + 
-      ( ((domain_size_coils_desired%max_coils)==0) ? 0 : 1 );
-    unsigned int domain_size_coils = (num_repetitions==1) ? domain_size_coils_desired : max_coils;
-    unsigned int domain_size_coils_tail = (num_repetitions==1) ? domain_size_coils_desired : domain_size_coils_desired - (num_repetitions-1)*domain_size_coils;
+    // We can (only) convolve as many batches per run as fit in shared memory. 
+    NFFT_coil_batching batching = NFFT_setup_coil_batching<REAL>( device, num_batches );
+    unsigned int domain_size_coils = batching.domain_size_coils;
     
     // Block and Grid dimensions
-    dim3 dimBlock( (unsigned int)threads_per_block ); 
+    dim3 dimBlock( batching.threads_per_block ); 
     dim3 dimGrid( (prod(matrix_size_os+matrix_size_wrap)+dimBlock.x-1)/dimBlock.x, number_of_frames );
     
-    // Calculate how much shared memory to use per thread
-    size_t bytes_per_thread = domain_size_coils * sizeof( vector_td<REAL,D> );
-    size_t bytes_per_thread_tail = domain_size_coils_tail * sizeof( vector_td<REAL,D> );
-    
     unsigned int double_warp_size_power=0, __tmp = cudaDeviceManager::Instance()->warp_size(device)<<1;
     while(__tmp!=1){
       __tmp>>=1;
@@ -1283,12 +1508,12 @@ _convolve_NFFT_NC2C<REAL,D,false>{ // False: use non-atomic operations variant
     // Invoke kernel
     //
     
-    for( unsigned int repetition = 0; repetition<num_repetitions; repetition++ ){
+    for( unsigned int repetition = 0; repetition<batching.num_repetitions; repetition++ ){
       
       NFFT_H_convolve_kernel<REAL,D>
-        <<<dimGrid, dimBlock, ((repetition==num_repetitions-1) ? dimBlock.x*bytes_per_thread_tail : dimBlock.x*bytes_per_thread)>>>
+        <<<dimGrid, dimBlock, dimBlock.x*batching.coils(repetition)*sizeof(complext<REAL>)>>>
         ( alpha, beta, W, vector_td<unsigned int,D>(matrix_size_os+matrix_size_wrap), number_of_samples,
-          (repetition==num_repetitions-1) ? domain_size_coils_tail : domain_size_coils, 
+          batching.coils(repetition), 
           raw_pointer_cast(&(*trajectory_positions)[0]), 
           _tmp.get_data_ptr()+repetition*prod(matrix_size_os+matrix_size_wrap)*number_of_frames*domain_size_coils,
           samples->get_data_ptr()+repetition*number_of_samples*number_of_frames*domain_size_coils, 
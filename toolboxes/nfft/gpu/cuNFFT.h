@@ -40,6 +40,7 @@ namespace Gadgetron{
       However, using atomic operations has the advantage of not requiring any pre-processing.
       As the preprocessing step can be quite costly in terms of memory usage,
       the atomic mode can be necessary for very large images or for 3D/4D volumes.
+      Alternatively set_preprocessing_memory_budget bounds the temporary memory of the preprocessing.
       Notice: currently no devices support atomics operations in double precision.
   */
   template< class REAL, unsigned int D, bool ATOMICS = false > class EXPORTGPUNFFT cuNFFT_plan
@@ -108,6 +109,25 @@ namespace Gadgetron{
     */
     void preprocess( cuNDArray<typename reald<REAL,D>::Type> *trajectory, NFFT_prep_mode mode );
 
+    /**
+       Bound the temporary device memory of the NC2C preprocessing.
+       By default (a budget of 0) the (cell, sample) pairs of the entire trajectory are generated and sorted at once,
+       which takes four unsigned ints per pair on top of the preprocessed plan. With a budget the cells are processed in 
+       consecutive ranges of at most budget/16 pairs, and only the pairs of one range are held and sorted at a time.
+       The plan itself (a sample index per pair and two bucket indices per cell and frame) is the same either way.
+       \param bytes the budget in bytes, 0 to preprocess in one pass.
+    */
+    inline void set_preprocessing_memory_budget( size_t bytes ){
+      preprocessing_memory_budget = bytes;
+    }
+
+    /**
+       Get the memory budget of the NC2C preprocessing, see set_preprocessing_memory_budget.
+    */
+    inline size_t get_preprocessing_memory_budget(){
+      return preprocessing_memory_budget;
+    }
+
     /**
        Enum defining the desired NFFT operation
     */
@@ -139,6 +159,22 @@ namespace Gadgetron{
     */
     void mult_MH_M( cuNDArray<complext<REAL> > *in, cuNDArray<complext<REAL> > *out,
                     cuNDArray<REAL> *dcw, std::vector<size_t> halfway_dims );
+
+    /**
+       Precompute the Toeplitz kernel of the operator of mult_MH_M (E^H dcw^2 E) for the preprocessed trajectory.
+       The point spread function is computed once on a grid of twice the matrix size, after which
+       mult_MH_M_toeplitz costs two FFTs of that grid and a pointwise multiply instead of two convolutions.
+       \param[in] trajectory the trajectory given to preprocess, which must have included NFFT_PREP_NC2C.
+       \param[in] dcw optional density compensation weights. If an 0x0-pointer is provided no density compensation is used.
+    */
+    void preprocess_toeplitz( cuNDArray<typename reald<REAL,D>::Type> *trajectory, cuNDArray<REAL> *dcw );
+
+    /**
+       Execute the normal operator of mult_MH_M with the kernel of preprocess_toeplitz.
+       \param[in] in the input image array of the matrix size.
+       \param[out] out the output image array.
+    */
+    void mult_MH_M_toeplitz( cuNDArray<complext<REAL> > *in, cuNDArray<complext<REAL> > *out );
   
   public: // Utilities
   
@@ -213,6 +249,20 @@ namespace Gadgetron{
       return device;
     }
     
+    /**
+       Query if the Toeplitz kernel of mult_MH_M_toeplitz has been computed
+    */
+    inline bool is_toeplitz_preprocessed(){
+      return toeplitz_kernel.get() != 0x0;
+    }
+
+    /**
+       Get the Toeplitz kernel of mult_MH_M_toeplitz, the spectrum of the point spread function on the 2x grid
+    */
+    inline boost::shared_ptr< cuNDArray<complext<REAL> > > get_toeplitz_kernel(){
+      return toeplitz_kernel;
+    }
+
     /**
        Query of the plan has been setup
     */
@@ -232,6 +282,9 @@ namespace Gadgetron{
     // Shared barebones constructor
     void barebones();
     
+    // NC2C preprocessing in ranges of cells, see set_preprocessing_memory_budget
+    void preprocess_NC2C_tiled();
+
     // Compute beta control parameter for Kaiser-Bessel kernel
     void compute_beta();
 
@@ -274,11 +327,15 @@ namespace Gadgetron{
     boost::shared_ptr< cuNDArray<complext<REAL> > > deapodization_filter; //Inverse fourier transformed deapodization filter
 
     boost::shared_ptr< cuNDArray<complext<REAL> > > deapodization_filterFFT; //Fourier transformed deapodization filter
+
+    boost::shared_ptr< cuNDArray<complext<REAL> > > toeplitz_kernel; //Spectrum of the point spread function on the 2x grid
    
     thrust::device_vector< typename reald<REAL,D>::Type > *trajectory_positions;
     thrust::device_vector<unsigned int> *tuples_last;
     thrust::device_vector<unsigned int> *bucket_begin, *bucket_end;
 
+    size_t preprocessing_memory_budget;          // Bytes of temporary memory of the NC2C preprocessing, 0 for no bound
+
     //
     // State variables
     //
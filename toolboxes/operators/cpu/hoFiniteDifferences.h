@@ -0,0 +1,290 @@
+/** \file hoFiniteDifferences.h
+\brief Line based kernels for periodic finite differences and total variation of hoNDArrays, CPU based.
+
+The first D dimensions of an array are the stencil dimensions, further dimensions are a batch of independent arrays.
+The arrays are processed as lines along the contiguous first dimension; for every line, the neighbouring lines of all
+D directions are located once, and the inner loops run over contiguous memory without index arithmetic, so the
+compiler vectorises them. The lines are distributed over the OpenMP threads.
+
+The total variation is computed in two passes over the array: the first pass computes all D forward differences,
+the magnitude of the gradient and its inverse at every pixel, the second the divergence term of the TV gradient from
+the inverse magnitudes of every pixel and of its backward neighbours.
+*/
+
+#pragma once
+
+#include "hoNDArray.h"
+#include "complext.h"
+#include "vector_td.h"
+
+#include <cmath>
+#include <vector>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+namespace Gadgetron{
+
+    /// Line geometry of the first D dimensions of an array
+    template <unsigned int D> class hoFiniteDifferenceLines
+    {
+    public:
+
+        template <class T> explicit hoFiniteDifferenceLines(const hoNDArray<T>& a)
+        {
+            if (a.get_number_of_dimensions() < D){
+                throw std::runtime_error("hoFiniteDifferenceLines : array has fewer than D dimensions");
+            }
+
+            size_t n = 1;
+            for (unsigned int d = 0; d < D; d++){
+                dims_[d] = (long long)a.get_size(d);
+                n *= a.get_size(d);
+            }
+
+            elements_ = n;
+            lines_ = (n > 0) ? a.get_number_of_elements() / dims_[0] : 0;
+        }
+
+        /// length of the lines
+        long long length() const { return dims_[0]; }
+
+        /// number of lines, of all arrays in the batch
+        long long lines() const { return lines_; }
+
+        /// offset of the first element of the line reached from line l by the shift along dimensions 1 to D-1, periodic
+        size_t shifted_line(long long l, const vector_td<long long, D>& shift) const
+        {
+            long long lines_per_array = (long long)(elements_ / dims_[0]);
+            long long batch = l / lines_per_array;
+            long long r = l % lines_per_array;
+
+            size_t offset = 0, stride = dims_[0];
+            for (unsigned int d = 1; d < D; d++){
+                long long c = r % dims_[d];
+                r /= dims_[d];
+                c = ((c + shift[d]) % dims_[d] + dims_[d]) % dims_[d];
+                offset += c*stride;
+                stride *= dims_[d];
+            }
+
+            return batch*elements_ + offset;
+        }
+
+        /// periodic shift along the first dimension
+        long long shift0(const vector_td<long long, D>& shift) const
+        {
+            return ((shift[0] % dims_[0]) + dims_[0]) % dims_[0];
+        }
+
+    protected:
+        vector_td<long long, D> dims_;
+        size_t elements_;
+        long long lines_;
+    };
+
+    /// out(c) = in(c + shift) - in(c), with periodic boundaries; out may not alias in
+    template <class T, unsigned int D> void periodic_difference(const hoNDArray<T>& in, const vector_td<long long, D>& shift, hoNDArray<T>& out, bool accumulate)
+    {
+        if (in.get_number_of_elements() != out.get_number_of_elements()){
+            throw std::runtime_error("periodic_difference : array dimensions mismatch");
+        }
+
+        hoFiniteDifferenceLines<D> g(in);
+        const long long N0 = g.length();
+        const long long s0 = g.shift0(shift);
+        const T* pIn = in.get_data_ptr();
+        T* pOut = out.get_data_ptr();
+
+        long long l;
+#ifdef USE_OMP
+#pragma omp parallel for private(l) if(g.lines()*N0 > 64*1024)
+#endif
+        for (l = 0; l < g.lines(); l++){
+            const T* c = pIn + l*N0;
+            const T* nb = pIn + g.shifted_line(l, shift);
+            T* r = pOut + l*N0;
+
+            // the neighbour of x is nb[x + s0] up to the end of the line, then wraps to nb[x + s0 - N0]
+            const long long n1 = N0 - s0;
+            if (accumulate){
+                for (long long x = 0; x < n1; x++) r[x] += nb[x + s0] - c[x];
+                for (long long x = n1; x < N0; x++) r[x] += nb[x + s0 - N0] - c[x];
+            }
+            else{
+                for (long long x = 0; x < n1; x++) r[x] = nb[x + s0] - c[x];
+                for (long long x = n1; x < N0; x++) r[x] = nb[x + s0 - N0] - c[x];
+            }
+        }
+    }
+
+    /// out(c) = 2 in(c) - in(c + shift1) - in(c + shift2), with periodic boundaries; out may not alias in
+    template <class T, unsigned int D> void periodic_second_difference(const hoNDArray<T>& in, const vector_td<long long, D>& shift1, const vector_td<long long, D>& shift2, hoNDArray<T>& out, bool accumulate)
+    {
+        if (in.get_number_of_elements() != out.get_number_of_elements()){
+            throw std::runtime_error("periodic_second_difference : array dimensions mismatch");
+        }
+
+        hoFiniteDifferenceLines<D> g(in);
+        const long long N0 = g.length();
+        const long long s1 = g.shift0(shift1);
+        const long long s2 = g.shift0(shift2);
+        const T* pIn = in.get_data_ptr();
+        T* pOut = out.get_data_ptr();
+
+        long long l;
+#ifdef USE_OMP
+#pragma omp parallel for private(l) if(g.lines()*N0 > 64*1024)
+#endif
+        for (l = 0; l < g.lines(); l++){
+            const T* c = pIn + l*N0;
+            const T* nb1 = pIn + g.shifted_line(l, shift1);
+            const T* nb2 = pIn + g.shifted_line(l, shift2);
+            T* r = pOut + l*N0;
+
+            if (!accumulate){
+                for (long long x = 0; x < N0; x++) r[x] = T(0);
+            }
+
+            for (long long x = 0; x < N0; x++) r[x] += c[x] + c[x];
+
+            const long long n1 = N0 - s1;
+            for (long long x = 0; x < n1; x++) r[x] -= nb1[x + s1];
+            for (long long x = n1; x < N0; x++) r[x] -= nb1[x + s1 - N0];
+
+            const long long n2 = N0 - s2;
+            for (long long x = 0; x < n2; x++) r[x] -= nb2[x + s2];
+            for (long long x = n2; x < N0; x++) r[x] -= nb2[x + s2 - N0];
+        }
+    }
+
+    /// Magnitude of the periodic forward difference gradient, g(c) = sqrt( sum_d |in(c + e_d) - in(c)|^2 ), over all D dimensions in one pass
+    /// inv_mag, if not NULL, receives 1/g(c) where g(c) > limit and 0 elsewhere
+    /// returns the sum of g over the array
+    template <class T, unsigned int D> typename realType<T>::Type tv_magnitude(const hoNDArray<T>& in, typename realType<T>::Type limit, hoNDArray<typename realType<T>::Type>* inv_mag)
+    {
+        typedef typename realType<T>::Type REAL;
+
+        hoFiniteDifferenceLines<D> g(in);
+        const long long N0 = g.length();
+        const T* pIn = in.get_data_ptr();
+
+        if (inv_mag && !inv_mag->dimensions_equal(&in)){
+            inv_mag->create(in.get_dimensions());
+        }
+
+        REAL sum = 0;
+
+#ifdef USE_OMP
+#pragma omp parallel if(g.lines()*N0 > 64*1024)
+#endif
+        {
+            std::vector<REAL> acc(N0);
+            REAL local = 0;
+
+            long long l;
+#ifdef USE_OMP
+#pragma omp for
+#endif
+            for (l = 0; l < g.lines(); l++){
+                const T* c = pIn + l*N0;
+                REAL* a = &acc[0];
+
+                for (long long x = 0; x < N0 - 1; x++) a[x] = norm(c[x + 1] - c[x]);
+                a[N0 - 1] = norm(c[0] - c[N0 - 1]);
+
+                for (unsigned int d = 1; d < D; d++){
+                    vector_td<long long, D> e((long long)0);
+                    e[d] = 1;
+                    const T* nb = pIn + g.shifted_line(l, e);
+                    for (long long x = 0; x < N0; x++) a[x] += norm(nb[x] - c[x]);
+                }
+
+                for (long long x = 0; x < N0; x++){
+                    a[x] = std::sqrt(a[x]);
+                    local += a[x];
+                }
+
+                if (inv_mag){
+                    REAL* w = inv_mag->get_data_ptr() + l*N0;
+                    for (long long x = 0; x < N0; x++) w[x] = (a[x] > limit) ? REAL(1) / a[x] : REAL(0);
+                }
+            }
+
+#ifdef USE_OMP
+#pragma omp atomic
+#endif
+            sum += local;
+        }
+
+        return sum;
+    }
+
+    /// Gradient of the total variation from the inverse magnitudes of tv_magnitude
+    /// out(c) += weight * ( w(c) sum_d (in(c) - in(c + e_d)) + sum_d w(c - e_d) (in(c) - in(c - e_d)) )
+    template <class T, unsigned int D> void tv_gradient(const hoNDArray<T>& in, const hoNDArray<typename realType<T>::Type>& inv_mag, typename realType<T>::Type weight, hoNDArray<T>& out, bool accumulate)
+    {
+        typedef typename realType<T>::Type REAL;
+
+        if (in.get_number_of_elements() != out.get_number_of_elements() || in.get_number_of_elements() != inv_mag.get_number_of_elements()){
+            throw std::runtime_error("tv_gradient : array dimensions mismatch");
+        }
+
+        hoFiniteDifferenceLines<D> g(in);
+        const long long N0 = g.length();
+        const T* pIn = in.get_data_ptr();
+        const REAL* pW = inv_mag.get_data_ptr();
+        T* pOut = out.get_data_ptr();
+
+#ifdef USE_OMP
+#pragma omp parallel if(g.lines()*N0 > 64*1024)
+#endif
+        {
+            std::vector<T> acc(N0);
+
+            long long l;
+#ifdef USE_OMP
+#pragma omp for
+#endif
+            for (l = 0; l < g.lines(); l++){
+                const T* c = pIn + l*N0;
+                const REAL* w = pW + l*N0;
+                T* a = &acc[0];
+
+                // forward differences of dimension 0, and the backward ones with the inverse magnitudes of the previous pixels
+                for (long long x = 0; x < N0 - 1; x++) a[x] = c[x] - c[x + 1];
+                a[N0 - 1] = c[N0 - 1] - c[0];
+
+                for (unsigned int d = 1; d < D; d++){
+                    vector_td<long long, D> e((long long)0);
+                    e[d] = 1;
+                    const T* nb = pIn + g.shifted_line(l, e);
+                    for (long long x = 0; x < N0; x++) a[x] += c[x] - nb[x];
+                }
+
+                for (long long x = 0; x < N0; x++) a[x] *= w[x];
+
+                a[0] += w[N0 - 1] * (c[0] - c[N0 - 1]);
+                for (long long x = 1; x < N0; x++) a[x] += w[x - 1] * (c[x] - c[x - 1]);
+
+                for (unsigned int d = 1; d < D; d++){
+                    vector_td<long long, D> e((long long)0);
+                    e[d] = -1;
+                    const size_t o = g.shifted_line(l, e);
+                    const T* nb = pIn + o;
+                    const REAL* wb = pW + o;
+                    for (long long x = 0; x < N0; x++) a[x] += wb[x] * (c[x] - nb[x]);
+                }
+
+                T* r = pOut + l*N0;
+                if (accumulate){
+                    for (long long x = 0; x < N0; x++) r[x] += weight*a[x];
+                }
+                else{
+                    for (long long x = 0; x < N0; x++) r[x] = weight*a[x];
+                }
+            }
+        }
+    }
+}
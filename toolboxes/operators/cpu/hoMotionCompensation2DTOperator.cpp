@@ -1,6 +1,8 @@
 
 #include "hoMotionCompensation2DTOperator.h"
 
+#include <cstring>
+
 namespace Gadgetron { 
 
 template <typename T, typename CoordType> 
@@ -128,6 +130,115 @@ typename hoMotionCompensation2DTOperator<T, CoordType>::value_type hoMotionCompe
     }
 }
 
+template <typename T, typename CoordType>
+typename hoMotionCompensation2DTOperator<T, CoordType>::WarpTable& hoMotionCompensation2DTOperator<T, CoordType>::warp_table(const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy)
+{
+    WarpTable& table = (&dx == &dx_) ? table_ : ((&dx == &adj_dx_) ? adj_table_ : other_table_);
+
+    bool same = table.dx.dimensions_equal(&dx) && table.dy.dimensions_equal(&dy) && table.weight.get_number_of_elements()>0;
+
+    if (same)
+    {
+        same = (memcmp(table.dx.begin(), dx.begin(), sizeof(CoordType)*dx.get_number_of_elements()) == 0)
+            && (memcmp(table.dy.begin(), dy.begin(), sizeof(CoordType)*dy.get_number_of_elements()) == 0);
+    }
+
+    if (!same)
+    {
+        this->prepare_warp(dx, dy, table);
+    }
+
+    return table;
+}
+
+template <typename T, typename CoordType>
+void hoMotionCompensation2DTOperator<T, CoordType>::prepare_warp(const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy, WarpTable& table)
+{
+    try
+    {
+        size_t RO = dx.get_size(0);
+        size_t E1 = dx.get_size(1);
+        size_t N = dx.get_size(2);
+
+        GADGET_CHECK_THROW(dy.get_size(0)==RO);
+        GADGET_CHECK_THROW(dy.get_size(1)==E1);
+        GADGET_CHECK_THROW(dy.get_size(2)==N);
+
+        const size_t W = BSPLINE_ORDER + 1;
+
+        table.dx = dx;
+        table.dy = dy;
+        table.index.create(2*W, RO, E1, N);
+        table.interior.create(RO, E1, N);
+        table.weight.create(2*W, RO, E1, N);
+
+        const CoordType* pDx = dx.begin();
+        const CoordType* pDy = dy.begin();
+        int* pIndex = table.index.begin();
+        unsigned char* pInterior = table.interior.begin();
+        value_type* pWeight = table.weight.begin();
+
+        typedef hoNDBSpline<T, 2> BSplineType;
+        typedef typename BSplineType::coord_type bspline_coord_type;
+
+        // the source positions as computed by hoImageRegDeformationField and evaluated by hoNDInterpolatorBSpline, a row at a time
+        long long ii;
+        long long totalN = (long long)(E1*N);
+        #pragma omp parallel private(ii) shared(RO, E1, totalN, pDx, pDy, pIndex, pInterior, pWeight)
+        {
+            std::vector<bspline_coord_type> xo(RO), yo(RO);
+            std::vector<value_type> xWeight, yWeight;
+            std::vector<long long> xIndex, yIndex;
+
+            #pragma omp for
+            for (ii = 0; ii<totalN; ii++)
+            {
+                size_t y = ii % E1;
+                size_t offset = ii*RO;
+
+                for (size_t x = 0; x<RO; x++)
+                {
+                    xo[x] = (CoordType)(x + pDx[offset+x]);
+                    yo[x] = (CoordType)(y + pDy[offset+x]);
+                }
+
+                BSplineType::computeBSplineGridWeights(RO, BSPLINE_ORDER, 0, xo, xWeight, xIndex);
+                BSplineType::computeBSplineGridWeights(E1, BSPLINE_ORDER, 0, yo, yWeight, yIndex);
+
+                for (size_t x = 0; x<RO; x++)
+                {
+                    size_t q = offset + x;
+
+                    long long ix = static_cast<long long>(std::floor(xo[x]));
+                    long long iy = static_cast<long long>(std::floor(yo[x]));
+
+                    // as the interpolator of the warper does, positions past the far edges are mirrored by the BSpline
+                    pInterior[q] = (ix>=0 && iy>=0);
+
+                    if (!pInterior[q])
+                    {
+                        pIndex[2*W*q] = (int)ix;
+                        pIndex[2*W*q+W] = (int)iy;
+                        continue;
+                    }
+
+                    for (size_t k = 0; k<W; k++)
+                    {
+                        pIndex[2*W*q+k] = (int)xIndex[x*W+k];
+                        pIndex[2*W*q+W+k] = (int)yIndex[x*W+k];
+                        pWeight[2*W*q+k] = xWeight[x*W+k];
+                        pWeight[2*W*q+W+k] = yWeight[x*W+k];
+                    }
+                }
+            }
+        }
+    }
+    catch(...)
+    {
+        GADGET_THROW("Errors in hoMotionCompensation2DTOperator<T>::prepare_warp(...) ... ");
+    }
+}
+
 template <typename T, typename CoordType> 
 void hoMotionCompensation2DTOperator<T, CoordType>::warp_image(const hoNDArray<T>& im, const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy, hoNDArray<T>& warpped, T bgValue, Gadgetron::GT_BOUNDARY_CONDITION bh)
 {
@@ -146,44 +257,49 @@ void hoMotionCompensation2DTOperator<T, CoordType>::warp_image(const hoNDArray<T
         GADGET_CHECK_THROW(dy.get_size(1)==E1);
         GADGET_CHECK_THROW(dy.get_size(2)==N);
 
+        const WarpTable& table = this->warp_table(dx, dy);
+
         warpped.create(RO, E1, CHA, N);
 
         typedef T ValueType;
         typedef hoNDImage<ValueType, 2> ImageType;
-        typedef hoNDImage<value_type, 2> RealImageType;
-        typedef hoNDImage<CoordType, 2> DeformType;
+        typedef hoNDBSpline<ValueType, 2> BSplineType;
 
         ValueType* pIm = const_cast<ValueType*>(im.begin());
-        CoordType* pDx = const_cast<CoordType*>(dx.begin());
-        CoordType* pDy = const_cast<CoordType*>(dy.begin());
         ValueType* pWarpped = warpped.begin();
 
+        const int* pIndex = table.index.begin();
+        const unsigned char* pInterior = table.interior.begin();
+        const value_type* pWeight = table.weight.begin();
+
         std::vector<size_t> dim2D(2);
         dim2D[0] = RO;
         dim2D[1] = E1;
 
-        size_t N2D = sizeof(ValueType)*RO*E1;
+        const size_t W = BSPLINE_ORDER + 1;
 
         long long ii;
 
         long long totalN = N*CHA;
-        #pragma omp parallel private(ii) shared(RO, E1, CHA, totalN, pIm, pDx, pDy, pWarpped, bgValue, bh, dim2D, N2D)
+        #pragma omp parallel private(ii) shared(RO, E1, CHA, totalN, pIm, pWarpped, pIndex, pInterior, pWeight, bgValue, bh, dim2D)
         {
-            hoImageRegDeformationField<CoordType, 2> deformTransform;
             hoNDBoundaryHandlerFixedValue< ImageType > bhFixedValue;
             hoNDBoundaryHandlerBorderValue< ImageType > bhBorderValue;
             hoNDBoundaryHandlerPeriodic< ImageType > bhPeriodic;
             hoNDBoundaryHandlerMirror< ImageType > bhMirror;
 
-            hoNDInterpolatorBSpline<ImageType, 2> interpBSpline(5);
+            hoNDBoundaryHandler< ImageType >* boundary = &bhFixedValue;
+            if ( bh == GT_BOUNDARY_CONDITION_BORDERVALUE )
+                boundary = &bhBorderValue;
+            else if ( bh == GT_BOUNDARY_CONDITION_PERIODIC )
+                boundary = &bhPeriodic;
+            else if ( bh == GT_BOUNDARY_CONDITION_MIRROR )
+                boundary = &bhMirror;
 
-            hoImageRegWarper<ImageType, ImageType, CoordType> warper;
-            warper.setBackgroundValue(bgValue);
-            warper.setTransformation(deformTransform);
-            warper.setInterpolator(interpBSpline);
+            BSplineType bspline;
+            hoNDArray<ValueType> coeff(RO, E1);
 
-            ImageType targetIm, sourceIm, warppedIm;
-            DeformType dxIm, dyIm;
+            ImageType sourceIm;
 
             #pragma omp for
             for ( ii=0; ii<totalN; ii++ )
@@ -191,32 +307,55 @@ void hoMotionCompensation2DTOperator<T, CoordType>::warp_image(const hoNDArray<T
                 long long n = ii/CHA;
                 long long cha = ii - n*CHA;
 
-                targetIm.create(dim2D, pIm+cha*RO*E1+n*RO*E1*CHA);
-                sourceIm.create(dim2D, pIm+cha*RO*E1+n*RO*E1*CHA);
+                ValueType* pSource = pIm+cha*RO*E1+n*RO*E1*CHA;
+                ValueType* pDst = pWarpped+cha*RO*E1+n*RO*E1*CHA;
+
+                sourceIm.create(dim2D, pSource);
+                boundary->setArray( sourceIm );
+
+                // the coefficients depend on the image, the stencils only on the deformation
+                hoNDArray<ValueType> source2D(RO, E1, pSource);
+                bspline.computeBSplineCoefficients(source2D, BSPLINE_ORDER, coeff);
+                const ValueType* pCoeff = coeff.begin();
+
+                size_t offsetN = n*RO*E1;
+
+                for ( size_t p=0; p<RO*E1; p++ )
+                {
+                    // background pixels of the target are not warped
+                    if ( pSource[p] == bgValue )
+                    {
+                        pDst[p] = pSource[p];
+                        continue;
+                    }
+
+                    size_t q = offsetN + p;
 
-                warppedIm.create(dim2D, pWarpped+cha*RO*E1+n*RO*E1*CHA);
+                    const int* xIndex = pIndex + 2*W*q;
+                    const int* yIndex = xIndex + W;
 
-                dxIm.create(dim2D, pDx+n*RO*E1);
-                dyIm.create(dim2D, pDy+n*RO*E1);
+                    if ( !pInterior[q] )
+                    {
+                        pDst[p] = (*boundary)( (long long)xIndex[0], (long long)yIndex[0] );
+                        continue;
+                    }
 
-                bhFixedValue.setArray( sourceIm );
-                interpBSpline.setArray( sourceIm );
+                    const value_type* xWeight = pWeight + 2*W*q;
+                    const value_type* yWeight = xWeight + W;
 
-                if ( bh == GT_BOUNDARY_CONDITION_FIXEDVALUE )
-                    interpBSpline.setBoundaryHandler(bhFixedValue);
-                else if ( bh == GT_BOUNDARY_CONDITION_BORDERVALUE )
-                    interpBSpline.setBoundaryHandler(bhBorderValue);
-                else if ( bh == GT_BOUNDARY_CONDITION_PERIODIC )
-                    interpBSpline.setBoundaryHandler(bhPeriodic);
-                else if ( bh == GT_BOUNDARY_CONDITION_MIRROR )
-                    interpBSpline.setBoundaryHandler(bhMirror);
-                else
-                    interpBSpline.setBoundaryHandler(bhFixedValue);
+                    ValueType res = 0;
 
-                deformTransform.setDeformationField( dxIm, 0 );
-                deformTransform.setDeformationField( dyIm, 1 );
+                    unsigned int ix, iy;
+                    for ( iy=0; iy<W; iy++ )
+                    {
+                        for ( ix=0; ix<W; ix++ )
+                        {
+                            res += pCoeff[ xIndex[ix] + RO*(size_t)yIndex[iy] ] * xWeight[ix] * yWeight[iy];
+                        }
+                    }
 
-                warper.warp(targetIm, sourceIm, false, warppedIm);
+                    pDst[p] = res;
+                }
             }
         }
     }
@@ -46,12 +46,42 @@ public:
 
 protected: 
 
+    /// order of the BSpline interpolation of the warp
+    enum { BSPLINE_ORDER = 5 };
+
+    /// the interpolation stencils of a warp: for every pixel of every frame, the BSPLINE_ORDER+1
+    /// coefficient indexes and weights along x and y
+    /// the stencils only depend on the deformation fields, they are built once and reused until the fields change
+    struct WarpTable
+    {
+        // the deformation fields the table was built from
+        hoNDArray<CoordType> dx;
+        hoNDArray<CoordType> dy;
+
+        // [2*(BSPLINE_ORDER+1) RO E1 N], the x and y indexes of the coefficients with the mirror boundary condition,
+        // or the pixel given to the boundary handler in the first x and y entries if not interior
+        hoNDArray<int> index;
+        // [RO E1 N], whether the source position is inside the image
+        hoNDArray<unsigned char> interior;
+        // [2*(BSPLINE_ORDER+1) RO E1 N]
+        hoNDArray<value_type> weight;
+    };
+
+    // the table for the deformation fields, rebuilt if their content has changed
+    WarpTable& warp_table(const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy);
+    void prepare_warp(const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy, WarpTable& table);
+
     // warp the 2D+T image arrays
     // im : complex image [RO E1 CHA N]
     // dx, dy : [RO E1 N] deformation fields
     // the image domain warpping is performed
     virtual void warp_image(const hoNDArray<T>& im, const hoNDArray<CoordType>& dx, const hoNDArray<CoordType>& dy, hoNDArray<T>& warpped, T bgValue=0, Gadgetron::GT_BOUNDARY_CONDITION bh=GT_BOUNDARY_CONDITION_FIXEDVALUE);
 
+    // tables of dx_/dy_, adj_dx_/adj_dy_ and of other fields
+    WarpTable table_;
+    WarpTable adj_table_;
+    WarpTable other_table_;
+
     // helper memory
     ARRAY_TYPE moco_im_;
     ARRAY_TYPE adj_moco_im_;
@@ -7,6 +7,7 @@
 #include "partialDerivativeOperator.h"
 #include "hoNDArray_math.h"
 #include "vector_td_utilities.h"
+#include "hoFiniteDifferences.h"
 
 #ifdef USE_OMP
 #include <omp.h>
@@ -41,28 +42,7 @@ namespace Gadgetron{
                   throw std::runtime_error("hoPartialDerivativeOperator::compute_partial_derivative : dimensionality mismatch");
               }
 
-              typename int64d<D>::Type dims = vector_td<long long,D>( from_std_vector<size_t,D>( *(in->get_dimensions().get()) ));
-
-#ifdef USE_OMP
-#pragma omp parallel for
-#endif
-      for( long long idx=0; idx<in->get_number_of_elements(); idx++ ) {
-
-                  T valN, valC;
-
-                  typename int64d<D>::Type co = idx_to_co<D>(idx, dims);
-                  typename int64d<D>::Type coN = (co+dims+stride)%dims;
-
-                  valN = in->get_data_ptr()[co_to_idx<D>(coN, dims)];
-                  valC = in->get_data_ptr()[co_to_idx<D>(co, dims)];
-
-                  T val = valN-valC;
-
-                  if( accumulate )
-                      out->get_data_ptr()[idx] += val;
-                  else
-                      out->get_data_ptr()[idx] = val;
-              }
+              periodic_difference<T,D>(*in, stride, *out, accumulate);
           }
 
           virtual void compute_second_order_partial_derivative( typename int64d<D>::Type forwards_stride,
@@ -77,30 +57,7 @@ namespace Gadgetron{
                   throw std::runtime_error( "hoPartialDerivativeOperator::compute_second_order_partial_derivative : dimensionality mismatch");
               }
 
-              typename int64d<D>::Type dims = vector_td<long long,D>( from_std_vector<size_t,D>( *(in->get_dimensions().get()) ));
-
-#ifdef USE_OMP
-#pragma omp parallel for
-#endif
-      for( long long idx=0; idx<in->get_number_of_elements(); idx++ ) {
-
-                  T valN1, valN2, valC;
-
-                  typename int64d<D>::Type co = idx_to_co<D>(idx, dims);
-                  typename int64d<D>::Type coN1 = (co+dims+forwards_stride)%dims;
-                  typename int64d<D>::Type coN2 = (co+dims+adjoint_stride)%dims;
-
-                  valN1 = in->get_data_ptr()[co_to_idx<D>(coN1, dims)];
-                  valN2 = in->get_data_ptr()[co_to_idx<D>(coN2, dims)];
-                  valC = in->get_data_ptr()[co_to_idx<D>(co, dims)];
-
-                  T val = valC+valC-valN1-valN2;
-
-                  if( accumulate )
-                      out->get_data_ptr()[idx] += val;
-                  else
-                      out->get_data_ptr()[idx] = val;
-              }
+              periodic_second_difference<T,D>(*in, forwards_stride, adjoint_stride, *out, accumulate);
           }
 
     };
@@ -54,8 +54,32 @@ void hoSPIRIT2DTOperator<T>::set_forward_kernel(ARRAY_TYPE& forward_kernel, bool
         }
 
         // allocate the helper memory
-        res_after_apply_kernel_.create(RO, E1, srcCHA, dstCHA);
-        res_after_apply_kernel_dst_.create(RO, E1, dstCHA, srcCHA);
+        if (use_blocked_kernel_)
+        {
+            BaseClass::block_kernel(forward_kernel_.begin(), RO*E1, srcCHA, dstCHA, N, forward_kernel_blocked_);
+            BaseClass::block_kernel(adjoint_kernel_.begin(), RO*E1, dstCHA, srcCHA, N, adjoint_kernel_blocked_);
+
+            if (compute_adjoint_forward_kernel)
+            {
+                BaseClass::block_kernel(adjoint_forward_kernel_.begin(), RO*E1, srcCHA, srcCHA, N, adjoint_forward_kernel_blocked_);
+            }
+            else
+            {
+                adjoint_forward_kernel_blocked_.clear();
+            }
+
+            res_after_apply_kernel_.clear();
+            res_after_apply_kernel_dst_.clear();
+        }
+        else
+        {
+            forward_kernel_blocked_.clear();
+            adjoint_kernel_blocked_.clear();
+            adjoint_forward_kernel_blocked_.clear();
+
+            res_after_apply_kernel_.create(RO, E1, srcCHA, dstCHA);
+            res_after_apply_kernel_dst_.create(RO, E1, dstCHA, srcCHA);
+        }
 
         if(kspace_.get_size(4)>N)
         {
@@ -93,6 +117,12 @@ void hoSPIRIT2DTOperator<T>::apply_forward_kernel(ARRAY_TYPE& x)
 
         this->res_after_apply_kernel_sum_over_.create(RO, E1, dstCHA, N);
 
+        if (forward_kernel_blocked_.get_number_of_elements() > 0)
+        {
+            BaseClass::apply_blocked_kernel(forward_kernel_blocked_, RO*E1, srcCHA, dstCHA, N, x.begin(), this->res_after_apply_kernel_sum_over_.begin());
+            return;
+        }
+
         long long n;
         for (n = 0; n < (long long)N; n++)
         {
@@ -176,6 +206,12 @@ void hoSPIRIT2DTOperator<T>::apply_adjoint_kernel(ARRAY_TYPE& x)
 
         this->res_after_apply_kernel_sum_over_dst_.create(RO, E1, srcCHA, N);
 
+        if (adjoint_kernel_blocked_.get_number_of_elements() > 0)
+        {
+            BaseClass::apply_blocked_kernel(adjoint_kernel_blocked_, RO*E1, dstCHA, srcCHA, N, x.begin(), this->res_after_apply_kernel_sum_over_dst_.begin());
+            return;
+        }
+
         long long n;
         for (n = 0; n < (long long)N; n++)
         {
@@ -290,10 +326,18 @@ void hoSPIRIT2DTOperator<T>::apply_adjoint_forward_kernel(ARRAY_TYPE& x)
         GADGET_CHECK_THROW(this->adjoint_forward_kernel_.get_size(3)==srcCHA);
         size_t kernelN = this->adjoint_forward_kernel_.get_size(4);
 
+        this->res_after_apply_kernel_sum_over_dst_.create(RO, E1, srcCHA, N);
+
+        if (adjoint_forward_kernel_blocked_.get_number_of_elements() > 0)
+        {
+            BaseClass::apply_blocked_kernel(adjoint_forward_kernel_blocked_, RO*E1, srcCHA, srcCHA, N, x.begin(), this->res_after_apply_kernel_sum_over_dst_.begin());
+            return;
+        }
+
         long long n;
-        for (n = 0; n < (long long)N; N++)
+        for (n = 0; n < (long long)N; n++)
         {
-            hoNDArray<T> currComplexIm(RO, E1, srcCHA, this->complexIm_.begin() + n*RO*E1*srcCHA);
+            hoNDArray<T> currComplexIm(RO, E1, srcCHA, x.begin() + n*RO*E1*srcCHA);
 
             hoNDArray<T> curr_adjoint_forward_kernel;
 
@@ -46,6 +46,7 @@ public:
 
     using BaseClass::use_non_centered_fft_;
     using BaseClass::no_null_space_;
+    using BaseClass::use_blocked_kernel_;
     //using BaseClass::performTiming_;
     //using BaseClass::debugFolder_;
 
@@ -58,6 +59,9 @@ protected:
     using BaseClass::forward_kernel_;
     using BaseClass::adjoint_kernel_;
     using BaseClass::adjoint_forward_kernel_;
+    using BaseClass::forward_kernel_blocked_;
+    using BaseClass::adjoint_kernel_blocked_;
+    using BaseClass::adjoint_forward_kernel_blocked_;
     using BaseClass::acquired_points_;
     using BaseClass::acquired_points_indicator_;
     using BaseClass::unacquired_points_indicator_;
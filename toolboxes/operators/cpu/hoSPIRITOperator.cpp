@@ -2,11 +2,13 @@
 #include "hoSPIRITOperator.h"
 #include "mri_core_spirit.h"
 
+#include <cstring>
+
 namespace Gadgetron 
 {
 
 template <typename T> 
-hoSPIRITOperator<T>::hoSPIRITOperator(std::vector<size_t> *dims) : use_non_centered_fft_(false), no_null_space_(false), BaseClass(dims)
+hoSPIRITOperator<T>::hoSPIRITOperator(std::vector<size_t> *dims) : use_non_centered_fft_(false), no_null_space_(false), use_blocked_kernel_(false), BaseClass(dims)
 {
 }
 
@@ -129,7 +131,34 @@ void hoSPIRITOperator<T>::set_forward_kernel(ARRAY_TYPE& forward_kernel, bool co
         dimSrc[NDim - 2] = dims[NDim - 2];
         dimDst[NDim - 2] = dims[NDim - 1];
 
-        res_after_apply_kernel_.create(dims);
+        if (use_blocked_kernel_)
+        {
+            size_t P = forward_kernel_.get_number_of_elements() / (dims[NDim - 2] * dims[NDim - 1]);
+
+            block_kernel(forward_kernel_.begin(), P, dims[NDim - 2], dims[NDim - 1], 1, forward_kernel_blocked_);
+            block_kernel(adjoint_kernel_.begin(), P, dims[NDim - 1], dims[NDim - 2], 1, adjoint_kernel_blocked_);
+
+            if (compute_adjoint_forward_kernel)
+            {
+                block_kernel(adjoint_forward_kernel_.begin(), P, dims[NDim - 2], dims[NDim - 2], 1, adjoint_forward_kernel_blocked_);
+            }
+            else
+            {
+                adjoint_forward_kernel_blocked_.clear();
+            }
+
+            // the [... srcCHA dstCHA] intermediate is not needed
+            res_after_apply_kernel_.clear();
+        }
+        else
+        {
+            forward_kernel_blocked_.clear();
+            adjoint_kernel_blocked_.clear();
+            adjoint_forward_kernel_blocked_.clear();
+
+            res_after_apply_kernel_.create(dims);
+        }
+
         res_after_apply_kernel_sum_over_.create(dimDst);
         kspace_dst_.create(dimDst);
     }
@@ -181,6 +210,142 @@ void hoSPIRITOperator<T>::sum_over_src_channel(const ARRAY_TYPE& x, ARRAY_TYPE&
     }
 }
 
+template <typename T>
+void hoSPIRITOperator<T>::apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& blocked_kernel, const ARRAY_TYPE& im, ARRAY_TYPE& r)
+{
+    try
+    {
+        size_t NDim = kernel.get_number_of_dimensions();
+        size_t srcCHA = kernel.get_size(NDim - 2);
+        size_t dstCHA = kernel.get_size(NDim - 1);
+        size_t P = kernel.get_number_of_elements() / (srcCHA*dstCHA);
+
+        if (use_blocked_kernel_ && blocked_kernel.get_number_of_elements() > 0 && im.get_number_of_elements() == P*srcCHA)
+        {
+            std::vector<size_t> dimR;
+            im.get_dimensions(dimR);
+            dimR[dimR.size() - 1] = dstCHA;
+
+            if (!r.dimensions_equal(&dimR))
+            {
+                r.create(dimR);
+            }
+
+            apply_blocked_kernel(blocked_kernel, P, srcCHA, dstCHA, 1, im.begin(), r.begin());
+        }
+        else
+        {
+            Gadgetron::multiply(kernel, im, res_after_apply_kernel_);
+            this->sum_over_src_channel(res_after_apply_kernel_, r);
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRITOperator<T>::apply_kernel(...) ... ");
+    }
+}
+
+// number of pixels of a tile of the blocked kernels
+// the image of a tile, 64 pixels for all source channels, stays in the cache while all destination channels are computed
+static const size_t spirit_kernel_tile_size = 64;
+
+template <typename T>
+void hoSPIRITOperator<T>::block_kernel(const T* kernel, size_t P, size_t srcCHA, size_t dstCHA, size_t Nk, ARRAY_TYPE& blocked)
+{
+    try
+    {
+        const size_t tile = spirit_kernel_tile_size;
+        size_t numTiles = (P + tile - 1) / tile;
+
+        std::vector<size_t> dim(5);
+        dim[0] = tile;
+        dim[1] = srcCHA;
+        dim[2] = dstCHA;
+        dim[3] = numTiles;
+        dim[4] = Nk;
+
+        if (!blocked.dimensions_equal(&dim))
+        {
+            blocked.create(dim);
+        }
+        Gadgetron::clear(blocked);
+
+        T* pB = blocked.begin();
+
+        long long t;
+#pragma omp parallel for default(none) private(t) shared(kernel, pB, P, srcCHA, dstCHA, Nk, numTiles)
+        for (t = 0; t < (long long)(numTiles*Nk); t++)
+        {
+            size_t k = t / numTiles;
+            size_t p0 = (t - k*numTiles)*tile;
+            size_t np = (p0 + tile <= P) ? tile : P - p0;
+
+            for (size_t d = 0; d < dstCHA; d++)
+            {
+                for (size_t s = 0; s < srcCHA; s++)
+                {
+                    const T* pK = kernel + k*P*srcCHA*dstCHA + d*P*srcCHA + s*P + p0;
+                    T* pT = pB + t*tile*srcCHA*dstCHA + d*tile*srcCHA + s*tile;
+                    memcpy(pT, pK, sizeof(T)*np);
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        GADGET_THROW("Errors in hoSPIRITOperator<T>::block_kernel(...) ... ");
+    }
+}
+
+template <typename T>
+void hoSPIRITOperator<T>::apply_blocked_kernel(const ARRAY_TYPE& blocked, size_t P, size_t srcCHA, size_t dstCHA, size_t N, const T* im, T* r)
+{
+    const size_t tile = spirit_kernel_tile_size;
+    size_t numTiles = blocked.get_size(3);
+    size_t Nk = blocked.get_size(4);
+
+    GADGET_CHECK_THROW(blocked.get_size(0) == tile);
+    GADGET_CHECK_THROW(blocked.get_size(1) == srcCHA);
+    GADGET_CHECK_THROW(blocked.get_size(2) == dstCHA);
+    GADGET_CHECK_THROW(numTiles*tile >= P);
+
+    const T* pB = blocked.begin();
+
+    long long t;
+#pragma omp parallel for default(none) private(t) shared(pB, im, r, P, srcCHA, dstCHA, N, numTiles, Nk)
+    for (t = 0; t < (long long)(numTiles*N); t++)
+    {
+        size_t n = t / numTiles;
+        size_t tt = t - n*numTiles;
+        size_t p0 = tt*tile;
+        size_t np = (p0 + tile <= P) ? tile : P - p0;
+
+        size_t k = (n < Nk) ? n : Nk - 1;
+        const T* pK = pB + (k*numTiles + tt)*tile*srcCHA*dstCHA;
+        const T* pX = im + n*P*srcCHA + p0;
+        T* pR = r + n*P*dstCHA + p0;
+
+        T acc[spirit_kernel_tile_size];
+
+        for (size_t d = 0; d < dstCHA; d++)
+        {
+            const T* pKd = pK + d*tile*srcCHA;
+
+            size_t p;
+            for (p = 0; p < np; p++) acc[p] = pKd[p] * pX[p];
+
+            for (size_t s = 1; s < srcCHA; s++)
+            {
+                const T* pKs = pKd + s*tile;
+                const T* pXs = pX + s*P;
+                for (p = 0; p < np; p++) acc[p] += pKs[p] * pXs[p];
+            }
+
+            memcpy(pR + d*P, acc, sizeof(T)*np);
+        }
+    }
+}
+
 template <typename T>
 void hoSPIRITOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
 {
@@ -206,9 +371,7 @@ void hoSPIRITOperator<T>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_);
-
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_kernel(forward_kernel_, forward_kernel_blocked_, complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
@@ -240,8 +403,7 @@ void hoSPIRITOperator<T>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
         this->convert_to_image(*x, complexIm_);
 
         // apply kernel and sum
-        Gadgetron::multiply(adjoint_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_kernel(adjoint_kernel_, adjoint_kernel_blocked_, complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
@@ -283,9 +445,7 @@ void hoSPIRITOperator<T>::compute_righ_hand_side(const ARRAY_TYPE& x, ARRAY_TYPE
             this->convert_to_image(x, complexIm_);
 
             // apply kernel and sum
-            GADGET_CATCH_THROW(Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_));
-
-            GADGET_CATCH_THROW(this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_));
+            GADGET_CATCH_THROW(this->apply_kernel(forward_kernel_, forward_kernel_blocked_, complexIm_, res_after_apply_kernel_sum_over_));
 
             // go back to kspace 
             this->convert_to_kspace(res_after_apply_kernel_sum_over_, b);
@@ -326,8 +486,7 @@ void hoSPIRITOperator<T>::gradient(ARRAY_TYPE* x, ARRAY_TYPE* g, bool accumulate
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(adjoint_forward_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_kernel(adjoint_forward_kernel_, adjoint_forward_kernel_blocked_, complexIm_, res_after_apply_kernel_sum_over_);
 
         // go back to kspace 
         this->convert_to_kspace(res_after_apply_kernel_sum_over_, *g);
@@ -371,8 +530,7 @@ typename hoSPIRITOperator<T>::REAL hoSPIRITOperator<T>::magnitude(ARRAY_TYPE* x)
         }
 
         // apply kernel and sum
-        Gadgetron::multiply(forward_kernel_, complexIm_, res_after_apply_kernel_);
-        this->sum_over_src_channel(res_after_apply_kernel_, res_after_apply_kernel_sum_over_);
+        this->apply_kernel(forward_kernel_, forward_kernel_blocked_, complexIm_, res_after_apply_kernel_sum_over_);
 
         // L2 norm
         T obj(0);
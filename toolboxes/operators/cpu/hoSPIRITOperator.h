@@ -76,6 +76,11 @@ public:
     /// if true, perform the spirit operation without null space constraint
     bool no_null_space_;
 
+    /// if true, the image domain kernels are also kept in a channel-blocked layout and applied as one
+    /// matrix-vector product per pixel, without the [... srcCHA dstCHA] intermediate and the sum over srcCHA
+    /// must be set before set_forward_kernel
+    bool use_blocked_kernel_;
+
     ///// whether to perform timing
     //bool performTiming_;
 
@@ -103,9 +108,26 @@ protected:
 
     ARRAY_TYPE coil_senMap_;
 
+    // kernels in the channel-blocked layout, see block_kernel
+    ARRAY_TYPE forward_kernel_blocked_;
+    ARRAY_TYPE adjoint_kernel_blocked_;
+    ARRAY_TYPE adjoint_forward_kernel_blocked_;
+
     // utility functions
     void sum_over_src_channel(const ARRAY_TYPE& x, ARRAY_TYPE& r);
 
+    /// r = sum over srcCHA of kernel .* im, with the blocked kernel if it is set
+    /// kernel : [... srcCHA dstCHA], im : [... srcCHA], r : [... dstCHA]
+    void apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& blocked_kernel, const ARRAY_TYPE& im, ARRAY_TYPE& r);
+
+    /// reorder Nk kernels [P srcCHA dstCHA Nk] of P pixels into tiles of pixels, [tile srcCHA dstCHA numTiles Nk]
+    /// the kernel of one tile is contiguous and the last tile is zero padded
+    static void block_kernel(const T* kernel, size_t P, size_t srcCHA, size_t dstCHA, size_t Nk, ARRAY_TYPE& blocked);
+
+    /// r [P dstCHA N] = sum over srcCHA of the blocked kernels and im [P srcCHA N]
+    /// the last kernel is used for n >= Nk
+    static void apply_blocked_kernel(const ARRAY_TYPE& blocked, size_t P, size_t srcCHA, size_t dstCHA, size_t N, const T* im, T* r);
+
     // helper memory
     ARRAY_TYPE kspace_;
     ARRAY_TYPE complexIm_;
@@ -2,6 +2,7 @@
 
 #include "hoNDArray_math.h"
 #include "generalOperator.h"
+#include "hoFiniteDifferences.h"
 
 #include "vector_td_operators.h"
 
@@ -34,84 +35,21 @@ public:
 			throw std::runtime_error("hoTvOperator: input/output array dimensions mismatch");
 		}
 
-		T* in = in_array->get_data_ptr();
-		T* out = out_array->get_data_ptr();
-
-		vector_td<unsigned int,D> dims = from_std_vector<unsigned int, D>(*(in_array->get_dimensions()));
-
-		if (!accumulate)
-			clear(out_array);
-
-#ifdef USE_OMP
-#pragma omp parallel for
-#endif
-		for (int idx=0; idx < in_array->get_number_of_elements(); idx++){
-
-			T xi = in[idx];
-			T result = T(0);
-
-			vector_td<unsigned int,D> co = idx_to_co<D>(idx, dims);
-
-			REAL grad = gradient_(in,dims,co);
-
-			if (grad > limit_) {
-				result += REAL(D)*xi/grad;
-				for (int i = 0; i < D; i++){
-					co[i]+=1;
-					result -= in[co_to_idx<D>((co+dims)%dims,dims)]/grad;
-					co[i]-=1;
-				}
-			}
-
-			for (int i = 0; i < D; i++){
-				co[i]-=1;
-				grad = gradient_(in,dims,co);
-				if (grad > limit_) {
-					result +=(xi-in[co_to_idx<D>((co+dims)%dims,dims)])/grad;
-				}
-				co[i]+=1;
-			}
-			out[idx] += this->weight_*result;
-		}
+		// all forward differences and the inverse gradient magnitudes in one pass, then the divergence
+		tv_magnitude<T,D>(*in_array, limit_, &inv_mag_);
+		tv_gradient<T,D>(*in_array, inv_mag_, this->weight_, *out_array, accumulate);
 	}
 
 
 	virtual REAL magnitude( hoNDArray<T> *in_array )
 	{
-
-		T* in = in_array->get_data_ptr();
-
-		vector_td<unsigned int,D> dims = from_std_vector<unsigned int, D>(*(in_array->get_dimensions()));
-
-		REAL result =0;
-#ifdef USE_OMP
-#pragma omp parallel for reduction(+:result)
-#endif
-		for (int idx=0; idx < in_array->get_number_of_elements(); idx++){
-			vector_td<unsigned int,D> co = idx_to_co<D>(idx, dims);
-			REAL grad = gradient_(in,dims,co);
-			result += this->weight_*grad;
-		}
-
-		return result;
-	}
-
-private:
-
-	REAL inline gradient_(T* in, const vector_td<unsigned int,D> dims, vector_td<unsigned int,D> co)
-	{
-		REAL grad = REAL(0);
-		T xi = in[co_to_idx<D>((co+dims)%dims,dims)];
-		for (int i = 0; i < D; i++){
-			co[i]+=1;
-			T dt = in[co_to_idx<D>((co+dims)%dims,dims)];
-			grad += norm(xi-dt);
-			co[i]-=1;
-		}
-		return std::sqrt(grad);
+		return this->weight_*tv_magnitude<T,D>(*in_array, limit_, NULL);
 	}
 
 protected:
 	REAL limit_;
+
+	// inverse gradient magnitudes, kept across the iterations of a solver
+	hoNDArray<REAL> inv_mag_;
 };
 }
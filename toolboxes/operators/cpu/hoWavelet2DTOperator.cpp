@@ -89,13 +89,7 @@ void hoWavelet2DTOperator<T>::forward_wav(const hoNDArray<T>& x, hoNDArray<T>& y
 
         if (CHA == 1)
         {
-#pragma omp parallel for default(none) private(t) shared(num, RO, E1, E2, W, pX, pY) if ( num > 1)
-            for (t = 0; t<num; t++)
-            {
-                hoNDArray<T> in(RO, E1, E2, pX + t*RO*E1*E2);
-                hoNDArray<T> out(RO, E1, E2, W, pY + t*RO*E1*E2*W);
-                p_active_wav_->transform(in, out, 3, num_of_wav_levels_, true);
-            }
+            p_active_wav_->transform(pX, pY, RO, E1, E2, num, 3, num_of_wav_levels_, true);
         }
         else
         {
@@ -113,15 +107,7 @@ void hoWavelet2DTOperator<T>::forward_wav(const hoNDArray<T>& x, hoNDArray<T>& y
                     hoNDArray<T> in(RO, E1, CHA, E2, pX + t*RO*E1*CHA*E2);
                     Gadgetron::permute(&in, &forward_buf_, &dimOrder);
 
-                    long long cha;
-
-#pragma omp parallel for default(none) private(cha) shared(num, RO, E1, CHA, E2, W, pY, t) if ( CHA > 4 )
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        hoNDArray<T> in_dwt(RO, E1, E2, forward_buf_.begin() + cha*RO*E1*E2);
-                        hoNDArray<T> out(RO, E1, E2, W, pY + t*RO*E1*E2*W*CHA + cha*RO*E1*E2*W);
-                        p_active_wav_->transform(in_dwt, out, 3, num_of_wav_levels_, true);
-                    }
+                    p_active_wav_->transform(forward_buf_.begin(), pY + t*RO*E1*E2*W*CHA, RO, E1, E2, CHA, 3, num_of_wav_levels_, true);
                 }
             }
         }
@@ -172,13 +158,7 @@ void hoWavelet2DTOperator<T>::adjoint_wav(const hoNDArray<T>& x, hoNDArray<T>& y
 
         if (CHA == 1)
         {
-#pragma omp parallel for default(none) private(t) shared(num, RO, E1, E2, W, pX, pY) if ( num > 1)
-            for (t = 0; t<num; t++)
-            {
-                hoNDArray<T> in(RO, E1, E2, W, pX + t*RO*E1*E2*W);
-                hoNDArray<T> out(RO, E1, E2, pY + t*RO*E1*E2);
-                p_active_wav_->transform(in, out, 3, num_of_wav_levels_, false);
-            }
+            p_active_wav_->transform(pX, pY, RO, E1, E2, num, 3, num_of_wav_levels_, false);
         }
         else
         {
@@ -195,14 +175,7 @@ void hoWavelet2DTOperator<T>::adjoint_wav(const hoNDArray<T>& x, hoNDArray<T>& y
                 {
                     hoNDArray<T> out(RO, E1, CHA, E2, pY + t*RO*E1*CHA*E2);
 
-                    long long cha;
-#pragma omp parallel for default(none) private(cha) shared(RO, E1, CHA, E2, W, pX) if ( CHA > 4 )
-                    for (cha = 0; cha<CHA; cha++)
-                    {
-                        hoNDArray<T> in(RO, E1, E2, W, pX + cha*RO*E1*E2*W);
-                        hoNDArray<T> out_idwt(RO, E1, E2, adjoint_buf_.begin() + cha*RO*E1*E2);
-                        p_active_wav_->transform(in, out_idwt, 3, num_of_wav_levels_, false);
-                    }
+                    p_active_wav_->transform(pX + t*RO*E1*E2*W*CHA, adjoint_buf_.begin(), RO, E1, E2, CHA, 3, num_of_wav_levels_, false);
 
                     Gadgetron::permute(&adjoint_buf_, &out, &dimOrder);
                 }
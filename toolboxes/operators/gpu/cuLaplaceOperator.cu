@@ -4,6 +4,7 @@
 #include "vector_td.h"
 #include "vector_td_utilities.h"
 #include "check_CUDA.h"
+#include "cuStencilTile.h"
 
 namespace Gadgetron{
 
@@ -20,38 +21,32 @@ namespace Gadgetron{
     enum { Value = i};
   };
 
-  template<class T, unsigned int D, unsigned int dim> class inner_laplace_functor{
-  public:
-		static __device__ __inline__ void apply(T& val,const T* __restrict__ in, const typename intd<D>::Type dims,const typename intd<D>::Type co, typename intd<D>::Type& stride){
-			for (int d = -1; d < 2; d++)
-				stride[dim]=d;
-				inner_laplace_functor<T,D,dim-1>::apply(val,in,dims,co,stride);
-		}
-  };
-  template<class T, unsigned int D> class inner_laplace_functor<T,D,0>{
-  public:
-  	static __device__ __inline__ void apply(T& val,const T* __restrict__ in, const typename intd<D>::Type dims,const typename intd<D>::Type co, typename intd<D>::Type& stride){
-  		typename intd<D>::Type coN = (co+dims+stride)%dims;
-  		val -= in[co_to_idx<D>(coN,dims)];
-  	}
-  };
+  // The laplacian of the 3^D neighbourhood, 3^D in(c) - sum of in over the neighbourhood, from a shared memory tile
+  template<class REAL, class T, unsigned int D, int BX, int BY, int BZ> __global__ void
+  laplace_kernel( const intd3 dims, const T * __restrict__ in, T * __restrict__ out, bool accumulate )
+  {
+    typedef cuStencilTile<D,BX,BY,BZ> Tile;
 
-  template<class REAL, class T, unsigned int D> __global__ void
-  laplace_kernel( typename intd<D>::Type dims, const T * __restrict__ in, T * __restrict__ out )
-  {  
-    const int idx = blockIdx.y*gridDim.x*blockDim.x + blockIdx.x*blockDim.x + threadIdx.x;
-    if( idx < prod(dims) ){
-    
-      T val = T(0);
-      typename intd<D>::Type coN;
+    // raw storage, as T may have constructors
+    __shared__ __align__(16) unsigned char tile_buffer[Tile::SIZE*sizeof(T)];
+    T* tile = reinterpret_cast<T*>(tile_buffer);
 
-      typename intd<D>::Type co = idx_to_co<D>(idx, dims);
+    Tile::load(in, dims, tile);
+    __syncthreads();
 
-      typename intd<D>::Type stride(0);
+    const int idx = Tile::image_index(dims);
+    if( idx >= 0 ){
 
+      const int i = Tile::center();
+      T val = tile[i]*((REAL) Pow<3,D>::Value);
 
-      inner_laplace_functor<T,D,D-1>::apply(val,in,dims,co,stride);
-      out[idx] = val+in[co_to_idx<D>(co, dims)]*((REAL) Pow<3,D>::Value);
+      for (int z = -Tile::HZ; z <= Tile::HZ; z++)
+        for (int y = -Tile::HY; y <= Tile::HY; y++)
+          for (int x = -1; x <= 1; x++)
+            val -= tile[i + x + y*Tile::STRIDE_Y + z*Tile::STRIDE_Z];
+
+      if (accumulate) out[idx] += val;
+      else out[idx] = val;
     }
   }
 
@@ -63,14 +58,18 @@ namespace Gadgetron{
       throw std::runtime_error("laplaceOperator::compute_laplace : array dimensions mismatch.");
 
     }
-  
-    typename intd<D>::Type dims = vector_td<int,D>( from_std_vector<size_t,D>( *(in->get_dimensions().get()) ));
 
-    dim3 dimBlock( dims[0] );
-    dim3 dimGrid( prod(dims)/dims[0] );
-  
+    typedef cuStencilBlock<D> B;
+    typedef cuStencilTile<D,B::BX,B::BY,B::BZ> Tile;
+
+    const intd3 dims = stencil_dims<D>( *(in->get_dimensions().get()) );
+    const size_t N = prod(dims);
+    const size_t batches = in->get_number_of_elements()/N;
+
     // Invoke kernel
-    laplace_kernel<typename realType<T>::Type ,T,D><<< dimGrid, dimBlock >>> (dims, in->get_data_ptr(), out->get_data_ptr() );
+    for (size_t b = 0; b < batches; b++){
+      laplace_kernel<typename realType<T>::Type,T,D,B::BX,B::BY,B::BZ><<< Tile::grid(dims), Tile::block() >>> (dims, in->get_data_ptr()+b*N, out->get_data_ptr()+b*N, accumulate );
+    }
   
     CHECK_FOR_CUDA_ERROR();
   }
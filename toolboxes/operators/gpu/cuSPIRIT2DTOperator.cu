@@ -0,0 +1,315 @@
+#include "cuSPIRIT2DTOperator.h"
+#include "cuNDArray_operators.h"
+#include "cuNDArray_elemwise.h"
+#include "cuNDArray_expression.h"
+#include "cuNDFFT.h"
+#include "check_CUDA.h"
+#include "setup_grid.h"
+
+#include <stdexcept>
+#include <cfloat>
+
+namespace Gadgetron {
+
+  namespace {
+
+    __inline__ __device__ size_t spirit_thread_index()
+    {
+      return ((size_t)blockIdx.y*gridDim.x + blockIdx.x)*blockDim.x + threadIdx.x;
+    }
+
+    // adjKer(:, dst, src, n) = conj(ker(:, src, dst, n))
+    template <class T> __global__ void spirit_adjoint_kernel_kernel(const T* __restrict__ ker, size_t P, int srcCHA, int dstCHA, size_t num, T* __restrict__ adjKer)
+    {
+      const size_t idx = spirit_thread_index();
+      if (idx >= num) return;
+
+      size_t i = idx;
+      const size_t p = i%P; i /= P;
+      const int src = (int)(i%srcCHA); i /= srcCHA;
+      const int dst = (int)(i%dstCHA);
+      const size_t n = i/dstCHA;
+
+      adjKer[p + P*(dst + (size_t)dstCHA*(src + (size_t)srcCHA*n))] = conj(ker[idx]);
+    }
+
+    // res(:, dst, n) = sum over src of ker(:, src, dst, min(n, kerN-1)) .* im(:, src, n)
+    template <class T> __global__ void spirit_apply_kernel_kernel(const T* __restrict__ ker, const T* __restrict__ im, size_t P, int srcCHA, int dstCHA, int kerN, size_t num, T* __restrict__ res)
+    {
+      const size_t idx = spirit_thread_index();
+      if (idx >= num) return;
+
+      const size_t p = idx%P;
+      const int dst = (int)((idx/P)%dstCHA);
+      const size_t n = idx/(P*dstCHA);
+      const size_t kn = (n < (size_t)kerN) ? n : (size_t)(kerN - 1);
+
+      const T* pKer = ker + p + P*(size_t)srcCHA*(dst + (size_t)dstCHA*kn);
+      const T* pIm = im + p + P*(size_t)srcCHA*n;
+
+      T v(0);
+      for (int src = 0; src < srcCHA; src++) {
+        v += pKer[src*P] * pIm[src*P];
+      }
+
+      res[idx] = v;
+    }
+
+    // acquired points as 1, otherwise 0, as hoSPIRITOperator::set_acquired_points
+    template <class T, class REAL> __global__ void spirit_acquired_points_kernel(const T* __restrict__ kspace, size_t num, T* __restrict__ acq, T* __restrict__ unacq)
+    {
+      const size_t idx = spirit_thread_index();
+      if (idx >= num) return;
+
+      const bool acquired = (abs(kspace[idx]) >= (REAL)DBL_EPSILON);
+      acq[idx] = acquired ? T(1) : T(0);
+      unacq[idx] = acquired ? T(0) : T(1);
+    }
+
+    template <class T, class REAL> __global__ void spirit_restore_acquired_kernel(const T* __restrict__ acquired, size_t num, T* __restrict__ y)
+    {
+      const size_t idx = spirit_thread_index();
+      if (idx >= num) return;
+
+      const T a = acquired[idx];
+      if (abs(a) > REAL(0)) y[idx] = a;
+    }
+  }
+
+  template <class REAL>
+  cuSPIRIT2DTOperator<REAL>::cuSPIRIT2DTOperator() : linearOperator< cuNDArray< complext<REAL> > >(), no_null_space_(false)
+  {
+  }
+
+  template <class REAL>
+  cuSPIRIT2DTOperator<REAL>::~cuSPIRIT2DTOperator()
+  {
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::set_forward_kernel(const ARRAY_TYPE& forward_kernel)
+  {
+    if (forward_kernel.get_number_of_dimensions() < 4)
+      throw std::runtime_error("cuSPIRIT2DTOperator::set_forward_kernel(): the kernel must be [RO E1 srcCHA dstCHA Nor1]");
+
+    size_t RO = forward_kernel.get_size(0);
+    size_t E1 = forward_kernel.get_size(1);
+    size_t srcCHA = forward_kernel.get_size(2);
+    size_t dstCHA = forward_kernel.get_size(3);
+    size_t N = forward_kernel.get_number_of_elements()/(RO*E1*srcCHA*dstCHA);
+
+    // the centered fft is built from the timeswitch, see convert_to_image
+    if (RO%2 != 0 || E1%2 != 0)
+      throw std::runtime_error("cuSPIRIT2DTOperator::set_forward_kernel(): RO and E1 must be even");
+
+    forward_kernel_ = forward_kernel;
+
+    std::vector<size_t> dims;
+    dims.push_back(RO);
+    dims.push_back(E1);
+    dims.push_back(dstCHA);
+    dims.push_back(srcCHA);
+    dims.push_back(N);
+    adjoint_kernel_.create(&dims);
+
+    dim3 blockDim, gridDim;
+    setup_grid(forward_kernel_.get_number_of_elements(), &blockDim, &gridDim);
+
+    spirit_adjoint_kernel_kernel<<< gridDim, blockDim >>>(forward_kernel_.get_data_ptr(), RO*E1, (int)srcCHA, (int)dstCHA,
+                                                          forward_kernel_.get_number_of_elements(), adjoint_kernel_.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::set_acquired_points(const ARRAY_TYPE& kspace)
+  {
+    acquired_points_ = kspace;
+
+    boost::shared_ptr< std::vector<size_t> > dims = kspace.get_dimensions();
+    acquired_points_indicator_.create(dims.get());
+    unacquired_points_indicator_.create(dims.get());
+
+    dim3 blockDim, gridDim;
+    setup_grid(kspace.get_number_of_elements(), &blockDim, &gridDim);
+
+    spirit_acquired_points_kernel<T, REAL><<< gridDim, blockDim >>>(kspace.get_data_ptr(), kspace.get_number_of_elements(),
+                                                                    acquired_points_indicator_.get_data_ptr(), unacquired_points_indicator_.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::restore_acquired_kspace(ARRAY_TYPE& y)
+  {
+    if (y.get_number_of_elements() != acquired_points_.get_number_of_elements())
+      throw std::runtime_error("cuSPIRIT2DTOperator::restore_acquired_kspace(): the acquired points are not set for y");
+
+    dim3 blockDim, gridDim;
+    setup_grid(y.get_number_of_elements(), &blockDim, &gridDim);
+
+    spirit_restore_acquired_kernel<T, REAL><<< gridDim, blockDim >>>(acquired_points_.get_data_ptr(), y.get_number_of_elements(), y.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::convert_to_image(const ARRAY_TYPE& x, ARRAY_TYPE& im)
+  {
+    // ifft2 applies the timeswitch before the transform, the second one makes it the centered ifft2c up to the sign
+    if (&im != &x) im = x;
+    cuNDFFT<REAL>::instance()->ifft2(&im);
+    timeswitch2D(&im);
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::convert_to_kspace(const ARRAY_TYPE& im, ARRAY_TYPE& x)
+  {
+    // fft2 applies the timeswitch after the transform
+    if (&x != &im) x = im;
+    timeswitch2D(&x);
+    cuNDFFT<REAL>::instance()->fft2(&x);
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& im, ARRAY_TYPE& res)
+  {
+    size_t RO = im.get_size(0);
+    size_t E1 = im.get_size(1);
+    size_t srcCHA = kernel.get_size(2);
+    size_t dstCHA = kernel.get_size(3);
+    size_t N = im.get_number_of_elements()/(RO*E1*srcCHA);
+    size_t kerN = kernel.get_number_of_elements()/(RO*E1*srcCHA*dstCHA);
+
+    if (kernel.get_size(0) != RO || kernel.get_size(1) != E1 || im.get_size(2) != srcCHA)
+      throw std::runtime_error("cuSPIRIT2DTOperator::apply_kernel(): the image does not match the kernel");
+
+    std::vector<size_t> dims;
+    dims.push_back(RO);
+    dims.push_back(E1);
+    dims.push_back(dstCHA);
+    dims.push_back(N);
+
+    if (!res.dimensions_equal(&dims)) res.create(&dims);
+
+    dim3 blockDim, gridDim;
+    setup_grid(res.get_number_of_elements(), &blockDim, &gridDim);
+
+    spirit_apply_kernel_kernel<<< gridDim, blockDim >>>(kernel.get_data_ptr(), im.get_data_ptr(), RO*E1, (int)srcCHA, (int)dstCHA, (int)kerN,
+                                                        res.get_number_of_elements(), res.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    if (no_null_space_)
+    {
+      this->convert_to_image(*x, complexIm_);
+    }
+    else
+    {
+      // (G-I)Dc'x
+      if (!kspace_.dimensions_equal(x)) kspace_.create(x->get_dimensions().get());
+      assign(kspace_, lazy(*x) * lazy(unacquired_points_indicator_));
+      this->convert_to_image(kspace_, complexIm_);
+    }
+
+    // apply kernel and sum
+    this->apply_kernel(forward_kernel_, complexIm_, res_after_apply_kernel_sum_over_);
+
+    // go back to kspace
+    if (accumulate)
+    {
+      this->convert_to_kspace(res_after_apply_kernel_sum_over_, kspace_);
+      *y += kspace_;
+    }
+    else
+    {
+      this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
+    }
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTOperator<REAL>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    // Dc(G-I)'x
+    this->convert_to_image(*x, complexIm_);
+
+    // apply adjoint kernel and sum
+    this->apply_kernel(adjoint_kernel_, complexIm_, res_after_apply_kernel_sum_over_);
+
+    if (!accumulate)
+    {
+      this->convert_to_kspace(res_after_apply_kernel_sum_over_, *y);
+
+      // apply Dc
+      if (!no_null_space_) assign(*y, lazy(*y) * lazy(unacquired_points_indicator_));
+    }
+    else
+    {
+      this->convert_to_kspace(res_after_apply_kernel_sum_over_, kspace_);
+
+      // apply Dc and accumulate in one pass
+      if (no_null_space_)
+        *y += kspace_;
+      else
+        assign(*y, lazy(*y) + lazy(kspace_) * lazy(unacquired_points_indicator_));
+    }
+  }
+
+  // ------------------------------------------------------------
+
+  template <class REAL>
+  cuSPIRIT2DTDataFidelityOperator<REAL>::cuSPIRIT2DTDataFidelityOperator() : BaseClass()
+  {
+    this->no_null_space_ = true;
+  }
+
+  template <class REAL>
+  cuSPIRIT2DTDataFidelityOperator<REAL>::~cuSPIRIT2DTDataFidelityOperator()
+  {
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTDataFidelityOperator<REAL>::apply(const ARRAY_TYPE& kernel, ARRAY_TYPE& x, ARRAY_TYPE& y, bool accumulate)
+  {
+    // x to image domain
+    this->convert_to_image(x, this->complexIm_);
+
+    // G-I or (G-I)'
+    this->apply_kernel(kernel, this->complexIm_, this->res_after_apply_kernel_sum_over_);
+
+    if (accumulate)
+    {
+      this->convert_to_kspace(this->res_after_apply_kernel_sum_over_, this->kspace_);
+      y += this->kspace_;
+    }
+    else
+    {
+      this->convert_to_kspace(this->res_after_apply_kernel_sum_over_, y);
+    }
+
+    // apply D, acquired points, D' = D
+    assign(y, lazy(y) + lazy(x) * lazy(this->acquired_points_indicator_));
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTDataFidelityOperator<REAL>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    this->apply(this->forward_kernel_, *x, *y, accumulate);
+  }
+
+  template <class REAL>
+  void cuSPIRIT2DTDataFidelityOperator<REAL>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    this->apply(this->adjoint_kernel_, *x, *y, accumulate);
+  }
+
+  // ------------------------------------------------------------
+  // Instantiation
+  // ------------------------------------------------------------
+
+  template class EXPORTGPUOPERATORS cuSPIRIT2DTOperator<float>;
+  template class EXPORTGPUOPERATORS cuSPIRIT2DTOperator<double>;
+
+  template class EXPORTGPUOPERATORS cuSPIRIT2DTDataFidelityOperator<float>;
+  template class EXPORTGPUOPERATORS cuSPIRIT2DTDataFidelityOperator<double>;
+}
@@ -0,0 +1,96 @@
+/** \file       cuSPIRIT2DTOperator.h
+    \brief      SPIRIT operator for 2D+T cases on the gpu, following hoSPIRIT2DTOperator and hoSPIRIT2DTDataFidelityOperator
+
+    The image domain kernels are the ones of spirit2d_image_domain_kernel, e.g. computed on the cpu and uploaded.
+    The fft is the centered 2D fft of hoNDFFT::fft2c up to a global sign, which cancels in F'GF and in the
+    wavelet terms, so the results are the ones of the cpu operators up to the float rounding.
+    RO and E1 must be even.
+*/
+
+#pragma once
+
+#include "gpuoperators_export.h"
+#include "linearOperator.h"
+#include "cuNDArray.h"
+#include "complext.h"
+
+namespace Gadgetron {
+
+template <class REAL>
+class EXPORTGPUOPERATORS cuSPIRIT2DTOperator : public linearOperator< cuNDArray< complext<REAL> > >
+{
+public:
+
+    typedef complext<REAL> T;
+    typedef cuNDArray<T> ARRAY_TYPE;
+
+    cuSPIRIT2DTOperator();
+    virtual ~cuSPIRIT2DTOperator();
+
+    /// set forward kernel and compute the adjoint kernel
+    /// forward_kernel : [RO E1 srcCHA dstCHA Nor1]
+    /// the number of kernels can be 1 or equal to the number of 2D kspaces
+    virtual void set_forward_kernel(const ARRAY_TYPE& forward_kernel);
+
+    /// set the acquired kspace [RO E1 srcCHA N], unacquired points are zero
+    virtual void set_acquired_points(const ARRAY_TYPE& kspace);
+
+    /// restore acquired kspace points to y
+    virtual void restore_acquired_kspace(ARRAY_TYPE& y);
+
+    /// apply (G-I)Dc'
+    /// x: [RO E1 srcCHA N]
+    /// y: [RO E1 dstCHA N]
+    virtual void mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+    /// apply Dc(G-I)'
+    virtual void mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+
+    /// if true, perform the spirit operation without null space constraint
+    bool no_null_space_;
+
+protected:
+
+    /// centered 2D fft, out can be in
+    void convert_to_image(const ARRAY_TYPE& x, ARRAY_TYPE& im);
+    void convert_to_kspace(const ARRAY_TYPE& im, ARRAY_TYPE& x);
+
+    /// res [RO E1 dstCHA N] = sum over srcCHA of kernel .* im [RO E1 srcCHA N], the last kernel is used beyond Nor1
+    void apply_kernel(const ARRAY_TYPE& kernel, const ARRAY_TYPE& im, ARRAY_TYPE& res);
+
+    ARRAY_TYPE forward_kernel_;
+    ARRAY_TYPE adjoint_kernel_;
+
+    ARRAY_TYPE acquired_points_;
+    ARRAY_TYPE acquired_points_indicator_;
+    ARRAY_TYPE unacquired_points_indicator_;
+
+    // helper memory
+    ARRAY_TYPE complexIm_;
+    ARRAY_TYPE res_after_apply_kernel_sum_over_;
+    ARRAY_TYPE kspace_;
+};
+
+/// SPIRIT 2DT operator with data fidelity, as hoSPIRIT2DTDataFidelityOperator
+/// x is the kspace, including acquired and unacquired points
+template <class REAL>
+class EXPORTGPUOPERATORS cuSPIRIT2DTDataFidelityOperator : public cuSPIRIT2DTOperator<REAL>
+{
+public:
+
+    typedef cuSPIRIT2DTOperator<REAL> BaseClass;
+    typedef typename BaseClass::ARRAY_TYPE ARRAY_TYPE;
+
+    cuSPIRIT2DTDataFidelityOperator();
+    virtual ~cuSPIRIT2DTDataFidelityOperator();
+
+    /// y = [(G-I) + D]*x
+    virtual void mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+    /// y = [(G-I)' + D']*x
+    virtual void mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+
+protected:
+
+    void apply(const ARRAY_TYPE& kernel, ARRAY_TYPE& x, ARRAY_TYPE& y, bool accumulate);
+};
+
+}
@@ -0,0 +1,108 @@
+/** \file cuStencilTile.h
+    \brief Shared memory tiles for the periodic nearest neighbour stencils of the GPU operators.
+
+    A thread block of BX*BY*BZ threads computes a BX*BY*BZ block of the output. The block and a halo of one pixel
+    along each of the D stencil dimensions are read into shared memory once, with periodic boundaries, and all
+    directional differences of the stencil are taken from there. Arrays of dimension 1 and 2 are processed as
+    3D arrays with unit extent and no halo in the missing dimensions.
+
+    Only for inclusion in the .cu files of the operators.
+*/
+
+#pragma once
+
+#include "vector_td.h"
+
+#include <vector>
+
+namespace Gadgetron{
+
+  template<unsigned int D, int BX, int BY, int BZ> struct cuStencilTile
+  {
+    // halo along x, y and z
+    enum { HX = 1, HY = (D > 1) ? 1 : 0, HZ = (D > 2) ? 1 : 0 };
+
+    // extent of the tile with its halo
+    enum { SX = BX + 2*HX, SY = BY + 2*HY, SZ = BZ + 2*HZ, SIZE = SX*SY*SZ };
+
+    // strides of the tile
+    enum { STRIDE_Y = SX, STRIDE_Z = SX*SY };
+
+    enum { THREADS = BX*BY*BZ };
+
+    static __device__ __inline__ int thread_index()
+    {
+      return threadIdx.x + BX*(threadIdx.y + BY*threadIdx.z);
+    }
+
+    /// tile index of the pixel of this thread
+    static __device__ __inline__ int center()
+    {
+      return (threadIdx.x + HX) + STRIDE_Y*(threadIdx.y + HY) + STRIDE_Z*(threadIdx.z + HZ);
+    }
+
+    /// tile coordinates of tile index i
+    static __device__ __inline__ void coordinates(int i, int& x, int& y, int& z)
+    {
+      x = i % SX;
+      y = (i / SX) % SY;
+      z = i / STRIDE_Z;
+    }
+
+    /// first pixel of the block of this thread block, dims padded with 1 to three dimensions
+    static __device__ __inline__ intd3 origin()
+    {
+      return intd3(blockIdx.x*BX, blockIdx.y*BY, blockIdx.z*BZ);
+    }
+
+    /// index into the image of the pixel of this thread, or -1 outside of the image
+    static __device__ __inline__ int image_index(const intd3& dims)
+    {
+      const int x = blockIdx.x*BX + threadIdx.x;
+      const int y = blockIdx.y*BY + threadIdx.y;
+      const int z = blockIdx.z*BZ + threadIdx.z;
+      if (x >= dims[0] || y >= dims[1] || z >= dims[2]) return -1;
+      return x + dims[0]*(y + dims[1]*z);
+    }
+
+    /// read the block and its halo into tile; the caller synchronizes the threads before using it
+    template<class T> static __device__ __inline__ void load(const T* __restrict__ in, const intd3& dims, T* tile)
+    {
+      const intd3 o = origin();
+      for (int i = thread_index(); i < SIZE; i += THREADS){
+        int x, y, z;
+        coordinates(i, x, y, z);
+        // the halo reaches one pixel beyond either side of the image at most
+        const int gx = (o[0] + x - HX + dims[0]) % dims[0];
+        const int gy = (o[1] + y - HY + dims[1]) % dims[1];
+        const int gz = (o[2] + z - HZ + dims[2]) % dims[2];
+        tile[i] = in[gx + dims[0]*(gy + dims[1]*gz)];
+      }
+    }
+
+    /// launch configuration for an image of dims
+    static dim3 grid(const intd3& dims)
+    {
+      return dim3((dims[0] + BX - 1)/BX, (dims[1] + BY - 1)/BY, (dims[2] + BZ - 1)/BZ);
+    }
+
+    static dim3 block()
+    {
+      return dim3(BX, BY, BZ);
+    }
+  };
+
+  /// the first D dimensions of an array padded with 1 to three dimensions
+  template<unsigned int D> inline intd3 stencil_dims(const std::vector<size_t>& dimensions)
+  {
+    intd3 dims(1, 1, 1);
+    for (unsigned int d = 0; d < D && d < 3; d++) dims[d] = (int)dimensions[d];
+    return dims;
+  }
+
+  /// block shapes of the tiles, 256 threads each
+  template<unsigned int D> struct cuStencilBlock;
+  template<> struct cuStencilBlock<1> { enum { BX = 256, BY = 1, BZ = 1 }; };
+  template<> struct cuStencilBlock<2> { enum { BX = 32, BY = 8, BZ = 1 }; };
+  template<> struct cuStencilBlock<3> { enum { BX = 16, BY = 4, BZ = 4 }; };
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "check_CUDA.h"
 #include "cudaDeviceManager.h"
+#include "cuStencilTile.h"
 #include <stdio.h>
 
 using namespace Gadgetron;
@@ -57,6 +58,102 @@ template<class REAL, class T, unsigned int D> static __global__ void tvGradient_
 	}
 }
 
+// Tiled kernels for D <= 3. The inverse gradient magnitudes of the block and of the pixels one before it along each
+// dimension are computed once into shared memory, then every pixel gathers its gradient from them, in one launch.
+template<class REAL, class T, unsigned int D, int BX, int BY, int BZ> static __global__ void tvGradient_tiled_kernel(const T* __restrict__ in, T* __restrict__ out, const intd3 dims, REAL limit, REAL weight)
+{
+	typedef cuStencilTile<D,BX,BY,BZ> Tile;
+
+	// raw storage, as T may have constructors
+	__shared__ __align__(16) unsigned char tile_buffer[Tile::SIZE*sizeof(T)];
+	__shared__ REAL inv_grad[Tile::SIZE];
+	T* tile = reinterpret_cast<T*>(tile_buffer);
+
+	Tile::load(in, dims, tile);
+	__syncthreads();
+
+	// all but the last tile position along each stencil dimension have their forward neighbours in the tile
+	for (int i = Tile::thread_index(); i < Tile::SIZE; i += Tile::THREADS){
+		int x, y, z;
+		Tile::coordinates(i, x, y, z);
+		if (x < Tile::SX-1 && (D < 2 || y < Tile::SY-1) && (D < 3 || z < Tile::SZ-1)){
+			const T xi = tile[i];
+			REAL grad = norm(xi-tile[i+1]);
+			if (D > 1) grad += norm(xi-tile[i+Tile::STRIDE_Y]);
+			if (D > 2) grad += norm(xi-tile[i+Tile::STRIDE_Z]);
+			grad = sqrt(grad);
+			inv_grad[i] = (grad > limit) ? REAL(1)/grad : REAL(0);
+		}
+	}
+	__syncthreads();
+
+	const int idx = Tile::image_index(dims);
+	if (idx >= 0){
+		const int i = Tile::center();
+		const T xi = tile[i];
+
+		T forward = xi-tile[i+1];
+		T result = (xi-tile[i-1])*inv_grad[i-1];
+		if (D > 1){
+			forward += xi-tile[i+Tile::STRIDE_Y];
+			result += (xi-tile[i-Tile::STRIDE_Y])*inv_grad[i-Tile::STRIDE_Y];
+		}
+		if (D > 2){
+			forward += xi-tile[i+Tile::STRIDE_Z];
+			result += (xi-tile[i-Tile::STRIDE_Z])*inv_grad[i-Tile::STRIDE_Z];
+		}
+		result += forward*inv_grad[i];
+
+		out[idx] += result*weight;
+	}
+}
+
+template<class REAL, class T, unsigned int D, int BX, int BY, int BZ> static __global__ void tvMagnitude_tiled_kernel(const T* __restrict__ in, T* __restrict__ out, const intd3 dims, REAL weight)
+{
+	typedef cuStencilTile<D,BX,BY,BZ> Tile;
+
+	__shared__ __align__(16) unsigned char tile_buffer[Tile::SIZE*sizeof(T)];
+	T* tile = reinterpret_cast<T*>(tile_buffer);
+
+	Tile::load(in, dims, tile);
+	__syncthreads();
+
+	const int idx = Tile::image_index(dims);
+	if (idx >= 0){
+		const int i = Tile::center();
+		const T xi = tile[i];
+		REAL grad = norm(xi-tile[i+1]);
+		if (D > 1) grad += norm(xi-tile[i+Tile::STRIDE_Y]);
+		if (D > 2) grad += norm(xi-tile[i+Tile::STRIDE_Z]);
+		out[idx] = sqrt(grad)*weight;
+	}
+}
+
+// Launches the kernels on every image of a batch, tiled for D <= 3
+template<class REAL, class T, unsigned int D, bool TILED = (D <= 3)> struct tvLauncher
+{
+	typedef cuStencilBlock<D> B;
+	typedef cuStencilTile<D,B::BX,B::BY,B::BZ> Tile;
+
+	static void gradient(const T* in, T* out, std::vector<size_t>& dimensions, size_t batches, REAL limit, REAL weight)
+	{
+		const intd3 dims = stencil_dims<D>(dimensions);
+		const size_t N = prod(dims);
+		for (size_t i = 0; i < batches; i++){
+			tvGradient_tiled_kernel<REAL,T,D,B::BX,B::BY,B::BZ><<<Tile::grid(dims),Tile::block()>>>(in+i*N,out+i*N,dims,limit,weight);
+		}
+	}
+
+	static void magnitude(const T* in, T* out, std::vector<size_t>& dimensions, size_t batches, REAL weight)
+	{
+		const intd3 dims = stencil_dims<D>(dimensions);
+		const size_t N = prod(dims);
+		for (size_t i = 0; i < batches; i++){
+			tvMagnitude_tiled_kernel<REAL,T,D,B::BX,B::BY,B::BZ><<<Tile::grid(dims),Tile::block()>>>(in+i*N,out+i*N,dims,weight);
+		}
+	}
+};
+
 
 
 
@@ -69,19 +166,10 @@ template<class T, unsigned int D> void cuTvOperator<T,D>::gradient (cuNDArray<T>
 	if (!accumulate)
 		clear(out);
 
-	const typename intd<D>::Type dims = vector_td<int,D>( from_std_vector<size_t,D>(*(in->get_dimensions())));
-	int elements = in->get_number_of_elements();
+	std::vector<size_t> dimensions = *(in->get_dimensions());
+	const size_t N = prod(from_std_vector<size_t,D>(dimensions));
 
-	int threadsPerBlock =std::min(prod(dims),256); //Using hardcoded blockSize because we use quite a lot of registers
-
-	dim3 dimBlock( threadsPerBlock);
-	int totalBlocksPerGridx = std::min(std::max(1,prod(dims)/threadsPerBlock),cudaDeviceManager::Instance()->max_griddim());
-	int totalBlocksPerGridy = (prod(dims)-1)/(threadsPerBlock*totalBlocksPerGridx)+1;
-	dim3 dimGrid(totalBlocksPerGridx,totalBlocksPerGridy);
-
-	for (int i =0; i < (elements/prod(dims)); i++){
-		tvGradient_kernel<<<dimGrid,dimBlock>>>(in->get_data_ptr()+i*prod(dims),out->get_data_ptr()+i*prod(dims),dims,limit_,this->weight_);
-	}
+	tvLauncher<REAL,T,D>::gradient(in->get_data_ptr(),out->get_data_ptr(),dimensions,in->get_number_of_elements()/N,limit_,this->weight_);
 
 	//cudaDeviceSynchronize();
 	//CHECK_FOR_CUDA_ERROR();
@@ -99,21 +187,49 @@ template<class REAL, class T, unsigned int D> static __global__ void tvMagnitude
 }
 
 
+// Generic kernels, for D > 3
+template<class REAL, class T, unsigned int D> struct tvLauncher<REAL,T,D,false>
+{
+	static void configuration(const vector_td<int,D>& dims, dim3& dimBlock, dim3& dimGrid)
+	{
+		int threadsPerBlock =std::min(prod(dims),256); //Using hardcoded blockSize because we use quite a lot of registers
+		dimBlock = dim3( threadsPerBlock);
+		int totalBlocksPerGridx = std::min(std::max(1,prod(dims)/threadsPerBlock),cudaDeviceManager::Instance()->max_griddim());
+		int totalBlocksPerGridy = (prod(dims)-1)/(threadsPerBlock*totalBlocksPerGridx)+1;
+		dimGrid = dim3(totalBlocksPerGridx,totalBlocksPerGridy);
+	}
+
+	static void gradient(const T* in, T* out, std::vector<size_t>& dimensions, size_t batches, REAL limit, REAL weight)
+	{
+		const typename intd<D>::Type dims = vector_td<int,D>( from_std_vector<size_t,D>(dimensions));
+		dim3 dimBlock, dimGrid;
+		configuration(dims,dimBlock,dimGrid);
+
+		for (size_t i =0; i < batches; i++){
+			tvGradient_kernel<<<dimGrid,dimBlock>>>(in+i*prod(dims),out+i*prod(dims),dims,limit,weight);
+		}
+	}
+
+	static void magnitude(const T* in, T* out, std::vector<size_t>& dimensions, size_t batches, REAL weight)
+	{
+		const typename intd<D>::Type dims = vector_td<int,D>( from_std_vector<size_t,D>(dimensions));
+		dim3 dimBlock, dimGrid;
+		configuration(dims,dimBlock,dimGrid);
+
+		for (size_t i =0; i < batches; i++){
+			tvMagnitude_kernel<<<dimGrid,dimBlock>>>(in+i*prod(dims),out+i*prod(dims),dims,REAL(0),weight);
+		}
+	}
+};
+
 template<class T, unsigned int D> typename realType<T>::Type cuTvOperator<T,D>::magnitude (cuNDArray<T> * in)
 {
 	cuNDArray<T> out(in->get_dimensions());
-	const typename intd<D>::Type dims = vector_td<int,D>( from_std_vector<size_t,D>(*(in->get_dimensions())));
-	int elements = in->get_number_of_elements();
 
-	int threadsPerBlock =std::min(prod(dims),256); //Using hardcoded blockSize because we use quite a lot of registers
-	dim3 dimBlock( threadsPerBlock);
-	int totalBlocksPerGridx = std::min(std::max(1,prod(dims)/threadsPerBlock),cudaDeviceManager::Instance()->max_griddim());
-	int totalBlocksPerGridy = (prod(dims)-1)/(threadsPerBlock*totalBlocksPerGridx)+1;
-	dim3 dimGrid(totalBlocksPerGridx,totalBlocksPerGridy);
+	std::vector<size_t> dimensions = *(in->get_dimensions());
+	const size_t N = prod(from_std_vector<size_t,D>(dimensions));
 
-	for (int i =0; i < (elements/prod(dims)); i++){
-		tvMagnitude_kernel<<<dimGrid,dimBlock>>>(in->get_data_ptr()+i*prod(dims),out.get_data_ptr()+i*prod(dims),dims,limit_,this->weight_);
-	}
+	tvLauncher<REAL,T,D>::magnitude(in->get_data_ptr(),out.get_data_ptr(),dimensions,in->get_number_of_elements()/N,this->weight_);
 
 	//cudaDeviceSynchronize();
 	//CHECK_FOR_CUDA_ERROR();
@@ -0,0 +1,554 @@
+#include "cuWavelet2DTOperator.h"
+#include "cuNDArray_operators.h"
+#include "cuNDArray_elemwise.h"
+#include "cuNDArray_expression.h"
+#include "cuNDArray_blas.h"
+#include "cuNDFFT.h"
+#include "check_CUDA.h"
+#include "setup_grid.h"
+
+#include <stdexcept>
+#include <cfloat>
+
+namespace Gadgetron {
+
+  namespace {
+
+    __inline__ __device__ size_t wav_thread_index()
+    {
+      return ((size_t)blockIdx.y*gridDim.x + blockIdx.x)*blockDim.x + threadIdx.x;
+    }
+
+    // coefficients 2, 3, 6, 7 are scaled by s1, 1, 3, 5, 7 by s2 and 4, 5, 6, 7 by s3, as hoWavelet2DTOperator::apply_scale_*_dimension
+    template <class REAL> __inline__ __device__ REAL wav_coeff_weight(size_t w, REAL s1, REAL s2, REAL s3)
+    {
+      if (w == 0) return REAL(1);
+
+      const int k = (int)((w - 1)%7) + 1;
+      REAL r = REAL(1);
+      if (k == 2 || k == 3 || k == 6 || k == 7) r *= s1;
+      if (k & 1) r *= s2;
+      if (k >= 4) r *= s3;
+      return r;
+    }
+
+    // one level of the redundant harr transform of hoNDHarrWavelet::dwt3D
+    // band k filters RO with the high pass if bit 0 of k is set, E1 for bit 1 and E2 for bit 2
+    // src(ro, e1, e2, cha) is at src[ro + e1*RO + e2*srcStrideE2 + cha*srcStrideCHA], low(ro, e1, e2, cha) at low[ro + e1*RO + e2*RO*E1 + cha*lowStrideCHA]
+    template <class T, class REAL> __global__ void harr_forward_level_kernel(const T* __restrict__ src, size_t srcStrideE2, size_t srcStrideCHA,
+                                                                 T* __restrict__ low, size_t lowStrideCHA, T* __restrict__ y,
+                                                                 int RO, int E1, int E2, int W, int level, size_t num)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      size_t i = idx;
+      const int ro = (int)(i%RO); i /= RO;
+      const int e1 = (int)(i%E1); i /= E1;
+      const int e2 = (int)(i%E2);
+      const size_t cha = i/E2;
+
+      const int ro2[2] = { ro, (ro + 1)%RO };
+      const int e12[2] = { e1, (e1 + 1)%E1 };
+      const int e22[2] = { e2, (e2 + 1)%E2 };
+
+      T v[8];
+      for (int c = 0; c < 2; c++) {
+        for (int b = 0; b < 2; b++) {
+          for (int a = 0; a < 2; a++) {
+            v[a + 2*b + 4*c] = src[ro2[a] + (size_t)e12[b]*RO + e22[c]*srcStrideE2 + cha*srcStrideCHA];
+          }
+        }
+      }
+
+      const size_t N3D = (size_t)RO*E1*E2;
+      const size_t offset = ro + (size_t)e1*RO + (size_t)e2*RO*E1;
+
+      for (int k = 0; k < 8; k++) {
+        T r(0);
+        for (int j = 0; j < 8; j++) {
+          // the high pass takes the difference with the next sample
+          if (__popc(j & k) & 1) r -= v[j];
+          else r += v[j];
+        }
+        r *= REAL(0.125);
+
+        if (k == 0) low[offset + cha*lowStrideCHA] = r;
+        else y[offset + (7*level + k)*N3D + cha*N3D*W] = r;
+      }
+    }
+
+    // one level of hoNDHarrWavelet::idwt3D, which is the adjoint of the forward level
+    // out(ro, e1, e2, cha) is at out[ro + e1*RO + e2*outStrideE2 + cha*outStrideCHA]
+    template <class T, class REAL> __global__ void harr_inverse_level_kernel(const T* __restrict__ low, size_t lowStrideCHA, const T* __restrict__ x,
+                                                                 T* __restrict__ out, size_t outStrideE2, size_t outStrideCHA,
+                                                                 int RO, int E1, int E2, int W, int level, size_t num)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      size_t i = idx;
+      const int ro = (int)(i%RO); i /= RO;
+      const int e1 = (int)(i%E1); i /= E1;
+      const int e2 = (int)(i%E2);
+      const size_t cha = i/E2;
+
+      const int ro2[2] = { ro, (ro + RO - 1)%RO };
+      const int e12[2] = { e1, (e1 + E1 - 1)%E1 };
+      const int e22[2] = { e2, (e2 + E2 - 1)%E2 };
+
+      const size_t N3D = (size_t)RO*E1*E2;
+
+      T r(0);
+      for (int j = 0; j < 8; j++) {
+        const size_t offset = ro2[j & 1] + (size_t)e12[(j >> 1) & 1]*RO + (size_t)e22[(j >> 2) & 1]*RO*E1;
+
+        for (int k = 0; k < 8; k++) {
+          const T c = (k == 0) ? low[offset + cha*lowStrideCHA] : x[offset + (7*level + k)*N3D + cha*N3D*W];
+          if (__popc(j & k) & 1) r -= c;
+          else r += c;
+        }
+      }
+
+      r *= REAL(0.125);
+      out[ro + (size_t)e1*RO + e2*outStrideE2 + cha*outStrideCHA] = r;
+    }
+
+    // combined(:, n) = sum over cha of x(:, cha, n) .* conj(coilMap(:, cha, min(n, coilN-1))), as coil_combine
+    template <class T> __global__ void wav_coil_combine_kernel(const T* __restrict__ x, const T* __restrict__ coilMap, size_t P, int CHA, int coilN, size_t num, T* __restrict__ combined)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      const size_t p = idx%P;
+      const size_t n = idx/P;
+      const size_t cn = (n < (size_t)coilN) ? n : (size_t)(coilN - 1);
+
+      T v(0);
+      for (int cha = 0; cha < CHA; cha++) {
+        v += x[p + P*(cha + (size_t)CHA*n)] * conj(coilMap[p + P*(cha + (size_t)CHA*cn)]);
+      }
+
+      combined[idx] = v;
+    }
+
+    // y(:, cha, n) = coilMap(:, cha, min(n, coilN-1)) .* im(:, n)
+    template <class T> __global__ void wav_coil_expand_kernel(const T* __restrict__ im, const T* __restrict__ coilMap, size_t P, int CHA, int coilN, size_t num, T* __restrict__ y)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      const size_t p = idx%P;
+      const size_t n = idx/(P*CHA);
+      const size_t cha = (idx/P)%CHA;
+      const size_t cn = (n < (size_t)coilN) ? n : (size_t)(coilN - 1);
+
+      y[idx] = coilMap[p + P*(cha + (size_t)CHA*cn)] * im[p + P*n];
+    }
+
+    // 1 for the unacquired points, as hoWaveletOperator::set_acquired_points
+    template <class T, class REAL> __global__ void wav_unacquired_points_kernel(const T* __restrict__ kspace, size_t num, T* __restrict__ unacq)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      unacq[idx] = (abs(kspace[idx]) < (REAL)DBL_EPSILON) ? T(1) : T(0);
+    }
+
+    // norm(:, w) = weight(w) * sqrt(sum over cha of |c(:, w, cha)|^2)
+    template <class T, class REAL> __global__ void wav_coeff_norm_kernel(const T* __restrict__ c, size_t N3D, int W, int CHA, REAL s1, REAL s2, REAL s3, size_t num, REAL* __restrict__ pNorm)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      const size_t M = N3D*W;
+
+      REAL v(0);
+      for (int cha = 0; cha < CHA; cha++) {
+        v += norm(c[idx + cha*M]);
+      }
+
+      pNorm[idx] = wav_coeff_weight(idx/N3D, s1, s2, s3) * sqrt(v);
+    }
+
+    // soft thresholding of hoWavelet2DTOperator::shrink_wav_coeff, the threshold of coefficient w is thres*weight(w)
+    template <class T, class REAL> __global__ void wav_shrink_kernel(T* __restrict__ c, const REAL* __restrict__ pNorm, bool norm_across_cha, size_t N3D, int W, int startW,
+                                                                     REAL thres, REAL s1, REAL s2, REAL s3, size_t num)
+    {
+      const size_t idx = wav_thread_index();
+      if (idx >= num) return;
+
+      const size_t M = N3D*W;
+      const size_t w = (idx%M)/N3D;
+      if (w < (size_t)startW) return;
+
+      const REAL t = thres * wav_coeff_weight(w, s1, s2, s3);
+      const REAL n = norm_across_cha ? pNorm[idx%M] : abs(c[idx]);
+
+      if (n < t) {
+        c[idx] = T(0);
+      }
+      else {
+        const T v = c[idx];
+        const REAL m = abs(v);
+        if (m > REAL(FLT_EPSILON)) c[idx] = v*((m - t)/m);
+      }
+    }
+  }
+
+  template <class REAL>
+  cuWavelet2DTOperator<REAL>::cuWavelet2DTOperator() : linearOperator< cuNDArray< complext<REAL> > >(),
+    input_in_kspace_(false), no_null_space_(true), num_of_wav_levels_(1), with_approx_coeff_(false), proximity_across_cha_(false)
+  {
+    scale_factor_first_dimension_ = 1;
+    scale_factor_second_dimension_ = 1;
+    scale_factor_third_dimension_ = 1;
+  }
+
+  template <class REAL>
+  cuWavelet2DTOperator<REAL>::~cuWavelet2DTOperator()
+  {
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::set_acquired_points(const ARRAY_TYPE& kspace)
+  {
+    acquired_points_ = kspace;
+
+    unacquired_points_indicator_.create(kspace.get_dimensions().get());
+
+    dim3 blockDim, gridDim;
+    setup_grid(kspace.get_number_of_elements(), &blockDim, &gridDim);
+
+    wav_unacquired_points_kernel<T, REAL><<< gridDim, blockDim >>>(kspace.get_data_ptr(), kspace.get_number_of_elements(), unacquired_points_indicator_.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::convert_to_image(const ARRAY_TYPE& x, ARRAY_TYPE& im)
+  {
+    if (&im != &x) im = x;
+    cuNDFFT<REAL>::instance()->ifft2(&im);
+    timeswitch2D(&im);
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::convert_to_kspace(const ARRAY_TYPE& im, ARRAY_TYPE& x)
+  {
+    if (&x != &im) x = im;
+    timeswitch2D(&x);
+    cuNDFFT<REAL>::instance()->fft2(&x);
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::forward_wav(const ARRAY_TYPE& x, ARRAY_TYPE& y)
+  {
+    size_t RO = x.get_size(0);
+    size_t E1 = x.get_size(1);
+    size_t CHA = x.get_size(2);
+    size_t E2 = x.get_number_of_elements()/(RO*E1*CHA);
+    size_t W = 1 + 7*num_of_wav_levels_;
+
+    if (E2 < 2 || num_of_wav_levels_ == 0)
+      throw std::runtime_error("cuWavelet2DTOperator::forward_wav(): at least two images and one level are needed");
+
+    std::vector<size_t> dims;
+    dims.push_back(RO);
+    dims.push_back(E1);
+    dims.push_back(E2);
+    dims.push_back(W);
+    dims.push_back(CHA);
+
+    if (!y.dimensions_equal(&dims)) y.create(&dims);
+
+    size_t N2D = RO*E1;
+    size_t N3D = N2D*E2;
+
+    std::vector<size_t> dimBuf(dims.begin(), dims.begin() + 3);
+    dimBuf.push_back(CHA);
+
+    size_t num = N3D*CHA;
+
+    dim3 blockDim, gridDim;
+    setup_grid(num, &blockDim, &gridDim);
+
+    for (size_t n = 0; n < num_of_wav_levels_; n++)
+    {
+      const T* pSrc = x.get_data_ptr();
+      size_t srcStrideE2 = N2D*CHA;
+      size_t srcStrideCHA = N2D;
+
+      if (n > 0)
+      {
+        pSrc = wav_buf_[(n - 1)%2].get_data_ptr();
+        srcStrideE2 = N2D;
+        srcStrideCHA = N3D;
+      }
+
+      // the low frequency coefficients of the last level go to w=0
+      T* pLow = y.get_data_ptr();
+      size_t lowStrideCHA = N3D*W;
+
+      if (n + 1 < num_of_wav_levels_)
+      {
+        if (!wav_buf_[n%2].dimensions_equal(&dimBuf)) wav_buf_[n%2].create(&dimBuf);
+        pLow = wav_buf_[n%2].get_data_ptr();
+        lowStrideCHA = N3D;
+      }
+
+      harr_forward_level_kernel<T, REAL><<< gridDim, blockDim >>>(pSrc, srcStrideE2, srcStrideCHA, pLow, lowStrideCHA, y.get_data_ptr(),
+                                                         (int)RO, (int)E1, (int)E2, (int)W, (int)n, num);
+      CHECK_FOR_CUDA_ERROR();
+    }
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::adjoint_wav(const ARRAY_TYPE& x, ARRAY_TYPE& y)
+  {
+    size_t RO = x.get_size(0);
+    size_t E1 = x.get_size(1);
+    size_t E2 = x.get_size(2);
+    size_t W = x.get_size(3);
+    size_t CHA = x.get_number_of_elements()/(RO*E1*E2*W);
+
+    if (W != 1 + 7*num_of_wav_levels_)
+      throw std::runtime_error("cuWavelet2DTOperator::adjoint_wav(): the number of coefficients does not match the number of levels");
+
+    std::vector<size_t> dims;
+    dims.push_back(RO);
+    dims.push_back(E1);
+    dims.push_back(CHA);
+    dims.push_back(E2);
+
+    if (!y.dimensions_equal(&dims)) y.create(&dims);
+
+    size_t N2D = RO*E1;
+    size_t N3D = N2D*E2;
+
+    std::vector<size_t> dimBuf;
+    dimBuf.push_back(RO);
+    dimBuf.push_back(E1);
+    dimBuf.push_back(E2);
+    dimBuf.push_back(CHA);
+
+    size_t num = N3D*CHA;
+
+    dim3 blockDim, gridDim;
+    setup_grid(num, &blockDim, &gridDim);
+
+    for (long long n = (long long)num_of_wav_levels_ - 1; n >= 0; n--)
+    {
+      const T* pLow = x.get_data_ptr();
+      size_t lowStrideCHA = N3D*W;
+
+      if (n + 1 < (long long)num_of_wav_levels_)
+      {
+        pLow = wav_buf_[(n + 1)%2].get_data_ptr();
+        lowStrideCHA = N3D;
+      }
+
+      T* pOut = y.get_data_ptr();
+      size_t outStrideE2 = N2D*CHA;
+      size_t outStrideCHA = N2D;
+
+      if (n > 0)
+      {
+        if (!wav_buf_[n%2].dimensions_equal(&dimBuf)) wav_buf_[n%2].create(&dimBuf);
+        pOut = wav_buf_[n%2].get_data_ptr();
+        outStrideE2 = N2D;
+        outStrideCHA = N3D;
+      }
+
+      harr_inverse_level_kernel<T, REAL><<< gridDim, blockDim >>>(pLow, lowStrideCHA, x.get_data_ptr(), pOut, outStrideE2, outStrideCHA,
+                                                         (int)RO, (int)E1, (int)E2, (int)W, (int)n, num);
+      CHECK_FOR_CUDA_ERROR();
+    }
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    if (accumulate) wav_coeff_ = *y;
+
+    const ARRAY_TYPE* pIm = x;
+
+    if (input_in_kspace_)
+    {
+      if (!no_null_space_)
+      {
+        // Dc'x+D'a
+        if (!kspace_.dimensions_equal(x)) kspace_.create(x->get_dimensions().get());
+        assign(kspace_, lazy(*x) * lazy(unacquired_points_indicator_) + lazy(acquired_points_));
+        this->convert_to_image(kspace_, complexIm_);
+      }
+      else
+      {
+        this->convert_to_image(*x, complexIm_);
+      }
+
+      pIm = &complexIm_;
+    }
+
+    size_t RO = x->get_size(0);
+    size_t E1 = x->get_size(1);
+    size_t CHA = x->get_size(2);
+    size_t N = x->get_size(3);
+
+    if (coil_map_.get_number_of_elements() > 0 && coil_map_.get_size(0) == RO && coil_map_.get_size(1) == E1 && coil_map_.get_size(2) == CHA)
+    {
+      // S'
+      std::vector<size_t> dims;
+      dims.push_back(RO);
+      dims.push_back(E1);
+      dims.push_back(1);
+      dims.push_back(N);
+
+      if (!combined_.dimensions_equal(&dims)) combined_.create(&dims);
+
+      size_t coilN = coil_map_.get_number_of_elements()/(RO*E1*CHA);
+
+      dim3 blockDim, gridDim;
+      setup_grid(combined_.get_number_of_elements(), &blockDim, &gridDim);
+
+      wav_coil_combine_kernel<<< gridDim, blockDim >>>(pIm->get_data_ptr(), coil_map_.get_data_ptr(), RO*E1, (int)CHA, (int)coilN,
+                                                       combined_.get_number_of_elements(), combined_.get_data_ptr());
+      CHECK_FOR_CUDA_ERROR();
+
+      pIm = &combined_;
+    }
+
+    // W
+    this->forward_wav(*pIm, *y);
+
+    if (accumulate) *y += wav_coeff_;
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate)
+  {
+    if (accumulate) kspace_ = *y;
+
+    size_t RO = x->get_size(0);
+    size_t E1 = x->get_size(1);
+    size_t N = x->get_size(2);
+
+    bool hasCoilMap = (coil_map_.get_number_of_elements() > 0 && coil_map_.get_size(0) == RO && coil_map_.get_size(1) == E1);
+
+    // W'
+    this->adjoint_wav(*x, complexIm_);
+
+    ARRAY_TYPE* pIm = &complexIm_;
+
+    if (hasCoilMap)
+    {
+      // S
+      size_t CHA = coil_map_.get_size(2);
+      size_t coilN = coil_map_.get_number_of_elements()/(RO*E1*CHA);
+
+      std::vector<size_t> dims;
+      dims.push_back(RO);
+      dims.push_back(E1);
+      dims.push_back(CHA);
+      dims.push_back(N);
+
+      if (!combined_.dimensions_equal(&dims)) combined_.create(&dims);
+
+      dim3 blockDim, gridDim;
+      setup_grid(combined_.get_number_of_elements(), &blockDim, &gridDim);
+
+      wav_coil_expand_kernel<<< gridDim, blockDim >>>(complexIm_.get_data_ptr(), coil_map_.get_data_ptr(), RO*E1, (int)CHA, (int)coilN,
+                                                      combined_.get_number_of_elements(), combined_.get_data_ptr());
+      CHECK_FOR_CUDA_ERROR();
+
+      pIm = &combined_;
+    }
+
+    ARRAY_TYPE* pY = y;
+    ARRAY_TYPE res;
+    if (accumulate) pY = &res;
+
+    if (input_in_kspace_)
+    {
+      // F
+      this->convert_to_kspace(*pIm, *pY);
+
+      // Dc
+      if (!no_null_space_) *pY *= unacquired_points_indicator_;
+    }
+    else
+    {
+      *pY = *pIm;
+    }
+
+    if (accumulate)
+    {
+      res += kspace_;
+      *y = res;
+    }
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::L1Norm(const ARRAY_TYPE& wavCoeff, cuNDArray<REAL>& wavCoeffNorm, bool apply_scale_factors)
+  {
+    size_t RO = wavCoeff.get_size(0);
+    size_t E1 = wavCoeff.get_size(1);
+    size_t E2 = wavCoeff.get_size(2);
+    size_t W = wavCoeff.get_size(3);
+    size_t CHA = wavCoeff.get_number_of_elements()/(RO*E1*E2*W);
+
+    std::vector<size_t> dims;
+    dims.push_back(RO);
+    dims.push_back(E1);
+    dims.push_back(E2);
+    dims.push_back(W);
+    dims.push_back(1);
+
+    if (!wavCoeffNorm.dimensions_equal(&dims)) wavCoeffNorm.create(&dims);
+
+    REAL s1 = apply_scale_factors ? scale_factor_first_dimension_ : REAL(1);
+    REAL s2 = apply_scale_factors ? scale_factor_second_dimension_ : REAL(1);
+    REAL s3 = apply_scale_factors ? scale_factor_third_dimension_ : REAL(1);
+
+    dim3 blockDim, gridDim;
+    setup_grid(wavCoeffNorm.get_number_of_elements(), &blockDim, &gridDim);
+
+    wav_coeff_norm_kernel<T, REAL><<< gridDim, blockDim >>>(wavCoeff.get_data_ptr(), RO*E1*E2, (int)W, (int)CHA, s1, s2, s3,
+                                                            wavCoeffNorm.get_number_of_elements(), wavCoeffNorm.get_data_ptr());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template <class REAL>
+  REAL cuWavelet2DTOperator<REAL>::magnitude(ARRAY_TYPE* x)
+  {
+    this->mult_M(x, &wav_coeff_, false);
+    this->L1Norm(wav_coeff_, wav_coeff_norm_, true);
+    return asum(&wav_coeff_norm_);
+  }
+
+  template <class REAL>
+  void cuWavelet2DTOperator<REAL>::proximity(ARRAY_TYPE& wavCoeff, REAL thres)
+  {
+    size_t RO = wavCoeff.get_size(0);
+    size_t E1 = wavCoeff.get_size(1);
+    size_t E2 = wavCoeff.get_size(2);
+    size_t W = wavCoeff.get_size(3);
+
+    if (proximity_across_cha_) this->L1Norm(wavCoeff, wav_coeff_norm_, false);
+
+    dim3 blockDim, gridDim;
+    setup_grid(wavCoeff.get_number_of_elements(), &blockDim, &gridDim);
+
+    wav_shrink_kernel<T, REAL><<< gridDim, blockDim >>>(wavCoeff.get_data_ptr(), proximity_across_cha_ ? wav_coeff_norm_.get_data_ptr() : (REAL*)0,
+                                                        proximity_across_cha_, RO*E1*E2, (int)W, with_approx_coeff_ ? 0 : 1, thres,
+                                                        scale_factor_first_dimension_, scale_factor_second_dimension_, scale_factor_third_dimension_,
+                                                        wavCoeff.get_number_of_elements());
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  // ------------------------------------------------------------
+  // Instantiation
+  // ------------------------------------------------------------
+
+  template class EXPORTGPUOPERATORS cuWavelet2DTOperator<float>;
+  template class EXPORTGPUOPERATORS cuWavelet2DTOperator<double>;
+}
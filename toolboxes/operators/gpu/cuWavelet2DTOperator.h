@@ -0,0 +1,109 @@
+/** \file       cuWavelet2DTOperator.h
+    \brief      Redundant harr wavelet operator for 2D+T L1 regularization on the gpu, following hoWavelet2DTOperator
+
+    Only the harr wavelet ("db1") is implemented and motion compensation is not supported.
+    The transform is the one of hoNDHarrWavelet::dwt3D/idwt3D over [RO E1 N], the wavelet coefficients are
+    laid out as the ones of hoWavelet2DTOperator, so the scaling factors and thresholds have the same meaning.
+*/
+
+#pragma once
+
+#include "gpuoperators_export.h"
+#include "linearOperator.h"
+#include "cuNDArray.h"
+#include "complext.h"
+
+namespace Gadgetron {
+
+template <class REAL>
+class EXPORTGPUOPERATORS cuWavelet2DTOperator : public linearOperator< cuNDArray< complext<REAL> > >
+{
+public:
+
+    typedef complext<REAL> T;
+    typedef cuNDArray<T> ARRAY_TYPE;
+
+    cuWavelet2DTOperator();
+    virtual ~cuWavelet2DTOperator();
+
+    /// if no_null_space_ == true
+    /// perform operation ||WS'F'x||1,    if input_in_kspace_==true  and coil_map_ is not empty
+    /// perform operation ||WS'x||1,      if input_in_kspace_==false and coil_map_ is not empty
+    /// perform operation ||Wx||1,        if input_in_kspace_==false and coil_map_ is empty
+    /// perform operation ||WF'x||1,      if input_in_kspace_==true  and coil_map_ is empty
+
+    /// if no_null_space_ == false
+    /// perform operation ||WS'F'(Dc'x+D'a)||1,    if coil_map_ is not empty
+    /// perform operation ||WF'(Dc'x+D'a)||1,      if coil_map_ is empty
+
+    /// forward wavelet transform operation
+    /// x: [RO E1 CHA N]
+    /// y: [RO E1 N W CHA] or [RO E1 N W 1], W=1+7*level
+    virtual void mult_M(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+    /// backward wavelet transform for operation
+    /// x: [RO E1 N W CHA] or [RO E1 N W 1]
+    /// y: [RO E1 CHA N]
+    virtual void mult_MH(ARRAY_TYPE* x, ARRAY_TYPE* y, bool accumulate = false);
+
+    /// L1 norm of the scaled wavelet coefficients, joint across CHA
+    virtual REAL magnitude(ARRAY_TYPE* x);
+
+    /// proximal operation for the L1 norm of wavelet, the joint sparsity across CHA is used if proximity_across_cha_ is true
+    virtual void proximity(ARRAY_TYPE& wavCoeff, REAL thres);
+
+    /// the redundant harr wavelet is a tight frame
+    virtual bool unitary() const { return true; }
+
+    /// set the acquired kspace [RO E1 CHA N], unacquired points are zero
+    virtual void set_acquired_points(const ARRAY_TYPE& kspace);
+
+    /// if true, input is in kspace domain
+    bool input_in_kspace_;
+
+    /// if true, no null space is used
+    bool no_null_space_;
+
+    /// number of transformation levels
+    size_t num_of_wav_levels_;
+
+    /// whether to include low frequency approximation coefficients
+    bool with_approx_coeff_;
+
+    /// whether to perform proximity across channels
+    bool proximity_across_cha_;
+
+    /// coil map [RO E1 CHA] or [RO E1 CHA N], if not empty, the coil combined image is transformed
+    ARRAY_TYPE coil_map_;
+
+    /// scaling factors of the high frequency coefficients along RO, E1 and N, as hoWavelet2DTOperator
+    REAL scale_factor_first_dimension_;
+    REAL scale_factor_second_dimension_;
+    REAL scale_factor_third_dimension_;
+
+protected:
+
+    /// centered 2D fft, as cuSPIRIT2DTOperator
+    void convert_to_image(const ARRAY_TYPE& x, ARRAY_TYPE& im);
+    void convert_to_kspace(const ARRAY_TYPE& im, ARRAY_TYPE& x);
+
+    /// x: [RO E1 CHA N], y: [RO E1 N W CHA]
+    void forward_wav(const ARRAY_TYPE& x, ARRAY_TYPE& y);
+    /// x: [RO E1 N W CHA], y: [RO E1 CHA N]
+    void adjoint_wav(const ARRAY_TYPE& x, ARRAY_TYPE& y);
+
+    /// wavCoeffNorm [RO E1 N W 1] = sqrt of the sum over CHA of |wavCoeff|^2, the high frequency coefficients weighted by the scaling factors
+    void L1Norm(const ARRAY_TYPE& wavCoeff, cuNDArray<REAL>& wavCoeffNorm, bool apply_scale_factors);
+
+    ARRAY_TYPE acquired_points_;
+    ARRAY_TYPE unacquired_points_indicator_;
+
+    // helper memory
+    ARRAY_TYPE complexIm_;
+    ARRAY_TYPE combined_;
+    ARRAY_TYPE kspace_;
+    ARRAY_TYPE wav_coeff_;
+    ARRAY_TYPE wav_buf_[2];
+    cuNDArray<REAL> wav_coeff_norm_;
+};
+
+}
@@ -7,6 +7,8 @@
 #include "linearOperator.h"
 #include <numeric>
 #include <functional>
+#include <future>
+#include <exception>
 namespace Gadgetron{
 
 
@@ -42,6 +44,22 @@ public:
 			for (int i = 0; i < this->get_number_of_subsets(); i++) mult_MH(projections[i].get(),out,i,true);
 	}
 
+	/**
+	 * Starts the forwards projection of a subset, out holds the result once the future is ready.
+	 * Operators that can run it alongside the caller override this, by default it is done before returning.
+	 * in and out must not be touched until the future is ready.
+	 */
+	virtual std::future<void> mult_M_async(ARRAY_TYPE* in, ARRAY_TYPE* out, int subset, bool accumulate){
+		std::promise<void> done;
+		try {
+			mult_M(in,out,subset,accumulate);
+			done.set_value();
+		} catch (...) {
+			done.set_exception(std::current_exception());
+		}
+		return done.get_future();
+	}
+
 	virtual boost::shared_ptr< std::vector<size_t> > get_codomain_dimensions(int subset)=0;
 /*
  	virtual void set_codomain_subsets(std::vector< std::vector<unsigned int> > & _dims){
@@ -23,6 +23,7 @@ kmeans<T>::kmeans()
     max_iter_ = 100;
     replicates_ = 10;
     perform_online_update_ = true;
+    use_triangle_inequality_ = false;
 
     verbose_ = false;
     perform_timing_ = false;
@@ -219,90 +220,81 @@ void kmeans<T>::get_initial_guess_kmeansplusplus(const ArrayType& X, size_t K, A
         C_for_initial.create(P, K, this->replicates_);
         Gadgetron::clear(C_for_initial);
 
-        ClusterType IDX;
-        IDX.resize(N, 0);
-
-        // find the first center
         ArrayType C;
         C.create(P, K);
         Gadgetron::clear(C);
 
-        VectorType norm_C(K, 0);
-
-        ArrayType D;
-        D.create(P, N);
-
-        ArrayType D_norm;
-        D_norm.create(N);
-
-        ArrayType cumsum_D_norm;
-        cumsum_D_norm.create(N);
+        // squared distance of every point to its nearest centroid picked so far
+        ArrayType min_D2;
+        min_D2.create(N);
 
-        ArrayType CX;
+        ArrayType cumsum_D2;
+        cumsum_D2.create(N);
 
         size_t n, i, t, s;
 
         for (n = 0; n < this->replicates_; n++)
         {
+            // find the first center
             size_t ind = (size_t)(dis(gen)*N);
             if (ind >= N) ind = N - 1;
             memcpy(&C(0, 0), &X(0, ind), sizeof(T)*P);
 
-            ArrayType aC;
-            aC.create(P, C.begin());
-            norm_C[0] = Gadgetron::dotu(aC, aC);
+            min_D2.fill(std::numeric_limits<T>::max());
 
-            for (i = 1; i < K; i++)
+            for (i = 0; i < K; i++)
             {
-                // compute distance to the nearest centroid for all data points
-                this->compute_dist(X, IDX, C, D);
-
-                // compute norm of distance vector
-                this->compute_norm_dist(D, D_norm);
-
-                // compute accumulated distrance
-                cumsum_D_norm(0) = D_norm(0);
-                for (t = 1; t < N; t++)
+                if (i > 0)
                 {
-                    cumsum_D_norm(t) = cumsum_D_norm(t - 1) + D_norm(t);
-                }
-
-                if (std::abs(cumsum_D_norm(N - 1)) < FLT_EPSILON)
-                {
-                    GERROR_STREAM("std::abs(cumsum_D_norm(N-1))<FLT_EPSILON ... ");
-                    // set centroid from i to K
+                    // compute accumulated squared distance
+                    cumsum_D2(0) = min_D2(0);
+                    for (t = 1; t < N; t++)
+                    {
+                        cumsum_D2(t) = cumsum_D2(t - 1) + min_D2(t);
+                    }
 
-                    for (s = i; s < K; s++)
+                    if (std::abs(cumsum_D2(N - 1)) < FLT_EPSILON)
                     {
-                        size_t ind = (size_t)(dis(gen)*N);
-                        if (ind >= N) ind = N - 1;
-                        memcpy(&C(0, s), &X(0, ind), sizeof(T)*P);
+                        GERROR_STREAM("std::abs(cumsum_D2(N-1))<FLT_EPSILON ... ");
+                        // set centroid from i to K
+
+                        for (s = i; s < K; s++)
+                        {
+                            size_t ind = (size_t)(dis(gen)*N);
+                            if (ind >= N) ind = N - 1;
+                            memcpy(&C(0, s), &X(0, ind), sizeof(T)*P);
+                        }
+                        break;
                     }
-                    break;
-                }
 
-                // convert to probability
-                for (t = 0; t < N; t++)
-                {
-                    cumsum_D_norm(t) /= cumsum_D_norm(N - 1);
-                }
+                    // pick the next centroid with probability proportional to the squared distance
+                    T v = dis(gen) * cumsum_D2(N - 1);
+                    for (t = 0; t < N - 1; t++)
+                    {
+                        if (cumsum_D2(t) >= v) break;
+                    }
 
-                T v = dis(gen);
-                for (t = 0; t < N; t++)
-                {
-                    if (cumsum_D_norm(t)>=v) break;
+                    memcpy(&C(0, i), &X(0, t), sizeof(T)*P);
                 }
 
-                memcpy(&C(0, i), &X(0, t), sizeof(T)*P);
+                // only the distance to the new centroid has to be computed
+                const T* pX = X.begin();
+                const T* pC = &C(0, i);
+                T* pD2 = min_D2.begin();
 
-                aC.create(P, &C(0, i));
-                norm_C[i] = Gadgetron::dotu(aC, aC);
-
-                // update the IDX
-                ArrayType curr_C;
-                curr_C.create(P, i+1, C.begin());
+                long long tt;
+#pragma omp parallel for default(none) private(tt) shared(N, P, pX, pC, pD2)
+                for (tt = 0; tt < (long long)N; tt++)
+                {
+                    T d = 0;
+                    for (size_t p = 0; p < P; p++)
+                    {
+                        T v = pX[p + tt*P] - pC[p];
+                        d += v*v;
+                    }
 
-                this->update_IDX(X, curr_C, norm_C, IDX);
+                    if (d < pD2[tt]) pD2[tt] = d;
+                }
             }
 
             memcpy(&C_for_initial(0, 0, n), C.begin(), sizeof(T)*P*K);
@@ -421,8 +413,16 @@ void kmeans<T>::run(const ArrayType& X, size_t K, const ArrayType& C_for_initial
             norm_C[k] = v;
         }
 
+        // distance bounds for the triangle inequality
+        VectorType upper, lower;
+        ArrayType C_bound;
+        ClusterType IDX_bound;
+
         // first round of clustering
-        this->update_IDX(X, C, norm_C, IDX);
+        if (this->use_triangle_inequality_)
+            this->update_IDX_bounded(X, C, IDX, upper, lower, C_bound, IDX_bound);
+        else
+            this->update_IDX(X, C, norm_C, IDX);
 
         ClusterType prev_IDX;
         ArrayType D, D_norm;
@@ -439,7 +439,10 @@ void kmeans<T>::run(const ArrayType& X, size_t K, const ArrayType& C_for_initial
             // update the centroid
             this->update_centroid(X, IDX, C, norm_C);
             // update clustering
-            this->update_IDX(X, C, norm_C, IDX);
+            if (this->use_triangle_inequality_)
+                this->update_IDX_bounded(X, C, IDX, upper, lower, C_bound, IDX_bound);
+            else
+                this->update_IDX(X, C, norm_C, IDX);
 
             this->compute_dist(X, IDX, C, D);
             this->compute_norm_dist(D, D_norm);
@@ -520,6 +523,113 @@ void kmeans<T>::run(const ArrayType& X, size_t K, const ArrayType& C_for_initial
     }
 }
 
+template <typename T>
+void kmeans<T>::run_minibatch(const ArrayType& X, size_t K, const ArrayType& C_for_initial, size_t batch_size, ClusterType& IDX, ArrayType& C, T& sumD)
+{
+    try
+    {
+        if (this->perform_timing_) gt_timer_.start("run_minibatch");
+
+        size_t P = X.get_size(0);
+        size_t N = X.get_size(1);
+
+        GADGET_CHECK_THROW(N>K);
+        GADGET_CHECK_THROW(batch_size>0);
+        GADGET_CHECK_THROW(C_for_initial.get_size(0) == P);
+        GADGET_CHECK_THROW(C_for_initial.get_size(1) == K);
+
+        if (batch_size > N) batch_size = N;
+
+        C.create(P, K);
+        memcpy(C.begin(), C_for_initial.begin(), sizeof(T)*P*K);
+
+        VectorType norm_C(K, 0);
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<size_t> dis(0, N - 1);
+
+        ArrayType X_batch;
+        X_batch.create(P, batch_size);
+
+        ClusterType IDX_batch;
+
+        // number of samples assigned to every centroid so far
+        std::vector<size_t> num_in_C(K, 0);
+
+        size_t iter, b, k, p;
+        for (iter = 0; iter < this->max_iter_; iter++)
+        {
+            for (b = 0; b < batch_size; b++)
+            {
+                memcpy(&X_batch(0, b), &X(0, dis(gen)), sizeof(T)*P);
+            }
+
+            for (k = 0; k < K; k++)
+            {
+                T v = 0;
+                for (p = 0; p < P; p++)
+                {
+                    v += C(p, k)*C(p, k);
+                }
+
+                norm_C[k] = v;
+            }
+
+            this->update_IDX(X_batch, C, norm_C, IDX_batch);
+
+            // gradient step per sample, with a learning rate decreasing for every centroid
+            for (b = 0; b < batch_size; b++)
+            {
+                k = IDX_batch[b];
+                num_in_C[k]++;
+
+                T eta = (T)1 / (T)num_in_C[k];
+                for (p = 0; p < P; p++)
+                {
+                    C(p, k) += eta * (X_batch(p, b) - C(p, k));
+                }
+            }
+        }
+
+        // assign all samples to the final centroids
+        for (k = 0; k < K; k++)
+        {
+            T v = 0;
+            for (p = 0; p < P; p++)
+            {
+                v += C(p, k)*C(p, k);
+            }
+
+            norm_C[k] = v;
+        }
+
+        this->update_IDX(X, C, norm_C, IDX);
+
+        ArrayType D, D_norm;
+        this->compute_dist(X, IDX, C, D);
+        this->compute_norm_dist(D, D_norm);
+
+        sumD = 0;
+        size_t n;
+        for (n = 0; n<N; n++)
+        {
+            sumD += D_norm(n)*D_norm(n);
+        }
+
+        if (this->verbose_)
+        {
+            GDEBUG_STREAM("Mini-batch kmeans : " << this->max_iter_ << " batches of " << batch_size << " - " << sumD);
+        }
+
+        if (this->perform_timing_) gt_timer_.stop();
+    }
+    catch (...)
+    {
+        GERROR_STREAM("Exceptions happened in kmeans<T>::run_minibatch(...) ... ");
+    }
+}
+
 template <typename T>
 void kmeans<T>::compute_dist(const ArrayType& X, const ClusterType& IDX, const ArrayType& C, ArrayType& D)
 {
@@ -612,23 +722,31 @@ void kmeans<T>::update_IDX(const ArrayType& X, const ArrayType& C, const VectorT
         ArrayType CX;
         Gadgetron::gemm(CX, C, true, X, false);
 
-        size_t t, s;
+        T* pCX = CX.begin();
+        const T* pNC = &norm_C[0];
+        size_t* pIDX = &IDX[0];
+
+        long long t;
 
+#pragma omp parallel for default(none) private(t) shared(N, K, pCX, pNC, pIDX)
         for (t = 0; t < N; t++)
         {
+            T* cx = pCX + t*K;
+
+            size_t s;
             for (s = 0; s < K; s++)
             {
-                CX(s, t) = 2* CX(s, t) - norm_C[s];
+                cx[s] = 2 * cx[s] - pNC[s];
             }
 
-            T maxCX = CX(0, t);
-            IDX[t] = 0;
+            T maxCX = cx[0];
+            pIDX[t] = 0;
             for (s = 1; s < K; s++)
             {
-                if (CX(s, t) > maxCX)
+                if (cx[s] > maxCX)
                 {
-                    maxCX = CX(s, t);
-                    IDX[t] = s;
+                    maxCX = cx[s];
+                    pIDX[t] = s;
                 }
             }
         }
@@ -639,6 +757,156 @@ void kmeans<T>::update_IDX(const ArrayType& X, const ArrayType& C, const VectorT
     }
 }
 
+template <typename T>
+void kmeans<T>::update_IDX_bounded(const ArrayType& X, const ArrayType& C, ClusterType& IDX, VectorType& upper, VectorType& lower, ArrayType& C_bound, ClusterType& IDX_bound)
+{
+    try
+    {
+        size_t P = X.get_size(0);
+        size_t N = X.get_size(1);
+
+        size_t K = C.get_size(1);
+
+        const T* pX = X.begin();
+        const T* pC = C.begin();
+
+        bool initialize = (upper.size() != N || lower.size() != N || IDX_bound.size() != N
+                            || C_bound.get_size(0) != P || C_bound.get_size(1) != K);
+
+        // how far every centroid moved since the bounds were computed
+        VectorType delta(K, 0);
+        T max_delta = 0;
+
+        // half of the distance from every centroid to its nearest other centroid
+        VectorType half_min_CC(K, std::numeric_limits<T>::max());
+
+        size_t k, j, p;
+
+        if (!initialize)
+        {
+            const T* pCB = C_bound.begin();
+            for (k = 0; k < K; k++)
+            {
+                T d = 0;
+                for (p = 0; p < P; p++)
+                {
+                    T v = pC[p + k*P] - pCB[p + k*P];
+                    d += v*v;
+                }
+
+                delta[k] = std::sqrt(d);
+                if (delta[k] > max_delta) max_delta = delta[k];
+            }
+        }
+
+        for (k = 0; k < K; k++)
+        {
+            for (j = k + 1; j < K; j++)
+            {
+                T d = 0;
+                for (p = 0; p < P; p++)
+                {
+                    T v = pC[p + k*P] - pC[p + j*P];
+                    d += v*v;
+                }
+
+                d = std::sqrt(d) / 2;
+                if (d < half_min_CC[k]) half_min_CC[k] = d;
+                if (d < half_min_CC[j]) half_min_CC[j] = d;
+            }
+        }
+
+        IDX.resize(N, 0);
+        upper.resize(N, 0);
+        lower.resize(N, 0);
+        IDX_bound.resize(N, K);
+
+        size_t* pIDX = &IDX[0];
+        size_t* pIDXB = &IDX_bound[0];
+        T* pU = &upper[0];
+        T* pL = &lower[0];
+        const T* pDelta = &delta[0];
+        const T* pS = &half_min_CC[0];
+
+        long long n;
+
+#pragma omp parallel for default(none) private(n) shared(N, K, P, pX, pC, pIDX, pIDXB, pU, pL, pDelta, pS, max_delta, initialize)
+        for (n = 0; n < N; n++)
+        {
+            const T* x = pX + n*P;
+            size_t a = pIDX[n];
+
+            // the bounds of a point are only valid if it stayed in its cluster since they were computed
+            if (!initialize && a < K && a == pIDXB[n])
+            {
+                T u = pU[n] + pDelta[a];
+                T l = pL[n] - max_delta;
+                T m = (pS[a] > l) ? pS[a] : l;
+
+                if (u <= m)
+                {
+                    pU[n] = u;
+                    pL[n] = l;
+                    continue;
+                }
+
+                // tighten the upper bound and check again
+                T d = 0;
+                for (size_t q = 0; q < P; q++)
+                {
+                    T v = x[q] - pC[q + a*P];
+                    d += v*v;
+                }
+                u = std::sqrt(d);
+
+                if (u <= m)
+                {
+                    pU[n] = u;
+                    pL[n] = l;
+                    continue;
+                }
+            }
+
+            // distances to all centroids, keep the nearest and the second nearest
+            T d1 = std::numeric_limits<T>::max();
+            T d2 = std::numeric_limits<T>::max();
+            size_t c1 = 0;
+
+            for (size_t c = 0; c < K; c++)
+            {
+                T d = 0;
+                for (size_t q = 0; q < P; q++)
+                {
+                    T v = x[q] - pC[q + c*P];
+                    d += v*v;
+                }
+
+                if (d < d1)
+                {
+                    d2 = d1;
+                    d1 = d;
+                    c1 = c;
+                }
+                else if (d < d2)
+                {
+                    d2 = d;
+                }
+            }
+
+            pIDX[n] = c1;
+            pU[n] = std::sqrt(d1);
+            pL[n] = (K > 1) ? std::sqrt(d2) : std::numeric_limits<T>::max();
+        }
+
+        C_bound = C;
+        IDX_bound = IDX;
+    }
+    catch (...)
+    {
+        GERROR_STREAM("Exceptions happened in kmeans<T>::update_IDX_bounded(...) ... ");
+    }
+}
+
 template <typename T>
 void kmeans<T>::update_centroid(const ArrayType& X, const ClusterType& IDX, ArrayType& C, VectorType& norm_C)
 {
@@ -26,6 +26,14 @@ namespace Gadgetron {
 // then, the resulting centroids are used for whole data kmeans
 // 'kmeans++': perform the kmeans++ method, http://ilpubs.stanford.edu:8090/778/1/2006-13.pdf
 //
+// triangle inequality: the assignment step of the kmeans iterations can keep, for every point, an upper bound of the distance to its own
+// centroid and a lower bound of the distance to all others (Hamerly, SDM 2010). Points whose bounds show that their cluster cannot change
+// are skipped, which saves most of the distance computations once the centroids move little. The clustering results are not changed.
+//
+// mini-batch: run_minibatch updates the centroids with small random batches of samples, each centroid with a learning rate of
+// 1/(number of samples assigned to it so far) (Sculley, WWW 2010). This is much faster than the full iterations for large N,
+// at the cost of a slightly larger sum of distances.
+//
 // online update: the kmeans can optionally use the so-called "online" update. In this process, every data point is reallocated to all clusters and the
 // delta change of adding or removing this point is computed; those moves which will reduce the total sum cost will be performed.
 //
@@ -65,6 +73,9 @@ public:
     // whether to perform on-line update
     bool perform_online_update_;
 
+    // whether to skip distance computations using the triangle inequality
+    bool use_triangle_inequality_;
+
     // ======================================================================================
     /// parameter for debugging
     // ======================================================================================
@@ -98,6 +109,10 @@ public:
     virtual void run_replicates(const ArrayType& X, size_t K, const ArrayType& C_for_initial, ClusterType& IDX, ArrayType& C, VectorType& sumD_rep, T& sumD);
     virtual void run(const ArrayType& X, size_t K, const ArrayType& C_for_initial, ClusterType& IDX, ArrayType& C, T& sumD);
 
+    /// compute mini-batch kmeans, max_iter_ batches of batch_size samples are used
+    /// C_for_initial: [P K], the initial centroids
+    virtual void run_minibatch(const ArrayType& X, size_t K, const ArrayType& C_for_initial, size_t batch_size, ClusterType& IDX, ArrayType& C, T& sumD);
+
     /// compute distance vector
     /// D: [P N] distance from a point to its closest centroid
     void compute_dist(const ArrayType& X, const ClusterType& IDX, const ArrayType& C, ArrayType& D);
@@ -109,6 +124,10 @@ public:
     /// norm_C is the norm of centroid, dot(C,C,1)
     void update_IDX(const ArrayType& X, const ArrayType& C, const VectorType& norm_C, ClusterType& IDX);
 
+    /// given the current centroids, update the IDX, skipping points by their distance bounds
+    /// upper, lower, C_bound and IDX_bound keep the state between calls, they are initialized if upper does not have N elements
+    void update_IDX_bounded(const ArrayType& X, const ArrayType& C, ClusterType& IDX, VectorType& upper, VectorType& lower, ArrayType& C_bound, ClusterType& IDX_bound);
+
     /// update centroids, given the IDX
     void update_centroid(const ArrayType& X, const ClusterType& IDX, ArrayType& C, VectorType& norm_C);
 
@@ -7,6 +7,7 @@
 #pragma once
 #include "python_toolbox.h"
 #include "python_numpy_wrappers.h"
+#include "python_hoNDArray_converter.h"
 
 #include "hoNDArray.h"
 #include "mri_core_data.h"
@@ -49,6 +50,18 @@ namespace Gadgetron {
             // increment the reference count so it exists after `return`
             return bp::incref(buffer.ptr());
         }
+
+        /// Hands the image array over to Python, the image data is moved into a NumPy array without copying
+        static bp::object convert(IsmrmrdImageArray && arrayData)
+        {
+            bp::object pygadgetron = bp::import("gadgetron");
+
+            auto data = hoNDArray_to_numpy_array_shared< std::complex<float> >::convert(std::move(arrayData.data_));
+            auto pyHeaders = boost::python::object(arrayData.headers_);
+            auto pyMeta = boost::python::object(arrayData.meta_);
+
+            return pygadgetron.attr("IsmrmrdImageArray")(data, pyHeaders, pyMeta);
+        }
     };
 
     // ------------------------------------------------------------------------
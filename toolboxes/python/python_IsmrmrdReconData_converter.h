@@ -1,6 +1,7 @@
 #pragma once
 #include "python_toolbox.h"
 #include "python_numpy_wrappers.h"
+#include "python_hoNDArray_converter.h"
 
 #include "hoNDArray.h"
 #include "mri_core_data.h"
@@ -14,28 +15,42 @@ namespace Gadgetron {
 class IsmrmrdReconData_to_python_object {
 public:
   static PyObject* convert(const IsmrmrdReconData & reconData) {
+    bp::object pyReconData = ReconDataToPython(const_cast<IsmrmrdReconData&>(reconData), false);
+    // increment the reference count so it exists after `return`
+    return bp::incref(pyReconData.ptr());
+  }
+
+  /// Hands the recon data over to Python: the data and trajectory arrays are moved into NumPy arrays
+  /// without copying and are left empty
+  static bp::object convert(IsmrmrdReconData && reconData) {
+    return ReconDataToPython(reconData, true);
+  }
+
+private:
+  static bp::object ReconDataToPython(IsmrmrdReconData & reconData, bool move){
 
     bp::object pygadgetron = bp::import("gadgetron");
     auto pyReconData = bp::list();
     for (auto & reconBit : reconData.rbit_ ){
-      auto data = DataBufferedToPython(reconBit.data_);
-      auto ref = 	reconBit.ref_ ? DataBufferedToPython(*reconBit.ref_) : bp::object();
+      auto data = DataBufferedToPython(reconBit.data_, move);
+      auto ref = 	reconBit.ref_ ? DataBufferedToPython(*reconBit.ref_, move) : bp::object();
 
       auto pyReconBit = pygadgetron.attr("IsmrmrdReconBit")(data,ref);
       pyReconData.append(pyReconBit);
 
     }
-    // increment the reference count so it exists after `return`
-    return bp::incref(pyReconData.ptr());
+    return pyReconData;
   }
 
-private:
-  static bp::object DataBufferedToPython( const IsmrmrdDataBuffered & dataBuffer){
+  static bp::object DataBufferedToPython( IsmrmrdDataBuffered & dataBuffer, bool move){
 
     bp::object pygadgetron = bp::import("gadgetron");
-    auto data = bp::object(dataBuffer.data_);
+    auto data = move ? hoNDArray_to_numpy_array_shared< std::complex<float> >::convert(std::move(dataBuffer.data_)) : bp::object(dataBuffer.data_);
        auto headers = boost::python::object(dataBuffer.headers_);
-    auto trajectory = dataBuffer.trajectory_ ? bp::object(*dataBuffer.trajectory_) : bp::object();
+    auto trajectory = bp::object();
+    if (dataBuffer.trajectory_) {
+      trajectory = move ? hoNDArray_to_numpy_array_shared<float>::convert(std::move(*dataBuffer.trajectory_)) : bp::object(*dataBuffer.trajectory_);
+    }
     auto sampling = SamplingDescriptionToPython(dataBuffer.sampling_);
     auto buffer = pygadgetron.attr("IsmrmrdDataBuffered")(data,headers,sampling,trajectory);
         return buffer;
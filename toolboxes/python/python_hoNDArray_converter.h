@@ -12,6 +12,7 @@
 #include "log.h"
 
 #include <boost/python.hpp>
+#include <boost/make_shared.hpp>
 namespace bp = boost::python;
 
 namespace Gadgetron {
@@ -29,6 +30,7 @@ struct hoNDArray_to_numpy_array {
         PyObject *obj = NumPyArray_EMPTY(dims2.size(), dims2.data(), get_numpy_type<T>(),true);
         if (sizeof(T) != NumPyArray_ITEMSIZE(obj)) {
             GERROR("sizeof(T): %d, ITEMSIZE: %d\n", sizeof(T), NumPyArray_ITEMSIZE(obj));
+            Py_DECREF(obj);
             throw std::runtime_error("hondarray_to_numpy_array: "
                     "python object and array data type sizes do not match");
         }
@@ -37,8 +39,54 @@ struct hoNDArray_to_numpy_array {
         memcpy(NumPyArray_DATA(obj), arr.get_data_ptr(),
                 arr.get_number_of_elements() * sizeof(T));
 
-        // increment the reference count so it exists after `return`
-        return bp::incref(obj);
+        // NumPyArray_EMPTY returns a new reference, which is handed to Boost
+        return obj;
+    }
+};
+
+// -------------------------------------------------------------------------------
+/// Used for handing an hoNDArray over to NumPy without copying the data.
+/// The NumPy array wraps the hoNDArray buffer and holds the hoNDArray through a capsule set as its base
+/// object, so the buffer stays valid as long as Python refers to the array or any view of it.
+/// Only for numeric T, the header arrays hold Python objects and are always converted.
+template <typename T>
+struct hoNDArray_to_numpy_array_shared {
+    typedef boost::shared_ptr< hoNDArray<T> > ArrayPtr;
+
+    static bp::object convert(ArrayPtr arr) {
+        if (!arr || arr->get_number_of_elements() == 0) {
+            return arr ? bp::object(*arr) : bp::object();
+        }
+
+        size_t ndim = arr->get_number_of_dimensions();
+        std::vector<npy_intp> dims2(ndim);
+        for (size_t i = 0; i < ndim; i++) {
+            dims2[i] = static_cast<npy_intp>(arr->get_size(i));
+        }
+
+        ArrayPtr* holder = new ArrayPtr(arr);
+        PyObject* capsule = PyCapsule_New(holder, capsule_name(), &destroy);
+        if (!capsule) {
+            delete holder;
+            bp::throw_error_already_set();
+        }
+
+        PyObject* obj = NumPyArray_NewFromData(dims2.size(), dims2.data(), get_numpy_type<T>(), arr->get_data_ptr(), capsule);
+        if (!obj) bp::throw_error_already_set();
+
+        return bp::object(bp::handle<>(obj));
+    }
+
+    /// Takes over the buffer of arr, which is left empty
+    static bp::object convert(hoNDArray<T>&& arr) {
+        return convert(boost::make_shared< hoNDArray<T> >(std::move(arr)));
+    }
+
+protected:
+    static const char* capsule_name() { return "gadgetron.hoNDArray"; }
+
+    static void destroy(PyObject* capsule) {
+        delete static_cast<ArrayPtr*>(PyCapsule_GetPointer(capsule, capsule_name()));
     }
 };
 
@@ -63,8 +111,8 @@ struct hoNDArray_to_numpy_array<ISMRMRD::AcquisitionHeader> {
         memcpy(NumPyArray_DATA(obj), pyobjects.data(),
                 pyobjects.size()* sizeof(PyObject*));
 
-        // increment the reference count so it exists after `return`
-        return bp::incref(obj);
+        // NumPyArray_EMPTY returns a new reference, which is handed to Boost
+        return obj;
     }
 };
 
@@ -93,8 +141,8 @@ struct hoNDArray_to_numpy_array<ISMRMRD::ImageHeader>
         memcpy(NumPyArray_DATA(obj), pyobjects.data(),
             pyobjects.size() * sizeof(PyObject*));
 
-        // increment the reference count so it exists after `return`
-        return bp::incref(obj);
+        // NumPyArray_EMPTY returns a new reference, which is handed to Boost
+        return obj;
     }
 };
 
@@ -127,16 +175,24 @@ struct hoNDArray_from_numpy_array {
         data->convertible = storage;
 
         PyObject* obj =  NumPyArray_FromAny(obj_orig, nullptr, 1, 36,  NPY_ARRAY_IN_FARRAY, nullptr);
+        if (!obj) bp::throw_error_already_set();
         size_t ndim = NumPyArray_NDIM(obj);
         std::vector<size_t> dims(ndim);
         for (size_t i = 0; i < ndim; i++) {
             dims[i] = NumPyArray_DIM(obj, i);
         }
-        // Placement-new of hoNDArray in memory provided by Boost
-        hoNDArray<T>* arr = new (storage) hoNDArray<T>(dims);
-        memcpy(arr->get_data_ptr(), NumPyArray_DATA(obj),
-                sizeof(T) * arr->get_number_of_elements());
-        //PyObject_Del(obj);
+
+        if (obj == obj_orig) {
+            // Already Fortran ordered and aligned: wrap the NumPy buffer. The converted value lives in
+            // Boost's storage, which does not outlive the source object, and is copied by whoever keeps it.
+            new (storage) hoNDArray<T>(dims, static_cast<T*>(NumPyArray_DATA(obj)), false);
+        } else {
+            // Placement-new of hoNDArray in memory provided by Boost
+            hoNDArray<T>* arr = new (storage) hoNDArray<T>(dims);
+            memcpy(arr->get_data_ptr(), NumPyArray_DATA(obj),
+                    sizeof(T) * arr->get_number_of_elements());
+        }
+        Py_DECREF(obj);
     }
 };
 
@@ -136,6 +136,23 @@ npy_intp* NumPyArray_STRIDES(PyObject* obj)
 PyObject* NumPyArray_FromAny(PyObject* op, PyArray_Descr* dtype, int min_depth, int max_depth, int requirements, PyObject* context){
   return PyArray_FromAny(op, dtype, min_depth, max_depth, requirements, context);
 }
+
+/// Wraps PyArray_New and PyArray_SetBaseObject
+PyObject* NumPyArray_NewFromData(int nd, npy_intp* dims, int typenum, void* data, PyObject* base)
+{
+    PyObject* obj = PyArray_New(&PyArray_Type, nd, dims, typenum, NULL, data, 0, NPY_ARRAY_FARRAY, NULL);
+    if (!obj) {
+        Py_XDECREF(base);
+        return NULL;
+    }
+    // steals the reference to base, also on failure
+    if (PyArray_SetBaseObject((PyArrayObject*)obj, base) < 0) {
+        Py_DECREF(obj);
+        return NULL;
+    }
+    return obj;
+}
+
 /// Wraps PyArray_ITEMSIZE
 int NumPyArray_ITEMSIZE(PyObject* obj)
 {
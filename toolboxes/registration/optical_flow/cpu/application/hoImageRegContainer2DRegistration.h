@@ -16,6 +16,8 @@
 #include "hoNDArray_utils.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDImage_util.h"
+#include "GadgetronThreadBudget.h"
+#include "GadgetronNodeProfile.h"
 
 // transformation
 #include "hoImageRegTransformation.h"
@@ -177,6 +179,9 @@ namespace Gadgetron
         typedef hoNDImageContainer2D<SourceType> SourceContinerType;
         typedef hoNDImageContainer2D<DeformationFieldType> DeformationFieldContinerType;
 
+        /// precomputed target pyramid
+        typedef hoImageRegPyramid<TargetType> TargetPyramidType;
+
         hoImageRegContainer2DRegistration(unsigned int resolution_pyramid_levels=3, bool use_world_coordinates=false, ValueType bg_value=ValueType(0));
         virtual ~hoImageRegContainer2DRegistration();
 
@@ -186,9 +191,15 @@ namespace Gadgetron
         /// register two images
         /// transform or deform can contain the initial transformation or deformation
         /// if warped == NULL, warped images will not be computed
+        /// if targetPyramid is set and was created for the target, the target pyramid is not computed again
         virtual bool registerTwoImagesParametric(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, TransformationParametricType& transform);
-        virtual bool registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform);
-        virtual bool registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv);
+        virtual bool registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, 
+                                                        boost::shared_ptr<TargetPyramidType> targetPyramid = boost::shared_ptr<TargetPyramidType>());
+        virtual bool registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv, 
+                                                        boost::shared_ptr<TargetPyramidType> targetPyramid = boost::shared_ptr<TargetPyramidType>());
+
+        /// create the target pyramid with the pyramid parameters used by the deformation field registrations
+        virtual bool createTargetPyramid(const TargetType& target, TargetPyramidType& pyramid);
 
         /// if warped is true, the warped images will be computed; if initial is true, the registration will be initialized by deformation_field_ and deformation_field_inverse_
         virtual bool registerOverContainer2DPairWise(TargetContinerType& targetContainer, SourceContinerType& sourceContainer, bool warped, bool initial = false);
@@ -394,6 +405,15 @@ namespace Gadgetron
         /// in-FOV constraint
         bool apply_in_FOV_constraint_;
 
+        /// threading over the container
+        /// if true, the registration pairs are handed out to the threads one at a time (dynamic scheduling),
+        /// so pairs needing more iterations do not hold up the others; the thread budget is split between
+        /// the pairs and the inner solver of every pair, instead of switching on nested OpenMP without bound
+        bool dynamic_scheduling_;
+        /// total number of threads for the registration over the container, 0 means all processors
+        /// the default is registration.threads of the node profile
+        int max_num_of_threads_;
+
         /// verbose mode
         bool verbose_;
 
@@ -431,6 +451,12 @@ namespace Gadgetron
 
         bool initialize(const TargetContinerType& targetContainer, bool warped);
 
+        /// set up the threads to register numOfImages pairs, returns the number of threads over the pairs
+        /// innerThreads is the number of threads for the solver of every pair, 0 if not limited
+        /// the previous OpenMP settings are returned in nested, schedule and chunk, to be restored with restoreThreading
+        int setupThreading(long long numOfImages, int& innerThreads, int& nested, int& schedule, int& chunk, const char* caller);
+        void restoreThreading(int nested, int schedule, int chunk);
+
     };
 
     template<typename TargetType, typename SourceType, typename CoordType> 
@@ -480,6 +506,9 @@ namespace Gadgetron
         container_reg_mode_ = GT_IMAGE_REG_CONTAINER_PAIR_WISE;
         container_reg_transformation_ = GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD;
 
+        dynamic_scheduling_ = false;
+        max_num_of_threads_ = GadgetronNodeProfile::instance().get_int("registration.threads", 0);
+
         max_iter_num_pyramid_level_.clear();
         max_iter_num_pyramid_level_.resize(resolution_pyramid_levels_, 32);
         max_iter_num_pyramid_level_[0] = 16;
@@ -546,7 +575,7 @@ namespace Gadgetron
 
     template<typename TargetType, typename SourceType, typename CoordType> 
     bool hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
-    registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform)
+    registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, boost::shared_ptr<TargetPyramidType> targetPyramid)
     {
         try
         {
@@ -576,6 +605,7 @@ namespace Gadgetron
 
             reg.setTarget( const_cast<TargetType&>(target) );
             reg.setSource( const_cast<TargetType&>(source) );
+            reg.setTargetPyramid(targetPyramid);
 
             if ( verbose_ )
             {
@@ -643,7 +673,27 @@ namespace Gadgetron
 
     template<typename TargetType, typename SourceType, typename CoordType> 
     bool hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
-    registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv)
+    createTargetPyramid(const TargetType& target, TargetPyramidType& pyramid)
+    {
+        try
+        {
+            // the bidirectional registration uses the same pyramid parameters
+            hoImageRegDeformationFieldRegister<TargetType, CoordType> reg(resolution_pyramid_levels_, use_world_coordinates_, bg_value_);
+            GADGET_CHECK_RETURN_FALSE(reg.setDefaultParameters(resolution_pyramid_levels_, use_world_coordinates_));
+            GADGET_CHECK_RETURN_FALSE(reg.createTargetPyramid(const_cast<TargetType&>(target), pyramid));
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Error happened in hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::createTargetPyramid(...) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    bool hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv, boost::shared_ptr<TargetPyramidType> targetPyramid)
     {
         try
         {
@@ -677,6 +727,7 @@ namespace Gadgetron
 
             reg.setTarget( const_cast<TargetType&>(target) );
             reg.setSource( const_cast<SourceType&>(source) );
+            reg.setTargetPyramid(targetPyramid);
 
             if ( verbose_ )
             {
@@ -794,6 +845,65 @@ namespace Gadgetron
         return true;
     }
 
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    int hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    setupThreading(long long numOfImages, int& innerThreads, int& nested, int& schedule, int& chunk, const char* caller)
+    {
+        int numOfThreads = 1;
+        innerThreads = 0;
+
+        #ifdef USE_OMP
+            int numOfProcs = GadgetronThreadBudget::num_threads();
+
+            omp_sched_t sched;
+            omp_get_schedule(&sched, &chunk);
+            schedule = (int)sched;
+            nested = omp_get_nested();
+
+            if ( dynamic_scheduling_ )
+            {
+                int budget = (max_num_of_threads_>0) ? max_num_of_threads_ : numOfProcs;
+                numOfThreads = (numOfImages>budget) ? budget : (int)numOfImages;
+                if ( numOfThreads < 1 ) numOfThreads = 1;
+
+                // the threads not needed for the pairs go to the solver of every pair
+                innerThreads = budget/numOfThreads;
+                omp_set_nested( (innerThreads>1) ? 1 : 0 );
+                omp_set_schedule(omp_sched_dynamic, 1);
+
+                GDEBUG_STREAM(caller << " - dynamic scheduling, " << numOfThreads << " threads over the pairs, " << innerThreads << " per pair ... ");
+            }
+            else
+            {
+                if ( numOfImages < numOfProcs-1 )
+                {
+                    omp_set_nested(1);
+                    GDEBUG_STREAM(caller << " - nested openMP on ... ");
+                }
+                else
+                {
+                    omp_set_nested(0);
+                    GDEBUG_STREAM(caller << " - nested openMP off ... ");
+                }
+
+                numOfThreads = (numOfImages>numOfProcs) ? numOfProcs : numOfImages;
+                omp_set_schedule(omp_sched_static, 0);
+            }
+        #endif // USE_OMP
+
+        return numOfThreads;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    void hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    restoreThreading(int nested, int schedule, int chunk)
+    {
+        #ifdef USE_OMP
+            omp_set_nested(nested);
+            omp_set_schedule((omp_sched_t)schedule, chunk);
+        #endif // USE_OMP
+    }
+
     template<typename TargetType, typename SourceType, typename CoordType> 
     bool hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
     registerOverContainer2DPairWise(TargetContinerType& targetContainer, SourceContinerType& sourceContainer, bool warped, bool initial)
@@ -820,24 +930,8 @@ namespace Gadgetron
 
             GDEBUG_STREAM("registerOverContainer2DPairWise - threading ... ");
 
-            int numOfThreads = 1;
-
-            #ifdef USE_OMP
-                int numOfProcs = omp_get_num_procs();
-                int nested = omp_get_nested();
-                if ( numOfImages < numOfProcs-1 )
-                {
-                    omp_set_nested(1);
-                    GDEBUG_STREAM("registerOverContainer2DPairWise - nested openMP on ... ");
-                }
-                else
-                {
-                    omp_set_nested(0);
-                    GDEBUG_STREAM("registerOverContainer2DPairWise - nested openMP off ... ");
-                }
-
-                numOfThreads = (numOfImages>numOfProcs) ? numOfProcs : numOfImages;
-            #endif // USE_OMP
+            int innerThreads = 0, nested = 0, schedule = 0, chunk = 0;
+            int numOfThreads = this->setupThreading(numOfImages, innerThreads, nested, schedule, chunk, "registerOverContainer2DPairWise");
 
             unsigned int ii;
             long long n;
@@ -851,11 +945,15 @@ namespace Gadgetron
                     deformation_field_[ii].get_all_images(deform[ii]);
                 }
 
-                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, warpedImages) num_threads(numOfThreads)
+                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, warpedImages, innerThreads) num_threads(numOfThreads)
                 {
                     DeformationFieldType* deformCurr[DIn];
 
-                    #pragma omp for 
+                    #ifdef USE_OMP
+                        if ( innerThreads > 0 ) omp_set_num_threads(innerThreads);
+                    #endif // USE_OMP
+
+                    #pragma omp for schedule(runtime)
                     for ( n=0; n<numOfImages; n++ )
                     {
                         TargetType& target = *(targetImages[n]);
@@ -892,12 +990,16 @@ namespace Gadgetron
                     deformation_field_inverse_[ii].get_all_images(deformInv[ii]);
                 }
 
-                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, deformInv, warpedImages) num_threads(numOfThreads)
+                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, deformInv, warpedImages, innerThreads) num_threads(numOfThreads)
                 {
                     DeformationFieldType* deformCurr[DIn];
                     DeformationFieldType* deformInvCurr[DIn];
 
-                    #pragma omp for 
+                    #ifdef USE_OMP
+                        if ( innerThreads > 0 ) omp_set_num_threads(innerThreads);
+                    #endif // USE_OMP
+
+                    #pragma omp for schedule(runtime)
                     for ( n=0; n<numOfImages; n++ )
                     {
                         TargetType& target = *(targetImages[n]);
@@ -933,9 +1035,7 @@ namespace Gadgetron
                 GDEBUG_STREAM("To be implemented ...");
             }
 
-#ifdef USE_OMP
-            omp_set_nested(nested);
-#endif // USE_OMP
+            this->restoreThreading(nested, schedule, chunk);
         }
         catch(...)
         {
@@ -992,24 +1092,38 @@ namespace Gadgetron
 
             GADGET_CHECK_RETURN_FALSE(numOfImages==targetImages.size());
 
-            int numOfThreads = 1;
+            // every reference frame is the target of all images in its row, so its pyramid is computed only once
+            std::vector< boost::shared_ptr<TargetPyramidType> > targetPyramids(numOfImages);
+            if ( container_reg_transformation_ == GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD 
+                || container_reg_transformation_ == GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD_BIDIRECTIONAL )
+            {
+                std::vector< boost::shared_ptr<TargetPyramidType> > rowPyramids(row);
 
-            #ifdef USE_OMP
-                int numOfProcs = omp_get_num_procs();
-                int nested = omp_get_nested();
-                if ( numOfImages < numOfProcs-1 )
+                long long rr;
+
+                #pragma omp parallel for default(none) private(rr) shared(row, imageContainer, referenceFrame, rowPyramids) if ( row > 1 )
+                for ( rr=0; rr<(long long)row; rr++ )
                 {
-                    omp_set_nested(1);
-                    GDEBUG_STREAM("registerOverContainer2DFixedReference - nested openMP on ... ");
+                    boost::shared_ptr<TargetPyramidType> pyramid(new TargetPyramidType());
+                    if ( this->createTargetPyramid(imageContainer(rr, referenceFrame[rr]), *pyramid) )
+                    {
+                        rowPyramids[rr] = pyramid;
+                    }
                 }
-                else
+
+                ind = 0;
+                for ( r=0; r<row; r++ )
                 {
-                    omp_set_nested(0);
-                    GDEBUG_STREAM("registerOverContainer2DFixedReference - nested openMP off ... ");
+                    for ( c=0; c<col[r]; c++ )
+                    {
+                        targetPyramids[ind] = rowPyramids[r];
+                        ind++;
+                    }
                 }
+            }
 
-                numOfThreads = (numOfImages>numOfProcs) ? numOfProcs : numOfImages;
-            #endif // USE_OMP
+            int innerThreads = 0, nested = 0, schedule = 0, chunk = 0;
+            int numOfThreads = this->setupThreading(numOfImages, innerThreads, nested, schedule, chunk, "registerOverContainer2DFixedReference");
 
             if ( container_reg_transformation_ == GT_IMAGE_REG_TRANSFORMATION_DEFORMATION_FIELD )
             {
@@ -1020,11 +1134,15 @@ namespace Gadgetron
                     deformation_field_[ii].get_all_images(deform[ii]);
                 }
 
-                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, warpedImages) num_threads(numOfThreads)
+                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, targetPyramids, sourceImages, deform, warpedImages, innerThreads) num_threads(numOfThreads)
                 {
                     DeformationFieldType* deformCurr[DIn];
 
-                    #pragma omp for 
+                    #ifdef USE_OMP
+                        if ( innerThreads > 0 ) omp_set_num_threads(innerThreads);
+                    #endif // USE_OMP
+
+                    #pragma omp for schedule(runtime)
                     for ( n=0; n<numOfImages; n++ )
                     {
                         if ( targetImages[n] == sourceImages[n] )
@@ -1051,7 +1169,7 @@ namespace Gadgetron
                             deformCurr[ii] = deform[ii][n];
                         }
 
-                        registerTwoImagesDeformationField(target, source, initial, warpedImages[n], deformCurr);
+                        registerTwoImagesDeformationField(target, source, initial, warpedImages[n], deformCurr, targetPyramids[n]);
                     }
                 }
             }
@@ -1066,12 +1184,16 @@ namespace Gadgetron
                     deformation_field_inverse_[ii].get_all_images(deformInv[ii]);
                 }
 
-                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, sourceImages, deform, deformInv, warpedImages) num_threads(numOfThreads)
+                #pragma omp parallel default(none) private(n, ii) shared(numOfImages, initial, targetImages, targetPyramids, sourceImages, deform, deformInv, warpedImages, innerThreads) num_threads(numOfThreads)
                 {
                     DeformationFieldType* deformCurr[DIn];
                     DeformationFieldType* deformInvCurr[DIn];
 
-                    #pragma omp for 
+                    #ifdef USE_OMP
+                        if ( innerThreads > 0 ) omp_set_num_threads(innerThreads);
+                    #endif // USE_OMP
+
+                    #pragma omp for schedule(runtime)
                     for ( n=0; n<numOfImages; n++ )
                     {
                         if ( targetImages[n] == sourceImages[n] )
@@ -1102,7 +1224,7 @@ namespace Gadgetron
                             deformInvCurr[ii] = deformInv[ii][n];
                         }
 
-                        registerTwoImagesDeformationFieldBidirectional(target, source, initial, warpedImages[n], deformCurr, deformInvCurr);
+                        registerTwoImagesDeformationFieldBidirectional(target, source, initial, warpedImages[n], deformCurr, deformInvCurr, targetPyramids[n]);
                     }
                 }
             }
@@ -1112,9 +1234,7 @@ namespace Gadgetron
                 GDEBUG_STREAM("To be implemented ...");
             }
 
-#ifdef USE_OMP
-            omp_set_nested(nested);
-#endif // USE_OMP
+            this->restoreThreading(nested, schedule, chunk);
         }
         catch(...)
         {
@@ -7,6 +7,8 @@
 #define hoImageRegDissimilarityHistogramBased_H_
 
 #include <limits>
+#include <vector>
+#include <algorithm>
 #include "hoMatrix.h"
 #include "hoImageRegDissimilarity.h"
 
@@ -107,100 +109,145 @@ namespace Gadgetron
             hist_.createMatrix(num_bin_target_, num_bin_warpped_);
             Gadgetron::clear(hist_);
 
-            // intensity range
+            size_t N = target_->get_number_of_elements();
+            const ValueType* pT = target.begin();
+            const ValueType* pW = warped.begin();
+
+            long long n;
+
+            // intensity range, per thread and then reduced
             min_target_ = std::numeric_limits<ValueType>::max();
-            max_target_ = std::numeric_limits<ValueType>::min();
+            max_target_ = -std::numeric_limits<ValueType>::max();
 
             min_warpped_ = min_target_;
             max_warpped_ = max_target_;
 
-            size_t N = target_->get_number_of_elements();
-
-            long long n;
-            for ( n=0; n<(long long)N; n++ )
+            #pragma omp parallel private(n) shared(N, pT, pW) if(N>64*1024)
             {
-                ValueType vt = target(n);
-                if ( vt < min_target_ ) min_target_ = vt;
-                if ( vt > max_target_ ) max_target_ = vt;
+                ValueType minT = min_target_, maxT = max_target_, minW = min_warpped_, maxW = max_warpped_;
 
-                ValueType vw = warped(n);
-                if ( vw < min_warpped_ ) min_warpped_ = vw;
-                if ( vw > max_warpped_ ) max_warpped_ = vw;
+                #pragma omp for nowait
+                for ( n=0; n<(long long)N; n++ )
+                {
+                    ValueType vt = pT[n];
+                    if ( vt < minT ) minT = vt;
+                    if ( vt > maxT ) maxT = vt;
+
+                    ValueType vw = pW[n];
+                    if ( vw < minW ) minW = vw;
+                    if ( vw > maxW ) maxW = vw;
+                }
+
+                #pragma omp critical
+                {
+                    if ( minT < min_target_ ) min_target_ = minT;
+                    if ( maxT > max_target_ ) max_target_ = maxT;
+                    if ( minW < min_warpped_ ) min_warpped_ = minW;
+                    if ( maxW > max_warpped_ ) max_warpped_ = maxW;
+                }
             }
 
             ValueType range_t = ValueType(1.0)/(max_target_ - min_target_ + std::numeric_limits<ValueType>::epsilon());
             ValueType range_w = ValueType(1.0)/(max_warpped_ - min_warpped_ + std::numeric_limits<ValueType>::epsilon());
 
-            num_samples_in_hist_ = 0;
+            // every thread fills a private histogram, the histograms are summed at the end;
+            // the samples are processed in blocks, the bin coordinates of a block are computed in one loop first
+            const size_t numT = num_bin_target_;
+            const size_t numW = num_bin_warpped_;
+            const ValueType scaleT = range_t*(numT-1);
+            const ValueType scaleW = range_w*(numW-1);
+            const ValueType minT = min_target_;
+            const ValueType minW = min_warpped_;
+            const ValueType bg = bg_value_;
+            const bool pv = pv_interpolation_;
+
+            const long long step = (long long)( (step_size_ignore_pixel_>0) ? step_size_ignore_pixel_ : 1 );
+            const long long num_samples = ((long long)N + step - 1)/step;
+            const long long block_size = 256;
+            const long long num_blocks = (num_samples + block_size - 1)/block_size;
+
+            hist_value_type* pHist = hist_.begin();
+            size_t num_samples_in_hist = 0;
 
-            if ( pv_interpolation_ )
+            long long b;
+
+            #pragma omp parallel private(b) shared(pT, pW, pHist, num_samples_in_hist) if(num_samples>64*1024)
             {
-                #pragma omp parallel for default(none) private(n) shared(N, range_t, range_w)
-                for ( n=0; n<(long long)N; n+=(long long)step_size_ignore_pixel_ )
+                std::vector<hist_value_type> h(numT*numW, 0);
+                size_t count = 0;
+
+                ValueType xT[block_size], xW[block_size];
+                bool valid[block_size];
+
+                #pragma omp for nowait
+                for ( b=0; b<num_blocks; b++ )
                 {
-                    ValueType vt = target(n);
-                    ValueType vw = warped(n);
+                    const long long m0 = b*block_size;
+                    const long long M = std::min(block_size, num_samples - m0);
 
-                    if ( std::abs(vt-bg_value_)<FLT_EPSILON 
-                        && std::abs(vw-bg_value_)<FLT_EPSILON )
+                    long long k;
+                    for ( k=0; k<M; k++ )
                     {
-                        continue;
+                        ValueType vt = pT[(m0+k)*step];
+                        ValueType vw = pW[(m0+k)*step];
+
+                        valid[k] = !( std::abs(vt-bg)<FLT_EPSILON && std::abs(vw-bg)<FLT_EPSILON );
+
+                        xT[k] = scaleT*(vt-minT);
+                        xW[k] = scaleW*(vw-minW);
                     }
 
-                    ValueType xT = range_t*(vt-min_target_)*(num_bin_target_-1);
-                    ValueType xW = range_w*(vw-min_warpped_)*(num_bin_warpped_-1);
+                    if ( pv )
+                    {
+                        for ( k=0; k<M; k++ )
+                        {
+                            if ( !valid[k] ) continue;
 
-                    size_t indT = static_cast<size_t>(xT);
-                    size_t indW = static_cast<size_t>(xW);
+                            size_t indT = static_cast<size_t>(xT[k]);
+                            size_t indW = static_cast<size_t>(xW[k]);
 
-                    ValueType sT, s1T, sW, s1W;
+                            ValueType sT, s1T, sW, s1W;
 
-                    sT = xT - indT; s1T = 1 - sT;
-                    sW = xW - indW; s1W = 1 - sW;
+                            sT = xT[k] - indT; s1T = 1 - sT;
+                            sW = xW[k] - indW; s1W = 1 - sW;
 
-                    #pragma omp critical
-                    {
-                        hist_(indT, indW) += s1T*s1W;
+                            hist_value_type* p = &h[indT + indW*numT];
+                            p[0] += s1T*s1W;
 
-                        if ( indT<num_bin_target_-1 && indW<num_bin_warpped_-1 )
-                        {
-                            hist_(indT, indW+1) += s1T*sW;
-                            hist_(indT+1, indW) += sT*s1W;
-                            hist_(indT+1, indW+1) += sT*sW;
+                            if ( indT<numT-1 && indW<numW-1 )
+                            {
+                                p[numT] += s1T*sW;
+                                p[1] += sT*s1W;
+                                p[numT+1] += sT*sW;
+                            }
+
+                            count++;
                         }
                     }
-
-                    #pragma omp atomic
-                    num_samples_in_hist_++;
-                }
-            }
-            else
-            {
-                #pragma omp parallel for default(none) private(n) shared(N, range_t, range_w)
-                for ( n=0; n<(long long)N; n+=(long long)step_size_ignore_pixel_ )
-                {
-                    ValueType vt = target(n);
-                    ValueType vw = warped(n);
-
-                    if ( std::abs(vt-bg_value_)<FLT_EPSILON 
-                        && std::abs(vw-bg_value_)<FLT_EPSILON )
+                    else
                     {
-                        continue;
-                    }
+                        for ( k=0; k<M; k++ )
+                        {
+                            if ( !valid[k] ) continue;
 
-                    size_t indT = static_cast<size_t>( range_t*(vt-min_target_)*(num_bin_target_-1) + 0.5 );
-                    size_t indW = static_cast<size_t>( range_w*(vw-min_warpped_)*(num_bin_warpped_-1) + 0.5 );
+                            size_t indT = static_cast<size_t>( xT[k] + 0.5 );
+                            size_t indW = static_cast<size_t>( xW[k] + 0.5 );
 
-                    #pragma omp critical
-                    {
-                        hist_(indT, indW)++;
+                            h[indT + indW*numT]++;
+                            count++;
+                        }
                     }
+                }
 
-                    #pragma omp atomic
-                    num_samples_in_hist_++;
+                #pragma omp critical
+                {
+                    for ( size_t i=0; i<numT*numW; i++ ) pHist[i] += h[i];
+                    num_samples_in_hist += count;
                 }
             }
 
+            num_samples_in_hist_ = num_samples_in_hist;
+
             if ( !debugFolder_.empty() ) {  gt_exporter_.export_array(hist_, debugFolder_+"hist2D"); }
         }
         catch(...)
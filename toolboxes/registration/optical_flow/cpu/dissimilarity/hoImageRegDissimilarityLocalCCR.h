@@ -87,12 +87,15 @@ namespace Gadgetron
         hoNDArray<computing_value_type> v2; computing_value_type* p_v2;
         hoNDArray<computing_value_type> v12; computing_value_type* p_v12;
 
+        /// the smoothed target mean and second moment do not depend on the warped image
+        /// they are computed once in initialize, with the sigmaArg_ set at that time
+        hoNDArray<computing_value_type> mu1_target_;
+        hoNDArray<computing_value_type> v1_target_;
+
         //hoNDArray<computing_value_type> vv1; computing_value_type* p_vv1;
         //hoNDArray<computing_value_type> vv2; computing_value_type* p_vv2;
         //hoNDArray<computing_value_type> vv12; computing_value_type* p_vv12;
 
-        hoNDArray<computing_value_type> mem_;
-
         computing_value_type eps_;
     };
 
@@ -140,13 +143,29 @@ namespace Gadgetron
         //vv2.create(image_dim_); p_vv2 = vv2.begin();
         //vv12.create(image_dim_); p_vv12 = vv12.begin();
 
-        #ifdef WIN32
-            size_t v=0;
-            for ( size_t ii=0; ii<image_dim_.size(); ii++ ) v+=image_dim_[ii];
-            mem_.create(2*v);
-        #endif // WIN32
-
         eps_ = std::numeric_limits<computing_value_type>::epsilon();
+
+        mu1_target_.create(image_dim_);
+        v1_target_.create(image_dim_);
+
+        long long N = (long long)target.get_number_of_elements();
+        const ValueType* pT = target.begin();
+        computing_value_type* p_mu1_target = mu1_target_.begin();
+        computing_value_type* p_v1_target = v1_target_.begin();
+
+        long long n;
+        #pragma omp parallel for private(n) shared(N, pT, p_mu1_target, p_v1_target) if(N>64*1024)
+        for ( n=0; n<N; ++n )
+        {
+            const computing_value_type v = (computing_value_type)pT[n];
+            p_mu1_target[n] = v;
+            p_v1_target[n] = v*v;
+        }
+
+        std::vector< hoNDArray<computing_value_type>* > moments(2);
+        moments[0] = &mu1_target_;
+        moments[1] = &v1_target_;
+        Gadgetron::filterGaussianMultiple(moments, sigmaArg_);
     }
 
     template<typename ImageType> 
@@ -219,31 +238,27 @@ namespace Gadgetron
             ValueType* pT = target.begin();
             ValueType* pW = warped.begin();
 
+            // v1 is overwritten below, so the smoothed target moments are copied in every evaluation
+            memcpy(p_mu1, mu1_target_.begin(), sizeof(computing_value_type)*N);
+            memcpy(p_v1, v1_target_.begin(), sizeof(computing_value_type)*N);
+
+            #pragma omp parallel for private(n) shared(N, pT, pW) if(N>64*1024)
             for ( n=0; n<N; ++n )
             {
                 const computing_value_type v1 = (computing_value_type)pT[n];
                 const computing_value_type v2 = (computing_value_type)pW[n];
 
-                p_mu1[n] = v1;
                 p_mu2[n] = v2;
-                p_v1[n] = v1*v1;
                 p_v2[n] = v2*v2;
                 p_v12[n] = v1*v2;
             }
 
-                //#ifdef WIN32
-                    Gadgetron::filterGaussian(mu1, sigmaArg_, mem_.begin());
-                    Gadgetron::filterGaussian(mu2, sigmaArg_, mem_.begin());
-                    Gadgetron::filterGaussian(v1, sigmaArg_, mem_.begin());
-                    Gadgetron::filterGaussian(v2, sigmaArg_, mem_.begin());
-                    Gadgetron::filterGaussian(v12, sigmaArg_, mem_.begin());
-                //#else
-                //    Gadgetron::filterGaussian(mu1, sigmaArg_);
-                //    Gadgetron::filterGaussian(mu2, sigmaArg_);
-                //    Gadgetron::filterGaussian(v1, sigmaArg_);
-                //    Gadgetron::filterGaussian(v2, sigmaArg_);
-                //    Gadgetron::filterGaussian(v12, sigmaArg_);
-                //#endif // WIN32
+            // the three moments are smoothed together, the recursive filter costs the same for any window size
+            std::vector< hoNDArray<computing_value_type>* > moments(3);
+            moments[0] = &mu2;
+            moments[1] = &v2;
+            moments[2] = &v12;
+            Gadgetron::filterGaussianMultiple(moments, sigmaArg_);
 
             //if ( 0 )
             //{
@@ -289,9 +304,10 @@ namespace Gadgetron
             //}
 
             dissimilarity_ = 0;
-            computing_value_type v=0;
 
-            //#pragma omp parallel for private(n)
+            computing_value_type lcc = 0;
+
+            #pragma omp parallel for private(n) reduction(+:lcc) if(N>64*1024)
             for ( n=0; n<N; ++n )
             {
                 const computing_value_type u1 = p_mu1[n];
@@ -302,22 +318,15 @@ namespace Gadgetron
                 const computing_value_type vv12 = p_v12[n] - u1 * u2;
 
                 const computing_value_type ff1 = vv12 / (vv1 * vv2);
-                const computing_value_type lcc = vv12 * ff1;
+                const computing_value_type lcc_n = vv12 * ff1;
 
-                const computing_value_type ff2 = - lcc / vv2;
+                const computing_value_type ff2 = - lcc_n / vv2;
                 const computing_value_type ff3 = ff2 * u2 + ff1 * u1;
 
                 p_v1[n] = ff1; p_v2[n] = ff2; p_v12[n] = ff3;
 
-                p_cc[n] = lcc;
-            }
-
-            computing_value_type lcc = 0;
-
-            // #pragma omp parallel for reduction(+:lcc)
-            for (n=0; n<N; n++)
-            {
-                lcc += cc[n];
+                p_cc[n] = lcc_n;
+                lcc += lcc_n;
             }
 
             dissimilarity_ = -lcc/N;
@@ -341,29 +350,11 @@ namespace Gadgetron
 
             long long n;
 
-            //#pragma omp parallel sections if ( D==2 )
-            {
-                //#ifdef WIN32
-                    //#pragma omp section
-                    {
-                        Gadgetron::filterGaussian(v1, sigmaArg_, mem_.begin());
-                    }
-
-                    //#pragma omp section
-                    {
-                        Gadgetron::filterGaussian(v2, sigmaArg_, mem_.begin());
-                    }
-
-                    //#pragma omp section
-                    {
-                        Gadgetron::filterGaussian(v12, sigmaArg_, mem_.begin());
-                    }
-                //#else
-                //    Gadgetron::filterGaussian(v1, sigmaArg_);
-                //    Gadgetron::filterGaussian(v2, sigmaArg_);
-                //    Gadgetron::filterGaussian(v12, sigmaArg_);
-                //#endif // WIN32
-            }
+            std::vector< hoNDArray<computing_value_type>* > f(3);
+            f[0] = &v1;
+            f[1] = &v2;
+            f[2] = &v12;
+            Gadgetron::filterGaussianMultiple(f, sigmaArg_);
 
             // deriv = f1*i1 + f2*i2 + f3, we don't need to multiply this by 2.0
 
@@ -379,7 +370,7 @@ namespace Gadgetron
                 T* pT = target.begin();
                 T* pW = warped.begin();
 
-                // #pragma omp parallel for default(none) shared(N, pT, pW)
+                #pragma omp parallel for private(n) shared(N, pT, pW) if(N>64*1024)
                 for ( n=0; n<(long long)N; n++ )
                 {
                     deriv(n) = static_cast<T>( p_v1[n]* (computing_value_type)pT[n] + ( p_v2[n]*(computing_value_type)pW[n] - p_v12[n] ) );
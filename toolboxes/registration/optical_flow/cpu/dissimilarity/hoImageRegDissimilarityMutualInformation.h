@@ -250,15 +250,25 @@ namespace Gadgetron {
             ValueType range_t = ValueType(1.0)/(max_target_ - min_target_ + std::numeric_limits<ValueType>::epsilon());
             ValueType range_w = ValueType(1.0)/(max_warpped_ - min_warpped_ + std::numeric_limits<ValueType>::epsilon());
 
+            const ValueType scaleT = range_t*(num_bin_target_-1);
+            const ValueType scaleW = range_w*(num_bin_warpped_-1);
+            const ValueType minT = min_target_;
+            const ValueType minW = min_warpped_;
+            const ValueType* pT = target.begin();
+            const ValueType* pW = warped.begin();
+            ValueType* pDeriv = deriv_.begin();
+
             long long n;
 
+            // the linear interpolator keeps no state, the pixels are independent
             ValueType v = (ValueType)(1.0/N);
+            #pragma omp parallel for private(n) shared(N, pT, pW, pDeriv, interp_Dist) if(N>64*1024)
             for ( n=0; n<(long long)N; n++ )
             {
-                coord_type it = (coord_type)(range_t*(target(n)-min_target_)*(num_bin_target_-1));
-                coord_type iw = (coord_type)(range_w*(warped(n)-min_warpped_)*(num_bin_warpped_-1));
+                coord_type it = (coord_type)(scaleT*(pT[n]-minT));
+                coord_type iw = (coord_type)(scaleW*(pW[n]-minW));
 
-                deriv_(n) = ValueType( interp_Dist(it, iw) ) * v;
+                pDeriv[n] = ValueType( interp_Dist(it, iw) ) * v;
             }
 
             // Gadgetron::math::scal(deriv_.get_number_of_elements(), ValueType(1.0/N), deriv_.begin());
@@ -1,4 +1,5 @@
 #include "hoCKOpticalFlowSolver.h"
+#include "hoOpticalFlowSweep.h"
 #include "vector_td_utilities.h"
 
 #ifdef USE_OMP
@@ -7,37 +8,6 @@
 
 namespace Gadgetron{
 
-  // Helpers
-  //
-  
-  template<unsigned int D> inline bool
-  is_border_pixel_for_stride( typename int64d<D>::Type stride, typename uint64d<D>::Type co, typename uint64d<D>::Type dims )
-  {
-    for( size_t d=0; d<D; d++ ){
-      if( stride.vec[d] == -1 ){
-	if( co.vec[d] == 0 ){
-	  return true;
-	}
-      }
-      else if( stride.vec[d] == 1 ){
-	if( co.vec[d] == (dims.vec[d]-1) ){
-	  return true;
-	}
-      }
-    }
-    return false;
-  }
-
-  template<size_t i, size_t j> struct Pow
-  {
-    enum { Value = i*Pow<i,j-1>::Value };
-  };
-  
-  template <size_t i> struct Pow<i,1>
-  {
-    enum { Value = i };
-  };
-  
   //
   // Implementation
   //
@@ -60,37 +30,48 @@ namespace Gadgetron{
     //
   
     boost::shared_ptr< std::vector<size_t> > disp_dims = _gradient_image->get_dimensions();
-    boost::shared_ptr< hoNDArray<T> > displacements_ping( new hoNDArray<T>(disp_dims.get()) );
-    boost::shared_ptr< hoNDArray<T> > displacements_pong( new hoNDArray<T>(disp_dims.get()) );
-    clear(displacements_ping.get());
-    clear(displacements_pong.get());
-    
-    // We use "shared memory" to hold the averaged displacements
-    boost::shared_ptr< hoNDArray<T> > _shared_mem(new hoNDArray<T>(disp_dims.get()));
-    T *shared_mem = _shared_mem->get_data_ptr();
-    clear( _shared_mem.get());
+
+    // The displacements are updated in place
+    boost::shared_ptr< hoNDArray<T> > displacements( new hoNDArray<T>(disp_dims.get()) );
+    clear(displacements.get());
 
     typename uint64d<D>::Type matrix_size = from_std_vector<size_t,D>( *disp_dims );  
-    size_t number_of_elements = prod(matrix_size);
     size_t num_batches = 1;
 
     for( size_t d=D; d<_gradient_image->get_number_of_dimensions()-1; d++ ){
       num_batches *= _gradient_image->get_size(d);
     }
+
+    // Number of elements per batch
+    const size_t num_elements_per_batch = prod(matrix_size);
+  
+    // Number of elements per dim
+    const size_t num_elements_per_dim = num_elements_per_batch*num_batches;
+
+    const hoOpticalFlowSweep<T,D> sweep( matrix_size, num_batches );
+    const long long num_lines = sweep.lines();
+    const long long N0 = sweep.length();
+
+    T *disp = displacements->get_data_ptr();
+    const T *gradient_image = _gradient_image->get_data_ptr();
+    const T *stencil_image = (_stencil_image) ? _stencil_image->get_data_ptr() : 0x0;
+
+    const T disp_thresh_sqr = this->limit_*this->limit_;
+    const T omega = this->sor_relaxation_;
+    const T ab_sqr = (alpha_/beta_)*(alpha_/beta_);
+    const T alpha_sqr = alpha_*alpha_;
   
     // Get ready
     // 
 
     size_t iteration_no = 0;
-    hoNDArray<T> *ping = displacements_ping.get();
-    hoNDArray<T> *pong = displacements_pong.get(); 
 
     if( this->output_mode_ >= hoOpticalFlowSolver<T,D>::OUTPUT_VERBOSE ) {
       GDEBUG_STREAM(std::endl);
     }
 
     //
-    // Main Jacobi loop
+    // Main Gauss-Seidel loop
     //
     
     while(true){
@@ -98,171 +79,97 @@ namespace Gadgetron{
       if( this->output_mode_ >= hoOpticalFlowSolver<T,D>::OUTPUT_VERBOSE ) {
 	GDEBUG_STREAM("."; std::cout.flush());
       }
-    
-      // Continuation flag used for early Jacobi termination
-      size_t continue_flag = 0;
-
-      // Number of elements per batch
-      const size_t num_elements_per_batch = prod(matrix_size);
-  
-      // Number of elements per dim
-      const size_t num_elements_per_dim = num_elements_per_batch*num_batches;
 
-      T *in_disp = ping->get_data_ptr();
-      T *out_disp = pong->get_data_ptr();
-      T *gradient_image = _gradient_image->get_data_ptr();
-      T *stencil_image = (_stencil_image) ? _stencil_image->get_data_ptr() : 0x0;
+      // The termination test is only done every convergence_check_interval_ iterations
+      const bool check_convergence = ((iteration_no+1)%this->convergence_check_interval_ == 0);
+    
+      // Continuation flag used for early termination
+      int continue_flag = 0;
 
       //
-      // Find the average velocities (shared memory)
+      // Update the displacement field and the intensity attenuation colour by colour,
+      // pixels of the same colour are not neighbours
       //
-      
-      for( size_t dim = 0; dim < D+1; dim++ ){
+
+      for( unsigned int colour = 0; colour < hoOpticalFlowSweep<T,D>::NUM_COLOURS; colour++ ){
+
+	long long l;
+
 #ifdef USE_OMP
-#pragma omp parallel for
+#pragma omp parallel for private(l) if(num_lines*N0 > 4096)
 #endif
-	for( long long idx = 0; idx < (long long)num_elements_per_dim; idx++ ){
-	  	  
-	  // Index to the shared memory
-	  const size_t shared_idx = dim*num_elements_per_dim+idx;
-	  
-	  // Batch idx (second slowest varying dimension)   
-	  const size_t batch_idx = idx/num_elements_per_batch;
-	  
-	  // Local index to the image (or batch in our terminology)
-	  const size_t idx_in_batch = idx-batch_idx*num_elements_per_batch;
-    	  
-	  if( stencil_image && stencil_image[idx_in_batch] > T(0) )
+	for( l = 0; l < num_lines; l++ ){
+
+	  if( sweep.line_colour(l) != (colour>>1) )
 	    continue;
 
-	  // Local co to the image
-	  const typename uint64d<D>::Type co = idx_to_co<D>( idx_in_batch, matrix_size );    
-	  const typename int64d<D>::Type zeros(0);
-	  const typename int64d<D>::Type ones(1);
-	  const typename int64d<D>::Type threes(3);
-	  
-	  const int num_neighbors = Pow<3,D>::Value;
-	  T num_contribs = T(0);
-	  
-	  shared_mem[shared_idx] = T(0);
-	  
-	  // Compute average of neighbors
-	  //
-	  
-	  for( long long i=0; i<num_neighbors; i++ ){
-	    
-	    // Find the stride of the neighbor {-1, 0, 1}^D
-	    const typename int64d<D>::Type stride = idx_to_co<D>( i, threes ) - ones;
-	    
-	    size_t neighbor_idx;
-	    
-	    const size_t base_offset = dim*num_elements_per_dim + batch_idx*num_elements_per_batch;
-	    
-	    // Verify that the neighbor is not out of bounds (and not the thread itself)
-	    if( !is_border_pixel_for_stride<D>( stride, co, matrix_size ) && !(stride==zeros) ){	
-	      neighbor_idx = (size_t) co_to_idx<D>( vector_td<long long,D>(co)+stride, vector_td<long long,D>(matrix_size)) + base_offset;
-	    }
-	    else{
-	      neighbor_idx = idx_in_batch + base_offset;
+	  long long nb[hoOpticalFlowSweep<T,D>::NUM_NEIGHBOUR_LINES];
+	  sweep.neighbour_lines(l, nb);
+
+	  const long long line = l*N0;
+	  const long long line_in_batch = sweep.offset_in_batch(l);
+
+	  for( long long x = (colour&1); x < N0; x += 2 ){
+
+	    if( stencil_image && stencil_image[line_in_batch+x] > T(0) )
+	      continue;
+
+	    const long long idx = line+x;
+
+	    T phi = T(0);
+	    T norm = T(0);
+
+	    typename reald<T,D>::Type derivatives, averages;
+
+	    // Contributions from the spatial dimensions
+	    //
+
+	    for( size_t d=0; d<D; d++ ){
+	      derivatives.vec[d] = gradient_image[d*num_elements_per_dim+idx];
+	      averages.vec[d] = sweep.average_clamped( disp+d*num_elements_per_dim, nb, x );
+	      phi += averages.vec[d]*derivatives.vec[d];
+	      norm += derivatives.vec[d]*derivatives.vec[d];
 	    }
-	    
-	    shared_mem[shared_idx] += in_disp[neighbor_idx];
-	    num_contribs += T(1);
-	  }
-	  
-	  // Normalize
-	  shared_mem[shared_idx] /= num_contribs;
-	}
-      }
-      
-      //
-      // Update displacement field (Jacobi iteration)
-      //
-      
-      const T disp_thresh_sqr = this->limit_*this->limit_;
 
-      for( size_t dim = 0; dim < D+1; dim++ ){
-#ifdef USE_OMP
-#pragma omp parallel for
-#endif
-	for( long long idx = 0; idx < num_elements_per_dim; idx++ ){  
-	  // Index to the shared memory
-	  const size_t shared_idx = dim*num_elements_per_dim+idx;
-	  
-	  // Batch idx (second slowest varying dimension)   
-	  const size_t batch_idx = idx/num_elements_per_batch;
-	  
-	  // Local index to the image (or batch in our terminology)
-	  const size_t idx_in_batch = idx-batch_idx*num_elements_per_batch;
-    	  
-	  if( stencil_image && stencil_image[idx_in_batch] > T(0) )
-	    continue;
+	    // Contributions from the temporal dimension
+	    //
+
+	    phi += gradient_image[D*num_elements_per_dim+idx];
+
+	    // Contribution from the intensity attentuation estimation
+	    //
+
+	    const T attenuation = sweep.average_clamped( disp+D*num_elements_per_dim, nb, x );
+	    phi -= attenuation;
+
+	    // Normalize
+	    //
+
+	    phi /= (ab_sqr+alpha_sqr+norm);
 
-	  T phi = T(0);
-	  T norm = T(0);
-	  
-	  typename reald<T,D>::Type derivatives;
-	  
-	  // Contributions from the spatial dimensions
-	  //
-	  
-	  for( size_t d=0; d<D; d++ ){
-	    derivatives.vec[d] = gradient_image[d*num_elements_per_dim+idx];
-	    const size_t shared_idx_d = d*num_elements_per_dim+idx;
-	    phi += (shared_mem[shared_idx_d]*derivatives.vec[d]);
-	    norm += (derivatives.vec[d]*derivatives.vec[d]);
+	    // Form result displacements, over-relaxed
+	    //
+
+	    for( size_t d=0; d<D; d++ ){
+	      T &u = disp[d*num_elements_per_dim+idx];
+	      const T delta = omega*(averages.vec[d]-derivatives.vec[d]*phi-u);
+	      u += delta;
+
+	      // Set the continuation flag if the displacement field has changed above the threshold
+	      if( check_convergence && delta*delta > disp_thresh_sqr )
+		continue_flag = 1;
+	    }
+
+	    T &a = disp[D*num_elements_per_dim+idx];
+	    a += omega*(attenuation+ab_sqr*phi-a);
 	  }
-	  
-	  // Contributions from the temporal dimension
-	  //
-	  
-	  phi += gradient_image[D*num_elements_per_dim+idx];
-	  
-	  // Contribution from the intensity attentuation estimation
-	  //
-	  
-	  phi -= shared_mem[D*num_elements_per_dim+idx];
-	  
-	  // Normalize
-	  //
-	  
-	  phi /= ((alpha_/beta_)*(alpha_/beta_)+alpha_*alpha_+norm);
-	  
-	  // Form result displacement
-	  //
-	  
-	  T result;
-	  
-	  if( dim<D )
-	    result = shared_mem[shared_idx]-derivatives.vec[dim]*phi;
-	  else
-	    result = shared_mem[D*num_elements_per_dim+idx]+(alpha_/beta_)*(alpha_/beta_)*phi;
-	  
-	  // Clear the "termination" flag if the displacement field has changed above the threshold
-	  //
-	  
-	  T delta = result-in_disp[dim*num_elements_per_dim+idx];
-	  if( dim < D && delta*delta > disp_thresh_sqr )
-	    continue_flag = 1;
-	  
-	  // Output result
-	  //
-	  
-	  out_disp[dim*num_elements_per_dim+idx] = result;
 	}
       }
-      
-      // Swap in/out buffers
-      //
-      
-      hoNDArray<T> *tmp = ping;
-      ping = pong;
-      pong = tmp;
 
       // Check termination criteria
       //
       
-      if( continue_flag == 0 ){
+      if( check_convergence && continue_flag == 0 ){
 	if( this->output_mode_ >= hoOpticalFlowSolver<T,D>::OUTPUT_VERBOSE ) {
 	  GDEBUG_STREAM(std::endl << "Break after " << iteration_no+1 << " iterations" << std::endl);
 	}
@@ -275,10 +182,7 @@ namespace Gadgetron{
       iteration_no++;
     }
     
-    if( ping == displacements_ping.get() )   
-      return displacements_ping;
-    else
-      return displacements_pong;
+    return displacements;
   }
   
   // 
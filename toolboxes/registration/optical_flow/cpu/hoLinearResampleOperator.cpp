@@ -6,8 +6,33 @@
 #include <stdio.h>
 #include <cmath>
 
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
 namespace Gadgetron{
 
+  // out_j = sum_i M(i,j) in_i for the compressed sparse column matrix M
+  template <class T, class REAL> static void
+  resample_gather( const arma::SpMat<REAL>& M, const T *in, T *out, bool accumulate )
+  {
+    const long long num_cols = (long long) M.n_cols;
+    const arma::uword *col_ptrs = M.col_ptrs;
+    const arma::uword *row_indices = M.row_indices;
+    const REAL *values = M.values;
+
+    long long j;
+#ifdef USE_OMP
+#pragma omp parallel for private(j) if(num_cols > 4096)
+#endif
+    for( j=0; j<num_cols; j++ ){
+      T res = T(0);
+      for( arma::uword k=col_ptrs[j]; k<col_ptrs[j+1]; k++ )
+        res += values[k]*in[row_indices[k]];
+      out[j] = accumulate ? out[j]+res : res;
+    }
+  }
+
   template <class T, unsigned int D>
   void hoLinearResampleOperator<T,D>::mult_M( hoNDArray<T> *in, hoNDArray<T> *out, bool accumulate )
   {
@@ -18,10 +43,12 @@ namespace Gadgetron{
     if( !in || !in->get_data_ptr() || !out || !out->get_data_ptr() ){
       throw std::runtime_error("hoLinearResampleOperator::mult_M(): illegal input/output array." );
     }
-  
-    arma::Row<typename stdType<T>::Type > in_vec = as_arma_row(in);
-    arma::Row<typename stdType<T>::Type > out_vec = as_arma_row(out);
-    out_vec = in_vec*R_T_;
+
+    if( in->get_number_of_elements() != R_T_.n_rows || out->get_number_of_elements() != R_T_.n_cols ){
+      throw std::runtime_error("hoLinearResampleOperator::mult_M(): input/output array size does not match the displacements." );
+    }
+
+    resample_gather( R_T_, in->get_data_ptr(), out->get_data_ptr(), accumulate );
   }
 
   template <class T, unsigned int D>
@@ -35,15 +62,18 @@ namespace Gadgetron{
       throw std::runtime_error("hoLinearResampleOperator::mult_M(): illegal input/output array." );
     }
 
-    arma::Col<typename stdType<T>::Type > in_vec = as_arma_col(in);
-    arma::Col<typename stdType<T>::Type > out_vec = as_arma_col(out);
-    out_vec = R_T_ * in_vec;
+    if( in->get_number_of_elements() != R_.n_rows || out->get_number_of_elements() != R_.n_cols ){
+      throw std::runtime_error("hoLinearResampleOperator::mult_MH(): input/output array size does not match the displacements." );
+    }
+
+    resample_gather( R_, in->get_data_ptr(), out->get_data_ptr(), accumulate );
   }
   
   template <class T, unsigned int D>
   void hoLinearResampleOperator<T,D>::reset()
   {
     R_T_.reset();
+    R_.reset();
     resampleOperator< hoNDArray<typename realType<T>::Type>, hoNDArray<T> >::reset();
   }
   
@@ -170,6 +200,7 @@ namespace Gadgetron{
     locations.resize(2,location_index);
     values.resize(location_index);
     R_T_ = arma::SpMat<REAL>( locations, values, num_elements_mat*extended_dim, num_elements_ext, false );
+    R_ = R_T_.t();
     this->preprocessed_ = true;
   }
 
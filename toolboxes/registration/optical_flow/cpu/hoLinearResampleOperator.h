@@ -26,6 +26,9 @@ namespace Gadgetron{
     inline unsigned int get_num_neighbors();
   
   protected:
+    // Both products gather over the columns of a compressed sparse column matrix, so the elements of
+    // the output are computed independently and in parallel. The matrices are built once per displacement field.
     arma::SpMat<typename realType<T>::Type> R_T_; //Contains the TRANSPOSED resampling matrix.
+    arma::SpMat<typename realType<T>::Type> R_; //Contains the resampling matrix, for the adjoint.
   };
 }
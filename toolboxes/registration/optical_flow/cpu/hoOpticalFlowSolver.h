@@ -22,8 +22,22 @@ namespace Gadgetron{
   {  
   public:
   
-    hoOpticalFlowSolver() : opticalFlowSolver< hoNDArray<T>,D >() {}   
+    hoOpticalFlowSolver() : opticalFlowSolver< hoNDArray<T>,D >() {
+      sor_relaxation_ = T(1);
+      convergence_check_interval_ = 4;
+    }
     virtual ~hoOpticalFlowSolver() {}
+
+    // The core solvers run in place Gauss-Seidel sweeps over the pixels in 2^D colours (see hoOpticalFlowSweep.h).
+    // Set the relaxation factor of the successive over-relaxation, in (0,2); 1 gives the plain Gauss-Seidel update
+    //
+
+    inline void set_sor_relaxation( T omega ) { sor_relaxation_ = omega; }
+
+    // Test for convergence every k'th iteration only
+    //
+
+    inline void set_convergence_check_interval( unsigned int k ) { convergence_check_interval_ = (k > 0) ? k : 1; }
     
   protected:
 
@@ -42,5 +56,9 @@ namespace Gadgetron{
 				     typename uint64d<D>::Type matrix_size_moving, 
 				     size_t number_of_batches_fixed, 
 				     size_t number_of_batches_moving );
+
+  protected:
+    T sor_relaxation_;
+    unsigned int convergence_check_interval_;
   };  
 }
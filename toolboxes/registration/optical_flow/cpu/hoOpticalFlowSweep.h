@@ -0,0 +1,133 @@
+/** \file hoOpticalFlowSweep.h
+    \brief Line geometry of the multicolour Gauss-Seidel sweeps of the CPU-based optical flow solvers.
+
+    The Horn-Schunck and Cornelius-Kanade updates of a pixel depend on the average displacement over its 3^D neighbourhood.
+    Colouring the pixels by the parities of their D coordinates gives 2^D colours, and no two pixels of the same colour
+    are neighbours, so all pixels of one colour can be updated in place and in parallel from the latest values of the
+    other colours (the red-black ordering, generalized from the 2D cross to the 3^D box stencil).
+
+    The pixels are visited line by line along the first dimension; the 3^(D-1) neighbouring lines of every line
+    are located once, so the inner loops only step along contiguous memory.
+*/
+
+#pragma once
+
+#include "vector_td_utilities.h"
+
+namespace Gadgetron{
+
+  template<unsigned int D> struct hoOpticalFlowNeighbourLines
+  {
+    enum { Value = 3*hoOpticalFlowNeighbourLines<D-1>::Value };
+  };
+
+  template<> struct hoOpticalFlowNeighbourLines<1>
+  {
+    enum { Value = 1 };
+  };
+
+  template<class T, unsigned int D> class hoOpticalFlowSweep
+  {
+  public:
+
+    enum { NUM_NEIGHBOUR_LINES = hoOpticalFlowNeighbourLines<D>::Value, CENTER_LINE = (hoOpticalFlowNeighbourLines<D>::Value-1)/2, NUM_COLOURS = 1<<D };
+
+    hoOpticalFlowSweep( const typename uint64d<D>::Type& matrix_size, size_t num_batches )
+      : matrix_size_(matrix_size)
+    {
+      elements_per_batch_ = (long long)prod(matrix_size);
+      lines_per_batch_ = elements_per_batch_/(long long)matrix_size[0];
+      lines_ = lines_per_batch_*(long long)num_batches;
+    }
+
+    // Length of the lines
+    inline long long length() const { return (long long)matrix_size_[0]; }
+
+    // Number of lines, over all batches
+    inline long long lines() const { return lines_; }
+
+    // Index of the first pixel of line l in its batch
+    inline long long offset_in_batch( long long l ) const { return (l%lines_per_batch_)*length(); }
+
+    // Colour of line l, the parities of its coordinates along dimensions 1 to D-1.
+    // Pixel x of the line has colour (line_colour << 1) | (x & 1).
+    inline unsigned int line_colour( long long l ) const
+    {
+      long long r = l%lines_per_batch_;
+      unsigned int colour = 0;
+      for( unsigned int d=1; d<D; d++ ){
+        colour |= (unsigned int)((r%(long long)matrix_size_[d]) & 1) << (d-1);
+        r /= (long long)matrix_size_[d];
+      }
+      return colour;
+    }
+
+    // Offsets of the first pixels of the neighbouring lines of line l, -1 for lines outside the image.
+    // Neighbour k is shifted by idx_to_co(k, threes)-ones along dimensions 1 to D-1.
+    inline void neighbour_lines( long long l, long long *nb ) const
+    {
+      const long long batch_offset = (l/lines_per_batch_)*elements_per_batch_;
+      long long co[D];
+      long long r = l%lines_per_batch_;
+      for( unsigned int d=1; d<D; d++ ){
+        co[d] = r%(long long)matrix_size_[d];
+        r /= (long long)matrix_size_[d];
+      }
+
+      for( long long k=0; k<NUM_NEIGHBOUR_LINES; k++ ){
+        long long s = k, offset = 0, stride = length();
+        bool inside = true;
+        for( unsigned int d=1; d<D; d++ ){
+          const long long c = co[d]+(s%3)-1;
+          s /= 3;
+          if( c < 0 || c >= (long long)matrix_size_[d] ) inside = false;
+          offset += c*stride;
+          stride *= (long long)matrix_size_[d];
+        }
+        nb[k] = inside ? batch_offset+offset : -1;
+      }
+    }
+
+    // Horn-Schunck average: the mean of the neighbours inside the image, excluding the pixel itself
+    inline T average_inside( const T *u, const long long *nb, long long x ) const
+    {
+      const long long N0 = length();
+      T sum = T(0);
+      long long count = 0;
+      for( long long k=0; k<NUM_NEIGHBOUR_LINES; k++ ){
+        if( nb[k] < 0 ) continue;
+        const T *line = u+nb[k];
+        if( x > 0 ){ sum += line[x-1]; count++; }
+        if( k != CENTER_LINE ){ sum += line[x]; count++; }
+        if( x < N0-1 ){ sum += line[x+1]; count++; }
+      }
+      return (count > 0) ? sum/T(count) : T(0);
+    }
+
+    // Cornelius-Kanade average: the mean over the full neighbourhood, including the pixel itself,
+    // where the neighbours outside the image take the value of the pixel
+    inline T average_clamped( const T *u, const long long *nb, long long x ) const
+    {
+      const long long N0 = length();
+      const T self = u[nb[CENTER_LINE]+x];
+      T sum = T(0);
+      for( long long k=0; k<NUM_NEIGHBOUR_LINES; k++ ){
+        if( nb[k] < 0 ){
+          sum += T(3)*self;
+          continue;
+        }
+        const T *line = u+nb[k];
+        sum += (x > 0) ? line[x-1] : self;
+        sum += line[x];
+        sum += (x < N0-1) ? line[x+1] : self;
+      }
+      return sum/T(3*NUM_NEIGHBOUR_LINES);
+    }
+
+  protected:
+    typename uint64d<D>::Type matrix_size_;
+    long long elements_per_batch_;
+    long long lines_per_batch_;
+    long long lines_;
+  };
+}
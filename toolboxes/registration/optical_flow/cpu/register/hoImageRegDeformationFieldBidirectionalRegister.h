@@ -300,8 +300,7 @@ namespace Gadgetron {
                         // forward
                         DeformationFieldType deFieldResampled;
 
-                        hoNDBoundaryHandlerBorderValue<DeformationFieldType> bhBorderValue(deField);
-                        hoNDInterpolatorLinear<DeformationFieldType> interpLinear(deField, bhBorderValue);
+                        hoNDInterpolatorStatic<DeformationFieldType, D, 1, GT_BOUNDARY_CONDITION_BORDERVALUE> interpLinear(deField);
 
                         GADGET_CHECK_RETURN_FALSE(Gadgetron::resampleImage(deField, interpLinear, dim, deFieldResampled));
 
@@ -311,7 +310,6 @@ namespace Gadgetron {
                         // inverse
                         DeformationFieldType deFieldResampled_inverse;
 
-                        bhBorderValue.setArray(deField_inverse);
                         interpLinear.setArray(deField_inverse);
                         GADGET_CHECK_RETURN_FALSE(Gadgetron::resampleImage(deField_inverse, interpLinear, dimInv, deFieldResampled_inverse));
 
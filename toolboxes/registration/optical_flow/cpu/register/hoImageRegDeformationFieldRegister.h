@@ -346,8 +346,7 @@ namespace Gadgetron {
                     {
                         DeformationFieldType deFieldResampled;
 
-                        hoNDBoundaryHandlerBorderValue<DeformationFieldType> bhBorderValue(deField);
-                        hoNDInterpolatorLinear<DeformationFieldType> interpLinear(deField, bhBorderValue);
+                        hoNDInterpolatorStatic<DeformationFieldType, D, 1, GT_BOUNDARY_CONDITION_BORDERVALUE> interpLinear(deField);
 
                         GADGET_CHECK_RETURN_FALSE(Gadgetron::resampleImage(deField, interpLinear, dim, deFieldResampled));
 
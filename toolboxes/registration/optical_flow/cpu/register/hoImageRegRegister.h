@@ -14,6 +14,7 @@
 #include "hoNDArray_utils.h"
 #include "hoNDArray_elemwise.h"
 #include "hoNDImage_util.h"
+#include <boost/shared_ptr.hpp>
 
 // transformation
 #include "hoImageRegTransformation.h"
@@ -41,6 +42,19 @@
 
 namespace Gadgetron {
 
+    /// multi-resolution pyramid of an image
+    template<typename ImageType> 
+    struct hoImageRegPyramid
+    {
+        /// the image the pyramid was created from
+        const ImageType* image;
+
+        /// level 0 is a copy of the image
+        std::vector<ImageType> levels;
+
+        hoImageRegPyramid() : image(NULL) {}
+    };
+
     /// perform the image registration using pyramid scheme
     template<typename TargetType, typename SourceType, typename CoordType> 
     class hoImageRegRegister
@@ -106,6 +120,17 @@ namespace Gadgetron {
         virtual void setTarget(TargetType& target);
         virtual void setSource(SourceType& source);
 
+        /// the resolution pyramid of a target image, e.g. computed once and shared by all registrations against a fixed reference
+        typedef hoImageRegPyramid<TargetType> TargetPyramidType;
+
+        /// create the target pyramid with the current pyramid parameters
+        /// the pyramid parameters must be the same as those of the registrations using it
+        bool createTargetPyramid(TargetType& target, TargetPyramidType& pyramid);
+
+        /// use a precomputed target pyramid in initialize, instead of building it again
+        /// it is used only if it was created for the image set by setTarget and has resolution_pyramid_levels_ levels
+        void setTargetPyramid(boost::shared_ptr<TargetPyramidType> pyramid) { target_pyramid_shared_ = pyramid; }
+
         /// create dissimilarity measures
         DissimilarityType* createDissimilarity(GT_IMAGE_DISSIMILARITY v, unsigned int level);
 
@@ -197,6 +222,13 @@ namespace Gadgetron {
         std::vector<TargetType> target_pyramid_;
         std::vector<TargetType> source_pyramid_;
 
+        /// precomputed target pyramid
+        boost::shared_ptr<TargetPyramidType> target_pyramid_shared_;
+
+        /// downsample pyramid[0] into the remaining levels of the pyramid
+        template<typename ImageType> 
+        void createPyramid(hoNDBoundaryHandler<ImageType>& bh, hoNDInterpolator<ImageType>& interp, std::vector<ImageType>& pyramid);
+
         /// store the boundary handler and interpolator for warpers
         std::vector<BoundaryHandlerTargetType*> target_bh_warper_;
         std::vector<InterpTargetType*> target_interp_warper_;
@@ -383,9 +415,6 @@ namespace Gadgetron {
             target_pyramid_.resize(resolution_pyramid_levels_);
             source_pyramid_.resize(resolution_pyramid_levels_);
 
-            target_pyramid_[0] = *target_;
-            source_pyramid_[0] = *source_;
-
             target_bh_pyramid_construction_ = createBoundaryHandler<TargetType>(boundary_handler_type_pyramid_construction_);
             target_interp_pyramid_construction_ = createInterpolator<TargetType, DOut>(interp_type_pyramid_construction_);
             target_interp_pyramid_construction_->setBoundaryHandler(*target_bh_pyramid_construction_);
@@ -395,112 +424,30 @@ namespace Gadgetron {
             source_interp_pyramid_construction_->setBoundaryHandler(*source_bh_pyramid_construction_);
 
             /// allocate all objects
-            unsigned int ii, jj;
-            for ( ii=0; ii<resolution_pyramid_levels_-1; ii++ )
-            {
-                // create pyramid
-                target_bh_pyramid_construction_->setArray(target_pyramid_[ii]);
-                target_interp_pyramid_construction_->setArray(target_pyramid_[ii]);
-
-                if ( use_world_coordinates_ )
-                {
-                    if ( resolution_pyramid_divided_by_2_ )
-                    {
-                        Gadgetron::downsampleImageBy2WithAveraging(target_pyramid_[ii], *target_bh_pyramid_construction_, target_pyramid_[ii+1]);
-                    }
-                    else
-                    {
-                        std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
-                        Gadgetron::downsampleImage(target_pyramid_[ii], *target_interp_pyramid_construction_, target_pyramid_[ii+1], &ratio[0]);
-
-                        std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
-                        for ( jj=0; jj<DOut; jj++ )
-                        {
-                            sigma[jj] /= target_pyramid_[ii+1].get_pixel_size(jj); // world to pixel
-                        }
-
-                        Gadgetron::filterGaussian(target_pyramid_[ii+1], &sigma[0]);
-                    }
-                }
-                else
-                {
-                    std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
-
-                    bool downsampledBy2 = true;
-                    for ( jj=0; jj<DOut; jj++ )
-                    {
-                        if ( std::abs(ratio[jj]-2.0f) > FLT_EPSILON )
-                        {
-                            downsampledBy2 = false;
-                            break;
-                        }
-                    }
-
-                    if ( downsampledBy2 )
-                    {
-                        Gadgetron::downsampleImageBy2WithAveraging(target_pyramid_[ii], *target_bh_pyramid_construction_, target_pyramid_[ii+1]);
-                        // Gadgetron::downsampleImage(target_pyramid_[ii], *target_interp_pyramid_construction_, target_pyramid_[ii+1], &ratio[0]);
-                    }
-                    else
-                    {
-                        Gadgetron::downsampleImage(target_pyramid_[ii], *target_interp_pyramid_construction_, target_pyramid_[ii+1], &ratio[0]);
-                        std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
-                        Gadgetron::filterGaussian(target_pyramid_[ii+1], &sigma[0]);
-                    }
-                }
-
-                // source
-
-                source_bh_pyramid_construction_->setArray(source_pyramid_[ii]);
-                source_interp_pyramid_construction_->setArray(source_pyramid_[ii]);
-
-                if ( use_world_coordinates_ )
-                {
-                    if ( resolution_pyramid_divided_by_2_ )
-                    {
-                        Gadgetron::downsampleImageBy2WithAveraging(source_pyramid_[ii], *source_bh_pyramid_construction_, source_pyramid_[ii+1]);
-                    }
-                    else
-                    {
-                        std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
-                        Gadgetron::downsampleImage(source_pyramid_[ii], *source_interp_pyramid_construction_, source_pyramid_[ii+1], &ratio[0]);
+            unsigned int ii;
 
-                        std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
-                        for ( jj=0; jj<DOut; jj++ )
-                        {
-                            sigma[jj] /= source_pyramid_[ii+1].get_pixel_size(jj); // world to pixel
-                        }
-
-                        Gadgetron::filterGaussian(source_pyramid_[ii+1], &sigma[0]);
-                    }
-                }
-                else
+            if ( target_pyramid_shared_ && target_pyramid_shared_->image==target_ && target_pyramid_shared_->levels.size()==resolution_pyramid_levels_ )
+            {
+                // the levels are only read during the registration, so they are referenced without copying
+                for ( ii=0; ii<resolution_pyramid_levels_; ii++ )
                 {
-                    std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
+                    TargetType& level = target_pyramid_shared_->levels[ii];
 
-                    bool downsampledBy2 = true;
-                    for ( jj=0; jj<DOut; jj++ )
-                    {
-                        if ( std::abs(ratio[jj]-2.0f) > FLT_EPSILON )
-                        {
-                            downsampledBy2 = false;
-                            break;
-                        }
-                    }
+                    std::vector<size_t> dim;
+                    level.get_dimensions(dim);
 
-                    if ( downsampledBy2 )
-                    {
-                        Gadgetron::downsampleImageBy2WithAveraging(source_pyramid_[ii], *source_bh_pyramid_construction_, source_pyramid_[ii+1]);
-                        //Gadgetron::downsampleImage(source_pyramid_[ii], *source_interp_pyramid_construction_, source_pyramid_[ii+1], &ratio[0]);
-                    }
-                    else
-                    {
-                        Gadgetron::downsampleImage(source_pyramid_[ii], *source_interp_pyramid_construction_, source_pyramid_[ii+1], &ratio[0]);
-                        std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
-                        Gadgetron::filterGaussian(source_pyramid_[ii+1], &sigma[0]);
-                    }
+                    target_pyramid_[ii].create(dim, level.begin(), false);
+                    target_pyramid_[ii].copyImageInfoWithoutImageSize(level);
                 }
             }
+            else
+            {
+                target_pyramid_[0] = *target_;
+                createPyramid(*target_bh_pyramid_construction_, *target_interp_pyramid_construction_, target_pyramid_);
+            }
+
+            source_pyramid_[0] = *source_;
+            createPyramid(*source_bh_pyramid_construction_, *source_interp_pyramid_construction_, source_pyramid_);
 
             for ( ii=0; ii<resolution_pyramid_levels_; ii++ )
             {
@@ -551,6 +498,96 @@ namespace Gadgetron {
         return true;
     }
 
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    template<typename ImageType> 
+    void hoImageRegRegister<TargetType, SourceType, CoordType>::createPyramid(hoNDBoundaryHandler<ImageType>& bh, hoNDInterpolator<ImageType>& interp, std::vector<ImageType>& pyramid)
+    {
+        unsigned int ii, jj;
+        for ( ii=0; ii<pyramid.size()-1; ii++ )
+        {
+            bh.setArray(pyramid[ii]);
+            interp.setArray(pyramid[ii]);
+
+            if ( use_world_coordinates_ )
+            {
+                if ( resolution_pyramid_divided_by_2_ )
+                {
+                    Gadgetron::downsampleImageBy2WithAveraging(pyramid[ii], bh, pyramid[ii+1]);
+                }
+                else
+                {
+                    std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
+                    Gadgetron::downsampleImage(pyramid[ii], interp, pyramid[ii+1], &ratio[0]);
+
+                    std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
+                    for ( jj=0; jj<DOut; jj++ )
+                    {
+                        sigma[jj] /= pyramid[ii+1].get_pixel_size(jj); // world to pixel
+                    }
+
+                    Gadgetron::filterGaussian(pyramid[ii+1], &sigma[0]);
+                }
+            }
+            else
+            {
+                std::vector<float> ratio = resolution_pyramid_downsample_ratio_[ii];
+
+                bool downsampledBy2 = true;
+                for ( jj=0; jj<DOut; jj++ )
+                {
+                    if ( std::abs(ratio[jj]-2.0f) > FLT_EPSILON )
+                    {
+                        downsampledBy2 = false;
+                        break;
+                    }
+                }
+
+                if ( downsampledBy2 )
+                {
+                    Gadgetron::downsampleImageBy2WithAveraging(pyramid[ii], bh, pyramid[ii+1]);
+                    // Gadgetron::downsampleImage(pyramid[ii], interp, pyramid[ii+1], &ratio[0]);
+                }
+                else
+                {
+                    Gadgetron::downsampleImage(pyramid[ii], interp, pyramid[ii+1], &ratio[0]);
+                    std::vector<float> sigma = resolution_pyramid_blurring_sigma_[ii+1];
+                    Gadgetron::filterGaussian(pyramid[ii+1], &sigma[0]);
+                }
+            }
+        }
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    bool hoImageRegRegister<TargetType, SourceType, CoordType>::createTargetPyramid(TargetType& target, TargetPyramidType& pyramid)
+    {
+        try
+        {
+            GADGET_CHECK_RETURN_FALSE(resolution_pyramid_levels_>0);
+            GADGET_CHECK_RETURN_FALSE(resolution_pyramid_downsample_ratio_.size()==resolution_pyramid_levels_-1);
+            GADGET_CHECK_RETURN_FALSE(resolution_pyramid_blurring_sigma_.size()==resolution_pyramid_levels_);
+
+            pyramid.image = &target;
+            pyramid.levels.resize(resolution_pyramid_levels_);
+            pyramid.levels[0] = target;
+
+            BoundaryHandlerTargetType* bh = createBoundaryHandler<TargetType>(boundary_handler_type_pyramid_construction_);
+            InterpTargetType* interp = createInterpolator<TargetType, DOut>(interp_type_pyramid_construction_);
+            interp->setBoundaryHandler(*bh);
+
+            createPyramid(*bh, *interp, pyramid.levels);
+
+            delete bh;
+            delete interp;
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Errors happened in hoImageRegRegister<TargetType, SourceType, CoordType>::createTargetPyramid(...) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
     template<typename TargetType, typename SourceType, typename CoordType> 
     inline void hoImageRegRegister<TargetType, SourceType, CoordType>::setTarget(TargetType& target)
     {
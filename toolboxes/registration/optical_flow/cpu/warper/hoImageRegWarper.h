@@ -21,12 +21,52 @@
 #include "GadgetronTimer.h"
 #include "ImageIOAnalyze.h"
 
+#include "hoNDInterpolator_simd.h"
+
 #ifdef USE_OMP
     #include <omp.h>
 #endif // USE_OMP
 
 namespace Gadgetron {
 
+    namespace hoImageRegWarperDetail
+    {
+        /// whether interpolateLinearRow has a kernel for the image value and coordinate type
+        inline bool hasLinearRowKernel(const float*, const float*) { return true; }
+
+        template <typename T, typename C> 
+        inline bool hasLinearRowKernel(const T*, const C*) { return false; }
+
+        /// vectorised linear interpolation at the points of a row, available for float images
+        /// iz is NULL for 2D images
+        inline bool interpolateLinearRow(const float* im, const std::vector<size_t>& dim, size_t N, const float* ix, const float* iy, const float* iz, float* r)
+        {
+            if ( iz == NULL )
+            {
+                hoNDInterpolatorSimd::linear2D(im, dim[0], dim[1], N, ix, iy, r);
+            }
+            else
+            {
+                hoNDInterpolatorSimd::linear3D(im, dim[0], dim[1], dim[2], N, ix, iy, iz, r);
+            }
+
+            return true;
+        }
+
+        template <typename T, typename C> 
+        inline bool interpolateLinearRow(const T* /*im*/, const std::vector<size_t>& /*dim*/, size_t /*N*/, const C* /*ix*/, const C* /*iy*/, const C* /*iz*/, T* /*r*/)
+        {
+            return false;
+        }
+
+        template <typename C> 
+        inline bool isInterior(const std::vector<size_t>& dim, C x, C y, const C* z)
+        {
+            if ( z == NULL ) return hoNDInterpolatorSimd::interior2D(dim[0], dim[1], (float)x, (float)y);
+            return hoNDInterpolatorSimd::interior3D(dim[0], dim[1], dim[2], (float)x, (float)y, (float)(*z));
+        }
+    }
+
     /// warp the source image to the grid of target image under a transformation
     /// both image domain warpping and world coordinate warpping is implemented
     /// for the image domain warpping, the pixels are in the coordinate of image grid
@@ -50,6 +90,10 @@ namespace Gadgetron {
         typedef Target2DType Source3DType;
 
         typedef hoNDInterpolator<SourceType> InterpolatorType;
+        typedef hoNDInterpolatorLinear<SourceType> InterpolatorLinearType;
+
+        /// coordinate type of the interpolator
+        typedef typename SourceType::coord_type interp_coord_type;
 
         typedef hoImageRegTransformation<CoordType, DIn, DOut> TransformationType;
         typedef hoImageRegDeformationField<CoordType, DIn> DeformTransformationType;
@@ -107,6 +151,16 @@ namespace Gadgetron {
 
         /// back ground values, used to mark regions in the target image which will not be warped
         ValueType bg_value_;
+
+        /// whether the rows of 2D/3D images are interpolated with the vectorised kernel
+        /// true for the linear interpolator of float images, then only the points near the border go through interp_
+        bool useVectorisedInterpolation(const SourceType& source) const;
+
+        /// interpolate the source at the points of a row of the target, the background pixels of the target are skipped
+        /// iz is NULL for 2D images; buf holds N values
+        void interpolateRow(const SourceType& source, bool vectorised, size_t N, const ValueType* target, 
+                            const interp_coord_type* ix, const interp_coord_type* iy, const interp_coord_type* iz, 
+                            ValueType* buf, ValueType* warped);
     };
 
     template<typename TargetType, typename SourceType, typename CoordType> 
@@ -163,6 +217,9 @@ namespace Gadgetron {
 
             warped = target;
 
+            // the source positions of a row are computed first and then interpolated together
+            bool vectorised = this->useVectorisedInterpolation(source);
+
             if ( DIn==2 && DOut==2 )
             {
                 size_t sx = target.get_size(0);
@@ -170,6 +227,9 @@ namespace Gadgetron {
 
                 long long y;
 
+                std::vector<interp_coord_type> bx(sx, 0), by(sx, 0);
+                std::vector<ValueType> buf(sx);
+
                 if ( useWorldCoordinate )
                 {
                     // #pragma omp parallel private(y) shared(sx, sy, target, source, warped) num_threads(2)
@@ -194,10 +254,13 @@ namespace Gadgetron {
                                     // world to source
                                     source.world_to_image(px_source, py_source, ix_source, iy_source);
 
-                                    // interpolate the source
-                                    warped( offset ) = (*interp_)(ix_source, iy_source);
+                                    bx[x] = ix_source;
+                                    by[x] = iy_source;
                                 }
                             }
+
+                            // interpolate the source
+                            this->interpolateRow(source, vectorised, sx, target.begin()+y*sx, &bx[0], &by[0], NULL, &buf[0], warped.begin()+y*sx);
                         }
                     }
                 }
@@ -219,10 +282,13 @@ namespace Gadgetron {
                                     // transform the point
                                     transform_->transform(x, size_t(y), ix_source, iy_source);
 
-                                    // interpolate the source
-                                    warped( offset ) = (*interp_)(ix_source, iy_source);
+                                    bx[x] = ix_source;
+                                    by[x] = iy_source;
                                 }
                             }
+
+                            // interpolate the source
+                            this->interpolateRow(source, vectorised, sx, target.begin()+y*sx, &bx[0], &by[0], NULL, &buf[0], warped.begin()+y*sx);
                         }
                     }
                 }
@@ -237,10 +303,13 @@ namespace Gadgetron {
 
                 if ( useWorldCoordinate )
                 {
-                    #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped)
+                    #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped, vectorised)
                     {
                         coord_type px, py, pz, px_source, py_source, pz_source, ix_source, iy_source, iz_source;
 
+                        std::vector<interp_coord_type> bx(sx, 0), by(sx, 0), bz(sx, 0);
+                        std::vector<ValueType> buf(sx);
+
                         #pragma omp for 
                         for ( z=0; z<(long long)sz; z++ )
                         {
@@ -261,20 +330,27 @@ namespace Gadgetron {
                                         // world to source
                                         source.world_to_image(px_source, py_source, pz_source, ix_source, iy_source, iz_source);
 
-                                        // interpolate the source
-                                        warped( x+offset ) = (*interp_)(ix_source, iy_source, iz_source);
+                                        bx[x] = ix_source;
+                                        by[x] = iy_source;
+                                        bz[x] = iz_source;
                                     }
                                 }
+
+                                // interpolate the source
+                                this->interpolateRow(source, vectorised, sx, target.begin()+offset, &bx[0], &by[0], &bz[0], &buf[0], warped.begin()+offset);
                             }
                         }
                     }
                 }
                 else
                 {
-                    #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped)
+                    #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped, vectorised)
                     {
                         coord_type ix_source, iy_source, iz_source;
 
+                        std::vector<interp_coord_type> bx(sx, 0), by(sx, 0), bz(sx, 0);
+                        std::vector<ValueType> buf(sx);
+
                         #pragma omp for 
                         for ( z=0; z<(long long)sz; z++ )
                         {
@@ -289,10 +365,14 @@ namespace Gadgetron {
                                         // transform the point
                                         transform_->transform(x, y, size_t(z), ix_source, iy_source, iz_source);
 
-                                        // interpolate the source
-                                        warped( x+offset ) = (*interp_)(ix_source, iy_source, iz_source);
+                                        bx[x] = ix_source;
+                                        by[x] = iy_source;
+                                        bz[x] = iz_source;
                                     }
                                 }
+
+                                // interpolate the source
+                                this->interpolateRow(source, vectorised, sx, target.begin()+offset, &bx[0], &by[0], &bz[0], &buf[0], warped.begin()+offset);
                             }
                         }
                     }
@@ -387,6 +467,9 @@ namespace Gadgetron {
 
             warped = target;
 
+            // the source positions of a row are computed first and then interpolated together
+            bool vectorised = this->useVectorisedInterpolation(source);
+
             if ( DIn==2 && DOut==2 )
             {
                 size_t sx = target.get_size(0);
@@ -394,6 +477,9 @@ namespace Gadgetron {
 
                 long long y;
 
+                std::vector<interp_coord_type> bx(sx, 0), by(sx, 0);
+                std::vector<ValueType> buf(sx);
+
                 // #pragma omp parallel private(y) shared(sx, sy, target, source, warped) num_threads(2)
                 {
                     coord_type px, py, dx, dy, ix_source, iy_source;
@@ -416,10 +502,13 @@ namespace Gadgetron {
                                 // world to source
                                 source.world_to_image(px+dx, py+dy, ix_source, iy_source);
 
-                                // interpolate the source
-                                warped( offset ) = (*interp_)(ix_source, iy_source);
+                                bx[x] = ix_source;
+                                by[x] = iy_source;
                             }
                         }
+
+                        // interpolate the source
+                        this->interpolateRow(source, vectorised, sx, target.begin()+y*sx, &bx[0], &by[0], NULL, &buf[0], warped.begin()+y*sx);
                     }
                 }
             }
@@ -431,10 +520,13 @@ namespace Gadgetron {
 
                 long long z;
 
-                #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped)
+                #pragma omp parallel private(z) shared(sx, sy, sz, target, source, warped, vectorised)
                 {
                     coord_type px, py, pz, dx, dy, dz, ix_source, iy_source, iz_source;
 
+                    std::vector<interp_coord_type> bx(sx, 0), by(sx, 0), bz(sx, 0);
+                    std::vector<ValueType> buf(sx);
+
                     #pragma omp for 
                     for ( z=0; z<(long long)sz; z++ )
                     {
@@ -455,10 +547,14 @@ namespace Gadgetron {
                                     // world to source
                                     source.world_to_image(px+dx, py+dy, pz+dz, ix_source, iy_source, iz_source);
 
-                                    // interpolate the source
-                                    warped( x+offset ) = (*interp_)(ix_source, iy_source, iz_source);
+                                    bx[x] = ix_source;
+                                    by[x] = iy_source;
+                                    bz[x] = iz_source;
                                 }
                             }
+
+                            // interpolate the source
+                            this->interpolateRow(source, vectorised, sx, target.begin()+offset, &bx[0], &by[0], &bz[0], &buf[0], warped.begin()+offset);
                         }
                     }
                 }
@@ -516,6 +612,57 @@ namespace Gadgetron {
         return true;
     }
 
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    bool hoImageRegWarper<TargetType, SourceType, CoordType>::useVectorisedInterpolation(const SourceType& source) const
+    {
+        if ( (DOut!=2 && DOut!=3) || dynamic_cast<InterpolatorLinearType*>(interp_)==NULL ) return false;
+
+        unsigned int d;
+        for ( d=0; d<DOut; d++ )
+        {
+            if ( source.get_size(d) < 2 ) return false;
+        }
+
+        if ( source.get_number_of_elements() >= (size_t)(1u<<31) ) return false;
+
+        // the kernels exist for float images only
+        return hoImageRegWarperDetail::hasLinearRowKernel((const ValueType*)NULL, (const interp_coord_type*)NULL);
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType> 
+    void hoImageRegWarper<TargetType, SourceType, CoordType>::
+    interpolateRow(const SourceType& source, bool vectorised, size_t N, const ValueType* target, 
+                    const interp_coord_type* ix, const interp_coord_type* iy, const interp_coord_type* iz, 
+                    ValueType* buf, ValueType* warped)
+    {
+        std::vector<size_t> dim;
+
+        if ( vectorised )
+        {
+            source.get_dimensions(dim);
+            hoImageRegWarperDetail::interpolateLinearRow(source.begin(), dim, N, ix, iy, iz, buf);
+        }
+
+        size_t x;
+        for ( x=0; x<N; x++ )
+        {
+            if ( target[x] == bg_value_ ) continue;
+
+            if ( vectorised && hoImageRegWarperDetail::isInterior(dim, ix[x], iy[x], (iz==NULL) ? iz : iz+x) )
+            {
+                warped[x] = buf[x];
+            }
+            else if ( iz == NULL )
+            {
+                warped[x] = (*interp_)(ix[x], iy[x]);
+            }
+            else
+            {
+                warped[x] = (*interp_)(ix[x], iy[x], iz[x]);
+            }
+        }
+    }
+
     template<typename TargetType, typename SourceType, typename CoordType> 
     void hoImageRegWarper<TargetType, SourceType, CoordType>::print(std::ostream& os) const
     {
@@ -0,0 +1,211 @@
+#include "cuImageRegContainer2DRegistration.h"
+#include "cuCKOpticalFlowSolver.h"
+#include "cuLinearResampleOperator.h"
+#include "cuNDArray.h"
+
+#include <cuda_runtime.h>
+#include <algorithm>
+
+namespace Gadgetron
+{
+    template<typename TargetType, typename SourceType, typename CoordType>
+    cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    cuImageRegContainer2DRegistration(unsigned int resolution_pyramid_levels, bool use_world_coordinates, ValueType bg_value)
+        : BaseClass(resolution_pyramid_levels, use_world_coordinates, bg_value)
+    {
+        alpha_ = ValueType(0.05);
+        beta_ = ValueType(1.0);
+        limit_ = ValueType(0.01);
+
+        if ( cudaGetDevice(&device_) != cudaSuccess )
+        {
+            device_ = 0;
+        }
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::~cuImageRegContainer2DRegistration()
+    {
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    bool cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    solveDeformationField(const TargetType& target, const SourceType& source, DeformationFieldType** deform)
+    {
+        try
+        {
+            GADGET_CHECK_RETURN_FALSE(DIn==2);
+            GADGET_CHECK_RETURN_FALSE(target.dimensions_equal(source));
+
+            if ( this->use_world_coordinates_ )
+            {
+                GERROR_STREAM("cuImageRegContainer2DRegistration : world coordinates are not supported by the optical flow solver ... ");
+                return false;
+            }
+
+            size_t sx = target.get_size(0);
+            size_t sy = target.get_size(1);
+
+            // the solver requires at least 12 pixels along each dimension at the coarsest level
+            unsigned int levels = 0;
+            while ( levels+1 < this->resolution_pyramid_levels_ && (std::min(sx, sy) >> (levels+1)) >= 12 )
+            {
+                levels++;
+            }
+
+            unsigned int iters = 0;
+            for ( size_t ii=0; ii<this->max_iter_num_pyramid_level_.size(); ii++ )
+            {
+                iters = std::max(iters, this->max_iter_num_pyramid_level_[ii]);
+            }
+            if ( iters == 0 ) iters = 32;
+
+            boost::shared_ptr< hoNDArray<ValueType> > displacement;
+
+            {
+                boost::mutex::scoped_lock lock(device_mutex_);
+
+                if ( cudaSetDevice(device_) != cudaSuccess )
+                {
+                    GERROR_STREAM("cuImageRegContainer2DRegistration : unable to set cuda device " << device_);
+                    return false;
+                }
+
+                // the images are uploaded without their image information
+                std::vector<size_t> dims(2);
+                dims[0] = sx;
+                dims[1] = sy;
+
+                hoNDArray<ValueType> h_target(dims, const_cast<ValueType*>(target.begin()), false);
+                hoNDArray<ValueType> h_source(dims, const_cast<ValueType*>(source.begin()), false);
+
+                cuNDArray<ValueType> fixed_image(h_target);
+                cuNDArray<ValueType> moving_image(h_source);
+
+                boost::shared_ptr< cuLinearResampleOperator<ValueType,2> > R( new cuLinearResampleOperator<ValueType,2>() );
+
+                cuCKOpticalFlowSolver<ValueType,2> solver;
+                solver.set_interpolator(R);
+                solver.set_num_multires_levels(levels);
+                solver.set_max_num_iterations_per_level(iters);
+                solver.set_alpha(alpha_);
+                solver.set_beta(beta_);
+                solver.set_limit(limit_);
+
+                // the displacements are of dimension [sx sy 2]: target pixel x is moved to source position x + d(x)
+                boost::shared_ptr< cuNDArray<ValueType> > d = solver.solve(&fixed_image, &moving_image);
+                displacement = d->to_host();
+            }
+
+            GADGET_CHECK_RETURN_FALSE(displacement->get_number_of_elements()==sx*sy*DIn);
+
+            for ( unsigned int d=0; d<DIn; d++ )
+            {
+                if ( !target.dimensions_equal( *(deform[d]) ) )
+                {
+                    deform[d]->copyImageInfo(target);
+                }
+
+                const ValueType* pD = displacement->begin() + d*sx*sy;
+                CoordType* pDeform = deform[d]->begin();
+                for ( size_t n=0; n<sx*sy; n++ )
+                {
+                    pDeform[n] = (CoordType)pD[n];
+                }
+            }
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Error happened in cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::solveDeformationField(...) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    bool cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    warpSource(const TargetType& target, const SourceType& source, DeformationFieldType** deform, TargetType& warped)
+    {
+        try
+        {
+            hoImageRegDeformationField<CoordType, DIn> transform;
+            for ( unsigned int d=0; d<DIn; d++ )
+            {
+                transform.setDeformationField( *(deform[d]), d);
+            }
+
+            hoNDBoundaryHandlerFixedValue<SourceType> bhFixedValue;
+            bhFixedValue.setArray( const_cast<SourceType&>(source) );
+
+            hoNDInterpolatorBSpline<SourceType, DIn> interpBSpline(5);
+            interpBSpline.setArray( const_cast<SourceType&>(source) );
+            interpBSpline.setBoundaryHandler(bhFixedValue);
+
+            hoImageRegWarper<TargetType, SourceType, CoordType> warper;
+            warper.setBackgroundValue(this->bg_value_);
+            warper.setTransformation(transform);
+            warper.setInterpolator(interpBSpline);
+
+            GADGET_CHECK_RETURN_FALSE(warper.warp(target, source, this->use_world_coordinates_, warped));
+        }
+        catch(...)
+        {
+            GERROR_STREAM("Error happened in cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::warpSource(...) ... ");
+            return false;
+        }
+
+        return true;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    bool cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, boost::shared_ptr<TargetPyramidType> targetPyramid)
+    {
+        GADGET_CHECK_RETURN_FALSE(deform!=NULL);
+
+        if ( initial )
+        {
+            GWARN_STREAM("cuImageRegContainer2DRegistration : the optical flow solver does not use the initial deformation fields ... ");
+        }
+
+        GADGET_CHECK_RETURN_FALSE(this->solveDeformationField(target, source, deform));
+
+        if ( warped != NULL )
+        {
+            GADGET_CHECK_RETURN_FALSE(this->warpSource(target, source, deform, *warped));
+        }
+
+        return true;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    bool cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::
+    registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv, boost::shared_ptr<TargetPyramidType> targetPyramid)
+    {
+        GADGET_CHECK_RETURN_FALSE(deform!=NULL);
+        GADGET_CHECK_RETURN_FALSE(deformInv!=NULL);
+
+        GADGET_CHECK_RETURN_FALSE(this->registerTwoImagesDeformationField(target, source, initial, warped, deform, targetPyramid));
+        GADGET_CHECK_RETURN_FALSE(this->solveDeformationField(source, target, deformInv));
+
+        return true;
+    }
+
+    template<typename TargetType, typename SourceType, typename CoordType>
+    void cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType>::print(std::ostream& os) const
+    {
+        using namespace std;
+
+        BaseClass::print(os);
+
+        os << "--------------Gagdgetron GPU optical flow backend -------------" << endl;
+        os << "Cuda device is : " << device_ << endl;
+        os << "Alpha is : " << alpha_ << endl;
+        os << "Beta is : " << beta_ << endl;
+        os << "Limit is : " << limit_ << endl;
+        os << "--------------------------------------------------------------------" << endl << ends;
+    }
+
+    template class EXPORTGPUREG cuImageRegContainer2DRegistration< hoNDImage<float, 2>, hoNDImage<float, 2>, float >;
+}
@@ -0,0 +1,69 @@
+/** \file cuImageRegContainer2DRegistration.h
+    \brief GPU backend of the deformation field registrations of hoImageRegContainer2DRegistration.
+
+    The pair-wise deformation field registration is run by the Cornelius-Kanade optical flow solver
+    of cuCKOpticalFlowSolver instead of the CPU demons type solver. Everything else, i.e. the container
+    modes, the threading over the image pairs and the warping of the source images, is inherited from
+    hoImageRegContainer2DRegistration, so an object of this class can be passed to any function taking
+    a hoImageRegContainer2DRegistration, e.g. the motion correction functions of the cmr toolbox.
+
+    The deformation fields are returned in pixel units, as by the CPU registration with use_world_coordinates_ == false.
+    The inverse deformation of the bidirectional registration is estimated by a second registration with the roles of
+    target and source swapped. The dissimilarity and regularization parameters of the CPU registration are not used;
+    the optical flow solver is controlled by alpha_, beta_ and limit_.
+*/
+
+#pragma once
+
+#include "hoImageRegContainer2DRegistration.h"
+#include "gpureg_export.h"
+
+#include <boost/thread/mutex.hpp>
+
+namespace Gadgetron
+{
+    template<typename TargetType, typename SourceType, typename CoordType>
+    class EXPORTGPUREG cuImageRegContainer2DRegistration : public hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType>
+    {
+    public:
+
+        typedef hoImageRegContainer2DRegistration<TargetType, SourceType, CoordType> BaseClass;
+        typedef cuImageRegContainer2DRegistration<TargetType, SourceType, CoordType> Self;
+
+        typedef typename BaseClass::ValueType ValueType;
+        enum { DIn = BaseClass::DIn };
+
+        typedef typename BaseClass::DeformationFieldType DeformationFieldType;
+        typedef typename BaseClass::TargetPyramidType TargetPyramidType;
+
+        cuImageRegContainer2DRegistration(unsigned int resolution_pyramid_levels=3, bool use_world_coordinates=false, ValueType bg_value=ValueType(0));
+        virtual ~cuImageRegContainer2DRegistration();
+
+        /// the target pyramid is not used by the optical flow solver
+        virtual bool registerTwoImagesDeformationField(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform,
+                                                        boost::shared_ptr<TargetPyramidType> targetPyramid = boost::shared_ptr<TargetPyramidType>());
+        virtual bool registerTwoImagesDeformationFieldBidirectional(const TargetType& target, const SourceType& source, bool initial, TargetType* warped, DeformationFieldType** deform, DeformationFieldType** deformInv,
+                                                        boost::shared_ptr<TargetPyramidType> targetPyramid = boost::shared_ptr<TargetPyramidType>());
+
+        virtual void print(std::ostream& os) const;
+
+        /// regularization weights and convergence limit of the optical flow solver
+        ValueType alpha_;
+        ValueType beta_;
+        ValueType limit_;
+
+        /// cuda device used for the registrations
+        int device_;
+
+    protected:
+
+        /// compute the deformation field moving the source onto the target, in pixel units
+        bool solveDeformationField(const TargetType& target, const SourceType& source, DeformationFieldType** deform);
+
+        /// warp the source with the bspline interpolator, as the CPU registration does
+        bool warpSource(const TargetType& target, const SourceType& source, DeformationFieldType** deform, TargetType& warped);
+
+        /// the pair-wise registrations are run from several threads, the solves are serialized on the device
+        boost::mutex device_mutex_;
+    };
+}
@@ -1,5 +1,6 @@
 #include <chrono>
 #include "gadgetron_rest.h"
+#include "GadgetronMetrics.h"
 
 namespace Gadgetron
 {
@@ -14,6 +15,13 @@ namespace Gadgetron
 	  return "<html><body><h1>GADGETRON</h1></body></html>\n";
 	});
 
+      //Counters and histograms for monitoring and autoscaling, in the Prometheus text format
+      instance_->app_.route_dynamic("/metrics")([]() {
+	  crow::response res(200, GadgetronMetrics::instance().write());
+	  res.set_header("Content-Type", "text/plain; version=0.0.4");
+	  return res;
+	});
+
 	instance_->open();
       }
       return instance_;
@@ -0,0 +1,91 @@
+/** \file cgPreconditionerCache.h
+    \brief A small keyed cache for preconditioner weights.
+
+    The weights of the preconditioners of the reconstruction gadgets depend only on the coil maps,
+    the regularization image and (for the circulant preconditioner) the trajectory and density
+    compensation, which mostly stay the same over many frames. The caller derives a key from these
+    inputs, e.g. with cgPreconditionerCache::hash, and reuses the weights as long as the key is unchanged.
+    Any change of an input changes the key, so stale weights are never returned.
+    The least recently used entry is dropped when the capacity is exceeded.
+*/
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <list>
+#include <utility>
+#include <cstring>
+#include <cstddef>
+
+namespace Gadgetron{
+
+  template <class ARRAY_TYPE> class cgPreconditionerCache
+  {
+  public:
+
+    typedef boost::uint64_t key_type;
+
+    cgPreconditionerCache( size_t capacity = 4 ) : capacity_(capacity > 0 ? capacity : 1) {}
+    virtual ~cgPreconditionerCache() {}
+
+    // The cached weights for key, or an empty pointer
+    virtual boost::shared_ptr<ARRAY_TYPE> find( key_type key )
+    {
+      for( typename std::list<entry>::iterator it = entries_.begin(); it != entries_.end(); ++it ){
+        if( it->first == key ){
+          entries_.splice( entries_.begin(), entries_, it );
+          return entries_.front().second;
+        }
+      }
+      return boost::shared_ptr<ARRAY_TYPE>();
+    }
+
+    virtual void insert( key_type key, boost::shared_ptr<ARRAY_TYPE> weights )
+    {
+      for( typename std::list<entry>::iterator it = entries_.begin(); it != entries_.end(); ++it ){
+        if( it->first == key ){
+          entries_.erase(it);
+          break;
+        }
+      }
+      entries_.push_front( entry(key, weights) );
+      while( entries_.size() > capacity_ )
+        entries_.pop_back();
+    }
+
+    virtual void clear() { entries_.clear(); }
+    virtual size_t size() { return entries_.size(); }
+
+    virtual void set_capacity( size_t capacity ){
+      capacity_ = (capacity > 0) ? capacity : 1;
+      while( entries_.size() > capacity_ )
+        entries_.pop_back();
+    }
+    virtual size_t get_capacity() { return capacity_; }
+
+    // 64 bit FNV-1a style hash of a memory block, processed in 8 byte words.
+    // Chain several inputs by passing the previous hash as seed.
+    static key_type hash( const void *data, size_t bytes, key_type seed = 14695981039346656037ULL )
+    {
+      const key_type prime = 1099511628211ULL;
+      key_type h = seed ^ (key_type)bytes;
+      const unsigned char *p = static_cast<const unsigned char*>(data);
+
+      size_t words = bytes/sizeof(key_type);
+      for( size_t i=0; i<words; i++ ){
+        key_type w;
+        memcpy( &w, p+i*sizeof(key_type), sizeof(key_type) );
+        h = (h^w)*prime;
+      }
+      for( size_t i=words*sizeof(key_type); i<bytes; i++ )
+        h = (h^p[i])*prime;
+      return h;
+    }
+
+  protected:
+    typedef std::pair< key_type, boost::shared_ptr<ARRAY_TYPE> > entry;
+    std::list<entry> entries_;
+    size_t capacity_;
+  };
+}
@@ -133,6 +133,7 @@ namespace Gadgetron{
       // Initialize
       //
 
+      this->begin_solve( rhs->get_dimensions().get() );
       initialize(rhs);
 
       // Iterate
@@ -144,15 +145,23 @@ namespace Gadgetron{
     
       for( unsigned int it=0; it<iterations_; it++ ){
 
-        REAL tc_metric;
+        REAL tc_metric = REAL(-1); // stays negative if the iteration did not evaluate the metric
         bool tc_terminate;
       
         this->iterate( it, &tc_metric, &tc_terminate );
+        this->count_iteration();
 
         solver_dump( x_.get());
       
         if( tc_terminate )
           break;
+
+        if( tc_metric >= REAL(0) && this->stagnated(tc_metric) ){
+          if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE ){
+            GDEBUG_STREAM("Terminating after iteration " << it << ": the residual stagnates" << std::endl);
+          }
+          break;
+        }
       }
     
       // Clean up and we are done
@@ -160,6 +169,7 @@ namespace Gadgetron{
 
       boost::shared_ptr<ARRAY_TYPE> tmpx = x_;
       deinitialize();
+      this->end_solve(tmpx);
       return tmpx;
     }
 
@@ -313,12 +323,12 @@ namespace Gadgetron{
       //
 
       alpha_ = rq_/dot( p_.get(), &q );
-      axpy( alpha_, p_.get(), x_.get());
 
-      // Update residual
+      // Update solution and residual
       //
 
-      axpy( -alpha_, &q, r_.get());
+      // <r,r> is the next rq_ without a preconditioner, with one it is not needed
+      REAL rr = update_solution( alpha_, &q, !precond_.get() );
 
       // Apply preconditioning
       //
@@ -329,15 +339,13 @@ namespace Gadgetron{
         precond_->apply( &q, &q );
         
         REAL tmp_rq = real(dot( r_.get(), &q ));      
-        *p_ *= ELEMENT_TYPE((tmp_rq/rq_));
-        axpy( ELEMENT_TYPE(1), &q, p_.get() );
+        update_direction( ELEMENT_TYPE((tmp_rq/rq_)), &q );
         rq_ = tmp_rq;
       } 
       else{
         
-        REAL tmp_rq = real(dot( r_.get(), r_.get()) );
-        *p_ *= ELEMENT_TYPE((tmp_rq/rq_));           
-        axpy( ELEMENT_TYPE(1), r_.get(), p_.get() );
+        REAL tmp_rq = rr;
+        update_direction( ELEMENT_TYPE((tmp_rq/rq_)), r_.get() );
         rq_ = tmp_rq;      
       }
       
@@ -349,6 +357,26 @@ namespace Gadgetron{
       }    
     }
     
+    // x += alpha*p, r -= alpha*q, returns <r,r> of the updated residual if residual_norm is set (0 otherwise).
+    // The array specific solvers override this (and update_direction) with a single pass over the arrays.
+    //
+
+    virtual REAL update_solution( ELEMENT_TYPE alpha, ARRAY_TYPE *q, bool residual_norm )
+    {
+      axpy( alpha, p_.get(), x_.get() );
+      axpy( -alpha, q, r_.get() );
+      return residual_norm ? real(dot( r_.get(), r_.get() )) : REAL(0);
+    }
+
+    // p = z + beta*p
+    //
+
+    virtual void update_direction( ELEMENT_TYPE beta, ARRAY_TYPE *z )
+    {
+      *p_ *= beta;
+      axpy( ELEMENT_TYPE(1), z, p_.get() );
+    }
+
     // Perform mult_MH_M of the encoding and regularization matrices
     //
 
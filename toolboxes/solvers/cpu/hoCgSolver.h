@@ -10,6 +10,7 @@
 
 #include "cgSolver.h"
 #include "hoNDArray_math.h"
+#include "hoSolverUtils.h"
 
 namespace Gadgetron{
 
@@ -18,11 +19,26 @@ namespace Gadgetron{
       
       The class hoCgSolver is a convienience wrapper for the device independent cgSolver class.
       hoCgSolver instantiates the cgSolver for type hoNDArray<T>.
+      The vector updates of an iteration are fused into single passes over the arrays (see hoSolverUtils.h).
   */
   template <class T> class hoCgSolver : public cgSolver< hoNDArray<T> >
   {
   public:
+    typedef typename realType<T>::Type REAL;
+
     hoCgSolver() : cgSolver<hoNDArray<T> >() {}
     virtual ~hoCgSolver() {}
+
+  protected:
+
+    virtual REAL update_solution( T alpha, hoNDArray<T> *q, bool residual_norm )
+    {
+      return REAL(solver_cg_update( alpha, this->p_.get(), q, this->x_.get(), this->r_.get(), residual_norm ));
+    }
+
+    virtual void update_direction( T beta, hoNDArray<T> *z )
+    {
+      solver_xpay( z, beta, this->p_.get() );
+    }
   };
 }
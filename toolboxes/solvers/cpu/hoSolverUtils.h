@@ -23,4 +23,59 @@ template<class T> void solver_non_negativity_filter(hoNDArray<T> *xdata, hoNDArr
 		if( (real(x[i]) <= REAL(0)) && (real(g[i]) > 0) )
 			g[i]=T(0);
 }
+
+// Fused conjugate gradient updates: x += alpha*p, r -= alpha*q in a single pass, returning <r,r> of the updated residual.
+// Without residual_norm the reduction is skipped and 0 is returned.
+template<class T> double solver_cg_update(T alpha, hoNDArray<T> *pdata, hoNDArray<T> *qdata, hoNDArray<T> *xdata, hoNDArray<T> *rdata, bool residual_norm = true)
+{
+	if( pdata->get_number_of_elements() != xdata->get_number_of_elements() ||
+	    qdata->get_number_of_elements() != xdata->get_number_of_elements() ||
+	    rdata->get_number_of_elements() != xdata->get_number_of_elements() )
+		throw std::runtime_error("solver_cg_update: array dimensions mismatch");
+
+	const T* p = pdata->get_data_ptr();
+	const T* q = qdata->get_data_ptr();
+	T* x = xdata->get_data_ptr();
+	T* r = rdata->get_data_ptr();
+	const long long elements = (long long) xdata->get_number_of_elements();
+
+	if( !residual_norm ){
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+		for( long long i=0; i < elements; i++ ){
+			x[i] += alpha*p[i];
+			r[i] -= alpha*q[i];
+		}
+		return 0;
+	}
+
+	double rr = 0;
+#ifdef USE_OMP
+#pragma omp parallel for reduction(+:rr)
+#endif
+	for( long long i=0; i < elements; i++ ){
+		x[i] += alpha*p[i];
+		r[i] -= alpha*q[i];
+		rr += double(norm(r[i]));
+	}
+	return rr;
+}
+
+// p = z + beta*p
+template<class T> void solver_xpay(hoNDArray<T> *zdata, T beta, hoNDArray<T> *pdata)
+{
+	if( zdata->get_number_of_elements() != pdata->get_number_of_elements() )
+		throw std::runtime_error("solver_xpay: array dimensions mismatch");
+
+	const T* z = zdata->get_data_ptr();
+	T* p = pdata->get_data_ptr();
+	const long long elements = (long long) pdata->get_number_of_elements();
+
+#ifdef USE_OMP
+#pragma omp parallel for
+#endif
+	for( long long i=0; i < elements; i++ )
+		p[i] = z[i] + beta*p[i];
+}
 }
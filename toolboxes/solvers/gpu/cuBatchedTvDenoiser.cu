@@ -0,0 +1,272 @@
+#include "cuBatchedTvDenoiser.h"
+#include "cuNDArray_math.h"
+#include "check_CUDA.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#define TV_THREADS_PER_BLOCK 256
+
+namespace Gadgetron{
+
+  // The blocks of a launch are laid out as (blocks per image, images), so a block belongs to one image and
+  // returns as a whole when its image is converged. The differences are forward differences with Neumann
+  // boundaries, the divergences their negative adjoints.
+
+  template<class T> __device__ static inline T forward_x( const T *u, int i, int x, int nx )
+  {
+    return (x < nx-1) ? u[i+1]-u[i] : T(0);
+  }
+
+  template<class T> __device__ static inline T forward_y( const T *u, int i, int y, int nx, int ny )
+  {
+    return (y < ny-1) ? u[i+nx]-u[i] : T(0);
+  }
+
+  template<class T> __device__ static inline T divergence( const T *px, const T *py, int i, int x, int y, int nx, int ny )
+  {
+    T d = T(0);
+    if( x < nx-1 ) d += px[i];
+    if( x > 0 ) d -= px[i-1];
+    if( y < ny-1 ) d += py[i];
+    if( y > 0 ) d -= py[i-nx];
+    return d;
+  }
+
+  // p = proj_lambda( p + sigma (grad xbar - wbar) ), and for TGV q = proj_alpha0( q + sigma E wbar )
+  template<class REAL, class T, bool TGV> __global__ static void
+  tv_dual_kernel( const T *xbar, T *px, T *py, const T *wbar1, const T *wbar2, T *q11, T *q12, T *q22,
+                  const REAL *lambda, const REAL *alpha0, const int *active, int nx, int ny, REAL sigma )
+  {
+    const int image = blockIdx.y;
+    if( !active[image] ) return;
+
+    const int idx = blockIdx.x*blockDim.x+threadIdx.x;
+    if( idx >= nx*ny ) return;
+
+    const int x = idx%nx, y = idx/nx;
+    const int i = image*nx*ny+idx;
+
+    T gx = forward_x(xbar, i, x, nx);
+    T gy = forward_y(xbar, i, y, nx, ny);
+    if( TGV ){
+      gx -= wbar1[i];
+      gy -= wbar2[i];
+    }
+
+    T p1 = px[i]+sigma*gx;
+    T p2 = py[i]+sigma*gy;
+    REAL scale = ::max(REAL(1), sqrt(norm(p1)+norm(p2))/lambda[image]);
+    px[i] = p1/scale;
+    py[i] = p2/scale;
+
+    if( TGV ){
+      T e11 = forward_x(wbar1, i, x, nx);
+      T e22 = forward_y(wbar2, i, y, nx, ny);
+      T e12 = (forward_y(wbar1, i, y, nx, ny)+forward_x(wbar2, i, x, nx))*REAL(0.5);
+
+      T r11 = q11[i]+sigma*e11;
+      T r12 = q12[i]+sigma*e12;
+      T r22 = q22[i]+sigma*e22;
+      scale = ::max(REAL(1), sqrt(norm(r11)+norm(r22)+REAL(2)*norm(r12))/alpha0[image]);
+      q11[i] = r11/scale;
+      q12[i] = r12/scale;
+      q22[i] = r22/scale;
+    }
+  }
+
+  // x = (x + tau (div p + f)) / (1 + tau), for TGV w += tau (p + div q), and the extrapolations xbar, wbar.
+  // With CHECK the squared change and norm of x of each image are added to change and energy.
+  template<class REAL, class T, bool TGV, bool CHECK> __global__ static void
+  tv_primal_kernel( T *x, T *xbar, const T *f, const T *px, const T *py,
+                    T *w1, T *w2, T *wbar1, T *wbar2, const T *q11, const T *q12, const T *q22,
+                    const int *active, int nx, int ny, REAL tau, REAL *change, REAL *energy )
+  {
+    const int image = blockIdx.y;
+    if( !active[image] ) return;
+
+    const int idx = blockIdx.x*blockDim.x+threadIdx.x;
+    REAL dx = REAL(0), e = REAL(0);
+
+    if( idx < nx*ny ){
+      const int cx = idx%nx, cy = idx/nx;
+      const int i = image*nx*ny+idx;
+
+      const T x_old = x[i];
+      const T x_new = (x_old+tau*(divergence(px, py, i, cx, cy, nx, ny)+f[i]))/(REAL(1)+tau);
+      x[i] = x_new;
+      xbar[i] = REAL(2)*x_new-x_old;
+
+      if( TGV ){
+        const T w1_old = w1[i], w2_old = w2[i];
+        const T w1_new = w1_old+tau*(px[i]+divergence(q11, q12, i, cx, cy, nx, ny));
+        const T w2_new = w2_old+tau*(py[i]+divergence(q12, q22, i, cx, cy, nx, ny));
+        w1[i] = w1_new;
+        w2[i] = w2_new;
+        wbar1[i] = REAL(2)*w1_new-w1_old;
+        wbar2[i] = REAL(2)*w2_new-w2_old;
+      }
+
+      if( CHECK ){
+        dx = norm(x_new-x_old);
+        e = norm(x_new);
+      }
+    }
+
+    if( CHECK ){
+      __shared__ REAL s_change[TV_THREADS_PER_BLOCK];
+      __shared__ REAL s_energy[TV_THREADS_PER_BLOCK];
+      s_change[threadIdx.x] = dx;
+      s_energy[threadIdx.x] = e;
+      __syncthreads();
+
+      for( unsigned int s = blockDim.x/2; s > 0; s >>= 1 ){
+        if( threadIdx.x < s ){
+          s_change[threadIdx.x] += s_change[threadIdx.x+s];
+          s_energy[threadIdx.x] += s_energy[threadIdx.x+s];
+        }
+        __syncthreads();
+      }
+
+      if( threadIdx.x == 0 ){
+        atomicAdd(change+image, s_change[0]);
+        atomicAdd(energy+image, s_energy[0]);
+      }
+    }
+  }
+
+  template<class REAL, class T, bool TGV> static void
+  tv_iteration( const dim3 &grid, const dim3 &block, bool check, cuNDArray<T> **a, const REAL *lambda, const REAL *alpha0,
+                const int *active, int nx, int ny, REAL sigma, REAL tau, REAL *change, REAL *energy )
+  {
+    // a: x, xbar, f, px, py, and for TGV w1, w2, wbar1, wbar2, q11, q12, q22
+    T *d[12];
+    for( int k = 0; k < 12; k++ ) d[k] = (TGV || k < 5) ? a[k]->get_data_ptr() : 0;
+
+    tv_dual_kernel<REAL,T,TGV><<<grid,block>>>( d[1], d[3], d[4], d[7], d[8], d[9], d[10], d[11],
+                                                lambda, alpha0, active, nx, ny, sigma );
+    if( check )
+      tv_primal_kernel<REAL,T,TGV,true><<<grid,block>>>( d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7], d[8], d[9], d[10], d[11],
+                                                         active, nx, ny, tau, change, energy );
+    else
+      tv_primal_kernel<REAL,T,TGV,false><<<grid,block>>>( d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7], d[8], d[9], d[10], d[11],
+                                                          active, nx, ny, tau, change, energy );
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template<class T>
+  cuBatchedTvDenoiser<T>::cuBatchedTvDenoiser() : regularization_(TV), check_interval_(10)
+  {
+  }
+
+  template<class T> void
+  cuBatchedTvDenoiser<T>::denoise( cuNDArray<T> *images, const std::vector<Parameters> &params )
+  {
+    if( !images || images->get_number_of_dimensions() < 2 )
+      throw std::runtime_error("cuBatchedTvDenoiser::denoise: the images need at least two dimensions");
+
+    const int nx = (int) images->get_size(0);
+    const int ny = (int) images->get_size(1);
+    const size_t N = images->get_number_of_elements()/(nx*ny);
+
+    if( params.size() != N )
+      throw std::runtime_error("cuBatchedTvDenoiser::denoise: one set of parameters per image required");
+
+    iterations_.assign(N, 0);
+    if( N == 0 ) return;
+
+    const bool tgv = (regularization_ == TGV);
+
+    // The work arrays, the primal variable x is the input array itself
+    std::vector<size_t> dims;
+    dims.push_back(nx); dims.push_back(ny); dims.push_back(N);
+
+    cuNDArray<T> xbar(*images), f(*images);
+    cuNDArray<T> *a[12] = { images, &xbar, &f };
+
+    std::vector< boost::shared_ptr< cuNDArray<T> > > work;
+    for( int k = 3; k < (tgv ? 12 : 5); k++ ){
+      work.push_back( boost::shared_ptr< cuNDArray<T> >(new cuNDArray<T>(dims)) );
+      a[k] = work.back().get();
+      clear(a[k]);
+    }
+
+    // The parameters per image
+    std::vector<REAL> h_lambda(N), h_alpha0(N);
+    std::vector<int> h_active(N);
+    unsigned int max_iterations = 0;
+    for( size_t n = 0; n < N; n++ ){
+      if( params[n].lambda <= REAL(0) || (tgv && params[n].alpha0 <= REAL(0)) )
+        throw std::runtime_error("cuBatchedTvDenoiser::denoise: the weights must be positive");
+
+      h_lambda[n] = params[n].lambda;
+      h_alpha0[n] = params[n].alpha0;
+      h_active[n] = (params[n].max_iterations > 0) ? 1 : 0;
+      max_iterations = std::max(max_iterations, params[n].max_iterations);
+    }
+
+    cuNDArray<REAL> lambda(N), alpha0(N), change(N), energy(N);
+    cuNDArray<int> active(N);
+    CUDA_CALL(cudaMemcpy(lambda.get_data_ptr(), &h_lambda[0], N*sizeof(REAL), cudaMemcpyHostToDevice));
+    CUDA_CALL(cudaMemcpy(alpha0.get_data_ptr(), &h_alpha0[0], N*sizeof(REAL), cudaMemcpyHostToDevice));
+    CUDA_CALL(cudaMemcpy(active.get_data_ptr(), &h_active[0], N*sizeof(int), cudaMemcpyHostToDevice));
+
+    // Step sizes with tau*sigma*|K|^2 <= 1, |K|^2 <= 8 for the gradient and <= 12 with the TGV operator
+    const REAL step = REAL(1)/std::sqrt(REAL(tgv ? 12 : 8));
+
+    const dim3 block(TV_THREADS_PER_BLOCK);
+    const dim3 grid((nx*ny+TV_THREADS_PER_BLOCK-1)/TV_THREADS_PER_BLOCK, (unsigned int) N);
+
+    std::vector<REAL> h_change(N), h_energy(N);
+    size_t remaining = std::count(h_active.begin(), h_active.end(), 1);
+
+    for( unsigned int it = 0; it < max_iterations && remaining > 0; it++ ){
+
+      const bool check = ((it+1)%check_interval_ == 0);
+      if( check ){
+        CUDA_CALL(cudaMemset(change.get_data_ptr(), 0, N*sizeof(REAL)));
+        CUDA_CALL(cudaMemset(energy.get_data_ptr(), 0, N*sizeof(REAL)));
+      }
+
+      if( tgv )
+        tv_iteration<REAL,T,true>( grid, block, check, a, lambda.get_data_ptr(), alpha0.get_data_ptr(), active.get_data_ptr(),
+                                   nx, ny, step, step, change.get_data_ptr(), energy.get_data_ptr() );
+      else
+        tv_iteration<REAL,T,false>( grid, block, check, a, lambda.get_data_ptr(), alpha0.get_data_ptr(), active.get_data_ptr(),
+                                    nx, ny, step, step, change.get_data_ptr(), energy.get_data_ptr() );
+
+      if( check ){
+        CUDA_CALL(cudaMemcpy(&h_change[0], change.get_data_ptr(), N*sizeof(REAL), cudaMemcpyDeviceToHost));
+        CUDA_CALL(cudaMemcpy(&h_energy[0], energy.get_data_ptr(), N*sizeof(REAL), cudaMemcpyDeviceToHost));
+      }
+
+      bool changed = false;
+      for( size_t n = 0; n < N; n++ ){
+        if( !h_active[n] ) continue;
+        iterations_[n]++;
+
+        bool done = (iterations_[n] >= params[n].max_iterations);
+        if( check && params[n].tolerance > REAL(0) )
+          done = done || (h_change[n] <= params[n].tolerance*params[n].tolerance*h_energy[n]);
+
+        if( done ){
+          h_active[n] = 0;
+          remaining--;
+          changed = true;
+        }
+      }
+
+      if( changed && remaining > 0 )
+        CUDA_CALL(cudaMemcpy(active.get_data_ptr(), &h_active[0], N*sizeof(int), cudaMemcpyHostToDevice));
+    }
+  }
+
+  //
+  // Instantiations
+  //
+
+  // float only, the reductions use atomicAdd
+  template class EXPORTGPUSOLVERS cuBatchedTvDenoiser<float>;
+  template class EXPORTGPUSOLVERS cuBatchedTvDenoiser<float_complext>;
+}
@@ -0,0 +1,69 @@
+/** \file cuBatchedTvDenoiser.h
+    \brief Total variation (TV) and total generalized variation (TGV) denoising of a batch of 2D images.
+
+    The images are stacked into one device array [x y N] and denoised together by the first order primal-dual
+    algorithm of Chambolle and Pock ("A first-order primal-dual algorithm for convex problems with applications
+    to imaging", J Math Imaging Vis 40:120-145, 2011). Every image has its own weights, iteration limit and
+    tolerance; an iteration is one launch of the dual and one of the primal update over the whole batch, so
+    hundreds of small images keep the device busy where one solver run per image would not.
+
+    TV:  min_x  lambda |grad x|_1 + 1/2 |x-f|^2
+    TGV: min_x,w  lambda |grad x - w|_1 + alpha0 |E w|_1 + 1/2 |x-f|^2, E the symmetrized gradient
+         (Bredies, Kunisch and Pock, "Total generalized variation", SIAM J Imaging Sci 3:492-526, 2010)
+
+    The relative change of an image, |x_k+1 - x_k| / |x_k+1|, is reduced on the device every check interval.
+    An image below its tolerance or at its iteration limit is left out of the following launches, the
+    iterations stop once no image is left.
+*/
+
+#pragma once
+
+#include "cuNDArray.h"
+#include "complext.h"
+#include "gpusolvers_export.h"
+
+#include <vector>
+
+namespace Gadgetron{
+
+  template<class T> class EXPORTGPUSOLVERS cuBatchedTvDenoiser
+  {
+  public:
+
+    typedef typename realType<T>::Type REAL;
+
+    enum Regularization { TV, TGV };
+
+    struct Parameters
+    {
+      Parameters( REAL lambda = REAL(0.1), unsigned int max_iterations = 100, REAL tolerance = REAL(0), REAL alpha0 = REAL(0.2) )
+        : lambda(lambda), alpha0(alpha0), max_iterations(max_iterations), tolerance(tolerance) {}
+
+      REAL lambda;                  // weight of the first order term
+      REAL alpha0;                  // weight of the second order term of TGV
+      unsigned int max_iterations;
+      REAL tolerance;               // relative change at which the image is converged, 0 runs all iterations
+    };
+
+    cuBatchedTvDenoiser();
+
+    void set_regularization( Regularization r ) { regularization_ = r; }
+    Regularization get_regularization() const { return regularization_; }
+
+    // Iterations between the convergence checks, a check reads back two numbers per image
+    void set_check_interval( unsigned int interval ) { check_interval_ = (interval > 0) ? interval : 1; }
+    unsigned int get_check_interval() const { return check_interval_; }
+
+    // Denoises the images [x y N] in place, params holds one entry per image (N = elements/(x*y))
+    void denoise( cuNDArray<T> *images, const std::vector<Parameters> &params );
+
+    // Iterations run for each image of the last call
+    const std::vector<unsigned int>& get_iterations() const { return iterations_; }
+
+  protected:
+
+    Regularization regularization_;
+    unsigned int check_interval_;
+    std::vector<unsigned int> iterations_;
+  };
+}
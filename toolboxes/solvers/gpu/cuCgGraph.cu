@@ -0,0 +1,227 @@
+#include "cuCgGraph.h"
+#include "cuNDArray_blas.h"
+#include "check_CUDA.h"
+
+#include <algorithm>
+
+#define CG_THREADS_PER_BLOCK 256
+#define CG_MAX_BLOCKS 1024
+
+namespace Gadgetron{
+
+#define CUBLAS_CALL(fun) {cublasStatus_t err = fun; if (err != CUBLAS_STATUS_SUCCESS) {throw cuda_error(gadgetron_getCublasErrorString(err));}}
+
+  // Defined in cuNDArray_blas.cu
+  //
+
+  template<class T> EXPORTGPUCORE cublasStatus_t cublas_dot(cublasHandle_t, int, const T*, int, const  T*, int, T*, bool cc = true);
+
+  // Indices into the device scalars
+  enum { CG_PQ = 0, CG_RQ = 1, CG_RQ_NEW = 2, CG_ALPHA = 3 };
+
+  template<class T> __global__ static void
+  cg_alpha_kernel( T *scalars )
+  {
+    scalars[CG_ALPHA] = T(real(scalars[CG_RQ]))/scalars[CG_PQ];
+  }
+
+  template<class T> __global__ static void
+  cg_solution_kernel( T *x, T *r, const T *p, const T *q, const T *scalars, size_t elements )
+  {
+    const T alpha = scalars[CG_ALPHA];
+    for( size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x ){
+      x[idx] += alpha*p[idx];
+      r[idx] -= alpha*q[idx];
+    }
+  }
+
+  template<class T> __global__ static void
+  cg_direction_kernel( T *p, const T *z, const T *scalars, size_t elements )
+  {
+    const T beta = T(real(scalars[CG_RQ_NEW])/real(scalars[CG_RQ]));
+    for( size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x ){
+      p[idx] = z[idx] + beta*p[idx];
+    }
+  }
+
+  template<class T> __global__ static void
+  cg_swap_rq_kernel( T *scalars )
+  {
+    scalars[CG_RQ] = T(real(scalars[CG_RQ_NEW]));
+  }
+
+  static dim3 cg_grid( size_t elements )
+  {
+    size_t blocks = (elements+CG_THREADS_PER_BLOCK-1)/CG_THREADS_PER_BLOCK;
+    return dim3( (unsigned int) std::max<size_t>( 1, std::min<size_t>( blocks, CG_MAX_BLOCKS ) ) );
+  }
+
+  template<class T>
+  cuCgGraph<T>::cuCgGraph() : x_(0), r_(0), p_(0), q_(0), z_(0), elements_(0)
+  {
+    CUDA_CALL(cudaGetDevice(&device_));
+
+    // A blocking stream, ordered with the legacy default stream used by the operators
+    CUDA_CALL(cudaStreamCreate(&stream_));
+    CUDA_CALL(cudaMalloc((void**)&scalars_, 4*sizeof(T)));
+    CUDA_CALL(cudaMemset(scalars_, 0, 4*sizeof(T)));
+
+    // The graphs capture cublas calls on this handle, so it is not shared through the cudaDeviceManager pool
+    CUBLAS_CALL(cublasCreate(&handle_));
+    CUBLAS_CALL(cublasSetStream(handle_, stream_));
+    CUBLAS_CALL(cublasSetPointerMode(handle_, CUBLAS_POINTER_MODE_DEVICE));
+
+#if CUDART_VERSION >= 10000
+    solution_graph_ = 0;
+    direction_graph_ = 0;
+#endif
+  }
+
+  template<class T>
+  cuCgGraph<T>::~cuCgGraph()
+  {
+    int old_device;
+    cudaGetDevice(&old_device);
+    cudaSetDevice(device_);
+    release_graphs();
+    cublasDestroy(handle_);
+    cudaFree(scalars_);
+    cudaStreamDestroy(stream_);
+    cudaSetDevice(old_device);
+  }
+
+  template<class T> void
+  cuCgGraph<T>::release_graphs()
+  {
+#if CUDART_VERSION >= 10000
+    if( solution_graph_ ) cudaGraphExecDestroy(solution_graph_);
+    if( direction_graph_ ) cudaGraphExecDestroy(direction_graph_);
+    solution_graph_ = 0;
+    direction_graph_ = 0;
+#endif
+  }
+
+  template<class T> void
+  cuCgGraph<T>::launch_solution_update()
+  {
+    CUBLAS_CALL(cublas_dot<T>( handle_, (int)elements_, p_, 1, q_, 1, scalars_+CG_PQ ));
+    cg_alpha_kernel<T><<< 1, 1, 0, stream_ >>>( scalars_ );
+    cg_solution_kernel<T><<< cg_grid(elements_), CG_THREADS_PER_BLOCK, 0, stream_ >>>( x_, r_, p_, q_, scalars_, elements_ );
+  }
+
+  template<class T> void
+  cuCgGraph<T>::launch_direction_update()
+  {
+    CUBLAS_CALL(cublas_dot<T>( handle_, (int)elements_, r_, 1, z_, 1, scalars_+CG_RQ_NEW ));
+    cg_direction_kernel<T><<< cg_grid(elements_), CG_THREADS_PER_BLOCK, 0, stream_ >>>( p_, z_, scalars_, elements_ );
+    cg_swap_rq_kernel<T><<< 1, 1, 0, stream_ >>>( scalars_ );
+  }
+
+  template<class T> void
+  cuCgGraph<T>::capture( cuNDArray<T> *x, cuNDArray<T> *r, cuNDArray<T> *p, cuNDArray<T> *q, cuNDArray<T> *z )
+  {
+    if( !x || !r || !p || !q || !z ){
+      throw std::runtime_error("cuCgGraph::capture: 0x0 array not accepted");
+    }
+
+    if( x->get_device() != device_ ){
+      throw std::runtime_error("cuCgGraph::capture: arrays do not reside on the device of the graph");
+    }
+
+    const size_t elements = x->get_number_of_elements();
+    if( r->get_number_of_elements() != elements || p->get_number_of_elements() != elements ||
+        q->get_number_of_elements() != elements || z->get_number_of_elements() != elements ){
+      throw std::runtime_error("cuCgGraph::capture: array dimensions mismatch");
+    }
+
+    // The memory cache often returns the same buffers in the next solve
+    if( x->get_data_ptr() == x_ && r->get_data_ptr() == r_ && p->get_data_ptr() == p_ &&
+        q->get_data_ptr() == q_ && z->get_data_ptr() == z_ && elements == elements_ )
+      return;
+
+    x_ = x->get_data_ptr(); r_ = r->get_data_ptr(); p_ = p->get_data_ptr();
+    q_ = q->get_data_ptr(); z_ = z->get_data_ptr();
+    elements_ = elements;
+
+    release_graphs();
+
+#if CUDART_VERSION >= 10000
+    cudaGraph_t graph;
+
+    CUDA_CALL(cudaStreamBeginCapture(stream_, cudaStreamCaptureModeThreadLocal));
+    launch_solution_update();
+    CUDA_CALL(cudaStreamEndCapture(stream_, &graph));
+    CUDA_CALL(cudaGraphInstantiate(&solution_graph_, graph, 0, 0, 0));
+    CUDA_CALL(cudaGraphDestroy(graph));
+
+    CUDA_CALL(cudaStreamBeginCapture(stream_, cudaStreamCaptureModeThreadLocal));
+    launch_direction_update();
+    CUDA_CALL(cudaStreamEndCapture(stream_, &graph));
+    CUDA_CALL(cudaGraphInstantiate(&direction_graph_, graph, 0, 0, 0));
+    CUDA_CALL(cudaGraphDestroy(graph));
+#endif
+  }
+
+  template<class T> void
+  cuCgGraph<T>::set_rq( REAL rq )
+  {
+    T value = T(rq);
+    CUDA_CALL(cudaMemcpyAsync(scalars_+CG_RQ, &value, sizeof(T), cudaMemcpyHostToDevice, stream_));
+    CUDA_CALL(cudaStreamSynchronize(stream_));
+  }
+
+  template<class T> void
+  cuCgGraph<T>::update_solution()
+  {
+    if( elements_ == 0 ){
+      throw std::runtime_error("cuCgGraph::update_solution: no arrays captured");
+    }
+#if CUDART_VERSION >= 10000
+    CUDA_CALL(cudaGraphLaunch(solution_graph_, stream_));
+#else
+    launch_solution_update();
+#endif
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template<class T> void
+  cuCgGraph<T>::update_direction()
+  {
+    if( elements_ == 0 ){
+      throw std::runtime_error("cuCgGraph::update_direction: no arrays captured");
+    }
+#if CUDART_VERSION >= 10000
+    CUDA_CALL(cudaGraphLaunch(direction_graph_, stream_));
+#else
+    launch_direction_update();
+#endif
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  template<class T> typename cuCgGraph<T>::REAL
+  cuCgGraph<T>::get_rq()
+  {
+    T value;
+    CUDA_CALL(cudaMemcpyAsync(&value, scalars_+CG_RQ, sizeof(T), cudaMemcpyDeviceToHost, stream_));
+    CUDA_CALL(cudaStreamSynchronize(stream_));
+    return real(value);
+  }
+
+  template<class T> T
+  cuCgGraph<T>::get_alpha()
+  {
+    T value;
+    CUDA_CALL(cudaMemcpyAsync(&value, scalars_+CG_ALPHA, sizeof(T), cudaMemcpyDeviceToHost, stream_));
+    CUDA_CALL(cudaStreamSynchronize(stream_));
+    return value;
+  }
+
+  //
+  // Instantiations
+  //
+
+  template class EXPORTGPUSOLVERS cuCgGraph<float>;
+  template class EXPORTGPUSOLVERS cuCgGraph<double>;
+  template class EXPORTGPUSOLVERS cuCgGraph<float_complext>;
+  template class EXPORTGPUSOLVERS cuCgGraph<double_complext>;
+}
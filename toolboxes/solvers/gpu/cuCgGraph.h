@@ -0,0 +1,71 @@
+/** \file cuCgGraph.h
+    \brief The vector updates of a conjugate gradient iteration with the scalars kept on the device.
+
+    The updates of the solution, the residual and the search direction of cuCgSolver are captured
+    once as CUDA graphs and replayed in every iteration. The inner products are computed by cublas
+    into device memory, and alpha and beta are computed on the device, so an iteration does not
+    wait for the host. The scalars are read back only when the termination criterion is evaluated.
+
+    The graphs run on a blocking stream and are thereby ordered with the operators,
+    which launch their kernels on the default stream.
+    Without CUDA graph support (CUDA < 10) the same kernels are launched individually.
+*/
+
+#pragma once
+
+#include "cuNDArray.h"
+#include "complext.h"
+#include "gpusolvers_export.h"
+
+#include <cublas_v2.h>
+
+namespace Gadgetron{
+
+  template<class T> class EXPORTGPUSOLVERS cuCgGraph
+  {
+  public:
+
+    typedef typename realType<T>::Type REAL;
+
+    cuCgGraph();
+    ~cuCgGraph();
+
+    // Captures the updates for the given arrays, unless the arrays of the last capture are passed again.
+    // z is the preconditioned residual, or r itself without preconditioning.
+    void capture( cuNDArray<T> *x, cuNDArray<T> *r, cuNDArray<T> *p, cuNDArray<T> *q, cuNDArray<T> *z );
+
+    // Sets the squared (preconditioned) residual norm <r,z>
+    void set_rq( REAL rq );
+
+    // alpha = rq/<p,q>, x += alpha*p, r -= alpha*q
+    void update_solution();
+
+    // rq' = <r,z>, p = z + rq'/rq*p, rq = rq'
+    void update_direction();
+
+    // Wait for the device and read back the scalars
+    REAL get_rq();
+    T get_alpha();
+
+  protected:
+
+    void release_graphs();
+    void launch_solution_update();
+    void launch_direction_update();
+
+    int device_;
+    cudaStream_t stream_;
+    cublasHandle_t handle_;
+
+    // Device scalars: <p,q>, rq, rq', alpha
+    T *scalars_;
+
+    T *x_, *r_, *p_, *q_, *z_;
+    size_t elements_;
+
+#if CUDART_VERSION >= 10000
+    cudaGraphExec_t solution_graph_;
+    cudaGraphExec_t direction_graph_;
+#endif
+  };
+}
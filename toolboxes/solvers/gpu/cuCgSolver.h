@@ -12,6 +12,8 @@
 #include "cuNDArray_elemwise.h"
 #include "cuNDArray_blas.h"
 #include "cgSolver.h"
+#include "cuCgGraph.h"
+#include "cuSolverUtils.h"
 
 namespace Gadgetron{
   
@@ -20,11 +22,298 @@ namespace Gadgetron{
       
       The class cuCgSolver is a convienience wrapper for the device independent cgSolver class.
       cuCgSolver instantiates the cgSolver for type cuNDArray<T>.
+      The solution/residual update with the residual norm, and the direction update,
+      each run as one fused kernel (see cuSolverUtils.h).
+
+      With set_use_graphs(true) the vector updates of each iteration are replayed from CUDA graphs
+      with alpha, beta and the residual norm kept on the device (see cuCgGraph.h).
+      The host then waits for the device only every tc_check_interval iterations, to evaluate the
+      termination callback. This mainly pays off for small problems, e.g. real-time 2D frames,
+      where kernel launches and host round trips dominate the iteration time.
+
+      With set_mixed_precision(true) the operators keep running in the precision of T (i.e. float),
+      but the inner products of the iteration are accumulated in double precision. If the residual
+      norm has not decreased for stall_iterations iterations, the residual is recomputed from the
+      current solution (r = b - Ax) and the search direction is restarted. This recovers the
+      accuracy lost to the accumulated rounding errors of the recursively updated residual.
+      The graph mode takes precedence if both are enabled.
+
+      With set_batch_size(B) the arrays hold B independent systems as consecutive equal-sized parts,
+      e.g. B slices stacked in the last dimension. The operators must not couple the parts. The inner
+      products, alpha and beta are computed per batch member in one kernel launch each, and every member
+      stops updating once its own relative residual is below the tolerance. The solve ends when all
+      members have converged. This mode takes precedence over the graph and mixed precision modes.
   */
   template <class T> class cuCgSolver : public cgSolver< cuNDArray<T> >
   {
-  public:    
-    cuCgSolver() : cgSolver<cuNDArray<T> >() {}
+  public:
+
+    typedef typename realType<T>::Type REAL;
+
+    cuCgSolver() : cgSolver<cuNDArray<T> >(), use_graphs_(false), tc_check_interval_(1),
+      mixed_precision_(false), stall_iterations_(3), rhs_(0), batches_(1) {}
     virtual ~cuCgSolver() {}
+
+    virtual void set_use_graphs( bool use_graphs ) { use_graphs_ = use_graphs; }
+    virtual bool get_use_graphs() { return use_graphs_; }
+
+    // Evaluate the termination callback every 'interval' iterations only (graph mode)
+    virtual void set_tc_check_interval( unsigned int interval ) { tc_check_interval_ = (interval > 0) ? interval : 1; }
+    virtual unsigned int get_tc_check_interval() { return tc_check_interval_; }
+
+    virtual void set_mixed_precision( bool mixed_precision ) { mixed_precision_ = mixed_precision; }
+    virtual bool get_mixed_precision() { return mixed_precision_; }
+
+    // Iterations without a decrease of the residual norm before the residual is recomputed (mixed precision mode)
+    virtual void set_stall_iterations( unsigned int iterations ) { stall_iterations_ = (iterations > 0) ? iterations : 1; }
+    virtual unsigned int get_stall_iterations() { return stall_iterations_; }
+
+    // Number of residual replacements in the last solve (mixed precision mode)
+    virtual unsigned int get_number_of_residual_replacements() { return residual_replacements_; }
+
+    virtual void set_batch_size( unsigned int batches ) { batches_ = (batches > 0) ? batches : 1; }
+    virtual unsigned int get_batch_size() { return batches_; }
+
+    // Iterations each batch member needed in the last solve (batched mode)
+    virtual std::vector<unsigned int> get_batch_iterations() { return batch_iterations_; }
+
+  protected:
+
+    virtual void initialize( cuNDArray<T> *rhs )
+    {
+      cgSolver< cuNDArray<T> >::initialize(rhs);
+
+      rhs_ = rhs;
+      residual_replacements_ = 0;
+      stalled_iterations_ = 0;
+      best_rq_ = this->rq_;
+
+      if( !use_graphs_ && !mixed_precision_ && batches_ == 1 )
+        return;
+
+      q_ = boost::shared_ptr< cuNDArray<T> >( new cuNDArray<T>(this->x_->get_dimensions()) );
+
+      if( batches_ > 1 ){
+        initialize_batched();
+        return;
+      }
+
+      if( !use_graphs_ )
+        return;
+
+      if( !graph_.get() || graph_device_ != this->x_->get_device() ){
+        graph_ = boost::shared_ptr< cuCgGraph<T> >( new cuCgGraph<T>() );
+        graph_device_ = this->x_->get_device();
+      }
+
+      // Without a preconditioner the residual is its own preconditioned residual
+      cuNDArray<T> *z = this->precond_.get() ? q_.get() : this->r_.get();
+      graph_->capture( this->x_.get(), this->r_.get(), this->p_.get(), q_.get(), z );
+      graph_->set_rq( this->rq_ );
+    }
+
+    virtual void deinitialize()
+    {
+      q_.reset();
+      rhs_ = 0;
+      cgSolver< cuNDArray<T> >::deinitialize();
+    }
+
+    virtual void iterate( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
+    {
+      if( batches_ > 1 )
+        iterate_batched( iteration, tc_metric, tc_terminate );
+      else if( use_graphs_ )
+        iterate_graph( iteration, tc_metric, tc_terminate );
+      else if( mixed_precision_ )
+        iterate_mixed_precision( iteration, tc_metric, tc_terminate );
+      else
+        cgSolver< cuNDArray<T> >::iterate( iteration, tc_metric, tc_terminate );
+    }
+
+    virtual void iterate_graph( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
+    {
+      this->mult_MH_M( this->p_.get(), q_.get() );
+
+      graph_->update_solution();
+
+      if( this->precond_.get() ){
+        this->precond_->apply( this->r_.get(), q_.get() );
+        this->precond_->apply( q_.get(), q_.get() );
+      }
+
+      graph_->update_direction();
+
+      *tc_terminate = false;
+
+      if( (iteration+1) % tc_check_interval_ == 0 || iteration+1 == this->iterations_ ){
+        this->rq_ = graph_->get_rq();
+        this->alpha_ = graph_->get_alpha();
+        if( !this->cb_->iterate( iteration, tc_metric, tc_terminate ) ){
+          throw std::runtime_error( "Error: cuCgSolver::iterate : termination callback iteration failed" );
+        }
+      }
+    }
+
+    virtual void iterate_mixed_precision( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
+    {
+      this->mult_MH_M( this->p_.get(), q_.get() );
+
+      // For a Hermitian system <p,Ap> is real
+      double pq = solver_real_dot( this->p_.get(), q_.get() );
+      this->alpha_ = T(REAL(double(this->rq_)/pq));
+
+      double rr = solver_cg_update( this->alpha_, this->p_.get(), q_.get(), this->x_.get(), this->r_.get(), !this->precond_.get() );
+      double rq = this->precond_.get() ? preconditioned_residual() : rr;
+
+      if( rq < best_rq_ ){
+        best_rq_ = rq;
+        stalled_iterations_ = 0;
+      }
+      else
+        stalled_iterations_++;
+
+      if( stalled_iterations_ >= stall_iterations_ ){
+
+        // r = b - Ax, and restart from the steepest descent direction
+        this->mult_MH_M( this->x_.get(), q_.get() );
+        *this->r_ = *rhs_;
+        *this->r_ -= *q_;
+        rq = preconditioned_residual();
+        *this->p_ = this->precond_.get() ? *q_ : *this->r_;
+
+        if( this->output_mode_ >= solver<cuNDArray<T>,cuNDArray<T> >::OUTPUT_VERBOSE ){
+          GDEBUG_STREAM("Iteration " << iteration << ": residual stalled, recomputed rq = " << rq << std::endl);
+        }
+
+        best_rq_ = rq;
+        stalled_iterations_ = 0;
+        residual_replacements_++;
+      }
+      else{
+        solver_xpay( this->precond_.get() ? q_.get() : this->r_.get(), T(REAL(rq/double(this->rq_))), this->p_.get() );
+      }
+
+      this->rq_ = REAL(rq);
+
+      if( !this->cb_->iterate( iteration, tc_metric, tc_terminate ) ){
+        throw std::runtime_error( "Error: cuCgSolver::iterate : termination callback iteration failed" );
+      }
+    }
+
+    virtual void initialize_batched()
+    {
+      if( rhs_->get_number_of_elements() % batches_ ){
+        throw std::runtime_error( "Error: cuCgSolver::initialize : the rhs does not split into the batch size" );
+      }
+
+      // p holds the preconditioned residual after the initialization of the base class
+      batch_rq_ = solver_real_dot_batched( this->r_.get(), this->p_.get(), batches_ );
+
+      if( this->precond_.get() ){
+        this->precond_->apply( rhs_, q_.get() );
+        this->precond_->apply( q_.get(), q_.get() );
+        batch_rq0_ = solver_real_dot_batched( rhs_, q_.get(), batches_ );
+      }
+      else
+        batch_rq0_ = solver_real_dot_batched( rhs_, rhs_, batches_ );
+
+      batch_iterations_ = std::vector<unsigned int>( batches_, 0 );
+      batch_converged_ = std::vector<bool>( batches_, false );
+    }
+
+    virtual void iterate_batched( unsigned int iteration, REAL *tc_metric, bool *tc_terminate )
+    {
+      this->mult_MH_M( this->p_.get(), q_.get() );
+
+      std::vector<double> pq = solver_real_dot_batched( this->p_.get(), q_.get(), batches_ );
+      std::vector<T> alpha( batches_, T(0) );
+      for( unsigned int b=0; b<batches_; b++ ){
+        if( !batch_converged_[b] && pq[b] != 0.0 )
+          alpha[b] = T(REAL(batch_rq_[b]/pq[b]));
+      }
+
+      solver_axpy_batched( alpha, this->p_.get(), this->x_.get() );
+      for( unsigned int b=0; b<batches_; b++ )
+        alpha[b] = -alpha[b];
+      solver_axpy_batched( alpha, q_.get(), this->r_.get() );
+
+      cuNDArray<T> *z = this->r_.get();
+      if( this->precond_.get() ){
+        this->precond_->apply( this->r_.get(), q_.get() );
+        this->precond_->apply( q_.get(), q_.get() );
+        z = q_.get();
+      }
+
+      std::vector<double> rq = solver_real_dot_batched( this->r_.get(), z, batches_ );
+      std::vector<T> beta( batches_, T(0) );
+
+      double max_metric = 0.0, sum_rq = 0.0;
+      *tc_terminate = true;
+
+      for( unsigned int b=0; b<batches_; b++ ){
+        if( !batch_converged_[b] ){
+          beta[b] = T(REAL(rq[b]/batch_rq_[b]));
+          batch_rq_[b] = rq[b];
+          batch_iterations_[b] = iteration+1;
+          batch_converged_[b] = ( batch_rq0_[b] == 0.0 || batch_rq_[b]/batch_rq0_[b] < this->tc_tolerance_ );
+        }
+
+        if( batch_rq0_[b] > 0.0 )
+          max_metric = std::max( max_metric, batch_rq_[b]/batch_rq0_[b] );
+        sum_rq += batch_rq_[b];
+        *tc_terminate = *tc_terminate && batch_converged_[b];
+      }
+
+      // The direction of converged members is irrelevant, their alpha stays zero
+      solver_xpay_batched( z, beta, this->p_.get() );
+
+      this->rq_ = REAL(sum_rq);
+      *tc_metric = REAL(max_metric);
+
+      if( this->output_mode_ >= solver<cuNDArray<T>,cuNDArray<T> >::OUTPUT_VERBOSE ){
+        GDEBUG_STREAM("Iteration " << iteration << ". max rq/rq_0 over the batch = " << max_metric << std::endl);
+      }
+    }
+
+    // Fused vector updates of the standard iteration (see cuSolverUtils.h)
+    virtual REAL update_solution( T alpha, cuNDArray<T> *q, bool residual_norm )
+    {
+      return REAL(solver_cg_update( alpha, this->p_.get(), q, this->x_.get(), this->r_.get(), residual_norm ));
+    }
+
+    virtual void update_direction( T beta, cuNDArray<T> *z )
+    {
+      solver_xpay( z, beta, this->p_.get() );
+    }
+
+    // Computes z = M^2 r into q_ (with a preconditioner) and returns <r,z>
+    double preconditioned_residual()
+    {
+      if( this->precond_.get() ){
+        this->precond_->apply( this->r_.get(), q_.get() );
+        this->precond_->apply( q_.get(), q_.get() );
+        return solver_real_dot( this->r_.get(), q_.get() );
+      }
+      return solver_real_dot( this->r_.get(), this->r_.get() );
+    }
+
+    bool use_graphs_;
+    unsigned int tc_check_interval_;
+    int graph_device_;
+    boost::shared_ptr< cuCgGraph<T> > graph_;
+    boost::shared_ptr< cuNDArray<T> > q_;
+
+    bool mixed_precision_;
+    unsigned int stall_iterations_;
+    unsigned int stalled_iterations_;
+    unsigned int residual_replacements_;
+    double best_rq_;
+    cuNDArray<T> *rhs_;
+
+    unsigned int batches_;
+    std::vector<double> batch_rq_, batch_rq0_;
+    std::vector<bool> batch_converged_;
+    std::vector<unsigned int> batch_iterations_;
   };
 }
@@ -0,0 +1,377 @@
+/** \file       cuGdSolver.h
+    \brief      Gradient descent solver with proximal operation on the gpu, the algorithm of hoGdSolver for the cuNDArray
+
+    The proximal operator Proximal_Oper_Type must provide mult_M, mult_MH, proximity(cuNDArray<T>&, REAL) and unitary(),
+    e.g. cuWavelet2DTOperator.
+*/
+
+#pragma once
+
+#include "solver.h"
+#include "linearOperator.h"
+#include "cuNDArray_operators.h"
+#include "cuNDArray_elemwise.h"
+#include "cuNDArray_blas.h"
+#include "cuNDArray_reductions.h"
+
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Gadgetron {
+
+template <class T, class Proximal_Oper_Type> class cuGdSolver;
+
+template <class T, class Proximal_Oper_Type>
+class cuGdSolverCallBack
+{
+public:
+
+    cuGdSolverCallBack() : solver_(NULL) {}
+    virtual ~cuGdSolverCallBack() {}
+
+    typedef cuGdSolver<T, Proximal_Oper_Type> SolverType;
+    SolverType* solver_;
+
+    virtual void execute(const cuNDArray<T>& b, cuNDArray<T>& x) = 0;
+};
+
+template <class T, class Proximal_Oper_Type>
+class cuGdSolver : public solver< cuNDArray<T>, cuNDArray<T> >
+{
+public:
+
+    typedef cuGdSolver<T, Proximal_Oper_Type> Self;
+    typedef solver< cuNDArray<T>, cuNDArray<T> > BaseClass;
+    typedef cuNDArray<T> Array_Type;
+
+    typedef typename realType<T>::Type value_type;
+
+    cuGdSolver();
+    virtual ~cuGdSolver();
+
+    virtual boost::shared_ptr<Array_Type> solve(Array_Type* x);
+    virtual void solve(const Array_Type& b, Array_Type& x);
+
+    /// number of max iterations
+    size_t iterations_;
+
+    /// threshold for detla change of solution gradient
+    value_type grad_thres_;
+
+    /// threshold for detla change of objective function
+    value_type thres_;
+
+    /// record the function values
+    std::vector<value_type> func_value_;
+
+    /// strength of proximity operation
+    value_type proximal_strength_ratio_;
+
+    /// the scale factor for regularization
+    /// if < 0, then compute the scale factor in the solver
+    value_type scale_factor_;
+
+    /// whether to determine lamda from L1 term
+    bool determine_proximal_strength_from_L1_term_;
+
+    /// maximal number of inner iterations
+    size_t iterations_inner_;
+
+    /// maximal number of linear search steps
+    size_t search_steps_;
+
+    linearOperator<Array_Type>* oper_system_;
+    Proximal_Oper_Type* oper_reg_;
+
+    cuGdSolverCallBack<T, Proximal_Oper_Type>* call_back_;
+
+protected:
+
+    /// max of |x|
+    value_type max_abs(Array_Type& x) { return max(abs(&x).get()); }
+};
+
+template <class T, class Proximal_Oper_Type>
+cuGdSolver<T, Proximal_Oper_Type>::
+cuGdSolver() : BaseClass()
+{
+    iterations_ = 100;
+    grad_thres_ = (value_type)1e-5;
+    thres_ = (value_type)0.1;
+    proximal_strength_ratio_ = 1e-3;
+
+    scale_factor_ = -1;
+    determine_proximal_strength_from_L1_term_ = false;
+
+    iterations_inner_ = 50;
+    search_steps_ = 10;
+
+    oper_system_ = NULL;
+    oper_reg_ = NULL;
+
+    call_back_ = NULL;
+}
+
+template <class T, class Proximal_Oper_Type>
+cuGdSolver<T, Proximal_Oper_Type>::
+~cuGdSolver()
+{
+}
+
+template <class T, class Proximal_Oper_Type>
+boost::shared_ptr< cuNDArray<T> > cuGdSolver<T, Proximal_Oper_Type>::solve(Array_Type* x)
+{
+    boost::shared_ptr<Array_Type> b(new Array_Type);
+    this->solve(*b, *x);
+    return b;
+}
+
+template <class T, class Proximal_Oper_Type>
+void cuGdSolver<T, Proximal_Oper_Type>::
+solve(const Array_Type& b, Array_Type& x)
+{
+    if (oper_system_ == NULL || oper_reg_ == NULL)
+        throw std::runtime_error("cuGdSolver::solve(): the solver can only handle two operators");
+
+    if (!this->x0_)
+        throw std::runtime_error("cuGdSolver::solve(): the initial solution is not set");
+
+    func_value_.clear();
+    func_value_.reserve(iterations_);
+
+    Array_Type ATb;
+    Array_Type* pb = const_cast<Array_Type*>(&b);
+    oper_system_->mult_MH(pb, &ATb);
+
+    Array_Type WATb;
+    if (determine_proximal_strength_from_L1_term_)
+    {
+        oper_reg_->mult_M(&ATb, &WATb);
+    }
+
+    value_type norm_length = 0.1;
+    value_type norm_max;
+
+    if (this->scale_factor_ < 0)
+    {
+        if (determine_proximal_strength_from_L1_term_)
+        {
+            norm_max = this->max_abs(WATb);
+        }
+        else
+        {
+            norm_max = this->max_abs(ATb);
+        }
+    }
+    else
+    {
+        norm_max = scale_factor_;
+    }
+
+    value_type proximal_strength = proximal_strength_ratio_ * std::abs(norm_max);
+    if (std::abs(proximal_strength) < FLT_EPSILON)
+    {
+        norm_max = this->max_abs(*(this->x0_));
+        proximal_strength = proximal_strength_ratio_ * std::abs(norm_max);
+    }
+
+    if (this->output_mode_ >= Self::OUTPUT_VERBOSE)
+    {
+        GDEBUG_STREAM("---> cuGdSolver iteration : proximal_strength - " << proximal_strength);
+    }
+
+    if (proximal_strength<FLT_EPSILON) return;
+
+    x = *(this->x0_);
+
+    Array_Type Ax;
+    oper_system_->mult_M(&x, &Ax);
+
+    Array_Type bufX(x);
+    Array_Type bufAx(Ax), bufAx2(Ax);
+    Array_Type bufX2(x);
+    clear(&bufX2);
+
+    value_type stepA = 0;
+    value_type stepB = 1;
+
+    size_t nIter;
+
+    Array_Type x2(x), diffx(x), xprev(x);
+    Array_Type diffb(ATb), diffbNorm(ATb), ATAb(ATb);
+    Array_Type proximal_WATb, proximal_WTATb, proximal_res, r;
+    value_type diffA_norm, diffX_norm;
+
+    for (nIter = 0; nIter<iterations_; nIter++)
+    {
+        value_type tt = (stepA - 1) / stepB;
+
+        x2 = bufX2;
+        x2 *= tt;
+        x2 += x;
+
+        bufAx2 = Ax;
+        bufAx2 -= bufAx;
+        bufAx2 *= tt;
+        bufAx2 += Ax;
+
+        oper_system_->mult_MH(&bufAx2, &ATAb);
+        diffb = ATAb;
+        diffb -= ATb;
+
+        bufX = x;
+
+        size_t iterInner;
+        for (iterInner = 0; iterInner<iterations_inner_; iterInner++)
+        {
+            diffbNorm = diffb;
+            diffbNorm *= value_type(1.0) / norm_length;
+            diffx = x2;
+            diffx -= diffbNorm;
+
+            value_type proximal_strength_normalized = proximal_strength / norm_length;
+
+            oper_reg_->mult_M(&diffx, &WATb);
+
+            if (!proximal_WATb.dimensions_equal(&WATb))
+            {
+                proximal_WATb.create(WATb.get_dimensions());
+                clear(&proximal_WATb);
+            }
+
+            if (!proximal_WTATb.dimensions_equal(&WATb))
+            {
+                proximal_WTATb.create(WATb.get_dimensions());
+                clear(&proximal_WTATb);
+            }
+
+            // clamp the magnitude of proximal_WATb to proximal_strength_normalized, which is x - shrink1(x)
+            if (!r.dimensions_equal(&proximal_WATb)) r.create(proximal_WATb.get_dimensions());
+            shrink1(&proximal_WATb, proximal_strength_normalized, &r);
+            proximal_WATb -= r;
+
+            WATb -= proximal_WATb;
+            WATb -= proximal_WTATb;
+
+            size_t ii;
+            for (ii = 0; ii<search_steps_; ii++)
+            {
+                proximal_res = WATb;
+                proximal_res += proximal_WATb;
+
+                oper_reg_->proximity(proximal_res, proximal_strength_normalized);
+
+                WATb -= proximal_res;
+                proximal_WATb += WATb;
+
+                value_type n1 = nrm2(&WATb);
+
+                WATb = proximal_res;
+                WATb += proximal_WTATb;
+
+                if (!oper_reg_->unitary())
+                {
+                    oper_reg_->mult_MH(&WATb, &r);
+                    oper_reg_->mult_M(&r, &WATb);
+                }
+
+                r = proximal_res;
+                r -= WATb;
+                proximal_WTATb += r;
+
+                value_type nx = nrm2(&WATb);
+
+                if (n1 < nx*1e-4) break;
+            }
+
+            oper_reg_->mult_MH(&WATb, &x);
+
+            diffx = x;
+            diffx -= x2;
+
+            oper_system_->mult_M(&x, &Ax);
+
+            bufAx = Ax;
+            bufAx -= bufAx2;
+
+            diffX_norm = nrm2(&diffx);
+            diffX_norm = diffX_norm*diffX_norm;
+
+            diffA_norm = nrm2(&bufAx);
+            diffA_norm = diffA_norm*diffA_norm;
+
+            if (diffX_norm <= FLT_EPSILON) break;
+            if (diffA_norm <= diffX_norm * norm_length)
+            {
+                break;
+            }
+            else
+            {
+                norm_length = std::max((value_type)(1.5*norm_length), diffA_norm / diffX_norm);
+            }
+        }
+
+        bufAx = Ax;
+
+        stepA = stepB;
+        stepB = (value_type)((1.0 + std::sqrt(4.0*stepA*stepA + 1.0)) / 2.0);
+
+        bufX2 = x;
+        bufX2 -= bufX;
+
+        bufAx2 = Ax;
+        bufAx2 -= *pb;
+
+        oper_reg_->mult_M(&x, &WATb);
+
+        value_type error_data_fidelity = nrm2(&bufAx2);
+        error_data_fidelity = error_data_fidelity*error_data_fidelity;
+        error_data_fidelity *= 0.5;
+
+        value_type error_image_reg = asum(abs(&WATb).get());
+        func_value_.push_back(error_data_fidelity + proximal_strength*error_image_reg);
+
+        if (this->output_mode_ >= Self::OUTPUT_VERBOSE)
+        {
+            if (nIter > 0)
+            {
+                GDEBUG_STREAM("---> iteration " << nIter << " - cost : " << error_data_fidelity << " - delta change : " << (func_value_[nIter] - func_value_[nIter - 1]) << " - " << (func_value_[nIter] - func_value_[nIter - 1]) / func_value_[nIter - 1]);
+            }
+            else
+            {
+                GDEBUG_STREAM("---> iteration " << nIter << " - initial cost : " << error_data_fidelity);
+            }
+        }
+
+        if (nIter >= 2)
+        {
+            if (func_value_[nIter] > func_value_[nIter - 1])
+            {
+                x = xprev;
+                break;
+            }
+
+            if (std::abs(func_value_[nIter] - func_value_[nIter - 1]) <= thres_)
+            {
+                break;
+            }
+
+            if (std::abs(func_value_[nIter] - func_value_[nIter - 1]) / func_value_[nIter - 1] <= grad_thres_)
+            {
+                break;
+            }
+        }
+
+        if(call_back_!=NULL)
+        {
+            call_back_->solver_ = this;
+            call_back_->execute(b, x);
+        }
+
+        xprev = x;
+    }
+}
+
+}
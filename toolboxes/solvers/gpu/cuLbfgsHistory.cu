@@ -0,0 +1,262 @@
+#include "cuLbfgsHistory.h"
+#include "cuNDArray_blas.h"
+#include "check_CUDA.h"
+
+#include <algorithm>
+
+#define LBFGS_THREADS_PER_BLOCK 256
+#define LBFGS_MAX_BLOCKS 1024
+
+namespace Gadgetron{
+
+#define CUBLAS_CALL(fun) {cublasStatus_t err = fun; if (err != CUBLAS_STATUS_SUCCESS) {throw cuda_error(gadgetron_getCublasErrorString(err));}}
+
+  // Indices into the device scalars
+  enum { LBFGS_ONE = 0, LBFGS_ZERO = 1, LBFGS_MINUS_GAMMA = 2 };
+
+  //
+  // cublas gemm/gemv with the first matrix conjugate transposed
+  //
+
+  static cublasStatus_t lbfgs_gemm( cublasHandle_t handle, cublasOperation_t op, int m, int n, int k, const float *alpha,
+                                    const float *A, int lda, const float *B, int ldb, const float *beta, float *C, int ldc )
+  {
+    return cublasSgemm( handle, op, CUBLAS_OP_N, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc );
+  }
+
+  static cublasStatus_t lbfgs_gemm( cublasHandle_t handle, cublasOperation_t op, int m, int n, int k, const double *alpha,
+                                    const double *A, int lda, const double *B, int ldb, const double *beta, double *C, int ldc )
+  {
+    return cublasDgemm( handle, op, CUBLAS_OP_N, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc );
+  }
+
+  static cublasStatus_t lbfgs_gemm( cublasHandle_t handle, cublasOperation_t op, int m, int n, int k, const float_complext *alpha,
+                                    const float_complext *A, int lda, const float_complext *B, int ldb, const float_complext *beta, float_complext *C, int ldc )
+  {
+    return cublasCgemm( handle, op, CUBLAS_OP_N, m, n, k, (const cuComplex*) alpha,
+                        (const cuComplex*) A, lda, (const cuComplex*) B, ldb, (const cuComplex*) beta, (cuComplex*) C, ldc );
+  }
+
+  static cublasStatus_t lbfgs_gemm( cublasHandle_t handle, cublasOperation_t op, int m, int n, int k, const double_complext *alpha,
+                                    const double_complext *A, int lda, const double_complext *B, int ldb, const double_complext *beta, double_complext *C, int ldc )
+  {
+    return cublasZgemm( handle, op, CUBLAS_OP_N, m, n, k, (const cuDoubleComplex*) alpha,
+                        (const cuDoubleComplex*) A, lda, (const cuDoubleComplex*) B, ldb, (const cuDoubleComplex*) beta, (cuDoubleComplex*) C, ldc );
+  }
+
+  template<class T> static cublasOperation_t lbfgs_adjoint() { return CUBLAS_OP_C; }
+  template<> cublasOperation_t lbfgs_adjoint<float>() { return CUBLAS_OP_T; }
+  template<> cublasOperation_t lbfgs_adjoint<double>() { return CUBLAS_OP_T; }
+
+  // Stores s = alpha*d and y = g-g_old in their columns of the basis
+  template<class T> __global__ static void
+  lbfgs_pair_kernel( T *s, T *y, const T *d, typename realType<T>::Type alpha, const T *g, const T *g_old, size_t elements )
+  {
+    for( size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x ){
+      s[idx] = alpha*d[idx];
+      y[idx] = g[idx]-g_old[idx];
+    }
+  }
+
+  // The gemm updates the columns of the new pair, G is Hermitian so the rows are their conjugates
+  template<class T> __global__ static void
+  lbfgs_mirror_kernel( T *gram, unsigned int m, unsigned int slot )
+  {
+    const unsigned int n = 2*m;
+    const unsigned int i = blockIdx.x*blockDim.x+threadIdx.x;
+    if( i < n && i != slot && i != m+slot ){
+      gram[i*n+slot] = conj(gram[slot*n+i]);
+      gram[i*n+m+slot] = conj(gram[(m+slot)*n+i]);
+    }
+  }
+
+  // The two-loop recursion on the inner products. With q = g - sum_j alpha_j y_j and
+  // r = gamma q + sum_j c_j s_j, every inner product of the recursion is an entry of w = V^H g or G.
+  template<class T> __global__ static void
+  lbfgs_coefficients_kernel( const T *w, const T *gram, T *coef, T *scalars, unsigned int m, unsigned int head, unsigned int count )
+  {
+    const unsigned int n = 2*m;
+
+    for( unsigned int j=0; j<n; j++ )
+      coef[j] = T(0);
+
+    if( count == 0 ){
+      scalars[LBFGS_MINUS_GAMMA] = T(-1);
+      return;
+    }
+
+    // G(a,b) = <v_a,v_b>
+#define LBFGS_G(a,b) gram[(b)*n+(a)]
+
+    // Newest to oldest, alpha_i = <s_i,q>/rho_i, stored in the y coefficients
+    for( unsigned int k=0; k<count; k++ ){
+      const unsigned int i = (head+m-k)%m;
+      T sq = w[i];
+      for( unsigned int l=0; l<k; l++ ){
+        const unsigned int j = (head+m-l)%m;
+        sq -= coef[m+j]*LBFGS_G(i,m+j);
+      }
+      coef[m+i] = sq/LBFGS_G(i,m+i);
+    }
+
+    const T gamma = LBFGS_G(head,m+head)/LBFGS_G(m+head,m+head);
+
+    // Oldest to newest, beta_i = <y_i,r>/rho_i, c_i = alpha_i-beta_i stored in the s coefficients
+    for( unsigned int k=count; k-->0; ){
+      const unsigned int i = (head+m-k)%m;
+      T yq = w[m+i];
+      for( unsigned int l=0; l<count; l++ ){
+        const unsigned int j = (head+m-l)%m;
+        yq -= coef[m+j]*LBFGS_G(m+i,m+j);
+      }
+      T yr = gamma*yq;
+      for( unsigned int l=count; l-->k+1; ){
+        const unsigned int j = (head+m-l)%m;
+        yr += coef[j]*LBFGS_G(m+i,j);
+      }
+      coef[i] = coef[m+i]-yr/LBFGS_G(i,m+i);
+    }
+
+#undef LBFGS_G
+
+    // d = -r = V coef - gamma g
+    for( unsigned int k=0; k<count; k++ ){
+      const unsigned int i = (head+m-k)%m;
+      coef[i] = -coef[i];
+      coef[m+i] = gamma*coef[m+i];
+    }
+    scalars[LBFGS_MINUS_GAMMA] = -gamma;
+  }
+
+  static dim3 lbfgs_grid( size_t elements )
+  {
+    size_t blocks = (elements+LBFGS_THREADS_PER_BLOCK-1)/LBFGS_THREADS_PER_BLOCK;
+    return dim3( (unsigned int) std::max<size_t>( 1, std::min<size_t>( blocks, LBFGS_MAX_BLOCKS ) ) );
+  }
+
+  template<class T>
+  cuLbfgsHistory<T>::cuLbfgsHistory( size_t elements, unsigned int m ) : elements_(elements), m_(m), head_(0), count_(0)
+  {
+    if( elements == 0 || m == 0 ){
+      throw std::runtime_error("cuLbfgsHistory: empty history requested");
+    }
+
+    CUDA_CALL(cudaGetDevice(&device_));
+
+    // A blocking stream, ordered with the legacy default stream used by the operators
+    CUDA_CALL(cudaStreamCreate(&stream_));
+    CUDA_CALL(cudaMalloc((void**)&basis_, elements*2*m*sizeof(T)));
+    CUDA_CALL(cudaMalloc((void**)&gram_, 4*m*m*sizeof(T)));
+    CUDA_CALL(cudaMalloc((void**)&work_, 4*m*sizeof(T)));
+    CUDA_CALL(cudaMalloc((void**)&scalars_, 3*sizeof(T)));
+
+    T constants[3] = { T(1), T(0), T(-1) };
+    CUDA_CALL(cudaMemcpy(scalars_, constants, 3*sizeof(T), cudaMemcpyHostToDevice));
+    CUDA_CALL(cudaMemset(gram_, 0, 4*m*m*sizeof(T)));
+
+    // The direction is formed from all 2m columns, the unused ones with zero coefficients
+    CUDA_CALL(cudaMemset(basis_, 0, elements*2*m*sizeof(T)));
+
+    // Device pointer mode for the scalars, so the handle is not shared through the cudaDeviceManager pool
+    CUBLAS_CALL(cublasCreate(&handle_));
+    CUBLAS_CALL(cublasSetStream(handle_, stream_));
+    CUBLAS_CALL(cublasSetPointerMode(handle_, CUBLAS_POINTER_MODE_DEVICE));
+  }
+
+  template<class T>
+  cuLbfgsHistory<T>::~cuLbfgsHistory()
+  {
+    int old_device;
+    cudaGetDevice(&old_device);
+    cudaSetDevice(device_);
+    cublasDestroy(handle_);
+    cudaFree(scalars_);
+    cudaFree(work_);
+    cudaFree(gram_);
+    cudaFree(basis_);
+    cudaStreamDestroy(stream_);
+    cudaSetDevice(old_device);
+  }
+
+  template<class T> void
+  cuLbfgsHistory<T>::check( cuNDArray<T> *a, const char *caller )
+  {
+    if( !a ){
+      throw std::runtime_error(std::string("cuLbfgsHistory::") + caller + ": 0x0 array not accepted");
+    }
+    if( a->get_device() != device_ ){
+      throw std::runtime_error(std::string("cuLbfgsHistory::") + caller + ": array does not reside on the device of the history");
+    }
+    if( a->get_number_of_elements() != elements_ ){
+      throw std::runtime_error(std::string("cuLbfgsHistory::") + caller + ": array dimensions mismatch");
+    }
+  }
+
+  template<class T> void
+  cuLbfgsHistory<T>::reset()
+  {
+    head_ = 0;
+    count_ = 0;
+  }
+
+  template<class T> void
+  cuLbfgsHistory<T>::add_pair( cuNDArray<T> *d, REAL alpha, cuNDArray<T> *g, cuNDArray<T> *g_old )
+  {
+    check(d, "add_pair");
+    check(g, "add_pair");
+    check(g_old, "add_pair");
+
+    const unsigned int slot = (count_ == 0) ? 0 : (head_+1)%m_;
+    T *s = basis_+slot*elements_;
+    T *y = basis_+(m_+slot)*elements_;
+
+    lbfgs_pair_kernel<T><<< lbfgs_grid(elements_), LBFGS_THREADS_PER_BLOCK, 0, stream_ >>>
+      ( s, y, d->get_data_ptr(), alpha, g->get_data_ptr(), g_old->get_data_ptr(), elements_ );
+
+    // Columns slot and m+slot of G, ldb and ldc step from the s to the y column
+    const unsigned int n = 2*m_;
+    CUBLAS_CALL(lbfgs_gemm( handle_, lbfgs_adjoint<T>(), (int)n, 2, (int)elements_, scalars_+LBFGS_ONE,
+                            basis_, (int)elements_, s, (int)(m_*elements_), scalars_+LBFGS_ZERO, gram_+slot*n, (int)(m_*n) ));
+
+    lbfgs_mirror_kernel<T><<< 1, n, 0, stream_ >>>( gram_, m_, slot );
+    CHECK_FOR_CUDA_ERROR();
+
+    head_ = slot;
+    count_ = std::min(count_+1, m_);
+  }
+
+  template<class T> void
+  cuLbfgsHistory<T>::direction( cuNDArray<T> *g, cuNDArray<T> *d )
+  {
+    check(g, "direction");
+    check(d, "direction");
+
+    const unsigned int n = 2*m_;
+    T *w = work_;
+    T *coef = work_+n;
+
+    // The gemm with one column is the gemv w = V^H g
+    if( count_ > 0 )
+      CUBLAS_CALL(lbfgs_gemm( handle_, lbfgs_adjoint<T>(), (int)n, 1, (int)elements_, scalars_+LBFGS_ONE,
+                              basis_, (int)elements_, g->get_data_ptr(), (int)elements_, scalars_+LBFGS_ZERO, w, (int)n ));
+
+    lbfgs_coefficients_kernel<T><<< 1, 1, 0, stream_ >>>( w, gram_, coef, scalars_, m_, head_, count_ );
+
+    // d = V coef - gamma g
+    if( d->get_data_ptr() != g->get_data_ptr() )
+      CUDA_CALL(cudaMemcpyAsync(d->get_data_ptr(), g->get_data_ptr(), elements_*sizeof(T), cudaMemcpyDeviceToDevice, stream_));
+
+    CUBLAS_CALL(lbfgs_gemm( handle_, CUBLAS_OP_N, (int)elements_, 1, (int)n, scalars_+LBFGS_ONE,
+                            basis_, (int)elements_, coef, (int)n, scalars_+LBFGS_MINUS_GAMMA, d->get_data_ptr(), (int)elements_ ));
+    CHECK_FOR_CUDA_ERROR();
+  }
+
+  //
+  // Instantiations
+  //
+
+  template class EXPORTGPUSOLVERS cuLbfgsHistory<float>;
+  template class EXPORTGPUSOLVERS cuLbfgsHistory<double>;
+  template class EXPORTGPUSOLVERS cuLbfgsHistory<float_complext>;
+  template class EXPORTGPUSOLVERS cuLbfgsHistory<double_complext>;
+}
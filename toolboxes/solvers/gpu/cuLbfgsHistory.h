@@ -0,0 +1,68 @@
+/** \file cuLbfgsHistory.h
+    \brief The correction pair history of the L-BFGS solver kept contiguously on the device.
+
+    The m pairs (s,y) are the 2m columns of one device matrix V = [s_0..s_m-1 y_0..y_m-1], filled as a
+    ring buffer. Their inner products G = V^H V are updated by a single gemm when a pair is added. The
+    two-loop recursion then needs the inner products of the gradient with the pairs only, V^H g, which
+    are computed in one gemv. The recursion itself runs on the small matrix G in a single thread on the
+    device and gives the coefficients of the direction d = V c - gamma g, which is formed by a second gemv.
+
+    A direction update is thereby two gemvs and two small kernels, with all scalars kept on the device,
+    instead of 4m dot products and axpys each waiting for the host.
+    The calls run on a blocking stream and are thereby ordered with the operators.
+*/
+
+#pragma once
+
+#include "cuNDArray.h"
+#include "complext.h"
+#include "gpusolvers_export.h"
+
+#include <cublas_v2.h>
+
+namespace Gadgetron{
+
+  template<class T> class EXPORTGPUSOLVERS cuLbfgsHistory
+  {
+  public:
+
+    typedef typename realType<T>::Type REAL;
+
+    // A history of m pairs of arrays of 'elements' elements on the current device
+    cuLbfgsHistory( size_t elements, unsigned int m );
+    ~cuLbfgsHistory();
+
+    size_t get_number_of_elements() { return elements_; }
+    unsigned int get_m() { return m_; }
+    int get_device() { return device_; }
+
+    // Empties the history
+    void reset();
+
+    // Adds s = alpha*d and y = g-g_old, replacing the oldest pair once m pairs are stored
+    void add_pair( cuNDArray<T> *d, REAL alpha, cuNDArray<T> *g, cuNDArray<T> *g_old );
+
+    // d = -H g, the L-BFGS two-loop recursion (algorithm 9.2 in Numerical Optimization)
+    void direction( cuNDArray<T> *g, cuNDArray<T> *d );
+
+  protected:
+
+    void check( cuNDArray<T> *a, const char *caller );
+
+    int device_;
+    cudaStream_t stream_;
+    cublasHandle_t handle_;
+
+    size_t elements_;
+    unsigned int m_;
+
+    // Slot of the newest pair and the number of pairs stored
+    unsigned int head_;
+    unsigned int count_;
+
+    T *basis_;   // V, elements x 2m
+    T *gram_;    // G = V^H V, 2m x 2m
+    T *work_;    // V^H g and the coefficients, 2m each
+    T *scalars_; // one, zero and -gamma
+  };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lbfgsSolver.h"
+#include "cuLbfgsHistory.h"
 #include "cuNDArray_operators.h"
 #include "cuNDArray_elemwise.h"
 #include "cuNDArray_blas.h"
@@ -13,13 +14,64 @@
 #include "cuSolverUtils.h"
 
 namespace Gadgetron{
-  
+
+  /** \class cuLbfgsSolver
+      \brief Instantiation of the L-BFGS solver on the gpu.
+
+      With set_use_device_history(true) the correction pairs are stored contiguously on the device and
+      the two-loop recursion is computed from their batched inner products (see cuLbfgsHistory.h).
+      The direction update then does not wait for the host.
+  */
   template <class T> class cuLbfgsSolver : public lbfgsSolver<cuNDArray<T> >
   {
   public:
-    
-    cuLbfgsSolver() : lbfgsSolver<cuNDArray<T> >() {}
+
+    typedef typename realType<T>::Type REAL;
+
+    cuLbfgsSolver() : lbfgsSolver<cuNDArray<T> >(), use_device_history_(false) {}
     virtual ~cuLbfgsSolver() {}
+
+    virtual void set_use_device_history( bool use_device_history ) { use_device_history_ = use_device_history; }
+    virtual bool get_use_device_history() { return use_device_history_; }
+
+  protected:
+
+    virtual void reset_history()
+    {
+      lbfgsSolver<cuNDArray<T> >::reset_history();
+      if( history_.get() )
+        history_->reset();
+    }
+
+    virtual void update_direction( cuNDArray<T> *g, cuNDArray<T> *d )
+    {
+      if( !use_device_history_ ){
+        lbfgsSolver<cuNDArray<T> >::update_direction(g,d);
+        return;
+      }
+
+      // The history is created for the first gradient of a solve and kept for the next solve of the same size
+      if( !history_.get() || history_->get_number_of_elements() != g->get_number_of_elements() ||
+          history_->get_m() != this->m_ || history_->get_device() != g->get_device() ){
+        history_.reset();
+        history_ = boost::shared_ptr< cuLbfgsHistory<T> >( new cuLbfgsHistory<T>(g->get_number_of_elements(), this->m_) );
+      }
+
+      history_->direction(g,d);
+    }
+
+    virtual void add_correction_pair( cuNDArray<T> *d, REAL alpha, cuNDArray<T> *g, cuNDArray<T> *g_old )
+    {
+      if( !use_device_history_ ){
+        lbfgsSolver<cuNDArray<T> >::add_correction_pair(d,alpha,g,g_old);
+        return;
+      }
+
+      history_->add_pair(d,alpha,g,g_old);
+    }
+
+    bool use_device_history_;
+    boost::shared_ptr< cuLbfgsHistory<T> > history_;
 /*
     virtual void iteration_callback(cuNDArray<T>* x ,int iteration,typename realType<T>::Type value){
   	  if (iteration == 0){
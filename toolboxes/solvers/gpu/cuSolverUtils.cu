@@ -2,7 +2,9 @@
 #include "cuSolverUtils.h"
 #include <thrust/transform.h>
 #include <thrust/iterator/zip_iterator.h>
+#include <thrust/inner_product.h>
 #include "cuNDArray_math.h"
+#include "check_CUDA.h"
 #define MAX_THREADS_PER_BLOCK 512
 
 using namespace Gadgetron;
@@ -34,6 +36,200 @@ template <class T> void EXPORTGPUSOLVERS Gadgetron::solver_non_negativity_filter
 }
 
 
+template<class T> struct real_dot_functor{
+	__device__ __inline__ double operator() (T x, T y){
+		return double(x)*double(y);
+	}
+};
+
+template<class REAL> struct real_dot_functor< complext<REAL> >{
+	// Re(conj(x)*y)
+	__device__ __inline__ double operator() (complext<REAL> x, complext<REAL> y){
+		return double(x.vec[0])*double(y.vec[0]) + double(x.vec[1])*double(y.vec[1]);
+	}
+};
+
+template<class T> double EXPORTGPUSOLVERS Gadgetron::solver_real_dot(cuNDArray<T>* x, cuNDArray<T>* y)
+{
+	if( x == 0x0 || y == 0x0 || x->get_number_of_elements() != y->get_number_of_elements() )
+		throw std::runtime_error("solver_real_dot: invalid or mismatching input arrays");
+
+	return thrust::inner_product(x->begin(),x->end(),y->begin(),0.0,thrust::plus<double>(),real_dot_functor<T>());
+}
+
+#define BATCHED_DOT_THREADS 256
+#define BATCHED_DOT_MAX_BLOCKS 64
+
+template <class T> __global__ static void batched_real_dot_kernel(const T* x, const T* y, size_t batch_elements, double* partial){
+	__shared__ double cache[BATCHED_DOT_THREADS];
+	const size_t offset = blockIdx.y*batch_elements;
+	real_dot_functor<T> fun;
+
+	double sum = 0;
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < batch_elements; idx += blockDim.x*gridDim.x)
+		sum += fun(x[offset+idx],y[offset+idx]);
+	cache[threadIdx.x] = sum;
+	__syncthreads();
+
+	for (unsigned int i = blockDim.x/2; i > 0; i /= 2){
+		if (threadIdx.x < i)
+			cache[threadIdx.x] += cache[threadIdx.x+i];
+		__syncthreads();
+	}
+
+	if (threadIdx.x == 0)
+		partial[blockIdx.y*gridDim.x+blockIdx.x] = cache[0];
+}
+
+template<class T> std::vector<double> EXPORTGPUSOLVERS Gadgetron::solver_real_dot_batched(cuNDArray<T>* x, cuNDArray<T>* y, unsigned int batches)
+{
+	if( x == 0x0 || y == 0x0 || x->get_number_of_elements() != y->get_number_of_elements() )
+		throw std::runtime_error("solver_real_dot_batched: invalid or mismatching input arrays");
+	if( batches == 0 || x->get_number_of_elements() % batches )
+		throw std::runtime_error("solver_real_dot_batched: the arrays do not split into the number of batches");
+
+	const size_t batch_elements = x->get_number_of_elements()/batches;
+	const unsigned int blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(BATCHED_DOT_MAX_BLOCKS,(batch_elements+BATCHED_DOT_THREADS-1)/BATCHED_DOT_THREADS));
+
+	// One launch for all batch members, the few partial sums per member are added on the host
+	std::vector<size_t> partial_dims(1,blocks*batches);
+	cuNDArray<double> partial(partial_dims);
+	batched_real_dot_kernel<T><<<dim3(blocks,batches),BATCHED_DOT_THREADS>>>(x->get_data_ptr(),y->get_data_ptr(),batch_elements,partial.get_data_ptr());
+	CHECK_FOR_CUDA_ERROR();
+
+	std::vector<double> host_partial(blocks*batches);
+	CUDA_CALL(cudaMemcpy(&host_partial[0],partial.get_data_ptr(),host_partial.size()*sizeof(double),cudaMemcpyDeviceToHost));
+
+	std::vector<double> result(batches,0.0);
+	for (unsigned int b = 0; b < batches; b++)
+		for (unsigned int i = 0; i < blocks; i++)
+			result[b] += host_partial[b*blocks+i];
+	return result;
+}
+
+#define CG_UPDATE_MAX_BLOCKS 1024
+
+template <class T> __global__ static void cg_update_kernel(T alpha, const T* p, const T* q, T* x, T* r, size_t elements, double* partial){
+	__shared__ double cache[BATCHED_DOT_THREADS];
+	real_dot_functor<T> fun;
+
+	double sum = 0;
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x){
+		x[idx] += alpha*p[idx];
+		const T res = r[idx]-alpha*q[idx];
+		r[idx] = res;
+		sum += fun(res,res);
+	}
+	cache[threadIdx.x] = sum;
+	__syncthreads();
+
+	for (unsigned int i = blockDim.x/2; i > 0; i /= 2){
+		if (threadIdx.x < i)
+			cache[threadIdx.x] += cache[threadIdx.x+i];
+		__syncthreads();
+	}
+
+	if (threadIdx.x == 0)
+		partial[blockIdx.x] = cache[0];
+}
+
+template <class T> __global__ static void cg_update_only_kernel(T alpha, const T* p, const T* q, T* x, T* r, size_t elements){
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x){
+		x[idx] += alpha*p[idx];
+		r[idx] -= alpha*q[idx];
+	}
+}
+
+template<class T> double EXPORTGPUSOLVERS Gadgetron::solver_cg_update(T alpha, cuNDArray<T>* p, cuNDArray<T>* q, cuNDArray<T>* x, cuNDArray<T>* r, bool residual_norm)
+{
+	if( p == 0x0 || q == 0x0 || x == 0x0 || r == 0x0 )
+		throw std::runtime_error("solver_cg_update: 0x0 array not accepted");
+
+	const size_t elements = x->get_number_of_elements();
+	if( p->get_number_of_elements() != elements || q->get_number_of_elements() != elements || r->get_number_of_elements() != elements )
+		throw std::runtime_error("solver_cg_update: array dimensions mismatch");
+
+	if( !residual_norm ){
+		const unsigned int update_blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(65535,(elements+MAX_THREADS_PER_BLOCK-1)/MAX_THREADS_PER_BLOCK));
+		cg_update_only_kernel<T><<<update_blocks,MAX_THREADS_PER_BLOCK>>>(alpha,p->get_data_ptr(),q->get_data_ptr(),x->get_data_ptr(),r->get_data_ptr(),elements);
+		CHECK_FOR_CUDA_ERROR();
+		return 0.0;
+	}
+
+	const unsigned int blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(CG_UPDATE_MAX_BLOCKS,(elements+BATCHED_DOT_THREADS-1)/BATCHED_DOT_THREADS));
+
+	std::vector<size_t> partial_dims(1,blocks);
+	cuNDArray<double> partial(partial_dims);
+	cg_update_kernel<T><<<blocks,BATCHED_DOT_THREADS>>>(alpha,p->get_data_ptr(),q->get_data_ptr(),x->get_data_ptr(),r->get_data_ptr(),elements,partial.get_data_ptr());
+	CHECK_FOR_CUDA_ERROR();
+
+	std::vector<double> host_partial(blocks);
+	CUDA_CALL(cudaMemcpy(&host_partial[0],partial.get_data_ptr(),blocks*sizeof(double),cudaMemcpyDeviceToHost));
+
+	double result = 0.0;
+	for (unsigned int i = 0; i < blocks; i++)
+		result += host_partial[i];
+	return result;
+}
+
+template <class T> __global__ static void xpay_kernel(const T* z, T beta, T* p, size_t elements){
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x)
+		p[idx] = z[idx]+beta*p[idx];
+}
+
+template<class T> void EXPORTGPUSOLVERS Gadgetron::solver_xpay(cuNDArray<T>* z, T beta, cuNDArray<T>* p)
+{
+	if( z == 0x0 || p == 0x0 || z->get_number_of_elements() != p->get_number_of_elements() )
+		throw std::runtime_error("solver_xpay: invalid or mismatching input arrays");
+
+	const size_t elements = z->get_number_of_elements();
+	const unsigned int blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(65535,(elements+MAX_THREADS_PER_BLOCK-1)/MAX_THREADS_PER_BLOCK));
+	xpay_kernel<T><<<blocks,MAX_THREADS_PER_BLOCK>>>(z->get_data_ptr(),beta,p->get_data_ptr(),elements);
+	CHECK_FOR_CUDA_ERROR();
+}
+
+template <class T> __global__ static void batched_axpy_kernel(const T* a, const T* x, T* y, size_t batch_elements, size_t elements){
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x)
+		y[idx] += a[idx/batch_elements]*x[idx];
+}
+
+template <class T> __global__ static void batched_xpay_kernel(const T* z, const T* beta, T* p, size_t batch_elements, size_t elements){
+	for (size_t idx = blockIdx.x*blockDim.x+threadIdx.x; idx < elements; idx += blockDim.x*gridDim.x)
+		p[idx] = z[idx]+beta[idx/batch_elements]*p[idx];
+}
+
+template<class T> static boost::shared_ptr< cuNDArray<T> > batched_scalars(const std::vector<T>& values, size_t elements){
+	if( values.empty() || elements % values.size() )
+		throw std::runtime_error("solver batched update: the arrays do not split into the number of batches");
+	std::vector<size_t> dims(1,values.size());
+	boost::shared_ptr< cuNDArray<T> > scalars(new cuNDArray<T>(dims));
+	CUDA_CALL(cudaMemcpy(scalars->get_data_ptr(),&values[0],values.size()*sizeof(T),cudaMemcpyHostToDevice));
+	return scalars;
+}
+
+template<class T> void EXPORTGPUSOLVERS Gadgetron::solver_axpy_batched(const std::vector<T>& a, cuNDArray<T>* x, cuNDArray<T>* y)
+{
+	if( x == 0x0 || y == 0x0 || x->get_number_of_elements() != y->get_number_of_elements() )
+		throw std::runtime_error("solver_axpy_batched: invalid or mismatching input arrays");
+
+	const size_t elements = x->get_number_of_elements();
+	boost::shared_ptr< cuNDArray<T> > scalars = batched_scalars(a,elements);
+	const unsigned int blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(65535,(elements+MAX_THREADS_PER_BLOCK-1)/MAX_THREADS_PER_BLOCK));
+	batched_axpy_kernel<T><<<blocks,MAX_THREADS_PER_BLOCK>>>(scalars->get_data_ptr(),x->get_data_ptr(),y->get_data_ptr(),elements/a.size(),elements);
+	CHECK_FOR_CUDA_ERROR();
+}
+
+template<class T> void EXPORTGPUSOLVERS Gadgetron::solver_xpay_batched(cuNDArray<T>* z, const std::vector<T>& beta, cuNDArray<T>* p)
+{
+	if( z == 0x0 || p == 0x0 || z->get_number_of_elements() != p->get_number_of_elements() )
+		throw std::runtime_error("solver_xpay_batched: invalid or mismatching input arrays");
+
+	const size_t elements = z->get_number_of_elements();
+	boost::shared_ptr< cuNDArray<T> > scalars = batched_scalars(beta,elements);
+	const unsigned int blocks = (unsigned int) std::max<size_t>(1,std::min<size_t>(65535,(elements+MAX_THREADS_PER_BLOCK-1)/MAX_THREADS_PER_BLOCK));
+	batched_xpay_kernel<T><<<blocks,MAX_THREADS_PER_BLOCK>>>(z->get_data_ptr(),scalars->get_data_ptr(),p->get_data_ptr(),elements/beta.size(),elements);
+	CHECK_FOR_CUDA_ERROR();
+}
 
 template<class T> struct updateF_functor{
 
@@ -104,6 +300,36 @@ template void EXPORTGPUSOLVERS Gadgetron::updateFgroup<float_complext>(std::vect
 template void EXPORTGPUSOLVERS Gadgetron::updateFgroup<double_complext>(std::vector<cuNDArray<double_complext> >& data, double alpha, double sigma);
 
 
+template double EXPORTGPUSOLVERS Gadgetron::solver_real_dot<float>(cuNDArray<float>*, cuNDArray<float>*);
+template double EXPORTGPUSOLVERS Gadgetron::solver_real_dot<double>(cuNDArray<double>*, cuNDArray<double>*);
+template double EXPORTGPUSOLVERS Gadgetron::solver_real_dot<float_complext>(cuNDArray<float_complext>*, cuNDArray<float_complext>*);
+template double EXPORTGPUSOLVERS Gadgetron::solver_real_dot<double_complext>(cuNDArray<double_complext>*, cuNDArray<double_complext>*);
+
+template double EXPORTGPUSOLVERS Gadgetron::solver_cg_update<float>(float, cuNDArray<float>*, cuNDArray<float>*, cuNDArray<float>*, cuNDArray<float>*, bool);
+template double EXPORTGPUSOLVERS Gadgetron::solver_cg_update<double>(double, cuNDArray<double>*, cuNDArray<double>*, cuNDArray<double>*, cuNDArray<double>*, bool);
+template double EXPORTGPUSOLVERS Gadgetron::solver_cg_update<float_complext>(float_complext, cuNDArray<float_complext>*, cuNDArray<float_complext>*, cuNDArray<float_complext>*, cuNDArray<float_complext>*, bool);
+template double EXPORTGPUSOLVERS Gadgetron::solver_cg_update<double_complext>(double_complext, cuNDArray<double_complext>*, cuNDArray<double_complext>*, cuNDArray<double_complext>*, cuNDArray<double_complext>*, bool);
+
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay<float>(cuNDArray<float>*, float, cuNDArray<float>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay<double>(cuNDArray<double>*, double, cuNDArray<double>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay<float_complext>(cuNDArray<float_complext>*, float_complext, cuNDArray<float_complext>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay<double_complext>(cuNDArray<double_complext>*, double_complext, cuNDArray<double_complext>*);
+
+template std::vector<double> EXPORTGPUSOLVERS Gadgetron::solver_real_dot_batched<float>(cuNDArray<float>*, cuNDArray<float>*, unsigned int);
+template std::vector<double> EXPORTGPUSOLVERS Gadgetron::solver_real_dot_batched<double>(cuNDArray<double>*, cuNDArray<double>*, unsigned int);
+template std::vector<double> EXPORTGPUSOLVERS Gadgetron::solver_real_dot_batched<float_complext>(cuNDArray<float_complext>*, cuNDArray<float_complext>*, unsigned int);
+template std::vector<double> EXPORTGPUSOLVERS Gadgetron::solver_real_dot_batched<double_complext>(cuNDArray<double_complext>*, cuNDArray<double_complext>*, unsigned int);
+
+template void EXPORTGPUSOLVERS Gadgetron::solver_axpy_batched<float>(const std::vector<float>&, cuNDArray<float>*, cuNDArray<float>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_axpy_batched<double>(const std::vector<double>&, cuNDArray<double>*, cuNDArray<double>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_axpy_batched<float_complext>(const std::vector<float_complext>&, cuNDArray<float_complext>*, cuNDArray<float_complext>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_axpy_batched<double_complext>(const std::vector<double_complext>&, cuNDArray<double_complext>*, cuNDArray<double_complext>*);
+
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay_batched<float>(cuNDArray<float>*, const std::vector<float>&, cuNDArray<float>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay_batched<double>(cuNDArray<double>*, const std::vector<double>&, cuNDArray<double>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay_batched<float_complext>(cuNDArray<float_complext>*, const std::vector<float_complext>&, cuNDArray<float_complext>*);
+template void EXPORTGPUSOLVERS Gadgetron::solver_xpay_batched<double_complext>(cuNDArray<double_complext>*, const std::vector<double_complext>&, cuNDArray<double_complext>*);
+
 template void EXPORTGPUSOLVERS Gadgetron::solver_non_negativity_filter<float>(cuNDArray<float>*, cuNDArray<float>*);
 template void EXPORTGPUSOLVERS Gadgetron::solver_non_negativity_filter<double>(cuNDArray<double>*, cuNDArray<double>*);
 template void EXPORTGPUSOLVERS Gadgetron::solver_non_negativity_filter<float_complext>(cuNDArray<float_complext>*, cuNDArray<float_complext>*);
@@ -4,11 +4,35 @@
 #include "cuNDArray.h"
 #include "gpusolvers_export.h"
 
+#include <vector>
+
 namespace Gadgetron{
 
 template<class T> void EXPORTGPUSOLVERS solver_non_negativity_filter(cuNDArray<T>* x , cuNDArray<T>* g);
 
 
+// Real part of the inner product <x,y> with x conjugated, accumulated in double precision
+template<class T> double EXPORTGPUSOLVERS solver_real_dot(cuNDArray<T>* x, cuNDArray<T>* y);
+
+// Fused conjugate gradient updates: x += alpha*p, r -= alpha*q in a single pass over the arrays.
+// Returns <r,r> of the updated residual, accumulated in double precision.
+// Without residual_norm the reduction and its copy to the host are skipped and 0 is returned.
+template<class T> double EXPORTGPUSOLVERS solver_cg_update(T alpha, cuNDArray<T>* p, cuNDArray<T>* q, cuNDArray<T>* x, cuNDArray<T>* r, bool residual_norm = true);
+
+// p = z + beta*p
+template<class T> void EXPORTGPUSOLVERS solver_xpay(cuNDArray<T>* z, T beta, cuNDArray<T>* p);
+
+// Batched variants for 'batches' independent systems stored as consecutive equal-sized parts of the arrays.
+// The scalars are one per batch member.
+
+template<class T> std::vector<double> EXPORTGPUSOLVERS solver_real_dot_batched(cuNDArray<T>* x, cuNDArray<T>* y, unsigned int batches);
+
+// y_b += a_b*x_b
+template<class T> void EXPORTGPUSOLVERS solver_axpy_batched(const std::vector<T>& a, cuNDArray<T>* x, cuNDArray<T>* y);
+
+// p_b = z_b + beta_b*p_b
+template<class T> void EXPORTGPUSOLVERS solver_xpay_batched(cuNDArray<T>* z, const std::vector<T>& beta, cuNDArray<T>* p);
+
 template<class T> void EXPORTGPUSOLVERS updateF(cuNDArray<T>& data, typename realType<T>::Type alpha ,typename realType<T>::Type sigma);
 
 template<class T> void updateF(hoCuNDArray<T>& data, typename realType<T>::Type alpha ,typename realType<T>::Type sigma){
@@ -108,7 +108,7 @@ public:
 		REAL reg_res,data_res;
 
 
-		std::list<bfgsPair> subspace;
+		reset_history();
 
 		if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE ){
 			GDEBUG_STREAM("Iterating..." << std::endl);
@@ -151,7 +151,7 @@ public:
 				GDEBUG_STREAM("Iteration " <<i << ". Relative gradient norm: " <<  grad_norm/grad_norm0 << std::endl);
 			}
 
-			lbfgs_update(&g,&d,subspace);
+			update_direction(&g,&d);
 
 			if (this->precond_.get()){
 				this->precond_->apply(&d,&d);
@@ -255,23 +255,7 @@ public:
 			this->add_gradient(x,&g);
 
 
-			//Expand current BFGS subspace with new pair
-			bfgsPair pair;
-			if (subspace.size() == m_){
-				pair=subspace.back();
-				subspace.pop_back();
-				*(pair.s) = d;
-				*(pair.y) = g;
-			} else {
-				pair.s = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(d));
-				pair.y = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(g));
-			}
-			*(pair.s) *= alpha;
-			*(pair.y) -= g_old;
-
-			pair.rho = dot(pair.s.get(),pair.y.get());
-
-			subspace.push_front(pair);
+			add_correction_pair(&d,alpha,&g,&g_old);
 
 
 			iteration_callback(x,i,f);
@@ -397,6 +381,42 @@ protected:
 		ELEMENT_TYPE rho;
 	};
 
+	/***
+	 * @brief Empties the history of correction pairs, called at the start of every solve
+	 */
+	virtual void reset_history(){
+		subspace_.clear();
+	}
+
+	/***
+	 * @brief Computes the search direction d from the gradient g and the history of correction pairs
+	 */
+	virtual void update_direction(ARRAY_TYPE* g, ARRAY_TYPE* d){
+		lbfgs_update(g,d,subspace_);
+	}
+
+	/***
+	 * @brief Adds the pair s = alpha*d, y = g-g_old to the history, dropping the oldest pair once m_ are stored
+	 */
+	virtual void add_correction_pair(ARRAY_TYPE* d, REAL alpha, ARRAY_TYPE* g, ARRAY_TYPE* g_old){
+		bfgsPair pair;
+		if (subspace_.size() == m_){
+			pair=subspace_.back();
+			subspace_.pop_back();
+			*(pair.s) = *d;
+			*(pair.y) = *g;
+		} else {
+			pair.s = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(*d));
+			pair.y = boost::shared_ptr<ARRAY_TYPE>(new ARRAY_TYPE(*g));
+		}
+		*(pair.s) *= alpha;
+		*(pair.y) -= *g_old;
+
+		pair.rho = dot(pair.s.get(),pair.y.get());
+
+		subspace_.push_front(pair);
+	}
+
 	/***
 	 * @brief L-BFGS update, following algorithm 9.2 in Numerical Optimization
 	 * @param[in] g gradient
@@ -815,6 +835,8 @@ protected:
 
 	unsigned int m_; // Number of copies to use.
 
+	std::list<bfgsPair> subspace_;
+
 	// Preconditioner
 
 	std::vector<boost::shared_ptr<ARRAY_TYPE> > reg_priors;
@@ -61,6 +61,8 @@ public:
 			throw std::runtime_error("Error: nlcgSolver::compute_rhs : encoding operator has not set domain dimension" );
 		}
 
+		this->begin_solve(image_dims.get());
+
 		ARRAY_TYPE * x = new ARRAY_TYPE(image_dims.get()); //The image. Will be returned inside a shared_ptr
 
 		ARRAY_TYPE g(image_dims.get()); //Contains the gradient of the current step
@@ -106,6 +108,7 @@ public:
 		REAL grad_norm0;
 
 		for (int i = 0; i < iterations_; i++){
+			this->count_iteration();
 			if (i==0){
 				if (this->x0_.get()){
 					this->encoding_operator_->mult_M(x,&encoding_space);
@@ -273,9 +276,17 @@ public:
 
 			if (grad_norm/grad_norm0 < tc_tolerance_)  break;
 
+			if (this->stagnated(grad_norm/grad_norm0)){
+				if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE )
+					GDEBUG_STREAM("Terminating after iteration " << i << ": the gradient norm stagnates" << std::endl);
+				break;
+			}
+
 		}
 
-		return boost::shared_ptr<ARRAY_TYPE>(x);
+		boost::shared_ptr<ARRAY_TYPE> result(x);
+		this->end_solve(result);
+		return result;
 																															}
 
 
@@ -11,6 +11,7 @@
 #include <numeric>
 #include <vector>
 #include <functional>
+#include <future>
 #include <boost/iterator/counting_iterator.hpp>
 #include <boost/make_shared.hpp>
 
@@ -27,6 +28,7 @@ public:
 		non_negativity_=false;
 		reg_steps_=2;
 		_kappa = REAL(1);
+		pipelined_ = false;
 	}
 	virtual ~osMOMSolver(){};
 
@@ -52,6 +54,13 @@ public:
 
 	void set_reg_steps(unsigned int reg_steps){ reg_steps_ = reg_steps;}
 
+	/**
+	 * Projects the next subset while the current one is backprojected and applied, using mult_M_async of the encoding operator.
+	 * The projection of a subset is then taken from the image before the update of the previous subset.
+	 * @param pipelined
+	 */
+	void set_pipelined(bool pipelined=true){ pipelined_ = pipelined;}
+
 	boost::shared_ptr<ARRAY_TYPE> solve(ARRAY_TYPE* in){
 		//boost::shared_ptr<ARRAY_TYPE> rhs = compute_rhs(in);
 		if( this->encoding_operator_.get() == 0 ){
@@ -110,12 +119,29 @@ public:
 		std::vector<int> isubsets(boost::counting_iterator<int>(0), boost::counting_iterator<int>(this->encoding_operator_->get_number_of_subsets()));
 		REAL kappa_int = _kappa;
 		REAL step_size;
+
+		const int num_subsets = this->encoding_operator_->get_number_of_subsets();
+		const bool pipelined = pipelined_ && num_subsets > 1;
+		ARRAY_TYPE x_ahead;
+		std::future<void> projection_ahead;
+		auto project_ahead = [&](int subset){
+			x_ahead = *x;
+			projection_ahead = this->encoding_operator_->mult_M_async(&x_ahead,tmp_projections[subset].get(),subset,false);
+		};
+		if (pipelined && _iterations > 0)
+			project_ahead(isubsets[0]);
+
 		for (int i =0; i < _iterations; i++){
-			for (int isubset = 0; isubset < this->encoding_operator_->get_number_of_subsets(); isubset++){
+			for (int isubset = 0; isubset < num_subsets; isubset++){
 
 				t = 0.5*(1+std::sqrt(1+4*t*t));
 				int subset = isubsets[isubset];
-				this->encoding_operator_->mult_M(x,tmp_projections[subset].get(),subset,false);
+				if (pipelined){
+					projection_ahead.get();
+					if (i < _iterations-1 || isubset < num_subsets-1)
+						project_ahead(isubsets[(isubset+1)%num_subsets]);
+				} else
+					this->encoding_operator_->mult_M(x,tmp_projections[subset].get(),subset,false);
 				*tmp_projections[subset] -= *subsets[subset];
 				*tmp_projections[subset] *= ELEMENT_TYPE(-1);
 				if( this->output_mode_ >= solver<ARRAY_TYPE,ARRAY_TYPE>::OUTPUT_VERBOSE ){
@@ -214,6 +240,7 @@ protected:
 	REAL _beta, _gamma, _alpha, _kappa;
 	bool non_negativity_;
 	unsigned int reg_steps_;
+	bool pipelined_;
 	boost::shared_ptr<subsetOperator<ARRAY_TYPE> > encoding_operator_;
 	std::vector<boost::shared_ptr<generalOperator<ARRAY_TYPE>>> regularization_operators;
 	boost::shared_ptr<ARRAY_TYPE> preconditioning_image_;
@@ -556,6 +556,7 @@ protected:
 		// Define u_k
 		//
 		boost::shared_ptr<ARRAY_TYPE_ELEMENT> u_k( new ARRAY_TYPE_ELEMENT(this->encoding_operator_->get_domain_dimensions()) );
+		this->begin_solve( u_k->get_dimensions().get() );
 
 		// Use x0 (if provided) as starting solution estimate
 		//
@@ -581,6 +582,7 @@ protected:
 
 		// ... and return the result
 		//
+		this->end_solve(u_k);
 		return u_k;
     		}
 
@@ -720,6 +722,8 @@ protected:
 
 		for( unsigned int outer_iteration=0; outer_iteration<outer_iterations; outer_iteration++ ) {
 
+			this->count_iteration();
+
 			if( this->output_mode_ >= solver<ARRAY_TYPE_ELEMENT, ARRAY_TYPE_ELEMENT>::OUTPUT_VERBOSE )
 				GDEBUG_STREAM(std::endl << "SB outer loop iteration " << outer_iteration << std::endl << std::endl);
 
@@ -7,7 +7,10 @@
 #include <boost/shared_ptr.hpp>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <deque>
 #include "log.h"
+#include "GadgetronMetrics.h"
 namespace Gadgetron
 {
 
@@ -16,7 +19,7 @@ namespace Gadgetron
   public:
 
     // Constructor/destructor
-    solver() { output_mode_ = OUTPUT_SILENT; }
+    solver() { output_mode_ = OUTPUT_SILENT; warm_start_ = false; stagnation_iterations_ = 0; stagnation_ratio_ = 1.0; solve_iterations_ = 0; }
     virtual ~solver() {}
   
     // Output modes
@@ -33,6 +36,19 @@ namespace Gadgetron
     virtual void set_x0( boost::shared_ptr<ARRAY_TYPE_OUT> x0 ){ x0_ = x0; }
     virtual boost::shared_ptr<ARRAY_TYPE_OUT> get_x0(){ return x0_; }
 
+    // Warm start: keep the solution of every solve as the starting estimate (x0) of the next,
+    // e.g. for the consecutive frames of a dynamic series. An x0 of other dimensions is then dropped.
+    virtual void set_warm_start( bool warm_start ) { warm_start_ = warm_start; }
+    virtual bool get_warm_start() { return warm_start_; }
+
+    // Early termination on a stagnating convergence metric (the relative residual or gradient norm):
+    // stop when the metric is above 'ratio' times its value 'iterations' iterations before.
+    // Zero iterations (the default) disables the check.
+    virtual void set_stagnation_termination( unsigned int iterations, double ratio ){
+      stagnation_iterations_ = iterations;
+      stagnation_ratio_ = ratio;
+    }
+
     virtual void solver_warning(std::string warn){
       GDEBUG_STREAM(warn << std::endl);
     }
@@ -41,7 +57,49 @@ namespace Gadgetron
     virtual boost::shared_ptr<ARRAY_TYPE_OUT> solve( ARRAY_TYPE_IN* ) = 0;
 
   protected:
+
+    // Call at the start of a solve with the dimensions of the solution
+    virtual void begin_solve( std::vector<size_t> *dims ){
+      if( warm_start_ && x0_.get() && !x0_->dimensions_equal(dims) )
+        x0_.reset();
+      metric_history_.clear();
+      solve_iterations_ = 0;
+    }
+
+    // Call once per iteration of a solve, the number of iterations per solve is exported as a metric
+    virtual void count_iteration(){
+      solve_iterations_++;
+    }
+
+    // Call with the result at the end of a solve
+    virtual void end_solve( boost::shared_ptr<ARRAY_TYPE_OUT> result ){
+      if( warm_start_ && result.get() )
+        x0_ = boost::shared_ptr<ARRAY_TYPE_OUT>( new ARRAY_TYPE_OUT(*result) );
+
+      static GadgetronMetricHistogram& iterations =
+        GadgetronMetrics::instance().histogram("gadgetron_solver_iterations", "Iterations per solve of the iterative solvers");
+      iterations.add(solve_iterations_);
+    }
+
+    // Records the convergence metric of an iteration, returns true if the solve has stagnated
+    virtual bool stagnated( double metric ){
+      if( stagnation_iterations_ == 0 )
+        return false;
+      metric_history_.push_back(metric);
+      if( metric_history_.size() <= stagnation_iterations_ )
+        return false;
+      double past = metric_history_.front();
+      metric_history_.pop_front();
+      return metric > stagnation_ratio_*past;
+    }
+
     int output_mode_;
     boost::shared_ptr<ARRAY_TYPE_OUT> x0_;
+
+    bool warm_start_;
+    unsigned int stagnation_iterations_;
+    double stagnation_ratio_;
+    std::deque<double> metric_history_;
+    unsigned int solve_iterations_;
   };
 }